@@ -39,6 +39,12 @@ struct DeviceConfig;
 
 } // namespace runtime
 
+/// An entry point of a saved bundle, named \p name, running \p func.
+struct BundleEntry {
+  std::string name;
+  Function *func;
+};
+
 // This is the interface that glow backends need to implement.
 class Backend {
 public:
@@ -85,6 +91,16 @@ public:
     LOG(FATAL) << "Saving a bundle is not supported by the backend";
   }
 
+  /// Save a single bundle with an entry point for each of \p entries in
+  /// \p outputDir under name \p bundleName, prepending all generated files
+  /// with this name. The entry points share the constant weights and the
+  /// activations memory area, so they must not run concurrently.
+  virtual void saveFunctions(llvm::ArrayRef<BundleEntry> entries,
+                             llvm::StringRef outputDir,
+                             llvm::StringRef bundleName) const {
+    LOG(FATAL) << "Saving a bundle is not supported by the backend";
+  }
+
   /// Used by the compiler during graph optimization and before code generation,
   /// giving the backend an opportunity to transform the graph before IRGen. The
   /// backend may insert backend-specific nodes. The backend is responsible for
@@ -129,11 +145,23 @@ public:
   /// performed.
   virtual bool shouldShareBuffers() const { return true; }
 
+  /// \returns true if the Backend wants the activations planned offline from
+  /// their live intervals, see MemoryAllocator::allocateAll, rather than
+  /// allocated one by one in the order of the instructions.
+  virtual bool shouldPlanActivationsOffline() const { return false; }
+
+  /// \returns true if the Backend wants the nodes scheduled before IRGen to
+  /// minimize the predicted peak memory of the activations, see
+  /// PeakMemoryBasedScheduler, unless the command line picks a scheduler.
+  virtual bool shouldMinimizePeakMemory() const { return false; }
+
   /// Modify the \p optimizationOpts however desired.
   virtual FunctionPassPipeline getOptimizationPipeline() const;
 
   /// \returns true if the Backend supports partial, unpadded tensors for
-  /// inputs that can have variable size (e.g., embedding indices).
+  /// inputs that can have variable size (e.g., embedding indices). The
+  /// padding of a partial tensor reads as zeros, unless its placeholder is
+  /// ragged, see Placeholder::isRagged.
   virtual bool supportsPartialTensors() const { return false; }
 
   /// \returns true if Backend generated Instruction for Node \p N,
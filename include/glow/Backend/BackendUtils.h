@@ -18,6 +18,9 @@
 
 #include "glow/CodeGen/MemoryAllocator.h"
 #include "glow/IR/IR.h"
+#include "glow/Support/Memory.h"
+
+#include "llvm/ADT/DenseMap.h"
 
 #include <map>
 
@@ -58,6 +61,11 @@ class RuntimeBundle {
   SymbolTableTy symbolTable_;
   /// Pointer to memory containing the weights for execution.
   uint8_t *constants_{nullptr};
+  /// True if constants_ is shared with the RuntimeBundles with identical
+  /// weights, see collectConstants.
+  bool constantsShared_{false};
+  /// The pages backing constants_ if it isn't shared.
+  HugePages constantsPages_{HugePages::None};
   /// Amount of memory needed for weights.
   size_t constantWeightVarsMemSize_{0};
   /// Amount of memory needed for mutable vars.
@@ -88,21 +96,34 @@ public:
   /// This allows the graph to go away after compile time.
   /// Allocates a block of memory of size \p constantMaxSize then walks the
   /// given function \p F and and copies weights to their address as specified
-  /// by offsets contained in symbolTable_.
+  /// by offsets contained in symbolTable_. The block is then shared through
+  /// a reference-counted pool with all the RuntimeBundles whose weights have
+  /// the same content, such as the replicas and versions of a network, so
+  /// that identical weights are stored once.
+  /// Blocks of at least HugePageSize bytes are backed by the huge pages
+  /// selected by -constant-weights-huge-pages, which reduce the TLB misses of
+  /// the lookups into large tables.
   void collectConstants(const IRFunction *F);
   void collectConstants(const Module *M);
-  /// Free constants.
+  /// Free constants, or release them if they are shared.
   void freeConstants();
+  /// Erases the symbols of \p category from the symbol table, once the
+  /// compiled function no longer looks them up. The symbols of the constants
+  /// must be kept until the constants are collected.
+  void eraseSymbols(SymbolCategory category);
 
   /// Sets the input and output flags for each symbol in the symbolBundle.
   void setInputsandOutputs();
 
   /// Computes offsets and total allocation for Constants, Placeholders, and
   /// Activations to build runtime symbol table. Returns RuntimeBundle.
+  /// Activations are planned offline if \p planActivationsOffline, see
+  /// planActivations.
   static runtime::RuntimeBundle create(const IRFunction &F,
                                        MemoryAllocator &constantAllocator,
                                        MemoryAllocator &placeholderAllocator,
-                                       MemoryAllocator &activationsAllocator);
+                                       MemoryAllocator &activationsAllocator,
+                                       bool planActivationsOffline = false);
 
   /// Computes offsets and total allocation for Constants, Placeholders, and
   /// Activations to build runtime symbol table. \returns RuntimeBundle.
@@ -195,6 +216,15 @@ bool isOutput(const Placeholder *PH, const IRFunction &F);
 /// by the current function.
 bool isInput(const Placeholder *PH, const IRFunction &F);
 
+/// Allocates the activations of \p instrs with \p allocator in a single
+/// region associated with \p instrs, at offsets planned offline from their
+/// live intervals. Activations are live until their deallocation if \p
+/// reuseMemory, and until the end of \p instrs otherwise. \returns the
+/// addresses of the activations.
+llvm::DenseMap<const Value *, uint64_t>
+planActivations(const IRFunction::InstListTy &instrs,
+                MemoryAllocator &allocator, bool reuseMemory);
+
 /// If \p N does not have fused activation \returns true.
 template <typename T,
           std::enable_if_t<!has_getFusedActivation<T, FusedActivation>::value,
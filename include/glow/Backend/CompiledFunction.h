@@ -46,6 +46,11 @@ public:
   /// Collects constants for runtime.
   virtual void collectConstants(const Module *){};
 
+  /// Prepares the function for its first executions once its constants are
+  /// collected, e.g. by resolving its code and touching its memory, so that
+  /// they don't pay for it. \returns an Error if the function can't run.
+  virtual Error warmUp() { return Error::success(); }
+
   /// Setter for TraceEvent lookup. Note: does not enable tracing automatically.
   void setTraceInfo(TraceInfo &&info) { traceInfo_ = std::move(info); }
 
@@ -32,6 +32,11 @@ struct BackendHints {
 
   /// Storage nodes to be pinned to SRAM listed in order of priority.
   std::vector<std::string> SRAMPrioritization;
+
+  /// Whether the function is estimated to be bound by the DRAM bandwidth
+  /// rather than by compute, see isMemoryBound. A device running several
+  /// functions concurrently may limit how many such functions run at once.
+  bool memoryBound{false};
 };
 
 /// Options relevant to Backends during compilation.
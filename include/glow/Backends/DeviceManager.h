@@ -22,11 +22,14 @@
 #include "glow/Runtime/RuntimeTypes.h"
 #include "glow/Runtime/StatsExporter.h"
 #include "glow/Support/Error.h"
+#include "glow/Support/HostMemory.h"
 
 #include <atomic>
 #include <functional>
 #include <map>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 
 namespace glow {
 namespace runtime {
@@ -41,6 +44,66 @@ using ReadyCBTy = std::function<void(const Module *, Error)>;
 /// device.
 using FunctionMapTy = std::map<std::string, CompiledFunction *>;
 
+/// The bytes that a function added to a device takes on it.
+struct NetworkMemoryUsage {
+  /// Constant weights. Functions with identical weights share them, see
+  /// RuntimeBundle::collectConstants, and each of them counts them.
+  uint64_t constants{0};
+  /// Activations of the runs.
+  uint64_t activations{0};
+  /// Inputs and outputs of the runs.
+  uint64_t io{0};
+
+  NetworkMemoryUsage() = default;
+
+  /// The usage of a function compiled into \p bundle, one run at a time.
+  explicit NetworkMemoryUsage(const RuntimeBundle &bundle)
+      : constants(bundle.getConstantWeightSize()),
+        activations(bundle.getActivationsSize()),
+        io(bundle.getMutableWeightSize()) {}
+
+  /// \returns the bytes of the function.
+  uint64_t getTotal() const { return constants + activations + io; }
+};
+
+/// The memory of a device and the functions using it.
+struct DeviceMemoryUsage {
+  /// The bytes of the device, the ones taken and the ones free for new
+  /// functions.
+  uint64_t maxBytes{0};
+  uint64_t usedBytes{0};
+  uint64_t availableBytes{0};
+  /// The largest allocation the device can make, less than availableBytes
+  /// when its free memory is fragmented or its allocations are limited.
+  uint64_t largestFreeBlock{0};
+  /// The usage of the functions on the device by name.
+  std::map<std::string, NetworkMemoryUsage> networks;
+
+  /// \returns the fraction of the available memory that a single allocation
+  /// can't take, from 0 when it is contiguous towards 1.
+  double getFragmentation() const {
+    return availableBytes
+               ? 1.0 - double(largestFreeBlock) / double(availableBytes)
+               : 0.0;
+  }
+};
+
+/// \returns RUNTIME_REQUEST_CANCELLED if the run of \p context was
+/// cancelled, or RUNTIME_DEADLINE_EXCEEDED if its deadline passed, in which
+/// case the stage of the run of \p name that is about to start is dropped.
+inline Error checkAbandoned(const ExecutionContext &context,
+                            llvm::StringRef name) {
+  if (context.isCancelled()) {
+    return MAKE_ERR(ErrorValue::ErrorCode::RUNTIME_REQUEST_CANCELLED,
+                    "The run of " + name.str() + " was cancelled");
+  }
+  if (context.isPastDeadline()) {
+    return MAKE_ERR(ErrorValue::ErrorCode::RUNTIME_DEADLINE_EXCEEDED,
+                    "The run of " + name.str() + " missed its deadline");
+  }
+  return Error::success();
+}
+
 /// Interface managing a specific instance of a device.
 class DeviceManager {
 protected:
@@ -53,23 +116,68 @@ protected:
   /// String for logging used memory for the device.
   const std::string usedMemoryKey_{"glow.device.used_memory.device"};
 
+  /// String for logging the largest free block of the device.
+  const std::string largestFreeBlockKey_{
+      "glow.device.largest_free_block.device"};
+
   /// Maximum available memory on the device.
   std::atomic<uint64_t> maxMemoryBytes_{0};
 
   /// Amount of memory used by all models.
   std::atomic<uint64_t> usedMemoryBytes_{0};
 
+  /// Number of runs given to runFunction that didn't return yet, as counted
+  /// by the runtime.
+  std::atomic<unsigned> inflightRuns_{0};
+
+  /// Number of the functions on the device using each block of constant
+  /// weights. Functions with identical weights share a block, see
+  /// RuntimeBundle::collectConstants, which is counted once in
+  /// usedMemoryBytes_.
+  std::unordered_map<const uint8_t *, unsigned> constantsUsers_;
+
+  /// The memory usage of the functions on the device by name, which the
+  /// device thread updates while getMemoryUsage() reads it.
+  std::map<std::string, NetworkMemoryUsage> networkMemory_;
+  mutable std::mutex networkMemoryLock_;
+
+  /// \returns the bytes of constant weights that adding \p functions, whose
+  /// constants were collected, adds to the device. Blocks of constants that
+  /// are already on the device or shared by several of \p functions are only
+  /// counted once.
+  uint64_t getAddedConstantsSize(const FunctionMapTy &functions) const;
+
+  /// Counts \p function as a user of its constants. \returns the bytes of
+  /// constant weights added to the device.
+  uint64_t addConstantsUser(CompiledFunction *function);
+
+  /// Stops counting \p function as a user of its constants. \returns the bytes
+  /// of constant weights removed from the device.
+  uint64_t removeConstantsUser(CompiledFunction *function);
+
+  /// Records that the function \p name added to the device takes \p usage,
+  /// and exports it as the "glow.device.<kind>_memory.device<ID>.<name>"
+  /// counters.
+  void addNetworkMemoryUsage(const std::string &name,
+                             const NetworkMemoryUsage &usage);
+
+  /// Forgets the memory usage of the function \p name evicted from the
+  /// device, and zeroes its counters.
+  void removeNetworkMemoryUsage(const std::string &name);
+
   /// Helper method to export memory usage counters.
   void exportMemoryCounters() {
     Stats()->setCounter(availableMemoryKey_,
                         maxMemoryBytes_ - usedMemoryBytes_);
     Stats()->setCounter(usedMemoryKey_, usedMemoryBytes_);
+    Stats()->setCounter(largestFreeBlockKey_, getLargestFreeBlock());
   }
 
   /// Helper method to zero out memory counters, used when a device is freed.
   void zeroMemoryCounters() {
     Stats()->setCounter(availableMemoryKey_, 0);
     Stats()->setCounter(usedMemoryKey_, 0);
+    Stats()->setCounter(largestFreeBlockKey_, 0);
   }
 
 public:
@@ -79,6 +187,8 @@ public:
                             std::to_string(config_.deviceID)),
         usedMemoryKey_("glow.device.used_memory.device" +
                        std::to_string(config_.deviceID)),
+        largestFreeBlockKey_("glow.device.largest_free_block.device" +
+                             std::to_string(config_.deviceID)),
         maxMemoryBytes_(config_.getDeviceMemory(2000000000)) {}
   virtual ~DeviceManager() {}
 
@@ -120,6 +230,46 @@ public:
               std::unique_ptr<ExecutionContext> context,
               runtime::ResultCBTy resultCB) = 0;
 
+  /// Stage the inputs in \p context of a run of \p functionName that is given
+  /// to runFunction() later, e.g. start copying them to the device while it
+  /// works on the runs in flight, so that the copy is off the critical path
+  /// of the run. What is staged is kept in the DeviceBindings of \p context,
+  /// and runFunction() uses it instead of staging the inputs again. A device
+  /// may stage nothing, e.g. when all its buffers are busy, it then stages
+  /// the inputs in runFunction() as usual. Must not block on the runs in
+  /// flight. \returns an Error, with nothing staged, if the inputs cannot be
+  /// staged.
+  virtual Error prepareInputs(const std::string &functionName,
+                              ExecutionContext &context) {
+    return Error::success();
+  }
+
+  /// Release what prepareInputs() staged in \p context for a run of
+  /// \p functionName that isn't given to runFunction(), e.g. because another
+  /// part of the run failed.
+  virtual void releaseInputs(const std::string &functionName,
+                             ExecutionContext &context) {}
+
+  /// \returns the allocator of the host memory that the device transfers to
+  /// and from without staging, which the tensors of the runs, e.g. of a
+  /// TensorPool, may be allocated from. Devices that register memory with
+  /// their driver return their own allocator, the other ones page-locked
+  /// memory. May be called concurrently.
+  virtual HostMemoryAllocator &getHostMemoryAllocator() {
+    return getPageLockedAllocator();
+  }
+
+  /// Count a run that the runtime gives to runFunction, until
+  /// finishedRun() is called for it once its resultCB is called. The counts
+  /// tell the runtime how busy the device is.
+  void startedRun() { inflightRuns_++; }
+
+  /// Count a run counted by startedRun() as done.
+  void finishedRun() { inflightRuns_--; }
+
+  /// \returns the number of runs that were started and aren't finished.
+  unsigned getInflightRuns() const { return inflightRuns_; }
+
   /// Stops execution and shuts down the Device.
   virtual Error stop(bool block = true) { return Error::success(); };
 
@@ -146,6 +296,15 @@ public:
   /// fit on the device.
   virtual bool isMemoryAvailable(uint64_t estimate) const = 0;
 
+  /// \returns the bytes of the largest allocation the device can make for a
+  /// new network, which devices whose free memory fragments or whose
+  /// allocations are limited report; it is the available memory otherwise.
+  virtual uint64_t getLargestFreeBlock() const { return getAvailableMemory(); }
+
+  /// \returns the memory of the device and the memory each function on it
+  /// takes. May be called concurrently.
+  DeviceMemoryUsage getMemoryUsage() const;
+
   /// \returns the DeviceConfig which initialized this device.
   const DeviceConfig &getDeviceConfig() { return config_; }
 
@@ -19,6 +19,13 @@
 #include "glow/Graph/Graph.h"
 #include "glow/Graph/Nodes.h"
 
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/EquivalenceClasses.h"
+#include "llvm/ADT/STLExtras.h"
+
+#include <unordered_map>
+#include <unordered_set>
+
 namespace glow {
 
 /// Convert regular convolution nodes (that use NHWC) into a backend-specific
@@ -126,6 +133,283 @@ inline Node *convertAvgPoolGradToNCHWPool(AvgPoolGradNode *PGN, Function *F) {
   return NR;
 }
 
+/// Per-element costs a backend pays for the nodes whose layout
+/// assignNCHWLayouts() chooses. Only their ratios matter.
+struct LayoutCosts {
+  /// Cost of a convolution in NHWC and in NCHW.
+  float convNHWC{1};
+  float convNCHW{1};
+  /// Cost of a max or average pool in NHWC and in NCHW.
+  float poolNHWC{1};
+  float poolNCHW{1};
+  /// Cost of a transpose between NHWC and NCHW.
+  float transpose{1};
+};
+
+/// \returns whether \p N computes every element of its result from the
+/// elements at the same position in its inputs, so that it runs the same in
+/// any layout.
+inline bool isLayoutAgnostic(const Node *N) {
+  switch (N->getKind()) {
+  case Kinded::Kind::ReluNodeKind:
+  case Kinded::Kind::SigmoidNodeKind:
+  case Kinded::Kind::TanhNodeKind:
+  case Kinded::Kind::AddNodeKind:
+  case Kinded::Kind::SubNodeKind:
+  case Kinded::Kind::MulNodeKind:
+  case Kinded::Kind::MaxNodeKind:
+  case Kinded::Kind::MinNodeKind:
+    break;
+  default:
+    return false;
+  }
+  if (N->getNumResults() != 1 || N->getNthResult(0).dims().size() != 4) {
+    return false;
+  }
+  for (unsigned i = 0, e = N->getNumInputs(); i < e; i++) {
+    if (N->getNthInput(i).dims() != N->getNthResult(0).dims()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/// \returns the indices of the inputs of \p N that are in the layout of its
+/// results, if \p N is a layout agnostic node or an NHWC convolution or pool.
+inline llvm::SmallVector<unsigned, 2> getLayoutInputs(const Node *N) {
+  if (auto *CN = llvm::dyn_cast<ConvolutionNode>(N)) {
+    if (CN->getLayout() == NHWC) {
+      return {ConvolutionNode::InputIdx, ConvolutionNode::FilterIdx};
+    }
+    return {};
+  }
+  if (auto *PN = llvm::dyn_cast<MaxPoolNode>(N)) {
+    if (PN->getLayout() == NHWC) {
+      return {MaxPoolNode::InputIdx};
+    }
+    return {};
+  }
+  if (auto *PN = llvm::dyn_cast<AvgPoolNode>(N)) {
+    if (PN->getLayout() == NHWC) {
+      return {AvgPoolNode::InputIdx};
+    }
+    return {};
+  }
+  llvm::SmallVector<unsigned, 2> inputs;
+  if (isLayoutAgnostic(N)) {
+    for (unsigned i = 0, e = N->getNumInputs(); i < e; i++) {
+      inputs.push_back(i);
+    }
+  }
+  return inputs;
+}
+
+/// \returns the type of \p NV with its NHWC dims permuted to NCHW.
+inline TypeRef getNCHWType(NodeValue NV, Function *F) {
+  auto dimsNHWC = ShapeNHWC(NV.dims());
+  auto dimsNCHW = {dimsNHWC.n, dimsNHWC.c, dimsNHWC.h, dimsNHWC.w};
+  return F->getParent()->uniqueTypeWithNewShape(NV.getType(), dimsNCHW);
+}
+
+/// \returns a copy of \p N, an NHWC convolution or pool or a layout agnostic
+/// node, that computes its results in NCHW from the same inputs, which are
+/// expected to be in NCHW.
+inline Node *createNCHWNode(Node *N, Function *F) {
+  auto outTy = getNCHWType(N->getNthResult(0), F);
+  switch (N->getKind()) {
+  case Kinded::Kind::ConvolutionNodeKind: {
+    auto *CN = llvm::cast<ConvolutionNode>(N);
+    return F->addNode(new ConvolutionNode(
+        CN->getName(), outTy, CN->getInput(), CN->getFilter(), CN->getBias(),
+        CN->getKernels(), CN->getStrides(), CN->getPads(), CN->getGroup(),
+        CN->getDilation(), NCHW, CN->getFusedActivation()));
+  }
+  case Kinded::Kind::MaxPoolNodeKind: {
+    auto *PN = llvm::cast<MaxPoolNode>(N);
+    return F->addNode(new MaxPoolNode(
+        PN->getName(), outTy, getNCHWType(PN->getArgmax(), F), PN->getInput(),
+        PN->getKernels(), PN->getStrides(), PN->getPads(), NCHW));
+  }
+  case Kinded::Kind::AvgPoolNodeKind: {
+    auto *PN = llvm::cast<AvgPoolNode>(N);
+    return F->addNode(new AvgPoolNode(PN->getName(), outTy, PN->getInput(),
+                                      PN->getKernels(), PN->getStrides(),
+                                      PN->getPads(), NCHW));
+  }
+  case Kinded::Kind::ReluNodeKind:
+    return F->createRELU(N->getName(), N->getNthInput(0), outTy);
+  case Kinded::Kind::SigmoidNodeKind:
+    return F->createSigmoid(N->getName(), outTy, N->getNthInput(0));
+  case Kinded::Kind::TanhNodeKind:
+    return F->createTanh(N->getName(), outTy, N->getNthInput(0));
+#define ARITHMETIC_CASE(NODE_NAME_)                                            \
+  case Kinded::Kind::NODE_NAME_##NodeKind:                                     \
+    return F->create##NODE_NAME_(N->getName(), outTy, N->getNthInput(0),       \
+                                 N->getNthInput(1));
+    ARITHMETIC_CASE(Add);
+    ARITHMETIC_CASE(Sub);
+    ARITHMETIC_CASE(Mul);
+    ARITHMETIC_CASE(Max);
+    ARITHMETIC_CASE(Min);
+#undef ARITHMETIC_CASE
+  default:
+    llvm_unreachable("Node can't be converted to NCHW");
+  }
+}
+
+/// Convert the NHWC convolutions and pools of \p F that \p canUseNCHW
+/// accepts to NCHW, a region at a time. A region is a maximal connected group
+/// of such nodes and of the layout agnostic nodes between them. All of a
+/// region is converted at once, with a single transpose per value that enters
+/// or leaves it, and only when the \p costs of the backend say that the
+/// region gains more in NCHW than its transposes cost. Transposes of
+/// Constants are not counted, since they are folded. \returns whether \p F
+/// was changed.
+inline bool
+assignNCHWLayouts(Function *F, const LayoutCosts &costs,
+                  llvm::function_ref<bool(const Node *)> canUseNCHW) {
+  auto isNCHWCandidate = [&](const Node *N) {
+    return (llvm::isa<ConvolutionNode>(N) || llvm::isa<MaxPoolNode>(N) ||
+            llvm::isa<AvgPoolNode>(N)) &&
+           !getLayoutInputs(N).empty() && canUseNCHW(N);
+  };
+  auto isMember = [&](const Node *N) {
+    return isNCHWCandidate(N) || isLayoutAgnostic(N);
+  };
+
+  // Group the nodes into regions, kept in the order of the nodes of F.
+  // The layout inputs of the members are kept since the checks of
+  // isLayoutAgnostic() don't hold while a region is being converted.
+  llvm::EquivalenceClasses<Node *> regionOf;
+  std::vector<Node *> members;
+  llvm::DenseMap<Node *, llvm::SmallVector<unsigned, 2>> layoutInputs;
+  for (auto &N : F->getNodes()) {
+    if (!isMember(&N)) {
+      continue;
+    }
+    members.push_back(&N);
+    layoutInputs[&N] = getLayoutInputs(&N);
+    regionOf.insert(&N);
+    for (auto idx : layoutInputs[&N]) {
+      Node *input = N.getNthInput(idx).getNode();
+      if (input->getParent() == F && isMember(input)) {
+        regionOf.unionSets(&N, input);
+      }
+    }
+  }
+  llvm::DenseMap<Node *, std::vector<Node *>> regions;
+  std::vector<Node *> leaders;
+  for (auto *N : members) {
+    auto &region = regions[regionOf.getLeaderValue(N)];
+    if (region.empty()) {
+      leaders.push_back(regionOf.getLeaderValue(N));
+    }
+    region.push_back(N);
+  }
+
+  bool changed = false;
+  for (auto *leader : leaders) {
+    auto &region = regions[leader];
+    auto inRegion = [&](const Node *N) {
+      return regionOf.isEquivalent(const_cast<Node *>(N), leader);
+    };
+
+    // Weigh what the convolutions and pools gain against the transposes.
+    float gain = 0;
+    float loss = 0;
+    std::unordered_set<NodeValue> entering;
+    for (auto *N : region) {
+      float size = N->getNthResult(0).getType()->size();
+      if (llvm::isa<ConvolutionNode>(N)) {
+        gain += (costs.convNHWC - costs.convNCHW) * size;
+      } else if (llvm::isa<MaxPoolNode>(N) || llvm::isa<AvgPoolNode>(N)) {
+        gain += (costs.poolNHWC - costs.poolNCHW) * size;
+      }
+      for (auto idx : layoutInputs[N]) {
+        NodeValue input = N->getNthInput(idx);
+        if (!inRegion(input.getNode()) &&
+            !llvm::isa<Constant>(input.getNode()) &&
+            entering.insert(input).second) {
+          loss += costs.transpose * input.getType()->size();
+        }
+      }
+      for (unsigned i = 0, e = N->getNumResults(); i < e; i++) {
+        NodeValue result = N->getNthResult(i);
+        for (auto &U : result.getUsers()) {
+          if (!inRegion(U.getUser())) {
+            loss += costs.transpose * result.getType()->size();
+            break;
+          }
+        }
+      }
+    }
+    if (gain <= loss) {
+      continue;
+    }
+
+    // Remember the uses of the region outside of it, they get the results
+    // back in NHWC once the region is converted.
+    std::vector<std::pair<NodeValue, std::vector<NodeHandle *>>> leaving;
+    for (auto *N : region) {
+      for (unsigned i = 0, e = N->getNumResults(); i < e; i++) {
+        NodeValue result = N->getNthResult(i);
+        std::vector<NodeHandle *> sites;
+        for (auto &U : result.getUsers()) {
+          if (!inRegion(U.getUser())) {
+            sites.push_back(U.get());
+          }
+        }
+        if (!sites.empty()) {
+          leaving.emplace_back(result, std::move(sites));
+        }
+      }
+    }
+
+    // Transpose every value entering the region once.
+    std::unordered_map<NodeValue, NodeValue> transposed;
+    for (auto *N : region) {
+      for (auto idx : layoutInputs[N]) {
+        NodeValue input = N->getNthInput(idx);
+        if (inRegion(input.getNode())) {
+          continue;
+        }
+        auto it = transposed.find(input);
+        if (it == transposed.end()) {
+          auto *T = F->createTranspose(input.getNode()->getName().str() +
+                                           ".nchw",
+                                       input, NHWC2NCHW);
+          it = transposed.emplace(input, T->getResult()).first;
+        }
+        N->setNthInput(idx, it->second);
+      }
+    }
+
+    // Rebuild the nodes of the region in NCHW.
+    std::unordered_map<NodeValue, NodeValue> replaced;
+    for (auto *N : region) {
+      Node *NN = createNCHWNode(N, F);
+      for (unsigned i = 0, e = N->getNumResults(); i < e; i++) {
+        replaced[N->getNthResult(i)] = NN->getNthResult(i);
+      }
+    }
+    for (auto &R : replaced) {
+      R.first.typeUnsafeReplaceAllUsesOfWith(R.second, F);
+    }
+
+    // Transpose every value leaving the region once.
+    for (auto &L : leaving) {
+      NodeValue result = replaced[L.first];
+      auto *T = F->createTranspose(result.getNode()->getName().str() + ".nhwc",
+                                   result, NCHW2NHWC);
+      for (auto *site : L.second) {
+        *site = T->getResult();
+      }
+    }
+    changed = true;
+  }
+  return changed;
+}
+
 } // namespace glow
 
 #endif // GLOW_BACKENDS_LAYOUTCONVERTER_H
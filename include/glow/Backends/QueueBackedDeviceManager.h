@@ -18,6 +18,7 @@
 
 #include "glow/Backends/DeviceManager.h"
 #include "glow/Runtime/RuntimeTypes.h"
+#include "glow/Runtime/StatsExporter.h"
 #include "glow/Support/ThreadPool.h"
 
 #include <atomic>
@@ -71,9 +72,21 @@ public:
                               std::unique_ptr<ExecutionContext> context,
                               ResultCBTy callback) override {
     RunIdentifierTy id = nextIdentifier_++;
-    workThread_.submit([this, id, functionName = std::move(functionName),
+    auto queueTime = context->isStatsSampled()
+                         ? std::chrono::steady_clock::now()
+                         : std::chrono::steady_clock::time_point();
+    workThread_.submit([this, id, queueTime,
+                        functionName = std::move(functionName),
                         context = std::move(context),
                         callback = std::move(callback)]() mutable {
+      if (context->isStatsSampled()) {
+        Stats()->addLatencyValue("device_queue", functionName, queueTime);
+      }
+      // Drop the runs abandoned while they were queued.
+      if (auto err = checkAbandoned(*context, functionName)) {
+        callback(id, std::move(err), std::move(context));
+        return;
+      }
       runFunctionImpl(id, std::move(functionName), std::move(context),
                       std::move(callback));
     });
@@ -133,11 +133,12 @@ void readPngImageAndPreprocess(Tensor &imageData, llvm::StringRef filename,
 /// \param imageNormMode normalize values to this range.
 /// \param imageChannelOrder the order of color channels.
 /// \param imageLayout the order of dimensions (channel, height, and width).
+/// \param numThreads the number of threads decoding the images in parallel.
 void loadImagesAndPreprocess(const llvm::ArrayRef<std::string> &filenames,
                              Tensor *inputImageData,
                              ImageNormalizationMode imageNormMode,
                              ImageChannelOrder imageChannelOrder,
-                             ImageLayout imageLayout);
+                             ImageLayout imageLayout, unsigned numThreads = 1);
 } // namespace glow
 
 #endif // GLOW_BASE_IMAGE_H
@@ -18,6 +18,7 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <vector>
 
 #include "glow/Base/Type.h"
@@ -48,6 +49,22 @@ void genericTranspose(const Tensor *src, Tensor *dest,
 /// returned dims. For example, input {2,1,4} would result in {2,1,4,1,1,1}.
 ShapeVector expandDimsToMax(llvm::ArrayRef<size_t> currDims);
 
+/// Copies the \p n elements of \p src cast to DestElemType into \p dst.
+template <class DestElemType, class SrcElemType>
+void castElements(const SrcElemType *src, DestElemType *dst, size_t n) {
+  for (size_t idx = 0; idx != n; ++idx) {
+    dst[idx] = DestElemType(src[idx]);
+  }
+}
+
+/// The conversions between float and float16_t, in bulk.
+inline void castElements(const float *src, float16_t *dst, size_t n) {
+  convertFloatToFloat16(src, dst, n);
+}
+inline void castElements(const float16_t *src, float *dst, size_t n) {
+  convertFloat16ToFloat(src, dst, n);
+}
+
 /// A class that represents a contiguous n-dimensional array (a tensor).
 class Tensor final {
 public:
@@ -77,6 +94,7 @@ private:
   size_t unpaddedSize_{0};
 
   template <class ElemTy> friend class Handle;
+  friend class TensorPool;
 
   /// \returns a pointer to the tensor data buffer.
   char *getData() const { return data_; }
@@ -89,6 +107,13 @@ public:
   /// set return the size of the entire payload.
   size_t getUnpaddedSizeInBytes() const;
 
+  /// Sets the size of the unpadded memory region to \p size bytes, or to the
+  /// entire payload if \p size is zero.
+  void setUnpaddedSizeInBytes(size_t size) {
+    assert(size <= getSizeInBytes() && "Unpadded size exceeds the payload.");
+    unpaddedSize_ = size;
+  }
+
   /// \returns the type of the tensor.
   const Type &getType() const { return type_; }
 
@@ -577,11 +602,8 @@ public:
     assert(getElementType() != t->getElementType() &&
            "Use copyRawFrom instead");
     assert(actualSize() == t->actualSize() && "Different sizes");
-    const auto *src = t->getRawDataPointer<SrcElemType>();
-    auto *dst = getRawDataPointer<DestElemType>();
-    for (size_t idx = 0, end = actualSize(); idx != end; ++idx) {
-      dst[idx] = DestElemType(src[idx]);
-    }
+    castElements(t->getRawDataPointer<SrcElemType>(),
+                 getRawDataPointer<DestElemType>(), actualSize());
   }
 
   /// Convert each element of this tensor to \p newTy. Calls into
@@ -638,6 +660,22 @@ private:
                    bool verbose) const {
     auto const *myData = getRawDataPointer<ElemTy>();
     auto const *otherData = other.getRawDataPointer<ElemTy>();
+    if (!verbose) {
+      // Compare blocks of elements without exiting in the middle of a block,
+      // which lets the compiler vectorize the comparisons.
+      constexpr size_t blockSize = 256;
+      for (size_t b = 0, e = size(); b < e; b += blockSize) {
+        bool equal = true;
+        for (size_t i = b, be = std::min(e, b + blockSize); i < be; i++) {
+          double delta = myData[i] - otherData[i];
+          equal &= std::abs(delta) <= allowedError;
+        }
+        if (!equal) {
+          return false;
+        }
+      }
+      return true;
+    }
     double maxFoundError = 0.0;
     size_t maxFoundErrorIdx = 0, numExceedingError = 0;
     for (size_t i = 0, e = size(); i < e; i++) {
@@ -668,13 +706,7 @@ private:
   }
 
   bool isBitwiseEqualImpl(const Tensor &other) const {
-    auto const *myData = getUnsafePtr();
-    auto const *otherData = other.getUnsafePtr();
-    for (size_t i = 0, e = getSizeInBytes(); i < e; i++) {
-      if (myData[i] != otherData[i])
-        return false;
-    }
-    return true;
+    return !memcmp(getUnsafePtr(), other.getUnsafePtr(), getSizeInBytes());
   }
 };
 
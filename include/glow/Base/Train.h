@@ -34,6 +34,11 @@ struct TrainingConfig {
   float learningRate{0.01f};
   float momentum{0.0};
   unsigned batchSize{1};
+  /// If not 0, the bytes that the forward activations kept for the backward
+  /// pass should take. differentiate() then keeps only some activations, the
+  /// checkpoints, and recomputes the others from them in the backward pass.
+  /// 0 keeps all the activations.
+  uint64_t activationsMemoryBudget{0};
 };
 
 } // namespace glow
@@ -478,10 +478,16 @@ struct Type final {
   /// \returns a hash value for this Type. Hashes for Ty1 and Ty2 are equal if
   /// Ty1.isEqual(Ty2).
   llvm::hash_code equals_hash() const {
-    return llvm::hash_combine(
+    llvm::hash_code hash = llvm::hash_combine(
         elementType_, dims(),
-        // hashing floats is tricky, fall back to std::hash
-        std::hash<float>{}(scale_), offset_);
+        llvm::hash_combine_range(strides().begin(), strides().end()));
+    // isEqual ignores the scale and offset of the types that aren't
+    // quantized.
+    if (isQuantizedType()) {
+      // hashing floats is tricky, fall back to std::hash
+      hash = llvm::hash_combine(hash, std::hash<float>{}(scale_), offset_);
+    }
+    return hash;
   }
 
   ElemKind getElementType() const { return elementType_; }
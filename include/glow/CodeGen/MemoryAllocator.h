@@ -17,7 +17,7 @@
 #define GLOW_CODEGEN_MEMORYALLOCATOR_H
 #include <cstddef>
 #include <cstdint>
-#include <list>
+#include <map>
 #include <set>
 #include <string>
 #include <unordered_map>
@@ -42,6 +42,67 @@ public:
   bool contains(uint64_t idx) const { return idx >= begin_ && idx < end_; }
 };
 
+/// The free segments between the allocations of a MemoryAllocator, ordered by
+/// address in a treap whose nodes also hold the size of the largest segment of
+/// their subtree. This finds the free segment of lowest address which fits an
+/// allocation, and the neighbours of a freed segment, in O(log n). The
+/// priorities of the nodes are pseudo-random but deterministic, so that the
+/// same operations always build the same tree.
+class FreeSegments {
+  struct Node {
+    uint64_t begin;
+    uint64_t end;
+    /// The size of the largest segment of the subtree of the node.
+    uint64_t maxSize;
+    uint32_t priority;
+    /// The indices of the children in nodes_, or -1.
+    int left;
+    int right;
+  };
+
+  /// The nodes of the tree, and the indices of the unused ones.
+  std::vector<Node> nodes_;
+  std::vector<int> unused_;
+  /// The index of the root, or -1 if the tree is empty.
+  int root_{-1};
+  /// The state of the generator of the priorities.
+  uint32_t seed_{0x9e3779b9};
+
+  /// Recomputes the largest size of the subtree of \p n from its children.
+  void update(int n);
+
+  /// Splits the tree \p n into the trees \p left of the segments beginning
+  /// before \p begin and \p right of the others.
+  void split(int n, uint64_t begin, int &left, int &right);
+
+  /// \returns the tree of the segments of \p left, which are all before the
+  /// ones of \p right, followed by the ones of \p right.
+  int merge(int left, int right);
+
+public:
+  /// Removes all the segments.
+  void clear();
+
+  /// Adds the free segment [\p begin, \p end), which must not overlap any
+  /// other.
+  void insert(uint64_t begin, uint64_t end);
+
+  /// Removes the free segment beginning at \p begin.
+  void erase(uint64_t begin);
+
+  /// \returns the free segment of lowest address which holds \p size bytes
+  /// in \p segment, or false if there is none.
+  bool findFirstFit(uint64_t size, Segment &segment) const;
+
+  /// \returns the free segment of highest address beginning before \p addr
+  /// in \p segment, or false if there is none.
+  bool findBefore(uint64_t addr, Segment &segment) const;
+
+  /// \returns the free segment beginning at \p begin in \p segment, or false
+  /// if there is none.
+  bool findAt(uint64_t begin, Segment &segment) const;
+};
+
 /// Allocates segments of memory.
 /// Each allocation is associated with a user-defined handle, typically
 /// representing a client-specific object, e.g. a handle can be a `Value *` and
@@ -57,24 +118,35 @@ public:
   /// A reserved value to mark invalid allocation.
   static const uint64_t npos;
 
+  /// A buffer whose live interval is known before it is allocated, see
+  /// allocateAll. The buffer is live from time \p begin until, excluding, time
+  /// \p end, where times are usually the positions of the instructions that
+  /// allocate and free it.
+  struct Buffer {
+    uint64_t size;
+    uint64_t begin;
+    uint64_t end;
+  };
+
   explicit MemoryAllocator(const std::string &name, uint64_t poolSize)
       : name_(name), poolSize_(poolSize) {}
 
   void reset() {
     maxMemoryAllocated_ = 0;
     allocations_.clear();
+    freeSegments_.clear();
     handleToAllocInfo_.clear();
     addrToHandle_.clear();
   }
 
   /// \returns True if the value \p idx is within the currently allocated range.
   bool contains(uint64_t idx) const {
-    for (auto &s : allocations_) {
-      if (s.contains(idx)) {
-        return true;
-      }
+    auto it = allocations_.upper_bound(idx);
+    if (it == allocations_.begin()) {
+      return false;
     }
-    return false;
+    --it;
+    return idx < it->second;
   }
 
   /// Allocate a region of size \p size and associate a \p handle with it.
@@ -94,6 +166,33 @@ public:
                     const std::set<Handle> &mustNotEvict,
                     std::vector<Handle> &evicted);
 
+  /// Allocate a single region, associated with \p handle, that holds all the
+  /// \p buffers at offsets planned offline from their live intervals, so that
+  /// buffers live at the same time don't overlap. The addresses of the
+  /// buffers are stored in \p addrs. Freeing \p handle frees all of them.
+  /// \p buffers must not be empty.
+  /// \returns the address of the region, or MemoryAllocator::npos, if the
+  /// allocation failed.
+  uint64_t allocateAll(const std::vector<Buffer> &buffers, Handle handle,
+                       std::vector<uint64_t> &addrs);
+
+  /// Plan the \p buffers by replaying their allocations and deallocations in
+  /// time order with the first-fit strategy of allocate, storing their
+  /// offsets in \p offsets. \returns the size of the planned region.
+  static uint64_t planFirstFit(const std::vector<Buffer> &buffers,
+                               std::vector<uint64_t> &offsets);
+
+  /// Plan the \p buffers greedily by decreasing size, placing each of them in
+  /// the smallest gap left between the already placed buffers that are live at
+  /// the same time, storing their offsets in \p offsets. \returns the size of
+  /// the planned region.
+  static uint64_t planBestFit(const std::vector<Buffer> &buffers,
+                              std::vector<uint64_t> &offsets);
+
+  /// \returns the maximum total size of the \p buffers live at the same time,
+  /// which is a lower bound of the size of any plan of them.
+  static uint64_t getMaxLiveSize(const std::vector<Buffer> &buffers);
+
   /// \returns the handle currently associated with the allocation at \p
   /// address.
   Handle getHandle(uint64_t ptr) const;
@@ -129,8 +228,10 @@ public:
 private:
   /// The name of the memory region.
   std::string name_;
-  /// A list of live buffers.
-  std::list<Segment> allocations_;
+  /// Maps the beginnings of the live buffers to their ends.
+  std::map<uint64_t, uint64_t> allocations_;
+  /// The free segments between the live buffers, below the last one.
+  FreeSegments freeSegments_;
   /// The size of the memory region that we can allocate segments into.
   uint64_t poolSize_;
   /// This is the high water mark for the allocated memory.
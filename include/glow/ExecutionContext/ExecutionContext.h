@@ -21,6 +21,10 @@
 
 #include "llvm/ADT/STLExtras.h"
 
+#include <atomic>
+#include <chrono>
+#include <memory>
+
 namespace glow {
 
 /// Sub-classed per backend, this holds Device specific per-function information
@@ -37,6 +41,21 @@ public:
   }
 };
 
+/// A token shared with the runtime by a client that may give up on its runs.
+/// Once the token is cancelled, the runtime drops the work of the runs that
+/// hasn't started: it checks the token before dispatching a queued request,
+/// before running each node of a DAG and before a device runs a function.
+class CancellationToken {
+  std::atomic<bool> cancelled_{false};
+
+public:
+  /// Cancels the runs of the contexts holding this token.
+  void cancel() { cancelled_ = true; }
+
+  /// \returns whether the token was cancelled.
+  bool isCancelled() const { return cancelled_; }
+};
+
 /// The runtime context for a single execution (Inferance or Training) in the
 /// the Glow Execution Engine or HostManager. This class includes the mapping
 /// between Input/Output Placeholders and the materialized Tensors used for this
@@ -47,6 +66,17 @@ class ExecutionContext {
   std::unique_ptr<DeviceBindings> deviceBindings_;
   std::unique_ptr<TraceContext> traceContext_;
 
+  /// Whether the latency of the stages of this run is exported to the
+  /// StatsExporterRegistry.
+  bool statsSampled_{false};
+
+  /// The token cancelling this run, if any.
+  std::shared_ptr<CancellationToken> cancellationToken_;
+
+  /// The time after which this run is abandoned.
+  std::chrono::steady_clock::time_point deadline_{
+      std::chrono::steady_clock::time_point::max()};
+
   /// Trace Events recorded during this run.
 
 public:
@@ -104,6 +134,51 @@ public:
     return traceContext;
   }
 
+  /// \returns whether the latency of the stages of this run is exported.
+  bool isStatsSampled() const { return statsSampled_; }
+
+  /// Sets whether the latency of the stages of this run is exported.
+  void setStatsSampled(bool sampled) { statsSampled_ = sampled; }
+
+  /// \returns the token cancelling this run, or null.
+  const std::shared_ptr<CancellationToken> &getCancellationToken() const {
+    return cancellationToken_;
+  }
+
+  /// Sets the token cancelling this run.
+  void setCancellationToken(std::shared_ptr<CancellationToken> token) {
+    cancellationToken_ = std::move(token);
+  }
+
+  /// \returns whether this run was cancelled.
+  bool isCancelled() const {
+    return cancellationToken_ && cancellationToken_->isCancelled();
+  }
+
+  /// \returns the time after which this run is abandoned, or the maximum
+  /// time point if it has no deadline.
+  std::chrono::steady_clock::time_point getDeadline() const {
+    return deadline_;
+  }
+
+  /// Sets the time after which this run is abandoned.
+  void setDeadline(std::chrono::steady_clock::time_point deadline) {
+    deadline_ = deadline;
+  }
+
+  /// \returns whether the deadline of this run passed.
+  bool isPastDeadline() const {
+    return deadline_ != std::chrono::steady_clock::time_point::max() &&
+           std::chrono::steady_clock::now() > deadline_;
+  }
+
+  /// Gives this context the token and the deadline of \p other, for the
+  /// stages of the run of \p other.
+  void inheritCancellation(const ExecutionContext &other) {
+    cancellationToken_ = other.cancellationToken_;
+    deadline_ = other.deadline_;
+  }
+
   /// Clones this ExecutionContext, but does not clone underlying Tensors.
   ExecutionContext clone() {
     if (deviceBindings_) {
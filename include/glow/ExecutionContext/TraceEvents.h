@@ -26,6 +26,7 @@
 namespace glow {
 
 class PlaceholderBindings;
+class TraceRecorder;
 
 /// An individual tracing event, such as the begin or end of an instruction.
 /// Designed to match the Google Trace Event Format for Chrome:
@@ -38,6 +39,7 @@ struct TraceEvent {
     RUNTIME = 0x02,  // Glow runtime events only.
     OPERATOR = 0x04, // Backend operator instrumentation only.
     DEBUG = 0x08,    // Full debug events with extra information.
+    COMPILE = 0x10,  // Compilation stages and passes only.
     STANDARD =
         RUNTIME | OPERATOR, // Glow runtime events and backend operator events.
   };
@@ -160,9 +162,22 @@ class TraceContext {
   /// Lock around traceEvents_.
   std::mutex lock_;
 
+  /// The recorder events are logged into rather than traceEvents_, if any.
+  TraceRecorder *recorder_{nullptr};
+
 public:
   TraceContext(TraceLevel level) : traceLevel_(level) {}
 
+  /// Creates a context that logs the events of \p level into \p recorder,
+  /// without their attributes, rather than keeping them. Such a context is
+  /// cheap enough to trace a sample of production traffic.
+  TraceContext(TraceLevel level, TraceRecorder *recorder)
+      : traceLevel_(level), recorder_(recorder) {}
+
+  /// \returns the recorder events are logged into, or nullptr if they are
+  /// kept in the context.
+  TraceRecorder *getRecorder() const { return recorder_; }
+
   /// \returns TraceEvents for the last run.
   std::vector<TraceEvent> &getTraceEvents() { return traceEvents_; }
 
@@ -209,7 +224,8 @@ public:
   std::map<int, std::string> &getThreadNames() { return threadNames_; }
 
   /// Dumps all TraceEvents in json format to the given \p filename,
-  /// optionally with a provided \p processName.
+  /// optionally with a provided \p processName. A context logging into a
+  /// recorder dumps all the events of the recorder.
   void dump(llvm::StringRef filename, const std::string &processName = "");
 
   /// Moves all TraceEvents and thread names in \p other into this context.
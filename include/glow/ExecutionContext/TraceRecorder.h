@@ -0,0 +1,159 @@
+/**
+ * Copyright (c) Glow Contributors. See CONTRIBUTORS file.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef GLOW_EXECUTIONCONTEXT_TRACERECORDER_H
+#define GLOW_EXECUTIONCONTEXT_TRACERECORDER_H
+
+#include "glow/ExecutionContext/TraceEvents.h"
+
+#include "llvm/ADT/StringMap.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace glow {
+
+/// A fixed-size binary trace record, see TraceRecorder.
+struct TraceRecord {
+  /// Time of the event, in microseconds in the TraceEvent::now() domain.
+  uint64_t timestamp;
+  /// Duration of the event, for Complete events.
+  uint64_t duration;
+  /// Interned name of the event, see TraceRecorder::intern.
+  uint32_t nameId;
+  /// Type of the event, see TraceEvent.
+  char type;
+};
+
+/// Process-wide recorder of cheap trace events, meant to be left on for a
+/// sample of production traffic. Every thread writes fixed-size TraceRecords
+/// with interned names into its own lock-free ring buffer, without allocating
+/// or taking a lock once the thread has seen a name. A background thread
+/// drains the ring buffers into TraceEvents, which are dumped in the same
+/// Chrome trace format as TraceContext::dump. A record that doesn't fit in a
+/// full ring buffer or in the flushed events is dropped rather than waited
+/// for. A TraceContext created with a TraceRecorder logs into it.
+class TraceRecorder final {
+public:
+  /// Number of records of the ring buffer of each thread.
+  static constexpr size_t kThreadBufferSize = 1 << 14;
+
+  /// Maximum number of flushed events kept until they are taken.
+  static constexpr size_t kMaxFlushedEvents = 1 << 20;
+
+  /// Interval between two flushes of the background thread.
+  static constexpr std::chrono::milliseconds kFlushInterval{10};
+
+  TraceRecorder();
+  ~TraceRecorder();
+
+  TraceRecorder(const TraceRecorder &) = delete;
+  TraceRecorder &operator=(const TraceRecorder &) = delete;
+
+  /// Records an event of type \p type named \p name at \p timestamp, lasting
+  /// \p duration for Complete events, on the ring buffer of the calling
+  /// thread. May be called concurrently.
+  void record(llvm::StringRef name, char type, uint64_t timestamp,
+              uint64_t duration = 0);
+
+  /// \returns the id of \p name, the same for all threads.
+  uint32_t intern(llvm::StringRef name);
+
+  /// Sets the human readable \p name for thread \p tid.
+  void setThreadName(int tid, llvm::StringRef name);
+
+  /// Drains the ring buffers of all threads into the flushed events now
+  /// rather than on the next flush of the background thread.
+  void flush();
+
+  /// \returns the flushed events after removing them from the recorder.
+  std::vector<TraceEvent> takeTraceEvents();
+
+  /// Flushes the ring buffers, then dumps and removes the flushed events in
+  /// json format to \p filename, optionally with a provided \p processName.
+  void dump(llvm::StringRef filename, const std::string &processName = "");
+
+  /// \returns the number of records dropped because a ring buffer or the
+  /// flushed events were full.
+  uint64_t getDroppedCount() const { return dropped_; }
+
+private:
+  /// The single producer single consumer ring buffer of a thread.
+  struct ThreadBuffer {
+    std::unique_ptr<TraceRecord[]> records{new TraceRecord[kThreadBufferSize]};
+    /// Position of the next record, written by the thread.
+    std::atomic<size_t> head{0};
+    /// Position of the next record to flush, written by the flusher.
+    std::atomic<size_t> tail{0};
+    /// TraceEvent::getThreadId() of the thread.
+    int tid;
+    /// Ids of the names the thread has seen, which saves it from taking
+    /// namesLock_.
+    llvm::StringMap<uint32_t> nameCache;
+  };
+
+  /// \returns the ring buffer of the calling thread, registering it first if
+  /// the thread has never recorded into this recorder.
+  ThreadBuffer &getThreadBuffer();
+
+  /// Drains all ring buffers into flushed_. Requires flushLock_.
+  void drain();
+
+  /// Body of the background flush thread.
+  void flushLoop();
+
+  /// Unique id of the recorder, which identifies its ring buffers in the
+  /// thread local storage of threads.
+  const uint64_t id_;
+
+  /// The interned names, indexed by their id, and their ids.
+  std::vector<std::string> names_;
+  llvm::StringMap<uint32_t> nameIds_;
+  std::mutex namesLock_;
+
+  /// The ring buffers of all threads, kept after the threads exit so that
+  /// their last records are flushed.
+  std::vector<std::shared_ptr<ThreadBuffer>> buffers_;
+  std::mutex buffersLock_;
+
+  /// Events flushed from the ring buffers, human readable thread names and
+  /// a copy of the interned names for the flusher.
+  std::vector<TraceEvent> flushed_;
+  std::map<int, std::string> threadNames_;
+  std::vector<std::string> flushedNames_;
+  std::mutex flushLock_;
+
+  /// Number of records dropped.
+  std::atomic<uint64_t> dropped_{0};
+
+  /// The background flush thread, which runs until stop_ is set.
+  bool stop_{false};
+  std::condition_variable stopCV_;
+  std::mutex stopLock_;
+  std::thread flushThread_;
+};
+
+/// \returns the process-wide TraceRecorder.
+TraceRecorder *getTraceRecorder();
+
+} // namespace glow
+
+#endif // GLOW_EXECUTIONCONTEXT_TRACERECORDER_H
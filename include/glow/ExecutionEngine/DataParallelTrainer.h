@@ -0,0 +1,125 @@
+/**
+ * Copyright (c) Glow Contributors. See CONTRIBUTORS file.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef GLOW_EXECUTIONENGINE_DATAPARALLELTRAINER_H
+#define GLOW_EXECUTIONENGINE_DATAPARALLELTRAINER_H
+
+#include "glow/Base/Train.h"
+#include "glow/ExecutionContext/ExecutionContext.h"
+#include "glow/Graph/Graph.h"
+#include "glow/Graph/PlaceholderBindings.h"
+#include "glow/Runtime/HostManager/HostManager.h"
+#include "glow/Support/Error.h"
+#include "glow/Support/ThreadPool.h"
+
+#include "llvm/ADT/ArrayRef.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace glow {
+
+/// Sums the float tensors \p buffers in place with a ring all-reduce, so that
+/// all of them end up holding the sum. Every buffer is split in as many
+/// chunks as there are buffers. Buffer i adds chunk i - s to buffer i + 1 at
+/// step s of the reduce-scatter, then copies the summed chunks around the
+/// ring during the all-gather, which moves 2 * (n - 1) / n of a buffer per
+/// buffer, the same amount whatever the number of buffers. The steps of the
+/// buffers run in parallel on \p pool. All the buffers must have the same
+/// type.
+void ringAllReduce(llvm::ArrayRef<Tensor *> buffers, ThreadPool &pool);
+
+/// Trains a Function with data parallelism: the training Function is
+/// replicated on the devices of a HostManager, every replica computes the
+/// gradients of a shard of the minibatch, the gradients are summed over the
+/// replicas with ringAllReduce() in host memory, and every replica applies the
+/// same SGD update to its own copy of the weights. The result is the one of
+/// training on a single device with a minibatch numReplicas times larger.
+class DataParallelTrainer final {
+  /// The Module of the Functions, owned by hostManager_ once compiled.
+  std::unique_ptr<Module> module_;
+  Module *rawModule_;
+
+  /// The HostManager with a device per replica.
+  std::unique_ptr<runtime::HostManager> hostManager_;
+
+  unsigned numReplicas_;
+
+  /// The Function computing the gradients of the weights, and the Function
+  /// applying the SGD update with the summed gradients.
+  std::string gradName_;
+  std::string updateName_;
+
+  /// The trainable Placeholders and the Placeholders of their gradients.
+  std::vector<std::pair<Placeholder *, Placeholder *>> weights_;
+
+  /// The context of every replica, which holds the weights, the gradients
+  /// and the momentum of the replica between the runs.
+  std::vector<std::unique_ptr<ExecutionContext>> contexts_;
+
+  /// The threads of the all-reduce.
+  std::unique_ptr<ThreadPool> pool_;
+
+  /// Runs \p name on every replica concurrently. \returns the first Error of
+  /// the runs.
+  Error runReplicas(llvm::StringRef name);
+
+public:
+  /// Creates a trainer of \p numReplicas replicas, each on a device of
+  /// \p backend with \p deviceMemory bytes, or the default memory if 0.
+  DataParallelTrainer(llvm::StringRef backend, unsigned numReplicas,
+                      uint64_t deviceMemory = 0);
+
+  ~DataParallelTrainer();
+
+  /// \returns the Module to build the Function to train in.
+  Module &getModule() { return *rawModule_; }
+
+  /// \returns the number of replicas.
+  unsigned getNumReplicas() const { return numReplicas_; }
+
+  /// Differentiates \p F, whose inputs hold the shard of the minibatch of one
+  /// replica, adds the Function applying the updates described by \p config
+  /// and compiles the Module. config.batchSize is the size of a shard, the
+  /// gradients are averaged over the whole minibatch. \p F itself is erased,
+  /// only its gradient and update Functions are compiled. Can only be called
+  /// once.
+  Error compile(Function *F, const TrainingConfig &config,
+                CompilationContext &cctx);
+
+  /// Copies the tensors of \p bindings into every replica, e.g. the initial
+  /// values of the weights. Placeholders that \p bindings doesn't hold are
+  /// zeros, or keep their values from the previous runs.
+  void loadBindings(const PlaceholderBindings &bindings);
+
+  /// Copies the tensors of the Placeholders held by \p bindings from the first
+  /// replica into \p bindings, e.g. the trained weights. All the replicas hold
+  /// the same weights.
+  void storeBindings(PlaceholderBindings &bindings) const;
+
+  /// Like runBatch(), runs \p iterations training steps with slices of
+  /// \p inputs for \p ph, consuming numReplicas shards per step. Replica r
+  /// gets the shard starting at slice \p sampleCounter + r * shard size, and
+  /// \p sampleCounter counts the samples of all the replicas.
+  Error train(size_t iterations, size_t &sampleCounter,
+              llvm::ArrayRef<Placeholder *> ph,
+              llvm::ArrayRef<Tensor *> inputs);
+};
+
+} // namespace glow
+
+#endif // GLOW_EXECUTIONENGINE_DATAPARALLELTRAINER_H
@@ -53,6 +53,9 @@ class ExecutionEngine final {
   /// Whether to ignore the user-specified DeviceConfig.
   bool ignoreUserDeviceConfig_{false};
 
+  /// Number of devices of the backend the functions are compiled for.
+  unsigned numDevices_{1};
+
   /// The HostManager for executing the compiled functions.
   std::unique_ptr<runtime::HostManager> hostManager_;
 
@@ -64,12 +67,15 @@ class ExecutionEngine final {
   void runInternal(ExecutionContext &context, llvm::StringRef name);
 
 public:
-  /// Constructor for an ExecutionEngine with \p backend and memory \p
-  /// deviceMemory in bytes. If \p ignoreUserDeviceConfig then user device
-  /// configs will be ignored.
+  /// Constructor for an ExecutionEngine with \p numDevices devices of
+  /// \p backend, each with memory \p deviceMemory in bytes. If
+  /// \p ignoreUserDeviceConfig then user device configs will be ignored. With
+  /// several devices every function is compiled for all of them, and the
+  /// runs started with runAsync are spread over the devices.
   ExecutionEngine(llvm::StringRef backend = "Interpreter",
                   uint64_t deviceMemory = 0,
-                  bool ignoreUserDeviceConfig = false);
+                  bool ignoreUserDeviceConfig = false,
+                  unsigned numDevices = 1);
 
   ~ExecutionEngine();
 
@@ -88,6 +94,9 @@ public:
   /// Get the name of the current backend in use.
   llvm::StringRef getBackendName() const;
 
+  /// \returns the number of devices the functions run on.
+  unsigned getNumDevices() const { return numDevices_; }
+
   /// \returns the internal graph. Note: After compilation the contents of the
   /// module will have been altered and raw pointers to elements of the graph
   /// may no longer be valid.
@@ -127,6 +136,12 @@ public:
   /// Context aware single execution of a function with the given \p
   /// name.
   void run(PlaceholderBindings &bindings, llvm::StringRef name);
+
+  /// Starts a run of the function \p name, or of the only compiled function
+  /// if \p name is empty, with \p context without waiting for it. \p callback
+  /// is called with the Error and the context of the run once it is done.
+  void runAsync(std::unique_ptr<ExecutionContext> context,
+                llvm::StringRef name, runtime::ResultCBTy callback);
 };
 
 //===----------------------------------------------------------------------===//
@@ -164,6 +179,22 @@ void runBatch(ExecutionEngine &EE, PlaceholderBindings &bindings,
               llvm::ArrayRef<Placeholder *> ph, llvm::ArrayRef<Tensor *> inputs,
               llvm::StringRef name = "");
 
+/// Like runBatch(), runs \p iterations iterations of the compiled function on
+/// the slices of \p inputs for \p ph, but keeps up to \p runsPerDevice runs
+/// in flight on every device of \p EE, so that the batches are spread over
+/// all the devices. Every run has a context of its own, a copy of
+/// \p bindings, so the function must not depend on the Placeholders updated
+/// by the earlier runs, as training does. The batches of the outputs
+/// \p outputs of every run are concatenated in the order of the iterations
+/// into \p results, which are reset to hold iterations batches each.
+void runBatchParallel(ExecutionEngine &EE, PlaceholderBindings &bindings,
+                      size_t iterations, size_t &sampleCounter,
+                      llvm::ArrayRef<Placeholder *> ph,
+                      llvm::ArrayRef<Tensor *> inputs,
+                      llvm::ArrayRef<Placeholder *> outputs,
+                      llvm::ArrayRef<Tensor *> results,
+                      unsigned runsPerDevice = 2, llvm::StringRef name = "");
+
 } // namespace glow
 
 #endif // GLOW_EXECUTIONENGINE_EXECUTIONENGINE_H
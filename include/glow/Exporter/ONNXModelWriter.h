@@ -25,6 +25,7 @@
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/StringRef.h"
 
+#include <fstream>
 #include <string>
 
 /// ONNX traits for protobuf types.
@@ -50,6 +51,15 @@ class ONNXModelWriter : public CommonOperatorWriter<ONNX_TRAITS> {
   size_t opsetVersion_;
   /// Keeps the track of already visited or processed nodes.
   ReportedNodes reportedNodes_;
+  /// The location, relative to the model, of the file which the payloads of
+  /// the Constants are written to when they are external.
+  std::string externalDataLocation_;
+  /// The file of the external payloads, and its size so far.
+  std::ofstream externalDataFile_;
+  uint64_t externalDataSize_{0};
+  /// Writes the payload of \p C to the external data file, and the tensor
+  /// referring to it into \p out.
+  Error writeExternalTensor(const Constant *C, TensorType *out);
   /// Writes tensor shape from placeholder \p PH into protpbuf \p valueProto.
   static void tensorShapeFromPlaceholder(const Placeholder *PH,
                                          ValueInfoType *valueProto);
@@ -73,10 +83,15 @@ public:
   /// Creates an ONNX model writer to serialize \p F graph into file
   /// \p modelFilename, writing \p irVersion and \p opsetVersion.
   /// If \p errPtr is not null then if an error occurs it will get assigned
-  /// there otherwise if an error occurs it will abort.
+  /// there otherwise if an error occurs it will abort. If \p externalData
+  /// then the payloads of the Constants, but the smallest ones, are streamed
+  /// to the ONNX external data file \p modelFilename + ".data" as the graph
+  /// is written, instead of being held in the model until it is serialized,
+  /// which keeps the model small and below the 2GB limit of protobufs.
   ONNXModelWriter(const std::string &modelFilename, Function &F,
                   size_t irVersion, size_t opsetVersion,
-                  Error *errPtr = nullptr, bool textMode = false);
+                  Error *errPtr = nullptr, bool textMode = false,
+                  bool externalData = false);
 
 private:
   /// \returns error for the unexpected node kind.
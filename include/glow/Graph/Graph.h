@@ -26,15 +26,18 @@
 #include "llvm/ADT/StringSet.h"
 #include "llvm/ADT/ilist.h"
 #include "llvm/ADT/ilist_node.h"
+#include "llvm/Support/Allocator.h"
 
 #include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 namespace glow {
 class PlaceholderBindings;
 
-/// List of Types.
-using TypesList = std::list<Type>;
 /// Intrusive list of Nodes.
 using NodesList = llvm::iplist<glow::Node>;
 /// List of pointers to Nodes. The nodes are not owned by the list.
@@ -59,9 +62,22 @@ enum class FunctionState {
 class Module final {
   /// Stores the functions in the module.
   FunctionList functions_;
-  /// A uniqued list of types. Types in this list can be equated by comparing
-  /// their addresses.
-  TypesList types_{};
+  /// The arena of the uniqued types. Types are never freed before the module,
+  /// so they are bump allocated and freed all at once with the module. Types
+  /// in the arena can be equated by comparing their addresses.
+  llvm::SpecificBumpPtrAllocator<Type> types_;
+  /// Hashes types with Type::equals_hash, consistently with Type::isEqual.
+  struct TypeHash {
+    size_t operator()(const Type *T) const;
+  };
+  /// Compares types with Type::isEqual.
+  struct TypeEqual {
+    bool operator()(const Type *LHS, const Type *RHS) const {
+      return LHS->isEqual(*RHS);
+    }
+  };
+  /// The types of types_, so that uniqueType() finds them by hash.
+  std::unordered_set<const Type *, TypeHash, TypeEqual> typeIndex_;
   /// Stores a list of unique Storage names that were used by the module at
   /// some point.
   llvm::StringSet<> usedStorageNames_{};
@@ -78,6 +94,10 @@ class Module final {
   /// Module log context that stores all logs related to this module.
   LogContext moduleLogCtx_{nullptr};
 
+  /// Storage that the unowned payloads of Constants point into, such as
+  /// memory mapped weights, kept alive as long as the Module.
+  std::vector<std::shared_ptr<void>> externalStorage_;
+
   /// Inserts the constant \p V to the list of constants.
   Constant *addConstant(Constant *V);
 
@@ -100,6 +120,12 @@ public:
                                     const llvm::StringSet<> &stringTable,
                                     llvm::StringSet<> &updateTable);
 
+  /// Keeps \p storage alive as long as the Module, for Constants whose
+  /// unowned payloads point into it.
+  void addExternalStorage(std::shared_ptr<void> storage) {
+    externalStorage_.push_back(std::move(storage));
+  }
+
   /// Registers a name as used by some Node in this module.
   void registerNodeName(llvm::StringRef name) {
     // Don't care if it's already in the set.
@@ -271,6 +297,14 @@ class Function final : public Named {
   /// The state of this function.
   FunctionState state_;
 
+  /// The signatures of the nodes that passed their own checks in verify().
+  /// The checks of a node only depend on what its signature hashes, so they
+  /// are skipped while the signature is unchanged.
+  mutable std::unordered_map<const Node *, size_t> verifiedNodes_;
+
+  /// Protects verifiedNodes_.
+  mutable std::mutex verifiedNodesLock_;
+
 public:
   Function(Module *parent, llvm::StringRef Name = {})
       : Named(Name), parent_(parent), state_(FunctionState::FuncCreated) {
@@ -424,20 +458,18 @@ public:
   /// Creates a ChannelwiseQuantizedConvolutionNode with the given \p name which
   /// convolves the 4D \p input with \p filter and \bias. \p scales and \p
   /// offsets provide individual quantization parameters for each filter group
-  /// in \p filter. \p kernels defines the size of the height and width
-  /// dimensions of the filters. \p strides defines the number of steps to take
-  /// in the input for each output cell. \p pads defines how many zero padding
-  /// cells should be added to the input during convolution. \p group defines
-  /// the number of groups the input and output channels should be divided into
-  /// and convolved separately.
-  /// NOTE: ChannelwiseQuantizedConvolutionNode does
-  /// not yet have an implementation so attempting to run a graph containing
-  /// this node fails.
+  /// in \p filter if \p groupwise, or for each output channel otherwise.
+  /// \p kernels defines the size of the height and width dimensions of the
+  /// filters. \p strides defines the number of steps to take in the input for
+  /// each output cell. \p pads defines how many zero padding cells should be
+  /// added to the input during convolution. \p group defines the number of
+  /// groups the input and output channels should be divided into and convolved
+  /// separately.
   ChannelwiseQuantizedConvolutionNode *createChannelwiseQuantizedConv(
       llvm::StringRef name, NodeValue input, Constant *filter, Constant *bias,
       Constant *scales, Constant *offsets, TypeRef outTy,
       llvm::ArrayRef<unsigned_t> kernels, llvm::ArrayRef<unsigned_t> strides,
-      llvm::ArrayRef<unsigned_t> pads, unsigned_t group);
+      llvm::ArrayRef<unsigned_t> pads, unsigned_t group, bool groupwise = true);
 
   /// Creates and \returns a ConvertTo Node with name \p name of \p input to
   /// output type \p outTy.
@@ -507,6 +539,15 @@ public:
       llvm::StringRef name, NodeValue input, Constant *W, NodeValue B,
       TypeRef outTy, quantization::Schema schema, bool transposeWeight = false);
 
+  /// Create a dynamically quantized fully connected node. Args \p input and
+  /// \p B and the result are float, and \p W is the constant float weights of
+  /// a FullyConnected. \p W is transposed and quantized symmetrically to
+  /// Int8QTy during node creation time, while \p input is quantized with the
+  /// params of its range every time the node is run.
+  DynamicQuantizedFullyConnectedNode *
+  createDynamicQuantizedFullyConnected(llvm::StringRef name, NodeValue input,
+                                       Constant *W, NodeValue B);
+
   /// Implement an operation that computes the row-wise dot product of its
   /// inputs. Consequently, \p X and \p Y must be either 1D or 2D tensors. This
   /// lowered to a Mul node, and is followed by a BatchedReduceAdd if \p X and
@@ -689,6 +730,16 @@ public:
                            NodeValue var, unsigned_t channelIdx = 0,
                            float epsilon = 1e-5, float momentum = 0.9);
 
+  /// Creates a LayerNormalizationNode which normalizes the trailing dimensions
+  /// of \p input equal to the dimensions of \p scale and \p bias to a zero
+  /// mean and a unit variance, plus \p epsilon, and then scales them by
+  /// \p scale and shifts them by \p bias.
+  LayerNormalizationNode *createLayerNormalization(llvm::StringRef name,
+                                                   NodeValue input,
+                                                   NodeValue scale,
+                                                   NodeValue bias,
+                                                   float epsilon = 1e-5);
+
   /// Bucketizes the input tensor based on monotonically increasing \p
   /// boundaries for each value in \p input. For each value x in input, the
   /// operator \returns index i given boundaries[i-1] < x <= boundaries[i]. If
@@ -812,6 +863,15 @@ public:
   BatchMatMulNode *createBatchMatMul(llvm::StringRef name, NodeValue lhs,
                                      NodeValue rhs);
 
+  /// Creates a BatchedPairwiseDotProductNode which computes, for every batch,
+  /// the dot products of every pair of distinct \p inputs, all of the shape
+  /// {B, D}. The product of inputs i and j, j < i, is at index
+  /// i * (i - 1) / 2 + j of the result, which has the shape
+  /// {B, N * (N - 1) / 2}.
+  BatchedPairwiseDotProductNode *
+  createBatchedPairwiseDotProduct(llvm::StringRef name,
+                                  llvm::ArrayRef<NodeValue> inputs);
+
   /// Create a node, performing BatchedReduceAdd operation. Output type is
   /// based on the input \p batch type with dimensions specified with \p axes
   /// removed.
@@ -885,6 +945,20 @@ public:
                                  NodeValue data, NodeValue weights,
                                  NodeValue indices, NodeValue lengths);
 
+  /// Same as SparseLengthsSum, but the slices of every segment are averaged.
+  /// Empty segments are zero.
+  SparseLengthsMeanNode *createSparseLengthsMean(llvm::StringRef name,
+                                                 NodeValue data,
+                                                 NodeValue indices,
+                                                 NodeValue lengths);
+
+  /// Same as SparseLengthsSum, but every segment holds the elementwise
+  /// maximum of its slices. Empty segments are zero.
+  SparseLengthsMaxNode *createSparseLengthsMax(llvm::StringRef name,
+                                               NodeValue data,
+                                               NodeValue indices,
+                                               NodeValue lengths);
+
   /// Creates and \returns a node of \p name, performing the SparseLengthsSum
   /// operation, using rowwise quantization for the input \p data with the \p
   /// scales and \p offsets as separate input tensors. Gathers slices of the
@@ -951,6 +1025,37 @@ public:
       llvm::StringRef name, Tensor &data, NodeValue indices, NodeValue lengths,
       ElemKind precision = ElemKind::FloatTy, bool useFP16Accumulation = false);
 
+  /// Same as \ref createFusedRowwiseQuantizedSparseLengthsSum(), but the
+  /// slices of every segment are averaged. Empty segments are zero.
+  FusedRowwiseQuantizedSparseLengthsMeanNode *
+  createFusedRowwiseQuantizedSparseLengthsMean(
+      llvm::StringRef name, Constant *data, NodeValue indices,
+      NodeValue lengths, ElemKind precision = ElemKind::FloatTy,
+      bool useFP16Accumulation = false);
+
+  /// Same as \ref createFusedRowwiseQuantizedSparseLengthsMean(), but expects
+  /// float input \p data, which is rowwise-quantized and fused internally.
+  FusedRowwiseQuantizedSparseLengthsMeanNode *
+  createFusedRowwiseQuantizedSparseLengthsMean(
+      llvm::StringRef name, Tensor &data, NodeValue indices, NodeValue lengths,
+      ElemKind precision = ElemKind::FloatTy, bool useFP16Accumulation = false);
+
+  /// Same as \ref createFusedRowwiseQuantizedSparseLengthsSum(), but every
+  /// segment holds the elementwise maximum of its dequantized slices. Empty
+  /// segments are zero.
+  FusedRowwiseQuantizedSparseLengthsMaxNode *
+  createFusedRowwiseQuantizedSparseLengthsMax(
+      llvm::StringRef name, Constant *data, NodeValue indices,
+      NodeValue lengths, ElemKind precision = ElemKind::FloatTy,
+      bool useFP16Accumulation = false);
+
+  /// Same as \ref createFusedRowwiseQuantizedSparseLengthsMax(), but expects
+  /// float input \p data, which is rowwise-quantized and fused internally.
+  FusedRowwiseQuantizedSparseLengthsMaxNode *
+  createFusedRowwiseQuantizedSparseLengthsMax(
+      llvm::StringRef name, Tensor &data, NodeValue indices, NodeValue lengths,
+      ElemKind precision = ElemKind::FloatTy, bool useFP16Accumulation = false);
+
   /// Same as \ref createFusedRowwiseQuantizedSparseLengthsSum(), but i-th slice
   /// is multiplied by weights[i]. len(weights) must be equal to len(indices).
   FusedRowwiseQuantizedSparseLengthsWeightedSumNode *
@@ -968,6 +1073,22 @@ public:
       NodeValue lengths, ElemKind precision = ElemKind::FloatTy,
       bool useFP16Accumulation = false);
 
+  /// Creates and \returns a node of \p name performing the
+  /// FusedRowwiseQuantizedSparseLengthsWeightedSum of several tables at once.
+  /// \p data, \p weights, \p indices and \p lengths are the concatenations
+  /// of the inputs of the tables. Table i owns the rows of \p data starting
+  /// at \p rowOffsets[i], the entries of \p weights and \p indices starting
+  /// at \p indexOffsets[i] and the entries of \p lengths starting at
+  /// \p segmentOffsets[i], and its indices are relative to its first row. The
+  /// result is the concatenation of the results of the tables.
+  GroupedFusedRowwiseQuantizedSparseLengthsWeightedSumNode *
+  createGroupedFusedRowwiseQuantizedSparseLengthsWeightedSum(
+      llvm::StringRef name, NodeValue data, NodeValue weights,
+      NodeValue indices, NodeValue lengths, llvm::ArrayRef<size_t> rowOffsets,
+      llvm::ArrayRef<size_t> indexOffsets,
+      llvm::ArrayRef<size_t> segmentOffsets,
+      ElemKind precision = ElemKind::FloatTy, bool useFP16Accumulation = false);
+
   /// Given a vector of segment lengths, calculates offsets of each segment and
   /// packs them next to the lengths. For the input vector of length N the
   /// output is a Nx2 matrix with (offset, lengths) packaged for each segment.
@@ -1039,6 +1160,13 @@ public:
 
   TopKNode *createTopK(llvm::StringRef name, NodeValue input, unsigned_t k);
 
+  /// Create a step of an LSTM, computing the hidden and cell states from the
+  /// pre-activations \p gates of shape [B, 4H], which holds the input, forget
+  /// and output gates and the candidate cell one after the other, and from
+  /// the previous cell state \p prevCell of shape [B, H].
+  LSTMUnitNode *createLSTMUnit(llvm::StringRef name, NodeValue gates,
+                               NodeValue prevCell);
+
   /// Gathers entries of the outer-most dimension of \p data indexed by
   /// \p indices, and concatenates them. A non-zero \p batchDims specifies the
   /// batch, and the result is the concatenation of the operation on each sample
@@ -1093,6 +1221,15 @@ public:
   ResizeNearestNode *createResizeNearest(llvm::StringRef name, NodeValue input,
                                          float heightScale, float widthScale);
 
+  /// Given \p input tensor of [N,H,W,C], where N is the batch, C is the channel
+  /// or depth, H is the height and W is the width, generates an Output tensor
+  /// with resized spatial dimensions using bilinear interpolation. The Output
+  /// tensor is of shape [N, floor(H * \p heightScale), floor(W * \p
+  /// widthScale), C]
+  ResizeBilinearNode *createResizeBilinear(llvm::StringRef name,
+                                           NodeValue input, float heightScale,
+                                           float widthScale);
+
   /// Create quantization node which transforms floating point tensor to a
   /// quantized one with given Scale and Offset. Scale and Offset params are
   /// part of the \p outTy.
@@ -1292,7 +1429,9 @@ public:
   Function *clone(llvm::StringRef newName,
                   llvm::DenseMap<Node *, Node *> *map = nullptr);
 
-  /// Verify the correctness of the Function.
+  /// Verify the correctness of the Function. The checks of every node are
+  /// only repeated for the nodes that changed since they last passed, the
+  /// checks of the graph as a whole take linear time.
   /// \returns true when the function is valid. False otherwise.
   bool verify() const;
 
@@ -1348,6 +1487,12 @@ Function *differentiate(Function *F, const TrainingConfig &config,
 /// nullptr if none are found.
 SaveNode *getOutputSave(Function *F, Placeholder *PH);
 
+/// \returns true if the nodes of \p F only read the prefix of \p PH that
+/// they use, e.g. the indices of sparse lookups, whose lengths bound the
+/// indices read, so that \p PH may be bound to a partial tensor or be
+/// ragged.
+bool allowsPartialInput(const Placeholder *PH, const Function *F);
+
 /// Clone \p node and its sources into \p newF using old-to-new mapping \p
 /// currToNew.
 Node *recursiveClone(Function *newF, Node *node, NodeMap &currToNew);
@@ -26,6 +26,7 @@
 #include "glow/Base/Type.h"
 #include "glow/Graph/NodeValue.h"
 #include "glow/Graph/UseDef.h"
+#include "glow/Support/ObjectPool.h"
 #include "glow/Support/Support.h"
 
 #include <list>
@@ -41,11 +42,12 @@ template <bool is_const_iter> class NodeValueIteratorImpl;
 using NodeValueIterator = NodeValueIteratorImpl<false>;
 using NodeValueConstIterator = NodeValueIteratorImpl<true>;
 
-/// Represents a node in the compute graph.
+/// Represents a node in the compute graph. Nodes are allocated by ObjectPool.
 class Node : public Named,
              public Kinded,
              public UseDef<Node, NodeUse>,
-             public llvm::ilist_node<Node> {
+             public llvm::ilist_node<Node>,
+             public PoolAllocated {
   friend llvm::ilist_traits<Node>;
 
 protected:
@@ -139,6 +141,14 @@ public:
   /// \returns True if the node is valid. False otherwise.
   bool verify() const;
 
+  /// Verify node like verify(), without checking that its parent contains it.
+  /// \returns True if the node is valid. False otherwise.
+  bool verifyLocal() const;
+
+  /// \returns a hash of everything verifyLocal() checks: the kind, the
+  /// members, the inputs and their types, the predicate and the result types.
+  llvm::hash_code getVerifySignature() const;
+
   /// Replace all uses of this node with null. This method is used by the
   /// destruction sequence. When the node is deleted we need to unregister all
   /// users. This allows us to deconstruct the graph in an arbitrary order.
@@ -18,6 +18,8 @@
 
 #include "glow/Base/Type.h"
 
+#include <list>
+
 namespace glow {
 
 class Function;
@@ -131,6 +133,9 @@ private:
   friend NodeUse;
   ///  Parent object which contains this handle.
   Node *parent_{nullptr};
+  /// The use of this handle in the list of users of the referenced node,
+  /// valid while the handle references a node.
+  std::list<NodeUse>::iterator use_;
 
 public:
   /// Create a new value and register the node we reference
@@ -28,6 +28,9 @@
 
 namespace glow {
 
+class ModuleReader;
+class ModuleWriter;
+
 // Storage is the base class for Constants, which are bound to tensors, and
 // Placeholder nodes which are unbound.
 class Storage : public Node {
@@ -52,6 +55,8 @@ public:
   llvm::StringRef getOutputName(unsigned idx) const;
   bool hasSideEffects() const;
   Node *clone() const;
+  void serialize(ModuleWriter &writer) const;
+  static Node *deserialize(llvm::StringRef name, ModuleReader &reader);
   /// @}
 
   /// \returns result type of the storage.
@@ -140,6 +145,9 @@ class Placeholder : public Storage {
   /// Specifies if associated Tensors should be zeroed when allocated.
   bool allocZero_{false};
 
+  /// Specifies if the placeholder is ragged.
+  bool ragged_{false};
+
 public:
   /// Create a new placeholder.
   Placeholder(llvm::StringRef name, TypeRef Ty, bool isTrainable)
@@ -158,6 +166,18 @@ public:
   /// Sets whether or not associated Tensors should be zeroed.
   void setAllocZero(bool on = true) { allocZero_ = on; }
 
+  /// \returns True if the placeholder is ragged: its type is the capacity of
+  /// the placeholder, of which a run only uses a valid prefix, e.g. the
+  /// indices of a sparse lookup, whose lengths bound the indices read. The
+  /// elements past the prefix are undefined, so the backends only transfer
+  /// the prefix, and don't pad the rest. The size of the prefix is the
+  /// unpadded size of the bound tensor, see
+  /// PlaceholderBindings::setNumValidElements.
+  bool isRagged() const { return ragged_; }
+
+  /// Sets whether or not the placeholder is ragged.
+  void setRagged(bool on = true) { ragged_ = on; }
+
   static bool classof(const Kinded *k) {
     return k->getKind() == Kinded::Kind::PlaceholderKind;
   }
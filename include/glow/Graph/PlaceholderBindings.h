@@ -82,6 +82,11 @@ public:
   /// type of P.
   Tensor *allocate(Placeholder *P);
 
+  /// Sets the valid prefix of the tensor backing the ragged placeholder \p P
+  /// to its first \p numElements elements, so that a run only transfers
+  /// them. A tensor with no valid element is transferred whole.
+  void setNumValidElements(Placeholder *P, size_t numElements);
+
   /// Allocates zero-initialized backing tensors to all placeholders in \p lst
   /// that are not currently allocated in the bindings.
   /// \returns the number of tensors that were allocated.
@@ -0,0 +1,220 @@
+/**
+ * Copyright (c) Glow Contributors. See CONTRIBUTORS file.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef GLOW_GRAPH_SERIALIZATION_H
+#define GLOW_GRAPH_SERIALIZATION_H
+
+#include "glow/Graph/Nodes.h"
+#include "glow/Support/Error.h"
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/StringRef.h"
+
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+namespace glow {
+
+class Module;
+
+/// Saves \p M, usually already optimized, to the file \p path in the native
+/// binary format of Glow. The file holds the types, the Placeholders, the
+/// Constants and the nodes of all the Functions of \p M, and loadModule()
+/// rebuilds them as they are, without importing or optimizing anything. The
+/// format is specific to the version of Glow and to the host, e.g. it is in
+/// the byte order of the host, so the files are build artifacts, not a model
+/// interchange format (see ONNXModelWriter).
+Error saveModule(const Module &M, llvm::StringRef path);
+
+/// Loads into \p M, which must be empty, the Module saved to the file \p path
+/// by saveModule(). The file is memory mapped, and the payloads of the
+/// Constants point into the mapping instead of being copied. The records are
+/// checked to be well formed and the Functions are verified, but like a
+/// bundle the file is trusted to come from saveModule().
+Error loadModule(Module &M, llvm::StringRef path);
+
+/// Writes the records of a Module for saveModule(). The nodes write the
+/// arguments of their constructors in order in their serialize() methods.
+class ModuleWriter {
+  /// Hashes types consistently with Type::isEqual.
+  struct TypeHash {
+    size_t operator()(const Type *T) const {
+      return llvm::hash_combine(T->getElementType(), T->dims());
+    }
+  };
+  /// Compares types with Type::isEqual.
+  struct TypeEqual {
+    bool operator()(const Type *LHS, const Type *RHS) const {
+      return LHS->isEqual(*RHS);
+    }
+  };
+
+  /// The records of the types, which come first in the file.
+  std::string types_;
+  /// The records of the Module, using the types of types_.
+  std::string body_;
+  /// The index of every type in types_.
+  std::unordered_map<const Type *, uint32_t, TypeHash, TypeEqual> typeIDs_;
+  /// The nodes which were written and may be used by the next nodes, and
+  /// their indices.
+  std::vector<const Node *> nodes_;
+  llvm::DenseMap<const Node *, uint32_t> nodeIDs_;
+  /// Whether all the nodes which were referred to had been added.
+  bool ok_{true};
+
+  void writeBytes(const void *data, size_t size) {
+    body_.append(static_cast<const char *>(data), size);
+  }
+
+public:
+  /// The index of a NodeValue without a node.
+  static constexpr uint32_t kNullID = ~0u;
+
+  template <typename T>
+  typename std::enable_if<std::is_arithmetic<T>::value ||
+                          std::is_enum<T>::value>::type
+  write(T value) {
+    writeBytes(&value, sizeof(T));
+  }
+
+  void write(llvm::StringRef str) {
+    write<uint32_t>(str.size());
+    writeBytes(str.data(), str.size());
+  }
+
+  template <typename T> void write(llvm::ArrayRef<T> values) {
+    static_assert(std::is_arithmetic<T>::value, "Can only write scalars");
+    write<uint64_t>(values.size());
+    writeBytes(values.data(), values.size() * sizeof(T));
+  }
+
+  void write(NodeValueArrayRef values);
+
+  /// Writes a reference to the node of \p value, which must have been added.
+  /// Writes kNullID if \p value has no node.
+  void write(NodeValue value);
+
+  void write(TypeRef T);
+
+  /// Numbers \p N, so that the next records may refer to it.
+  void addNode(const Node *N);
+
+  /// Forgets the nodes added since the last \p numNodes nodes were added.
+  /// The nodes of a Function are only used in the Function.
+  void resetNodes(size_t numNodes);
+
+  /// \returns the number of nodes which were added.
+  size_t getNumNodes() const { return nodes_.size(); }
+
+  /// \returns false if a NodeValue of a node which was not added was
+  /// written.
+  bool ok() const { return ok_; }
+
+  /// \returns the number of types which were written.
+  size_t getNumTypes() const { return typeIDs_.size(); }
+
+  /// \returns the records of the types.
+  const std::string &getTypes() const { return types_; }
+
+  /// \returns the records written with this writer.
+  const std::string &getBody() const { return body_; }
+};
+
+/// Reads the records written with a ModuleWriter for loadModule(). The reader
+/// checks all that it reads. Once a read fails, ok() returns false and all
+/// the later reads return zero values.
+class ModuleReader {
+  /// The Module which the types are uniqued in.
+  Module &M_;
+  /// The records that are left to read.
+  const char *cur_;
+  const char *end_;
+  bool ok_{true};
+  /// The types in the order of the type records.
+  std::vector<TypeRef> types_;
+  /// The nodes in the order they were added.
+  std::vector<Node *> nodes_;
+
+  /// Reads \p size bytes into \p data. \returns false, filling \p data with
+  /// zeros, if there are not enough bytes left or a read already failed.
+  bool readBytes(void *data, size_t size) {
+    if (!ok_ || size_t(end_ - cur_) < size) {
+      ok_ = false;
+      memset(data, 0, size);
+      return false;
+    }
+    memcpy(data, cur_, size);
+    cur_ += size;
+    return true;
+  }
+
+  /// Reads the number of elements of size \p elemSize of a vector.
+  /// \returns 0 if there are fewer bytes left than the elements need.
+  size_t readCount(size_t elemSize);
+
+public:
+  /// Creates a reader of the records in [\p begin, \p end) of a Module that
+  /// is loaded into \p M.
+  ModuleReader(Module &M, const char *begin, const char *end)
+      : M_(M), cur_(begin), end_(end) {}
+
+  /// \returns false if a read failed.
+  bool ok() const { return ok_; }
+
+  /// Makes the next reads fail, when what was read is invalid.
+  void fail() { ok_ = false; }
+
+  template <typename T>
+  typename std::enable_if<std::is_arithmetic<T>::value ||
+                          std::is_enum<T>::value>::type
+  read(T &value) {
+    readBytes(&value, sizeof(T));
+  }
+
+  void read(std::string &str);
+
+  template <typename T> void read(std::vector<T> &values) {
+    static_assert(std::is_arithmetic<T>::value, "Can only read scalars");
+    values.resize(readCount(sizeof(T)));
+    readBytes(values.data(), values.size() * sizeof(T));
+  }
+
+  void read(std::vector<NodeValue> &values);
+
+  void read(NodeValue &value);
+
+  void read(TypeRef &T);
+
+  /// Reads the type records.
+  void readTypes();
+
+  /// Numbers \p N like ModuleWriter::addNode() did.
+  void addNode(Node *N) { nodes_.push_back(N); }
+
+  /// Forgets the nodes like ModuleWriter::resetNodes() did.
+  void resetNodes(size_t numNodes) { nodes_.resize(numNodes); }
+
+  /// \returns the number of bytes left to read.
+  size_t getNumBytesLeft() const { return end_ - cur_; }
+};
+
+} // namespace glow
+
+#endif // GLOW_GRAPH_SERIALIZATION_H
@@ -22,21 +22,36 @@ namespace glow {
 
 /// A UseDef is something that can be an operand for an instruction.
 template <typename UserTy, typename Use> class UseDef {
+public:
+  /// The type of the list of users.
+  using UseList = std::list<Use>;
+  /// A handle on a use in the list of users, which remains valid until the
+  /// use is removed. Operands keep the handle of their use, so that they are
+  /// removed from the list in constant time however many users the value has.
+  using UseHandle = typename UseList::iterator;
+
+private:
   /// A list of users. Notice that the same user may appear twice in the list.
-  /// This is typically a very short list.
-  std::list<Use> users_{};
+  /// This is typically a very short list, but constants and placeholders of
+  /// large graphs may have thousands of users.
+  UseList users_{};
 
 public:
   UseDef() = default;
 
-  /// Removes the use \p U from the uselist.
+  /// Removes the use \p U from the uselist. This is linear in the number of
+  /// users, prefer removing the handle of the use.
   void removeUse(Use U) {
     auto it = std::find(users_.begin(), users_.end(), U);
     assert(it != users_.end() && "User not in list");
     users_.erase(it);
   }
-  /// Adds the use \p U.
-  void addUse(Use U) { users_.push_back(U); }
+
+  /// Removes the use of handle \p H, returned by addUse(), from the uselist.
+  void removeUse(UseHandle H) { users_.erase(H); }
+
+  /// Adds the use \p U. \returns the handle of the use.
+  UseHandle addUse(Use U) { return users_.insert(users_.end(), U); }
 
   /// \returns True if the value has some users.
   bool hasUsers() const { return !users_.empty(); }
@@ -58,10 +73,10 @@ public:
   }
 
   /// \returns the list of users for this value.
-  std::list<Use> &getUsers() { return users_; }
+  UseList &getUsers() { return users_; }
 
   /// \returns the list of users for this value.
-  const std::list<Use> &getUsers() const { return users_; }
+  const UseList &getUsers() const { return users_; }
 };
 
 } // namespace glow
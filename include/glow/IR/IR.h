@@ -21,6 +21,7 @@
 #include "glow/Base/Type.h"
 #include "glow/Graph/Graph.h"
 #include "glow/Graph/UseDef.h"
+#include "glow/Support/ObjectPool.h"
 
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/MapVector.h"
@@ -81,10 +82,12 @@ struct Use {
   ConstInstructionOperand getOperand() const;
 };
 
+/// A value of the IR. Values are allocated by ObjectPool.
 class Value : public Named,
               public UseDef<Instruction, Use>,
               public Typed,
-              public Kinded {
+              public Kinded,
+              public PoolAllocated {
 public:
   Value(llvm::StringRef name, TypeRef T, Kinded::Kind k)
       : Named(name), Typed(T), Kinded(k) {}
@@ -128,6 +131,9 @@ private:
   /// A list of operands that the instruction has. This is typically a very
   /// short list.
   llvm::SmallVector<Operand, 6> ops_{};
+  /// The use of every operand in the list of users of its value, valid
+  /// while the operand is set.
+  llvm::SmallVector<UseHandle, 6> uses_{};
 
   // Define/disallow default ctor, copy ctor and assignment operator.
   Instruction(const Instruction &I) = delete;
@@ -267,9 +273,9 @@ private:
   /// A list of unique instruction names use by the function.
   llvm::StringSet<> stringTable_;
 
-  /// Perform scheduling on the graph.
+  /// Perform scheduling on the graph for the backend \p B.
   /// \returns computed schedule in the \p Schedule parameter.
-  void scheduleGraph(NodesPtrList &Schedule);
+  void scheduleGraph(NodesPtrList &Schedule, const Backend &B);
 
 public:
   /// Add an instruction to the instr stream.
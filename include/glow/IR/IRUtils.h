@@ -136,6 +136,21 @@ size_t getOriginOffset(Value *V);
 /// \returns peels off the layers of tensorviews from a value \p V.
 const Value *getOrigin(const Value *V);
 
+/// \returns true if the region \p regionDims at \p offsets of a tensor of
+/// \p tensorDims is strided, i.e. it is not contiguous, but is made of rows of
+/// \p rowLen contiguous elements starting every \p pitch elements of the
+/// tensor.
+bool getStridedRegionLayout(llvm::ArrayRef<size_t> offsets,
+                            llvm::ArrayRef<size_t> regionDims,
+                            llvm::ArrayRef<size_t> tensorDims, size_t &rowLen,
+                            size_t &pitch);
+
+/// \returns true if \p V is a strided tensor view, i.e. a TensorView whose
+/// region of its source is strided, see getStridedRegionLayout. The address of
+/// the view is the one of its first row. The source of a strided view must
+/// not be a strided view itself.
+bool getStridedViewLayout(const Value *V, size_t &rowLen, size_t &pitch);
+
 } // namespace glow
 
 #endif // GLOW_IR_IRUTILS_H
@@ -99,12 +99,14 @@ class Caffe2ModelLoader
   /// and \p weightsCount, and \p onnxTensorDescriptorV1 correspondent
   /// descriptors. Converts inputs into placeholder if requested \p
   /// loadInputsAsPlaceholders. Reports success/failure through optional
-  /// parameter \p errPtr.
+  /// parameter \p errPtr. The inputs named in \p inputShapes, if any, are
+  /// loaded with the given shape instead of the one of the model.
   Caffe2ModelLoader(const void *model, uint32_t modelSize,
                     uint32_t weightsCount,
                     const onnxTensorDescriptorV1 *weightDescriptors,
                     Function &F, bool loadInputsAsPlaceholders,
-                    Error *errPtr = nullptr);
+                    Error *errPtr = nullptr,
+                    const llvm::StringMap<ShapeVector> *inputShapes = nullptr);
 
   friend class ONNXIFIModelLoader;
 
@@ -122,12 +124,15 @@ public:
   /// The list \p types and \p names are used to initialized the inputs and
   /// outputs with specific names and types.
   /// If \p errPtr is not null then if an error occurs it will get assigned
-  /// there otherwise if an error occurs it will abort.
+  /// there otherwise if an error occurs it will abort. If \p outputNames is
+  /// not empty, only the operators and weights needed to compute the values
+  /// \p outputNames are loaded, and they are the only external outputs.
   Caffe2ModelLoader(const std::string &netDescFilename,
                     const std::string &netWeightFilename,
                     llvm::ArrayRef<const char *> names,
                     llvm::ArrayRef<TypeRef> types, Function &F,
-                    Error *errPtr = nullptr);
+                    Error *errPtr = nullptr,
+                    llvm::ArrayRef<std::string> outputNames = {});
 
   /// Creates a Caffe2 model loader to build \p F.
   /// If \p errPtr is not null then if an error occurs it will get assigned
@@ -51,11 +51,16 @@ public:
   /// Tensors. Loading inputs as Tensors is useful for when weights are not
   /// provided such as when the graph being loaded is actually a small patch of
   /// a larger graph because the graph inputs in this case may represent
-  /// internal values for the larger graph.
+  /// internal values for the larger graph. The inputs named in \p
+  /// inputShapes, if any, are loaded with the given shape instead of the one
+  /// of the model, which e.g. rebatches the model. The inputs only read as the
+  /// indices or weights of sparse lookups are ragged, so that a request only
+  /// transfers their valid prefix.
   static Expected<std::unique_ptr<ONNXIFIModelLoader>>
   parse(const void *onnxModel, uint32_t onnxModelSize, uint32_t weightsCount,
         const onnxTensorDescriptorV1 *weightDescriptors, Function &F,
-        bool loadInputsAsPlaceholders = true, bool use_onnx = true);
+        bool loadInputsAsPlaceholders = true, bool use_onnx = true,
+        const llvm::StringMap<ShapeVector> *inputShapes = nullptr);
 };
 
 } // namespace glow
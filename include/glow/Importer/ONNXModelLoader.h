@@ -103,6 +103,10 @@ class ONNXModelLoader
   Error loadBatchNormalization(const ONNX_NAMESPACE::NodeProto &op,
                                const ArgumentDictionaryTy &dict);
 
+  /// Load LayerNormalization ONNX operator.
+  Error loadLayerNormalization(const ONNX_NAMESPACE::NodeProto &op,
+                               const ArgumentDictionaryTy &dict);
+
   /// Load Concat ONNX operator.
   Error loadConcat(const ONNX_NAMESPACE::NodeProto &op,
                    const ArgumentDictionaryTy &dict);
@@ -235,16 +239,34 @@ protected:
   Error setOutputNodes(ONNX_NAMESPACE::GraphProto &net);
 
   /// Set ir verion and op version.
-  Error setVersion(ONNX_NAMESPACE::ModelProto MP);
+  Error setVersion(const ONNX_NAMESPACE::ModelProto &MP);
 
   /// \returns Expected<ModelProto> if a ModelProto can be loaded from the
   /// stream \p iStream.
   static Expected<ONNX_NAMESPACE::ModelProto>
   loadProto(google::protobuf::io::ZeroCopyInputStream &iStream);
 
-  /// Load the network initializers from the GraphProto.
+  /// Load the network initializers from the GraphProto. The initializers are
+  /// decoded in parallel, see ProtobufLoader::runInParallel.
   Error loadInitializers(ONNX_NAMESPACE::GraphProto &net);
 
+  /// Load the tensor \p T of the initializer \p in. If the raw data of \p in
+  /// has the layout of the payload of \p T, it is moved out of \p in, into
+  /// \p storage, and \p T is an unowned tensor pointing into it. Is called
+  /// concurrently for the initializers of a graph.
+  Error loadInitializerTensor(ONNX_NAMESPACE::TensorProto &in, Tensor &T,
+                              std::shared_ptr<void> &storage);
+
+  /// Removes from \p net the nodes, initializers and inputs that the values
+  /// \p outputNames don't depend on, and makes \p outputNames the outputs of
+  /// \p net.
+  static void pruneToOutputs(ONNX_NAMESPACE::GraphProto &net,
+                             llvm::ArrayRef<std::string> outputNames);
+
+  /// Load the tensor \p T of the initializer \p in, whose data is stored in
+  /// an external file, see loadExternalData.
+  Error loadExternalTensor(const ONNX_NAMESPACE::TensorProto &in, Tensor &T);
+
   /// Load the inputs from the GraphProto. If \p loadInputsAsPlaceholders is
   /// true then this will load each graph input as a placeholder otherwise it
   /// will create an empty tensor for each input.
@@ -276,10 +298,12 @@ protected:
   /// and \p weightsCount, and \p onnxTensorDescriptorV1 correspondent
   /// descriptors. Converts inputs into placeholder if requested \p
   /// loadInputsAsPlaceholders. Reports success/failure through optional
-  /// parameter \p errPtr.
+  /// parameter \p errPtr. The inputs named in \p inputShapes, if any, are
+  /// loaded with the given shape instead of the one of the model.
   ONNXModelLoader(const void *model, uint32_t modelSize, uint32_t weightsCount,
                   const onnxTensorDescriptorV1 *weightDescriptors, Function &F,
-                  bool loadInputsAsPlaceholders, Error *errPtr = nullptr);
+                  bool loadInputsAsPlaceholders, Error *errPtr = nullptr,
+                  const llvm::StringMap<ShapeVector> *inputShapes = nullptr);
 
   friend class ONNXIFIModelLoader;
 
@@ -308,11 +332,14 @@ public:
   /// inputs to the network.
   /// If \p names and \p types are empty loader fills inputs automatically.
   /// If \p errPtr is not null then if an error occurs it will get assigned
-  /// there otherwise if an error occurs it will abort.
+  /// there otherwise if an error occurs it will abort. If \p outputNames is
+  /// not empty, only the nodes, initializers and inputs needed to compute
+  /// the values \p outputNames are loaded, and they are the only outputs.
   ONNXModelLoader(const std::string &modelDescFilename,
                   llvm::ArrayRef<const char *> tensorNames,
                   llvm::ArrayRef<TypeRef> types, Function &F,
-                  Error *errPtr = nullptr);
+                  Error *errPtr = nullptr,
+                  llvm::ArrayRef<std::string> outputNames = {});
 };
 
 } // namespace glow
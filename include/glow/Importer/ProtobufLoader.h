@@ -26,11 +26,14 @@
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/FormatVariadic.h"
 #include "llvm/Support/raw_ostream.h"
 
 #include <google/protobuf/text_format.h>
 
+#include <functional>
 #include <memory>
 #include <string>
 #include <vector>
@@ -96,6 +99,50 @@ template <typename AttrType> std::vector<float> getFloats(const AttrType *arg) {
   return dim;
 }
 
+/// Removes from the operators \p ops, in topological order, the operators
+/// that the values \p outputNames don't depend on, keeping the order of the
+/// others. \returns the names of the values that the kept operators use or
+/// define, including \p outputNames, which tell the inputs and weights of \p
+/// ops that are needed.
+template <typename OpsTy>
+llvm::StringSet<> pruneOperators(OpsTy &ops,
+                                 llvm::ArrayRef<std::string> outputNames) {
+  llvm::StringSet<> usedNames;
+  for (const auto &name : outputNames) {
+    usedNames.insert(name);
+  }
+  // Walk the operators backward, so that the producers of the inputs of an
+  // operator are seen after it.
+  std::vector<bool> keep(ops.size(), false);
+  for (int i = ops.size() - 1; i >= 0; i--) {
+    const auto &op = ops.Get(i);
+    for (const auto &output : op.output()) {
+      if (usedNames.count(output)) {
+        keep[i] = true;
+        break;
+      }
+    }
+    if (!keep[i]) {
+      continue;
+    }
+    for (const auto &output : op.output()) {
+      usedNames.insert(output);
+    }
+    for (const auto &input : op.input()) {
+      usedNames.insert(input);
+    }
+  }
+
+  OpsTy kept;
+  for (int i = 0, e = ops.size(); i < e; i++) {
+    if (keep[i]) {
+      kept.Add()->Swap(ops.Mutable(i));
+    }
+  }
+  ops.Swap(&kept);
+  return usedNames;
+}
+
 /// Returns canonical name for a given operator: either \p name() from proto,
 /// or its type name.
 template <typename T> std::string loadOperatorName(const T &op) {
@@ -119,6 +166,31 @@ protected:
   llvm::StringMap<Placeholder *> outputVarsByName_;
   /// A map from names of the external inputs of the network to Variables.
   llvm::StringMap<Placeholder *> inputVarsByName_;
+  /// Shapes that replace the shapes of the inputs of the model with the same
+  /// name, see getInputType.
+  llvm::StringMap<ShapeVector> inputShapes_;
+  /// Directory that the relative locations of external weights are resolved
+  /// in, the directory of the model file.
+  std::string externalDataDir_;
+  /// The files of external weights mapped in memory, by path.
+  llvm::StringMap<std::shared_ptr<llvm::sys::fs::mapped_file_region>>
+      mappedFiles_;
+
+  /// Loads the weights of type \p ty at \p offset of the file of external
+  /// weights \p location into \p T. The file is mapped in memory and \p T is
+  /// an unowned tensor pointing at the mapping, which the Module keeps. The
+  /// weights are copied into \p T instead if they aren't aligned for their
+  /// element type, or if -mmap-external-weights is off.
+  Error loadExternalData(llvm::StringRef location, uint64_t offset,
+                         const Type &ty, Tensor &T);
+
+  /// Runs \p job for every index in [0, \p numJobs), on the loader threads
+  /// (see -loader-threads). The jobs run concurrently, so they must not
+  /// touch the graph or the loader, e.g. they decode tensors that the caller
+  /// creates Constants from afterwards, in a deterministic order. \returns
+  /// the error of the failed job with the lowest index.
+  static Error runInParallel(size_t numJobs,
+                             const std::function<Error(size_t)> &job);
 
   // Delete all Constants that have no users. This is useful because some
   // Constants may have been copied and modified during loading instead of used
@@ -136,6 +208,10 @@ protected:
   Expected<Placeholder *> createAndRegisterPlaceholder(llvm::StringRef name,
                                                        TypeRef T);
 
+  /// \returns the type of the input \p name of the model of type \p T, with
+  /// its shape replaced if inputShapes_ has one of the same rank for \p name.
+  TypeRef getInputType(llvm::StringRef name, TypeRef T);
+
   /// \returns the NodeValue that was registered with the name \p name or
   /// a nullptr wrapped in a NodeValue if no node has been registered with this
   /// name.
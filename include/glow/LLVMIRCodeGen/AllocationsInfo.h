@@ -61,8 +61,9 @@ struct AllocationsInfo {
   /// Assign offsets to all activations.
   /// No actual memory allocation is performed. All the allocations should be
   /// performed by the client based on the information provided by the
-  /// AllocationsInfo or RuntimeBundle.
-  void allocateActivations(const IRFunction *F);
+  /// AllocationsInfo or RuntimeBundle. The activations are planned offline
+  /// if \p planOffline, see planActivations.
+  void allocateActivations(const IRFunction *F, bool planOffline = false);
   /// Assign offsets to all tensorviews.
   /// No memory allocation is performed. Sets up all offsets into already
   /// defined offsets for WeightVars and AllocActivations. Assumes the weight
@@ -73,6 +73,16 @@ public:
 
   ModuleHandle addModule(std::unique_ptr<Module> M);
 
+  /// Split \p M into up to \p numThreads parts, generate the machine code of
+  /// every part on a thread of its own and add the objects, which resolve
+  /// the symbols of each other. \returns the handles of the objects, just
+  /// that of \p M if \p numThreads is below 2.
+  std::vector<ModuleHandle> addModule(std::unique_ptr<Module> M,
+                                      unsigned numThreads);
+
+  /// Add the already compiled object code \p obj, e.g. loaded from a cache.
+  ModuleHandle addObject(std::unique_ptr<MemoryBuffer> obj);
+
   void removeModule(ModuleHandle H);
 };
 
@@ -76,8 +76,10 @@ public:
   virtual std::unique_ptr<CompiledFunction>
   compileIR(std::unique_ptr<IRFunction> IR) const override;
 
+  /// Compile \p IR at the optimization level \p optLevel, see
+  /// LLVMIRGen::setOptLevel, without collecting its constants.
   virtual std::unique_ptr<CompiledFunction>
-  compileIRWithoutConstants(IRFunction *IR) const;
+  compileIRWithoutConstants(IRFunction *IR, unsigned optLevel = 2) const;
 
   virtual Expected<std::unique_ptr<CompiledFunction>>
   compile(Function *F, const BackendOptions &opts) const override;
@@ -85,6 +87,10 @@ public:
   virtual void save(Function *F, llvm::StringRef outputDir,
                     llvm::StringRef bundleName,
                     llvm::StringRef mainEntryName) const override;
+
+  virtual void saveFunctions(llvm::ArrayRef<BundleEntry> entries,
+                             llvm::StringRef outputDir,
+                             llvm::StringRef bundleName) const override;
   /// @}
 
   /// \returns the size of metrics collected for a single TraceEvent.
@@ -21,34 +21,163 @@
 #include "glow/Backend/BackendUtils.h"
 #include "glow/Backend/CompiledFunction.h"
 
+#include "llvm/ADT/StringMap.h"
+
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
 namespace glow {
+
+class ThreadPool;
+
 /// A Glow IR function compiled using LLVM.
 class LLVMCompiledFunction : public CompiledFunction {
 public:
   LLVMCompiledFunction(std::unique_ptr<llvm::orc::GlowJIT> JIT,
                        runtime::RuntimeBundle &&runtimeBundle);
 
+  /// Frees all the pooled execution buffers.
+  ~LLVMCompiledFunction() override;
+
   /// \name CompiledFunction interface
   ///@{
   virtual Error execute(ExecutionContext *context) override;
 
   virtual void collectConstants(const Module *module) override;
 
+  /// Erases the symbols of the activations and, once they are collected, of
+  /// the constants, as the runs only look up the placeholders.
+  virtual void freeCompilationResources() override;
+
+  /// Resolves the code of the function, which the JIT compiles on its first
+  /// lookup, and pre-faults the constants and a set of execution buffers.
+  virtual Error warmUp() override;
+
   /// Read trace events out of this func and write them into /p bindings
   virtual void translateTraceEvents(ExecutionContext *context) const override;
   ///@}
   //
 
+  /// A slot of the offsets array of the JITed code which refers to a
+  /// placeholder, either directly or through a tensor view.
+  struct PlaceholderOffset {
+    /// Index of the slot in the offsets array.
+    size_t index;
+    /// Offset in bytes of the referenced memory from the placeholder start.
+    size_t viewOffset;
+  };
+
+  /// Bind placeholders without copying them. \p offsets is the offsets array
+  /// computed at compile time and \p placeholderOffsets maps placeholder names
+  /// to the slots referring to them. Requires the module to provide the
+  /// "jitmain_bound" entry point, which takes the offsets array as an argument.
+  void enableZeroCopy(
+      std::vector<size_t> offsets,
+      llvm::StringMap<std::vector<PlaceholderOffset>> placeholderOffsets);
+
+  /// Let the runs of the function run its segments, the segment \p idx
+  /// depending on the segments \p segmentPreds[idx], concurrently on the pool
+  /// returned by getInterOpPool. Requires the module to provide the
+  /// "jitmain_segment" entry point, see LLVMIRGen::planInterOpSegments.
+  void setSegmentPreds(const std::vector<std::vector<unsigned>> &segmentPreds);
+
+  /// \returns the number of segments of the function, or 0 if it isn't
+  /// segmented.
+  size_t getNumSegments() const { return segmentSuccs_.size(); }
+
+  /// Sets the \p name the latency stats of the runs of the function are
+  /// exported under.
+  void setName(llvm::StringRef name) { name_ = name; }
+
+  /// \returns the optimization level the function was compiled at.
+  unsigned getOptLevel() const { return optLevel_; }
+
+  /// Sets the optimization level the function was compiled at to
+  /// \p optLevel.
+  void setOptLevel(unsigned optLevel) { optLevel_ = optLevel; }
+
+  /// Keeps \p IR, which the function was compiled from without full
+  /// optimizations, so that the device can recompile it in the background.
+  void setTierUpIR(std::unique_ptr<IRFunction> IR) {
+    tierUpIR_ = std::move(IR);
+  }
+
+  /// \returns the IR to recompile the function from with full optimizations,
+  /// or nullptr if the function doesn't need to be recompiled.
+  IRFunction *getTierUpIR() const { return tierUpIR_.get(); }
+
+  /// Sets whether the function is bound by the DRAM bandwidth, as hinted by
+  /// the Partitioner, see BackendHints::memoryBound.
+  void setMemoryBound(bool memoryBound) { memoryBound_ = memoryBound; }
+
+  /// \returns whether the function is bound by the DRAM bandwidth.
+  bool isMemoryBound() const { return memoryBound_; }
+
 protected:
+  /// The memory regions used by a single execution of the function.
+  struct ExecutionBuffers {
+    /// Base address of the activations memory block.
+    uint8_t *activations{nullptr};
+    /// Base address of the mutable weights memory block, inputs and outputs.
+    uint8_t *mutableWeights{nullptr};
+  };
+
+  /// \returns a set of execution buffers sized from the RuntimeBundle, reusing
+  /// a pooled one if available. New buffers are pre-faulted, so that the first
+  /// execution using them does not pay for page faults.
+  ExecutionBuffers acquireBuffers();
+
+  /// Return \p buffers to the pool for reuse by later executions.
+  void releaseBuffers(ExecutionBuffers buffers);
+
+  /// \returns the address of the symbol \p name of the JITed code, which is
+  /// looked up only if \p address is 0 and then cached in \p address.
+  Expected<llvm::JITTargetAddress> findAddress(llvm::StringRef name,
+                                               llvm::JITTargetAddress &address);
+
+  /// \returns the address of the entry point of the JITed code, which is
+  /// looked up on the first call only.
+  Expected<llvm::JITTargetAddress> getJitmainAddress();
+
+  /// \returns the address of the entry point running a single segment of the
+  /// JITed code, which is looked up on the first call only.
+  Expected<llvm::JITTargetAddress> getSegmentAddress();
+
+  /// \returns the pool the segments of the function run on besides the
+  /// calling thread, or nullptr to run them in sequence.
+  virtual ThreadPool *getInterOpPool() const { return nullptr; }
+
+  /// Run every segment of the entry point at \p address once the segments it
+  /// depends on are done, on the calling thread and on \p pool, and wait for
+  /// all of them. The arguments of the segments are \p mutableWeights,
+  /// \p activations and \p offsets, which is only passed to "jitmain_bound"
+  /// code.
+  void runSegments(ThreadPool &pool, llvm::JITTargetAddress address,
+                   uint8_t *mutableWeights, uint8_t *activations,
+                   size_t *offsets);
+
+  /// Point the slots of \p offsets which refer to placeholders in \p bindings
+  /// directly at the backing tensors, relative to \p weightsAddress. Tensors
+  /// which are not aligned to TensorAlignment, do not match the size of the
+  /// symbol or back several placeholders are left to be copied. The bound
+  /// placeholders are added to \p bound.
+  void bindPlaceholders(PlaceholderBindings *bindings, uint8_t *weightsAddress,
+                        std::vector<size_t> &offsets,
+                        std::unordered_set<const Placeholder *> &bound);
+
   /// Load constant tensors from \p bindings into \p weightsAddress, as defined
-  /// by the RuntimeBundle (pre-run).
-  virtual void loadPlaceholders(PlaceholderBindings *bindings,
-                                uint8_t *weightsAddress);
+  /// by the RuntimeBundle (pre-run). Placeholders in \p bound are skipped.
+  virtual void
+  loadPlaceholders(PlaceholderBindings *bindings, uint8_t *weightsAddress,
+                   const std::unordered_set<const Placeholder *> &bound = {});
 
   /// Load weights from \p weightsAddress into applicable backing tensors in
-  /// \p bindings, as defined by the RuntimeBundle (post-run).
-  virtual void updatePlaceholders(PlaceholderBindings *bindings,
-                                  uint8_t *weightsAddress);
+  /// \p bindings, as defined by the RuntimeBundle (post-run). Placeholders in
+  /// \p bound are skipped.
+  virtual void
+  updatePlaceholders(PlaceholderBindings *bindings, uint8_t *weightsAddress,
+                     const std::unordered_set<const Placeholder *> &bound = {});
 
   /// The LLVM JIT engine. The jit must be initialized after the ctor
   /// initializes the LLVM backends.
@@ -57,6 +186,50 @@ protected:
   /// The JIT can be accessed from multiple threads but is not thread safe,
   /// JITLock_ protects it.
   std::mutex JITLock_;
+
+  /// The address of the entry point, or 0 if it wasn't looked up yet.
+  /// Protected by JITLock_.
+  llvm::JITTargetAddress jitmainAddress_{0};
+
+  /// The address of the entry point running a single segment, or 0 if it
+  /// wasn't looked up yet. Protected by JITLock_.
+  llvm::JITTargetAddress segmentAddress_{0};
+
+  /// The segments each segment of the function is followed by, and the
+  /// number of segments each one depends on, see setSegmentPreds. Empty if
+  /// the function isn't segmented.
+  std::vector<std::vector<unsigned>> segmentSuccs_;
+  std::vector<unsigned> segmentNumPreds_;
+
+  /// Execution buffers which are not used by any execution in flight. There
+  /// are at most as many as there have been concurrent executions.
+  std::vector<ExecutionBuffers> freeBuffers_;
+
+  /// Protects freeBuffers_.
+  std::mutex buffersLock_;
+
+  /// Whether placeholders are bound without copying, see enableZeroCopy.
+  bool zeroCopy_{false};
+
+  /// The offsets array computed at compile time, used as the starting point
+  /// for the offsets passed to "jitmain_bound".
+  std::vector<size_t> offsets_;
+
+  /// Maps placeholder names to the slots of the offsets array referring to
+  /// them.
+  llvm::StringMap<std::vector<PlaceholderOffset>> placeholderOffsets_;
+
+  /// Name the latency stats of the runs of the function are exported under.
+  std::string name_;
+
+  /// Optimization level the function was compiled at.
+  unsigned optLevel_{2};
+
+  /// IR of a function compiled without full optimizations, see setTierUpIR.
+  std::unique_ptr<IRFunction> tierUpIR_;
+
+  /// Whether the function is bound by the DRAM bandwidth.
+  bool memoryBound_{false};
 };
 } // end namespace glow
 
@@ -27,6 +27,8 @@
 #include "llvm/IR/Module.h"
 #include "llvm/Target/TargetMachine.h"
 
+#include <vector>
+
 namespace glow {
 
 class PlaceholderBindings;
@@ -131,6 +133,11 @@ protected:
   DebugInfo dbgInfo_;
   /// Debug info builder.
   std::unique_ptr<llvm::DIBuilder> DIBuilder_;
+  /// Optimization level of the generated code, from 0 to 2.
+  unsigned optLevel_{2};
+  /// Whether the specialized libjit kernels are shared with the other modules
+  /// JITed by the process, see setShareSpecializations.
+  bool shareSpecializations_{false};
 
   /// A set that contains all of the argument that we request from the
   /// specializer not to specialize.
@@ -140,6 +147,21 @@ protected:
   /// the bitcode.
   llvm::StringRef libjitBC_;
 
+  /// The instructions emitting code of each segment of the function, see
+  /// planInterOpSegments, or none if the function isn't segmented.
+  std::vector<std::vector<const Instruction *>> segments_;
+  /// The indices of the segments each segment depends on.
+  std::vector<std::vector<unsigned>> segmentPreds_;
+  /// The functions the segments are emitted into, see getSegmentFunction.
+  std::vector<llvm::Function *> segmentFunctions_;
+
+  /// While the body of a loop over the repetitions of a sequence of
+  /// instructions is emitted, see emitRepeatedInstrs, the row of the table of
+  /// the value numbers of the operands of the current repetition, and the
+  /// index in the row of each operand of the first repetition.
+  llvm::Value *repeatValues_{nullptr};
+  llvm::DenseMap<const Value *, unsigned> repeatSlots_;
+
   /// Generates LLVM IR that computes the address of \p val using \p builder.
   /// The address type is specified by \p ptrTy.
   llvm::Value *emitValueAddress(llvm::IRBuilder<> &builder,
@@ -201,6 +223,36 @@ protected:
       llvm::IRBuilder<> &builder, const glow::Instruction *I,
       llvm::Function *kernel, llvm::DenseMap<Value *, int> &bufferToArgNum,
       llvm::Value *loopCount);
+  /// \returns true if the data parallel instruction \p I can be emitted by
+  /// generateVectorLLVMIRForDataParallelInstr. Derived classes emitting more
+  /// instructions as vectors should override both functions.
+  virtual bool canVectorizeDataParallelInstr(const glow::Instruction *I) const;
+  /// Emit IR for the data parallel instruction \p I which is invoked inside
+  /// the stacked \p kernel, computing the \p width elements starting at
+  /// \p index with LLVM vector types. The \p bufferToArgNum map can be used
+  /// to find the required buffers like in generateLLVMIRForDataParallelInstr.
+  virtual void generateVectorLLVMIRForDataParallelInstr(
+      llvm::IRBuilder<> &builder, const glow::Instruction *I,
+      llvm::Function *kernel, llvm::DenseMap<Value *, int> &bufferToArgNum,
+      llvm::Value *index, unsigned width);
+  /// \returns the number of elements computed at once by the vector loop of
+  /// the data-parallel \p kernel emitted for \p bundle, or 1 if the kernel
+  /// only has a scalar loop.
+  unsigned
+  getDataParallelVectorWidth(llvm::ArrayRef<const Instruction *> bundle,
+                             llvm::Function *kernel);
+  /// Emit a load of the \p width elements of the buffer \p val starting at
+  /// \p index inside the data-parallel \p kernel.
+  llvm::Value *emitVectorLoad(llvm::IRBuilder<> &builder, Value *val,
+                              llvm::Function *kernel,
+                              llvm::DenseMap<Value *, int> &bufferToArgNum,
+                              llvm::Value *index, unsigned width);
+  /// Emit a store of the vector \p vec to the elements of the buffer \p val
+  /// starting at \p index inside the data-parallel \p kernel.
+  void emitVectorStore(llvm::IRBuilder<> &builder, llvm::Value *vec,
+                       Value *val, llvm::Function *kernel,
+                       llvm::DenseMap<Value *, int> &bufferToArgNum,
+                       llvm::Value *index);
   /// \returns the llvm type of the glow vale \p val.
   llvm::Type *getElementType(llvm::IRBuilder<> &builder, const Value *val);
   /// Create a debug information for a given LLVM type \p ty.
@@ -235,6 +287,17 @@ protected:
   std::pair<llvm::BasicBlock *, llvm::BasicBlock *>
   createLoop(llvm::IRBuilder<> &builder, llvm::LLVMContext &ctx,
              llvm::Value *numElements) const;
+  /// Create LLVM IR for a for loop whose index goes from \p begin up to \p
+  /// end, excluded, by steps of \p step. Unlike the loop above, the body is
+  /// skipped when \p begin is not below \p end. The LLVM vectorizer is asked
+  /// to vectorize the loop if \p vectorize is true, and to leave it alone
+  /// otherwise.
+  /// \returns a pair of basic blocks. The first BB is the BB of the loop body,
+  /// the second BB is the loop exit BB.
+  std::pair<llvm::BasicBlock *, llvm::BasicBlock *>
+  createLoop(llvm::IRBuilder<> &builder, llvm::LLVMContext &ctx,
+             llvm::Value *begin, llvm::Value *end, size_t step,
+             bool vectorize) const;
 
 public:
   /// Destructor
@@ -263,8 +326,51 @@ public:
   /// \param I IR instruction which should be compiled into LLVM IR.
   virtual void generateLLVMIRForInstr(llvm::IRBuilder<> &builder,
                                       const glow::Instruction *I);
-  /// Emit LLVM-IR for the whole IRFunction.
+  /// Emit LLVM-IR for the whole IRFunction. The segments of a segmented
+  /// function are emitted into their own functions, which are called in
+  /// order.
   virtual void generateLLVMIRForModule(llvm::IRBuilder<> &builder);
+  /// Emit LLVM-IR for the instructions \p instrs in order, grouping the
+  /// data-parallel ones into kernels.
+  virtual void
+  generateLLVMIRForInstrs(llvm::IRBuilder<> &builder,
+                          llvm::ArrayRef<const Instruction *> instrs);
+  /// Emit LLVM-IR for the instructions \p instrs in order as
+  /// generateLLVMIRForInstrs does, except for the sequences of at least
+  /// -llvm-roll-repeated-instrs instructions repeated on different buffers,
+  /// e.g. the identical layers of a network, which are emitted once in a loop
+  /// over their repetitions.
+  void generateLLVMIRForRepeatedInstrs(
+      llvm::IRBuilder<> &builder, llvm::ArrayRef<const Instruction *> instrs);
+  /// Emit a loop running the instructions \p body once per row of \p values,
+  /// which holds the operands of each repetition of \p body in the order
+  /// they are first used, those of \p body first.
+  void emitRepeatedInstrs(
+      llvm::IRBuilder<> &builder, llvm::ArrayRef<const Instruction *> body,
+      llvm::ArrayRef<std::vector<const Value *>> values);
+  /// \returns whether the code emitted for the instruction \p I only depends
+  /// on its kind, its attributes and the types, the kinds of memory and the
+  /// overlaps of its operands, so that its repetitions on other buffers may
+  /// be emitted in a loop. Backends whose instructions depend on more, e.g.
+  /// on the payload of constants, should exclude them.
+  virtual bool canRollInstr(const glow::Instruction *I) const;
+  /// Split the function into segments of instructions which depend on each
+  /// other, so that the segments which don't depend on each other can run
+  /// concurrently. An instruction depends on the earlier ones accessing the
+  /// memory it accesses, one of them writing it, so that the buffers shared
+  /// or reused by the IR optimizer order their accesses. The function isn't
+  /// segmented if its segments would all run in sequence. Must be called
+  /// after the allocation of the memory and before performCodeGen.
+  void planInterOpSegments();
+  /// \returns the indices of the segments each segment of the function
+  /// depends on, which are before it, or no segments if the function isn't
+  /// segmented.
+  const std::vector<std::vector<unsigned>> &getSegmentPreds() const {
+    return segmentPreds_;
+  }
+  /// \returns the function the segment \p idx is emitted into, which has the
+  /// type of "main" and is created by the first call.
+  llvm::Function *getSegmentFunction(unsigned idx);
   /// Helper function to create a new CallInst, with the specified \p builder,
   /// \p callee, and \p args. Verifies that the function signature is correct,
   /// and then creates and \returns the CallInst.
@@ -284,6 +390,21 @@ public:
   virtual void optimizeLLVMModule(llvm::Function *F, llvm::TargetMachine &TM);
   /// Performs specialization of operations based on constant parameters.
   virtual void performSpecialization();
+  /// \returns the optimization level of the generated code.
+  unsigned getOptLevel() const { return optLevel_; }
+  /// Set the optimization level of the generated code to \p optLevel. Level 0
+  /// skips the specialization, the inlining and the LLVM optimizations to
+  /// generate code as fast as possible. Must be called before performCodeGen.
+  void setOptLevel(unsigned optLevel) { optLevel_ = optLevel; }
+  /// \returns whether the specialized libjit kernels are shared with the other
+  /// modules JITed by the process.
+  bool getShareSpecializations() const { return shareSpecializations_; }
+  /// Set whether the specialized libjit kernels are compiled once per process
+  /// by the SpecializationCache and only declared in the module, to
+  /// \p share. Only valid for modules JITed in the process.
+  void setShareSpecializations(bool share) { shareSpecializations_ = share; }
+  /// \returns the libjit bitcode linked into the module.
+  llvm::StringRef getLibjitBC() const { return libjitBC_; }
   /// \returns allocations info.
   virtual AllocationsInfo &getAllocationsInfo() { return allocationsInfo_; }
   /// \returns the name of the bundle, to be used for filename when saving.
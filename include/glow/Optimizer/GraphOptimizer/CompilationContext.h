@@ -21,8 +21,13 @@
 #include "glow/Quantization/Base/Base.h"
 #include "glow/Support/Error.h"
 
+#include <memory>
+
 namespace glow {
 
+class FunctionPassPipeline;
+class TraceContext;
+
 /// Configuration for different precision modes.
 struct PrecisionConfiguration {
   /// Enum for what kind of transformation should be done for Quantization.
@@ -63,6 +68,35 @@ using QuantizationMode = PrecisionConfiguration::QuantizationMode;
 struct OptimizationOptions {
   /// If true, perform compile-time computation of constant operations.
   bool enableConstantFolding{true};
+
+  /// If true, group the parallel FullyConnected nodes of different inputs
+  /// into BatchMatMuls. Only useful to backends which execute BatchMatMul
+  /// natively instead of lowering it into MatMuls.
+  bool groupParallelFCsIntoBatchMatMul{false};
+
+  /// If true, the FunctionPassManagers collect the wall time, the runs, the
+  /// changes and the node and constant byte deltas of their passes, and add
+  /// them to the stats of the registered StatsExporters.
+  bool collectPassStats{false};
+
+  /// If set, the target-dependent graph optimizations run this pipeline
+  /// instead of the one of the Backend, e.g. a pipeline tuned for the model
+  /// and loaded with deserializePipelineFromYaml().
+  std::shared_ptr<const FunctionPassPipeline> graphOptimizationPipeline;
+};
+
+/// Options for the warm-up of the networks added to a HostManager, which is
+/// done before they can be run.
+struct WarmupOptions {
+  /// If true, the compiled functions are prepared for their first runs, e.g.
+  /// the JITed code is resolved and the memory of the weights and of the
+  /// activations is faulted in, see CompiledFunction::warmUp.
+  bool prepare{false};
+
+  /// The number of times the networks are run with zero inputs, e.g. to fill
+  /// the caches and the pools of the devices and of the executor. The
+  /// outputs of the runs are discarded.
+  unsigned numRuns{0};
 };
 
 /// Context for compilation.
@@ -90,6 +124,14 @@ struct CompilationContext {
   /// Configuration for different precision modes.
   PrecisionConfiguration precisionConfig;
 
+  /// Options for the warm-up of the networks added to a HostManager. Not
+  /// done when profiling.
+  WarmupOptions warmupOpts;
+
+  /// If set, the compilation stages and the passes are logged into it as
+  /// TraceLevel::COMPILE events.
+  TraceContext *traceContext{nullptr};
+
   CompilationContext(PlaceholderBindings *bindings_ = nullptr,
                      LoweredInfoMap *loweredInfoMap_ = nullptr)
       : bindings(bindings_), loweredInfoMap(loweredInfoMap_) {}
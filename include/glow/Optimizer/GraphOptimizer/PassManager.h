@@ -23,10 +23,33 @@
 #include "glow/Optimizer/GraphOptimizer/FunctionPasses.h"
 #include "glow/Optimizer/GraphOptimizerPipeline/Pipeline.h"
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallVector.h"
 
+#include <chrono>
+#include <map>
+
 namespace glow {
 
+/// Compile-time statistics of a FunctionPass, accumulated over its runs by a
+/// FunctionPassManager.
+struct FunctionPassStats {
+  /// Number of times the pass ran.
+  unsigned numRuns{0};
+
+  /// Number of runs which changed the Function.
+  unsigned numChanges{0};
+
+  /// Wall time of the runs.
+  std::chrono::microseconds time{0};
+
+  /// Change of the number of nodes of the Function over the runs.
+  int64_t nodesDelta{0};
+
+  /// Change of the bytes of the constants of the Module over the runs.
+  int64_t constantBytesDelta{0};
+};
+
 /// Manager for running a series of FunctionPasses. Given some Function,
 /// CompilationContext, and provided Pipeline, it will run all passes on the
 /// Function. Enables easier debugging given runPrePass() and runPostPass()
@@ -42,6 +65,18 @@ private:
   /// The index of the current pass being executed in the pipeline.
   size_t passIdx_ = 0;
 
+  /// Number of passes that changed the Function in the current run().
+  unsigned numChanges_ = 0;
+
+  /// For every pass that ran without changing the Function in the current
+  /// run(), the numChanges_ it left the Function at. Running the pass again is
+  /// skipped as long as no other pass changes the Function.
+  llvm::DenseMap<unsigned, unsigned> unchangedAt_;
+
+  /// The statistics of the passes of the current run(), if
+  /// OptimizationOptions::collectPassStats is set.
+  std::map<FunctionPassID, FunctionPassStats> passStats_;
+
   /// Creates and \returns a FunctionPass given a provided \p passID.
   std::unique_ptr<FunctionPass> createFunctionPass(FunctionPassID passID);
 
@@ -55,7 +90,8 @@ private:
   bool runPostPass(Function *F, const CompilationContext &cctx,
                    const FunctionPass &P);
 
-  /// Runs a FunctionPass described by \p passConfig over \p F given \p cctx.
+  /// Runs a FunctionPass described by \p passConfig over \p F given \p cctx,
+  /// unless it would find nothing to change. \returns if \p F was modified.
   bool runPass(const FunctionPassConfig &passConfig, Function *F,
                const CompilationContext &cctx);
 
@@ -72,6 +108,12 @@ public:
   /// Getter for a reference to the Pipeline used by this PassManager..
   const FunctionPassPipeline &getPipeline() const { return pipeline_; };
 
+  /// \returns the statistics of the passes of the last run(), which are only
+  /// collected if OptimizationOptions::collectPassStats was set.
+  const std::map<FunctionPassID, FunctionPassStats> &getPassStats() const {
+    return passStats_;
+  }
+
   /// Dump a textual representation of the FunctionPassManager to \p os.
   void dump(llvm::raw_ostream &os = llvm::outs()) const;
 };
@@ -152,6 +152,17 @@ FunctionPassConfig getDCEPassConfig();
 /// \returns the name of a FunctionPass given its \p passID.
 llvm::StringRef getNameOfPass(FunctionPassID passID);
 
+/// Writes \p pipeline as YAML to the file \p fileName. \returns an Error if
+/// the file can't be written.
+Error serializePipelineToYaml(llvm::StringRef fileName,
+                              const FunctionPassPipeline &pipeline);
+
+/// \returns the pipeline of the YAML file \p fileName, as written by
+/// serializePipelineToYaml(), or an Error if the file can't be read or isn't
+/// a valid pipeline.
+Expected<FunctionPassPipeline>
+deserializePipelineFromYaml(llvm::StringRef fileName);
+
 } // namespace glow
 
 #endif // GLOW_OPTIMIZER_GRAPHOPTIMIZER_GRAPHOPTIMIZER_PIPELINES_PIPELINES_H
@@ -16,6 +16,7 @@
 #ifndef GLOW_OPTIMIZER_IROPTIMIZER_IROPTIMIZER_H
 #define GLOW_OPTIMIZER_IROPTIMIZER_IROPTIMIZER_H
 
+#include <cstddef>
 #include <memory>
 
 namespace glow {
@@ -27,6 +28,24 @@ class Backend;
 /// Perform optimizations on the IR representation.
 void optimize(IRFunction &M, bool shouldShareBuffers);
 
+/// Split the sequences of instructions of \p M that compute their results row
+/// by row, e.g. a slice followed by element-wise instructions and a reduction
+/// of the inner dimensions, into tiles of rows whose buffers take about \p
+/// cacheSize bytes. All the instructions of a sequence are computed on a tile
+/// before moving to the next one, and the intermediate results only used
+/// inside of the sequence are kept in a buffer of one tile, which stays in the
+/// cache. Must run after optimize. \returns true if \p M was changed.
+bool tileInstructionChains(IRFunction &M, size_t cacheSize);
+
+/// Replace the ExtractTensors and InsertTensors of \p M copying regions that
+/// are not contiguous, but are made of rows starting every pitch elements,
+/// e.g. slices and concats along an inner dimension, with strided tensor
+/// views (see getStridedViewLayout). This is only done when the copies are
+/// only read, or only written, by data-parallel instructions, which must then
+/// access the strided views row by row. Must run after optimize.
+/// \returns true if \p M was changed.
+bool createStridedViews(IRFunction &M);
+
 /// Helper to generate and optimize IR from given Function \p F. \p
 /// shouldShareBuffers signifies whether to use the share buffers optimization.
 /// Backend /p B is used to allow for custom lowering from Node to
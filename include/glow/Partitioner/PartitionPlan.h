@@ -0,0 +1,40 @@
+/**
+ * Copyright (c) Glow Contributors. See CONTRIBUTORS file.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef GLOW_PARTITIONER_PARTITIONPLAN_H
+#define GLOW_PARTITIONER_PARTITIONPLAN_H
+
+#include "glow/Runtime/RuntimeTypes.h"
+#include "glow/Support/Error.h"
+
+#include "llvm/ADT/StringRef.h"
+
+namespace glow {
+
+/// Serialize the partition plan \p config, a user-defined partition with
+/// the nodes of every partition listed, into the yaml file \p fileName.
+/// \returns an Error if the file can't be written.
+Error serializePartitionConfig(const runtime::PartitionConfig &config,
+                               llvm::StringRef fileName);
+
+/// Deserialize the partition plan serialized by serializePartitionConfig
+/// into the file \p fileName. \returns an Error if the file can't be read or
+/// doesn't hold a valid plan.
+Expected<runtime::PartitionConfig>
+deserializePartitionConfig(llvm::StringRef fileName);
+
+} // namespace glow
+
+#endif // GLOW_PARTITIONER_PARTITIONPLAN_H
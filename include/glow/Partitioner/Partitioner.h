@@ -78,11 +78,30 @@ class Partitioner final : public PartitionerBase {
   /// Initialization. Called in class constructor.
   void init();
 
+  /// Give every node of \p partitions the Storage nodes of its function to
+  /// place in the SRAM of its devices, as backend hints.
+  void setSRAMPrioritization(const DAGListTy &partitions);
+
+  /// \returns the peak compute and bandwidths of the first device of
+  /// \p backendName, which the cost model estimates its partitions with.
+  BackendInfo getPeakBackendInfo(llvm::StringRef backendName) const;
+
+  /// Hint every node of \p partitions whose function is estimated to be
+  /// bound by the DRAM bandwidth of its devices as memory bound.
+  void setMemoryBoundHints(const DAGListTy &partitions);
+
   /// Verify the generated functions in module, and \returns error if any
   /// function is invalid. Dump partition logs from \p partitions and \p
-  /// mapping.
+  /// mapping. Set the SRAM and the memory bound hints of \p partitions.
   Error finalize(const DAGListTy &partitions, const NodeToFunctionMap &mapping);
 
+  /// Dump into the csv file \p filename the roofline estimate of the cost of
+  /// every node of \p partitions, and of each partition in total. If \p
+  /// profile is not empty, the times measured in the trace events \p profile
+  /// are reported next to the estimated times.
+  Error dumpCostReport(const DAGListTy &partitions, llvm::StringRef filename,
+                       llvm::StringRef profile);
+
   /// After getting the initial partitions, adjust the partitions to minimize
   /// communication and computation cost.
   void partitionsAdjust(NodeToFunctionMap &partitions,
@@ -117,6 +136,26 @@ class Partitioner final : public PartitionerBase {
                             std::map<std::string, BackendInfo> &backendMap,
                             CompilationContext &cctx);
 
+  /// Shard the embedding tables of the functions in the module larger than
+  /// -partition-max-table-size across the devices, see
+  /// glow::shardEmbeddingTables.
+  void shardEmbeddingTables();
+
+  /// \returns the file of the partition plan of \p F on the devices, in the
+  /// directory of -partition-plan-cache.
+  std::string getPartitionPlanFile(const Function *F) const;
+
+  /// Save the plan of \p partitions, the partitions of the single function of
+  /// the module, into \p planFile. The failures are logged.
+  void savePartitionPlan(const DAGListTy &partitions,
+                         llvm::StringRef planFile);
+
+  /// Partition the function of \p plan, which savePartitionPlan saved. The
+  /// function is optimized first, like the partitioning that made the plan
+  /// did.
+  Expected<DAGListTy> partitionFromPlan(const PartitionConfig &plan,
+                                        CompilationContext &cctx);
+
   /// Create the map between the backend name and the concrete backend info
   /// (e.g. backend pointer, mem, number) used in this partiton. If there are
   /// backends need to be created, we use \p backendsHolder to hold them for
@@ -148,9 +187,11 @@ public:
               bool optimized = false);
 
   /// Based on \p partitionConfig passed into Partitioner, do user-defined
-  /// partition.
+  /// partition. The partitions are not optimized if \p optimizePartitions
+  /// is false, when the function was optimized before.
   Expected<DAGListTy>
-  partitionFromConfig(const PartitionConfig &partitionConfig);
+  partitionFromConfig(const PartitionConfig &partitionConfig,
+                      bool optimizePartitions = true);
 
   /// This partition approach is used in Glow Quantization Profiling flow. The
   /// backendBasedPartition is applied first in case there are heterogeneous
@@ -174,6 +215,13 @@ public:
   Expected<DAGListTy> loadBalancedPartition(CompilationContext &cctx,
                                             size_t numDevices = 0);
 
+  /// This partition approach minimizes the total bytes of the tensors sent
+  /// from one partition to another, while respecting memory constraints. It
+  /// starts from the memory-based cut of the BFS levels and refines it, see
+  /// minimizeBoundaryBytes. \p cctx is used for function optimization.
+  /// \returns the partition result or an error.
+  Expected<DAGListTy> minCutPartition(CompilationContext &cctx);
+
   /// Decompose each function in a module. Given the parameters, this function
   /// will choose different partition approches supported in this class:
   /// heterogeneous partition, user-defined partition or quantization profiling.
@@ -19,6 +19,8 @@
 #include "glow/Partitioner/PartitionerTypes.h"
 #include "glow/Support/Error.h"
 
+#include "llvm/ADT/StringMap.h"
+
 namespace glow {
 
 using namespace runtime;
@@ -38,9 +40,14 @@ public:
   void dumpDAG(llvm::StringRef dotFilename, const DAGListTy &partitions) const;
 
 protected:
-  /// Given the node-function mapping \p mapping, do the actual partitioning. If
-  /// \p saveDAG is true, the DAG will be generated. \returns the final
-  /// partitions or an empty partition (If \p saveDAG is false).
+  /// The name of the partition of every node moved by the last
+  /// doPartitioning, by the name of the node.
+  llvm::StringMap<std::string> nodePartitions_;
+
+  /// Given the node-function mapping \p mapping, do the actual partitioning by
+  /// moving the nodes of \p funcs into their partitions, which leaves \p funcs
+  /// empty. If \p saveDAG is true, the DAG will be generated. \returns the
+  /// final partitions or an empty partition (If \p saveDAG is false).
   DAGListTy doPartitioning(llvm::StringRef funcName, std::vector<Function *>,
                            Module *module, NodeToFunctionMap &mapping,
                            bool saveDAG);
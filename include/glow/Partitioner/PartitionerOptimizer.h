@@ -61,5 +61,20 @@ void partitionsCombine(NodeToFunctionMap &partitions,
 DeviceIDTy
 assignLogicalDeviceID(NodeToFunctionMap &mapping,
                       const std::map<std::string, BackendInfo> &backendMap);
+
+/// \returns the total bytes of the results of the nodes of \p partitions which
+/// are used by other partitions, every result counted once per partition
+/// using it.
+uint64_t getBoundaryBytes(const std::vector<NodesSet> &partitions);
+
+/// Move nodes between \p partitions to minimize getBoundaryBytes, while the
+/// memory usage of each partition stays within \p availableMemory. The nodes of
+/// a partition may only use the nodes of the same or of earlier partitions,
+/// which keeps the partitions acyclic. The nodes are moved to the previous or
+/// to the next partition by Fiduccia-Mattheyses passes of the
+/// Kernighan-Lin heuristic, which accept moves that increase the boundary bytes
+/// as long as a later move of the pass more than makes up for them.
+void minimizeBoundaryBytes(std::vector<NodesSet> &partitions,
+                           uint64_t availableMemory);
 } // namespace glow
 #endif // GLOW_PARTITIONER_PARTITIONEROPTIMIZER_H
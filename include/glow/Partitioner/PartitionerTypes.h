@@ -140,6 +140,9 @@ public:
   /// Add a new Node->Function mapping.
   void add(Node *N, Function *F) { nodeToFunction_[N] = F; }
 
+  /// Remove the mapping of \p N, e.g. after it is erased.
+  void erase(Node *N) { nodeToFunction_.erase(N); }
+
   /// Get list of functions contained in this map.
   const FunctionList &getPartitions() const { return functions_; }
 
@@ -18,7 +18,9 @@
 
 #include "glow/Graph/Graph.h"
 #include "glow/Partitioner/PartitionerTypes.h"
+#include "glow/Support/Error.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringMap.h"
 
 namespace glow {
 /// Visit nodes if Function \p F in BFS order and return the nodes by levels
@@ -39,12 +41,53 @@ uint64_t getOutMemPerNode(const NodesSet &nodes, const Node *node);
 /// Given a node, \returns the NodeSet of inputs of this node.
 NodesSet getInputs(const Node *node);
 
+/// The estimated cost of a node on a backend, see getNodeCost.
+struct NodeCost {
+  /// Number of operations, only counted for MatMul, FC and Conv.
+  uint64_t ops{0};
+  /// Bytes moved from and to DRAM.
+  uint64_t dramBytes{0};
+  /// Bytes moved from and to SRAM.
+  uint64_t sramBytes{0};
+  /// Estimated time in seconds, the maximum of the compute time and of the
+  /// times to move the bytes.
+  float time{0};
+
+  /// \returns the operations per byte moved.
+  float getArithmeticIntensity() const {
+    uint64_t bytes = dramBytes + sramBytes;
+    return bytes ? float(ops) / bytes : 0;
+  }
+};
+
+/// \returns the roofline estimate of the cost of \p node based on the peak
+/// compute and bandwidths of \p backendInfo.
+NodeCost getNodeCost(const Node *node, const BackendInfo &backendInfo);
+
 /// Return the estimated op computation time based on \p backendInfo.
 float getNodeComputeTime(const Node *node, const BackendInfo &backendInfo);
 
+/// \returns the sum of the roofline estimates of the costs of the nodes of
+/// \p F based on \p backendInfo.
+NodeCost getFunctionCost(const Function *F, const BackendInfo &backendInfo);
+
+/// \returns whether moving the DRAM bytes of \p cost takes longer than its
+/// operations on a device with the peaks of \p backendInfo, i.e. whether its
+/// operations per DRAM byte are below the ratio of the peak compute to the
+/// peak DRAM bandwidth. \returns false if the peaks are unknown.
+bool isMemoryBound(const NodeCost &cost, const BackendInfo &backendInfo);
+
 /// Given a node, \returns the memory usage of its inputs (i.e. Storage input).
 uint64_t getNodeMemUsage(const Node *node);
 
+/// \returns the names of the Storage nodes of \p F to place in the
+/// \p sramCapacity bytes of SRAM of a device, by decreasing priority. The
+/// nodes read or written the most times by \p F, which save the most DRAM
+/// traffic per byte of SRAM, come first, then the smallest ones. The nodes
+/// which don't fit in the capacity left by the previous ones are skipped.
+std::vector<std::string> getSRAMPrioritization(const Function *F,
+                                               uint64_t sramCapacity);
+
 /// Given nodes set \p currNodes and its memory usage info \p info, \returns the
 /// new memory usage if \p newNode is added into \p currNodes.
 GraphMemInfo updateGraphMemInfoByAddingNode(const NodesSet &currNodes,
@@ -60,5 +103,43 @@ std::set<Kinded::Kind> generateNodeKindsSet(llvm::StringRef names);
 
 /// Log the info of current partition \p partitions.
 void logPartitionInfo(const NodeToFunctionMap &partitions);
+
+/// Load the Complete events of the trace \p filename, in the json format of
+/// TraceContext::dump, of a profiling run. \returns the average duration in
+/// seconds of the events of each name, which is the measured time of the
+/// node of the same name, or an error if the trace can't be read.
+Expected<llvm::StringMap<float>> loadNodeTimeProfile(llvm::StringRef filename);
+
+/// The tables sharded by shardEmbeddingTables, and their shards.
+using ShardedTablesMap = llvm::DenseMap<Constant *, std::vector<Constant *>>;
+
+/// Shard by rows the constant embedding tables larger than \p maxTableSize of
+/// the SparseLengthsWeightedSum nodes of \p F, fused rowwise-quantized or not,
+/// into the fewest tables of at most \p maxTableSize, up to \p maxShards
+/// tables. The row r of a table goes to the row r / n of the
+/// shard r % n. Each node is replaced by the sum of one node per shard, which
+/// gets the weights of the indices of other shards zeroed. The tables of \p
+/// shardedTables are sharded already, and the new ones are added to it.
+/// \returns the number of nodes replaced.
+unsigned shardEmbeddingTables(Function *F, uint64_t maxTableSize,
+                              unsigned maxShards,
+                              ShardedTablesMap &shardedTables);
+
+/// \returns the key of \p node in the profiles of getNodeProfile, made of its
+/// kind and the types of its inputs and results.
+std::string getNodeProfileKey(const Node *node);
+
+/// \returns the average of the times \p nodeTimes, measured per node name,
+/// of the nodes of \p F of the same kind and shape, see getNodeProfileKey.
+llvm::StringMap<float> getNodeProfile(Function *F,
+                                      const llvm::StringMap<float> &nodeTimes);
+
+/// \returns the time of every node of \p F. It's the time of the nodes of the
+/// same kind and shape in \p profile, see getNodeProfile, if there are some.
+/// Otherwise it's the roofline estimate based on \p backendInfo, scaled by the
+/// ratio of the measured to the estimated time of the nodes in \p profile.
+llvm::DenseMap<const Node *, float>
+getNodeTimes(Function *F, const BackendInfo &backendInfo,
+             const llvm::StringMap<float> &profile);
 } // namespace glow
 #endif // GLOW_PARTITIONER_PARTITIONUTILS_H
@@ -0,0 +1,70 @@
+/**
+ * Copyright (c) Glow Contributors. See CONTRIBUTORS file.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef GLOW_PARTITIONER_PLACEMENTPLANNER_H
+#define GLOW_PARTITIONER_PLACEMENTPLANNER_H
+
+#include "glow/Runtime/RuntimeTypes.h"
+#include "glow/Support/Error.h"
+
+#include "llvm/ADT/ArrayRef.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace glow {
+
+/// The load and the cost of a network whose replicas are placed by
+/// planPlacement(). A replica is a copy of the network on one device.
+struct NetworkLoad {
+  /// The name of the network.
+  std::string name;
+  /// The backend of the devices the network runs on.
+  std::string backendName;
+  /// The device memory a replica takes, in bytes.
+  uint64_t memory{0};
+  /// The requests per second the network should serve, its target or its
+  /// observed rate.
+  double targetQPS{0};
+  /// The requests per second a replica serves when its device runs nothing
+  /// else, or zero if unknown, in which case the network gets one replica.
+  double replicaQPS{0};
+  /// The indices of the devices the replicas are on, which the plan keeps
+  /// when it can so that fewer replicas move.
+  std::vector<unsigned> devices;
+};
+
+/// The placement of the replicas of networks on devices.
+struct PlacementPlan {
+  /// The indices of the devices of the replicas of every network, by name.
+  std::map<std::string, std::vector<unsigned>> replicas;
+  /// The requests per second the replicas serve, over all the networks.
+  double servedQPS{0};
+};
+
+/// \returns the replicas of \p networks on \p devices which serve the most
+/// requests, up to the target of every network, within the available memory
+/// of the devices. The networks sharing a device share its time. Every
+/// network gets a replica, and more replicas go where they serve the most
+/// requests, so that hot networks get the devices that cold ones don't
+/// need. \returns an Error if a network doesn't fit on any device.
+Expected<PlacementPlan>
+planPlacement(llvm::ArrayRef<NetworkLoad> networks,
+              llvm::ArrayRef<runtime::DeviceInfo> devices);
+
+} // namespace glow
+
+#endif // GLOW_PARTITIONER_PLACEMENTPLANNER_H
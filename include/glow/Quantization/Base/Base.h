@@ -144,6 +144,29 @@ struct QuantizationConfiguration {
   /// Whether to use rowwise quantization when quantizing a Function.
   bool enableRowwise{false};
 
+  /// With rowwise quantization, the largest error of the 4-bit quantization
+  /// of an embedding table, see getFused4BitRowwiseQuantizationError, for
+  /// which the table is quantized to UInt4FusedFP16QTy instead of
+  /// UInt8FusedQTy. 0 keeps all tables in 8 bits.
+  float fused4BitMaxError{0.0f};
+
+  /// Whether to quantize the FullyConnected nodes with constant weights
+  /// dynamically: their weights are quantized when the Function is, and their
+  /// activations every time they are run, with the params of their range in
+  /// that run, so that they need no profile.
+  bool enableDynamic{false};
+
+  /// Whether to run in float the regions of quantized nodes whose
+  /// conversions from and to float cost more than the float compute they
+  /// save, e.g. the cheap nodes between nodes which aren't quantized.
+  bool minimizeConversions{false};
+
+  /// Kinds of the nodes whose activations are quantized to Int16QTy while
+  /// their weights, e.g. the filter of a Convolution, stay in Int8QTy, when
+  /// the precision is Int8QTy and the backend supports them so. Lowered
+  /// nodes follow the kind of the node they were lowered from.
+  KindSet int16ActivationKinds{};
+
   /// New name for the quantized function. If no name is given then
   /// \ref quantizeFunction() will generate a name.
   std::string newFuncName{""};
@@ -243,6 +266,12 @@ Tensor dequantizeTensor(const Tensor &tensor, ElemKind floatKind);
 /// output.
 Tensor tensor4BitsFusedRowwiseDequantization(const Tensor &input);
 
+/// \returns the error of the 4-bit fused rowwise quantization of the 2D float
+/// tensor \p input, which has an even number of columns: the L2 norm of the
+/// difference between \p input and its dequantized quantization, relative to
+/// the L2 norm of \p input.
+float getFused4BitRowwiseQuantizationError(const Tensor &input);
+
 /// Convert the floating point quantization parameters \p scale and \p offset
 /// into the integer sequence of:
 /// result = ((input >> pre) * scale) >> post + offset.
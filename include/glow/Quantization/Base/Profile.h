@@ -36,6 +36,21 @@ void generateTensorHistogram(const Handle<float> inputTensor,
                              Handle<float> existingHistogram, float &min,
                              float &max);
 
+/// Merge a histogram gathered separately, e.g. on another device or another
+/// set of batches, into an existing histogram of the same number of bins.
+/// \param srcHistogram histogram to merge.
+/// \param srcMin min value seen by \p srcHistogram.
+/// \param srcMax max value seen by \p srcHistogram.
+/// \param destHistogram histogram the counts of \p srcHistogram are added to,
+///                      both rebinned to the union of their ranges.
+/// \param destMin min value seen by \p destHistogram, updated to the merged
+///                min.
+/// \param destMax max value seen by \p destHistogram, updated to the merged
+///                max.
+void mergeTensorHistograms(const Handle<float> srcHistogram, float srcMin,
+                           float srcMax, Handle<float> destHistogram,
+                           float &destMin, float &destMax);
+
 } // namespace quantization
 } // namespace glow
 
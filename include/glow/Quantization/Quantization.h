@@ -42,6 +42,16 @@ std::vector<NodeQuantizationInfo> generateNodeQuantizationInfos(
     const LoweredInfoMap &loweredMap = {}, Schema schema = Schema::Asymmetric,
     ElemKind quantizationPrecision = ElemKind::Int8QTy);
 
+/// Merge the profile gathered into \p otherBindings by the QuantizationProfile
+/// nodes of \p otherF into the profile gathered into \p bindings by the ones
+/// of \p F, e.g. to combine the profiles of the same model run on separate
+/// devices or threads. Profiles are matched by the name of the profiled
+/// NodeValue, so \p F and \p otherF may belong to different Modules.
+void mergeQuantizationProfiles(PlaceholderBindings &bindings,
+                               const Function *F,
+                               const PlaceholderBindings &otherBindings,
+                               const Function *otherF);
+
 /// Quantizes the function \p F into an unoptimized partially quantized function
 /// based on configuration from \p quantConfig. This method converts to integer
 /// as many nodes as permitted by the backend \p B. \p loweredMap contains info
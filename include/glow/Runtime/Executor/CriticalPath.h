@@ -0,0 +1,129 @@
+/**
+ * Copyright (c) Glow Contributors. See CONTRIBUTORS file.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef GLOW_RUNTIME_EXECUTOR_CRITICALPATH_H
+#define GLOW_RUNTIME_EXECUTOR_CRITICALPATH_H
+
+#include "glow/ExecutionContext/TraceEvents.h"
+#include "glow/Runtime/RuntimeTypes.h"
+
+#include "llvm/ADT/ArrayRef.h"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace glow {
+namespace runtime {
+
+/// Finds what bounds the latency of the runs of a partitioned DAG from their
+/// trace events. For every run of a DAGNode the executor logs a Complete
+/// event at the RUNTIME level, from the time the node was ready, all its
+/// parents being done, until its result was handled. Its arguments hold the
+/// run, the node and the timestamps of the stages in between. The events
+/// must be kept by the TraceContext of the runs, which a context logging into
+/// a TraceRecorder doesn't do.
+///
+/// The analyzer rebuilds the timeline of each run, its critical path, and the
+/// slack of every node: how much later the node could have been done
+/// without delaying the run. Over many runs, the node the critical paths
+/// spend the most time in is the one to optimize or rebalance first.
+class CriticalPathAnalyzer final {
+public:
+  /// The arguments of the trace event of a run of a DAGNode.
+  static constexpr const char *kRunArg = "dag_run";
+  static constexpr const char *kNodeArg = "dag_node";
+  static constexpr const char *kDispatchArg = "dispatch";
+  static constexpr const char *kDeviceBeginArg = "device_begin";
+  static constexpr const char *kDeviceEndArg = "device_end";
+
+  /// The timestamps of a run of a DAGNode, in microseconds.
+  struct NodeTimeline {
+    /// All the parents of the node were done.
+    uint64_t ready{0};
+    /// The node was handed to its device, after waiting for its pipeline
+    /// stage.
+    uint64_t dispatch{0};
+    /// The device ran the function of the node, or both are zero if the
+    /// device didn't trace its run.
+    uint64_t deviceBegin{0};
+    uint64_t deviceEnd{0};
+    /// The result of the node was handled, its children were made ready.
+    uint64_t done{0};
+  };
+
+  /// What a DAGNode took over the analyzed runs, in microseconds.
+  struct NodeReport {
+    const DAGNode *node{nullptr};
+    /// The number of runs whose critical path goes through the node.
+    size_t numCritical{0};
+    /// The time the critical paths spent in the node, over all the runs.
+    uint64_t criticalTime{0};
+    /// The mean time the node waited from ready until it was dispatched.
+    double meanQueue{0};
+    /// The mean time the device took besides running the function: the
+    /// transfers of the tensors, the queue of the device and the handoff of
+    /// the result.
+    double meanTransfer{0};
+    /// The mean time the device ran the function of the node.
+    double meanCompute{0};
+    /// The mean slack of the node.
+    double meanSlack{0};
+  };
+
+  /// The analysis of the runs.
+  struct Report {
+    size_t numRuns{0};
+    /// The mean time from the first node being ready until the last one was
+    /// done.
+    double meanLatency{0};
+    /// The nodes of the DAG in the order they should be optimized, by
+    /// decreasing critical time.
+    std::vector<NodeReport> nodes;
+
+    /// \returns a human readable table of the nodes, and which to optimize
+    /// first.
+    std::string toString() const;
+  };
+
+  /// Analyzes the runs of the DAG of \p root, which must outlive the
+  /// analyzer.
+  explicit CriticalPathAnalyzer(const DAGNode *root);
+
+  /// Adds the runs of the DAG whose nodes all have an event in \p events.
+  /// The other events, those of other DAGs and of the runs that failed, are
+  /// ignored. \returns the number of runs added.
+  size_t addTraceEvents(llvm::ArrayRef<TraceEvent> events);
+
+  /// \returns the analysis of the runs added so far.
+  Report analyze() const;
+
+private:
+  /// The nodes of the DAG, parents before children.
+  std::vector<const DAGNode *> nodes_;
+  /// The indices of the nodes in nodes_, by name.
+  std::unordered_map<std::string, size_t> indices_;
+  /// The indices of the parents of every node, without the root.
+  std::vector<std::vector<size_t>> parents_;
+  /// The indices of the children of every node.
+  std::vector<std::vector<size_t>> children_;
+  /// The timelines of the nodes of every run added.
+  std::vector<std::vector<NodeTimeline>> runs_;
+};
+
+} // namespace runtime
+} // namespace glow
+
+#endif // GLOW_RUNTIME_EXECUTOR_CRITICALPATH_H
@@ -46,6 +46,11 @@ public:
   /// Shutdown the Executor. Should block until all active requests are complete
   /// and prevent new requests from being initiated.
   virtual void shutdown() = 0;
+
+  /// Drop whatever the Executor keeps for the runs of the DAG of \p root. It
+  /// must be called before the DAG is freed, since another DAG may then get
+  /// its address. Runs of the DAG may still be going on.
+  virtual void removeDAG(const DAGNode *root) {}
 };
 
 } // namespace runtime
@@ -16,17 +16,23 @@
 #ifndef GLOW_RUNTIME_THREAD_POOL_EXECUTOR_H
 #define GLOW_RUNTIME_THREAD_POOL_EXECUTOR_H
 
+#include <chrono>
 #include <condition_variable>
 #include <mutex>
+#include <queue>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 
 #include "glow/Runtime/Executor/Executor.h"
+#include "glow/Support/TensorPool.h"
 #include "glow/Support/ThreadPool.h"
 
 namespace glow {
 namespace runtime {
 
 class ExecutionState;
+class PipelineStages;
 
 /// This class implements a simple barrier with which to wait for all threads
 /// to exit a certain section of code before proceeding.
@@ -58,10 +64,24 @@ private:
 /// handle and process multiple concurrent execution runs.
 class ThreadPoolExecutor final : public Executor {
 public:
-  /// Constructor.
+  /// The number of runs of nodes that were hedged, and the number of those
+  /// won by the hedge.
+  static constexpr const char *kHedgedRuns = "glow.executor.hedged_runs";
+  static constexpr const char *kHedgeWins = "glow.executor.hedge_wins";
+  /// The number of runs of nodes that could have been hedged.
+  static constexpr const char *kHedgeableRuns =
+      "glow.executor.hedgeable_runs";
+  /// The number of runs of nodes that were skipped by their predicate.
+  static constexpr const char *kSkippedRuns = "glow.executor.skipped_runs";
+
+  /// Constructor. If \p pipelineDepth isn't zero, the nodes of a DAG are
+  /// pipelined: a node runs for at most \p pipelineDepth runs at once, and
+  /// the other runs ready for it wait in the order they got ready. The nodes
+  /// that run on several devices are hedged as described by \p hedging.
   explicit ThreadPoolExecutor(const DeviceManagerMapTy &deviceManagers,
-                              unsigned numWorkers = kNumWorkers)
-      : threadPool_(numWorkers), deviceManagers_(deviceManagers) {}
+                              unsigned numWorkers = kNumWorkers,
+                              unsigned pipelineDepth = 0,
+                              const HedgingConfig &hedging = HedgingConfig());
 
   /// See Executor::run. A particular invocation is specified completely by
   /// the triple (roots, bindings, runId).
@@ -72,12 +92,152 @@ public:
 
   void shutdown() override;
 
+  /// See Executor::removeDAG. Drops the ExecutionStates cached for the DAG of
+  /// \p root.
+  void removeDAG(const DAGNode *root) override;
+
 private:
+  /// The ExecutionStates of a DAG that aren't used by a run, and the pool of
+  /// the tensors of the intermediate placeholders of the DAG.
+  struct ExecutionStatePool {
+    /// Pool of the intermediate tensors, it outlives the states.
+    TensorPool tensorPool;
+    /// The pipeline stages of the DAG if it is pipelined, it outlives the
+    /// states.
+    std::unique_ptr<PipelineStages> stages;
+    /// Lock for states.
+    std::mutex lock;
+    /// The states waiting for a run.
+    std::vector<std::unique_ptr<ExecutionState>> states;
+    /// Whether the runs of the DAG may be handed to the device of its only
+    /// node directly, see runDirectly, and the placeholders of the node.
+    bool direct{false};
+    std::vector<Placeholder *> directPlaceholders;
+  };
+
+  /// \returns the ExecutionState pool of the DAG of \p root, created on the
+  /// first run of the DAG.
+  std::shared_ptr<ExecutionStatePool> getStatePool(const DAGNode *root);
+
+  /// Run the DAG of \p root with \p context on the device of its only node,
+  /// without an ExecutionState, if the pool \p pool of the DAG allows it and
+  /// \p context binds exactly the placeholders of the node. The result is
+  /// then passed to \p cb from the thread of the device. \returns false,
+  /// leaving \p context and \p cb untouched, if the DAG must run through an
+  /// ExecutionState.
+  bool runDirectly(const ExecutionStatePool &pool, const DAGNode *root,
+                   std::unique_ptr<ExecutionContext> &context,
+                   RunIdentifierTy runId, ResultCBTy &cb);
+
+  /// \returns an ExecutionState for the run \p runId of the DAG of \p root,
+  /// reset with \p context and \p cb. The state is taken from the pool
+  /// \p pool of the DAG, or created if there is none, and is given back to
+  /// the pool when the last reference to it is dropped.
+  std::shared_ptr<ExecutionState>
+  getExecutionState(std::shared_ptr<ExecutionStatePool> pool,
+                    const DAGNode *root, RunIdentifierTy runId,
+                    std::unique_ptr<ExecutionContext> context, ResultCBTy cb);
+
   /// Execute the DAG node specified by \p node within the run corresponding to
-  /// \p executionState.
+  /// \p executionState, once the pipeline stage of the node has room.
   void executeDAGNode(std::shared_ptr<ExecutionState> executionState,
                       DAGNode *node);
 
+  /// Have the device that runs \p node within the run corresponding to
+  /// \p executionState stage the inputs of the node, while the run waits
+  /// for its pipeline stage. See DeviceManager::prepareInputs.
+  void prepareDAGNode(ExecutionState &executionState, DAGNode *node);
+
+  /// Run \p node within the run corresponding to \p executionState, after
+  /// it entered its pipeline stage.
+  void runDAGNode(std::shared_ptr<ExecutionState> executionState,
+                  DAGNode *node);
+
+  /// \returns whether \p node runs within the run corresponding to
+  /// \p executionState, as decided by its predicate, or an Error if the
+  /// predicate isn't bound.
+  Expected<bool> isPredicatedOn(ExecutionState &executionState,
+                                const DAGNode *node);
+
+  /// Skip \p node within the run corresponding to \p executionState: its
+  /// outputs are zeroed and its children are run as if it ran. The inputs
+  /// staged on \p preparedDevice, if not null, are released.
+  void skipDAGNode(std::shared_ptr<ExecutionState> executionState,
+                   DAGNode *node, DeviceManager *preparedDevice);
+
+  /// \returns the DeviceManager that runs the next run of \p node: the one
+  /// of its devices other than \p exclude with the fewest runs in flight.
+  /// \returns the end of deviceManagers_ if none of these devices exist.
+  DeviceManagerMapTy::const_iterator
+  selectDevice(DAGNode *node, DeviceManager *exclude = nullptr);
+
+  /// Mark the run of \p node for \p executionState as no longer running in
+  /// the pipeline stage of the node, and start the next queued run of the
+  /// node if there is one.
+  void leaveStage(ExecutionState &executionState, DAGNode *node);
+
+  /// A run of a node that may be hedged, whose attempts run on copies of the
+  /// input context of the node.
+  struct HedgedRun {
+    /// The state of the run, dropped once an attempt won.
+    std::shared_ptr<ExecutionState> state;
+    DAGNode *node;
+    /// The device of the first attempt.
+    DeviceManager *primary;
+    /// Lock for the fields below.
+    std::mutex lock;
+    /// Number of attempts in flight.
+    unsigned pending{0};
+    /// Whether an attempt won.
+    bool done{false};
+  };
+
+  /// The latencies of the last runs of a node, in microseconds.
+  struct LatencyHistory {
+    std::mutex lock;
+    std::vector<uint64_t> samples;
+    /// The index of the sample replaced by the next one.
+    size_t next{0};
+  };
+
+  /// Run \p node within the run corresponding to \p executionState on
+  /// \p deviceManager, and hedge the run on another device if it takes
+  /// longer than the hedging percentile of the latencies of the node.
+  void runHedgedDAGNode(std::shared_ptr<ExecutionState> executionState,
+                        DAGNode *node, DeviceManager *deviceManager);
+
+  /// Start an attempt of \p run on \p deviceManager, with a copy of the input
+  /// context of the node. Must be called with the lock of \p run held.
+  void startAttempt(std::shared_ptr<HedgedRun> run,
+                    DeviceManager *deviceManager);
+
+  /// Launch the hedged attempt of \p run, if no attempt won yet and the
+  /// budget of hedges isn't spent.
+  void hedge(std::shared_ptr<HedgedRun> run);
+
+  /// Handle the result \p err and \p ctx of the attempt of \p run on
+  /// \p deviceManager, which started at \p startTime. The first attempt to
+  /// finish hands its outputs over to the run, unless it failed while the
+  /// other one is still in flight. The other attempt is ignored.
+  void finishAttempt(std::shared_ptr<HedgedRun> run,
+                     DeviceManager *deviceManager, Error err,
+                     std::unique_ptr<ExecutionContext> ctx,
+                     std::chrono::steady_clock::time_point startTime);
+
+  /// \returns the latency history of \p node.
+  LatencyHistory &getLatencyHistory(const DAGNode *node);
+
+  /// \returns the latency after which a run of \p node is hedged, or zero
+  /// if too few runs of the node were recorded.
+  std::chrono::microseconds getHedgeTimeout(const DAGNode *node);
+
+  /// Record the latency of a run of \p node which started at \p startTime.
+  void recordLatency(const DAGNode *node,
+                     std::chrono::steady_clock::time_point startTime);
+
+  /// Launches the hedges whose timeouts expired, until shutdown.
+  void runHedgeTimers();
+
   /// Handle the result returned asynchronously by the DeviceManager.
   /// \p executionState is tracks the state of the run that the node that
   /// finished executing belongs to, \p err is the Error returned by the
@@ -89,7 +249,7 @@ private:
   void handleDeviceManagerResult(std::shared_ptr<ExecutionState> executionState,
                                  Error err,
                                  std::unique_ptr<ExecutionContext> ctx,
-                                 const DAGNode *node);
+                                 DAGNode *node);
 
   /// The default number of workers in the thread pool.
   constexpr static unsigned kNumWorkers = 3;
@@ -102,6 +262,45 @@ private:
   InflightBarrier inflightBarrier_;
   /// Whether the executor is currently shutting down or not.
   std::atomic<bool> shuttingDown_{false};
+  /// Maximum number of runs of a DAG node that run at once, or zero if the
+  /// DAGs aren't pipelined.
+  const unsigned pipelineDepth_;
+  /// The number of latencies of a node that are kept, and the number needed
+  /// to hedge its runs.
+  constexpr static size_t kHedgeSamples = 128;
+  constexpr static size_t kMinHedgeSamples = 16;
+  /// The hedging policy.
+  const HedgingConfig hedging_;
+  /// Number of runs that could be hedged, and number of runs that were.
+  std::atomic<uint64_t> hedgeableRuns_{0};
+  std::atomic<uint64_t> hedgedRuns_{0};
+  /// The latencies of the nodes that may be hedged.
+  std::unordered_map<const DAGNode *, std::unique_ptr<LatencyHistory>>
+      latencies_;
+  /// Lock for latencies_.
+  std::mutex latenciesLock_;
+  /// The runs waiting for their hedge timeout, soonest first.
+  using HedgeTimerTy = std::pair<std::chrono::steady_clock::time_point,
+                                 std::shared_ptr<HedgedRun>>;
+  struct HedgeTimerCompare {
+    bool operator()(const HedgeTimerTy &a, const HedgeTimerTy &b) const {
+      return a.first > b.first;
+    }
+  };
+  std::priority_queue<HedgeTimerTy, std::vector<HedgeTimerTy>,
+                      HedgeTimerCompare>
+      hedgeTimers_;
+  /// Lock and condition variable for hedgeTimers_ and stopHedgeTimers_.
+  std::mutex hedgeTimersLock_;
+  std::condition_variable hedgeTimersCV_;
+  bool stopHedgeTimers_{false};
+  /// The thread of runHedgeTimers(), if hedging is enabled.
+  std::thread hedgeTimerThread_;
+  /// The ExecutionState pool of every DAG that was run, by root.
+  std::unordered_map<const DAGNode *, std::shared_ptr<ExecutionStatePool>>
+      statePools_;
+  /// Lock for statePools_.
+  std::mutex statePoolsLock_;
 };
 
 } // namespace runtime
@@ -18,24 +18,109 @@
 #include "glow/Backend/Backend.h"
 #include "glow/Backends/DeviceManager.h"
 #include "glow/Graph/Graph.h"
+#include "glow/Partitioner/PlacementPlanner.h"
 #include "glow/Runtime/Executor/Executor.h"
 #include "glow/Runtime/Provisioner/Provisioner.h"
 #include "glow/Runtime/RuntimeTypes.h"
+#include "glow/Support/MPMCQueue.h"
+
+#include "llvm/ADT/StringMap.h"
 
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <list>
 #include <map>
 #include <mutex>
-#include <queue>
+#include <set>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
 namespace glow {
 namespace runtime {
+/// A request of a network that is run many times, see
+/// HostManager::prepareRequest. Its context holds a tensor for every
+/// placeholder of the network, allocated once and reused by all the runs, so
+/// that a run allocates no bindings. The placeholders are numbered by slots,
+/// which are looked up by name once, callers then fill the inputs and read the
+/// results of every run in place through the slots.
+class PreparedRequest final {
+  /// Name of the network the request runs.
+  std::string networkName_;
+
+  /// Module of the network, which holds the placeholders of the slots.
+  std::shared_ptr<Module> module_;
+
+  /// The context of the runs, null while a run has it.
+  std::unique_ptr<ExecutionContext> context_;
+
+  /// The placeholder and the tensor of every slot.
+  std::vector<Placeholder *> placeholders_;
+  std::vector<Tensor *> tensors_;
+
+public:
+  /// Allocate the tensors of the placeholders of \p module, the module of the
+  /// network \p networkName.
+  PreparedRequest(llvm::StringRef networkName, std::shared_ptr<Module> module);
+
+  /// \returns the name of the network the request runs.
+  llvm::StringRef getNetworkName() const { return networkName_; }
+
+  /// \returns the number of slots, one per placeholder of the network.
+  size_t getNumSlots() const { return placeholders_.size(); }
+
+  /// \returns the slot of the placeholder \p name, or an Error if the network
+  /// has no such placeholder. Meant to be called once, not for every run.
+  Expected<size_t> getSlot(llvm::StringRef name) const;
+
+  /// \returns the placeholder of \p slot.
+  Placeholder *getPlaceholder(size_t slot) const {
+    DCHECK_LT(slot, placeholders_.size()) << "Invalid slot";
+    return placeholders_[slot];
+  }
+
+  /// \returns the tensor of \p slot, which stays the same for all the runs.
+  /// It must not be accessed while a run has the context.
+  Tensor *getTensor(size_t slot) const {
+    DCHECK_LT(slot, tensors_.size()) << "Invalid slot";
+    return tensors_[slot];
+  }
+
+  /// \returns whether a run has the context.
+  bool isRunning() const { return context_ == nullptr; }
+
+  /// \returns the context to pass to HostManager::runNetwork, without the
+  /// trace context and the stats sampling of the last run.
+  std::unique_ptr<ExecutionContext> takeContext();
+
+  /// Give back \p context, which takeContext returned, once the run is done.
+  void returnContext(std::unique_ptr<ExecutionContext> context);
+};
+
 /// The HostManager serves as an entry point into the Runtime environment. It
 /// provides an interface to add, run, and evict networks from the host. It
 /// handles DeviceManager initialization, houses the Executor, and calls into
 /// the Partitioner and Provisioner for network initialization.
 class HostManager final {
+  struct BatchingData;
+  struct ResultCacheData;
+  struct TenantData;
+
+  /// The variants of a network compiled for other batch sizes, see
+  /// addBatchVariant.
+  struct BatchVariants {
+    /// Name of the placeholder whose first dimension is the batch size of
+    /// the requests.
+    std::string placeholderName;
+
+    /// The names of the variants by their batch sizes.
+    std::map<size_t, std::string> names;
+  };
+
   /// NetworkData contains data about each network in HostManager that is needed
   /// by the runtime.
   struct NetworkData {
@@ -47,7 +132,75 @@ class HostManager final {
     /// use an atomic refcount rather than just store a shared_ptr for thread
     /// safety.
     std::atomic<size_t> refcount{0};
+
+    /// Set while removeNetwork checks that there are no runs of the network,
+    /// so that runNetwork doesn't start new ones.
+    std::atomic<bool> removing{false};
+
+    /// The batching of the requests of the network if enableBatching was
+    /// called for it, owned by batching_.
+    std::atomic<BatchingData *> batching{nullptr};
+
+    /// The variants of the network added by addBatchVariant, or null.
+    /// Replaced rather than modified, and accessed with std::atomic_load and
+    /// std::atomic_store.
+    std::shared_ptr<const BatchVariants> batchVariants;
+
+    /// Whether the network is a variant of another network.
+    bool isBatchVariant{false};
+
+    /// Moving average of the observed durations of the runs of the network in
+    /// microseconds, zero until a run finished.
+    std::atomic<uint64_t> estimatedRunTimeUs{0};
+
+    /// Whether the partitions of the network are on their devices. Only
+    /// cleared with HostConfig::evictLRUNetworks, when the network is evicted
+    /// to make room for another one.
+    std::atomic<bool> resident{true};
+
+    /// The value of useClock_ when the network was last run, which orders the
+    /// networks for the LRU eviction.
+    std::atomic<uint64_t> lastUse{0};
+
+    /// The tenant the network was given by setTenant, owned by tenants_, or
+    /// null.
+    std::atomic<TenantData *> tenant{nullptr};
+
+    /// The cache of the results of the network if enableResultCache was
+    /// called for it, or null. The runs which fill it hold it too. Accessed
+    /// with std::atomic_load and std::atomic_store.
+    std::shared_ptr<ResultCacheData> resultCache;
+
+    /// The requests per second the network should serve, set by
+    /// setTargetQPS, or zero to place its replicas for its observed rate.
+    /// Guarded by networkLock_.
+    double targetQPS{0};
+
+    /// Number of requests of the network, counted by runNetwork.
+    std::atomic<uint64_t> numRequests{0};
+
+    /// The value of numRequests and the time when planPlacement last
+    /// observed the rate of the requests. Guarded by networkLock_.
+    uint64_t observedRequests{0};
+    std::chrono::steady_clock::time_point observedTime{
+        std::chrono::steady_clock::now()};
+
+    /// The requests per second a replica serves estimated from the costs of
+    /// the nodes of the network, used until a run finished, or zero if
+    /// unknown.
+    double estimatedReplicaQPS{0};
+
+    /// \returns whether a run of the network that starts now is expected to
+    /// finish by \p deadline.
+    bool canFinishBy(std::chrono::steady_clock::time_point deadline) const;
+
+    /// Add \p runTime, the observed duration of a run, to the estimate.
+    void recordRunTime(std::chrono::microseconds runTime);
   };
+
+  /// A map from a networkName to a network.
+  using NetworkMapTy = llvm::StringMap<std::shared_ptr<NetworkData>>;
+
   /// Container for inference requests waiting in the queue.
   struct InferRequest {
     /// Name of the network the requested run is for.
@@ -65,14 +218,21 @@ class HostManager final {
     /// The runtime generated ID for the run request.
     uint64_t requestID;
 
-    // Define greater than operator to allow sorting in priority_heap for queue
-    // reqests. If priority is the same fall back to order of submission.
-    bool operator>(const InferRequest &inferReq) const {
-      if (priority == inferReq.priority) {
-        return requestID > inferReq.requestID;
-      }
-      return priority > inferReq.priority;
-    }
+    /// The network of the run, which its refcount keeps alive.
+    NetworkData *network{nullptr};
+
+    /// The tenant of the network when the request was made, or null.
+    TenantData *tenant{nullptr};
+
+    /// The time by which the run must finish, or the maximum time point if
+    /// the run has no deadline.
+    std::chrono::steady_clock::time_point deadline{
+        std::chrono::steady_clock::time_point::max()};
+
+    /// The time the request was queued at, only set if its context is
+    /// sampled for the latency stats.
+    std::chrono::steady_clock::time_point queueTime;
+
     InferRequest(std::string networkName,
                  std::unique_ptr<ExecutionContext> context, ResultCBTy callback,
                  uint64_t priority, uint64_t requestID)
@@ -80,30 +240,256 @@ class HostManager final {
           callback{callback}, priority{priority}, requestID{requestID} {}
   };
 
+  /// State of the dynamic batching of the requests of a network, see
+  /// enableBatching.
+  struct BatchingData {
+    /// The configuration of the batching.
+    const BatchingConfig config;
+
+    /// The network whose requests are batched.
+    NetworkData *network;
+
+    /// Module of the network that runs the batches. Holding it keeps its
+    /// placeholders alive.
+    std::shared_ptr<Module> batchedModule;
+
+    /// The placeholders of batchedModule by name.
+    llvm::StringMap<Placeholder *> placeholders;
+
+    /// Requests waiting to be batched with their arrival times, oldest first.
+    std::deque<std::pair<InferRequest, std::chrono::steady_clock::time_point>>
+        pending;
+
+    /// Set to make the batching thread dispatch all the pending requests and
+    /// exit.
+    bool stop{false};
+
+    /// Mutex for pending and stop.
+    std::mutex lock;
+
+    /// Signaled when a request or stop may complete a batch.
+    std::condition_variable cv;
+
+    /// The thread that forms and dispatches the batches.
+    std::thread thread;
+
+    BatchingData(const BatchingConfig &config, NetworkData *network,
+                 std::shared_ptr<Module> batchedModule)
+        : config{config}, network{network},
+          batchedModule{std::move(batchedModule)} {}
+
+    /// Dispatch the pending requests and join the batching thread. This must
+    /// not be called while the batching thread may wait on networkLock_.
+    ~BatchingData();
+  };
+
+  /// The results of the runs of a network by the hashes of their inputs, see
+  /// enableResultCache.
+  struct ResultCacheData {
+    /// A cached run: its inputs, to tell apart the runs with the same hash,
+    /// and its outputs with their indices in outputs.
+    struct Entry {
+      uint64_t key;
+      std::vector<Tensor> inputs;
+      std::vector<std::pair<size_t, Tensor>> outputs;
+      std::chrono::steady_clock::time_point expiry;
+      size_t bytes;
+    };
+
+    /// The configuration of the cache.
+    const ResultCacheConfig config;
+
+    /// Module of the network, which keeps its placeholders alive.
+    std::shared_ptr<Module> module;
+
+    /// The placeholders the network reads and doesn't write, sorted by name,
+    /// and the ones it writes.
+    std::vector<Placeholder *> inputs;
+    std::vector<Placeholder *> outputs;
+
+    /// The cached runs, most recently used first, and their positions by
+    /// key.
+    std::list<Entry> entries;
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> index;
+
+    /// The bytes of the tensors of entries.
+    size_t bytes{0};
+
+    /// The numbers of lookups and of the ones that found their run.
+    uint64_t lookups{0};
+    uint64_t hits{0};
+
+    /// Mutex for entries, index, bytes, lookups and hits.
+    std::mutex lock;
+
+    /// Key of the stat of the hit rate of the cache.
+    const std::string hitRateKey;
+
+    ResultCacheData(const ResultCacheConfig &config, llvm::StringRef name,
+                    std::shared_ptr<Module> module)
+        : config{config}, module{std::move(module)},
+          hitRateKey{"glow.result_cache." + name.str() + ".hit_rate_pct"} {}
+
+    /// Sets \p key to the hash of the inputs bound in \p bindings.
+    /// \returns false if one of them isn't bound, the run is then not
+    /// cached.
+    bool getKey(PlaceholderBindings &bindings, uint64_t &key) const;
+
+    /// Copies the outputs of the cached run of \p key into \p bindings if
+    /// it has the same inputs and all the outputs bound there. \returns
+    /// whether it did.
+    bool lookup(uint64_t key, PlaceholderBindings &bindings);
+
+    /// Caches the inputs and outputs bound in \p bindings, of a run whose
+    /// inputs hash to \p key.
+    void insert(uint64_t key, PlaceholderBindings &bindings);
+  };
+
+  /// State of a tenant, see addTenant.
+  struct TenantData {
+    /// The configuration of the tenant.
+    const TenantConfig config;
+
+    /// The queued requests of the tenant, as a heap whose top is the request
+    /// to dispatch first: the earliest deadline, else the lowest priority
+    /// value, else the oldest request.
+    std::vector<InferRequest> queue;
+
+    /// Number of dispatched requests of the tenant that didn't finish.
+    size_t active{0};
+
+    /// Virtual time of the weighted fair queuing: the tenant whose pass is
+    /// the lowest is dispatched next, and its pass grows by kFairStride
+    /// divided by its weight.
+    uint64_t pass{0};
+
+    /// Keys of the stats of the queue depth and of the active requests of
+    /// the tenant.
+    const std::string queueDepthKey;
+    const std::string activeKey;
+
+    explicit TenantData(const TenantConfig &config)
+        : config{config},
+          queueDepthKey{"glow.tenant." + config.name + ".queue_depth"},
+          activeKey{"glow.tenant." + config.name + ".active_requests"} {}
+
+    /// \returns whether the tenant runs as many requests as its quota allows.
+    bool atQuota() const {
+      return config.maxActiveRequests && active >= config.maxActiveRequests;
+    }
+  };
+
+  /// The pass a dispatch adds for a weight of 1, see TenantData::pass.
+  static constexpr uint64_t kFairStride = 1 << 20;
+
+  /// The tenants by name. Tenants are never removed, so that networks and
+  /// requests point to them. Guarded by tenantsLock_.
+  std::unordered_map<std::string, std::unique_ptr<TenantData>> tenants_;
+
+  /// The pass of the requests of the networks without a tenant, queued in
+  /// inferQueue_. Guarded by tenantsLock_.
+  uint64_t defaultPass_{0};
+
+  /// The pass of the last dispatch. Tenants that were idle resume from it
+  /// rather than from their own pass, so that they don't get the dispatches
+  /// they missed in a burst. Guarded by tenantsLock_.
+  uint64_t virtualTime_{0};
+
+  /// Number of requests queued in the queues of the tenants, read without
+  /// taking tenantsLock_.
+  std::atomic<size_t> tenantQueueSize_{0};
+
+  /// Mutex for the state of the tenants, which only the requests of networks
+  /// with a tenant take while tenantQueueSize_ is zero.
+  std::mutex tenantsLock_;
+
   /// Count of current in-flight networks being run. Atomic to allow
   /// concurrency in runNetwork.
   std::atomic<size_t> activeRequestCount_{0};
 
+  /// Limit of activeRequestCount_, which is config_.maxActiveRequests unless
+  /// config_.adaptiveConcurrency adjusts it.
+  std::atomic<size_t> activeRequestLimit_{0};
+
+  /// The runs that completed in the current window of the adaptive limit,
+  /// the sum of their latencies, and whether a request was held back by the
+  /// limit during the window.
+  size_t concurrencyWindowRuns_{0};
+  std::chrono::microseconds concurrencyWindowLatency_{0};
+  std::atomic<bool> concurrencyLimited_{false};
+  std::mutex concurrencyLock_;
+
   /// Count of total requests, this is used as a run ID. Atomic to allow
   /// concurrency in runNetwork.
   std::atomic<size_t> totalRequestCount_{0};
 
-  /// Priority queue for queued requests. This is a min-heap so lowest value is
-  /// popped first.
-  std::priority_queue<InferRequest, std::vector<InferRequest>,
-                      std::greater<InferRequest>>
-      inferQueue_;
-
   /// Configuration parameters for this Runtime Host.
   const HostConfig config_{};
 
+  /// Lock-free priority queue for queued requests, the lowest value is popped
+  /// first.
+  MPMCPriorityQueue<InferRequest> inferQueue_{config_.maxQueueSize,
+                                              config_.numPriorities};
+
+  /// Queued requests that have a deadline, as a heap whose top is the
+  /// earliest deadline. They are dispatched before inferQueue_. Guarded by
+  /// deadlineQueueLock_.
+  std::vector<InferRequest> deadlineQueue_;
+
+  /// Mutex for deadlineQueue_, which only requests with a deadline take.
+  std::mutex deadlineQueueLock_;
+
+  /// Size of deadlineQueue_, read without taking deadlineQueueLock_.
+  std::atomic<size_t> deadlineQueueSize_{0};
+
+  /// The result of a run, whose callback is called by a completion thread.
+  struct Completion {
+    ResultCBTy callback;
+    RunIdentifierTy runID;
+    Error err;
+    std::unique_ptr<ExecutionContext> context;
+    /// Name of the network, for the latency of the callback.
+    std::string name;
+  };
+
+  /// The results waiting for a completion thread, if there are completion
+  /// threads, see HostConfig::completionThreads.
+  std::unique_ptr<MPMCQueue<Completion>> completions_;
+
+  /// The completion threads.
+  std::vector<std::thread> completionThreads_;
+
+  /// Whether the completion threads take the results. Once they are stopped
+  /// the callbacks are called by the threads of the executor again.
+  std::atomic<bool> completionsRunning_{false};
+
+  /// Number of completion threads waiting for results.
+  std::atomic<unsigned> completionWaiters_{0};
+
+  /// Lock and condition variable the idle completion threads wait on, and
+  /// whether they should stop once there is no result left.
+  std::mutex completionsLock_;
+  std::condition_variable completionsCV_;
+  bool stopCompletions_{false};
+
   /// A map from a networkName to a network, which is represented by struct DAG.
-  std::unordered_map<std::string, NetworkData> networks_;
+  std::unordered_map<std::string, std::shared_ptr<NetworkData>> networks_;
+
+  /// Immutable copy of networks_ that runNetwork looks networks up in without
+  /// taking networkLock_. Accessed with std::atomic_load and
+  /// std::atomic_store, and replaced by publishNetworks.
+  std::shared_ptr<const NetworkMapTy> publishedNetworks_{
+      std::make_shared<NetworkMapTy>()};
 
-  /// Mutex for networks_ since runNetwork, addNetwork, and
-  /// removeNetwork can all be called concurrently, a guard is needed.
+  /// Mutex for networks_ since addNetwork, and removeNetwork can be called
+  /// concurrently, a guard is needed. runNetwork doesn't take it.
   std::mutex networkLock_;
 
+  /// A map from a networkName to the state of the batching of its requests,
+  /// for the networks that enableBatching was called for. Guarded by
+  /// networkLock_.
+  std::unordered_map<std::string, std::unique_ptr<BatchingData>> batching_;
+
   /// A map of DeviceManagers by deviceID. An ordered map is used here to allow
   /// a stable iteration order over devices.
   DeviceManagerMapTy devices_;
@@ -128,6 +514,36 @@ class HostManager final {
   static constexpr const char *kDeviceMemoryMax =
       "glow.devices.maximum_memory.total";
 
+  /// String const for logging the largest free block of all devices, i.e.
+  /// the largest allocation any device can make.
+  static constexpr const char *kDeviceLargestFreeBlock =
+      "glow.devices.largest_free_block.max";
+
+  /// String const for logging the number of networks evicted to make room
+  /// for other networks.
+  static constexpr const char *kEvictedNetworks = "glow.networks.evicted";
+
+  /// String const for logging the latency of reloading evicted networks.
+  static constexpr const char *kReloadLatency = "glow.networks.reload_us";
+
+  /// String const for logging the requests failed because they could not
+  /// finish by their deadline.
+  static constexpr const char *kDeadlineExceededRequests =
+      "glow.requests.deadline_exceeded";
+
+  /// String const for logging the requests dropped because their client
+  /// cancelled them.
+  static constexpr const char *kCancelledRequests = "glow.requests.cancelled";
+
+  /// String consts for logging the requests served from the cache of the
+  /// results of their network, and the ones that weren't found there.
+  static constexpr const char *kResultCacheHits = "glow.result_cache.hits";
+  static constexpr const char *kResultCacheMisses = "glow.result_cache.misses";
+
+  /// String const for logging the limit of the requests that run at once.
+  static constexpr const char *kActiveRequestLimit =
+      "glow.requests.active_limit";
+
   /// Helper function to handle cleanup if an error occurs during addNetwork.
   /// This must be called while holding the a lock on networkLock_.
   void cleanupAddNetwork(llvm::ArrayRef<std::string> names);
@@ -135,9 +551,160 @@ class HostManager final {
   /// Set of networks in the process of being added.
   std::set<std::string> processingNetworks_;
 
-  /// Method to dispatch a new run to the executor.
+  /// Networks replaced by swapNetwork whose runs haven't all finished yet,
+  /// so that they are not evicted yet. Guarded by networkLock_.
+  std::vector<std::shared_ptr<NetworkData>> retiredNetworks_;
+
+  /// Number of addNetworkAsync and swapNetwork calls whose work in the
+  /// background hasn't finished. Guarded by asyncLoadsLock_.
+  size_t asyncLoads_{0};
+
+  /// Counts the runs of all the networks, see NetworkData::lastUse.
+  std::atomic<uint64_t> useClock_{0};
+
+  /// Mutex serializing the evictions and reloads of the networks with
+  /// HostConfig::evictLRUNetworks. It is taken before networkLock_.
+  std::mutex residencyLock_;
+
+  /// Mutex for asyncLoads_.
+  std::mutex asyncLoadsLock_;
+
+  /// Signaled when asyncLoads_ drops to zero.
+  std::condition_variable asyncLoadsDone_;
+
+  /// \returns whether \p name is the name of a network, of a network being
+  /// added, or of the function of a network, which may differ from the name
+  /// of the network after swapNetwork. This must be called while holding a
+  /// lock on networkLock_.
+  bool isNameUsed(llvm::StringRef name) const;
+
+  /// Run \p work in the background. \returns the future of the Error it
+  /// returns. clearHost waits for the work to finish.
+  std::future<Error> runAsync(std::function<Error()> work);
+
+  /// \returns whether planPlacement places the replicas of \p network,
+  /// named \p name: a network of a single partition, which isn't batched
+  /// and has no batch variants, whose devices can load more replicas of it.
+  /// This must be called while holding a lock on networkLock_.
+  bool canPlaceReplicas(llvm::StringRef name, const NetworkData &network);
+
+  /// Move the replicas of the network \p networkName to \p deviceIDs, the
+  /// way swapNetwork replaces a network: a copy of the network with the new
+  /// replicas is published, and the replicas that aren't kept are evicted
+  /// once the runs of the old network finished. The devices which fail to
+  /// load a replica are skipped. \returns whether the replicas moved.
+  Expected<bool> moveReplicas(const std::string &networkName,
+                              llvm::ArrayRef<DeviceIDTy> deviceIDs);
+
+  /// The work of swapNetwork, run in the background.
+  Error swapNetworkImpl(const std::string &networkName,
+                        std::unique_ptr<Module> module,
+                        CompilationContext &cctx);
+
+  /// Evict the partitions of \p network from the devices and the
+  /// Provisioner, and remove its DAG from the executor. There must be no
+  /// runs of \p network.
+  Error evictNetwork(NetworkData &network);
+
+  /// Evict the partitions of \p network from the devices, or only from
+  /// \p devices if given, keeping their compiled functions in the
+  /// Provisioner.
+  Error evictPartitions(NetworkData &network,
+                        const std::set<DeviceIDTy> *devices = nullptr);
+
+  /// Evict from their devices the partitions of the least recently run
+  /// network, other than \p keep, that is resident and has no runs. Its
+  /// compiled functions stay on the host for its next run to reload it.
+  /// \returns false if there is no such network. This must be called while
+  /// holding a lock on residencyLock_ but not on networkLock_.
+  bool evictLRUNetwork(const NetworkData *keep);
+
+  /// Add the partitions of the evicted \p network back to their devices,
+  /// evicting other networks while they don't fit. This must be called while
+  /// holding a lock on residencyLock_ but not on networkLock_.
+  Error reloadNetwork(NetworkData &network);
+
+  /// Warm up \p dag, whose partitions were just provisioned, as \p opts
+  /// asks. The failures are logged, the network can be run anyway.
+  void warmUpNetwork(DAG &dag, const WarmupOptions &opts);
+
+  /// Replace publishedNetworks_ with a copy of networks_. This must be called
+  /// while holding a lock on networkLock_.
+  void publishNetworks();
+
+  /// Increment activeRequestCount_ unless it reached activeRequestLimit_.
+  /// \returns whether it was incremented.
+  bool claimActiveRequest();
+
+  /// Decrement activeRequestCount_ if it is over activeRequestLimit_, after
+  /// the limit was lowered, instead of running a queued request in the slot
+  /// of a request that completed. \returns whether it was decremented.
+  bool releaseExcessRequest();
+
+  /// Count a run that completed in \p latency from its dispatch toward the
+  /// window of the adaptive limit, adjusting the limit at the end of the
+  /// window.
+  void recordConcurrencySample(std::chrono::microseconds latency);
+
+  /// Queue \p request, whose deadline and priority are set. \returns false,
+  /// leaving \p request untouched, if the queue of the request is full.
+  bool queueRequest(InferRequest &&request);
+
+  /// \returns the next queued request to run after removing it from its
+  /// queue: the request with the earliest deadline, else the request of the
+  /// highest priority, or None if no request is queued.
+  llvm::Optional<InferRequest> popRequest();
+
+  /// \returns the next request to dispatch among the requests of the tenants
+  /// that didn't reach their quotas and the requests of inferQueue_, by
+  /// weighted fair queuing, or None if there is none.
+  llvm::Optional<InferRequest> popFairRequest();
+
+  /// \returns whether a tenant that didn't reach its quota has queued
+  /// requests.
+  bool hasRunnableTenantRequest();
+
+  /// Release the quota taken by a dispatched request of \p tenant, if it
+  /// isn't null.
+  void releaseTenant(TenantData *tenant);
+
+  /// Fail \p request, which can't finish by its deadline, and release its
+  /// network.
+  void failDeadline(InferRequest &request);
+
+  /// Call the callback of \p completion, on a completion thread if there
+  /// are some and the queue of results isn't full.
+  void complete(Completion completion);
+
+  /// Call the callback of \p completion and record its latency.
+  static void callCompletion(Completion &completion);
+
+  /// Main loop of the completion threads.
+  void runCompletions();
+
+  /// Stop the completion threads once they called the callbacks of the
+  /// results that are left.
+  void stopCompletions();
+
+  /// Fail \p request, which was cancelled by its client, and release its
+  /// network.
+  void failCancelled(InferRequest &request);
+
+  /// Method to dispatch a new run to the executor, on behalf of a caller
+  /// that claimed an active request. Releases the claim if the queue is
+  /// empty.
   void dispatchNextRun();
 
+  /// Body of the thread of \p batching, which waits for full batches or for
+  /// the oldest request to time out, and dispatches the batches.
+  void runBatching(BatchingData *batching);
+
+  /// Concatenate the inputs of \p requests, run them as one request of the
+  /// batched network of \p batching, and split the results back to the
+  /// callbacks of the requests.
+  void dispatchBatch(BatchingData *batching,
+                     std::vector<InferRequest> requests);
+
   /// Method to calculate and export aggregate memory usage counters.
   void exportMemoryCounters();
 
@@ -166,6 +733,31 @@ public:
   Error addNetwork(std::unique_ptr<Module> module, CompilationContext &cctx,
                    bool saturateHost = false);
 
+  /// Like addNetwork, except that the network is partitioned, compiled and
+  /// provisioned in the background, so that the caller isn't blocked.
+  /// \returns a future of the Error addNetwork returns. The network is run
+  /// by runNetwork once the future is ready.
+  std::future<Error> addNetworkAsync(std::unique_ptr<Module> module,
+                                     CompilationContext cctx,
+                                     bool saturateHost = false);
+
+  /// Replace the network \p networkName by the single function of \p module
+  /// without any time during which runNetwork doesn't find \p networkName.
+  /// The function is added in the background like with addNetworkAsync,
+  /// under its own name, which must not be used by any other network.
+  /// runNetwork calls for \p networkName then atomically switch to the new
+  /// version, while the runs of the old version that already started
+  /// finish. The old version is evicted after the last of them. The
+  /// requests find the placeholders of the new version by name, which is why
+  /// both versions should have the same placeholders. Networks that are
+  /// batched, or that other networks are batched with, and networks that
+  /// have batch variants or are one, see addBatchVariant, can't be swapped.
+  /// \returns a future of the Error of the operation, which is ready once
+  /// the old version has been evicted.
+  std::future<Error> swapNetwork(llvm::StringRef networkName,
+                                 std::unique_ptr<Module> module,
+                                 CompilationContext cctx);
+
   /// Given \p networkName removes that network from the host. This also
   /// removes the network from any backends setup to execute it.
   /// \returns an Error indicating success or failure of the operation.
@@ -174,22 +766,121 @@ public:
   /// Returns true if \p networkName is already added to the host.
   bool networkAdded(llvm::StringRef networkName);
 
+  /// Enable the dynamic batching of the requests of \p networkName, as
+  /// described by \p config. Requests passed to runNetwork are then collected
+  /// until there are config.maxBatchSize of them or the oldest one waited
+  /// config.maxWait. Their placeholders are concatenated along their first
+  /// dimension, padded with zeros up to config.maxBatchSize requests, and run
+  /// with config.batchedNetworkName, which must have been added too. Every
+  /// placeholder bound by a request is copied back from the results of the
+  /// batch. \returns an Error if the placeholders of the two networks don't
+  /// match.
+  Error enableBatching(llvm::StringRef networkName,
+                       const BatchingConfig &config);
+
+  /// Cache the results of the runs of \p networkName, as described by
+  /// \p config. A request whose inputs are those of a cached run is then
+  /// served from the copies of its outputs and doesn't run on a device. The
+  /// requests are looked up by a hash of the bytes of their inputs, and
+  /// only the requests which bind all the inputs of the network are cached.
+  /// The network must compute its outputs from its inputs alone. The hits
+  /// and misses are exported as the counters "glow.result_cache.hits" and
+  /// "glow.result_cache.misses", and the hit rate of the network in percent
+  /// as "glow.result_cache.<name>.hit_rate_pct". The cache is dropped when
+  /// the network is swapped. \returns an Error if the network isn't found or
+  /// writes a placeholder that it reads.
+  Error enableResultCache(llvm::StringRef networkName,
+                          const ResultCacheConfig &config);
+
+  /// Make runNetwork run the network \p variantName, which must have been
+  /// added too, instead of \p networkName for the requests whose batch size
+  /// is the one of \p variantName. The placeholders of the two networks must
+  /// have the same names and types, except that their first dimension is the
+  /// batch size, so that a network compiled for each batch size serves the
+  /// requests of that size. The batch size of a request is the first
+  /// dimension of the tensor it binds to the first placeholder of
+  /// \p networkName, and the requests of the other sizes run
+  /// \p networkName. Networks that are batched, see enableBatching, can't
+  /// have variants. \returns an Error if the networks aren't found or their
+  /// placeholders don't match.
+  Error addBatchVariant(llvm::StringRef networkName,
+                        llvm::StringRef variantName);
+
+  /// Add the tenant described by \p config. The requests of the networks
+  /// given to the tenant by setTenant are queued apart from the others: at
+  /// most config.maxActiveRequests of them run at once and at most
+  /// config.maxQueueSize of them are queued, and the tenants get shares of the
+  /// dispatches weighted by their config.weight while several of them have
+  /// queued requests. The depths of the queues and the numbers of running
+  /// requests of the tenants are exported as the counters
+  /// "glow.tenant.<name>.queue_depth" and
+  /// "glow.tenant.<name>.active_requests". \returns an Error if there is
+  /// already a tenant of that name.
+  Error addTenant(const TenantConfig &config);
+
+  /// Give the network \p networkName to the tenant \p tenantName, the next
+  /// requests of the network count against the quotas of the tenant.
+  /// \returns an Error if the network or the tenant isn't found.
+  Error setTenant(llvm::StringRef networkName, llvm::StringRef tenantName);
+
+  /// Set the requests per second \p networkName should serve to \p qps, for
+  /// planPlacement. Zero plans for the observed rate of the requests instead.
+  /// \returns an Error if the network isn't found.
+  Error setTargetQPS(llvm::StringRef networkName, double qps);
+
+  /// \returns the replicas of the networks on the devices which serve the
+  /// most requests, see glow::planPlacement, with the IDs of the devices.
+  /// A network is planned for its target, see setTargetQPS, or else for the
+  /// rate of its requests since the last plan, and a replica serves the
+  /// requests its observed run time allows, or the ones the costs of its
+  /// nodes allow until it ran. Only the networks of a single partition which
+  /// aren't batched and have no batch variants are planned, the others keep
+  /// their devices. Calling it and applyPlacement periodically re-plans the
+  /// replicas as the traffic shifts, unlike the fixed duplication of
+  /// saturateHost. \returns an Error if a network doesn't fit.
+  Expected<PlacementPlan> planPlacement();
+
+  /// Move the replicas of the networks to the devices of \p plan, which
+  /// planPlacement returned. The networks losing replicas move first, to
+  /// free memory for the others. Like with swapNetwork, runNetwork keeps
+  /// finding the networks while they move. The networks whose compiled
+  /// functions don't hold their constants, which only the stripped module
+  /// had, and the networks of hosts with HostConfig::evictLRUNetworks keep
+  /// their devices. \returns the number of networks moved.
+  Expected<unsigned> applyPlacement(const PlacementPlan &plan);
+
   /// Removes all networks from the host, and stops execution on all devices.
   Error clearHost();
 
+  /// \returns the number of requests that may run at once, which
+  /// HostConfig::adaptiveConcurrency adjusts to the latency of the runs.
+  size_t getActiveRequestLimit() const { return activeRequestLimit_; }
+
   /// Runs the network specified by \p networkName using
   /// the provided \p context, returns a runIdentifier which refers to the
   /// specic inference request. Calls \p callback with the results when
   /// inference is done.
   /// Note: This method is intended to be thread-safe, it will be called
-  /// concurrently from multiple threads.
+  /// concurrently from multiple threads, and takes no lock.
   /// Returns -1 if networkName not found or too many active requests.
   /// The parameter \p priority is used to indicate queueing priority, priority
   /// is lowest number first and in case of a tie the request that was submitted
-  /// first will go first.
-  RunIdentifierTy runNetwork(llvm::StringRef networkName,
-                             std::unique_ptr<ExecutionContext> context,
-                             ResultCBTy callback, uint64_t priority = 0);
+  /// first will go first. Priorities from config_.numPriorities - 1 on are
+  /// queued as equal.
+  /// If \p deadline is given, the run must finish by it: requests with a
+  /// deadline run before the others, earliest deadline first, and a request
+  /// is failed with RUNTIME_DEADLINE_EXCEEDED instead of being run when the
+  /// observed run times of the network say that it would finish late. The
+  /// deadline of \p context is used instead if it is earlier, and the
+  /// executor and the devices also drop the run once it passed. A
+  /// request whose context is cancelled, see CancellationToken, is failed
+  /// with RUNTIME_REQUEST_CANCELLED instead of being dispatched.
+  RunIdentifierTy
+  runNetwork(llvm::StringRef networkName,
+             std::unique_ptr<ExecutionContext> context, ResultCBTy callback,
+             uint64_t priority = 0,
+             std::chrono::steady_clock::time_point deadline =
+                 std::chrono::steady_clock::time_point::max());
 
   /// A wrapper around runNetwork that provides a blocking interface for an
   /// inference request. Runs the network provided in \p networkName using \p
@@ -204,6 +895,36 @@ public:
   Error runNetworkBlocking(llvm::StringRef networkName,
                            PlaceholderBindings &bindings);
 
+  /// \returns the allocator of the host memory of the device \p deviceID,
+  /// see DeviceManager::getHostMemoryAllocator. The tensors allocated from it
+  /// are transferred without staging to that device, and as usual to the
+  /// other ones. \returns an Error if there is no such device.
+  Expected<HostMemoryAllocator *>
+  getHostMemoryAllocator(DeviceIDTy deviceID = 0);
+
+  /// \returns the memory of every device, with the constants, activations
+  /// and IO of each function on it and how fragmented its free memory is.
+  /// Safe to call concurrently with runNetwork.
+  std::map<DeviceIDTy, DeviceMemoryUsage> getDeviceMemoryUsage() const;
+
+  /// \returns the module holding the placeholders of \p networkName, or an
+  /// Error if the network isn't found. The module stays valid while it is
+  /// held, even once the network is removed. Safe to call concurrently with
+  /// runNetwork.
+  Expected<std::shared_ptr<Module>>
+  getNetworkModule(llvm::StringRef networkName);
+
+  /// \returns a request of \p networkName whose context and tensors are
+  /// allocated once, to be run many times with runNetwork. \returns an Error
+  /// if the network isn't found.
+  Expected<std::unique_ptr<PreparedRequest>>
+  prepareRequest(llvm::StringRef networkName);
+
+  /// A wrapper around runNetwork that provides a blocking interface for the
+  /// prepared \p request, which gets its context back once the run is done.
+  /// \returns an Error indicating success or failure.
+  Error runNetworkBlocking(PreparedRequest &request);
+
   /// Initialize the HostManager with the given \p configs creating one
   /// DeviceManager for each config listed.
   Error init(std::vector<std::unique_ptr<DeviceConfig>> configs);
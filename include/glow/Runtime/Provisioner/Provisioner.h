@@ -20,6 +20,7 @@
 #include "glow/Backends/DeviceManager.h"
 #include "glow/Runtime/RuntimeTypes.h"
 #include "glow/Support/Error.h"
+#include "glow/Support/ThreadPool.h"
 
 #include <map>
 
@@ -31,7 +32,10 @@ namespace runtime {
 /// device.
 class Provisioner final {
 public:
-  Provisioner(DeviceManagerMapTy &devices);
+  /// Create a Provisioner for \p devices that compiles the partitions of a
+  /// network on \p compileThreads threads at once. The partitions are compiled
+  /// one after another when \p compileThreads is at most one.
+  Provisioner(DeviceManagerMapTy &devices, unsigned compileThreads = 0);
 
   /// Traverses the DAG \p networks and:
   ///   1. Retrieves each node's Function from the provided \p module.
@@ -41,6 +45,10 @@ public:
   Error provision(DAGListTy &networks, Module &module,
                   CompilationContext &cctx);
 
+  /// \returns the compiled function \p name, which stays owned by the
+  /// Provisioner until removeFunction is called, or null if there is none.
+  CompiledFunction *getFunction(llvm::StringRef name);
+
   /// Remove stored compiledFunction.
   Error removeFunction(llvm::StringRef name);
 
@@ -64,6 +72,10 @@ private:
   /// List of available DeviceManagers added during initialization.
   std::vector<DeviceManager *> devices_;
 
+  /// Pool of the threads the partitions are compiled on, or nullptr if they
+  /// are compiled on the thread calling provision.
+  std::unique_ptr<ThreadPool> compilePool_;
+
   /// Helper function to cleanup a provision call. On a success free resources
   /// that are no longer needed by the compiledFunctions. On failure free the
   /// compiledFunctions that were created.
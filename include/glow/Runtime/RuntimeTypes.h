@@ -22,6 +22,8 @@
 #include "glow/Graph/Graph.h"
 #include "glow/Support/Error.h"
 
+#include <atomic>
+#include <chrono>
 #include <map>
 #include <string>
 #include <unordered_map>
@@ -60,8 +62,8 @@ struct DeviceInfo {
   /// ",". E.g. "Div,Add". In Partitioner, the complementary set of those nodes
   /// won't be supported in this backend.
   std::string supportedNodes;
-  /// Available SRAM capacity in bytes.
-  uint64_t sramCapacity;
+  /// Available SRAM capacity in bytes, none if it is zero.
+  uint64_t sramCapacity{0};
   /// Peak compute on device in ops/second. Assumes all ops are in int8.
   /// TODO: distinguish between data types with different peak flops.
   float peakCompute;
@@ -91,8 +93,9 @@ struct DAGNode {
   /// indicates the network should be duplicated.
   std::vector<DeviceIDTy> logicalDevices;
   /// Index of the current deviceID in deviceIDs. This is used by the Executor
-  /// when picking a device to request a network run.
-  unsigned currentDeviceIdx{0};
+  /// when picking a device to request a network run. Atomic since runs of the
+  /// node pick devices concurrently.
+  std::atomic<unsigned> currentDeviceIdx{0};
   /// Name assigned to the sub-network, this is the id that will be passed to
   /// the DeviceManager when requesting a run of the network.
   std::string name;
@@ -109,9 +112,15 @@ struct DAGNode {
   /// access the associated PHs for the function that are stored in the Module.
   Module *module{nullptr};
 
+  /// Name of the placeholder predicating the node, or empty if the node
+  /// always runs. The placeholder must be an input of the network or an
+  /// output of an ancestor of the node. The node is skipped when all the
+  /// bytes of the first element of the placeholder are zero, and its outputs
+  /// are zeros.
+  std::string predicate;
+
   DeviceIDTy getNextDevice() {
-    currentDeviceIdx++;
-    return deviceIDs[currentDeviceIdx % deviceIDs.size()];
+    return deviceIDs[++currentDeviceIdx % deviceIDs.size()];
   }
 };
 
@@ -168,17 +177,145 @@ struct DeviceConfig {
   uint64_t getDeviceMemory(uint64_t defaultMemory) const {
     return deviceMemory == 0 ? defaultMemory : deviceMemory;
   }
+
+  /// \returns the NUMA node of the host the device is attached to, given by
+  /// the "numaNode" parameter, or -1 if it isn't given.
+  int getNumaNode() const {
+    auto it = parameters.find("numaNode");
+    unsigned node;
+    if (it == parameters.end() ||
+        llvm::StringRef(it->second).getAsInteger(10, node)) {
+      return -1;
+    }
+    return node;
+  }
 };
 
 /// Options configuring Host components of the Runtime, such as the Partitioner
 /// and Executor.
+/// Configuration of the hedging of the partitions that run on several
+/// devices, e.g. the ones of the networks added with saturateHost. A run of
+/// such a partition that takes longer than the given percentile of the
+/// recent runs of the partition is duplicated on another of its devices, and
+/// the first attempt to finish wins. The attempts run on copies of the
+/// inputs and outputs of the partition, which the winner's outputs are
+/// copied back from, so that the loser can be ignored.
+struct HedgingConfig {
+  /// Percentile, in (0, 1], of the latencies of a partition after which a
+  /// run is hedged, e.g. 0.99. Zero disables hedging.
+  double percentile{0};
+  /// Maximum fraction of the runs of the partitions that may be hedged.
+  double budget{0.05};
+};
+
+/// Configuration of the adaptive limit of the requests that a HostManager
+/// runs at once, which adjusts the limit to the load by additive increase
+/// and multiplicative decrease. Past the limit, requests wait in the queue of
+/// the HostManager, while the requests over the limit that are running wait
+/// in the queues of the executor and of the devices, which inflates their
+/// latency. After every window of as many runs as the limit, the limit is
+/// multiplied by backoff if the average latency of the runs, from their
+/// dispatch to their completion, exceeded latencyTarget, or else incremented
+/// if some requests were held back by it.
+struct AdaptiveConcurrencyConfig {
+  /// Latency of the runs, from their dispatch to their completion, that the
+  /// limit is adjusted to. Zero disables the adaptive limit.
+  std::chrono::microseconds latencyTarget{0};
+  /// Lower bound of the limit. HostConfig::maxActiveRequests is its upper
+  /// bound and its initial value.
+  size_t minActiveRequests{1};
+  /// Factor, in (0, 1), the limit is multiplied by when the runs of a window
+  /// were slower than latencyTarget.
+  double backoff{0.75};
+};
+
 struct HostConfig {
-  /// Number of outstanding or concurrent networks before queueing.
+  /// Number of outstanding or concurrent networks before queueing. This is
+  /// the upper bound of the limit when adaptiveConcurrency is enabled.
   size_t maxActiveRequests{10};
   /// Number of requests to queue up before refusing further requests.
   size_t maxQueueSize{100};
+  /// Number of distinct priorities of queued requests. Requests with a larger
+  /// priority are queued as the lowest priority.
+  size_t numPriorities{8};
   /// Number of threads to allocate to the Executor.
   size_t executorThreads{3};
+  /// Number of requests a partition of a network may run at once when the
+  /// Executor pipelines the partitions of networks across devices. While a
+  /// device runs a partition for a request, the devices of the partitions
+  /// before it run the next requests. Zero disables pipelining.
+  size_t executorPipelineDepth{0};
+  /// Number of threads the Provisioner compiles the partitions of a network
+  /// on. Adding a network then takes about as long as compiling its largest
+  /// partition rather than all of them. At most one compiles the partitions
+  /// one after another on the thread adding the network.
+  size_t compileThreads{0};
+  /// One in this many requests exports the latency of the stages of its run
+  /// (queueing, executor, device queueing, copies, kernel and callback) to
+  /// the StatsExporterRegistry, as the time series
+  /// "glow.latency.<stage>.<name>", see ExecutionContext::setStatsSampled.
+  /// Zero samples only the requests whose context is already sampled.
+  size_t latencyStatsSampleInterval{0};
+  /// One in this many requests that have no TraceContext is traced at the
+  /// runtime level into the process-wide TraceRecorder, which keeps the cost
+  /// of tracing low enough for production traffic. Zero traces no request.
+  size_t traceSampleInterval{0};
+  /// Whether networks are evicted from their devices, least recently run
+  /// first, when a network that is added or reloaded doesn't fit. Evicted
+  /// networks keep their compiled functions and constants on the host, and
+  /// are reloaded onto their devices by their next run. The reload latency
+  /// is exported as the time series "glow.networks.reload_us".
+  bool evictLRUNetworks{false};
+  /// Hedging of the partitions that run on several devices by the Executor.
+  HedgingConfig hedging;
+  /// Number of threads that call the callbacks of the requests. The results
+  /// are handed off to them through a lock-free queue, so that a slow
+  /// callback doesn't hold up the threads of the executor, which go on with
+  /// the next requests. Zero calls the callbacks on the executor threads.
+  size_t completionThreads{0};
+  /// Adaptive limit of the requests that run at once.
+  AdaptiveConcurrencyConfig adaptiveConcurrency;
+};
+
+/// Configuration of the dynamic batching of the requests of a network, see
+/// HostManager::enableBatching.
+struct BatchingConfig {
+  /// Name of the network that runs the batches. Its placeholders have the
+  /// same names and types as those of the batched network, except that their
+  /// first dimension is maxBatchSize times larger.
+  std::string batchedNetworkName;
+  /// Maximum number of requests concatenated into one batch.
+  size_t maxBatchSize{8};
+  /// Maximum time a request waits for more requests to fill its batch.
+  std::chrono::microseconds maxWait{2000};
+};
+
+/// Configuration of the cache of the results of a network, see
+/// HostManager::enableResultCache.
+struct ResultCacheConfig {
+  /// Maximum bytes of the inputs and outputs of the cached runs, beyond which
+  /// the least recently used runs are dropped.
+  size_t maxBytes{64 << 20};
+  /// Time after which a cached run is dropped.
+  std::chrono::milliseconds ttl{60000};
+};
+
+/// Configuration of a tenant of a HostManager, a group of networks whose
+/// requests share quotas and a share of the dispatches, see
+/// HostManager::addTenant.
+struct TenantConfig {
+  /// Name of the tenant.
+  std::string name;
+  /// Maximum number of requests of the tenant that run at once, or zero for
+  /// no limit but HostConfig::maxActiveRequests.
+  size_t maxActiveRequests{0};
+  /// Maximum number of queued requests of the tenant, or zero for
+  /// HostConfig::maxQueueSize.
+  size_t maxQueueSize{0};
+  /// Share of the dispatches the tenant gets while the requests of several
+  /// tenants are queued, relative to the weights of the other tenants. The
+  /// requests of the networks without a tenant have a weight of 1.
+  unsigned weight{1};
 };
 
 /// This is struct for user defined partition.
@@ -200,6 +337,15 @@ struct PartitionConfig {
   /// name in Glow function and may be different from the original name from
   /// models. Since Glow will mangle names to make them unique.
   llvm::StringMap<size_t> nodeToPartition;
+  /// The name of the placeholder predicating each partition, see
+  /// DAGNode::predicate. An empty name, or an empty vector, means the
+  /// partition always runs. Otherwise partitionPredicates.size() ==
+  /// numOfPartitions.
+  std::vector<std::string> partitionPredicates;
+  /// The logical devices of each partition, see DAGNode::logicalDevices. An
+  /// empty vector means they are assigned by the Partitioner. Otherwise
+  /// logicalIDs.size() == numOfPartitions.
+  std::vector<std::vector<DeviceIDTy>> logicalIDs;
 
   PartitionConfig() : numOfPartitions(0) {}
   bool enabled() { return numOfPartitions > 0; }
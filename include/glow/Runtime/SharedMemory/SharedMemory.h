@@ -0,0 +1,149 @@
+/**
+ * Copyright (c) Glow Contributors. See CONTRIBUTORS file.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef GLOW_RUNTIME_SHAREDMEMORY_SHAREDMEMORY_H
+#define GLOW_RUNTIME_SHAREDMEMORY_SHAREDMEMORY_H
+
+#include "glow/Runtime/HostManager/HostManager.h"
+#include "glow/Support/Error.h"
+
+#include "llvm/ADT/StringRef.h"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace glow {
+namespace runtime {
+
+namespace shm {
+struct SegmentHeader;
+struct Slot;
+} // namespace shm
+
+/// Configuration of the shared memory segment of a SharedMemoryServer.
+struct SharedMemoryConfig {
+  /// The POSIX name of the segment, e.g. "/glow", which the clients connect
+  /// to.
+  std::string name;
+
+  /// The number of requests the clients may have at the same time.
+  unsigned numSlots{16};
+
+  /// The bytes of the tensors of every request.
+  size_t slotBytes{1 << 20};
+};
+
+/// Serves the networks of a HostManager to other processes through a POSIX
+/// shared memory segment, so that one copy of the networks and of their
+/// weights serves all the processes. The segment holds a ring of submitted
+/// requests and a slot per request, whose tensors the clients write and read
+/// in place: the tensors of the runs are bound to the shared memory and
+/// nothing is serialized or copied. Only supported on Linux.
+class SharedMemoryServer final {
+  HostManager &hostManager_;
+
+  /// The name, the size and the mapping of the segment.
+  std::string name_;
+  size_t size_{0};
+  char *base_{nullptr};
+  shm::SegmentHeader *header_{nullptr};
+
+  /// The thread popping the submitted requests and running them.
+  std::thread dispatcher_;
+  std::atomic<bool> stop_{false};
+
+  /// The number of requests which were run and haven't completed.
+  std::atomic<unsigned> inflight_{0};
+
+  SharedMemoryServer(HostManager &hostManager, llvm::StringRef name)
+      : hostManager_(hostManager), name_(name) {}
+
+  /// Creates and maps the segment of \p config.
+  Error init(const SharedMemoryConfig &config);
+
+  /// Pops and runs the submitted requests until the server is destroyed.
+  void dispatch();
+
+  /// Runs the request of the slot \p index.
+  void runSlot(unsigned index);
+
+  /// Writes \p err into the slot \p index and wakes up its client.
+  void respond(unsigned index, Error err);
+
+public:
+  /// Creates the segment of \p config and starts serving the networks of
+  /// \p hostManager, which must outlive the server. \returns an Error if the
+  /// segment exists or can't be created.
+  static Expected<std::unique_ptr<SharedMemoryServer>>
+  create(HostManager &hostManager, const SharedMemoryConfig &config);
+
+  /// Waits for the running requests and removes the segment.
+  ~SharedMemoryServer();
+};
+
+/// Submits requests to a SharedMemoryServer of another process, or of the
+/// same one.
+class SharedMemoryClient final {
+  size_t size_{0};
+  char *base_{nullptr};
+  shm::SegmentHeader *header_{nullptr};
+
+  SharedMemoryClient() = default;
+
+public:
+  /// A request for a network, which holds a slot of the segment until it is
+  /// destroyed, and may be run many times. Its tensors are in the shared
+  /// memory: the client writes the inputs and reads the outputs in place.
+  class Request final {
+    friend class SharedMemoryClient;
+    shm::Slot *slot_;
+    /// The tensors of the slot, and their bytes.
+    char *data_;
+    size_t capacity_;
+
+    Request(shm::Slot *slot, char *data, size_t capacity)
+        : slot_(slot), data_(data), capacity_(capacity) {}
+
+  public:
+    ~Request();
+
+    /// Binds \p size bytes of the slot to the placeholder \p name, for its
+    /// input or its output. \returns the bytes, which must be as many as the
+    /// placeholder has, or an Error if the slot is full. The placeholders
+    /// that aren't added are zeros.
+    Expected<void *> addTensor(llvm::StringRef name, size_t size);
+  };
+
+  /// Maps the segment \p name of a server. \returns an Error if the segment
+  /// doesn't exist or wasn't created by a server of this version.
+  static Expected<std::unique_ptr<SharedMemoryClient>>
+  connect(llvm::StringRef name);
+
+  ~SharedMemoryClient();
+
+  /// \returns a request for \p networkName, or an Error if all the slots are
+  /// held. The request must be destroyed before the client.
+  Expected<std::unique_ptr<Request>> createRequest(llvm::StringRef networkName);
+
+  /// Runs \p request and waits for it. \returns the Error of the run.
+  Error run(Request &request);
+};
+
+} // namespace runtime
+} // namespace glow
+
+#endif // GLOW_RUNTIME_SHAREDMEMORY_SHAREDMEMORY_H
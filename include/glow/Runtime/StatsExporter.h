@@ -18,6 +18,7 @@
 
 #include "llvm/ADT/StringRef.h"
 
+#include <chrono>
 #include <vector>
 
 namespace glow {
@@ -51,6 +52,12 @@ public:
   /// Set a counter for all registered StatsExporters.
   void setCounter(llvm::StringRef key, int64_t value);
 
+  /// Add the microseconds elapsed since \p start to the time series
+  /// "glow.latency.<stage>.<name>" of the latency of \p stage of the network
+  /// or function \p name, for all registered StatsExporters.
+  void addLatencyValue(llvm::StringRef stage, llvm::StringRef name,
+                       std::chrono::steady_clock::time_point start);
+
   /// Register a StatsExporter.
   void registerStatsExporter(StatsExporter *exporter);
 
@@ -248,6 +248,8 @@ public:
     MODEL_LOADER_UNSUPPORTED_ONNX_VERSION,
     // Model loader encountered an invalid protobuf.
     MODEL_LOADER_INVALID_PROTOBUF,
+    // Model loader encountered an invalid serialized Module.
+    MODEL_LOADER_INVALID_MODULE,
     // Partitioner error.
     PARTITIONER_ERROR,
     // Runtime error, out of device memory.
@@ -262,6 +264,10 @@ public:
     RUNTIME_DEVICE_NOT_FOUND,
     // Runtime error, network busy to perform any operation on it.
     RUNTIME_NET_BUSY,
+    // Runtime error, request can't finish by its deadline.
+    RUNTIME_DEADLINE_EXCEEDED,
+    // Runtime error, request was cancelled by its client.
+    RUNTIME_REQUEST_CANCELLED,
     // Compilation error; node unsupported after optimizations.
     COMPILE_UNSUPPORTED_NODE_AFTER_OPTIMIZE,
     // Compilation error; Compilation context not correctly setup.
@@ -291,6 +297,9 @@ public:
 
   std::string logToString() const;
 
+  /// \returns the error code of the ErrorValue.
+  ErrorCode getErrorCode() const { return ec_; }
+
   GlowErrorValue(const char *fileName, size_t lineNumber, std::string message,
                  ErrorCode ec)
       : lineNumber_(lineNumber), fileName_(fileName), message_(message),
@@ -420,6 +429,13 @@ public:
   GlowError(const GlowError &) = delete;
   GlowError &operator=(const GlowError &) = delete;
 
+  /// \returns true if an ErrorValue with the error code \p ec is contained.
+  /// This doesn't mark the Error as checked, so that it may still be handled
+  /// or returned.
+  bool hasErrorCode(GlowErrorValue::ErrorCode ec) const {
+    return hasErrorValue() && errorValue_->getErrorCode() == ec;
+  }
+
   /// Overload of operator bool() that \returns true if no ErrorValue is
   /// contained contained.
   /// NOTE: This marks the Error as checked only if an ErrorValue is contained.
@@ -18,6 +18,7 @@
 
 #include "fp16.h"
 
+#include <cstddef>
 #include <cstdint>
 #include <iostream>
 
@@ -75,6 +76,15 @@ inline std::ostream &operator<<(std::ostream &os, const float16 &b) {
   return os;
 }
 
+/// Converts the \p n floats of \p src to float16 into \p dst. The conversions
+/// of the whole arrays use the F16C instructions when they are enabled at
+/// compile time, e.g. by -march=native, and several threads for large arrays.
+void convertFloatToFloat16(const float *src, float16 *dst, size_t n);
+
+/// Converts the \p n float16 of \p src to float into \p dst, like
+/// convertFloatToFloat16.
+void convertFloat16ToFloat(const float16 *src, float *dst, size_t n);
+
 } // End namespace glow.
 
 #endif // GLOW_SUPPORT_FLOAT16_H
@@ -0,0 +1,82 @@
+/**
+ * Copyright (c) Glow Contributors. See CONTRIBUTORS file.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef GLOW_SUPPORT_HOSTMEMORY_H
+#define GLOW_SUPPORT_HOSTMEMORY_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+
+namespace glow {
+
+/// Allocates host buffers that a device transfers to and from without
+/// staging them, e.g. because they are pinned or registered with its driver.
+/// Tensors whose payloads are allocated here, e.g. by a TensorPool, are
+/// copied to the device directly, where pageable memory is first copied into
+/// staging memory by the backend or its driver.
+class HostMemoryAllocator {
+public:
+  virtual ~HostMemoryAllocator() = default;
+
+  /// \returns \p bytes of memory aligned to TensorAlignment, or nullptr if no
+  /// more memory can be pinned, in which case the caller falls back to
+  /// pageable memory. May be called concurrently.
+  virtual void *allocate(size_t bytes) = 0;
+
+  /// Frees \p data of \p bytes bytes, which allocate() returned. May be
+  /// called concurrently.
+  virtual void deallocate(void *data, size_t bytes) = 0;
+
+  /// \returns whether the \p bytes at \p data are in a buffer allocated here,
+  /// so that they are transferred without staging. May be called
+  /// concurrently.
+  virtual bool contains(const void *data, size_t bytes) const = 0;
+};
+
+/// Allocates page-locked host memory, which the OS never pages out, so that
+/// drivers can set up DMA to it without faulting or locking the pages on
+/// every transfer. This is the pinned memory of the devices that don't
+/// register memory with their driver. The memory the OS lets a process lock
+/// is limited, see RLIMIT_MEMLOCK, past which allocate() returns nullptr.
+class PageLockedAllocator final : public HostMemoryAllocator {
+  /// The size of the buffers, by address.
+  std::map<uintptr_t, size_t> buffers_;
+  mutable std::mutex lock_;
+
+  /// The bytes which are locked.
+  std::atomic<uint64_t> lockedBytes_{0};
+
+public:
+  ~PageLockedAllocator() override;
+
+  void *allocate(size_t bytes) override;
+
+  void deallocate(void *data, size_t bytes) override;
+
+  bool contains(const void *data, size_t bytes) const override;
+
+  /// \returns the bytes which are locked, rounded up to whole pages.
+  uint64_t getLockedBytes() const { return lockedBytes_; }
+};
+
+/// \returns the allocator of page-locked memory shared by the whole process.
+PageLockedAllocator &getPageLockedAllocator();
+
+} // namespace glow
+
+#endif // GLOW_SUPPORT_HOSTMEMORY_H
@@ -0,0 +1,199 @@
+/**
+ * Copyright (c) Glow Contributors. See CONTRIBUTORS file.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef GLOW_SUPPORT_MPMCQUEUE_H
+#define GLOW_SUPPORT_MPMCQUEUE_H
+
+#include "llvm/ADT/Optional.h"
+#include "llvm/Support/MathExtras.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace glow {
+
+/// A bounded lock-free FIFO queue for multiple producers and consumers. Each
+/// slot of the ring buffer has a sequence number that tells producers and
+/// consumers whose turn it is to use it, so that neither ever waits on a lock.
+template <typename T> class MPMCQueue final {
+  /// A slot of the ring buffer.
+  struct Cell {
+    /// The position the cell can be pushed at, or the position it was pushed
+    /// at plus one once it holds a value.
+    std::atomic<size_t> sequence;
+    /// Storage of the value of the cell.
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+  };
+
+  /// Size of the padding that keeps the positions on separate cache lines.
+  static constexpr size_t kCacheLineSize = 64;
+
+  /// The ring buffer.
+  std::unique_ptr<Cell[]> cells_;
+
+  /// Number of cells minus one, the capacity is a power of two.
+  const size_t mask_;
+
+  /// The position of the next push.
+  alignas(kCacheLineSize) std::atomic<size_t> pushPos_{0};
+
+  /// The position of the next pop.
+  alignas(kCacheLineSize) std::atomic<size_t> popPos_{0};
+
+public:
+  /// Create a queue of at least \p capacity elements.
+  explicit MPMCQueue(size_t capacity)
+      : cells_(new Cell[llvm::PowerOf2Ceil(std::max<size_t>(capacity, 2))]),
+        mask_(llvm::PowerOf2Ceil(std::max<size_t>(capacity, 2)) - 1) {
+    for (size_t i = 0; i <= mask_; i++) {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  ~MPMCQueue() {
+    while (pop()) {
+    }
+  }
+
+  MPMCQueue(const MPMCQueue &) = delete;
+  MPMCQueue &operator=(const MPMCQueue &) = delete;
+
+  /// Move \p value to the back of the queue. \returns false, leaving \p value
+  /// untouched, if the queue is full.
+  bool push(T &&value) {
+    size_t pos = pushPos_.load(std::memory_order_relaxed);
+    Cell *cell;
+    while (true) {
+      cell = &cells_[pos & mask_];
+      size_t sequence = cell->sequence.load(std::memory_order_acquire);
+      auto diff = intptr_t(sequence) - intptr_t(pos);
+      if (diff == 0) {
+        if (pushPos_.compare_exchange_weak(pos, pos + 1,
+                                           std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = pushPos_.load(std::memory_order_relaxed);
+      }
+    }
+    new (&cell->storage) T(std::move(value));
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  /// \returns the front of the queue after removing it from the queue, or
+  /// None if the queue is empty.
+  llvm::Optional<T> pop() {
+    size_t pos = popPos_.load(std::memory_order_relaxed);
+    Cell *cell;
+    while (true) {
+      cell = &cells_[pos & mask_];
+      size_t sequence = cell->sequence.load(std::memory_order_acquire);
+      auto diff = intptr_t(sequence) - intptr_t(pos + 1);
+      if (diff == 0) {
+        if (popPos_.compare_exchange_weak(pos, pos + 1,
+                                          std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return llvm::None;
+      } else {
+        pos = popPos_.load(std::memory_order_relaxed);
+      }
+    }
+    T *value = reinterpret_cast<T *>(&cell->storage);
+    llvm::Optional<T> result(std::move(*value));
+    value->~T();
+    cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+    return result;
+  }
+};
+
+/// A bounded lock-free queue for multiple producers and consumers that pops
+/// its elements by priority, and in FIFO order among the elements of the same
+/// priority. There is one MPMCQueue per priority, a lower value is a higher
+/// priority, and the priorities past the last one are queued as the last one.
+template <typename T> class MPMCPriorityQueue final {
+  /// The queue of every priority, highest priority first.
+  std::vector<std::unique_ptr<MPMCQueue<T>>> queues_;
+
+  /// The number of elements that were pushed and not popped yet.
+  std::atomic<size_t> size_{0};
+
+  /// The maximum number of elements in the queue.
+  const size_t capacity_;
+
+public:
+  /// Create a queue of \p capacity elements with \p numPriorities priorities.
+  MPMCPriorityQueue(size_t capacity, size_t numPriorities)
+      : capacity_(capacity) {
+    assert(numPriorities > 0 && "The queue needs a priority");
+    for (size_t i = 0; i < numPriorities; i++) {
+      queues_.emplace_back(new MPMCQueue<T>(capacity));
+    }
+  }
+
+  /// Move \p value into the queue with priority \p priority. \returns false,
+  /// leaving \p value untouched, if the queue is full.
+  bool push(T &&value, uint64_t priority) {
+    // Reserve room for the value first, so that the queue of its priority
+    // can't be full.
+    size_t size = size_.load();
+    do {
+      if (size >= capacity_) {
+        return false;
+      }
+    } while (!size_.compare_exchange_weak(size, size + 1));
+    auto &queue = queues_[std::min<uint64_t>(priority, queues_.size() - 1)];
+    bool pushed = queue->push(std::move(value));
+    (void)pushed;
+    assert(pushed && "A reserved push can't fail");
+    return true;
+  }
+
+  /// \returns the element of the highest priority after removing it from the
+  /// queue, or None if the queue is empty. Elements whose push didn't return
+  /// yet may be missed.
+  llvm::Optional<T> pop() {
+    if (empty()) {
+      return llvm::None;
+    }
+    for (auto &queue : queues_) {
+      if (auto value = queue->pop()) {
+        size_--;
+        return value;
+      }
+    }
+    return llvm::None;
+  }
+
+  /// \returns the number of elements in the queue, which includes the
+  /// elements whose push didn't return yet.
+  size_t size() const { return size_.load(); }
+
+  /// \returns whether size() is zero.
+  bool empty() const { return size() == 0; }
+};
+
+} // namespace glow
+
+#endif // GLOW_SUPPORT_MPMCQUEUE_H
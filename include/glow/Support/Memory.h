@@ -22,6 +22,10 @@
 
 #include <cstdlib>
 
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
 namespace glow {
 
 /// The tensor payload is allocated to be aligned to this value.
@@ -42,12 +46,85 @@ inline void *alignedAlloc(size_t size, size_t align) {
 /// Free aligned memory.
 inline void alignedFree(void *p) { glow_aligned_free(p); }
 
+/// The size of the (transparent) huge pages requested by hugePageAlloc.
+constexpr size_t HugePageSize = 2 * 1024 * 1024;
+
+/// Allocate \p size bytes of memory aligned to HugePageSize and, where the OS
+/// supports it, ask for it to be backed by huge pages to reduce TLB misses.
+/// The memory must be released with alignedFree.
+inline void *hugePageAlloc(size_t size) {
+  void *ptr = alignedAlloc(size, HugePageSize);
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+  // This is only a hint, the memory is still usable if it is ignored.
+  (void)madvise(ptr, size, MADV_HUGEPAGE);
+#endif
+  return ptr;
+}
+
 /// Rounds up \p size to the nearest \p alignment.
 inline size_t alignedSize(size_t size, size_t alignment) {
   size_t mod = size % alignment;
   return mod ? size + alignment - mod : size;
 }
 
+/// The pages backing the memory allocated by hugePagesAlloc.
+enum class HugePages {
+  /// Regular pages.
+  None,
+  /// Transparent huge pages, see hugePageAlloc.
+  Transparent,
+  /// Pages of the 2MB or the 1GB hugetlbfs pool the OS reserved, e.g. with
+  /// /proc/sys/vm/nr_hugepages, which are never swapped or split.
+  HugeTLB2MB,
+  HugeTLB1GB,
+};
+
+/// Allocate \p size bytes of memory backed by \p pages, which is set to the
+/// pages that back it: 2MB pages if the OS can't select 1GB ones, and
+/// transparent huge pages if the hugetlbfs pool doesn't have enough pages or
+/// the OS doesn't support it. The memory is aligned to TensorAlignment and
+/// must be released with hugePagesFree.
+inline void *hugePagesAlloc(size_t size, HugePages &pages) {
+  if (pages == HugePages::None) {
+    return alignedAlloc(size, TensorAlignment);
+  }
+#if defined(__linux__) && defined(MAP_HUGETLB)
+  if (pages != HugePages::Transparent) {
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB;
+    size_t pageSize = HugePageSize;
+#ifdef MAP_HUGE_SHIFT
+    if (pages == HugePages::HugeTLB1GB) {
+      flags |= 30 << MAP_HUGE_SHIFT;
+      pageSize = size_t(1) << 30;
+    }
+#else
+    pages = HugePages::HugeTLB2MB;
+#endif
+    void *ptr = mmap(nullptr, alignedSize(size, pageSize),
+                     PROT_READ | PROT_WRITE, flags, -1, 0);
+    if (ptr != MAP_FAILED) {
+      return ptr;
+    }
+  }
+#endif
+  pages = HugePages::Transparent;
+  return hugePageAlloc(size);
+}
+
+/// Free the \p size bytes at \p ptr, which hugePagesAlloc allocated with
+/// \p pages.
+inline void hugePagesFree(void *ptr, size_t size, HugePages pages) {
+  if (pages == HugePages::None || pages == HugePages::Transparent) {
+    alignedFree(ptr);
+    return;
+  }
+#ifdef __linux__
+  size_t pageSize =
+      pages == HugePages::HugeTLB1GB ? size_t(1) << 30 : HugePageSize;
+  munmap(ptr, alignedSize(size, pageSize));
+#endif
+}
+
 } // end namespace glow
 
 #endif // GLOW_SUPPORT_MEMORY_H
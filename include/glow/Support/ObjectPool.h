@@ -0,0 +1,55 @@
+/**
+ * Copyright (c) Glow Contributors. See CONTRIBUTORS file.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef GLOW_SUPPORT_OBJECTPOOL_H
+#define GLOW_SUPPORT_OBJECTPOOL_H
+
+#include <cstddef>
+
+namespace glow {
+
+/// A process-wide allocator of the small objects that the compiler creates
+/// and destroys by the million, such as the nodes of the graph and the
+/// instructions of the IR. Blocks are carved from large slabs with a bump
+/// pointer, and freed blocks are kept in free lists by size, first in a cache
+/// of the freeing thread, so allocating and freeing a block is a few loads and
+/// stores in the common case. The objects don't share pages with the rest of
+/// the heap, which fragments less in long-lived processes. Slabs are never
+/// returned to the system, their blocks are reused by the next objects.
+class ObjectPool {
+public:
+  /// \returns a block of at least \p size bytes, aligned for any object.
+  static void *allocate(size_t size);
+
+  /// Frees \p ptr, a block returned by allocate(), possibly by another thread.
+  static void deallocate(void *ptr);
+
+  /// \returns the number of slabs allocated by the pool.
+  static size_t getNumSlabs();
+};
+
+/// A base class of the classes whose objects are allocated by ObjectPool.
+/// Derived classes don't need a virtual destructor, the block knows its own
+/// size.
+struct PoolAllocated {
+  static void *operator new(size_t size) { return ObjectPool::allocate(size); }
+  static void operator delete(void *ptr) { ObjectPool::deallocate(ptr); }
+  static void *operator new(size_t, void *ptr) { return ptr; }
+  static void operator delete(void *, void *) {}
+};
+
+} // end namespace glow
+
+#endif // GLOW_SUPPORT_OBJECTPOOL_H
@@ -17,37 +17,97 @@
 #define GLOW_TENSORPOOL_H
 
 #include "glow/Base/Tensor.h"
+#include "glow/Support/HostMemory.h"
+#include "glow/Support/MPMCQueue.h"
 
 #include <atomic>
 #include <iostream>
+#include <memory>
 #include <mutex>
-#include <unordered_map>
 #include <vector>
 
 namespace glow {
 
+/// A pool of Tensors whose buffers are recycled by size rather than by Type.
+/// Every buffer belongs to a size class, with four classes per power of two
+/// so that at most a quarter of a buffer is wasted, and a buffer is handed
+/// out again for any Type whose size falls in its class. Each thread that
+/// uses the pool has a small cache of buffers per size class, and the
+/// buffers that don't fit in it go to a lock-free list per size class shared
+/// by all threads, so neither get nor reclaim take a lock. The buffers may
+/// come from a HostMemoryAllocator, e.g. the pinned memory of a device, see
+/// DeviceManager::getHostMemoryAllocator.
 class TensorPool final {
+public:
+  /// Number of size classes, which cover every 64 bit size in bytes.
+  static constexpr size_t kNumSizeClasses = 256;
+
+  /// Number of buffers per size class cached by each thread.
+  static constexpr size_t kThreadCacheSize = 4;
+
+  /// Maximum number of buffers per size class in the shared lists. The
+  /// buffers reclaimed past it are freed.
+  static constexpr size_t kSharedListCapacity = 1024;
+
+  /// \returns the size class of buffers of \p bytes bytes.
+  static size_t getSizeClass(uint64_t bytes);
+
+  /// \returns the size in bytes of the buffers of \p sizeClass.
+  static uint64_t getSizeClassBytes(size_t sizeClass);
+
 private:
-  struct TypeHash {
-    size_t operator()(const Type &t) const { return t.equals_hash(); }
+  /// The buffers cached by a thread. Slots are only filled and emptied with
+  /// atomic exchanges, by their thread and by clear().
+  struct ThreadCache {
+    std::atomic<Tensor *> slots[kNumSizeClasses][kThreadCacheSize];
+    ThreadCache();
   };
 
-  struct TypeEquals {
-    bool operator()(const Type &a, const Type &b) const { return a.isEqual(b); }
-  };
-  /// A stack of available Tensors per Type.
-  std::unordered_map<Type, std::vector<Tensor *>, TypeHash, TypeEquals> pools_;
+  /// \returns the cache of the calling thread, registering it first if the
+  /// thread has never used this pool.
+  ThreadCache &getThreadCache();
+
+  /// \returns the shared list of \p sizeClass, creating it if needed.
+  MPMCQueue<Tensor *> &getSharedList(size_t sizeClass);
+
+  /// Marks \p sizeClass as used, for Stats::totalTypes.
+  void markSizeClassUsed(size_t sizeClass);
 
-  /// Mutex around pools_;
-  std::mutex lock_;
+  /// \returns a new Tensor of type \p ty whose buffer fills its size class.
+  Tensor *allocate(TypeRef ty, size_t sizeClass);
+
+  /// Frees the Tensor \p t allocated by allocate().
+  void freeTensor(Tensor *t);
+
+  /// Adds the available Tensor \p t of \p sizeClass to the shared list, or
+  /// frees it if the list is full.
+  void pushShared(Tensor *t, size_t sizeClass);
+
+  /// Unique id of the pool, which identifies its caches in the thread local
+  /// storage of threads.
+  const uint64_t id_;
+
+  /// The caches of all threads that used the pool.
+  std::vector<std::unique_ptr<ThreadCache>> threadCaches_;
+  std::mutex threadCachesLock_;
+
+  /// The shared list of every size class, created on first use.
+  std::atomic<MPMCQueue<Tensor *> *> sharedLists_[kNumSizeClasses];
+
+  /// Bit mask of the size classes that have been used.
+  std::atomic<uint64_t> usedSizeClasses_[kNumSizeClasses / 64];
 
   /// Whether or not to allow allocation of new buffers if the pool is empty.
   const bool preventInlineAllocs_{false};
 
+  /// The allocator of the buffers, or nullptr to allocate pageable memory.
+  HostMemoryAllocator *hostMemory_{nullptr};
+
 public:
   /// Statistics relating to the usage of the pool.
   struct Stats {
-    /// The total number of Types that has ever been available in this pool.
+    /// The total number of size classes that have ever been available in this
+    /// pool.
     std::atomic<uint64_t> totalTypes{0};
     /// The number of Tensors currently allocated and available.
     std::atomic<uint64_t> currentBuffers{0};
@@ -62,27 +122,49 @@ public:
     std::atomic<uint64_t> totalReclaims{0};
     /// The total number of times a Tensor was freed (e.g. via clear()).
     std::atomic<uint64_t> totalFrees{0};
+    /// The number of gets served by the cache of the calling thread.
+    std::atomic<uint64_t> threadCacheGets{0};
+    /// The number of gets served by the shared lists, which other threads
+    /// may be using concurrently.
+    std::atomic<uint64_t> sharedListGets{0};
+    /// The number of reclaims that went to the shared lists because the cache
+    /// of the calling thread was full.
+    std::atomic<uint64_t> sharedListReclaims{0};
+    /// The number of reclaimed Tensors freed because the shared list of their
+    /// size class was full.
+    std::atomic<uint64_t> overflowFrees{0};
+    /// The number of buffers allocated in pageable memory because the
+    /// HostMemoryAllocator of the pool had no more memory.
+    std::atomic<uint64_t> hostMemoryFallbacks{0};
   } stats_;
 
-  TensorPool(bool preventAllocs = false)
-      : preventInlineAllocs_{preventAllocs} {}
+  /// Creates a pool which allocates its buffers with \p hostMemory, falling
+  /// back to pageable memory if it fails, or in pageable memory if it is
+  /// nullptr. \p hostMemory must outlive the pool.
+  TensorPool(bool preventAllocs = false,
+             HostMemoryAllocator *hostMemory = nullptr);
+
+  ~TensorPool();
 
-  ~TensorPool() { clear(); }
+  TensorPool(const TensorPool &) = delete;
+  TensorPool &operator=(const TensorPool &) = delete;
 
-  /// Retrieve a Tensor with type \p ty from the pool - this type must have
-  /// previously been added by initialize. If the pool is empty this will
+  /// Retrieve a Tensor with type \p ty from the pool, reusing any available
+  /// buffer of the size class of \p ty. If the pool has none this will
   /// allocate a new Tensor unless preventAllocs was set true at construction
-  /// time.
+  /// time. May be called concurrently.
   Tensor *get(TypeRef ty);
 
   /// Return a Tensor \p t to the pool. This Tensor must have been previously
-  /// allocated by this TensorPool.
+  /// allocated by this TensorPool and must not have been reset since. May be
+  /// called concurrently.
   void reclaim(Tensor *t);
 
   /// Add \p count elements of the provided type \p ty to the pool.
   void reserve(TypeRef ty, size_t count);
 
-  /// Clear the pool and all allocated Tensors.
+  /// Clear the pool and all allocated Tensors, including those cached by
+  /// threads.
   /// Note: this does not delete tensors that were allocated by the pool but
   /// were not reclaimed.
   void clear();
@@ -18,11 +18,13 @@
 
 #include <atomic>
 #include <condition_variable>
+#include <deque>
 #include <functional>
 #include <future>
 #include <mutex>
 #include <queue>
 #include <thread>
+#include <type_traits>
 #include <vector>
 
 namespace glow {
@@ -50,6 +52,17 @@ shared_function<std::decay_t<F>> make_shared_function(F &&f) {
 }
 #endif
 
+/// \returns the CPUs of the NUMA node \p node of the host, or an empty list if
+/// the host has no such node or its topology is unknown, e.g. on hosts other
+/// than Linux.
+std::vector<unsigned> getNumaNodeCPUs(unsigned node);
+
+/// Restrict the current thread to run on \p cpus. As the kernel places pages
+/// on the node of the thread that touches them first, the memory the thread
+/// then allocates and initializes is local to the node of \p cpus. \returns
+/// false if the affinity could not be set.
+bool setCurrentThreadAffinity(const std::vector<unsigned> &cpus);
+
 /// An executor that runs Tasks on a single thread.
 class ThreadExecutor final {
 public:
@@ -105,9 +118,166 @@ protected:
   std::thread worker_;
 };
 
-/// Thread pool for asynchronous execution of generic functions.
+/// A type-erased void() callable that stores callables of up to kInlineSize
+/// bytes in place, so that wrapping a small lambda allocates no memory. Unlike
+/// std::function it is move-only, so it can hold move-only captures.
+class InlineFunction final {
+public:
+  /// The size of the callables that are stored without allocating.
+  static constexpr size_t kInlineSize = 64;
+
+  InlineFunction() = default;
+
+  template <typename F,
+            typename = typename std::enable_if<!std::is_same<
+                typename std::decay<F>::type, InlineFunction>::value>::type>
+  InlineFunction(F &&fn) {
+    using FnTy = typename std::decay<F>::type;
+    construct<FnTy>(std::forward<F>(fn), FitsInline<FnTy>());
+  }
+
+  InlineFunction(InlineFunction &&other) noexcept { moveFrom(other); }
+
+  InlineFunction &operator=(InlineFunction &&other) noexcept {
+    if (this != &other) {
+      reset();
+      moveFrom(other);
+    }
+    return *this;
+  }
+
+  InlineFunction(const InlineFunction &) = delete;
+  InlineFunction &operator=(const InlineFunction &) = delete;
+
+  ~InlineFunction() { reset(); }
+
+  /// Call the stored callable.
+  void operator()() { ops_->invoke(&storage_); }
+
+  /// \returns whether a callable is stored.
+  explicit operator bool() const { return ops_ != nullptr; }
+
+private:
+  using Storage = typename std::aligned_storage<kInlineSize>::type;
+
+  /// Whether a callable of type F is stored in place.
+  template <typename F>
+  using FitsInline =
+      std::integral_constant<bool,
+                             sizeof(F) <= kInlineSize &&
+                                 alignof(F) <= alignof(Storage) &&
+                                 std::is_nothrow_move_constructible<F>::value>;
+
+  /// The operations on a stored callable.
+  struct Ops {
+    void (*invoke)(void *fn);
+    void (*move)(void *dst, void *src);
+    void (*destroy)(void *fn);
+  };
+
+  /// The Ops of a callable of type F stored in place.
+  template <typename F> struct InlineOps {
+    static void invoke(void *fn) { (*static_cast<F *>(fn))(); }
+    static void move(void *dst, void *src) {
+      new (dst) F(std::move(*static_cast<F *>(src)));
+      static_cast<F *>(src)->~F();
+    }
+    static void destroy(void *fn) { static_cast<F *>(fn)->~F(); }
+    static constexpr Ops ops{&invoke, &move, &destroy};
+  };
+
+  /// Store \p fn in place.
+  template <typename F, typename G> void construct(G &&fn, std::true_type) {
+    new (&storage_) F(std::forward<G>(fn));
+    ops_ = &InlineOps<F>::ops;
+  }
+
+  /// Store \p fn on the heap, and a callable owning it in place.
+  template <typename F, typename G> void construct(G &&fn, std::false_type) {
+    auto heapFn = [fn = std::unique_ptr<F>(new F(std::forward<G>(fn)))]() {
+      (*fn)();
+    };
+    construct<decltype(heapFn)>(std::move(heapFn), std::true_type());
+  }
+
+  void moveFrom(InlineFunction &other) {
+    ops_ = other.ops_;
+    if (ops_) {
+      ops_->move(&storage_, &other.storage_);
+      other.ops_ = nullptr;
+    }
+  }
+
+  void reset() {
+    if (ops_) {
+      ops_->destroy(&storage_);
+      ops_ = nullptr;
+    }
+  }
+
+  /// The operations on the stored callable, or nullptr if there is none.
+  const Ops *ops_{nullptr};
+
+  /// Storage of the callable.
+  Storage storage_;
+};
+
+template <typename F>
+constexpr InlineFunction::Ops InlineFunction::InlineOps<F>::ops;
+
+/// Work-stealing thread pool for asynchronous execution of generic functions.
+/// Every worker thread has a deque of tasks. Tasks are queued on the worker
+/// that submits them, or round robin when submitted from outside the pool,
+/// and idle workers steal the tasks queued on the other workers, so that a
+/// task doesn't wait behind a slow one while a worker is idle.
 class ThreadPool final {
 public:
+  /// A worker thread of the pool. The tasks submitted to a worker directly
+  /// run on its thread in submission order, they are never stolen.
+  class Worker final {
+  public:
+    /// Submit \p fn as a work item for the thread of the worker.
+    /// \p fn must be a lambda with void return type and arguments.
+    template <typename F> std::future<void> submit(F &&fn) {
+#ifdef WIN32
+      std::packaged_task<void(void)> task(make_shared_function(std::move(fn)));
+#else
+      std::packaged_task<void(void)> task(std::move(fn));
+#endif
+
+      return submit(std::move(task));
+    }
+
+    /// Submit \p task as a work item for the thread of the worker.
+    std::future<void> submit(std::packaged_task<void(void)> &&task);
+
+  private:
+    friend class ThreadPool;
+
+    Worker(ThreadPool *pool, size_t index) : pool_(pool), index_(index) {}
+
+    /// The pool of the worker.
+    ThreadPool *pool_;
+
+    /// The index of the worker in the workers_ of pool_.
+    size_t index_;
+
+    /// Mutex for the queues of the worker.
+    std::mutex lock_;
+
+    /// Tasks that any worker may run, oldest first.
+    std::deque<InlineFunction> tasks_;
+
+    /// Tasks that only this worker runs, oldest first.
+    std::deque<InlineFunction> pinnedTasks_;
+
+    /// Number of tasks in pinnedTasks_.
+    std::atomic<size_t> numPinnedTasks_{0};
+
+    /// The thread of the worker.
+    std::thread thread_;
+  };
+
   /// Constructor. Initializes a thread pool with \p numWorkers
   /// threads and has them all run ThreadPool::threadPoolWorkerMain.
   ThreadPool(unsigned numWorkers = kNumWorkers);
@@ -134,13 +304,21 @@ public:
   /// Submit \p task as a work item for the thread pool.
   std::future<void> submit(std::packaged_task<void(void)> &&task);
 
-  /// Returns a ThreadExecutor that can be accessed directly, allowing
+  /// Submit \p fn as a work item for the thread pool without a way to wait
+  /// for it. Unlike submit, this allocates no memory when \p fn is smaller
+  /// than InlineFunction::kInlineSize.
+  void run(InlineFunction &&fn);
+
+  /// Returns a Worker that can be accessed directly, allowing
   /// submitting multiple tasks to the same thread.
-  ThreadExecutor *getExecutor() {
+  Worker *getExecutor() {
     size_t exIndex = nextWorker_++;
-    return workers_[exIndex % workers_.size()];
+    return workers_[exIndex % workers_.size()].get();
   }
 
+  /// \returns the number of worker threads in the pool.
+  size_t getNumWorkers() const { return workers_.size(); }
+
   /// Run the provided function on every thread in the ThreadPool. The function
   /// must be copyable.
   template <typename F> std::future<void> runOnAllThreads(F &&fn) {
@@ -148,7 +326,7 @@ public:
         std::make_shared<std::atomic<size_t>>(0);
     std::shared_ptr<std::promise<void>> promise =
         std::make_shared<std::promise<void>>();
-    for (auto *w : workers_) {
+    for (auto &w : workers_) {
       w->submit([fn, finished, promise, total = workers_.size()]() {
         fn();
         if ((finished->fetch_add(1) + 1) >= total) {
@@ -164,13 +342,41 @@ private:
   /// The default number of workers in the thread pool (overridable).
   constexpr static unsigned kNumWorkers = 10;
 
+  /// Main loop run by \p worker.
+  void threadPoolWorkerMain(Worker *worker);
+
+  /// \returns the next task for \p worker to run: its oldest pinned task,
+  /// else its oldest task, else the oldest task of another worker. \returns
+  /// an empty function if there is none.
+  InlineFunction takeTask(Worker *worker);
+
+  /// Wake up the workers waiting for a task after a task was queued, all of
+  /// them if \p all is set and one of them otherwise.
+  void notifyWorkers(bool all);
+
   /// Vector of worker thread objects.
   /// It is safe to access this without a lock as it is const after
   /// construction.
-  std::vector<ThreadExecutor *> workers_;
+  std::vector<std::unique_ptr<Worker>> workers_;
 
   /// Round robin index for the next work thread.
   std::atomic<size_t> nextWorker_{0};
+
+  /// Number of tasks that any worker may run.
+  std::atomic<size_t> numTasks_{0};
+
+  /// Number of workers waiting for a task.
+  std::atomic<size_t> numWaiting_{0};
+
+  /// Flag checked in between work items to determine whether the workers
+  /// should stop and exit.
+  std::atomic<bool> shouldStop_{false};
+
+  /// Mutex that idle workers wait on.
+  std::mutex waitMtx_;
+
+  /// Condition variable to signal to idle workers when a task is queued.
+  std::condition_variable taskQueued_;
 };
 } // namespace glow
 
@@ -161,6 +161,10 @@ void Backend::autoInstrument(TraceInfo &traceInfo, IRFunction *IR) const {
 bool Backend::checkAllNodesSupported(const Function &F) const {
   bool allSupported = true;
   for (const Node &N : F.getNodes()) {
+    // IRGen handles the barriers for all the backends.
+    if (llvm::isa<RecomputeBarrierNode>(N)) {
+      continue;
+    }
     if (!isOpSupported(N)) {
       allSupported = false;
       report("Unsupported node found while compiling Function " +
@@ -18,10 +18,15 @@
 #include "glow/IR/Instrs.h"
 #include "glow/Support/Debug.h"
 
+#include "llvm/ADT/Hashing.h"
 #include "llvm/Support/CommandLine.h"
 
 #include <glog/logging.h>
 
+#include <algorithm>
+#include <mutex>
+#include <unordered_map>
+
 #define DEBUG_TYPE "backend-utils"
 
 using namespace glow;
@@ -37,16 +42,115 @@ static llvm::cl::opt<bool> reuseActivationsMemory(
     llvm::cl::desc("Should activation memory allocations be reused"),
     llvm::cl::init(true), llvm::cl::cat(BackendUtilsCat));
 
+static llvm::cl::opt<bool> shareConstantWeights(
+    "share-constant-weights",
+    llvm::cl::desc("Should the collected constant weights of functions be "
+                   "stored once when they are identical"),
+    llvm::cl::init(true), llvm::cl::cat(BackendUtilsCat));
+
+static llvm::cl::opt<HugePages> constantWeightsHugePages(
+    "constant-weights-huge-pages",
+    llvm::cl::desc("The pages backing the collected constant weights of the "
+                   "functions whose weights take at least a huge page"),
+    llvm::cl::values(
+        clEnumValN(HugePages::None, "none", "Regular pages"),
+        clEnumValN(HugePages::Transparent, "thp", "Transparent huge pages"),
+        clEnumValN(HugePages::HugeTLB2MB, "hugetlb-2mb",
+                   "2MB pages of the hugetlbfs pool"),
+        clEnumValN(HugePages::HugeTLB1GB, "hugetlb-1gb",
+                   "1GB pages of the hugetlbfs pool")),
+    llvm::cl::init(HugePages::Transparent), llvm::cl::cat(BackendUtilsCat));
+
 namespace {
+/// Process-wide pool of the blocks of constant weights collected by
+/// RuntimeBundles. Blocks are keyed by a hash of their content and reference
+/// counted, so that RuntimeBundles with identical weights share a block that
+/// is freed once the last of them releases it.
+class ConstantsPool {
+  /// A block of the pool.
+  struct Block {
+    uint8_t *data;
+    size_t size;
+    unsigned users;
+    HugePages pages;
+  };
+
+  /// The blocks with the same hash, keyed by the hash.
+  std::unordered_map<size_t, std::vector<Block>> blocks_;
+
+  /// The hash of each block, keyed by its data.
+  std::unordered_map<const uint8_t *, size_t> hashes_;
+
+  std::mutex lock_;
+
+public:
+  /// Adds the block of \p size bytes at \p data, backed by \p pages, to the
+  /// pool. \returns the block of the pool with the same content, after
+  /// freeing \p data, or \p data if there was none.
+  uint8_t *acquire(uint8_t *data, size_t size, HugePages pages) {
+    size_t hash = llvm::hash_value(
+        llvm::StringRef(reinterpret_cast<const char *>(data), size));
+    std::lock_guard<std::mutex> lock(lock_);
+    auto &bucket = blocks_[hash];
+    for (auto &block : bucket) {
+      if (block.size == size && memcmp(block.data, data, size) == 0) {
+        block.users++;
+        hugePagesFree(data, size, pages);
+        return block.data;
+      }
+    }
+    bucket.push_back({data, size, 1, pages});
+    hashes_[data] = hash;
+    return data;
+  }
+
+  /// Releases the block at \p data acquired earlier, which is freed if it has
+  /// no users left.
+  void release(uint8_t *data) {
+    std::lock_guard<std::mutex> lock(lock_);
+    auto hashIt = hashes_.find(data);
+    assert(hashIt != hashes_.end() && "Unknown block of constants");
+    auto bucketIt = blocks_.find(hashIt->second);
+    auto &bucket = bucketIt->second;
+    auto blockIt = std::find_if(bucket.begin(), bucket.end(),
+                                [&](const Block &b) { return b.data == data; });
+    assert(blockIt != bucket.end() && "Unknown block of constants");
+    if (--blockIt->users > 0) {
+      return;
+    }
+    hugePagesFree(data, blockIt->size, blockIt->pages);
+    bucket.erase(blockIt);
+    if (bucket.empty()) {
+      blocks_.erase(bucketIt);
+    }
+    hashes_.erase(hashIt);
+  }
+};
+
+/// \returns the process-wide ConstantsPool, which is never destroyed because
+/// CompiledFunctions with static storage may release their constants after
+/// it would be.
+ConstantsPool &getConstantsPool() {
+  static auto *pool = new ConstantsPool();
+  return *pool;
+}
+
 /// Allocate space for the activations of \p instrs using \p allocator and store
-/// the resultant symbols in \p symbolTable.
+/// the resultant symbols in \p symbolTable. The activations are planned offline
+/// if \p planOffline.
 void allocateActivations(const glow::IRFunction::InstListTy &instrs,
                          MemoryAllocator &allocator,
-                         glow::runtime::SymbolTableTy &symbolTable) {
+                         glow::runtime::SymbolTableTy &symbolTable,
+                         bool planOffline) {
+  llvm::DenseMap<const Value *, uint64_t> plannedAddr;
+  if (planOffline) {
+    plannedAddr = planActivations(instrs, allocator, reuseActivationsMemory);
+  }
   for (const auto &I : instrs) {
     if (auto *A = dyn_cast<AllocActivationInst>(&I)) {
       auto numBytes = I.getSizeInBytes();
-      size_t addr = allocator.allocate(numBytes, A);
+      size_t addr =
+          planOffline ? plannedAddr[A] : allocator.allocate(numBytes, A);
       assert(!symbolTable.count(std::string(A->getName())) &&
              "Allocation already made!");
       runtime::RuntimeSymbolInfo symbol;
@@ -68,12 +172,11 @@ void allocateActivations(const glow::IRFunction::InstListTy &instrs,
       // source of the tensorview.
       assert(!symbolTable.count(std::string(TV->getName())) &&
              "Allocation already made!");
-      size_t offsetLength = TV->getOffsets().empty() ? 0 : TV->getOffsets()[0];
+      size_t offsetLength = 0;
       auto *tvSource = TV->getSrc();
-      if (tvSource->dims().size() > 1) {
-        for (size_t i = 1; i < tvSource->dims().size(); ++i) {
-          offsetLength *= tvSource->dims()[i];
-        }
+      auto offsets = TV->getOffsets();
+      for (size_t i = 0; i < offsets.size(); ++i) {
+        offsetLength += offsets[i] * tvSource->getType()->strides()[i];
       }
       assert(symbolTable.count(std::string(tvSource->getName())) &&
              "Source allocation not found!");
@@ -104,12 +207,16 @@ void allocateActivations(const glow::IRFunction::InstListTy &instrs,
       auto *A = D->getAlloc();
       assert(symbolTable.count(std::string(A->getName())) &&
              "Invalid deallocation!");
-      if (reuseActivationsMemory) {
+      if (reuseActivationsMemory && !planOffline) {
         allocator.deallocate(A);
       }
       continue;
     }
   }
+  // All the planned activations are freed at once.
+  if (reuseActivationsMemory && !plannedAddr.empty()) {
+    allocator.deallocate(&instrs);
+  }
 }
 
 /// Allocate space for the Constants in \p constants using \p allocator and
@@ -166,6 +273,8 @@ operator=(glow::runtime::RuntimeBundle &&rhs) {
 
   std::swap(symbolTable_, rhs.symbolTable_);
   std::swap(constants_, rhs.constants_);
+  std::swap(constantsShared_, rhs.constantsShared_);
+  std::swap(constantsPages_, rhs.constantsPages_);
   std::swap(constantWeightVarsMemSize_, rhs.constantWeightVarsMemSize_);
   std::swap(mutableWeightVarsMemSize_, rhs.mutableWeightVarsMemSize_);
   std::swap(activationsMemSize_, rhs.activationsMemSize_);
@@ -184,10 +293,26 @@ void glow::runtime::RuntimeBundle::freeConstants() {
   DCHECK(isValid_);
 
   if (constants_) {
-    glow::alignedFree(constants_);
+    if (constantsShared_) {
+      getConstantsPool().release(constants_);
+    } else {
+      hugePagesFree(constants_, constantWeightVarsMemSize_, constantsPages_);
+    }
     constants_ = nullptr;
+    constantsShared_ = false;
+    constantsPages_ = HugePages::None;
   }
 }
+void glow::runtime::RuntimeBundle::eraseSymbols(SymbolCategory category) {
+  for (auto it = symbolTable_.begin(); it != symbolTable_.end();) {
+    if (it->second.symbolCategory == category) {
+      it = symbolTable_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
 void glow::runtime::RuntimeBundle::collectConstants(const Module *M) {
   DCHECK(isValid_);
 
@@ -200,8 +325,11 @@ void glow::runtime::RuntimeBundle::collectConstants(const Module *M) {
   }
 
   assert(constants_ == nullptr && "constants already allocated");
-  constants_ =
-      (uint8_t *)alignedAlloc(constantWeightVarsMemSize_, TensorAlignment);
+  constantsPages_ = constantWeightVarsMemSize_ >= HugePageSize
+                       ? constantWeightsHugePages
+                       : HugePages::None;
+  constants_ = (uint8_t *)hugePagesAlloc(constantWeightVarsMemSize_,
+                                         constantsPages_);
 
   for (const auto &symbol : symbolTable_) {
     llvm::StringRef name = symbol.first;
@@ -218,6 +346,12 @@ void glow::runtime::RuntimeBundle::collectConstants(const Module *M) {
     // Copy weight to offset.
     memcpy(constants_ + info.offset, payload, info.size);
   }
+
+  if (shareConstantWeights) {
+    constants_ = getConstantsPool().acquire(
+        constants_, constantWeightVarsMemSize_, constantsPages_);
+    constantsShared_ = true;
+  }
 }
 
 size_t glow::runtime::RuntimeBundle::getValueOffset(const Named *v) const {
@@ -237,6 +371,48 @@ runtime::RuntimeBundle::getSymbolInfo(const Named *v) const {
 
 namespace glow {
 
+llvm::DenseMap<const Value *, uint64_t>
+planActivations(const IRFunction::InstListTy &instrs,
+                MemoryAllocator &allocator, bool reuseMemory) {
+  // The live interval of an activation is measured in instructions.
+  std::vector<MemoryAllocator::Buffer> buffers;
+  std::vector<const Value *> activations;
+  llvm::DenseMap<const Value *, size_t> indices;
+  uint64_t time = 0;
+  for (const auto &I : instrs) {
+    time++;
+    if (auto *A = dyn_cast<AllocActivationInst>(&I)) {
+      indices[A] = buffers.size();
+      buffers.push_back({A->getSizeInBytes(), time, 0});
+      activations.push_back(A);
+      continue;
+    }
+    if (auto *D = dyn_cast<DeallocActivationInst>(&I)) {
+      if (reuseMemory) {
+        buffers[indices[D->getAlloc()]].end = time;
+      }
+    }
+  }
+
+  llvm::DenseMap<const Value *, uint64_t> addrs;
+  if (buffers.empty()) {
+    return addrs;
+  }
+  for (auto &buffer : buffers) {
+    if (buffer.end == 0) {
+      buffer.end = time + 1;
+    }
+  }
+  std::vector<uint64_t> bufferAddrs;
+  auto base = allocator.allocateAll(buffers, &instrs, bufferAddrs);
+  (void)base;
+  assert(base != MemoryAllocator::npos && "Could not allocate activations");
+  for (size_t i = 0, e = activations.size(); i < e; i++) {
+    addrs[activations[i]] = bufferAddrs[i];
+  }
+  return addrs;
+}
+
 /// If \p PH is an output placeholder, \returns true.
 /// This is determined by checking if the PH has a user which uses the PH as an
 /// overwritten input.
@@ -481,7 +657,8 @@ runtime::RuntimeBundle::create(const Function &F,
 
   // Allocate activations.
   for (const auto &f : funcs) {
-    allocateActivations(f->getInstrs(), allocator, symbolTable);
+    allocateActivations(f->getInstrs(), allocator, symbolTable,
+                        /* planOffline */ false);
   }
 
   activationsMaxMem =
@@ -517,7 +694,8 @@ runtime::RuntimeBundle
 runtime::RuntimeBundle::create(const IRFunction &F,
                                MemoryAllocator &constantAllocator,
                                MemoryAllocator &placeholderAllocator,
-                               MemoryAllocator &activationsAllocator) {
+                               MemoryAllocator &activationsAllocator,
+                               bool planActivationsOffline) {
 
   // If all allocators refer to the same underlying allocator, Constants,
   // Placeholders and activations will be allocated contiguously. The maximum
@@ -579,7 +757,8 @@ runtime::RuntimeBundle::create(const IRFunction &F,
   }
 
   // Compute the offsets for Activations.
-  allocateActivations(F.getInstrs(), activationsAllocator, symbolTable);
+  allocateActivations(F.getInstrs(), activationsAllocator, symbolTable,
+                      planActivationsOffline);
 
   auto activationsMaxSize = activationsAllocator.getMaxMemoryUsage();
   if (contiguous) {
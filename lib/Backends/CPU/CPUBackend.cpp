@@ -17,20 +17,37 @@
 #include "CPUBackend.h"
 #include "CPUFunction.h"
 #include "CPULLVMIRGen.h"
+#include "PerfCounters.h"
 
 #include "glow/Backend/BackendUtils.h"
 #include "glow/Graph/Graph.h"
 #include "glow/IR/Instrs.h"
 #include "glow/LLVMIRCodeGen/LLVMIRGen.h"
+#include "glow/Optimizer/GraphOptimizerPipeline/Pipeline.h"
 #include "glow/Support/Debug.h"
 
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Triple.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/LLVMContext.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/MathExtras.h"
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <thread>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
 
 using namespace glow;
 
+extern llvm::cl::opt<bool> llvmEnableAVX512;
+
 /// We compile the standard library (libjit) to LLVM bitcode, and then convert
 /// that binary data to an include file using an external utility (include-bin).
 /// The resulting file is included here to compile the bitcode image into our
@@ -40,6 +57,133 @@ static const unsigned char libjit_bc[] = {
 };
 static const size_t libjit_bc_size = sizeof(libjit_bc);
 
+/// The libjit variant built for targets with the 32 vector registers of
+/// AVX-512, which uses larger register blocks.
+static const unsigned char libjit_avx512_bc[] = {
+#include "glow/CPU/libjit_avx512_bc.inc"
+};
+static const size_t libjit_avx512_bc_size = sizeof(libjit_avx512_bc);
+
+/// The libjit variant built for AArch64, whose micro-kernels fit in the 32
+/// 128-bit registers of NEON.
+static const unsigned char libjit_neon_bc[] = {
+#include "glow/CPU/libjit_neon_bc.inc"
+};
+static const size_t libjit_neon_bc_size = sizeof(libjit_neon_bc);
+
+namespace {
+/// The variants of libjit.
+enum class LibjitVariant {
+  /// The best variant for the features of the host CPU.
+  Auto,
+  /// The variant for any target.
+  Generic,
+  /// The variant for AVX-512.
+  AVX512,
+  /// The variant for the NEON registers of AArch64.
+  NEON,
+};
+
+llvm::cl::opt<LibjitVariant> cpuLibjitVariant(
+    "cpu-libjit-variant",
+    llvm::cl::desc("Variant of libjit the CPU backend JITs functions with"),
+    llvm::cl::values(clEnumValN(LibjitVariant::Auto, "auto",
+                                "The best variant for the host CPU"),
+                     clEnumValN(LibjitVariant::Generic, "generic",
+                                "The variant for any target"),
+                     clEnumValN(LibjitVariant::AVX512, "avx512",
+                                "The variant for AVX-512"),
+                     clEnumValN(LibjitVariant::NEON, "neon",
+                                "The variant for AArch64")),
+    llvm::cl::init(LibjitVariant::Auto));
+
+llvm::cl::list<unsigned> cpuMatMulBlocking(
+    "cpu-matmul-blocking",
+    llvm::cl::desc("The blocking mc,kc,nc of the float matmul kernels, "
+                   "chosen for the caches of the host by default"),
+    llvm::cl::CommaSeparated, llvm::cl::ZeroOrMore);
+
+/// \returns whether \p triple is of an AArch64 target.
+bool isAArch64(llvm::StringRef triple) {
+  auto arch = llvm::Triple(triple).getArch();
+  return arch == llvm::Triple::aarch64 || arch == llvm::Triple::aarch64_be;
+}
+
+/// \returns the libjit variant best suited to the features of the host CPU.
+LibjitVariant detectHostLibjitVariant() {
+  if (isAArch64(llvm::sys::getProcessTriple())) {
+    return LibjitVariant::NEON;
+  }
+  llvm::StringMap<bool> hostFeatures;
+  if (!llvm::sys::getHostCPUFeatures(hostFeatures)) {
+    return LibjitVariant::Generic;
+  }
+  // The JIT only uses the AVX-512 registers with -llvm-enable-avx512.
+  if (llvmEnableAVX512 && hostFeatures.lookup("avx512f") &&
+      hostFeatures.lookup("avx512vl")) {
+    return LibjitVariant::AVX512;
+  }
+  return LibjitVariant::Generic;
+}
+
+/// \returns the libjit variant of the code for \p target, the host if it is
+/// empty.
+LibjitVariant getLibjitVariant(llvm::StringRef target) {
+  LibjitVariant variant = cpuLibjitVariant;
+  if (variant == LibjitVariant::Auto) {
+    // Detect the features of the host once. Code for other targets uses the
+    // NEON variant on AArch64 and the generic variant otherwise.
+    static LibjitVariant hostVariant = detectHostLibjitVariant();
+    if (target.empty()) {
+      variant = hostVariant;
+    } else if (isAArch64(target)) {
+      variant = LibjitVariant::NEON;
+    } else {
+      variant = LibjitVariant::Generic;
+    }
+  }
+  return variant;
+}
+
+/// \returns the blocking of the float matmul kernels for the caches of the
+/// host, when the micro-kernel computes \p nr columns. The sizes of the caches
+/// that aren't known are those of a recent desktop processor.
+MatMulBlocking getHostMatMulBlocking(size_t nr) {
+  size_t l1 = 32 << 10;
+  size_t l2 = 256 << 10;
+  size_t l3 = 8 << 20;
+#ifdef _SC_LEVEL1_DCACHE_SIZE
+  auto detect = [](int name, size_t &size) {
+    long bytes = sysconf(name);
+    if (bytes > 0) {
+      size = bytes;
+    }
+  };
+  detect(_SC_LEVEL1_DCACHE_SIZE, l1);
+  detect(_SC_LEVEL2_CACHE_SIZE, l2);
+  detect(_SC_LEVEL3_CACHE_SIZE, l3);
+#endif
+  return CPUBackend::getMatMulBlocking(
+      l1, l2, l3, std::thread::hardware_concurrency(), nr);
+}
+} // namespace
+
+MatMulBlocking CPUBackend::getMatMulBlocking(size_t l1, size_t l2, size_t l3,
+                                             unsigned numThreads, size_t nr) {
+  // The micro-kernel computes 8 rows per register of A, see
+  // libjit_matmul.cpp, and the kernels pack mc x kc blocks of A on the stack.
+  constexpr size_t mr = 4 * 8;
+  constexpr size_t maxPackedBytes = 512 << 10;
+  const size_t panelBytes = (mr + nr) * sizeof(float);
+  size_t kc = llvm::PowerOf2Floor(l1 / panelBytes);
+  kc = std::min<size_t>(1024, std::max<size_t>(16, kc));
+  size_t mc = std::min(l2 / 2, maxPackedBytes) / (kc * sizeof(float));
+  mc = std::max(mr, mc / mr * mr);
+  size_t nc = l3 / std::max(numThreads, 1u) / (kc * sizeof(float));
+  nc = std::max<size_t>(256, nc) / nr * nr;
+  return {mc, kc, nc};
+}
+
 bool CPUBackend::isOpSupported(const NodeInfo &NI) const {
   // Note: For brevity below, "X ==> Y, Z" signifes that Node X is IRGen'd into
   // Instructions Y and Z.
@@ -53,10 +197,23 @@ bool CPUBackend::isOpSupported(const NodeInfo &NI) const {
   case Kinded::Kind::MulNodeKind:
   case Kinded::Kind::MaxNodeKind:
   case Kinded::Kind::MinNodeKind:
+    // Float16Ty is stored as half precision and computed in float by libjit.
+    return NI.allInputsAndOutputsHaveSameElemKind(
+        {ElemKind::FloatTy, ElemKind::Float16Ty, ElemKind::Int8QTy,
+         ElemKind::Int16QTy});
+
+  case Kinded::Kind::MatMulNodeKind:
+    // Int16QTy activations are multiplied by Int8QTy weights.
+    return NI.allInputsAndOutputsHaveSameElemKind(
+               {ElemKind::FloatTy, ElemKind::Float16Ty, ElemKind::Int8QTy}) ||
+           (NI.allInputsAndOutputsHaveSameElemKind({ElemKind::Int16QTy},
+                                                   {MatMulNode::RHSIdx}) &&
+            (NI.getInElemTy(MatMulNode::RHSIdx) == ElemKind::Int8QTy));
+
   case Kinded::Kind::CPUMaxSplatNodeKind:
   case Kinded::Kind::BatchedReduceAddNodeKind:
-  case Kinded::Kind::MatMulNodeKind:
   case Kinded::Kind::AvgPoolNodeKind:
+  case Kinded::Kind::AdaptiveAvgPoolNodeKind:
     return NI.allInputsAndOutputsHaveSameElemKind(
         {ElemKind::FloatTy, ElemKind::Int8QTy});
 
@@ -76,44 +233,90 @@ bool CPUBackend::isOpSupported(const NodeInfo &NI) const {
   case Kinded::Kind::ReshapeNodeKind:
     // These are implemented via a Copy Instruction.
     return NI.allInputsAndOutputsHaveSameElemKind(
-        {ElemKind::FloatTy, ElemKind::Int8QTy, ElemKind::Int32QTy,
-         ElemKind::Int32ITy, ElemKind::Int64ITy, ElemKind::BoolTy});
+        {ElemKind::FloatTy, ElemKind::Float16Ty, ElemKind::Int8QTy,
+         ElemKind::Int16QTy, ElemKind::Int32QTy, ElemKind::Int32ITy,
+         ElemKind::Int64ITy, ElemKind::BoolTy});
 
     // InsertTensor ==> Copy + InsertTensor. Copy supports everything
     // ReshapeNode above supports, so InsertTensor is the limiting factor.
   case Kinded::Kind::InsertTensorNodeKind:
     // Concat ==> Splat + Insert. Both only support the following.
   case Kinded::Kind::ConcatNodeKind:
+    return NI.allInputsAndOutputsHaveSameElemKind(
+        {ElemKind::FloatTy, ElemKind::Int8QTy, ElemKind::Int32ITy,
+         ElemKind::Int64ITy, ElemKind::BoolTy});
   case Kinded::Kind::SplatNodeKind:
     return NI.allInputsAndOutputsHaveSameElemKind(
-        {ElemKind::FloatTy, ElemKind::Int8QTy, ElemKind::Int64ITy,
+        {ElemKind::FloatTy, ElemKind::Float16Ty, ElemKind::Int8QTy,
+         ElemKind::Int16QTy, ElemKind::Int32ITy, ElemKind::Int64ITy,
          ElemKind::BoolTy});
   case Kinded::Kind::SliceNodeKind:
     return NI.allInputsAndOutputsHaveSameElemKind(
         {ElemKind::FloatTy, ElemKind::Int8QTy, ElemKind::Int32QTy,
          ElemKind::Int64ITy});
   case Kinded::Kind::SpaceToDepthNodeKind:
-  case Kinded::Kind::DivNodeKind:
     return NI.allInputsAndOutputsHaveSameElemKind(
         {ElemKind::FloatTy, ElemKind::Int8QTy, ElemKind::Int64ITy});
+  case Kinded::Kind::ResizeNearestNodeKind:
+  case Kinded::Kind::ResizeBilinearNodeKind:
+    return NI.allInputsAndOutputsHaveSameElemKind(
+        {ElemKind::FloatTy, ElemKind::Int8QTy});
+  case Kinded::Kind::DivNodeKind:
+    return NI.allInputsAndOutputsHaveSameElemKind(
+        {ElemKind::FloatTy, ElemKind::Float16Ty, ElemKind::Int8QTy,
+         ElemKind::Int64ITy});
 
   case Kinded::Kind::TransposeNodeKind:
     return NI.allInputsAndOutputsHaveSameElemKind(
         {ElemKind::FloatTy, ElemKind::Int8QTy, ElemKind::Int64ITy,
          ElemKind::BoolTy});
 
+  case Kinded::Kind::CPUBlockSparseMatMulNodeKind:
+    return NI.allInputsAndOutputsHaveSameElemKind(
+               {ElemKind::FloatTy}, {CPUBlockSparseMatMulNode::IndicesIdx,
+                                     CPUBlockSparseMatMulNode::OffsetsIdx}) &&
+           (NI.getInElemTy(CPUBlockSparseMatMulNode::IndicesIdx) ==
+            ElemKind::Int32ITy) &&
+           (NI.getInElemTy(CPUBlockSparseMatMulNode::OffsetsIdx) ==
+            ElemKind::Int32ITy);
+
+  case Kinded::Kind::SGDNodeKind:
+  case Kinded::Kind::CPUSGDNodeKind:
+  case Kinded::Kind::CPUSGDMomentumNodeKind:
+    return NI.allInputsAndOutputsHaveSameElemKind({ElemKind::FloatTy});
+
+  case Kinded::Kind::CPUSparseSGDNodeKind:
+    return NI.allInputsAndOutputsHaveSameElemKind(
+               {ElemKind::FloatTy}, {CPUSparseSGDNode::IndicesIdx,
+                                     CPUSparseSGDNode::LengthsIdx}) &&
+           (NI.getInElemTy(CPUSparseSGDNode::IndicesIdx) ==
+            ElemKind::Int64ITy) &&
+           (NI.getInElemTy(CPUSparseSGDNode::LengthsIdx) ==
+            ElemKind::Int32ITy);
+
   case Kinded::Kind::SparseLengthsSumNodeKind:
     return NI.allInputsAndOutputsHaveSameElemKind(
-               {ElemKind::FloatTy}, {SparseLengthsSumNode::IndicesIdx,
-                                     SparseLengthsSumNode::LengthsIdx}) &&
+               {ElemKind::FloatTy, ElemKind::Float16Ty},
+               {SparseLengthsSumNode::IndicesIdx,
+                SparseLengthsSumNode::LengthsIdx}) &&
            (NI.getInElemTy(SparseLengthsSumNode::IndicesIdx) ==
             ElemKind::Int64ITy) &&
            (NI.getInElemTy(SparseLengthsSumNode::LengthsIdx) ==
             ElemKind::Int32ITy);
 
+  case Kinded::Kind::SparseLengthsMeanNodeKind:
+  case Kinded::Kind::SparseLengthsMaxNodeKind:
+    return NI.allInputsAndOutputsHaveSameElemKind(
+               {ElemKind::FloatTy}, {SparseLengthsMeanNode::IndicesIdx,
+                                     SparseLengthsMeanNode::LengthsIdx}) &&
+           (NI.getInElemTy(SparseLengthsMeanNode::IndicesIdx) ==
+            ElemKind::Int64ITy) &&
+           (NI.getInElemTy(SparseLengthsMeanNode::LengthsIdx) ==
+            ElemKind::Int32ITy);
+
   case Kinded::Kind::SparseLengthsWeightedSumNodeKind:
     return NI.allInputsAndOutputsHaveSameElemKind(
-               {ElemKind::FloatTy},
+               {ElemKind::FloatTy, ElemKind::Float16Ty},
                {SparseLengthsWeightedSumNode::IndicesIdx,
                 SparseLengthsWeightedSumNode::LengthsIdx}) &&
            (NI.getInElemTy(SparseLengthsWeightedSumNode::IndicesIdx) ==
@@ -163,14 +366,51 @@ bool CPUBackend::isOpSupported(const NodeInfo &NI) const {
   case Kinded::Kind::LengthsToRangesNodeKind:
     return NI.allInputsAndOutputsHaveSameElemKind({ElemKind::Int32ITy});
 
+  case Kinded::Kind::BucketizeNodeKind:
+    return (NI.getInElemTy(BucketizeNode::InputIdx) == ElemKind::FloatTy) &&
+           (NI.getOutElemTy(BucketizeNode::ResultIdx) == ElemKind::Int32ITy);
+
+  case Kinded::Kind::BatchOneHotNodeKind:
+    return NI.allInputsAndOutputsHaveSameElemKind(
+               {ElemKind::FloatTy, ElemKind::Int8QTy, ElemKind::Int32ITy,
+                ElemKind::Int64ITy},
+               {BatchOneHotNode::LengthsIdx}) &&
+           (NI.getInElemTy(BatchOneHotNode::LengthsIdx) == ElemKind::Int32ITy);
+
+  case Kinded::Kind::SparseToDenseMaskNodeKind:
+    return (NI.getInElemTy(SparseToDenseMaskNode::IndicesIdx) ==
+            ElemKind::Int64ITy) &&
+           (NI.getInElemTy(SparseToDenseMaskNode::LengthsIdx) ==
+            ElemKind::Int32ITy) &&
+           (NI.getInElemTy(SparseToDenseMaskNode::ValuesIdx) ==
+            NI.getInElemTy(SparseToDenseMaskNode::DefaultValueIdx)) &&
+           (NI.getInElemTy(SparseToDenseMaskNode::ValuesIdx) ==
+            NI.getOutElemTy(SparseToDenseMaskNode::ResultIdx));
+
   case Kinded::Kind::IntLookupTableNodeKind:
-  case Kinded::Kind::RescaleQuantizedNodeKind:
     return NI.allInputsAndOutputsHaveSameElemKind({ElemKind::Int8QTy});
 
+  case Kinded::Kind::RescaleQuantizedNodeKind:
+    return NI.allInputsAndOutputsHaveSameElemKind(
+        {ElemKind::Int8QTy, ElemKind::Int16QTy});
+
   case Kinded::Kind::PowNodeKind:
+  case Kinded::Kind::BatchBoxCoxNodeKind:
+  case Kinded::Kind::LayerNormalizationNodeKind:
   case Kinded::Kind::AvgPoolGradNodeKind:
   case Kinded::Kind::QuantizationProfileNodeKind:
   case Kinded::Kind::CPUConvDKKC8NodeKind:
+  case Kinded::Kind::CPUConvIm2ColNodeKind:
+  case Kinded::Kind::CPUConvWinogradNodeKind:
+  case Kinded::Kind::CPUConvFusedNodeKind:
+  case Kinded::Kind::CPUConvFusedAddNodeKind:
+  case Kinded::Kind::CPUConvDepthwisePointwiseNodeKind:
+  case Kinded::Kind::CPUMatMulPackedNodeKind:
+  case Kinded::Kind::BatchMatMulNodeKind:
+  case Kinded::Kind::CPUBatchMatMulNodeKind:
+  case Kinded::Kind::BatchedPairwiseDotProductNodeKind:
+  case Kinded::Kind::LSTMUnitNodeKind:
+  case Kinded::Kind::CPULSTMUnitNodeKind:
   case Kinded::Kind::LocalResponseNormalizationNodeKind:
   case Kinded::Kind::LocalResponseNormalizationGradNodeKind:
   case Kinded::Kind::LogNodeKind:
@@ -199,20 +439,43 @@ bool CPUBackend::isOpSupported(const NodeInfo &NI) const {
       return NI.allInputsAndOutputsHaveSameElemKind({ElemKind::FloatTy});
     }
 
-    return NI.allInputsAndOutputsHaveSameElemKind({ElemKind::Int8QTy},
-                                                  {ConvolutionNode::BiasIdx}) &&
+    // Int16QTy activations are convolved with an Int8QTy filter.
+    return (NI.allInputsAndOutputsHaveSameElemKind(
+                {ElemKind::Int8QTy}, {ConvolutionNode::BiasIdx}) ||
+            (NI.allInputsAndOutputsHaveSameElemKind(
+                 {ElemKind::Int16QTy},
+                 {ConvolutionNode::FilterIdx, ConvolutionNode::BiasIdx}) &&
+             (NI.getInElemTy(ConvolutionNode::FilterIdx) ==
+              ElemKind::Int8QTy))) &&
            (NI.getInElemTy(ConvolutionNode::BiasIdx) == ElemKind::Int32QTy);
 
+  case Kinded::Kind::CPUConvDepthwiseNodeKind:
+    return NI.allInputsAndOutputsHaveSameElemKind({ElemKind::FloatTy}) ||
+           (NI.allInputsAndOutputsHaveSameElemKind(
+                {ElemKind::Int8QTy}, {CPUConvDepthwiseNode::BiasIdx}) &&
+            (NI.getInElemTy(CPUConvDepthwiseNode::BiasIdx) ==
+             ElemKind::Int32QTy));
+
   case Kinded::Kind::BatchedAddNodeKind:
     if (!NI.getInTy(BatchedAddNode::BatchIdx)->isQuantizedType()) {
-      return NI.allInputsAndOutputsHaveSameElemKind({ElemKind::FloatTy});
+      return NI.allInputsAndOutputsHaveSameElemKind(
+          {ElemKind::FloatTy, ElemKind::Float16Ty});
     }
-    // Allow for Int8QTy or Int32QTy for the Slice input.
-    return NI.allInputsAndOutputsHaveSameElemKind({ElemKind::Int8QTy},
-                                                  {BatchedAddNode::SliceIdx}) &&
-           ((NI.getInElemTy(BatchedAddNode::SliceIdx) == ElemKind::Int8QTy) ||
+    // Allow for the type of the Batch or Int32QTy for the Slice input.
+    return NI.allInputsAndOutputsHaveSameElemKind(
+               {ElemKind::Int8QTy, ElemKind::Int16QTy},
+               {BatchedAddNode::SliceIdx}) &&
+           ((NI.getInElemTy(BatchedAddNode::SliceIdx) ==
+             NI.getInElemTy(BatchedAddNode::BatchIdx)) ||
             (NI.getInElemTy(BatchedAddNode::SliceIdx) == ElemKind::Int32QTy));
 
+  case Kinded::Kind::ConvertToNodeKind:
+    return ((NI.getInElemTy(ConvertToNode::InputIdx) == ElemKind::FloatTy) &&
+            (NI.getOutElemTy(ConvertToNode::ResultIdx) ==
+             ElemKind::Float16Ty)) ||
+           ((NI.getInElemTy(ConvertToNode::InputIdx) == ElemKind::Float16Ty) &&
+            (NI.getOutElemTy(ConvertToNode::ResultIdx) == ElemKind::FloatTy));
+
   case Kinded::Kind::GatherNodeKind:
     return NI.allInputsAndOutputsHaveSameElemKind(
                {ElemKind::FloatTy, ElemKind::Int8QTy, ElemKind::Int64ITy},
@@ -276,10 +539,12 @@ bool CPUBackend::isOpSupported(const NodeInfo &NI) const {
   case Kinded::Kind::QuantizeNodeKind:
     return (NI.getInElemTy(QuantizeNode::InputIdx) == ElemKind::FloatTy) &&
            ((NI.getOutElemTy(QuantizeNode::ResultIdx) == ElemKind::Int8QTy) ||
+            (NI.getOutElemTy(QuantizeNode::ResultIdx) == ElemKind::Int16QTy) ||
             (NI.getOutElemTy(QuantizeNode::ResultIdx) == ElemKind::Int32QTy));
 
   case Kinded::Kind::DequantizeNodeKind:
-    return (NI.getInElemTy(DequantizeNode::InputIdx) == ElemKind::Int8QTy) &&
+    return ((NI.getInElemTy(DequantizeNode::InputIdx) == ElemKind::Int8QTy) ||
+            (NI.getInElemTy(DequantizeNode::InputIdx) == ElemKind::Int16QTy)) &&
            (NI.getOutElemTy(DequantizeNode::ResultIdx) == ElemKind::FloatTy);
 
   case Kinded::Kind::SoftMaxNodeKind:
@@ -299,9 +564,15 @@ bool CPUBackend::isOpSupported(const NodeInfo &NI) const {
            (NI.getInElemTy(LengthsSumNode::LengthsIdx) == ElemKind::Int32ITy);
 
   case Kinded::Kind::FusedRowwiseQuantizedSparseLengthsWeightedSumNodeKind:
-    return (NI.getInElemTy(
-                FusedRowwiseQuantizedSparseLengthsWeightedSumNode::DataIdx) ==
-            ElemKind::UInt8FusedQTy) &&
+    return ((NI.getInElemTy(
+                 FusedRowwiseQuantizedSparseLengthsWeightedSumNode::DataIdx) ==
+             ElemKind::UInt8FusedQTy) ||
+            (NI.getInElemTy(
+                 FusedRowwiseQuantizedSparseLengthsWeightedSumNode::DataIdx) ==
+             ElemKind::UInt8FusedFP16QTy) ||
+            (NI.getInElemTy(
+                 FusedRowwiseQuantizedSparseLengthsWeightedSumNode::DataIdx) ==
+             ElemKind::UInt4FusedFP16QTy)) &&
            (NI.getInElemTy(FusedRowwiseQuantizedSparseLengthsWeightedSumNode::
                                WeightsIdx) == ElemKind::FloatTy) &&
            (NI.getInElemTy(FusedRowwiseQuantizedSparseLengthsWeightedSumNode::
@@ -312,6 +583,34 @@ bool CPUBackend::isOpSupported(const NodeInfo &NI) const {
                 FusedRowwiseQuantizedSparseLengthsWeightedSumNode::ResultIdx) ==
             ElemKind::FloatTy);
 
+  case Kinded::Kind::FusedRowwiseQuantizedSparseLengthsMeanNodeKind:
+  case Kinded::Kind::FusedRowwiseQuantizedSparseLengthsMaxNodeKind: {
+    using PoolNode = FusedRowwiseQuantizedSparseLengthsMeanNode;
+    return ((NI.getInElemTy(PoolNode::DataIdx) == ElemKind::UInt8FusedQTy) ||
+            (NI.getInElemTy(PoolNode::DataIdx) ==
+             ElemKind::UInt8FusedFP16QTy) ||
+            (NI.getInElemTy(PoolNode::DataIdx) ==
+             ElemKind::UInt4FusedFP16QTy)) &&
+           (NI.getInElemTy(PoolNode::IndicesIdx) == ElemKind::Int64ITy) &&
+           (NI.getInElemTy(PoolNode::LengthsIdx) == ElemKind::Int32ITy) &&
+           (NI.getOutElemTy(PoolNode::ResultIdx) == ElemKind::FloatTy);
+  }
+
+  case Kinded::Kind::
+      GroupedFusedRowwiseQuantizedSparseLengthsWeightedSumNodeKind: {
+    using GroupedSLWS =
+        GroupedFusedRowwiseQuantizedSparseLengthsWeightedSumNode;
+    return ((NI.getInElemTy(GroupedSLWS::DataIdx) == ElemKind::UInt8FusedQTy) ||
+            (NI.getInElemTy(GroupedSLWS::DataIdx) ==
+             ElemKind::UInt8FusedFP16QTy) ||
+            (NI.getInElemTy(GroupedSLWS::DataIdx) ==
+             ElemKind::UInt4FusedFP16QTy)) &&
+           (NI.getInElemTy(GroupedSLWS::WeightsIdx) == ElemKind::FloatTy) &&
+           (NI.getInElemTy(GroupedSLWS::IndicesIdx) == ElemKind::Int64ITy) &&
+           (NI.getInElemTy(GroupedSLWS::LengthsIdx) == ElemKind::Int32ITy) &&
+           (NI.getOutElemTy(GroupedSLWS::ResultIdx) == ElemKind::FloatTy);
+  }
+
   case Kinded::Kind::RowwiseQuantizedFullyConnectedNodeKind:
     return (NI.getInElemTy(RowwiseQuantizedFullyConnectedNode::InputIdx) ==
             ElemKind::Int8QTy) &&
@@ -326,6 +625,27 @@ bool CPUBackend::isOpSupported(const NodeInfo &NI) const {
            (NI.getOutElemTy(RowwiseQuantizedFullyConnectedNode::ResultIdx) ==
             ElemKind::Int8QTy);
 
+  case Kinded::Kind::DynamicQuantizedFullyConnectedNodeKind:
+    return NI.allInputsAndOutputsHaveSameElemKind(
+               {ElemKind::FloatTy},
+               {DynamicQuantizedFullyConnectedNode::WeightsIdx}) &&
+           (NI.getInElemTy(DynamicQuantizedFullyConnectedNode::WeightsIdx) ==
+            ElemKind::Int8QTy);
+
+  case Kinded::Kind::ChannelwiseQuantizedConvolutionNodeKind:
+    return (NI.getInElemTy(ChannelwiseQuantizedConvolutionNode::InputIdx) ==
+            ElemKind::Int8QTy) &&
+           (NI.getInElemTy(ChannelwiseQuantizedConvolutionNode::FilterIdx) ==
+            ElemKind::Int8QTy) &&
+           (NI.getInElemTy(ChannelwiseQuantizedConvolutionNode::BiasIdx) ==
+            ElemKind::FloatTy) &&
+           (NI.getInElemTy(ChannelwiseQuantizedConvolutionNode::ScalesIdx) ==
+            ElemKind::FloatTy) &&
+           (NI.getInElemTy(ChannelwiseQuantizedConvolutionNode::OffsetsIdx) ==
+            ElemKind::Int32ITy) &&
+           (NI.getOutElemTy(ChannelwiseQuantizedConvolutionNode::ResultIdx) ==
+            ElemKind::Int8QTy);
+
   case Kinded::Kind::SparseToDenseNodeKind:
     return NI.allInputsAndOutputsHaveSameElemKind(
                {ElemKind::FloatTy}, {SparseToDenseNode::IndicesIdx}) &&
@@ -365,12 +685,72 @@ bool CPUBackend::shouldLower(const Node *N) const {
   switch (N->getKind()) {
   case Kinded::Kind::ConvolutionNodeKind:
   case Kinded::Kind::SparseLengthsSumNodeKind:
+  case Kinded::Kind::
+      GroupedFusedRowwiseQuantizedSparseLengthsWeightedSumNodeKind:
+    return false;
+  case Kinded::Kind::ChannelwiseQuantizedConvolutionNodeKind:
+    // Run by a single kernel, which requantizes every output channel, instead
+    // of a Convolution per group or per channel.
+    return false;
+  case Kinded::Kind::BatchMatMulNodeKind:
+    // Float multiplications are done by a single kernel, see
+    // transformPostLowering.
+    return llvm::cast<BatchMatMulNode>(N)->getResult().getElementType() !=
+           ElemKind::FloatTy;
+  case Kinded::Kind::LSTMUnitNodeKind:
+    // Float steps are computed by a single kernel, see transformPostLowering.
+    return llvm::cast<LSTMUnitNode>(N)->getCell().getElementType() !=
+           ElemKind::FloatTy;
+  case Kinded::Kind::SparseLengthsMeanNodeKind:
+  case Kinded::Kind::FusedRowwiseQuantizedSparseLengthsMeanNodeKind:
+    // Float means are computed by the kernels of the sums, which scale the
+    // rows by the inverse of the length of their segment, instead of
+    // dividing the sums by the broadcasted lengths.
+    return N->getNthResult(0).getElementType() != ElemKind::FloatTy;
+  case Kinded::Kind::BucketizeNodeKind:
+    // Searched by a single kernel instead of comparing every element to all
+    // the boundaries in its own nodes.
     return false;
+  case Kinded::Kind::BatchBoxCoxNodeKind:
+    // Float transforms are computed by a single kernel, which shares the
+    // logarithm of both cases.
+    return llvm::cast<BatchBoxCoxNode>(N)->getResult().getElementType() !=
+           ElemKind::FloatTy;
+  case Kinded::Kind::LayerNormalizationNodeKind:
+    // Float rows are normalized by a single kernel, which computes their mean
+    // and variance in one pass, instead of by the reductions and the
+    // broadcasts of the lowering.
+    return llvm::cast<LayerNormalizationNode>(N)
+               ->getResult()
+               .getElementType() != ElemKind::FloatTy;
+  case Kinded::Kind::BatchedPairwiseDotProductNodeKind:
+    // Float interactions are computed by a single kernel, straight from the
+    // inputs, instead of concatenating them and multiplying every pair twice
+    // in a BatchMatMul of which only a triangle is gathered.
+    return llvm::cast<BatchedPairwiseDotProductNode>(N)
+               ->getResult()
+               .getElementType() != ElemKind::FloatTy;
+  case Kinded::Kind::SGDNodeKind:
+    // Float updates are fused by transformPostLowering.
+    return llvm::cast<SGDNode>(N)->getWeight().getElementType() !=
+           ElemKind::FloatTy;
   default:
     return true;
   }
 }
 
+FunctionPassPipeline CPUBackend::getOptimizationPipeline() const {
+  auto pipeline = Backend::getOptimizationPipeline();
+  // Compute the embedding tables of the same shape in a single parallel loop.
+  pipeline.pushFront({FunctionPassID::GroupFusedRowwiseQuantizedSLWS});
+  return pipeline;
+}
+
+size_t CPUBackend::getTraceEventDataSize() const {
+  return GlowCPUPerfCounters ? sizeof(uint64_t) * (1 + kNumPerfCounters)
+                             : sizeof(uint64_t);
+}
+
 std::unique_ptr<CompiledFunction> CPUBackend::createCompiledFunction(
     std::unique_ptr<llvm::orc::GlowJIT> JIT,
     runtime::RuntimeBundle &&runtimeBundle) const {
@@ -383,10 +763,47 @@ CPUBackend::createIRGen(const IRFunction *IR,
                         AllocationsInfo &allocationsInfo) const {
   CPULLVMIRGen *irgen =
       new CPULLVMIRGen(IR, allocationsInfo, "", getLibjitBitcode());
+  bool blockingSet =
+      cpuMatMulBlocking.size() == 3 &&
+      std::find(cpuMatMulBlocking.begin(), cpuMatMulBlocking.end(), 0u) ==
+          cpuMatMulBlocking.end();
+  if (blockingSet) {
+    irgen->setMatMulBlocking(
+        {cpuMatMulBlocking[0], cpuMatMulBlocking[1], cpuMatMulBlocking[2]});
+  } else if (getTarget().empty()) {
+    LOG_IF(WARNING, !cpuMatMulBlocking.empty())
+        << "Ignoring -cpu-matmul-blocking, which needs three positive values";
+    // Detect the caches of the host once. The AVX-512 micro-kernel computes
+    // twice as many columns, and the NEON one computes two.
+    static const MatMulBlocking genericBlocking = getHostMatMulBlocking(3);
+    static const MatMulBlocking avx512Blocking = getHostMatMulBlocking(6);
+    static const MatMulBlocking neonBlocking = getHostMatMulBlocking(2);
+    switch (getLibjitVariant(getTarget())) {
+    case LibjitVariant::AVX512:
+      irgen->setMatMulBlocking(avx512Blocking);
+      break;
+    case LibjitVariant::NEON:
+      irgen->setMatMulBlocking(neonBlocking);
+      break;
+    default:
+      irgen->setMatMulBlocking(genericBlocking);
+      break;
+    }
+  }
   return std::unique_ptr<CPULLVMIRGen>(irgen);
 }
 
 llvm::StringRef CPUBackend::getLibjitBitcode() const {
+  switch (getLibjitVariant(getTarget())) {
+  case LibjitVariant::AVX512:
+    return llvm::StringRef(reinterpret_cast<const char *>(libjit_avx512_bc),
+                           libjit_avx512_bc_size);
+  case LibjitVariant::NEON:
+    return llvm::StringRef(reinterpret_cast<const char *>(libjit_neon_bc),
+                           libjit_neon_bc_size);
+  default:
+    break;
+  }
   return llvm::StringRef(reinterpret_cast<const char *>(libjit_bc),
                          libjit_bc_size);
 }
@@ -18,6 +18,8 @@
 
 #include "CPUDeviceManager.h"
 
+#include "CPULLVMIRGen.h"
+
 #include "glow/Backend/Backend.h"
 #include "glow/Base/Tensor.h"
 #include "glow/LLVMIRCodeGen/LLVMBackend.h"
@@ -48,12 +50,33 @@ public:
 
   bool shouldLower(const Node *N) const override;
 
+  FunctionPassPipeline getOptimizationPipeline() const override;
+
+  bool shouldPlanActivationsOffline() const override { return true; }
+  bool shouldMinimizePeakMemory() const override { return true; }
+
+  /// Only the unpadded bytes of a partial tensor are copied, and the padding
+  /// is zeroed unless its placeholder is ragged.
+  bool supportsPartialTensors() const override { return true; }
+
   runtime::DeviceManager *
   createDeviceManager(const runtime::DeviceConfig &deviceConfig) override {
     return createCPUDeviceManager(deviceConfig);
   }
+
+  /// With -cpu-perf-counters a TraceEvent holds the hardware counters after
+  /// its timestamp.
+  size_t getTraceEventDataSize() const override;
   /// @}
 
+  /// \returns the blocking of the float matmul kernels for a CPU with \p l1,
+  /// \p l2 and \p l3 bytes of data caches shared by \p numThreads threads,
+  /// when the micro-kernel computes \p nr columns: the panels of the
+  /// micro-kernel fit in the L1 cache, a block of A in half of the L2 cache,
+  /// and a panel of B in the share of the L3 cache of a thread.
+  static MatMulBlocking getMatMulBlocking(size_t l1, size_t l2, size_t l3,
+                                          unsigned numThreads, size_t nr);
+
 public:
   /// @name LLVMBackend methods.
   /// This is the implementation of the LLVMBackend interface.
@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 #include "CPUDeviceManager.h"
+#include "CPUBackend.h"
 #include "CPUFunction.h"
 
 #include "llvm/Support/CommandLine.h"
@@ -30,6 +31,95 @@ static llvm::cl::opt<unsigned, /* ExternalStorage */ true> GlowCPUMemoryOpt(
     llvm::cl::desc("CPU DeviceManager maximum memory in kilobytes."),
     llvm::cl::location(GlowCPUMemory));
 
+unsigned GlowCPUIntraOpThreads = 1;
+
+static llvm::cl::opt<unsigned, /* ExternalStorage */ true>
+    GlowCPUIntraOpThreadsOpt(
+        "cpu-intra-op-threads",
+        llvm::cl::desc("Number of threads used by a CPU DeviceManager to "
+                       "execute the kernels of a single inference."),
+        llvm::cl::location(GlowCPUIntraOpThreads));
+
+unsigned CPUDeviceManager::getNumIntraOpThreads(const DeviceConfig &config) {
+  auto it = config.parameters.find("intraOpThreads");
+  if (it != config.parameters.end()) {
+    unsigned numThreads;
+    if (!llvm::StringRef(it->second).getAsInteger(10, numThreads)) {
+      return std::max(1u, numThreads);
+    }
+    LOG(ERROR) << "Invalid intraOpThreads parameter: " << it->second;
+  }
+  return std::max(1u, GlowCPUIntraOpThreads);
+}
+
+unsigned GlowCPUExecutionLanes = 1;
+
+static llvm::cl::opt<unsigned, /* ExternalStorage */ true>
+    GlowCPUExecutionLanesOpt(
+        "cpu-execution-lanes",
+        llvm::cl::desc("Number of inferences a CPU DeviceManager may run "
+                       "concurrently."),
+        llvm::cl::location(GlowCPUExecutionLanes));
+
+unsigned CPUDeviceManager::getNumExecutionLanes(const DeviceConfig &config) {
+  auto it = config.parameters.find("executionLanes");
+  if (it != config.parameters.end()) {
+    unsigned numLanes;
+    if (!llvm::StringRef(it->second).getAsInteger(10, numLanes)) {
+      return std::max(1u, numLanes);
+    }
+    LOG(ERROR) << "Invalid executionLanes parameter: " << it->second;
+  }
+  return std::max(1u, GlowCPUExecutionLanes);
+}
+
+unsigned GlowCPUMemoryBoundRuns = 0;
+
+static llvm::cl::opt<unsigned, /* ExternalStorage */ true>
+    GlowCPUMemoryBoundRunsOpt(
+        "cpu-memory-bound-runs",
+        llvm::cl::desc("Number of runs of memory bound functions a CPU "
+                       "DeviceManager with several execution lanes may run "
+                       "concurrently, 0 for no limit."),
+        llvm::cl::location(GlowCPUMemoryBoundRuns));
+
+unsigned CPUDeviceManager::getMaxMemoryBoundRuns(const DeviceConfig &config) {
+  auto it = config.parameters.find("memoryBoundRuns");
+  if (it != config.parameters.end()) {
+    unsigned numRuns;
+    if (!llvm::StringRef(it->second).getAsInteger(10, numRuns)) {
+      return numRuns;
+    }
+    LOG(ERROR) << "Invalid memoryBoundRuns parameter: " << it->second;
+  }
+  return GlowCPUMemoryBoundRuns;
+}
+
+void CPUDeviceManager::pinThreads(const DeviceConfig &config) {
+  int node = config.getNumaNode();
+  if (node < 0) {
+    return;
+  }
+  numaCPUs_ = getNumaNodeCPUs(node);
+  if (numaCPUs_.empty()) {
+    LOG(WARNING) << "Can't pin CPU device " << config.deviceID
+                 << " to unknown NUMA node " << node;
+    return;
+  }
+  auto pin = [cpus = numaCPUs_]() {
+    if (!setCurrentThreadAffinity(cpus)) {
+      LOG(WARNING) << "Failed to set the affinity of a CPU device thread";
+    }
+  };
+  workThread_.runOnAllThreads(pin).wait();
+  if (intraOpPool_) {
+    intraOpPool_->runOnAllThreads(pin).wait();
+  }
+  for (auto &lane : lanes_) {
+    lane->submit([pin]() { pin(); }).wait();
+  }
+}
+
 DeviceManager *createCPUDeviceManager(const DeviceConfig &config) {
   if (GlowCPUMemory) {
     // Convert command line GlowCPUMemory to bytes from kilobytes.
@@ -67,8 +157,6 @@ void CPUDeviceManager::addNetworkImpl(const Module *module,
                                       ReadyCBTy readyCB) {
   DCHECK(readyCB != nullptr);
 
-  uint64_t allFunctionsMemoryBytes{0};
-
   // First check for uniqueness of the function name.
   for (const auto &func : functions) {
     if (functions_.count(func.first) != 0) {
@@ -92,10 +180,16 @@ void CPUDeviceManager::addNetworkImpl(const Module *module,
                   .str()));
       return;
     }
+  }
 
-    allFunctionsMemoryBytes +=
-        func.second->getRuntimeBundle().getConstantWeightSize();
+  // Collect the constants first, functions with identical weights share them
+  // and only need memory for them once.
+  for (const auto &func : functions) {
+    if (func.second->getRuntimeBundle().getConstants() == nullptr) {
+      func.second->getRuntimeBundle().collectConstants(module);
+    }
   }
+  uint64_t allFunctionsMemoryBytes = getAddedConstantsSize(functions);
 
   if (usedMemoryBytes_ + allFunctionsMemoryBytes > maxMemoryBytes_) {
     readyCB(module,
@@ -106,13 +200,40 @@ void CPUDeviceManager::addNetworkImpl(const Module *module,
 
   // Add to the function name lookup map.
   for (const auto &func : functions) {
-    if (func.second->getRuntimeBundle().getConstants() == nullptr) {
-      func.second->getRuntimeBundle().collectConstants(module);
-    }
+    usedMemoryBytes_ += addConstantsUser(func.second);
+    addNetworkMemoryUsage(
+        func.first, NetworkMemoryUsage(func.second->getRuntimeBundle()));
+    std::lock_guard<std::mutex> lock(functionsLock_);
     functions_.emplace(func.first, func.second);
+    if (static_cast<LLVMCompiledFunction *>(func.second)->isMemoryBound()) {
+      memoryBoundFunctions_.insert(func.first);
+    }
+  }
+
+  // Recompile the functions compiled without full optimizations in the
+  // background, they serve meanwhile.
+  for (const auto &func : functions) {
+    auto *llvmFunc = static_cast<LLVMCompiledFunction *>(func.second);
+    if (!llvmFunc->getTierUpIR()) {
+      continue;
+    }
+    if (!tierUpThread_) {
+      tierUpThread_ = llvm::make_unique<ThreadExecutor>();
+      if (!numaCPUs_.empty()) {
+        tierUpThread_->submit([cpus = numaCPUs_]() {
+          setCurrentThreadAffinity(cpus);
+        });
+      }
+    }
+    {
+      std::lock_guard<std::mutex> lock(functionsLock_);
+      pendingTierUps_.insert(func.first);
+    }
+    tierUpThread_->submit([this, name = func.first, llvmFunc]() {
+      tierUpFunction(name, llvmFunc);
+    });
   }
 
-  usedMemoryBytes_ += allFunctionsMemoryBytes;
   assert(usedMemoryBytes_ <= maxMemoryBytes_);
 
   // Export change in memory usage.
@@ -126,11 +247,26 @@ void CPUDeviceManager::evictNetworkImpl(std::string functionName,
                                         EvictFunctionCBTy evictCB) {
   DCHECK(evictCB != nullptr);
 
+  std::unique_lock<std::mutex> lock(functionsLock_);
   auto it = functions_.find(functionName);
   if (it != functions_.end()) {
-    usedMemoryBytes_ -= it->second->getRuntimeBundle().getConstantWeightSize();
+    // Cancel the recompilation of the function, or wait for it to end if it
+    // already started, as it uses the IR owned by the function.
+    pendingTierUps_.erase(functionName);
+    tierUpDone_.wait(lock, [&]() { return runningTierUp_ != functionName; });
+    std::shared_ptr<CompiledFunction> tiered;
+    auto tieredIt = tieredFunctions_.find(functionName);
+    if (tieredIt != tieredFunctions_.end()) {
+      tiered = std::move(tieredIt->second);
+      tieredFunctions_.erase(tieredIt);
+    }
+    usedMemoryBytes_ -= removeConstantsUser(it->second);
+    removeNetworkMemoryUsage(functionName);
+    memoryBoundFunctions_.erase(functionName);
     functions_.erase(it);
+    lock.unlock();
   } else {
+    lock.unlock();
     evictCB(functionName,
             MAKE_ERR(ErrorValue::ErrorCode::RUNTIME_NET_NOT_FOUND,
                      strFormat("Could not find function with name %s to evict",
@@ -150,8 +286,10 @@ void CPUDeviceManager::runFunctionImpl(
 
   TRACE_EVENT_SCOPE_NAMED(context->getTraceContext(), TraceLevel::RUNTIME,
                           "DeviceManager::run", dmRun);
+  std::unique_lock<std::mutex> lock(functionsLock_);
   auto funcIt = functions_.find(function);
   if (funcIt == functions_.end()) {
+    lock.unlock();
     dmRun.addArg("reason", "function not found");
     TRACE_EVENT_SCOPE_END_NAMED(dmRun);
     resultCB(id,
@@ -162,9 +300,19 @@ void CPUDeviceManager::runFunctionImpl(
   }
 
   CompiledFunction *func = funcIt->second;
+  // Prefer the recompilation of the function with full optimizations.
+  std::shared_ptr<CompiledFunction> tiered;
+  auto tieredIt = tieredFunctions_.find(function);
+  if (tieredIt != tieredFunctions_.end()) {
+    tiered = tieredIt->second;
+    func = tiered.get();
+  }
+  lock.unlock();
 
-  // Run that function.
+  // Run that function, letting its kernels use the intra-op threads.
+  CPUFunction::setIntraOpThreadPool(intraOpPool_.get());
   auto executeErr = func->execute(context.get());
+  CPUFunction::setIntraOpThreadPool(nullptr);
 
   // End the TraceEvent early to avoid time in the CB.
   TRACE_EVENT_SCOPE_END_NAMED(dmRun);
@@ -172,5 +320,139 @@ void CPUDeviceManager::runFunctionImpl(
   // Fire the resultCB.
   resultCB(id, std::move(executeErr), std::move(context));
 }
+
+void CPUDeviceManager::tierUpFunction(const std::string &name,
+                                      LLVMCompiledFunction *function) {
+  {
+    std::lock_guard<std::mutex> lock(functionsLock_);
+    if (!pendingTierUps_.erase(name)) {
+      // The function was evicted.
+      return;
+    }
+    runningTierUp_ = name;
+  }
+
+  CPUBackend backend;
+  auto start = std::chrono::steady_clock::now();
+  std::unique_ptr<CompiledFunction> compiled =
+      backend.compileIRWithoutConstants(function->getTierUpIR());
+  compiled->setTraceInfo(TraceInfo(function->getTraceInfo()));
+  // The constants of the module are cleared once the network is added, share
+  // those of the function instead. They outlive the recompiled function,
+  // which is dropped when the function is evicted.
+  compiled->getRuntimeBundle().setConstants(
+      function->getRuntimeBundle().getConstants());
+  compiled->freeCompilationResources();
+  std::shared_ptr<CompiledFunction> tiered(
+      compiled.release(), [](CompiledFunction *tieredFunction) {
+        tieredFunction->getRuntimeBundle().setConstants(nullptr);
+        delete tieredFunction;
+      });
+  auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - start);
+  VLOG(1) << "Recompiled " << name << " with full optimizations in "
+          << duration.count() << "ms";
+
+  {
+    std::lock_guard<std::mutex> lock(functionsLock_);
+    runningTierUp_.clear();
+    tieredFunctions_[name] = std::move(tiered);
+  }
+  tierUpDone_.notify_all();
+}
+
+RunIdentifierTy
+CPUDeviceManager::runFunction(std::string functionName,
+                              std::unique_ptr<ExecutionContext> context,
+                              ResultCBTy callback) {
+  if (lanes_.empty()) {
+    return QueueBackedDeviceManager::runFunction(
+        std::move(functionName), std::move(context), std::move(callback));
+  }
+
+  RunIdentifierTy id = nextIdentifier_++;
+  auto queueTime = context->isStatsSampled()
+                       ? std::chrono::steady_clock::now()
+                       : std::chrono::steady_clock::time_point();
+  bool memoryBound = maxMemoryBoundRuns_ && isMemoryBound(functionName);
+  PendingRun run{id, std::move(functionName), std::move(context),
+                 std::move(callback), queueTime, memoryBound};
+  if (memoryBound) {
+    std::lock_guard<std::mutex> lock(memoryBoundLock_);
+    if (!stopped_ && numMemoryBoundRuns_ >= maxMemoryBoundRuns_) {
+      pendingMemoryBoundRuns_.push_back(std::move(run));
+      return id;
+    }
+    numMemoryBoundRuns_++;
+  }
+  submitToLane(std::move(run));
+  return id;
+}
+
+void CPUDeviceManager::submitToLane(PendingRun run) {
+  // Pick the lane with the fewest queued or running inferences.
+  size_t lane = 0;
+  for (size_t i = 1, e = lanes_.size(); i < e; i++) {
+    if (laneLoads_[i] < laneLoads_[lane]) {
+      lane = i;
+    }
+  }
+  laneLoads_[lane]++;
+
+  lanes_[lane]->submit([this, lane, run = std::move(run)]() mutable {
+    if (run.context->isStatsSampled()) {
+      Stats()->addLatencyValue("device_queue", run.functionName,
+                               run.queueTime);
+    }
+    if (auto err = checkAbandoned(*run.context, run.functionName)) {
+      run.callback(run.id, std::move(err), std::move(run.context));
+    } else {
+      runFunctionImpl(run.id, std::move(run.functionName),
+                      std::move(run.context), std::move(run.callback));
+    }
+    laneLoads_[lane]--;
+    if (run.memoryBound) {
+      endMemoryBoundRun();
+    }
+  });
+}
+
+void CPUDeviceManager::endMemoryBoundRun() {
+  std::unique_lock<std::mutex> lock(memoryBoundLock_);
+  if (stopped_ || pendingMemoryBoundRuns_.empty()) {
+    numMemoryBoundRuns_--;
+    return;
+  }
+  // The next run takes the place of the one which ended.
+  PendingRun next = std::move(pendingMemoryBoundRuns_.front());
+  pendingMemoryBoundRuns_.pop_front();
+  lock.unlock();
+  submitToLane(std::move(next));
+}
+
+Error CPUDeviceManager::stop(bool block) {
+  // Fail the runs which wait for a lane, they would never start.
+  std::deque<PendingRun> pending;
+  {
+    std::lock_guard<std::mutex> lock(memoryBoundLock_);
+    stopped_ = true;
+    pending.swap(pendingMemoryBoundRuns_);
+  }
+  for (auto &run : pending) {
+    run.callback(run.id,
+                 MAKE_ERR(ErrorValue::ErrorCode::RUNTIME_REQUEST_REFUSED,
+                          "The device was stopped"),
+                 std::move(run.context));
+  }
+  for (auto &lane : lanes_) {
+    lane->stop(block);
+  }
+  auto err = QueueBackedDeviceManager::stop(block);
+  // Stop the recompilations last, the device thread may still queue some.
+  if (tierUpThread_) {
+    tierUpThread_->stop(block);
+  }
+  return err;
+}
 } // namespace runtime
 } // namespace glow
@@ -20,32 +20,185 @@
 #include "glow/Runtime/StatsExporter.h"
 
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
 
 namespace glow {
+
+class LLVMCompiledFunction;
+
 namespace runtime {
 
-/// A class controlling a single CPU thread of execution driving the JIT
-/// backend. Many CPUFunctions may be added, but only one inference is executed
-/// at a time.
+/// A class controlling the CPU threads of execution driving the JIT backend.
+/// Many CPUFunctions may be added. By default only one inference is executed
+/// at a time, on the device thread; with several execution lanes each lane
+/// runs one inference concurrently with the others. The kernels of an
+/// inference may split their outer loops across an optional pool of intra-op
+/// worker threads. Functions compiled without full optimizations by
+/// -llvm-tiered-compile are recompiled with full optimizations in the
+/// background, and the recompiled functions replace them in later runs.
+///
+/// Concurrent runs of functions bound by the DRAM bandwidth, as hinted by the
+/// Partitioner, slow each other down instead of overlapping. With several
+/// lanes, at most a given number of them run at once; the others wait while
+/// the runs of compute bound functions take the free lanes.
 class CPUDeviceManager : public QueueBackedDeviceManager {
   /// Compiled function list by name.
   FunctionMapTy functions_;
 
+  /// Protects functions_ against lookups from the execution lanes while
+  /// networks are added or evicted on the device thread.
+  mutable std::mutex functionsLock_;
+
+  /// Pool of threads helping the device thread execute the kernels of a
+  /// single inference. It is null if intra-op parallelism is disabled.
+  std::unique_ptr<ThreadPool> intraOpPool_;
+
+  /// Threads executing inferences, one per execution lane. It is empty if the
+  /// device has a single lane, in which case inferences run on the device
+  /// thread.
+  std::vector<std::unique_ptr<ThreadExecutor>> lanes_;
+
+  /// Number of inferences queued or running on each of the lanes_.
+  std::unique_ptr<std::atomic<size_t>[]> laneLoads_;
+
+  /// A run waiting for a lane.
+  struct PendingRun {
+    RunIdentifierTy id;
+    std::string functionName;
+    std::unique_ptr<ExecutionContext> context;
+    ResultCBTy callback;
+    std::chrono::steady_clock::time_point queueTime;
+    bool memoryBound;
+  };
+
+  /// Maximum number of runs of memory bound functions queued or running on
+  /// the lanes at once, 0 for no limit.
+  unsigned maxMemoryBoundRuns_{0};
+
+  /// Protects the scheduling of the runs of memory bound functions.
+  std::mutex memoryBoundLock_;
+
+  /// Number of runs of memory bound functions queued or running on the
+  /// lanes. Protected by memoryBoundLock_.
+  unsigned numMemoryBoundRuns_{0};
+
+  /// Runs of memory bound functions waiting for the end of another one, in
+  /// the order they were requested. Protected by memoryBoundLock_.
+  std::deque<PendingRun> pendingMemoryBoundRuns_;
+
+  /// Whether the device is stopped, in which case the pending runs fail.
+  /// Protected by memoryBoundLock_.
+  bool stopped_{false};
+
+  /// Names of the functions which are bound by the DRAM bandwidth. Protected
+  /// by functionsLock_.
+  std::unordered_set<std::string> memoryBoundFunctions_;
+
+  /// Queue \p run on the least loaded lane.
+  void submitToLane(PendingRun run);
+
+  /// Start the next pending run of a memory bound function in place of one
+  /// which ended, if any.
+  void endMemoryBoundRun();
+
+  /// Functions recompiled with full optimizations by name, which run in place
+  /// of the functions of the same name in functions_. They are shared with the
+  /// runs in flight. Protected by functionsLock_.
+  std::unordered_map<std::string, std::shared_ptr<CompiledFunction>>
+      tieredFunctions_;
+
+  /// Names of the functions waiting to be recompiled with full optimizations.
+  /// Protected by functionsLock_.
+  std::unordered_set<std::string> pendingTierUps_;
+
+  /// Name of the function being recompiled, empty if none. Protected by
+  /// functionsLock_.
+  std::string runningTierUp_;
+
+  /// Signalled when the recompilation of runningTierUp_ ends.
+  std::condition_variable tierUpDone_;
+
+  /// Thread recompiling functions with full optimizations, created with the
+  /// first function compiled without them.
+  std::unique_ptr<ThreadExecutor> tierUpThread_;
+
+  /// The CPUs of the NUMA node given by the "numaNode" parameter, which all
+  /// the threads of the device are pinned to. Their first touch places the
+  /// constants and the execution buffers of the device on the node. It is
+  /// empty if the device isn't pinned.
+  std::vector<unsigned> numaCPUs_;
+
+  /// Pin the device thread, the intra-op threads and the execution lanes to
+  /// the NUMA node of \p config, if it gives one.
+  void pinThreads(const DeviceConfig &config);
+
   /// String constant for logging number of in-use devices.
   static constexpr const char *kDevicesUsedCPU = "glow.devices_used.cpu";
 
+  /// \returns the number of threads (including the device thread) used to
+  /// execute a single inference, as requested by the "intraOpThreads"
+  /// parameter of \p config or the -cpu-intra-op-threads option.
+  static unsigned getNumIntraOpThreads(const DeviceConfig &config);
+
+  /// \returns the number of inferences which may run concurrently, as
+  /// requested by the "executionLanes" parameter of \p config or the
+  /// -cpu-execution-lanes option.
+  static unsigned getNumExecutionLanes(const DeviceConfig &config);
+
+  /// \returns the number of runs of memory bound functions which may run
+  /// concurrently, as requested by the "memoryBoundRuns" parameter of
+  /// \p config or the -cpu-memory-bound-runs option, 0 for no limit.
+  static unsigned getMaxMemoryBoundRuns(const DeviceConfig &config);
+
+  /// Recompile \p function named \p name with full optimizations, unless it
+  /// has been evicted meanwhile, and make it run in place of \p function.
+  /// Runs on tierUpThread_.
+  void tierUpFunction(const std::string &name, LLVMCompiledFunction *function);
+
 public:
   explicit CPUDeviceManager(const DeviceConfig &config)
       : QueueBackedDeviceManager(config) {
+    unsigned numThreads = getNumIntraOpThreads(config);
+    if (numThreads > 1) {
+      intraOpPool_ = llvm::make_unique<ThreadPool>(numThreads - 1);
+    }
+    unsigned numLanes = getNumExecutionLanes(config);
+    if (numLanes > 1) {
+      laneLoads_.reset(new std::atomic<size_t>[numLanes]);
+      for (unsigned i = 0; i < numLanes; i++) {
+        laneLoads_[i] = 0;
+        lanes_.emplace_back(llvm::make_unique<ThreadExecutor>());
+      }
+      maxMemoryBoundRuns_ = getMaxMemoryBoundRuns(config);
+    }
+    pinThreads(config);
     Stats()->incrementCounter(kDevicesUsedCPU);
     exportMemoryCounters();
   }
 
   ~CPUDeviceManager() override {
+    // Stop the lanes before the functions they run go away.
+    ERR_TO_VOID(stop(true));
     Stats()->incrementCounter(kDevicesUsedCPU, -1);
     zeroMemoryCounters();
   }
 
+  /// Execute the named Function on the least loaded execution lane, or on the
+  /// device thread if the device has a single lane. A run of a memory bound
+  /// function waits for the end of another one if as many as allowed are
+  /// queued or running.
+  RunIdentifierTy runFunction(std::string functionName,
+                              std::unique_ptr<ExecutionContext> context,
+                              ResultCBTy callback) override;
+
+  /// Stops execution on the device thread and on all execution lanes.
+  Error stop(bool block = true) override;
+
   /// Returns the amount of memory in bytes available on the device when no
   /// models are loaded.
   uint64_t getMaximumMemory() const override;
@@ -62,6 +215,37 @@ public:
   /// compute and bandwidths (used in partitioning).
   DeviceInfo getDeviceInfo() const override;
 
+  /// \returns the number of threads used to execute a single inference.
+  unsigned getNumIntraOpThreads() const {
+    return intraOpPool_ ? intraOpPool_->getNumWorkers() + 1 : 1;
+  }
+
+  /// \returns the number of inferences which may run concurrently.
+  unsigned getNumExecutionLanes() const {
+    return lanes_.empty() ? 1 : lanes_.size();
+  }
+
+  /// \returns the number of runs of memory bound functions which may run
+  /// concurrently, 0 for no limit.
+  unsigned getMaxMemoryBoundRuns() const { return maxMemoryBoundRuns_; }
+
+  /// \returns whether the function \p name is bound by the DRAM bandwidth.
+  bool isMemoryBound(const std::string &name) const {
+    std::lock_guard<std::mutex> lock(functionsLock_);
+    return memoryBoundFunctions_.count(name);
+  }
+
+  /// \returns the CPUs the threads of the device are pinned to, empty if
+  /// they aren't.
+  const std::vector<unsigned> &getNumaCPUs() const { return numaCPUs_; }
+
+  /// \returns the number of functions recompiled with full optimizations
+  /// which run in place of the functions compiled without them.
+  size_t getNumTieredFunctions() const {
+    std::lock_guard<std::mutex> lock(functionsLock_);
+    return tieredFunctions_.size();
+  }
+
 protected:
   void addNetworkImpl(const Module *module, FunctionMapTy functions,
                       ReadyCBTy cb) override;
@@ -14,17 +14,246 @@
  * limitations under the License.
  */
 #include "CPUFunction.h"
+#include "PerfCounters.h"
 
 #include "glow/Graph/PlaceholderBindings.h"
 #include "glow/Support/Compiler.h"
 #include "glow/Support/Memory.h"
+#include "glow/Support/ThreadPool.h"
+
+#include "llvm/Support/Error.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
 
 using namespace glow;
 
+namespace {
+/// Body of a parallel loop in libjit, see libjit_parallel_body.
+using ParallelBodyTy = void (*)(size_t begin, size_t end, void *ctx);
+
+/// Parallel loop runner exposed to libjit, see libjit_parallel_runner.
+using ParallelRunnerTy = void (*)(size_t numIters, ParallelBodyTy body,
+                                  void *ctx);
+
+/// Reader of the hardware counters exposed to libjit, see
+/// libjit_counter_reader.
+using CounterReaderTy = void (*)(uint64_t *counters);
+
+/// The intra-op pool of the current thread. Workers of the pool never have
+/// one, so nested parallel loops run serially.
+thread_local ThreadPool *intraOpPool = nullptr;
+
+/// Split \p numIters iterations of \p body into contiguous chunks, one for
+/// each worker of the intra-op pool of the current thread plus one for the
+/// current thread itself, and wait for all of them to finish.
+void runParallelFor(size_t numIters, ParallelBodyTy body, void *ctx) {
+  ThreadPool *pool = intraOpPool;
+  size_t numChunks =
+      pool ? std::min<size_t>(numIters, pool->getNumWorkers() + 1) : 1;
+  if (numChunks <= 1) {
+    body(0, numIters, ctx);
+    return;
+  }
+
+  size_t chunkSize = numIters / numChunks;
+  size_t remainder = numIters % numChunks;
+  std::vector<std::future<void>> futures;
+  futures.reserve(numChunks - 1);
+  // The first chunks get one extra iteration each to spread the remainder.
+  size_t begin = chunkSize + (remainder > 0);
+  for (size_t i = 1; i < numChunks; i++) {
+    size_t end = begin + chunkSize + (i < remainder);
+    futures.push_back(
+        pool->submit([body, ctx, begin, end]() { body(begin, end, ctx); }));
+    begin = end;
+  }
+  body(0, chunkSize + (remainder > 0), ctx);
+  for (auto &future : futures) {
+    future.wait();
+  }
+}
+} // namespace
+
 CPUFunction::CPUFunction(std::unique_ptr<llvm::orc::GlowJIT> JIT,
                          runtime::RuntimeBundle &&runtimeBundle)
-    : LLVMCompiledFunction(std::move(JIT), std::move(runtimeBundle)) {}
+    : LLVMCompiledFunction(std::move(JIT), std::move(runtimeBundle)) {
+  installParallelRunner();
+  if (GlowCPUPerfCounters) {
+    installCounterReader();
+  }
+}
+
+CPUFunction::~CPUFunction() {
+  if (!perfSummary_.empty()) {
+    dumpPerfCounterSummary(llvm::outs());
+  }
+}
+
+void CPUFunction::setIntraOpThreadPool(ThreadPool *pool) {
+  intraOpPool = pool;
+}
+
+ThreadPool *CPUFunction::getInterOpPool() const { return intraOpPool; }
+
+void *CPUFunction::findHook(llvm::StringRef name) {
+  std::lock_guard<std::mutex> lock(JITLock_);
+  auto sym = JIT_->findSymbol(name);
+  if (!sym) {
+    // Older libjit versions do not provide the hook.
+    llvm::consumeError(sym.takeError());
+    return nullptr;
+  }
+  auto addrOrLLVMError = sym.getAddress();
+  if (!addrOrLLVMError) {
+    LOG(WARNING) << "Failed to install the libjit hook " << name.str() << ": "
+                 << llvm::toString(addrOrLLVMError.takeError());
+    return nullptr;
+  }
+  return reinterpret_cast<void *>(addrOrLLVMError.get());
+}
+
+void CPUFunction::installParallelRunner() {
+  // Without the hook kernels run serially.
+  if (auto *hook = findHook("glow_libjit_parallel_runner")) {
+    *reinterpret_cast<ParallelRunnerTy *>(hook) = &runParallelFor;
+  }
+}
+
+void CPUFunction::installCounterReader() {
+  // Without the hook the counters are written as zeros.
+  if (auto *hook = findHook("glow_libjit_counter_reader")) {
+    *reinterpret_cast<CounterReaderTy *>(hook) = &readPerfCounters;
+  }
+}
+
+void CPUFunction::installRowCache() {
+  // Without the hook the kernels dequantize all rows.
+  auto *hook = findHook("glow_libjit_row_caches");
+  if (!hook || !runtimeBundle_.getConstants()) {
+    return;
+  }
+  auto rowCache =
+      llvm::make_unique<RowCache>(runtimeBundle_, GlowCPURowCacheRows);
+  if (!rowCache->getNumTables()) {
+    return;
+  }
+  *reinterpret_cast<const LibjitRowCaches **>(hook) =
+      rowCache->getLibjitCaches();
+  rowCache_ = std::move(rowCache);
+}
 
 Error CPUFunction::execute(ExecutionContext *context) {
-  return LLVMCompiledFunction::execute(context);
+  if (!GlowCPURowCacheRows) {
+    return LLVMCompiledFunction::execute(context);
+  }
+  std::call_once(rowCacheOnce_, [this]() { installRowCache(); });
+  {
+    std::shared_lock<std::shared_timed_mutex> lock(rowCacheLock_);
+    RETURN_IF_ERR(LLVMCompiledFunction::execute(context));
+  }
+  // Refresh the caches from the lookups of the last runs.
+  uint64_t refreshRuns = std::max(GlowCPURowCacheRefreshRuns, 1u);
+  if (rowCache_ && ++numRowCacheRuns_ % refreshRuns == 0) {
+    std::unique_lock<std::shared_timed_mutex> lock(rowCacheLock_);
+    rowCache_->refresh();
+  }
+  return Error::success();
+}
+
+Error CPUFunction::warmUp() {
+  if (GlowCPURowCacheRows) {
+    std::call_once(rowCacheOnce_, [this]() { installRowCache(); });
+  }
+  return LLVMCompiledFunction::warmUp();
+}
+
+void CPUFunction::freeCompilationResources() {
+  if (GlowCPURowCacheRows && runtimeBundle_.getConstants()) {
+    std::call_once(rowCacheOnce_, [this]() { installRowCache(); });
+  }
+  LLVMCompiledFunction::freeCompilationResources();
+}
+
+void CPUFunction::translateTraceEvents(ExecutionContext *context) const {
+  auto &traceInfo = getTraceInfo();
+  if (!traceInfo.enabled ||
+      traceInfo.dataSize != sizeof(uint64_t) * (1 + kNumPerfCounters)) {
+    LLVMCompiledFunction::translateTraceEvents(context);
+    return;
+  }
+
+  TraceContext *traceContext = context->getTraceContext();
+  if (!traceContext->shouldLog(TraceLevel::OPERATOR)) {
+    return;
+  }
+
+  PlaceholderBindings *bindings = context->getPlaceholderBindings();
+  int tid = TraceEvent::getThreadId();
+  auto &traceEvents = traceContext->getTraceEvents();
+  std::lock_guard<std::mutex> lock(perfSummaryLock_);
+  for (auto &backing : traceInfo.events) {
+    Tensor *backingTensor = bindings->get(backing.first);
+    DCHECK(backingTensor) << "Could not get backing tensor for Placeholder: "
+                          << backing.first->getName().str();
+    auto *slots = reinterpret_cast<const uint64_t *>(
+        backingTensor->getUnsafePtr());
+
+    for (const TraceInfo::Event &event : backing.second) {
+      // Each slot holds the timestamp followed by the counters.
+      const uint64_t *start = slots + event.startIndex * (1 + kNumPerfCounters);
+      if (event.type != TraceEvent::CompleteType) {
+        traceEvents.push_back(
+            {event.name, start[0], event.type, tid, {{"kind", event.kind}}});
+        continue;
+      }
+      const uint64_t *end = slots + event.endIndex * (1 + kNumPerfCounters);
+      uint64_t duration = end[0] - start[0];
+      uint64_t counters[kNumPerfCounters];
+      for (size_t i = 0; i < kNumPerfCounters; i++) {
+        counters[i] = end[1 + i] - start[1 + i];
+      }
+      traceEvents.push_back(
+          {event.name,
+           start[0],
+           duration,
+           tid,
+           {{"kind", event.kind},
+            {"cycles", std::to_string(counters[Cycles])},
+            {"instructions", std::to_string(counters[Instructions])},
+            {"llc_misses", std::to_string(counters[LLCMisses])},
+            {"memory_bytes",
+             std::to_string(counters[LLCMisses] * kCacheLineSize)}}});
+
+      auto &summary = perfSummary_[event.name];
+      summary.kind = event.kind;
+      summary.runs++;
+      summary.duration += duration;
+      for (size_t i = 0; i < kNumPerfCounters; i++) {
+        summary.counters[i] += counters[i];
+      }
+    }
+  }
+}
+
+void CPUFunction::dumpPerfCounterSummary(llvm::raw_ostream &os) const {
+  std::lock_guard<std::mutex> lock(perfSummaryLock_);
+  os << "node                                     kind                    "
+        "     runs    time (us) cycles/run    IPC     MB/s\n";
+  for (const auto &entry : perfSummary_) {
+    const auto &summary = entry.second;
+    double runs = summary.runs;
+    double cycles = summary.counters[Cycles];
+    double ipc = cycles ? summary.counters[Instructions] / cycles : 0;
+    // Bytes per microsecond are MB/s.
+    double bandwidth =
+        summary.duration
+            ? double(summary.counters[LLCMisses] * kCacheLineSize) /
+                  summary.duration
+            : 0;
+    os << llvm::format("%-40s %-24s %8llu %12llu %10.0f %6.2f %8.0f\n",
+                       entry.first().str().c_str(), summary.kind.c_str(),
+                       (unsigned long long)summary.runs,
+                       (unsigned long long)summary.duration, cycles / runs,
+                       ipc, bandwidth);
+  }
 }
@@ -16,6 +16,9 @@
 #ifndef GLOW_BACKENDS_CPU_CPUFUNCTION_H
 #define GLOW_BACKENDS_CPU_CPUFUNCTION_H
 
+#include "PerfCounters.h"
+#include "RowCache.h"
+
 #include "glow/LLVMIRCodeGen/GlowJIT.h"
 #include "glow/LLVMIRCodeGen/LLVMCompiledFunction.h"
 
@@ -23,7 +26,17 @@
 #include "glow/Backend/BackendUtils.h"
 #include "glow/Backend/CompiledFunction.h"
 
+#include "llvm/ADT/StringMap.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+
 namespace glow {
+
+class ThreadPool;
+
 /// A Glow IR function compiled for the CPU using LLVM.
 class CPUFunction final : public LLVMCompiledFunction {
 public:
@@ -32,13 +45,86 @@ public:
 
   /// \name CompiledFunction interface
   ///@{
-  ~CPUFunction() override = default;
+  ~CPUFunction() override;
   Error execute(ExecutionContext *context) override;
 
+  /// Also creates the row caches before the first run, see
+  /// LLVMCompiledFunction::warmUp.
+  Error warmUp() override;
+
+  /// Also creates the row caches first, as they are built from the symbols
+  /// of the constants, see LLVMCompiledFunction::freeCompilationResources.
+  void freeCompilationResources() override;
+
+  /// Read trace events out of this function and write them into \p context.
+  /// With -cpu-perf-counters the events of the kernels have the difference of
+  /// the hardware counters between their start and their end as arguments,
+  /// and are added to the per-node summary.
+  void translateTraceEvents(ExecutionContext *context) const override;
+
   /// \returns the backend used to compile this function.
   virtual std::string getCompileBackendName() const override { return "CPU"; }
   ///@}
   //
+
+  /// Set the pool used by libjit kernels invoked from the calling thread to
+  /// split their outer loops. With a null \p pool (the default) the kernels
+  /// run serially on the calling thread.
+  static void setIntraOpThreadPool(ThreadPool *pool);
+
+  /// Print the table of the time and hardware counters of every node over
+  /// all runs traced with -cpu-perf-counters to \p os. The table is printed
+  /// when the function is destroyed. A low IPC with a high memory bandwidth
+  /// points to a memory-bound kernel.
+  void dumpPerfCounterSummary(llvm::raw_ostream &os) const;
+
+protected:
+  /// Runs the segments of the function on the intra-op pool of the calling
+  /// thread, see setIntraOpThreadPool.
+  ThreadPool *getInterOpPool() const override;
+
+private:
+  /// \returns the address of the global \p name of the JITed libjit code,
+  /// or nullptr if it doesn't have one.
+  void *findHook(llvm::StringRef name);
+
+  /// Install the runtime's parallel runner into the JITed libjit code, so that
+  /// kernels can use the intra-op thread pool of the calling thread.
+  void installParallelRunner();
+
+  /// Install the reader of the hardware counters into the JITed libjit code.
+  void installCounterReader();
+
+  /// Create the caches of the hot rows of the embedding tables and install
+  /// them into the JITed libjit code, see -cpu-row-cache-rows.
+  void installRowCache();
+
+  /// The row caches, or null if they are disabled or there are no tables.
+  /// They are created by the first run, once the constants are collected.
+  std::unique_ptr<RowCache> rowCache_;
+
+  /// Makes the first run create rowCache_.
+  std::once_flag rowCacheOnce_;
+
+  /// Held shared by the runs, and exclusively to refresh rowCache_.
+  std::shared_timed_mutex rowCacheLock_;
+
+  /// Number of runs since the creation of rowCache_.
+  std::atomic<uint64_t> numRowCacheRuns_{0};
+
+  /// The time and hardware counters of a node over all traced runs.
+  struct PerfSummary {
+    std::string kind;
+    uint64_t runs{0};
+    uint64_t duration{0};
+    uint64_t counters[kNumPerfCounters] = {};
+  };
+
+  /// The summary of each node, by name.
+  mutable llvm::StringMap<PerfSummary> perfSummary_;
+
+  /// Protects perfSummary_.
+  mutable std::mutex perfSummaryLock_;
 };
 } // end namespace glow
 
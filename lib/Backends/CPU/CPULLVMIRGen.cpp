@@ -15,6 +15,7 @@
  */
 
 #include "CPULLVMIRGen.h"
+#include "PerfCounters.h"
 
 #include "glow/IR/Instrs.h"
 #include "glow/LLVMIRCodeGen/LLVMBackend.h"
@@ -22,6 +23,7 @@
 
 using namespace glow;
 using llvm::cast;
+using llvm::dyn_cast;
 
 CPULLVMIRGen::CPULLVMIRGen(const IRFunction *F,
                            AllocationsInfo &allocationsInfo,
@@ -29,7 +31,21 @@ CPULLVMIRGen::CPULLVMIRGen(const IRFunction *F,
     : LLVMIRGen(F, allocationsInfo, mainEntryName, libjitBC) {}
 
 void CPULLVMIRGen::generateLLVMIRForModule(llvm::IRBuilder<> &builder) {
-  // TODO: Add here any backend specific logic.
+  // Make the blocking of the matmul kernels a constant of the module, so that
+  // LLVM folds it into the loops of the kernels.
+  auto *blocking = getModule().getGlobalVariable("libjit_matmul_blocking",
+                                                 /* allowInternal */ true);
+  if (blocking) {
+    if (matMulBlocking_.hasValue()) {
+      auto *arrayTy = cast<llvm::ArrayType>(blocking->getValueType());
+      auto *sizeTTy = arrayTy->getElementType();
+      blocking->setInitializer(llvm::ConstantArray::get(
+          arrayTy, {llvm::ConstantInt::get(sizeTTy, matMulBlocking_->mc),
+                    llvm::ConstantInt::get(sizeTTy, matMulBlocking_->kc),
+                    llvm::ConstantInt::get(sizeTTy, matMulBlocking_->nc)}));
+    }
+    blocking->setConstant(true);
+  }
   LLVMIRGen::generateLLVMIRForModule(builder);
 }
 
@@ -111,6 +127,372 @@ void CPULLVMIRGen::generateLLVMIRForInstr(llvm::IRBuilder<> &builder,
                 depthStripsVal});
     break;
   }
+  case Kinded::Kind::CPUConvIm2ColInstKind: {
+    auto *CI = cast<CPUConvIm2ColInst>(I);
+    auto *dest = CI->getDest();
+    auto *src = CI->getSrc();
+    auto *filter = CI->getFilter();
+    auto *bias = CI->getBias();
+    auto *destPtr = emitValueAddress(builder, dest);
+    auto *srcPtr = emitValueAddress(builder, src);
+    auto *filterPtr = emitValueAddress(builder, filter);
+    auto *biasPtr = emitValueAddress(builder, bias);
+
+    auto *destDims = emitValueDims(builder, dest);
+    auto *srcDims = emitValueDims(builder, src);
+    auto *filterDims = emitValueDims(builder, filter);
+    auto *biasDims = emitValueDims(builder, bias);
+
+    auto *kernels = emitConstSizeTArray(builder, CI->getKernels());
+    auto *strides = emitConstSizeTArray(builder, CI->getStrides());
+    auto *pads = emitConstSizeTArray(builder, CI->getPads());
+
+    auto *F = getFunction("conv_im2col", dest->getElementType());
+    createCall(builder, F,
+               {destPtr, srcPtr, filterPtr, biasPtr, destDims, srcDims,
+                filterDims, biasDims, kernels, strides, pads});
+    break;
+  }
+  case Kinded::Kind::CPUConvWinogradInstKind: {
+    auto *CI = cast<CPUConvWinogradInst>(I);
+    auto *dest = CI->getDest();
+    auto *src = CI->getSrc();
+    auto *filter = CI->getFilter();
+    auto *bias = CI->getBias();
+    auto *destPtr = emitValueAddress(builder, dest);
+    auto *srcPtr = emitValueAddress(builder, src);
+    auto *filterPtr = emitValueAddress(builder, filter);
+    auto *biasPtr = emitValueAddress(builder, bias);
+
+    auto *destDims = emitValueDims(builder, dest);
+    auto *srcDims = emitValueDims(builder, src);
+    auto *filterDims = emitValueDims(builder, filter);
+    auto *biasDims = emitValueDims(builder, bias);
+
+    auto *pads = emitConstSizeTArray(builder, CI->getPads());
+
+    auto *F = getFunction("conv_winograd", dest->getElementType());
+    createCall(builder, F,
+               {destPtr, srcPtr, filterPtr, biasPtr, destDims, srcDims,
+                filterDims, biasDims, pads});
+    break;
+  }
+  case Kinded::Kind::CPUConvFusedInstKind:
+  case Kinded::Kind::CPUConvFusedAddInstKind: {
+    // Both instructions share the same kernels, which skip the residual when
+    // they are passed a null pointer.
+    Value *dest, *src, *filter, *bias;
+    Value *residual = nullptr;
+    llvm::ArrayRef<unsigned_t> kernelsVal, stridesVal, padsVal;
+    float minVal, maxVal;
+    if (auto *CI = dyn_cast<CPUConvFusedInst>(I)) {
+      dest = CI->getDest();
+      src = CI->getSrc();
+      filter = CI->getFilter();
+      bias = CI->getBias();
+      kernelsVal = CI->getKernels();
+      stridesVal = CI->getStrides();
+      padsVal = CI->getPads();
+      minVal = CI->getMin();
+      maxVal = CI->getMax();
+    } else {
+      auto *CAI = cast<CPUConvFusedAddInst>(I);
+      dest = CAI->getDest();
+      src = CAI->getSrc();
+      filter = CAI->getFilter();
+      bias = CAI->getBias();
+      residual = CAI->getResidual();
+      kernelsVal = CAI->getKernels();
+      stridesVal = CAI->getStrides();
+      padsVal = CAI->getPads();
+      minVal = CAI->getMin();
+      maxVal = CAI->getMax();
+    }
+    auto *destPtr = emitValueAddress(builder, dest);
+    auto *srcPtr = emitValueAddress(builder, src);
+    auto *filterPtr = emitValueAddress(builder, filter);
+    auto *biasPtr = emitValueAddress(builder, bias);
+    llvm::Value *residualPtr =
+        residual ? emitValueAddress(builder, residual)
+                 : llvm::ConstantPointerNull::get(
+                       getElementType(builder, dest)->getPointerTo());
+
+    auto *destDims = emitValueDims(builder, dest);
+    auto *srcDims = emitValueDims(builder, src);
+    auto *filterDims = emitValueDims(builder, filter);
+    auto *biasDims = emitValueDims(builder, bias);
+
+    auto *kernels = emitConstSizeTArray(builder, kernelsVal);
+    auto *strides = emitConstSizeTArray(builder, stridesVal);
+    auto *pads = emitConstSizeTArray(builder, padsVal);
+    auto *min = emitConstF32(builder, minVal);
+    auto *max = emitConstF32(builder, maxVal);
+
+    // The layout of the filter selects the algorithm.
+    const char *kernelName = filter->dims().size() == 2 ? "conv_im2col_fused"
+                                                        : "conv_winograd_fused";
+    auto *F = getFunction(kernelName, dest->getElementType());
+    createCall(builder, F,
+               {destPtr, srcPtr, filterPtr, biasPtr, residualPtr, destDims,
+                srcDims, filterDims, biasDims, kernels, strides, pads, min,
+                max});
+    break;
+  }
+  case Kinded::Kind::CPUConvDepthwiseInstKind: {
+    auto *CI = cast<CPUConvDepthwiseInst>(I);
+    auto *dest = CI->getDest();
+    auto *src = CI->getSrc();
+    auto *filter = CI->getFilter();
+    auto *bias = CI->getBias();
+    auto *destPtr = emitValueAddress(builder, dest);
+    auto *srcPtr = emitValueAddress(builder, src);
+    auto *filterPtr = emitValueAddress(builder, filter);
+    auto *biasPtr = emitValueAddress(builder, bias);
+
+    auto *destDims = emitValueDims(builder, dest);
+    auto *srcDims = emitValueDims(builder, src);
+    auto *filterDims = emitValueDims(builder, filter);
+    auto *biasDims = emitValueDims(builder, bias);
+
+    auto *kernels = emitConstSizeTArray(builder, CI->getKernels());
+    auto *strides = emitConstSizeTArray(builder, CI->getStrides());
+    auto *pads = emitConstSizeTArray(builder, CI->getPads());
+
+    auto *F = getFunction("conv_depthwise", dest->getElementType());
+    if (!src->getType()->isQuantizedType()) {
+      createCall(builder, F,
+                 {destPtr, srcPtr, filterPtr, biasPtr, destDims, srcDims,
+                  filterDims, biasDims, kernels, strides, pads,
+                  emitConstF32(builder, CI->getMin()),
+                  emitConstF32(builder, CI->getMax())});
+      break;
+    }
+
+    auto *destTy = dest->getType();
+    auto *srcTy = src->getType();
+    auto *filterTy = filter->getType();
+    auto *biasTy = bias->getType();
+
+    // Requantize the bias and the products like the generic int8
+    // convolution does.
+    float matMulScale = srcTy->getScale() * filterTy->getScale();
+    auto biasScaleParam = quantization::quantizeScaleOffset32To8(
+        biasTy->getScale() / matMulScale, biasTy->getOffset());
+    auto outScaleParam = quantization::quantizeScaleOffset32To8(
+        matMulScale / destTy->getScale(), 0);
+
+    auto *destOffset = emitConstI32(builder, destTy->getOffset());
+    auto *srcOffset = emitConstI32(builder, srcTy->getOffset());
+    auto *filterOffset = emitConstI32(builder, filterTy->getOffset());
+    auto *biasOffset = emitConstI32(builder, biasTy->getOffset());
+    auto *biasPre = emitConstI32(builder, biasScaleParam.pre);
+    auto *biasPost = emitConstI32(builder, biasScaleParam.post);
+    auto *biasScale = emitConstI32(builder, biasScaleParam.scale);
+    auto *outPre = emitConstI32(builder, outScaleParam.pre);
+    auto *outPost = emitConstI32(builder, outScaleParam.post);
+    auto *outScale = emitConstI32(builder, outScaleParam.scale);
+
+    createCall(builder, F,
+               {destPtr,    srcPtr,     filterPtr,  biasPtr,   destDims,
+                srcDims,    filterDims, biasDims,   kernels,   strides,
+                pads,       destOffset, srcOffset,  filterOffset,
+                biasOffset, biasPre,    biasPost,   biasScale, outPre,
+                outPost,    outScale});
+    break;
+  }
+  case Kinded::Kind::CPUConvDepthwisePointwiseInstKind: {
+    auto *CI = cast<CPUConvDepthwisePointwiseInst>(I);
+    auto *dest = CI->getDest();
+    auto *src = CI->getSrc();
+    auto *filter = CI->getFilter();
+    auto *bias = CI->getBias();
+    auto *pwFilter = CI->getPointwiseFilter();
+    auto *pwBias = CI->getPointwiseBias();
+    auto *destPtr = emitValueAddress(builder, dest);
+    auto *srcPtr = emitValueAddress(builder, src);
+    auto *filterPtr = emitValueAddress(builder, filter);
+    auto *biasPtr = emitValueAddress(builder, bias);
+    auto *pwFilterPtr = emitValueAddress(builder, pwFilter);
+    auto *pwBiasPtr = emitValueAddress(builder, pwBias);
+
+    auto *destDims = emitValueDims(builder, dest);
+    auto *srcDims = emitValueDims(builder, src);
+    auto *filterDims = emitValueDims(builder, filter);
+    auto *biasDims = emitValueDims(builder, bias);
+    auto *pwFilterDims = emitValueDims(builder, pwFilter);
+    auto *pwBiasDims = emitValueDims(builder, pwBias);
+
+    auto *kernels = emitConstSizeTArray(builder, CI->getKernels());
+    auto *strides = emitConstSizeTArray(builder, CI->getStrides());
+    auto *pads = emitConstSizeTArray(builder, CI->getPads());
+    auto *dwMin = emitConstF32(builder, CI->getDepthwiseMin());
+    auto *dwMax = emitConstF32(builder, CI->getDepthwiseMax());
+    auto *min = emitConstF32(builder, CI->getMin());
+    auto *max = emitConstF32(builder, CI->getMax());
+
+    auto *F = getFunction("conv_depthwise_pointwise", dest->getElementType());
+    createCall(builder, F,
+               {destPtr, srcPtr, filterPtr, biasPtr, pwFilterPtr, pwBiasPtr,
+                destDims, srcDims, filterDims, biasDims, pwFilterDims,
+                pwBiasDims, kernels, strides, pads, dwMin, dwMax, min, max});
+    break;
+  }
+  case Kinded::Kind::CPUMatMulPackedInstKind: {
+    auto *MM = cast<CPUMatMulPackedInst>(I);
+    auto *dest = MM->getDest();
+    auto *lhs = MM->getLHS();
+    auto *packedRHS = MM->getPackedRHS();
+    auto *destPtr = emitValueAddress(builder, dest);
+    auto *lhsPtr = emitValueAddress(builder, lhs);
+    auto *packedRHSPtr = emitValueAddress(builder, packedRHS);
+
+    auto *destDims = emitValueDims(builder, dest);
+    auto *lhsDims = emitValueDims(builder, lhs);
+    auto *packedRHSDims = emitValueDims(builder, packedRHS);
+
+    auto *F = getFunction("matmul_packed", dest->getElementType());
+    createCall(builder, F,
+               {destPtr, lhsPtr, packedRHSPtr, destDims, lhsDims,
+                packedRHSDims});
+    break;
+  }
+  case Kinded::Kind::CPUBatchMatMulInstKind: {
+    auto *BMM = cast<CPUBatchMatMulInst>(I);
+    auto *dest = BMM->getDest();
+    auto *lhs = BMM->getLHS();
+    auto *rhs = BMM->getRHS();
+    auto *destPtr = emitValueAddress(builder, dest);
+    auto *lhsPtr = emitValueAddress(builder, lhs);
+    auto *rhsPtr = emitValueAddress(builder, rhs);
+
+    auto *destDims = emitValueDims(builder, dest);
+    auto *lhsDims = emitValueDims(builder, lhs);
+    auto *rhsDims = emitValueDims(builder, rhs);
+
+    auto *F = getFunction("batch_matmul", dest->getElementType());
+    createCall(builder, F,
+               {destPtr, lhsPtr, rhsPtr, destDims, lhsDims, rhsDims});
+    break;
+  }
+  case Kinded::Kind::CPULSTMUnitInstKind: {
+    auto *LU = cast<CPULSTMUnitInst>(I);
+    auto *cell = LU->getCell();
+    auto *hiddenPtr = emitValueAddress(builder, LU->getHidden());
+    auto *cellPtr = emitValueAddress(builder, cell);
+    auto *gatesPtr = emitValueAddress(builder, LU->getGates());
+    auto *prevCellPtr = emitValueAddress(builder, LU->getPrevCell());
+    auto *cellDims = emitValueDims(builder, cell);
+
+    auto *F = getFunction("lstm_unit", cell->getElementType());
+    createCall(builder, F,
+               {hiddenPtr, cellPtr, gatesPtr, prevCellPtr, cellDims});
+    break;
+  }
+  case Kinded::Kind::CPUBlockSparseMatMulInstKind: {
+    auto *MM = cast<CPUBlockSparseMatMulInst>(I);
+    auto *dest = MM->getDest();
+    auto *lhs = MM->getLHS();
+    auto *values = MM->getValues();
+    auto *destPtr = emitValueAddress(builder, dest);
+    auto *lhsPtr = emitValueAddress(builder, lhs);
+    auto *valuesPtr = emitValueAddress(builder, values);
+    auto *indicesPtr = emitValueAddress(builder, MM->getIndices());
+    auto *offsetsPtr = emitValueAddress(builder, MM->getOffsets());
+
+    auto *destDims = emitValueDims(builder, dest);
+    auto *lhsDims = emitValueDims(builder, lhs);
+    auto *valuesDims = emitValueDims(builder, values);
+
+    auto *F = getFunction("block_sparse_matmul", dest->getElementType());
+    createCall(builder, F,
+               {destPtr, lhsPtr, valuesPtr, indicesPtr, offsetsPtr, destDims,
+                lhsDims, valuesDims});
+    break;
+  }
+  case Kinded::Kind::CPUSGDInstKind:
+  case Kinded::Kind::CPUSGDMomentumInstKind: {
+    Value *dest, *gradient, *weight;
+    Value *destGsum = nullptr, *gsum = nullptr;
+    float L1Decay, L2Decay, learningRate, momentum = 0;
+    unsigned batchSize;
+    if (auto *SGD = dyn_cast<CPUSGDInst>(I)) {
+      dest = SGD->getUpdatedWeight();
+      gradient = SGD->getGradient();
+      weight = SGD->getWeight();
+      L1Decay = SGD->getL1Decay();
+      L2Decay = SGD->getL2Decay();
+      learningRate = SGD->getLearningRate();
+      batchSize = SGD->getBatchSize();
+    } else {
+      auto *SGDM = cast<CPUSGDMomentumInst>(I);
+      dest = SGDM->getUpdatedWeight();
+      destGsum = SGDM->getUpdatedGsum();
+      gradient = SGDM->getGradient();
+      weight = SGDM->getWeight();
+      gsum = SGDM->getGsum();
+      L1Decay = SGDM->getL1Decay();
+      L2Decay = SGDM->getL2Decay();
+      learningRate = SGDM->getLearningRate();
+      momentum = SGDM->getMomentum();
+      batchSize = SGDM->getBatchSize();
+    }
+    auto *nullPtr = llvm::ConstantPointerNull::get(
+        getElementType(builder, dest)->getPointerTo());
+    auto *destPtr = emitValueAddress(builder, dest);
+    llvm::Value *destGsumPtr =
+        destGsum ? emitValueAddress(builder, destGsum) : nullPtr;
+    auto *gradientPtr = emitValueAddress(builder, gradient);
+    auto *weightPtr = emitValueAddress(builder, weight);
+    llvm::Value *gsumPtr = gsum ? emitValueAddress(builder, gsum) : nullPtr;
+    auto *size = emitConstSizeT(builder, dest->size());
+
+    auto *F = getFunction("sgd", dest->getElementType());
+    createCall(builder, F,
+               {destPtr, destGsumPtr, gradientPtr, weightPtr, gsumPtr, size,
+                emitConstF32(builder, L1Decay), emitConstF32(builder, L2Decay),
+                emitConstF32(builder, learningRate),
+                emitConstF32(builder, momentum),
+                emitConstF32(builder, batchSize)});
+    break;
+  }
+  case Kinded::Kind::CPUSparseSGDInstKind: {
+    auto *SGD = cast<CPUSparseSGDInst>(I);
+    auto *dest = SGD->getUpdatedWeight();
+    auto *weight = SGD->getWeight();
+    auto *destGrad = SGD->getDestGrad();
+    auto *destPtr = emitValueAddress(builder, dest);
+    auto *weightPtr = emitValueAddress(builder, weight);
+    auto *destGradPtr = emitValueAddress(builder, destGrad);
+    auto *weightsPtr = emitValueAddress(builder, SGD->getWeights());
+    auto *indicesPtr = emitValueAddress(builder, SGD->getIndices());
+    auto *lengthsPtr = emitValueAddress(builder, SGD->getLengths());
+    auto *segments = emitConstSizeT(builder, SGD->getLengths()->dims()[0]);
+    auto *lineSize =
+        emitConstSizeT(builder, destGrad->size() / destGrad->dims()[0]);
+    auto *weightSize = emitConstSizeT(builder, weight->size());
+
+    auto *F = getFunction("sparse_sgd", dest->getElementType());
+    createCall(builder, F,
+               {destPtr, weightPtr, destGradPtr, weightsPtr, indicesPtr,
+                lengthsPtr, segments, lineSize, weightSize,
+                emitConstF32(builder, SGD->getLearningRate()),
+                emitConstF32(builder, SGD->getBatchSize())});
+    break;
+  }
+  case Kinded::Kind::TraceEventInstKind: {
+    if (!GlowCPUPerfCounters) {
+      LLVMIRGen::generateLLVMIRForInstr(builder, I);
+      break;
+    }
+    // The slots of the event data hold the counters after the timestamp, see
+    // CPUBackend::getTraceEventDataSize.
+    auto *TEI = cast<TraceEventInst>(I);
+    auto *offset = emitConstSizeT(builder, TEI->getIndex());
+    auto *dataPtr = emitValueAddress(builder, TEI->getData());
+    auto *F = getFunction("write_perf_counters");
+    createCall(builder, F, {dataPtr, offset});
+    break;
+  }
   default:
     LLVMIRGen::generateLLVMIRForInstr(builder, I);
   }
@@ -18,11 +18,24 @@
 
 #include "glow/LLVMIRCodeGen/LLVMIRGen.h"
 
+#include "llvm/ADT/Optional.h"
+
 namespace glow {
 
+/// The blocking parameters of the float matmul kernels of libjit, see
+/// libjit_matmul_blocking in libjit_matmul.cpp.
+struct MatMulBlocking {
+  size_t mc;
+  size_t kc;
+  size_t nc;
+};
+
 /// This is a class containing a common logic for the generation of the LLVM IR
 /// from an IRFunction. The primary clients of this class are JITs and bundlers.
 class CPULLVMIRGen : public LLVMIRGen {
+  /// The blocking of the matmul kernels, or None to keep the defaults of
+  /// libjit.
+  llvm::Optional<MatMulBlocking> matMulBlocking_;
 
 public:
   /// Destructor
@@ -44,6 +57,11 @@ public:
       llvm::Value *loopCount) override;
   /// Emit LLVM-IR for the whole IRFunction.
   virtual void generateLLVMIRForModule(llvm::IRBuilder<> &builder) override;
+
+  /// Make the matmul kernels of the module use \p blocking.
+  void setMatMulBlocking(const MatMulBlocking &blocking) {
+    matMulBlocking_ = blocking;
+  }
 };
 
 } // namespace glow
@@ -34,6 +34,143 @@ BB.newBackendSpecificInstr("CPUConvDKKC8")
     .addMember(MemberType::Unsigned, "Group")
     .autoIRGen();
 
+BB.newBackendSpecificInstr("CPUConvIm2Col")
+    .addOperand("Dest", OperandKind::Out)
+    .addOperand("Src", OperandKind::In)
+    .addOperand("Filter", OperandKind::In)
+    .addOperand("Bias", OperandKind::In)
+    .addMember(MemberType::VectorUnsigned, "Kernels")
+    .addMember(MemberType::VectorUnsigned, "Strides")
+    .addMember(MemberType::VectorUnsigned, "Pads")
+    .autoIRGen();
+
+BB.newBackendSpecificInstr("CPUConvWinograd")
+    .addOperand("Dest", OperandKind::Out)
+    .addOperand("Src", OperandKind::In)
+    .addOperand("Filter", OperandKind::In)
+    .addOperand("Bias", OperandKind::In)
+    .addMember(MemberType::VectorUnsigned, "Pads")
+    .autoIRGen();
+
+BB.newBackendSpecificInstr("CPUConvFused")
+    .addOperand("Dest", OperandKind::Out)
+    .addOperand("Src", OperandKind::In)
+    .addOperand("Filter", OperandKind::In)
+    .addOperand("Bias", OperandKind::In)
+    .addMember(MemberType::VectorUnsigned, "Kernels")
+    .addMember(MemberType::VectorUnsigned, "Strides")
+    .addMember(MemberType::VectorUnsigned, "Pads")
+    .addMember(MemberType::Float, "Min")
+    .addMember(MemberType::Float, "Max")
+    .autoIRGen();
+
+BB.newBackendSpecificInstr("CPUConvFusedAdd")
+    .addOperand("Dest", OperandKind::Out)
+    .addOperand("Src", OperandKind::In)
+    .addOperand("Filter", OperandKind::In)
+    .addOperand("Bias", OperandKind::In)
+    .addOperand("Residual", OperandKind::In)
+    .addMember(MemberType::VectorUnsigned, "Kernels")
+    .addMember(MemberType::VectorUnsigned, "Strides")
+    .addMember(MemberType::VectorUnsigned, "Pads")
+    .addMember(MemberType::Float, "Min")
+    .addMember(MemberType::Float, "Max")
+    .autoIRGen();
+
+BB.newBackendSpecificInstr("CPUConvDepthwise")
+    .addOperand("Dest", OperandKind::Out)
+    .addOperand("Src", OperandKind::In)
+    .addOperand("Filter", OperandKind::In)
+    .addOperand("Bias", OperandKind::In)
+    .addMember(MemberType::VectorUnsigned, "Kernels")
+    .addMember(MemberType::VectorUnsigned, "Strides")
+    .addMember(MemberType::VectorUnsigned, "Pads")
+    .addMember(MemberType::Float, "Min")
+    .addMember(MemberType::Float, "Max")
+    .autoIRGen();
+
+BB.newBackendSpecificInstr("CPUConvDepthwisePointwise")
+    .addOperand("Dest", OperandKind::Out)
+    .addOperand("Src", OperandKind::In)
+    .addOperand("Filter", OperandKind::In)
+    .addOperand("Bias", OperandKind::In)
+    .addOperand("PointwiseFilter", OperandKind::In)
+    .addOperand("PointwiseBias", OperandKind::In)
+    .addMember(MemberType::VectorUnsigned, "Kernels")
+    .addMember(MemberType::VectorUnsigned, "Strides")
+    .addMember(MemberType::VectorUnsigned, "Pads")
+    .addMember(MemberType::Float, "DepthwiseMin")
+    .addMember(MemberType::Float, "DepthwiseMax")
+    .addMember(MemberType::Float, "Min")
+    .addMember(MemberType::Float, "Max")
+    .autoIRGen();
+
+BB.newBackendSpecificInstr("CPUMatMulPacked")
+    .addOperand("Dest", OperandKind::Out)
+    .addOperand("LHS", OperandKind::In)
+    .addOperand("PackedRHS", OperandKind::In)
+    .autoIRGen();
+
+BB.newBackendSpecificInstr("CPUBlockSparseMatMul")
+    .addOperand("Dest", OperandKind::Out)
+    .addOperand("LHS", OperandKind::In)
+    .addOperand("Values", OperandKind::In)
+    .addOperand("Indices", OperandKind::In)
+    .addOperand("Offsets", OperandKind::In)
+    .autoIRGen();
+
+BB.newBackendSpecificInstr("CPUBatchMatMul")
+    .addOperand("Dest", OperandKind::Out)
+    .addOperand("LHS", OperandKind::In)
+    .addOperand("RHS", OperandKind::In)
+    .autoIRGen();
+
+BB.newBackendSpecificInstr("CPULSTMUnit")
+    .addOperand("Hidden", OperandKind::Out)
+    .addOperand("Cell", OperandKind::Out)
+    .addOperand("Gates", OperandKind::In)
+    .addOperand("PrevCell", OperandKind::In)
+    .inplaceOperand({"Cell", "PrevCell"})
+    .autoIRGen();
+
+BB.newBackendSpecificInstr("CPUSGD")
+    .addOperand("UpdatedWeight", OperandKind::Out)
+    .addOperand("Gradient", OperandKind::In)
+    .addOperand("Weight", OperandKind::In)
+    .addMember(MemberType::Float, "L1Decay")
+    .addMember(MemberType::Float, "L2Decay")
+    .addMember(MemberType::Float, "LearningRate")
+    .addMember(MemberType::Unsigned, "BatchSize")
+    .inplaceOperand({"UpdatedWeight", "Weight"})
+    .autoIRGen();
+
+BB.newBackendSpecificInstr("CPUSGDMomentum")
+    .addOperand("UpdatedWeight", OperandKind::Out)
+    .addOperand("UpdatedGsum", OperandKind::Out)
+    .addOperand("Gradient", OperandKind::In)
+    .addOperand("Weight", OperandKind::In)
+    .addOperand("Gsum", OperandKind::In)
+    .addMember(MemberType::Float, "L1Decay")
+    .addMember(MemberType::Float, "L2Decay")
+    .addMember(MemberType::Float, "LearningRate")
+    .addMember(MemberType::Float, "Momentum")
+    .addMember(MemberType::Unsigned, "BatchSize")
+    .inplaceOperand({"UpdatedWeight", "Weight"})
+    .inplaceOperand({"UpdatedGsum", "Gsum"})
+    .autoIRGen();
+
+BB.newBackendSpecificInstr("CPUSparseSGD")
+    .addOperand("UpdatedWeight", OperandKind::Out)
+    .addOperand("Weight", OperandKind::In)
+    .addOperand("DestGrad", OperandKind::In)
+    .addOperand("Weights", OperandKind::In)
+    .addOperand("Indices", OperandKind::In)
+    .addOperand("Lengths", OperandKind::In)
+    .addMember(MemberType::Float, "LearningRate")
+    .addMember(MemberType::Unsigned, "BatchSize")
+    .inplaceOperand({"UpdatedWeight", "Weight"})
+    .autoIRGen();
+
 BB.includeBackendSpecificVerification("glow/CPUSpecificInstrsVerification.h");
 
 #endif // GLOW_WITH_CPU
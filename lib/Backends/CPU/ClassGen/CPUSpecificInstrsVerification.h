@@ -33,4 +33,170 @@ void CPUConvDKKC8Inst::verify() const {
          "Invalid Element Type");
 }
 
+void CPUConvIm2ColInst::verify() const {
+  assert(getFilter()->dims()[0] ==
+             getKernels()[0] * getKernels()[1] * getSrc()->dims()[3] &&
+         "Invalid filter rows.");
+  assert(getFilter()->dims()[1] == getDest()->dims()[3] &&
+         "Invalid filter columns.");
+  assert(getDest()->getElementType() == getSrc()->getElementType() &&
+         "Invalid Element Type");
+  assert(getDest()->getElementType() == getFilter()->getElementType() &&
+         "Invalid Element Type");
+  assert(getDest()->getElementType() == getBias()->getElementType() &&
+         "Invalid Element Type");
+}
+
+void CPUConvWinogradInst::verify() const {
+  assert(getFilter()->dims()[0] == 16 &&
+         getFilter()->dims()[1] == getSrc()->dims()[3] &&
+         getFilter()->dims()[2] == getDest()->dims()[3] &&
+         "Invalid filter shape.");
+  assert(getDest()->getElementType() == getSrc()->getElementType() &&
+         "Invalid Element Type");
+  assert(getDest()->getElementType() == getFilter()->getElementType() &&
+         "Invalid Element Type");
+  assert(getDest()->getElementType() == getBias()->getElementType() &&
+         "Invalid Element Type");
+}
+
+void CPUConvFusedInst::verify() const {
+  auto filter = getFilter()->dims();
+  assert((filter.size() == 2 ? filter[1] : filter[2]) ==
+             getDest()->dims()[3] &&
+         "Invalid filter shape.");
+  assert(getDest()->getElementType() == getSrc()->getElementType() &&
+         "Invalid Element Type");
+  assert(getDest()->getElementType() == getFilter()->getElementType() &&
+         "Invalid Element Type");
+  assert(getDest()->getElementType() == getBias()->getElementType() &&
+         "Invalid Element Type");
+}
+
+void CPUConvDepthwiseInst::verify() const {
+  assert(getFilter()->dims()[1] == getSrc()->dims()[3] &&
+         getDest()->dims()[3] == getSrc()->dims()[3] &&
+         "Invalid filter shape.");
+  assert(getDest()->getElementType() == getSrc()->getElementType() &&
+         "Invalid Element Type");
+  assert(getDest()->getElementType() == getFilter()->getElementType() &&
+         "Invalid Element Type");
+}
+
+void CPUConvDepthwisePointwiseInst::verify() const {
+  assert(getFilter()->dims()[1] == getSrc()->dims()[3] &&
+         getPointwiseFilter()->dims()[0] == getSrc()->dims()[3] &&
+         getPointwiseFilter()->dims()[1] == getDest()->dims()[3] &&
+         "Invalid filter shape.");
+  assert(getDest()->getElementType() == ElemKind::FloatTy &&
+         getSrc()->getElementType() == ElemKind::FloatTy &&
+         "Invalid Element Type");
+}
+
+void CPUConvFusedAddInst::verify() const {
+  auto filter = getFilter()->dims();
+  assert((filter.size() == 2 ? filter[1] : filter[2]) ==
+             getDest()->dims()[3] &&
+         "Invalid filter shape.");
+  assert(getDest()->getType() == getResidual()->getType() &&
+         "Invalid residual type");
+  assert(getDest()->getElementType() == getSrc()->getElementType() &&
+         "Invalid Element Type");
+  assert(getDest()->getElementType() == getFilter()->getElementType() &&
+         "Invalid Element Type");
+  assert(getDest()->getElementType() == getBias()->getElementType() &&
+         "Invalid Element Type");
+}
+
+void CPUMatMulPackedInst::verify() const {
+  auto dest = getDest()->dims();
+  auto packed = getPackedRHS()->dims();
+  assert(getLHS()->dims()[0] == dest[0] && "Invalid number of rows");
+  assert(getLHS()->dims()[1] == packed[1] && "Invalid inner dimension");
+  assert(packed[0] == (dest[1] + packed[2] - 1) / packed[2] &&
+         "Invalid number of panels");
+  assert(getDest()->getElementType() == getLHS()->getElementType() &&
+         "Invalid Element Type");
+  assert(getDest()->getElementType() == getPackedRHS()->getElementType() &&
+         "Invalid Element Type");
+}
+
+void CPUBlockSparseMatMulInst::verify() const {
+  auto dest = getDest()->dims();
+  auto values = getValues()->dims();
+  assert(getLHS()->dims()[0] == dest[0] && "Invalid number of rows");
+  assert(values[1] == values[2] && "Blocks must be square");
+  assert(getLHS()->dims()[1] % values[1] == 0 && "Invalid inner dimension");
+  assert(dest[1] % values[1] == 0 && "Invalid number of columns");
+  assert(getIndices()->dims()[0] == values[0] && "Invalid number of indices");
+  assert(getOffsets()->dims()[0] == dest[1] / values[1] + 1 &&
+         "Invalid number of offsets");
+  assert(getDest()->getElementType() == getLHS()->getElementType() &&
+         "Invalid Element Type");
+  assert(getDest()->getElementType() == getValues()->getElementType() &&
+         "Invalid Element Type");
+  (void)dest;
+  (void)values;
+}
+
+void CPUBatchMatMulInst::verify() const {
+  auto dest = getDest()->dims();
+  auto lhs = getLHS()->dims();
+  auto rhs = getRHS()->dims();
+  assert(lhs[0] == dest[0] && "Invalid number of batches");
+  assert((rhs[0] == lhs[0] || rhs[0] == 1) && "Invalid number of RHS batches");
+  assert(lhs[1] == dest[1] && "Invalid number of rows");
+  assert(lhs[2] == rhs[1] && "Invalid inner dimension");
+  assert(rhs[2] == dest[2] && "Invalid number of columns");
+  assert(getDest()->getElementType() == getLHS()->getElementType() &&
+         "Invalid Element Type");
+  assert(getDest()->getElementType() == getRHS()->getElementType() &&
+         "Invalid Element Type");
+  (void)dest;
+  (void)lhs;
+  (void)rhs;
+}
+
+void CPULSTMUnitInst::verify() const {
+  auto gates = getGates()->dims();
+  auto cell = getPrevCell()->dims();
+  assert(gates[0] == cell[0] && "Invalid number of batches");
+  assert(gates[1] == 4 * cell[1] && "Invalid number of gates");
+  assert(getCell()->getType() == getPrevCell()->getType() &&
+         "Invalid cell type");
+  assert(getHidden()->getType() == getPrevCell()->getType() &&
+         "Invalid hidden type");
+  (void)gates;
+  (void)cell;
+}
+
+void CPUSGDInst::verify() const {
+  assert(getGradient()->getType() == getWeight()->getType() &&
+         "Invalid gradient type");
+  assert(getUpdatedWeight()->getType() == getWeight()->getType() &&
+         "Invalid updated weight type");
+}
+
+void CPUSGDMomentumInst::verify() const {
+  assert(getGradient()->getType() == getWeight()->getType() &&
+         "Invalid gradient type");
+  assert(getGsum()->getType() == getWeight()->getType() && "Invalid gsum type");
+  assert(getUpdatedWeight()->getType() == getWeight()->getType() &&
+         "Invalid updated weight type");
+  assert(getUpdatedGsum()->getType() == getWeight()->getType() &&
+         "Invalid updated gsum type");
+}
+
+void CPUSparseSGDInst::verify() const {
+  assert(getUpdatedWeight()->getType() == getWeight()->getType() &&
+         "Invalid updated weight type");
+  assert(getDestGrad()->dims()[0] == getLengths()->dims()[0] &&
+         "Mismatching DestGrad and Lengths segments");
+  assert(getDestGrad()->dims().drop_front() ==
+             getWeight()->dims().drop_front() &&
+         "Mismatching DestGrad and Weight rows");
+  assert(getWeights()->dims() == getIndices()->dims() &&
+         "Weights and Indices must have the same shape");
+}
+
 #endif // GLOW_WITH_CPU
@@ -33,6 +33,174 @@ BB.newNode("CPUConvDKKC8")
     .setDocstring("This is a cpu-specific convolution implementation where the "
                   "filter is transposed to the shape [D/8, K, K, C, 8]");
 
+BB.newNode("CPUConvIm2Col")
+    .addInput("Input")
+    .addInput("Filter")
+    .addInput("Bias")
+    .addMember(MemberType::VectorUnsigned, "Kernels")
+    .addMember(MemberType::VectorUnsigned, "Strides")
+    .addMember(MemberType::VectorUnsigned, "Pads")
+    .addResultFromCtorArg()
+    .setDocstring("This is a cpu-specific convolution implemented as a "
+                  "matrix multiplication of the input patches (im2col), where "
+                  "the filter is transposed to the shape [K * K * C, D]");
+
+BB.newNode("CPUConvWinograd")
+    .addInput("Input")
+    .addInput("Filter")
+    .addInput("Bias")
+    .addMember(MemberType::VectorUnsigned, "Pads")
+    .addResultFromCtorArg()
+    .setDocstring("This is a cpu-specific 3x3 stride 1 convolution using the "
+                  "Winograd F(2x2, 3x3) algorithm, where the filter is "
+                  "transformed to the shape [16, C, D]");
+
+BB.newNode("CPUConvFused")
+    .addInput("Input")
+    .addInput("Filter")
+    .addInput("Bias")
+    .addMember(MemberType::VectorUnsigned, "Kernels")
+    .addMember(MemberType::VectorUnsigned, "Strides")
+    .addMember(MemberType::VectorUnsigned, "Pads")
+    .addMember(MemberType::Float, "Min")
+    .addMember(MemberType::Float, "Max")
+    .addResultFromCtorArg()
+    .setDocstring("This is a cpu-specific im2col or Winograd convolution, "
+                  "depending on whether the filter has the shape "
+                  "[K * K * C, D] or [16, C, D], whose result is clamped to "
+                  "[Min, Max] as it is written back");
+
+BB.newNode("CPUConvFusedAdd")
+    .addInput("Input")
+    .addInput("Filter")
+    .addInput("Bias")
+    .addInput("Residual")
+    .addMember(MemberType::VectorUnsigned, "Kernels")
+    .addMember(MemberType::VectorUnsigned, "Strides")
+    .addMember(MemberType::VectorUnsigned, "Pads")
+    .addMember(MemberType::Float, "Min")
+    .addMember(MemberType::Float, "Max")
+    .addResultFromCtorArg()
+    .setDocstring("This is a CPUConvFused convolution that also adds Residual "
+                  "to its result before clamping it");
+
+BB.newNode("CPUConvDepthwise")
+    .addInput("Input")
+    .addInput("Filter")
+    .addInput("Bias")
+    .addMember(MemberType::VectorUnsigned, "Kernels")
+    .addMember(MemberType::VectorUnsigned, "Strides")
+    .addMember(MemberType::VectorUnsigned, "Pads")
+    .addMember(MemberType::Float, "Min")
+    .addMember(MemberType::Float, "Max")
+    .addResultFromCtorArg()
+    .setDocstring("This is a cpu-specific depthwise convolution, with a group "
+                  "per channel, where the filter is transposed to the shape "
+                  "[K * K, C] so that the channels are vectorized. Float "
+                  "results are clamped to [Min, Max] as they are written "
+                  "back");
+
+BB.newNode("CPUConvDepthwisePointwise")
+    .addInput("Input")
+    .addInput("Filter")
+    .addInput("Bias")
+    .addInput("PointwiseFilter")
+    .addInput("PointwiseBias")
+    .addMember(MemberType::VectorUnsigned, "Kernels")
+    .addMember(MemberType::VectorUnsigned, "Strides")
+    .addMember(MemberType::VectorUnsigned, "Pads")
+    .addMember(MemberType::Float, "DepthwiseMin")
+    .addMember(MemberType::Float, "DepthwiseMax")
+    .addMember(MemberType::Float, "Min")
+    .addMember(MemberType::Float, "Max")
+    .addResultFromCtorArg()
+    .setDocstring("This is a CPUConvDepthwise convolution, clamped to "
+                  "[DepthwiseMin, DepthwiseMax], followed by a pointwise "
+                  "convolution whose filter is transposed to the shape [C, D], "
+                  "clamped to [Min, Max]. The depthwise results are computed "
+                  "in blocks of pixels that are multiplied while they are in "
+                  "cache");
+
+BB.newBackendSpecificNode("CPUMatMulPacked")
+    .addInput("LHS")
+    .addInput("PackedRHS")
+    .addResultFromCtorArg()
+    .setDocstring("This is a cpu-specific MatMul implementation where the "
+                  "constant RHS of shape [K, N] is packed into panels of the "
+                  "shape [ceil(N/32), K, 32], zero padded in the last panel");
+
+BB.newBackendSpecificNode("CPUBlockSparseMatMul")
+    .addInput("LHS")
+    .addInput("Values")
+    .addInput("Indices")
+    .addInput("Offsets")
+    .addResultFromCtorArg()
+    .setDocstring("This is a cpu-specific MatMul implementation where only the "
+                  "non-zero B x B blocks of the constant RHS are stored. The "
+                  "non-zero blocks of the j-th column of blocks of the RHS "
+                  "are Values[Offsets[j]:Offsets[j+1]], and Indices holds the "
+                  "row of blocks of the RHS of each of them");
+
+BB.newBackendSpecificNode("CPUBatchMatMul")
+    .addInput("LHS")
+    .addInput("RHS")
+    .addResultFromCtorArg()
+    .setDocstring("This is a cpu-specific BatchMatMul that multiplies all the "
+                  "batches of LHS of shape [B, M, K] in a single kernel. RHS "
+                  "is of shape [B, K, N], or [1, K, N] if the same matrix "
+                  "multiplies all the batches");
+
+BB.newNode("CPULSTMUnit")
+    .addInput("Gates")
+    .addInput("PrevCell")
+    .addResult("PrevCell.getType()", "Hidden")
+    .addResult("PrevCell.getType()", "Cell")
+    .setDocstring("This is a cpu-specific LSTMUnit, which computes the gates "
+                  "and the hidden and cell states of each element in a "
+                  "single pass");
+
+BB.newNode("CPUSGD")
+    .addInput("Gradient")
+    .addInput("Weight")
+    .addMember(MemberType::Float, "L1Decay")
+    .addMember(MemberType::Float, "L2Decay")
+    .addMember(MemberType::Float, "LearningRate")
+    .addMember(MemberType::Unsigned, "BatchSize")
+    .addResult("Weight.getType()", "UpdatedWeight")
+    .setDocstring("This is a cpu-specific SGD update without momentum, which "
+                  "applies the weight decays and the learning rate to each "
+                  "weight in a single pass");
+
+BB.newNode("CPUSGDMomentum")
+    .addInput("Gradient")
+    .addInput("Weight")
+    .addInput("Gsum")
+    .addMember(MemberType::Float, "L1Decay")
+    .addMember(MemberType::Float, "L2Decay")
+    .addMember(MemberType::Float, "LearningRate")
+    .addMember(MemberType::Float, "Momentum")
+    .addMember(MemberType::Unsigned, "BatchSize")
+    .addResult("Weight.getType()", "UpdatedWeight")
+    .addResult("Gsum.getType()", "UpdatedGsum")
+    .setDocstring("This is a cpu-specific SGD update with momentum, which "
+                  "updates each weight and its accumulated step Gsum in a "
+                  "single pass");
+
+BB.newNode("CPUSparseSGD")
+    .addInput("Weight")
+    .addInput("DestGrad")
+    .addInput("Weights")
+    .addInput("Indices")
+    .addInput("Lengths")
+    .addMember(MemberType::Float, "LearningRate")
+    .addMember(MemberType::Unsigned, "BatchSize")
+    .addResult("Weight.getType()", "UpdatedWeight")
+    .setDocstring("This is a cpu-specific SGD update of the embedding table "
+                  "Weight by the gradient of a SparseLengthsWeightedSum of "
+                  "it, given by the gradient DestGrad of its result and its "
+                  "Weights, Indices and Lengths. Only the rows of Weight "
+                  "referenced by Indices are updated");
+
 BB.includeBackendSpecificVerification("glow/CPUSpecificNodesVerification.h");
 
 #endif // GLOW_WITH_CPU
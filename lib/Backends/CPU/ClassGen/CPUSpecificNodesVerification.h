@@ -30,4 +30,282 @@ bool CPUConvDKKC8Node::verify() const {
   return expectCompareTrue("Invalid output dimensions", exp, odim, this);
 }
 
+bool CPUConvIm2ColNode::verify() const {
+  ShapeNHWC idim(getInput().getType()->dims());
+  ShapeNHWC odim(getResult().getType()->dims());
+  auto outSz = calculateConvPoolOutputDims(idim.h, idim.w, getKernels(),
+                                           getStrides(), getPads());
+  ShapeNHWC exp(idim.n, outSz.first, outSz.second, getBias().dims()[0]);
+  bool isValid =
+      expectCompareTrue("Invalid output dimensions", exp, odim, this);
+  isValid &= expectCompareTrue("Invalid filter rows", getFilter().dims()[0],
+                               getKernels()[0] * getKernels()[1] * idim.c,
+                               this);
+  isValid &= expectCompareTrue("Invalid filter columns", getFilter().dims()[1],
+                               odim.c, this);
+  return isValid;
+}
+
+bool CPUConvWinogradNode::verify() const {
+  ShapeNHWC idim(getInput().getType()->dims());
+  ShapeNHWC odim(getResult().getType()->dims());
+  unsigned_t kernels[] = {3, 3};
+  unsigned_t strides[] = {1, 1};
+  auto outSz =
+      calculateConvPoolOutputDims(idim.h, idim.w, kernels, strides, getPads());
+  ShapeNHWC exp(idim.n, outSz.first, outSz.second, getBias().dims()[0]);
+  bool isValid =
+      expectCompareTrue("Invalid output dimensions", exp, odim, this);
+  auto fdim = getFilter().dims();
+  isValid &= expectCompareTrue("Invalid filter positions", fdim[0],
+                               size_t(16), this);
+  isValid &= expectCompareTrue("Invalid filter input channels", fdim[1],
+                               idim.c, this);
+  isValid &= expectCompareTrue("Invalid filter output channels", fdim[2],
+                               odim.c, this);
+  return isValid;
+}
+
+/// Verify the shapes of a CPUConvFused or CPUConvFusedAdd \p node, whose
+/// filter has either the im2col or the Winograd layout.
+static bool verifyCPUConvFused(const Node *node, NodeValue input,
+                               NodeValue filter, NodeValue bias,
+                               NodeValue result,
+                               llvm::ArrayRef<unsigned_t> kernels,
+                               llvm::ArrayRef<unsigned_t> strides,
+                               llvm::ArrayRef<unsigned_t> pads) {
+  ShapeNHWC idim(input.getType()->dims());
+  ShapeNHWC odim(result.getType()->dims());
+  auto outSz = calculateConvPoolOutputDims(idim.h, idim.w, kernels, strides,
+                                           pads);
+  ShapeNHWC exp(idim.n, outSz.first, outSz.second, bias.dims()[0]);
+  bool isValid =
+      expectCompareTrue("Invalid output dimensions", exp, odim, node);
+  auto fdim = filter.dims();
+  if (fdim.size() == 2) {
+    isValid &= expectCompareTrue("Invalid filter rows", fdim[0],
+                                 kernels[0] * kernels[1] * idim.c, node);
+    isValid &= expectCompareTrue("Invalid filter columns", fdim[1], odim.c,
+                                 node);
+    return isValid;
+  }
+  isValid &= expectCompareTrue("Invalid filter rank", fdim.size(), size_t(3),
+                               node);
+  if (!isValid) {
+    return false;
+  }
+  bool is3x3Stride1 = kernels[0] == 3 && kernels[1] == 3 && strides[0] == 1 &&
+                      strides[1] == 1;
+  isValid &= expectCompareTrue("Winograd requires a 3x3 stride 1 convolution",
+                               is3x3Stride1, true, node);
+  isValid &= expectCompareTrue("Invalid filter positions", fdim[0],
+                               size_t(16), node);
+  isValid &= expectCompareTrue("Invalid filter input channels", fdim[1],
+                               idim.c, node);
+  isValid &= expectCompareTrue("Invalid filter output channels", fdim[2],
+                               odim.c, node);
+  return isValid;
+}
+
+bool CPUConvFusedNode::verify() const {
+  return verifyCPUConvFused(this, getInput(), getFilter(), getBias(),
+                            getResult(), getKernels(), getStrides(), getPads());
+}
+
+bool CPUConvFusedAddNode::verify() const {
+  bool isValid =
+      verifyCPUConvFused(this, getInput(), getFilter(), getBias(), getResult(),
+                         getKernels(), getStrides(), getPads());
+  isValid &= checkSameType(getResidual(), getResult(), this);
+  return isValid;
+}
+
+/// Verify the shapes of the depthwise convolution of \p node, whose filter
+/// has the shape [K * K, C] and whose result has the channels of its input.
+static bool verifyCPUConvDepthwise(const Node *node, NodeValue input,
+                                   NodeValue filter, NodeValue bias,
+                                   llvm::ArrayRef<size_t> resultDims,
+                                   llvm::ArrayRef<unsigned_t> kernels,
+                                   llvm::ArrayRef<unsigned_t> strides,
+                                   llvm::ArrayRef<unsigned_t> pads) {
+  ShapeNHWC idim(input.getType()->dims());
+  ShapeNHWC odim(resultDims);
+  auto outSz = calculateConvPoolOutputDims(idim.h, idim.w, kernels, strides,
+                                           pads);
+  ShapeNHWC exp(idim.n, outSz.first, outSz.second, idim.c);
+  bool isValid =
+      expectCompareTrue("Invalid output dimensions", exp, odim, node);
+  isValid &= expectCompareTrue("Invalid filter shape", filter.dims(),
+                               llvm::ArrayRef<size_t>(
+                                   {kernels[0] * kernels[1], idim.c}),
+                               node);
+  isValid &= expectCompareTrue("Invalid bias size", bias.dims()[0], idim.c,
+                               node);
+  return isValid;
+}
+
+bool CPUConvDepthwiseNode::verify() const {
+  return verifyCPUConvDepthwise(this, getInput(), getFilter(), getBias(),
+                                getResult().dims(), getKernels(), getStrides(),
+                                getPads());
+}
+
+bool CPUConvDepthwisePointwiseNode::verify() const {
+  ShapeNHWC odim(getResult().dims());
+  auto idim = getInput().dims();
+  size_t dims[] = {odim.n, odim.h, odim.w, idim[3]};
+  bool isValid = verifyCPUConvDepthwise(this, getInput(), getFilter(),
+                                        getBias(), dims, getKernels(),
+                                        getStrides(), getPads());
+  isValid &= expectCompareTrue("Invalid pointwise filter shape",
+                               getPointwiseFilter().dims(),
+                               llvm::ArrayRef<size_t>({idim[3], odim.c}),
+                               this);
+  isValid &= expectCompareTrue("Invalid pointwise bias size",
+                               getPointwiseBias().dims()[0], odim.c, this);
+  isValid &= checkType(getResult(), ElemKind::FloatTy, this);
+  return isValid;
+}
+
+bool CPUMatMulPackedNode::verify() const {
+  auto lhs = getLHS().dims();
+  auto packed = getPackedRHS().dims();
+  auto dest = getResult().dims();
+  bool isValid = expectCompareTrue("LHS must be 2D", lhs.size(), size_t(2),
+                                   this);
+  isValid &= expectCompareTrue("PackedRHS must be 3D", packed.size(),
+                               size_t(3), this);
+  isValid &= expectCompareTrue("Result must be 2D", dest.size(), size_t(2),
+                               this);
+  if (!isValid) {
+    return false;
+  }
+  isValid &= expectCompareTrue("Mismatching LHS and Result rows", lhs[0],
+                               dest[0], this);
+  isValid &= expectCompareTrue("Mismatching LHS and PackedRHS depth", lhs[1],
+                               packed[1], this);
+  isValid &= expectCompareTrue("Invalid number of panels", packed[0],
+                               (dest[1] + packed[2] - 1) / packed[2], this);
+  isValid &= checkType(getResult(), getLHS().getElementType(), this);
+  isValid &= checkType(getPackedRHS(), getLHS().getElementType(), this);
+  return isValid;
+}
+
+bool CPUBlockSparseMatMulNode::verify() const {
+  auto lhs = getLHS().dims();
+  auto values = getValues().dims();
+  auto dest = getResult().dims();
+  bool isValid = expectCompareTrue("LHS must be 2D", lhs.size(), size_t(2),
+                                   this);
+  isValid &= expectCompareTrue("Values must be 3D", values.size(), size_t(3),
+                               this);
+  isValid &= expectCompareTrue("Result must be 2D", dest.size(), size_t(2),
+                               this);
+  if (!isValid) {
+    return false;
+  }
+  size_t blockSize = values[1];
+  isValid &= expectCompareTrue("Blocks must be square", values[2], blockSize,
+                               this);
+  isValid &= expectCompareTrue("Mismatching LHS and Result rows", lhs[0],
+                               dest[0], this);
+  isValid &= expectCompareTrue("LHS depth must be a multiple of the blocks",
+                               lhs[1] % blockSize, size_t(0), this);
+  isValid &= expectCompareTrue("Result width must be a multiple of the blocks",
+                               dest[1] % blockSize, size_t(0), this);
+  isValid &= expectCompareTrue("Invalid number of indices",
+                               getIndices().dims(), values.slice(0, 1), this);
+  isValid &= expectCompareTrue("Invalid number of offsets",
+                               getOffsets().dims()[0],
+                               dest[1] / blockSize + 1, this);
+  isValid &= checkType(getResult(), getLHS().getElementType(), this);
+  isValid &= checkType(getValues(), getLHS().getElementType(), this);
+  isValid &= checkType(getIndices(), ElemKind::Int32ITy, this);
+  isValid &= checkType(getOffsets(), ElemKind::Int32ITy, this);
+  return isValid;
+}
+
+bool CPUBatchMatMulNode::verify() const {
+  auto lhs = getLHS().dims();
+  auto rhs = getRHS().dims();
+  auto dest = getResult().dims();
+  bool isValid = expectCompareTrue("LHS must be 3D", lhs.size(), size_t(3),
+                                   this);
+  isValid &= expectCompareTrue("RHS must be 3D", rhs.size(), size_t(3), this);
+  isValid &= expectCompareTrue("Result must be 3D", dest.size(), size_t(3),
+                               this);
+  if (!isValid) {
+    return false;
+  }
+  isValid &= expectCompareTrue("Mismatching LHS and Result batches", lhs[0],
+                               dest[0], this);
+  isValid &= expectCompareTrue("RHS must have a batch per LHS batch or one",
+                               rhs[0] == lhs[0] || rhs[0] == 1, true, this);
+  isValid &= expectCompareTrue("Mismatching LHS and Result rows", lhs[1],
+                               dest[1], this);
+  isValid &= expectCompareTrue("Mismatching LHS and RHS depth", lhs[2], rhs[1],
+                               this);
+  isValid &= expectCompareTrue("Mismatching RHS and Result columns", rhs[2],
+                               dest[2], this);
+  isValid &= checkType(getResult(), getLHS().getElementType(), this);
+  isValid &= checkType(getRHS(), getLHS().getElementType(), this);
+  return isValid;
+}
+
+bool CPULSTMUnitNode::verify() const {
+  auto gates = getGates().dims();
+  auto cell = getPrevCell().dims();
+  bool isValid = expectCompareTrue("Gates must be 2D", gates.size(), size_t(2),
+                                   this);
+  isValid &= expectCompareTrue("PrevCell must be 2D", cell.size(), size_t(2),
+                               this);
+  if (!isValid) {
+    return false;
+  }
+  isValid &= expectCompareTrue("Mismatching Gates and PrevCell batches",
+                               gates[0], cell[0], this);
+  isValid &= expectCompareTrue("Gates must hold 4 gates per cell", gates[1],
+                               4 * cell[1], this);
+  isValid &= checkType(getGates(), ElemKind::FloatTy, this);
+  isValid &= checkSameType(getCell(), getPrevCell(), this);
+  isValid &= checkSameType(getHidden(), getPrevCell(), this);
+  return isValid;
+}
+
+bool CPUSGDNode::verify() const {
+  bool isValid = checkSameType(getGradient(), getWeight(), this);
+  isValid &= checkSameType(getUpdatedWeight(), getWeight(), this);
+  return isValid;
+}
+
+bool CPUSGDMomentumNode::verify() const {
+  bool isValid = checkSameType(getGradient(), getWeight(), this);
+  isValid &= checkSameType(getGsum(), getWeight(), this);
+  isValid &= checkSameType(getUpdatedWeight(), getWeight(), this);
+  isValid &= checkSameType(getUpdatedGsum(), getWeight(), this);
+  return isValid;
+}
+
+bool CPUSparseSGDNode::verify() const {
+  auto weight = getWeight().dims();
+  auto destGrad = getDestGrad().dims();
+  bool isValid = checkSameType(getUpdatedWeight(), getWeight(), this);
+  isValid &= checkType(getDestGrad(), getWeight().getElementType(), this);
+  isValid &= checkType(getWeights(), getWeight().getElementType(), this);
+  isValid &= checkType(getIndices(), ElemKind::Int64ITy, this);
+  isValid &= checkType(getLengths(), ElemKind::Int32ITy, this);
+  isValid &= expectCompareTrue("Indices must be 1D", getIndices().dims().size(),
+                               size_t(1), this);
+  isValid &= expectCompareTrue("Lengths must be 1D", getLengths().dims().size(),
+                               size_t(1), this);
+  isValid &= expectCompareTrue("Weights and Indices must have the same shape",
+                               getWeights().dims(), getIndices().dims(), this);
+  isValid &= expectCompareTrue("Mismatching DestGrad and Lengths segments",
+                               destGrad[0], getLengths().dims()[0], this);
+  isValid &= expectCompareTrue("Mismatching DestGrad and Weight rows",
+                               destGrad.drop_front(), weight.drop_front(),
+                               this);
+  return isValid;
+}
+
 #endif // GLOW_WITH_CPU
@@ -0,0 +1,125 @@
+/**
+ * Copyright (c) Glow Contributors. See CONTRIBUTORS file.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "PerfCounters.h"
+
+#include "llvm/Support/CommandLine.h"
+
+#include <glog/logging.h>
+
+#include <cstring>
+#include <mutex>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace glow {
+
+bool GlowCPUPerfCounters = false;
+
+static llvm::cl::opt<bool, /* ExternalStorage */ true> GlowCPUPerfCountersOpt(
+    "cpu-perf-counters",
+    llvm::cl::desc("Record the cycles, instructions and last level cache "
+                   "misses of the kernels of the CPU backend in their trace "
+                   "events. Requires auto instrumentation."),
+    llvm::cl::location(GlowCPUPerfCounters));
+
+namespace {
+#ifdef __linux__
+/// The perf_event configuration of each counter, see PerfCounter.
+constexpr uint64_t counterConfigs[kNumPerfCounters] = {
+    PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES};
+
+/// \returns the file descriptor of the user space counter \p config of the
+/// calling thread, in the group of \p groupFd, or -1 on failure. The leader
+/// of a group (\p groupFd is -1) reads all the counters of the group at once.
+int openCounter(uint64_t config, int groupFd) {
+  perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.config = config;
+  attr.disabled = groupFd == -1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_GROUP;
+  return syscall(__NR_perf_event_open, &attr, 0, -1, groupFd, 0);
+}
+
+/// The counters of a thread.
+struct ThreadCounters {
+  /// File descriptors of the counters, the first one leads the group.
+  int fds[kNumPerfCounters];
+
+  /// Whether all counters could be opened.
+  bool available{false};
+
+  ThreadCounters() {
+    size_t opened = 0;
+    for (; opened < kNumPerfCounters; opened++) {
+      fds[opened] = openCounter(counterConfigs[opened], opened ? fds[0] : -1);
+      if (fds[opened] < 0) {
+        break;
+      }
+    }
+    if (opened == kNumPerfCounters &&
+        ioctl(fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP) == 0) {
+      available = true;
+      return;
+    }
+    static std::once_flag warned;
+    std::call_once(warned, [&]() {
+      LOG(WARNING) << "Hardware performance counters are not available: "
+                   << strerror(errno);
+    });
+    for (size_t i = 0; i < opened; i++) {
+      close(fds[i]);
+    }
+  }
+
+  ~ThreadCounters() {
+    if (available) {
+      for (int fd : fds) {
+        close(fd);
+      }
+    }
+  }
+};
+#endif
+} // namespace
+
+void readPerfCounters(uint64_t *counters) {
+#ifdef __linux__
+  thread_local ThreadCounters threadCounters;
+  if (threadCounters.available) {
+    // A group read returns the number of counters followed by their values.
+    uint64_t values[1 + kNumPerfCounters];
+    if (read(threadCounters.fds[0], values, sizeof(values)) ==
+        sizeof(values)) {
+      memcpy(counters, values + 1, sizeof(uint64_t) * kNumPerfCounters);
+      return;
+    }
+  }
+#endif
+  memset(counters, 0, sizeof(uint64_t) * kNumPerfCounters);
+}
+
+} // namespace glow
@@ -0,0 +1,54 @@
+/**
+ * Copyright (c) Glow Contributors. See CONTRIBUTORS file.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef GLOW_BACKENDS_CPU_PERFCOUNTERS_H
+#define GLOW_BACKENDS_CPU_PERFCOUNTERS_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace glow {
+
+/// Whether the TraceEvents of the CPU backend record hardware performance
+/// counters along with their timestamps, see readPerfCounters.
+extern bool GlowCPUPerfCounters;
+
+/// Number of hardware counters read by readPerfCounters. Must match
+/// LIBJIT_NUM_PERF_COUNTERS in libjit_defs.h.
+constexpr size_t kNumPerfCounters = 3;
+
+/// The hardware counters, in the order readPerfCounters reads them.
+enum PerfCounter : size_t {
+  /// CPU cycles.
+  Cycles = 0,
+  /// Retired instructions.
+  Instructions = 1,
+  /// Last level cache misses, which each move a cache line from memory.
+  LLCMisses = 2,
+};
+
+/// Size of the cache lines moved by the last level cache misses, which makes
+/// LLCMisses an estimate of the memory traffic.
+constexpr size_t kCacheLineSize = 64;
+
+/// Reads the kNumPerfCounters hardware counters of the calling thread into
+/// \p counters. The counters are opened the first time a thread reads them,
+/// and are all zeros if they can't be opened (e.g. off Linux or without the
+/// permission to use perf events).
+void readPerfCounters(uint64_t *counters);
+
+} // namespace glow
+
+#endif // GLOW_BACKENDS_CPU_PERFCOUNTERS_H
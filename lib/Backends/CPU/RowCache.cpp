@@ -0,0 +1,158 @@
+/**
+ * Copyright (c) Glow Contributors. See CONTRIBUTORS file.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "RowCache.h"
+
+#include "glow/Backend/BackendUtils.h"
+#include "glow/Base/Type.h"
+#include "glow/Support/Memory.h"
+
+#include "llvm/Support/CommandLine.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace glow {
+
+unsigned GlowCPURowCacheRows = 0;
+unsigned GlowCPURowCacheRefreshRuns = 16;
+
+static llvm::cl::opt<unsigned, /* ExternalStorage */ true>
+    GlowCPURowCacheRowsOpt(
+        "cpu-row-cache-rows",
+        llvm::cl::desc("Number of the most looked up rows of every fused "
+                       "rowwise-quantized embedding table which the CPU "
+                       "backend keeps dequantized. 0 disables the row "
+                       "caches."),
+        llvm::cl::location(GlowCPURowCacheRows));
+
+static llvm::cl::opt<unsigned, /* ExternalStorage */ true>
+    GlowCPURowCacheRefreshRunsOpt(
+        "cpu-row-cache-refresh-runs",
+        llvm::cl::desc("Number of runs of a function between two refreshes "
+                       "of its row caches."),
+        llvm::cl::location(GlowCPURowCacheRefreshRuns));
+
+} // namespace glow
+
+using namespace glow;
+
+RowCache::RowCache(const runtime::RuntimeBundle &bundle, size_t maxRows)
+    : maxRows_(maxRows) {
+  for (const auto &symbol : bundle.getSymbolTable()) {
+    const auto &info = symbol.second;
+    const ElemKind kind = info.type.getElementType();
+    if (info.symbolCategory != runtime::SymbolCategory::Constant ||
+        !isFusedQuantizedElemKind(kind) || info.type.dims().size() != 2) {
+      continue;
+    }
+    Table table;
+    table.data = bundle.getConstants() + info.offset;
+    table.numRows = info.type.dims()[0];
+    table.inLineSize = info.type.dims()[1];
+    table.fp16ScaleOffset = kind != ElemKind::UInt8FusedQTy;
+    table.fourBits = kind == ElemKind::UInt4FusedFP16QTy;
+    table.outLineSize =
+        table.inLineSize -
+        2 * (table.fp16ScaleOffset ? sizeof(float16_t) : sizeof(float));
+    if (table.fourBits) {
+      table.outLineSize *= 2;
+    }
+    // Every row of the arena starts on a cache line.
+    table.rowStride =
+        alignedSize(table.outLineSize * sizeof(float), TensorAlignment) /
+        sizeof(float);
+    table.slots.assign(table.numRows, -1);
+    table.counts.assign(table.numRows, 0);
+    size_t numSlots = std::min(maxRows_, table.numRows);
+    table.arena = static_cast<float *>(alignedAlloc(
+        std::max<size_t>(numSlots * table.rowStride * sizeof(float), 1),
+        TensorAlignment));
+    tables_.push_back(std::move(table));
+  }
+
+  for (auto &table : tables_) {
+    libjitTables_.push_back({table.data, table.slots.data(), table.arena,
+                             table.rowStride, table.counts.data()});
+  }
+  libjitCaches_ = {libjitTables_.size(), libjitTables_.data()};
+}
+
+RowCache::~RowCache() {
+  for (auto &table : tables_) {
+    alignedFree(table.arena);
+  }
+}
+
+void RowCache::refresh() {
+  for (auto &table : tables_) {
+    // Pick the most looked up rows, the rows with the lowest indices first
+    // among the rows with the same count. Rows never looked up are not
+    // cached.
+    std::vector<size_t> rows;
+    for (size_t row = 0; row < table.numRows; row++) {
+      if (table.counts[row]) {
+        rows.push_back(row);
+      }
+    }
+    size_t numCached = std::min(maxRows_, rows.size());
+    auto hotter = [&table](size_t a, size_t b) {
+      return table.counts[a] > table.counts[b] ||
+             (table.counts[a] == table.counts[b] && a < b);
+    };
+    std::nth_element(rows.begin(), rows.begin() + numCached, rows.end(),
+                     hotter);
+    rows.resize(numCached);
+    std::sort(rows.begin(), rows.end());
+
+    for (auto row : table.cachedRows) {
+      table.slots[row] = -1;
+    }
+    table.cachedRows = std::move(rows);
+    for (size_t slot = 0; slot < numCached; slot++) {
+      size_t row = table.cachedRows[slot];
+      const uint8_t *src = table.data + row * table.inLineSize;
+      // The scale and offset are at the end of the row.
+      float scale, offset;
+      if (table.fp16ScaleOffset) {
+        float16_t scaleOffset[2];
+        memcpy(scaleOffset, src + table.inLineSize - sizeof(scaleOffset),
+               sizeof(scaleOffset));
+        scale = scaleOffset[0];
+        offset = scaleOffset[1];
+      } else {
+        float scaleOffset[2];
+        memcpy(scaleOffset, src + table.inLineSize - sizeof(scaleOffset),
+               sizeof(scaleOffset));
+        scale = scaleOffset[0];
+        offset = scaleOffset[1];
+      }
+      float *dest = table.arena + slot * table.rowStride;
+      for (size_t k = 0; k < table.outLineSize; k++) {
+        uint8_t value =
+            table.fourBits ? (src[k / 2] >> (4 * (k % 2))) & 0xf : src[k];
+        dest[k] = scale * value + offset;
+      }
+      table.slots[row] = slot;
+    }
+
+    // Halve the counts, so that the rows which are no longer looked up are
+    // evicted by the next refreshes.
+    for (auto &count : table.counts) {
+      count /= 2;
+    }
+  }
+}
@@ -0,0 +1,123 @@
+/**
+ * Copyright (c) Glow Contributors. See CONTRIBUTORS file.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef GLOW_BACKENDS_CPU_ROWCACHE_H
+#define GLOW_BACKENDS_CPU_ROWCACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace glow {
+
+namespace runtime {
+class RuntimeBundle;
+}
+
+/// Number of hot rows of every fused rowwise-quantized embedding table which
+/// the CPU backend keeps dequantized, see RowCache. 0 disables the caches.
+extern unsigned GlowCPURowCacheRows;
+
+/// Number of runs of a function between two refreshes of its row caches.
+extern unsigned GlowCPURowCacheRefreshRuns;
+
+/// The cache of a table read by the libjit kernels. Must have the same layout
+/// as libjit_row_cache in libjit_defs.h.
+struct LibjitRowCache {
+  const uint8_t *data;
+  const int32_t *slots;
+  const float *arena;
+  size_t rowStride;
+  uint32_t *counts;
+};
+
+/// The caches of a function read by the libjit kernels. Must have the same
+/// layout as libjit_row_caches in libjit_defs.h.
+struct LibjitRowCaches {
+  size_t numCaches;
+  const LibjitRowCache *caches;
+};
+
+/// The caches of the hot rows of the fused rowwise-quantized embedding tables
+/// of a function. The FusedRowwiseQuantizedSparseLengthsWeightedSum kernels
+/// count the lookups of every row, and read the rows held by the cache, which
+/// are already dequantized, instead of the table. Index distributions are
+/// usually skewed, so a few rows packed in a small arena serve most lookups,
+/// with fewer cache misses and no dequantization. refresh() moves the most
+/// looked up rows into the cache.
+class RowCache {
+  /// The cache of one table.
+  struct Table {
+    /// The table, in the constant weights of the function.
+    const uint8_t *data;
+    size_t numRows;
+    /// Size in bytes of the rows of the table.
+    size_t inLineSize;
+    /// Number of elements of the rows of the table.
+    size_t outLineSize;
+    /// Whether the scale and offset of the rows are float16 values.
+    bool fp16ScaleOffset;
+    /// Whether the rows pack two 4-bit values in every byte.
+    bool fourBits;
+    /// See LibjitRowCache.
+    size_t rowStride;
+    std::vector<int32_t> slots;
+    std::vector<uint32_t> counts;
+    /// The rows of the arena held by slot.
+    std::vector<size_t> cachedRows;
+    float *arena{nullptr};
+  };
+
+  /// Number of rows cached for every table.
+  size_t maxRows_;
+
+  std::vector<Table> tables_;
+
+  /// The descriptions of tables_ for libjit.
+  std::vector<LibjitRowCache> libjitTables_;
+  LibjitRowCaches libjitCaches_{0, nullptr};
+
+public:
+  /// Creates the empty caches of up to \p maxRows rows of every fused
+  /// rowwise-quantized constant of \p bundle, whose constants must have been
+  /// collected.
+  RowCache(const runtime::RuntimeBundle &bundle, size_t maxRows);
+
+  ~RowCache();
+
+  RowCache(const RowCache &) = delete;
+  RowCache &operator=(const RowCache &) = delete;
+
+  /// \returns the caches, to be used by the libjit kernels.
+  const LibjitRowCaches *getLibjitCaches() const { return &libjitCaches_; }
+
+  /// \returns the number of tables with a cache.
+  size_t getNumTables() const { return tables_.size(); }
+
+  /// \returns the rows of table \p table held by its cache.
+  const std::vector<size_t> &getCachedRows(size_t table) const {
+    return tables_[table].cachedRows;
+  }
+
+  /// Fill the cache of every table with its most looked up rows since the
+  /// previous refreshes, then halve their counts so that the rows that are no
+  /// longer used are evicted over time. Must not run concurrently with the
+  /// kernels.
+  void refresh();
+};
+
+} // namespace glow
+
+#endif // GLOW_BACKENDS_CPU_ROWCACHE_H
@@ -19,10 +19,58 @@
 #include "glow/Graph/Graph.h"
 #include "glow/Graph/Nodes.h"
 
+#include "llvm/Support/CommandLine.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
 using namespace glow;
+using llvm::cast;
 using llvm::dyn_cast;
 using llvm::isa;
 
+namespace {
+/// The algorithms the CPU backend can use for float convolutions.
+enum class CPUConvAlgorithm {
+  /// Select the algorithm based on the shape of the convolution.
+  Auto,
+  /// Convolve directly, with the DKKC8 kernel when possible.
+  Direct,
+  /// Multiply the input patches by the filter with the blocked GEMM.
+  Im2Col,
+  /// Use Winograd F(2x2, 3x3) for 3x3 stride 1 convolutions.
+  Winograd,
+};
+
+llvm::cl::opt<CPUConvAlgorithm> cpuConvAlgorithm(
+    "cpu-conv-algorithm",
+    llvm::cl::desc("Algorithm used by the CPU backend for float convolutions. "
+                   "Convolutions that the selected algorithm does not support "
+                   "are performed directly."),
+    llvm::cl::values(
+        clEnumValN(CPUConvAlgorithm::Auto, "auto",
+                   "Select the algorithm from the shape of each convolution"),
+        clEnumValN(CPUConvAlgorithm::Direct, "direct", "Direct convolution"),
+        clEnumValN(CPUConvAlgorithm::Im2Col, "im2col", "im2col and GEMM"),
+        clEnumValN(CPUConvAlgorithm::Winograd, "winograd",
+                   "Winograd F(2x2, 3x3)")),
+    llvm::cl::init(CPUConvAlgorithm::Auto));
+
+llvm::cl::opt<float> cpuSparseMatMulThreshold(
+    "cpu-sparse-matmul-threshold",
+    llvm::cl::desc("Minimum fraction of zero blocks in the constant RHS of a "
+                   "MatMul for the CPU backend to only store its non-zero "
+                   "blocks. Values above 1 disable block-sparse MatMuls."),
+    llvm::cl::init(0.7));
+
+llvm::cl::opt<unsigned> cpuSparseMatMulBlockSize(
+    "cpu-sparse-matmul-block-size",
+    llvm::cl::desc("Side of the square blocks of the RHS of block-sparse "
+                   "MatMuls in the CPU backend"),
+    llvm::cl::init(8));
+} // namespace
+
 /// Try to optimize the regular Convolution into a target-specific convolution
 /// with a different filter memory layout. This optimization adds a new kind of
 /// cpu-specific convolution that operates on filter weight data in a
@@ -31,7 +79,7 @@ using llvm::isa;
 /// This optimization changes the data layout to [D/8, K, K, C, 8].  We
 /// pre-swizzle the data in the weights to make the access pattern more
 /// efficient.
-static Node *optimizeCPUConv(ConvolutionNode *CN, Function *F) {
+static Node *optimizeCPUConvDKKC8(ConvolutionNode *CN, Function *F) {
   auto depth = CN->getFilter().dims()[0];
   auto *M = F->getParent();
   auto group = CN->getGroup();
@@ -84,6 +132,576 @@ static Node *optimizeCPUConv(ConvolutionNode *CN, Function *F) {
       CN->getBias(), CN->getKernels(), CN->getStrides(), CN->getPads(), group));
 }
 
+/// \returns true if \p CN can be performed with the im2col or the Winograd
+/// convolutions, which require a constant float filter that can be rewritten,
+/// and don't support groups or dilation.
+static bool isGEMMConvCandidate(const ConvolutionNode *CN) {
+  const Constant *filter = dyn_cast<Constant>(CN->getFilter());
+  return filter && filter->getNumUsers() == 1 &&
+         filter->getElementType() == ElemKind::FloatTy &&
+         CN->getGroup() == 1 && CN->getDilation() == 1 &&
+         CN->getLayout() == NHWC &&
+         CN->getFusedActivation() == FusedActivation::NONE;
+}
+
+/// \returns true if \p CN is a 3x3 stride 1 convolution that can use the
+/// Winograd algorithm.
+static bool isWinogradConvCandidate(const ConvolutionNode *CN) {
+  auto kernels = CN->getKernels();
+  auto strides = CN->getStrides();
+  return isGEMMConvCandidate(CN) && kernels[0] == 3 && kernels[1] == 3 &&
+         strides[0] == 1 && strides[1] == 1;
+}
+
+/// Select the algorithm used for \p CN, either the one requested on the
+/// command line, or one based on its shape. Winograd cuts the multiplications
+/// of 3x3 stride 1 convolutions by 2.25x but adds transforms whose cost is
+/// only amortized with enough channels. The blocked GEMM of im2col beats the
+/// direct convolution, except for the shapes the DKKC8 kernel is tuned for or
+/// when the matrices are too narrow to fill its registers.
+static CPUConvAlgorithm selectCPUConvAlgorithm(const ConvolutionNode *CN) {
+  switch (cpuConvAlgorithm) {
+  case CPUConvAlgorithm::Winograd:
+    return isWinogradConvCandidate(CN) ? CPUConvAlgorithm::Winograd
+                                       : CPUConvAlgorithm::Direct;
+  case CPUConvAlgorithm::Im2Col:
+    return isGEMMConvCandidate(CN) ? CPUConvAlgorithm::Im2Col
+                                   : CPUConvAlgorithm::Direct;
+  case CPUConvAlgorithm::Direct:
+    return CPUConvAlgorithm::Direct;
+  case CPUConvAlgorithm::Auto:
+    break;
+  }
+
+  if (!isGEMMConvCandidate(CN)) {
+    return CPUConvAlgorithm::Direct;
+  }
+  auto kernels = CN->getKernels();
+  auto strides = CN->getStrides();
+  size_t inChannels = CN->getInput().dims()[3];
+  size_t outChannels = CN->getResult().dims()[3];
+  if (isWinogradConvCandidate(CN) && inChannels >= 64 && outChannels >= 64) {
+    return CPUConvAlgorithm::Winograd;
+  }
+  // Pointwise convolutions are plain matrix multiplications.
+  bool pointwise = kernels[0] == 1 && kernels[1] == 1 && strides[0] == 1 &&
+                   strides[1] == 1 &&
+                   std::all_of(CN->getPads().begin(), CN->getPads().end(),
+                               [](unsigned_t p) { return p == 0; });
+  if (pointwise && outChannels >= 16) {
+    return CPUConvAlgorithm::Im2Col;
+  }
+  if (outChannels % 64 == 0) {
+    return CPUConvAlgorithm::Direct;
+  }
+  if (kernels[0] * kernels[1] * inChannels >= 64 && outChannels >= 16) {
+    return CPUConvAlgorithm::Im2Col;
+  }
+  return CPUConvAlgorithm::Direct;
+}
+
+/// Replace \p CN with a convolution that multiplies the input patches of all
+/// output pixels by the filter transposed at compile time to the shape
+/// [K * K * C, D], using the blocked GEMM of libjit_matmul.cpp.
+static Node *optimizeCPUConvIm2Col(ConvolutionNode *CN, Function *F) {
+  Constant *filter = cast<Constant>(CN->getFilter());
+  auto dims = filter->dims();
+  size_t depth = dims[0];
+  size_t patchSize = dims[1] * dims[2] * dims[3];
+  auto *filterT = F->getParent()->createConstant(
+      ElemKind::FloatTy, {patchSize, depth}, filter->getName());
+  auto FTH = filterT->getHandle();
+  auto FH = filter->getHandle();
+  for (size_t d = 0; d < depth; d++) {
+    for (size_t i = 0; i < patchSize; i++) {
+      FTH.at({i, d}) = FH.raw(d * patchSize + i);
+    }
+  }
+
+  return F->addNode(new CPUConvIm2ColNode(
+      CN->getName(), CN->getResult().getType(), CN->getInput(), filterT,
+      CN->getBias(), CN->getKernels(), CN->getStrides(), CN->getPads()));
+}
+
+/// Replace the 3x3 stride 1 convolution \p CN with a Winograd F(2x2, 3x3)
+/// convolution. The filter transform U = G * g * G^T is computed once at
+/// compile time for each pair of input and output channels, and stored with
+/// the shape [16, C, D].
+static Node *optimizeCPUConvWinograd(ConvolutionNode *CN, Function *F) {
+  static const float G[4][3] = {
+      {1.0f, 0.0f, 0.0f},
+      {0.5f, 0.5f, 0.5f},
+      {0.5f, -0.5f, 0.5f},
+      {0.0f, 0.0f, 1.0f},
+  };
+
+  Constant *filter = cast<Constant>(CN->getFilter());
+  auto dims = filter->dims();
+  size_t depth = dims[0];
+  size_t channels = dims[3];
+  auto *filterU = F->getParent()->createConstant(
+      ElemKind::FloatTy, {16, channels, depth}, filter->getName());
+  auto UH = filterU->getHandle();
+  auto FH = filter->getHandle();
+  for (size_t d = 0; d < depth; d++) {
+    for (size_t c = 0; c < channels; c++) {
+      // tmp = G * g, a 4x3 matrix.
+      float tmp[4][3];
+      for (size_t i = 0; i < 4; i++) {
+        for (size_t j = 0; j < 3; j++) {
+          tmp[i][j] = 0;
+          for (size_t k = 0; k < 3; k++) {
+            tmp[i][j] += G[i][k] * FH.at({d, k, j, c});
+          }
+        }
+      }
+      // U = tmp * G^T, a 4x4 matrix.
+      for (size_t i = 0; i < 4; i++) {
+        for (size_t j = 0; j < 4; j++) {
+          float u = 0;
+          for (size_t k = 0; k < 3; k++) {
+            u += tmp[i][k] * G[j][k];
+          }
+          UH.at({i * 4 + j, c, d}) = u;
+        }
+      }
+    }
+  }
+
+  return F->addNode(new CPUConvWinogradNode(
+      CN->getName(), CN->getResult().getType(), CN->getInput(), filterU,
+      CN->getBias(), CN->getPads()));
+}
+
+/// \returns true if \p CN is a depthwise convolution, with a group per
+/// channel, of floats or of int8, whose constant filter can be rewritten.
+static bool isDepthwiseConvCandidate(const ConvolutionNode *CN) {
+  const Constant *filter = dyn_cast<Constant>(CN->getFilter());
+  if (!filter || filter->getNumUsers() != 1 || CN->getDilation() != 1 ||
+      CN->getLayout() != NHWC ||
+      CN->getFusedActivation() != FusedActivation::NONE) {
+    return false;
+  }
+  size_t channels = CN->getInput().dims()[3];
+  if (CN->getGroup() != channels || CN->getResult().dims()[3] != channels) {
+    return false;
+  }
+  switch (CN->getInput().getElementType()) {
+  case ElemKind::FloatTy:
+    return filter->getElementType() == ElemKind::FloatTy;
+  case ElemKind::Int8QTy:
+    return filter->getElementType() == ElemKind::Int8QTy &&
+           CN->getBias().getElementType() == ElemKind::Int32QTy;
+  default:
+    return false;
+  }
+}
+
+/// Replace the depthwise convolution \p CN with a cpu-specific one whose
+/// filter is transposed at compile time from [C, K, K, 1] to [K * K, C], so
+/// that the kernel reads the filter of consecutive channels like it reads the
+/// NHWC input, and vectorizes across the channels.
+static Node *optimizeCPUConvDepthwise(ConvolutionNode *CN, Function *F) {
+  Constant *filter = cast<Constant>(CN->getFilter());
+  auto dims = filter->dims();
+  size_t channels = dims[0];
+  size_t positions = dims[1] * dims[2];
+  Module *M = F->getParent();
+  auto *filterT = M->createConstant(
+      M->uniqueTypeWithNewShape(filter->getType(), {positions, channels}),
+      filter->getName());
+  // Copy the elements bytewise, for both floats and int8.
+  size_t elemSize = filter->getType()->getElementSize();
+  const char *src = filter->getPayload().getUnsafePtr();
+  char *dst = filterT->getPayloadMutable().getUnsafePtr();
+  for (size_t c = 0; c < channels; c++) {
+    for (size_t k = 0; k < positions; k++) {
+      memcpy(dst + (k * channels + c) * elemSize,
+             src + (c * positions + k) * elemSize, elemSize);
+    }
+  }
+
+  return F->addNode(new CPUConvDepthwiseNode(
+      CN->getName(), CN->getResult().getType(), CN->getInput(), filterT,
+      CN->getBias(), CN->getKernels(), CN->getStrides(), CN->getPads(),
+      -std::numeric_limits<float>::infinity(),
+      std::numeric_limits<float>::infinity()));
+}
+
+/// Try to replace the regular Convolution \p CN with one of the cpu-specific
+/// convolutions: the depthwise one when it applies, or the one of the
+/// algorithm picked by selectCPUConvAlgorithm.
+static Node *optimizeCPUConv(ConvolutionNode *CN, Function *F) {
+  if (isDepthwiseConvCandidate(CN)) {
+    return optimizeCPUConvDepthwise(CN, F);
+  }
+  switch (selectCPUConvAlgorithm(CN)) {
+  case CPUConvAlgorithm::Winograd:
+    return optimizeCPUConvWinograd(CN, F);
+  case CPUConvAlgorithm::Im2Col:
+    return optimizeCPUConvIm2Col(CN, F);
+  default:
+    return optimizeCPUConvDKKC8(CN, F);
+  }
+}
+
+/// The operands of a cpu-specific convolution that can be extended with a
+/// residual Add or an activation, see fuseCPUConvEpilogue. The result is
+/// clamped to [min, max], and the residual is added when it is set. Depthwise
+/// convolutions can only be extended with an activation.
+struct CPUConvEpilogue {
+  bool depthwise{false};
+  TypeRef type;
+  NodeValue input;
+  NodeValue filter;
+  NodeValue bias;
+  NodeValue residual;
+  std::vector<unsigned_t> kernels;
+  std::vector<unsigned_t> strides;
+  std::vector<unsigned_t> pads;
+  float min{-std::numeric_limits<float>::infinity()};
+  float max{std::numeric_limits<float>::infinity()};
+};
+
+/// \returns true and fills \p epilogue if \p NV is computed by an im2col,
+/// Winograd, float depthwise or fused cpu-specific convolution that has no
+/// other user than the node being fused into it.
+static bool getCPUConvEpilogue(NodeValue NV, CPUConvEpilogue &epilogue) {
+  Node *N = NV.getNode();
+  if (N->getNumUsers() != 1) {
+    return false;
+  }
+  epilogue.type = NV.getType();
+  if (auto *CN = dyn_cast<CPUConvDepthwiseNode>(N)) {
+    if (CN->getResult().getElementType() != ElemKind::FloatTy) {
+      return false;
+    }
+    epilogue.depthwise = true;
+    epilogue.input = CN->getInput();
+    epilogue.filter = CN->getFilter();
+    epilogue.bias = CN->getBias();
+    epilogue.kernels = CN->getKernels();
+    epilogue.strides = CN->getStrides();
+    epilogue.pads = CN->getPads();
+    epilogue.min = CN->getMin();
+    epilogue.max = CN->getMax();
+    return true;
+  }
+  if (auto *CN = dyn_cast<CPUConvIm2ColNode>(N)) {
+    epilogue.input = CN->getInput();
+    epilogue.filter = CN->getFilter();
+    epilogue.bias = CN->getBias();
+    epilogue.kernels = CN->getKernels();
+    epilogue.strides = CN->getStrides();
+    epilogue.pads = CN->getPads();
+    return true;
+  }
+  if (auto *CN = dyn_cast<CPUConvWinogradNode>(N)) {
+    epilogue.input = CN->getInput();
+    epilogue.filter = CN->getFilter();
+    epilogue.bias = CN->getBias();
+    epilogue.kernels = {3, 3};
+    epilogue.strides = {1, 1};
+    epilogue.pads = CN->getPads();
+    return true;
+  }
+  if (auto *CN = dyn_cast<CPUConvFusedNode>(N)) {
+    epilogue.input = CN->getInput();
+    epilogue.filter = CN->getFilter();
+    epilogue.bias = CN->getBias();
+    epilogue.kernels = CN->getKernels();
+    epilogue.strides = CN->getStrides();
+    epilogue.pads = CN->getPads();
+    epilogue.min = CN->getMin();
+    epilogue.max = CN->getMax();
+    return true;
+  }
+  if (auto *CN = dyn_cast<CPUConvFusedAddNode>(N)) {
+    epilogue.input = CN->getInput();
+    epilogue.filter = CN->getFilter();
+    epilogue.bias = CN->getBias();
+    epilogue.residual = CN->getResidual();
+    epilogue.kernels = CN->getKernels();
+    epilogue.strides = CN->getStrides();
+    epilogue.pads = CN->getPads();
+    epilogue.min = CN->getMin();
+    epilogue.max = CN->getMax();
+    return true;
+  }
+  return false;
+}
+
+/// Try to fuse \p N into the write-back of the cpu-specific convolution that
+/// computes one of its inputs. \p N is either a residual Add, which must come
+/// before any activation, or the Max or Min with a Splat that a Relu or a Clip
+/// are lowered to, which narrow the range the result is clamped to. This
+/// saves the passes over the output that these nodes would otherwise make.
+static Node *fuseCPUConvEpilogue(Node *N, Function *F) {
+  // Nodes that have already been fused are dead.
+  if (!N->hasUsers()) {
+    return nullptr;
+  }
+
+  CPUConvEpilogue epilogue;
+  NodeValue result;
+  if (auto *AN = dyn_cast<AddNode>(N)) {
+    result = AN->getResult();
+    NodeValue residual;
+    if (getCPUConvEpilogue(AN->getLHS(), epilogue)) {
+      residual = AN->getRHS();
+    } else if (getCPUConvEpilogue(AN->getRHS(), epilogue)) {
+      residual = AN->getLHS();
+    } else {
+      return nullptr;
+    }
+    if (epilogue.depthwise || epilogue.residual.getNode() ||
+        epilogue.min != -std::numeric_limits<float>::infinity() ||
+        epilogue.max != std::numeric_limits<float>::infinity() ||
+        residual.getType() != result.getType()) {
+      return nullptr;
+    }
+    epilogue.residual = residual;
+  } else if (isa<MaxNode>(N) || isa<MinNode>(N)) {
+    bool isMax = isa<MaxNode>(N);
+    result = N->getNthResult(0);
+    SplatNode *splat;
+    if ((splat = dyn_cast<SplatNode>(N->getNthInput(0)))) {
+      if (!getCPUConvEpilogue(N->getNthInput(1), epilogue)) {
+        return nullptr;
+      }
+    } else if ((splat = dyn_cast<SplatNode>(N->getNthInput(1)))) {
+      if (!getCPUConvEpilogue(N->getNthInput(0), epilogue)) {
+        return nullptr;
+      }
+    } else {
+      return nullptr;
+    }
+    // The clamps can only be merged when their ranges intersect.
+    float value = splat->getValue();
+    if (isMax && value <= epilogue.max) {
+      epilogue.min = std::max(epilogue.min, value);
+    } else if (!isMax && value >= epilogue.min) {
+      epilogue.max = std::min(epilogue.max, value);
+    } else {
+      return nullptr;
+    }
+  } else {
+    return nullptr;
+  }
+
+  if (result.getType() != epilogue.type) {
+    return nullptr;
+  }
+  if (epilogue.depthwise) {
+    return F->addNode(new CPUConvDepthwiseNode(
+        N->getName(), result.getType(), epilogue.input, epilogue.filter,
+        epilogue.bias, epilogue.kernels, epilogue.strides, epilogue.pads,
+        epilogue.min, epilogue.max));
+  }
+  if (epilogue.residual.getNode()) {
+    return F->addNode(new CPUConvFusedAddNode(
+        N->getName(), result.getType(), epilogue.input, epilogue.filter,
+        epilogue.bias, epilogue.residual, epilogue.kernels, epilogue.strides,
+        epilogue.pads, epilogue.min, epilogue.max));
+  }
+  return F->addNode(new CPUConvFusedNode(
+      N->getName(), result.getType(), epilogue.input, epilogue.filter,
+      epilogue.bias, epilogue.kernels, epilogue.strides, epilogue.pads,
+      epilogue.min, epilogue.max));
+}
+
+/// Try to fuse the float depthwise convolution that computes the input of the
+/// pointwise im2col convolution \p N, possibly with a clamp, and has no other
+/// user, into a single node. The depthwise results are then multiplied by the
+/// pointwise filter while they are in cache, and are never stored. The
+/// pointwise convolutions with a residual are not fused.
+static Node *fuseCPUConvDepthwisePointwise(Node *N, Function *F) {
+  NodeValue input, filter, bias;
+  llvm::ArrayRef<unsigned_t> kernels, strides, pads;
+  float min = -std::numeric_limits<float>::infinity();
+  float max = std::numeric_limits<float>::infinity();
+  if (auto *CN = dyn_cast<CPUConvIm2ColNode>(N)) {
+    input = CN->getInput();
+    filter = CN->getFilter();
+    bias = CN->getBias();
+    kernels = CN->getKernels();
+    strides = CN->getStrides();
+    pads = CN->getPads();
+  } else if (auto *CN = dyn_cast<CPUConvFusedNode>(N)) {
+    input = CN->getInput();
+    filter = CN->getFilter();
+    bias = CN->getBias();
+    kernels = CN->getKernels();
+    strides = CN->getStrides();
+    pads = CN->getPads();
+    min = CN->getMin();
+    max = CN->getMax();
+  } else {
+    return nullptr;
+  }
+  // Nodes that have already been fused are dead, and the Winograd filters of
+  // CPUConvFused have three dimensions.
+  bool pointwise = N->hasUsers() && filter.dims().size() == 2 &&
+                   kernels[0] == 1 && kernels[1] == 1 && strides[0] == 1 &&
+                   strides[1] == 1 &&
+                   std::all_of(pads.begin(), pads.end(),
+                               [](unsigned_t p) { return p == 0; });
+  auto *DN = dyn_cast<CPUConvDepthwiseNode>(input.getNode());
+  if (!pointwise || !DN || DN->getNumUsers() != 1 ||
+      DN->getResult().getElementType() != ElemKind::FloatTy) {
+    return nullptr;
+  }
+  return F->addNode(new CPUConvDepthwisePointwiseNode(
+      N->getName(), N->getNthResult(0).getType(), DN->getInput(),
+      DN->getFilter(), DN->getBias(), filter, bias, DN->getKernels(),
+      DN->getStrides(), DN->getPads(), DN->getMin(), DN->getMax(), min, max));
+}
+
+/// Number of columns of the RHS of a MatMul in each packed panel. This must
+/// match the number of rows processed by the dot-product kernel of
+/// libjit_matmul.cpp.
+static constexpr size_t matMulPanelSize = 32;
+
+/// Try to replace a MatMul whose RHS is a constant (e.g. the weights of a
+/// lowered FullyConnected) with a cpu-specific MatMul that reads the RHS in a
+/// packed panel layout. The RHS of shape [K, N] is laid out as
+/// [ceil(N/32), K, 32], so that the dot-product kernel streams sequentially
+/// through each panel, and the packing that libjit_matmul_f would otherwise
+/// redo on every call is performed once at compile time.
+static Node *optimizeCPUMatMul(MatMulNode *MM, Function *F) {
+  Constant *weights = dyn_cast<Constant>(MM->getRHS());
+  if (!weights || weights->getNumUsers() != 1) {
+    // Can't mutate the weights.
+    return nullptr;
+  }
+
+  // We only support Floats for now.
+  if (weights->getElementType() != ElemKind::FloatTy) {
+    return nullptr;
+  }
+
+  // Narrow matrices don't fill a single panel and are handled by the generic
+  // kernel equally well.
+  auto dims = weights->dims();
+  size_t k = dims[0];
+  size_t n = dims[1];
+  if (n < matMulPanelSize) {
+    return nullptr;
+  }
+
+  size_t numPanels = (n + matMulPanelSize - 1) / matMulPanelSize;
+  auto *packed =
+      F->getParent()->createConstant(ElemKind::FloatTy,
+                                     {numPanels, k, matMulPanelSize},
+                                     weights->getName());
+  auto PH = packed->getHandle();
+  auto WH = weights->getHandle();
+  PH.clear(0);
+  for (size_t p = 0; p < k; p++) {
+    for (size_t j = 0; j < n; j++) {
+      PH.at({j / matMulPanelSize, p, j % matMulPanelSize}) = WH.at({p, j});
+    }
+  }
+
+  return F->addNode(new CPUMatMulPackedNode(
+      MM->getName(), MM->getResult().getType(), MM->getLHS(), packed));
+}
+
+/// Try to replace a MatMul whose RHS is a mostly zero constant (e.g. the pruned
+/// weights of a lowered FullyConnected) with a cpu-specific MatMul that only
+/// stores and multiplies the non-zero blocks of the RHS. The RHS of shape
+/// [K, N] is cut into B x B blocks, and the non-zero blocks of each column of
+/// blocks are stored contiguously, so that they are accumulated into the same
+/// B columns of the result.
+static Node *optimizeCPUBlockSparseMatMul(MatMulNode *MM, Function *F) {
+  Constant *weights = dyn_cast<Constant>(MM->getRHS());
+  if (!weights || weights->getNumUsers() != 1 ||
+      weights->getElementType() != ElemKind::FloatTy) {
+    return nullptr;
+  }
+
+  size_t bs = cpuSparseMatMulBlockSize;
+  auto dims = weights->dims();
+  size_t k = dims[0];
+  size_t n = dims[1];
+  if (bs == 0 || k % bs || n % bs) {
+    return nullptr;
+  }
+
+  // Find the non-zero blocks, column of blocks by column of blocks.
+  auto WH = weights->getHandle();
+  size_t numBlockRows = k / bs;
+  size_t numBlockCols = n / bs;
+  std::vector<std::pair<size_t, size_t>> blocks;
+  for (size_t j = 0; j < numBlockCols; j++) {
+    for (size_t p = 0; p < numBlockRows; p++) {
+      bool isZero = true;
+      for (size_t x = 0; x < bs && isZero; x++) {
+        for (size_t y = 0; y < bs && isZero; y++) {
+          isZero = WH.at({p * bs + x, j * bs + y}) == 0;
+        }
+      }
+      if (!isZero) {
+        blocks.emplace_back(p, j);
+      }
+    }
+  }
+  size_t numBlocks = numBlockRows * numBlockCols;
+  size_t numZeroBlocks = numBlocks - blocks.size();
+  if (numZeroBlocks < cpuSparseMatMulThreshold * numBlocks) {
+    return nullptr;
+  }
+
+  // An all zero RHS still gets a zero block, so that no tensor is empty.
+  size_t numValues = std::max<size_t>(blocks.size(), 1);
+  Module *M = F->getParent();
+  auto *values = M->createConstant(ElemKind::FloatTy, {numValues, bs, bs},
+                                   weights->getName().str() + ".values");
+  auto *indices = M->createConstant(ElemKind::Int32ITy, {numValues},
+                                    weights->getName().str() + ".indices");
+  auto *offsets = M->createConstant(ElemKind::Int32ITy, {numBlockCols + 1},
+                                    weights->getName().str() + ".offsets");
+  auto VH = values->getHandle();
+  auto IH = indices->getHandle<int32_t>();
+  auto OH = offsets->getHandle<int32_t>();
+  VH.clear(0);
+  IH.clear(0);
+  OH.clear(0);
+  for (size_t e = 0; e < blocks.size(); e++) {
+    size_t p = blocks[e].first;
+    size_t j = blocks[e].second;
+    for (size_t x = 0; x < bs; x++) {
+      for (size_t y = 0; y < bs; y++) {
+        VH.at({e, x, y}) = WH.at({p * bs + x, j * bs + y});
+      }
+    }
+    IH.raw(e) = p;
+    OH.raw(j + 1)++;
+  }
+  for (size_t j = 0; j < numBlockCols; j++) {
+    OH.raw(j + 1) += OH.raw(j);
+  }
+
+  return F->addNode(new CPUBlockSparseMatMulNode(
+      MM->getName(), MM->getResult().getType(), MM->getLHS(), values, indices,
+      offsets));
+}
+
+/// Replace the BatchMatMul \p BMM of floats, which the CPU backend doesn't
+/// lower, with a cpu-specific BatchMatMul that multiplies all the batches in a
+/// single kernel, instead of a MatMul per batch. A RHS which broadcasts a
+/// single matrix with a Tile is multiplied directly, so that the Tile isn't
+/// computed and the kernel shares the matrix between the batches.
+static Node *optimizeCPUBatchMatMul(BatchMatMulNode *BMM, Function *F) {
+  NodeValue RHS = BMM->getRHS();
+  auto *TN = dyn_cast<TileNode>(RHS);
+  if (TN && TN->getAxis() == 0 && TN->getInput().dims()[0] == 1) {
+    RHS = TN->getInput();
+  }
+  return F->addNode(new CPUBatchMatMulNode(
+      BMM->getName(), BMM->getResult().getType(), BMM->getLHS(), RHS));
+}
+
 /// Merge Max and Splat nodes into target-specific CPUMaxSplat node.
 /// For quantized network, sinkRescaleQuantizedNode transformation might have
 /// merged Rescale into Max node. In this case we need to pull it out, since
@@ -119,11 +737,147 @@ static Node *optimizeCPUMaxSplat(MaxNode *MN, Function *F) {
       new CPUMaxSplatNode(MN->getName(), input, splat->getValue()));
 }
 
+/// Replace the sandwich Quantize(Op(Dequantize(A), Dequantize(B))) of an
+/// arithmetic node \p Q quantizes into int8 with Op(A, B) computed in int8,
+/// the result type of \p Q. The int8 kernels rescale their operands, so A
+/// and B may have any scale and offset. Float Splat operands, e.g. the zeros
+/// of a lowered Relu, become Splats of the type of \p Q. The nodes that were
+/// kept in float on purpose, for the precision mode kinds of \p cctx, are not
+/// fused. \returns the int8 node, or nullptr if the node can't be fused.
+static Node *fuseCPUQuantizedSandwich(QuantizeNode *Q, Function *F,
+                                      const CompilationContext &cctx) {
+  auto outTy = Q->getResult().getType();
+  Node *op = Q->getInput().getNode();
+  if (outTy->getElementType() != ElemKind::Int8QTy ||
+      !Q->getInput().hasOneUse() ||
+      cctx.precisionConfig.precisionModeKindSet.count(op->getKind())) {
+    return nullptr;
+  }
+  switch (op->getKind()) {
+  case Kinded::Kind::AddNodeKind:
+  case Kinded::Kind::SubNodeKind:
+  case Kinded::Kind::MulNodeKind:
+  case Kinded::Kind::MaxNodeKind:
+  case Kinded::Kind::MinNodeKind:
+    break;
+  default:
+    return nullptr;
+  }
+
+  bool hasDequantize = false;
+  for (unsigned i = 0, e = op->getNumInputs(); i < e; i++) {
+    Node *input = op->getNthInput(i).getNode();
+    if (auto *DQ = dyn_cast<DequantizeNode>(input)) {
+      if (DQ->getInput().getElementType() != ElemKind::Int8QTy) {
+        return nullptr;
+      }
+      hasDequantize = true;
+    } else if (!isa<SplatNode>(input)) {
+      return nullptr;
+    }
+  }
+  if (!hasDequantize) {
+    return nullptr;
+  }
+
+  Node *newOp = F->addNode(op->clone());
+  for (unsigned i = 0, e = op->getNumInputs(); i < e; i++) {
+    Node *input = op->getNthInput(i).getNode();
+    if (auto *DQ = dyn_cast<DequantizeNode>(input)) {
+      newOp->setNthInput(i, DQ->getInput());
+    } else {
+      auto *SN = cast<SplatNode>(input);
+      newOp->setNthInput(i, F->createSplat(SN->getName(), outTy,
+                                           SN->getValue()));
+    }
+  }
+  newOp->setType(0, outTy);
+  return newOp;
+}
+
+/// Replace the SGD update \p SGD of a float weight, which the CPU backend
+/// doesn't lower, with a CPU-specific update that computes each weight in a
+/// single pass. When the gradient is the data gradient of a
+/// SparseLengthsWeightedSum of the weight, and no decay or momentum changes
+/// the rows that were not looked up, only the looked up rows are updated,
+/// without computing the dense gradient of the table. \returns the updated
+/// weight.
+static NodeValue optimizeCPUSGD(SGDNode *SGD, Function *F) {
+  NodeValue grad = SGD->getGradient();
+  NodeValue weight = SGD->getWeight();
+  auto *SLWSG = dyn_cast<SparseLengthsWeightedSumGradNode>(grad.getNode());
+  if (SLWSG && grad == SLWSG->getGradOfInputNamedData() && grad.hasOneUse() &&
+      SLWSG->getData() == weight && SGD->getL1Decay() == 0 &&
+      SGD->getL2Decay() == 0 && SGD->getMomentum() == 0) {
+    auto *SSGD = F->addNode(new CPUSparseSGDNode(
+        SGD->getName(), weight, SLWSG->getGradOfOriginalOutputNamedResult(),
+        SLWSG->getWeights(), SLWSG->getIndices(), SLWSG->getLengths(),
+        SGD->getLearningRate(), SGD->getBatchSize()));
+    return SSGD->getUpdatedWeight();
+  }
+
+  if (SGD->getMomentum() == 0) {
+    auto *CSGD = F->addNode(new CPUSGDNode(
+        SGD->getName(), grad, weight, SGD->getL1Decay(), SGD->getL2Decay(),
+        SGD->getLearningRate(), SGD->getBatchSize()));
+    return CSGD->getUpdatedWeight();
+  }
+
+  // The accumulated steps, like the ones of the lowered SGD.
+  Placeholder *gsum =
+      F->getParent()->createPlaceholder(weight.getType(), "gsum", false);
+  gsum->setAllocZero();
+  auto *CSGD = F->addNode(new CPUSGDMomentumNode(
+      SGD->getName(), grad, weight, gsum, SGD->getL1Decay(), SGD->getL2Decay(),
+      SGD->getLearningRate(), SGD->getMomentum(), SGD->getBatchSize()));
+  F->createSave("save.gsum", CSGD->getUpdatedGsum(), gsum);
+  return CSGD->getUpdatedWeight();
+}
+
 bool CPUBackend::transformPostLowering(Function *F,
-                                       CompilationContext &) const {
+                                       CompilationContext &cctx) const {
   LOG_SCOPE(F->getLogContext(), "CPUBackend::transformPostLowering")
 
   bool changed = false;
+  // SGD updates of float weights are not lowered, see shouldLower. Like the
+  // lowered ones they are erased, as they have side effects.
+  for (auto it = F->getNodes().begin(), e = F->getNodes().end(); it != e;) {
+    if (auto *SGD = dyn_cast<SGDNode>(&*(it++))) {
+      SGD->getUpdatedWeight().replaceAllUsesOfWith(optimizeCPUSGD(SGD, F));
+      F->eraseNode(SGD);
+      changed = true;
+    }
+  }
+
+  // BatchMatMuls of floats are not lowered either, see shouldLower.
+  for (auto &node : F->getNodes()) {
+    if (auto *BMM = dyn_cast<BatchMatMulNode>(&node)) {
+      BMM->getResult().replaceAllUsesOfWith(optimizeCPUBatchMatMul(BMM, F));
+      changed = true;
+    }
+  }
+
+  // Nor are the LSTMUnits of floats, which are computed by a single kernel.
+  for (auto &node : F->getNodes()) {
+    if (auto *LU = dyn_cast<LSTMUnitNode>(&node)) {
+      auto *CLU = F->addNode(new CPULSTMUnitNode(
+          LU->getName(), LU->getGates(), LU->getPrevCell()));
+      LU->getHidden().replaceAllUsesOfWith(CLU->getHidden());
+      LU->getCell().replaceAllUsesOfWith(CLU->getCell());
+      changed = true;
+    }
+  }
+
+  // Compute the arithmetic nodes between a Dequantize and a Quantize in int8.
+  for (auto &node : F->getNodes()) {
+    if (auto *Q = dyn_cast<QuantizeNode>(&node)) {
+      if (Node *FQ = fuseCPUQuantizedSandwich(Q, F, cctx)) {
+        Q->getResult().replaceAllUsesOfWith(FQ);
+        changed = true;
+      }
+    }
+  }
+
   for (auto &node : F->getNodes()) {
     // Try to replace generic convolution with cpu-optimized version.
     if (auto *CN = dyn_cast<ConvolutionNode>(&node)) {
@@ -134,6 +888,46 @@ bool CPUBackend::transformPostLowering(Function *F,
       }
     }
 
+    // Try to replace MatMuls by constant weights with the block-sparse or the
+    // prepacked version.
+    if (auto *MM = dyn_cast<MatMulNode>(&node)) {
+      Node *NMM = optimizeCPUBlockSparseMatMul(MM, F);
+      if (!NMM) {
+        NMM = optimizeCPUMatMul(MM, F);
+      }
+      if (NMM) {
+        MM->getResult().replaceAllUsesOfWith(NMM);
+        changed = true;
+        continue;
+      }
+    }
+  }
+
+  // Fuse residual Adds, Relus and Clips into the convolutions, until no more
+  // nodes can be fused. This happens before the Max nodes of the activations
+  // are merged into CPUMaxSplat.
+  bool fused;
+  do {
+    fused = false;
+    for (auto &node : F->getNodes()) {
+      if (Node *FCN = fuseCPUConvEpilogue(&node, F)) {
+        node.getNthResult(0).replaceAllUsesOfWith(FCN);
+        fused = true;
+      }
+    }
+    changed |= fused;
+  } while (fused);
+
+  // Fuse the depthwise convolutions and their activations into the pointwise
+  // convolutions that follow them, as in depthwise separable convolutions.
+  for (auto &node : F->getNodes()) {
+    if (Node *FCN = fuseCPUConvDepthwisePointwise(&node, F)) {
+      node.getNthResult(0).replaceAllUsesOfWith(FCN);
+      changed = true;
+    }
+  }
+
+  for (auto &node : F->getNodes()) {
     // Merge Max and Splat nodes into CPUMaxSplat.
     if (auto *MN = dyn_cast<MaxNode>(&node)) {
       if (Node *MSN = optimizeCPUMaxSplat(MN, F)) {
@@ -309,92 +309,262 @@ template <typename T> struct value_index {
   T value;
 };
 
-/// Helper function for TopK
+/// \returns whether \p a ranks before \p b in a TopK: larger values first and,
+/// among equal values, smaller indices first.
 template <typename T>
-static int value_index_sort(const void *va, const void *vb) {
-  value_index<T> *a = (value_index<T> *)va;
-  value_index<T> *b = (value_index<T> *)vb;
-  if (a->value != b->value)
-    return a->value > b->value ? -1 : 1;
-  return a->index < b->index ? -1 : 1;
+static bool value_index_before(const value_index<T> &a,
+                               const value_index<T> &b) {
+  if (a.value != b.value)
+    return a.value > b.value;
+  return a.index < b.index;
 }
 
-/// Generic Top-K function. Here, \p scratch is some allocated buffer space, \p
-/// size is the size of the input, and \p n is the size of the last dimension of
-/// the input.
-template <typename T>
-static void libjit_topk(T *values, size_t *indices, const T *input,
-                        size_t *scratch, size_t k, size_t n, size_t size) {
-  size_t in = 0;
-  size_t out = 0;
+/// The number of values of a row that the TopK kernel compares to the worst
+/// kept value at once.
+static constexpr size_t kTopKBlockSize = 16;
 
-  value_index<T> *buffer = (value_index<T> *)scratch;
+/// Replaces the top of the heap \p heap of \p k elements, which is the one
+/// ranking last, with \p x and restores the heap.
+template <typename T>
+static void libjit_topk_replace_top(value_index<T> *heap, size_t k,
+                                    value_index<T> x) {
+  size_t pos = 0;
+  for (;;) {
+    size_t child = 2 * pos + 1;
+    if (child >= k) {
+      break;
+    }
+    if (child + 1 < k && value_index_before(heap[child], heap[child + 1])) {
+      child++;
+    }
+    if (!value_index_before(x, heap[child])) {
+      break;
+    }
+    heap[pos] = heap[child];
+    pos = child;
+  }
+  heap[pos] = x;
+}
 
+/// Writes the \p k largest of the \p n values of \p row, in order, to
+/// \p values and \p indices, using \p heap to hold k elements. The heap keeps
+/// the k best values seen so far with the worst one on top, so that a value
+/// costs a comparison with the top, and only a value that beats it costs a
+/// log(k) insertion. The values are compared to the top by blocks, without a
+/// branch per value so that the test is vectorized, and almost all the blocks
+/// of a long row are skipped once the heap holds large values.
+template <typename T>
+static void libjit_topk_row(T *values, size_t *indices, const T *row,
+                            value_index<T> *heap, size_t k, size_t n) {
   // Specialize TopK for the case where K is 1.
   if (k == 1) {
-    while (in < size) {
-      // Find the largest value by iterating over the array instead of calling
-      // 'sort'.
-      value_index<T> mx = {0, input[in]};
-      for (size_t i = 1; i < n; i++) {
-        if (input[i + in] > mx.value) {
-          mx = {i, input[i + in]};
-        }
+    // Find the largest value by iterating over the array instead of calling
+    // 'sort'.
+    value_index<T> mx = {0, row[0]};
+    for (size_t i = 1; i < n; i++) {
+      if (row[i] > mx.value) {
+        mx = {i, row[i]};
       }
-      indices[out] = mx.index;
-      values[out] = mx.value;
-      out++;
-      in += n;
     }
+    indices[0] = mx.index;
+    values[0] = mx.value;
     return;
   }
 
-  while (in < size) {
-    for (size_t i = 0; i < n; i++) {
-      buffer[i].index = i;
-      buffer[i].value = input[in++];
+  for (size_t i = 0; i < k; i++) {
+    heap[i] = {i, row[i]};
+  }
+  std::make_heap(heap, heap + k, value_index_before<T>);
+  for (size_t i = k; i < n; i += kTopKBlockSize) {
+    size_t end = std::min(i + kTopKBlockSize, n);
+    T threshold = heap[0].value;
+    bool beats = false;
+    for (size_t j = i; j < end; j++) {
+      beats |= row[j] > threshold;
     }
-    qsort(buffer, n, sizeof(value_index<T>), value_index_sort<T>);
-    for (size_t i = 0; i < k; i++) {
-      indices[out] = buffer[i].index;
-      values[out] = buffer[i].value;
-      out++;
+    if (!beats) {
+      continue;
+    }
+    // A value equal to the top has a larger index, so it ranks after it.
+    for (size_t j = i; j < end; j++) {
+      if (row[j] > heap[0].value) {
+        libjit_topk_replace_top(heap, k, {j, row[j]});
+      }
     }
   }
+  std::sort_heap(heap, heap + k, value_index_before<T>);
+  for (size_t i = 0; i < k; i++) {
+    indices[i] = heap[i].index;
+    values[i] = heap[i].value;
+  }
 }
 
-template <typename T, typename IDX>
-static void libjit_gather(T *dest, const T *data, const IDX *indices,
-                          size_t numIndices, size_t sliceSize,
-                          size_t numSamples, size_t sampleSize) {
-  // The index of the slice that is being written.
-  size_t outIdx = 0;
+/// The arguments of libjit_topk_body.
+template <typename T> struct TopKArgs {
+  T *values;
+  size_t *indices;
+  const T *input;
+  /// The heaps of the groups of rows, k elements each.
+  value_index<T> *heaps;
+  size_t k;
+  size_t n;
+  size_t numRows;
+  size_t numGroups;
+};
 
-  // For each sample in our batch:
-  for (size_t sample = 0; sample < numSamples; sample++) {
-    size_t sampleStart = sample * sampleSize;
+/// Processes the groups of rows [\p begin, \p end) of TopK. Every group uses
+/// its own heap, so the groups can run in parallel.
+template <typename T>
+static void libjit_topk_body(size_t begin, size_t end, void *ctx) {
+  auto *args = static_cast<TopKArgs<T> *>(ctx);
+  size_t k = args->k;
+  size_t n = args->n;
+  for (size_t group = begin; group < end; group++) {
+    value_index<T> *heap = args->heaps + group * k;
+    for (size_t row = group * args->numRows / args->numGroups,
+                e = (group + 1) * args->numRows / args->numGroups;
+         row < e; row++) {
+      libjit_topk_row(args->values + row * k, args->indices + row * k,
+                      args->input + row * n, heap, k, n);
+    }
+  }
+}
 
-    // For each slice that we fetch:
-    for (size_t i = 0; i < numIndices; i++) {
-      size_t slice = indices[i];
+/// Generic Top-K function. Here, \p scratch is some allocated buffer space, \p
+/// size is the size of the input, and \p n is the size of the last dimension of
+/// the input. The rows are split in groups which run in parallel, as many as
+/// the heaps of k elements that fit in the 2 * n words of \p scratch.
+template <typename T>
+static void libjit_topk(T *values, size_t *indices, const T *input,
+                        size_t *scratch, size_t k, size_t n, size_t size) {
+  size_t numRows = size / n;
+  size_t numHeaps = 2 * n * sizeof(size_t) / (sizeof(value_index<T>) * k);
+  size_t numGroups = std::max<size_t>(std::min(numRows, numHeaps), 1);
+  TopKArgs<T> args{values, indices, input, (value_index<T> *)scratch,
+                   k,      n,       numRows, numGroups};
+  libjit_parallel_for(numGroups, &libjit_topk_body<T>, &args);
+}
+
+/// Prefetch the \p numBytes bytes starting at \p p, one cache line at a time.
+static void libjit_prefetch_row(const uint8_t *p, size_t numBytes) {
+  for (size_t i = 0; i < numBytes; i += 64) {
+    __builtin_prefetch(p + i);
+  }
+}
+
+/// The largest slices that libjit_copy_slice copies inline.
+constexpr size_t kSmallCopySize = 64;
+
+/// Copies the \p numBytes bytes of \p src to \p dest. The small slices, e.g.
+/// of narrow embeddings, are copied with overlapping copies of a constant
+/// size, which are single vector moves, instead of calling memcpy.
+inline void libjit_copy_slice(void *dest, const void *src, size_t numBytes) {
+  uint8_t *d = (uint8_t *)dest;
+  const uint8_t *s = (const uint8_t *)src;
+  if (numBytes > kSmallCopySize) {
+    memcpy(d, s, numBytes);
+  } else if (numBytes >= 32) {
+    memcpy(d, s, 32);
+    memcpy(d + numBytes - 32, s + numBytes - 32, 32);
+  } else if (numBytes >= 16) {
+    memcpy(d, s, 16);
+    memcpy(d + numBytes - 16, s + numBytes - 16, 16);
+  } else if (numBytes >= 8) {
+    memcpy(d, s, 8);
+    memcpy(d + numBytes - 8, s + numBytes - 8, 8);
+  } else if (numBytes >= 4) {
+    memcpy(d, s, 4);
+    memcpy(d + numBytes - 4, s + numBytes - 4, 4);
+  } else {
+    for (size_t i = 0; i < numBytes; i++) {
+      d[i] = s[i];
+    }
+  }
+}
 
-      // Copy the slice.
-      memcpy(dest + outIdx * sliceSize, data + sampleStart + slice * sliceSize,
-             sliceSize * sizeof(T));
+/// Arguments of a Gather passed to the body of its parallel loop. The sizes
+/// are in bytes.
+template <typename IDX> struct GatherArgs {
+  uint8_t *dest;
+  const uint8_t *data;
+  const IDX *indices;
+  size_t numIndices;
+  size_t sliceSize;
+  size_t sampleSize;
+  size_t prefetchDistance;
+};
+
+/// The position of an output slice of a Gather: the sample and the index of
+/// its slice, which are advanced without dividing.
+struct GatherPos {
+  size_t sample;
+  size_t index;
+};
 
-      // Point to the next location in the destination tensor.
-      outIdx++;
+/// \returns the slice of \p args copied at \p pos, and moves \p pos to the
+/// next output slice.
+template <typename IDX>
+inline const uint8_t *libjit_next_gather_slice(const GatherArgs<IDX> *args,
+                                               GatherPos *pos) {
+  const uint8_t *slice = args->data + pos->sample * args->sampleSize +
+                         args->indices[pos->index] * args->sliceSize;
+  if (++pos->index == args->numIndices) {
+    pos->index = 0;
+    pos->sample++;
+  }
+  return slice;
+}
+
+/// Copy the output slices [\p begin, \p end) of the Gather \p ctx. The slice
+/// of the output slice prefetchDistance slices ahead is prefetched, so that
+/// the cache misses of the lookups of large tables overlap.
+template <typename IDX>
+static void libjit_gather_body(size_t begin, size_t end, void *ctx) {
+  const GatherArgs<IDX> *args = (const GatherArgs<IDX> *)ctx;
+  const size_t sliceSize = args->sliceSize;
+  const size_t numIndices = args->numIndices;
+  const size_t ahead = MIN(begin + args->prefetchDistance, end);
+  GatherPos cur{begin / numIndices, begin % numIndices};
+  GatherPos next{ahead / numIndices, ahead % numIndices};
+  for (size_t i = begin; i < end; i++) {
+    if (i + args->prefetchDistance < end) {
+      libjit_prefetch_row(libjit_next_gather_slice(args, &next), sliceSize);
     }
+    libjit_copy_slice(args->dest + i * sliceSize,
+                      libjit_next_gather_slice(args, &cur), sliceSize);
   }
 }
 
+template <typename T, typename IDX>
+static void libjit_gather(T *dest, const T *data, const IDX *indices,
+                          size_t numIndices, size_t sliceSize,
+                          size_t numSamples, size_t sampleSize,
+                          size_t prefetchDistance) {
+  GatherArgs<IDX> args{(uint8_t *)dest,
+                       (const uint8_t *)data,
+                       indices,
+                       numIndices,
+                       sliceSize * sizeof(T),
+                       sampleSize * sizeof(T),
+                       prefetchDistance};
+  // The output slices are written in order of the samples, then of the
+  // indices.
+  libjit_parallel_for(numSamples * numIndices, &libjit_gather_body<IDX>,
+                      &args);
+}
+
+/// The ranges are all copied into the output one after the other, so their
+/// copies are sequential. The range prefetchDistance ranges ahead is
+/// prefetched.
 template <typename T, typename U>
 static void libjit_gatherranges(T *output, U *lengths, const T *data,
                                 const U *ranges, size_t numExamples,
-                                size_t exampleSize) {
+                                size_t exampleSize, size_t prefetchDistance) {
   // Indices into the output and range buffers.
   size_t outputIdx = 0;
   size_t rangesIdx = 0;
+  // Each range is of the form (start, len).
+  const size_t numRanges = numExamples * exampleSize;
 
   // For each example:
   for (size_t example = 0; example < numExamples; ++example) {
@@ -403,18 +573,23 @@ static void libjit_gatherranges(T *output, U *lengths, const T *data,
 
     // For each range:
     for (size_t range = 0; range < exampleSize; ++range) {
+      const size_t ahead = rangesIdx / 2 + prefetchDistance;
+      if (prefetchDistance && ahead < numRanges) {
+        libjit_prefetch_row((const uint8_t *)(data + ranges[2 * ahead]),
+                            ranges[2 * ahead + 1] * sizeof(T));
+      }
+
       // Get the start and length of the range.
       const U start = ranges[rangesIdx];
       const U len = ranges[rangesIdx + 1];
 
       // Copy the specified elements.
-      memcpy(output + outputIdx, data + start, len * sizeof(T));
+      libjit_copy_slice(output + outputIdx, data + start, len * sizeof(T));
 
       // len elements were copied, so increment the output index by len.
       outputIdx += len;
 
-      // Each range is of the form (start, len), so increment the ranges
-      // index by 2 to get to the next range.
+      // Increment the ranges index by 2 to get to the next range.
       rangesIdx += 2;
 
       // Increment the total length for the example by len.
@@ -427,193 +602,505 @@ static void libjit_gatherranges(T *output, U *lengths, const T *data,
   }
 }
 
+/// The minimum number of bytes of slices that a ScatterData writes in
+/// parallel.
+constexpr size_t kParallelScatterSize = 1 << 16;
+
+/// The number of parts of the data that the parallel ScatterData writes.
+constexpr size_t kScatterParts = 64;
+
+/// Arguments of a ScatterData passed to the body of its parallel loop.
+template <typename T> struct ScatterDataArgs {
+  T *data;
+  const size_t *dataDims;
+  const size_t *indices;
+  const T *slices;
+  size_t numIndices;
+  size_t indexSize;
+  size_t sliceSize;
+  bool isCumulative;
+  float dataScale;
+  int32_t dataOffset;
+  float sliceScale;
+  int32_t sliceOffset;
+  /// The slice of data that every slice is written to, and the slices sorted
+  /// by the part of the data that they are written to, in order. The slices
+  /// of part p are order[partBegin[p]] to order[partBegin[p + 1] - 1].
+  size_t *destSlices;
+  size_t *order;
+  size_t partBegin[kScatterParts + 1];
+};
+
+/// \returns the slice of data that the slice \p i of \p args is written to.
 template <typename T>
-static void libjit_scatterdatacopy(T *data, const size_t *dataDims,
-                                   const size_t *indices, const T *slices,
-                                   size_t numIndices, size_t indexSize,
-                                   size_t sliceSize) {
-  for (size_t i = 0; i < numIndices; i++) {
-    size_t destDataIdx = indices[i * indexSize];
-    for (size_t j = 1; j < indexSize; j++) {
-      destDataIdx *= dataDims[j];
-      destDataIdx += indices[i * indexSize + j];
-    }
-    memcpy(data + destDataIdx * sliceSize, slices + i * sliceSize,
-           sliceSize * sizeof(T));
+inline size_t libjit_get_scatter_dest(const ScatterDataArgs<T> *args,
+                                      size_t i) {
+  const size_t *index = args->indices + i * args->indexSize;
+  size_t destDataIdx = index[0];
+  for (size_t j = 1; j < args->indexSize; j++) {
+    destDataIdx *= args->dataDims[j];
+    destDataIdx += index[j];
   }
+  return destDataIdx;
 }
 
-template <typename T>
-static void libjit_scatterdataaddfloat(T *data, const size_t *dataDims,
-                                       const size_t *indices, const T *slices,
-                                       size_t numIndices, size_t indexSize,
-                                       size_t sliceSize) {
-  for (size_t i = 0; i < numIndices; i++) {
-    size_t destDataIdx = indices[i * indexSize];
-    for (size_t j = 1; j < indexSize; j++) {
-      destDataIdx *= dataDims[j];
-      destDataIdx += indices[i * indexSize + j];
-    }
-    for (size_t j = 0; j < sliceSize; j++) {
-      data[destDataIdx * sliceSize + j] += slices[i * sliceSize + j];
-    }
+/// Adds the float \p slice of \p args to \p dest.
+static void libjit_scatter_add_slice(const ScatterDataArgs<float> *args,
+                                     float *dest, const float *slice) {
+  for (size_t j = 0; j < args->sliceSize; j++) {
+    dest[j] += slice[j];
+  }
+}
+
+/// Adds the quantized \p slice of \p args to \p dest, in float.
+static void libjit_scatter_add_slice(const ScatterDataArgs<int8_t> *args,
+                                     int8_t *dest, const int8_t *slice) {
+  const float dataScale = args->dataScale;
+  const int32_t dataOffset = args->dataOffset;
+  for (size_t j = 0; j < args->sliceSize; j++) {
+    float lhs = (dest[j] - dataOffset) * dataScale;
+    float rhs = (slice[j] - args->sliceOffset) * args->sliceScale;
+    dest[j] = libjit_clip((lhs + rhs) / dataScale + dataOffset);
   }
 }
 
+/// Writes the slice \p i of \p args to the slice \p destDataIdx of data.
 template <typename T>
-static void libjit_scatterdataaddquantized(
-    T *data, const size_t *dataDims, const size_t *indices, const T *slices,
-    size_t numIndices, size_t indexSize, size_t sliceSize, float dataScale,
-    int32_t dataOffset, float sliceScale, int32_t sliceOffset) {
+inline void libjit_scatter_slice(const ScatterDataArgs<T> *args, size_t i,
+                                 size_t destDataIdx) {
+  T *dest = args->data + destDataIdx * args->sliceSize;
+  const T *slice = args->slices + i * args->sliceSize;
+  if (args->isCumulative) {
+    libjit_scatter_add_slice(args, dest, slice);
+  } else {
+    libjit_copy_slice(dest, slice, args->sliceSize * sizeof(T));
+  }
+}
 
-  for (size_t i = 0; i < numIndices; i++) {
-    size_t destDataIdx = indices[i * indexSize];
-    for (size_t j = 1; j < indexSize; j++) {
-      destDataIdx *= dataDims[j];
-      destDataIdx += indices[i * indexSize + j];
+/// Writes the slices of the parts [\p begin, \p end) of the data of the
+/// ScatterData \p ctx. The parts are disjoint and the slices of a part are
+/// written in order, so the results are the same as writing all the slices in
+/// order, even when the indices are not unique.
+template <typename T>
+static void libjit_scatterdata_body(size_t begin, size_t end, void *ctx) {
+  const ScatterDataArgs<T> *args = (const ScatterDataArgs<T> *)ctx;
+  for (size_t k = args->partBegin[begin]; k < args->partBegin[end]; k++) {
+    size_t i = args->order[k];
+    libjit_scatter_slice(args, i, args->destSlices[i]);
+  }
+}
+
+/// Writes the slices of \p args. When the slices are large enough and the
+/// kernels run in parallel, the slices are sorted by the part of the data
+/// that they are written to, keeping their order in every part, and the
+/// parts are written in parallel.
+template <typename T> static void libjit_scatterdata(ScatterDataArgs<T> *args) {
+  const size_t numIndices = args->numIndices;
+  if (!glow_libjit_parallel_runner ||
+      numIndices * args->sliceSize * sizeof(T) < kParallelScatterSize) {
+    for (size_t i = 0; i < numIndices; i++) {
+      libjit_scatter_slice(args, i, libjit_get_scatter_dest(args, i));
     }
-    for (size_t j = 0; j < sliceSize; j++) {
-      float lhs = (data[destDataIdx * sliceSize + j] - dataOffset) * dataScale;
-      float rhs = (slices[i * sliceSize + j] - sliceOffset) * sliceScale;
-      T result = libjit_clip((lhs + rhs) / dataScale + dataOffset);
-      data[destDataIdx * sliceSize + j] = result;
+    return;
+  }
+  size_t numDataSlices = 1;
+  for (size_t j = 0; j < args->indexSize; j++) {
+    numDataSlices *= args->dataDims[j];
+  }
+  libjit_aligned_malloc((void **)&args->destSlices, 64,
+                        2 * numIndices * sizeof(size_t));
+  args->order = args->destSlices + numIndices;
+  // Count the slices of every part, then sort the slices by part with a
+  // stable counting sort.
+  size_t *partBegin = args->partBegin;
+  memset(partBegin, 0, sizeof(args->partBegin));
+  for (size_t i = 0; i < numIndices; i++) {
+    size_t destDataIdx = libjit_get_scatter_dest(args, i);
+    args->destSlices[i] = destDataIdx;
+    partBegin[destDataIdx * kScatterParts / numDataSlices + 1]++;
+  }
+  for (size_t p = 0; p < kScatterParts; p++) {
+    partBegin[p + 1] += partBegin[p];
+  }
+  size_t next[kScatterParts];
+  memcpy(next, partBegin, sizeof(next));
+  for (size_t i = 0; i < numIndices; i++) {
+    args->order[next[args->destSlices[i] * kScatterParts / numDataSlices]++] =
+        i;
+  }
+  libjit_parallel_for(kScatterParts, &libjit_scatterdata_body<T>, args);
+  libjit_aligned_free(args->destSlices);
+}
+
+/// The side of the tiles of the 2D transposes. The tiles have constant bounds
+/// so that the compiler transposes them in registers.
+static constexpr size_t kTransposeTileSize = 8;
+
+/// The side of the blocks of tiles of the 2D transposes, which are small
+/// enough to keep their source and destination lines in the L1 cache.
+static constexpr size_t kTransposeBlockSize = 64;
+
+/// The maximum number of dimensions of a transpose.
+static constexpr size_t kTransposeMaxDims = 6;
+
+/// Copies the \p rows x \p cols matrix \p in, whose rows and columns are
+/// \p inRow and \p inCol elements apart, to \p out, whose rows and columns are
+/// \p outRow and \p outCol elements apart, one tile at a time.
+template <typename T>
+static void libjit_transpose_2d(const T *in, T *out, size_t rows, size_t cols,
+                                size_t inRow, size_t inCol, size_t outRow,
+                                size_t outCol) {
+  constexpr size_t tile = kTransposeTileSize;
+  for (size_t br = 0; br < rows; br += kTransposeBlockSize) {
+    for (size_t bc = 0; bc < cols; bc += kTransposeBlockSize) {
+      size_t er = MIN(br + kTransposeBlockSize, rows);
+      size_t ec = MIN(bc + kTransposeBlockSize, cols);
+      for (size_t r = br; r < er; r += tile) {
+        for (size_t c = bc; c < ec; c += tile) {
+          const T *src = in + r * inRow + c * inCol;
+          T *dest = out + r * outRow + c * outCol;
+          // The transposes pass consecutive rows that are adjacent in the
+          // input, so the inner loop reads it sequentially.
+          if (r + tile <= er && c + tile <= ec) {
+            for (size_t j = 0; j < tile; j++) {
+              for (size_t i = 0; i < tile; i++) {
+                dest[i * outRow + j * outCol] = src[i * inRow + j * inCol];
+              }
+            }
+            continue;
+          }
+          for (size_t j = 0, ej = MIN(tile, ec - c); j < ej; j++) {
+            for (size_t i = 0, ei = MIN(tile, er - r); i < ei; i++) {
+              dest[i * outRow + j * outCol] = src[i * inRow + j * inCol];
+            }
+          }
+        }
+      }
     }
   }
 }
 
+/// Transposes \p inW of dims \p idim into \p outW of dims \p odim, where the
+/// dimension i of the output is the dimension \p shuffle[i] of the input. The
+/// dimensions of size 1 are dropped, and the consecutive output dimensions
+/// that are consecutive in the input too are merged, which turns most
+/// transposes into 2D or 3D ones. Then, if the innermost dimensions of the
+/// input and of the output match, the kernel copies contiguous rows with
+/// memcpy. Otherwise it transposes the innermost dimension of the output with
+/// the innermost one of the input by tiles, so that both are read and written
+/// a cache line at a time, for every index of the other dimensions.
 template <typename T>
 static void libjit_transpose_generic(const T *inW, T *outW, const size_t *idim,
                                      const size_t *odim, const size_t *shuffle,
                                      size_t numDims) {
-  // Transpose 2d matrices one tile at a time. This access pattern ensures
-  // that the whole tile is kept in L1 cache. When scanning the whole row at
-  // once we invalidate many cache lines when we touch a single column.
-  const unsigned tileSize = 64;
-
-  // Source coordinate.
-  size_t SC[5];
-
-  if (numDims == 5) {
-    for (size_t x = 0; x < odim[0]; x++)
-      for (size_t y = 0; y < odim[1]; y++)
-        for (size_t z = 0; z < odim[2]; z++)
-          for (size_t w = 0; w < odim[3]; w++)
-            for (size_t q = 0; q < odim[4]; q++) {
-              SC[shuffle[0]] = x;
-              SC[shuffle[1]] = y;
-              SC[shuffle[2]] = z;
-              SC[shuffle[3]] = w;
-              SC[shuffle[4]] = q;
-              outW[libjit_getXYZWQ(odim, x, y, z, w, q)] =
-                  inW[libjit_getXYZWQ(idim, SC[0], SC[1], SC[2], SC[3], SC[4])];
-            }
+  // The strides of the input dimensions.
+  size_t inStrides[kTransposeMaxDims];
+  size_t stride = 1;
+  for (size_t i = numDims; i > 0; i--) {
+    inStrides[i - 1] = stride;
+    stride *= idim[i - 1];
+  }
+
+  // The sizes of the merged output dimensions, and their strides in the input
+  // and in the output.
+  size_t sizes[kTransposeMaxDims];
+  size_t inS[kTransposeMaxDims];
+  size_t outS[kTransposeMaxDims];
+  size_t m = 0;
+  for (size_t i = 0; i < numDims; i++) {
+    if (odim[i] == 1) {
+      continue;
+    }
+    size_t in = inStrides[shuffle[i]];
+    if (m > 0 && inS[m - 1] == in * odim[i]) {
+      sizes[m - 1] *= odim[i];
+      inS[m - 1] = in;
+      continue;
+    }
+    sizes[m] = odim[i];
+    inS[m] = in;
+    m++;
+  }
+  if (m == 0) {
+    outW[0] = inW[0];
     return;
   }
-  if (numDims == 4) {
-    for (size_t x = 0; x < odim[0]; x++)
-      for (size_t y = 0; y < odim[1]; y++)
-        for (size_t z = 0; z < odim[2]; z++)
-          for (size_t w = 0; w < odim[3]; w++) {
-            SC[shuffle[0]] = x;
-            SC[shuffle[1]] = y;
-            SC[shuffle[2]] = z;
-            SC[shuffle[3]] = w;
-            outW[libjit_getXYZW(odim, x, y, z, w)] =
-                inW[libjit_getXYZW(idim, SC[0], SC[1], SC[2], SC[3])];
-          }
+  stride = 1;
+  for (size_t i = m; i > 0; i--) {
+    outS[i - 1] = stride;
+    stride *= sizes[i - 1];
+  }
+
+  // The output dimension which is innermost in the input. Its stride is 1, as
+  // the dimensions after it in the input have size 1.
+  size_t inner = 0;
+  for (size_t i = 1; i < m; i++) {
+    if (inS[i] < inS[inner]) {
+      inner = i;
+    }
+  }
+
+  // The dimensions that are iterated around the copy of rows, or around the
+  // 2D transposes of the inner and of the last dimensions.
+  size_t outer[kTransposeMaxDims];
+  size_t numOuter = 0;
+  size_t numIters = 1;
+  for (size_t i = 0; i + 1 < m; i++) {
+    if (i != inner) {
+      outer[numOuter++] = i;
+      numIters *= sizes[i];
+    }
+  }
+
+  size_t counters[kTransposeMaxDims] = {0};
+  const T *in = inW;
+  T *out = outW;
+  for (size_t it = 0; it < numIters; it++) {
+    if (inner == m - 1) {
+      memcpy(out, in, sizes[m - 1] * sizeof(T));
+    } else {
+      libjit_transpose_2d(in, out, sizes[inner], sizes[m - 1], inS[inner],
+                          inS[m - 1], outS[inner], 1);
+    }
+
+    // Step to the next index of the outer dimensions.
+    for (size_t d = numOuter; d > 0; d--) {
+      size_t dim = outer[d - 1];
+      in += inS[dim];
+      out += outS[dim];
+      if (++counters[d - 1] < sizes[dim]) {
+        break;
+      }
+      in -= inS[dim] * sizes[dim];
+      out -= outS[dim] * sizes[dim];
+      counters[d - 1] = 0;
+    }
+  }
+}
+
+/// The number of channels whose int32 sums the quantized average pools
+/// accumulate at once.
+constexpr size_t kPoolChannelBlock = 64;
+
+/// The arguments of the NHWC pools, which compute the output rows in
+/// parallel. The window of an output pixel is made of the input pixels of
+/// rows [x0, x1) and columns [y0, y1), see libjit_pool_window, and every
+/// pixel of the window is a contiguous vector of channels, so the pools are
+/// vectorized across the channels.
+struct PoolArgs {
+  const void *in;
+  void *out;
+  const size_t *inDims;
+  const size_t *outDims;
+  size_t kernelH;
+  size_t kernelW;
+  size_t strideH;
+  size_t strideW;
+  size_t padT;
+  size_t padL;
+  /// Whether the windows are the ones of AdaptiveAvgPool, which split the
+  /// input evenly into the output pixels, instead of the kernels.
+  bool adaptive;
+  /// The offsets of the quantized pools.
+  int32_t inOffset;
+  int32_t outOffset;
+  /// The scaling of the sums of the windows of the quantized AvgPool.
+  int32_t outPre;
+  int32_t outPost;
+  int32_t outScale;
+  /// The ratio of the input and output scales of the quantized
+  /// AdaptiveAvgPool, whose windows have different sizes.
+  float scaleRatio;
+};
+
+/// Computes the valid part [\p begin, \p end) of the window of the output
+/// index \p o along the dimension of the input size \p inSize and output
+/// size \p outSize, with the kernel \p kernel, \p stride and \p pad.
+inline void libjit_pool_range(const PoolArgs *args, size_t o, size_t inSize,
+                              size_t outSize, size_t kernel, size_t stride,
+                              size_t pad, size_t *begin, size_t *end) {
+  if (args->adaptive) {
+    // The windows of PyTorch: [floor(o * in / out), ceil((o + 1) * in / out)).
+    *begin = o * inSize / outSize;
+    *end = ((o + 1) * inSize + outSize - 1) / outSize;
     return;
   }
-  if (numDims == 3) {
-    for (size_t x = 0; x < odim[0]; x++) {
-      // Process the tiles in the innermost two dimensions:
-      for (size_t sy = 0; sy < odim[1]; sy += tileSize) {
-        for (size_t sz = 0; sz < odim[2]; sz += tileSize) {
-          // Process the inner tile:
-          for (size_t y = sy; y < MIN(sy + tileSize, odim[1]); y++) {
-            for (size_t z = sz; z < MIN(sz + tileSize, odim[2]); z++) {
-              SC[shuffle[0]] = x;
-              SC[shuffle[1]] = y;
-              SC[shuffle[2]] = z;
-              outW[libjit_getXYZ(odim, x, y, z)] =
-                  inW[libjit_getXYZ(idim, SC[0], SC[1], SC[2])];
-            }
+  ssize_t first = (ssize_t)(o * stride) - (ssize_t)pad;
+  ssize_t last = first + (ssize_t)kernel;
+  *begin = (size_t)MAX(first, (ssize_t)0);
+  *end = (size_t)MAX(MIN(last, (ssize_t)inSize), (ssize_t)*begin);
+}
+
+/// Computes the window of the output pixel (\p ax, \p ay) of \p args.
+inline void libjit_pool_window(const PoolArgs *args, size_t ax, size_t ay,
+                               size_t *x0, size_t *x1, size_t *y0,
+                               size_t *y1) {
+  libjit_pool_range(args, ax, args->inDims[1], args->outDims[1],
+                    args->kernelH, args->strideH, args->padT, x0, x1);
+  libjit_pool_range(args, ay, args->inDims[2], args->outDims[2],
+                    args->kernelW, args->strideW, args->padL, y0, y1);
+}
+
+/// Computes the MaxPool output rows [\p begin, \p end), numbered over the
+/// batch and the height, of \p ctx. The windows that are all padding are
+/// zeros.
+template <typename T>
+static void libjit_max_pool_body(size_t begin, size_t end, void *ctx) {
+  const PoolArgs *args = (const PoolArgs *)ctx;
+  const T *in = (const T *)args->in;
+  T *out = (T *)args->out;
+  const size_t *inDims = args->inDims;
+  const size_t *outDims = args->outDims;
+  const size_t C = inDims[3];
+  for (size_t row = begin; row < end; row++) {
+    size_t n = row / outDims[1];
+    size_t ax = row % outDims[1];
+    for (size_t ay = 0; ay < outDims[2]; ay++) {
+      T *dest = out + libjit_getXYZW(outDims, n, ax, ay, 0);
+      size_t x0, x1, y0, y1;
+      libjit_pool_window(args, ax, ay, &x0, &x1, &y0, &y1);
+      if (x0 == x1 || y0 == y1) {
+        memset(dest, 0, C * sizeof(T));
+        continue;
+      }
+      memcpy(dest, in + libjit_getXYZW(inDims, n, x0, y0, 0), C * sizeof(T));
+      for (size_t x = x0; x < x1; x++) {
+        for (size_t y = x == x0 ? y0 + 1 : y0; y < y1; y++) {
+          const T *src = in + libjit_getXYZW(inDims, n, x, y, 0);
+          for (size_t z = 0; z < C; z++) {
+            dest[z] = MAX(dest[z], src[z]);
           }
         }
       }
     }
-    return;
   }
+}
 
-  if (numDims == 2) {
-    // Process the tiles in the matrix:
-    for (size_t sx = 0; sx < odim[0]; sx += tileSize) {
-      for (size_t sy = 0; sy < odim[1]; sy += tileSize) {
-        // Process the inner tile:
-        for (size_t x = sx; x < MIN(sx + tileSize, odim[0]); x++) {
-          for (size_t y = sy; y < MIN(sy + tileSize, odim[1]); y++) {
-            SC[shuffle[0]] = x;
-            SC[shuffle[1]] = y;
-            outW[libjit_getXY(odim, x, y)] =
-                inW[libjit_getXY(idim, SC[0], SC[1])];
+/// Computes the float AvgPool or AdaptiveAvgPool output rows [\p begin,
+/// \p end) of \p ctx. The sums of AvgPool are divided by the area of the
+/// kernel, which counts the padding, the ones of AdaptiveAvgPool by the area
+/// of their window.
+static void libjit_avg_pool_f_body(size_t begin, size_t end, void *ctx) {
+  const PoolArgs *args = (const PoolArgs *)ctx;
+  const float *in = (const float *)args->in;
+  float *out = (float *)args->out;
+  const size_t *inDims = args->inDims;
+  const size_t *outDims = args->outDims;
+  const size_t C = inDims[3];
+  for (size_t row = begin; row < end; row++) {
+    size_t n = row / outDims[1];
+    size_t ax = row % outDims[1];
+    for (size_t ay = 0; ay < outDims[2]; ay++) {
+      float *dest = out + libjit_getXYZW(outDims, n, ax, ay, 0);
+      size_t x0, x1, y0, y1;
+      libjit_pool_window(args, ax, ay, &x0, &x1, &y0, &y1);
+      for (size_t z = 0; z < C; z++) {
+        dest[z] = 0;
+      }
+      for (size_t x = x0; x < x1; x++) {
+        // The pixels of the row of the window are contiguous, e.g. all the
+        // pixels of a global average pool are summed in one loop per row.
+        const float *src = in + libjit_getXYZW(inDims, n, x, y0, 0);
+        for (size_t i = 0, e = (y1 - y0) * C; i < e; i += C) {
+          for (size_t z = 0; z < C; z++) {
+            dest[z] += src[i + z];
           }
         }
       }
+      if (args->adaptive) {
+        // Divides like the Interpreter.
+        float kW = y1 - y0;
+        float kH = x1 - x0;
+        for (size_t z = 0; z < C; z++) {
+          dest[z] = dest[z] / kW / kH;
+        }
+        continue;
+      }
+      float filterArea = args->kernelH * args->kernelW;
+      for (size_t z = 0; z < C; z++) {
+        dest[z] = dest[z] / filterArea;
+      }
     }
-    return;
   }
 }
 
-template <typename T>
-static void libjit_max_pool_generic(const T *inW, T *outW,
-                                    const size_t *inWdims,
-                                    const size_t *outWdims, size_t *kernelSizes,
-                                    size_t *strides, size_t *pads) {
-  size_t pad_t = pads[0];
-  size_t pad_l = pads[1];
-  size_t stride_h = strides[0];
-  size_t stride_w = strides[1];
-  size_t kernel_h = kernelSizes[0];
-  size_t kernel_w = kernelSizes[1];
-  // For each sample in the batch:
-  for (size_t n = 0; n < outWdims[0]; n++) {
-    // For each (x,y) step in the input/output tensor:
-    ssize_t x = -(ssize_t)pad_t;
-    for (size_t ax = 0; ax < outWdims[1]; x += stride_h, ax++) {
-      ssize_t y = -(ssize_t)pad_l;
-      for (size_t ay = 0; ay < outWdims[2]; y += stride_w, ay++) {
-
-        // For each layer in the output tensor:
-        for (size_t z = 0; z < inWdims[3]; z++) {
-          int first = 1;
-          T max = 0;
-
-          // For each element in the pool filter:
-          for (size_t fx = 0; fx < kernel_h; fx++) {
-            for (size_t fy = 0; fy < kernel_w; fy++) {
-              ssize_t ox = x + fx;
-              ssize_t oy = y + fy;
-
-              // Ignore index access below zero (this is due to padding).
-              if (ox < 0 || oy < 0 || ox >= (ssize_t)inWdims[1] ||
-                  oy >= (ssize_t)inWdims[2]) {
-                continue;
-              }
-
-              float val =
-                  inW[libjit_getXYZW(inWdims, n, (size_t)ox, (size_t)oy, z)];
-
-              if (first || (val >= max)) {
-                first = 0;
-                max = val;
-              }
+/// Computes the quantized AvgPool or AdaptiveAvgPool output rows [\p begin,
+/// \p end) of \p ctx. The int32 sums of the windows are accumulated for
+/// kPoolChannelBlock channels at a time. AvgPool scales them with the
+/// integer multiplier of the kernel area, AdaptiveAvgPool, whose windows
+/// have different areas, in float like the Interpreter.
+static void libjit_avg_pool_i8_body(size_t begin, size_t end, void *ctx) {
+  const PoolArgs *args = (const PoolArgs *)ctx;
+  const int8_t *in = (const int8_t *)args->in;
+  int8_t *out = (int8_t *)args->out;
+  const size_t *inDims = args->inDims;
+  const size_t *outDims = args->outDims;
+  const size_t C = inDims[3];
+  int32_t sum[kPoolChannelBlock];
+  for (size_t row = begin; row < end; row++) {
+    size_t n = row / outDims[1];
+    size_t ax = row % outDims[1];
+    for (size_t ay = 0; ay < outDims[2]; ay++) {
+      int8_t *dest = out + libjit_getXYZW(outDims, n, ax, ay, 0);
+      size_t x0, x1, y0, y1;
+      libjit_pool_window(args, ax, ay, &x0, &x1, &y0, &y1);
+      const int32_t count = (x1 - x0) * (y1 - y0);
+      for (size_t c = 0; c < C; c += kPoolChannelBlock) {
+        const size_t numChannels = MIN(kPoolChannelBlock, C - c);
+        for (size_t z = 0; z < numChannels; z++) {
+          sum[z] = 0;
+        }
+        for (size_t x = x0; x < x1; x++) {
+          const int8_t *src = in + libjit_getXYZW(inDims, n, x, y0, c);
+          for (size_t i = 0, e = (y1 - y0) * C; i < e; i += C) {
+            for (size_t z = 0; z < numChannels; z++) {
+              sum[z] += src[i + z];
             }
           }
+        }
+        if (args->adaptive) {
+          const float scale =
+              args->scaleRatio / (float)(y1 - y0) / (float)(x1 - x0);
+          for (size_t z = 0; z < numChannels; z++) {
+            int32_t val = sum[z] - count * args->inOffset;
+            dest[c + z] = libjit_clip(
+                (int32_t)roundf(val * scale + args->outOffset));
+          }
+        } else {
+          for (size_t z = 0; z < numChannels; z++) {
+            int32_t val = sum[z] - count * args->inOffset;
+            dest[c + z] = libjit_clip(
+                libjit_scale_i32i8(val, args->outPre, args->outPost,
+                                   args->outScale, args->outOffset));
+          }
+        }
+      }
+    }
+  }
+}
 
-          outW[libjit_getXYZW(outWdims, n, ax, ay, z)] = max;
-        } // C
-      }   // W
-    }     // H
-  }       // N
+/// Fills the arguments \p args of a pool of \p inW of dims \p inWdims into
+/// \p outW of dims \p outWdims with \p kernelSizes, \p strides and \p pads,
+/// which are null for AdaptiveAvgPool.
+static void libjit_init_pool_args(PoolArgs *args, const void *inW, void *outW,
+                                  const size_t *inWdims,
+                                  const size_t *outWdims,
+                                  const size_t *kernelSizes,
+                                  const size_t *strides, const size_t *pads) {
+  memset(args, 0, sizeof(PoolArgs));
+  args->in = inW;
+  args->out = outW;
+  args->inDims = inWdims;
+  args->outDims = outWdims;
+  args->adaptive = !kernelSizes;
+  if (kernelSizes) {
+    args->kernelH = kernelSizes[0];
+    args->kernelW = kernelSizes[1];
+    args->strideH = strides[0];
+    args->strideW = strides[1];
+    args->padT = pads[0];
+    args->padL = pads[1];
+  }
 }
 
 template <typename T>
@@ -731,6 +1218,23 @@ static void libjit_batchedadd_quantized(int8_t *dest, const int8_t *batch,
   }
 }
 
+/// Adds \p slice to every slice of the int16 \p batch, whose scales are
+/// brought to the scale of \p dest by \p batchScale and \p sliceScale.
+template <typename T>
+static void libjit_batchedadd_quantized_i16(
+    int16_t *dest, const int16_t *batch, const T *slice, size_t numSlice,
+    size_t sliceSize, int32_t destOffset, int32_t batchOffset,
+    int32_t sliceOffset, float batchScale, float sliceScale) {
+  for (size_t n = 0; n < numSlice; n++) {
+    size_t base = n * sliceSize;
+    for (size_t i = 0; i < sliceSize; i++) {
+      float x = (batch[base + i] - batchOffset) * batchScale;
+      float y = ((int64_t)slice[i] - sliceOffset) * sliceScale;
+      dest[base + i] = libjit_clip_i16(x + y + destOffset);
+    }
+  }
+}
+
 static void find_min_max_f(float *tensor, size_t size, float &min, float &max) {
   min = tensor[0];
   max = tensor[0];
@@ -805,6 +1309,148 @@ libjit_space_to_depth_generic(const T *inPtr, T *outPtr, size_t blockSize,
     }
   }
 }
+
+/// The arguments of the ResizeNearest and ResizeBilinear kernels, which
+/// process the rows of the NHWC output in [N * H]. LLVMIRGen computes the
+/// input pixels of every output row and column, and the bilinear weights.
+struct ResizeArgs {
+  const void *in;
+  void *out;
+  const size_t *inDims;
+  const size_t *outDims;
+  /// The two input rows of every output row, the second one contributing
+  /// rowWeights of the output. ResizeNearest only uses the first one.
+  const size_t *rows;
+  const float *rowWeights;
+  /// The offsets in the rows of the two input pixels of every output column,
+  /// the second one contributing colWeights of the output.
+  const size_t *cols;
+  const float *colWeights;
+  /// The offsets, and the ratio of the input and output scales, of the
+  /// quantized kernels.
+  int32_t inOffset;
+  int32_t outOffset;
+  float scaleRatio;
+};
+
+template <typename T>
+static void libjit_resize_nearest_body(size_t begin, size_t end, void *ctx) {
+  const ResizeArgs *args = (const ResizeArgs *)ctx;
+  const T *in = (const T *)args->in;
+  T *out = (T *)args->out;
+  const size_t outH = args->outDims[1];
+  const size_t outRow = args->outDims[2] * args->outDims[3];
+  const size_t C = args->inDims[3];
+  for (size_t row = begin; row < end; row++) {
+    size_t n = row / outH;
+    size_t oh = row % outH;
+    T *dest = out + row * outRow;
+    // The rows upsampled from the same input row are copies of each other.
+    if (row > begin && oh && args->rows[2 * oh] == args->rows[2 * oh - 2]) {
+      memcpy(dest, dest - outRow, outRow * sizeof(T));
+      continue;
+    }
+    const T *src =
+        in + libjit_getXYZW(args->inDims, n, args->rows[2 * oh], 0, 0);
+    for (size_t ow = 0, e = args->outDims[2]; ow < e; ow++) {
+      libjit_copy_slice(dest + ow * C, src + args->cols[2 * ow], C * sizeof(T));
+    }
+  }
+}
+
+static void libjit_resize_bilinear_f_body(size_t begin, size_t end,
+                                          void *ctx) {
+  const ResizeArgs *args = (const ResizeArgs *)ctx;
+  const float *in = (const float *)args->in;
+  float *out = (float *)args->out;
+  const size_t outH = args->outDims[1];
+  const size_t C = args->inDims[3];
+  for (size_t row = begin; row < end; row++) {
+    size_t n = row / outH;
+    size_t oh = row % outH;
+    const float *top =
+        in + libjit_getXYZW(args->inDims, n, args->rows[2 * oh], 0, 0);
+    const float *bottom =
+        in + libjit_getXYZW(args->inDims, n, args->rows[2 * oh + 1], 0, 0);
+    const float lh = args->rowWeights[oh];
+    float *dest = out + row * args->outDims[2] * C;
+    // Interpolate the channels of the pixels, which are contiguous and
+    // vectorized.
+    for (size_t ow = 0, e = args->outDims[2]; ow < e; ow++, dest += C) {
+      const float *a = top + args->cols[2 * ow];
+      const float *b = top + args->cols[2 * ow + 1];
+      const float *c = bottom + args->cols[2 * ow];
+      const float *d = bottom + args->cols[2 * ow + 1];
+      const float lw = args->colWeights[ow];
+      for (size_t z = 0; z < C; z++) {
+        float t = a[z] + (b[z] - a[z]) * lw;
+        float u = c[z] + (d[z] - c[z]) * lw;
+        dest[z] = t + (u - t) * lh;
+      }
+    }
+  }
+}
+
+static void libjit_resize_bilinear_i8_body(size_t begin, size_t end,
+                                           void *ctx) {
+  const ResizeArgs *args = (const ResizeArgs *)ctx;
+  const int8_t *in = (const int8_t *)args->in;
+  int8_t *out = (int8_t *)args->out;
+  const size_t outH = args->outDims[1];
+  const size_t C = args->inDims[3];
+  const float inOffset = args->inOffset;
+  const float outOffset = args->outOffset;
+  const float scaleRatio = args->scaleRatio;
+  for (size_t row = begin; row < end; row++) {
+    size_t n = row / outH;
+    size_t oh = row % outH;
+    const int8_t *top =
+        in + libjit_getXYZW(args->inDims, n, args->rows[2 * oh], 0, 0);
+    const int8_t *bottom =
+        in + libjit_getXYZW(args->inDims, n, args->rows[2 * oh + 1], 0, 0);
+    const float lh = args->rowWeights[oh];
+    int8_t *dest = out + row * args->outDims[2] * C;
+    // The weights add up to 1, so the input offset is subtracted once from
+    // the interpolation of the quantized values.
+    for (size_t ow = 0, e = args->outDims[2]; ow < e; ow++, dest += C) {
+      const int8_t *a = top + args->cols[2 * ow];
+      const int8_t *b = top + args->cols[2 * ow + 1];
+      const int8_t *c = bottom + args->cols[2 * ow];
+      const int8_t *d = bottom + args->cols[2 * ow + 1];
+      const float lw = args->colWeights[ow];
+      for (size_t z = 0; z < C; z++) {
+        float t = a[z] + (float)(b[z] - a[z]) * lw;
+        float u = c[z] + (float)(d[z] - c[z]) * lw;
+        float v = t + (u - t) * lh;
+        dest[z] = libjit_clip(
+            (int32_t)nearbyintf((v - inOffset) * scaleRatio + outOffset));
+      }
+    }
+  }
+}
+
+/// Runs the resize kernel \p body on the NHWC \p in of \p inDims into \p out
+/// of \p outDims, see ResizeArgs.
+static void libjit_resize(libjit_parallel_body body, const void *in,
+                          void *out, const size_t *inDims,
+                          const size_t *outDims, const size_t *rows,
+                          const float *rowWeights, const size_t *cols,
+                          const float *colWeights, int32_t inOffset,
+                          int32_t outOffset, float scaleRatio) {
+  ResizeArgs args;
+  args.in = in;
+  args.out = out;
+  args.inDims = inDims;
+  args.outDims = outDims;
+  args.rows = rows;
+  args.rowWeights = rowWeights;
+  args.cols = cols;
+  args.colWeights = colWeights;
+  args.inOffset = inOffset;
+  args.outOffset = outOffset;
+  args.scaleRatio = scaleRatio;
+  libjit_parallel_for(outDims[0] * outDims[1], body, &args);
+}
 /// The dimensions passed in here are pre-expanded in LLVMIRGen with 1s so that
 /// we can iterate over the shape here, regardless of the shape of the tensor.
 template <typename T>
@@ -838,6 +1484,827 @@ static void libjit_reducemin(T *dest, const T *batch, size_t destSize,
     }
   }
 }
+
+/// The number of partial results of the reductions of contiguous rows, which
+/// are combined at the end of the rows so that the rows are reduced in
+/// vectors.
+constexpr size_t kReduceLanes = 16;
+
+/// The number of elements of the output rows that the reductions of the outer
+/// axes compute at once.
+constexpr size_t kReduceBlock = 1024;
+
+/// Views a reduction of \p batchDims into \p destDims, both expanded to 6
+/// dimensions, as the reduction of the middle dimension of a tensor of shape
+/// [\p outer, \p reduced, \p inner]. \returns false if the reduced axes are
+/// not contiguous, ignoring the dimensions of size 1.
+inline bool libjit_get_reduce_shape(const size_t *destDims,
+                                    const size_t *batchDims, size_t *outer,
+                                    size_t *reduced, size_t *inner) {
+  *outer = *reduced = *inner = 1;
+  // 0 before the reduced axes, 1 in them, 2 after them.
+  int part = 0;
+  for (size_t i = 0; i < 6; i++) {
+    if (batchDims[i] == 1) {
+      continue;
+    }
+    if (destDims[i] == 1) {
+      if (part == 2) {
+        return false;
+      }
+      part = 1;
+      *reduced *= batchDims[i];
+      continue;
+    }
+    if (part == 1) {
+      part = 2;
+    }
+    *(part == 0 ? outer : inner) *= batchDims[i];
+  }
+  return true;
+}
+
+/// Arguments of a reduction of the middle dimension of a tensor of shape
+/// [outer, reduced, inner], see libjit_get_reduce_shape.
+struct ReduceArgs {
+  const void *batch;
+  void *dest;
+  size_t outer;
+  size_t reduced;
+  size_t inner;
+  /// The quantization parameters of the int8 sums.
+  int32_t destOffset;
+  int32_t batchOffset;
+  int32_t batchPre;
+  int32_t batchPost;
+  int32_t batchScale;
+};
+
+/// \returns the number of iterations of the reduction of \p args: the rows of
+/// the reduced dimension when it is the innermost one, otherwise the blocks
+/// of kReduceBlock elements of the outer rows.
+inline size_t libjit_get_reduce_iters(const ReduceArgs *args) {
+  if (args->inner == 1) {
+    return args->outer;
+  }
+  return args->outer * ((args->inner + kReduceBlock - 1) / kReduceBlock);
+}
+
+/// The operations of the reductions, whose results start at init() and which
+/// combine the elements with apply().
+template <typename T> struct ReduceAddOp {
+  static T init() { return 0; }
+  static T apply(T a, T b) { return a + b; }
+};
+
+template <typename T> struct ReduceMinOp {
+  static T init() { return std::numeric_limits<T>::max(); }
+  static T apply(T a, T b) { return std::min(a, b); }
+};
+
+/// Computes the iterations [\p begin, \p end) of the reduction \p ctx with
+/// the operation \p Op, see libjit_get_reduce_iters. The elements of the rows
+/// of the reduced dimension are combined into kReduceLanes partial results,
+/// the rows of the outer dimensions are combined in order.
+template <typename T, typename Op>
+static void libjit_reduce_body(size_t begin, size_t end, void *ctx) {
+  const ReduceArgs *args = (const ReduceArgs *)ctx;
+  const T *batch = (const T *)args->batch;
+  T *dest = (T *)args->dest;
+  const size_t reduced = args->reduced;
+  const size_t inner = args->inner;
+  if (inner == 1) {
+    for (size_t i = begin; i < end; i++) {
+      const T *row = batch + i * reduced;
+      T acc[kReduceLanes];
+      for (size_t l = 0; l < kReduceLanes; l++) {
+        acc[l] = Op::init();
+      }
+      size_t k = 0;
+      for (; k + kReduceLanes <= reduced; k += kReduceLanes) {
+        for (size_t l = 0; l < kReduceLanes; l++) {
+          acc[l] = Op::apply(acc[l], row[k + l]);
+        }
+      }
+      T res = Op::init();
+      for (size_t l = 0; l < kReduceLanes; l++) {
+        res = Op::apply(res, acc[l]);
+      }
+      for (; k < reduced; k++) {
+        res = Op::apply(res, row[k]);
+      }
+      dest[i] = res;
+    }
+    return;
+  }
+  const size_t numBlocks = (inner + kReduceBlock - 1) / kReduceBlock;
+  for (size_t i = begin; i < end; i++) {
+    size_t o = i / numBlocks;
+    size_t z0 = (i % numBlocks) * kReduceBlock;
+    size_t numElems = MIN(kReduceBlock, inner - z0);
+    T *out = dest + o * inner + z0;
+    const T *in = batch + o * reduced * inner + z0;
+    for (size_t z = 0; z < numElems; z++) {
+      out[z] = Op::init();
+    }
+    for (size_t k = 0; k < reduced; k++) {
+      const T *row = in + k * inner;
+      for (size_t z = 0; z < numElems; z++) {
+        out[z] = Op::apply(out[z], row[z]);
+      }
+    }
+  }
+}
+
+/// Same as libjit_reduce_body for the int8 sums, which are accumulated in
+/// int32 and then scaled to the output.
+static void libjit_reduce_add_i8_body(size_t begin, size_t end, void *ctx) {
+  const ReduceArgs *args = (const ReduceArgs *)ctx;
+  const int8_t *batch = (const int8_t *)args->batch;
+  int8_t *dest = (int8_t *)args->dest;
+  const size_t reduced = args->reduced;
+  const size_t inner = args->inner;
+  int32_t sum[kReduceBlock];
+  if (inner == 1) {
+    for (size_t i = begin; i < end; i++) {
+      const int8_t *row = batch + i * reduced;
+      int32_t acc[kReduceLanes] = {0};
+      size_t k = 0;
+      for (; k + kReduceLanes <= reduced; k += kReduceLanes) {
+        for (size_t l = 0; l < kReduceLanes; l++) {
+          acc[l] += row[k + l];
+        }
+      }
+      int32_t res = 0;
+      for (size_t l = 0; l < kReduceLanes; l++) {
+        res += acc[l];
+      }
+      for (; k < reduced; k++) {
+        res += row[k];
+      }
+      res -= (int32_t)reduced * args->batchOffset;
+      dest[i] = libjit_clip(libjit_scale_i32i8(res, args->batchPre,
+                                               args->batchPost,
+                                               args->batchScale,
+                                               args->destOffset));
+    }
+    return;
+  }
+  const size_t numBlocks = (inner + kReduceBlock - 1) / kReduceBlock;
+  for (size_t i = begin; i < end; i++) {
+    size_t o = i / numBlocks;
+    size_t z0 = (i % numBlocks) * kReduceBlock;
+    size_t numElems = MIN(kReduceBlock, inner - z0);
+    const int8_t *in = batch + o * reduced * inner + z0;
+    for (size_t z = 0; z < numElems; z++) {
+      sum[z] = 0;
+    }
+    for (size_t k = 0; k < reduced; k++) {
+      const int8_t *row = in + k * inner;
+      for (size_t z = 0; z < numElems; z++) {
+        sum[z] += row[z];
+      }
+    }
+    int8_t *out = dest + o * inner + z0;
+    for (size_t z = 0; z < numElems; z++) {
+      int32_t res = sum[z] - (int32_t)reduced * args->batchOffset;
+      out[z] = libjit_clip(libjit_scale_i32i8(res, args->batchPre,
+                                              args->batchPost,
+                                              args->batchScale,
+                                              args->destOffset));
+    }
+  }
+}
+
+/// Reduces \p batch of dims \p batchDims into \p dest of dims \p destDims with
+/// the operation \p Op, in parallel. \returns false, computing nothing, if
+/// the reduced axes are not contiguous.
+template <typename T, typename Op>
+static bool libjit_reduce(T *dest, const T *batch, const size_t *destDims,
+                          const size_t *batchDims) {
+  ReduceArgs args;
+  if (!libjit_get_reduce_shape(destDims, batchDims, &args.outer,
+                               &args.reduced, &args.inner)) {
+    return false;
+  }
+  args.batch = batch;
+  args.dest = dest;
+  libjit_parallel_for(libjit_get_reduce_iters(&args),
+                      &libjit_reduce_body<T, Op>, &args);
+  return true;
+}
+
+/// How the rows of a segment of a SparseLengths operation are pooled.
+enum class SLSPooling { Sum, Mean, Max };
+
+/// \returns the weight of the rows of a segment of \p length rows pooled by
+/// \p pooling. It is unused by Max.
+static float libjit_sls_pooling_weight(SLSPooling pooling, int32_t length) {
+  return pooling == SLSPooling::Mean ? 1.0f / length : 1.0f;
+}
+
+/// Arguments of a SparseLengths(Weighted)Sum, Mean or Max passed to the body
+/// of its parallel loop. \p weights is null for the unweighted variants.
+struct SparseLengthsSumArgs {
+  float *dest;
+  const float *data;
+  const float *weights;
+  const size_t *indices;
+  const int32_t *lengths;
+  size_t lineSize;
+  SLSPooling pooling;
+};
+
+/// Compute the output segments [\p begin, \p end) of a
+/// SparseLengths(Weighted)Sum, Mean or Max described by \p ctx. Segments
+/// are independent, so different ranges may be processed concurrently. The
+/// rows are read once in all the modes, and empty segments stay zero.
+static void libjit_sparse_lengths_sum_body(size_t begin, size_t end,
+                                           void *ctx) {
+  const SparseLengthsSumArgs *args = (const SparseLengthsSumArgs *)ctx;
+  const size_t lineSize = args->lineSize;
+  // Find the first index used by segment \p begin.
+  size_t curIndex = 0;
+  for (size_t i = 0; i < begin; i++) {
+    curIndex += args->lengths[i];
+  }
+  for (size_t i = begin; i < end; i++) {
+    float *dest = args->dest + i * lineSize;
+    const int32_t length = args->lengths[i];
+    const float segmentWeight =
+        libjit_sls_pooling_weight(args->pooling, length);
+    for (int32_t j = 0; j < length; j++) {
+      const float *line = args->data + args->indices[curIndex] * lineSize;
+      if (args->pooling == SLSPooling::Max) {
+        for (size_t k = 0; k < lineSize; k++) {
+          dest[k] = j ? MAX(dest[k], line[k]) : line[k];
+        }
+      } else {
+        float weight = args->weights ? args->weights[curIndex] : segmentWeight;
+        for (size_t k = 0; k < lineSize; k++) {
+          dest[k] += weight * line[k];
+        }
+      }
+      curIndex++;
+    }
+  }
+}
+
+/// Number of weights updated by an iteration of the parallel loop of an SGD
+/// update.
+constexpr size_t kSGDBlockSize = 4096;
+
+/// Arguments of an SGD update passed to the body of its parallel loop.
+/// \p gsum and \p destGsum are null without momentum.
+struct SGDArgs {
+  float *dest;
+  float *destGsum;
+  const float *gradient;
+  const float *weight;
+  const float *gsum;
+  size_t size;
+  float L1Decay;
+  float L2Decay;
+  float learningRate;
+  float momentum;
+  float batchSize;
+};
+
+/// Update the blocks [\p begin, \p end) of kSGDBlockSize weights of the SGD
+/// update described by \p ctx, computing the same steps as the lowered SGD
+/// node. Every weight only depends on itself, so different ranges may be
+/// processed concurrently, and the outputs may alias the inputs.
+static void libjit_sgd_body(size_t begin, size_t end, void *ctx) {
+  const SGDArgs *args = (const SGDArgs *)ctx;
+  size_t last = std::min(end * kSGDBlockSize, args->size);
+  for (size_t i = begin * kSGDBlockSize; i < last; i++) {
+    float w = args->weight[i];
+    float g = args->gradient[i];
+    if (args->L1Decay != 0) {
+      g += args->L1Decay * (w >= 0 ? 1.0f : -1.0f);
+    }
+    if (args->L2Decay != 0) {
+      g += args->L2Decay * w;
+    }
+    if (args->batchSize > 1) {
+      g /= args->batchSize;
+    }
+    float dx = -args->learningRate * g;
+    if (args->gsum) {
+      dx = args->momentum * args->gsum[i] + dx;
+      args->destGsum[i] = dx;
+    }
+    args->dest[i] = w + dx;
+  }
+}
+
+/// Accumulate \p weight * (\p scale * row[k] + \p offset) into dest[k] for
+/// every k in [0, \p lineSize). The float8 operations are lowered to the
+/// widest vector instructions of the target CPU (AVX2 or AVX-512 on x86).
+static void libjit_accumulate_dequantized_row(float *dest, const uint8_t *row,
+                                              size_t lineSize, float scale,
+                                              float offset, float weight) {
+  // weight * (scale * x + offset) == (weight * scale) * x + weight * offset.
+  const float ws = weight * scale;
+  const float wo = weight * offset;
+  const float8 ws8 = BroadcastFloat8(ws);
+  const float8 wo8 = BroadcastFloat8(wo);
+  size_t k = 0;
+  for (; k + 16 <= lineSize; k += 16) {
+    float8 lo = LoaduUInt8AsFloat8(row + k) * ws8 + wo8;
+    float8 hi = LoaduUInt8AsFloat8(row + k + 8) * ws8 + wo8;
+    AdduFloat8(dest + k, lo);
+    AdduFloat8(dest + k + 8, hi);
+  }
+  for (; k + 8 <= lineSize; k += 8) {
+    AdduFloat8(dest + k, LoaduUInt8AsFloat8(row + k) * ws8 + wo8);
+  }
+  for (; k < lineSize; k++) {
+    dest[k] += ws * row[k] + wo;
+  }
+}
+
+/// Same as libjit_accumulate_dequantized_row, but for a \p row of 4-bit
+/// values, two in every byte with the even columns in the low bits. The bytes
+/// are unpacked into vectors of nibbles, which are lowered to shifts, masks
+/// and shuffles of the target vector registers.
+static void libjit_accumulate_dequantized_4bit_row(float *dest,
+                                                   const uint8_t *row,
+                                                   size_t lineSize, float scale,
+                                                   float offset, float weight) {
+  const float ws = weight * scale;
+  const float wo = weight * offset;
+  const float8 ws8 = BroadcastFloat8(ws);
+  const float8 wo8 = BroadcastFloat8(wo);
+  size_t k = 0;
+  for (; k + 16 <= lineSize; k += 16) {
+    float8 lo = LoaduUInt4AsFloat8(row + k / 2) * ws8 + wo8;
+    float8 hi = LoaduUInt4AsFloat8(row + k / 2 + 4) * ws8 + wo8;
+    AdduFloat8(dest + k, lo);
+    AdduFloat8(dest + k + 8, hi);
+  }
+  for (; k + 8 <= lineSize; k += 8) {
+    AdduFloat8(dest + k, LoaduUInt4AsFloat8(row + k / 2) * ws8 + wo8);
+  }
+  for (; k < lineSize; k++) {
+    dest[k] += ws * ((row[k / 2] >> (4 * (k % 2))) & 0xf) + wo;
+  }
+}
+
+/// Accumulate \p weight * row[k] into dest[k] for every k in [0, \p lineSize).
+/// \p row must be aligned to the size of a float8.
+static void libjit_accumulate_row(float *dest, const float *row,
+                                  size_t lineSize, float weight) {
+  const float8 w8 = BroadcastFloat8(weight);
+  size_t k = 0;
+  for (; k + 8 <= lineSize; k += 8) {
+    AdduFloat8(dest + k, LoadFloat8(row + k) * w8);
+  }
+  for (; k < lineSize; k++) {
+    dest[k] += weight * row[k];
+  }
+}
+
+/// Store into dest[k] the maximum of dest[k] and \p scale * row[k] +
+/// \p offset for every k in [0, \p lineSize), or only the latter if
+/// \p first. The loop has no calls, so it is vectorized.
+static void libjit_max_dequantized_row(float *dest, const uint8_t *row,
+                                       size_t lineSize, float scale,
+                                       float offset, bool first) {
+  for (size_t k = 0; k < lineSize; k++) {
+    float d = scale * row[k] + offset;
+    dest[k] = first ? d : MAX(dest[k], d);
+  }
+}
+
+/// Same as libjit_max_dequantized_row, but for a \p row of 4-bit values, two
+/// in every byte with the even columns in the low bits.
+static void libjit_max_dequantized_4bit_row(float *dest, const uint8_t *row,
+                                            size_t lineSize, float scale,
+                                            float offset, bool first) {
+  for (size_t k = 0; k < lineSize; k++) {
+    float d = scale * ((row[k / 2] >> (4 * (k % 2))) & 0xf) + offset;
+    dest[k] = first ? d : MAX(dest[k], d);
+  }
+}
+
+/// Store into dest[k] the maximum of dest[k] and row[k] for every k in
+/// [0, \p lineSize), or only the latter if \p first.
+static void libjit_max_row(float *dest, const float *row, size_t lineSize,
+                           bool first) {
+  for (size_t k = 0; k < lineSize; k++) {
+    dest[k] = first ? row[k] : MAX(dest[k], row[k]);
+  }
+}
+
+/// Arguments of a (Fused)RowwiseQuantizedSparseLengthsWeightedSum, or of a
+/// FusedRowwiseQuantizedSparseLengthsMean or Max, passed to the body of its
+/// parallel loop. For the fused variants the scale and offset of each row are
+/// stored at its end, after \p outLineSize data bytes, and \p scales and
+/// \p offsets are null. \p weights is null for the Mean and Max.
+struct RowwiseQuantizedSLWSArgs {
+  float *dest;
+  const uint8_t *data;
+  const float *scales;
+  const float *offsets;
+  const float *weights;
+  const size_t *indices;
+  const int32_t *lengths;
+  size_t inLineSize;
+  size_t outLineSize;
+  /// Whether the fused scale and offset are stored as float16 values.
+  bool fp16ScaleOffset;
+  /// Whether the fused data packs two 4-bit values in every byte, the even
+  /// columns in the low bits.
+  bool fourBits;
+  /// For the grouped version, the first row, index and segment of each of the
+  /// numTables tables.
+  const size_t *rowOffsets;
+  const size_t *indexOffsets;
+  const size_t *segmentOffsets;
+  size_t numTables;
+  /// The cache of the hot rows of the fused data, or null.
+  const libjit_row_cache *rowCache;
+  /// How the rows of a segment are pooled, Sum for the weighted sums.
+  SLSPooling pooling;
+};
+
+/// \returns the row cache of the table \p data, or null if it has none.
+static const libjit_row_cache *libjit_find_row_cache(const uint8_t *data) {
+  const libjit_row_caches *caches = glow_libjit_row_caches;
+  if (!caches) {
+    return nullptr;
+  }
+  for (size_t i = 0; i < caches->numCaches; i++) {
+    if (caches->caches[i].data == data) {
+      return &caches->caches[i];
+    }
+  }
+  return nullptr;
+}
+
+/// Prefetch the row \p line of the
+/// (Fused)RowwiseQuantizedSparseLengthsWeightedSum described by \p args, from
+/// the row cache if it holds the row.
+static void libjit_prefetch_slws_row(const RowwiseQuantizedSLWSArgs *args,
+                                     size_t line) {
+  if (const libjit_row_cache *cache = args->rowCache) {
+    int32_t slot = cache->slots[line];
+    if (slot >= 0) {
+      libjit_prefetch_row((const uint8_t *)(cache->arena +
+                                            slot * cache->rowStride),
+                          args->outLineSize * sizeof(float));
+      return;
+    }
+  }
+  libjit_prefetch_row(args->data + line * args->inLineSize, args->inLineSize);
+}
+
+/// Accumulate into \p dest the row \p line of the
+/// (Fused)RowwiseQuantizedSparseLengthsWeightedSum described by \p args,
+/// dequantized and scaled by \p weight. If the rows are pooled by Max, store
+/// into \p dest the maximum of \p dest and the dequantized row instead, or
+/// only the latter if \p first.
+static void libjit_rowwise_quantized_slws_row(
+    const RowwiseQuantizedSLWSArgs *args, float *dest, size_t line,
+    float weight, bool first) {
+  const size_t outLineSize = args->outLineSize;
+  const bool isMax = args->pooling == SLSPooling::Max;
+  if (const libjit_row_cache *cache = args->rowCache) {
+    __atomic_fetch_add(&cache->counts[line], 1, __ATOMIC_RELAXED);
+    int32_t slot = cache->slots[line];
+    if (slot >= 0) {
+      const float *cached = cache->arena + slot * cache->rowStride;
+      if (isMax) {
+        libjit_max_row(dest, cached, outLineSize, first);
+      } else {
+        libjit_accumulate_row(dest, cached, outLineSize, weight);
+      }
+      return;
+    }
+  }
+  const uint8_t *row = args->data + line * args->inLineSize;
+  float scale, offset;
+  if (args->fourBits) {
+    uint16_t scaleOffset[2];
+    memcpy(scaleOffset, row + args->inLineSize - sizeof(scaleOffset),
+           sizeof(scaleOffset));
+    scale = libjit_fp16_to_float(scaleOffset[0]);
+    offset = libjit_fp16_to_float(scaleOffset[1]);
+    if (isMax) {
+      libjit_max_dequantized_4bit_row(dest, row, outLineSize, scale, offset,
+                                      first);
+    } else {
+      libjit_accumulate_dequantized_4bit_row(dest, row, outLineSize, scale,
+                                             offset, weight);
+    }
+    return;
+  }
+  if (args->scales) {
+    scale = args->scales[line];
+    offset = args->offsets[line];
+  } else if (args->fp16ScaleOffset) {
+    uint16_t scaleOffset[2];
+    memcpy(scaleOffset, row + outLineSize, sizeof(scaleOffset));
+    scale = libjit_fp16_to_float(scaleOffset[0]);
+    offset = libjit_fp16_to_float(scaleOffset[1]);
+  } else {
+    memcpy(&scale, row + outLineSize, sizeof(float));
+    memcpy(&offset, row + outLineSize + sizeof(float), sizeof(float));
+  }
+  if (isMax) {
+    libjit_max_dequantized_row(dest, row, outLineSize, scale, offset, first);
+  } else {
+    libjit_accumulate_dequantized_row(dest, row, outLineSize, scale, offset,
+                                      weight);
+  }
+}
+
+/// Compute the output segments [\p begin, \p end) of a
+/// (Fused)RowwiseQuantizedSparseLengthsWeightedSum described by \p ctx. The
+/// row used by the next index is prefetched while the current one is
+/// accumulated.
+static void libjit_rowwise_quantized_slws_body(size_t begin, size_t end,
+                                               void *ctx) {
+  const RowwiseQuantizedSLWSArgs *args = (const RowwiseQuantizedSLWSArgs *)ctx;
+  const size_t outLineSize = args->outLineSize;
+  // Find the first index used by segment \p begin and the last index used by
+  // segment \p end - 1.
+  size_t curIndex = 0;
+  for (size_t i = 0; i < begin; i++) {
+    curIndex += args->lengths[i];
+  }
+  size_t endIndex = curIndex;
+  for (size_t i = begin; i < end; i++) {
+    endIndex += args->lengths[i];
+  }
+  for (size_t i = begin; i < end; i++) {
+    float *dest = args->dest + i * outLineSize;
+    const int32_t e = args->lengths[i];
+    const float segmentWeight = libjit_sls_pooling_weight(args->pooling, e);
+    for (int32_t j = 0; j < e; j++, curIndex++) {
+      if (curIndex + 1 < endIndex) {
+        libjit_prefetch_slws_row(args, args->indices[curIndex + 1]);
+      }
+      libjit_rowwise_quantized_slws_row(
+          args, dest, args->indices[curIndex],
+          args->weights ? args->weights[curIndex] : segmentWeight, j == 0);
+    }
+  }
+}
+
+/// Compute the output segments [\p begin, \p end) of a
+/// GroupedFusedRowwiseQuantizedSparseLengthsWeightedSum described by \p ctx.
+/// The row used by the next index of the segment is prefetched while the
+/// current one is accumulated.
+static void libjit_grouped_rowwise_quantized_slws_body(size_t begin,
+                                                       size_t end, void *ctx) {
+  const RowwiseQuantizedSLWSArgs *args = (const RowwiseQuantizedSLWSArgs *)ctx;
+  const size_t outLineSize = args->outLineSize;
+  // Find the table of segment \p begin, and its first index.
+  size_t table = 0;
+  while (table + 1 < args->numTables &&
+         args->segmentOffsets[table + 1] <= begin) {
+    table++;
+  }
+  size_t curIndex = args->indexOffsets[table];
+  for (size_t i = args->segmentOffsets[table]; i < begin; i++) {
+    curIndex += args->lengths[i];
+  }
+  for (size_t i = begin; i < end; i++) {
+    // Move to the first index of the next table at its first segment.
+    const size_t prevTable = table;
+    while (table + 1 < args->numTables &&
+           args->segmentOffsets[table + 1] <= i) {
+      table++;
+    }
+    if (table != prevTable) {
+      curIndex = args->indexOffsets[table];
+    }
+    float *dest = args->dest + i * outLineSize;
+    for (int32_t j = 0, e = args->lengths[i]; j < e; j++, curIndex++) {
+      if (j + 1 < e) {
+        libjit_prefetch_slws_row(
+            args, args->rowOffsets[table] + args->indices[curIndex + 1]);
+      }
+      libjit_rowwise_quantized_slws_row(
+          args, dest, args->rowOffsets[table] + args->indices[curIndex],
+          args->weights[curIndex], j == 0);
+    }
+  }
+}
+
+/// The range of the arguments of libjit_fast_expf. exp is a denormal below
+/// the low bound, and close to FLT_MAX above the high bound.
+constexpr float kFastExpMin = -87.0f;
+constexpr float kFastExpMax = 88.0f;
+
+/// \returns an approximation of exp(\p x) with a relative error below 5e-6,
+/// 0 below kFastExpMin and e^88 above kFastExpMax. x = n * ln(2) + r with n
+/// an integer and |r| <= ln(2) / 2, then exp(x) is 2^n, built from the bits
+/// of n, times the polynomial of Cephes for exp(r). n * ln(2) is subtracted
+/// in one step, as -ffast-math would fold the usual two-part subtraction, so
+/// the error of r grows with |n|: it is 1e-7 for |x| < 1. The function has no
+/// branches and no calls, so that the loops using it are vectorized, unlike
+/// the ones calling expf.
+inline float libjit_fast_expf(float x) {
+  const float clamped = MIN(MAX(x, kFastExpMin), kFastExpMax);
+  // Round x / ln(2) to the nearest integer by adding 1.5 * 2^23, which moves
+  // the integer into the low bits of the mantissa. This is done on the bits,
+  // so that -ffast-math doesn't fold the addition and the subtraction.
+  const float shifter = 12582912.0f;
+  float shifted = clamped * 1.44269504088896341f + shifter;
+  int32_t shiftedBits, shifterBits;
+  memcpy(&shiftedBits, &shifted, sizeof(float));
+  memcpy(&shifterBits, &shifter, sizeof(float));
+  const int32_t n = shiftedBits - shifterBits;
+  const float r = clamped - (float)n * 0.693147180559945309f;
+  float p = 1.9875691500e-4f;
+  p = p * r + 1.3981999507e-3f;
+  p = p * r + 8.3334519073e-3f;
+  p = p * r + 4.1665795894e-2f;
+  p = p * r + 1.6666665459e-1f;
+  p = p * r + 5.0000001201e-1f;
+  p = p * r * r + r + 1.0f;
+  const int32_t scaleBits = (n + 127) << 23;
+  float scale;
+  memcpy(&scale, &scaleBits, sizeof(float));
+  return x < kFastExpMin ? 0.0f : p * scale;
+}
+
+/// \returns an approximation of tanh(\p x) with an absolute error below 1e-6,
+/// computed as 1 - 2 / (exp(2x) + 1) with libjit_fast_expf.
+inline float libjit_fast_tanhf(float x) {
+  return 1.0f - 2.0f / (libjit_fast_expf(2.0f * x) + 1.0f);
+}
+
+/// \returns an approximation of 1 / (1 + exp(-\p x)) with an absolute error
+/// below 1e-6, computed with libjit_fast_expf.
+inline float libjit_fast_sigmoidf(float x) {
+  return 1.0f / (libjit_fast_expf(-x) + 1.0f);
+}
+
+/// Computes the softmax of the row \p in of \p size elements into \p out,
+/// with libjit_fast_expf. The exponentials are computed relative to the
+/// maximum of the row, so that they don't overflow, and are summed while they
+/// are written. All the loops are vectorized.
+void libjit_softmax_fast_row(const float *in, float *out, size_t size) {
+  float max = in[0];
+  for (size_t i = 1; i < size; i++) {
+    max = MAX(max, in[i]);
+  }
+  float sum = 0;
+  for (size_t i = 0; i < size; i++) {
+    const float e = libjit_fast_expf(in[i] - max);
+    out[i] = e;
+    sum += e;
+  }
+  const float scale = 1.0f / sum;
+  for (size_t i = 0; i < size; i++) {
+    out[i] *= scale;
+  }
+}
+
+/// \returns an approximation of ln(\p x) with an absolute error below 3e-7
+/// around 1 and a relative error below 3e-7 elsewhere, for the normal
+/// positive \p x. x = m * 2^e with sqrt(0.5) <= m < sqrt(2), taken from the
+/// bits of x, then ln(x) is e * ln(2) plus the polynomial of Cephes for
+/// ln(m). Like libjit_fast_expf, the function has no branches and no calls.
+inline float libjit_fast_logf(float x) {
+  int32_t bits;
+  memcpy(&bits, &x, sizeof(float));
+  // The mantissa of x with the exponent of 0.5, in [0.5, 1).
+  int32_t e = ((bits >> 23) & 0xff) - 126;
+  const int32_t mantissaBits = (bits & 0x807fffff) | 0x3f000000;
+  float m;
+  memcpy(&m, &mantissaBits, sizeof(float));
+  const bool small = m < 0.707106781186547524f;
+  e -= small;
+  const float r = small ? m + m - 1.0f : m - 1.0f;
+  const float z = r * r;
+  float p = 7.0376836292e-2f;
+  p = p * r - 1.1514610310e-1f;
+  p = p * r + 1.1676998740e-1f;
+  p = p * r - 1.2420140846e-1f;
+  p = p * r + 1.4249322787e-1f;
+  p = p * r - 1.6668057665e-1f;
+  p = p * r + 2.0000714765e-1f;
+  p = p * r - 2.4999993993e-1f;
+  p = p * r + 3.3333331174e-1f;
+  p = p * r * z;
+  const float fe = (float)e;
+  p += -2.12194440e-4f * fe;
+  p += -0.5f * z;
+  return r + p + 0.693359375f * fe;
+}
+
+/// The number of boundaries up to which libjit_bucketize_f compares every
+/// value to all the boundaries, which vectorizes, instead of searching them.
+constexpr size_t kBucketizeLinearMax = 16;
+
+/// \returns the number of the \p numBoundaries sorted \p boundaries that are
+/// lower than or equal to \p x. The search halves the range without
+/// branching on the comparisons, so that it is only bound by the loads.
+inline size_t libjit_bucketize_search(float x, const float *boundaries,
+                                      size_t numBoundaries) {
+  const float *base = boundaries;
+  size_t n = numBoundaries;
+  while (n > 1) {
+    const size_t half = n / 2;
+    base = base[half] <= x ? base + half : base;
+    n -= half;
+  }
+  return (base - boundaries) + (*base <= x);
+}
+
+/// Expands the \p featureCnt features of the \p batchSize rows of \p data
+/// into rows of \p outWidth zeros and ones of \p dest: the \p lengths[j]
+/// elements of the feature j are one where \p values equals the feature.
+template <typename T>
+void libjit_batch_one_hot(T *dest, const T *data, const int32_t *lengths,
+                          const T *values, size_t batchSize, size_t featureCnt,
+                          size_t outWidth) {
+  for (size_t b = 0; b < batchSize; b++) {
+    T *row = dest + b * outWidth;
+    size_t offset = 0;
+    for (size_t j = 0; j < featureCnt; j++) {
+      const T value = data[b * featureCnt + j];
+      const size_t length = lengths[j];
+      for (size_t i = offset, e = offset + length; i < e; i++) {
+        row[i] = value == values[i];
+      }
+      offset += length;
+    }
+  }
+}
+
+/// Arguments of a layer normalization passed to the body of its parallel
+/// loop.
+struct LayerNormArgs {
+  float *dest;
+  const float *src;
+  const float *scale;
+  const float *bias;
+  size_t cols;
+  float epsilon;
+};
+
+/// Normalize the rows [\p begin, \p end) of the layer normalization
+/// described by \p ctx. The mean and the variance of every row are computed
+/// in a single pass with Welford's algorithm, so the row is read twice: once
+/// for its moments and once to normalize it.
+static void libjit_layer_norm_body(size_t begin, size_t end, void *ctx) {
+  const LayerNormArgs *args = (const LayerNormArgs *)ctx;
+  const size_t cols = args->cols;
+  for (size_t i = begin; i < end; i++) {
+    const float *row = args->src + i * cols;
+    float mean = 0;
+    float m2 = 0;
+    for (size_t j = 0; j < cols; j++) {
+      const float delta = row[j] - mean;
+      mean += delta / (j + 1);
+      m2 += delta * (row[j] - mean);
+    }
+    const float invStdDev = 1.0f / sqrtf(m2 / cols + args->epsilon);
+    float *out = args->dest + i * cols;
+    for (size_t j = 0; j < cols; j++) {
+      out[j] = (row[j] - mean) * invStdDev * args->scale[j] + args->bias[j];
+    }
+  }
+}
+
+struct PairwiseDotProductArgs {
+  float *dest;
+  const float *const *inputs;
+  size_t numInputs;
+  size_t vectorSize;
+};
+
+/// Compute the pairwise dot products of the batches [\p begin, \p end) of
+/// the interaction described by \p ctx. The vectors of a batch, one per
+/// input, are small enough to stay in the cache while every pair is
+/// multiplied.
+static void libjit_batched_pairwise_dot_product_body(size_t begin, size_t end,
+                                                     void *ctx) {
+  const PairwiseDotProductArgs *args = (const PairwiseDotProductArgs *)ctx;
+  const size_t numInputs = args->numInputs;
+  const size_t vectorSize = args->vectorSize;
+  const size_t numPairs = numInputs * (numInputs - 1) / 2;
+  for (size_t b = begin; b < end; b++) {
+    float *out = args->dest + b * numPairs;
+    for (size_t i = 1; i < numInputs; i++) {
+      const float *x = args->inputs[i] + b * vectorSize;
+      for (size_t j = 0; j < i; j++) {
+        const float *y = args->inputs[j] + b * vectorSize;
+        float sum = 0;
+        for (size_t d = 0; d < vectorSize; d++) {
+          sum += x[d] * y[d];
+        }
+        *out++ = sum;
+      }
+    }
+  }
+}
 } // namespace
 
 extern "C" {
@@ -900,6 +2367,21 @@ extern "C" {
         libjit_scale_i32i8((body), pre, post, scale, destOffset));             \
   }
 
+/// Macro to define a mini-kernel for data-parallel arithmetic operations on
+/// int16 activations. The operands are dequantized to the scale of the
+/// destination by \p lhsScale and \p rhsScale. For multiplicative operations
+/// \p lhsScale is the scale of the product and \p rhsScale is 1.
+/// \p name the name of the kernel
+/// \p body the operation to be performed
+#define DEFINE_DATA_PARALLEL_KERNEL_QUANTIZED_I16(name, body)                  \
+  int16_t name(size_t idx, const int16_t *LHS, const int16_t *RHS,             \
+               int32_t destOffset, int32_t lhsOffset, int32_t rhsOffset,       \
+               float lhsScale, float rhsScale) {                               \
+    float lhs = (LHS[idx] - lhsOffset) * lhsScale;                             \
+    float rhs = (RHS[idx] - rhsOffset) * rhsScale;                             \
+    return libjit_clip_i16((body) + destOffset);                               \
+  }
+
 /// Define mini-kernels for all data parallel operations. They are invoked from
 /// the generated kernels for sequences of data parallel operations.
 DEFINE_DATA_PARALLEL_KERNEL(libjit_elementmax_kernel_f, float,
@@ -909,6 +2391,7 @@ DEFINE_DATA_PARALLEL_KERNEL(libjit_elementmin_kernel_f, float,
 DEFINE_DATA_PARALLEL_KERNEL(libjit_copy_kernel_f, float, LHS[idx])
 DEFINE_DATA_PARALLEL_KERNEL(libjit_copy_kernel_u, size_t, LHS[idx])
 DEFINE_DATA_PARALLEL_KERNEL(libjit_copy_kernel_i8, int8_t, LHS[idx])
+DEFINE_DATA_PARALLEL_KERNEL(libjit_copy_kernel_i16, int16_t, LHS[idx])
 DEFINE_DATA_PARALLEL_KERNEL(libjit_copy_kernel_i32, int32_t, LHS[idx])
 DEFINE_DATA_PARALLEL_KERNEL(libjit_copy_kernel_b, int8_t, LHS[idx])
 DEFINE_DATA_PARALLEL_KERNEL(libjit_element_add_kernel_f, float,
@@ -925,6 +2408,8 @@ DEFINE_DATA_PARALLEL_KERNEL(libjit_element_pow_kernel_f, float,
                             pow(LHS[idx], RHS[idx]))
 DEFINE_DATA_PARALLEL_KERNEL(libjit_element_log_kernel_f, float, log(LHS[idx]))
 DEFINE_DATA_PARALLEL_KERNEL(libjit_element_exp_kernel_f, float, exp(LHS[idx]))
+DEFINE_DATA_PARALLEL_KERNEL(libjit_element_exp_fast_kernel_f, float,
+                            libjit_fast_expf(LHS[idx]))
 DEFINE_DATA_PARALLEL_KERNEL_QUANTIZED(libjit_element_add_kernel_i8, int8_t,
                                       lhs + rhs)
 DEFINE_DATA_PARALLEL_KERNEL_QUANTIZED(libjit_element_sub_kernel_i8, int8_t,
@@ -935,11 +2420,36 @@ DEFINE_DATA_PARALLEL_KERNEL_QUANTIZED(libjit_elementmin_kernel_i8, int8_t,
                                       MIN(lhs, rhs))
 DEFINE_DATA_PARALLEL_KERNEL_QUANTIZED_M(libjit_element_mul_kernel_i8, lhs *rhs)
 DEFINE_DATA_PARALLEL_KERNEL_QUANTIZED_M(libjit_element_div_kernel_i8, lhs / rhs)
+DEFINE_DATA_PARALLEL_KERNEL_QUANTIZED_I16(libjit_element_add_kernel_i16,
+                                          lhs + rhs)
+DEFINE_DATA_PARALLEL_KERNEL_QUANTIZED_I16(libjit_element_sub_kernel_i16,
+                                          lhs - rhs)
+DEFINE_DATA_PARALLEL_KERNEL_QUANTIZED_I16(libjit_elementmax_kernel_i16,
+                                          MAX(lhs, rhs))
+DEFINE_DATA_PARALLEL_KERNEL_QUANTIZED_I16(libjit_elementmin_kernel_i16,
+                                          MIN(lhs, rhs))
+DEFINE_DATA_PARALLEL_KERNEL_QUANTIZED_I16(libjit_element_mul_kernel_i16,
+                                          lhs *rhs)
 
 /// This is a variable used by Glow backends to determine the actual type used
 /// for size_t when libjit was compiled.
 size_t libjit_sizeTVar;
 
+/// The runner used to split the outer loops of the heavier kernels across
+/// threads. It is weak so that several bundles can be linked together.
+__attribute__((weak)) libjit_parallel_runner glow_libjit_parallel_runner =
+    nullptr;
+
+/// The reader of the hardware counters of libjit_write_perf_counters. It is
+/// weak so that several bundles can be linked together.
+__attribute__((weak)) libjit_counter_reader glow_libjit_counter_reader =
+    nullptr;
+
+/// The row caches of the SLWS kernels. It is weak so that several bundles can
+/// be linked together.
+__attribute__((weak)) const libjit_row_caches *glow_libjit_row_caches =
+    nullptr;
+
 /// Specialize the Modulo kernel into two functions based on the
 /// value of SignFollowDivisor.
 int64_t libjit_element_modulo_kernel_sign_follow_u(size_t idx,
@@ -1023,6 +2533,8 @@ int8_t libjit_element_cmp_lt_kernel_i8(size_t idx, const int8_t *LHS,
 // approximation by a direct tanh call.
 DEFINE_DATA_PARALLEL_KERNEL(libjit_tanh_kernel_f, float,
                             1 - 2 / (expf(LHS[idx] * 2) + 1))
+DEFINE_DATA_PARALLEL_KERNEL(libjit_tanh_fast_kernel_f, float,
+                            libjit_fast_tanhf(LHS[idx]))
 
 int8_t libjit_intlookuptable_kernel_i8(size_t idx, const int8_t *src,
                                        const int8_t *mapping) {
@@ -1052,14 +2564,20 @@ DEFINE_DATA_PARALLEL_KERNEL_FUNC(libjit_sigmoid_kernel_f) {
   float e = expf(-LHS[idx]);
   return 1 / (e + 1);
 }
+DEFINE_DATA_PARALLEL_KERNEL(libjit_sigmoid_fast_kernel_f, float,
+                            libjit_fast_sigmoidf(LHS[idx]))
 DEFINE_DATA_PARALLEL_KERNEL_WITH_IMM_OPERAND(libjit_element_maxsplat_kernel_f,
                                              float, MAX(LHS[idx], val))
 DEFINE_DATA_PARALLEL_KERNEL_WITH_IMM_OPERAND(libjit_element_maxsplat_kernel_i8,
                                              int8_t, MAX(LHS[idx], val))
 DEFINE_DATA_PARALLEL_KERNEL_WITH_IMM_OPERAND(libjit_splat_kernel_f, float, val)
 DEFINE_DATA_PARALLEL_KERNEL_WITH_IMM_OPERAND(libjit_splat_kernel_u, size_t, val)
+DEFINE_DATA_PARALLEL_KERNEL_WITH_IMM_OPERAND(libjit_splat_kernel_i32, int32_t,
+                                             val)
 DEFINE_DATA_PARALLEL_KERNEL_WITH_IMM_OPERAND(libjit_splat_kernel_i8, int8_t,
                                              val)
+DEFINE_DATA_PARALLEL_KERNEL_WITH_IMM_OPERAND(libjit_splat_kernel_i16, int16_t,
+                                             val)
 DEFINE_DATA_PARALLEL_KERNEL_WITH_IMM_OPERAND(libjit_splat_kernel_b, int8_t, val)
 
 #undef DEFINE_DATA_PARALLEL_KERNEL
@@ -1105,88 +2623,82 @@ void libjit_batchedadd_i32_i8(int8_t *dest, const int8_t *batch,
                               sliceScale);
 }
 
+void libjit_batchedadd_i16(int16_t *dest, const int16_t *batch,
+                           const int16_t *slice, size_t numSlice,
+                           size_t sliceSize, int32_t destOffset,
+                           int32_t batchOffset, int32_t sliceOffset,
+                           float batchScale, float sliceScale) {
+  libjit_batchedadd_quantized_i16(dest, batch, slice, numSlice, sliceSize,
+                                  destOffset, batchOffset, sliceOffset,
+                                  batchScale, sliceScale);
+}
+
+void libjit_batchedadd_i32_i16(int16_t *dest, const int16_t *batch,
+                               const int32_t *slice, size_t numSlice,
+                               size_t sliceSize, int32_t destOffset,
+                               int32_t batchOffset, int32_t sliceOffset,
+                               float batchScale, float sliceScale) {
+  libjit_batchedadd_quantized_i16(dest, batch, slice, numSlice, sliceSize,
+                                  destOffset, batchOffset, sliceOffset,
+                                  batchScale, sliceScale);
+}
+
 /// The dimensions passed in here are pre-expanded in LLVMIRGen with 1s so that
 /// we can iterate over the shape here, regardless of the shape of the tensor.
+/// A single axis is reduced, so the reduced axes are always contiguous.
 void libjit_batchedreduceadd_f(float *dest, const float *batch, size_t destSize,
                                const size_t *destDims, const size_t *batchDims,
                                size_t axis) {
-  for (size_t i = 0; i < destSize; i++)
-    dest[i] = 0.0;
-
-  for (size_t x = 0; x < batchDims[0]; x++)
-    for (size_t y = 0; y < batchDims[1]; y++)
-      for (size_t z = 0; z < batchDims[2]; z++)
-        for (size_t w = 0; w < batchDims[3]; w++)
-          for (size_t q = 0; q < batchDims[4]; q++)
-            for (size_t r = 0; r < batchDims[5]; r++) {
-              size_t I[] = {x, y, z, w, q, r};
-              I[axis] = 0;
-              dest[libjit_getXYZWQR(destDims, I[0], I[1], I[2], I[3], I[4],
-                                    I[5])] +=
-                  batch[libjit_getXYZWQR(batchDims, x, y, z, w, q, r)];
-            }
+  libjit_reduce<float, ReduceAddOp<float>>(dest, batch, destDims, batchDims);
 }
 
 void libjit_reducemin_f(float *dest, const float *batch, size_t destSize,
                         const size_t *destDims, const size_t *batchDims) {
-  libjit_reducemin(dest, batch, destSize, destDims, batchDims,
-                   std::numeric_limits<float>::max());
+  if (!libjit_reduce<float, ReduceMinOp<float>>(dest, batch, destDims,
+                                                batchDims)) {
+    libjit_reducemin(dest, batch, destSize, destDims, batchDims,
+                     std::numeric_limits<float>::max());
+  }
 }
 
 void libjit_reducemin_i32(int32_t *dest, const int32_t *batch, size_t destSize,
                           const size_t *destDims, const size_t *batchDims) {
-  libjit_reducemin(dest, batch, destSize, destDims, batchDims,
-                   std::numeric_limits<int32_t>::max());
+  if (!libjit_reduce<int32_t, ReduceMinOp<int32_t>>(dest, batch, destDims,
+                                                    batchDims)) {
+    libjit_reducemin(dest, batch, destSize, destDims, batchDims,
+                     std::numeric_limits<int32_t>::max());
+  }
 }
 
 void libjit_reducemin_u(int64_t *dest, const int64_t *batch, size_t destSize,
                         const size_t *destDims, const size_t *batchDims) {
-  libjit_reducemin(dest, batch, destSize, destDims, batchDims,
-                   std::numeric_limits<int64_t>::max());
+  if (!libjit_reduce<int64_t, ReduceMinOp<int64_t>>(dest, batch, destDims,
+                                                    batchDims)) {
+    libjit_reducemin(dest, batch, destSize, destDims, batchDims,
+                     std::numeric_limits<int64_t>::max());
+  }
 }
 
 /// Same as the non-quantized version, the dimensions here are pre-expanded in
-/// LLVMIRGen. However, for quantization, we must accumulate in the inner-most
-/// loop with higher precision (int32_t) and then clip the result back into the
-/// dest tensor. Thus we add max_tensor_dimensions different cases for this to
-/// ensure the axis is used as the inner-most loop.
+/// LLVMIRGen. However, for quantization, we must accumulate with higher
+/// precision (int32_t) and then clip the result back into the dest tensor.
 void libjit_batchedreduceadd_i8(int8_t *dest, const int8_t *batch,
                                 const size_t *destDims, const size_t *batchDims,
                                 int32_t destOffset, int32_t batchOffset,
                                 int32_t batchPre, int32_t batchPost,
                                 int32_t batchScale, size_t axis) {
-  switch (axis) {
-#define LOOP_AXIS_CASE(_D0, _D1, _D2, _D3, _D4, _D5_AXIS)                      \
-  case _D5_AXIS:                                                               \
-    for (size_t i##_D0 = 0; i##_D0 < batchDims[_D0]; i##_D0++)                 \
-      for (size_t i##_D1 = 0; i##_D1 < batchDims[_D1]; i##_D1++)               \
-        for (size_t i##_D2 = 0; i##_D2 < batchDims[_D2]; i##_D2++)             \
-          for (size_t i##_D3 = 0; i##_D3 < batchDims[_D3]; i##_D3++)           \
-            for (size_t i##_D4 = 0; i##_D4 < batchDims[_D4]; i##_D4++) {       \
-              int32_t sum = 0.0;                                               \
-              for (size_t i##_D5_AXIS = 0; i##_D5_AXIS < batchDims[_D5_AXIS];  \
-                   i##_D5_AXIS++) {                                            \
-                sum += batch[libjit_getXYZWQR(batchDims, i0, i1, i2, i3, i4,   \
-                                              i5)] -                           \
-                       batchOffset;                                            \
-              }                                                                \
-              size_t i##_D5_AXIS = 0;                                          \
-              int32_t res = libjit_scale_i32i8(sum, batchPre, batchPost,       \
-                                               batchScale, destOffset);        \
-              dest[libjit_getXYZWQR(destDims, i0, i1, i2, i3, i4, i5)] =       \
-                  libjit_clip(res);                                            \
-            }                                                                  \
-    return;
-
-    // Each loop order, with the inner-most dimension/index equal to the axis.
-    LOOP_AXIS_CASE(1, 2, 3, 4, 5, 0);
-    LOOP_AXIS_CASE(0, 2, 3, 4, 5, 1);
-    LOOP_AXIS_CASE(0, 1, 3, 4, 5, 2);
-    LOOP_AXIS_CASE(0, 1, 2, 4, 5, 3);
-    LOOP_AXIS_CASE(0, 1, 2, 3, 5, 4);
-    LOOP_AXIS_CASE(0, 1, 2, 3, 4, 5);
-#undef LOOP_AXIS_CASE
-  }
+  ReduceArgs args;
+  libjit_get_reduce_shape(destDims, batchDims, &args.outer, &args.reduced,
+                          &args.inner);
+  args.batch = batch;
+  args.dest = dest;
+  args.destOffset = destOffset;
+  args.batchOffset = batchOffset;
+  args.batchPre = batchPre;
+  args.batchPost = batchPost;
+  args.batchScale = batchScale;
+  libjit_parallel_for(libjit_get_reduce_iters(&args),
+                      &libjit_reduce_add_i8_body, &args);
 }
 
 void libjit_cross_entropy_loss_f(float *CE, float *P, size_t *labels,
@@ -1201,82 +2713,92 @@ void libjit_cross_entropy_loss_f(float *CE, float *P, size_t *labels,
 
 void libjit_gather64_f(float *dest, const float *data, const int64_t *indices,
                        size_t numIndices, size_t sliceSize, size_t numSamples,
-                       size_t sampleSize) {
+                       size_t sampleSize, size_t prefetchDistance) {
   libjit_gather(dest, data, indices, numIndices, sliceSize, numSamples,
-                sampleSize);
+                sampleSize, prefetchDistance);
 }
 
 void libjit_gather64_i8(int8_t *dest, const int8_t *data,
                         const int64_t *indices, size_t numIndices,
-                        size_t sliceSize, size_t numSamples,
-                        size_t sampleSize) {
+                        size_t sliceSize, size_t numSamples, size_t sampleSize,
+                        size_t prefetchDistance) {
   libjit_gather(dest, data, indices, numIndices, sliceSize, numSamples,
-                sampleSize);
+                sampleSize, prefetchDistance);
 }
 
 void libjit_gather64_u(size_t *dest, const size_t *data, const int64_t *indices,
                        size_t numIndices, size_t sliceSize, size_t numSamples,
-                       size_t sampleSize) {
+                       size_t sampleSize, size_t prefetchDistance) {
   libjit_gather(dest, data, indices, numIndices, sliceSize, numSamples,
-                sampleSize);
+                sampleSize, prefetchDistance);
 }
 
 void libjit_gather32_f(float *dest, const float *data, const int32_t *indices,
                        size_t numIndices, size_t sliceSize, size_t numSamples,
-                       size_t sampleSize) {
+                       size_t sampleSize, size_t prefetchDistance) {
   libjit_gather(dest, data, indices, numIndices, sliceSize, numSamples,
-                sampleSize);
+                sampleSize, prefetchDistance);
 }
 
 void libjit_gather32_i8(int8_t *dest, const int8_t *data,
                         const int32_t *indices, size_t numIndices,
-                        size_t sliceSize, size_t numSamples,
-                        size_t sampleSize) {
+                        size_t sliceSize, size_t numSamples, size_t sampleSize,
+                        size_t prefetchDistance) {
   libjit_gather(dest, data, indices, numIndices, sliceSize, numSamples,
-                sampleSize);
+                sampleSize, prefetchDistance);
 }
 
 void libjit_gather32_u(size_t *dest, const size_t *data, const int32_t *indices,
                        size_t numIndices, size_t sliceSize, size_t numSamples,
-                       size_t sampleSize) {
+                       size_t sampleSize, size_t prefetchDistance) {
   libjit_gather(dest, data, indices, numIndices, sliceSize, numSamples,
-                sampleSize);
+                sampleSize, prefetchDistance);
 }
 
 void libjit_gatherranges64_f(float *output, int64_t *lengths, const float *data,
                              const int64_t *ranges, size_t numExamples,
-                             size_t exampleSize) {
-  libjit_gatherranges(output, lengths, data, ranges, numExamples, exampleSize);
+                             size_t exampleSize, size_t prefetchDistance) {
+  libjit_gatherranges(output, lengths, data, ranges, numExamples, exampleSize,
+                      prefetchDistance);
 }
 
 void libjit_gatherranges64_i8(int8_t *output, int64_t *lengths,
                               const int8_t *data, const int64_t *ranges,
-                              size_t numExamples, size_t exampleSize) {
-  libjit_gatherranges(output, lengths, data, ranges, numExamples, exampleSize);
+                              size_t numExamples, size_t exampleSize,
+                              size_t prefetchDistance) {
+  libjit_gatherranges(output, lengths, data, ranges, numExamples, exampleSize,
+                      prefetchDistance);
 }
 
 void libjit_gatherranges64_u(size_t *output, int64_t *lengths,
                              const size_t *data, const int64_t *ranges,
-                             size_t numExamples, size_t exampleSize) {
-  libjit_gatherranges(output, lengths, data, ranges, numExamples, exampleSize);
+                             size_t numExamples, size_t exampleSize,
+                             size_t prefetchDistance) {
+  libjit_gatherranges(output, lengths, data, ranges, numExamples, exampleSize,
+                      prefetchDistance);
 }
 
 void libjit_gatherranges32_f(float *output, int32_t *lengths, const float *data,
                              const int32_t *ranges, size_t numExamples,
-                             size_t exampleSize) {
-  libjit_gatherranges(output, lengths, data, ranges, numExamples, exampleSize);
+                             size_t exampleSize, size_t prefetchDistance) {
+  libjit_gatherranges(output, lengths, data, ranges, numExamples, exampleSize,
+                      prefetchDistance);
 }
 
 void libjit_gatherranges32_i8(int8_t *output, int32_t *lengths,
                               const int8_t *data, const int32_t *ranges,
-                              size_t numExamples, size_t exampleSize) {
-  libjit_gatherranges(output, lengths, data, ranges, numExamples, exampleSize);
+                              size_t numExamples, size_t exampleSize,
+                              size_t prefetchDistance) {
+  libjit_gatherranges(output, lengths, data, ranges, numExamples, exampleSize,
+                      prefetchDistance);
 }
 
 void libjit_gatherranges32_u(size_t *output, int32_t *lengths,
                              const size_t *data, const int32_t *ranges,
-                             size_t numExamples, size_t exampleSize) {
-  libjit_gatherranges(output, lengths, data, ranges, numExamples, exampleSize);
+                             size_t numExamples, size_t exampleSize,
+                             size_t prefetchDistance) {
+  libjit_gatherranges(output, lengths, data, ranges, numExamples, exampleSize,
+                      prefetchDistance);
 }
 
 void libjit_lengths_range_fill_i32(const int32_t *lengths, int32_t *output,
@@ -1293,13 +2815,10 @@ void libjit_scatterdata_f(float *data, const size_t *dataDims,
                           const size_t *indices, const float *slices,
                           size_t numIndices, size_t indexSize, size_t sliceSize,
                           bool isCumulative) {
-  if (isCumulative) {
-    libjit_scatterdataaddfloat(data, dataDims, indices, slices, numIndices,
-                               indexSize, sliceSize);
-  } else {
-    libjit_scatterdatacopy(data, dataDims, indices, slices, numIndices,
-                           indexSize, sliceSize);
-  }
+  ScatterDataArgs<float> args{data,       dataDims,  indices,  slices,
+                              numIndices, indexSize, sliceSize};
+  args.isCumulative = isCumulative;
+  libjit_scatterdata(&args);
 }
 
 void libjit_scatterdata_i8(int8_t *data, const size_t *dataDims,
@@ -1308,14 +2827,14 @@ void libjit_scatterdata_i8(int8_t *data, const size_t *dataDims,
                            size_t sliceSize, bool isCumulative, float dataScale,
                            int32_t dataOffset, float sliceScale,
                            int32_t sliceOffset) {
-  if (isCumulative) {
-    libjit_scatterdataaddquantized(data, dataDims, indices, slices, numIndices,
-                                   indexSize, sliceSize, dataScale, dataOffset,
-                                   sliceScale, sliceOffset);
-  } else {
-    libjit_scatterdatacopy(data, dataDims, indices, slices, numIndices,
-                           indexSize, sliceSize);
-  }
+  ScatterDataArgs<int8_t> args{data,       dataDims,  indices,  slices,
+                               numIndices, indexSize, sliceSize};
+  args.isCumulative = isCumulative;
+  args.dataScale = dataScale;
+  args.dataOffset = dataOffset;
+  args.sliceScale = sliceScale;
+  args.sliceOffset = sliceOffset;
+  libjit_scatterdata(&args);
 }
 
 void libjit_lengths_to_ranges_i32(int32_t *ranges, const int32_t *lengths,
@@ -1329,20 +2848,133 @@ void libjit_lengths_to_ranges_i32(int32_t *ranges, const int32_t *lengths,
   }
 }
 
+void libjit_bucketize_f(int32_t *dest, const float *src,
+                        const float *boundaries, size_t size,
+                        size_t numBoundaries) {
+  if (numBoundaries == 0) {
+    memset(dest, 0, size * sizeof(int32_t));
+    return;
+  }
+  if (numBoundaries <= kBucketizeLinearMax) {
+    for (size_t i = 0; i < size; i++) {
+      int32_t count = 0;
+      for (size_t j = 0; j < numBoundaries; j++) {
+        count += boundaries[j] <= src[i];
+      }
+      dest[i] = count;
+    }
+    return;
+  }
+  for (size_t i = 0; i < size; i++) {
+    dest[i] = libjit_bucketize_search(src[i], boundaries, numBoundaries);
+  }
+}
+
+void libjit_batch_box_cox_f(float *dest, const float *data,
+                            const float *lambda1, const float *lambda2,
+                            size_t rows, size_t cols, float epsilon) {
+  for (size_t i = 0; i < rows; i++) {
+    for (size_t j = 0; j < cols; j++) {
+      const float l1 = lambda1[j];
+      const float x = MAX(data[i * cols + j] + lambda2[j], 1e-6f);
+      // The logarithm is shared by both cases, x^l1 = exp(l1 * ln(x)).
+      const float lnX = libjit_fast_logf(x);
+      const float pow = (libjit_fast_expf(l1 * lnX) - 1.0f) / (l1 + epsilon);
+      dest[i * cols + j] = l1 == 0.0f ? lnX : pow;
+    }
+  }
+}
+
+void libjit_layer_norm_f(float *dest, const float *src, const float *scale,
+                         const float *bias, size_t rows, size_t cols,
+                         float epsilon) {
+  LayerNormArgs args{dest, src, scale, bias, cols, epsilon};
+  libjit_parallel_for(rows, &libjit_layer_norm_body, &args);
+}
+
+void libjit_batched_pairwise_dot_product_f(float *dest,
+                                           const float *const *inputs,
+                                           size_t numInputs, size_t batchSize,
+                                           size_t vectorSize) {
+  PairwiseDotProductArgs args{dest, inputs, numInputs, vectorSize};
+  libjit_parallel_for(batchSize, &libjit_batched_pairwise_dot_product_body,
+                      &args);
+}
+
+void libjit_batch_one_hot_f(float *dest, const float *data,
+                            const int32_t *lengths, const float *values,
+                            size_t batchSize, size_t featureCnt,
+                            size_t outWidth) {
+  libjit_batch_one_hot(dest, data, lengths, values, batchSize, featureCnt,
+                       outWidth);
+}
+
+void libjit_batch_one_hot_i8(int8_t *dest, const int8_t *data,
+                             const int32_t *lengths, const int8_t *values,
+                             size_t batchSize, size_t featureCnt,
+                             size_t outWidth) {
+  libjit_batch_one_hot(dest, data, lengths, values, batchSize, featureCnt,
+                       outWidth);
+}
+
+void libjit_batch_one_hot_i32(int32_t *dest, const int32_t *data,
+                              const int32_t *lengths, const int32_t *values,
+                              size_t batchSize, size_t featureCnt,
+                              size_t outWidth) {
+  libjit_batch_one_hot(dest, data, lengths, values, batchSize, featureCnt,
+                       outWidth);
+}
+
+void libjit_batch_one_hot_u(int64_t *dest, const int64_t *data,
+                            const int32_t *lengths, const int64_t *values,
+                            size_t batchSize, size_t featureCnt,
+                            size_t outWidth) {
+  libjit_batch_one_hot(dest, data, lengths, values, batchSize, featureCnt,
+                       outWidth);
+}
+
+void libjit_sparse_to_dense_mask(char *dest, const char *values,
+                                 const char *defaultValue,
+                                 const int64_t *indices,
+                                 const int32_t *lengths,
+                                 const int64_t *sortedMask,
+                                 const size_t *maskPositions, size_t maskSize,
+                                 size_t numBatches, size_t valueSize) {
+  for (size_t i = 0, e = numBatches * maskSize; i < e; i++) {
+    memcpy(dest + i * valueSize, defaultValue, valueSize);
+  }
+  if (maskSize == 0) {
+    return;
+  }
+  size_t pos = 0;
+  for (size_t batch = 0; batch < numBatches; batch++) {
+    char *batchDest = dest + batch * maskSize * valueSize;
+    for (int32_t i = 0; i < lengths[batch]; i++, pos++) {
+      // Find the last mask ID not greater than the index, as
+      // libjit_bucketize_search does.
+      const int64_t index = indices[pos];
+      const int64_t *base = sortedMask;
+      size_t n = maskSize;
+      while (n > 1) {
+        const size_t half = n / 2;
+        base = base[half] <= index ? base + half : base;
+        n -= half;
+      }
+      if (*base != index) {
+        continue;
+      }
+      memcpy(batchDest + maskPositions[base - sortedMask] * valueSize,
+             values + pos * valueSize, valueSize);
+    }
+  }
+}
+
 void libjit_sparse_lengths_sum_f(float *dest, float *data, size_t *indices,
                                  int32_t *lengths, size_t segments,
                                  size_t lineSize) {
   memset(dest, 0, segments * lineSize * sizeof(float));
-  size_t curIndex = 0;
-  for (size_t i = 0; i < segments; i++) {
-    for (int32_t j = 0; j < lengths[i]; j++) {
-      size_t line = indices[curIndex];
-      for (size_t k = 0; k < lineSize; k++) {
-        dest[i * lineSize + k] += data[line * lineSize + k];
-      }
-      curIndex++;
-    }
-  }
+  SparseLengthsSumArgs args{dest, data, nullptr, indices, lengths, lineSize};
+  libjit_parallel_for(segments, &libjit_sparse_lengths_sum_body, &args);
 }
 
 void libjit_sparse_lengths_weighted_sum_f(float *dest, float *data,
@@ -1350,17 +2982,26 @@ void libjit_sparse_lengths_weighted_sum_f(float *dest, float *data,
                                           int32_t *lengths, size_t segments,
                                           size_t lineSize) {
   memset(dest, 0, segments * lineSize * sizeof(float));
-  size_t curIndex = 0;
-  for (size_t i = 0; i < segments; i++) {
-    for (int32_t j = 0; j < lengths[i]; j++) {
-      float weight = weights[curIndex];
-      size_t line = indices[curIndex];
-      for (size_t k = 0; k < lineSize; k++) {
-        dest[i * lineSize + k] += weight * data[line * lineSize + k];
-      }
-      curIndex++;
-    }
-  }
+  SparseLengthsSumArgs args{dest, data, weights, indices, lengths, lineSize};
+  libjit_parallel_for(segments, &libjit_sparse_lengths_sum_body, &args);
+}
+
+void libjit_sparse_lengths_mean_f(float *dest, float *data, size_t *indices,
+                                  int32_t *lengths, size_t segments,
+                                  size_t lineSize) {
+  memset(dest, 0, segments * lineSize * sizeof(float));
+  SparseLengthsSumArgs args{dest,    data,     nullptr,         indices,
+                            lengths, lineSize, SLSPooling::Mean};
+  libjit_parallel_for(segments, &libjit_sparse_lengths_sum_body, &args);
+}
+
+void libjit_sparse_lengths_max_f(float *dest, float *data, size_t *indices,
+                                 int32_t *lengths, size_t segments,
+                                 size_t lineSize) {
+  memset(dest, 0, segments * lineSize * sizeof(float));
+  SparseLengthsSumArgs args{dest,    data,     nullptr,        indices,
+                            lengths, lineSize, SLSPooling::Max};
+  libjit_parallel_for(segments, &libjit_sparse_lengths_sum_body, &args);
 }
 
 void libjit_sparse_lengths_weighted_sum_grad_f(
@@ -1395,48 +3036,129 @@ void libjit_sparse_lengths_weighted_sum_grad_f(
   }
 }
 
+void libjit_sgd_f(float *dest, float *destGsum, const float *gradient,
+                  const float *weight, const float *gsum, size_t size,
+                  float L1Decay, float L2Decay, float learningRate,
+                  float momentum, float batchSize) {
+  SGDArgs args{dest,    destGsum, gradient,     weight,   gsum,     size,
+               L1Decay, L2Decay,  learningRate, momentum, batchSize};
+  libjit_parallel_for((size + kSGDBlockSize - 1) / kSGDBlockSize,
+                      &libjit_sgd_body, &args);
+}
+
+void libjit_sparse_sgd_f(float *dest, const float *weight,
+                         const float *destGrad, const float *weights,
+                         const size_t *indices, const int32_t *lengths,
+                         size_t segments, size_t lineSize, size_t weightSize,
+                         float learningRate, float batchSize) {
+  // The rows that were not looked up keep their weights.
+  if (dest != weight) {
+    memcpy(dest, weight, weightSize * sizeof(float));
+  }
+  // The gradient of a row is the sum of the gradients of the segments that
+  // looked it up, scaled by the weights of the lookups. Rows may be looked up
+  // several times, so the lookups are applied sequentially.
+  for (size_t i = 0, curIndex = 0; i < segments; ++i) {
+    const float *segmentGrad = destGrad + i * lineSize;
+    for (int32_t j = 0; j < lengths[i]; ++j, ++curIndex) {
+      float scale = weights[curIndex];
+      float *line = dest + indices[curIndex] * lineSize;
+      for (size_t k = 0; k < lineSize; ++k) {
+        float g = scale * segmentGrad[k];
+        if (batchSize > 1) {
+          g /= batchSize;
+        }
+        line[k] += -learningRate * g;
+      }
+    }
+  }
+}
+
 void libjit_rowwise_quantized_sparse_lengths_weighted_sum_f(
     float *dest, uint8_t *data, float *scales, float *offsets, float *weights,
     size_t *indices, int32_t *lengths, size_t segments, size_t lineSize) {
   memset(dest, 0, segments * lineSize * sizeof(float));
-  size_t curIndex = 0;
-  for (size_t i = 0; i < segments; i++) {
-    for (int32_t j = 0; j < lengths[i]; j++) {
-      const float weight = weights[curIndex];
-      const size_t line = indices[curIndex];
-      const float scale = scales[line];
-      const float offset = offsets[line];
-      for (size_t k = 0; k < lineSize; k++) {
-        const float fData = scale * data[line * lineSize + k] + offset;
-        dest[i * lineSize + k] += weight * fData;
-      }
-      curIndex++;
-    }
-  }
+  RowwiseQuantizedSLWSArgs args{dest,    data,    scales,   offsets,  weights,
+                                indices, lengths, lineSize, lineSize, false};
+  libjit_parallel_for(segments, &libjit_rowwise_quantized_slws_body, &args);
 }
 
 void libjit_fused_rowwise_quantized_sparse_lengths_weighted_sum_f(
     float *dest, int8_t *data, float *weights, size_t *indices,
-    int32_t *lengths, size_t segments, size_t inLineSize, size_t outLineSize) {
+    int32_t *lengths, size_t segments, size_t inLineSize, size_t outLineSize,
+    bool fp16ScaleOffset, bool fourBits) {
   memset(dest, 0, segments * outLineSize * sizeof(float));
-  size_t curIndex = 0;
-  for (size_t i = 0; i < segments; i++) {
-    for (int32_t j = 0, e = lengths[i]; j < e; j++) {
-      const float weight = weights[curIndex];
-      const size_t line = indices[curIndex];
-      const int8_t *currRowScaleOffsetPtr =
-          data + ((line + 1) * inLineSize) - 2 * sizeof(float);
-      float scale, offset;
-      memcpy(&scale, currRowScaleOffsetPtr, sizeof(float));
-      memcpy(&offset, currRowScaleOffsetPtr + sizeof(float), sizeof(float));
-      for (size_t k = 0; k < outLineSize; k++) {
-        const float fData =
-            (scale * (uint8_t)(data[line * inLineSize + k])) + offset;
-        dest[i * outLineSize + k] += weight * fData;
-      }
-      curIndex++;
-    }
-  }
+  RowwiseQuantizedSLWSArgs args{dest,
+                                (const uint8_t *)data,
+                                nullptr,
+                                nullptr,
+                                weights,
+                                indices,
+                                lengths,
+                                inLineSize,
+                                outLineSize,
+                                fp16ScaleOffset,
+                                fourBits};
+  args.rowCache = libjit_find_row_cache(args.data);
+  libjit_parallel_for(segments, &libjit_rowwise_quantized_slws_body, &args);
+}
+
+/// Shared by the FusedRowwiseQuantizedSparseLengthsMean and Max, whose rows
+/// are pooled by \p pooling.
+static void libjit_fused_rowwise_quantized_sparse_lengths_pool(
+    float *dest, int8_t *data, size_t *indices, int32_t *lengths,
+    size_t segments, size_t inLineSize, size_t outLineSize,
+    bool fp16ScaleOffset, bool fourBits, SLSPooling pooling) {
+  memset(dest, 0, segments * outLineSize * sizeof(float));
+  RowwiseQuantizedSLWSArgs args{dest,
+                                (const uint8_t *)data,
+                                nullptr,
+                                nullptr,
+                                nullptr,
+                                indices,
+                                lengths,
+                                inLineSize,
+                                outLineSize,
+                                fp16ScaleOffset,
+                                fourBits};
+  args.rowCache = libjit_find_row_cache(args.data);
+  args.pooling = pooling;
+  libjit_parallel_for(segments, &libjit_rowwise_quantized_slws_body, &args);
+}
+
+void libjit_fused_rowwise_quantized_sparse_lengths_mean_f(
+    float *dest, int8_t *data, size_t *indices, int32_t *lengths,
+    size_t segments, size_t inLineSize, size_t outLineSize,
+    bool fp16ScaleOffset, bool fourBits) {
+  libjit_fused_rowwise_quantized_sparse_lengths_pool(
+      dest, data, indices, lengths, segments, inLineSize, outLineSize,
+      fp16ScaleOffset, fourBits, SLSPooling::Mean);
+}
+
+void libjit_fused_rowwise_quantized_sparse_lengths_max_f(
+    float *dest, int8_t *data, size_t *indices, int32_t *lengths,
+    size_t segments, size_t inLineSize, size_t outLineSize,
+    bool fp16ScaleOffset, bool fourBits) {
+  libjit_fused_rowwise_quantized_sparse_lengths_pool(
+      dest, data, indices, lengths, segments, inLineSize, outLineSize,
+      fp16ScaleOffset, fourBits, SLSPooling::Max);
+}
+
+void libjit_grouped_fused_rowwise_quantized_sparse_lengths_weighted_sum_f(
+    float *dest, int8_t *data, float *weights, size_t *indices,
+    int32_t *lengths, const size_t *rowOffsets, const size_t *indexOffsets,
+    const size_t *segmentOffsets, size_t numTables, size_t segments,
+    size_t inLineSize, size_t outLineSize, bool fp16ScaleOffset,
+    bool fourBits) {
+  memset(dest, 0, segments * outLineSize * sizeof(float));
+  RowwiseQuantizedSLWSArgs args{
+      dest,         (const uint8_t *)data, nullptr,        nullptr,
+      weights,      indices,               lengths,        inLineSize,
+      outLineSize,  fp16ScaleOffset,       fourBits,       rowOffsets,
+      indexOffsets, segmentOffsets,        numTables};
+  args.rowCache = libjit_find_row_cache(args.data);
+  libjit_parallel_for(segments, &libjit_grouped_rowwise_quantized_slws_body,
+                      &args);
 }
 
 void libjit_sparse_to_dense_f(float *dest, const size_t *indices,
@@ -1556,15 +3278,21 @@ void libjit_local_response_normalization_grad_f(
 void libjit_max_pool_i8(const int8_t *inW, int8_t *outW, const size_t *inWdims,
                         const size_t *outWdims, size_t *kernelSizes,
                         size_t *strides, size_t *pads) {
-  libjit_max_pool_generic(inW, outW, inWdims, outWdims, kernelSizes, strides,
-                          pads);
+  PoolArgs args;
+  libjit_init_pool_args(&args, inW, outW, inWdims, outWdims, kernelSizes,
+                        strides, pads);
+  libjit_parallel_for(outWdims[0] * outWdims[1], &libjit_max_pool_body<int8_t>,
+                      &args);
 }
 
 void libjit_max_pool_f(const float *inW, float *outW, const size_t *inWdims,
                        const size_t *outWdims, size_t *kernelSizes,
                        size_t *strides, size_t *pads) {
-  libjit_max_pool_generic(inW, outW, inWdims, outWdims, kernelSizes, strides,
-                          pads);
+  PoolArgs args;
+  libjit_init_pool_args(&args, inW, outW, inWdims, outWdims, kernelSizes,
+                        strides, pads);
+  libjit_parallel_for(outWdims[0] * outWdims[1], &libjit_max_pool_body<float>,
+                      &args);
 }
 
 void libjit_max_pool_argmax_i8(const int8_t *inW, int8_t *outW, int64_t *argmax,
@@ -1621,89 +3349,50 @@ void libjit_avg_pool_i8(const int8_t *inW, int8_t *outW, const size_t *inWdims,
                         size_t *strides, size_t *pads, int32_t outOffset,
                         int32_t inOffset, int32_t outPre, int32_t outPost,
                         int32_t outScale) {
-  size_t pad_t = pads[0];
-  size_t pad_l = pads[1];
-  size_t stride_h = strides[0];
-  size_t stride_w = strides[1];
-  size_t kernel_h = kernelSizes[0];
-  size_t kernel_w = kernelSizes[1];
-  // For each input in the batch:
-  for (size_t n = 0; n < outWdims[0]; n++) {
-    // For each (x,y) step in the input/output tensor:
-    ssize_t x = -ssize_t(pad_t);
-    for (size_t ax = 0; ax < outWdims[1]; x += stride_h, ax++) {
-      ssize_t y = -ssize_t(pad_l);
-      for (size_t ay = 0; ay < outWdims[2]; y += stride_w, ay++) {
-        // For each layer in the output tensor:
-        for (size_t z = 0; z < inWdims[3]; z++) {
-          int32_t sum = 0;
-
-          for (size_t fx = 0; fx < kernel_h; fx++) {
-            for (size_t fy = 0; fy < kernel_w; fy++) {
-              ssize_t ox = x + fx;
-              ssize_t oy = y + fy;
-
-              // Ignore index access below zero (this is due to padding).
-              if (ox < 0 || oy < 0 || ox >= (ssize_t)inWdims[1] ||
-                  oy >= (ssize_t)inWdims[2]) {
-                continue;
-              }
-              sum +=
-                  inW[libjit_getXYZW(inWdims, n, (size_t)ox, (size_t)oy, z)] -
-                  inOffset;
-            }
-          }
-
-          outW[libjit_getXYZW(outWdims, n, ax, ay, z)] = libjit_clip(
-              libjit_scale_i32i8(sum, outPre, outPost, outScale, outOffset));
-        } // C
-      }   // W
-    }     // H
-  }       // N
+  PoolArgs args;
+  libjit_init_pool_args(&args, inW, outW, inWdims, outWdims, kernelSizes,
+                        strides, pads);
+  args.inOffset = inOffset;
+  args.outOffset = outOffset;
+  args.outPre = outPre;
+  args.outPost = outPost;
+  args.outScale = outScale;
+  libjit_parallel_for(outWdims[0] * outWdims[1], &libjit_avg_pool_i8_body,
+                      &args);
 }
 
 void libjit_avg_pool_f(const float *inW, float *outW, const size_t *inWdims,
                        const size_t *outWdims, size_t *kernelSizes,
                        size_t *strides, size_t *pads) {
-  size_t pad_t = pads[0];
-  size_t pad_l = pads[1];
-  size_t stride_h = strides[0];
-  size_t stride_w = strides[1];
-  size_t kernel_h = kernelSizes[0];
-  size_t kernel_w = kernelSizes[1];
-  float filterArea = kernel_h * kernel_w;
-  // For each input in the batch:
-  for (size_t n = 0; n < outWdims[0]; n++) {
-    // For each (x,y) step in the input/output tensor:
-    ssize_t x = -(ssize_t)pad_t;
-    for (size_t ax = 0; ax < outWdims[1]; x += stride_h, ax++) {
-      ssize_t y = -(ssize_t)pad_l;
-      for (size_t ay = 0; ay < outWdims[2]; y += stride_w, ay++) {
-        // For each layer in the output tensor:
-        for (size_t z = 0; z < inWdims[3]; z++) {
-
-          float sum = 0;
-
-          for (size_t fx = 0; fx < kernel_h; fx++) {
-            for (size_t fy = 0; fy < kernel_w; fy++) {
-              ssize_t ox = x + fx;
-              ssize_t oy = y + fy;
-
-              // Ignore index access below zero (this is due to padding).
-              if (ox < 0 || oy < 0 || ox >= (ssize_t)inWdims[1] ||
-                  oy >= (ssize_t)inWdims[2]) {
-                continue;
-              }
-
-              sum += inW[libjit_getXYZW(inWdims, n, (size_t)ox, (size_t)oy, z)];
-            }
-          }
-
-          outW[libjit_getXYZW(outWdims, n, ax, ay, z)] = sum / filterArea;
-        } // C
-      }   // W
-    }     // H
-  }       // N
+  PoolArgs args;
+  libjit_init_pool_args(&args, inW, outW, inWdims, outWdims, kernelSizes,
+                        strides, pads);
+  libjit_parallel_for(outWdims[0] * outWdims[1], &libjit_avg_pool_f_body,
+                      &args);
+}
+
+void libjit_adaptive_avg_pool_i8(const int8_t *inW, int8_t *outW,
+                                 const size_t *inWdims, const size_t *outWdims,
+                                 int32_t outOffset, int32_t inOffset,
+                                 float scaleRatio) {
+  PoolArgs args;
+  libjit_init_pool_args(&args, inW, outW, inWdims, outWdims, nullptr, nullptr,
+                        nullptr);
+  args.inOffset = inOffset;
+  args.outOffset = outOffset;
+  args.scaleRatio = scaleRatio;
+  libjit_parallel_for(outWdims[0] * outWdims[1], &libjit_avg_pool_i8_body,
+                      &args);
+}
+
+void libjit_adaptive_avg_pool_f(const float *inW, float *outW,
+                                const size_t *inWdims,
+                                const size_t *outWdims) {
+  PoolArgs args;
+  libjit_init_pool_args(&args, inW, outW, inWdims, outWdims, nullptr, nullptr,
+                        nullptr);
+  libjit_parallel_for(outWdims[0] * outWdims[1], &libjit_avg_pool_f_body,
+                      &args);
 }
 
 void libjit_avg_pool_grad_f(float *inG, const float *outG,
@@ -1761,11 +3450,21 @@ int32_t libjit_element_quantize_kernel_i32(size_t idx, const float *inW,
   return result;
 }
 
+int16_t libjit_element_quantize_kernel_i16(size_t idx, const float *inW,
+                                           float scale, int32_t offset) {
+  return libjit_clip_i16(inW[idx] / scale + offset);
+}
+
 float libjit_element_dequantize_kernel_f(size_t idx, const int8_t *inW,
                                          float scale, int32_t offset) {
   return scale * (inW[idx] - offset);
 }
 
+float libjit_element_dequantize_i16_kernel_f(size_t idx, const int16_t *inW,
+                                             float scale, int32_t offset) {
+  return scale * (inW[idx] - offset);
+}
+
 int8_t libjit_element_rescale_kernel_i8(size_t idx, const int8_t *inW,
                                         int32_t outOffset, int32_t inOffset,
                                         int32_t pre, int32_t post,
@@ -1775,6 +3474,12 @@ int8_t libjit_element_rescale_kernel_i8(size_t idx, const int8_t *inW,
   return libjit_clip(s);
 }
 
+int16_t libjit_element_rescale_kernel_i16(size_t idx, const int16_t *inW,
+                                          int32_t outOffset, int32_t inOffset,
+                                          float scale) {
+  return libjit_clip_i16((inW[idx] - inOffset) * scale + outOffset);
+}
+
 void libjit_softmax_f(const float *inW, float *outW, const size_t *idim,
                       const size_t *odim) {
   for (size_t n = 0; n < idim[0]; n++) {
@@ -1801,6 +3506,14 @@ void libjit_softmax_f(const float *inW, float *outW, const size_t *idim,
   } // N
 }
 
+void libjit_softmax_fast_f(const float *inW, float *outW, const size_t *idim,
+                           const size_t *odim) {
+  for (size_t n = 0; n < idim[0]; n++) {
+    libjit_softmax_fast_row(inW + libjit_getXY(idim, n, 0),
+                            outW + libjit_getXY(odim, n, 0), idim[1]);
+  }
+}
+
 void libjit_softmax_grad_f(float *inG, float *outW, const size_t *selectedW,
                            const size_t *idim, const size_t *selectdim) {
   for (size_t n = 0; n < idim[0]; n++) {
@@ -1818,6 +3531,30 @@ void libjit_sigmoid_f(const float *inW, float *outW, size_t numElem) {
   }
 }
 
+/// Computes a step of an LSTM for each of the \p cellDims[0] x \p cellDims[1]
+/// elements of the cell state \p prevCell in a single pass: reads the four
+/// pre-activations of its gates from the rows of \p gates, which hold the
+/// input, forget and output gates and the candidate cell one after the
+/// other, and writes the new states \p cell and \p hidden. \p cell may be
+/// \p prevCell.
+void libjit_lstm_unit_f(float *hidden, float *cell, const float *gates,
+                        const float *prevCell, const size_t *cellDims) {
+  const size_t h = cellDims[1];
+  for (size_t b = 0; b < cellDims[0]; b++) {
+    const float *g = gates + b * 4 * h;
+    for (size_t j = 0; j < h; j++) {
+      float i = 1 / (expf(-g[j]) + 1);
+      float f = 1 / (expf(-g[h + j]) + 1);
+      float o = 1 / (expf(-g[2 * h + j]) + 1);
+      float c = 1 - 2 / (expf(2 * g[3 * h + j]) + 1);
+      size_t idx = b * h + j;
+      float newCell = f * prevCell[idx] + i * c;
+      cell[idx] = newCell;
+      hidden[idx] = o * (1 - 2 / (expf(2 * newCell) + 1));
+    }
+  }
+}
+
 void libjit_topk_f(float *values, size_t *indices, const float *input,
                    size_t *scratch, size_t k, size_t n, size_t size) {
   libjit_topk(values, indices, input, scratch, k, n, size);
@@ -1908,6 +3645,14 @@ void libjit_insert_tensor_i8(int8_t *tensor, int8_t *slice, size_t *offset,
                        numDimsTensor, numDimsSlice, offsetDim, count, axis);
 }
 
+void libjit_insert_tensor_i32(int32_t *tensor, int32_t *slice, size_t *offset,
+                              size_t *tensorDim, size_t *sliceDim,
+                              size_t numDimsTensor, size_t numDimsSlice,
+                              size_t offsetDim, size_t count, size_t axis) {
+  libjit_insert_tensor(tensor, slice, offset, tensorDim, sliceDim,
+                       numDimsTensor, numDimsSlice, offsetDim, count, axis);
+}
+
 void libjit_insert_tensor_b(int8_t *tensor, int8_t *slice, size_t *offset,
                             size_t *tensorDim, size_t *sliceDim,
                             size_t numDimsTensor, size_t numDimsSlice,
@@ -1929,6 +3674,39 @@ void libjit_space_to_depth_i8(const int8_t *inTensor, int8_t *outTensor,
   libjit_space_to_depth_generic(inTensor, outTensor, blockSize, inDims,
                                 outDims);
 }
+
+void libjit_resize_nearest_f(const float *in, float *out, const size_t *inDims,
+                             const size_t *outDims, const size_t *rows,
+                             const size_t *cols) {
+  libjit_resize(&libjit_resize_nearest_body<float>, in, out, inDims, outDims,
+                rows, nullptr, cols, nullptr, 0, 0, 0);
+}
+
+void libjit_resize_nearest_i8(const int8_t *in, int8_t *out,
+                              const size_t *inDims, const size_t *outDims,
+                              const size_t *rows, const size_t *cols) {
+  libjit_resize(&libjit_resize_nearest_body<int8_t>, in, out, inDims, outDims,
+                rows, nullptr, cols, nullptr, 0, 0, 0);
+}
+
+void libjit_resize_bilinear_f(const float *in, float *out,
+                              const size_t *inDims, const size_t *outDims,
+                              const size_t *rows, const float *rowWeights,
+                              const size_t *cols, const float *colWeights) {
+  libjit_resize(&libjit_resize_bilinear_f_body, in, out, inDims, outDims, rows,
+                rowWeights, cols, colWeights, 0, 0, 0);
+}
+
+void libjit_resize_bilinear_i8(const int8_t *in, int8_t *out,
+                               const size_t *inDims, const size_t *outDims,
+                               const size_t *rows, const float *rowWeights,
+                               const size_t *cols, const float *colWeights,
+                               int32_t inOffset, int32_t outOffset,
+                               float scaleRatio) {
+  libjit_resize(&libjit_resize_bilinear_i8_body, in, out, inDims, outDims,
+                rows, rowWeights, cols, colWeights, inOffset, outOffset,
+                scaleRatio);
+}
 __attribute__((noinline)) void
 libjit_dump_tensor(uint8_t *tensor, size_t *tensorDim, size_t numDimsTensor,
                    size_t elemKind, const char *name) {
@@ -1977,6 +3755,20 @@ void libjit_write_timestamp(uint64_t *tensor, size_t offset) {
   memcpy(tensor + offset, &ts, sizeof(uint64_t));
 }
 
+/// Write the timestamp followed by the hardware counters of the calling thread
+/// into the slot \p offset of \p tensor, whose slots are made of
+/// 1 + LIBJIT_NUM_PERF_COUNTERS values.
+void libjit_write_perf_counters(uint64_t *tensor, size_t offset) {
+  uint64_t *slot = tensor + offset * (1 + LIBJIT_NUM_PERF_COUNTERS);
+  libjit_counter_reader reader = glow_libjit_counter_reader;
+  if (reader) {
+    reader(slot + 1);
+  } else {
+    memset(slot + 1, 0, sizeof(uint64_t) * LIBJIT_NUM_PERF_COUNTERS);
+  }
+  libjit_write_timestamp(slot, 0);
+}
+
 /// Update min/max values \p compInfo and histogram \p existingHistogram with
 /// data collected from tensor \p inputTensor.
 /// Note: code ported from Profile.cpp: generateTensorHistogram
@@ -24,6 +24,13 @@
 
 #include "libjit_defs.h"
 
+extern "C" {
+// Defined in libjit_matmul.cpp, which is linked into the same module.
+void libjit_matmul_f(float *c, const float *a, const float *b,
+                     const size_t *cDims, const size_t *aDims,
+                     const size_t *bDims);
+}
+
 namespace {
 // Initialize the convolution output frame for slice \p N with the bias \p
 // biasW.
@@ -251,6 +258,848 @@ void libjit_convDKKC8_foreach_xy_pixels_filter(
   }       // For each X in the output.
 }
 
+/// Type of the functions that iterate over the pixels of a DKKC8 convolution.
+typedef void (*libjit_convDKKC8_pixel_fn)(
+    size_t sampleN, size_t outChannel, unsigned numDepthRegs,
+    unsigned depthStrips, unsigned sizeGroupY, size_t numChannels, float *outW,
+    const float *inW, const float *filterW, const float *biasW,
+    const size_t *outWdims, const size_t *inWdims, const size_t *filterWdims,
+    const size_t *biasWdims, const size_t *kernelSizes, const size_t *strides,
+    const size_t *pads, size_t group, size_t endChannelIndex);
+
+/// Arguments of libjit_convDKKC8_f for a single sample in the batch, passed to
+/// the body of its parallel loop.
+struct ConvDKKC8Args {
+  libjit_convDKKC8_pixel_fn eachPixelConv;
+  size_t sampleN;
+  size_t blocksPerGroup;
+  size_t inCperG;
+  size_t outCperG;
+  unsigned numDepthRegs;
+  unsigned sizeGroupY;
+  unsigned depthStrips;
+  float *outW;
+  const float *inW;
+  const float *filterW;
+  const float *biasW;
+  const size_t *outWdims;
+  const size_t *inWdims;
+  const size_t *filterWdims;
+  const size_t *biasWdims;
+  const size_t *kernelSizes;
+  const size_t *strides;
+  const size_t *pads;
+};
+
+/// Convolve the blocks of output channels [\p begin, \p end) of the sample
+/// described by \p ctx. Blocks are numbered consecutively over all groups.
+/// Each block writes a disjoint set of output channels, so different ranges may
+/// be processed concurrently.
+void libjit_convDKKC8_channel_blocks(size_t begin, size_t end, void *ctx) {
+  const ConvDKKC8Args *args = (const ConvDKKC8Args *)ctx;
+  size_t blockSize = 8 * args->numDepthRegs * args->depthStrips;
+  for (size_t i = begin; i < end; i++) {
+    size_t g = i / args->blocksPerGroup;
+    size_t startChannelIndex = g * args->outCperG;
+    size_t endChannelIndex = (g + 1) * args->outCperG;
+    size_t d = startChannelIndex + (i % args->blocksPerGroup) * blockSize;
+
+    // Perform the convolution for each pixel.
+    args->eachPixelConv(args->sampleN, d, args->numDepthRegs,
+                        args->depthStrips, args->sizeGroupY, args->inCperG,
+                        args->outW, args->inW, args->filterW, args->biasW,
+                        args->outWdims, args->inWdims, args->filterWdims,
+                        args->biasWdims, args->kernelSizes, args->strides,
+                        args->pads, g, endChannelIndex);
+  }
+}
+
+/// Upper bound on the number of floats of the scratch buffers of the im2col
+/// and Winograd convolutions. Larger problems are processed in chunks of rows
+/// (or tiles) that fit this budget.
+constexpr size_t conv_scratch_budget = 1 << 21;
+
+/// Number of output rows of the im2col convolution that are multiplied at a
+/// time, so that the epilogue is applied while the rows are still cached.
+constexpr size_t conv_write_back_rows = 256;
+
+/// \returns \p v clamped to [\p minVal, \p maxVal]. NaNs are propagated.
+inline float libjit_conv_clamp(float v, float minVal, float maxVal) {
+  return v < minVal ? minVal : (v > maxVal ? maxVal : v);
+}
+
+/// Apply the epilogue of the convolutions to the \p rows rows of \p D
+/// output channels of \p outW: add the bias and the matching rows of
+/// \p residualW, unless it is null, and clamp the result to
+/// [\p minVal, \p maxVal].
+void libjit_conv_write_back(float *outW, const float *biasW,
+                            const float *residualW, size_t rows, size_t D,
+                            float minVal, float maxVal) {
+  for (size_t i = 0; i < rows; i++) {
+    float *out = outW + i * D;
+    const float *residual = residualW ? residualW + i * D : nullptr;
+    for (size_t d = 0; d < D; d++) {
+      float v = out[d] + biasW[d];
+      if (residual) {
+        v += residual[d];
+      }
+      out[d] = libjit_conv_clamp(v, minVal, maxVal);
+    }
+  }
+}
+
+/// Copy the input patches of the output pixels [\p begin, \p end) of the
+/// whole batch into the row-major matrix \p col, one row of
+/// kernel_h * kernel_w * C elements per output pixel. Padding is filled with
+/// zeros.
+void libjit_im2col_rows(size_t begin, size_t end, float *col, const float *inW,
+                        const size_t *outWdims, const size_t *inWdims,
+                        const size_t *kernelSizes, const size_t *strides,
+                        const size_t *pads) {
+  size_t inC = inWdims[3];
+  size_t pixels = outWdims[1] * outWdims[2];
+  for (size_t r = begin; r < end; r++) {
+    size_t n = r / pixels;
+    size_t outx = (r % pixels) / outWdims[2];
+    size_t outy = (r % pixels) % outWdims[2];
+    for (size_t fx = 0; fx < kernelSizes[0]; fx++) {
+      for (size_t fy = 0; fy < kernelSizes[1]; fy++) {
+        ssize_t inx = (ssize_t)(outx * strides[0] + fx) - (ssize_t)pads[0];
+        ssize_t iny = (ssize_t)(outy * strides[1] + fy) - (ssize_t)pads[1];
+        if (inx < 0 || iny < 0 || inx >= (ssize_t)inWdims[1] ||
+            iny >= (ssize_t)inWdims[2]) {
+          memset(col, 0, inC * sizeof(float));
+        } else {
+          memcpy(col, inW + libjit_getXYZW(inWdims, n, inx, iny, 0),
+                 inC * sizeof(float));
+        }
+        col += inC;
+      }
+    }
+  }
+}
+
+/// Arguments of libjit_conv_winograd_f for a chunk of tiles, passed to the
+/// bodies of its parallel loops. \p V and \p M hold the 16 transformed input
+/// and output matrices of the chunk, of \p numTiles rows each.
+struct ConvWinogradArgs {
+  float *outW;
+  const float *inW;
+  const float *biasW;
+  const float *residualW;
+  const float *zeros;
+  float *V;
+  float *M;
+  const size_t *outWdims;
+  const size_t *inWdims;
+  const size_t *pads;
+  size_t tilesH;
+  size_t tilesW;
+  size_t firstTile;
+  size_t numTiles;
+  float minVal;
+  float maxVal;
+};
+
+/// Compute the input transform V = B^T * d * B of Winograd F(2x2, 3x3) for
+/// the tiles [\p begin, \p end) of the chunk described by \p ctx, where d are
+/// the 4x4 input patches of the tiles, for all channels at once.
+void libjit_winograd_input_tiles(size_t begin, size_t end, void *ctx) {
+  const ConvWinogradArgs *args = (const ConvWinogradArgs *)ctx;
+  const size_t *inWdims = args->inWdims;
+  size_t C = inWdims[3];
+  size_t tilesPerSample = args->tilesH * args->tilesW;
+  for (size_t t = begin; t < end; t++) {
+    size_t tile = args->firstTile + t;
+    size_t n = tile / tilesPerSample;
+    size_t ty = (tile % tilesPerSample) / args->tilesW;
+    size_t tx = (tile % tilesPerSample) % args->tilesW;
+
+    // Point to the pixels of the patch, or to zeros for the padding.
+    const float *d[4][4];
+    for (size_t i = 0; i < 4; i++) {
+      for (size_t j = 0; j < 4; j++) {
+        ssize_t inx = (ssize_t)(2 * ty + i) - (ssize_t)args->pads[0];
+        ssize_t iny = (ssize_t)(2 * tx + j) - (ssize_t)args->pads[1];
+        bool inside = inx >= 0 && iny >= 0 && inx < (ssize_t)inWdims[1] &&
+                      iny < (ssize_t)inWdims[2];
+        d[i][j] = inside ? args->inW + libjit_getXYZW(inWdims, n, inx, iny, 0)
+                         : args->zeros;
+      }
+    }
+
+    float *V = args->V + t * C;
+    size_t stride = args->numTiles * C;
+    for (size_t c = 0; c < C; c++) {
+      float tmp[4][4];
+      for (size_t j = 0; j < 4; j++) {
+        tmp[0][j] = d[0][j][c] - d[2][j][c];
+        tmp[1][j] = d[1][j][c] + d[2][j][c];
+        tmp[2][j] = d[2][j][c] - d[1][j][c];
+        tmp[3][j] = d[1][j][c] - d[3][j][c];
+      }
+      for (size_t i = 0; i < 4; i++) {
+        V[(i * 4 + 0) * stride + c] = tmp[i][0] - tmp[i][2];
+        V[(i * 4 + 1) * stride + c] = tmp[i][1] + tmp[i][2];
+        V[(i * 4 + 2) * stride + c] = tmp[i][2] - tmp[i][1];
+        V[(i * 4 + 3) * stride + c] = tmp[i][1] - tmp[i][3];
+      }
+    }
+  }
+}
+
+/// Compute the output transform Y = A^T * M * A of Winograd F(2x2, 3x3) for
+/// the tiles [\p begin, \p end) of the chunk described by \p ctx, apply the
+/// epilogue (bias, optional residual and clamp) and store the 2x2 outputs of
+/// the tiles that are inside the image.
+void libjit_winograd_output_tiles(size_t begin, size_t end, void *ctx) {
+  const ConvWinogradArgs *args = (const ConvWinogradArgs *)ctx;
+  const size_t *outWdims = args->outWdims;
+  size_t D = outWdims[3];
+  size_t tilesPerSample = args->tilesH * args->tilesW;
+  for (size_t t = begin; t < end; t++) {
+    size_t tile = args->firstTile + t;
+    size_t n = tile / tilesPerSample;
+    size_t ty = (tile % tilesPerSample) / args->tilesW;
+    size_t tx = (tile % tilesPerSample) % args->tilesW;
+    size_t rows = MIN(outWdims[1] - 2 * ty, (size_t)2);
+    size_t cols = MIN(outWdims[2] - 2 * tx, (size_t)2);
+
+    float *Y[2][2];
+    const float *R[2][2];
+    for (size_t i = 0; i < rows; i++) {
+      for (size_t j = 0; j < cols; j++) {
+        size_t offset = libjit_getXYZW(outWdims, n, 2 * ty + i, 2 * tx + j, 0);
+        Y[i][j] = args->outW + offset;
+        R[i][j] = args->residualW ? args->residualW + offset : nullptr;
+      }
+    }
+
+    const float *M = args->M + t * D;
+    size_t stride = args->numTiles * D;
+    for (size_t d = 0; d < D; d++) {
+      float tmp[2][4];
+      for (size_t j = 0; j < 4; j++) {
+        float m0 = M[(0 * 4 + j) * stride + d];
+        float m1 = M[(1 * 4 + j) * stride + d];
+        float m2 = M[(2 * 4 + j) * stride + d];
+        float m3 = M[(3 * 4 + j) * stride + d];
+        tmp[0][j] = m0 + m1 + m2;
+        tmp[1][j] = m1 - m2 - m3;
+      }
+      float bias = args->biasW[d];
+      float y[2][2];
+      for (size_t i = 0; i < 2; i++) {
+        y[i][0] = tmp[i][0] + tmp[i][1] + tmp[i][2] + bias;
+        y[i][1] = tmp[i][1] - tmp[i][2] - tmp[i][3] + bias;
+      }
+      for (size_t i = 0; i < rows; i++) {
+        for (size_t j = 0; j < cols; j++) {
+          float v = R[i][j] ? y[i][j] + R[i][j][d] : y[i][j];
+          Y[i][j][d] = libjit_conv_clamp(v, args->minVal, args->maxVal);
+        }
+      }
+    }
+  }
+}
+
+/// Perform a convolution as a matrix multiplication of the input patches of
+/// all output pixels (im2col) with the filter, which has been transposed at
+/// compile time to the shape \p filterWdims = {kernel_h * kernel_w * C, D}.
+/// Pointwise convolutions read the input in place, other ones copy the
+/// patches of as many output pixels as fit the scratch budget at a time. The
+/// epilogue of libjit_conv_write_back is applied to each block of rows right
+/// after it is computed.
+void libjit_conv_im2col(float *outW, const float *inW, const float *filterW,
+                        const float *biasW, const float *residualW,
+                        const size_t *outWdims, const size_t *inWdims,
+                        const size_t *filterWdims, const size_t *kernelSizes,
+                        const size_t *strides, const size_t *pads,
+                        float minVal, float maxVal) {
+  size_t K = filterWdims[0];
+  size_t D = filterWdims[1];
+  size_t numRows = outWdims[0] * outWdims[1] * outWdims[2];
+  bool pointwise = kernelSizes[0] == 1 && kernelSizes[1] == 1 &&
+                   strides[0] == 1 && strides[1] == 1 && pads[0] == 0 &&
+                   pads[1] == 0 && pads[2] == 0 && pads[3] == 0;
+
+  size_t chunkRows = numRows;
+  float *col = nullptr;
+  if (!pointwise) {
+    chunkRows = MIN(numRows, MAX(conv_scratch_budget / K, (size_t)1));
+    libjit_aligned_malloc((void **)&col, 64, chunkRows * K * sizeof(float));
+  }
+
+  for (size_t r = 0; r < numRows; r += chunkRows) {
+    size_t rows = MIN(numRows - r, chunkRows);
+    const float *a = inW + r * K;
+    if (!pointwise) {
+      libjit_im2col_rows(r, r + rows, col, inW, outWdims, inWdims,
+                         kernelSizes, strides, pads);
+      a = col;
+    }
+    for (size_t i = 0; i < rows; i += conv_write_back_rows) {
+      size_t blockRows = MIN(rows - i, conv_write_back_rows);
+      float *c = outW + (r + i) * D;
+      size_t cDims[] = {blockRows, D};
+      size_t aDims[] = {blockRows, K};
+      libjit_matmul_f(c, a + i * K, filterW, cDims, aDims, filterWdims);
+      libjit_conv_write_back(c, biasW,
+                             residualW ? residualW + (r + i) * D : nullptr,
+                             blockRows, D, minVal, maxVal);
+    }
+  }
+
+  if (col) {
+    libjit_aligned_free(col);
+  }
+}
+
+/// Perform a 3x3 stride-1 convolution with the Winograd F(2x2, 3x3)
+/// algorithm. The output is computed in 2x2 tiles from 4x4 input tiles, as 16
+/// independent matrix multiplications of the transformed input tiles with the
+/// filter, which has been transformed at compile time to the shape
+/// \p filterWdims = {16, C, D}. This takes 16 instead of 36 multiplications
+/// for each 2x2 output tile, input channel, and output channel. The epilogue
+/// is applied when the output tiles are stored.
+void libjit_conv_winograd(float *outW, const float *inW, const float *filterW,
+                          const float *biasW, const float *residualW,
+                          const size_t *outWdims, const size_t *inWdims,
+                          const size_t *filterWdims, const size_t *pads,
+                          float minVal, float maxVal) {
+  size_t C = filterWdims[1];
+  size_t D = filterWdims[2];
+  size_t tilesH = (outWdims[1] + 1) / 2;
+  size_t tilesW = (outWdims[2] + 1) / 2;
+  size_t totalTiles = outWdims[0] * tilesH * tilesW;
+  size_t chunkTiles =
+      MIN(totalTiles, MAX(conv_scratch_budget / (16 * MAX(C, D)), (size_t)1));
+
+  float *V = nullptr;
+  float *M = nullptr;
+  float *zeros = nullptr;
+  libjit_aligned_malloc((void **)&V, 64, 16 * chunkTiles * C * sizeof(float));
+  libjit_aligned_malloc((void **)&M, 64, 16 * chunkTiles * D * sizeof(float));
+  libjit_aligned_malloc((void **)&zeros, 64, C * sizeof(float));
+  memset(zeros, 0, C * sizeof(float));
+
+  ConvWinogradArgs args{};
+  args.outW = outW;
+  args.inW = inW;
+  args.biasW = biasW;
+  args.residualW = residualW;
+  args.zeros = zeros;
+  args.V = V;
+  args.M = M;
+  args.outWdims = outWdims;
+  args.inWdims = inWdims;
+  args.pads = pads;
+  args.tilesH = tilesH;
+  args.tilesW = tilesW;
+  args.minVal = minVal;
+  args.maxVal = maxVal;
+  for (size_t t = 0; t < totalTiles; t += chunkTiles) {
+    args.firstTile = t;
+    args.numTiles = MIN(totalTiles - t, chunkTiles);
+    libjit_parallel_for(args.numTiles, &libjit_winograd_input_tiles, &args);
+    size_t mDims[] = {args.numTiles, D};
+    size_t vDims[] = {args.numTiles, C};
+    size_t uDims[] = {C, D};
+    for (size_t xi = 0; xi < 16; xi++) {
+      libjit_matmul_f(M + xi * args.numTiles * D, V + xi * args.numTiles * C,
+                      filterW + xi * C * D, mDims, vDims, uDims);
+    }
+    libjit_parallel_for(args.numTiles, &libjit_winograd_output_tiles, &args);
+  }
+
+  libjit_aligned_free(zeros);
+  libjit_aligned_free(M);
+  libjit_aligned_free(V);
+}
+
+/// Number of output channels of the channelwise quantized convolution that
+/// are accumulated together.
+constexpr size_t cqc_channels_block = 8;
+
+/// Arguments of libjit_channelwise_quantized_convolution_i8 passed to the body
+/// of its parallel loop.
+struct ChannelwiseQuantizedConvI8Args {
+  int8_t *outW;
+  const int8_t *inW;
+  const int8_t *filterW;
+  const int32_t *biasW;
+  const int32_t *filterOffsets;
+  const int32_t *outPre;
+  const int32_t *outPost;
+  const int32_t *outScale;
+  const size_t *outWdims;
+  const size_t *inWdims;
+  const size_t *filterWdims;
+  const size_t *kernelSizes;
+  const size_t *strides;
+  const size_t *pads;
+  size_t inCperG;
+  size_t outCperG;
+  size_t blocksPerGroup;
+  int32_t outOffset;
+  int32_t inOffset;
+};
+
+/// Convolve the blocks of cqc_channels_block output channels [\p begin,
+/// \p end) described by \p ctx. Blocks are numbered consecutively over the
+/// groups of every sample of the batch. The products of the filter and of the
+/// input are accumulated without the offsets of the filter, which are applied
+/// with the sums of the input once per output, together with the
+/// requantization of the channel.
+void libjit_channelwise_quantized_conv_blocks(size_t begin, size_t end,
+                                              void *ctx) {
+  const ChannelwiseQuantizedConvI8Args *args =
+      (const ChannelwiseQuantizedConvI8Args *)ctx;
+  const size_t *inWdims = args->inWdims;
+  const size_t *outWdims = args->outWdims;
+  const size_t inCperG = args->inCperG;
+  const size_t outCperG = args->outCperG;
+  const size_t kernel_h = args->kernelSizes[0];
+  const size_t kernel_w = args->kernelSizes[1];
+  const size_t sliceSize =
+      args->filterWdims[1] * args->filterWdims[2] * args->filterWdims[3];
+  const int32_t inOffset = args->inOffset;
+  const size_t blocksPerSample = outWdims[3] / outCperG * args->blocksPerGroup;
+  for (size_t block = begin; block < end; block++) {
+    size_t n = block / blocksPerSample;
+    size_t g = (block % blocksPerSample) / args->blocksPerGroup;
+    size_t d =
+        g * outCperG + (block % args->blocksPerGroup) * cqc_channels_block;
+    size_t numD = MIN(cqc_channels_block, (g + 1) * outCperG - d);
+    const int8_t *filterW = args->filterW + d * sliceSize;
+
+    ssize_t x = -(ssize_t)args->pads[0];
+    for (size_t ax = 0; ax < outWdims[1]; x += args->strides[0], ax++) {
+      ssize_t y = -(ssize_t)args->pads[1];
+      for (size_t ay = 0; ay < outWdims[2]; y += args->strides[1], ay++) {
+        int32_t sum[cqc_channels_block] = {0};
+        int32_t inSum = 0;
+
+        // For each element in the convolution-filter:
+        for (size_t fx = 0; fx < kernel_h; fx++) {
+          for (size_t fy = 0; fy < kernel_w; fy++) {
+            ssize_t ox = x + fx;
+            ssize_t oy = y + fy;
+
+            // Ignore index access below zero (this is due to padding).
+            if (ox < 0 || oy < 0 || ox >= (ssize_t)inWdims[1] ||
+                oy >= (ssize_t)inWdims[2]) {
+              continue;
+            }
+
+            const int8_t *in =
+                args->inW + libjit_getXYZW(inWdims, n, (size_t)ox, (size_t)oy,
+                                           g * inCperG);
+            const int8_t *filter = filterW + (fx * kernel_w + fy) * inCperG;
+            for (size_t fd = 0; fd < inCperG; fd++) {
+              int32_t v = in[fd] - inOffset;
+              inSum += v;
+              for (size_t i = 0; i < numD; i++) {
+                sum[i] += filter[sliceSize * i + fd] * v;
+              }
+            }
+          }
+        }
+
+        int8_t *out = args->outW + libjit_getXYZW(outWdims, n, ax, ay, d);
+        for (size_t i = 0; i < numD; i++) {
+          // Apply the offset of the filter and the bias of the channel, and
+          // scale the result back to the expected destination scale.
+          int32_t acc =
+              sum[i] - args->filterOffsets[d + i] * inSum + args->biasW[d + i];
+          out[i] = libjit_clip(libjit_scale_i32i8(
+              acc, args->outPre[d + i], args->outPost[d + i],
+              args->outScale[d + i], args->outOffset));
+        }
+      } // W
+    }   // H
+  }
+}
+
+/// Number of output channels of the int16 convolution that are accumulated
+/// together.
+constexpr size_t i16_channels_block = 8;
+
+/// Arguments of libjit_convolution_i16 passed to the body of its parallel
+/// loop. \p biasScale brings the bias to the scale of the products and
+/// \p outScale brings these to the scale of the output.
+struct ConvolutionI16Args {
+  int16_t *outW;
+  const int16_t *inW;
+  const int8_t *filterW;
+  const int32_t *biasW;
+  const size_t *outWdims;
+  const size_t *inWdims;
+  const size_t *filterWdims;
+  const size_t *kernelSizes;
+  const size_t *strides;
+  const size_t *pads;
+  size_t inCperG;
+  size_t outCperG;
+  size_t blocksPerGroup;
+  size_t dilation;
+  int32_t outOffset;
+  int32_t inOffset;
+  int32_t filterOffset;
+  int32_t biasOffset;
+  float biasScale;
+  float outScale;
+};
+
+/// Convolve the blocks of i16_channels_block output channels [\p begin,
+/// \p end) described by \p ctx, numbered as in
+/// libjit_channelwise_quantized_conv_blocks. The products of the int8 filter
+/// and of the int16 input are accumulated in 64 bits, the offset of the
+/// filter is applied with the sums of the input and the result is
+/// requantized in float.
+void libjit_convolution_i16_blocks(size_t begin, size_t end, void *ctx) {
+  const ConvolutionI16Args *args = (const ConvolutionI16Args *)ctx;
+  const size_t *inWdims = args->inWdims;
+  const size_t *outWdims = args->outWdims;
+  const size_t inCperG = args->inCperG;
+  const size_t outCperG = args->outCperG;
+  const size_t kernel_h = args->kernelSizes[0];
+  const size_t kernel_w = args->kernelSizes[1];
+  const size_t dilation = args->dilation;
+  const size_t sliceSize =
+      args->filterWdims[1] * args->filterWdims[2] * args->filterWdims[3];
+  const int32_t inOffset = args->inOffset;
+  const size_t blocksPerSample = outWdims[3] / outCperG * args->blocksPerGroup;
+  for (size_t block = begin; block < end; block++) {
+    size_t n = block / blocksPerSample;
+    size_t g = (block % blocksPerSample) / args->blocksPerGroup;
+    size_t d =
+        g * outCperG + (block % args->blocksPerGroup) * i16_channels_block;
+    size_t numD = MIN(i16_channels_block, (g + 1) * outCperG - d);
+    const int8_t *filterW = args->filterW + d * sliceSize;
+
+    ssize_t x = -(ssize_t)args->pads[0];
+    for (size_t ax = 0; ax < outWdims[1]; x += args->strides[0], ax++) {
+      ssize_t y = -(ssize_t)args->pads[1];
+      for (size_t ay = 0; ay < outWdims[2]; y += args->strides[1], ay++) {
+        int64_t sum[i16_channels_block] = {0};
+        int64_t inSum = 0;
+
+        // For each element in the convolution-filter:
+        for (size_t fx = 0; fx < kernel_h; fx++) {
+          for (size_t fy = 0; fy < kernel_w; fy++) {
+            ssize_t ox = x + fx * dilation;
+            ssize_t oy = y + fy * dilation;
+
+            // Ignore index access below zero (this is due to padding).
+            if (ox < 0 || oy < 0 || ox >= (ssize_t)inWdims[1] ||
+                oy >= (ssize_t)inWdims[2]) {
+              continue;
+            }
+
+            const int16_t *in =
+                args->inW + libjit_getXYZW(inWdims, n, (size_t)ox, (size_t)oy,
+                                           g * inCperG);
+            const int8_t *filter = filterW + (fx * kernel_w + fy) * inCperG;
+            for (size_t fd = 0; fd < inCperG; fd++) {
+              // The product of an int8 and of a 17-bit value fits 32 bits.
+              int32_t v = in[fd] - inOffset;
+              inSum += v;
+              for (size_t i = 0; i < numD; i++) {
+                sum[i] += filter[sliceSize * i + fd] * v;
+              }
+            }
+          }
+        }
+
+        int16_t *out = args->outW + libjit_getXYZW(outWdims, n, ax, ay, d);
+        for (size_t i = 0; i < numD; i++) {
+          // Apply the offset of the filter and the bias, and scale the result
+          // back to the expected destination scale.
+          int64_t acc = sum[i] - args->filterOffset * inSum;
+          float bias =
+              (args->biasW[d + i] - args->biasOffset) * args->biasScale;
+          out[i] = libjit_clip_i16(((float)acc + bias) * args->outScale +
+                                   args->outOffset);
+        }
+      } // W
+    }   // H
+  }
+}
+
+/// Number of channels of the depthwise convolutions that are accumulated
+/// together, in float8 registers for floats.
+constexpr size_t depthwise_channels_block = 32;
+
+/// Arguments of libjit_conv_depthwise_f passed to the body of its parallel
+/// loop over the output pixels, which are numbered over the whole batch. The
+/// results of the pixel \p firstPixel + i are written to the row i of
+/// \p outW, of as many elements as channels, and clamped to
+/// [\p minVal, \p maxVal].
+struct ConvDepthwiseArgs {
+  float *outW;
+  const float *inW;
+  const float *filterW;
+  const float *biasW;
+  const size_t *outWdims;
+  const size_t *inWdims;
+  const size_t *kernelSizes;
+  const size_t *strides;
+  const size_t *pads;
+  size_t firstPixel;
+  float minVal;
+  float maxVal;
+};
+
+/// Arguments of libjit_conv_depthwise_i8 passed to the body of its parallel
+/// loop, numbered as in ConvDepthwiseArgs, with the offsets and the
+/// requantization parameters of libjit_convolution_i8.
+struct ConvDepthwiseI8Args {
+  int8_t *outW;
+  const int8_t *inW;
+  const int8_t *filterW;
+  const int32_t *biasW;
+  const size_t *outWdims;
+  const size_t *inWdims;
+  const size_t *kernelSizes;
+  const size_t *strides;
+  const size_t *pads;
+  int32_t outOffset;
+  int32_t inOffset;
+  int32_t filterOffset;
+  int32_t biasOffset;
+  int32_t biasPre;
+  int32_t biasPost;
+  int32_t biasScale;
+  int32_t outPre;
+  int32_t outPost;
+  int32_t outScale;
+};
+
+/// The positions of the filter of a depthwise convolution that are inside the
+/// input for an output pixel, [fxBegin, fxEnd) x [fyBegin, fyEnd), and the
+/// input pixel (x, y) of the filter position (0, 0), which may be in the
+/// padding.
+struct DepthwiseWindow {
+  ssize_t x;
+  ssize_t y;
+  size_t fxBegin;
+  size_t fxEnd;
+  size_t fyBegin;
+  size_t fyEnd;
+
+  /// \returns whether the whole filter is inside the input.
+  bool isFull(const size_t *kernelSizes) const {
+    return fxBegin == 0 && fyBegin == 0 && fxEnd == kernelSizes[0] &&
+           fyEnd == kernelSizes[1];
+  }
+
+  /// \returns the offset of the filter position (\p fx, \p fy) in a sample
+  /// of the input of shape \p inWdims.
+  size_t getInputOffset(const size_t *inWdims, size_t fx, size_t fy) const {
+    return ((x + (ssize_t)fx) * inWdims[2] + (y + (ssize_t)fy)) * inWdims[3];
+  }
+};
+
+/// \returns the window of the filter for the output pixel (\p outx, \p outy).
+DepthwiseWindow libjit_depthwise_window(size_t outx, size_t outy,
+                                        const size_t *inWdims,
+                                        const size_t *kernelSizes,
+                                        const size_t *strides,
+                                        const size_t *pads) {
+  DepthwiseWindow w;
+  w.x = (ssize_t)(outx * strides[0]) - (ssize_t)pads[0];
+  w.y = (ssize_t)(outy * strides[1]) - (ssize_t)pads[1];
+  ssize_t endX = (ssize_t)inWdims[1] - w.x;
+  ssize_t endY = (ssize_t)inWdims[2] - w.y;
+  w.fxBegin = w.x < 0 ? -w.x : 0;
+  w.fyBegin = w.y < 0 ? -w.y : 0;
+  w.fxEnd = endX <= 0 ? 0 : MIN(kernelSizes[0], (size_t)endX);
+  w.fyEnd = endY <= 0 ? 0 : MIN(kernelSizes[1], (size_t)endY);
+  return w;
+}
+
+/// Accumulate the channels [\p c, \p c + 8 * \p R) of the output pixel of the
+/// window \p w of a depthwise convolution, while they are inside the \p C
+/// channels, into \p out. The filter loops are unrolled for \p K x \p K
+/// kernels, which the whole window must be inside, and run over the window
+/// for \p K = 0. \returns the first channel that is left.
+template <size_t K, size_t R>
+size_t libjit_conv_depthwise_channels_f(float *out, const float *inW,
+                                        const float *filterW,
+                                        const float *biasW,
+                                        const DepthwiseWindow &w,
+                                        const size_t *inWdims,
+                                        size_t kernel_w, size_t c, size_t C) {
+  const size_t fxBegin = K ? 0 : w.fxBegin;
+  const size_t fxEnd = K ? K : w.fxEnd;
+  const size_t fyBegin = K ? 0 : w.fyBegin;
+  const size_t fyEnd = K ? K : w.fyEnd;
+  const size_t kw = K ? K : kernel_w;
+  for (; c + 8 * R <= C; c += 8 * R) {
+    float8 sum[R];
+    for (size_t r = 0; r < R; r++) {
+      sum[r] = LoaduFloat8(biasW + c + 8 * r);
+    }
+    for (size_t fx = fxBegin; fx < fxEnd; fx++) {
+      for (size_t fy = fyBegin; fy < fyEnd; fy++) {
+        const float *in = inW + w.getInputOffset(inWdims, fx, fy) + c;
+        const float *filter = filterW + (fx * kw + fy) * C + c;
+        for (size_t r = 0; r < R; r++) {
+          sum[r] += LoaduFloat8(in + 8 * r) * LoaduFloat8(filter + 8 * r);
+        }
+      }
+    }
+    for (size_t r = 0; r < R; r++) {
+      StoreuFloat8(out + c + 8 * r, sum[r]);
+    }
+  }
+  return c;
+}
+
+/// Compute the output pixel of the window \p w of the sample \p inW into
+/// \p out, vectorized across the channels, with the filter loops unrolled as
+/// in libjit_conv_depthwise_channels_f.
+template <size_t K>
+void libjit_conv_depthwise_pixel_f(float *out, const float *inW,
+                                   const float *filterW, const float *biasW,
+                                   const DepthwiseWindow &w,
+                                   const size_t *inWdims, size_t kernel_w,
+                                   float minVal, float maxVal) {
+  constexpr size_t regs = depthwise_channels_block / 8;
+  const size_t C = inWdims[3];
+  size_t c = libjit_conv_depthwise_channels_f<K, regs>(
+      out, inW, filterW, biasW, w, inWdims, kernel_w, 0, C);
+  c = libjit_conv_depthwise_channels_f<K, 1>(out, inW, filterW, biasW, w,
+                                             inWdims, kernel_w, c, C);
+  // The channels that don't fill a register.
+  for (; c < C; c++) {
+    float sum = biasW[c];
+    for (size_t fx = w.fxBegin; fx < w.fxEnd; fx++) {
+      for (size_t fy = w.fyBegin; fy < w.fyEnd; fy++) {
+        sum += inW[w.getInputOffset(inWdims, fx, fy) + c] *
+               filterW[(fx * kernel_w + fy) * C + c];
+      }
+    }
+    out[c] = sum;
+  }
+  for (c = 0; c < C; c++) {
+    out[c] = libjit_conv_clamp(out[c], minVal, maxVal);
+  }
+}
+
+/// Compute the output pixels [\p begin, \p end) of the depthwise convolution
+/// described by \p ctx. The 3x3 and 5x5 filters are unrolled for the pixels
+/// whose window is inside the input.
+void libjit_conv_depthwise_pixels_f(size_t begin, size_t end, void *ctx) {
+  const ConvDepthwiseArgs *args = (const ConvDepthwiseArgs *)ctx;
+  const size_t *inWdims = args->inWdims;
+  const size_t *outWdims = args->outWdims;
+  const size_t *kernelSizes = args->kernelSizes;
+  const size_t C = inWdims[3];
+  const size_t pixels = outWdims[1] * outWdims[2];
+  const size_t sampleSize = inWdims[1] * inWdims[2] * C;
+  for (size_t p = begin; p < end; p++) {
+    size_t r = args->firstPixel + p;
+    size_t n = r / pixels;
+    size_t outx = (r % pixels) / outWdims[2];
+    size_t outy = (r % pixels) % outWdims[2];
+    DepthwiseWindow w = libjit_depthwise_window(
+        outx, outy, inWdims, kernelSizes, args->strides, args->pads);
+    const float *in = args->inW + n * sampleSize;
+    float *out = args->outW + p * C;
+    bool full = w.isFull(kernelSizes);
+    if (full && kernelSizes[0] == 3 && kernelSizes[1] == 3) {
+      libjit_conv_depthwise_pixel_f<3>(out, in, args->filterW, args->biasW, w,
+                                       inWdims, 3, args->minVal,
+                                       args->maxVal);
+    } else if (full && kernelSizes[0] == 5 && kernelSizes[1] == 5) {
+      libjit_conv_depthwise_pixel_f<5>(out, in, args->filterW, args->biasW, w,
+                                       inWdims, 5, args->minVal,
+                                       args->maxVal);
+    } else {
+      libjit_conv_depthwise_pixel_f<0>(out, in, args->filterW, args->biasW, w,
+                                       inWdims, kernelSizes[1], args->minVal,
+                                       args->maxVal);
+    }
+  }
+}
+
+/// Compute the output pixel of the window \p w of the sample \p inW of the
+/// int8 depthwise convolution described by \p args into \p out, with the
+/// filter loops unrolled as in libjit_conv_depthwise_channels_f. The products
+/// of the channels of a block are accumulated in 32 bits, which vectorizes
+/// across the channels.
+template <size_t K>
+void libjit_conv_depthwise_pixel_i8(int8_t *out, const int8_t *inW,
+                                    const DepthwiseWindow &w,
+                                    size_t kernel_w,
+                                    const ConvDepthwiseI8Args *args) {
+  const size_t *inWdims = args->inWdims;
+  const size_t C = inWdims[3];
+  const size_t fxBegin = K ? 0 : w.fxBegin;
+  const size_t fxEnd = K ? K : w.fxEnd;
+  const size_t fyBegin = K ? 0 : w.fyBegin;
+  const size_t fyEnd = K ? K : w.fyEnd;
+  const size_t kw = K ? K : kernel_w;
+  const int32_t inOffset = args->inOffset;
+  const int32_t filterOffset = args->filterOffset;
+  for (size_t c = 0; c < C; c += depthwise_channels_block) {
+    size_t numC = MIN(depthwise_channels_block, C - c);
+    int32_t sum[depthwise_channels_block];
+    for (size_t i = 0; i < numC; i++) {
+      // Scale the bias to match the scale of the products.
+      sum[i] = libjit_scale_i32i8(args->biasW[c + i] - args->biasOffset,
+                                  args->biasPre, args->biasPost,
+                                  args->biasScale, 0);
+    }
+    for (size_t fx = fxBegin; fx < fxEnd; fx++) {
+      for (size_t fy = fyBegin; fy < fyEnd; fy++) {
+        const int8_t *in = inW + w.getInputOffset(inWdims, fx, fy) + c;
+        const int8_t *filter = args->filterW + (fx * kw + fy) * C + c;
+        for (size_t i = 0; i < numC; i++) {
+          sum[i] += (in[i] - inOffset) * (filter[i] - filterOffset);
+        }
+      }
+    }
+    for (size_t i = 0; i < numC; i++) {
+      // Scale the result back to the expected destination scale.
+      out[c + i] = libjit_clip(libjit_scale_i32i8(
+          sum[i], args->outPre, args->outPost, args->outScale,
+          args->outOffset));
+    }
+  }
+}
+
+/// Compute the output pixels [\p begin, \p end) of the int8 depthwise
+/// convolution described by \p ctx, as libjit_conv_depthwise_pixels_f does.
+void libjit_conv_depthwise_pixels_i8(size_t begin, size_t end, void *ctx) {
+  const ConvDepthwiseI8Args *args = (const ConvDepthwiseI8Args *)ctx;
+  const size_t *inWdims = args->inWdims;
+  const size_t *outWdims = args->outWdims;
+  const size_t *kernelSizes = args->kernelSizes;
+  const size_t C = inWdims[3];
+  const size_t pixels = outWdims[1] * outWdims[2];
+  const size_t sampleSize = inWdims[1] * inWdims[2] * C;
+  for (size_t r = begin; r < end; r++) {
+    size_t n = r / pixels;
+    size_t outx = (r % pixels) / outWdims[2];
+    size_t outy = (r % pixels) % outWdims[2];
+    DepthwiseWindow w = libjit_depthwise_window(
+        outx, outy, inWdims, kernelSizes, args->strides, args->pads);
+    const int8_t *in = args->inW + n * sampleSize;
+    int8_t *out = args->outW + r * C;
+    bool full = w.isFull(kernelSizes);
+    if (full && kernelSizes[0] == 3 && kernelSizes[1] == 3) {
+      libjit_conv_depthwise_pixel_i8<3>(out, in, w, 3, args);
+    } else if (full && kernelSizes[0] == 5 && kernelSizes[1] == 5) {
+      libjit_conv_depthwise_pixel_i8<5>(out, in, w, 5, args);
+    } else {
+      libjit_conv_depthwise_pixel_i8<0>(out, in, w, kernelSizes[1], args);
+    }
+  }
+}
+
 } // namespace
 
 extern "C" {
@@ -271,6 +1120,16 @@ void libjit_convDKKC8_f(float *outW, const float *inW, const float *filterW,
       (pixelScanFirst ? &libjit_convDKKC8_foreach_xy_pixels_filter
                       : &libjit_convDKKC8_foreach_xy_filter_pixels);
 
+  // Each block processes [numDepthRegs x float8 x depthStrips] output
+  // channels of a single group.
+  size_t blockSize = 8 * numDepthRegs * depthStrips;
+  size_t blocksPerGroup = (outCperG + blockSize - 1) / blockSize;
+  ConvDKKC8Args args{eachPixelConv, 0,           blocksPerGroup, inCperG,
+                     outCperG,      numDepthRegs, sizeGroupY,     depthStrips,
+                     outW,          inW,          filterW,        biasW,
+                     outWdims,      inWdims,      filterWdims,    biasWdims,
+                     kernelSizes,   strides,      pads};
+
   // For each input in the batch:
   for (size_t n = 0; n < inWdims[0]; n++) {
 
@@ -278,24 +1137,12 @@ void libjit_convDKKC8_f(float *outW, const float *inW, const float *filterW,
     // Later we will accumulate values into this slice.
     libjit_conv_init_output_with_bias(n, outW, biasW, outWdims, biasWdims);
 
-    // For each group of input channels:
-    for (size_t g = 0; g < group; g++) {
-
-      // For each output channel, process [numDepthRegs x float8] elements.
-      size_t startChannelIndex = g * outCperG;
-      size_t endChannelIndex = (g + 1) * outCperG;
-      for (size_t d = startChannelIndex; d < endChannelIndex;
-           d += 8 * numDepthRegs * depthStrips) {
-
-        // Perform the convolution for each pixel.
-        eachPixelConv(n, d, numDepthRegs, depthStrips, sizeGroupY, inCperG,
-                      outW, inW, filterW, biasW, outWdims, inWdims, filterWdims,
-                      biasWdims, kernelSizes, strides, pads, g,
-                      endChannelIndex);
-
-      } // For each D (the depth, or the output channel).
-    }   // for each G, the group
-  }     // For each N, the sample in the batch.
+    // For each group and each block of output channels in the group, split
+    // across the threads made available by the runtime.
+    args.sampleN = n;
+    libjit_parallel_for(group * blocksPerGroup,
+                        &libjit_convDKKC8_channel_blocks, &args);
+  } // For each N, the sample in the batch.
 }
 
 void libjit_convolution_f(float *outW, const float *inW, const float *filterW,
@@ -419,6 +1266,133 @@ void libjit_convolution_f(float *outW, const float *inW, const float *filterW,
   }           // For each N, the sample in the batch.
 }
 
+void libjit_conv_im2col_f(float *outW, const float *inW, const float *filterW,
+                          const float *biasW, const size_t *outWdims,
+                          const size_t *inWdims, const size_t *filterWdims,
+                          const size_t *biasWdims, const size_t *kernelSizes,
+                          const size_t *strides, const size_t *pads) {
+  libjit_conv_im2col(outW, inW, filterW, biasW, nullptr, outWdims, inWdims,
+                     filterWdims, kernelSizes, strides, pads, -INFINITY,
+                     INFINITY);
+}
+
+void libjit_conv_winograd_f(float *outW, const float *inW,
+                            const float *filterW, const float *biasW,
+                            const size_t *outWdims, const size_t *inWdims,
+                            const size_t *filterWdims, const size_t *biasWdims,
+                            const size_t *pads) {
+  libjit_conv_winograd(outW, inW, filterW, biasW, nullptr, outWdims, inWdims,
+                       filterWdims, pads, -INFINITY, INFINITY);
+}
+
+/// Perform an im2col convolution and fuse the epilogue into its write-back:
+/// add the bias and \p residualW, unless it is null, and clamp the result to
+/// [\p minVal, \p maxVal]. This is a convolution followed by an optional
+/// residual Add, and by a Relu or a Clip, in a single pass over the output.
+void libjit_conv_im2col_fused_f(float *outW, const float *inW,
+                                const float *filterW, const float *biasW,
+                                const float *residualW, const size_t *outWdims,
+                                const size_t *inWdims,
+                                const size_t *filterWdims,
+                                const size_t *biasWdims,
+                                const size_t *kernelSizes,
+                                const size_t *strides, const size_t *pads,
+                                float minVal, float maxVal) {
+  libjit_conv_im2col(outW, inW, filterW, biasW, residualW, outWdims, inWdims,
+                     filterWdims, kernelSizes, strides, pads, minVal, maxVal);
+}
+
+/// Perform a Winograd convolution with the epilogue of
+/// libjit_conv_im2col_fused_f fused into the output transform.
+void libjit_conv_winograd_fused_f(
+    float *outW, const float *inW, const float *filterW, const float *biasW,
+    const float *residualW, const size_t *outWdims, const size_t *inWdims,
+    const size_t *filterWdims, const size_t *biasWdims,
+    const size_t *kernelSizes, const size_t *strides, const size_t *pads,
+    float minVal, float maxVal) {
+  libjit_conv_winograd(outW, inW, filterW, biasW, residualW, outWdims,
+                       inWdims, filterWdims, pads, minVal, maxVal);
+}
+
+/// Perform a depthwise convolution, with a group per channel, whose filter
+/// has been transposed at compile time to the shape
+/// \p filterWdims = {kernel_h * kernel_w, C}, so that the channels of the
+/// NHWC input and of the filter are contiguous and are vectorized. The result
+/// is clamped to [\p minVal, \p maxVal]. The output pixels are split across
+/// the threads made available by the runtime.
+void libjit_conv_depthwise_f(float *outW, const float *inW,
+                             const float *filterW, const float *biasW,
+                             const size_t *outWdims, const size_t *inWdims,
+                             const size_t *filterWdims,
+                             const size_t *biasWdims,
+                             const size_t *kernelSizes, const size_t *strides,
+                             const size_t *pads, float minVal, float maxVal) {
+  ConvDepthwiseArgs args{outW,    inW,         filterW, biasW, outWdims,
+                         inWdims, kernelSizes, strides, pads,  0,
+                         minVal,  maxVal};
+  libjit_parallel_for(outWdims[0] * outWdims[1] * outWdims[2],
+                      &libjit_conv_depthwise_pixels_f, &args);
+}
+
+/// Perform a depthwise convolution as libjit_conv_depthwise_f does, followed
+/// by a pointwise convolution by \p pwFilterW, which has been transposed to
+/// the shape \p pwFilterWdims = {C, D}. The depthwise results are clamped to
+/// [\p dwMinVal, \p dwMaxVal] and the pointwise ones to [\p minVal,
+/// \p maxVal]. The depthwise results of conv_write_back_rows pixels at a time
+/// are computed into a scratch buffer and multiplied right away, so that they
+/// are never written to memory.
+void libjit_conv_depthwise_pointwise_f(
+    float *outW, const float *inW, const float *filterW, const float *biasW,
+    const float *pwFilterW, const float *pwBiasW, const size_t *outWdims,
+    const size_t *inWdims, const size_t *filterWdims, const size_t *biasWdims,
+    const size_t *pwFilterWdims, const size_t *pwBiasWdims,
+    const size_t *kernelSizes, const size_t *strides, const size_t *pads,
+    float dwMinVal, float dwMaxVal, float minVal, float maxVal) {
+  size_t C = inWdims[3];
+  size_t D = outWdims[3];
+  size_t numPixels = outWdims[0] * outWdims[1] * outWdims[2];
+  size_t chunkPixels = MIN(numPixels, conv_write_back_rows);
+  size_t dwDims[] = {outWdims[0], outWdims[1], outWdims[2], C};
+  float *dw = nullptr;
+  libjit_aligned_malloc((void **)&dw, 64, chunkPixels * C * sizeof(float));
+
+  ConvDepthwiseArgs args{dw,       inW,         filterW, biasW, dwDims,
+                         inWdims,  kernelSizes, strides, pads,  0,
+                         dwMinVal, dwMaxVal};
+  for (size_t r = 0; r < numPixels; r += chunkPixels) {
+    size_t pixels = MIN(numPixels - r, chunkPixels);
+    args.firstPixel = r;
+    libjit_parallel_for(pixels, &libjit_conv_depthwise_pixels_f, &args);
+    float *c = outW + r * D;
+    size_t cDims[] = {pixels, D};
+    size_t aDims[] = {pixels, C};
+    libjit_matmul_f(c, dw, pwFilterW, cDims, aDims, pwFilterWdims);
+    libjit_conv_write_back(c, pwBiasW, nullptr, pixels, D, minVal, maxVal);
+  }
+
+  libjit_aligned_free(dw);
+}
+
+/// Perform an int8 depthwise convolution with the filter layout of
+/// libjit_conv_depthwise_f, and the offsets and requantization of
+/// libjit_convolution_i8.
+void libjit_conv_depthwise_i8(
+    int8_t *outW, const int8_t *inW, const int8_t *filterW,
+    const int32_t *biasW, const size_t *outWdims, const size_t *inWdims,
+    const size_t *filterWdims, const size_t *biasWdims,
+    const size_t *kernelSizes, const size_t *strides, const size_t *pads,
+    int32_t outOffset, int32_t inOffset, int32_t filterOffset,
+    int32_t biasOffset, int32_t biasPre, int32_t biasPost, int32_t biasScale,
+    int32_t outPre, int32_t outPost, int32_t outScale) {
+  ConvDepthwiseI8Args args{
+      outW,      inW,          filterW,    biasW,   outWdims,
+      inWdims,   kernelSizes,  strides,    pads,    outOffset,
+      inOffset,  filterOffset, biasOffset, biasPre, biasPost,
+      biasScale, outPre,       outPost,    outScale};
+  libjit_parallel_for(outWdims[0] * outWdims[1] * outWdims[2],
+                      &libjit_conv_depthwise_pixels_i8, &args);
+}
+
 void libjit_convolution_i8(int8_t *outW, const int8_t *inW,
                            const int8_t *filterW, const int32_t *biasW,
                            const size_t *outWdims, const size_t *inWdims,
@@ -518,6 +1492,48 @@ void libjit_convolution_i8(int8_t *outW, const int8_t *inW,
   }         // N
 }
 
+void libjit_channelwise_quantized_convolution_i8(
+    int8_t *outW, const int8_t *inW, const int8_t *filterW,
+    const int32_t *biasW, const int32_t *filterOffsets, const int32_t *outPre,
+    const int32_t *outPost, const int32_t *outScale, const size_t *outWdims,
+    const size_t *inWdims, const size_t *filterWdims,
+    const size_t *kernelSizes, const size_t *strides, const size_t *pads,
+    size_t group, int32_t outOffset, int32_t inOffset) {
+  size_t outCperG = outWdims[3] / group;
+  size_t blocksPerGroup =
+      (outCperG + cqc_channels_block - 1) / cqc_channels_block;
+  size_t inCperG = inWdims[3] / group;
+  ChannelwiseQuantizedConvI8Args args{
+      outW,     inW,      filterW,  biasW,    filterOffsets,  outPre,
+      outPost,  outScale, outWdims, inWdims,  filterWdims,    kernelSizes,
+      strides,  pads,     inCperG,  outCperG, blocksPerGroup, outOffset,
+      inOffset};
+  libjit_parallel_for(inWdims[0] * group * blocksPerGroup,
+                      &libjit_channelwise_quantized_conv_blocks, &args);
+}
+
+void libjit_convolution_i16(int16_t *outW, const int16_t *inW,
+                            const int8_t *filterW, const int32_t *biasW,
+                            const size_t *outWdims, const size_t *inWdims,
+                            const size_t *filterWdims, const size_t *biasWdims,
+                            const size_t *kernelSizes, const size_t *strides,
+                            const size_t *pads, size_t group, int32_t outOffset,
+                            int32_t inOffset, int32_t filterOffset,
+                            int32_t biasOffset, float biasScale,
+                            float outScale, size_t dilation) {
+  size_t outCperG = outWdims[3] / group;
+  size_t blocksPerGroup =
+      (outCperG + i16_channels_block - 1) / i16_channels_block;
+  size_t inCperG = inWdims[3] / group;
+  ConvolutionI16Args args{
+      outW,       inW,          filterW,        biasW,     outWdims,
+      inWdims,    filterWdims,  kernelSizes,    strides,   pads,
+      inCperG,    outCperG,     blocksPerGroup, dilation,  outOffset,
+      inOffset,   filterOffset, biasOffset,     biasScale, outScale};
+  libjit_parallel_for(inWdims[0] * group * blocksPerGroup,
+                      &libjit_convolution_i16_blocks, &args);
+}
+
 void libjit_convolution_grad_f(float *inG, const float *outG, const float *inW,
                                float *filterG, float *biasG,
                                const float *filterW, const size_t *outGdims,
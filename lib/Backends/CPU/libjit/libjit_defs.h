@@ -17,6 +17,7 @@
 #define GLOW_BACKENDS_CPU_LIBJIT_LIBJIT_DEFS_H
 
 #include <cstdlib>
+#include <math.h>
 #include <stdint.h>
 #include <string.h>
 
@@ -69,6 +70,24 @@ inline void AdduFloat8(float *p, float8 v) {
   StoreuFloat8(p, LoaduFloat8(p) + v);
 }
 
+/// Load 8 consecutive bytes from \p p and convert them to a float8. The
+/// element-wise initialization is lowered to a single widening conversion on
+/// targets that have one (e.g. vpmovzxbd + vcvtdq2ps with AVX2).
+inline float8 LoaduUInt8AsFloat8(const uint8_t *p) {
+  return (float8){(float)p[0], (float)p[1], (float)p[2], (float)p[3],
+                  (float)p[4], (float)p[5], (float)p[6], (float)p[7]};
+}
+
+/// Load 4 consecutive bytes from \p p and convert their 8 nibbles to a float8,
+/// the low nibble of every byte first. The element-wise initialization is
+/// lowered to a widening load, shifts, masks and a shuffle.
+inline float8 LoaduUInt4AsFloat8(const uint8_t *p) {
+  return (float8){(float)(p[0] & 0xf), (float)(p[0] >> 4),
+                  (float)(p[1] & 0xf), (float)(p[1] >> 4),
+                  (float)(p[2] & 0xf), (float)(p[2] >> 4),
+                  (float)(p[3] & 0xf), (float)(p[3] >> 4)};
+}
+
 /// \returns the index of the element at x,y,z,w,q,r.
 inline size_t libjit_getXYZWQR(const size_t *dims, size_t x, size_t y, size_t z,
                                size_t w, size_t q, size_t r) {
@@ -107,6 +126,12 @@ inline int8_t libjit_clip(int32_t val) {
   return (int8_t)MIN(MAX(val, -128), 127);
 }
 
+/// \returns \p val rounded to the nearest integer and clipped to the range of
+/// int16, which holds the int16 activations requantized in float.
+inline int16_t libjit_clip_i16(float val) {
+  return (int16_t)nearbyintf(MIN(MAX(val, -32768.0f), 32767.0f));
+}
+
 /// Scales a 32-bit integer using the integer shift-mult-shift method.
 /// See QuantizationTransform32To8 for more details.
 inline int32_t libjit_scale_i32i8(int32_t input, int32_t pre, int32_t post,
@@ -125,6 +150,124 @@ inline int32_t libjit_scale_i32i8(int32_t input, int32_t pre, int32_t post,
   return ((((input >> pre) * scale) + rtn) >> post) + offset;
 }
 
+/// \returns the float value of the IEEE half precision number \p h.
+inline float libjit_fp16_to_float(uint16_t h) {
+  const uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+  const uint32_t exp = (h >> 10) & 0x1f;
+  const uint32_t mant = h & 0x3ff;
+  if (exp == 0) {
+    // Zero or subnormal, whose value is mant * 2^-24.
+    const float f = mant * (1.0f / (1 << 24));
+    return sign ? -f : f;
+  }
+  uint32_t bits;
+  if (exp == 0x1f) {
+    // Infinity or NaN.
+    bits = sign | 0x7f800000 | (mant << 13);
+  } else {
+    bits = sign | ((exp + 112) << 23) | (mant << 13);
+  }
+  float f;
+  memcpy(&f, &bits, sizeof(f));
+  return f;
+}
+
+/// \returns the IEEE half precision number closest to \p f, rounding ties to
+/// even.
+inline uint16_t libjit_float_to_fp16(float f) {
+  uint32_t bits;
+  memcpy(&bits, &f, sizeof(bits));
+  const uint16_t sign = (bits >> 16) & 0x8000;
+  const uint32_t abs = bits & 0x7fffffff;
+  if (abs >= 0x7f800000) {
+    // Infinity or NaN, which stays a quiet NaN.
+    return sign | 0x7c00 | (abs > 0x7f800000 ? 0x200 : 0);
+  }
+  if (abs >= 0x477ff000) {
+    // At least 65520, which rounds to infinity.
+    return sign | 0x7c00;
+  }
+  if (abs < 0x38800000) {
+    // Below 2^-14, which is a subnormal number of mant * 2^-24.
+    float scaled;
+    memcpy(&scaled, &abs, sizeof(scaled));
+    scaled *= 1 << 24;
+    uint32_t mant = (uint32_t)scaled;
+    float frac = scaled - mant;
+    mant += frac > 0.5f || (frac == 0.5f && (mant & 1));
+    return sign | mant;
+  }
+  // Round the 13 dropped bits of the mantissa, then rebias the exponent.
+  const uint32_t rounded = abs + 0xfff + ((abs >> 13) & 1);
+  return sign | ((rounded - 0x38000000) >> 13);
+}
+
+/// A body of a parallel loop that processes the iterations [\p begin, \p end)
+/// of a kernel's outer loop. \p ctx holds the kernel-specific arguments.
+typedef void (*libjit_parallel_body)(size_t begin, size_t end, void *ctx);
+
+/// A runner that distributes \p numIters iterations of \p body over a set of
+/// worker threads and returns once all of them have been processed.
+typedef void (*libjit_parallel_runner)(size_t numIters,
+                                       libjit_parallel_body body, void *ctx);
+
+/// The runner used by libjit_parallel_for. It is null by default, which makes
+/// all kernels run on the calling thread. The JIT installs a runner backed by
+/// the thread pool of the device that executes the function. The symbol does
+/// not start with "libjit_" so that it is not internalized by LLVMIRGen.
+extern "C" libjit_parallel_runner glow_libjit_parallel_runner;
+
+/// A reader of the hardware performance counters of the calling thread, which
+/// writes LIBJIT_NUM_PERF_COUNTERS values into \p counters.
+typedef void (*libjit_counter_reader)(uint64_t *counters);
+
+/// Number of counters read by a libjit_counter_reader.
+#define LIBJIT_NUM_PERF_COUNTERS 3
+
+/// The reader used by libjit_write_perf_counters. The JIT installs one when
+/// the CPU backend records performance counters, otherwise the counters are
+/// written as zeros.
+extern "C" libjit_counter_reader glow_libjit_counter_reader;
+
+/// A cache of the dequantized hot rows of a fused rowwise-quantized embedding
+/// table, which the FusedRowwiseQuantizedSparseLengthsWeightedSum kernels read
+/// instead of the table. The JIT fills it from the observed lookups, see
+/// glow::RowCache, whose LibjitRowCache must have the same layout.
+struct libjit_row_cache {
+  /// The table, as passed to the kernels.
+  const uint8_t *data;
+  /// For every row of the table, its slot in arena, or -1 if it is not cached.
+  const int32_t *slots;
+  /// The dequantized rows, each rowStride floats apart and 64 bytes aligned.
+  const float *arena;
+  size_t rowStride;
+  /// The number of lookups of every row of the table, which the kernels
+  /// increment.
+  uint32_t *counts;
+};
+
+/// The row caches of the tables of a function.
+struct libjit_row_caches {
+  size_t numCaches;
+  const libjit_row_cache *caches;
+};
+
+/// The row caches used by the SLWS kernels. It is null by default, which makes
+/// the kernels dequantize every row they read.
+extern "C" const libjit_row_caches *glow_libjit_row_caches;
+
+/// Process the iterations [0, \p numIters) of \p body, splitting them across
+/// threads if a parallel runner was installed.
+inline void libjit_parallel_for(size_t numIters, libjit_parallel_body body,
+                                void *ctx) {
+  libjit_parallel_runner runner = glow_libjit_parallel_runner;
+  if (runner && numIters > 1) {
+    runner(numIters, body, ctx);
+    return;
+  }
+  body(0, numIters, ctx);
+}
+
 #ifdef _WIN32
 #define libjit_aligned_malloc(p, a, s)                                         \
   (((*(p)) = _aligned_malloc((s), (a))), *(p) ? 0 : errno)
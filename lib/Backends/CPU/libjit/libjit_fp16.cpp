@@ -0,0 +1,219 @@
+/**
+ * Copyright (c) Glow Contributors. See CONTRIBUTORS file.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Kernels of the operators on Float16Ty tensors. The tensors are stored as
+// IEEE half precision numbers, which halves the memory traffic of the
+// bandwidth bound operators, but all arithmetic is done in float: every
+// element is widened when it is loaded, accumulated in float, and rounded back
+// to half precision once when it is stored.
+
+#include "libjit_defs.h"
+
+namespace {
+
+/// Number of rows of C computed at once by the fp16 matmul, which share the
+/// widened elements of B.
+constexpr size_t fp16RowBlock = 4;
+
+/// Number of columns of C accumulated at once by the fp16 kernels.
+constexpr size_t fp16ColBlock = 64;
+
+/// Arguments of libjit_matmul_f16 passed to the body of its parallel loop.
+struct MatMulF16Args {
+  uint16_t *c;
+  const uint16_t *a;
+  const uint16_t *b;
+  size_t m;
+  size_t n;
+  size_t k;
+};
+
+/// Compute the blocks of fp16RowBlock rows [\p begin, \p end) of the
+/// row-major matrix C described by \p ctx, fp16ColBlock columns at a time
+/// whose partial sums are kept in float.
+void libjit_matmul_f16_rows(size_t begin, size_t end, void *ctx) {
+  const MatMulF16Args *args = (const MatMulF16Args *)ctx;
+  const size_t n = args->n;
+  const size_t k = args->k;
+  float acc[fp16RowBlock][fp16ColBlock];
+  float bRow[fp16ColBlock];
+  for (size_t block = begin; block < end; block++) {
+    size_t i0 = block * fp16RowBlock;
+    size_t rows = MIN(fp16RowBlock, args->m - i0);
+    for (size_t j0 = 0; j0 < n; j0 += fp16ColBlock) {
+      size_t cols = MIN(fp16ColBlock, n - j0);
+      memset(acc, 0, sizeof(acc));
+      for (size_t p = 0; p < k; p++) {
+        const uint16_t *b = args->b + p * n + j0;
+        for (size_t j = 0; j < cols; j++) {
+          bRow[j] = libjit_fp16_to_float(b[j]);
+        }
+        for (size_t i = 0; i < rows; i++) {
+          float a = libjit_fp16_to_float(args->a[(i0 + i) * k + p]);
+          for (size_t j = 0; j < cols; j++) {
+            acc[i][j] += a * bRow[j];
+          }
+        }
+      }
+      for (size_t i = 0; i < rows; i++) {
+        uint16_t *c = args->c + (i0 + i) * n + j0;
+        for (size_t j = 0; j < cols; j++) {
+          c[j] = libjit_float_to_fp16(acc[i][j]);
+        }
+      }
+    }
+  }
+}
+
+/// Arguments of the fp16 SparseLengths(Weighted)Sum passed to the body of its
+/// parallel loop.
+struct SparseLengthsSumF16Args {
+  uint16_t *dest;
+  const uint16_t *data;
+  const uint16_t *weights;
+  const size_t *indices;
+  const int32_t *lengths;
+  size_t lineSize;
+};
+
+/// Compute the output segments [\p begin, \p end) of a fp16
+/// SparseLengths(Weighted)Sum described by \p ctx, accumulating fp16ColBlock
+/// columns of a segment at a time in float.
+void libjit_sparse_lengths_sum_f16_body(size_t begin, size_t end, void *ctx) {
+  const SparseLengthsSumF16Args *args = (const SparseLengthsSumF16Args *)ctx;
+  const size_t lineSize = args->lineSize;
+  // Find the first index used by segment \p begin.
+  size_t firstIndex = 0;
+  for (size_t i = 0; i < begin; i++) {
+    firstIndex += args->lengths[i];
+  }
+  float acc[fp16ColBlock];
+  for (size_t i = begin; i < end; i++) {
+    for (size_t k0 = 0; k0 < lineSize; k0 += fp16ColBlock) {
+      size_t cols = MIN(fp16ColBlock, lineSize - k0);
+      memset(acc, 0, sizeof(acc));
+      for (int32_t j = 0; j < args->lengths[i]; j++) {
+        size_t curIndex = firstIndex + j;
+        float weight = args->weights
+                           ? libjit_fp16_to_float(args->weights[curIndex])
+                           : 1.0f;
+        const uint16_t *line =
+            args->data + args->indices[curIndex] * lineSize + k0;
+        for (size_t k = 0; k < cols; k++) {
+          acc[k] += weight * libjit_fp16_to_float(line[k]);
+        }
+      }
+      uint16_t *dest = args->dest + i * lineSize + k0;
+      for (size_t k = 0; k < cols; k++) {
+        dest[k] = libjit_float_to_fp16(acc[k]);
+      }
+    }
+    firstIndex += args->lengths[i];
+  }
+}
+
+} // namespace
+
+extern "C" {
+
+/// Macro to define a mini-kernel for data-parallel operations on fp16
+/// tensors, whose \p body computes a float from the widened operands \p L and
+/// \p R.
+#define DEFINE_DATA_PARALLEL_KERNEL_F16(name, body)                            \
+  uint16_t name(size_t idx, const uint16_t *LHS, const uint16_t *RHS,          \
+                const uint16_t *op3) {                                         \
+    float L = libjit_fp16_to_float(LHS[idx]);                                  \
+    float R = libjit_fp16_to_float(RHS[idx]);                                  \
+    return libjit_float_to_fp16(body);                                         \
+  }
+
+DEFINE_DATA_PARALLEL_KERNEL_F16(libjit_element_add_kernel_f16, L + R)
+DEFINE_DATA_PARALLEL_KERNEL_F16(libjit_element_sub_kernel_f16, L - R)
+DEFINE_DATA_PARALLEL_KERNEL_F16(libjit_element_mul_kernel_f16, L * R)
+DEFINE_DATA_PARALLEL_KERNEL_F16(libjit_element_div_kernel_f16, L / R)
+DEFINE_DATA_PARALLEL_KERNEL_F16(libjit_elementmax_kernel_f16, MAX(L, R))
+DEFINE_DATA_PARALLEL_KERNEL_F16(libjit_elementmin_kernel_f16, MIN(L, R))
+
+#undef DEFINE_DATA_PARALLEL_KERNEL_F16
+
+uint16_t libjit_copy_kernel_f16(size_t idx, const uint16_t *LHS,
+                                const uint16_t *RHS, const uint16_t *op3) {
+  return LHS[idx];
+}
+
+uint16_t libjit_splat_kernel_f16(size_t idx, uint16_t val, const uint16_t *LHS,
+                                 const uint16_t *RHS) {
+  return val;
+}
+
+/// Performs the matrix multiplication c = a * b of row-major fp16 matrices,
+/// accumulating in float.
+/// \p c is a m x n matrix, so \p cDims = {m, n}
+/// \p a is a m x k matrix, so \p aDims = {m, k}
+/// \p b is a k x n matrix, so \p bDims = {k, n}
+void libjit_matmul_f16(uint16_t *c, const uint16_t *a, const uint16_t *b,
+                       const size_t *cDims, const size_t *aDims,
+                       const size_t *bDims) {
+  MatMulF16Args args{c, a, b, cDims[0], cDims[1], aDims[1]};
+  size_t blocks = (cDims[0] + fp16RowBlock - 1) / fp16RowBlock;
+  libjit_parallel_for(blocks, &libjit_matmul_f16_rows, &args);
+}
+
+void libjit_batchedadd_f16(uint16_t *dest, const uint16_t *batch,
+                           const uint16_t *slice, size_t numSlice,
+                           size_t sliceSize) {
+  // For each layer in the batch:
+  for (size_t n = 0; n < numSlice; n++) {
+    size_t base = n * sliceSize;
+    // For each element in the slice.
+    for (size_t i = 0; i < sliceSize; i++) {
+      float sum = libjit_fp16_to_float(batch[base + i]) +
+                  libjit_fp16_to_float(slice[i]);
+      dest[base + i] = libjit_float_to_fp16(sum);
+    }
+  }
+}
+
+void libjit_sparse_lengths_sum_f16(uint16_t *dest, uint16_t *data,
+                                   size_t *indices, int32_t *lengths,
+                                   size_t segments, size_t lineSize) {
+  SparseLengthsSumF16Args args{dest,    data,    nullptr,
+                               indices, lengths, lineSize};
+  libjit_parallel_for(segments, &libjit_sparse_lengths_sum_f16_body, &args);
+}
+
+void libjit_sparse_lengths_weighted_sum_f16(uint16_t *dest, uint16_t *data,
+                                            uint16_t *weights, size_t *indices,
+                                            int32_t *lengths, size_t segments,
+                                            size_t lineSize) {
+  SparseLengthsSumF16Args args{dest,    data,    weights,
+                               indices, lengths, lineSize};
+  libjit_parallel_for(segments, &libjit_sparse_lengths_sum_f16_body, &args);
+}
+
+void libjit_convert_f_to_f16(uint16_t *dest, const float *src, size_t size) {
+  for (size_t i = 0; i < size; i++) {
+    dest[i] = libjit_float_to_fp16(src[i]);
+  }
+}
+
+void libjit_convert_f16_to_f(float *dest, const uint16_t *src, size_t size) {
+  for (size_t i = 0; i < size; i++) {
+    dest[i] = libjit_fp16_to_float(src[i]);
+  }
+}
+
+} // extern "C"
@@ -15,6 +15,15 @@
  */
 #include "libjit_defs.h"
 
+extern "C" {
+/// Blocking parameters {mc, kc, nc} of the outer kernel.  We multiply mc x kc
+/// blocks of A with kc x nc panels of B (this approach is referred to as
+/// `gebp` in the literature).  The defaults fit the caches of recent Intel
+/// desktop processors; the CPU backend turns them into constants of the
+/// module it JITs, chosen for the cache sizes of the host.
+size_t libjit_matmul_blocking[3] = {256, 128, 4096};
+}
+
 namespace {
 
 /// Macros for accessing submatrices of a matmul using the leading dimension.
@@ -37,8 +46,15 @@ void libjit_matmul_odd(int m, int n, int k, const float *a, int lda,
 
 /// Number of registers to use for rows of A in the dot-product kernel.
 constexpr int regsA = 4;
-/// Number of registers to use for columns of B in the dot-product kernel.
-constexpr int regsB = 3;
+/// Number of registers to use for columns of B in the dot-product kernel. The
+/// accumulators, the rows of A and a column of B fit in the 16 vector
+/// registers of AVX2; the libjit variants for other register files set
+/// LIBJIT_MATMUL_REGS_B, to use more columns with the 32 registers of AVX-512
+/// and fewer with the 32 128-bit registers of NEON.
+#ifndef LIBJIT_MATMUL_REGS_B
+#define LIBJIT_MATMUL_REGS_B 3
+#endif
+constexpr int regsB = LIBJIT_MATMUL_REGS_B;
 
 /// Number of rows of A to process in the kernel.  Vector loads are used for A,
 /// so we load eight times as many floats as we use registers.
@@ -46,13 +62,6 @@ constexpr int mr = regsA * 8;
 /// Number of columns of B to process in the kernel.
 constexpr int nr = regsB;
 
-/// Blocking parameters for the outer kernel.  We multiply mc x kc blocks of A
-/// with kc x nc panels of B (this approach is referred to as `gebp` in the
-/// literature).  TODO: Generalize these parameters for other cache sizes.
-constexpr int mc = 256;
-constexpr int kc = 128;
-constexpr int nc = 4096;
-
 /// Only pack matrices if dimension is above this threshold.  Packing is
 /// primarily helpful for avoiding TLB pressure and cache set conflicts, so this
 /// can be fairly large.
@@ -214,8 +223,8 @@ void libjit_matmul_inner(int m, int n, int k, const float *a, int lda,
 }
 
 /// Tile A into mc * kc blocks, where mc and kc are chosen to approximately fit
-/// the L2 cache on recent Intel processors (e.g., 256 KB for Skylake).  Stream
-/// kc * n panels of B through memory to compute each mc * n block of C.
+/// the L2 cache, see libjit_matmul_blocking.  Stream kc * n panels of B
+/// through memory to compute each mc * n block of C.
 /// \p a is an \p m x \p k column-major matrix;
 /// \p b is a \p k x \p n column-major matrix;
 /// \p c is a \p m x \p n column-major matrix.
@@ -225,9 +234,12 @@ template <bool pack>
 void __attribute__((noinline))
 libjit_matmul_outer(size_t m, size_t n, size_t k, const float *a, size_t lda,
                     const float *b, size_t ldb, float *c, size_t ldc) {
+  const size_t mc = libjit_matmul_blocking[0];
+  const size_t kc = libjit_matmul_blocking[1];
+  const size_t nc = libjit_matmul_blocking[2];
   float *packedB = nullptr;
   if (pack) {
-    libjit_aligned_malloc((void **)&packedB, 64, kc * nc);
+    libjit_aligned_malloc((void **)&packedB, 64, kc * nc * sizeof(float));
   }
 
   for (size_t p = 0; p < k; p += kc) {
@@ -250,10 +262,471 @@ libjit_matmul_outer(size_t m, size_t n, size_t k, const float *a, size_t lda,
   }
 }
 
+/// Compute the \p m x \p n column-major matrix C from \p k columns of the
+/// \p numPanels packed panels of A at \p panels. Each panel is a column-major
+/// mr x \p panelDepth matrix, the panels are stored one after the other and
+/// the last one is zero padded, so the dot-product kernel always reads A
+/// sequentially.
+void libjit_matmul_panels(size_t numPanels, size_t m, size_t n, size_t k,
+                          const float *panels, size_t panelDepth,
+                          const float *b, size_t ldb, float *c, size_t ldc) {
+  size_t j = (n / nr) * nr;
+  for (size_t q = 0; q < numPanels; q++) {
+    const float *a = panels + q * panelDepth * mr;
+    size_t i = q * mr;
+    size_t ib = MIN(m - i, (size_t)mr);
+    if (ib == (size_t)mr) {
+      for (size_t jj = 0; jj < j; jj += nr) {
+        libjit_matmul_dot<regsA, regsB>(k, a, mr, &B(0, jj), ldb, &C(i, jj),
+                                        ldc);
+      }
+      if (j < n) {
+        libjit_matmul_odd(mr, n - j, k, a, mr, &B(0, j), ldb, &C(i, j), ldc);
+      }
+    } else {
+      libjit_matmul_odd(ib, n, k, a, mr, &B(0, 0), ldb, &C(i, 0), ldc);
+    }
+  }
+}
+
 #undef C
 #undef B
 #undef A
 
+/// Only split a matmul across threads if it performs at least this many
+/// multiply-accumulates; smaller ones are dominated by the dispatch overhead.
+constexpr size_t parallel_threshold = 1 << 20;
+
+/// Arguments of libjit_matmul_f passed to the body of its parallel loop.
+struct MatMulArgs {
+  float *c;
+  const float *a;
+  const float *b;
+  const size_t *cDims;
+  const size_t *aDims;
+  const size_t *bDims;
+};
+
+/// Compute the rows [\p begin, \p end) of the row-major matrix C described by
+/// \p ctx. Rows of C only depend on the same rows of A, so different ranges
+/// may be computed concurrently.
+void libjit_matmul_rows(size_t begin, size_t end, void *ctx) {
+  const MatMulArgs *args = (const MatMulArgs *)ctx;
+  const size_t *cDims = args->cDims;
+  const size_t *aDims = args->aDims;
+  const size_t *bDims = args->bDims;
+  size_t m = cDims[1];
+  size_t n = end - begin;
+  size_t k = aDims[1];
+  const float *a = args->a + begin * aDims[1];
+  float *c = args->c + begin * cDims[1];
+  bool pack = m >= (size_t)pack_threshold;
+  if (pack) {
+    libjit_matmul_outer<true>(m, n, k, args->b, bDims[1], a, aDims[1], c,
+                              cDims[1]);
+  } else {
+    libjit_matmul_outer<false>(m, n, k, args->b, bDims[1], a, aDims[1], c,
+                               cDims[1]);
+  }
+}
+
+/// Arguments of libjit_matmul_packed_f passed to the body of its parallel
+/// loop.
+struct MatMulPackedArgs {
+  float *c;
+  const float *a;
+  const float *packedB;
+  size_t n;
+  size_t k;
+  size_t numPanels;
+};
+
+/// Compute the rows [\p begin, \p end) of the row-major matrix C described by
+/// \p ctx, where B has been packed ahead of time. As in libjit_matmul_rows the
+/// kernel computes C^T += B^T * A^T, with the panels of B as the column-major
+/// left-hand side. A is tiled into mc x kc blocks so that they stay in the L2
+/// cache while all panels of B are streamed through it.
+void libjit_matmul_packed_rows(size_t begin, size_t end, void *ctx) {
+  const MatMulPackedArgs *args = (const MatMulPackedArgs *)ctx;
+  const size_t n = args->n;
+  const size_t k = args->k;
+  const size_t mc = libjit_matmul_blocking[0];
+  const size_t kc = libjit_matmul_blocking[1];
+  for (size_t p = 0; p < k; p += kc) {
+    size_t pb = MIN(k - p, kc);
+    for (size_t i = begin; i < end; i += mc) {
+      size_t ib = MIN(end - i, mc);
+      libjit_matmul_panels(args->numPanels, n, ib, pb, args->packedB + p * mr,
+                           k, args->a + i * k + p, k, args->c + i * n, n);
+    }
+  }
+}
+
+/// Arguments of libjit_block_sparse_matmul_f passed to the body of its
+/// parallel loop.
+struct BlockSparseMatMulArgs {
+  float *c;
+  const float *a;
+  const float *values;
+  const int32_t *indices;
+  const int32_t *offsets;
+  size_t n;
+  size_t k;
+  size_t blockSize;
+};
+
+/// Compute the rows [\p begin, \p end) of the row-major matrix C described by
+/// \p ctx, where B is stored as block-sparse columns. Only the non-zero blocks
+/// of B are visited: each one scales its rows by the matching elements of A and
+/// accumulates them into a contiguous run of C, which LLVM vectorizes.
+void libjit_block_sparse_matmul_rows(size_t begin, size_t end, void *ctx) {
+  const BlockSparseMatMulArgs *args = (const BlockSparseMatMulArgs *)ctx;
+  const size_t bs = args->blockSize;
+  const size_t numBlockCols = args->n / bs;
+  for (size_t i = begin; i < end; i++) {
+    const float *aRow = args->a + i * args->k;
+    float *cRow = args->c + i * args->n;
+    for (size_t j = 0; j < numBlockCols; j++) {
+      float *cBlock = cRow + j * bs;
+      for (int32_t e = args->offsets[j], ee = args->offsets[j + 1];
+           e < ee; e++) {
+        const float *block = args->values + e * bs * bs;
+        const float *aBlock = aRow + args->indices[e] * bs;
+        for (size_t p = 0; p < bs; p++) {
+          float ap = aBlock[p];
+          for (size_t q = 0; q < bs; q++) {
+            cBlock[q] += ap * block[p * bs + q];
+          }
+        }
+      }
+    }
+  }
+}
+
+/// Arguments of libjit_batch_matmul_f passed to the body of its parallel
+/// loop.
+struct BatchMatMulArgs {
+  float *c;
+  const float *a;
+  const float *b;
+  /// The rows of each batch of A and C.
+  size_t m;
+  size_t n;
+  size_t k;
+  /// The distance between the batches of B, 0 if B is broadcast.
+  size_t bBatchStride;
+};
+
+/// Compute the rows [\p begin, \p end) of the batches of row-major matrices C
+/// described by \p ctx, where the rows of all the batches are numbered one
+/// after the other. Each run of rows of the same batch is computed like in
+/// libjit_matmul_rows. When B is broadcast all the rows are multiplied by the
+/// same matrix, so the whole range is a single multiplication, which reuses
+/// the packed blocks of B across the batches.
+void libjit_batch_matmul_rows(size_t begin, size_t end, void *ctx) {
+  const BatchMatMulArgs *args = (const BatchMatMulArgs *)ctx;
+  const size_t m = args->m;
+  const size_t n = args->n;
+  const size_t k = args->k;
+  bool pack = n >= (size_t)pack_threshold;
+  for (size_t i = begin; i < end;) {
+    size_t batch = i / m;
+    size_t rows = args->bBatchStride ? MIN(end - i, (batch + 1) * m - i)
+                                     : end - i;
+    const float *a = args->a + i * k;
+    const float *b = args->b + batch * args->bBatchStride;
+    float *c = args->c + i * n;
+    if (pack) {
+      libjit_matmul_outer<true>(n, rows, k, b, n, a, k, c, n);
+    } else {
+      libjit_matmul_outer<false>(n, rows, k, b, n, a, k, c, n);
+    }
+    i += rows;
+  }
+}
+
+/// Number of rows of A processed together by the int8 dot-product kernel.
+constexpr size_t i8RowsBlock = 2;
+/// Number of rows of the transposed B processed together by the int8
+/// dot-product kernel.
+constexpr size_t i8ColsBlock = 4;
+
+/// Compute the \p rows x \p cols int32 dot products of the rows of \p a with
+/// the rows of \p bt, all of which have \p k contiguous int8 elements, and
+/// store them to \p out, whose leading dimension is \p ldo. The innermost loop
+/// is a set of widening multiply-add reductions, which LLVM vectorizes into
+/// pmaddwd (or vpdpwssd on targets with VNNI).
+template <size_t rows, size_t cols>
+void libjit_dot_i8(size_t k, const int8_t *a, size_t lda, const int8_t *bt,
+                   size_t ldb, int32_t *out, size_t ldo) {
+  int32_t acc[rows][cols] = {{0}};
+  for (size_t p = 0; p < k; p++) {
+    for (size_t r = 0; r < rows; r++) {
+      int32_t av = a[r * lda + p];
+      for (size_t c = 0; c < cols; c++) {
+        acc[r][c] += av * (int32_t)bt[c * ldb + p];
+      }
+    }
+  }
+  for (size_t r = 0; r < rows; r++) {
+    for (size_t c = 0; c < cols; c++) {
+      out[r * ldo + c] = acc[r][c];
+    }
+  }
+}
+
+/// Compute the raw int32 dot products of \p numRows rows of \p a, at most
+/// i8RowsBlock, with the \p n rows of \p bt, and store them to the
+/// \p numRows x \p n row-major matrix \p out. All rows have \p k elements.
+void libjit_gemm_i8_rows(size_t numRows, size_t n, size_t k, const int8_t *a,
+                         size_t lda, const int8_t *bt, size_t ldb,
+                         int32_t *out) {
+  size_t j = 0;
+  if (numRows == i8RowsBlock) {
+    for (; j + i8ColsBlock <= n; j += i8ColsBlock) {
+      libjit_dot_i8<i8RowsBlock, i8ColsBlock>(k, a, lda, bt + j * ldb, ldb,
+                                              out + j, n);
+    }
+  }
+  for (size_t r = 0; r < numRows; r++) {
+    size_t jj = j;
+    for (; jj + i8ColsBlock <= n; jj += i8ColsBlock) {
+      libjit_dot_i8<1, i8ColsBlock>(k, a + r * lda, lda, bt + jj * ldb, ldb,
+                                    out + r * n + jj, n);
+    }
+    for (; jj < n; jj++) {
+      libjit_dot_i8<1, 1>(k, a + r * lda, lda, bt + jj * ldb, ldb,
+                          out + r * n + jj, n);
+    }
+  }
+}
+
+/// \returns the sum of the \p k elements of \p a.
+int32_t libjit_sum_i8(size_t k, const int8_t *a) {
+  int32_t sum = 0;
+  for (size_t p = 0; p < k; p++) {
+    sum += a[p];
+  }
+  return sum;
+}
+
+/// Arguments of libjit_matmul_i8 passed to the body of its parallel loop.
+/// \p bt is the transposed B and \p btSums holds the sums of its rows.
+struct MatMulI8Args {
+  int8_t *out;
+  const int8_t *a;
+  const int8_t *bt;
+  const int32_t *btSums;
+  size_t m;
+  size_t n;
+  size_t k;
+  int32_t outOffset;
+  int32_t aOffset;
+  int32_t bOffset;
+  int32_t outPre;
+  int32_t outPost;
+  int32_t outScale;
+};
+
+/// Compute the blocks of i8RowsBlock rows [\p begin, \p end) of the
+/// quantized MatMul described by \p ctx. The offsets are applied after the
+/// raw dot products, using
+///   sum((a - aOff) * (b - bOff)) =
+///       sum(a * b) - bOff * sum(a) - aOff * sum(b) + k * aOff * bOff.
+void libjit_matmul_i8_rows(size_t begin, size_t end, void *ctx) {
+  const MatMulI8Args *args = (const MatMulI8Args *)ctx;
+  const size_t n = args->n;
+  const size_t k = args->k;
+  int32_t dots[i8RowsBlock * n];
+  for (size_t block = begin; block < end; block++) {
+    size_t i = block * i8RowsBlock;
+    size_t numRows = MIN(args->m - i, i8RowsBlock);
+    libjit_gemm_i8_rows(numRows, n, k, args->a + i * k, k, args->bt, k, dots);
+    for (size_t r = 0; r < numRows; r++) {
+      int32_t aSum = libjit_sum_i8(k, args->a + (i + r) * k);
+      int32_t rowTerm =
+          int32_t(k) * args->aOffset * args->bOffset - args->bOffset * aSum;
+      int8_t *out = args->out + (i + r) * n;
+      for (size_t j = 0; j < n; j++) {
+        int32_t sum =
+            dots[r * n + j] + rowTerm - args->aOffset * args->btSums[j];
+        out[j] = libjit_clip(libjit_scale_i32i8(
+            sum, args->outPre, args->outPost, args->outScale, args->outOffset));
+      }
+    }
+  }
+}
+
+/// Arguments of libjit_rowwise_quantized_fc_i8 passed to the body of its
+/// parallel loop. \p weightsSums holds the sums of the rows of the weights.
+struct RowwiseQuantizedFCI8Args {
+  int8_t *out;
+  const int8_t *in;
+  const int8_t *weights;
+  const int32_t *weightsSums;
+  const int32_t *bias;
+  const int32_t *weightsOffsets;
+  const int32_t *biasPre;
+  const int32_t *biasPost;
+  const int32_t *biasScale;
+  const int32_t *outPre;
+  const int32_t *outPost;
+  const int32_t *outScale;
+  size_t m;
+  size_t n;
+  size_t k;
+  int32_t outOffset;
+  int32_t inOffset;
+  int32_t biasOffset;
+};
+
+/// Compute the blocks of i8RowsBlock rows [\p begin, \p end) of the rowwise
+/// quantized FC described by \p ctx, applying the offsets as in
+/// libjit_matmul_i8_rows.
+void libjit_rowwise_quantized_fc_i8_rows(size_t begin, size_t end, void *ctx) {
+  const RowwiseQuantizedFCI8Args *args = (const RowwiseQuantizedFCI8Args *)ctx;
+  const size_t n = args->n;
+  const size_t k = args->k;
+  const int32_t inOffset = args->inOffset;
+  int32_t dots[i8RowsBlock * n];
+  for (size_t block = begin; block < end; block++) {
+    size_t i = block * i8RowsBlock;
+    size_t numRows = MIN(args->m - i, i8RowsBlock);
+    libjit_gemm_i8_rows(numRows, n, k, args->in + i * k, k, args->weights, k,
+                        dots);
+    for (size_t r = 0; r < numRows; r++) {
+      int32_t inSum = libjit_sum_i8(k, args->in + (i + r) * k);
+      int8_t *out = args->out + (i + r) * n;
+      for (size_t j = 0; j < n; j++) {
+        int32_t wOffset = args->weightsOffsets[j];
+        int32_t sum = dots[r * n + j] - wOffset * inSum -
+                      inOffset * args->weightsSums[j] +
+                      int32_t(k) * wOffset * inOffset;
+        sum += libjit_scale_i32i8(args->bias[j] - args->biasOffset,
+                                  args->biasPre[j], args->biasPost[j],
+                                  args->biasScale[j], 0);
+        out[j] = libjit_clip(libjit_scale_i32i8(sum, args->outPre[j],
+                                                args->outPost[j],
+                                                args->outScale[j],
+                                                args->outOffset));
+      }
+    }
+  }
+}
+
+/// Arguments of libjit_dynamic_quantized_fc_f passed to the body of its
+/// parallel loop. \p in holds the input quantized with \p inOffset, and
+/// \p weightsSums the sums of the rows of the weights.
+struct DynamicQuantizedFCArgs {
+  float *out;
+  const int8_t *in;
+  const int8_t *weights;
+  const int32_t *weightsSums;
+  const float *bias;
+  size_t m;
+  size_t n;
+  size_t k;
+  int32_t inOffset;
+  int32_t weightsOffset;
+  float matMulScale;
+};
+
+/// Compute the blocks of i8RowsBlock rows [\p begin, \p end) of the
+/// dynamically quantized FC described by \p ctx, applying the offsets as in
+/// libjit_matmul_i8_rows and dequantizing the sums.
+void libjit_dynamic_quantized_fc_f_rows(size_t begin, size_t end, void *ctx) {
+  const DynamicQuantizedFCArgs *args = (const DynamicQuantizedFCArgs *)ctx;
+  const size_t n = args->n;
+  const size_t k = args->k;
+  const int32_t inOffset = args->inOffset;
+  const int32_t wOffset = args->weightsOffset;
+  int32_t dots[i8RowsBlock * n];
+  for (size_t block = begin; block < end; block++) {
+    size_t i = block * i8RowsBlock;
+    size_t numRows = MIN(args->m - i, i8RowsBlock);
+    libjit_gemm_i8_rows(numRows, n, k, args->in + i * k, k, args->weights, k,
+                        dots);
+    for (size_t r = 0; r < numRows; r++) {
+      int32_t inSum = libjit_sum_i8(k, args->in + (i + r) * k);
+      int32_t rowTerm = int32_t(k) * wOffset * inOffset - wOffset * inSum;
+      float *out = args->out + (i + r) * n;
+      for (size_t j = 0; j < n; j++) {
+        int32_t sum =
+            dots[r * n + j] + rowTerm - inOffset * args->weightsSums[j];
+        out[j] = float(sum) * args->matMulScale + args->bias[j];
+      }
+    }
+  }
+}
+
+/// Choose the asymmetric int8 scale \p scale and offset \p offset of the
+/// range [\p min, \p max], as quantization::chooseQuantizationParams does.
+void libjit_choose_quantization_params_i8(float min, float max, float *scale,
+                                          int32_t *offset) {
+  min = MIN(min, 0.f);
+  max = MAX(max, 0.f);
+  double s = ((double)max - min) / 255.0;
+  if (s == 0) {
+    s = 0.1;
+  }
+  double zeroPointFromMin = -128.0 - min / s;
+  double zeroPointFromMax = 127.0 - max / s;
+  double zeroPoint = 128.0 + fabs(min / s) < 127.0 + fabs(max / s)
+                         ? zeroPointFromMin
+                         : zeroPointFromMax;
+  if (fabsf(max + min) <= 1.19209290e-7f) {
+    zeroPoint = 0;
+  }
+  *offset = zeroPoint < -128.0
+                ? -128
+                : zeroPoint > 127.0 ? 127 : (int32_t)round(zeroPoint);
+  *scale = (float)s;
+}
+
+/// Arguments of libjit_matmul_i16 passed to the body of its parallel loop.
+/// \p bt is the transposed int8 B and \p btSums holds the sums of its rows.
+struct MatMulI16Args {
+  int16_t *out;
+  const int16_t *a;
+  const int8_t *bt;
+  const int32_t *btSums;
+  size_t m;
+  size_t n;
+  size_t k;
+  int32_t outOffset;
+  int32_t aOffset;
+  int32_t bOffset;
+  float outScale;
+};
+
+/// Compute the rows [\p begin, \p end) of the MatMul of int16 activations and
+/// int8 weights described by \p ctx. The offsets are applied as in
+/// libjit_matmul_i8_rows, to 64-bit sums, which are requantized in float.
+void libjit_matmul_i16_rows(size_t begin, size_t end, void *ctx) {
+  const MatMulI16Args *args = (const MatMulI16Args *)ctx;
+  const size_t n = args->n;
+  const size_t k = args->k;
+  for (size_t i = begin; i < end; i++) {
+    const int16_t *a = args->a + i * k;
+    int64_t aSum = 0;
+    for (size_t p = 0; p < k; p++) {
+      aSum += a[p];
+    }
+    int64_t rowTerm =
+        int64_t(k) * args->aOffset * args->bOffset - args->bOffset * aSum;
+    int16_t *out = args->out + i * n;
+    for (size_t j = 0; j < n; j++) {
+      const int8_t *b = args->bt + j * k;
+      int64_t dot = 0;
+      for (size_t p = 0; p < k; p++) {
+        dot += int32_t(a[p]) * b[p];
+      }
+      int64_t sum = dot + rowTerm - int64_t(args->aOffset) * args->btSums[j];
+      out[j] = libjit_clip_i16((float)sum * args->outScale + args->outOffset);
+    }
+  }
+}
+
 } // namespace
 
 extern "C" {
@@ -278,14 +751,75 @@ void libjit_matmul_f(float *c, const float *a, const float *b,
   //
   // The matrix multiplication routine is heavily inspired by:
   // https://github.com/flame/how-to-optimize-gemm
-  int m = cDims[1];
-  int n = cDims[0];
-  int k = aDims[1];
-  bool pack = m >= pack_threshold;
-  if (pack) {
-    libjit_matmul_outer<true>(m, n, k, b, bDims[1], a, aDims[1], c, cDims[1]);
+  //
+  // The rows of the row-major C (columns of the column-major one) are
+  // independent, so large multiplications are split along them across the
+  // threads made available by the runtime.
+  MatMulArgs args{c, a, b, cDims, aDims, bDims};
+  size_t rows = cDims[0];
+  if (rows * cDims[1] * aDims[1] >= parallel_threshold) {
+    libjit_parallel_for(rows, &libjit_matmul_rows, &args);
+  } else {
+    libjit_matmul_rows(0, rows, &args);
+  }
+}
+
+/// Performs the matrix multiplication c = a * b like libjit_matmul_f, where
+/// b has been packed at compile time into \p packedB, of the shape
+/// {ceil(n / mr), k, mr}. \p packedBDims[2] must be equal to mr.
+void libjit_matmul_packed_f(float *c, const float *a, const float *packedB,
+                            const size_t *cDims, const size_t *aDims,
+                            const size_t *packedBDims) {
+  memset(c, 0, cDims[0] * cDims[1] * sizeof(float));
+  MatMulPackedArgs args{c, a, packedB, cDims[1], aDims[1], packedBDims[0]};
+  size_t rows = cDims[0];
+  if (rows * cDims[1] * aDims[1] >= parallel_threshold) {
+    libjit_parallel_for(rows, &libjit_matmul_packed_rows, &args);
+  } else {
+    libjit_matmul_packed_rows(0, rows, &args);
+  }
+}
+
+/// Performs the matrix multiplication c = a * b like libjit_matmul_f, where
+/// the k x n matrix b is stored as block-sparse columns (the block-CSR form of
+/// its transpose) with square blocks of \p valuesDims[1] elements on a side.
+/// The non-zero blocks of the j-th column of blocks of b are the blocks
+/// [offsets[j], offsets[j + 1]) of \p values, each row-major, and \p indices
+/// holds the row of blocks of b each of them is at.
+void libjit_block_sparse_matmul_f(float *c, const float *a,
+                                  const float *values, const int32_t *indices,
+                                  const int32_t *offsets, const size_t *cDims,
+                                  const size_t *aDims,
+                                  const size_t *valuesDims) {
+  memset(c, 0, cDims[0] * cDims[1] * sizeof(float));
+  BlockSparseMatMulArgs args{c,       a,        values,   indices,
+                             offsets, cDims[1], aDims[1], valuesDims[1]};
+  size_t rows = cDims[0];
+  size_t blockSize = valuesDims[1];
+  if (rows * valuesDims[0] * blockSize * blockSize >= parallel_threshold) {
+    libjit_parallel_for(rows, &libjit_block_sparse_matmul_rows, &args);
+  } else {
+    libjit_block_sparse_matmul_rows(0, rows, &args);
+  }
+}
+
+/// Performs the batched matrix multiplication c[i] = a[i] * b[i] of row-major
+/// matrices, where \p cDims = {batches, m, n}, \p aDims = {batches, m, k}
+/// and \p bDims = {batches, k, n}, or {1, k, n} if the same b multiplies all
+/// the batches. The multiplications run in a single call, split across the
+/// threads along the rows of all the batches, so that many small batches
+/// still keep all the threads busy.
+void libjit_batch_matmul_f(float *c, const float *a, const float *b,
+                           const size_t *cDims, const size_t *aDims,
+                           const size_t *bDims) {
+  size_t rows = cDims[0] * cDims[1];
+  memset(c, 0, rows * cDims[2] * sizeof(float));
+  size_t bBatchStride = bDims[0] == 1 ? 0 : bDims[1] * bDims[2];
+  BatchMatMulArgs args{c, a, b, cDims[1], cDims[2], aDims[2], bBatchStride};
+  if (rows * cDims[2] * aDims[2] >= parallel_threshold) {
+    libjit_parallel_for(rows, &libjit_batch_matmul_rows, &args);
   } else {
-    libjit_matmul_outer<false>(m, n, k, b, bDims[1], a, aDims[1], c, cDims[1]);
+    libjit_batch_matmul_rows(0, rows, &args);
   }
 }
 
@@ -294,18 +828,71 @@ void libjit_matmul_i8(int8_t *outW, const int8_t *lhsW, const int8_t *rhsW,
                       const size_t *rhsWdims, int32_t outOffset,
                       int32_t lhsOffset, int32_t rhsOffset, int32_t outPre,
                       int32_t outPost, int32_t outScale) {
-  for (size_t x = 0; x < outWdims[0]; x++) {
-    for (size_t y = 0; y < outWdims[1]; y++) {
-      int32_t sum = 0;
-      for (size_t i = 0; i < lhsWdims[1]; i++) {
-        int32_t lhs = lhsW[libjit_getXY(lhsWdims, x, i)] - lhsOffset;
-        int32_t rhs = rhsW[libjit_getXY(rhsWdims, i, y)] - rhsOffset;
-        sum += lhs * rhs;
-      }
-      int32_t s = libjit_scale_i32i8(sum, outPre, outPost, outScale, outOffset);
-      outW[libjit_getXY(outWdims, x, y)] = libjit_clip(s);
+  size_t m = outWdims[0];
+  size_t n = outWdims[1];
+  size_t k = lhsWdims[1];
+  // Transpose B, so that the dot-product kernel reads both operands
+  // sequentially, and compute the sums used to apply the offset of A.
+  int8_t *bt = nullptr;
+  libjit_aligned_malloc((void **)&bt, 64, n * k);
+  int32_t *btSums = nullptr;
+  libjit_aligned_malloc((void **)&btSums, 64, n * sizeof(int32_t));
+  for (size_t j = 0; j < n; j++) {
+    int32_t sum = 0;
+    for (size_t p = 0; p < k; p++) {
+      int8_t b = rhsW[libjit_getXY(rhsWdims, p, j)];
+      bt[j * k + p] = b;
+      sum += b;
     }
+    btSums[j] = sum;
+  }
+
+  MatMulI8Args args{outW,      lhsW,   bt,      btSums,  m,
+                    n,         k,      outOffset, lhsOffset,
+                    rhsOffset, outPre, outPost, outScale};
+  size_t numBlocks = (m + i8RowsBlock - 1) / i8RowsBlock;
+  if (m * n * k >= parallel_threshold) {
+    libjit_parallel_for(numBlocks, &libjit_matmul_i8_rows, &args);
+  } else {
+    libjit_matmul_i8_rows(0, numBlocks, &args);
   }
+
+  libjit_aligned_free(btSums);
+  libjit_aligned_free(bt);
+}
+
+void libjit_matmul_i16(int16_t *outW, const int16_t *lhsW, const int8_t *rhsW,
+                       const size_t *outWdims, const size_t *lhsWdims,
+                       const size_t *rhsWdims, int32_t outOffset,
+                       int32_t lhsOffset, int32_t rhsOffset, float outScale) {
+  size_t m = outWdims[0];
+  size_t n = outWdims[1];
+  size_t k = lhsWdims[1];
+  // Transpose B and compute the sums of its rows, as libjit_matmul_i8.
+  int8_t *bt = nullptr;
+  libjit_aligned_malloc((void **)&bt, 64, n * k);
+  int32_t *btSums = nullptr;
+  libjit_aligned_malloc((void **)&btSums, 64, n * sizeof(int32_t));
+  for (size_t j = 0; j < n; j++) {
+    int32_t sum = 0;
+    for (size_t p = 0; p < k; p++) {
+      int8_t b = rhsW[libjit_getXY(rhsWdims, p, j)];
+      bt[j * k + p] = b;
+      sum += b;
+    }
+    btSums[j] = sum;
+  }
+
+  MatMulI16Args args{outW,      lhsW,      bt,        btSums,  m, n, k,
+                     outOffset, lhsOffset, rhsOffset, outScale};
+  if (m * n * k >= parallel_threshold) {
+    libjit_parallel_for(m, &libjit_matmul_i16_rows, &args);
+  } else {
+    libjit_matmul_i16_rows(0, m, &args);
+  }
+
+  libjit_aligned_free(btSums);
+  libjit_aligned_free(bt);
 }
 
 void libjit_rowwise_quantized_fc_i8(
@@ -322,21 +909,71 @@ void libjit_rowwise_quantized_fc_i8(
   // In rowwise quantized FC, weights is not pretransposed : I * Tranpose(W) +
   // B. out(i, j) = in(i, 0) * weights(j, 0) + in(i, 1) * weights(j, 1) + ... +
   //                in(i, k) * weights(j, k) + bias(j);
-  for (size_t i = 0; i < out_h; i++) {
-    for (size_t j = 0; j < out_w; j++) {
-      int32_t sum = 0;
-      for (size_t k = 0; k < in_w; k++) {
-        int32_t W = weightsW[libjit_getXY(weightsWdims, j, k)];
-        int32_t I = inW[libjit_getXY(inWdims, i, k)];
-        sum += (W - weightsOffsets[j]) * (I - inOffset);
-      }
-      int32_t B = libjit_scale_i32i8(biasW[j] - biasOffset, biasPre[j],
-                                     biasPost[j], biasScale[j], 0);
-      sum += B;
-      int32_t scaledSum = libjit_scale_i32i8(sum, outPre[j], outPost[j],
-                                             outScale[j], outOffset);
-      outW[libjit_getXY(outWdims, i, j)] = libjit_clip(scaledSum);
-    }
+  // The rows of the weights are therefore already laid out as the dot-product
+  // kernel expects them.
+  int32_t weightsSums[out_w];
+  for (size_t j = 0; j < out_w; j++) {
+    weightsSums[j] =
+        libjit_sum_i8(in_w, weightsW + libjit_getXY(weightsWdims, j, 0));
   }
+
+  RowwiseQuantizedFCI8Args args{
+      outW,    inW,      weightsW,  weightsSums, biasW,    weightsOffsets,
+      biasPre, biasPost, biasScale, outPre,      outPost,  outScale,
+      out_h,   out_w,    in_w,      outOffset,   inOffset, biasOffset};
+  size_t numBlocks = (out_h + i8RowsBlock - 1) / i8RowsBlock;
+  if (out_h * out_w * in_w >= parallel_threshold) {
+    libjit_parallel_for(numBlocks, &libjit_rowwise_quantized_fc_i8_rows, &args);
+  } else {
+    libjit_rowwise_quantized_fc_i8_rows(0, numBlocks, &args);
+  }
+}
+
+void libjit_dynamic_quantized_fc_f(float *outW, const float *inW,
+                                   const int8_t *weightsW, const float *biasW,
+                                   const size_t *outWdims,
+                                   const size_t *inWdims,
+                                   const size_t *weightsWdims,
+                                   const size_t *biasWdims,
+                                   int32_t weightsOffset, float weightsScale) {
+  size_t in_w = inWdims[1];
+  size_t out_h = outWdims[0];
+  size_t out_w = outWdims[1];
+  size_t inSize = out_h * in_w;
+
+  // Quantize the input with the params of its range in this run.
+  float min = inW[0];
+  float max = inW[0];
+  for (size_t i = 1; i < inSize; i++) {
+    min = MIN(min, inW[i]);
+    max = MAX(max, inW[i]);
+  }
+  float inScale;
+  int32_t inOffset;
+  libjit_choose_quantization_params_i8(min, max, &inScale, &inOffset);
+  int8_t *in = nullptr;
+  libjit_aligned_malloc((void **)&in, 64, inSize);
+  for (size_t i = 0; i < inSize; i++) {
+    in[i] = libjit_clip((int32_t)nearbyintf(inW[i] / inScale + inOffset));
+  }
+
+  // The weights are stored transposed, as in libjit_rowwise_quantized_fc_i8.
+  int32_t weightsSums[out_w];
+  for (size_t j = 0; j < out_w; j++) {
+    weightsSums[j] =
+        libjit_sum_i8(in_w, weightsW + libjit_getXY(weightsWdims, j, 0));
+  }
+
+  DynamicQuantizedFCArgs args{outW,     in,           weightsW, weightsSums,
+                              biasW,    out_h,        out_w,    in_w,
+                              inOffset, weightsOffset, inScale * weightsScale};
+  size_t numBlocks = (out_h + i8RowsBlock - 1) / i8RowsBlock;
+  if (out_h * out_w * in_w >= parallel_threshold) {
+    libjit_parallel_for(numBlocks, &libjit_dynamic_quantized_fc_f_rows, &args);
+  } else {
+    libjit_dynamic_quantized_fc_f_rows(0, numBlocks, &args);
+  }
+
+  libjit_aligned_free(in);
 }
 }
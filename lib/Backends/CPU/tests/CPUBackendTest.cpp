@@ -15,6 +15,113 @@
  */
 #include "tests/unittests/BackendTestUtils.h"
 
+#include "lib/Backends/CPU/CPUBackend.h"
+#include "lib/Backends/CPU/RowCache.h"
+
+#include "glow/ExecutionEngine/ExecutionEngine.h"
+#include "glow/Graph/Graph.h"
+
+#include "gtest/gtest.h"
+
+#include "llvm/Support/CommandLine.h"
+
 using namespace glow;
 
 std::set<std::string> glow::backendTestBlacklist = {};
+
+/// Test that FusedRowwiseQuantizedSparseLengthsWeightedSum computes the same
+/// results once its hot rows are served by the row cache.
+TEST(CPUBackendTest, fusedRowwiseQuantizedSLWSRowCache) {
+  GlowCPURowCacheRows = 4;
+  GlowCPURowCacheRefreshRuns = 1;
+  ExecutionEngine EE("CPU");
+  auto &mod = EE.getModule();
+  Function *F = mod.createFunction("main");
+  Tensor data(ElemKind::FloatTy, {100, 20});
+  data.getHandle().randomize(-1.0, 1.0, mod.getPRNG());
+  auto *weights =
+      mod.createPlaceholder(ElemKind::FloatTy, {12}, "weights", false);
+  auto *indices =
+      mod.createPlaceholder(ElemKind::Int64ITy, {12}, "indices", false);
+  auto *lengths =
+      mod.createPlaceholder(ElemKind::Int32ITy, {3}, "lengths", false);
+  auto *SLWS = F->createFusedRowwiseQuantizedSparseLengthsWeightedSum(
+      "slws", data, weights, indices, lengths);
+  auto *save = F->createSave("save", SLWS);
+
+  PlaceholderBindings bindings;
+  bindings.allocate(weights)->getHandle().randomize(-1.0, 1.0, mod.getPRNG());
+  // Rows 3 and 7 are hot, the others are looked up once.
+  bindings.allocate(indices)->getHandle<int64_t>() = {3, 7, 3, 50, 7, 3,
+                                                      99, 7, 3, 0,  7, 3};
+  bindings.allocate(lengths)->getHandle<int32_t>() = {4, 5, 3};
+  Tensor *result = bindings.allocate(save->getPlaceholder());
+  EE.compile(CompilationMode::Infer);
+
+  // The first run fills the cache, the next ones read it.
+  EE.run(bindings);
+  Tensor expected = result->clone();
+  for (size_t i = 0; i < 3; i++) {
+    result->zero();
+    EE.run(bindings);
+    EXPECT_TRUE(result->isEqual(expected));
+  }
+  GlowCPURowCacheRows = 0;
+  GlowCPURowCacheRefreshRuns = 16;
+}
+
+/// Test the blocking of the matmul kernels chosen for the caches of a desktop
+/// and of a server processor.
+TEST(CPUBackendTest, matMulBlocking) {
+  auto desktop =
+      CPUBackend::getMatMulBlocking(32 << 10, 256 << 10, 8 << 20, 8, 3);
+  EXPECT_EQ(desktop.mc, 256);
+  EXPECT_EQ(desktop.kc, 128);
+  EXPECT_EQ(desktop.nc, 2046);
+  // The blocks of A are packed on the stack, which bounds them on the large
+  // L2 cache.
+  auto server =
+      CPUBackend::getMatMulBlocking(48 << 10, 2 << 20, 105 << 20, 112, 6);
+  EXPECT_EQ(server.mc, 512);
+  EXPECT_EQ(server.kc, 256);
+  EXPECT_EQ(server.nc, 960);
+}
+
+/// Test that a MatMul large enough to pack its operands computes the same
+/// results with the blocking given by -cpu-matmul-blocking, whose blocks
+/// don't divide the matrices.
+TEST(CPUBackendTest, matMulWithBlocking) {
+  auto *blockingOpt = static_cast<llvm::cl::list<unsigned> *>(
+      llvm::cl::getRegisteredOptions()["cpu-matmul-blocking"]);
+  ASSERT_TRUE(blockingOpt);
+  for (unsigned value : {96, 40, 300}) {
+    blockingOpt->push_back(value);
+  }
+  ExecutionEngine EE("CPU");
+  auto &mod = EE.getModule();
+  Function *F = mod.createFunction("main");
+  auto *lhs = mod.createPlaceholder(ElemKind::FloatTy, {37, 100}, "lhs", false);
+  auto *rhs =
+      mod.createPlaceholder(ElemKind::FloatTy, {100, 1030}, "rhs", false);
+  auto *save = F->createSave("save", F->createMatMul("mm", lhs, rhs));
+
+  PlaceholderBindings bindings;
+  auto LH = bindings.allocate(lhs)->getHandle();
+  auto RH = bindings.allocate(rhs)->getHandle();
+  LH.randomize(-1.0, 1.0, mod.getPRNG());
+  RH.randomize(-1.0, 1.0, mod.getPRNG());
+  auto H = bindings.allocate(save->getPlaceholder())->getHandle();
+  EE.compile(CompilationMode::Infer);
+  EE.run(bindings);
+  blockingOpt->clear();
+
+  for (size_t i = 0; i < 37; i++) {
+    for (size_t j = 0; j < 1030; j++) {
+      float sum = 0;
+      for (size_t p = 0; p < 100; p++) {
+        sum += LH.at({i, p}) * RH.at({p, j});
+      }
+      EXPECT_NEAR(H.at({i, j}), sum, 1e-4);
+    }
+  }
+}
@@ -20,11 +20,10 @@ using namespace glow;
 std::set<std::string> glow::backendTestBlacklist = {
     "less_float16Cases/0",
     "less_int64Cases/0",
-    "ResizeNearest_Float/0",
     "ResizeNearest_Float16/0",
-    "ResizeNearest_Int8/0",
     "ResizeNearest_Int16/0",
     "ResizeNearest_Int32/0",
+    "ResizeBilinear_Float16/0",
     "replaceNaN_Float16/0",
     "Logit_Float16/0",
     "FP16Add/0",
@@ -69,10 +68,7 @@ std::set<std::string> glow::backendTestBlacklist = {
     "GroupConv3D/0",
     "NonCubicPaddingConv3D/0",
     "FP16AvgPool/0",
-    "AdaptiveAvgPool/0",
     "FP16AdaptiveAvgPool/0",
-    "Int8AdaptiveAvgPool/0",
-    "AdaptiveAvgPoolNonSquare/0",
     "FP16MaxPool/0",
     "NonCubicKernelConv3D/0",
     "NonCubicKernelConv3DQuantized/0",
@@ -96,22 +92,20 @@ std::set<std::string> glow::backendTestBlacklist = {
     "back/0",
     "FusedRowwiseQuantizedSparseLengthsSum_Float16_AccumFloat/0",
     "FusedRowwiseQuantizedSparseLengthsSum_Float16_AccumFloat16/0",
-    "SparseToDenseMask1/0",
-    "SparseToDenseMask2/0",
     "FP16Reshape/0",
     "sliceReshape_Float16/0",
     "Flatten_Float16Ty/0",
-    "Bucketize/0",
     "FP16SoftMax/0",
-    "BatchOneHotDataFloat/0",
     "BatchOneHotDataFloat16/0",
-    "BatchOneHotDataInt64/0",
-    "BatchOneHotDataInt32/0",
-    "BatchOneHotDataInt8/0",
     "dotProduct1D_Float16/0",
     "dotProduct2D_Float16/0",
-    "BatchBoxCox_Float/0",
     "BatchBoxCox_Float16/0",
+    "LayerNormalization_Float16/0",
+    "BatchedPairwiseDotProduct_Float16/0",
+    "SparseLengthsMean_Float16/0",
+    "SparseLengthsMax_Float16/0",
+    "FusedRowwiseQuantizedSparseLengthsMean_Float16/0",
+    "FusedRowwiseQuantizedSparseLengthsMax_Float16/0",
     "ConvertFrom_FloatTy_To_Float16Ty/0",
     "ConvertFrom_FloatTy_To_Int32ITy/0",
     "ConvertFrom_FloatTy_To_Int64ITy/0",
@@ -15,6 +15,46 @@
  */
 #include "tests/unittests/BackendTestUtils.h"
 
+#include "lib/Backends/CPU/PerfCounters.h"
+
+#include "glow/ExecutionEngine/ExecutionEngine.h"
+#include "glow/Graph/Graph.h"
+
+#include "gtest/gtest.h"
+
 using namespace glow;
 
 std::set<std::string> glow::backendTestBlacklist = {};
+
+/// Test that with -cpu-perf-counters the auto instrumented kernels report
+/// hardware counters, which are zeros where perf events are unavailable.
+TEST(CPUTraceEventsTest, perfCounters) {
+  GlowCPUPerfCounters = true;
+  ExecutionEngine EE("CPU");
+  auto &mod = EE.getModule();
+  Function *F = mod.createFunction("main");
+  auto *X = mod.createPlaceholder(ElemKind::FloatTy, {64, 64}, "X", false);
+  auto *FC = F->createMatMul("matmul", X, X);
+  F->createSave("save", F->createRELU("relu", FC));
+
+  ExecutionContext context;
+  context.setTraceContext(
+      llvm::make_unique<TraceContext>(TraceLevel::OPERATOR));
+  context.getPlaceholderBindings()->allocate(mod.getPlaceholders());
+  CompilationContext cctx;
+  cctx.compMode = CompilationMode::Infer;
+  cctx.backendOpts.autoInstrument = true;
+  EE.compile(cctx);
+  EE.run(context);
+  GlowCPUPerfCounters = false;
+
+  auto &traceEvents = context.getTraceContext()->getTraceEvents();
+  ASSERT_GT(traceEvents.size(), 0);
+  for (const auto &event : traceEvents) {
+    ASSERT_EQ(event.type, char(TraceEvent::CompleteType));
+    EXPECT_EQ(event.args.count("cycles"), 1) << event.name;
+    EXPECT_EQ(event.args.count("instructions"), 1) << event.name;
+    EXPECT_EQ(event.args.count("llc_misses"), 1) << event.name;
+    EXPECT_EQ(event.args.count("memory_bytes"), 1) << event.name;
+  }
+}
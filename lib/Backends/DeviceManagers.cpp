@@ -21,9 +21,11 @@
 #include "llvm/Support/Casting.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include <algorithm>
 #include <fstream>
 #include <string>
 #include <thread>
+#include <unordered_set>
 
 #include <glog/logging.h>
 
@@ -33,6 +35,93 @@ using namespace glow::runtime;
 namespace glow {
 namespace runtime {
 
+uint64_t
+DeviceManager::getAddedConstantsSize(const FunctionMapTy &functions) const {
+  uint64_t size = 0;
+  std::unordered_set<const uint8_t *> added;
+  for (const auto &func : functions) {
+    const auto &bundle = func.second->getRuntimeBundle();
+    const uint8_t *constants = bundle.getConstants();
+    if (constants && (constantsUsers_.count(constants) ||
+                      !added.insert(constants).second)) {
+      continue;
+    }
+    size += bundle.getConstantWeightSize();
+  }
+  return size;
+}
+
+uint64_t DeviceManager::addConstantsUser(CompiledFunction *function) {
+  const auto &bundle = function->getRuntimeBundle();
+  const uint8_t *constants = bundle.getConstants();
+  if (constants && constantsUsers_[constants]++ > 0) {
+    return 0;
+  }
+  return bundle.getConstantWeightSize();
+}
+
+uint64_t DeviceManager::removeConstantsUser(CompiledFunction *function) {
+  const auto &bundle = function->getRuntimeBundle();
+  const uint8_t *constants = bundle.getConstants();
+  if (constants) {
+    auto it = constantsUsers_.find(constants);
+    assert(it != constantsUsers_.end() && "Constants not on the device");
+    if (--it->second > 0) {
+      return 0;
+    }
+    constantsUsers_.erase(it);
+  }
+  return bundle.getConstantWeightSize();
+}
+
+/// \returns the key of the counter of the \p kind memory of the function
+/// \p name on the device \p deviceID.
+static std::string getNetworkMemoryKey(llvm::StringRef kind,
+                                       DeviceIDTy deviceID,
+                                       llvm::StringRef name) {
+  return ("glow.device." + kind + "_memory.device" +
+          std::to_string(deviceID) + "." + name)
+      .str();
+}
+
+void DeviceManager::addNetworkMemoryUsage(const std::string &name,
+                                          const NetworkMemoryUsage &usage) {
+  {
+    std::lock_guard<std::mutex> lock(networkMemoryLock_);
+    networkMemory_[name] = usage;
+  }
+  Stats()->setCounter(
+      getNetworkMemoryKey("constants", config_.deviceID, name),
+      usage.constants);
+  Stats()->setCounter(
+      getNetworkMemoryKey("activations", config_.deviceID, name),
+      usage.activations);
+  Stats()->setCounter(getNetworkMemoryKey("io", config_.deviceID, name),
+                      usage.io);
+}
+
+void DeviceManager::removeNetworkMemoryUsage(const std::string &name) {
+  {
+    std::lock_guard<std::mutex> lock(networkMemoryLock_);
+    networkMemory_.erase(name);
+  }
+  for (const char *kind : {"constants", "activations", "io"}) {
+    Stats()->setCounter(getNetworkMemoryKey(kind, config_.deviceID, name), 0);
+  }
+}
+
+DeviceMemoryUsage DeviceManager::getMemoryUsage() const {
+  DeviceMemoryUsage usage;
+  usage.maxBytes = getMaximumMemory();
+  usage.availableBytes = getAvailableMemory();
+  usage.usedBytes =
+      usage.maxBytes - std::min(usage.maxBytes, usage.availableBytes);
+  usage.largestFreeBlock = getLargestFreeBlock();
+  std::lock_guard<std::mutex> lock(networkMemoryLock_);
+  usage.networks = networkMemory_;
+  return usage;
+}
+
 DeviceManager *DeviceManager::createDeviceManager(const DeviceConfig &config) {
   std::unique_ptr<Backend> backend(
       FactoryRegistry<std::string, Backend>::get(config.backendName));
@@ -23,15 +23,30 @@
 #include "perf_lib_layer_params.h"
 #include "synapse.h"
 
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/FormatVariadic.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/Path.h"
 
 #include <chrono>
 #include <glog/logging.h>
 #include <unordered_map>
+#include <unordered_set>
 
 using namespace glow;
 
+static llvm::cl::opt<std::string> GlowHabanaRecipeCacheDirOpt(
+    "glow-habana-recipe-cache-dir",
+    llvm::cl::desc("Directory of the recipes compiled by Synapse, which the "
+                   "compilations of identical functions reuse, also after a "
+                   "restart. The cache is disabled when it is empty"),
+    llvm::cl::init(""));
+
+/// Version of the entries of the recipe cache. Bump it whenever the recipes
+/// change in a way that their key doesn't capture.
+static constexpr char kRecipeCacheVersion[] = "glow-habana-recipe-1";
+
 /// Get a path to a temporary file for the compiled recipe.
 static Expected<std::string> getRecipeFile() {
   llvm::SmallString<64> path;
@@ -41,6 +56,81 @@ static Expected<std::string> getRecipeFile() {
   return path.str();
 }
 
+/// \returns the key of the recipe of \p F in the recipe cache: a hash of the
+/// nodes of \p F, of the payloads of its Constants and of the version of
+/// Synapse.
+static std::string getRecipeKey(const Function *F) {
+  llvm::MD5 hash;
+  auto add = [&hash](llvm::StringRef data) {
+    hash.update(data);
+    // Terminate every part, so that moving bytes from one part to the next
+    // changes the key.
+    hash.update(llvm::StringRef("", 1));
+  };
+  add(kRecipeCacheVersion);
+  add(synGetVersion());
+  add(F->toString());
+  // The Constants are compiled into the recipe.
+  std::unordered_set<const Constant *> constants;
+  for (const auto &N : F->getNodes()) {
+    for (unsigned i = 0, e = N.getNumInputs(); i < e; i++) {
+      auto *C = llvm::dyn_cast<Constant>(N.getNthInput(i).getNode());
+      if (C && constants.insert(C).second) {
+        const auto &payload = C->getPayload();
+        add(C->getName());
+        add(llvm::StringRef(payload.getUnsafePtr(), payload.getSizeInBytes()));
+      }
+    }
+  }
+  llvm::MD5::MD5Result result;
+  hash.final(result);
+  llvm::SmallString<32> key;
+  llvm::MD5::stringifyResult(result, key);
+  return key.str();
+}
+
+/// \returns the path of the recipe \p key in the recipe cache.
+static std::string getCachedRecipePath(llvm::StringRef key) {
+  llvm::SmallString<128> path(GlowHabanaRecipeCacheDirOpt);
+  llvm::sys::path::append(path, key + ".recipe");
+  return path.str();
+}
+
+/// \returns a path in the recipe cache to compile the recipe \p key to before
+/// it is stored with storeRecipe(), or an Error if the directory of the cache
+/// can't be written.
+static Expected<std::string> getRecipeCacheTempFile(llvm::StringRef key) {
+  auto dirEC = llvm::sys::fs::create_directories(GlowHabanaRecipeCacheDirOpt);
+  RETURN_ERR_IF_NOT(!dirEC,
+                    strFormat("Unable to create the recipe cache directory %s",
+                              GlowHabanaRecipeCacheDirOpt.c_str()));
+  llvm::SmallString<128> path;
+  auto EC = llvm::sys::fs::createUniqueFile(
+      getCachedRecipePath(key) + "-%%%%%%.tmp", path);
+  RETURN_ERR_IF_NOT(!EC, strFormat("Unable to create a recipe file in %s",
+                                   GlowHabanaRecipeCacheDirOpt.c_str()));
+  return path.str();
+}
+
+/// Moves the recipe compiled to \p tempPath, and its binary, to the recipe
+/// cache as \p path. The renames are atomic and the binary is moved first, so
+/// that a recipe found in the cache is complete, whatever the other processes
+/// storing the same recipe do. \returns false if the recipe stays at
+/// \p tempPath.
+static bool storeRecipe(llvm::StringRef tempPath, llvm::StringRef path) {
+  if (auto EC = llvm::sys::fs::rename(tempPath + ".bin", path + ".bin")) {
+    LOG(WARNING) << "Unable to store the recipe " << path.str()
+                 << " in the cache: " << EC.message();
+    return false;
+  }
+  if (auto EC = llvm::sys::fs::rename(tempPath, path)) {
+    LOG(WARNING) << "Unable to store the recipe " << path.str()
+                 << " in the cache: " << EC.message();
+    return false;
+  }
+  return true;
+}
+
 /// Convert a Glow data type to a Synapse data type.
 static synDataType getSynType(ElemKind kind) {
   switch (kind) {
@@ -450,6 +540,22 @@ allocateGraphTensors(Function *F) {
 
 Expected<std::unique_ptr<CompiledFunction>>
 HabanaBackend::compile(Function *F, const BackendOptions &opts) const {
+  // Reuse the recipe of an identical function compiled earlier, here or by
+  // another process.
+  std::string recipeKey;
+  if (!GlowHabanaRecipeCacheDirOpt.empty()) {
+    recipeKey = getRecipeKey(F);
+    auto cachedRecipe = getCachedRecipePath(recipeKey);
+    if (llvm::sys::fs::exists(cachedRecipe)) {
+      LOG(INFO) << "Using the cached recipe " << cachedRecipe << " for "
+                << F->getName().str();
+      return Expected<std::unique_ptr<CompiledFunction>>(
+          llvm::make_unique<HabanaFunction>(runtime::RuntimeBundle::create(*F),
+                                            cachedRecipe, F,
+                                            /* ownsRecipe */ false));
+    }
+  }
+
   chk(synCreateGraph(synDeviceGoya));
 
   // Allocate all the tensors.
@@ -1058,7 +1164,11 @@ HabanaBackend::compile(Function *F, const BackendOptions &opts) const {
 
   // Compile the graph.
   std::string recipeName;
-  ASSIGN_VALUE_OR_RETURN_ERR(recipeName, getRecipeFile());
+  if (recipeKey.empty()) {
+    ASSIGN_VALUE_OR_RETURN_ERR(recipeName, getRecipeFile());
+  } else {
+    ASSIGN_VALUE_OR_RETURN_ERR(recipeName, getRecipeCacheTempFile(recipeKey));
+  }
   CompilationAttribute compileParams[1];
   compileParams[0].type = VISUALIZATION;
   compileParams[0].u32 = 1;
@@ -1071,9 +1181,18 @@ HabanaBackend::compile(Function *F, const BackendOptions &opts) const {
   LOG(INFO) << "Compilation took " << duration / 1000.0 << " [ms]";
   chk(synDestroyGraph());
 
+  bool ownsRecipe = true;
+  if (!recipeKey.empty()) {
+    auto cachedRecipe = getCachedRecipePath(recipeKey);
+    if (storeRecipe(recipeName, cachedRecipe)) {
+      recipeName = cachedRecipe;
+      ownsRecipe = false;
+    }
+  }
+
   return Expected<std::unique_ptr<CompiledFunction>>(
       llvm::make_unique<HabanaFunction>(runtime::RuntimeBundle::create(*F),
-                                        recipeName, F));
+                                        recipeName, F, ownsRecipe));
 }
 
 static bool isQuantizedType(ElemKind kind) {
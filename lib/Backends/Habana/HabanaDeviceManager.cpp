@@ -24,6 +24,7 @@
 
 #include "synapse.h"
 
+#include <algorithm>
 #include <glog/logging.h>
 #include <limits>
 
@@ -40,6 +41,16 @@ static llvm::cl::opt<unsigned, /* ExternalStorage */ true> GlowHabanaMemoryOpt(
     llvm::cl::desc("Amount of DRAM to allocate per Habana device in kilobytes"),
     llvm::cl::location(GlowHabanaMemory));
 
+unsigned GlowHabanaInflightRequests = 10;
+
+static llvm::cl::opt<unsigned, /* ExternalStorage */ true>
+    GlowHabanaInflightRequestsOpt(
+        "glow-habana-inflight-requests",
+        llvm::cl::desc("Number of requests per function whose inputs may be "
+                       "staged or whose results may be pending at once on a "
+                       "Habana device"),
+        llvm::cl::location(GlowHabanaInflightRequests));
+
 DeviceManager *createHabanaDeviceManager(const DeviceConfig &config) {
   return new HabanaDeviceManager(config);
 }
@@ -53,8 +64,10 @@ std::atomic<RunIdentifierTy> HabanaDeviceManager::runIdentifier_;
 
 HabanaDeviceManager::HabanaDeviceManager(const DeviceConfig &config,
                                          unsigned numRunners,
-                                         unsigned numWaiters)
-    : DeviceManager(config), numRunners_(numRunners), numWaiters_(numWaiters) {}
+                                         unsigned numWaiters,
+                                         unsigned numCopiers)
+    : DeviceManager(config), numCopiers_(numCopiers), numRunners_(numRunners),
+      numWaiters_(numWaiters) {}
 
 HabanaDeviceManager::~HabanaDeviceManager() {
   // If a device was never successfully acquired, there's nothing to clean up.
@@ -104,11 +117,13 @@ Error HabanaDeviceManager::init() {
   // Fetch initial memory information.
   RETURN_IF_ERR(updateMemoryUsage());
 
-  // Create thread pools for running functions and waiting on function results.
+  // Create thread pools for staging inputs, running functions and waiting on
+  // function results.
+  copyPool_ = llvm::make_unique<ThreadPool>(numCopiers_);
   runPool_ = llvm::make_unique<ThreadPool>(numRunners_);
   waitPool_ = llvm::make_unique<ThreadPool>(numWaiters_);
 
-  if (!runPool_ || !waitPool_) {
+  if (!copyPool_ || !runPool_ || !waitPool_) {
     RETURN_ERR("Failed to create HabanaDeviceManager thread pools");
   }
 
@@ -186,7 +201,8 @@ void HabanaDeviceManager::addNetwork(const Module *module,
         HabanaFunctionMeta{topologyId, habanaFunction,
                            llvm::make_unique<HabanaIOBufferPool>(
                                deviceId_, habanaFunction->getInputs(),
-                               habanaFunction->getOutputs())}));
+                               habanaFunction->getOutputs(),
+                               std::max(GlowHabanaInflightRequests, 1u))}));
 
     if (!inserted) {
       // TODO: Unload functions that were loaded successfully.
@@ -197,6 +213,12 @@ void HabanaDeviceManager::addNetwork(const Module *module,
       return;
     }
 
+    // The IO buffer pool holds the inputs and outputs of every request in
+    // flight.
+    NetworkMemoryUsage usage(habanaFunction->getRuntimeBundle());
+    usage.io *= std::max(GlowHabanaInflightRequests, 1u);
+    addNetworkMemoryUsage(func.first, usage);
+
     // Optimistically activate the topology if nothing else is loaded.
     cv_.wait(lk, [this] { return inflightRequests_ == 0; });
     if (auto err = chk_make_err(synActivateTopology(deviceId_, topologyId))) {
@@ -264,6 +286,7 @@ void HabanaDeviceManager::evictNetwork(std::string functionName,
                 functionName.c_str())));
     return;
   }
+  removeNetworkMemoryUsage(functionName);
 
   lk.unlock();
 
@@ -276,6 +299,74 @@ void HabanaDeviceManager::evictNetwork(std::string functionName,
   evictCB(functionName, Error::success());
 }
 
+Error HabanaDeviceManager::stageInputs(const std::string &functionName,
+                                       ExecutionContext &ctx, bool wait) {
+  // Try to find the function with the given name in functions_.
+  uint64_t topologyId;
+  HabanaFunction *function;
+  HabanaIOBufferPool *ioBufferPool;
+  {
+    std::lock_guard<std::mutex> lock(instanceMtx_);
+    auto it = functions_.find(functionName);
+    if (it == functions_.end()) {
+      return MAKE_ERR(
+          strFormat("Failed to run function: function called %s was not added",
+                    functionName.c_str()));
+    }
+
+    topologyId = (it->second).topologyId;
+    function = (it->second).function;
+    ioBufferPool = (it->second).ioBufferPool.get();
+  }
+
+  // Copy the inputs into an IO buffer. Getting one blocks while all IO buffers
+  // of the function are in flight, which bounds the number of in flight
+  // requests.
+  auto ioBuffer = wait ? ioBufferPool->get() : ioBufferPool->tryGet();
+  if (!ioBuffer) {
+    return Error::success();
+  }
+  auto deviceBindings =
+      llvm::make_unique<HabanaBindings>(deviceId_, topologyId);
+  deviceBindings->setIOBuffer(std::move(ioBuffer));
+  ctx.setDeviceBindings(std::move(deviceBindings));
+
+  if (auto err = function->stageInputs(&ctx)) {
+    ioBufferPool->put(
+        static_cast<HabanaBindings *>(ctx.getDeviceBindings())->getIOBuffer());
+    ctx.setDeviceBindings(nullptr);
+    return err;
+  }
+  return Error::success();
+}
+
+void HabanaDeviceManager::stageFunctionImpl(
+    RunIdentifierTy runId, std::string functionName,
+    std::unique_ptr<ExecutionContext> ctx, runtime::ResultCBTy resultCB) {
+  DCHECK(resultCB != nullptr);
+
+  TRACE_EVENT_SCOPE_NAMED(ctx->getTraceContext(), TraceLevel::RUNTIME,
+                          "HabanaDM::copierThread", trEvent);
+  if (ctx->getTraceContext()) {
+    ctx->getTraceContext()->setThreadName(
+        llvm::formatv("Habana {0} (copy)", deviceId_).str());
+  }
+  if (auto err = stageInputs(functionName, *ctx, /* wait */ true)) {
+    trEvent.addArg("error", "stageInputs() failed");
+    TRACE_EVENT_SCOPE_END_NAMED(trEvent);
+    resultCB(runId, std::move(err), std::move(ctx));
+    return;
+  }
+  TRACE_EVENT_SCOPE_END_NAMED(trEvent);
+
+  runPool_->submit([this, runId, functionName = std::move(functionName),
+                    ctx = std::move(ctx),
+                    resultCB = std::move(resultCB)]() mutable {
+    runFunctionImpl(runId, std::move(functionName), std::move(ctx),
+                    std::move(resultCB));
+  });
+}
+
 void HabanaDeviceManager::runFunctionImpl(RunIdentifierTy runId,
                                           std::string functionName,
                                           std::unique_ptr<ExecutionContext> ctx,
@@ -288,26 +379,19 @@ void HabanaDeviceManager::runFunctionImpl(RunIdentifierTy runId,
     ctx->getTraceContext()->setThreadName(
         llvm::formatv("Habana {0} (enqueue)", deviceId_).str());
   }
-  // Try to find the function with the given name in functions_.
-  uint64_t topologyId;
+  // The function was found when its inputs were staged.
   HabanaFunction *function;
   HabanaIOBufferPool *ioBufferPool;
   {
     std::lock_guard<std::mutex> lock(instanceMtx_);
     auto it = functions_.find(functionName);
-    if (it == functions_.end()) {
-      resultCB(runId,
-               MAKE_ERR(strFormat(
-                   "Failed to run function: function called %s was not added",
-                   functionName.c_str())),
-               std::move(ctx));
-      return;
-    }
-
-    topologyId = (it->second).topologyId;
+    DCHECK(it != functions_.end());
     function = (it->second).function;
     ioBufferPool = (it->second).ioBufferPool.get();
   }
+  auto *habanaBindings =
+      static_cast<HabanaBindings *>(ctx->getDeviceBindings());
+  uint64_t topologyId = habanaBindings->getTopologyId();
 
   // If we need to switch topos, wait to drain the queue.
   {
@@ -324,6 +408,8 @@ void HabanaDeviceManager::runFunctionImpl(RunIdentifierTy runId,
                                    activateTopoRes)
                          .str());
         TRACE_EVENT_SCOPE_END_NAMED(trEvent);
+        lock.unlock();
+        ioBufferPool->put(habanaBindings->getIOBuffer());
         resultCB(runId, std::move(err), std::move(ctx));
         return;
       }
@@ -333,14 +419,15 @@ void HabanaDeviceManager::runFunctionImpl(RunIdentifierTy runId,
   }
 
   // Execute the function.
-  auto deviceBindings =
-      llvm::make_unique<HabanaBindings>(deviceId_, topologyId);
-  deviceBindings->setIOBuffer(ioBufferPool->get());
-  ctx->setDeviceBindings(std::move(deviceBindings));
-
-  auto executeErr = function->execute(ctx.get());
+  auto executeErr = function->enqueue(ctx.get());
   if (executeErr) {
-    trEvent.addArg("error", "execute() failed");
+    {
+      std::lock_guard<std::mutex> lock(instanceMtx_);
+      inflightRequests_--;
+    }
+    cv_.notify_one();
+    ioBufferPool->put(habanaBindings->getIOBuffer());
+    trEvent.addArg("error", "enqueue() failed");
     TRACE_EVENT_SCOPE_END_NAMED(trEvent);
     resultCB(runId, std::move(executeErr), std::move(ctx));
     return;
@@ -431,16 +518,48 @@ HabanaDeviceManager::runFunction(std::string functionName,
   DCHECK(resultCB != nullptr);
 
   RunIdentifierTy runId = runIdentifier_++;
-  runPool_->submit([this, runId, functionName = std::move(functionName),
-                    ctx = std::move(ctx),
-                    resultCB = std::move(resultCB)]() mutable {
-    runFunctionImpl(runId, std::move(functionName), std::move(ctx),
-                    std::move(resultCB));
+  // The inputs staged by prepareInputs() skip the copy thread.
+  if (ctx->getDeviceBindings()) {
+    runPool_->submit([this, runId, functionName = std::move(functionName),
+                      ctx = std::move(ctx),
+                      resultCB = std::move(resultCB)]() mutable {
+      runFunctionImpl(runId, std::move(functionName), std::move(ctx),
+                      std::move(resultCB));
+    });
+    return runId;
+  }
+  copyPool_->submit([this, runId, functionName = std::move(functionName),
+                     ctx = std::move(ctx),
+                     resultCB = std::move(resultCB)]() mutable {
+    stageFunctionImpl(runId, std::move(functionName), std::move(ctx),
+                      std::move(resultCB));
   });
   return runId;
 }
 
+Error HabanaDeviceManager::prepareInputs(const std::string &functionName,
+                                         ExecutionContext &context) {
+  // Don't wait for the runs in flight to give an IO buffer back, the inputs
+  // are then staged by the copy thread.
+  return stageInputs(functionName, context, /* wait */ false);
+}
+
+void HabanaDeviceManager::releaseInputs(const std::string &functionName,
+                                        ExecutionContext &context) {
+  auto *habanaBindings =
+      static_cast<HabanaBindings *>(context.getDeviceBindings());
+  if (!habanaBindings) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(instanceMtx_);
+  auto it = functions_.find(functionName);
+  DCHECK(it != functions_.end());
+  (it->second).ioBufferPool->put(habanaBindings->getIOBuffer());
+  context.setDeviceBindings(nullptr);
+}
+
 Error HabanaDeviceManager::stop(bool block) {
+  copyPool_->stop(block);
   runPool_->stop(block);
   waitPool_->stop(block);
   return Error::success();
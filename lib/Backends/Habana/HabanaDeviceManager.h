@@ -56,14 +56,20 @@ class HabanaDeviceManager : public DeviceManager {
   /// activeEnqueues_).
   std::mutex instanceMtx_;
 
+  /// Thread pool for copying the inputs of functions into their IO buffers.
+  std::unique_ptr<ThreadPool> copyPool_;
   /// Thread pool for executing functions.
   std::unique_ptr<ThreadPool> runPool_;
   /// Thread pool for waiting on the results of executing functions.
   std::unique_ptr<ThreadPool> waitPool_;
+  /// The default number of workers in copy pool (overridable).
+  constexpr static unsigned kNumCopiers = 1;
   /// The default number of workers in run pool (overridable).
   constexpr static unsigned kNumRunners = 1;
   /// The default number of workers in wait pool (overridable).
   constexpr static unsigned kNumWaiters = 1;
+  /// The number of workers in copy pool.
+  unsigned numCopiers_{kNumCopiers};
   /// The number of workers in run pool.
   unsigned numRunners_{kNumRunners};
   /// The number of workers in wait pool.
@@ -103,9 +109,24 @@ class HabanaDeviceManager : public DeviceManager {
   /// Identifier for next run.
   static std::atomic<RunIdentifierTy> runIdentifier_;
 
-  /// Helper method for running a function. runFunction submits a lambda that
-  /// calls this to runPool_ so that it can return immediately without taking up
-  /// the calling thread for too long.
+  /// Stage the inputs in \p ctx of a run of \p functionName into an IO buffer
+  /// of the function, which is kept in the HabanaBindings of \p ctx. Waits
+  /// for a free IO buffer if \p wait, else stages nothing if there is none.
+  /// \returns an Error, with nothing staged, on failure.
+  Error stageInputs(const std::string &functionName, ExecutionContext &ctx,
+                    bool wait);
+
+  /// Helper method for staging the inputs of a function. runFunction submits
+  /// a lambda that calls this to copyPool_ so that it can return immediately;
+  /// once the inputs are in an IO buffer, the run is passed on to runPool_.
+  /// This overlaps the input copies of a run with the execution of the
+  /// previous one and the output copies of the one before.
+  void stageFunctionImpl(RunIdentifierTy runId, std::string functionName,
+                         std::unique_ptr<ExecutionContext> ctx,
+                         runtime::ResultCBTy resultCB);
+
+  /// Helper method for running a function whose inputs were staged by
+  /// stageFunctionImpl, which submits a lambda that calls this to runPool_.
   void runFunctionImpl(RunIdentifierTy runId, std::string functionName,
                        std::unique_ptr<ExecutionContext> ctx,
                        runtime::ResultCBTy resultCB);
@@ -119,7 +140,8 @@ public:
   /// Constructor.
   HabanaDeviceManager(const DeviceConfig &config,
                       unsigned numRunners = kNumRunners,
-                      unsigned numWaiters = kNumWaiters);
+                      unsigned numWaiters = kNumWaiters,
+                      unsigned numCopiers = kNumCopiers);
 
   /// Destructor.
   virtual ~HabanaDeviceManager();
@@ -138,6 +160,13 @@ public:
                               std::unique_ptr<ExecutionContext> ctx,
                               runtime::ResultCBTy resultCB) override;
 
+  /// Stages the inputs into a free IO buffer of the function, if there is one.
+  Error prepareInputs(const std::string &functionName,
+                      ExecutionContext &context) override;
+
+  void releaseInputs(const std::string &functionName,
+                     ExecutionContext &context) override;
+
   Error stop(bool block) override;
 
   uint64_t getMaximumMemory() const override;
@@ -86,6 +86,16 @@ std::unique_ptr<HabanaIOBuffer> HabanaIOBufferPool::get() {
   return buf;
 }
 
+std::unique_ptr<HabanaIOBuffer> HabanaIOBufferPool::tryGet() {
+  std::lock_guard<std::mutex> lk(mtx_);
+  if (ioBuffers_.empty()) {
+    return nullptr;
+  }
+  std::unique_ptr<HabanaIOBuffer> buf(std::move(ioBuffers_.front()));
+  ioBuffers_.pop();
+  return buf;
+}
+
 void HabanaIOBufferPool::put(std::unique_ptr<HabanaIOBuffer> buffer) {
   std::lock_guard<std::mutex> lk(mtx_);
   bool wasEmpty = ioBuffers_.empty();
@@ -146,43 +156,11 @@ static bool usedInFunction(const Placeholder *V, const Function *F) {
   return false;
 }
 
-/// \returns true if \p dst is capable of handling a partial tensor as input
-/// from \p src.
-static bool allowsPartialInput(const Node *src, const Node *dst) {
-  // If N is used as the indices or weights of a sparse lookup, it is safe to
-  // access a partial tensor.
-  if (auto *SLS =
-          llvm::dyn_cast<FusedRowwiseQuantizedSparseLengthsWeightedSumNode>(
-              dst)) {
-    return src == SLS->getIndices() || src == SLS->getWeights();
-  } else if (auto *SLS =
-                 llvm::dyn_cast<FusedRowwiseQuantizedSparseLengthsSumNode>(
-                     dst)) {
-    return src == SLS->getIndices();
-  } else if (auto *SLS = llvm::dyn_cast<SparseLengthsWeightedSumNode>(dst)) {
-    return src == SLS->getIndices() || src == SLS->getWeights();
-  } else if (auto *SLS = llvm::dyn_cast<SparseLengthsSumNode>(dst)) {
-    return src == SLS->getIndices();
-  }
-  return false;
-}
-
-/// \returns true if \p V is capable of handling a partial tensor as input.
-static bool allowsPartialInput(const Placeholder *V, const Function *F) {
-  for (auto const &U : V->getUsers()) {
-    if (U.getUser()->getParent() != F) {
-      continue;
-    }
-    if (!allowsPartialInput(*U.get(), U.getUser())) {
-      return false;
-    }
-  }
-  return true;
-}
-
 HabanaFunction::HabanaFunction(runtime::RuntimeBundle &&bundle,
-                               const std::string &recipeName, Function *F)
-    : CompiledFunction(std::move(bundle)), recipeName_(recipeName) {
+                               const std::string &recipeName, Function *F,
+                               bool ownsRecipe)
+    : CompiledFunction(std::move(bundle)), recipeName_(recipeName),
+      ownsRecipe_(ownsRecipe) {
   findIOPlaceholders(F);
 }
 
@@ -237,6 +215,9 @@ static Error dumpTopologyInfo(uint32_t deviceId, uint64_t topologyId) {
 }
 
 HabanaFunction::~HabanaFunction() {
+  if (!ownsRecipe_) {
+    return;
+  }
   CHECK(!llvm::sys::fs::remove(recipeName_))
       << "Failed to remove file at " << recipeName_;
   CHECK(!llvm::sys::fs::remove(recipeName_ + ".bin"))
@@ -248,18 +229,20 @@ Error HabanaFunction::execute(ExecutionContext *context) {
   TRACE_EVENT_SCOPE_NAMED(tc, TraceLevel::RUNTIME, "execute", exEvent);
   exEvent.addArg("recipe", recipeName_);
 
-  uint32_t deviceId =
-      static_cast<HabanaBindings *>(context->getDeviceBindings())
-          ->getDeviceId();
-  uint64_t topologyId =
-      static_cast<HabanaBindings *>(context->getDeviceBindings())
-          ->getTopologyId();
-  HabanaIOBuffer *ioBuffer =
-      static_cast<HabanaBindings *>(context->getDeviceBindings())
-          ->getIOBufferUnsafePtr();
+  RETURN_IF_ERR(stageInputs(context));
+  return enqueue(context);
+}
+
+Error HabanaFunction::stageInputs(ExecutionContext *context) {
+  auto *tc = context->getTraceContext();
+  auto *habanaBindings =
+      static_cast<HabanaBindings *>(context->getDeviceBindings());
+  HabanaIOBuffer *ioBuffer = habanaBindings->getIOBufferUnsafePtr();
 
-  std::vector<EnqueueTensorInfo> inputInfo;
-  std::vector<EnqueueTensorInfo> outputInfo;
+  std::vector<EnqueueTensorInfo> &inputInfo = habanaBindings->getInputInfo();
+  std::vector<EnqueueTensorInfo> &outputInfo = habanaBindings->getOutputInfo();
+  inputInfo.clear();
+  outputInfo.clear();
 
   // Set up input buffers and record bindings for enqueuing.
   TRACE_EVENT_SCOPE_NAMED(tc, TraceLevel::RUNTIME, "copyInputs", ciEvent);
@@ -273,7 +256,7 @@ Error HabanaFunction::execute(ExecutionContext *context) {
     tensors++;
     RETURN_ERR_IF_NOT(T, "Failed to get input tensor.");
 
-    bool isPartial = partialInputs_.count(P);
+    bool isPartial = partialInputs_.count(P) || P->isRagged();
     bool downcastInt64 = downcastInt64Inputs_.count(P);
 
     size_t elemSize =
@@ -335,9 +318,20 @@ Error HabanaFunction::execute(ExecutionContext *context) {
 
     outputInfo.push_back(eti);
   }
+  TRACE_EVENT_SCOPE_END_NAMED(roEvent);
+  return Error::success();
+}
+
+Error HabanaFunction::enqueue(ExecutionContext *context) {
+  auto *tc = context->getTraceContext();
+  auto *habanaBindings =
+      static_cast<HabanaBindings *>(context->getDeviceBindings());
+  uint32_t deviceId = habanaBindings->getDeviceId();
+  uint64_t topologyId = habanaBindings->getTopologyId();
+  std::vector<EnqueueTensorInfo> &inputInfo = habanaBindings->getInputInfo();
+  std::vector<EnqueueTensorInfo> &outputInfo = habanaBindings->getOutputInfo();
 
   EnqueueTensorInfo noInputEti = {"unused", (char *)nullptr, 0};
-  TRACE_EVENT_SCOPE_END_NAMED(roEvent);
 
   // Enqueue the run and wait for it to come back.
   synWaitHandle handle;
@@ -354,9 +348,8 @@ Error HabanaFunction::execute(ExecutionContext *context) {
   }
   TRACE_EVENT_SCOPE_END_NAMED(seEvent);
 
-  static_cast<HabanaBindings *>(context->getDeviceBindings())
-      ->setHandle(HabanaWaitHandle(deviceId, handle, std::move(inputInfo),
-                                   std::move(outputInfo)));
+  habanaBindings->setHandle(HabanaWaitHandle(
+      deviceId, handle, std::move(inputInfo), std::move(outputInfo)));
   return Error::success();
 }
 
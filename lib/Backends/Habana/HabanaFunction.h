@@ -84,6 +84,10 @@ public:
   /// ownership to the calling thread.
   std::unique_ptr<HabanaIOBuffer> get();
 
+  /// Get a HabanaIOBuffer instance from the pool like get(), without waiting.
+  /// \returns nullptr if all of them are in use.
+  std::unique_ptr<HabanaIOBuffer> tryGet();
+
   /// Return a HabanaIOBuffer instance to the pool. This returns exclusive
   /// ownership back to the pool.
   void put(std::unique_ptr<HabanaIOBuffer> buffer);
@@ -182,18 +186,30 @@ public:
     ioBuffer_ = std::move(ioBuffer);
   }
 
+  /// \returns the inputs of the enqueue staged in the IO buffer.
+  std::vector<EnqueueTensorInfo> &getInputInfo() { return inputInfo_; }
+
+  /// \returns the outputs of the enqueue registered in the IO buffer.
+  std::vector<EnqueueTensorInfo> &getOutputInfo() { return outputInfo_; }
+
 private:
   uint32_t deviceId_;
   uint64_t topologyId_;
   std::unique_ptr<HabanaIOBuffer> ioBuffer_;
   HabanaWaitHandle handle_;
+  /// The tensors of the enqueue, kept from the time the inputs are staged
+  /// until the run is enqueued, at which point they move to handle_.
+  std::vector<EnqueueTensorInfo> inputInfo_;
+  std::vector<EnqueueTensorInfo> outputInfo_;
 };
 
 class HabanaFunction final : public CompiledFunction {
 public:
-  /// Constructor.
+  /// Constructor. The recipe files are removed with the function if
+  /// \p ownsRecipe, and kept otherwise, e.g. when they are in the recipe
+  /// cache.
   HabanaFunction(runtime::RuntimeBundle &&bundle, const std::string &recipeName,
-                 Function *F);
+                 Function *F, bool ownsRecipe = true);
 
   /// @name CompiledFunction interface
   ///@{
@@ -204,6 +220,15 @@ public:
   Error execute(ExecutionContext *context) override;
   ///@}
 
+  /// Copies the inputs of \p context into the IO buffer of its bindings and
+  /// registers its outputs there, without touching the device. This may be
+  /// done while previous runs execute on the device.
+  Error stageInputs(ExecutionContext *context);
+
+  /// Enqueues on the device the run of \p context, whose inputs were staged
+  /// with stageInputs(). The handle to wait on is set in its bindings.
+  Error enqueue(ExecutionContext *context);
+
   /// \returns the backend used to compile this function.
   std::string getCompileBackendName() const override { return "Habana"; }
 
@@ -218,6 +243,9 @@ private:
   /// Path to the saved recipe file.
   std::string recipeName_;
 
+  /// Whether the recipe files are removed with the function.
+  bool ownsRecipe_;
+
   /// List of model input placeholders.
   PlaceholderList inputs_;
 
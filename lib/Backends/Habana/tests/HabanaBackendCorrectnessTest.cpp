@@ -25,5 +25,12 @@ std::set<std::string> glow::backendTestBlacklist = {
     "groupConvTest/0",   "softmaxGradTest/0",
     "convOps/0",         "basicFCNetQuantized/0",
     "complexNet1/0",     "tinyResnet/0",
-    "maxSplatTest/0",
+    "maxSplatTest/0",    "convWinogradTest/0",
+    "convIm2ColTest/0",  "convPointwiseTest/0",
+    "convResidualReluTest/0", "convWinogradResidualClipTest/0",
+    "convPointwiseReluTest/0", "fastMathTest/0",
+    "quantizedSandwichTest/0", "poolsTest/0",
+    "reductionsTest/0", "gatherScatterTest/0", "sliceConcatTest/0",
+    "convDepthwise3x3Test/0", "convDepthwise5x5StrideTest/0",
+    "convDepthwisePointwiseTest/0", "quantizedConvDepthwiseTest/0",
 };
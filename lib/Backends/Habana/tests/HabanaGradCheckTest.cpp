@@ -27,4 +27,5 @@ std::set<std::string> glow::backendTestBlacklist = {
     "gradientCheckFCConcatTanh/0",    "gradientCheckFC/0",
     "gradientCheckSigmoid/0",         "gradientCheckRelu/0",
     "gradientCheckTranspose/0",       "gradientCheckCrossEntropyLoss/0",
-    "gradientCheckMaxPool/0",         "gradientCheckTile/0"};
+    "gradientCheckMaxPool/0",         "gradientCheckTile/0",
+    "gradientCheckLSTMUnit/0"};
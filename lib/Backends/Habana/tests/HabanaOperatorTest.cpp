@@ -39,6 +39,9 @@ std::set<std::string> glow::backendTestBlacklist = {
     "ResizeNearest_Int8/0",
     "ResizeNearest_Int16/0",
     "ResizeNearest_Int32/0",
+    "ResizeBilinear_Float/0",
+    "ResizeBilinear_Float16/0",
+    "ResizeBilinear_Int8/0",
     "pow/0",
     "replaceNaN_Float/0",
     "replaceNaN_Float16/0",
@@ -77,6 +80,7 @@ std::set<std::string> glow::backendTestBlacklist = {
     "QuantizedArgMaxNoKeepDim/0",
     "ConcatTopK/0",
     "TopK1/0",
+    "TopKWideRows/0",
     "QuantizedTopK/0",
     "GatherDataFloatIdxInt32/0",
     "GatherDataFloatIdxInt64/0",
@@ -96,6 +100,7 @@ std::set<std::string> glow::backendTestBlacklist = {
     "FP16Transpose2Dims/0",
     "BoolTranspose2Dims/0",
     "Transpose3Dims_Float16/0",
+    "Transpose6Dims/0",
     "TransposeIntoReshapeOptim/0",
     "GatherSizeT/0",
     "BatchedGather/0",
@@ -122,6 +127,7 @@ std::set<std::string> glow::backendTestBlacklist = {
     "ArithMin_int64_t/0",
     "ArithMin_float16_t/0",
     "IntMatMul/0",
+    "IntMatMulRaggedEdges/0",
     "IntBatchedArith/0",
     "convTest/0",
     "convTest_Float16/0",
@@ -150,6 +156,7 @@ std::set<std::string> glow::backendTestBlacklist = {
     "Split_Float16/0",
     "Fp16Splat/0",
     "GroupConvolution/0",
+    "ChannelwiseQuantizedConvolution/0",
     "GroupwiseQuantizedConvolution/0",
     "DilatedConvolution/0",
     "GroupDilatedConvolution/0",
@@ -189,6 +196,7 @@ std::set<std::string> glow::backendTestBlacklist = {
     "SparseLengthsSum_Float/0",
     "SparseLengthsSum_Float16/0",
     "SparseLengthsSumI8/0",
+    "SparseLengthsSumRaggedIndices/0",
     "SparseLengthsWeightedSum_1D_Float/0",
     "SparseLengthsWeightedSum_1D_Float16/0",
     "SparseLengthsWeightedSum_2D_Float16/0",
@@ -202,6 +210,8 @@ std::set<std::string> glow::backendTestBlacklist = {
     "FusedRowwiseQuantizedSparseLengthsWeightedSum_Float16_AccumFloat/0",
     "FusedRowwiseQuantizedSparseLengthsWeightedSum_Float16_AccumFloat16/0",
     "FusedRowwiseQuantizedSparseLengthsWeightedSum_ConvertedFloat16/0",
+    "FusedRowwiseQuantizedSparseLengthsWeightedSum_Float_FP16ScaleOffset/0",
+    "FusedRowwiseQuantizedSparseLengthsWeightedSum_Float_4Bit/0",
     "FusedRowwiseQuantizedSparseLengthsSum_Float16_AccumFloat/0",
     "FusedRowwiseQuantizedSparseLengthsSum_Float16_AccumFloat16/0",
     "SparseToDense/0",
@@ -217,6 +227,7 @@ std::set<std::string> glow::backendTestBlacklist = {
     "SigmoidCrossEntropyWithLogits/0",
     "insertTensorTest/0",
     "Bucketize/0",
+    "BucketizeManyBoundaries/0",
     "SoftMax/0",
     "FP16SoftMax/0",
     "LengthsToRanges/0",
@@ -234,6 +245,16 @@ std::set<std::string> glow::backendTestBlacklist = {
     "dotProduct2D_Float16/0",
     "dotProduct2D_Int8/0",
     "BatchBoxCox_Float16/0",
+    "LayerNormalization_Float16/0",
+    "BatchedPairwiseDotProduct_Float16/0",
+    "SparseLengthsMean_Float/0",
+    "SparseLengthsMean_Float16/0",
+    "SparseLengthsMax_Float/0",
+    "SparseLengthsMax_Float16/0",
+    "FusedRowwiseQuantizedSparseLengthsMean_Float/0",
+    "FusedRowwiseQuantizedSparseLengthsMean_Float16/0",
+    "FusedRowwiseQuantizedSparseLengthsMax_Float/0",
+    "FusedRowwiseQuantizedSparseLengthsMax_Float16/0",
     "ConvertFrom_FloatTy_To_Float16Ty/0",
     "ConvertFrom_FloatTy_To_Int32ITy/0",
     "ConvertFrom_FloatTy_To_Int64ITy/0",
@@ -284,6 +305,7 @@ std::set<std::string> glow::backendTestBlacklist = {
     "Int8Log/0",
     "Int8Sigmoid/0",
     "rowwiseQuantizedFCTest/0",
+    "DynamicQuantizedFC/0",
     "rowwiseQuantizedFCTestSymmetric/0",
     "rowwiseQuantizedSLWSTest/0",
     "Int8ConvolutionDepth10/0",
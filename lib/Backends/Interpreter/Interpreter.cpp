@@ -23,6 +23,7 @@
 #include "glow/Graph/Nodes.h"
 #include "glow/IR/IR.h"
 #include "glow/IR/Instrs.h"
+#include "glow/Optimizer/GraphOptimizerPipeline/Pipeline.h"
 #include "glow/Optimizer/IROptimizer/IROptimizer.h"
 
 using namespace glow;
@@ -63,7 +64,7 @@ Interpreter::compileIRWithoutConstants(std::unique_ptr<IRFunction> IR) const {
   MemoryAllocator activationsAllocator("Activations", 0);
   runtime::RuntimeBundle bundle = runtime::RuntimeBundle::create(
       *IR, constantWeightsAllocator, placeholderWeightsAllocator,
-      activationsAllocator);
+      activationsAllocator, shouldPlanActivationsOffline());
   return llvm::make_unique<InterpreterFunction>(std::move(IR),
                                                 std::move(bundle));
 }
@@ -89,6 +90,10 @@ bool Interpreter::isOpSupported(const NodeInfo &NI) const {
         {ElemKind::FloatTy, ElemKind::Float16Ty, ElemKind::Int8QTy,
          ElemKind::Int16QTy, ElemKind::Int32QTy});
 
+  case Kinded::Kind::ResizeBilinearNodeKind:
+    return NI.allInputsAndOutputsHaveSameElemKind(
+        {ElemKind::FloatTy, ElemKind::Float16Ty, ElemKind::Int8QTy});
+
   case Kinded::Kind::AvgPoolNodeKind:
   case Kinded::Kind::AdaptiveAvgPoolNodeKind:
   case Kinded::Kind::MatMulNodeKind:
@@ -109,6 +114,8 @@ bool Interpreter::isOpSupported(const NodeInfo &NI) const {
            (NI.getOutElemTy(ArgMaxNode::ArgmaxIdx) == ElemKind::Int64ITy);
 
   case Kinded::Kind::PowNodeKind:
+  case Kinded::Kind::LayerNormalizationNodeKind:
+  case Kinded::Kind::BatchedPairwiseDotProductNodeKind:
   case Kinded::Kind::LocalResponseNormalizationNodeKind:
   case Kinded::Kind::LogNodeKind:
   case Kinded::Kind::TanhNodeKind:
@@ -173,9 +180,15 @@ bool Interpreter::isOpSupported(const NodeInfo &NI) const {
       return NI.allInputsAndOutputsHaveSameElemKind(
           {ElemKind::FloatTy, ElemKind::Float16Ty});
     }
-    return NI.allInputsAndOutputsHaveSameElemKind(
-               {ElemKind::Int8QTy, ElemKind::Int16QTy},
-               {ConvolutionNode::BiasIdx}) &&
+    // The filter of int16 activations may be in int8.
+    return (NI.allInputsAndOutputsHaveSameElemKind(
+                {ElemKind::Int8QTy, ElemKind::Int16QTy},
+                {ConvolutionNode::BiasIdx}) ||
+            (NI.allInputsAndOutputsHaveSameElemKind(
+                 {ElemKind::Int16QTy},
+                 {ConvolutionNode::FilterIdx, ConvolutionNode::BiasIdx}) &&
+             NI.getInElemTy(ConvolutionNode::FilterIdx) ==
+                 ElemKind::Int8QTy)) &&
            (NI.getInElemTy(ConvolutionNode::BiasIdx) == ElemKind::Int32QTy);
 
   case Kinded::Kind::ChannelwiseQuantizedConvolutionNodeKind:
@@ -226,6 +239,13 @@ bool Interpreter::isOpSupported(const NodeInfo &NI) const {
            (NI.getOutElemTy(RowwiseQuantizedFullyConnectedNode::ResultIdx) ==
             ElemKind::Int8QTy);
 
+  case Kinded::Kind::DynamicQuantizedFullyConnectedNodeKind:
+    return NI.allInputsAndOutputsHaveSameElemKind(
+               {ElemKind::FloatTy},
+               {DynamicQuantizedFullyConnectedNode::WeightsIdx}) &&
+           (NI.getInElemTy(DynamicQuantizedFullyConnectedNode::WeightsIdx) ==
+            ElemKind::Int8QTy);
+
   case Kinded::Kind::SparseLengthsSumNodeKind:
     return NI.allInputsAndOutputsHaveSameElemKind(
                {ElemKind::FloatTy, ElemKind::Float16Ty, ElemKind::Int8QTy},
@@ -236,6 +256,17 @@ bool Interpreter::isOpSupported(const NodeInfo &NI) const {
            (NI.getInElemTy(SparseLengthsSumNode::LengthsIdx) ==
             ElemKind::Int32ITy);
 
+  case Kinded::Kind::SparseLengthsMeanNodeKind:
+  case Kinded::Kind::SparseLengthsMaxNodeKind:
+    return NI.allInputsAndOutputsHaveSameElemKind(
+               {ElemKind::FloatTy, ElemKind::Float16Ty},
+               {SparseLengthsMeanNode::IndicesIdx,
+                SparseLengthsMeanNode::LengthsIdx}) &&
+           (NI.getInElemTy(SparseLengthsMeanNode::IndicesIdx) ==
+            ElemKind::Int64ITy) &&
+           (NI.getInElemTy(SparseLengthsMeanNode::LengthsIdx) ==
+            ElemKind::Int32ITy);
+
   case Kinded::Kind::SparseLengthsWeightedSumNodeKind:
     return NI.allInputsAndOutputsHaveSameElemKind(
                {ElemKind::FloatTy, ElemKind::Float16Ty, ElemKind::Int8QTy},
@@ -278,6 +309,21 @@ bool Interpreter::isOpSupported(const NodeInfo &NI) const {
             ElemKind::Int32ITy);
 
   case Kinded::Kind::FusedRowwiseQuantizedSparseLengthsWeightedSumNodeKind:
+    if (NI.getInElemTy(
+            FusedRowwiseQuantizedSparseLengthsWeightedSumNode::DataIdx) ==
+        ElemKind::UInt4FusedFP16QTy) {
+      // The result of 4-bit data may have either precision.
+      ElemKind precision = NI.getOutElemTy(
+          FusedRowwiseQuantizedSparseLengthsWeightedSumNode::ResultIdx);
+      return (precision == ElemKind::FloatTy ||
+              precision == ElemKind::Float16Ty) &&
+             (NI.getInElemTy(FusedRowwiseQuantizedSparseLengthsWeightedSumNode::
+                                 WeightsIdx) == precision) &&
+             (NI.getInElemTy(FusedRowwiseQuantizedSparseLengthsWeightedSumNode::
+                                 IndicesIdx) == ElemKind::Int64ITy) &&
+             (NI.getInElemTy(FusedRowwiseQuantizedSparseLengthsWeightedSumNode::
+                                 LengthsIdx) == ElemKind::Int32ITy);
+    }
     if (NI.getInElemTy(
             FusedRowwiseQuantizedSparseLengthsWeightedSumNode::DataIdx) ==
         ElemKind::UInt8FusedFP16QTy) {
@@ -304,6 +350,57 @@ bool Interpreter::isOpSupported(const NodeInfo &NI) const {
                 FusedRowwiseQuantizedSparseLengthsWeightedSumNode::ResultIdx) ==
             ElemKind::FloatTy);
 
+  case Kinded::Kind::FusedRowwiseQuantizedSparseLengthsMeanNodeKind:
+  case Kinded::Kind::FusedRowwiseQuantizedSparseLengthsMaxNodeKind: {
+    using PoolNode = FusedRowwiseQuantizedSparseLengthsMeanNode;
+    if ((NI.getInElemTy(PoolNode::IndicesIdx) != ElemKind::Int64ITy) ||
+        (NI.getInElemTy(PoolNode::LengthsIdx) != ElemKind::Int32ITy)) {
+      return false;
+    }
+    ElemKind precision = NI.getOutElemTy(PoolNode::ResultIdx);
+    switch (NI.getInElemTy(PoolNode::DataIdx)) {
+    case ElemKind::UInt8FusedQTy:
+      return precision == ElemKind::FloatTy;
+    case ElemKind::UInt8FusedFP16QTy:
+      return precision == ElemKind::Float16Ty;
+    case ElemKind::UInt4FusedFP16QTy:
+      return precision == ElemKind::FloatTy ||
+             precision == ElemKind::Float16Ty;
+    default:
+      return false;
+    }
+  }
+
+  case Kinded::Kind::
+      GroupedFusedRowwiseQuantizedSparseLengthsWeightedSumNodeKind: {
+    using GroupedSLWS =
+        GroupedFusedRowwiseQuantizedSparseLengthsWeightedSumNode;
+    ElemKind dataKind = NI.getInElemTy(GroupedSLWS::DataIdx);
+    ElemKind precision = NI.getOutElemTy(GroupedSLWS::ResultIdx);
+    switch (dataKind) {
+    case ElemKind::UInt8FusedQTy:
+      if (precision != ElemKind::FloatTy) {
+        return false;
+      }
+      break;
+    case ElemKind::UInt8FusedFP16QTy:
+      if (precision != ElemKind::Float16Ty) {
+        return false;
+      }
+      break;
+    case ElemKind::UInt4FusedFP16QTy:
+      if (precision != ElemKind::FloatTy && precision != ElemKind::Float16Ty) {
+        return false;
+      }
+      break;
+    default:
+      return false;
+    }
+    return (NI.getInElemTy(GroupedSLWS::WeightsIdx) == precision) &&
+           (NI.getInElemTy(GroupedSLWS::IndicesIdx) == ElemKind::Int64ITy) &&
+           (NI.getInElemTy(GroupedSLWS::LengthsIdx) == ElemKind::Int32ITy);
+  }
+
   case Kinded::Kind::LengthsRangeFillNodeKind:
   case Kinded::Kind::LengthsToRangesNodeKind:
     return NI.allInputsAndOutputsHaveSameElemKind({ElemKind::Int32ITy});
@@ -426,6 +523,14 @@ bool Interpreter::isOpSupported(const NodeInfo &NI) const {
            (NI.getInElemTy(SparseToDenseNode::IndicesIdx) ==
             ElemKind::Int64ITy);
 
+  case Kinded::Kind::BucketizeNodeKind:
+    return (NI.getInElemTy(BucketizeNode::InputIdx) == ElemKind::FloatTy) &&
+           (NI.getOutElemTy(BucketizeNode::ResultIdx) == ElemKind::Int32ITy);
+
+  case Kinded::Kind::BatchBoxCoxNodeKind:
+    return NI.allInputsAndOutputsHaveSameElemKind(
+        {ElemKind::FloatTy, ElemKind::Float16Ty});
+
   case Kinded::Kind::SparseToDenseMaskNodeKind:
     return (NI.getInElemTy(SparseToDenseMaskNode::IndicesIdx) ==
             ElemKind::Int64ITy) &&
@@ -522,18 +627,6 @@ bool Interpreter::verify(const Function &F) const {
     if (!checkNoFusionForNode(N)) {
       return false;
     }
-    switch (N.getKind()) {
-    case Kinded::Kind::ChannelwiseQuantizedConvolutionNodeKind: {
-      auto *CQCI = llvm::cast<ChannelwiseQuantizedConvolutionNode>(&N);
-      if (!CQCI->getGroupwise()) {
-        report("Glow Interpreter does not support Non-groupwise variant");
-        return false;
-      }
-      continue;
-    }
-    default:
-      continue;
-    }
   }
   return true;
 }
@@ -563,18 +656,6 @@ bool Interpreter::verify(const IRFunction &IR) const {
     if (!checkLayoutForInstr(I)) {
       return false;
     }
-    switch (I.getKind()) {
-    case Kinded::Kind::ChannelwiseQuantizedConvolutionInstKind: {
-      auto *CQCI = llvm::cast<ChannelwiseQuantizedConvolutionInst>(&I);
-      if (!CQCI->getGroupwise()) {
-        report("Glow Interpreter does not support Non-groupwise variant");
-        return false;
-      }
-      continue;
-    }
-    default:
-      continue;
-    }
   }
   return true;
 }
@@ -583,9 +664,23 @@ bool Interpreter::shouldLower(const Node *N) const {
   switch (N->getKind()) {
   case Kinded::Kind::ConvolutionNodeKind:
   case Kinded::Kind::SparseLengthsSumNodeKind:
+  case Kinded::Kind::SparseLengthsMeanNodeKind:
+  case Kinded::Kind::FusedRowwiseQuantizedSparseLengthsMeanNodeKind:
   case Kinded::Kind::ChannelwiseQuantizedConvolutionNodeKind:
+  case Kinded::Kind::
+      GroupedFusedRowwiseQuantizedSparseLengthsWeightedSumNodeKind:
+  case Kinded::Kind::BucketizeNodeKind:
+  case Kinded::Kind::BatchBoxCoxNodeKind:
+  case Kinded::Kind::LayerNormalizationNodeKind:
+  case Kinded::Kind::BatchedPairwiseDotProductNodeKind:
     return false;
   default:
     return true;
   }
 }
+
+FunctionPassPipeline Interpreter::getOptimizationPipeline() const {
+  auto pipeline = Backend::getOptimizationPipeline();
+  pipeline.pushFront({FunctionPassID::GroupFusedRowwiseQuantizedSLWS});
+  return pipeline;
+}
@@ -54,6 +54,10 @@ public:
 
   bool shouldLower(const Node *N) const override;
 
+  FunctionPassPipeline getOptimizationPipeline() const override;
+
+  bool shouldPlanActivationsOffline() const override { return true; }
+
   /// @}
   //
   /// \returns the size of metrics collected for a single TraceEvent.
@@ -15,6 +15,7 @@
  */
 #include "InterpreterDeviceManager.h"
 #include "Interpreter.h"
+#include "InterpreterFunction.h"
 
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/FormatVariadic.h"
@@ -26,10 +27,28 @@ static llvm::cl::opt<unsigned> interpreterMaxMem(
     "interpreter-memory",
     llvm::cl::desc("Interpreter DeviceManager maximum memory in kilobytes"),
     llvm::cl::init(0), llvm::cl::cat(InterpreterBackendCat));
+static llvm::cl::opt<unsigned> interpreterIntraOpThreads(
+    "interpreter-intra-op-threads",
+    llvm::cl::desc("Number of threads used by an Interpreter DeviceManager to "
+                   "execute the kernels of a single inference"),
+    llvm::cl::init(1), llvm::cl::cat(InterpreterBackendCat));
 
 namespace glow {
 namespace runtime {
 
+unsigned
+InterpreterDeviceManager::getNumIntraOpThreads(const DeviceConfig &config) {
+  auto it = config.parameters.find("intraOpThreads");
+  if (it != config.parameters.end()) {
+    unsigned numThreads;
+    if (!llvm::StringRef(it->second).getAsInteger(10, numThreads)) {
+      return std::max(1u, numThreads);
+    }
+    LOG(ERROR) << "Invalid intraOpThreads parameter: " << it->second;
+  }
+  return std::max(1u, unsigned(interpreterIntraOpThreads));
+}
+
 DeviceManager *createInterpreterDeviceManager(const DeviceConfig &config) {
   if (interpreterMaxMem) {
     // Convert command line interpreterMaxMem to bytes from kilobytes.
@@ -68,8 +87,6 @@ void InterpreterDeviceManager::addNetworkImpl(const Module *module,
                                               ReadyCBTy readyCB) {
   DCHECK(readyCB != nullptr);
 
-  uint64_t allFunctionsMemoryBytes{0};
-
   // First check for uniqueness of the function name.
   for (const auto &func : functions) {
     if (functions_.count(func.first) != 0) {
@@ -90,10 +107,16 @@ void InterpreterDeviceManager::addNetworkImpl(const Module *module,
                                    .str()));
       return;
     }
+  }
 
-    allFunctionsMemoryBytes +=
-        func.second->getRuntimeBundle().getConstantWeightSize();
+  // Collect the constants first, functions with identical weights share them
+  // and only need memory for them once.
+  for (const auto &func : functions) {
+    if (func.second->getRuntimeBundle().getConstants() == nullptr) {
+      func.second->collectConstants(module);
+    }
   }
+  uint64_t allFunctionsMemoryBytes = getAddedConstantsSize(functions);
 
   if (usedMemoryBytes_ + allFunctionsMemoryBytes > maxMemoryBytes_) {
     readyCB(module,
@@ -104,13 +127,12 @@ void InterpreterDeviceManager::addNetworkImpl(const Module *module,
 
   // Add to the function name lookup map.
   for (const auto &func : functions) {
-    if (func.second->getRuntimeBundle().getConstants() == nullptr) {
-      func.second->collectConstants(module);
-    }
+    usedMemoryBytes_ += addConstantsUser(func.second);
+    addNetworkMemoryUsage(
+        func.first, NetworkMemoryUsage(func.second->getRuntimeBundle()));
     functions_.emplace(func.first, func.second);
   }
 
-  usedMemoryBytes_ += allFunctionsMemoryBytes;
   assert(usedMemoryBytes_ <= maxMemoryBytes_);
 
   // Export changes to memory use.
@@ -126,7 +148,8 @@ void InterpreterDeviceManager::evictNetworkImpl(std::string functionName,
   auto it = functions_.find(functionName);
 
   if (it != functions_.end()) {
-    usedMemoryBytes_ -= it->second->getRuntimeBundle().getConstantWeightSize();
+    usedMemoryBytes_ -= removeConstantsUser(it->second);
+    removeNetworkMemoryUsage(functionName);
     functions_.erase(it);
   } else {
     evictCB(functionName,
@@ -159,8 +182,10 @@ void InterpreterDeviceManager::runFunctionImpl(
 
   CompiledFunction *func = funcIt->second;
 
-  // Run that function.
+  // Run that function, letting its kernels use the intra-op threads.
+  InterpreterFunction::setIntraOpThreadPool(intraOpPool_.get());
   auto executeErr = func->execute(context.get());
+  InterpreterFunction::setIntraOpThreadPool(nullptr);
 
   // End the TraceEvent early to avoid time in the CB.
   TRACE_EVENT_SCOPE_END_NAMED(dmRun);
@@ -24,18 +24,32 @@ namespace runtime {
 
 /// A class controlling a single "Interpreter Device", a thread of execution in
 /// the IR-Interpreter. Many InterpreterFunctions may be added, but only one
-/// inference is executed at a time.
+/// inference is executed at a time. The heaviest kernels of an inference may
+/// split their outer loops across an optional pool of intra-op worker threads.
 class InterpreterDeviceManager : public QueueBackedDeviceManager {
   /// Compiled function list by name.
   FunctionMapTy functions_;
 
+  /// Pool of threads helping the device thread execute the kernels of a
+  /// single inference. It is null if intra-op parallelism is disabled.
+  std::unique_ptr<ThreadPool> intraOpPool_;
+
   /// String constant for logging number of in-use devices.
   static constexpr const char *kDevicesUsedInterpreter =
       "glow.devices_used.interpreter";
 
+  /// \returns the number of threads (including the device thread) used to
+  /// execute a single inference, as requested by the "intraOpThreads"
+  /// parameter of \p config or the -interpreter-intra-op-threads option.
+  static unsigned getNumIntraOpThreads(const DeviceConfig &config);
+
 public:
   explicit InterpreterDeviceManager(const DeviceConfig &config)
       : QueueBackedDeviceManager(config) {
+    unsigned numThreads = getNumIntraOpThreads(config);
+    if (numThreads > 1) {
+      intraOpPool_ = llvm::make_unique<ThreadPool>(numThreads - 1);
+    }
     Stats()->incrementCounter(kDevicesUsedInterpreter);
     exportMemoryCounters();
   }
@@ -61,6 +75,11 @@ public:
   /// compute and bandwidths (used in partitioning).
   DeviceInfo getDeviceInfo() const override;
 
+  /// \returns the number of threads used to execute a single inference.
+  unsigned getNumIntraOpThreads() const {
+    return intraOpPool_ ? intraOpPool_->getNumWorkers() + 1 : 1;
+  }
+
 protected:
   void addNetworkImpl(const Module *module, FunctionMapTy functions,
                       ReadyCBTy cb) override;
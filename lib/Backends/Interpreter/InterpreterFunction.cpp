@@ -19,14 +19,68 @@
 #include "glow/IR/IR.h"
 #include "glow/IR/IRUtils.h"
 #include "glow/IR/Instrs.h"
+#include "glow/Support/ThreadPool.h"
 
 #include "llvm/Support/Casting.h"
+#include "llvm/Support/CommandLine.h"
 
 using namespace glow;
 
+static llvm::cl::opt<bool> interpreterPreallocateActivations(
+    "interpreter-preallocate-activations",
+    llvm::cl::desc("Allocate the activations of Interpreter functions once "
+                   "and reuse them across runs"),
+    llvm::cl::init(true));
+
+namespace {
+/// The intra-op pool of the current thread. Workers of the pool never have
+/// one, so nested parallel loops run serially.
+thread_local ThreadPool *intraOpPool = nullptr;
+
+/// Number of elements below which a parallel loop of a kernel runs serially,
+/// since handing it to the intra-op threads would cost more than it saves.
+constexpr size_t kMinParallelWork = 1 << 14;
+} // namespace
+
+void InterpreterFunction::setIntraOpThreadPool(ThreadPool *pool) {
+  intraOpPool = pool;
+}
+
+void BoundInterpreterFunction::parallelFor(
+    size_t numIters, size_t work,
+    llvm::function_ref<void(size_t, size_t)> body) {
+  ThreadPool *pool = intraOpPool;
+  size_t numChunks = 1;
+  if (pool && work >= kMinParallelWork) {
+    numChunks = std::min<size_t>(numIters, pool->getNumWorkers() + 1);
+  }
+  if (numChunks <= 1) {
+    body(0, numIters);
+    return;
+  }
+
+  size_t chunkSize = numIters / numChunks;
+  size_t remainder = numIters % numChunks;
+  std::vector<std::future<void>> futures;
+  futures.reserve(numChunks - 1);
+  // The first chunks get one extra iteration each to spread the remainder.
+  size_t begin = chunkSize + (remainder > 0);
+  for (size_t i = 1; i < numChunks; i++) {
+    size_t end = begin + chunkSize + (i < remainder);
+    futures.push_back(pool->submit([body, begin, end]() { body(begin, end); }));
+    begin = end;
+  }
+  body(0, chunkSize + (remainder > 0));
+  for (auto &future : futures) {
+    future.wait();
+  }
+}
+
 InterpreterFunction::InterpreterFunction(std::unique_ptr<IRFunction> F,
                                          runtime::RuntimeBundle &&bundle)
-    : CompiledFunction(std::move(bundle)), F_(std::move(F)) {}
+    : CompiledFunction(std::move(bundle)), F_(std::move(F)) {
+  BoundInterpreterFunction::decode(*F_, program_);
+}
 
 InterpreterFunction::~InterpreterFunction() {
   for (const auto &p : constants_) {
@@ -49,9 +103,37 @@ void InterpreterFunction::collectConstants(const Module *module) {
   }
 }
 
+void InterpreterFunction::freeCompilationResources() {
+  if (runtimeBundle_.getConstants() ||
+      !runtimeBundle_.getConstantWeightSize()) {
+    runtimeBundle_.eraseSymbols(runtime::SymbolCategory::Constant);
+    runtimeBundle_.eraseSymbols(runtime::SymbolCategory::ConstantTensorView);
+  }
+}
+
 Error InterpreterFunction::execute(ExecutionContext *context) {
-  BoundInterpreterFunction boundFunc(constants_);
-  auto res = boundFunc.execute(F_.get(), context);
+  // Reuse the bound function of a finished run, whose activations are
+  // already allocated. Concurrent runs each get their own.
+  std::unique_ptr<BoundInterpreterFunction> boundFunc;
+  if (interpreterPreallocateActivations) {
+    std::lock_guard<std::mutex> l(boundFuncsLock_);
+    if (!boundFuncs_.empty()) {
+      boundFunc = std::move(boundFuncs_.back());
+      boundFuncs_.pop_back();
+    }
+  }
+  if (!boundFunc) {
+    boundFunc =
+        interpreterPreallocateActivations
+            ? llvm::make_unique<BoundInterpreterFunction>(
+                  constants_, program_, F_.get(), runtimeBundle_)
+            : llvm::make_unique<BoundInterpreterFunction>(constants_, program_);
+  }
+  auto res = boundFunc->execute(F_.get(), context);
+  if (interpreterPreallocateActivations) {
+    std::lock_guard<std::mutex> l(boundFuncsLock_);
+    boundFuncs_.push_back(std::move(boundFunc));
+  }
   {
     TRACE_EVENT_SCOPE(context, TraceLevel::RUNTIME, "processInstrumentation");
     translateTraceEvents(context);
@@ -107,6 +189,24 @@ void InterpreterFunction::translateTraceEvents(
   }
 }
 
+BoundInterpreterFunction::BoundInterpreterFunction(
+    const std::unordered_map<std::string, Tensor *> &constants,
+    const InterpreterProgram &program, const IRFunction *F,
+    const runtime::RuntimeBundle &bundle)
+    : constants_(constants), program_(program),
+      slots_(program.slots.size(), nullptr), persistent_(true) {
+  if (bundle.getActivationsSize()) {
+    activations_ = reinterpret_cast<uint8_t *>(
+        alignedAlloc(bundle.getActivationsSize(), TensorAlignment));
+  }
+  for (const auto &I : F->getInstrs()) {
+    if (auto *A = llvm::dyn_cast<AllocActivationInst>(&I)) {
+      auto &symbol = bundle.getSymbolInfo(A);
+      tensors_[A] = new Tensor(activations_ + symbol.offset, A->getType());
+    }
+  }
+}
+
 BoundInterpreterFunction::~BoundInterpreterFunction() {
   // Delete the tensors that are owned by this backend.
   for (const auto &p : tensors_) {
@@ -114,31 +214,64 @@ BoundInterpreterFunction::~BoundInterpreterFunction() {
   }
   tensors_.clear();
   externalTensors_.clear();
+  alignedFree(activations_);
+}
+
+Tensor *BoundInterpreterFunction::findConstant(const Value *v) const {
+  if (persistent_) {
+    auto it = constantCache_.find(v);
+    if (it != constantCache_.end()) {
+      return it->second;
+    }
+  }
+  auto ic = constants_.find(std::string(v->getName()));
+  Tensor *T = ic != constants_.end() ? ic->second : nullptr;
+  if (persistent_) {
+    constantCache_[v] = T;
+  }
+  return T;
 }
 
 Tensor *BoundInterpreterFunction::getTensor(const Value *v) const {
+  // The tensors of the operands of the current instruction are looked up
+  // once per slot.
+  if (current_) {
+    for (unsigned i = current_->firstOperand,
+                  e = current_->firstOperand + current_->numOperands;
+         i < e; i++) {
+      if (program_.operands[i] == v) {
+        Tensor *&T = slots_[program_.operandSlots[i]];
+        if (!T) {
+          T = lookupTensor(v);
+        }
+        return T;
+      }
+    }
+  }
+  return lookupTensor(v);
+}
+
+Tensor *BoundInterpreterFunction::lookupTensor(const Value *v) const {
   auto it = tensors_.find(v);
   if (it != tensors_.end()) {
     return it->second;
   }
-  auto ic = constants_.find(std::string(v->getName()));
-  if (ic != constants_.end()) {
-    return ic->second;
+  if (auto *T = findConstant(v)) {
+    return T;
   }
 
   auto ie = externalTensors_.find(v);
-  assert(ie != externalTensors_.end() && "Unknown key Value.");
+  assert(ie != externalTensors_.end() && ie->second && "Unknown key Value.");
   return ie->second;
 }
 
 Tensor *BoundInterpreterFunction::getOrCreateTensor(const Value *v) {
   auto ie = externalTensors_.find(v);
-  if (ie != externalTensors_.end()) {
+  if (ie != externalTensors_.end() && ie->second) {
     return ie->second;
   }
-  auto ic = constants_.find(std::string(v->getName()));
-  if (ic != constants_.end()) {
-    return ic->second;
+  if (auto *T = findConstant(v)) {
+    return T;
   }
 
   // Pick the tensor.
@@ -146,6 +279,7 @@ Tensor *BoundInterpreterFunction::getOrCreateTensor(const Value *v) {
   if (it == tensors_.end()) {
     auto *T = new Tensor(v->getType());
     tensors_[v] = T;
+    resetSlot(v);
     return T;
   }
   return it->second;
@@ -158,6 +292,13 @@ Tensor *BoundInterpreterFunction::getOrCreateUnownedTensor(
   // Pick the tensor.
   auto it = tensors_.find(v);
 
+  // A persistent bound function points its view at the source of this run.
+  if (it != tensors_.end() && persistent_) {
+    *it->second = getTensor(src)->getUnowned(v->dims(), offsets);
+    it->second->setType(v->getType());
+    return it->second;
+  }
+
   // Release unowned tensors before re-creating them.
   if (it != tensors_.end()) {
     deleteTensor(v);
@@ -165,11 +306,18 @@ Tensor *BoundInterpreterFunction::getOrCreateUnownedTensor(
 
   auto *T = new Tensor();
   *T = getTensor(src)->getUnowned(v->dims(), offsets);
+  // The view may differ from its source in its quantization parameters.
+  T->setType(v->getType());
   tensors_[v] = T;
+  resetSlot(v);
   return T;
 }
 
 void BoundInterpreterFunction::deleteTensor(const Value *v) {
+  // The activations of a persistent bound function live until it does.
+  if (persistent_) {
+    return;
+  }
   auto it = tensors_.find(v);
   if (it == tensors_.end()) {
     return;
@@ -177,6 +325,49 @@ void BoundInterpreterFunction::deleteTensor(const Value *v) {
 
   delete it->second;
   tensors_.erase(it);
+  resetSlot(v);
+}
+
+void BoundInterpreterFunction::resetSlot(const Value *v) {
+  auto it = program_.slots.find(v);
+  if (it != program_.slots.end()) {
+    slots_[it->second] = nullptr;
+  }
+}
+
+template <class InstrTy, void (BoundInterpreterFunction::*fwd)(const InstrTy *)>
+void BoundInterpreterFunction::dispatch(BoundInterpreterFunction &BF,
+                                        const Instruction *I) {
+  (BF.*fwd)(static_cast<const InstrTy *>(I));
+}
+
+void BoundInterpreterFunction::decode(const IRFunction &F,
+                                      InterpreterProgram &program) {
+  for (const auto &I : F.getInstrs()) {
+    InterpreterProgram::Handler handler = nullptr;
+#define DEF_VALUE(CLASS, NAME)
+#define DEF_INSTR(CLASS, NAME)                                                 \
+  case Kinded::Kind::CLASS##Kind:                                              \
+    handler = &dispatch<CLASS, &BoundInterpreterFunction::fwd##CLASS>;         \
+    break;
+#define DEF_BACKEND_SPECIFIC_INSTR(CLASS, NAME)
+    switch (I.getKind()) {
+#include "glow/AutoGenInstr.def"
+
+    default:
+      llvm_unreachable("Invalid instruction.");
+    }
+
+    unsigned firstOperand = program.operands.size();
+    for (const auto &op : I.getOperands()) {
+      unsigned slot = program.slots.size();
+      slot = program.slots.emplace(op.first, slot).first->second;
+      program.operands.push_back(op.first);
+      program.operandSlots.push_back(slot);
+    }
+    program.instrs.push_back(
+        {handler, &I, firstOperand, unsigned(I.getNumOperands())});
+  }
 }
 
 Error BoundInterpreterFunction::execute(IRFunction *F,
@@ -191,12 +382,17 @@ Error BoundInterpreterFunction::execute(IRFunction *F,
         virtualPadded.push_back(ph.first);
       }
     }
-    // Replace all virtually padded tensors with real padding tensors.
+    // Replace all virtually padded tensors with real padding tensors, whose
+    // padding is zeroed unless their placeholder is ragged.
     for (auto &ph : virtualPadded) {
       auto oldTensor = context->getPlaceholderBindings()->get(ph);
       Tensor paddedTensor(oldTensor->getType());
-      memcpy(paddedTensor.getUnsafePtr(), oldTensor->getUnsafePtr(),
-             oldTensor->getUnpaddedSizeInBytes());
+      size_t numBytes = oldTensor->getUnpaddedSizeInBytes();
+      memcpy(paddedTensor.getUnsafePtr(), oldTensor->getUnsafePtr(), numBytes);
+      if (!ph->isRagged()) {
+        memset(paddedTensor.getUnsafePtr() + numBytes, 0,
+               paddedTensor.getSizeInBytes() - numBytes);
+      }
       context->getPlaceholderBindings()->erase(ph);
       context->getPlaceholderBindings()->insert(ph, std::move(paddedTensor));
     }
@@ -204,39 +400,37 @@ Error BoundInterpreterFunction::execute(IRFunction *F,
     for (auto &ph : context->getPlaceholderBindings()->pairs()) {
       auto *w = F->getWeightForNode(ph.first);
       // If the Placeholder has been aliased to the same Weight, just skip it.
-      if (externalTensors_.count(w)) {
+      auto &T = externalTensors_[w];
+      if (T) {
         continue;
       }
 
-      externalTensors_[w] = ph.second;
+      T = ph.second;
+      resetSlot(w);
     }
   }
 
-// Do the forward pass.
-#define DEF_VALUE(CLASS, NAME)
-#define DEF_INSTR(CLASS, NAME)                                                 \
-  case Kinded::Kind::CLASS##Kind: {                                            \
-    fwd##CLASS(llvm::cast<CLASS>(&I));                                         \
-    break;                                                                     \
-  }
-#define DEF_BACKEND_SPECIFIC_INSTR(CLASS, NAME)
-  // Dispatch the interpreter on each instruction in the program:
-  for (const auto &I : F->getInstrs()) {
-    switch (I.getKind()) {
-#include "glow/AutoGenInstr.def"
-
-    default:
-      llvm_unreachable("Invalid instruction.");
-    }
+  // Do the forward pass, dispatching each decoded instruction to its
+  // handler.
+  for (const auto &instr : program_.instrs) {
+    current_ = &instr;
+    instr.handler(*this, instr.I);
   }
+  current_ = nullptr;
 
   {
 
     TRACE_EVENT_SCOPE(context, TraceLevel::RUNTIME, "eraseTensors");
     // Remove the concrete tensors that back the placeholder tensors.
+    // A persistent bound function keeps the entries for the next run.
     for (auto &ph : context->getPlaceholderBindings()->pairs()) {
       auto *w = F->getWeightForNode(ph.first);
-      externalTensors_.erase(w);
+      if (persistent_) {
+        externalTensors_[w] = nullptr;
+      } else {
+        externalTensors_.erase(w);
+      }
+      resetSlot(w);
     }
   }
 
@@ -24,9 +24,12 @@
 #include "glow/Quantization/Base/Base.h"
 
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/STLExtras.h"
 
 #include <memory>
+#include <mutex>
 #include <unordered_map>
+#include <vector>
 
 namespace glow {
 
@@ -34,6 +37,9 @@ class IRFunction;
 class Value;
 class Tensor;
 class Constant;
+class Instruction;
+class BoundInterpreterFunction;
+class ThreadPool;
 
 // Forward declare all of the classes.
 #define DEF_VALUE(CLASS, NAME) class CLASS;
@@ -41,14 +47,52 @@ class Constant;
 #define DEF_BACKEND_SPECIFIC_INSTR(CLASS, NAME)
 #include "glow/AutoGenInstr.def"
 
+/// The instructions of an IRFunction decoded once for their execution by the
+/// interpreter: the handler of each instruction and the slots of its
+/// operands, so that the runs neither switch on the kinds of the instructions
+/// nor look up the tensors of their operands by value each time.
+struct InterpreterProgram {
+  /// Executes an instruction for a bound function.
+  using Handler = void (*)(BoundInterpreterFunction &, const Instruction *);
+
+  /// A decoded instruction, whose operands are the \p numOperands ones from
+  /// \p firstOperand in operands.
+  struct Instr {
+    Handler handler;
+    const Instruction *I;
+    unsigned firstOperand;
+    unsigned numOperands;
+  };
+
+  /// The instructions, in order.
+  std::vector<Instr> instrs;
+
+  /// The operands of all the instructions and the slots of their values.
+  std::vector<const Value *> operands;
+  std::vector<unsigned> operandSlots;
+
+  /// Maps the values used as operands to their slots.
+  std::unordered_map<const Value *, unsigned> slots;
+};
+
 /// Function "compiled" for execution by the interpreter.
 class InterpreterFunction final : public CompiledFunction {
   /// The IR to be executed.
   std::unique_ptr<IRFunction> F_;
 
+  /// The instructions of F_, decoded.
+  InterpreterProgram program_;
+
   /// Maps Value.name to tensors for constants.
   std::unordered_map<std::string, Tensor *> constants_;
 
+  /// The bound functions of finished runs, which own preallocated
+  /// activations and are reused by the next runs.
+  std::vector<std::unique_ptr<BoundInterpreterFunction>> boundFuncs_;
+
+  /// Mutex around boundFuncs_.
+  std::mutex boundFuncsLock_;
+
 public:
   InterpreterFunction(std::unique_ptr<IRFunction> F,
                       runtime::RuntimeBundle &&bundle);
@@ -62,6 +106,11 @@ public:
   /// Collects constants for runtime.
   void collectConstants(const Module *module) override;
 
+  /// Erases the symbols of the constants once they are collected, as the
+  /// runs look up the tensors of the constants instead. The IR and the
+  /// symbols of the activations are kept to run the function.
+  void freeCompilationResources() override;
+
   /// Get reference to IR function.
   IRFunction *getIR() { return F_.get(); }
 
@@ -73,6 +122,10 @@ public:
     return "Interpreter";
   }
   ///@}
+
+  /// Set the pool of threads helping the current thread execute the kernels
+  /// of the InterpreterFunctions it runs, or nullptr to run them serially.
+  static void setIntraOpThreadPool(ThreadPool *pool);
 };
 
 /// An InterpreterFunction bound to a specific invocation.
@@ -86,19 +139,84 @@ class BoundInterpreterFunction {
   /// A reference to the constant map from the owning InterpreterFunction.
   const std::unordered_map<std::string, Tensor *> &constants_;
 
+  /// A reference to the decoded instructions of the owning
+  /// InterpreterFunction.
+  const InterpreterProgram &program_;
+
+  /// The tensor of each slot of program_, or null until an instruction reads
+  /// it. Reset whenever the tensor of the value of a slot changes.
+  mutable std::vector<Tensor *> slots_;
+
+  /// The instruction being executed, whose operands are resolved through
+  /// slots_.
+  const InterpreterProgram::Instr *current_{nullptr};
+
+  /// Whether the bound function is reused across runs. Its activations are
+  /// then views into activations_ created once, and the entries of its maps
+  /// are kept from one run to the next so that a run allocates nothing.
+  const bool persistent_{false};
+
+  /// The memory of all activations of a persistent bound function, laid out
+  /// as planned in the RuntimeBundle.
+  uint8_t *activations_{nullptr};
+
+  /// Maps values to their constant tensor, or to null if they are not a
+  /// constant, for a persistent bound function.
+  mutable std::unordered_map<const Value *, Tensor *> constantCache_;
+
 public:
-  explicit BoundInterpreterFunction(
-      const std::unordered_map<std::string, Tensor *> &constants)
-      : constants_(constants) {}
+  BoundInterpreterFunction(
+      const std::unordered_map<std::string, Tensor *> &constants,
+      const InterpreterProgram &program)
+      : constants_(constants), program_(program),
+        slots_(program.slots.size(), nullptr) {}
+
+  /// Creates a persistent bound function for \p F, whose activations are
+  /// allocated once at the offsets planned in \p bundle.
+  BoundInterpreterFunction(
+      const std::unordered_map<std::string, Tensor *> &constants,
+      const InterpreterProgram &program, const IRFunction *F,
+      const runtime::RuntimeBundle &bundle);
 
   ~BoundInterpreterFunction();
 
+  /// Runs the instructions of \p F, decoded in the program of the bound
+  /// function.
   Error execute(IRFunction *F, ExecutionContext *context);
 
+  /// Decodes the instructions of \p F into \p program.
+  static void decode(const IRFunction &F, InterpreterProgram &program);
+
+  /// Run \p body over the iterations [0, \p numIters), split in contiguous
+  /// chunks [begin, end) between the current thread and its intra-op pool,
+  /// see InterpreterFunction::setIntraOpThreadPool. \p work estimates the
+  /// number of elements the whole loop touches; the loops too small to pay
+  /// for the dispatch run serially. \p body may run on other threads, so it
+  /// must only access tensors through handles obtained before the loop.
+  static void parallelFor(size_t numIters, size_t work,
+                          llvm::function_ref<void(size_t, size_t)> body);
+
 private:
-  /// \returns a pointer to the tensor that is saved under \p v.
+  /// Executes the instruction \p I of type InstrTy with \p fwd on \p BF.
+  template <class InstrTy,
+            void (BoundInterpreterFunction::*fwd)(const InstrTy *)>
+  static void dispatch(BoundInterpreterFunction &BF, const Instruction *I);
+
+  /// \returns a pointer to the tensor that is saved under \p v, through its
+  /// slot if it is an operand of the current instruction.
   Tensor *getTensor(const Value *v) const;
 
+  /// \returns a pointer to the tensor that is saved under \p v, looked up by
+  /// value.
+  Tensor *lookupTensor(const Value *v) const;
+
+  /// Resets the slot of \p v, whose tensor changed.
+  void resetSlot(const Value *v);
+
+  /// \returns the constant tensor of \p v, or nullptr if \p v is not a
+  /// constant.
+  Tensor *findConstant(const Value *v) const;
+
   /// Allocate a tensor to back the value \p v. Do not allocate anything if a
   /// tensor is already allocated for \p v.
   /// \returns a tensor for \p v.
@@ -129,7 +247,8 @@ private:
 #define DEF_BACKEND_SPECIFIC_INSTR(CLASS, NAME)
 #include "glow/AutoGenInstr.def"
 
-  template <typename ElemTy, typename AccumulatorTy>
+  template <typename ElemTy, typename AccumulatorTy,
+            typename FilterTy = ElemTy>
   void fwdConvolutionInstQuantizedImpl(Value *inV, Value *outV, Value *filterV,
                                        Value *biasV,
                                        llvm::ArrayRef<unsigned_t> kernelSizes,
@@ -193,12 +312,19 @@ private:
   template <typename ElemTy>
   void fwdBatchOneHotImpl(const glow::BatchOneHotInst *I);
 
+  template <typename ElemTy>
+  void fwdBatchBoxCoxInstImpl(const glow::BatchBoxCoxInst *I);
+
   template <typename ElemTy>
   void fwdSpaceToDepthInstImpl(const glow::SpaceToDepthInst *I);
 
   template <typename ElemTy>
   void fwdResizeNearestInstImpl(const ResizeNearestInst *I);
 
+  template <typename ElemTy>
+  void fwdResizeBilinearInstFloatImpl(const ResizeBilinearInst *I);
+  void fwdResizeBilinearInstI8Impl(const ResizeBilinearInst *I);
+
   template <typename ElemTy> void fwdSigmoidInstFloatImpl(const SigmoidInst *I);
 
   template <typename ElemTy> void fwdTanhInstFloatImpl(const TanhInst *I);
@@ -206,6 +332,13 @@ private:
   template <typename ElemTy>
   void fwdCrossEntropyLossInstFloatImpl(const CrossEntropyLossInst *I);
 
+  template <typename ElemTy>
+  void fwdLayerNormalizationInstImpl(const glow::LayerNormalizationInst *I);
+
+  template <typename ElemTy>
+  void fwdBatchedPairwiseDotProductInstImpl(
+      const glow::BatchedPairwiseDotProductInst *I);
+
   template <typename ElemTy>
   void fwdLocalResponseNormalizationInstFloatImpl(
       const glow::LocalResponseNormalizationInst *I);
@@ -296,9 +429,37 @@ private:
   void fwdRowwiseQuantizedSparseLengthsWeightedSumImpl(
       const RowwiseQuantizedSparseLengthsWeightedSumInst *I);
 
-  template <typename T, typename AccumT>
+  /// Shared by the FusedRowwiseQuantizedSparseLengthsWeightedSum instruction
+  /// \p I of type InstrTy and its grouped version, where table i starts at
+  /// row \p rowOffsets[i], index \p indexOffsets[i] and segment
+  /// \p segmentOffsets[i].
+  template <typename T, typename AccumT, typename InstrTy>
   void fwdFusedRowwiseQuantizedSparseLengthsWeightedSumImpl(
-      const FusedRowwiseQuantizedSparseLengthsWeightedSumInst *I);
+      const InstrTy *I, llvm::ArrayRef<size_t> rowOffsets,
+      llvm::ArrayRef<size_t> indexOffsets,
+      llvm::ArrayRef<size_t> segmentOffsets);
+
+  template <typename InstrTy>
+  void fwdFusedRowwiseQuantizedSparseLengthsWeightedSumDispatch(
+      const InstrTy *I, llvm::ArrayRef<size_t> rowOffsets,
+      llvm::ArrayRef<size_t> indexOffsets,
+      llvm::ArrayRef<size_t> segmentOffsets);
+
+  /// Shared by the SparseLengthsMean and SparseLengthsMax instructions \p I
+  /// of type InstrTy, which compute the maxima if \p isMax is true.
+  template <typename ElemTy, typename InstrTy>
+  void fwdSparseLengthsPoolInstFloatImpl(const InstrTy *I, bool isMax);
+
+  /// Shared by the FusedRowwiseQuantizedSparseLengthsMean and
+  /// FusedRowwiseQuantizedSparseLengthsMax instructions \p I of type
+  /// InstrTy, which compute the maxima if \p isMax is true.
+  template <typename T, typename AccumT, typename InstrTy>
+  void fwdFusedRowwiseQuantizedSparseLengthsPoolImpl(const InstrTy *I,
+                                                     bool isMax);
+
+  template <typename InstrTy>
+  void fwdFusedRowwiseQuantizedSparseLengthsPoolDispatch(const InstrTy *I,
+                                                         bool isMax);
   ///@}
 };
 
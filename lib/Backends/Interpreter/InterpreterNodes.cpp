@@ -140,60 +140,60 @@ void BoundInterpreterFunction::fwdConvolutionInstFloatImpl(
 
   PaddingTLBR pdim(pads);
 
-  // For each input in the batch:
-  for (size_t n = 0; n < idim.n; n++) {
-
-    // For each group of input channels:
-    for (size_t g = 0; g < group; g++) {
+  // Each iteration of the parallel loop computes one output channel of one
+  // input in the batch.
+  size_t work = outW.size() * kdim.height * kdim.width * inCperG;
+  parallelFor(idim.n * odim.c, work, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      size_t n = i / odim.c;
+      size_t d = i % odim.c;
+      size_t g = d / outCperG;
 
-      // For each output channel in the group:
-      for (size_t d = g * outCperG; d < (g + 1) * outCperG; d++) {
-
-        // For each convolution 'jump' in the input tensor:
-        ssize_t x = -ssize_t(pdim.top);
-        for (size_t ax = 0; ax < odim.h; x += sdim.height, ax++) {
-          ssize_t y = -ssize_t(pdim.left);
-          for (size_t ay = 0; ay < odim.w; y += sdim.width, ay++) {
+      // For each convolution 'jump' in the input tensor:
+      ssize_t x = -ssize_t(pdim.top);
+      for (size_t ax = 0; ax < odim.h; x += sdim.height, ax++) {
+        ssize_t y = -ssize_t(pdim.left);
+        for (size_t ay = 0; ay < odim.w; y += sdim.width, ay++) {
 
-            // For each element in the convolution-filter:
-            float sum = 0;
-            for (size_t fx = 0; fx < kdim.height; fx++) {
-              for (size_t fy = 0; fy < kdim.width; fy++) {
-                ssize_t ox = x + fx * dilation;
-                ssize_t oy = y + fy * dilation;
+          // For each element in the convolution-filter:
+          float sum = 0;
+          for (size_t fx = 0; fx < kdim.height; fx++) {
+            for (size_t fy = 0; fy < kdim.width; fy++) {
+              ssize_t ox = x + fx * dilation;
+              ssize_t oy = y + fy * dilation;
 
-                // Ignore index access below zero (this is due to padding).
-                if (ox < 0 || oy < 0 || ox >= ssize_t(idim.h) ||
-                    oy >= ssize_t(idim.w)) {
-                  continue;
-                }
-                for (size_t fd = 0; fd < inCperG; fd++) {
-                  sum += float(
-                      filterW.at({d, fx, fy, fd}) *
-                      inW.at({n, (size_t)ox, (size_t)oy, g * inCperG + fd}));
-                }
+              // Ignore index access below zero (this is due to padding).
+              if (ox < 0 || oy < 0 || ox >= ssize_t(idim.h) ||
+                  oy >= ssize_t(idim.w)) {
+                continue;
+              }
+              for (size_t fd = 0; fd < inCperG; fd++) {
+                sum += float(
+                    filterW.at({d, fx, fy, fd}) *
+                    inW.at({n, (size_t)ox, (size_t)oy, g * inCperG + fd}));
               }
             }
+          }
 
-            sum += float(biasW.at({d}));
-            outW.at({n, ax, ay, d}) = ElemTy(sum);
-          } // W
-        }   // H
-      }     // C
-    }       // G
-  }         // N
+          sum += float(biasW.at({d}));
+          outW.at({n, ax, ay, d}) = ElemTy(sum);
+        } // W
+      }   // H
+    }
+  });
 }
 
 /// This is the quantized implementation of Convolution.
-/// For bias, we support int32 quantization.
-template <typename ElemTy, typename AccumulatorTy>
+/// For bias, we support int32 quantization. The filter of int16 activations
+/// may be in int8.
+template <typename ElemTy, typename AccumulatorTy, typename FilterTy>
 void BoundInterpreterFunction::fwdConvolutionInstQuantizedImpl(
     Value *inV, Value *outV, Value *filterV, Value *biasV,
     llvm::ArrayRef<unsigned_t> kernelSizes, llvm::ArrayRef<unsigned_t> strides,
     llvm::ArrayRef<unsigned_t> pads, size_t group, size_t dilation) {
   auto inW = getWeightHandle<ElemTy>(inV);
   auto outW = getWeightHandle<ElemTy>(outV);
-  auto filterW = getWeightHandle<ElemTy>(filterV);
+  auto filterW = getWeightHandle<FilterTy>(filterV);
   auto biasW = getWeightHandle<int32_t>(biasV);
 
   ShapeNHWC odim(outW.dims());
@@ -226,59 +226,59 @@ void BoundInterpreterFunction::fwdConvolutionInstQuantizedImpl(
   // multiplication part of the calculation.
   float matMulScale = inScale * filterScale;
 
-  // For each input in the batch:
-  for (size_t n = 0; n < idim.n; n++) {
-    // For each group of input channels:
-    for (size_t g = 0; g < group; g++) {
-
-      // For each output channel in the group:
-      for (size_t d = g * outCperG; d < (g + 1) * outCperG; d++) {
-
-        // For each convolution 'jump' in the input tensor:
-        ssize_t x = -ssize_t(pdim.top);
-        for (size_t ax = 0; ax < odim.h; x += sdim.height, ax++) {
-          ssize_t y = -ssize_t(pdim.left);
-          for (size_t ay = 0; ay < odim.w; y += sdim.width, ay++) {
+  // Each iteration of the parallel loop computes one output channel of one
+  // input in the batch.
+  size_t work = outW.size() * kdim.height * kdim.width * inCperG;
+  parallelFor(idim.n * odim.c, work, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      size_t n = i / odim.c;
+      size_t d = i % odim.c;
+      size_t g = d / outCperG;
 
-            // For each element in the convolution-filter:
-            AccumulatorTy sum = 0;
-            for (size_t fx = 0; fx < kdim.height; fx++) {
-              for (size_t fy = 0; fy < kdim.width; fy++) {
-                ssize_t ox = x + fx * dilation;
-                ssize_t oy = y + fy * dilation;
+      // For each convolution 'jump' in the input tensor:
+      ssize_t x = -ssize_t(pdim.top);
+      for (size_t ax = 0; ax < odim.h; x += sdim.height, ax++) {
+        ssize_t y = -ssize_t(pdim.left);
+        for (size_t ay = 0; ay < odim.w; y += sdim.width, ay++) {
 
-                // Ignore index access below zero (this is due to padding).
-                if (ox < 0 || oy < 0 || ox >= ssize_t(idim.h) ||
-                    oy >= ssize_t(idim.w)) {
-                  continue;
-                }
-                for (size_t fd = 0; fd < inCperG; fd++) {
+          // For each element in the convolution-filter:
+          AccumulatorTy sum = 0;
+          for (size_t fx = 0; fx < kdim.height; fx++) {
+            for (size_t fy = 0; fy < kdim.width; fy++) {
+              ssize_t ox = x + fx * dilation;
+              ssize_t oy = y + fy * dilation;
 
-                  AccumulatorTy F = filterW.at({d, fx, fy, fd});
-                  AccumulatorTy I =
-                      inW.at({n, (size_t)ox, (size_t)oy, g * inCperG + fd});
-                  // We represent the element multiplication with offset as
-                  // (value - offset).
-                  sum += (F - filterOffset) * (I - inOffset);
-                }
+              // Ignore index access below zero (this is due to padding).
+              if (ox < 0 || oy < 0 || ox >= ssize_t(idim.h) ||
+                  oy >= ssize_t(idim.w)) {
+                continue;
+              }
+              for (size_t fd = 0; fd < inCperG; fd++) {
+
+                AccumulatorTy F = filterW.at({d, fx, fy, fd});
+                AccumulatorTy I =
+                    inW.at({n, (size_t)ox, (size_t)oy, g * inCperG + fd});
+                // We represent the element multiplication with offset as
+                // (value - offset).
+                sum += (F - filterOffset) * (I - inOffset);
               }
             }
+          }
 
-            // Scale the bias to match the scale of the matrix multiplication.
-            AccumulatorTy B = std::round(float(biasW.at({d}) - biasOffset) *
-                                         (biasScale / matMulScale));
+          // Scale the bias to match the scale of the matrix multiplication.
+          AccumulatorTy B = std::round(float(biasW.at({d}) - biasOffset) *
+                                       (biasScale / matMulScale));
 
-            // Add the bias:
-            sum += B;
+          // Add the bias:
+          sum += B;
 
-            // Scale the result back to the expected destination scale.
-            outW.at({n, ax, ay, d}) = quantization::clip<AccumulatorTy, ElemTy>(
-                std::round(float(sum) * (matMulScale / outScale) + outOffset));
-          } // W
-        }   // H
-      }     // C
-    }       // G
-  }         // N
+          // Scale the result back to the expected destination scale.
+          outW.at({n, ax, ay, d}) = quantization::clip<AccumulatorTy, ElemTy>(
+              std::round(float(sum) * (matMulScale / outScale) + outOffset));
+        } // W
+      }   // H
+    }
+  });
 }
 
 void BoundInterpreterFunction::fwdConvolutionInst(const ConvolutionInst *I) {
@@ -287,6 +287,14 @@ void BoundInterpreterFunction::fwdConvolutionInst(const ConvolutionInst *I) {
   auto strides = I->getStrides();
   size_t group = I->getGroup();
 
+  if (I->getSrc()->getElementType() == ElemKind::Int16QTy &&
+      I->getFilter()->getElementType() == ElemKind::Int8QTy) {
+    fwdConvolutionInstQuantizedImpl<int16_t, int64_t, int8_t>(
+        I->getSrc(), I->getDest(), I->getFilter(), I->getBias(), kernelSizes,
+        strides, pads, group, I->getDilation());
+    return;
+  }
+
   if (I->getSrc()->getType()->isQuantizedType()) {
     dispatchQuantizedWithAccumulationImpl(
         fwdConvolutionInstQuantizedImpl, I->getSrc()->getElementType(),
@@ -401,54 +409,53 @@ void BoundInterpreterFunction::fwdConvolution3DInstFloatImpl(
 
   PaddingTLNBRF pdim(pads);
 
-  // For each input in the batch:
-  for (size_t n = 0; n < idim.n; n++) {
-
-    // For each group of input channels:
-    for (size_t ig = 0; ig < group; ig++) {
-
-      // For each output channel in the group:
-      for (size_t og = ig * outCperG; og < (ig + 1) * outCperG; og++) {
+  // Each iteration of the parallel loop computes one output channel of one
+  // input in the batch.
+  size_t work = outW.size() * kdim.height * kdim.width * kdim.depth * inCperG;
+  parallelFor(idim.n * odim.c, work, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      size_t n = i / odim.c;
+      size_t og = i % odim.c;
+      size_t ig = og / outCperG;
 
-        // For each convolution 'jump' in the input tensor:
-        ssize_t x = -ssize_t(pdim.top);
-        for (size_t ax = 0; ax < odim.h; x += sdim.height, ax++) {
-          ssize_t y = -ssize_t(pdim.left);
-          for (size_t ay = 0; ay < odim.w; y += sdim.width, ay++) {
-            ssize_t z = -ssize_t(pdim.near);
-            for (size_t az = 0; az < odim.d; z += sdim.depth, az++) {
+      // For each convolution 'jump' in the input tensor:
+      ssize_t x = -ssize_t(pdim.top);
+      for (size_t ax = 0; ax < odim.h; x += sdim.height, ax++) {
+        ssize_t y = -ssize_t(pdim.left);
+        for (size_t ay = 0; ay < odim.w; y += sdim.width, ay++) {
+          ssize_t z = -ssize_t(pdim.near);
+          for (size_t az = 0; az < odim.d; z += sdim.depth, az++) {
 
-              // For each element in the 3D convolution-filter:
-              float sum = 0;
-              for (size_t fx = 0; fx < kdim.height; fx++) {
-                for (size_t fy = 0; fy < kdim.width; fy++) {
-                  for (size_t fz = 0; fz < kdim.depth; fz++) {
-                    ssize_t ox = x + fx;
-                    ssize_t oy = y + fy;
-                    ssize_t oz = z + fz;
-
-                    // Ignore index access below zero (this is due to padding).
-                    if (ox < 0 || oy < 0 || oz < 0 || ox >= ssize_t(idim.h) ||
-                        oy >= ssize_t(idim.w) || oz >= ssize_t(idim.d)) {
-                      continue;
-                    }
-                    for (size_t fg = 0; fg < inCperG; fg++) {
-                      sum += float(filterW.at({og, fx, fy, fz, fg}) *
-                                   inW.at({n, (size_t)ox, (size_t)oy,
-                                           (size_t)oz, ig * inCperG + fg}));
-                    }
+            // For each element in the 3D convolution-filter:
+            float sum = 0;
+            for (size_t fx = 0; fx < kdim.height; fx++) {
+              for (size_t fy = 0; fy < kdim.width; fy++) {
+                for (size_t fz = 0; fz < kdim.depth; fz++) {
+                  ssize_t ox = x + fx;
+                  ssize_t oy = y + fy;
+                  ssize_t oz = z + fz;
+
+                  // Ignore index access below zero (this is due to padding).
+                  if (ox < 0 || oy < 0 || oz < 0 || ox >= ssize_t(idim.h) ||
+                      oy >= ssize_t(idim.w) || oz >= ssize_t(idim.d)) {
+                    continue;
+                  }
+                  for (size_t fg = 0; fg < inCperG; fg++) {
+                    sum += float(filterW.at({og, fx, fy, fz, fg}) *
+                                 inW.at({n, (size_t)ox, (size_t)oy,
+                                         (size_t)oz, ig * inCperG + fg}));
                   }
                 }
               }
+            }
 
-              sum += float(biasW.at({og}));
-              outW.at({n, ax, ay, az, og}) = ElemTy(sum);
-            } // D
-          }   // W
-        }     // H
-      }       // C
-    }         // G
-  }           // N
+            sum += float(biasW.at({og}));
+            outW.at({n, ax, ay, az, og}) = ElemTy(sum);
+          } // D
+        }   // W
+      }     // H
+    }
+  });
 }
 
 /// This is the quantized implementation of Convolution3D.
@@ -494,67 +501,66 @@ void BoundInterpreterFunction::fwdConvolution3DInstQuantizedImpl(
   // multiplication part of the calculation.
   float matMulScale = inScale * filterScale;
 
-  // For each input in the batch:
-  for (size_t n = 0; n < idim.n; n++) {
-
-    // For each group of input channels:
-    for (size_t ig = 0; ig < group; ig++) {
-
-      // For each output channel in the group:
-      for (size_t og = ig * outCperG; og < (ig + 1) * outCperG; og++) {
+  // Each iteration of the parallel loop computes one output channel of one
+  // input in the batch.
+  size_t work = outW.size() * kdim.height * kdim.width * kdim.depth * inCperG;
+  parallelFor(idim.n * odim.c, work, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      size_t n = i / odim.c;
+      size_t og = i % odim.c;
+      size_t ig = og / outCperG;
 
-        // For each convolution 'jump' in the input tensor:
-        ssize_t x = -ssize_t(pdim.top);
-        for (size_t ax = 0; ax < odim.h; x += sdim.height, ax++) {
-          ssize_t y = -ssize_t(pdim.left);
-          for (size_t ay = 0; ay < odim.w; y += sdim.width, ay++) {
-            ssize_t z = -ssize_t(pdim.near);
-            for (size_t az = 0; az < odim.d; z += sdim.depth, az++) {
+      // For each convolution 'jump' in the input tensor:
+      ssize_t x = -ssize_t(pdim.top);
+      for (size_t ax = 0; ax < odim.h; x += sdim.height, ax++) {
+        ssize_t y = -ssize_t(pdim.left);
+        for (size_t ay = 0; ay < odim.w; y += sdim.width, ay++) {
+          ssize_t z = -ssize_t(pdim.near);
+          for (size_t az = 0; az < odim.d; z += sdim.depth, az++) {
 
-              // For each element in the convolution-filter:
-              AccumulatorTy sum = 0;
-              for (size_t fx = 0; fx < kdim.height; fx++) {
-                for (size_t fy = 0; fy < kdim.width; fy++) {
-                  for (size_t fz = 0; fz < kdim.depth; fz++) {
-                    ssize_t ox = x + fx;
-                    ssize_t oy = y + fy;
-                    ssize_t oz = z + fz;
-
-                    // Ignore index access below zero (this is due to padding).
-                    if (ox < 0 || oy < 0 || oz < 0 || ox >= ssize_t(idim.h) ||
-                        oy >= ssize_t(idim.w) || oz >= ssize_t(idim.d)) {
-                      continue;
-                    }
-                    for (size_t fg = 0; fg < inCperG; fg++) {
-
-                      AccumulatorTy F = filterW.at({og, fx, fy, fz, fg});
-                      AccumulatorTy I = inW.at({n, (size_t)ox, (size_t)oy,
-                                                (size_t)oz, ig * inCperG + fg});
-                      // We represent the element multiplication with offset as
-                      // (value - offset).
-                      sum += (F - filterOffset) * (I - inOffset);
-                    }
+            // For each element in the convolution-filter:
+            AccumulatorTy sum = 0;
+            for (size_t fx = 0; fx < kdim.height; fx++) {
+              for (size_t fy = 0; fy < kdim.width; fy++) {
+                for (size_t fz = 0; fz < kdim.depth; fz++) {
+                  ssize_t ox = x + fx;
+                  ssize_t oy = y + fy;
+                  ssize_t oz = z + fz;
+
+                  // Ignore index access below zero (this is due to padding).
+                  if (ox < 0 || oy < 0 || oz < 0 || ox >= ssize_t(idim.h) ||
+                      oy >= ssize_t(idim.w) || oz >= ssize_t(idim.d)) {
+                    continue;
+                  }
+                  for (size_t fg = 0; fg < inCperG; fg++) {
+
+                    AccumulatorTy F = filterW.at({og, fx, fy, fz, fg});
+                    AccumulatorTy I = inW.at({n, (size_t)ox, (size_t)oy,
+                                              (size_t)oz, ig * inCperG + fg});
+                    // We represent the element multiplication with offset as
+                    // (value - offset).
+                    sum += (F - filterOffset) * (I - inOffset);
                   }
                 }
               }
+            }
 
-              // Scale the bias to match the scale of the matrix multiplication.
-              AccumulatorTy B = std::round(float(biasW.at({og}) - biasOffset) *
-                                           (biasScale / matMulScale));
+            // Scale the bias to match the scale of the matrix multiplication.
+            AccumulatorTy B = std::round(float(biasW.at({og}) - biasOffset) *
+                                         (biasScale / matMulScale));
 
-              // Add the bias:
-              sum += B;
+            // Add the bias:
+            sum += B;
 
-              // Scale the result back to the expected destination scale.
-              outW.at({n, ax, ay, az, og}) =
-                  quantization::clip<AccumulatorTy, ElemTy>(std::round(
-                      float(sum) * (matMulScale / outScale) + outOffset));
-            } // D
-          }   // W
-        }     // H
-      }       // C
-    }         // G
-  }           // N
+            // Scale the result back to the expected destination scale.
+            outW.at({n, ax, ay, az, og}) =
+                quantization::clip<AccumulatorTy, ElemTy>(std::round(
+                    float(sum) * (matMulScale / outScale) + outOffset));
+          } // D
+        }   // W
+      }     // H
+    }
+  });
 }
 
 void BoundInterpreterFunction::fwdConvolution3DInst(
@@ -622,63 +628,64 @@ void BoundInterpreterFunction::fwdChannelwiseQuantizedConvolutionInst(
   int32_t inOffset = inTy.getOffset();
   int32_t outOffset = outTy.getOffset();
 
-  // For each input in the batch:
-  for (size_t n = 0; n < idim.n; n++) {
-    // For each group of input channels:
-    for (size_t g = 0; g < group; g++) {
-
-      // get groupwise qparams params
-      int32_t filterOffset = offsetsW.at(g);
-      float filterScale = scalesW.at(g);
+  // Each iteration of the parallel loop computes one output channel of one
+  // input in the batch.
+  size_t work = outW.size() * kdim.height * kdim.width * inCperG;
+  parallelFor(idim.n * odim.c, work, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      size_t n = i / odim.c;
+      size_t d = i % odim.c;
+      size_t g = d / outCperG;
+
+      // get groupwise or channelwise qparams params
+      size_t q = I->getGroupwise() ? g : d;
+      int32_t filterOffset = offsetsW.at(q);
+      float filterScale = scalesW.at(q);
       float matMulScale = inScale * filterScale;
 
-      // For each output channel in the group:
-      for (size_t d = g * outCperG; d < (g + 1) * outCperG; d++) {
-
-        // For each convolution 'jump' in the input tensor:
-        ssize_t x = -ssize_t(pdim.top);
-        for (size_t ax = 0; ax < odim.h; x += sdim.height, ax++) {
-          ssize_t y = -ssize_t(pdim.left);
-          for (size_t ay = 0; ay < odim.w; y += sdim.width, ay++) {
-
-            // For each element in the convolution-filter:
-            AccumulatorTy sum = 0;
-            for (size_t fx = 0; fx < kdim.height; fx++) {
-              for (size_t fy = 0; fy < kdim.width; fy++) {
-                ssize_t ox = x + fx;
-                ssize_t oy = y + fy;
+      // For each convolution 'jump' in the input tensor:
+      ssize_t x = -ssize_t(pdim.top);
+      for (size_t ax = 0; ax < odim.h; x += sdim.height, ax++) {
+        ssize_t y = -ssize_t(pdim.left);
+        for (size_t ay = 0; ay < odim.w; y += sdim.width, ay++) {
 
-                // Ignore index access below zero (this is due to padding).
-                if (ox < 0 || oy < 0 || ox >= ssize_t(idim.h) ||
-                    oy >= ssize_t(idim.w)) {
-                  continue;
-                }
-                for (size_t fd = 0; fd < inCperG; fd++) {
+          // For each element in the convolution-filter:
+          AccumulatorTy sum = 0;
+          for (size_t fx = 0; fx < kdim.height; fx++) {
+            for (size_t fy = 0; fy < kdim.width; fy++) {
+              ssize_t ox = x + fx;
+              ssize_t oy = y + fy;
 
-                  AccumulatorTy F = filterW.at({d, fx, fy, fd});
-                  AccumulatorTy I =
-                      inW.at({n, (size_t)ox, (size_t)oy, g * inCperG + fd});
-                  // We represent the element multiplication with offset as
-                  // (value - offset).
-                  sum += (F - filterOffset) * (I - inOffset);
-                }
+              // Ignore index access below zero (this is due to padding).
+              if (ox < 0 || oy < 0 || ox >= ssize_t(idim.h) ||
+                  oy >= ssize_t(idim.w)) {
+                continue;
+              }
+              for (size_t fd = 0; fd < inCperG; fd++) {
+
+                AccumulatorTy F = filterW.at({d, fx, fy, fd});
+                AccumulatorTy I =
+                    inW.at({n, (size_t)ox, (size_t)oy, g * inCperG + fd});
+                // We represent the element multiplication with offset as
+                // (value - offset).
+                sum += (F - filterOffset) * (I - inOffset);
               }
             }
+          }
 
-            // Scale the bias to match the scale of the matrix multiplication.
-            AccumulatorTy B = std::round(biasW.at({d}) / matMulScale);
+          // Scale the bias to match the scale of the matrix multiplication.
+          AccumulatorTy B = std::round(biasW.at({d}) / matMulScale);
 
-            // Add the bias:
-            sum += B;
+          // Add the bias:
+          sum += B;
 
-            // Scale the result back to the expected destination scale.
-            outW.at({n, ax, ay, d}) = quantization::clip<AccumulatorTy, int8_t>(
-                std::round(float(sum) * (matMulScale / outScale) + outOffset));
-          } // W
-        }   // H
-      }     // C
-    }       // G
-  }         // N
+          // Scale the result back to the expected destination scale.
+          outW.at({n, ax, ay, d}) = quantization::clip<AccumulatorTy, int8_t>(
+              std::round(float(sum) * (matMulScale / outScale) + outOffset));
+        } // W
+      }   // H
+    }
+  });
 }
 
 //===----------------------------------------------------------------------===//
@@ -701,53 +708,57 @@ static void fwdMaxPool(Tensor *inW, Tensor *outW, Tensor *argmaxW,
   if (argmaxW) {
     argmaxH = argmaxW->getHandle<int64_t>();
   }
-  // For each input in the batch:
-  for (size_t n = 0; n < odim.n; n++) {
-
-    // For each layer in the output tensor:
-    for (size_t z = 0; z < idim.c; z++) {
-      // For each convolution 'jump' in the input tensor:
-      ssize_t x = -ssize_t(pdim.top);
-      for (size_t ax = 0; ax < odim.h; x += sdim.height, ax++) {
-        ssize_t y = -ssize_t(pdim.left);
-        for (size_t ay = 0; ay < odim.w; y += sdim.width, ay++) {
-
-          bool first = true;
-          T max_value = 0;
-          int64_t argmaxNHWC = 0;
+  // Each iteration of the parallel loop computes one layer of the output
+  // tensor for one input in the batch.
+  BoundInterpreterFunction::parallelFor(
+      odim.n * idim.c, outHandle.size() * kdim.height * kdim.width,
+      [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+          size_t n = i / idim.c;
+          size_t z = i % idim.c;
+          // For each convolution 'jump' in the input tensor:
+          ssize_t x = -ssize_t(pdim.top);
+          for (size_t ax = 0; ax < odim.h; x += sdim.height, ax++) {
+            ssize_t y = -ssize_t(pdim.left);
+            for (size_t ay = 0; ay < odim.w; y += sdim.width, ay++) {
+
+              bool first = true;
+              T max_value = 0;
+              int64_t argmaxNHWC = 0;
 
-          for (size_t fx = 0; fx < kdim.height; fx++) {
-            for (size_t fy = 0; fy < kdim.width; fy++) {
-              ssize_t ox = x + fx;
-              ssize_t oy = y + fy;
+              for (size_t fx = 0; fx < kdim.height; fx++) {
+                for (size_t fy = 0; fy < kdim.width; fy++) {
+                  ssize_t ox = x + fx;
+                  ssize_t oy = y + fy;
 
-              // Ignore index access below zero (this is due to padding).
-              if (ox < 0 || oy < 0 || ox >= ssize_t(idim.h) ||
-                  oy >= ssize_t(idim.w)) {
-                continue;
-              }
+                  // Ignore index access below zero (this is due to padding).
+                  if (ox < 0 || oy < 0 || ox >= ssize_t(idim.h) ||
+                      oy >= ssize_t(idim.w)) {
+                    continue;
+                  }
 
-              T val = inHandle.at({n, (size_t)ox, (size_t)oy, z});
-              if (first || (val >= max_value)) {
-                first = false;
-                max_value = val;
-                if (argmaxW) {
-                  argmaxNHWC = &inHandle.at({n, (size_t)ox, (size_t)oy, z}) -
-                               &inHandle.raw(0);
+                  T val = inHandle.at({n, (size_t)ox, (size_t)oy, z});
+                  if (first || (val >= max_value)) {
+                    first = false;
+                    max_value = val;
+                    if (argmaxW) {
+                      argmaxNHWC =
+                          &inHandle.at({n, (size_t)ox, (size_t)oy, z}) -
+                          &inHandle.raw(0);
+                    }
+                  }
                 }
               }
-            }
-          }
 
-          outHandle.at({n, ax, ay, z}) = max_value;
+              outHandle.at({n, ax, ay, z}) = max_value;
 
-          if (argmaxW) {
-            (*argmaxH).at({n, ax, ay, z}) = argmaxNHWC;
-          }
-        } // W
-      }   // H
-    }     // C
-  }       // N
+              if (argmaxW) {
+                (*argmaxH).at({n, ax, ay, z}) = argmaxNHWC;
+              }
+            } // W
+          }   // H
+        }
+      });
 }
 
 void BoundInterpreterFunction::fwdMaxPoolInst(const MaxPoolInst *I) {
@@ -800,10 +811,13 @@ void BoundInterpreterFunction::fwdAvgPoolInstFloatImpl(const AvgPoolInst *I) {
   auto inW = getWeightHandle<ElemTy>(I->getSrc());
   auto outW = getWeightHandle<ElemTy>(I->getDest());
 
-  // For each input in the batch:
-  for (size_t n = 0; n < odim.n; n++) {
-    // For each layer in the output tensor:
-    for (size_t z = 0; z < idim.c; z++) {
+  // Each iteration of the parallel loop computes one layer of the output
+  // tensor for one input in the batch.
+  size_t work = outW.size() * kdim.height * kdim.width;
+  parallelFor(odim.n * idim.c, work, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      size_t n = i / idim.c;
+      size_t z = i % idim.c;
       // For each convolution 'jump' in the input tensor:
       ssize_t x = -ssize_t(pdim.top);
       for (size_t ax = 0; ax < odim.h; x += sdim.height, ax++) {
@@ -828,8 +842,8 @@ void BoundInterpreterFunction::fwdAvgPoolInstFloatImpl(const AvgPoolInst *I) {
           outW.at({n, ax, ay, z}) = ElemTy(sum / filterArea);
         } // W
       }   // H
-    }     // C
-  }       // N
+    }
+  });
 }
 
 void BoundInterpreterFunction::fwdAvgPoolInstI8Impl(const AvgPoolInst *I) {
@@ -850,10 +864,13 @@ void BoundInterpreterFunction::fwdAvgPoolInstI8Impl(const AvgPoolInst *I) {
   TensorQuantizationParams outQP{I->getDest()->getType()->getScale(),
                                  I->getDest()->getType()->getOffset()};
 
-  // For each input in the batch:
-  for (size_t n = 0; n < odim.n; n++) {
-    // For each layer in the output tensor:
-    for (size_t z = 0; z < idim.c; z++) {
+  // Each iteration of the parallel loop computes one layer of the output
+  // tensor for one input in the batch.
+  size_t work = outW.size() * kdim.height * kdim.width;
+  parallelFor(odim.n * idim.c, work, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      size_t n = i / idim.c;
+      size_t z = i % idim.c;
       // For each convolution 'jump' in the input tensor:
       ssize_t x = -ssize_t(pdim.top);
       for (size_t ax = 0; ax < odim.h; x += sdim.height, ax++) {
@@ -881,8 +898,8 @@ void BoundInterpreterFunction::fwdAvgPoolInstI8Impl(const AvgPoolInst *I) {
                          outQP.offset));
         } // W
       }   // H
-    }     // C
-  }       // N
+    }
+  });
 }
 
 void BoundInterpreterFunction::fwdAvgPoolInst(const AvgPoolInst *I) {
@@ -1694,6 +1711,47 @@ void BoundInterpreterFunction::fwdBatchOneHotInst(
   }
 }
 
+void BoundInterpreterFunction::fwdBucketizeInst(const BucketizeInst *I) {
+  auto srcH = getWeightHandle<float>(I->getSrc());
+  auto destH = getWeightHandle<int32_t>(I->getDest());
+  // The number of the boundaries lower than or equal to a value doesn't
+  // depend on their order.
+  std::vector<float> boundaries = I->getBoundaries();
+  std::sort(boundaries.begin(), boundaries.end());
+  for (size_t i = 0, e = srcH.size(); i < e; i++) {
+    destH.raw(i) = std::upper_bound(boundaries.begin(), boundaries.end(),
+                                    srcH.raw(i)) -
+                   boundaries.begin();
+  }
+}
+
+template <typename ElemTy>
+void BoundInterpreterFunction::fwdBatchBoxCoxInstImpl(
+    const glow::BatchBoxCoxInst *I) {
+  auto srcH = getWeightHandle<ElemTy>(I->getSrc());
+  auto lambda1H = getWeightHandle<ElemTy>(I->getLambda1());
+  auto lambda2H = getWeightHandle<ElemTy>(I->getLambda2());
+  auto destH = getWeightHandle<ElemTy>(I->getDest());
+  const float epsilon = I->getEpsilon();
+
+  for (size_t i = 0, rows = srcH.dims()[0]; i < rows; i++) {
+    for (size_t j = 0, cols = srcH.dims()[1]; j < cols; j++) {
+      const float l1 = float(lambda1H.at({j}));
+      const float x =
+          std::max(float(srcH.at({i, j})) + float(lambda2H.at({j})), 1e-6f);
+      // Like the lowering of the node, divide by lambda1 + epsilon.
+      destH.at({i, j}) = l1 == 0 ? std::log(x)
+                                 : (std::pow(x, l1) - 1.0f) / (l1 + epsilon);
+    }
+  }
+}
+
+void BoundInterpreterFunction::fwdBatchBoxCoxInst(
+    const glow::BatchBoxCoxInst *I) {
+  dispatchFloatingPointImpl(fwdBatchBoxCoxInstImpl,
+                            I->getSrc()->getElementType(), I);
+}
+
 template <typename ElemTy>
 void BoundInterpreterFunction::fwdSpaceToDepthInstImpl(
     const glow::SpaceToDepthInst *I) {
@@ -1784,6 +1842,99 @@ void BoundInterpreterFunction::fwdResizeNearestInst(
                             I->getSrc()->getElementType(), I);
 }
 
+/// Computes the input coordinate of the output coordinate \p o resized by
+/// \p scale along a dimension of \p inSize elements, as the nearest input
+/// coordinates \p i0 and \p i1 around it and the weight \p lambda of \p i1.
+static void getBilinearCoords(size_t o, float scale, size_t inSize, size_t &i0,
+                              size_t &i1, float &lambda) {
+  float in = o / scale;
+  i0 = std::min(size_t(in), inSize - 1);
+  i1 = std::min(i0 + 1, inSize - 1);
+  lambda = i1 == i0 ? 0 : in - i0;
+}
+
+template <typename ElemTy>
+void BoundInterpreterFunction::fwdResizeBilinearInstFloatImpl(
+    const ResizeBilinearInst *I) {
+  auto inW = getWeightHandle<ElemTy>(I->getSrc());
+  auto outW = getWeightHandle<ElemTy>(I->getDest());
+
+  ShapeNHWC odim(outW.dims());
+  ShapeNHWC idim(inW.dims());
+
+  for (size_t ob = 0; ob < odim.n; ++ob) {
+    for (size_t oh = 0; oh < odim.h; ++oh) {
+      size_t ih0, ih1;
+      float lh;
+      getBilinearCoords(oh, I->getHeightScale(), idim.h, ih0, ih1, lh);
+      for (size_t ow = 0; ow < odim.w; ++ow) {
+        size_t iw0, iw1;
+        float lw;
+        getBilinearCoords(ow, I->getWidthScale(), idim.w, iw0, iw1, lw);
+        for (size_t oc = 0; oc < odim.c; ++oc) {
+          float v00 = inW.at({ob, ih0, iw0, oc});
+          float v01 = inW.at({ob, ih0, iw1, oc});
+          float v10 = inW.at({ob, ih1, iw0, oc});
+          float v11 = inW.at({ob, ih1, iw1, oc});
+          float top = v00 + (v01 - v00) * lw;
+          float bottom = v10 + (v11 - v10) * lw;
+          outW.at({ob, oh, ow, oc}) = top + (bottom - top) * lh;
+        }
+      }
+    }
+  }
+}
+
+void BoundInterpreterFunction::fwdResizeBilinearInstI8Impl(
+    const ResizeBilinearInst *I) {
+  auto inW = getWeightHandle<int8_t>(I->getSrc());
+  auto outW = getWeightHandle<int8_t>(I->getDest());
+  auto *srcTy = I->getSrc()->getType();
+  auto *destTy = I->getDest()->getType();
+  TensorQuantizationParams srcQ{srcTy->getScale(), srcTy->getOffset()};
+  TensorQuantizationParams destQ{destTy->getScale(), destTy->getOffset()};
+
+  ShapeNHWC odim(outW.dims());
+  ShapeNHWC idim(inW.dims());
+
+  auto load = [&](llvm::ArrayRef<size_t> idx) {
+    return quantization::dequantize(inW.at(idx), srcQ);
+  };
+  for (size_t ob = 0; ob < odim.n; ++ob) {
+    for (size_t oh = 0; oh < odim.h; ++oh) {
+      size_t ih0, ih1;
+      float lh;
+      getBilinearCoords(oh, I->getHeightScale(), idim.h, ih0, ih1, lh);
+      for (size_t ow = 0; ow < odim.w; ++ow) {
+        size_t iw0, iw1;
+        float lw;
+        getBilinearCoords(ow, I->getWidthScale(), idim.w, iw0, iw1, lw);
+        for (size_t oc = 0; oc < odim.c; ++oc) {
+          float v00 = load({ob, ih0, iw0, oc});
+          float v01 = load({ob, ih0, iw1, oc});
+          float v10 = load({ob, ih1, iw0, oc});
+          float v11 = load({ob, ih1, iw1, oc});
+          float top = v00 + (v01 - v00) * lw;
+          float bottom = v10 + (v11 - v10) * lw;
+          outW.at({ob, oh, ow, oc}) =
+              quantization::quantize(top + (bottom - top) * lh, destQ);
+        }
+      }
+    }
+  }
+}
+
+void BoundInterpreterFunction::fwdResizeBilinearInst(
+    const ResizeBilinearInst *I) {
+  if (getTensor(I->getSrc())->getType().isQuantizedType()) {
+    fwdResizeBilinearInstI8Impl(I);
+    return;
+  }
+
+  dispatchFloatingPointImpl(fwdResizeBilinearInstFloatImpl,
+                            I->getSrc()->getElementType(), I);
+}
+
 //===----------------------------------------------------------------------===//
 //                      Local Response Normalization
 //===----------------------------------------------------------------------===//
@@ -1853,6 +2004,78 @@ void BoundInterpreterFunction::fwdLocalResponseNormalizationInst(
                             I->getSrc()->getElementType(), I);
 }
 
+template <typename ElemTy>
+void BoundInterpreterFunction::fwdLayerNormalizationInstImpl(
+    const glow::LayerNormalizationInst *I) {
+  auto inW = getWeightHandle<ElemTy>(I->getSrc());
+  auto scaleW = getWeightHandle<ElemTy>(I->getScale());
+  auto biasW = getWeightHandle<ElemTy>(I->getBias());
+  auto outW = getWeightHandle<ElemTy>(I->getDest());
+  const float epsilon = I->getEpsilon();
+
+  // Each row holds the normalized trailing dimensions of the input.
+  const size_t cols = scaleW.size();
+  const size_t rows = inW.size() / cols;
+  for (size_t i = 0; i < rows; i++) {
+    // Compute the mean and the variance of the row in a single pass with
+    // Welford's algorithm, which doesn't lose precision as the sums would.
+    float mean = 0;
+    float m2 = 0;
+    for (size_t j = 0; j < cols; j++) {
+      float x = float(inW.raw(i * cols + j));
+      float delta = x - mean;
+      mean += delta / (j + 1);
+      m2 += delta * (x - mean);
+    }
+    float invStdDev = 1 / std::sqrt(m2 / cols + epsilon);
+    for (size_t j = 0; j < cols; j++) {
+      float x = float(inW.raw(i * cols + j));
+      outW.raw(i * cols + j) =
+          ElemTy((x - mean) * invStdDev * float(scaleW.raw(j)) +
+                 float(biasW.raw(j)));
+    }
+  }
+}
+
+void BoundInterpreterFunction::fwdLayerNormalizationInst(
+    const LayerNormalizationInst *I) {
+  dispatchFloatingPointImpl(fwdLayerNormalizationInstImpl,
+                            I->getSrc()->getElementType(), I);
+}
+
+template <typename ElemTy>
+void BoundInterpreterFunction::fwdBatchedPairwiseDotProductInstImpl(
+    const glow::BatchedPairwiseDotProductInst *I) {
+  auto destW = getWeightHandle<ElemTy>(I->getDest());
+  std::vector<Handle<ElemTy>> inputs;
+  for (unsigned i = 0, e = I->getNumInputs(); i < e; i++) {
+    inputs.push_back(getWeightHandle<ElemTy>(I->getInput(i)));
+  }
+  const size_t batchSize = destW.dims()[0];
+  const size_t vectorSize = inputs[0].dims()[1];
+
+  // The products of input i with the inputs j < i follow those of input
+  // i - 1 in every batch.
+  for (size_t b = 0; b < batchSize; b++) {
+    size_t k = 0;
+    for (size_t i = 1, e = inputs.size(); i < e; i++) {
+      for (size_t j = 0; j < i; j++) {
+        float sum = 0;
+        for (size_t d = 0; d < vectorSize; d++) {
+          sum += float(inputs[i].at({b, d})) * float(inputs[j].at({b, d}));
+        }
+        destW.at({b, k++}) = ElemTy(sum);
+      }
+    }
+  }
+}
+
+void BoundInterpreterFunction::fwdBatchedPairwiseDotProductInst(
+    const BatchedPairwiseDotProductInst *I) {
+  dispatchFloatingPointImpl(fwdBatchedPairwiseDotProductInstImpl,
+                            I->getDest()->getElementType(), I);
+}
+
 void BoundInterpreterFunction::fwdLocalResponseNormalizationGradInst(
     const glow::LocalResponseNormalizationGradInst *I) {
   auto inW = getWeightHandle(I->getSrc());
@@ -2524,23 +2747,26 @@ void BoundInterpreterFunction::fwdMatMulInstQuantizedImpl(
   int32_t destOffset = destTy->getOffset();
 
   // For each (x,y) in the destination matrix:
-  for (size_t x = 0; x < destDim[0]; x++) {
-    for (size_t y = 0; y < destDim[1]; y++) {
-
-      // Perform DOT on the row an column.
-      AccumulatorTy sum = 0;
-      for (size_t i = 0; i < lhsDim[1]; i++) {
-        AccumulatorTy L = lhs.at({x, i});
-        AccumulatorTy R = rhs.at({i, y});
-        // We represent the element multiplication with offset as
-        // (value - offset).
-        sum += (L - lhsOffset) * (R - rhsOffset);
-      }
+  size_t work = dest.size() * lhsDim[1];
+  parallelFor(destDim[0], work, [&](size_t begin, size_t end) {
+    for (size_t x = begin; x < end; x++) {
+      for (size_t y = 0; y < destDim[1]; y++) {
+
+        // Perform DOT on the row an column.
+        AccumulatorTy sum = 0;
+        for (size_t i = 0; i < lhsDim[1]; i++) {
+          AccumulatorTy L = lhs.at({x, i});
+          AccumulatorTy R = rhs.at({i, y});
+          // We represent the element multiplication with offset as
+          // (value - offset).
+          sum += (L - lhsOffset) * (R - rhsOffset);
+        }
 
-      dest.at({x, y}) = quantization::clip<AccumulatorTy, ElemTy>(
-          std::round(scale * sum + destOffset));
+        dest.at({x, y}) = quantization::clip<AccumulatorTy, ElemTy>(
+            std::round(scale * sum + destOffset));
+      }
     }
-  }
+  });
 }
 
 template <typename ElemTy>
@@ -2557,17 +2783,20 @@ void BoundInterpreterFunction::fwdMatMulInstFloatImpl(const MatMulInst *I) {
   dest.clear(0);
 
   // For each (x,y) in the destination matrix:
-  for (size_t x = 0; x < destDim[0]; x++) {
-    for (size_t y = 0; y < destDim[1]; y++) {
-
-      // Perform DOT on the row an column.
-      float sum = 0;
-      for (size_t i = 0; i < lhsDim[1]; i++) {
-        sum += float(lhs.at({x, i}) * rhs.at({i, y}));
+  size_t work = dest.size() * lhsDim[1];
+  parallelFor(destDim[0], work, [&](size_t begin, size_t end) {
+    for (size_t x = begin; x < end; x++) {
+      for (size_t y = 0; y < destDim[1]; y++) {
+
+        // Perform DOT on the row an column.
+        float sum = 0;
+        for (size_t i = 0; i < lhsDim[1]; i++) {
+          sum += float(lhs.at({x, i}) * rhs.at({i, y}));
+        }
+        dest.at({x, y}) = ElemTy(sum);
       }
-      dest.at({x, y}) = ElemTy(sum);
     }
-  }
+  });
 }
 
 void BoundInterpreterFunction::fwdMatMulInst(const glow::MatMulInst *I) {
@@ -2604,23 +2833,62 @@ void BoundInterpreterFunction::fwdRowwiseQuantizedFullyConnectedInst(
   float inScale = inTy.getScale();
   float biasScale = biasTy.getScale();
 
-  for (size_t i = 0; i < idim.height; i++) {
-    for (size_t j = 0; j < odim.width; j++) {
-      float matMulScale = scalesW.raw(j) * inScale;
-      int32_t sum = 0;
+  size_t work = outW.size() * idim.width;
+  parallelFor(idim.height, work, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      for (size_t j = 0; j < odim.width; j++) {
+        float matMulScale = scalesW.raw(j) * inScale;
+        int32_t sum = 0;
+        for (size_t k = 0; k < idim.width; k++) {
+          int32_t W = weightsW.at({j, k});
+          int32_t A = inW.at({i, k});
+          sum += (W - offsetsW.raw(j)) * (A - inOffset);
+        }
+        int32_t B = std::round(float(biasW.at({j}) - biasOffset) *
+                               (biasScale / matMulScale));
+        sum += B;
+        // Scale the result back to the expected destination scale.
+        outW.at({i, j}) = quantization::clip<int32_t, int8_t>(
+            std::round(float(sum) * (matMulScale / outScale) + outOffset));
+      }
+    }
+  });
+}
+
+void BoundInterpreterFunction::fwdDynamicQuantizedFullyConnectedInst(
+    const DynamicQuantizedFullyConnectedInst *I) {
+  auto inW = getWeightHandle(I->getSrc());
+  auto outW = getWeightHandle(I->getDest());
+  auto weightsW = getWeightHandle<int8_t>(I->getWeights());
+  auto biasW = getWeightHandle(I->getBias());
+  ShapeHW idim(inW.dims());
+  ShapeHW odim(outW.dims());
+  auto weightsTy = weightsW.getType();
+  int32_t weightsOffset = weightsTy.getOffset();
+
+  // Quantize the input with the params of its range in this run.
+  auto minMax = inW.minMaxArg();
+  TensorQuantizationParams inTQP = quantization::chooseQuantizationParams(
+      inW.raw(minMax.first), inW.raw(minMax.second));
+  float matMulScale = inTQP.scale * weightsTy.getScale();
+
+  size_t work = outW.size() * idim.width;
+  parallelFor(idim.height, work, [&](size_t begin, size_t end) {
+    std::vector<int32_t> row(idim.width);
+    for (size_t i = begin; i < end; i++) {
       for (size_t k = 0; k < idim.width; k++) {
-        int32_t W = weightsW.at({j, k});
-        int32_t A = inW.at({i, k});
-        sum += (W - offsetsW.raw(j)) * (A - inOffset);
+        row[k] = quantization::quantize<int8_t>(inW.at({i, k}), inTQP);
+        row[k] -= inTQP.offset;
+      }
+      for (size_t j = 0; j < odim.width; j++) {
+        int32_t sum = 0;
+        for (size_t k = 0; k < idim.width; k++) {
+          sum += (int32_t(weightsW.at({j, k})) - weightsOffset) * row[k];
+        }
+        outW.at({i, j}) = float(sum) * matMulScale + biasW.at({j});
       }
-      int32_t B = std::round(float(biasW.at({j}) - biasOffset) *
-                             (biasScale / matMulScale));
-      sum += B;
-      // Scale the result back to the expected destination scale.
-      outW.at({i, j}) = quantization::clip<int32_t, int8_t>(
-          std::round(float(sum) * (matMulScale / outScale) + outOffset));
     }
-  }
+  });
 }
 
 //===----------------------------------------------------------------------===//
@@ -2649,26 +2917,29 @@ static void fwdBatchedAdd(Tensor *batch, Tensor *slice, Tensor *dest) {
   assert(batchH.dims().drop_front() == sliceH.dims() && "Invalid batch size");
 
   // For each layer in the batch:
-  for (size_t n = 0; n < bdim.first; n++) {
-    size_t base = batchH.getElementPtr({n});
-
-    // For each element in the slice.
-    for (size_t i = 0; i < bdim.second; i++) {
-      int32_t batchVal = batchH.raw(base + i);
-      int32_t sliceVal = sliceH.raw(i);
-      // We increase the size of the integer up to 16 bits for more accurate
-      // arithmetic.
-      const float largeScale = float(1) / (1 << 15);
-      // Scale both sides from 8-bit to 16-bits.
-      int32_t B =
-          std::round(float(batchVal - batchOffset) * (batchScale / largeScale));
-      int32_t S =
-          std::round(float(sliceVal - sliceOffset) * (sliceScale / largeScale));
-      int32_t R = B + S;
-      destH.raw(base + i) = quantization::clip<int32_t, int8_t>(
-          std::round(float(R) * (largeScale / destScale) + destOffset));
-    }
-  }
+  BoundInterpreterFunction::parallelFor(
+      bdim.first, batchH.size(), [&](size_t begin, size_t end) {
+        for (size_t n = begin; n < end; n++) {
+          size_t base = batchH.getElementPtr({n});
+
+          // For each element in the slice.
+          for (size_t i = 0; i < bdim.second; i++) {
+            int32_t batchVal = batchH.raw(base + i);
+            int32_t sliceVal = sliceH.raw(i);
+            // We increase the size of the integer up to 16 bits for more
+            // accurate arithmetic.
+            const float largeScale = float(1) / (1 << 15);
+            // Scale both sides from 8-bit to 16-bits.
+            int32_t B = std::round(float(batchVal - batchOffset) *
+                                   (batchScale / largeScale));
+            int32_t S = std::round(float(sliceVal - sliceOffset) *
+                                   (sliceScale / largeScale));
+            int32_t R = B + S;
+            destH.raw(base + i) = quantization::clip<int32_t, int8_t>(
+                std::round(float(R) * (largeScale / destScale) + destOffset));
+          }
+        }
+      });
 }
 
 template <typename ElemTy>
@@ -2685,14 +2956,16 @@ void BoundInterpreterFunction::fwdBatchedAddInstFloatImpl(
   assert(batch.dims().drop_front() == slice.dims() && "Invalid batch size");
 
   // For each layer in the batch:
-  for (size_t n = 0; n < bdim.first; n++) {
-    size_t base = batch.getElementPtr({n});
+  parallelFor(bdim.first, batch.size(), [&](size_t begin, size_t end) {
+    for (size_t n = begin; n < end; n++) {
+      size_t base = batch.getElementPtr({n});
 
-    // For each element in the slice.
-    for (size_t i = 0; i < bdim.second; i++) {
-      dest.raw(base + i) = batch.raw(base + i) + slice.raw(i);
+      // For each element in the slice.
+      for (size_t i = 0; i < bdim.second; i++) {
+        dest.raw(base + i) = batch.raw(base + i) + slice.raw(i);
+      }
     }
-  }
+  });
 }
 
 void BoundInterpreterFunction::fwdBatchedAddInst(
@@ -2950,21 +3223,27 @@ void BoundInterpreterFunction::fwdSparseLengthsSumInstI8Impl(
                                     T->getType().getOffset()};
   };
 
-  size_t curIdx = 0;
-  for (size_t i = 0; i < segments; i++) {
-    std::vector<float> accum(lineSize, 0.0f);
-    for (int32_t j = 0; j < LH.raw(i); j++) {
-      size_t offsetIn = IH.raw(curIdx) * lineSize;
+  parallelFor(segments, totalLength * lineSize, [&](size_t begin, size_t end) {
+    // Find the first index of segment begin.
+    size_t curIdx = 0;
+    for (size_t i = 0; i < begin; i++) {
+      curIdx += LH.raw(i);
+    }
+    for (size_t i = begin; i < end; i++) {
+      std::vector<float> accum(lineSize, 0.0f);
+      for (int32_t j = 0; j < LH.raw(i); j++) {
+        size_t offsetIn = IH.raw(curIdx) * lineSize;
+        for (size_t k = 0; k < lineSize; k++) {
+          accum[k] += quantization::dequantize(DH.raw(offsetIn++), TQP(data));
+        }
+        curIdx++;
+      }
+      size_t offsetOut = i * lineSize;
       for (size_t k = 0; k < lineSize; k++) {
-        accum[k] += quantization::dequantize(DH.raw(offsetIn++), TQP(data));
+        OH.raw(offsetOut++) = quantization::quantize(accum[k], TQP(out));
       }
-      curIdx++;
     }
-    size_t offsetOut = i * lineSize;
-    for (size_t k = 0; k < lineSize; k++) {
-      OH.raw(offsetOut++) = quantization::quantize(accum[k], TQP(out));
-    }
-  }
+  });
 }
 
 template <typename ElemTy>
@@ -2995,15 +3274,21 @@ void BoundInterpreterFunction::fwdSparseLengthsSumInstFloatImpl(
   auto DH = data->getHandle<ElemTy>();
   auto OH = out->getHandle<ElemTy>();
 
-  size_t curIdx = 0;
-  for (size_t i = 0; i < segments; i++) {
-    for (size_t j = 0, e = LH.raw(i); j < e; j++) {
-      size_t offsetIn = IH.raw(curIdx++) * lineSize;
-      size_t offsetOut = i * lineSize;
-      for (size_t k = 0; k < lineSize; k++)
-        OH.raw(offsetOut++) += DH.raw(offsetIn++);
+  parallelFor(segments, totalLength * lineSize, [&](size_t begin, size_t end) {
+    // Find the first index of segment begin.
+    size_t curIdx = 0;
+    for (size_t i = 0; i < begin; i++) {
+      curIdx += LH.raw(i);
     }
-  }
+    for (size_t i = begin; i < end; i++) {
+      for (size_t j = 0, e = LH.raw(i); j < e; j++) {
+        size_t offsetIn = IH.raw(curIdx++) * lineSize;
+        size_t offsetOut = i * lineSize;
+        for (size_t k = 0; k < lineSize; k++)
+          OH.raw(offsetOut++) += DH.raw(offsetIn++);
+      }
+    }
+  });
 }
 
 void BoundInterpreterFunction::fwdSparseLengthsSumInst(
@@ -3045,16 +3330,22 @@ void BoundInterpreterFunction::fwdSparseLengthsWeightedSumInstFloatImpl(
   auto WH = weights->getHandle<ElemTy>();
   auto OH = out->getHandle<ElemTy>();
 
-  size_t curIdx = 0;
-  for (size_t i = 0; i < segments; i++) {
-    for (size_t j = 0, e = LH.raw(i); j < e; j++) {
-      ElemTy weight = WH.raw(curIdx);
-      size_t offsetIn = IH.raw(curIdx++) * lineSize;
-      size_t offsetOut = i * lineSize;
-      for (size_t k = 0; k < lineSize; k++)
-        OH.raw(offsetOut++) += DH.raw(offsetIn++) * weight;
+  parallelFor(segments, totalLength * lineSize, [&](size_t begin, size_t end) {
+    // Find the first index of segment begin.
+    size_t curIdx = 0;
+    for (size_t i = 0; i < begin; i++) {
+      curIdx += LH.raw(i);
     }
-  }
+    for (size_t i = begin; i < end; i++) {
+      for (size_t j = 0, e = LH.raw(i); j < e; j++) {
+        ElemTy weight = WH.raw(curIdx);
+        size_t offsetIn = IH.raw(curIdx++) * lineSize;
+        size_t offsetOut = i * lineSize;
+        for (size_t k = 0; k < lineSize; k++)
+          OH.raw(offsetOut++) += DH.raw(offsetIn++) * weight;
+      }
+    }
+  });
 }
 
 void BoundInterpreterFunction::fwdSparseLengthsWeightedSumInstI8Impl(
@@ -3091,22 +3382,28 @@ void BoundInterpreterFunction::fwdSparseLengthsWeightedSumInstI8Impl(
   };
   using namespace quantization;
 
-  size_t curIdx = 0;
-  for (size_t i = 0; i < segments; i++) {
-    std::vector<float> accum(lineSize, 0.0f);
-    for (int32_t j = 0; j < LH.raw(i); j++) {
-      float weight = dequantize(WH.raw(curIdx), TQP(weights));
-      size_t offsetIn = IH.raw(curIdx) * lineSize;
+  parallelFor(segments, totalLength * lineSize, [&](size_t begin, size_t end) {
+    // Find the first index of segment begin.
+    size_t curIdx = 0;
+    for (size_t i = 0; i < begin; i++) {
+      curIdx += LH.raw(i);
+    }
+    for (size_t i = begin; i < end; i++) {
+      std::vector<float> accum(lineSize, 0.0f);
+      for (int32_t j = 0; j < LH.raw(i); j++) {
+        float weight = dequantize(WH.raw(curIdx), TQP(weights));
+        size_t offsetIn = IH.raw(curIdx) * lineSize;
+        for (size_t k = 0; k < lineSize; k++) {
+          accum[k] += weight * dequantize(DH.raw(offsetIn++), TQP(data));
+        }
+        curIdx++;
+      }
+      size_t offsetOut = i * lineSize;
       for (size_t k = 0; k < lineSize; k++) {
-        accum[k] += weight * dequantize(DH.raw(offsetIn++), TQP(data));
+        OH.raw(offsetOut++) = quantize(accum[k], TQP(out));
       }
-      curIdx++;
     }
-    size_t offsetOut = i * lineSize;
-    for (size_t k = 0; k < lineSize; k++) {
-      OH.raw(offsetOut++) = quantize(accum[k], TQP(out));
-    }
-  }
+  });
 }
 
 void BoundInterpreterFunction::fwdSparseLengthsWeightedSumInst(
@@ -3211,27 +3508,33 @@ void BoundInterpreterFunction::fwdRowwiseQuantizedSparseLengthsWeightedSumImpl(
   auto WH = weights->getHandle<T>();
   auto OH = out->getHandle<T>();
 
-  size_t curIdx = 0;
-  for (size_t i = 0; i < segments; i++) {
-    std::vector<AccumT> accum(lineSize, 0.0f);
-    for (size_t j = 0, e = LH.raw(i); j < e; j++) {
-      const float weight = static_cast<float>(WH.raw(curIdx));
-      const size_t rowIdx = IH.raw(curIdx++);
-      const float scale = static_cast<float>(DSH.at({rowIdx}));
-      const float offset = static_cast<float>(DOH.at({rowIdx}));
-      size_t offsetIn = rowIdx * lineSize;
+  parallelFor(segments, totalLength * lineSize, [&](size_t begin, size_t end) {
+    // Find the first index of segment begin.
+    size_t curIdx = 0;
+    for (size_t i = 0; i < begin; i++) {
+      curIdx += LH.raw(i);
+    }
+    for (size_t i = begin; i < end; i++) {
+      std::vector<AccumT> accum(lineSize, 0.0f);
+      for (size_t j = 0, e = LH.raw(i); j < e; j++) {
+        const float weight = static_cast<float>(WH.raw(curIdx));
+        const size_t rowIdx = IH.raw(curIdx++);
+        const float scale = static_cast<float>(DSH.at({rowIdx}));
+        const float offset = static_cast<float>(DOH.at({rowIdx}));
+        size_t offsetIn = rowIdx * lineSize;
+        for (size_t k = 0; k < lineSize; k++) {
+          float d = quantization::dequantizeWithFloatOffset(DH.raw(offsetIn++),
+                                                            scale, offset);
+          accum[k] += d * weight;
+        }
+      }
+      // Accumulation in FP32 complete, now copy back to output with cast to T.
+      size_t offsetOut = i * lineSize;
       for (size_t k = 0; k < lineSize; k++) {
-        float d = quantization::dequantizeWithFloatOffset(DH.raw(offsetIn++),
-                                                          scale, offset);
-        accum[k] += d * weight;
+        OH.raw(offsetOut++) = static_cast<T>(accum[k]);
       }
     }
-    // Accumulation in FP32 complete, now copy back to output with cast to T.
-    size_t offsetOut = i * lineSize;
-    for (size_t k = 0; k < lineSize; k++) {
-      OH.raw(offsetOut++) = static_cast<T>(accum[k]);
-    }
-  }
+  });
 }
 
 void BoundInterpreterFunction::fwdRowwiseQuantizedSparseLengthsWeightedSumInst(
@@ -3252,15 +3555,17 @@ void BoundInterpreterFunction::fwdRowwiseQuantizedSparseLengthsWeightedSumInst(
   }
 }
 
-template <typename T, typename AccumT>
+template <typename T, typename AccumT, typename InstrTy>
 void BoundInterpreterFunction::
     fwdFusedRowwiseQuantizedSparseLengthsWeightedSumImpl(
-        const FusedRowwiseQuantizedSparseLengthsWeightedSumInst *I) {
-  auto *out = getTensor(I->getDest());
-  auto *data = getTensor(I->getData());
-  auto *weights = getTensor(I->getWeights());
-  auto *indices = getTensor(I->getIndices());
-  auto *lengths = getTensor(I->getLengths());
+        const InstrTy *I, llvm::ArrayRef<size_t> rowOffsets,
+        llvm::ArrayRef<size_t> indexOffsets,
+        llvm::ArrayRef<size_t> segmentOffsets) {
+  Tensor *out = getTensor(I->getDest());
+  Tensor *data = getTensor(I->getData());
+  Tensor *weights = getTensor(I->getWeights());
+  Tensor *indices = getTensor(I->getIndices());
+  Tensor *lengths = getTensor(I->getLengths());
 
   out->zero();
 
@@ -3277,48 +3582,282 @@ void BoundInterpreterFunction::
 
   const size_t inLineSize = data->size() / data->dims()[0];
   const size_t outLineSize = out->size() / out->dims()[0];
+  // 4-bit rows pack two columns in every byte, and always have float16 scales
+  // and offsets.
+  const bool is4Bit = data->getElementType() == ElemKind::UInt4FusedFP16QTy;
 
   auto DH = data->getHandle<uint8_t>();
   auto WH = weights->getHandle<T>();
   auto OH = out->getHandle<T>();
 
-  size_t curIdx = 0;
-  for (size_t i = 0; i < segments; i++) {
-    std::vector<AccumT> accum(outLineSize, 0.0f);
-    for (size_t j = 0, e = LH.raw(i); j < e; j++) {
-      const float weight = static_cast<float>(WH.raw(curIdx));
-      const size_t rowIdx = IH.raw(curIdx++);
-      size_t offsetIn = rowIdx * inLineSize;
-      T scale, offset;
-      std::tie(scale, offset) = DH.getFusedScaleOffsetFromRow<T>(rowIdx);
+  size_t work = totalLength * outLineSize;
+  parallelFor(segments, work, [&](size_t begin, size_t end) {
+    // Find the table of segment begin and its first index.
+    size_t table = 0;
+    while (table + 1 < segmentOffsets.size() &&
+           segmentOffsets[table + 1] <= begin) {
+      table++;
+    }
+    size_t curIdx = indexOffsets[table];
+    for (size_t i = segmentOffsets[table]; i < begin; i++) {
+      curIdx += LH.raw(i);
+    }
+    for (size_t i = begin; i < end; i++) {
+      // Move to the first index of the next table at its first segment.
+      const size_t prevTable = table;
+      while (table + 1 < segmentOffsets.size() &&
+             segmentOffsets[table + 1] <= i) {
+        table++;
+      }
+      if (table != prevTable) {
+        curIdx = indexOffsets[table];
+      }
+      std::vector<AccumT> accum(outLineSize, 0.0f);
+      for (size_t j = 0, e = LH.raw(i); j < e; j++) {
+        const float weight = static_cast<float>(WH.raw(curIdx));
+        const size_t rowIdx = rowOffsets[table] + IH.raw(curIdx++);
+        size_t offsetIn = rowIdx * inLineSize;
+        if (is4Bit) {
+          float16_t scale, offset;
+          std::tie(scale, offset) =
+              DH.getFusedScaleOffsetFromRow<float16_t>(rowIdx);
+          for (size_t k = 0; k < outLineSize; k++) {
+            float d = quantization::dequantize4BitWithFloatOffset(
+                DH.raw(offsetIn + k / 2), static_cast<float>(scale),
+                static_cast<float>(offset), /* isMSB */ k % 2 == 1);
+            accum[k] += d * weight;
+          }
+          continue;
+        }
+        T scale, offset;
+        std::tie(scale, offset) = DH.getFusedScaleOffsetFromRow<T>(rowIdx);
+        for (size_t k = 0; k < outLineSize; k++) {
+          float d = quantization::dequantizeWithFloatOffset(
+              DH.raw(offsetIn++), static_cast<float>(scale),
+              static_cast<float>(offset));
+          accum[k] += d * weight;
+        }
+      }
+      // Accumulation in FP32 complete, now copy back to output with cast to T.
+      size_t offsetOut = i * outLineSize;
       for (size_t k = 0; k < outLineSize; k++) {
-        float d = quantization::dequantizeWithFloatOffset(
-            DH.raw(offsetIn++), static_cast<float>(scale),
-            static_cast<float>(offset));
-        accum[k] += d * weight;
+        OH.raw(offsetOut++) = static_cast<T>(accum[k]);
       }
     }
-    // Accumulation in FP32 complete, now copy back to output with cast to T.
-    size_t offsetOut = i * outLineSize;
-    for (size_t k = 0; k < outLineSize; k++) {
-      OH.raw(offsetOut++) = static_cast<T>(accum[k]);
+  });
+}
+
+template <typename InstrTy>
+void BoundInterpreterFunction::
+    fwdFusedRowwiseQuantizedSparseLengthsWeightedSumDispatch(
+        const InstrTy *I, llvm::ArrayRef<size_t> rowOffsets,
+        llvm::ArrayRef<size_t> indexOffsets,
+        llvm::ArrayRef<size_t> segmentOffsets) {
+  switch (I->getDest()->getElementType()) {
+  case ElemKind::FloatTy:
+    fwdFusedRowwiseQuantizedSparseLengthsWeightedSumImpl<float, float>(
+        I, rowOffsets, indexOffsets, segmentOffsets);
+    break;
+  case ElemKind::Float16Ty:
+    if (I->getUseFP16Accumulation()) {
+      fwdFusedRowwiseQuantizedSparseLengthsWeightedSumImpl<float16_t,
+                                                           float16_t>(
+          I, rowOffsets, indexOffsets, segmentOffsets);
+    } else {
+      fwdFusedRowwiseQuantizedSparseLengthsWeightedSumImpl<float16_t, float>(
+          I, rowOffsets, indexOffsets, segmentOffsets);
     }
+    break;
+  default:
+    llvm_unreachable("Type is not supported");
   }
 }
 
 void BoundInterpreterFunction::
     fwdFusedRowwiseQuantizedSparseLengthsWeightedSumInst(
         const FusedRowwiseQuantizedSparseLengthsWeightedSumInst *I) {
+  fwdFusedRowwiseQuantizedSparseLengthsWeightedSumDispatch(I, {0}, {0}, {0});
+}
+
+void BoundInterpreterFunction::
+    fwdGroupedFusedRowwiseQuantizedSparseLengthsWeightedSumInst(
+        const GroupedFusedRowwiseQuantizedSparseLengthsWeightedSumInst *I) {
+  fwdFusedRowwiseQuantizedSparseLengthsWeightedSumDispatch(
+      I, I->getRowOffsets(), I->getIndexOffsets(), I->getSegmentOffsets());
+}
+
+template <typename ElemTy, typename InstrTy>
+void BoundInterpreterFunction::fwdSparseLengthsPoolInstFloatImpl(
+    const InstrTy *I, bool isMax) {
+  staticAssertFloatingPointType(ElemTy);
+
+  Tensor *out = getTensor(I->getDest());
+  Tensor *data = getTensor(I->getData());
+  Tensor *indices = getTensor(I->getIndices());
+  Tensor *lengths = getTensor(I->getLengths());
+
+  out->zero();
+
+  auto IH = indices->getHandle<int64_t>();
+  auto LH = lengths->getHandle<int32_t>();
+
+  size_t segments = lengths->dims()[0];
+  size_t totalLength = 0;
+  for (size_t i = 0; i < segments; i++) {
+    totalLength += LH.raw(i);
+  }
+  assert(totalLength <= indices->dims()[0] &&
+         "sum(Lengths) must be equal to len(Indices)");
+
+  size_t lineSize = data->size() / data->dims()[0];
+
+  auto DH = data->getHandle<ElemTy>();
+  auto OH = out->getHandle<ElemTy>();
+
+  parallelFor(segments, totalLength * lineSize, [&](size_t begin, size_t end) {
+    // Find the first index of segment begin.
+    size_t curIdx = 0;
+    for (size_t i = 0; i < begin; i++) {
+      curIdx += LH.raw(i);
+    }
+    for (size_t i = begin; i < end; i++) {
+      size_t len = LH.raw(i);
+      // Empty segments stay zero.
+      if (len == 0) {
+        continue;
+      }
+      // The first row initializes the maxima.
+      size_t offsetOut = i * lineSize;
+      size_t offsetIn = IH.raw(curIdx++) * lineSize;
+      for (size_t k = 0; k < lineSize; k++) {
+        OH.raw(offsetOut + k) = DH.raw(offsetIn + k);
+      }
+      for (size_t j = 1; j < len; j++) {
+        offsetIn = IH.raw(curIdx++) * lineSize;
+        for (size_t k = 0; k < lineSize; k++) {
+          ElemTy d = DH.raw(offsetIn + k);
+          ElemTy &o = OH.raw(offsetOut + k);
+          o = isMax ? std::max(o, d) : ElemTy(o + d);
+        }
+      }
+      if (!isMax) {
+        for (size_t k = 0; k < lineSize; k++) {
+          OH.raw(offsetOut + k) = OH.raw(offsetOut + k) / ElemTy(len);
+        }
+      }
+    }
+  });
+}
+
+void BoundInterpreterFunction::fwdSparseLengthsMeanInst(
+    const SparseLengthsMeanInst *I) {
+  dispatchFloatingPointImpl(fwdSparseLengthsPoolInstFloatImpl,
+                            I->getData()->getElementType(), I,
+                            /* isMax */ false);
+}
+
+void BoundInterpreterFunction::fwdSparseLengthsMaxInst(
+    const SparseLengthsMaxInst *I) {
+  dispatchFloatingPointImpl(fwdSparseLengthsPoolInstFloatImpl,
+                            I->getData()->getElementType(), I,
+                            /* isMax */ true);
+}
+
+template <typename T, typename AccumT, typename InstrTy>
+void BoundInterpreterFunction::fwdFusedRowwiseQuantizedSparseLengthsPoolImpl(
+    const InstrTy *I, bool isMax) {
+  Tensor *out = getTensor(I->getDest());
+  Tensor *data = getTensor(I->getData());
+  Tensor *indices = getTensor(I->getIndices());
+  Tensor *lengths = getTensor(I->getLengths());
+
+  out->zero();
+
+  auto IH = indices->getHandle<int64_t>();
+  auto LH = lengths->getHandle<int32_t>();
+
+  size_t segments = lengths->dims()[0];
+  size_t totalLength = 0;
+  for (size_t i = 0; i < segments; i++) {
+    totalLength += LH.raw(i);
+  }
+  assert(totalLength <= indices->dims()[0] &&
+         "sum(Lengths) must be equal to len(Indices)");
+
+  const size_t inLineSize = data->size() / data->dims()[0];
+  const size_t outLineSize = out->size() / out->dims()[0];
+  // 4-bit rows pack two columns in every byte, and always have float16 scales
+  // and offsets.
+  const bool is4Bit = data->getElementType() == ElemKind::UInt4FusedFP16QTy;
+
+  auto DH = data->getHandle<uint8_t>();
+  auto OH = out->getHandle<T>();
+
+  size_t work = totalLength * outLineSize;
+  parallelFor(segments, work, [&](size_t begin, size_t end) {
+    // Find the first index of segment begin.
+    size_t curIdx = 0;
+    for (size_t i = 0; i < begin; i++) {
+      curIdx += LH.raw(i);
+    }
+    std::vector<AccumT> accum(outLineSize);
+    for (size_t i = begin; i < end; i++) {
+      size_t len = LH.raw(i);
+      // Empty segments stay zero.
+      if (len == 0) {
+        continue;
+      }
+      for (size_t j = 0; j < len; j++) {
+        const size_t rowIdx = IH.raw(curIdx++);
+        const size_t offsetIn = rowIdx * inLineSize;
+        float scale, offset;
+        if (is4Bit || std::is_same<T, float16_t>::value) {
+          auto scaleOffset = DH.getFusedScaleOffsetFromRow<float16_t>(rowIdx);
+          scale = scaleOffset.first;
+          offset = scaleOffset.second;
+        } else {
+          std::tie(scale, offset) =
+              DH.getFusedScaleOffsetFromRow<float>(rowIdx);
+        }
+        for (size_t k = 0; k < outLineSize; k++) {
+          float d = is4Bit ? quantization::dequantize4BitWithFloatOffset(
+                                 DH.raw(offsetIn + k / 2), scale, offset,
+                                 /* isMSB */ k % 2 == 1)
+                           : quantization::dequantizeWithFloatOffset(
+                                 DH.raw(offsetIn + k), scale, offset);
+          if (j == 0) {
+            accum[k] = d;
+          } else if (isMax) {
+            accum[k] = std::max(accum[k], AccumT(d));
+          } else {
+            accum[k] += d;
+          }
+        }
+      }
+      size_t offsetOut = i * outLineSize;
+      for (size_t k = 0; k < outLineSize; k++) {
+        OH.raw(offsetOut++) =
+            static_cast<T>(isMax ? accum[k] : accum[k] / AccumT(len));
+      }
+    }
+  });
+}
+
+template <typename InstrTy>
+void BoundInterpreterFunction::
+    fwdFusedRowwiseQuantizedSparseLengthsPoolDispatch(const InstrTy *I,
+                                                      bool isMax) {
   switch (I->getDest()->getElementType()) {
   case ElemKind::FloatTy:
-    fwdFusedRowwiseQuantizedSparseLengthsWeightedSumImpl<float, float>(I);
+    fwdFusedRowwiseQuantizedSparseLengthsPoolImpl<float, float>(I, isMax);
     break;
   case ElemKind::Float16Ty:
     if (I->getUseFP16Accumulation()) {
-      fwdFusedRowwiseQuantizedSparseLengthsWeightedSumImpl<float16_t,
-                                                           float16_t>(I);
+      fwdFusedRowwiseQuantizedSparseLengthsPoolImpl<float16_t, float16_t>(
+          I, isMax);
     } else {
-      fwdFusedRowwiseQuantizedSparseLengthsWeightedSumImpl<float16_t, float>(I);
+      fwdFusedRowwiseQuantizedSparseLengthsPoolImpl<float16_t, float>(I,
+                                                                      isMax);
     }
     break;
   default:
@@ -3326,6 +3865,16 @@ void BoundInterpreterFunction::
   }
 }
 
+void BoundInterpreterFunction::fwdFusedRowwiseQuantizedSparseLengthsMeanInst(
+    const FusedRowwiseQuantizedSparseLengthsMeanInst *I) {
+  fwdFusedRowwiseQuantizedSparseLengthsPoolDispatch(I, /* isMax */ false);
+}
+
+void BoundInterpreterFunction::fwdFusedRowwiseQuantizedSparseLengthsMaxInst(
+    const FusedRowwiseQuantizedSparseLengthsMaxInst *I) {
+  fwdFusedRowwiseQuantizedSparseLengthsPoolDispatch(I, /* isMax */ true);
+}
+
 void BoundInterpreterFunction::fwdLengthsToRangesInst(
     const LengthsToRangesInst *I) {
   auto ranges = getTensor(I->getDest())->getHandle<int32_t>();
@@ -3482,12 +4031,13 @@ static void fwdTopK(Tensor *outW, Tensor *indW, Tensor *inW, size_t k) {
       buf[i].first = in.raw(in_p++);
       buf[i].second = i;
     }
-    // NOTE: it's possible to do N + KlogK, while this version is NlogN
-    std::sort(buf.begin(), buf.end(), [](const pairType &a, const pairType &b) {
-      if (a.first != b.first)
-        return a.first > b.first;
-      return a.second < b.second;
-    });
+    // Only the first k values are sorted, which is N log K.
+    std::partial_sort(buf.begin(), buf.begin() + k, buf.end(),
+                      [](const pairType &a, const pairType &b) {
+                        if (a.first != b.first)
+                          return a.first > b.first;
+                        return a.second < b.second;
+                      });
     for (size_t i = 0; i < k; i++) {
       values.raw(out_p) = buf[i].first;
       indices.raw(out_p) = buf[i].second;
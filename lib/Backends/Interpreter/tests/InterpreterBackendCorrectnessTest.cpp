@@ -20,4 +20,7 @@ using namespace glow;
 std::set<std::string> glow::backendTestBlacklist = {
     // Interpreter does not support kernel stacking yet.
     "dataParallelStackingTest/0",
+    "dataParallelFusionTest/0",
+    // -llvm-fast-math is an option of the LLVM backends.
+    "fastMathTest/0",
 };
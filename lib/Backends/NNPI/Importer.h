@@ -149,6 +149,11 @@ inline std::string EnvDeviceVersion() {
   return deviceVersion.length() ? deviceVersion : "";
 }
 
+inline std::string EnvCompiledStreamCacheDir() {
+  auto dir = NNPIEnvVariables::getVarString("NNPI_COMPILED_STREAM_CACHE_DIR");
+  return dir.length() ? dir : "";
+}
+
 inline bool SymlowpWA() { return NNPIEnvVariables::getVarBool("SYMLOWP_WA"); }
 
 } // namespace glow
@@ -18,6 +18,8 @@
 #include "Importer.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include <algorithm>
+
 namespace glow {
 namespace runtime {
 
@@ -56,11 +58,9 @@ InferenceThreadEnv::~InferenceThreadEnv() {
   }
 }
 
-bool InferenceThreadEnv::execute(RunIdentifierTy runId,
-                                 std::unique_ptr<ExecutionContext> ctx,
-                                 runtime::ResultCBTy resultCB) {
+bool InferenceThreadEnv::stageInputs(ExecutionContext &ctx) {
   // Pre inference input preparation.
-  PlaceholderBindings &bindings = *ctx->getPlaceholderBindings();
+  PlaceholderBindings &bindings = *ctx.getPlaceholderBindings();
   ioTensors_.clear();
 
   for (auto &pht : bindings.pairs()) {
@@ -143,6 +143,29 @@ bool InferenceThreadEnv::execute(RunIdentifierTy runId,
                                       "Failed to queue copy command");
     }
   }
+  inputsStaged_ = true;
+  return true;
+}
+
+void InferenceThreadEnv::releaseInputs() {
+  for (auto *p : tmpBuffers_) {
+    delete[](p);
+  }
+  tmpBuffers_.clear();
+  rawInputs_.clear();
+  rawOutputs_.clear();
+  ioTensors_.clear();
+  inputsStaged_ = false;
+}
+
+bool InferenceThreadEnv::execute(RunIdentifierTy runId,
+                                 std::unique_ptr<ExecutionContext> ctx,
+                                 runtime::ResultCBTy resultCB) {
+  // The inputs may have been staged ahead of the run, see
+  // NNPIDeviceManager::prepareInputs.
+  if (!inputsStaged_ && !stageInputs(*ctx)) {
+    return false;
+  }
 
   // Inference.
   if (UseInferenceAPI()) {
@@ -230,13 +253,7 @@ bool InferenceThreadEnv::execute(RunIdentifierTy runId,
     }
   }
 
-  for (auto *p : tmpBuffers_) {
-    delete[](p);
-  }
-  tmpBuffers_.clear();
-  rawInputs_.clear();
-  rawOutputs_.clear();
-  ioTensors_.clear();
+  releaseInputs();
 
   // Invoke CB.
   resultCB(runId, Error::success(), std::move(ctx));
@@ -374,10 +391,22 @@ bool InferenceThreadEnv::init(
   return true;
 }
 
+/// The number of consecutive requests finishing with environments in excess
+/// of the queue depth after which one of them is destroyed.
+static constexpr unsigned kShrinkAfterIdleReleases = 64;
+
 InferencePoolEnv::InferencePoolEnv()
-    : numWorkers_(0), hostNetwork_(NNPI_INVALID_NNPIHANDLE) {}
+    : minWorkers_(0), numWorkers_(0), maxWorkers_(0), numCreatingEnvs_(0),
+      numIdleReleases_(0), queueDepth_(0), numRequests_(0),
+      hostNetwork_(NNPI_INVALID_NNPIHANDLE),
+      deviceNetwork_(NNPI_INVALID_NNPIHANDLE),
+      adapter_(NNPI_INVALID_NNPIHANDLE), device_(NNPI_INVALID_NNPIHANDLE),
+      function_(nullptr) {}
 
 InferencePoolEnv::~InferencePoolEnv() {
+  // The environments use the networks.
+  freeEnvs_.clear();
+  threadEnvs_.clear();
   if (UseInferenceAPI()) {
     if (hostNetwork_ != NNPI_INVALID_NNPIHANDLE) {
       LOG_NNPI_INF_ERROR(nnpiHostNetworkDestroy(hostNetwork_),
@@ -392,18 +421,18 @@ InferencePoolEnv::~InferencePoolEnv() {
   }
 }
 
-Error InferencePoolEnv::init(unsigned numWorkers, NNPIAdapter adapter,
-                             NNPIDeviceContext device,
+Error InferencePoolEnv::init(unsigned minWorkers, unsigned maxWorkers,
+                             NNPIAdapter adapter, NNPIDeviceContext device,
                              CompiledFunction *compiledFunction) {
   if (workersPool_) {
     return MAKE_ERR("InferencePool already initialized!");
   }
-  numWorkers_ = numWorkers;
+  minWorkers_ = std::max(minWorkers, 1u);
+  numWorkers_ = std::max(maxWorkers, minWorkers_);
+  maxWorkers_ = numWorkers_;
+  adapter_ = adapter;
+  device_ = device;
   workersPool_ = std::make_unique<ThreadPool>(numWorkers_);
-  threadEnvs_.resize(numWorkers_);
-  if (threadEnvs_.size() != numWorkers_) {
-    return MAKE_ERR("InferencePool failed to initialize thread env");
-  }
 
   // Create host network.
   auto *nnpiFunction = static_cast<NNPICompiledFunction *>(compiledFunction);
@@ -447,16 +476,19 @@ Error InferencePoolEnv::init(unsigned numWorkers, NNPIAdapter adapter,
     DBG_MEM_USAGE("done nnpiDeviceNetworkCreate");
   }
 
-  // Initialize all thread envs.
-  for (auto &tEnv : threadEnvs_) {
-    auto success = tEnv.init(nnpiFunction->getCompiledNetworkHandle(),
-                             nnpiFunction->getCompilationConfig(), hostNetwork_,
-                             deviceNetwork_, adapter, device);
-    if (!success) {
+  // Initialize the minimum number of thread envs.
+  function_ = nnpiFunction;
+  for (unsigned i = 0; i < minWorkers_; i++) {
+    auto tEnv = createThreadEnv();
+    if (!tEnv) {
       return MAKE_ERR("Failed to initialize thread env");
     }
+    freeEnvs_.push_back(tEnv.get());
+    threadEnvs_.push_back(std::move(tEnv));
   }
-  if (UseInferenceAPI() && hostNetwork_ != NNPI_INVALID_NNPIHANDLE) {
+  // The host network is needed to create more thread envs later.
+  if (UseInferenceAPI() && hostNetwork_ != NNPI_INVALID_NNPIHANDLE &&
+      numWorkers_ == minWorkers_) {
     DBG_MEM_USAGE("call nnpiHostNetworkDestroy");
     LOG_NNPI_INF_ERROR(nnpiHostNetworkDestroy(hostNetwork_),
                        "Failed to destroy NNPI host network");
@@ -466,18 +498,158 @@ Error InferencePoolEnv::init(unsigned numWorkers, NNPIAdapter adapter,
   return Error::success();
 }
 
+std::unique_ptr<InferenceThreadEnv> InferencePoolEnv::createThreadEnv() {
+  auto tEnv = std::make_unique<InferenceThreadEnv>();
+  auto success = tEnv->init(function_->getCompiledNetworkHandle(),
+                            function_->getCompilationConfig(), hostNetwork_,
+                            deviceNetwork_, adapter_, device_);
+  if (!success) {
+    return nullptr;
+  }
+  return tEnv;
+}
+
+InferenceThreadEnv *InferencePoolEnv::acquireThreadEnv() {
+  std::unique_lock<std::mutex> lock(envsLock_);
+  while (true) {
+    if (!freeEnvs_.empty()) {
+      auto *env = freeEnvs_.back();
+      freeEnvs_.pop_back();
+      return env;
+    }
+    // All thread envs are busy: grow if allowed.
+    if (threadEnvs_.size() + numCreatingEnvs_ < maxWorkers_) {
+      numCreatingEnvs_++;
+      lock.unlock();
+      DBG_MEM_USAGE("call createThreadEnv");
+      auto tEnv = createThreadEnv();
+      DBG_MEM_USAGE("done createThreadEnv");
+      lock.lock();
+      numCreatingEnvs_--;
+      if (!tEnv) {
+        return nullptr;
+      }
+      threadEnvs_.push_back(std::move(tEnv));
+      return threadEnvs_.back().get();
+    }
+    envsCV_.wait(lock);
+  }
+}
+
+InferenceThreadEnv *InferencePoolEnv::tryAcquireThreadEnv() {
+  std::lock_guard<std::mutex> lock(envsLock_);
+  if (freeEnvs_.empty()) {
+    return nullptr;
+  }
+  auto *env = freeEnvs_.back();
+  freeEnvs_.pop_back();
+  return env;
+}
+
+void InferencePoolEnv::releaseThreadEnv(InferenceThreadEnv *env) {
+  std::unique_ptr<InferenceThreadEnv> excessEnv;
+  {
+    std::lock_guard<std::mutex> lock(envsLock_);
+    size_t needed = std::max<size_t>(minWorkers_, queueDepth_);
+    if (threadEnvs_.size() > needed) {
+      numIdleReleases_++;
+    } else {
+      numIdleReleases_ = 0;
+    }
+    if (threadEnvs_.size() > minWorkers_ &&
+        (threadEnvs_.size() > maxWorkers_ ||
+         numIdleReleases_ >= kShrinkAfterIdleReleases)) {
+      numIdleReleases_ = 0;
+      auto it = std::find_if(
+          threadEnvs_.begin(), threadEnvs_.end(),
+          [env](const std::unique_ptr<InferenceThreadEnv> &tEnv) {
+            return tEnv.get() == env;
+          });
+      excessEnv = std::move(*it);
+      threadEnvs_.erase(it);
+    } else {
+      freeEnvs_.push_back(env);
+    }
+  }
+  envsCV_.notify_one();
+  // Destroy the excess thread env, if any, outside of the lock.
+}
+
+void InferencePoolEnv::setMaxWorkers(unsigned maxWorkers) {
+  {
+    std::lock_guard<std::mutex> lock(envsLock_);
+    maxWorkers_ = std::min(std::max(maxWorkers, minWorkers_), numWorkers_);
+    // Destroy the free thread envs in excess right away.
+    while (threadEnvs_.size() > maxWorkers_ && !freeEnvs_.empty()) {
+      auto *env = freeEnvs_.back();
+      freeEnvs_.pop_back();
+      threadEnvs_.erase(std::find_if(
+          threadEnvs_.begin(), threadEnvs_.end(),
+          [env](const std::unique_ptr<InferenceThreadEnv> &tEnv) {
+            return tEnv.get() == env;
+          }));
+    }
+  }
+  envsCV_.notify_all();
+}
+
+unsigned InferencePoolEnv::getNumThreadEnvs() {
+  std::lock_guard<std::mutex> lock(envsLock_);
+  return threadEnvs_.size();
+}
+
 void InferencePoolEnv::stop(bool block) { workersPool_->stop(block); }
 
 void InferencePoolEnv::execute(RunIdentifierTy runId,
                                std::unique_ptr<ExecutionContext> ctx,
                                runtime::ResultCBTy resultCB) {
-  unsigned id = (workerIndex_++) % numWorkers_;
-  workersPool_->submit([this, env = &(threadEnvs_.at(id)), runId,
-                        ctx = std::move(ctx),
+  queueDepth_++;
+  numRequests_++;
+  workersPool_->submit([this, runId, ctx = std::move(ctx),
                         resultCB = std::move(resultCB)]() mutable {
+    auto *preparedBindings =
+        static_cast<NNPIDeviceBindings *>(ctx->getDeviceBindings());
+    auto *env = preparedBindings ? preparedBindings->getThreadEnv()
+                                 : acquireThreadEnv();
+    if (!env) {
+      queueDepth_--;
+      resultCB(runId, MAKE_ERR("Failed to initialize thread env"),
+               std::move(ctx));
+      return;
+    }
     env->execute(runId, std::move(ctx), resultCB);
+    queueDepth_--;
+    releaseThreadEnv(env);
   });
 }
 
+Error InferencePoolEnv::prepare(ExecutionContext &ctx) {
+  // Don't wait for the runs in flight to give an environment back, nor create
+  // one, the inputs are then staged by the worker of the run.
+  auto *env = tryAcquireThreadEnv();
+  if (!env) {
+    return Error::success();
+  }
+  if (!env->stageInputs(ctx)) {
+    env->releaseInputs();
+    releaseThreadEnv(env);
+    return MAKE_ERR("Failed to stage the inputs");
+  }
+  ctx.setDeviceBindings(std::make_unique<NNPIDeviceBindings>(env));
+  return Error::success();
+}
+
+void InferencePoolEnv::release(ExecutionContext &ctx) {
+  auto *preparedBindings =
+      static_cast<NNPIDeviceBindings *>(ctx.getDeviceBindings());
+  if (!preparedBindings) {
+    return;
+  }
+  auto *env = preparedBindings->getThreadEnv();
+  env->releaseInputs();
+  releaseThreadEnv(env);
+  ctx.setDeviceBindings(nullptr);
+}
+
 } // namespace runtime
 } // namespace glow
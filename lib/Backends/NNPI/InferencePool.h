@@ -17,12 +17,15 @@
 #define GLOW_BACKENDS_NNPI_INFERENCEPOOL_H
 
 #include "NNPICompiledFunction.h"
+#include "glow/ExecutionContext/ExecutionContext.h"
 #include "glow/Runtime/RuntimeTypes.h"
 #include "glow/Support/ThreadPool.h"
 #include "nnpi_inference.h"
 #include "nnpi_transformer.h"
 #include <atomic>
+#include <condition_variable>
 #include <map>
+#include <mutex>
 #include <unordered_map>
 #include <vector>
 
@@ -50,9 +53,19 @@ class InferenceThreadEnv {
   std::vector<NNPICopyCommand> inputCopyCmds_, outputCopyCmds_;
   std::vector<void *> rawInputs_, rawOutputs_;
   std::set<int32_t *> tmpBuffers_; // Used for int64 tensors.
+  /// Whether the inputs of the next run were staged by stageInputs().
+  bool inputsStaged_{false};
+
 public:
   InferenceThreadEnv();
   ~InferenceThreadEnv();
+  /// Copies the inputs in \p ctx to the host resources and queues their
+  /// copy to the device, ahead of the execute() of \p ctx. \returns false
+  /// on failure.
+  bool stageInputs(ExecutionContext &ctx);
+  /// Drops the inputs staged by stageInputs() for a run that isn't executed.
+  void releaseInputs();
+  /// Runs \p ctx, staging its inputs first unless stageInputs() did.
   bool execute(RunIdentifierTy runId, std::unique_ptr<ExecutionContext> ctx,
                runtime::ResultCBTy resultCB);
   bool init(
@@ -63,22 +76,96 @@ public:
       NNPIAdapter adapter, NNPIDeviceContext device);
 };
 
+/// The device bindings of a run whose inputs were staged ahead of it by
+/// InferencePoolEnv::prepare() into an environment, which serves the run.
+class NNPIDeviceBindings : public DeviceBindings {
+  InferenceThreadEnv *env_;
+
+public:
+  explicit NNPIDeviceBindings(InferenceThreadEnv *env)
+      : DeviceBindings("NNPI"), env_(env) {}
+
+  InferenceThreadEnv *getThreadEnv() const { return env_; }
+};
+
+/// The inference environments of a network. Requests are served by a pool of
+/// worker threads, each of which checks out a free InferenceThreadEnv for the
+/// duration of a request. Environments are created on demand, when a request
+/// finds none free, up to a maximum that the device manager may change to
+/// rebalance the environments between the networks of a device. Environments
+/// that stay in excess of the observed queue depth are destroyed, down to a
+/// minimum.
 class InferencePoolEnv {
+  /// The number of environments kept even when the network is idle.
+  unsigned minWorkers_;
+  /// The number of worker threads, which bounds the number of environments.
   unsigned numWorkers_;
-  std::atomic<unsigned> workerIndex_;
+  /// The current maximum number of environments, at most numWorkers_.
+  unsigned maxWorkers_;
   std::unique_ptr<ThreadPool> workersPool_;
-  std::vector<InferenceThreadEnv> threadEnvs_;
+  /// All environments, and those not serving a request.
+  std::vector<std::unique_ptr<InferenceThreadEnv>> threadEnvs_;
+  std::vector<InferenceThreadEnv *> freeEnvs_;
+  /// The number of environments being created.
+  unsigned numCreatingEnvs_;
+  /// The number of consecutive requests that finished while there were more
+  /// environments than needed by the queue.
+  unsigned numIdleReleases_;
+  /// Protects the environments and the bounds above.
+  std::mutex envsLock_;
+  /// Signaled when an environment is released or maxWorkers_ grows.
+  std::condition_variable envsCV_;
+  /// The number of requests submitted and not finished yet.
+  std::atomic<unsigned> queueDepth_;
+  /// The number of requests submitted since the last takeNumRequests().
+  std::atomic<uint64_t> numRequests_;
   NNPIHostNetwork hostNetwork_;
   NNPIDeviceNetwork deviceNetwork_;
+  /// What new environments are created from.
+  NNPIAdapter adapter_;
+  NNPIDeviceContext device_;
+  NNPICompiledFunction *function_;
+
+  /// Creates and initializes a new environment. \returns nullptr on failure.
+  std::unique_ptr<InferenceThreadEnv> createThreadEnv();
+  /// \returns a free environment, creating one if allowed, waiting for one
+  /// otherwise. \returns nullptr if it couldn't be created.
+  InferenceThreadEnv *acquireThreadEnv();
+  /// \returns a free environment, or nullptr if there is none.
+  InferenceThreadEnv *tryAcquireThreadEnv();
+  /// Returns \p env after a request, destroying it if it has been in excess
+  /// for a while.
+  void releaseThreadEnv(InferenceThreadEnv *env);
 
 public:
   InferencePoolEnv();
   ~InferencePoolEnv();
-  Error init(unsigned numWorkers, NNPIAdapter adapter, NNPIDeviceContext device,
-             CompiledFunction *compiledFunction);
+  /// Initializes the pool to have between \p minWorkers and \p maxWorkers
+  /// environments, creating the minimum right away.
+  Error init(unsigned minWorkers, unsigned maxWorkers, NNPIAdapter adapter,
+             NNPIDeviceContext device, CompiledFunction *compiledFunction);
   void stop(bool block);
   void execute(RunIdentifierTy runId, std::unique_ptr<ExecutionContext> ctx,
                runtime::ResultCBTy resultCB);
+  /// Stages the inputs in \p ctx into a free environment, if there is one,
+  /// which then serves the execute() of \p ctx. \returns an Error, with
+  /// nothing staged, if the inputs couldn't be staged.
+  Error prepare(ExecutionContext &ctx);
+  /// Gives back the environment staged by prepare() for \p ctx, which isn't
+  /// executed.
+  void release(ExecutionContext &ctx);
+
+  /// \returns the bounds set at init() on the number of environments.
+  unsigned getMinWorkers() const { return minWorkers_; }
+  unsigned getNumWorkers() const { return numWorkers_; }
+  /// Sets the maximum number of environments to \p maxWorkers, clamped to the
+  /// bounds set at init(). Environments in excess are destroyed as they are
+  /// released.
+  void setMaxWorkers(unsigned maxWorkers);
+  /// \returns the number of environments currently allocated.
+  unsigned getNumThreadEnvs();
+  /// \returns the number of requests submitted since the last call.
+  uint64_t takeNumRequests() { return numRequests_.exchange(0); }
 };
 
 using InferencePoolMap = std::unordered_map<std::string, InferencePoolEnv>;
@@ -18,21 +18,69 @@
 #include "Importer.h"
 #include "nnpi_transformer.h"
 
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <unordered_set>
+#include <vector>
+
 using namespace glow;
 
-Error NNPICompiledFunction::compile(Function *F, const BackendOptions &opts) {
-  NNPIImporter importer;
-  network_ = importer.importFunction(F, opts);
-  LOG_INVALID_HANDLE_RETURN_LLVMERROR(network_, "Failed to import function");
+/// Version of the entries of the compiled stream cache. Bump it whenever the
+/// compiled streams change in a way that their key doesn't capture.
+static constexpr char kCompiledStreamCacheVersion[] = "glow-nnpi-stream-1";
 
-  // Apply optimizations.
-  NNPIOptimizationConfig optConf;
-  std::memset(&optConf, 0, sizeof(NNPIOptimizationConfig));
-  optConf.lstmReconstruction = 1;
-  optConf.reorderTransposeConvert = 1;
-  DBG_MEM_USAGE("NNPICompiledFunction call optimize <<");
-  LOG_NNPI_ERROR_RETURN_LLVMERROR(nnpiNetworkOptimize(network_, &optConf),
-                                  "Failed NNPI API Optimize");
+/// \returns the key of the stream compiled from \p F with \p config in the
+/// compiled stream cache: a hash of the nodes of \p F, of the payloads of its
+/// Constants and of \p config. The name of \p F is left out, so that
+/// identical partitions of a network share their stream.
+static std::string getCompiledStreamKey(const Function *F,
+                                        const NNPICompilationConfig &config) {
+  llvm::MD5 hash;
+  auto add = [&hash](llvm::StringRef data) {
+    hash.update(data);
+    // Terminate every part, so that moving bytes from one part to the next
+    // changes the key.
+    hash.update(llvm::StringRef("", 1));
+  };
+  add(kCompiledStreamCacheVersion);
+  add(llvm::StringRef(reinterpret_cast<const char *>(&config), sizeof(config)));
+  std::unordered_set<const Constant *> constants;
+  for (const auto &N : F->getNodes()) {
+    add(N.getDebugDesc());
+    // The Constants are compiled into the stream.
+    for (unsigned i = 0, e = N.getNumInputs(); i < e; i++) {
+      auto *C = llvm::dyn_cast<Constant>(N.getNthInput(i).getNode());
+      if (C && constants.insert(C).second) {
+        const auto &payload = C->getPayload();
+        add(C->getName());
+        add(llvm::StringRef(payload.getUnsafePtr(), payload.getSizeInBytes()));
+      }
+    }
+  }
+  llvm::MD5::MD5Result result;
+  hash.final(result);
+  llvm::SmallString<32> key;
+  llvm::MD5::stringifyResult(result, key);
+  return key.str();
+}
+
+/// \returns the path of the stream \p key in the cache directory
+/// \p cacheDir.
+static std::string getCachedStreamPath(llvm::StringRef cacheDir,
+                                       llvm::StringRef key) {
+  llvm::SmallString<128> path(cacheDir);
+  llvm::sys::path::append(path, key + ".nnpi");
+  return path.str();
+}
+
+Error NNPICompiledFunction::setupCompilationConfig(const BackendOptions &opts) {
+  // Clear the padding too, the config is part of the compiled stream key.
+  std::memset(&config_, 0, sizeof(NNPICompilationConfig));
   DBG_MEM_USAGE("NNPICompiledFunction call get compilation config <<");
   LOG_NNPI_ERROR_RETURN_LLVMERROR(nnpiGetDefaultCompilationConfig(&config_),
                                   "Failed NNPI API Read Config");
@@ -62,6 +110,106 @@ Error NNPICompiledFunction::compile(Function *F, const BackendOptions &opts) {
           false, "INVALID NNPI_DEVICE_VERSION, valid values are 1,2,3");
     }
   }
+  return Error::success();
+}
+
+bool NNPICompiledFunction::loadCachedStream(llvm::StringRef cacheDir,
+                                            llvm::StringRef key) {
+  auto path = getCachedStreamPath(cacheDir, key);
+  auto bufOrErr = llvm::MemoryBuffer::getFile(path);
+  if (!bufOrErr) {
+    return false;
+  }
+  const auto &buf = *bufOrErr.get();
+  compiledStream_.reset();
+  if (compiledStream_.write(buf.getBufferStart(), buf.getBufferSize()) <
+      buf.getBufferSize()) {
+    LOG(WARNING) << "Unable to read the compiled stream " << path;
+    compiledStream_.reset();
+    return false;
+  }
+  LOG(INFO) << "Using the cached compiled stream " << path;
+  return true;
+}
+
+void NNPICompiledFunction::storeCachedStream(llvm::StringRef cacheDir,
+                                             llvm::StringRef key) {
+  auto path = getCachedStreamPath(cacheDir, key);
+  if (auto EC = llvm::sys::fs::create_directories(cacheDir)) {
+    LOG(WARNING) << "Unable to create the compiled stream cache directory "
+                 << cacheDir.str() << ": " << EC.message();
+    return;
+  }
+  // Write to a unique file in the cache directory and rename it into place,
+  // so that concurrent writers of the same stream never expose a partial
+  // one.
+  int fd;
+  llvm::SmallString<128> tempPath;
+  if (auto EC =
+          llvm::sys::fs::createUniqueFile(path + "-%%%%%%.tmp", fd, tempPath)) {
+    LOG(WARNING) << "Unable to store the compiled stream " << path << ": "
+                 << EC.message();
+    return;
+  }
+  bool written;
+  {
+    llvm::raw_fd_ostream os(fd, /* shouldClose */ true);
+    std::vector<char> chunk(DEFAULT_BLOCK_STREAM_BLOCK_SIZE);
+    compiledStream_.resetRead();
+    // The stream doesn't bound its reads, read exactly what was written.
+    for (size_t left = compiledStream_.getSize(); left;) {
+      size_t size = compiledStream_.read(chunk.data(),
+                                         std::min(left, chunk.size()));
+      os.write(chunk.data(), size);
+      left -= size;
+    }
+    compiledStream_.resetRead();
+    os.close();
+    written = !os.has_error();
+    os.clear_error();
+  }
+  if (!written) {
+    LOG(WARNING) << "Unable to write the compiled stream " << path;
+    llvm::sys::fs::remove(tempPath);
+    return;
+  }
+  if (auto EC = llvm::sys::fs::rename(tempPath, path)) {
+    LOG(WARNING) << "Unable to store the compiled stream " << path << ": "
+                 << EC.message();
+    llvm::sys::fs::remove(tempPath);
+  }
+}
+
+Error NNPICompiledFunction::compile(Function *F, const BackendOptions &opts) {
+  RETURN_IF_ERR(setupCompilationConfig(opts));
+
+  // Only the streams compiled to memory for the inference API are cached,
+  // the other paths need the imported network.
+  std::string cacheDir = EnvCompiledStreamCacheDir();
+  if (cacheDir.empty() &&
+      opts.backendSpecificOpts.count("NNPICompiledStreamCacheDir")) {
+    cacheDir = opts.backendSpecificOpts.at("NNPICompiledStreamCacheDir");
+  }
+  std::string cacheKey;
+  if (!cacheDir.empty() && UseInferenceAPI() && ICETFilename().empty()) {
+    cacheKey = getCompiledStreamKey(F, config_);
+    if (loadCachedStream(cacheDir, cacheKey)) {
+      return Error::success();
+    }
+  }
+
+  NNPIImporter importer;
+  network_ = importer.importFunction(F, opts);
+  LOG_INVALID_HANDLE_RETURN_LLVMERROR(network_, "Failed to import function");
+
+  // Apply optimizations.
+  NNPIOptimizationConfig optConf;
+  std::memset(&optConf, 0, sizeof(NNPIOptimizationConfig));
+  optConf.lstmReconstruction = 1;
+  optConf.reorderTransposeConvert = 1;
+  DBG_MEM_USAGE("NNPICompiledFunction call optimize <<");
+  LOG_NNPI_ERROR_RETURN_LLVMERROR(nnpiNetworkOptimize(network_, &optConf),
+                                  "Failed NNPI API Optimize");
 
   if (UseIceT() || UseInferenceAPI()) {
     auto filename = ICETFilename();
@@ -102,10 +250,16 @@ Error NNPICompiledFunction::compile(Function *F, const BackendOptions &opts) {
           "Failed NNPI Compile");
     }
   }
+  if (!cacheKey.empty()) {
+    storeCachedStream(cacheDir, cacheKey);
+  }
   return Error::success();
 }
 
 NNPICompiledFunction::~NNPICompiledFunction() {
+  if (network_ == NNPI_INVALID_NNPIHANDLE) {
+    return;
+  }
   LOG_NNPI_ERROR(nnpiNetworkDestroy(network_), "Failed NNPI Network Destroy");
 }
 
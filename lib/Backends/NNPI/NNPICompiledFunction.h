@@ -21,6 +21,7 @@
 #include "glow/Backends/BackendOptions.h"
 #include "glow/ExecutionContext/ExecutionContext.h"
 #include "nnpi_transformer.h"
+#include "llvm/ADT/StringRef.h"
 #include <map>
 #include <memory>
 #include <mutex>
@@ -62,7 +63,20 @@ public:
   virtual Error compile(Function *F, const BackendOptions &opts);
 
 private:
-  NNPINetwork network_;
+  /// Fills config_ from the defaults of NNPI and from \p opts.
+  Error setupCompilationConfig(const BackendOptions &opts);
+
+  /// Reads the stream compiled for the key \p key from the cache directory
+  /// \p cacheDir. \returns false if the cache doesn't hold it.
+  bool loadCachedStream(llvm::StringRef cacheDir, llvm::StringRef key);
+
+  /// Writes the compiled stream to the cache directory \p cacheDir for the
+  /// key \p key. Failures are only logged.
+  void storeCachedStream(llvm::StringRef cacheDir, llvm::StringRef key);
+
+  /// The imported network, which is invalid when the compiled stream was
+  /// loaded from the cache.
+  NNPINetwork network_{NNPI_INVALID_NNPIHANDLE};
   NNPICompilationConfig config_;
   BlockStream compiledStream_;
   std::mutex compiledStreamMutex_;
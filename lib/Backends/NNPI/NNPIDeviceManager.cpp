@@ -27,6 +27,8 @@
 
 #include "DebugMacros.h"
 
+#include <algorithm>
+
 namespace glow {
 namespace runtime {
 
@@ -38,6 +40,29 @@ static llvm::cl::opt<unsigned, /* ExternalStorage */ true>
                                      "per NNPI device, in kilobytes"),
                       llvm::cl::location(GlowNNPIMemory));
 
+static llvm::cl::opt<unsigned> GlowNNPIMinInferenceWorkers(
+    "glow-nnpi-min-inference-workers",
+    llvm::cl::desc("Number of inference environments kept per function on an "
+                   "NNPI device when it is idle"),
+    llvm::cl::init(1));
+
+static llvm::cl::opt<unsigned> GlowNNPIMaxInferenceWorkers(
+    "glow-nnpi-max-inference-workers",
+    llvm::cl::desc("Number of inference environments a function on an NNPI "
+                   "device may grow to under load"),
+    llvm::cl::init(4));
+
+static llvm::cl::opt<unsigned> GlowNNPIDeviceInferenceWorkers(
+    "glow-nnpi-device-inference-workers",
+    llvm::cl::desc("Number of inference environments shared by the functions "
+                   "of an NNPI device according to their load, 0 for no "
+                   "limit"),
+    llvm::cl::init(0));
+
+/// Number of requests on a device between rebalancings of its inference
+/// environments.
+static constexpr RunIdentifierTy kRebalancePeriod = 1024;
+
 DeviceManager *createNNPIDeviceManager(const DeviceConfig &config) {
   return new NNPIDeviceManager(config);
 }
@@ -47,8 +72,10 @@ std::atomic<RunIdentifierTy> NNPIDeviceManager::runIdentifier_;
 
 NNPIDeviceManager::NNPIDeviceManager(const DeviceConfig &config,
                                      unsigned numInferenceWorkers)
-    : DeviceManager(config), numWorkersPerFunction_(numInferenceWorkers),
-      deviceId_(0), adapter_(NNPI_INVALID_NNPIHANDLE),
+    : DeviceManager(config), minWorkersPerFunction_(numInferenceWorkers),
+      maxWorkersPerFunction_(numInferenceWorkers),
+      numWorkersPerDevice_(GlowNNPIDeviceInferenceWorkers), deviceId_(0),
+      adapter_(NNPI_INVALID_NNPIHANDLE),
       device_(NNPI_INVALID_NNPIHANDLE) {
   auto it = config_.parameters.find("DeviceID");
   if (it != config_.parameters.end()) {
@@ -57,11 +84,13 @@ NNPIDeviceManager::NNPIDeviceManager(const DeviceConfig &config,
     deviceId_ = std::stoul(it->second);
   }
 
-  if (!numWorkersPerFunction_) {
-    numWorkersPerFunction_ =
-        UseInferenceAPI()
-            ? 2
-            : 1; // Ice-ref not re-entrant for the same nnpiNetwork.
+  if (!UseInferenceAPI()) {
+    // Ice-ref not re-entrant for the same nnpiNetwork.
+    minWorkersPerFunction_ = maxWorkersPerFunction_ = 1;
+  } else if (!numInferenceWorkers) {
+    minWorkersPerFunction_ = std::max<unsigned>(GlowNNPIMinInferenceWorkers, 1);
+    maxWorkersPerFunction_ = std::max<unsigned>(GlowNNPIMaxInferenceWorkers,
+                                                minWorkersPerFunction_);
   }
 }
 
@@ -139,14 +168,18 @@ void NNPIDeviceManager::addNetwork(const Module *module,
   for (const auto &func : functions) {
     functions_.emplace(func.first, func.second);
     usedMemoryBytes_ += functionCost_; // TODO:: static moduleSize.
+    addNetworkMemoryUsage(
+        func.first, NetworkMemoryUsage(func.second->getRuntimeBundle()));
 
-    auto err = inferenceEnvs_[func.first].init(numWorkersPerFunction_, adapter_,
+    auto err = inferenceEnvs_[func.first].init(minWorkersPerFunction_,
+                                               maxWorkersPerFunction_, adapter_,
                                                device_, func.second);
     if (err) {
       lock.unlock();
       readyCB(module, std::move(err));
     }
   }
+  rebalanceInferenceEnvs();
 
   LOG_IF(WARNING, usedMemoryBytes_ > maxMemoryBytes_)
       << "Using more memory than expected";
@@ -163,9 +196,11 @@ void NNPIDeviceManager::evictNetwork(std::string functionName,
 
   if (functions_.erase(functionName)) {
     usedMemoryBytes_ -= functionCost_; // TODO: static moduleSize.
+    removeNetworkMemoryUsage(functionName);
     inferenceEnvs_.at(functionName)
         .stop(true); // First stop existing threads on this network.
     inferenceEnvs_.erase(functionName);
+    rebalanceInferenceEnvs();
   } else {
     err =
         MAKE_ERR(ErrorValue::ErrorCode::RUNTIME_NET_NOT_FOUND,
@@ -196,9 +231,55 @@ NNPIDeviceManager::runFunction(std::string functionName,
     return runId;
   }
   infEnv->second.execute(runId, std::move(ctx), std::move(resultCB));
+
+  if (numWorkersPerDevice_ && runId % kRebalancePeriod == 0) {
+    std::lock_guard<std::mutex> lock(functionMapMutex_);
+    rebalanceInferenceEnvs();
+  }
   return runId;
 }
 
+Error NNPIDeviceManager::prepareInputs(const std::string &functionName,
+                                       ExecutionContext &context) {
+  auto infEnv = inferenceEnvs_.find(functionName);
+  if (infEnv == inferenceEnvs_.end()) {
+    return MAKE_ERR("Function isn't ready on the device");
+  }
+  return infEnv->second.prepare(context);
+}
+
+void NNPIDeviceManager::releaseInputs(const std::string &functionName,
+                                      ExecutionContext &context) {
+  auto infEnv = inferenceEnvs_.find(functionName);
+  if (infEnv != inferenceEnvs_.end()) {
+    infEnv->second.release(context);
+  }
+}
+
+void NNPIDeviceManager::rebalanceInferenceEnvs() {
+  if (!numWorkersPerDevice_ || inferenceEnvs_.empty()) {
+    return;
+  }
+
+  // Every function keeps its minimum, the rest is split by load.
+  uint64_t totalRequests = 0;
+  unsigned spareWorkers = numWorkersPerDevice_;
+  std::vector<std::pair<InferencePoolEnv *, uint64_t>> loads;
+  for (auto &env : inferenceEnvs_) {
+    auto numRequests = env.second.takeNumRequests();
+    totalRequests += numRequests;
+    spareWorkers -= std::min(spareWorkers, env.second.getMinWorkers());
+    loads.emplace_back(&env.second, numRequests);
+  }
+  for (auto &load : loads) {
+    auto *env = load.first;
+    unsigned share =
+        totalRequests ? spareWorkers * load.second / totalRequests
+                      : spareWorkers / loads.size();
+    env->setMaxWorkers(env->getMinWorkers() + share);
+  }
+}
+
 Error NNPIDeviceManager::stop(bool block) {
   for (auto &env : inferenceEnvs_) {
     env.second.stop(block);
@@ -47,8 +47,13 @@ class NNPIDeviceManager : public DeviceManager {
   uint64_t usedMemoryBytes_{0};
   /// Static memory cost of the InterpreterFunction.
   const uint64_t functionCost_{1};
-  /// Number of worker threads allocated per loaded function.
-  unsigned numWorkersPerFunction_;
+  /// Minimum and maximum number of inference environments, each with a worker
+  /// thread, per loaded function.
+  unsigned minWorkersPerFunction_;
+  unsigned maxWorkersPerFunction_;
+  /// Number of inference environments that the functions of the device share
+  /// when rebalanced, or 0 to let each function grow to its maximum.
+  unsigned numWorkersPerDevice_;
 
   /// Inference id counter.
   static std::atomic<RunIdentifierTy> runIdentifier_;
@@ -65,6 +70,12 @@ class NNPIDeviceManager : public DeviceManager {
   /// Lock to synchronize function adding/removing to/from the device manager.
   std::mutex functionMapMutex_;
 
+  /// Splits the numWorkersPerDevice_ inference environments between the
+  /// functions of the device, in proportion to the requests each received
+  /// since the last rebalancing and within the bounds of each. Must be called
+  /// with functionMapMutex_ held.
+  void rebalanceInferenceEnvs();
+
 public:
   explicit NNPIDeviceManager(const DeviceConfig &config,
                              unsigned numInferenceWorkers = 0);
@@ -78,6 +89,12 @@ public:
   RunIdentifierTy runFunction(std::string functionName,
                               std::unique_ptr<ExecutionContext> ctx,
                               runtime::ResultCBTy resultCB) override;
+  /// Stages the inputs into a free inference environment of the function, if
+  /// there is one.
+  Error prepareInputs(const std::string &functionName,
+                      ExecutionContext &context) override;
+  void releaseInputs(const std::string &functionName,
+                     ExecutionContext &context) override;
   Error stop(bool block) override;
   uint64_t getMaximumMemory() const override;
   uint64_t getAvailableMemory() const override;
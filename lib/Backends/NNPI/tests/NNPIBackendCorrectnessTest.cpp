@@ -22,9 +22,21 @@ std::set<std::string> glow::backendTestBlacklist = {
     "basicFCNet/0",
     "basicFCNetQuantized/0",
     "complexNet1/0",
+    "convDepthwise3x3Test/0",
+    "convDepthwise5x5StrideTest/0",
+    "convDepthwisePointwiseTest/0",
     "convDKKC8Test/0",
     "convGradTest/0",
+    "convIm2ColTest/0",
+    "convPointwiseReluTest/0",
+    "convPointwiseTest/0",
+    "convResidualReluTest/0",
     "convTest/0",
+    "convWinogradResidualClipTest/0",
+    "convWinogradTest/0",
+    "fastMathTest/0",
+    "gatherScatterTest/0",
+    "sliceConcatTest/0",
     "groupConvTest/0",
     "intLookupTable/0",
     "localResponseNormalizationGradTest/0",
@@ -32,7 +44,11 @@ std::set<std::string> glow::backendTestBlacklist = {
     "nonSquareKernelConvTest/0",
     "nonSquarePaddingConvTest/0",
     "nonSquareStrideConvTest/0",
+    "poolsTest/0",
+    "quantizedConvDepthwiseTest/0",
     "quantizedConvTest/0",
+    "quantizedSandwichTest/0",
+    "reductionsTest/0",
     "softmaxGradTest/0",
 };
 
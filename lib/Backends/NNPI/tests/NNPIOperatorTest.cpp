@@ -37,15 +37,18 @@ std::set<std::string> glow::backendTestBlacklist = {
     "convTest/0",
     "convTest_Float16/0",
     "DilatedConvolution/0",
+    "DynamicQuantizedFC/0",
     "EntropyLossTest/0",
     "FCGradientCheck/0",
     "FloatArgMaxKeepDim/0",
     "FloatArgMaxNoKeepDim/0",
     "FloatMaxPoolWithArgmax/0",
     "FloatMaxPoolWithArgmaxTransposed/0",
+    "Transpose6Dims/0",
     "FP16AdaptiveAvgPool/0",
     "GroupConv3D/0",
     "GroupDilatedConvolution/0",
+    "ChannelwiseQuantizedConvolution/0",
     "GroupwiseQuantizedConvolution/0",
     "insertTensorTest/0",
     "Int16ConvolutionDepth10/0",
@@ -82,6 +85,9 @@ std::set<std::string> glow::backendTestBlacklist = {
     "ResizeNearest_Int16/0",
     "ResizeNearest_Int32/0",
     "ResizeNearest_Int8/0",
+    "ResizeBilinear_Float/0",
+    "ResizeBilinear_Float16/0",
+    "ResizeBilinear_Int8/0",
     "rowwiseQuantizedFCTest/0",
     "ScatterAddNDimensionalDuplicatingIndices/0",
     "ScatterAddNDimensionalSimple/0",
@@ -96,6 +102,7 @@ std::set<std::string> glow::backendTestBlacklist = {
     "spaceToDepth_block2_int8/0",
     "spaceToDepth_block3_Float/0",
     "spaceToDepth_block3_int8/0",
+    "SparseLengthsSumRaggedIndices/0",
     "SparseToDense/0",
     "SparseToDenseMask1/0",
     "SparseToDenseMask2/0",
@@ -129,6 +136,7 @@ struct EmulatorOnlyTests {
           "batchedReduceMeanWithAxis/0",
           "batchedReduceZeroDimResult_Float/0",
           "Bucketize/0",
+          "BucketizeManyBoundaries/0",
           "CmpEQ/0",
           "ConcatTopK/0",
           "ConvertFrom_FloatTy_To_Int32ITy/0",
@@ -144,6 +152,7 @@ struct EmulatorOnlyTests {
           "Exp/0",
           "FusedRowwiseQuantizedSparseLengthsWeightedSum_ConvertedFloat16_back_"
           "to_back/0",
+          "FusedRowwiseQuantizedSparseLengthsWeightedSum_Float_4Bit/0",
           "MaxPool/0",
           "NonSquareKernelAveragePool/0",
           "NonSquareKernelConvolution/0",
@@ -155,6 +164,7 @@ struct EmulatorOnlyTests {
           "SoftMax/0",
           "TopK/0",
           "TopK1/0",
+          "TopKWideRows/0",
           "TransposeIntoReshapeOptim/0",
           "FusedRWQSLSAllZeroLengths_Float/0",
           "FusedRWQSLSAllZeroLengths_Float16/0",
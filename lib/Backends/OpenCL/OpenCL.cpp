@@ -21,6 +21,8 @@
 #define CL_USE_DEPRECATED_OPENCL_1_2_APIS
 
 #include "OpenCL.h"
+#include "OpenCLProgramCache.h"
+#include "OpenCLTuningCache.h"
 
 #include "glow/Backend/BackendUtils.h"
 #include "glow/CodeGen/MemoryAllocator.h"
@@ -39,6 +41,10 @@
 #include "llvm/Support/Format.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
 #define DEBUG_TYPE "opencl"
 
 using namespace glow;
@@ -82,6 +88,35 @@ llvm::cl::opt<bool> clDoProfile("opencl-profile",
                                 llvm::cl::desc("Profile OpenCL kernels"),
                                 llvm::cl::init(false),
                                 llvm::cl::cat(OpenCLBackendCat));
+static llvm::cl::opt<std::string> clProgramCacheDir(
+    "opencl-program-cache-dir",
+    llvm::cl::desc("Directory in which the binaries of the built OpenCL "
+                   "programs are cached across runs, disabled when empty"),
+    llvm::cl::init(""), llvm::cl::cat(OpenCLBackendCat));
+static llvm::cl::opt<bool> clAutotune(
+    "opencl-autotune",
+    llvm::cl::desc("Benchmark the local work sizes of the kernels and the "
+                   "tile sizes of the convolutions the first time they run "
+                   "with a given shape, and use the fastest ones"),
+    llvm::cl::init(false), llvm::cl::cat(OpenCLBackendCat));
+static llvm::cl::opt<std::string> clAutotuneCache(
+    "opencl-autotune-cache",
+    llvm::cl::desc("File in which the configurations found by "
+                   "-opencl-autotune are persisted across runs"),
+    llvm::cl::init(""), llvm::cl::cat(OpenCLBackendCat));
+static llvm::cl::opt<unsigned> clWeightStreamingGroupMB(
+    "opencl-weight-streaming-group-mb",
+    llvm::cl::desc("Megabytes of constants copied to the device at a time by "
+                   "the consecutive instructions of functions whose "
+                   "constants are streamed"),
+    llvm::cl::init(64), llvm::cl::cat(OpenCLBackendCat));
+
+/// Number of timed runs of every candidate configuration benchmarked by the
+/// autotuner, after a warm-up run.
+static constexpr unsigned kTuningRuns = 3;
+
+/// Maximum number of local work sizes benchmarked for a kernel.
+static constexpr size_t kMaxLocalWorkSizeCandidates = 32;
 
 static void dumpCompileLog(cl_device_id dev, cl_program prog) {
 #ifndef NDEBUG
@@ -107,6 +142,99 @@ static void addStringOption(std::vector<std::string> &options,
   options.push_back("-D" + name + "=" + value);
 }
 
+/// \returns the string valued info \p param of \p device.
+static std::string getDeviceInfoString(cl_device_id device,
+                                       cl_device_info param) {
+  size_t size;
+  cl_int err = clGetDeviceInfo(device, param, 0, nullptr, &size);
+  CHECK_EQ(err, CL_SUCCESS) << "Could not execute clGetDeviceInfo";
+  std::string value(size, '\0');
+  err = clGetDeviceInfo(device, param, size, &value[0], nullptr);
+  CHECK_EQ(err, CL_SUCCESS) << "Could not execute clGetDeviceInfo";
+  // Drop the terminating null character.
+  return value.c_str();
+}
+
+/// \returns the name of \p device, which identifies it in the caches.
+static std::string getDeviceName(cl_device_id device) {
+  return getDeviceInfoString(device, CL_DEVICE_NAME);
+}
+
+/// \returns the program for \p device in \p ctx created from \p binary and
+/// built with \p options, or nullptr if there is no binary or the driver
+/// rejects it, e.g. after a driver update the key didn't capture.
+static cl_program
+createProgramFromBinary(std::unique_ptr<llvm::MemoryBuffer> binary,
+                        cl_context ctx, cl_device_id device,
+                        const std::string &options) {
+  if (!binary) {
+    return nullptr;
+  }
+  size_t size = binary->getBufferSize();
+  auto *data =
+      reinterpret_cast<const unsigned char *>(binary->getBufferStart());
+  cl_int status;
+  cl_int err;
+  cl_program program =
+      clCreateProgramWithBinary(ctx, 1, &device, &size, &data, &status, &err);
+  if (err == CL_SUCCESS && status == CL_SUCCESS) {
+    // Programs created from binaries have to be built too, which is cheap.
+    err = clBuildProgram(program, 1, &device, options.c_str(), nullptr,
+                         nullptr);
+    if (err == CL_SUCCESS) {
+      return program;
+    }
+  }
+  LOG(WARNING) << "Ignoring a cached program binary rejected by the driver";
+  if (program) {
+    clReleaseProgram(program);
+  }
+  return nullptr;
+}
+
+/// Stores the binary of the built \p program for \p device into \p cache
+/// for \p key.
+static void storeProgramBinary(const OpenCLProgramCache &cache,
+                               llvm::StringRef key, cl_program program,
+                               cl_device_id device) {
+  cl_uint numDevices;
+  cl_int err = clGetProgramInfo(program, CL_PROGRAM_NUM_DEVICES,
+                                sizeof(numDevices), &numDevices, nullptr);
+  if (err != CL_SUCCESS) {
+    return;
+  }
+  std::vector<cl_device_id> devices(numDevices);
+  std::vector<size_t> sizes(numDevices);
+  err = clGetProgramInfo(program, CL_PROGRAM_DEVICES,
+                         sizeof(cl_device_id) * numDevices, devices.data(),
+                         nullptr);
+  if (err != CL_SUCCESS) {
+    return;
+  }
+  err = clGetProgramInfo(program, CL_PROGRAM_BINARY_SIZES,
+                         sizeof(size_t) * numDevices, sizes.data(), nullptr);
+  if (err != CL_SUCCESS) {
+    return;
+  }
+  auto it = std::find(devices.begin(), devices.end(), device);
+  if (it == devices.end() || !sizes[it - devices.begin()]) {
+    return;
+  }
+  // The driver returns the binaries of all devices of the program at once,
+  // skipping the null pointers.
+  size_t idx = it - devices.begin();
+  std::string binary(sizes[idx], '\0');
+  std::vector<unsigned char *> binaries(numDevices, nullptr);
+  binaries[idx] = reinterpret_cast<unsigned char *>(&binary[0]);
+  err = clGetProgramInfo(program, CL_PROGRAM_BINARIES,
+                         sizeof(unsigned char *) * numDevices, binaries.data(),
+                         nullptr);
+  if (err != CL_SUCCESS) {
+    return;
+  }
+  cache.store(key, binary);
+}
+
 OpenCLFunction::OpenCLFunction(std::unique_ptr<IRFunction> F,
                                runtime::RuntimeBundle &&bundle,
                                TraceInfo traceInfo)
@@ -122,10 +250,99 @@ OpenCLFunction::OpenCLFunction(std::unique_ptr<IRFunction> F,
     }
   }
   setTraceInfo(std::move(traceInfo));
+  planWeightStreaming();
 }
 
 void OpenCLFunction::freeCompilationResources() {
-  runtimeBundle_.freeConstants();
+  if (!streamsConstants_) {
+    runtimeBundle_.freeConstants();
+  }
+}
+
+void OpenCLFunction::planWeightStreaming() {
+  uint64_t constantsSize = runtimeBundle_.getConstantWeightSize();
+  if (!constantsSize) {
+    return;
+  }
+  uint64_t budget = uint64_t(clWeightStreamingGroupMB) << 20;
+  uint64_t groupSize = 0;
+  for (const auto &I : F_->getInstrs()) {
+    // The constants of the instruction, and the bytes of those the current
+    // group doesn't have yet.
+    llvm::SmallVector<std::pair<uint64_t, uint64_t>, 4> constants;
+    uint64_t newSize = 0;
+    for (const auto &op : I.getOperands()) {
+      auto *origin = getOrigin(op.first);
+      if (!isa<WeightVar>(origin)) {
+        continue;
+      }
+      uint64_t offset = runtimeBundle_.getValueOffset(origin);
+      if (offset >= constantsSize ||
+          std::any_of(constants.begin(), constants.end(),
+                      [offset](const std::pair<uint64_t, uint64_t> &c) {
+                        return c.first == offset;
+                      })) {
+        continue;
+      }
+      uint64_t size = origin->getSizeInBytes();
+      constants.push_back({offset, size});
+      if (streamingGroups_.empty() ||
+          !streamingGroups_.back().addresses.count(offset)) {
+        newSize += alignedSize(size, TensorAlignment);
+      }
+    }
+    if (streamingGroups_.empty() ||
+        (groupSize && groupSize + newSize > budget)) {
+      streamingGroups_.push_back({&I, {}, {}});
+      groupSize = 0;
+    }
+    auto &group = streamingGroups_.back();
+    for (const auto &c : constants) {
+      if (group.addresses.emplace(c.first, groupSize).second) {
+        group.constants.push_back(c);
+        groupSize += alignedSize(c.second, TensorAlignment);
+      }
+    }
+    streamingHalfSize_ = std::max(streamingHalfSize_, groupSize);
+  }
+  // The odd groups use the second half of the streaming region.
+  for (size_t i = 1; i < streamingGroups_.size(); i += 2) {
+    for (auto &address : streamingGroups_[i].addresses) {
+      address.second += streamingHalfSize_;
+    }
+  }
+}
+
+uint64_t OpenCLFunction::getStreamingRegionSize() const {
+  // The values past the region are as aligned as in the runtime bundle.
+  return alignedSize(2 * streamingHalfSize_, TensorAlignment) +
+         runtimeBundle_.getConstantWeightSize() % TensorAlignment;
+}
+
+void OpenCLFunction::enqueueStreamingCopies(
+    size_t group, runtime::OpenCLDeviceBindings *devBindings,
+    std::vector<cl_event> &copied, const std::vector<cl_event> &computed) {
+  cl_command_queue queue = devBindings->transferQueue;
+  // The half of the group was last used by the group before the previous
+  // one.
+  if (group >= 2) {
+    cl_int err = clEnqueueBarrierWithWaitList(queue, 1, &computed[group - 2],
+                                              nullptr);
+    CHECK_EQ(err, CL_SUCCESS) << "Unable to wait for the kernels";
+  }
+  const auto &streamingGroup = streamingGroups_[group];
+  const uint8_t *constants = runtimeBundle_.getConstants();
+  for (const auto &c : streamingGroup.constants) {
+    cl_int err = clEnqueueWriteBuffer(
+        queue, devBindings->deviceBuffer, /* blocking_write */ CL_FALSE,
+        streamingGroup.addresses.at(c.first), c.second, constants + c.first,
+        /* num_events_in_wait_list */ 0, /* event_list */ nullptr,
+        /* event */ nullptr);
+    CHECK_EQ(err, CL_SUCCESS) << "Unable to copy constants to the device";
+  }
+  cl_int err = clEnqueueMarkerWithWaitList(queue, 0, nullptr, &copied[group]);
+  CHECK_EQ(err, CL_SUCCESS) << "Unable to mark the copies";
+  clFlush(queue);
 }
 
 OpenCLFunction::~OpenCLFunction() {
@@ -191,7 +408,23 @@ OpenCLFunction::createProgram(const std::string &source,
     return program;
   }
   // Create a new compiled program. This will also add the program to the cache
-  // because 'program' is a reference to an existing cache item.
+  // because 'program' is a reference to an existing cache item. The binary of
+  // a program built before, e.g. by an earlier process, is loaded from the
+  // on-disk cache rather than compiling the source again.
+  OpenCLProgramCache diskCache(clProgramCacheDir);
+  std::string diskKey;
+  if (!clProgramCacheDir.empty()) {
+    diskKey = OpenCLProgramCache::getKey(
+        getDeviceName(deviceId),
+        getDeviceInfoString(deviceId, CL_DEVICE_VERSION),
+        getDeviceInfoString(deviceId, CL_DRIVER_VERSION), source,
+        combinedOptions);
+    program = createProgramFromBinary(diskCache.load(diskKey), ctx, deviceId,
+                                      combinedOptions);
+    if (program) {
+      return program;
+    }
+  }
   program = clCreateProgramWithSource(ctx, 1, &src, nullptr, &err);
   CHECK(program) << "clCreateProgramWithSource Failed.";
   err = clBuildProgram(program, 0, nullptr, combinedOptions.c_str(), nullptr,
@@ -200,6 +433,9 @@ OpenCLFunction::createProgram(const std::string &source,
     dumpCompileLog(deviceId, program);
   }
   CHECK_EQ(err, CL_SUCCESS) << "clBuildProgram Failed.";
+  if (!diskKey.empty()) {
+    storeProgramBinary(diskCache, diskKey, program, deviceId);
+  }
 
   return program;
 }
@@ -210,15 +446,39 @@ static void setKernelArg(cl_kernel kernel, unsigned argIdx, T value) {
   CHECK_EQ(err, CL_SUCCESS) << "Unable to set parameter";
 }
 
+/// \returns the address in the device buffer of the run of \p devBindings of
+/// the value at offset \p addr in \p bundle. The constants come first and are
+/// shared by all the runs in the buffer, unless they are streamed, and the
+/// mutable weights and activations of the run are runOffset bytes past where
+/// \p bundle places them.
+static uint64_t getRunAddress(const runtime::RuntimeBundle &bundle,
+                              const runtime::OpenCLDeviceBindings &devBindings,
+                              uint64_t addr) {
+  if (addr >= bundle.getConstantWeightSize()) {
+    return addr + devBindings.runOffset;
+  }
+  const auto *streamed = devBindings.streamedAddresses;
+  if (!streamed) {
+    return addr;
+  }
+  // The value may be a view into a streamed constant.
+  auto it = streamed->upper_bound(addr);
+  DCHECK(it != streamed->begin()) << "The constant is not streamed";
+  --it;
+  return it->second + (addr - it->first);
+}
+
 /// Set OpenCL \p kernel arguments using the buffer operands of the
 /// instruction \p I. The first of these arguments should be passed to the \p
 /// kernel at index \p nextKernelArgIdx. The \p bundle provides symbolTable, a
-/// mapping from Values to on-device buffer offsets of these values.
+/// mapping from Values to on-device buffer offsets of these values, which are
+/// relocated for the run of \p devBindings, see getRunAddress.
 ///
 /// \returns the index of the last set OpenCL kernel argument.
-static size_t setKernelArgsForBuffers(cl_kernel kernel, const Instruction &I,
-                                      size_t nextKernelArgIdx,
-                                      runtime::RuntimeBundle &bundle) {
+static size_t
+setKernelArgsForBuffers(cl_kernel kernel, const Instruction &I,
+                        size_t nextKernelArgIdx, runtime::RuntimeBundle &bundle,
+                        const runtime::OpenCLDeviceBindings &devBindings) {
   // Number of instruction operands.
   auto numArgs = I.getNumOperands();
   // The predicate of the instruction if available.
@@ -233,7 +493,9 @@ static size_t setKernelArgsForBuffers(cl_kernel kernel, const Instruction &I,
     if (value == predicate)
       continue;
     // The value is a buffer that should be passed as a kernel argument.
-    setKernelArg<cl_uint>(kernel, kernelArgIdx, bundle.getValueOffset(value));
+    setKernelArg<cl_uint>(
+        kernel, kernelArgIdx,
+        getRunAddress(bundle, devBindings, bundle.getValueOffset(value)));
     kernelArgIdx++;
   }
   return kernelArgIdx - 1;
@@ -276,7 +538,7 @@ void OpenCLFunction::fillBuffer(cl_mem buffer, uint64_t start, uint64_t len,
   setKernelArg(kernel, 0, buffer);
   setKernelArg<cl_uint>(kernel, 1, start);
   setKernelArg(kernel, 2, value);
-  enqueueKernel("splat", devBindings->commandQueue, kernel,
+  enqueueKernel("splat", devBindings->commandQueue, kernel, buffer,
                 devBindings->deviceId, {(size_t)len}, kernelLaunches);
 }
 
@@ -322,6 +584,195 @@ static void getMaxLocalWorkgroupSize(cl_kernel kernel, cl_device_id device,
   }
 }
 
+/// \returns the max size of the work groups of \p kernel on \p device.
+static size_t getKernelWorkGroupSize(cl_kernel kernel, cl_device_id device) {
+  size_t L;
+  cl_int err = clGetKernelWorkGroupInfo(
+      kernel, device, CL_KERNEL_WORK_GROUP_SIZE, sizeof(L), &L, nullptr);
+  CHECK_EQ(err, CL_SUCCESS) << "Error in clGetKernelWorkGroupInfo.";
+  return L;
+}
+
+/// \returns the process-wide cache of the configurations found by the
+/// autotuner, loaded from -opencl-autotune-cache the first time.
+static OpenCLTuningCache &getTuningCache() {
+  static OpenCLTuningCache *cache = []() {
+    auto *cache = new OpenCLTuningCache();
+    if (!clAutotuneCache.empty()) {
+      if (auto err = cache->load(clAutotuneCache)) {
+        LOG(WARNING) << ERR_TO_STRING(std::move(err));
+      }
+    }
+    return cache;
+  }();
+  return *cache;
+}
+
+/// Sets the configuration of \p key in the tuning cache to \p values, and
+/// persists the cache to -opencl-autotune-cache.
+static void recordTuning(llvm::StringRef key, llvm::ArrayRef<size_t> values) {
+  auto &cache = getTuningCache();
+  cache.insert(key, values);
+  if (!clAutotuneCache.empty()) {
+    if (auto err = cache.save(clAutotuneCache)) {
+      LOG(WARNING) << ERR_TO_STRING(std::move(err));
+    }
+  }
+}
+
+/// \returns a copy of the device buffer \p buffer made on \p commands. The
+/// autotuner runs the kernels on the copy, so that running a kernel several
+/// times doesn't clobber the results of the real run, e.g. of an in-place
+/// kernel, while the kernels see the same data, e.g. valid indices.
+static cl_mem createTuningBuffer(cl_command_queue commands, cl_mem buffer) {
+  size_t size;
+  cl_int err =
+      clGetMemObjectInfo(buffer, CL_MEM_SIZE, sizeof(size), &size, nullptr);
+  CHECK_EQ(err, CL_SUCCESS) << "Error in clGetMemObjectInfo.";
+  cl_context ctx;
+  err = clGetMemObjectInfo(buffer, CL_MEM_CONTEXT, sizeof(ctx), &ctx, nullptr);
+  CHECK_EQ(err, CL_SUCCESS) << "Error in clGetMemObjectInfo.";
+  cl_mem copy = clCreateBuffer(ctx, CL_MEM_READ_WRITE, size, nullptr, &err);
+  CHECK_EQ(err, CL_SUCCESS) << "Allocation failed!";
+  err = clEnqueueCopyBuffer(commands, buffer, copy, 0, 0, size, 0, nullptr,
+                            nullptr);
+  CHECK_EQ(err, CL_SUCCESS) << "Error in clEnqueueCopyBuffer.";
+  return copy;
+}
+
+/// \returns the best time in microseconds of kTuningRuns runs of \p kernel
+/// with the \p global and \p local work sizes on \p commands, or the max
+/// value if the device rejects them.
+static uint64_t benchmarkKernel(cl_command_queue commands, cl_kernel kernel,
+                                llvm::ArrayRef<size_t> global,
+                                llvm::ArrayRef<size_t> local) {
+  uint64_t best = std::numeric_limits<uint64_t>::max();
+  // Wait for the kernels enqueued before, which aren't part of the timing.
+  clFinish(commands);
+  // The first run is a warm-up run.
+  for (unsigned i = 0; i <= kTuningRuns; i++) {
+    auto start = std::chrono::steady_clock::now();
+    cl_int err =
+        clEnqueueNDRangeKernel(commands, kernel, global.size(), nullptr,
+                               &global[0], &local[0], 0, nullptr, nullptr);
+    if (err != CL_SUCCESS) {
+      return std::numeric_limits<uint64_t>::max();
+    }
+    clFinish(commands);
+    auto time = std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - start)
+                    .count();
+    if (i) {
+      best = std::min<uint64_t>(best, time);
+    }
+  }
+  return best;
+}
+
+/// \returns true if \p local is a valid local work size of \p kernel on
+/// \p device with the global work size \p global.
+static bool isValidLocalWorkSize(cl_kernel kernel, cl_device_id device,
+                                 llvm::ArrayRef<size_t> global,
+                                 llvm::ArrayRef<size_t> local) {
+  if (local.size() != global.size()) {
+    return false;
+  }
+  size_t WIS[3];
+  clGetDeviceInfo(device, CL_DEVICE_MAX_WORK_ITEM_SIZES, sizeof(WIS), &WIS,
+                  nullptr);
+  size_t totalWork = 1;
+  for (size_t i = 0, e = global.size(); i < e; i++) {
+    if (!local[i] || local[i] > WIS[i] || global[i] % local[i]) {
+      return false;
+    }
+    totalWork *= local[i];
+  }
+  return totalWork <= getKernelWorkGroupSize(kernel, device);
+}
+
+/// \returns the local work sizes of \p kernel on \p device with the global
+/// work size \p global benchmarked by the autotuner: \p defaultLocal, then
+/// the largest ones whose dimensions are powers of two.
+static std::vector<std::vector<size_t>>
+getLocalWorkSizeCandidates(cl_kernel kernel, cl_device_id device,
+                           llvm::ArrayRef<size_t> global,
+                           llvm::ArrayRef<size_t> defaultLocal) {
+  size_t WIS[3];
+  clGetDeviceInfo(device, CL_DEVICE_MAX_WORK_ITEM_SIZES, sizeof(WIS), &WIS,
+                  nullptr);
+  size_t WGS;
+  clGetDeviceInfo(device, CL_DEVICE_MAX_WORK_GROUP_SIZE, sizeof(WGS), &WGS,
+                  nullptr);
+  size_t maxWork = std::min(getKernelWorkGroupSize(kernel, device), WGS);
+
+  // Extend the candidates one dimension at a time.
+  std::vector<std::pair<size_t, std::vector<size_t>>> candidates{{1, {}}};
+  for (size_t i = 0, e = global.size(); i < e; i++) {
+    std::vector<std::pair<size_t, std::vector<size_t>>> extended;
+    for (const auto &candidate : candidates) {
+      for (size_t s = 1; s <= WIS[i] && candidate.first * s <= maxWork;
+           s *= 2) {
+        if (global[i] % s == 0) {
+          extended.emplace_back(candidate.first * s, candidate.second);
+          extended.back().second.push_back(s);
+        }
+      }
+    }
+    candidates = std::move(extended);
+  }
+  std::stable_sort(candidates.begin(), candidates.end(),
+                   [](const std::pair<size_t, std::vector<size_t>> &a,
+                      const std::pair<size_t, std::vector<size_t>> &b) {
+                     return a.first > b.first;
+                   });
+
+  // The default comes first, so that it wins ties.
+  std::vector<std::vector<size_t>> result{defaultLocal.vec()};
+  for (auto &candidate : candidates) {
+    if (result.size() == kMaxLocalWorkSizeCandidates) {
+      break;
+    }
+    if (candidate.second != result[0]) {
+      result.push_back(std::move(candidate.second));
+    }
+  }
+  return result;
+}
+
+/// Sets \p local to the fastest local work size of \p kernel, whose type is
+/// \p kernelType, with the global work size \p global on \p device. It is
+/// looked up in the tuning cache, or found by benchmarking the candidates on
+/// \p commands using a copy of the device buffer \p buffer. On entry \p
+/// local is the default local work size.
+static void tuneLocalWorkSize(llvm::StringRef kernelType,
+                              cl_command_queue commands, cl_kernel kernel,
+                              cl_mem buffer, cl_device_id device,
+                              llvm::ArrayRef<size_t> global,
+                              llvm::MutableArrayRef<size_t> local) {
+  auto key =
+      OpenCLTuningCache::getKey(getDeviceName(device), kernelType, global);
+  std::vector<size_t> tuned;
+  if (!getTuningCache().lookup(key, tuned) ||
+      !isValidLocalWorkSize(kernel, device, global, tuned)) {
+    auto candidates = getLocalWorkSizeCandidates(kernel, device, global, local);
+    cl_mem copy = createTuningBuffer(commands, buffer);
+    setKernelArg(kernel, 0, copy);
+    uint64_t bestTime = std::numeric_limits<uint64_t>::max();
+    tuned = candidates[0];
+    for (const auto &candidate : candidates) {
+      auto time = benchmarkKernel(commands, kernel, global, candidate);
+      if (time < bestTime) {
+        bestTime = time;
+        tuned = candidate;
+      }
+    }
+    setKernelArg(kernel, 0, buffer);
+    clReleaseMemObject(copy);
+    recordTuning(key, tuned);
+  }
+  std::copy(tuned.begin(), tuned.end(), local.begin());
+}
+
 void OpenCLFunction::enqueueKernel(llvm::StringRef name,
                                    cl_command_queue commands, cl_kernel kernel,
                                    cl_device_id device,
@@ -345,20 +796,27 @@ void OpenCLFunction::enqueueKernel(llvm::StringRef name,
 
 /// Enqueue a \p kernel for execution on the command queue \p commands on a
 /// given \p device. The information about the launched kernel will be added to
-/// \p kernelLaunches list.
+/// \p kernelLaunches list. With -opencl-autotune, the local work size is the
+/// fastest one for the kernel and \p global on this device, benchmarked on a
+/// copy of the device buffer \p buffer the first time.
 void OpenCLFunction::enqueueKernel(llvm::StringRef name,
                                    cl_command_queue commands, cl_kernel kernel,
-                                   cl_device_id device,
+                                   cl_mem buffer, cl_device_id device,
                                    llvm::ArrayRef<size_t> global,
                                    std::vector<KernelLaunch> &kernelLaunches) {
-  llvm::SmallVector<size_t, 4> local(global.size(), 0);
-  getMaxLocalWorkgroupSize(kernel, device, global, local);
   char kernelType[128];
   size_t retSize;
   cl_int err = clGetKernelInfo(kernel, CL_KERNEL_FUNCTION_NAME,
                                sizeof(kernelType), &kernelType, &retSize);
   CHECK_EQ(err, CL_SUCCESS) << "Error in clGetKernelInfo.";
 
+  llvm::SmallVector<size_t, 4> local(global.size(), 0);
+  getMaxLocalWorkgroupSize(kernel, device, global, local);
+  if (clAutotune) {
+    tuneLocalWorkSize(kernelType, commands, kernel, buffer, device, global,
+                      local);
+  }
+
   cl_event event{nullptr};
   bool profile = kernelProfiling_;
   err = clEnqueueNDRangeKernel(commands, kernel, global.size(), nullptr,
@@ -368,6 +826,76 @@ void OpenCLFunction::enqueueKernel(llvm::StringRef name,
   kernelLaunches.push_back(KernelLaunch(kernel, name, kernelType, event));
 }
 
+namespace {
+/// Sizes of the tiles and work groups of the fast convolution kernels, see
+/// kernels_fwd_conv.cl. The vector widths VWN and VWM are always 4, which the
+/// kernels assume.
+struct ConvTileConfig {
+  /// Work group sizes along the dimensions N and M.
+  size_t wgs0;
+  size_t wgs1;
+  /// Work per thread in the dimensions N and M.
+  size_t wptn;
+  size_t wptm;
+  /// Tile size in the dimension K.
+  size_t tsk;
+
+  bool operator==(const ConvTileConfig &other) const {
+    return toVector() == other.toVector();
+  }
+
+  /// \returns the configuration as stored in the tuning cache.
+  std::vector<size_t> toVector() const { return {wgs0, wgs1, wptn, wptm, tsk}; }
+
+  /// Sets \p config to the configuration stored as \p values in the tuning
+  /// cache. \returns false if \p values is malformed.
+  static bool fromVector(llvm::ArrayRef<size_t> values,
+                         ConvTileConfig &config) {
+    if (values.size() != 5) {
+      return false;
+    }
+    config = {values[0], values[1], values[2], values[3], values[4]};
+    return true;
+  }
+
+  /// \returns true if the kernels can use the configuration on a device whose
+  /// max work item sizes are \p WIS and max work group size is \p maxWGSize.
+  /// The work items of a work group load the tiles in equal parts and whole
+  /// vectors of 4.
+  bool isValid(const size_t *WIS, size_t maxWGSize) const {
+    return wgs0 && wgs1 && wgs0 <= WIS[0] && wgs1 <= WIS[1] &&
+           wgs0 * wgs1 <= maxWGSize && wptn && wptm && tsk &&
+           wptn % 4 == 0 && wptm % 4 == 0 && (tsk * wptm) % wgs0 == 0 &&
+           (tsk * wptn) % wgs1 == 0;
+  }
+};
+} // namespace
+
+/// \returns the tile sizes of the fast convolution kernels benchmarked by the
+/// autotuner on a device whose max work item sizes are \p WIS and max work
+/// group size is \p maxWGSize: \p defaultConfig, then the valid combinations
+/// of the usual sizes.
+static std::vector<ConvTileConfig>
+getConvTileCandidates(const ConvTileConfig &defaultConfig, const size_t *WIS,
+                      size_t maxWGSize) {
+  std::vector<ConvTileConfig> candidates{defaultConfig};
+  for (size_t wgs0 : {8, 16}) {
+    for (size_t wgs1 : {8, 16}) {
+      for (size_t wptn : {4, 8}) {
+        for (size_t wptm : {4, 8}) {
+          for (size_t tsk : {4, 8}) {
+            ConvTileConfig config{wgs0, wgs1, wptn, wptm, tsk};
+            if (config.isValid(WIS, maxWGSize) && !(config == defaultConfig)) {
+              candidates.push_back(config);
+            }
+          }
+        }
+      }
+    }
+  }
+  return candidates;
+}
+
 void OpenCLFunction::executeNCHWConvolution(
     const ConvolutionInst *CC, ExecutionContext *executionContext,
     std::vector<KernelLaunch> &kernelLaunches) {
@@ -458,29 +986,12 @@ void OpenCLFunction::executeNCHWConvolution(
     }
     if (id == 1 && defaultVal * wg_size[0] > dev_max_wg_size)
       defaultVal = dev_max_wg_size / wg_size[0];
-    addIntOption(options, "workgroup_size_" + std::to_string(id), defaultVal);
     wg_size[id] = defaultVal;
   }
-  // The tile-size in dimension K.
-  // Should be tunable.
-  addStringOption(options, "TSK", "4");
-  addIntOption(options, "TSK_UNROLL", 1);
+  // The tile sizes used without autotuning.
+  ConvTileConfig config{wg_size[0], wg_size[1], /* wptn */ 4, /* wptm */ 4,
+                        /* tsk */ 4};
 
-  // WPTN and WPTM should be tunable.
-  size_t WPTN = 4;
-  size_t WPTM = 4;
-  // The work-per-thread in dimension N.
-  addIntOption(options, "WPTN", WPTN);
-  // The work-per-thread in dimension M.
-  addIntOption(options, "WPTM", WPTM);
-
-  // Vector width in dimensions M and M.
-  // VWN and VWM should be tunable.
-  addStringOption(options, "VWM", "4");
-  addStringOption(options, "VWN", "4");
-
-  // Generate a tailor-made convolution kernel using the provided options based
-  // on the parameters of the current convolution.
   std::string src;
   if (isQuantized) {
     src.append(
@@ -490,59 +1001,125 @@ void OpenCLFunction::executeNCHWConvolution(
     src.append(reinterpret_cast<const char *>(kernels_fwd_conv_cl_src),
                kernels_fwd_conv_cl_src_size);
   }
+  auto kernelName = isQuantized ? "conv_forward_mem_i8" : "conv_forward_mem";
+
+  // Generate a tailor-made convolution kernel using the provided options based
+  // on the parameters of the current convolution and the tile sizes of \p
+  // tiles, which operates on the device buffer \p buffer.
+  auto createConvKernel = [&](const ConvTileConfig &tiles, cl_mem buffer) {
+    std::vector<std::string> tileOptions = options;
+    addIntOption(tileOptions, "workgroup_size_0", tiles.wgs0);
+    addIntOption(tileOptions, "workgroup_size_1", tiles.wgs1);
+    // The tile-size in dimension K.
+    addIntOption(tileOptions, "TSK", tiles.tsk);
+    addIntOption(tileOptions, "TSK_UNROLL", 1);
+    // The work-per-thread in dimension N.
+    addIntOption(tileOptions, "WPTN", tiles.wptn);
+    // The work-per-thread in dimension M.
+    addIntOption(tileOptions, "WPTM", tiles.wptm);
+    // Vector width in dimensions M and M.
+    addStringOption(tileOptions, "VWM", "4");
+    addStringOption(tileOptions, "VWN", "4");
+
+    auto prog = createProgram(src, tileOptions, devBindings->commandQueue);
+    auto kernel = createKernel(kernelName, prog);
+    setKernelArg(kernel, 0, buffer);
+    setKernelArg<cl_uint>(kernel, 1, getValueAddress(input, *devBindings));
+    setKernelArg<cl_uint>(kernel, 2, getValueAddress(weights, *devBindings));
+    setKernelArg<cl_uint>(kernel, 3, getValueAddress(bias, *devBindings));
+    setKernelArg<cl_uint>(kernel, 4, getValueAddress(output, *devBindings));
+
+    // Extra options for quantized kernel
+    if (isQuantized) {
+      auto inputTy = CC->getSrc()->getType();
+      auto outputTy = CC->getDest()->getType();
+      auto biasTy = CC->getBias()->getType();
+      auto weightsTy = CC->getFilter()->getType();
+      setKernelArg(kernel, 5, weightsTy->getOffset());
+      setKernelArg(kernel, 6, weightsTy->getScale());
+      setKernelArg(kernel, 7, inputTy->getOffset());
+      setKernelArg(kernel, 8, inputTy->getScale());
+      setKernelArg(kernel, 9, outputTy->getOffset());
+      setKernelArg(kernel, 10, outputTy->getScale());
+      setKernelArg(kernel, 11, biasTy->getOffset());
+      setKernelArg(kernel, 12, biasTy->getScale());
+    }
+    return kernel;
+  };
+
+  // Compute proper parameters for global work and workgroups for the tile
+  // sizes of \p tiles.
+  auto getConvWorkSizes = [&](const ConvTileConfig &tiles,
+                              std::vector<size_t> &global,
+                              std::vector<size_t> &local) {
+    auto fw_wgs0 = tiles.wgs0;
+    auto fw_wgs1 = tiles.wgs1;
+    int fw_div_N = tiles.wptn * fw_wgs0;
+    int fw_div_M = tiles.wptm * fw_wgs1;
+    int N_FW_ = odim.h * odim.w;
+    int M_FW_ = odim.c / group;
+
+    // Set the size of a workgroup.
+    local = {fw_wgs0, fw_wgs1, 1};
+
+    // Set the global work size.
+    global = {((N_FW_ - 1) / fw_div_N + 1) * fw_wgs0,
+              ((M_FW_ - 1) / fw_div_M + 1) * fw_wgs1, idim.n * group};
+  };
+
+  // With autotuning, use the fastest tile sizes for this convolution on this
+  // device, benchmarked on a copy of the device buffer the first time.
+  if (clAutotune) {
+    auto key = OpenCLTuningCache::getKey(
+        getDeviceName(devBindings->deviceId), kernelName,
+        {kdim.height, kdim.width, pads.top, pads.left, sdim.height, sdim.width,
+         dilation, group, fdim.c, fdim.n, idim.n, idim.h, idim.w, odim.h,
+         odim.w});
+    std::vector<size_t> tuned;
+    ConvTileConfig cached;
+    if (getTuningCache().lookup(key, tuned) &&
+        ConvTileConfig::fromVector(tuned, cached) &&
+        cached.isValid(WIS, dev_max_wg_size)) {
+      config = cached;
+    } else {
+      TRACE_EVENT_SCOPE(executionContext->getTraceContext(),
+                        TraceLevel::RUNTIME, "convTuneTiles");
+      auto candidates = getConvTileCandidates(config, WIS, dev_max_wg_size);
+      cl_mem copy = createTuningBuffer(devBindings->commandQueue,
+                                       devBindings->deviceBuffer);
+      uint64_t bestTime = std::numeric_limits<uint64_t>::max();
+      config = candidates[0];
+      for (const auto &candidate : candidates) {
+        auto kernel = createConvKernel(candidate, copy);
+        if (getKernelWorkGroupSize(kernel, devBindings->deviceId) >=
+            candidate.wgs0 * candidate.wgs1) {
+          std::vector<size_t> global, local;
+          getConvWorkSizes(candidate, global, local);
+          auto time = benchmarkKernel(devBindings->commandQueue, kernel,
+                                      global, local);
+          if (time < bestTime) {
+            bestTime = time;
+            config = candidate;
+          }
+        }
+        clReleaseKernel(kernel);
+      }
+      clReleaseMemObject(copy);
+      recordTuning(key, config.toVector());
+    }
+  }
 
   TRACE_EVENT_SCOPE_NAMED(executionContext->getTraceContext(),
                           TraceLevel::RUNTIME, "convCreateProgram", cpEvent);
-  auto prog = createProgram(src, options, devBindings->commandQueue);
+  auto kernel = createConvKernel(config, devBindings->deviceBuffer);
   TRACE_EVENT_SCOPE_END_NAMED(cpEvent);
 
-  auto kernelName = isQuantized ? "conv_forward_mem_i8" : "conv_forward_mem";
-  auto kernel = createKernel(kernelName, prog);
-  setKernelArg(kernel, 0, devBindings->deviceBuffer);
-  setKernelArg<cl_uint>(kernel, 1, runtimeBundle_.getValueOffset(input));
-  setKernelArg<cl_uint>(kernel, 2, runtimeBundle_.getValueOffset(weights));
-  setKernelArg<cl_uint>(kernel, 3, runtimeBundle_.getValueOffset(bias));
-  setKernelArg<cl_uint>(kernel, 4, runtimeBundle_.getValueOffset(output));
-
-  // Extra options for quantized kernel
-  if (isQuantized) {
-    auto inputTy = CC->getSrc()->getType();
-    auto outputTy = CC->getDest()->getType();
-    auto biasTy = CC->getBias()->getType();
-    auto weightsTy = CC->getFilter()->getType();
-    setKernelArg(kernel, 5, weightsTy->getOffset());
-    setKernelArg(kernel, 6, weightsTy->getScale());
-    setKernelArg(kernel, 7, inputTy->getOffset());
-    setKernelArg(kernel, 8, inputTy->getScale());
-    setKernelArg(kernel, 9, outputTy->getOffset());
-    setKernelArg(kernel, 10, outputTy->getScale());
-    setKernelArg(kernel, 11, biasTy->getOffset());
-    setKernelArg(kernel, 12, biasTy->getScale());
-  }
-
-  // Compute proper parameters for global work and workgroups.
-  auto fw_wgs0 = wg_size[0];
-  auto fw_wgs1 = wg_size[1];
-  int fw_wptn = WPTN;
-  int fw_wptm = WPTM;
-  int fw_div_N = fw_wptn * fw_wgs0;
-  int fw_div_M = fw_wptm * fw_wgs1;
-  int N_FW_ = odim.h * odim.w;
-  int M_FW_ = odim.c / group;
-  size_t max_kern_wg_size;
-  clGetKernelWorkGroupInfo(kernel, devBindings->deviceId,
-                           CL_KERNEL_WORK_GROUP_SIZE, sizeof(max_kern_wg_size),
-                           &max_kern_wg_size, nullptr);
-  CHECK_LE(fw_wgs0 * fw_wgs1, max_kern_wg_size) << "Bad workgroup size";
-
-  // Set the size of a workgroup.
-  std::vector<size_t> local = {fw_wgs0, fw_wgs1, 1};
-
-  // Set the global work size.
-  std::vector<size_t> global = {((N_FW_ - 1) / fw_div_N + 1) * fw_wgs0,
-                                ((M_FW_ - 1) / fw_div_M + 1) * fw_wgs1,
-                                idim.n * group};
+  size_t max_kern_wg_size =
+      getKernelWorkGroupSize(kernel, devBindings->deviceId);
+  CHECK_LE(config.wgs0 * config.wgs1, max_kern_wg_size) << "Bad workgroup size";
 
+  std::vector<size_t> global, local;
+  getConvWorkSizes(config, global, local);
   enqueueKernel(CC->getName(), devBindings->commandQueue, kernel,
                 devBindings->deviceId, global, local, kernelLaunches);
 }
@@ -598,9 +1175,33 @@ Error OpenCLFunction::execute(ExecutionContext *context) {
                      kernelLaunches);
   }
 
+  // With streamed constants, the constants of every group of instructions
+  // are copied while the kernels of the previous group run. The kernels of
+  // a group wait for its copies, and its copies for the kernels of the last
+  // group that used its half of the streaming region.
+  size_t numGroups =
+      clBindings->streamingRegionSize ? streamingGroups_.size() : 0;
+  std::vector<cl_event> copied(numGroups, nullptr);
+  std::vector<cl_event> computed(numGroups, nullptr);
+  size_t nextGroup = 0;
+  if (numGroups) {
+    enqueueStreamingCopies(0, clBindings, copied, computed);
+  }
+
   TRACE_EVENT_SCOPE_NAMED(context, TraceLevel::RUNTIME, "enqueueKernels",
                           enqueueEvent);
   for (const auto &I : F_->getInstrs()) {
+    if (nextGroup < numGroups && &I == streamingGroups_[nextGroup].first) {
+      size_t group = nextGroup++;
+      if (group > 0) {
+        clEnqueueMarkerWithWaitList(commands, 0, nullptr, &computed[group - 1]);
+      }
+      if (group + 1 < numGroups) {
+        enqueueStreamingCopies(group + 1, clBindings, copied, computed);
+      }
+      clEnqueueBarrierWithWaitList(commands, 1, &copied[group], nullptr);
+      clBindings->streamedAddresses = &streamingGroups_[group].addresses;
+    }
     // Skip memory allocation instructions as they are NOPs.
     if (isa<AllocActivationInst>(I) || isa<DeallocActivationInst>(I) ||
         isa<TensorViewInst>(I)) {
@@ -657,7 +1258,8 @@ Error OpenCLFunction::execute(ExecutionContext *context) {
 
       cl_kernel kernel = createKernel(kernelName, program);
       setKernelArg(kernel, 0, deviceBuffer);
-      auto numArgs = setKernelArgsForBuffers(kernel, I, 1, runtimeBundle_);
+      auto numArgs =
+          setKernelArgsForBuffers(kernel, I, 1, runtimeBundle_, *clBindings);
       auto numMandatoryArgs = numArgs;
       (void)numMandatoryArgs;
 
@@ -741,8 +1343,8 @@ Error OpenCLFunction::execute(ExecutionContext *context) {
       if (isQuantized) {
         DCHECK_GT(numArgs, numMandatoryArgs) << "Not enough kernel arguments";
       }
-      enqueueKernel(I.getName(), commands, kernel, deviceId, {global},
-                    kernelLaunches);
+      enqueueKernel(I.getName(), commands, kernel, deviceBuffer, deviceId,
+                    {global}, kernelLaunches);
       continue;
     }
 
@@ -751,7 +1353,8 @@ Error OpenCLFunction::execute(ExecutionContext *context) {
       // the batch is processed by a different parallel 'thread'.
       cl_kernel kernel = createKernel(kernelName, program);
       setKernelArg(kernel, 0, deviceBuffer);
-      auto numArgs = setKernelArgsForBuffers(kernel, I, 1, runtimeBundle_);
+      auto numArgs =
+          setKernelArgsForBuffers(kernel, I, 1, runtimeBundle_, *clBindings);
 
       // This is the number of elements for each slice. There are N slices in
       // our batch.
@@ -761,8 +1364,8 @@ Error OpenCLFunction::execute(ExecutionContext *context) {
       // Pass the slice size (size of each sample in the batch) as a parameter.
       setKernelArg<cl_uint>(kernel, numArgs + 1, flattenCdr(inputDims).second);
 
-      enqueueKernel(I.getName(), commands, kernel, deviceId, {numSlices},
-                    kernelLaunches);
+      enqueueKernel(I.getName(), commands, kernel, deviceBuffer, deviceId,
+                    {numSlices}, kernelLaunches);
       continue;
     }
 
@@ -771,7 +1374,8 @@ Error OpenCLFunction::execute(ExecutionContext *context) {
       // the batch is processed by a different parallel 'thread'.
       cl_kernel kernel = createKernel(kernelName, program);
       setKernelArg(kernel, 0, deviceBuffer);
-      auto numArgs = setKernelArgsForBuffers(kernel, I, 1, runtimeBundle_);
+      auto numArgs =
+          setKernelArgsForBuffers(kernel, I, 1, runtimeBundle_, *clBindings);
 
       // This is the number of elements for each slice. There are N slices in
       // our batch.
@@ -781,15 +1385,16 @@ Error OpenCLFunction::execute(ExecutionContext *context) {
       // Pass the slice size (size of each sample in the batch) as a parameter.
       setKernelArg<cl_uint>(kernel, numArgs + 1, flattenCdr(inputDims).second);
 
-      enqueueKernel(I.getName(), commands, kernel, deviceId, {numSlices},
-                    kernelLaunches);
+      enqueueKernel(I.getName(), commands, kernel, deviceBuffer, deviceId,
+                    {numSlices}, kernelLaunches);
       continue;
     }
 
     if (auto *ET = dyn_cast<ExtractTensorInst>(&I)) {
       cl_kernel kernel = createKernel(kernelName, program);
       setKernelArg(kernel, 0, deviceBuffer);
-      auto numArgs = setKernelArgsForBuffers(kernel, I, 1, runtimeBundle_);
+      auto numArgs =
+          setKernelArgsForBuffers(kernel, I, 1, runtimeBundle_, *clBindings);
 
       // Currently support tensors up to 4 dimensions.
       // TODO: Handle other dimensions.
@@ -821,15 +1426,16 @@ Error OpenCLFunction::execute(ExecutionContext *context) {
       setKernelArg(kernel, numArgs + 1, odim);
       setKernelArg(kernel, numArgs + 2, idim);
       setKernelArg(kernel, numArgs + 3, offset);
-      enqueueKernel(I.getName(), commands, kernel, deviceId, {odim.n, odim.h},
-                    kernelLaunches);
+      enqueueKernel(I.getName(), commands, kernel, deviceBuffer, deviceId,
+                    {odim.n, odim.h}, kernelLaunches);
       continue;
     }
 
     if (auto *IT = dyn_cast<InsertTensorInst>(&I)) {
       cl_kernel kernel = createKernel(kernelName, program);
       setKernelArg(kernel, 0, deviceBuffer);
-      auto numArgs = setKernelArgsForBuffers(kernel, I, 1, runtimeBundle_);
+      auto numArgs =
+          setKernelArgsForBuffers(kernel, I, 1, runtimeBundle_, *clBindings);
 
       // Currently support tensors of up to 4 dimensions.
       // TODO: Handle other dimensions.
@@ -862,8 +1468,8 @@ Error OpenCLFunction::execute(ExecutionContext *context) {
       setKernelArg(kernel, numArgs + 3, offset);
       setKernelArg<cl_uint>(kernel, numArgs + 4, IT->getCount());
       setKernelArg<cl_uint>(kernel, numArgs + 5, IT->getAxis());
-      enqueueKernel(I.getName(), commands, kernel, deviceId, {idim.n, idim.h},
-                    kernelLaunches);
+      enqueueKernel(I.getName(), commands, kernel, deviceBuffer, deviceId,
+                    {idim.n, idim.h}, kernelLaunches);
       continue;
     }
 
@@ -883,7 +1489,8 @@ Error OpenCLFunction::execute(ExecutionContext *context) {
       cl_kernel kernel =
           createKernel(useTiledMatMul ? tiledKernelName : kernelName, program);
       setKernelArg(kernel, 0, deviceBuffer);
-      auto numArgs = setKernelArgsForBuffers(kernel, I, 1, runtimeBundle_);
+      auto numArgs =
+          setKernelArgsForBuffers(kernel, I, 1, runtimeBundle_, *clBindings);
 
       auto ddim = ShapeNHWC::fromXY(BMM->getDest()->getType()->dims());
       auto ldim = ShapeNHWC::fromXY(BMM->getLHS()->getType()->dims());
@@ -912,7 +1519,7 @@ Error OpenCLFunction::execute(ExecutionContext *context) {
         enqueueKernel(I.getName(), commands, kernel, deviceId, global, local,
                       kernelLaunches);
       } else {
-        enqueueKernel(I.getName(), commands, kernel, deviceId,
+        enqueueKernel(I.getName(), commands, kernel, deviceBuffer, deviceId,
                       {ddim.n, ddim.h, ddim.w}, kernelLaunches);
       }
 #undef TILE_DIM
@@ -926,7 +1533,8 @@ Error OpenCLFunction::execute(ExecutionContext *context) {
       }
       cl_kernel kernel = createKernel(kernelName, program);
       setKernelArg(kernel, 0, deviceBuffer);
-      auto numArgs = setKernelArgsForBuffers(kernel, I, 1, runtimeBundle_);
+      auto numArgs =
+          setKernelArgsForBuffers(kernel, I, 1, runtimeBundle_, *clBindings);
 
       auto bdim = flattenCdr(BA->getBatch()->dims());
       setKernelArg<cl_uint>(kernel, numArgs + 1, bdim.first);
@@ -950,8 +1558,8 @@ Error OpenCLFunction::execute(ExecutionContext *context) {
       }
 
       // Parallelize on each element in the slice.
-      enqueueKernel(I.getName(), commands, kernel, deviceId, {bdim.second},
-                    kernelLaunches);
+      enqueueKernel(I.getName(), commands, kernel, deviceBuffer, deviceId,
+                    {bdim.second}, kernelLaunches);
       continue;
     }
 
@@ -980,14 +1588,15 @@ Error OpenCLFunction::execute(ExecutionContext *context) {
       // Create kernel and set arguments.
       cl_kernel kernel = createKernel(kernelName, program);
       setKernelArg(kernel, 0, deviceBuffer);
-      auto numArgs = setKernelArgsForBuffers(kernel, I, 1, runtimeBundle_);
+      auto numArgs =
+          setKernelArgsForBuffers(kernel, I, 1, runtimeBundle_, *clBindings);
 
       setKernelArg<cl_uint>(kernel, numArgs + 1, batchDims[axis]);
       setKernelArg<cl_uint>(kernel, numArgs + 2, axisSrcSliceSize);
 
       // Parallelize on each element in the slice.
-      enqueueKernel(I.getName(), commands, kernel, deviceId, destDimsVec,
-                    kernelLaunches);
+      enqueueKernel(I.getName(), commands, kernel, deviceBuffer, deviceId,
+                    destDimsVec, kernelLaunches);
       continue;
     }
 
@@ -1001,7 +1610,8 @@ Error OpenCLFunction::execute(ExecutionContext *context) {
       // the X and the Y in the output filter.
       cl_kernel kernel = createKernel(kernelName, program);
       setKernelArg(kernel, 0, deviceBuffer);
-      auto numArgs = setKernelArgsForBuffers(kernel, I, 1, runtimeBundle_);
+      auto numArgs =
+          setKernelArgsForBuffers(kernel, I, 1, runtimeBundle_, *clBindings);
       auto odim = ShapeNHWC(CC->getDest()->getType()->dims());
       auto idim = ShapeNHWC(CC->getSrc()->getType()->dims());
       auto pads = PaddingTLBR(CC->getPads());
@@ -1033,7 +1643,7 @@ Error OpenCLFunction::execute(ExecutionContext *context) {
 
       // Use a 3D grid where the first dimension is the depth and the second
       // dimension is the slice index in the batch.
-      enqueueKernel(I.getName(), commands, kernel, deviceId,
+      enqueueKernel(I.getName(), commands, kernel, deviceBuffer, deviceId,
                     {odim.h, odim.w, odim.c}, kernelLaunches);
       continue;
     }
@@ -1046,7 +1656,8 @@ Error OpenCLFunction::execute(ExecutionContext *context) {
       auto *biasGrad = CG->getBiasGrad();
       cl_kernel kernel = createKernel(kernelName, program);
       setKernelArg(kernel, 0, deviceBuffer);
-      auto numArgs = setKernelArgsForBuffers(kernel, I, 1, runtimeBundle_);
+      auto numArgs =
+          setKernelArgsForBuffers(kernel, I, 1, runtimeBundle_, *clBindings);
 
       auto destGradDim = ShapeNHWC(destGrad->dims());
       auto srcDim = ShapeNHWC(src->dims());
@@ -1063,17 +1674,17 @@ Error OpenCLFunction::execute(ExecutionContext *context) {
       setKernelArg(kernel, numArgs + 7, destGradDim);
       setKernelArg(kernel, numArgs + 8, filterGradDim);
       // Zero memory for the output buffers.
-      fillBuffer(deviceBuffer, runtimeBundle_.getValueOffset(srcGrad),
+      fillBuffer(deviceBuffer, getValueAddress(srcGrad, *clBindings),
                  srcGrad->size(), 0, srcGrad->getElementType(), clBindings,
                  kernelLaunches);
-      fillBuffer(deviceBuffer, runtimeBundle_.getValueOffset(filterGrad),
+      fillBuffer(deviceBuffer, getValueAddress(filterGrad, *clBindings),
                  filterGrad->size(), 0, filterGrad->getElementType(),
                  clBindings, kernelLaunches);
-      fillBuffer(deviceBuffer, runtimeBundle_.getValueOffset(biasGrad),
+      fillBuffer(deviceBuffer, getValueAddress(biasGrad, *clBindings),
                  biasGrad->size(), 0, biasGrad->getElementType(), clBindings,
                  kernelLaunches);
 
-      enqueueKernel(I.getName(), commands, kernel, deviceId,
+      enqueueKernel(I.getName(), commands, kernel, deviceBuffer, deviceId,
                     {destGradDim.h, destGradDim.w, destGradDim.c},
                     kernelLaunches);
       continue;
@@ -1088,7 +1699,8 @@ Error OpenCLFunction::execute(ExecutionContext *context) {
 
       cl_kernel kernel = createKernel(kernelName, program);
       setKernelArg(kernel, 0, deviceBuffer);
-      auto numArgs = setKernelArgsForBuffers(kernel, I, 1, runtimeBundle_);
+      auto numArgs =
+          setKernelArgsForBuffers(kernel, I, 1, runtimeBundle_, *clBindings);
 
       ShapeHW kdim(PM->getKernels());
       ShapeHW sdim(PM->getStrides());
@@ -1113,8 +1725,8 @@ Error OpenCLFunction::execute(ExecutionContext *context) {
         global = {{odim.h, odim.w, odim.c}};
       }
 
-      enqueueKernel(I.getName(), commands, kernel, deviceId, global,
-                    kernelLaunches);
+      enqueueKernel(I.getName(), commands, kernel, deviceBuffer, deviceId,
+                    global, kernelLaunches);
       continue;
     }
 
@@ -1123,7 +1735,8 @@ Error OpenCLFunction::execute(ExecutionContext *context) {
       // the X and the Y in the output filter.
       cl_kernel kernel = createKernel(kernelName, program);
       setKernelArg(kernel, 0, deviceBuffer);
-      auto numArgs = setKernelArgsForBuffers(kernel, I, 1, runtimeBundle_);
+      auto numArgs =
+          setKernelArgsForBuffers(kernel, I, 1, runtimeBundle_, *clBindings);
 
       auto odim = ShapeNHWC(PM->getDest()->getType()->dims());
       auto idim = ShapeNHWC(PM->getSrc()->getType()->dims());
@@ -1136,7 +1749,7 @@ Error OpenCLFunction::execute(ExecutionContext *context) {
       setKernelArg(kernel, numArgs + 4, odim);
       setKernelArg(kernel, numArgs + 5, idim);
 
-      enqueueKernel(I.getName(), commands, kernel, deviceId,
+      enqueueKernel(I.getName(), commands, kernel, deviceBuffer, deviceId,
                     {odim.h, odim.w, odim.c}, kernelLaunches);
       continue;
     }
@@ -1144,7 +1757,8 @@ Error OpenCLFunction::execute(ExecutionContext *context) {
     if (auto *PMG = dyn_cast<MaxPoolWithArgmaxGradInst>(&I)) {
       cl_kernel kernel = createKernel(kernelName, program);
       setKernelArg(kernel, 0, deviceBuffer);
-      auto numArgs = setKernelArgsForBuffers(kernel, I, 1, runtimeBundle_);
+      auto numArgs =
+          setKernelArgsForBuffers(kernel, I, 1, runtimeBundle_, *clBindings);
 
       auto destGradDim = ShapeNHWC(PMG->getDestGrad()->dims());
       auto srcGradDim = ShapeNHWC(PMG->getSrcGrad()->dims());
@@ -1157,8 +1771,8 @@ Error OpenCLFunction::execute(ExecutionContext *context) {
       setKernelArg(kernel, numArgs + 4, srcGradDim);
       setKernelArg(kernel, numArgs + 5, destGradDim);
 
-      enqueueKernel(I.getName(), commands, kernel, deviceId, {srcGradDim.n},
-                    kernelLaunches);
+      enqueueKernel(I.getName(), commands, kernel, deviceBuffer, deviceId,
+                    {srcGradDim.n}, kernelLaunches);
       continue;
     }
 
@@ -1171,7 +1785,8 @@ Error OpenCLFunction::execute(ExecutionContext *context) {
 
       cl_kernel kernel = createKernel(kernelName, program);
       setKernelArg(kernel, 0, deviceBuffer);
-      auto numArgs = setKernelArgsForBuffers(kernel, I, 1, runtimeBundle_);
+      auto numArgs =
+          setKernelArgsForBuffers(kernel, I, 1, runtimeBundle_, *clBindings);
 
       ShapeHW kdim(PA->getKernels());
       ShapeHW sdim(PA->getStrides());
@@ -1207,8 +1822,8 @@ Error OpenCLFunction::execute(ExecutionContext *context) {
         setKernelArg(kernel, numArgs + 7, destScaleParam);
       }
 
-      enqueueKernel(I.getName(), commands, kernel, deviceId, global,
-                    kernelLaunches);
+      enqueueKernel(I.getName(), commands, kernel, deviceBuffer, deviceId,
+                    global, kernelLaunches);
       continue;
     }
 
@@ -1220,7 +1835,8 @@ Error OpenCLFunction::execute(ExecutionContext *context) {
 
       cl_kernel kernel = createKernel(kernelName, program);
       setKernelArg(kernel, 0, deviceBuffer);
-      auto numArgs = setKernelArgsForBuffers(kernel, I, 1, runtimeBundle_);
+      auto numArgs =
+          setKernelArgsForBuffers(kernel, I, 1, runtimeBundle_, *clBindings);
 
       // Temporary hack to support 3-dim transposes.
       // TODO: support any dimensional transposes.
@@ -1242,8 +1858,8 @@ Error OpenCLFunction::execute(ExecutionContext *context) {
 
       ShapeNHWC shuff(mask[0], mask[1], mask[2], mask[3]);
       setKernelArg(kernel, numArgs + 3, shuff);
-      enqueueKernel(I.getName(), commands, kernel, deviceId, {idim.n, idim.h},
-                    kernelLaunches);
+      enqueueKernel(I.getName(), commands, kernel, deviceBuffer, deviceId,
+                    {idim.n, idim.h}, kernelLaunches);
       continue;
     }
 
@@ -1254,8 +1870,8 @@ Error OpenCLFunction::execute(ExecutionContext *context) {
       if (src == dest) {
         continue;
       }
-      size_t destOff = runtimeBundle_.getValueOffset(dest);
-      size_t srcOff = runtimeBundle_.getValueOffset(src);
+      size_t destOff = getValueAddress(dest, *clBindings);
+      size_t srcOff = getValueAddress(src, *clBindings);
       size_t sizeInBytes = dest->getSizeInBytes();
       cl_event event{nullptr};
       cl_int err = clEnqueueCopyBuffer(commands, deviceBuffer, deviceBuffer,
@@ -1271,7 +1887,8 @@ Error OpenCLFunction::execute(ExecutionContext *context) {
     if (auto *GI = dyn_cast<GatherInst>(&I)) {
       cl_kernel kernel = createKernel(kernelName, program);
       setKernelArg(kernel, 0, deviceBuffer);
-      auto numArgs = setKernelArgsForBuffers(kernel, I, 1, runtimeBundle_);
+      auto numArgs =
+          setKernelArgsForBuffers(kernel, I, 1, runtimeBundle_, *clBindings);
       unsigned_t batchDims = GI->getBatchDims();
 
       auto *data = GI->getData();
@@ -1296,23 +1913,24 @@ Error OpenCLFunction::execute(ExecutionContext *context) {
       setKernelArg<cl_uint>(kernel, numArgs + 4, destSampleSize);
       setKernelArg<cl_uint>(kernel, numArgs + 5, srcSampleSize);
 
-      enqueueKernel(I.getName(), commands, kernel, deviceId, {numIndices},
-                    kernelLaunches);
+      enqueueKernel(I.getName(), commands, kernel, deviceBuffer, deviceId,
+                    {numIndices}, kernelLaunches);
       continue;
     }
 
     if (auto *SDI = dyn_cast<ScatterDataInst>(&I)) {
       cl_kernel kernel = createKernel(kernelName, program);
       setKernelArg(kernel, 0, deviceBuffer);
-      auto numArgs = setKernelArgsForBuffers(kernel, I, 1, runtimeBundle_);
+      auto numArgs =
+          setKernelArgsForBuffers(kernel, I, 1, runtimeBundle_, *clBindings);
 
       auto *data = SDI->getData();
       size_t dataSliceSize = data->size() / data->dims()[0];
       size_t numIndices = SDI->getIndices()->size();
       setKernelArg<cl_uint>(kernel, numArgs + 1, dataSliceSize);
 
-      enqueueKernel(I.getName(), commands, kernel, deviceId, {numIndices},
-                    kernelLaunches);
+      enqueueKernel(I.getName(), commands, kernel, deviceBuffer, deviceId,
+                    {numIndices}, kernelLaunches);
       continue;
     }
 
@@ -1322,7 +1940,8 @@ Error OpenCLFunction::execute(ExecutionContext *context) {
       setKernelArg(kernel, 0, deviceBuffer);
       // Set all buffer arguments from the instruction (data, dest, weights,
       // indices, lengths) as subsequent arguments.
-      auto numArgs = setKernelArgsForBuffers(kernel, I, 1, runtimeBundle_);
+      auto numArgs =
+          setKernelArgsForBuffers(kernel, I, 1, runtimeBundle_, *clBindings);
 
       // Set the size of one slice of data as the last argument.
       auto *data = SLWS->getData();
@@ -1332,9 +1951,8 @@ Error OpenCLFunction::execute(ExecutionContext *context) {
       // Zero the destination buffer so that the kernel can accumulate (+=) into
       // it.
       auto *dest = SLWS->getDest();
-      fillBuffer(deviceBuffer, runtimeBundle_.getValueOffset(dest),
-                 dest->size(), 0, dest->getElementType(), clBindings,
-                 kernelLaunches);
+      fillBuffer(deviceBuffer, getValueAddress(dest, *clBindings), dest->size(),
+                 0, dest->getElementType(), clBindings, kernelLaunches);
 
       // Get the number of segments. The output for each segment will be
       // computed in parallel by setting the global size equal to the number of
@@ -1342,8 +1960,8 @@ Error OpenCLFunction::execute(ExecutionContext *context) {
       size_t segments = SLWS->getLengths()->size();
 
       // Enqueue the kernel.
-      enqueueKernel(I.getName(), commands, kernel, deviceId, {segments},
-                    kernelLaunches);
+      enqueueKernel(I.getName(), commands, kernel, deviceBuffer, deviceId,
+                    {segments}, kernelLaunches);
       continue;
     }
 
@@ -1353,7 +1971,8 @@ Error OpenCLFunction::execute(ExecutionContext *context) {
       setKernelArg(kernel, 0, deviceBuffer);
       // Set all buffer arguments from the instruction (dataGrad, destGrad,
       // weights, indices, lengths) as subsequent arguments.
-      auto numArgs = setKernelArgsForBuffers(kernel, I, 1, runtimeBundle_);
+      auto numArgs =
+          setKernelArgsForBuffers(kernel, I, 1, runtimeBundle_, *clBindings);
 
       // Set the number of segments as the second last argument.
       auto *lengths = SLWSG->getLengths();
@@ -1368,7 +1987,7 @@ Error OpenCLFunction::execute(ExecutionContext *context) {
       // Zero the data gradient buffer so that the kernel can accumulate (+=)
       // into it.
       auto *dataGrad = SLWSG->getDataGrad();
-      fillBuffer(deviceBuffer, runtimeBundle_.getValueOffset(dataGrad),
+      fillBuffer(deviceBuffer, getValueAddress(dataGrad, *clBindings),
                  dataGrad->size(), 0, dataGrad->getElementType(), clBindings,
                  kernelLaunches);
 
@@ -1376,7 +1995,7 @@ Error OpenCLFunction::execute(ExecutionContext *context) {
       // processed sequentially to avoid two kernel instances accumulating into
       // the same data gradient slice. This could potentially be relaxed by
       // using an atomic add in the kernel.
-      enqueueKernel(I.getName(), commands, kernel, deviceId, {1},
+      enqueueKernel(I.getName(), commands, kernel, deviceBuffer, deviceId, {1},
                     kernelLaunches);
       continue;
     }
@@ -1453,14 +2072,24 @@ Error OpenCLFunction::execute(ExecutionContext *context) {
 
   enqueueEvent.end();
 
-  clFinish(commands);
-
+  // The copies of the outputs are enqueued behind the kernels, and waited for
+  // by updatePlaceholders.
   {
     TRACE_EVENT_SCOPE(context, TraceLevel::RUNTIME, "updatePlaceholders");
     updatePlaceholders(context->getPlaceholderBindings(), clBindings,
                        kernelLaunches);
   }
 
+  // The kernels are done, and so are the copies they waited for.
+  for (size_t i = 0; i < numGroups; i++) {
+    for (cl_event event : {copied[i], computed[i]}) {
+      if (event) {
+        clReleaseEvent(event);
+      }
+    }
+  }
+  clBindings->streamedAddresses = nullptr;
+
   {
     TRACE_EVENT_SCOPE(context, TraceLevel::RUNTIME, "processInstrumentation");
     // Output profiling information.
@@ -1482,11 +2111,10 @@ uint64_t OpenCLFunction::copyValueToDevice(
     const Value *v, runtime::OpenCLDeviceBindings *devBindings,
     std::vector<KernelLaunch> &kernelLaunches, void *buf) {
   uint64_t copiedBytes = 0;
-  auto symbolInfo = runtimeBundle_.getSymbolInfo(v);
   size_t sizeInBytes = v->getType()->getSizeInBytes();
   // Issue a non-blocking command to copy the buffer to the device.
   if (sizeInBytes) {
-    size_t valueOffset = symbolInfo.offset;
+    size_t valueOffset = getValueAddress(v, *devBindings);
     cl_event event{nullptr};
     cl_int err = clEnqueueWriteBuffer(
         devBindings->commandQueue, devBindings->deviceBuffer,
@@ -1508,11 +2136,10 @@ uint64_t OpenCLFunction::copyValueFromDevice(
     const Value *v, runtime::OpenCLDeviceBindings *devBindings,
     std::vector<KernelLaunch> &kernelLaunches, void *buf) {
   uint64_t copiedBytes = 0;
-  auto symbolInfo = runtimeBundle_.getSymbolInfo(v);
   size_t sizeInBytes = v->getType()->getSizeInBytes();
   // Issue a non-blocking command to copy the buffer from the device.
   if (sizeInBytes) {
-    size_t valueOffset = symbolInfo.offset;
+    size_t valueOffset = getValueAddress(v, *devBindings);
     cl_event event{nullptr};
     cl_int err = clEnqueueReadBuffer(
         devBindings->commandQueue, devBindings->deviceBuffer,
@@ -1535,8 +2162,11 @@ uint64_t OpenCLFunction::copyValueFromDevice(
 void OpenCLFunction::loadPlaceholders(
     PlaceholderBindings *bindings, runtime::OpenCLDeviceBindings *devBindings,
     std::vector<KernelLaunch> &kernelLaunches) {
+  // The constants resident on the device were uploaded when the network was
+  // added.
   size_t sizeInBytes = runtimeBundle_.getConstantWeightSize();
-  if (runtimeBundle_.getConstants()) {
+  if (runtimeBundle_.getConstants() && !devBindings->residentConstants &&
+      !devBindings->streamingRegionSize) {
     // Issue a non-blocking command to copy the buffer to the device.
     auto buf = runtimeBundle_.getConstants();
     size_t valueOffset = 0;
@@ -1552,8 +2182,6 @@ void OpenCLFunction::loadPlaceholders(
       kernelLaunches.emplace_back(KernelLaunch("copyConstantsToDevice",
                                                "copyConstantsToDevice", event));
     }
-    // Do it!
-    clFinish(devBindings->commandQueue);
   }
 
   auto &symbolTable = runtimeBundle_.getSymbolTable();
@@ -1565,13 +2193,20 @@ void OpenCLFunction::loadPlaceholders(
     auto symbolInfo = it->second;
     auto addr = symbolInfo.offset;
     auto numBytes = PH.second->getUnpaddedSizeInBytes();
-    // Issue a non-blocking command to copy the buffer to the device.
-    auto buf = PH.second->getUnsafePtr();
+    // Issue a non-blocking command to copy the buffer to the device, through
+    // the pinned staging buffer if there is one.
+    void *buf = PH.second->getUnsafePtr();
+    if (auto *staging = getStagingAddress(devBindings, addr, numBytes, buf)) {
+      memcpy(staging, buf, numBytes);
+      buf = staging;
+    }
     cl_event event{nullptr};
 
     cl_int err = clEnqueueWriteBuffer(
         devBindings->commandQueue, devBindings->deviceBuffer,
-        /* blocking_write */ CL_FALSE, addr, numBytes, buf,
+        /* blocking_write */ CL_FALSE,
+        getRunAddress(runtimeBundle_, *devBindings, addr), numBytes,
+        buf,
         /* num_events_in_wait_list */ 0,
         /* event_list */ nullptr,
         /* event */ kernelProfiling_ ? &event : nullptr);
@@ -1581,8 +2216,9 @@ void OpenCLFunction::loadPlaceholders(
           KernelLaunch("copyInputsToDevice", "copyInputsToDevice", event));
     }
   }
-  // Do it!
-  clFinish(devBindings->commandQueue);
+  // The command queue is in order, so the kernels enqueued next run after
+  // the copies without waiting for them on the host. The host buffers are
+  // kept alive until the end of the run.
 }
 
 void OpenCLFunction::updatePlaceholders(
@@ -1597,13 +2233,19 @@ void OpenCLFunction::updatePlaceholders(
     auto symbolInfo = it->second;
     auto addr = symbolInfo.offset;
     auto numBytes = PH.second->getUnpaddedSizeInBytes();
-    // Issue a non-blocking command to copy the buffer to the device.
-    auto buf = PH.second->getUnsafePtr();
+    // Issue a non-blocking command to copy the buffer from the device,
+    // through the pinned staging buffer if there is one.
+    void *buf = PH.second->getUnsafePtr();
+    if (auto *staging = getStagingAddress(devBindings, addr, numBytes, buf)) {
+      buf = staging;
+    }
     cl_event event{nullptr};
 
     cl_int err = clEnqueueReadBuffer(
         devBindings->commandQueue, devBindings->deviceBuffer,
-        /* blocking_read */ CL_FALSE, addr, numBytes, buf,
+        /* blocking_read */ CL_FALSE,
+        getRunAddress(runtimeBundle_, *devBindings, addr), numBytes,
+        buf,
         /* num_events_in_wait_list */ 0,
         /* event_list */ nullptr,
         /* event */ kernelProfiling_ ? &event : nullptr);
@@ -1615,6 +2257,45 @@ void OpenCLFunction::updatePlaceholders(
   }
   // Do it!
   clFinish(devBindings->commandQueue);
+
+  // Copy the staged outputs into the bindings.
+  if (!devBindings->stagingBuffer) {
+    return;
+  }
+  for (auto PH : bindings->pairs()) {
+    auto it = symbolTable.find(PH.first->getName());
+    if (it == symbolTable.end()) {
+      continue;
+    }
+    auto addr = it->second.offset;
+    auto numBytes = PH.second->getUnpaddedSizeInBytes();
+    if (auto *staging = getStagingAddress(devBindings, addr, numBytes,
+                                          PH.second->getUnsafePtr())) {
+      memcpy(PH.second->getUnsafePtr(), staging, numBytes);
+    }
+  }
+}
+
+uint64_t OpenCLFunction::getValueAddress(
+    const Value *v, const runtime::OpenCLDeviceBindings &devBindings) const {
+  return getRunAddress(runtimeBundle_, devBindings,
+                       runtimeBundle_.getValueOffset(v));
+}
+
+uint8_t *
+OpenCLFunction::getStagingAddress(runtime::OpenCLDeviceBindings *devBindings,
+                                  uint64_t addr, uint64_t numBytes,
+                                  const void *hostPtr) {
+  uint64_t base = runtimeBundle_.getConstantWeightSize();
+  if (!devBindings->stagingBuffer || addr < base ||
+      addr - base + numBytes > devBindings->stagingSize) {
+    return nullptr;
+  }
+  if (devBindings->hostMemory &&
+      devBindings->hostMemory->contains(hostPtr, numBytes)) {
+    return nullptr;
+  }
+  return devBindings->stagingBuffer + (addr - base);
 }
 
 cl_mem OpenCLFunction::allocDeviceBuffer(uint64_t size, cl_context clContext) {
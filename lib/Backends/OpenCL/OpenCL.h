@@ -29,6 +29,8 @@
 
 #include "llvm/ADT/ArrayRef.h"
 
+#include <atomic>
+#include <map>
 #include <unordered_map>
 
 #if defined(__APPLE__) || defined(__MACOSX)
@@ -94,6 +96,46 @@ class OpenCLFunction final : public CompiledFunction {
   /// would result in different programs.
   std::unordered_map<ProgramKey, cl_program, ProgramKeyHash> programsCache_;
 
+  /// A group of consecutive instructions whose constants are copied
+  /// together to the device when the constants are streamed, see
+  /// OpenCLDeviceBindings::streamingRegionSize.
+  struct StreamingGroup {
+    /// The first instruction of the group.
+    const Instruction *first;
+    /// The offsets in the runtime bundle and the sizes of the constants the
+    /// instructions of the group access.
+    std::vector<std::pair<uint64_t, uint64_t>> constants;
+    /// The addresses in the device buffer the constants are copied to, by
+    /// their offsets in the runtime bundle.
+    std::map<uint64_t, uint64_t> addresses;
+  };
+
+  /// The groups of the instructions when the constants are streamed, one
+  /// half of the streaming region holding the constants of the even groups
+  /// and the other those of the odd groups.
+  std::vector<StreamingGroup> streamingGroups_;
+
+  /// The size of each half of the streaming region.
+  uint64_t streamingHalfSize_{0};
+
+  /// Whether the constants are streamed on a device, in which case they are
+  /// kept on the host once the compilation resources are freed.
+  std::atomic<bool> streamsConstants_{false};
+
+  /// Split the instructions into streamingGroups_ whose constants take at
+  /// most -opencl-weight-streaming-group-mb, unless a single instruction
+  /// accesses more.
+  void planWeightStreaming();
+
+  /// Enqueue on the transfer queue of \p devBindings the copies of the
+  /// constants of the streaming group \p group into its half of the
+  /// streaming region, once the kernels of the group that last used that
+  /// half are done, as told by \p computed. The copies signal \p copied.
+  void enqueueStreamingCopies(size_t group,
+                              runtime::OpenCLDeviceBindings *devBindings,
+                              std::vector<cl_event> &copied,
+                              const std::vector<cl_event> &computed);
+
   /// is kernel level profiling (autoInstrumentation) enabled.
   bool kernelProfiling_{false};
   /// Manual trace events:
@@ -123,6 +165,13 @@ public:
   /// Returns IR function pointer.
   IRFunction *getIR() { return F_.get(); }
 
+  /// \returns the size of the region of the device buffer through which the
+  /// constants are streamed when they don't fit on the device.
+  uint64_t getStreamingRegionSize() const;
+
+  /// Keep the constants on the host for a device that streams them.
+  void setStreamsConstants() { streamsConstants_ = true; }
+
   /// Create a program from the \p source using provided \p options.
   cl_program createProgram(const std::string &source,
                            const std::vector<std::string> &options,
@@ -162,9 +211,10 @@ private:
   /// in any of compiled programs.
   cl_kernel createKernel(const std::string &name, cl_program program);
 
-  /// Enqueue a \p kernel on a provided \p commands queue.
+  /// Enqueue a \p kernel on a provided \p commands queue. The first argument
+  /// of the kernel is the device \p buffer.
   void enqueueKernel(llvm::StringRef name, cl_command_queue commands,
-                     cl_kernel kernel, cl_device_id device,
+                     cl_kernel kernel, cl_mem buffer, cl_device_id device,
                      llvm::ArrayRef<size_t> global,
                      std::vector<KernelLaunch> &kernelLaunches);
   /// Enqueue a \p kernel on a provided \p commands queue using specified \p
@@ -175,6 +225,20 @@ private:
                      llvm::ArrayRef<size_t> local,
                      std::vector<KernelLaunch> &kernelLaunches);
 
+  /// \returns the address of \p v in the device buffer of the run of
+  /// \p devBindings.
+  uint64_t
+  getValueAddress(const Value *v,
+                  const runtime::OpenCLDeviceBindings &devBindings) const;
+
+  /// \returns the address in the staging buffer of \p devBindings of the
+  /// placeholder at offset \p addr of \p numBytes bytes whose tensor is at
+  /// \p hostPtr, or nullptr if it doesn't fit in the staging buffer or its
+  /// tensor is in the host memory of the device, so it isn't staged.
+  uint8_t *getStagingAddress(runtime::OpenCLDeviceBindings *devBindings,
+                             uint64_t addr, uint64_t numBytes,
+                             const void *hostPtr);
+
   /// Load inputs from \p bindings onto the device.
   void loadPlaceholders(PlaceholderBindings *bindings,
                         runtime::OpenCLDeviceBindings *devBindings,
@@ -254,10 +318,36 @@ struct OpenCLDeviceBindings : DeviceBindings {
       : DeviceBindings(OCLBackend::getName()), deviceBuffer{buffer},
         commandQueue{commands}, deviceId{device}, context{ctx}, program{prog} {}
 
-  /// CL memory buffer. Currently this contains both mutable and immutable
-  /// weights, the buffer is allocated once when the network is added.
+  /// CL memory buffer. This contains both mutable and immutable weights, the
+  /// buffer is allocated once when the network is added.
   cl_mem deviceBuffer;
 
+  /// Offset in bytes of the mutable weights and activations of the run in
+  /// deviceBuffer past where the runtime bundle places them. The constants
+  /// come first in deviceBuffer and are shared by concurrent runs, each of
+  /// which has its own slot of deviceBuffer for the rest. It wraps around
+  /// when the constants are streamed through a smaller region.
+  uint64_t runOffset{0};
+
+  /// Whether the constants are resident in deviceBuffer since the network
+  /// was added, rather than copied by every run.
+  bool residentConstants{false};
+
+  /// The size of the region at the start of deviceBuffer through which the
+  /// constants are streamed, or zero if they aren't. The constants of every
+  /// group of instructions are then copied into one half of the region while
+  /// the kernels of the previous group run on the constants in the other
+  /// half, see OpenCLFunction::getStreamingRegionSize.
+  uint64_t streamingRegionSize{0};
+
+  /// The command queue the streamed constants are copied through, so that
+  /// the copies overlap the kernels of commandQueue.
+  cl_command_queue transferQueue{nullptr};
+
+  /// The addresses of the streamed constants of the group of instructions
+  /// being enqueued, by their offsets in the runtime bundle.
+  const std::map<uint64_t, uint64_t> *streamedAddresses{nullptr};
+
   /// CL compute command queue. A per run queue for the specific device.
   ///
   cl_command_queue commandQueue;
@@ -273,6 +363,16 @@ struct OpenCLDeviceBindings : DeviceBindings {
 
   /// CL program which was compiled at addNetwork.
   cl_program program;
+
+  /// Pinned host buffer of stagingSize bytes through which the placeholders
+  /// are copied, at their offset past the constant weights. It is null if
+  /// the run has none, in which case they are copied directly.
+  uint8_t *stagingBuffer{nullptr};
+  size_t stagingSize{0};
+
+  /// The allocator of the host memory of the device. The placeholders whose
+  /// tensors it allocated are copied directly instead of being staged.
+  const HostMemoryAllocator *hostMemory{nullptr};
 };
 } // namespace runtime
 } // namespace glow
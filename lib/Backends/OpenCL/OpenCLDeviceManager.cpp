@@ -24,6 +24,7 @@
 #include "OpenCL.h"
 
 #include "glow/Runtime/StatsExporter.h"
+#include "glow/Support/Memory.h"
 
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/Support/CommandLine.h"
@@ -45,6 +46,24 @@ extern llvm::cl::opt<unsigned> clPlatformId;
 extern llvm::cl::opt<unsigned> clDeviceId;
 extern llvm::cl::opt<bool> clDoProfile;
 
+static llvm::cl::opt<unsigned> clExecutionLanes(
+    "opencl-execution-lanes",
+    llvm::cl::desc("Number of inferences an OpenCL DeviceManager may run "
+                   "concurrently, each on its own command queue."),
+    llvm::cl::init(1));
+
+static llvm::cl::opt<unsigned> clWeightStreamingHostMB(
+    "opencl-weight-streaming-host-mb",
+    llvm::cl::desc("Megabytes of constants an OpenCL DeviceManager may keep "
+                   "on the host for the functions that don't fit on the "
+                   "device, and stream to it while they run. 0 disables "
+                   "streaming."),
+    llvm::cl::init(0));
+
+/// Alignment of the slots of the device buffer of a function used by the
+/// concurrent runs, the same as the alignment of the values in the bundle.
+static constexpr size_t kRunSlotAlignment = TensorAlignment;
+
 namespace glow {
 namespace runtime {
 
@@ -139,6 +158,162 @@ unsigned OpenCLCommandQueuePool::getNumQueuesAvailableForProperties(
   return it != queuesAvailableByProps_.end() ? it->second : 0;
 }
 
+OpenCLStagingBufferPool::~OpenCLStagingBufferPool() {
+  // Make sure all buffers have been returned to the pool.
+  DCHECK_EQ(buffersAllocated_, buffers_.size())
+      << "OpenCLStagingBufferPool destroyed before all buffers returned!";
+  for (auto &buffer : buffers_) {
+    cl_int err = clEnqueueUnmapMemObject(mapQueue_, buffer.backingBuffer,
+                                         buffer.hostPtr, 0, nullptr, nullptr);
+    DCHECK_EQ(err, CL_SUCCESS)
+        << "clEnqueueUnmapMemObject failed with error code " << err;
+  }
+  if (mapQueue_) {
+    clFinish(mapQueue_);
+    clReleaseCommandQueue(mapQueue_);
+  }
+  for (auto &buffer : buffers_) {
+    cl_int err = clReleaseMemObject(buffer.backingBuffer);
+    DCHECK_EQ(err, CL_SUCCESS)
+        << "clReleaseMemObject failed with error code " << err;
+  }
+}
+
+Expected<OpenCLStagingBuffer>
+OpenCLStagingBufferPool::requestStagingBuffer(size_t size) {
+  // Find the smallest available buffer large enough.
+  auto best = buffers_.end();
+  for (auto it = buffers_.begin(), e = buffers_.end(); it != e; ++it) {
+    if (it->size >= size && (best == buffers_.end() || it->size < best->size)) {
+      best = it;
+    }
+  }
+  if (best != buffers_.end()) {
+    OpenCLStagingBuffer ret = *best;
+    buffers_.erase(best);
+    return ret;
+  }
+
+  // There is none. This means a new buffer must be created and mapped.
+  cl_int err;
+  if (!mapQueue_) {
+    mapQueue_ = clCreateCommandQueue(context_, device_, 0, &err);
+    RETURN_ERR_IF_NOT(err == CL_SUCCESS,
+                      strFormat("Unable to create command queue: %d", err));
+  }
+  OpenCLStagingBuffer ret;
+  ret.size = size;
+  ret.backingBuffer = clCreateBuffer(
+      context_, CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR, size, nullptr, &err);
+  RETURN_ERR_IF_NOT(err == CL_SUCCESS,
+                    strFormat("Unable to create staging buffer: %d", err));
+  ret.hostPtr = static_cast<uint8_t *>(clEnqueueMapBuffer(
+      mapQueue_, ret.backingBuffer, /* blocking_map */ CL_TRUE,
+      CL_MAP_READ | CL_MAP_WRITE, 0, size, 0, nullptr, nullptr, &err));
+  if (err != CL_SUCCESS) {
+    clReleaseMemObject(ret.backingBuffer);
+    RETURN_ERR(strFormat("Unable to map staging buffer: %d", err));
+  }
+  ++buffersAllocated_;
+  return ret;
+}
+
+void OpenCLStagingBufferPool::returnStagingBuffer(OpenCLStagingBuffer &buffer) {
+  DCHECK_LT(buffers_.size(), buffersAllocated_)
+      << "Available buffers must be less than allocated buffers";
+  buffers_.emplace_back(std::move(buffer));
+}
+
+void OpenCLHostMemoryAllocator::init(cl_context context, cl_device_id device) {
+  std::lock_guard<std::mutex> lock(lock_);
+  context_ = context;
+  device_ = device;
+}
+
+void OpenCLHostMemoryAllocator::clear() {
+  std::lock_guard<std::mutex> lock(lock_);
+  DCHECK(buffers_.empty())
+      << "OpenCLHostMemoryAllocator cleared before all buffers were freed!";
+  for (auto &buffer : buffers_) {
+    clEnqueueUnmapMemObject(mapQueue_, buffer.second.first,
+                            reinterpret_cast<void *>(buffer.first), 0, nullptr,
+                            nullptr);
+  }
+  if (mapQueue_) {
+    clFinish(mapQueue_);
+    clReleaseCommandQueue(mapQueue_);
+    mapQueue_ = nullptr;
+  }
+  for (auto &buffer : buffers_) {
+    clReleaseMemObject(buffer.second.first);
+  }
+  buffers_.clear();
+  context_ = nullptr;
+}
+
+void *OpenCLHostMemoryAllocator::allocate(size_t bytes) {
+  std::lock_guard<std::mutex> lock(lock_);
+  if (!context_) {
+    return nullptr;
+  }
+  cl_int err;
+  if (!mapQueue_) {
+    mapQueue_ = clCreateCommandQueue(context_, device_, 0, &err);
+    if (err != CL_SUCCESS) {
+      mapQueue_ = nullptr;
+      return nullptr;
+    }
+  }
+  cl_mem buffer =
+      clCreateBuffer(context_, CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR,
+                     bytes, nullptr, &err);
+  if (err != CL_SUCCESS) {
+    return nullptr;
+  }
+  void *data = clEnqueueMapBuffer(mapQueue_, buffer, /* blocking_map */ CL_TRUE,
+                                  CL_MAP_READ | CL_MAP_WRITE, 0, bytes, 0,
+                                  nullptr, nullptr, &err);
+  // Tensors need their payloads aligned, which the mapping doesn't promise.
+  if (err == CL_SUCCESS &&
+      reinterpret_cast<uintptr_t>(data) % TensorAlignment) {
+    clEnqueueUnmapMemObject(mapQueue_, buffer, data, 0, nullptr, nullptr);
+    clFinish(mapQueue_);
+    err = CL_INVALID_VALUE;
+  }
+  if (err != CL_SUCCESS) {
+    clReleaseMemObject(buffer);
+    return nullptr;
+  }
+  buffers_[reinterpret_cast<uintptr_t>(data)] = {buffer, bytes};
+  return data;
+}
+
+void OpenCLHostMemoryAllocator::deallocate(void *data, size_t bytes) {
+  std::lock_guard<std::mutex> lock(lock_);
+  auto it = buffers_.find(reinterpret_cast<uintptr_t>(data));
+  DCHECK(it != buffers_.end()) << "The buffer wasn't allocated here";
+  if (it == buffers_.end()) {
+    return;
+  }
+  clEnqueueUnmapMemObject(mapQueue_, it->second.first, data, 0, nullptr,
+                          nullptr);
+  clFinish(mapQueue_);
+  clReleaseMemObject(it->second.first);
+  buffers_.erase(it);
+}
+
+bool OpenCLHostMemoryAllocator::contains(const void *data,
+                                         size_t bytes) const {
+  auto addr = reinterpret_cast<uintptr_t>(data);
+  std::lock_guard<std::mutex> lock(lock_);
+  auto it = buffers_.upper_bound(addr);
+  if (it == buffers_.begin()) {
+    return false;
+  }
+  --it;
+  return addr - it->first + bytes <= it->second.second;
+}
+
 Expected<cl_mem> OpenCLDeviceManager::allocDeviceBuffer(uint64_t size) {
   const uint64_t alignment = 128;
   // Always allocate buffers properly aligned to hold values of any type.
@@ -148,8 +323,44 @@ Expected<cl_mem> OpenCLDeviceManager::allocDeviceBuffer(uint64_t size) {
   RETURN_ERR_IF_NOT(buf, "Allocation failed!");
   return buf;
 }
+
+unsigned OpenCLDeviceManager::getNumExecutionLanes(const DeviceConfig &config) {
+  auto it = config.parameters.find("executionLanes");
+  if (it != config.parameters.end()) {
+    unsigned numLanes;
+    if (!llvm::StringRef(it->second).getAsInteger(10, numLanes)) {
+      return std::max(1u, numLanes);
+    }
+    LOG(ERROR) << "Invalid executionLanes parameter: " << it->second;
+  }
+  return std::max(1u, unsigned(clExecutionLanes));
+}
+
+uint64_t
+OpenCLDeviceManager::getWeightStreamingHostBytes(const DeviceConfig &config) {
+  auto it = config.parameters.find("weightStreamingHostMB");
+  if (it != config.parameters.end()) {
+    uint64_t megabytes;
+    if (!llvm::StringRef(it->second).getAsInteger(10, megabytes)) {
+      return megabytes << 20;
+    }
+    LOG(ERROR) << "Invalid weightStreamingHostMB parameter: " << it->second;
+  }
+  return uint64_t(clWeightStreamingHostMB) << 20;
+}
+
 OpenCLDeviceManager::OpenCLDeviceManager(const DeviceConfig &config)
-    : QueueBackedDeviceManager(config) {}
+    : QueueBackedDeviceManager(config),
+      streamingHostBytes_(getWeightStreamingHostBytes(config)) {
+  unsigned numLanes = getNumExecutionLanes(config);
+  if (numLanes > 1) {
+    laneLoads_.reset(new std::atomic<size_t>[numLanes]);
+    for (unsigned i = 0; i < numLanes; i++) {
+      laneLoads_[i] = 0;
+      lanes_.emplace_back(llvm::make_unique<ThreadExecutor>());
+    }
+  }
+}
 
 Error OpenCLDeviceManager::parseConfig() {
   auto it = config_.parameters.find("deviceId");
@@ -227,6 +438,14 @@ Error OpenCLDeviceManager::init() {
     RETURN_ERR("Error getting device memory limit");
   }
 
+  cl_ulong maxAllocSize;
+  err = clGetDeviceInfo(deviceId_, CL_DEVICE_MAX_MEM_ALLOC_SIZE,
+                        sizeof(cl_ulong), &maxAllocSize, NULL);
+  if (err != CL_SUCCESS) {
+    RETURN_ERR("Error getting device allocation limit");
+  }
+  maxAllocBytes_ = maxAllocSize;
+
   // If limited by deviceConfig, should allow less deviceMemory
   if (config_.getDeviceMemory() != 0 && config_.getDeviceMemory() < mem_size) {
     maxMemoryBytes_ = config_.getDeviceMemory();
@@ -236,6 +455,9 @@ Error OpenCLDeviceManager::init() {
 
   commandQueuePool_.setContext(context_);
   commandQueuePool_.setDevice(deviceId_);
+  stagingBufferPool_.setContext(context_);
+  stagingBufferPool_.setDevice(deviceId_);
+  hostMemory_.init(context_, deviceId_);
 
   Stats()->incrementCounter(kDevicesUsedOpenCL);
   exportMemoryCounters();
@@ -243,8 +465,13 @@ Error OpenCLDeviceManager::init() {
 }
 
 OpenCLDeviceManager::~OpenCLDeviceManager() {
+  // Stop the lanes before the functions they run go away.
+  ERR_TO_VOID(stop(true));
+  hostMemory_.clear();
   clReleaseContext(context_);
   buffers_.clear();
+  runSlots_.clear();
+  streamedFunctions_.clear();
   Stats()->incrementCounter(kDevicesUsedOpenCL, -1);
   zeroMemoryCounters();
 }
@@ -254,11 +481,18 @@ uint64_t OpenCLDeviceManager::getMaximumMemory() const {
 }
 
 uint64_t OpenCLDeviceManager::getAvailableMemory() const {
-  return maxMemoryBytes_ - usedMemoryBytes_;
+  // The constants that don't fit may be streamed from the host.
+  return maxMemoryBytes_ - usedMemoryBytes_ + streamingHostBytes_ -
+         usedStreamingBytes_;
+}
+
+uint64_t OpenCLDeviceManager::getLargestFreeBlock() const {
+  return std::min(getAvailableMemory(), maxAllocBytes_);
 }
 
 bool OpenCLDeviceManager::isMemoryAvailable(uint64_t estimate) const {
-  return maxMemoryBytes_ >= (usedMemoryBytes_ + estimate);
+  return maxMemoryBytes_ + streamingHostBytes_ >=
+         usedMemoryBytes_ + usedStreamingBytes_ + estimate;
 }
 
 void OpenCLDeviceManager::addNetworkImpl(const Module *module,
@@ -293,8 +527,30 @@ void OpenCLDeviceManager::addNetworkImpl(const Module *module,
     if (bundle.getConstants() == nullptr) {
       bundle.collectConstants(module);
     }
+    // The buffer holds the constants, shared by all runs, and one slot per
+    // execution lane for the rest. The kernels take 32-bit offsets into it.
     size_t sizeInBytes = bundle.getConstantWeightSize();
-    if (usedMemoryBytes_ + sizeInBytes > maxMemoryBytes_) {
+    uint64_t slotSize = getRunSlotSize(bundle);
+    uint64_t numSlots = std::max<size_t>(lanes_.size(), 1);
+    if (slotSize) {
+      numSlots = std::max<uint64_t>(
+          1,
+          std::min<uint64_t>(numSlots, (UINT32_MAX - sizeInBytes) / slotSize));
+    }
+    auto size = sizeInBytes + numSlots * slotSize;
+    OpenCLFunction *function = static_cast<OpenCLFunction *>(func.second);
+    // Keep the constants on the host and stream them through a smaller
+    // region of the buffer if they don't fit on the device. A single run at
+    // a time then streams them.
+    uint64_t streamingRegionSize = 0;
+    if (usedMemoryBytes_ + size > maxMemoryBytes_ && sizeInBytes &&
+        usedStreamingBytes_ + sizeInBytes <= streamingHostBytes_ &&
+        function->getStreamingRegionSize() < sizeInBytes) {
+      streamingRegionSize = function->getStreamingRegionSize();
+      numSlots = 1;
+      size = streamingRegionSize + slotSize;
+    }
+    if (usedMemoryBytes_ + size > maxMemoryBytes_) {
       // Free the constants.
       bundle.freeConstants();
       readyCB(module,
@@ -317,8 +573,6 @@ void OpenCLDeviceManager::addNetworkImpl(const Module *module,
     }
 
     // Copy constants to device.
-    auto size = bundle.getConstantWeightSize() + bundle.getMutableWeightSize() +
-                bundle.getActivationsSize();
     cl_mem deviceBuffer;
     if (auto autoDeviceBufferOrErr = allocDeviceBuffer(size)) {
       deviceBuffer = *autoDeviceBufferOrErr;
@@ -328,7 +582,10 @@ void OpenCLDeviceManager::addNetworkImpl(const Module *module,
     }
 
     auto buffer = std::make_shared<OpenCLBuffer>(deviceBuffer, size);
-    if (bundle.getConstants()) {
+    if (streamingRegionSize) {
+      function->setStreamsConstants();
+      usedStreamingBytes_ += sizeInBytes;
+    } else if (bundle.getConstants()) {
       auto buf = bundle.getConstants();
       size_t valueOffset = 0;
       cl_event event{nullptr};
@@ -342,7 +599,7 @@ void OpenCLDeviceManager::addNetworkImpl(const Module *module,
       }
       clFinish(commands);
     }
-    usedMemoryBytes_ += sizeInBytes;
+    usedMemoryBytes_ += size;
     // Compile the CL program.
     // Add to the function name lookup map.
     // Add shared pointer to the buffer to buffers. This way the buffer will be
@@ -358,13 +615,31 @@ void OpenCLDeviceManager::addNetworkImpl(const Module *module,
     // Create the program from the source.
     std::string source(reinterpret_cast<const char *>(kernels_cl_src),
                        kernels_cl_src_size);
-    OpenCLFunction *function = static_cast<OpenCLFunction *>(func.second);
     auto program = function->createProgram(source, options, commands);
+    std::unique_lock<std::mutex> lock(functionsLock_);
     programs_.emplace(func.first, program);
     functions_.emplace(func.first, func.second);
     buffers_.emplace(func.first, buffer);
+    auto &slots = runSlots_[func.first];
+    for (unsigned slot = 0; slot < numSlots; slot++) {
+      slots.push_back(slot);
+    }
+    if (streamingRegionSize) {
+      streamedFunctions_.emplace(func.first,
+                                 std::make_pair(streamingRegionSize,
+                                                uint64_t(sizeInBytes)));
+    }
+    lock.unlock();
     buffer->incrementUsers();
 
+    // The buffer holds the constants, or their streaming region, and a slot
+    // of activations and IO per lane.
+    NetworkMemoryUsage usage;
+    usage.constants = streamingRegionSize ? streamingRegionSize : sizeInBytes;
+    usage.io = numSlots * bundle.getMutableWeightSize();
+    usage.activations = numSlots * slotSize - usage.io;
+    addNetworkMemoryUsage(func.first, usage);
+
     DCHECK_LE(usedMemoryBytes_, maxMemoryBytes_);
     clReleaseCommandQueue(commands);
   }
@@ -380,16 +655,29 @@ void OpenCLDeviceManager::evictNetworkImpl(std::string functionName,
                                            EvictFunctionCBTy evictCB) {
   DCHECK(evictCB != nullptr);
 
+  std::unique_lock<std::mutex> lock(functionsLock_);
   if (functions_.erase(functionName)) {
     auto buffer = buffers_[functionName];
     auto users = buffer->decrementUsers();
     auto size = buffer->getSize();
     buffers_.erase(functionName);
+    runSlots_.erase(functionName);
+    uint64_t streamedBytes = 0;
+    auto streamedIt = streamedFunctions_.find(functionName);
+    if (streamedIt != streamedFunctions_.end()) {
+      streamedBytes = streamedIt->second.second;
+      streamedFunctions_.erase(streamedIt);
+    }
+    lock.unlock();
+    DCHECK_GE(usedStreamingBytes_, streamedBytes);
+    usedStreamingBytes_ -= streamedBytes;
+    removeNetworkMemoryUsage(functionName);
     if (users == 0) {
       DCHECK_GE(usedMemoryBytes_, size);
       usedMemoryBytes_ -= size;
     }
   } else {
+    lock.unlock();
     evictCB(functionName,
             MAKE_ERR(ErrorValue::ErrorCode::RUNTIME_NET_NOT_FOUND,
                      strFormat("Could not find function with name %s to evict",
@@ -405,13 +693,44 @@ OpenCLDeviceManager::requestRunCommandQueue(CompiledFunction *function) {
   auto traceInfo = function->getTraceInfo();
   cl_command_queue_properties props =
       clDoProfile || traceInfo.enabled ? CL_QUEUE_PROFILING_ENABLE : 0;
+  std::lock_guard<std::mutex> lock(poolsLock_);
   return commandQueuePool_.requestCommandQueue(props);
 }
 
 void OpenCLDeviceManager::returnRunCommandQueue(OpenCLCommandQueue &queue) {
+  std::lock_guard<std::mutex> lock(poolsLock_);
   commandQueuePool_.returnCommandQueue(queue);
 }
 
+uint64_t OpenCLDeviceManager::getRunSlotSize(const RuntimeBundle &bundle) {
+  // Keep the values of every slot as aligned as in the first one.
+  size_t size = bundle.getMutableWeightSize() + bundle.getActivationsSize();
+  return alignedSize(size, kRunSlotAlignment);
+}
+
+Expected<unsigned>
+OpenCLDeviceManager::requestRunSlot(const std::string &functionName) {
+  std::lock_guard<std::mutex> lock(functionsLock_);
+  auto &slots = runSlots_[functionName];
+  // There is a slot per lane and a lane runs one inference at a time, unless
+  // the buffer couldn't fit them all.
+  RETURN_ERR_IF_NOT(!slots.empty(),
+                    "No free slot in the device buffer of " + functionName);
+  unsigned slot = slots.back();
+  slots.pop_back();
+  return slot;
+}
+
+void OpenCLDeviceManager::returnRunSlot(
+    const std::string &functionName,
+    const std::shared_ptr<OpenCLBuffer> &buffer, unsigned slot) {
+  std::lock_guard<std::mutex> lock(functionsLock_);
+  auto it = buffers_.find(functionName);
+  if (it != buffers_.end() && it->second == buffer) {
+    runSlots_[functionName].push_back(slot);
+  }
+}
+
 void OpenCLDeviceManager::runFunctionImpl(
     RunIdentifierTy id, std::string function,
     std::unique_ptr<ExecutionContext> context, ResultCBTy resultCB) {
@@ -419,8 +738,10 @@ void OpenCLDeviceManager::runFunctionImpl(
 
   TRACE_EVENT_SCOPE_NAMED(context->getTraceContext(), TraceLevel::RUNTIME,
                           "DeviceManager::run", dmRun);
+  std::unique_lock<std::mutex> lock(functionsLock_);
   auto funcIt = functions_.find(function);
   if (funcIt == functions_.end()) {
+    lock.unlock();
     dmRun.addArg("reason", "function not found");
     TRACE_EVENT_SCOPE_END_NAMED(dmRun);
     resultCB(id,
@@ -431,6 +752,12 @@ void OpenCLDeviceManager::runFunctionImpl(
   }
 
   CompiledFunction *func = funcIt->second;
+  auto program = programs_[function];
+  auto buffer = buffers_[function];
+  auto streamedIt = streamedFunctions_.find(function);
+  uint64_t streamingRegionSize =
+      streamedIt != streamedFunctions_.end() ? streamedIt->second.first : 0;
+  lock.unlock();
 
   TRACE_EVENT_SCOPE(context->getTraceContext(), TraceEvent::TraceLevel::RUNTIME,
                     "requestRunCommandQueue");
@@ -442,22 +769,94 @@ void OpenCLDeviceManager::runFunctionImpl(
     queue = std::move(queueOrError.get());
   } else {
     resultCB(id, queueOrError.takeError(), std::move(context));
+    return;
+  }
+
+  // The streamed constants are copied through a queue of their own, so that
+  // the copies overlap the kernels.
+  OpenCLCommandQueue transferQueue;
+  if (streamingRegionSize) {
+    std::unique_lock<std::mutex> poolsLock(poolsLock_);
+    auto transferQueueOrError = commandQueuePool_.requestCommandQueue();
+    poolsLock.unlock();
+    if (transferQueueOrError) {
+      transferQueue = std::move(transferQueueOrError.get());
+    } else {
+      returnRunCommandQueue(queue);
+      resultCB(id, transferQueueOrError.takeError(), std::move(context));
+      return;
+    }
   }
 
   TRACE_EVENT_SCOPE_END();
+
+  // Get a slot of the device buffer for this run, and a pinned staging buffer
+  // for its placeholders.
+  unsigned slot;
+  auto slotOrError = requestRunSlot(function);
+  if (slotOrError) {
+    slot = slotOrError.get();
+  } else {
+    if (transferQueue.backingQueue) {
+      returnRunCommandQueue(transferQueue);
+    }
+    returnRunCommandQueue(queue);
+    resultCB(id, slotOrError.takeError(), std::move(context));
+    return;
+  }
+  OpenCLStagingBuffer staging;
+  size_t stagingSize = func->getRuntimeBundle().getMutableWeightSize();
+  if (stagingSize) {
+    std::unique_lock<std::mutex> poolsLock(poolsLock_);
+    auto stagingOrError = stagingBufferPool_.requestStagingBuffer(stagingSize);
+    poolsLock.unlock();
+    if (stagingOrError) {
+      staging = std::move(stagingOrError.get());
+    } else {
+      returnRunSlot(function, buffer, slot);
+      if (transferQueue.backingQueue) {
+        returnRunCommandQueue(transferQueue);
+      }
+      returnRunCommandQueue(queue);
+      resultCB(id, stagingOrError.takeError(), std::move(context));
+      return;
+    }
+  }
+
   // Create and set deviceBindings for call. This contains all the state needed
   // for the function to run on a device.
-  auto program = programs_[function];
   auto clBindings = llvm::make_unique<runtime::OpenCLDeviceBindings>(
-      buffers_[function]->getBuffer(), queue.backingQueue, deviceId_, context_,
-      program);
+      buffer->getBuffer(), queue.backingQueue, deviceId_, context_, program);
+  const auto &bundle = func->getRuntimeBundle();
+  clBindings->runOffset = slot * getRunSlotSize(bundle);
+  clBindings->residentConstants = true;
+  if (streamingRegionSize) {
+    // The rest follows the streaming region instead of the constants, the
+    // offset wraps around when it moves the values back.
+    clBindings->runOffset +=
+        streamingRegionSize - bundle.getConstantWeightSize();
+    clBindings->residentConstants = false;
+    clBindings->streamingRegionSize = streamingRegionSize;
+    clBindings->transferQueue = transferQueue.backingQueue;
+  }
+  clBindings->stagingBuffer = staging.hostPtr;
+  clBindings->stagingSize = staging.size;
+  clBindings->hostMemory = &hostMemory_;
 
   context->setDeviceBindings(std::move(clBindings));
 
   // Run that function.
   auto executeErr = func->execute(context.get());
 
-  // Return the command queue.
+  // Return the staging buffer, the slot and the command queue.
+  if (staging.backingBuffer) {
+    std::lock_guard<std::mutex> poolsLock(poolsLock_);
+    stagingBufferPool_.returnStagingBuffer(staging);
+  }
+  returnRunSlot(function, buffer, slot);
+  if (transferQueue.backingQueue) {
+    returnRunCommandQueue(transferQueue);
+  }
   returnRunCommandQueue(queue);
 
   // End the TraceEvent early to avoid time in the CB.
@@ -466,3 +865,46 @@ void OpenCLDeviceManager::runFunctionImpl(
   // Fire the resultCB.
   resultCB(id, std::move(executeErr), std::move(context));
 }
+
+RunIdentifierTy
+OpenCLDeviceManager::runFunction(std::string functionName,
+                                 std::unique_ptr<ExecutionContext> context,
+                                 ResultCBTy callback) {
+  if (lanes_.empty()) {
+    return QueueBackedDeviceManager::runFunction(
+        std::move(functionName), std::move(context), std::move(callback));
+  }
+
+  // Pick the lane with the fewest queued or running inferences.
+  size_t lane = 0;
+  for (size_t i = 1, e = lanes_.size(); i < e; i++) {
+    if (laneLoads_[i] < laneLoads_[lane]) {
+      lane = i;
+    }
+  }
+  laneLoads_[lane]++;
+
+  RunIdentifierTy id = nextIdentifier_++;
+  auto queueTime = context->isStatsSampled()
+                       ? std::chrono::steady_clock::now()
+                       : std::chrono::steady_clock::time_point();
+  lanes_[lane]->submit([this, id, lane, queueTime,
+                        functionName = std::move(functionName),
+                        context = std::move(context),
+                        callback = std::move(callback)]() mutable {
+    if (context->isStatsSampled()) {
+      Stats()->addLatencyValue("device_queue", functionName, queueTime);
+    }
+    runFunctionImpl(id, std::move(functionName), std::move(context),
+                    std::move(callback));
+    laneLoads_[lane]--;
+  });
+  return id;
+}
+
+Error OpenCLDeviceManager::stop(bool block) {
+  for (auto &lane : lanes_) {
+    lane->stop(block);
+  }
+  return QueueBackedDeviceManager::stop(block);
+}
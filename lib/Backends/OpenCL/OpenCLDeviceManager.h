@@ -19,6 +19,9 @@
 #include "glow/Backends/QueueBackedDeviceManager.h"
 
 #include <atomic>
+#include <map>
+#include <mutex>
+#include <vector>
 
 #if defined(__APPLE__) || defined(__MACOSX)
 #include "OpenCL/opencl.h"
@@ -88,6 +91,86 @@ public:
   getNumQueuesAvailableForProperties(cl_command_queue_properties props) const;
 };
 
+/// A pinned host buffer through which the transfers between the host and the
+/// device of a run are staged. The driver copies pinned memory to and from
+/// the device without blocking the host, where it first copies pageable
+/// memory into its own staging memory.
+struct OpenCLStagingBuffer {
+  /// The buffer, allocated with CL_MEM_ALLOC_HOST_PTR.
+  cl_mem backingBuffer{nullptr};
+  /// Host address of the buffer, which stays mapped while it is in the pool.
+  uint8_t *hostPtr{nullptr};
+  /// Size of the buffer in bytes.
+  size_t size{0};
+};
+
+/// A class that contains a pool of reusable pinned host staging buffers.
+class OpenCLStagingBufferPool {
+  // OpenCL context for the buffers managed by this pool.
+  cl_context context_{nullptr};
+  // OpenCL device that the buffers in the pool are mapped for.
+  cl_device_id device_{0};
+  // Command queue used to map and unmap the buffers.
+  cl_command_queue mapQueue_{nullptr};
+  // The available buffers.
+  std::vector<OpenCLStagingBuffer> buffers_;
+  // Number of buffers in the pool, both out on loan and within the pool.
+  unsigned buffersAllocated_{0};
+
+public:
+  /// Default constructor.
+  OpenCLStagingBufferPool() = default;
+  /// Destructor.
+  ~OpenCLStagingBufferPool();
+  /// Set the OpenCL context for the pool to \p context.
+  void setContext(const cl_context context) { context_ = context; }
+  /// Set the OpenCL device for the pool to \p device.
+  void setDevice(const cl_device_id device) { device_ = device; }
+  /// Request a staging buffer of at least \p size bytes from the pool, which
+  /// is the smallest available one large enough or a new one.
+  Expected<OpenCLStagingBuffer> requestStagingBuffer(size_t size);
+  /// Return the staging buffer \p buffer to the pool.
+  void returnStagingBuffer(OpenCLStagingBuffer &buffer);
+  /// Return the total number of buffers allocated by the pool.
+  unsigned getNumAllocatedBuffers() const { return buffersAllocated_; }
+  /// Return the total number of buffers available to request.
+  unsigned getNumBuffersAvailable() const { return buffers_.size(); }
+};
+
+/// Allocates the host memory of an OpenCL device, see
+/// DeviceManager::getHostMemoryAllocator. Every buffer is a
+/// CL_MEM_ALLOC_HOST_PTR buffer of the context of the device, which stays
+/// mapped until it is freed, so that the driver copies it to and from the
+/// device without staging it like an OpenCLStagingBuffer. The runs read and
+/// write the tensors in such buffers directly instead of through their
+/// staging buffer.
+class OpenCLHostMemoryAllocator final : public HostMemoryAllocator {
+  /// The context and the device of the buffers, null until init().
+  cl_context context_{nullptr};
+  cl_device_id device_{0};
+  /// Command queue used to map and unmap the buffers.
+  cl_command_queue mapQueue_{nullptr};
+  /// The buffers and their sizes, by mapped address.
+  std::map<uintptr_t, std::pair<cl_mem, size_t>> buffers_;
+  mutable std::mutex lock_;
+
+public:
+  ~OpenCLHostMemoryAllocator() override { clear(); }
+
+  /// Allocates the next buffers in \p context for \p device.
+  void init(cl_context context, cl_device_id device);
+
+  /// Unmaps and releases the buffers, which must all have been freed, and
+  /// the command queue.
+  void clear();
+
+  void *allocate(size_t bytes) override;
+
+  void deallocate(void *data, size_t bytes) override;
+
+  bool contains(const void *data, size_t bytes) const override;
+};
+
 /// A class that contains an openCL device buffer. It frees the buffer when it
 /// is destroyed. Can be extended to store multiple buffers and rotate through
 /// them. Also tracks number of functions using this buffer. Since adds/evicts
@@ -122,7 +205,11 @@ public:
 };
 
 /// A class controlling a single OpenCL device. Many OpenCLFunctions may be
-/// added, but only one inference is executed at a time.
+/// added. By default only one inference is executed at a time, on the device
+/// thread; with several execution lanes each lane runs one inference on its
+/// own command queue and slot of the device buffer of the function, so that
+/// the transfers of one inference overlap the kernels of another while all of
+/// them share the constants resident on the device.
 class OpenCLDeviceManager : public QueueBackedDeviceManager {
   /// String constant for logging number of in-use devices.
   static constexpr const char *kDevicesUsedOpenCL = "glow.devices_used.opencl";
@@ -130,6 +217,24 @@ class OpenCLDeviceManager : public QueueBackedDeviceManager {
   /// Compiled function list by name.
   FunctionMapTy functions_;
 
+  /// Protects functions_, programs_, buffers_, runSlots_ and
+  /// streamedFunctions_ against lookups from the execution lanes while
+  /// networks are added or evicted on the device thread.
+  std::mutex functionsLock_;
+
+  /// Threads executing inferences, one per execution lane. It is empty if the
+  /// device has a single lane, in which case inferences run on the device
+  /// thread.
+  std::vector<std::unique_ptr<ThreadExecutor>> lanes_;
+
+  /// Number of inferences queued or running on each of the lanes_.
+  std::unique_ptr<std::atomic<size_t>[]> laneLoads_;
+
+  /// \returns the number of inferences which may run concurrently, as
+  /// requested by the "executionLanes" parameter of \p config or the
+  /// -opencl-execution-lanes option.
+  static unsigned getNumExecutionLanes(const DeviceConfig &config);
+
   /// Map of function name to cl_program.
   std::unordered_map<std::string, cl_program> programs_;
 
@@ -138,12 +243,41 @@ class OpenCLDeviceManager : public QueueBackedDeviceManager {
   /// CL compute context.
   cl_context context_;
 
+  /// The size of the largest buffer the device allocates, which bounds the
+  /// buffer of a function.
+  uint64_t maxAllocBytes_{0};
+
   /// Enable profiling flag.
   bool doProfile_{false};
 
   /// A pointer to the on-device memory buffer.
   std::map<std::string, std::shared_ptr<OpenCLBuffer>> buffers_;
 
+  /// The slots of the device buffer of each function that no run is using.
+  /// The buffer of a function holds its constants, uploaded once when it is
+  /// added and shared by all its runs, followed by one slot of mutable
+  /// weights and activations per execution lane.
+  std::map<std::string, std::vector<unsigned>> runSlots_;
+
+  /// \returns the size in bytes of a slot of the device buffer of a function
+  /// whose runtime bundle is \p bundle.
+  static uint64_t getRunSlotSize(const RuntimeBundle &bundle);
+
+  /// The bytes of constants that may be kept on the host for the functions
+  /// whose constants don't fit on the device, and the bytes kept.
+  const uint64_t streamingHostBytes_;
+  std::atomic<uint64_t> usedStreamingBytes_{0};
+
+  /// The size of the streaming region of the device buffer and the bytes of
+  /// constants kept on the host of each function whose constants are
+  /// streamed, see OpenCLDeviceBindings::streamingRegionSize.
+  std::map<std::string, std::pair<uint64_t, uint64_t>> streamedFunctions_;
+
+  /// \returns the bytes of constants that may be streamed, as requested by
+  /// the "weightStreamingHostMB" parameter of \p config or the
+  /// -opencl-weight-streaming-host-mb option.
+  static uint64_t getWeightStreamingHostBytes(const DeviceConfig &config);
+
   /// Allocate a device buffer of required \p size.
   Expected<cl_mem> allocDeviceBuffer(uint64_t size);
 
@@ -153,6 +287,16 @@ class OpenCLDeviceManager : public QueueBackedDeviceManager {
   /// Command queue pool.
   OpenCLCommandQueuePool commandQueuePool_;
 
+  /// Pinned host staging buffer pool.
+  OpenCLStagingBufferPool stagingBufferPool_;
+
+  /// Protects commandQueuePool_ and stagingBufferPool_ against concurrent
+  /// runs.
+  std::mutex poolsLock_;
+
+  /// The allocator of the host memory which is transferred without staging.
+  OpenCLHostMemoryAllocator hostMemory_;
+
   /// Requests a command queue for the current run.
   Expected<OpenCLCommandQueue>
   requestRunCommandQueue(CompiledFunction *function);
@@ -160,6 +304,17 @@ class OpenCLDeviceManager : public QueueBackedDeviceManager {
   /// Returns a command queue.
   void returnRunCommandQueue(OpenCLCommandQueue &queue);
 
+  /// Requests a slot of the device buffer of the function named
+  /// \p functionName for the current run.
+  Expected<unsigned> requestRunSlot(const std::string &functionName);
+
+  /// Returns the \p slot of a run of the function named \p functionName,
+  /// unless the function was evicted since the run started with the device
+  /// buffer \p buffer.
+  void returnRunSlot(const std::string &functionName,
+                     const std::shared_ptr<OpenCLBuffer> &buffer,
+                     unsigned slot);
+
 public:
   OpenCLDeviceManager(const DeviceConfig &config);
 
@@ -167,6 +322,20 @@ public:
 
   Error init() override;
 
+  /// Execute the named Function on the least loaded execution lane, or on the
+  /// device thread if the device has a single lane.
+  RunIdentifierTy runFunction(std::string functionName,
+                              std::unique_ptr<ExecutionContext> context,
+                              ResultCBTy callback) override;
+
+  /// Stops execution on the device thread and on all execution lanes.
+  Error stop(bool block = true) override;
+
+  /// \returns the number of inferences which may run concurrently.
+  unsigned getNumExecutionLanes() const {
+    return lanes_.empty() ? 1 : lanes_.size();
+  }
+
   /// Parse config object provided at initialization \returns Error
   /// indicating success/failure.
   Error parseConfig();
@@ -182,6 +351,16 @@ public:
   /// etc.
   bool isMemoryAvailable(uint64_t estimate) const override;
 
+  /// \returns the available memory, up to the size of the largest buffer the
+  /// device allocates.
+  uint64_t getLargestFreeBlock() const override;
+
+  /// \returns the allocator of the mapped host buffers of the device, which
+  /// must all be freed before the device is destroyed.
+  HostMemoryAllocator &getHostMemoryAllocator() override {
+    return hostMemory_;
+  }
+
 protected:
   /// Adds functions to the device. Calls to this are serialized so concurrency
   /// is not an issue.
@@ -193,8 +372,8 @@ protected:
   void evictNetworkImpl(std::string functionName,
                         EvictFunctionCBTy evictCB) override;
 
-  /// Run the function on the device, there is a single thread of execution so
-  /// only one function can execute at a time.
+  /// Run the function on the device, on the device thread or on one of the
+  /// execution lanes.
   void runFunctionImpl(runtime::RunIdentifierTy id, std::string functionName,
                        std::unique_ptr<ExecutionContext> context,
                        ResultCBTy cb) override;
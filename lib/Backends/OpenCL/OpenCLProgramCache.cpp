@@ -0,0 +1,136 @@
+/**
+ * Copyright (c) Glow Contributors. See CONTRIBUTORS file.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "OpenCLProgramCache.h"
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <glog/logging.h>
+
+#include <cstring>
+
+using namespace glow;
+
+namespace {
+/// Version of the layout of the cache files. Bump it whenever the layout
+/// changes in a way the key does not capture.
+constexpr char kFormatVersion[] = "glow-opencl-program-cache-1";
+
+/// The header of a cached program binary, followed by the binary.
+struct CacheFileHeader {
+  char magic[8];
+  uint64_t binarySize;
+};
+} // namespace
+
+std::string OpenCLProgramCache::getPath(llvm::StringRef key) const {
+  llvm::SmallString<128> path(dir_);
+  llvm::sys::path::append(path, key + ".clbin");
+  return path.str();
+}
+
+std::string OpenCLProgramCache::getKey(llvm::StringRef deviceName,
+                                       llvm::StringRef deviceVersion,
+                                       llvm::StringRef driverVersion,
+                                       llvm::StringRef source,
+                                       llvm::StringRef options) {
+  llvm::MD5 hash;
+  auto add = [&hash](llvm::StringRef data) {
+    hash.update(data);
+    // Terminate every part, so that moving bytes from one part to the next
+    // changes the key.
+    hash.update(llvm::StringRef("", 1));
+  };
+  add(kFormatVersion);
+  add(deviceName);
+  add(deviceVersion);
+  add(driverVersion);
+  add(source);
+  add(options);
+  llvm::MD5::MD5Result result;
+  hash.final(result);
+  llvm::SmallString<32> key;
+  llvm::MD5::stringifyResult(result, key);
+  return key.str();
+}
+
+std::unique_ptr<llvm::MemoryBuffer>
+OpenCLProgramCache::load(llvm::StringRef key) const {
+  auto path = getPath(key);
+  auto bufferOrErr = llvm::MemoryBuffer::getFile(path);
+  if (!bufferOrErr) {
+    return nullptr;
+  }
+  auto &buffer = *bufferOrErr;
+  CacheFileHeader header;
+  if (buffer->getBufferSize() <= sizeof(header)) {
+    LOG(WARNING) << "Ignoring the truncated program cache file " << path;
+    return nullptr;
+  }
+  std::memcpy(&header, buffer->getBufferStart(), sizeof(header));
+  if (std::memcmp(header.magic, "GLOWCLB1", sizeof(header.magic)) != 0 ||
+      header.binarySize != buffer->getBufferSize() - sizeof(header)) {
+    LOG(WARNING) << "Ignoring the mismatched program cache file " << path;
+    return nullptr;
+  }
+  return llvm::MemoryBuffer::getMemBufferCopy(
+      buffer->getBuffer().drop_front(sizeof(header)), path);
+}
+
+void OpenCLProgramCache::store(llvm::StringRef key,
+                               llvm::StringRef binary) const {
+  if (auto EC = llvm::sys::fs::create_directories(dir_)) {
+    LOG(WARNING) << "Cannot create the program cache directory " << dir_
+                 << ": " << EC.message();
+    return;
+  }
+  // Write a temporary file and rename it, so that concurrent builds of the
+  // same program, in this process or in others, never load a partially
+  // written file.
+  auto path = getPath(key);
+  int fd;
+  llvm::SmallString<128> tmpPath;
+  if (auto EC = llvm::sys::fs::createUniqueFile(path + "-%%%%%%.tmp", fd,
+                                                tmpPath)) {
+    LOG(WARNING) << "Cannot create a program cache file in " << dir_ << ": "
+                 << EC.message();
+    return;
+  }
+  {
+    llvm::raw_fd_ostream os(fd, /* shouldClose */ true);
+    CacheFileHeader header;
+    std::memcpy(header.magic, "GLOWCLB1", sizeof(header.magic));
+    header.binarySize = binary.size();
+    os.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    os << binary;
+    os.close();
+    if (os.has_error()) {
+      os.clear_error();
+      LOG(WARNING) << "Cannot write the program cache file " << tmpPath.c_str();
+      llvm::sys::fs::remove(tmpPath);
+      return;
+    }
+  }
+  if (auto EC = llvm::sys::fs::rename(tmpPath, path)) {
+    LOG(WARNING) << "Cannot write the program cache file " << path << ": "
+                 << EC.message();
+    llvm::sys::fs::remove(tmpPath);
+  }
+}
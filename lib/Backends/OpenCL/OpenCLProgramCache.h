@@ -0,0 +1,62 @@
+/**
+ * Copyright (c) Glow Contributors. See CONTRIBUTORS file.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef GLOW_BACKENDS_OPENCL_OPENCLPROGRAMCACHE_H
+#define GLOW_BACKENDS_OPENCL_OPENCLPROGRAMCACHE_H
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+#include <memory>
+#include <string>
+
+namespace glow {
+
+/// An on-disk cache of the OpenCL programs built by the OpenCL backend. The
+/// binary of a program is stored in a file of the cache directory named after
+/// a hash of the device, its driver, the source and the build options, so
+/// that building the same program again, e.g. after a restart, creates it
+/// from the binary instead of compiling the source.
+class OpenCLProgramCache final {
+  /// The directory holding the cached program binaries.
+  std::string dir_;
+
+  /// \returns the path of the file of the entry \p key.
+  std::string getPath(llvm::StringRef key) const;
+
+public:
+  /// Create a cache of the program binaries in \p dir.
+  explicit OpenCLProgramCache(llvm::StringRef dir) : dir_(dir) {}
+
+  /// \returns the key of the program built from \p source with the build
+  /// \p options for the device named \p deviceName, whose OpenCL version is
+  /// \p deviceVersion and driver version is \p driverVersion.
+  static std::string getKey(llvm::StringRef deviceName,
+                            llvm::StringRef deviceVersion,
+                            llvm::StringRef driverVersion,
+                            llvm::StringRef source, llvm::StringRef options);
+
+  /// \returns the program binary stored for \p key, or nullptr if there is
+  /// none.
+  std::unique_ptr<llvm::MemoryBuffer> load(llvm::StringRef key) const;
+
+  /// Store the program \p binary for \p key. Failures are logged and
+  /// otherwise ignored, the cache is only an optimization.
+  void store(llvm::StringRef key, llvm::StringRef binary) const;
+};
+
+} // namespace glow
+
+#endif // GLOW_BACKENDS_OPENCL_OPENCLPROGRAMCACHE_H
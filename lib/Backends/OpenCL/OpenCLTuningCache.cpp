@@ -0,0 +1,120 @@
+/**
+ * Copyright (c) Glow Contributors. See CONTRIBUTORS file.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "OpenCLTuningCache.h"
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace glow;
+
+std::string OpenCLTuningCache::getKey(llvm::StringRef deviceName,
+                                      llvm::StringRef kernel,
+                                      llvm::ArrayRef<size_t> params) {
+  std::string key;
+  llvm::raw_string_ostream os(key);
+  os << deviceName << '|' << kernel << '|';
+  for (size_t i = 0, e = params.size(); i < e; i++) {
+    os << (i ? "x" : "") << params[i];
+  }
+  os.flush();
+  // Tabs and new lines separate the fields and lines of the file.
+  for (auto &c : key) {
+    if (c == '\t' || c == '\n') {
+      c = ' ';
+    }
+  }
+  return key;
+}
+
+bool OpenCLTuningCache::lookup(llvm::StringRef key,
+                               std::vector<size_t> &values) const {
+  std::lock_guard<std::mutex> lock(lock_);
+  auto it = entries_.find(key);
+  if (it == entries_.end()) {
+    return false;
+  }
+  values = it->second;
+  return true;
+}
+
+void OpenCLTuningCache::insert(llvm::StringRef key,
+                               llvm::ArrayRef<size_t> values) {
+  std::lock_guard<std::mutex> lock(lock_);
+  entries_[key] = values.vec();
+}
+
+size_t OpenCLTuningCache::size() const {
+  std::lock_guard<std::mutex> lock(lock_);
+  return entries_.size();
+}
+
+Error OpenCLTuningCache::load(llvm::StringRef path) {
+  if (!llvm::sys::fs::exists(path)) {
+    return Error::success();
+  }
+  auto fileOrErr = llvm::MemoryBuffer::getFile(path);
+  RETURN_ERR_IF_NOT(fileOrErr, "Could not read the OpenCL tuning cache " +
+                                   path.str() + ": " +
+                                   fileOrErr.getError().message());
+
+  llvm::SmallVector<llvm::StringRef, 16> lines;
+  (*fileOrErr)->getBuffer().split(lines, '\n', -1, /* KeepEmpty */ false);
+  std::lock_guard<std::mutex> lock(lock_);
+  for (auto line : lines) {
+    llvm::SmallVector<llvm::StringRef, 8> fields;
+    line.split(fields, '\t');
+    RETURN_ERR_IF_NOT(fields.size() >= 2,
+                      "Malformed line in the OpenCL tuning cache " +
+                          path.str() + ": " + line.str());
+    std::vector<size_t> values;
+    for (size_t i = 1, e = fields.size(); i < e; i++) {
+      unsigned long long value;
+      RETURN_ERR_IF_NOT(!fields[i].getAsInteger(10, value),
+                        "Malformed value in the OpenCL tuning cache " +
+                            path.str() + ": " + line.str());
+      values.push_back(value);
+    }
+    entries_[fields[0]] = std::move(values);
+  }
+  return Error::success();
+}
+
+Error OpenCLTuningCache::save(llvm::StringRef path) const {
+  // Write a temporary file first and rename it, so that a process loading
+  // the cache concurrently never sees a partially written file.
+  std::string tmpPath = path.str() + ".tmp";
+  {
+    std::error_code EC;
+    llvm::raw_fd_ostream os(tmpPath, EC, llvm::sys::fs::F_None);
+    RETURN_ERR_IF_NOT(!EC, "Could not write the OpenCL tuning cache " +
+                               tmpPath + ": " + EC.message());
+    std::lock_guard<std::mutex> lock(lock_);
+    for (const auto &entry : entries_) {
+      os << entry.getKey();
+      for (auto value : entry.getValue()) {
+        os << '\t' << value;
+      }
+      os << '\n';
+    }
+  }
+  auto EC = llvm::sys::fs::rename(tmpPath, path);
+  RETURN_ERR_IF_NOT(!EC, "Could not write the OpenCL tuning cache " +
+                             path.str() + ": " + EC.message());
+  return Error::success();
+}
@@ -0,0 +1,69 @@
+/**
+ * Copyright (c) Glow Contributors. See CONTRIBUTORS file.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef GLOW_BACKENDS_OPENCL_OPENCLTUNINGCACHE_H
+#define GLOW_BACKENDS_OPENCL_OPENCLTUNINGCACHE_H
+
+#include "glow/Support/Error.h"
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace glow {
+
+/// The configurations of the OpenCL kernels found fastest by the autotuner,
+/// e.g. the local work sizes of a kernel or the tile sizes of a convolution.
+/// Every configuration is a list of integers identified by a key, which names
+/// the device, the kernel and the shape it was tuned for. The cache can be
+/// persisted to a text file with one configuration per line, made of the key
+/// and the integers separated by tabs. May be used concurrently.
+class OpenCLTuningCache {
+  /// The configurations by key.
+  llvm::StringMap<std::vector<size_t>> entries_;
+  /// Protects entries_.
+  mutable std::mutex lock_;
+
+public:
+  /// \returns the key of the configuration of \p kernel on the device named
+  /// \p deviceName for the shape described by \p params.
+  static std::string getKey(llvm::StringRef deviceName, llvm::StringRef kernel,
+                            llvm::ArrayRef<size_t> params);
+
+  /// Copies the configuration of \p key into \p values.
+  /// \returns false if there is none.
+  bool lookup(llvm::StringRef key, std::vector<size_t> &values) const;
+
+  /// Sets the configuration of \p key to \p values.
+  void insert(llvm::StringRef key, llvm::ArrayRef<size_t> values);
+
+  /// \returns the number of configurations in the cache.
+  size_t size() const;
+
+  /// Adds the configurations of the file \p path to the cache. A missing file
+  /// is the same as an empty one.
+  Error load(llvm::StringRef path);
+
+  /// Writes all configurations of the cache to the file \p path.
+  Error save(llvm::StringRef path) const;
+};
+
+} // namespace glow
+
+#endif // GLOW_BACKENDS_OPENCL_OPENCLTUNINGCACHE_H
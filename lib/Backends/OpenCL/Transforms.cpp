@@ -25,6 +25,14 @@ using llvm::dyn_cast;
 
 using namespace glow;
 
+/// Per-element costs of the OpenCL kernels in each layout. The NCHW
+/// convolution kernel is the fast one, the NHWC one is the generic fallback.
+static const LayoutCosts oclLayoutCosts = {
+    /* convNHWC */ 4, /* convNCHW */ 1,
+    /* poolNHWC */ 2, /* poolNCHW */ 1,
+    /* transpose */ 1,
+};
+
 /// Perform OpenCL specific post-lowering graph transformation.
 bool OCLBackend::transformPostLowering(Function *F,
                                        CompilationContext &cctx) const {
@@ -34,55 +42,17 @@ bool OCLBackend::transformPostLowering(Function *F,
   LOG_SCOPE(F->getLogContext(), "OCLBackend::transformPostLowering")
 
   bool changed = false;
-  for (auto &node : F->getNodes()) {
-    if (auto *CN = dyn_cast<ConvolutionNode>(&node)) {
-      if (cctx.compMode == CompilationMode::Train) {
-        continue;
-      }
-
-      // TODO: OpenCL fast convolution kernel itself has some issue with group >
-      // 1, which will be investigated later. So far, if the group > 1, we just
-      // call the slow convolution kernel.
-      if (CN->getGroup() > 1) {
-        continue;
-      }
-
-      if (CN->getLayout() == NCHW) {
-        continue;
-      }
-
-      auto *NR = convertConvToNCHWConv(CN, F);
-      CN->getResult().replaceAllUsesOfWith(NR);
-      changed = true;
-      continue;
-    }
-    if (auto *PMN = dyn_cast<MaxPoolNode>(&node)) {
-      if (cctx.compMode == CompilationMode::Train) {
-        continue;
-      }
-
-      if (PMN->getLayout() == NCHW) {
-        continue;
-      }
-
-      auto results = convertMaxPoolToNCHWPool(PMN, F);
-      PMN->getResult().replaceAllUsesOfWith(results.first);
-      changed = true;
-      continue;
-    }
-    if (auto *PAN = dyn_cast<AvgPoolNode>(&node)) {
-      if (cctx.compMode == CompilationMode::Train) {
-        continue;
-      }
-      if (PAN->getLayout() == NCHW) {
-        continue;
-      }
+  if (cctx.compMode != CompilationMode::Train) {
+    // TODO: OpenCL fast convolution kernel itself has some issue with group >
+    // 1, which will be investigated later. So far, if the group > 1, we just
+    // call the slow convolution kernel.
+    changed |= assignNCHWLayouts(F, oclLayoutCosts, [](const Node *N) {
+      auto *CN = dyn_cast<ConvolutionNode>(N);
+      return !CN || CN->getGroup() == 1;
+    });
+  }
 
-      auto *NR = convertAvgPoolToNCHWPool(PAN, F);
-      PAN->getResult().replaceAllUsesOfWith(NR);
-      changed = true;
-      continue;
-    }
+  for (auto &node : F->getNodes()) {
     // The code below replaces a regular BatchedReduceAddNode with a
     // semantically identical OCLBatchedReduceAddNode that has two additional
     // inputs for the slice sizes of the input and output nodes. The OpenCL
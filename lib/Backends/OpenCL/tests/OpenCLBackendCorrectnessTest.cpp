@@ -20,8 +20,15 @@ using namespace glow;
 std::set<std::string> glow::backendTestBlacklist = {
     // Requires the CPU target due to the use of MockCPUBackend.
     "dataParallelStackingTest/0",
+    "dataParallelFusionTest/0",
     "localResponseNormalizationTest/0",
     "localResponseNormalizationGradTest/0",
     "AvgPoolGradTest/0",
     "intLookupTable/0",
+    "poolsTest/0",
+    "reductionsTest/0",
+    "gatherScatterTest/0",
+    "sliceConcatTest/0",
+    // -llvm-fast-math is an option of the LLVM backends.
+    "fastMathTest/0",
 };
@@ -38,6 +38,9 @@ std::set<std::string> glow::backendTestBlacklist = {
     "ResizeNearest_Int8/0",
     "ResizeNearest_Int16/0",
     "ResizeNearest_Int32/0",
+    "ResizeBilinear_Float/0",
+    "ResizeBilinear_Float16/0",
+    "ResizeBilinear_Int8/0",
     "replaceNaN_Float/0",
     "replaceNaN_Float16/0",
     "log/0",
@@ -71,6 +74,7 @@ std::set<std::string> glow::backendTestBlacklist = {
     "FloatArgMaxNoKeepDim/0",
     "QuantizedArgMaxNoKeepDim/0",
     "ConcatTopK/0",
+    "Transpose6Dims/0",
     "GatherDataFloatIdxInt32/0",
     "GatherDataFloat16IdxInt32/0",
     "GatherDataFloat16IdxInt64/0",
@@ -170,6 +174,8 @@ std::set<std::string> glow::backendTestBlacklist = {
     "FusedRowwiseQuantizedSparseLengthsWeightedSum_Float16_AccumFloat/0",
     "FusedRowwiseQuantizedSparseLengthsWeightedSum_Float16_AccumFloat16/0",
     "FusedRowwiseQuantizedSparseLengthsWeightedSum_ConvertedFloat16/0",
+    "FusedRowwiseQuantizedSparseLengthsWeightedSum_Float_FP16ScaleOffset/0",
+    "FusedRowwiseQuantizedSparseLengthsWeightedSum_Float_4Bit/0",
     "FusedRowwiseQuantizedSparseLengthsWeightedSum_ConvertedFloat16_back_to_"
     "back/0",
     "FusedRowwiseQuantizedSparseLengthsSum_Float/0",
@@ -186,6 +192,7 @@ std::set<std::string> glow::backendTestBlacklist = {
     "SigmoidCrossEntropyWithLogits/0",
     "insertTensorTest/0",
     "Bucketize/0",
+    "BucketizeManyBoundaries/0",
     "FP16SoftMax/0",
     "LengthsToRanges/0",
     "LengthsRangeFill/0",
@@ -203,6 +210,18 @@ std::set<std::string> glow::backendTestBlacklist = {
     "dotProduct2D_Int8/0",
     "BatchBoxCox_Float/0",
     "BatchBoxCox_Float16/0",
+    "LayerNormalization_Float/0",
+    "LayerNormalization_Float16/0",
+    "BatchedPairwiseDotProduct_Float/0",
+    "BatchedPairwiseDotProduct_Float16/0",
+    "SparseLengthsMean_Float/0",
+    "SparseLengthsMean_Float16/0",
+    "SparseLengthsMax_Float/0",
+    "SparseLengthsMax_Float16/0",
+    "FusedRowwiseQuantizedSparseLengthsMean_Float/0",
+    "FusedRowwiseQuantizedSparseLengthsMean_Float16/0",
+    "FusedRowwiseQuantizedSparseLengthsMax_Float/0",
+    "FusedRowwiseQuantizedSparseLengthsMax_Float16/0",
     "ConvertFrom_FloatTy_To_Float16Ty/0",
     "ConvertFrom_FloatTy_To_Int32ITy/0",
     "ConvertFrom_FloatTy_To_Int64ITy/0",
@@ -249,6 +268,7 @@ std::set<std::string> glow::backendTestBlacklist = {
     "Int8Log/0",
     "Int8Sigmoid/0",
     "rowwiseQuantizedFCTest/0",
+    "DynamicQuantizedFC/0",
     "rowwiseQuantizedFCTestSymmetric/0",
     "rowwiseQuantizedSLWSTest/0",
     "SLSAllZeroLengths_Float16/0",
@@ -23,6 +23,7 @@
 using namespace glow;
 
 #include <png.h>
+#include <thread>
 
 namespace glow {
 
@@ -410,7 +411,8 @@ void glow::loadImagesAndPreprocess(const llvm::ArrayRef<std::string> &filenames,
                                    Tensor *inputImageData,
                                    ImageNormalizationMode imageNormMode,
                                    ImageChannelOrder imageChannelOrder,
-                                   ImageLayout imageLayout) {
+                                   ImageLayout imageLayout,
+                                   unsigned numThreads) {
   DCHECK(!filenames.empty())
       << "There must be at least one filename in filenames.";
   size_t numImages = filenames.size();
@@ -462,14 +464,27 @@ void glow::loadImagesAndPreprocess(const llvm::ArrayRef<std::string> &filenames,
   inputImageData->reset(ElemKind::FloatTy, batchDims);
   auto IIDH = inputImageData->getHandle<>();
 
-  // Read images into local tensors and add to batch.
-  for (size_t n = 0; n < filenames.size(); n++) {
-    Tensor localCopy =
-        readPngImageAndPreprocess(filenames[n], imageNormMode,
-                                  imageChannelOrder, imageLayout, mean, stddev);
-    DCHECK(std::equal(localCopy.dims().begin(), localCopy.dims().end(),
-                      inputImageData->dims().begin() + 1))
-        << "All images must have the same dimensions";
-    IIDH.insertSlice(localCopy, n);
+  // Read images into local tensors and add to batch. Every thread reads an
+  // interleaved subset of the images, into disjoint slices of the batch.
+  auto readImages = [&](size_t first, size_t step) {
+    for (size_t n = first; n < numImages; n += step) {
+      Tensor localCopy = readPngImageAndPreprocess(
+          filenames[n], imageNormMode, imageChannelOrder, imageLayout, mean,
+          stddev);
+      DCHECK(std::equal(localCopy.dims().begin(), localCopy.dims().end(),
+                        inputImageData->dims().begin() + 1))
+          << "All images must have the same dimensions";
+      IIDH.insertSlice(localCopy, n);
+    }
+  };
+  size_t numReaders =
+      std::max<size_t>(1, std::min<size_t>(numThreads, numImages));
+  std::vector<std::thread> readers;
+  for (size_t i = 1; i < numReaders; i++) {
+    readers.emplace_back(readImages, i, numReaders);
+  }
+  readImages(0, numReaders);
+  for (auto &reader : readers) {
+    reader.join();
   }
 }
@@ -22,6 +22,9 @@
 #include "llvm/Support/raw_ostream.h"
 #include <glog/logging.h>
 
+#include <algorithm>
+#include <cstring>
+
 using namespace glow;
 
 namespace {
@@ -196,79 +199,144 @@ static void dumpAsciiGenericImpl(Handle<ElemTy> handle, llvm::raw_ostream &os) {
   os.flush();
 }
 
-/// This is a slow generic transpose. This method performs a single for loop
-/// over a single dimension, or if we've reached the last dimension perform a
-/// single copy of a single element.
-template <class ElemTy>
-static void
-transposeGenericImpl(const Handle<ElemTy> &src, Handle<ElemTy> &dest,
-                     size_t *srcCoor, size_t *destCoor,
-                     llvm::ArrayRef<unsigned_t> shuffle, unsigned depth = 0) {
-  if (depth == shuffle.size()) {
-    auto srcIdx = llvm::ArrayRef<size_t>(srcCoor, depth);
-    auto destIdx = llvm::ArrayRef<size_t>(destCoor, depth);
-    dest.at(destIdx) = src.at(srcIdx);
-    return;
-  }
+/// The side of the tiles of the 2D transposes. The tiles have constant bounds
+/// so that the compiler transposes them in registers.
+constexpr size_t transposeTileSize = 8;
 
-  // Iterate over one dimension and continue recursively to the next dim.
-  for (size_t x = 0, e = dest.dims()[depth]; x < e; x++) {
-    unsigned_t swizzledDepth = shuffle[depth];
-    srcCoor[swizzledDepth] = x;
-    destCoor[depth] = x;
-    transposeGenericImpl(src, dest, srcCoor, destCoor, shuffle, depth + 1);
-  }
-}
+/// The side of the blocks of tiles of the 2D transposes, which are small
+/// enough to keep their source and destination lines in the L1 cache.
+constexpr size_t transposeBlockSize = 64;
 
-/// Faster function for transposing a tensor for important/common tensor
-/// shapes. If a transpose successfully occurs, the function \returns true;
-/// otherwise it \returns false, representing no transpose occurred and some
-/// other transpose function (e.g. transposeGenericImpl) must be called. \p
-/// dest is the tensor to transpose, and \p shuffle defines how to transpose.
+/// Copies the \p rows x \p cols matrix \p src, whose rows and columns are
+/// \p srcRow and \p srcCol elements apart, to \p dest, whose rows and columns
+/// are \p destRow and \p destCol elements apart, one tile at a time.
 template <class ElemTy>
-static bool tryTransposeFastImpl(const Handle<ElemTy> &src,
-                                 Handle<ElemTy> &dest,
-                                 llvm::ArrayRef<unsigned_t> shuffle) {
-  const size_t numDims = dest.dims().size();
-  size_t srcCoorArr[max_tensor_dimensions];
-  size_t destCoorArr[max_tensor_dimensions] = {0};
-  auto srcCoor = llvm::ArrayRef<size_t>(srcCoorArr, numDims);
-  auto destCoor = llvm::ArrayRef<size_t>(destCoorArr, numDims);
-
-  /// This defines a single depth of the for loop used to iterate over the
-  /// source and destination tensors for transposing.
-#define TRANSPOSE_LOOP_LEVEL(DEPTH_)                                           \
-  for (srcCoorArr[shuffle[DEPTH_]] = 0, destCoorArr[DEPTH_] = 0;               \
-       destCoorArr[DEPTH_] < dest.dims()[DEPTH_];                              \
-       srcCoorArr[shuffle[DEPTH_]]++, destCoorArr[DEPTH_]++)
-
-  switch (numDims) {
-  case 2:
-    TRANSPOSE_LOOP_LEVEL(1) {
-      TRANSPOSE_LOOP_LEVEL(0) { dest.at(destCoor) = src.at(srcCoor); }
-    }
-    return true;
-  case 4:
-    TRANSPOSE_LOOP_LEVEL(1) {
-      TRANSPOSE_LOOP_LEVEL(2) {
-        TRANSPOSE_LOOP_LEVEL(0) {
-          TRANSPOSE_LOOP_LEVEL(3) { dest.at(destCoor) = src.at(srcCoor); }
+static void transposeMatrix(const ElemTy *src, ElemTy *dest, size_t rows,
+                            size_t cols, size_t srcRow, size_t srcCol,
+                            size_t destRow, size_t destCol) {
+  constexpr size_t tile = transposeTileSize;
+  for (size_t br = 0; br < rows; br += transposeBlockSize) {
+    for (size_t bc = 0; bc < cols; bc += transposeBlockSize) {
+      size_t er = std::min(br + transposeBlockSize, rows);
+      size_t ec = std::min(bc + transposeBlockSize, cols);
+      for (size_t r = br; r < er; r += tile) {
+        for (size_t c = bc; c < ec; c += tile) {
+          const ElemTy *S = src + r * srcRow + c * srcCol;
+          ElemTy *D = dest + r * destRow + c * destCol;
+          // The rows are adjacent in the source, so the inner loop reads it
+          // sequentially.
+          if (r + tile <= er && c + tile <= ec) {
+            for (size_t j = 0; j < tile; j++) {
+              for (size_t i = 0; i < tile; i++) {
+                D[i * destRow + j * destCol] = S[i * srcRow + j * srcCol];
+              }
+            }
+            continue;
+          }
+          for (size_t j = 0, ej = std::min(tile, ec - c); j < ej; j++) {
+            for (size_t i = 0, ei = std::min(tile, er - r); i < ei; i++) {
+              D[i * destRow + j * destCol] = S[i * srcRow + j * srcCol];
+            }
+          }
         }
       }
     }
-    return true;
   }
-  return false;
 }
 
+/// Transposes \p src into \p dest, of the transposed shape, by \p shuffle.
+/// The kernel works on the raw data with the strides of the types. The
+/// dimensions of size 1 are dropped, and the consecutive dimensions of
+/// \p dest that are consecutive in \p src too are merged, which turns most
+/// transposes into 2D or 3D ones. Then the rows are copied with memcpy if the
+/// innermost dimensions of \p src and \p dest match, otherwise the innermost
+/// dimension of \p dest is transposed with the innermost one of \p src by
+/// tiles, for every index of the other dimensions.
 template <class ElemTy>
-static void transposeSelectImpl(const Handle<ElemTy> &src, Handle<ElemTy> &dest,
-                                llvm::ArrayRef<unsigned_t> shuffle) {
-  bool transposeOccurred = tryTransposeFastImpl(src, dest, shuffle);
-  if (!transposeOccurred) {
-    size_t srcCoor[max_tensor_dimensions];
-    size_t destCoor[max_tensor_dimensions];
-    transposeGenericImpl(src, dest, srcCoor, destCoor, shuffle);
+static void transposeImpl(const Tensor *src, Tensor *dest,
+                          llvm::ArrayRef<unsigned_t> shuffle) {
+  auto srcStrides = src->getType().strides();
+  auto destStrides = dest->getType().strides();
+  auto dims = dest->dims();
+
+  // The sizes of the merged dimensions of dest, and their strides in src and
+  // in dest.
+  size_t sizes[max_tensor_dimensions];
+  size_t srcS[max_tensor_dimensions];
+  size_t destS[max_tensor_dimensions];
+  size_t m = 0;
+  for (size_t i = 0, e = dims.size(); i < e; i++) {
+    if (dims[i] == 1) {
+      continue;
+    }
+    size_t srcStride = srcStrides[shuffle[i]];
+    if (m > 0 && srcS[m - 1] == srcStride * dims[i] &&
+        destS[m - 1] == destStrides[i] * dims[i]) {
+      sizes[m - 1] *= dims[i];
+      srcS[m - 1] = srcStride;
+      destS[m - 1] = destStrides[i];
+      continue;
+    }
+    sizes[m] = dims[i];
+    srcS[m] = srcStride;
+    destS[m] = destStrides[i];
+    m++;
+  }
+
+  auto *srcData = reinterpret_cast<const ElemTy *>(src->getUnsafePtr());
+  auto *destData = reinterpret_cast<ElemTy *>(dest->getUnsafePtr());
+  if (m == 0) {
+    destData[0] = srcData[0];
+    return;
+  }
+
+  // The dimension of dest which is innermost in src.
+  size_t inner = 0;
+  for (size_t i = 1; i < m; i++) {
+    if (srcS[i] < srcS[inner]) {
+      inner = i;
+    }
+  }
+
+  // The dimensions that are iterated around the copy of rows, or around the
+  // 2D transposes of the inner and of the last dimensions.
+  size_t outer[max_tensor_dimensions];
+  size_t numOuter = 0;
+  size_t numIters = 1;
+  for (size_t i = 0; i + 1 < m; i++) {
+    if (i != inner) {
+      outer[numOuter++] = i;
+      numIters *= sizes[i];
+    }
+  }
+
+  size_t counters[max_tensor_dimensions] = {0};
+  const ElemTy *S = srcData;
+  ElemTy *D = destData;
+  for (size_t it = 0; it < numIters; it++) {
+    if (inner != m - 1) {
+      transposeMatrix(S, D, sizes[inner], sizes[m - 1], srcS[inner],
+                      srcS[m - 1], destS[inner], destS[m - 1]);
+    } else if (srcS[m - 1] == 1 && destS[m - 1] == 1) {
+      memcpy(D, S, sizes[m - 1] * sizeof(ElemTy));
+    } else {
+      for (size_t i = 0; i < sizes[m - 1]; i++) {
+        D[i * destS[m - 1]] = S[i * srcS[m - 1]];
+      }
+    }
+
+    // Step to the next index of the outer dimensions.
+    for (size_t d = numOuter; d > 0; d--) {
+      size_t dim = outer[d - 1];
+      S += srcS[dim];
+      D += destS[dim];
+      if (++counters[d - 1] < sizes[dim]) {
+        break;
+      }
+      S -= srcS[dim] * sizes[dim];
+      D -= destS[dim] * sizes[dim];
+      counters[d - 1] = 0;
+    }
   }
 }
 } // namespace
@@ -399,51 +467,35 @@ void glow::genericTranspose(const Tensor *src, Tensor *dest,
 
   switch (src->getElementType()) {
   case ElemKind::FloatTy: {
-    auto srcH = src->getHandle<float>();
-    auto destH = dest->getHandle<float>();
-    transposeSelectImpl(srcH, destH, shuffle);
+    transposeImpl<float>(src, dest, shuffle);
     return;
   }
   case ElemKind::Float16Ty: {
-    auto srcH = src->getHandle<float16_t>();
-    auto destH = dest->getHandle<float16_t>();
-    transposeSelectImpl(srcH, destH, shuffle);
+    transposeImpl<float16_t>(src, dest, shuffle);
     return;
   }
   case ElemKind::Int8QTy: {
-    auto srcH = src->getHandle<int8_t>();
-    auto destH = dest->getHandle<int8_t>();
-    transposeSelectImpl(srcH, destH, shuffle);
+    transposeImpl<int8_t>(src, dest, shuffle);
     return;
   }
   case ElemKind::UInt8QTy: {
-    auto srcH = src->getHandle<uint8_t>();
-    auto destH = dest->getHandle<uint8_t>();
-    transposeSelectImpl(srcH, destH, shuffle);
+    transposeImpl<uint8_t>(src, dest, shuffle);
     return;
   }
   case ElemKind::Int16QTy: {
-    auto srcH = src->getHandle<int16_t>();
-    auto destH = dest->getHandle<int16_t>();
-    transposeSelectImpl(srcH, destH, shuffle);
+    transposeImpl<int16_t>(src, dest, shuffle);
     return;
   }
   case ElemKind::Int32QTy: {
-    auto srcH = src->getHandle<int32_t>();
-    auto destH = dest->getHandle<int32_t>();
-    transposeSelectImpl(srcH, destH, shuffle);
+    transposeImpl<int32_t>(src, dest, shuffle);
     return;
   }
   case ElemKind::Int32ITy: {
-    auto srcH = src->getHandle<int32_t>();
-    auto destH = dest->getHandle<int32_t>();
-    transposeSelectImpl(srcH, destH, shuffle);
+    transposeImpl<int32_t>(src, dest, shuffle);
     return;
   }
   case ElemKind::Int64ITy: {
-    auto srcH = src->getHandle<int64_t>();
-    auto destH = dest->getHandle<int64_t>();
-    transposeSelectImpl(srcH, destH, shuffle);
+    transposeImpl<int64_t>(src, dest, shuffle);
     return;
   }
   case ElemKind::UInt8FusedQTy: {
@@ -456,9 +508,7 @@ void glow::genericTranspose(const Tensor *src, Tensor *dest,
     llvm_unreachable("Transposing UInt4FusedFP16QTy is unsupported.");
   }
   case ElemKind::BoolTy: {
-    auto srcH = src->getHandle<bool>();
-    auto destH = dest->getHandle<bool>();
-    transposeSelectImpl(srcH, destH, shuffle);
+    transposeImpl<bool>(src, dest, shuffle);
     return;
   }
   }
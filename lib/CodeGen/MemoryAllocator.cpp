@@ -19,12 +19,20 @@
 #include "glow/Support/Memory.h"
 
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/Support/Casting.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include <algorithm>
+#include <iterator>
+#include <numeric>
+
 #define DEBUG_TYPE "memory-allocator"
 
+STATISTIC(NumBytesSavedByPlanning,
+          "Number of bytes saved by planning allocations offline");
+
 using namespace glow;
 
 namespace glow {
@@ -43,33 +51,293 @@ static_assert(std::is_unsigned<decltype(MemoryAllocator::npos)>{},
 
 const uint64_t MemoryAllocator::npos = -1;
 
+void FreeSegments::update(int n) {
+  Node &node = nodes_[n];
+  node.maxSize = node.end - node.begin;
+  if (node.left >= 0) {
+    node.maxSize = std::max(node.maxSize, nodes_[node.left].maxSize);
+  }
+  if (node.right >= 0) {
+    node.maxSize = std::max(node.maxSize, nodes_[node.right].maxSize);
+  }
+}
+
+void FreeSegments::split(int n, uint64_t begin, int &left, int &right) {
+  if (n < 0) {
+    left = right = -1;
+    return;
+  }
+  if (nodes_[n].begin < begin) {
+    split(nodes_[n].right, begin, nodes_[n].right, right);
+    left = n;
+  } else {
+    split(nodes_[n].left, begin, left, nodes_[n].left);
+    right = n;
+  }
+  update(n);
+}
+
+int FreeSegments::merge(int left, int right) {
+  if (left < 0 || right < 0) {
+    return left < 0 ? right : left;
+  }
+  if (nodes_[left].priority > nodes_[right].priority) {
+    nodes_[left].right = merge(nodes_[left].right, right);
+    update(left);
+    return left;
+  }
+  nodes_[right].left = merge(left, nodes_[right].left);
+  update(right);
+  return right;
+}
+
+void FreeSegments::clear() {
+  nodes_.clear();
+  unused_.clear();
+  root_ = -1;
+}
+
+void FreeSegments::insert(uint64_t begin, uint64_t end) {
+  assert(begin < end && "Empty free segment");
+  // Use a xorshift generator, so that the tree is balanced on average but is
+  // the same on every run.
+  seed_ ^= seed_ << 13;
+  seed_ ^= seed_ >> 17;
+  seed_ ^= seed_ << 5;
+  Node node{begin, end, end - begin, seed_, -1, -1};
+  int n;
+  if (unused_.empty()) {
+    n = nodes_.size();
+    nodes_.push_back(node);
+  } else {
+    n = unused_.back();
+    unused_.pop_back();
+    nodes_[n] = node;
+  }
+  int left, right;
+  split(root_, begin, left, right);
+  root_ = merge(merge(left, n), right);
+}
+
+void FreeSegments::erase(uint64_t begin) {
+  int left, middle, right;
+  split(root_, begin, left, middle);
+  split(middle, begin + 1, middle, right);
+  assert(middle >= 0 && nodes_[middle].left < 0 &&
+         nodes_[middle].right < 0 && "Unknown free segment");
+  unused_.push_back(middle);
+  root_ = merge(left, right);
+}
+
+bool FreeSegments::findFirstFit(uint64_t size, Segment &segment) const {
+  int n = root_;
+  if (n < 0 || nodes_[n].maxSize < size) {
+    return false;
+  }
+  // The segments of the left subtree are before the node, and the ones of
+  // the right subtree after it.
+  while (true) {
+    const Node &node = nodes_[n];
+    if (node.left >= 0 && nodes_[node.left].maxSize >= size) {
+      n = node.left;
+    } else if (node.end - node.begin >= size) {
+      segment = Segment(node.begin, node.end);
+      return true;
+    } else {
+      n = node.right;
+    }
+  }
+}
+
+bool FreeSegments::findBefore(uint64_t addr, Segment &segment) const {
+  bool found = false;
+  for (int n = root_; n >= 0;) {
+    const Node &node = nodes_[n];
+    if (node.begin < addr) {
+      segment = Segment(node.begin, node.end);
+      found = true;
+      n = node.right;
+    } else {
+      n = node.left;
+    }
+  }
+  return found;
+}
+
+bool FreeSegments::findAt(uint64_t begin, Segment &segment) const {
+  for (int n = root_; n >= 0;) {
+    const Node &node = nodes_[n];
+    if (node.begin == begin) {
+      segment = Segment(node.begin, node.end);
+      return true;
+    }
+    n = node.begin < begin ? node.right : node.left;
+  }
+  return false;
+}
+
 uint64_t MemoryAllocator::allocate(uint64_t size, Handle handle) {
   // Always allocate buffers properly aligned to hold values of any type.
   uint64_t segmentSize = alignedSize(size, TensorAlignment);
-  uint64_t prev = 0;
-  for (auto it = allocations_.begin(), e = allocations_.end(); it != e; it++) {
-    if (it->begin_ - prev >= segmentSize) {
-      allocations_.emplace(it, prev, prev + segmentSize);
-      maxMemoryAllocated_ = std::max(maxMemoryAllocated_, prev + segmentSize);
-      setHandle(prev, size, handle);
-      return prev;
+  // Look for the free segment of lowest address between the buffers that the
+  // new buffer fits in.
+  Segment gap(0, 0);
+  if (freeSegments_.findFirstFit(segmentSize, gap)) {
+    uint64_t ptr = gap.begin_;
+    freeSegments_.erase(ptr);
+    if (gap.size() > segmentSize) {
+      freeSegments_.insert(ptr + segmentSize, gap.end_);
     }
-    prev = it->end_;
+    allocations_.emplace(ptr, ptr + segmentSize);
+    maxMemoryAllocated_ = std::max(maxMemoryAllocated_, ptr + segmentSize);
+    setHandle(ptr, size, handle);
+    return ptr;
   }
-  // Could not find a place for the new buffer in the middle of the list. Push
-  // the new allocation to the end of the stack.
+  // Could not find a place for the new buffer in the middle of the buffers.
+  // Push the new allocation to the end of the stack.
+  uint64_t prev = allocations_.empty() ? 0 : allocations_.rbegin()->second;
 
   // Check that we are not allocating memory beyond the pool size.
   if (poolSize_ && (prev + segmentSize) > poolSize_) {
     return npos;
   }
 
-  allocations_.emplace_back(prev, prev + segmentSize);
+  allocations_.emplace_hint(allocations_.end(), prev, prev + segmentSize);
   maxMemoryAllocated_ = std::max(maxMemoryAllocated_, prev + segmentSize);
   setHandle(prev, size, handle);
   return prev;
 }
 
+/// \returns whether the live intervals of \p a and \p b overlap.
+static bool isLiveAtSameTime(const MemoryAllocator::Buffer &a,
+                             const MemoryAllocator::Buffer &b) {
+  return a.begin < b.end && b.begin < a.end;
+}
+
+/// \returns the allocations and deallocations of \p buffers as pairs of the
+/// time and the index of the buffer, the index of a deallocation being
+/// negated minus one. Deallocations are sorted before the allocations of the
+/// same time, so that the freed memory can be reused right away.
+static std::vector<std::pair<uint64_t, int64_t>>
+getTimeline(const std::vector<MemoryAllocator::Buffer> &buffers) {
+  std::vector<std::pair<uint64_t, int64_t>> events;
+  for (size_t i = 0, e = buffers.size(); i < e; i++) {
+    assert(buffers[i].begin < buffers[i].end && "Empty live interval");
+    events.emplace_back(buffers[i].begin, i);
+    events.emplace_back(buffers[i].end, -int64_t(i) - 1);
+  }
+  std::sort(events.begin(), events.end());
+  return events;
+}
+
+uint64_t MemoryAllocator::planFirstFit(const std::vector<Buffer> &buffers,
+                                       std::vector<uint64_t> &offsets) {
+  MemoryAllocator allocator("first-fit", 0);
+  offsets.assign(buffers.size(), 0);
+  for (const auto &event : getTimeline(buffers)) {
+    if (event.second < 0) {
+      allocator.deallocate(&buffers[-event.second - 1]);
+      continue;
+    }
+    offsets[event.second] =
+        allocator.allocate(buffers[event.second].size, &buffers[event.second]);
+  }
+  return allocator.getMaxMemoryUsage();
+}
+
+uint64_t MemoryAllocator::planBestFit(const std::vector<Buffer> &buffers,
+                                      std::vector<uint64_t> &offsets) {
+  // Place the largest buffers first, as they are the hardest to fit in gaps.
+  std::vector<size_t> order(buffers.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return buffers[a].size > buffers[b].size;
+  });
+
+  offsets.assign(buffers.size(), 0);
+  std::vector<size_t> placed;
+  uint64_t maxSize = 0;
+  for (auto idx : order) {
+    uint64_t size = alignedSize(buffers[idx].size, TensorAlignment);
+    // Collect the placed buffers live at the same time, by address.
+    std::vector<Segment> live;
+    for (auto other : placed) {
+      if (isLiveAtSameTime(buffers[idx], buffers[other])) {
+        auto otherSize = alignedSize(buffers[other].size, TensorAlignment);
+        live.emplace_back(offsets[other], offsets[other] + otherSize);
+      }
+    }
+    std::sort(live.begin(), live.end(), [](const Segment &a, const Segment &b) {
+      return a.begin_ < b.begin_;
+    });
+    // Look for the smallest gap the buffer fits in, and place it on top of
+    // the live buffers if there is none.
+    uint64_t best = npos;
+    uint64_t bestGap = npos;
+    uint64_t prev = 0;
+    for (const auto &segment : live) {
+      if (segment.begin_ >= prev + size && segment.begin_ - prev < bestGap) {
+        best = prev;
+        bestGap = segment.begin_ - prev;
+      }
+      prev = std::max(prev, segment.end_);
+    }
+    if (best == npos) {
+      best = prev;
+    }
+    offsets[idx] = best;
+    maxSize = std::max(maxSize, best + size);
+    placed.push_back(idx);
+  }
+  return maxSize;
+}
+
+uint64_t MemoryAllocator::getMaxLiveSize(const std::vector<Buffer> &buffers) {
+  uint64_t liveSize = 0;
+  uint64_t maxLiveSize = 0;
+  for (const auto &event : getTimeline(buffers)) {
+    if (event.second < 0) {
+      liveSize -=
+          alignedSize(buffers[-event.second - 1].size, TensorAlignment);
+      continue;
+    }
+    liveSize += alignedSize(buffers[event.second].size, TensorAlignment);
+    maxLiveSize = std::max(maxLiveSize, liveSize);
+  }
+  return maxLiveSize;
+}
+
+uint64_t MemoryAllocator::allocateAll(const std::vector<Buffer> &buffers,
+                                      Handle handle,
+                                      std::vector<uint64_t> &addrs) {
+  assert(!buffers.empty() && "No buffers to allocate");
+  // Keep the first-fit plan if the best-fit one is not smaller, so that
+  // planning offline never uses more memory than allocating online.
+  std::vector<uint64_t> firstFitOffsets;
+  std::vector<uint64_t> bestFitOffsets;
+  uint64_t firstFitSize = planFirstFit(buffers, firstFitOffsets);
+  uint64_t bestFitSize = planBestFit(buffers, bestFitOffsets);
+  bool useBestFit = bestFitSize < firstFitSize;
+  const auto &offsets = useBestFit ? bestFitOffsets : firstFitOffsets;
+  uint64_t size = useBestFit ? bestFitSize : firstFitSize;
+  DEBUG_GLOW(llvm::dbgs() << "Planned " << buffers.size() << " buffers of '"
+                          << name_ << "' offline in " << size
+                          << " bytes, first-fit: " << firstFitSize
+                          << " bytes, max live: " << getMaxLiveSize(buffers)
+                          << " bytes\n");
+
+  auto base = allocate(size, handle);
+  if (base == npos) {
+    return npos;
+  }
+  NumBytesSavedByPlanning += firstFitSize - size;
+  addrs.resize(buffers.size());
+  for (size_t i = 0, e = buffers.size(); i < e; i++) {
+    addrs[i] = base + offsets[i];
+  }
+  return base;
+}
+
 void MemoryAllocator::evictFirstFit(uint64_t size,
                                     const std::set<Handle> &mustNotEvict,
                                     std::vector<Handle> &evicted) {
@@ -81,24 +349,26 @@ void MemoryAllocator::evictFirstFit(uint64_t size,
   llvm::SmallVector<std::pair<Segment, Handle>, 16> evictionCandidates;
   for (auto it = allocations_.begin(), e = allocations_.end(); it != e; it++) {
     // Skip any allocations below the start address.
-    if (it->begin_ < startAddress) {
+    if (it->first < startAddress) {
       continue;
     }
-    auto curHandle = getHandle(it->begin_);
+    Segment segment(it->first, it->second);
+    auto curHandle = getHandle(segment.begin_);
     if (mustNotEvict.count(curHandle)) {
       DEBUG_GLOW(llvm::dbgs()
                  << "Cannot evict a buffer from '" << name_ << "' : "
-                 << "address: " << it->begin_ << " size: " << size << "\n");
+                 << "address: " << segment.begin_ << " size: " << size
+                 << "\n");
       // The block cannot be evicted. Start looking after it.
-      begin = it->end_;
+      begin = segment.end_;
       evictionCandidates.clear();
       hasSeenNonEvicted = true;
       continue;
     }
     // Remember current block as a candidate.
-    evictionCandidates.emplace_back(std::make_pair(*it, curHandle));
+    evictionCandidates.emplace_back(std::make_pair(segment, curHandle));
     // If the total to be evicted size is enough, no need to look any further.
-    if (it->end_ - begin >= size) {
+    if (segment.end_ - begin >= size) {
       break;
     }
   }
@@ -139,15 +409,33 @@ uint64_t MemoryAllocator::allocate(uint64_t size, Handle handle,
 
 void MemoryAllocator::deallocate(Handle handle) {
   auto ptr = getAddress(handle);
-  for (auto it = allocations_.begin(), e = allocations_.end(); it != e; it++) {
-    if (it->begin_ == ptr) {
-      allocations_.erase(it);
-      addrToHandle_.erase(ptr);
-      handleToAllocInfo_.erase(handle);
-      return;
-    }
+  auto it = allocations_.find(ptr);
+  if (it == allocations_.end()) {
+    llvm_unreachable("Unknown buffer to deallocate");
+  }
+  uint64_t begin = it->first;
+  uint64_t end = it->second;
+  bool isLast = std::next(it) == allocations_.end();
+  allocations_.erase(it);
+  addrToHandle_.erase(ptr);
+  handleToAllocInfo_.erase(handle);
+
+  // Merge the freed block with the free segments right before and after it.
+  // Only the segments below the last buffer are kept, as the allocations
+  // after the last buffer are pushed to the end of the stack.
+  Segment gap(0, 0);
+  if (freeSegments_.findBefore(begin, gap) && gap.end_ == begin) {
+    freeSegments_.erase(gap.begin_);
+    begin = gap.begin_;
+  }
+  if (isLast) {
+    return;
+  }
+  if (freeSegments_.findAt(end, gap)) {
+    freeSegments_.erase(gap.begin_);
+    end = gap.end_;
   }
-  llvm_unreachable("Unknown buffer to deallocate");
+  freeSegments_.insert(begin, end);
 }
 
 bool MemoryAllocator::hasHandle(uint64_t address) const {
@@ -16,6 +16,7 @@
 
 #include "glow/ExecutionContext/TraceEvents.h"
 #include "glow/ExecutionContext/ExecutionContext.h"
+#include "glow/ExecutionContext/TraceRecorder.h"
 
 #include "llvm/Support/raw_ostream.h"
 
@@ -129,6 +130,11 @@ void TraceContext::logTraceEvent(
     return;
   }
 
+  if (recorder_) {
+    recorder_->record(name, type, timestamp);
+    return;
+  }
+
   TraceEvent ev(name, timestamp, type, TraceEvent::getThreadId(),
                 std::move(additionalAttributes));
   {
@@ -144,6 +150,12 @@ void TraceContext::logCompleteTraceEvent(
     return;
   }
 
+  if (recorder_) {
+    recorder_->record(name, TraceEvent::CompleteType, startTimestamp,
+                      TraceEvent::now() - startTimestamp);
+    return;
+  }
+
   TraceEvent ev(name, startTimestamp, TraceEvent::now() - startTimestamp,
                 TraceEvent::getThreadId(), std::move(additionalAttributes));
   {
@@ -153,6 +165,10 @@ void TraceContext::logCompleteTraceEvent(
 }
 
 void TraceContext::setThreadName(int tid, llvm::StringRef name) {
+  if (recorder_) {
+    recorder_->setThreadName(tid, name);
+    return;
+  }
   threadNames_[tid] = name;
 }
 
@@ -162,6 +178,10 @@ void TraceContext::setThreadName(llvm::StringRef name) {
 
 void TraceContext::dump(llvm::StringRef filename,
                         const std::string &processName) {
+  if (recorder_) {
+    recorder_->dump(filename, processName);
+    return;
+  }
   TraceEvent::dumpTraceEvents(getTraceEvents(), filename,
                               std::move(processName), getThreadNames());
 }
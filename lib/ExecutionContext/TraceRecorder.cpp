@@ -0,0 +1,175 @@
+/**
+ * Copyright (c) Glow Contributors. See CONTRIBUTORS file.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "glow/ExecutionContext/TraceRecorder.h"
+
+#include <unordered_map>
+
+namespace glow {
+
+constexpr size_t TraceRecorder::kThreadBufferSize;
+constexpr size_t TraceRecorder::kMaxFlushedEvents;
+constexpr std::chrono::milliseconds TraceRecorder::kFlushInterval;
+
+static_assert((TraceRecorder::kThreadBufferSize &
+               (TraceRecorder::kThreadBufferSize - 1)) == 0,
+              "The ring buffer size must be a power of two");
+
+/// Source of the ids of the recorders.
+static std::atomic<uint64_t> nextRecorderId{0};
+
+TraceRecorder::TraceRecorder() : id_(nextRecorderId++) {
+  flushThread_ = std::thread([this]() { flushLoop(); });
+}
+
+TraceRecorder::~TraceRecorder() {
+  {
+    std::lock_guard<std::mutex> lock(stopLock_);
+    stop_ = true;
+  }
+  stopCV_.notify_all();
+  flushThread_.join();
+}
+
+TraceRecorder::ThreadBuffer &TraceRecorder::getThreadBuffer() {
+  // Most threads only ever record into the process-wide recorder, so the last
+  // recorder used is checked before the map of all of them.
+  thread_local uint64_t lastId = ~uint64_t(0);
+  thread_local ThreadBuffer *lastBuffer = nullptr;
+  if (lastId == id_) {
+    return *lastBuffer;
+  }
+  thread_local std::unordered_map<uint64_t, ThreadBuffer *> threadBuffers;
+  auto &buffer = threadBuffers[id_];
+  if (!buffer) {
+    auto newBuffer = std::make_shared<ThreadBuffer>();
+    newBuffer->tid = TraceEvent::getThreadId();
+    buffer = newBuffer.get();
+    std::lock_guard<std::mutex> lock(buffersLock_);
+    buffers_.push_back(std::move(newBuffer));
+  }
+  lastId = id_;
+  lastBuffer = buffer;
+  return *buffer;
+}
+
+uint32_t TraceRecorder::intern(llvm::StringRef name) {
+  std::lock_guard<std::mutex> lock(namesLock_);
+  auto it = nameIds_.try_emplace(name, names_.size());
+  if (it.second) {
+    names_.push_back(name.str());
+  }
+  return it.first->second;
+}
+
+void TraceRecorder::record(llvm::StringRef name, char type,
+                           uint64_t timestamp, uint64_t duration) {
+  auto &buffer = getThreadBuffer();
+  auto cached = buffer.nameCache.find(name);
+  uint32_t nameId;
+  if (cached != buffer.nameCache.end()) {
+    nameId = cached->second;
+  } else {
+    nameId = intern(name);
+    buffer.nameCache.try_emplace(name, nameId);
+  }
+
+  size_t head = buffer.head.load(std::memory_order_relaxed);
+  size_t tail = buffer.tail.load(std::memory_order_acquire);
+  if (head - tail >= kThreadBufferSize) {
+    dropped_++;
+    return;
+  }
+  buffer.records[head & (kThreadBufferSize - 1)] = {timestamp, duration,
+                                                     nameId, type};
+  buffer.head.store(head + 1, std::memory_order_release);
+}
+
+void TraceRecorder::setThreadName(int tid, llvm::StringRef name) {
+  std::lock_guard<std::mutex> lock(flushLock_);
+  threadNames_[tid] = name;
+}
+
+void TraceRecorder::drain() {
+  std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+  {
+    std::lock_guard<std::mutex> lock(buffersLock_);
+    buffers = buffers_;
+  }
+  // Names are only appended, so only the new ones are copied.
+  {
+    std::lock_guard<std::mutex> lock(namesLock_);
+    flushedNames_.insert(flushedNames_.end(),
+                         names_.begin() + flushedNames_.size(), names_.end());
+  }
+  for (auto &buffer : buffers) {
+    size_t tail = buffer->tail.load(std::memory_order_relaxed);
+    size_t head = buffer->head.load(std::memory_order_acquire);
+    for (; tail != head; tail++) {
+      if (flushed_.size() >= kMaxFlushedEvents) {
+        dropped_ += head - tail;
+        break;
+      }
+      const auto &record = buffer->records[tail & (kThreadBufferSize - 1)];
+      if (record.type == TraceEvent::CompleteType) {
+        flushed_.emplace_back(flushedNames_[record.nameId], record.timestamp,
+                              record.duration, buffer->tid);
+      } else {
+        flushed_.emplace_back(flushedNames_[record.nameId], record.timestamp,
+                              record.type, buffer->tid);
+      }
+    }
+    buffer->tail.store(head, std::memory_order_release);
+  }
+}
+
+void TraceRecorder::flush() {
+  std::lock_guard<std::mutex> lock(flushLock_);
+  drain();
+}
+
+void TraceRecorder::flushLoop() {
+  std::unique_lock<std::mutex> lock(stopLock_);
+  while (!stopCV_.wait_for(lock, kFlushInterval, [this]() { return stop_; })) {
+    flush();
+  }
+}
+
+std::vector<TraceEvent> TraceRecorder::takeTraceEvents() {
+  std::lock_guard<std::mutex> lock(flushLock_);
+  drain();
+  std::vector<TraceEvent> events;
+  std::swap(events, flushed_);
+  return events;
+}
+
+void TraceRecorder::dump(llvm::StringRef filename,
+                         const std::string &processName) {
+  auto events = takeTraceEvents();
+  std::map<int, std::string> threadNames;
+  {
+    std::lock_guard<std::mutex> lock(flushLock_);
+    threadNames = threadNames_;
+  }
+  TraceEvent::dumpTraceEvents(events, filename, processName, threadNames);
+}
+
+TraceRecorder *getTraceRecorder() {
+  static auto *recorder = new TraceRecorder();
+  return recorder;
+}
+
+} // namespace glow
@@ -0,0 +1,229 @@
+/**
+ * Copyright (c) Glow Contributors. See CONTRIBUTORS file.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "glow/ExecutionEngine/DataParallelTrainer.h"
+#include "glow/Graph/Nodes.h"
+
+#include "llvm/ADT/STLExtras.h"
+
+#include <future>
+
+using namespace glow;
+
+void glow::ringAllReduce(llvm::ArrayRef<Tensor *> buffers, ThreadPool &pool) {
+  const size_t n = buffers.size();
+  if (n < 2) {
+    return;
+  }
+  const size_t size = buffers[0]->size();
+  std::vector<float *> data;
+  for (auto *T : buffers) {
+    DCHECK(T->getElementType() == ElemKind::FloatTy &&
+           T->getType().isEqual(buffers[0]->getType()))
+        << "The buffers must be float tensors of the same type";
+    data.push_back(reinterpret_cast<float *>(T->getUnsafePtr()));
+  }
+  auto chunkBegin = [&](size_t chunk) { return chunk * size / n; };
+
+  // Runs the step \p step of every buffer in parallel. At every step every
+  // buffer sends a different chunk, and receives another one, so the steps of
+  // the buffers don't race.
+  auto runStep = [&](size_t step, bool reduce) {
+    std::vector<std::future<void>> futures;
+    for (size_t i = 0; i < n; i++) {
+      futures.push_back(pool.submit([&, i, step, reduce]() {
+        // The reduce-scatter sends chunk i - s, the all-gather sends the
+        // chunk i + 1 - s, which buffer i summed last.
+        size_t chunk = (i + n - step + (reduce ? 0 : 1)) % n;
+        const float *src = data[i];
+        float *dest = data[(i + 1) % n];
+        for (size_t k = chunkBegin(chunk), e = chunkBegin(chunk + 1); k < e;
+             k++) {
+          dest[k] = reduce ? dest[k] + src[k] : src[k];
+        }
+      }));
+    }
+    for (auto &future : futures) {
+      future.wait();
+    }
+  };
+
+  // After the reduce-scatter, buffer i holds the sum of chunk i + 1.
+  for (size_t step = 0; step + 1 < n; step++) {
+    runStep(step, /* reduce */ true);
+  }
+  for (size_t step = 0; step + 1 < n; step++) {
+    runStep(step, /* reduce */ false);
+  }
+}
+
+DataParallelTrainer::DataParallelTrainer(llvm::StringRef backend,
+                                         unsigned numReplicas,
+                                         uint64_t deviceMemory)
+    : module_(new Module), rawModule_(module_.get()),
+      numReplicas_(numReplicas) {
+  CHECK_GT(numReplicas_, 0) << "Expected at least one replica";
+  std::vector<std::unique_ptr<runtime::DeviceConfig>> configs;
+  for (unsigned i = 0; i < numReplicas_; i++) {
+    auto config = llvm::make_unique<runtime::DeviceConfig>(backend);
+    if (deviceMemory) {
+      config->setDeviceMemory(deviceMemory);
+    }
+    configs.push_back(std::move(config));
+  }
+  hostManager_ = llvm::make_unique<runtime::HostManager>(std::move(configs));
+  pool_ = llvm::make_unique<ThreadPool>(numReplicas_);
+}
+
+DataParallelTrainer::~DataParallelTrainer() {
+  contexts_.clear();
+  if (hostManager_) {
+    EXIT_ON_ERR(hostManager_->clearHost());
+  }
+}
+
+Error DataParallelTrainer::compile(Function *F, const TrainingConfig &config,
+                                   CompilationContext &cctx) {
+  RETURN_ERR_IF_NOT(module_, "The trainer was already compiled");
+  RETURN_ERR_IF_NOT(F->getParent() == rawModule_,
+                    "The Function must be in the Module of the trainer");
+
+  // Compute the gradients without updating the weights.
+  VariableGradientsList varGrads;
+  Function *GF =
+      differentiate(F, config, F->getName().str() + ".grad", &varGrads);
+  gradName_ = GF->getName();
+
+  // The summed gradients of all the replicas are divided by the size of the
+  // whole minibatch.
+  Function *UF = rawModule_->createFunction(F->getName().str() + ".update");
+  updateName_ = UF->getName();
+  for (auto &varGrad : varGrads) {
+    Placeholder *W = varGrad.first;
+    Placeholder *G = varGrad.second;
+    if (!W->isTraining()) {
+      continue;
+    }
+    auto *SGD = UF->addNode(new SGDNode(W->getName(), G, W, config.L1Decay,
+                                        config.L2Decay, config.learningRate,
+                                        config.momentum,
+                                        config.batchSize * numReplicas_));
+    UF->createSave(W->getName().str() + ".saveGrad", SGD, W);
+    weights_.push_back({W, G});
+  }
+  RETURN_ERR_IF_NOT(!weights_.empty(), "The Function has no trainable weights");
+
+  // The forward Function isn't run by the trainer.
+  rawModule_->eraseFunction(F);
+
+  cctx.compMode = CompilationMode::Train;
+  RETURN_IF_ERR(hostManager_->addNetwork(std::move(module_), cctx,
+                                         /* saturateHost */ true));
+
+  // Lowering may add Placeholders, e.g. for the momentum, so the contexts are
+  // only allocated now.
+  for (unsigned i = 0; i < numReplicas_; i++) {
+    auto context = llvm::make_unique<ExecutionContext>();
+    auto *bindings = context->getPlaceholderBindings();
+    bindings->allocate(rawModule_->getPlaceholders());
+    for (auto &pair : bindings->pairs()) {
+      pair.second->zero();
+    }
+    contexts_.push_back(std::move(context));
+  }
+  return Error::success();
+}
+
+void DataParallelTrainer::loadBindings(const PlaceholderBindings &bindings) {
+  for (auto &context : contexts_) {
+    auto *replicaBindings = context->getPlaceholderBindings();
+    for (auto &pair : bindings.pairs()) {
+      if (Tensor *T = replicaBindings->get(pair.first)) {
+        T->assign(pair.second);
+      }
+    }
+  }
+}
+
+void DataParallelTrainer::storeBindings(PlaceholderBindings &bindings) const {
+  DCHECK(!contexts_.empty()) << "The trainer wasn't compiled";
+  auto *replicaBindings = contexts_[0]->getPlaceholderBindings();
+  for (auto &pair : bindings.pairs()) {
+    if (Tensor *T = replicaBindings->get(pair.first)) {
+      pair.second->assign(T);
+    }
+  }
+}
+
+Error DataParallelTrainer::runReplicas(llvm::StringRef name) {
+  std::vector<std::promise<void>> promises(numReplicas_);
+  OneErrOnly runErr;
+  for (unsigned i = 0; i < numReplicas_; i++) {
+    hostManager_->runNetwork(
+        name, std::move(contexts_[i]),
+        [this, i, &promises, &runErr](
+            runtime::RunIdentifierTy, Error err,
+            std::unique_ptr<ExecutionContext> context) {
+          contexts_[i] = std::move(context);
+          runErr.set(std::move(err));
+          promises[i].set_value();
+        });
+  }
+  for (auto &promise : promises) {
+    promise.get_future().wait();
+  }
+  return runErr.get();
+}
+
+Error DataParallelTrainer::train(size_t iterations, size_t &sampleCounter,
+                                 llvm::ArrayRef<Placeholder *> ph,
+                                 llvm::ArrayRef<Tensor *> inputs) {
+  RETURN_ERR_IF_NOT(!contexts_.empty(), "The trainer wasn't compiled");
+  RETURN_ERR_IF_NOT(!ph.empty() && ph.size() == inputs.size(),
+                    "Expected an input for every Placeholder");
+  // This is the size of the shard of every replica.
+  size_t shardSize = ph[0]->getType()->dims()[0];
+
+  for (size_t j = 0; j < iterations; j++) {
+    for (unsigned r = 0; r < numReplicas_; r++) {
+      auto *bindings = contexts_[r]->getPlaceholderBindings();
+      for (size_t i = 0, e = ph.size(); i < e; i++) {
+        Tensor *backingTensor = bindings->get(ph[i]);
+        RETURN_ERR_IF_NOT(backingTensor, "Unknown input Placeholder");
+        auto dim = inputs[i]->dims();
+        RETURN_ERR_IF_NOT(backingTensor->dims().drop_front() ==
+                              dim.drop_front(),
+                          "Invalid slice size");
+        size_t slc = (sampleCounter + r * shardSize) % dim[0];
+        backingTensor->copyConsecutiveSlices(inputs[i], slc);
+      }
+    }
+
+    RETURN_IF_ERR(runReplicas(gradName_));
+
+    for (auto &weight : weights_) {
+      std::vector<Tensor *> grads;
+      for (auto &context : contexts_) {
+        grads.push_back(context->getPlaceholderBindings()->get(weight.second));
+      }
+      ringAllReduce(grads, *pool_);
+    }
+
+    RETURN_IF_ERR(runReplicas(updateName_));
+    sampleCounter += numReplicas_ * shardSize;
+  }
+  return Error::success();
+}
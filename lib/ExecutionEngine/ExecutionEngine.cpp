@@ -23,14 +23,20 @@
 
 #include "llvm/ADT/STLExtras.h"
 
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
 #include <future>
+#include <mutex>
 
 using namespace glow;
 
 ExecutionEngine::ExecutionEngine(llvm::StringRef backend, uint64_t deviceMemory,
-                                 bool ignoreUserDeviceConfig)
+                                 bool ignoreUserDeviceConfig,
+                                 unsigned numDevices)
     : deviceMemory_(deviceMemory),
-      ignoreUserDeviceConfig_(ignoreUserDeviceConfig) {
+      ignoreUserDeviceConfig_(ignoreUserDeviceConfig),
+      numDevices_(std::max(numDevices, 1u)) {
   setBackendName(backend);
 }
 
@@ -49,18 +55,22 @@ void ExecutionEngine::setBackendName(llvm::StringRef backend) {
   std::vector<std::unique_ptr<runtime::DeviceConfig>> configs;
   if (!ignoreUserDeviceConfig_ &&
       loadDeviceConfigsFromFile(configs, deviceMemory_)) {
-    // Loaded from file, so verify that there is just a single device configured
-    // and that it matches the expected backend name.
-    CHECK_EQ(configs.size(), 1)
-        << "Expected a single device for the ExecutionEngine";
-    CHECK(backend.str() == configs[0]->backendName)
-        << "Expected backend name to match the ExecutionEngine";
+    // Loaded from file, so verify that there are as many devices configured
+    // as expected and that they match the expected backend name.
+    CHECK_EQ(configs.size(), numDevices_)
+        << "Expected " << numDevices_ << " devices for the ExecutionEngine";
+    for (const auto &config : configs) {
+      CHECK(backend.str() == config->backendName)
+          << "Expected backend name to match the ExecutionEngine";
+    }
   } else {
-    auto config = llvm::make_unique<runtime::DeviceConfig>(backend);
-    if (deviceMemory_) {
-      config->setDeviceMemory(deviceMemory_);
+    for (unsigned i = 0; i < numDevices_; i++) {
+      auto config = llvm::make_unique<runtime::DeviceConfig>(backend);
+      if (deviceMemory_) {
+        config->setDeviceMemory(deviceMemory_);
+      }
+      configs.push_back(std::move(config));
     }
-    configs.push_back(std::move(config));
   }
   hostManager_ = llvm::make_unique<runtime::HostManager>(std::move(configs));
 }
@@ -159,6 +169,17 @@ void ExecutionEngine::run(PlaceholderBindings &bindings, llvm::StringRef name) {
   context.movePlaceholderBindings().release();
 }
 
+void ExecutionEngine::runAsync(std::unique_ptr<ExecutionContext> context,
+                               llvm::StringRef name,
+                               runtime::ResultCBTy callback) {
+  if (name.empty()) {
+    assert(compiledFunctions_.size() == 1 &&
+           "Expected exactly one compiled function.");
+    name = *compiledFunctions_.begin();
+  }
+  hostManager_->runNetwork(name, std::move(context), std::move(callback));
+}
+
 void glow::runBatch(ExecutionEngine &EE, PlaceholderBindings &bindings,
                     size_t iterations, size_t &sampleCounter,
                     llvm::ArrayRef<Placeholder *> ph,
@@ -199,6 +220,92 @@ void glow::runBatch(ExecutionEngine &EE, PlaceholderBindings &bindings,
   }
 }
 
+void glow::runBatchParallel(ExecutionEngine &EE, PlaceholderBindings &bindings,
+                            size_t iterations, size_t &sampleCounter,
+                            llvm::ArrayRef<Placeholder *> ph,
+                            llvm::ArrayRef<Tensor *> inputs,
+                            llvm::ArrayRef<Placeholder *> outputs,
+                            llvm::ArrayRef<Tensor *> results,
+                            unsigned runsPerDevice, llvm::StringRef name) {
+  // This is the size of one batch (the number of samples in the batch).
+  size_t batchSize = ph[0]->getType()->dims()[0];
+
+  assert(!inputs.empty() && "No inputs");
+  assert(inputs.size() == ph.size() &&
+         "The number of inputs does not match the number of placeholders");
+  assert(outputs.size() == results.size() &&
+         "The number of results does not match the number of outputs");
+
+  // The results hold the batches of all the iterations back to back.
+  std::vector<size_t> batchBytes;
+  for (size_t i = 0, e = outputs.size(); i < e; i++) {
+    TypeRef ty = outputs[i]->getType();
+    std::vector<size_t> dims(ty->dims().begin(), ty->dims().end());
+    dims[0] *= iterations;
+    results[i]->reset(Type::newShape(*ty, dims));
+    batchBytes.push_back(ty->getSizeInBytes());
+  }
+
+  // The contexts of the runs that aren't in flight.
+  std::vector<std::unique_ptr<ExecutionContext>> idle;
+  for (unsigned i = 0, e = EE.getNumDevices() * std::max(runsPerDevice, 1u);
+       i < e; i++) {
+    idle.push_back(llvm::make_unique<ExecutionContext>(
+        llvm::make_unique<PlaceholderBindings>(bindings.clone())));
+  }
+  std::mutex mutex;
+  std::condition_variable idleCV;
+  size_t numIdle = idle.size();
+  OneErrOnly runErr;
+
+  for (size_t j = 0; j < iterations; j++) {
+    std::unique_ptr<ExecutionContext> context;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      idleCV.wait(lock, [&idle]() { return !idle.empty(); });
+      context = std::move(idle.back());
+      idle.pop_back();
+    }
+
+    // Update the input placeholders of the context.
+    auto *runBindings = context->getPlaceholderBindings();
+    for (int i = 0, e = ph.size(); i < e; i++) {
+      auto *backingTensor = runBindings->get(ph[i]);
+      assert(backingTensor && "Can't find the backing tensor");
+      auto dim = inputs[i]->dims();
+      assert(backingTensor->dims().drop_front() == dim.drop_front() &&
+             "Invalid slice size");
+      backingTensor->copyConsecutiveSlices(inputs[i], sampleCounter % dim[0]);
+    }
+
+    EE.runAsync(std::move(context), name,
+                [&, j](runtime::RunIdentifierTy, Error err,
+                       std::unique_ptr<ExecutionContext> context) {
+                  if (err) {
+                    runErr.set(std::move(err));
+                  } else {
+                    // Distinct runs write distinct batches of the results.
+                    auto *runBindings = context->getPlaceholderBindings();
+                    for (size_t i = 0, e = outputs.size(); i < e; i++) {
+                      std::memcpy(results[i]->getUnsafePtr() +
+                                      j * batchBytes[i],
+                                  runBindings->get(outputs[i])->getUnsafePtr(),
+                                  batchBytes[i]);
+                    }
+                  }
+                  std::lock_guard<std::mutex> lock(mutex);
+                  idle.push_back(std::move(context));
+                  idleCV.notify_one();
+                });
+    sampleCounter += batchSize;
+  }
+
+  // Wait for the runs in flight.
+  std::unique_lock<std::mutex> lock(mutex);
+  idleCV.wait(lock, [&]() { return idle.size() == numIdle; });
+  EXIT_ON_ERR(runErr.get());
+}
+
 void ExecutionEngine::compile(CompilationMode mode) {
   CompilationContext cctx;
   cctx.compMode = mode;
@@ -212,5 +319,6 @@ void ExecutionEngine::compile(CompilationContext &cctx) {
     compiledFunctions_.insert(function->getName());
   }
 
-  EXIT_ON_ERR(hostManager_->addNetwork(std::move(module_), cctx));
+  EXIT_ON_ERR(hostManager_->addNetwork(std::move(module_), cctx,
+                                       /* saturateHost */ numDevices_ > 1));
 }
@@ -16,6 +16,9 @@
 
 #include "glow/Exporter/ONNXModelWriter.h"
 #include "glow/Graph/Utils.h"
+#include "glow/Support/Memory.h"
+
+#include "llvm/Support/Path.h"
 
 namespace glow {
 
@@ -437,11 +440,16 @@ public:
   llvm::ArrayRef<const Node *> getNodes() const { return reverseOrder_; }
 };
 
+/// Payloads smaller than this many bytes stay in the model when the
+/// payloads are written to external data, like the ONNX tools do.
+constexpr uint64_t kMinExternalDataSize = 1024;
+
 } // namespace
 
 ONNXModelWriter::ONNXModelWriter(const std::string &modelFilename, Function &F,
                                  size_t irVersion, size_t opsetVersion,
-                                 Error *errPtr, bool textMode)
+                                 Error *errPtr, bool textMode,
+                                 bool externalData)
     : CommonOperatorWriter(modelFilename, F, errPtr),
       opsetVersion_(opsetVersion) {
   // If errPtr already contains an error then don't continue with constructor.
@@ -452,6 +460,16 @@ ONNXModelWriter::ONNXModelWriter(const std::string &modelFilename, Function &F,
   // Lambda to setup the ONNXModelWriter and return any Errors that were
   // raised.
   auto setup = [&]() -> Error {
+    if (externalData) {
+      const std::string dataFilename = modelFilename + ".data";
+      externalDataLocation_ = llvm::sys::path::filename(dataFilename).str();
+      externalDataFile_.open(dataFilename, std::ios::out | std::ios::trunc |
+                                               std::ios::binary);
+      RETURN_ERR_IF_NOT(externalDataFile_,
+                        "Can't open the external data file " + dataFilename,
+                        ErrorValue::ErrorCode::MODEL_WRITER_INVALID_FILENAME);
+    }
+
     // Loop through all nodes, output Graph to Model protobuf.
     ONNX_NAMESPACE::ModelProto modelProto;
     modelProto.set_ir_version(irVersion);
@@ -489,7 +507,12 @@ ONNXModelWriter::ONNXModelWriter(const std::string &modelFilename, Function &F,
         const auto *C = llvm::cast<Constant>(N);
         auto *tensorProto = graphProto->add_initializer();
         tensorProto->set_name(C->getName());
-        writeTensor(C->getPayload(), tensorProto);
+        if (externalDataFile_.is_open() &&
+            C->getPayload().getSizeInBytes() >= kMinExternalDataSize) {
+          RETURN_IF_ERR(writeExternalTensor(C, tensorProto));
+        } else {
+          writeTensor(C->getPayload(), tensorProto);
+        }
       } else if (kind == Kinded::Kind::SaveNodeKind) {
         // Save node case, find input and use its name as a global output,
         // output only shape.
@@ -510,6 +533,12 @@ ONNXModelWriter::ONNXModelWriter(const std::string &modelFilename, Function &F,
       nodes->SwapElements(i, n - i - 1);
     }
 
+    if (externalDataFile_.is_open()) {
+      externalDataFile_.close();
+      RETURN_ERR_IF_NOT(
+          externalDataFile_, "Can't write the external data file",
+          ErrorValue::ErrorCode::MODEL_WRITER_SERIALIZATION_ERROR);
+    }
     return writeModel(modelProto, textMode);
   };
 
@@ -558,6 +587,39 @@ void ONNXModelWriter::writeTensor(const Tensor &T, TensorType *out) {
   out->set_raw_data(T.getUnsafePtr(), type.getSizeInBytes());
 }
 
+Error ONNXModelWriter::writeExternalTensor(const Constant *C,
+                                          TensorType *out) {
+  const Tensor &T = C->getPayload();
+  const auto &type = T.getType();
+  out->set_data_type(convertType(type));
+  for (auto dim : type.dims()) {
+    out->add_dims(dim);
+  }
+
+  // Align the payloads, so that the loader can use them in place in the
+  // memory mapped file.
+  uint64_t offset = alignedSize(externalDataSize_, TensorAlignment);
+  static const char padding[TensorAlignment] = {};
+  externalDataFile_.write(padding, offset - externalDataSize_);
+  externalDataFile_.write(T.getUnsafePtr(), type.getSizeInBytes());
+  RETURN_ERR_IF_NOT(externalDataFile_,
+                    "Can't write the payload of " + C->getName().str() +
+                        " to the external data file",
+                    ErrorValue::ErrorCode::MODEL_WRITER_SERIALIZATION_ERROR);
+  externalDataSize_ = offset + type.getSizeInBytes();
+
+  out->set_data_location(TensorType::EXTERNAL);
+  auto addEntry = [out](const std::string &key, const std::string &value) {
+    auto *entry = out->add_external_data();
+    entry->set_key(key);
+    entry->set_value(value);
+  };
+  addEntry("location", externalDataLocation_);
+  addEntry("offset", std::to_string(offset));
+  addEntry("length", std::to_string(type.getSizeInBytes()));
+  return Error::success();
+}
+
 void ONNXModelWriter::tensorShapeFromPlaceholder(const Placeholder *PH,
                                                  ValueInfoType *valueProto) {
   tensorShapeFromInput(PH->getName(), PH->getType(), valueProto);
@@ -775,6 +837,18 @@ Error ONNXModelWriter::writeBatchNormalization(
   return Error::success();
 }
 
+Error ONNXModelWriter::writeLayerNormalization(
+    const LayerNormalizationNode *node, GraphType &graph) {
+  auto *proto = graph.add_node();
+  // Add dictionary entries. The normalized dimensions start at axis.
+  addValueAttribute(proto, "axis",
+                    node->getInput().dims().size() -
+                        node->getScale().dims().size());
+  addValueAttribute(proto, "epsilon", node->getEpsilon());
+
+  return writeAllWithNode("LayerNormalization", node, proto);
+}
+
 Error ONNXModelWriter::writeMeanVarNormalization(
     const MeanVarNormalizationNode *node, GraphType &graph) {
   auto *proto = graph.add_node();
@@ -994,6 +1068,16 @@ Error ONNXModelWriter::writeResizeNearest(const ResizeNearestNode *node,
   return writeAllWithNode(node->getName(), node, proto);
 }
 
+Error ONNXModelWriter::writeResizeBilinear(const ResizeBilinearNode *node,
+                                           GraphType &graph) {
+  auto *proto = graph.add_node();
+  // Find dictionary entries.
+  addValueAttribute(proto, "height_scale", node->getHeightScale());
+  addValueAttribute(proto, "width_scale", node->getWidthScale());
+
+  return writeAllWithNode("ResizeBilinear", node, proto);
+}
+
 Error ONNXModelWriter::writeSoftMax(const SoftMaxNode *node, GraphType &graph) {
   auto *proto = graph.add_node();
   proto->set_name(node->getName());
@@ -1314,6 +1398,8 @@ DEF_ALL_WRITER_NODE(BatchOneHot)
 DEF_ALL_WRITER_NODE(LengthsToRanges)
 DEF_ALL_WRITER_NODE(SparseLengthsSum)
 DEF_ALL_WRITER_NODE(SparseLengthsWeightedSum)
+DEF_ALL_WRITER_NODE(SparseLengthsMean)
+DEF_ALL_WRITER_NODE(SparseLengthsMax)
 
 // Glow nodes with default exporting algorithm.
 DEF_ALL_WRITER_NODE(CmpEQ)
@@ -1322,10 +1408,15 @@ DEF_ALL_WRITER_NODE(CmpLT)
 DEF_ALL_WRITER_NODE(BatchedAdd)
 DEF_ALL_WRITER_NODE(Dequantize)
 DEF_ALL_WRITER_NODE(Regression)
+DEF_ALL_WRITER_NODE(BatchedPairwiseDotProduct)
 DEF_ALL_WRITER_NODE(RowwiseQuantizedFullyConnected)
+DEF_ALL_WRITER_NODE(DynamicQuantizedFullyConnected)
 DEF_ALL_WRITER_NODE(RowwiseQuantizedSparseLengthsWeightedSum)
 DEF_ALL_WRITER_NODE(FusedRowwiseQuantizedSparseLengthsSum)
 DEF_ALL_WRITER_NODE(FusedRowwiseQuantizedSparseLengthsWeightedSum)
+DEF_ALL_WRITER_NODE(FusedRowwiseQuantizedSparseLengthsMean)
+DEF_ALL_WRITER_NODE(FusedRowwiseQuantizedSparseLengthsMax)
+DEF_ALL_WRITER_NODE(LSTMUnit)
 
 Error ONNXModelWriter::writeClip(const ClipNode *node, GraphType &graph) {
   auto *proto = graph.add_node();
@@ -1525,6 +1616,9 @@ DEF_UNSUPPORTED_NODE(SparseLengthsWeightedSumGrad)
 DEF_UNSUPPORTED_NODE(SigmoidCrossEntropyWithLogits)
 DEF_UNSUPPORTED_NODE(LocalResponseNormalizationGrad)
 DEF_UNSUPPORTED_NODE(AdaptiveAvgPoolGrad)
+DEF_UNSUPPORTED_NODE(LSTMUnitGrad)
+DEF_UNSUPPORTED_NODE(RecomputeBarrier)
+DEF_UNSUPPORTED_NODE(GroupedFusedRowwiseQuantizedSparseLengthsWeightedSum)
 
 #ifdef GLOW_WITH_CPU
 
@@ -1549,6 +1643,109 @@ Error ONNXModelWriter::writeCPUConvDKKC8(const CPUConvDKKC8Node *node,
   return writeAllWithNode("CPUConvDKKC8", node, proto);
 }
 
+Error ONNXModelWriter::writeCPUConvIm2Col(const CPUConvIm2ColNode *node,
+                                          GraphType &graph) {
+  auto *proto = graph.add_node();
+  // Add dictionary entries.
+  addValueAttribute(proto, "kernel_shape", node->getKernels());
+  addValueAttribute(proto, "strides", node->getStrides());
+  addValueAttribute(proto, "pads", node->getPads());
+
+  return writeAllWithNode("CPUConvIm2Col", node, proto);
+}
+
+Error ONNXModelWriter::writeCPUConvWinograd(const CPUConvWinogradNode *node,
+                                            GraphType &graph) {
+  auto *proto = graph.add_node();
+  // Add dictionary entries.
+  addValueAttribute(proto, "pads", node->getPads());
+
+  return writeAllWithNode("CPUConvWinograd", node, proto);
+}
+
+Error ONNXModelWriter::writeCPUConvFused(const CPUConvFusedNode *node,
+                                         GraphType &graph) {
+  auto *proto = graph.add_node();
+  // Add dictionary entries.
+  addValueAttribute(proto, "kernel_shape", node->getKernels());
+  addValueAttribute(proto, "strides", node->getStrides());
+  addValueAttribute(proto, "pads", node->getPads());
+  addValueAttribute(proto, "min", node->getMin());
+  addValueAttribute(proto, "max", node->getMax());
+
+  return writeAllWithNode("CPUConvFused", node, proto);
+}
+
+Error ONNXModelWriter::writeCPUConvFusedAdd(const CPUConvFusedAddNode *node,
+                                            GraphType &graph) {
+  auto *proto = graph.add_node();
+  // Add dictionary entries.
+  addValueAttribute(proto, "kernel_shape", node->getKernels());
+  addValueAttribute(proto, "strides", node->getStrides());
+  addValueAttribute(proto, "pads", node->getPads());
+  addValueAttribute(proto, "min", node->getMin());
+  addValueAttribute(proto, "max", node->getMax());
+
+  return writeAllWithNode("CPUConvFusedAdd", node, proto);
+}
+
+Error ONNXModelWriter::writeCPUConvDepthwise(const CPUConvDepthwiseNode *node,
+                                             GraphType &graph) {
+  auto *proto = graph.add_node();
+  // Add dictionary entries.
+  addValueAttribute(proto, "kernel_shape", node->getKernels());
+  addValueAttribute(proto, "strides", node->getStrides());
+  addValueAttribute(proto, "pads", node->getPads());
+  addValueAttribute(proto, "min", node->getMin());
+  addValueAttribute(proto, "max", node->getMax());
+
+  return writeAllWithNode("CPUConvDepthwise", node, proto);
+}
+
+Error ONNXModelWriter::writeCPUConvDepthwisePointwise(
+    const CPUConvDepthwisePointwiseNode *node, GraphType &graph) {
+  auto *proto = graph.add_node();
+  // Add dictionary entries.
+  addValueAttribute(proto, "kernel_shape", node->getKernels());
+  addValueAttribute(proto, "strides", node->getStrides());
+  addValueAttribute(proto, "pads", node->getPads());
+  addValueAttribute(proto, "depthwise_min", node->getDepthwiseMin());
+  addValueAttribute(proto, "depthwise_max", node->getDepthwiseMax());
+  addValueAttribute(proto, "min", node->getMin());
+  addValueAttribute(proto, "max", node->getMax());
+
+  return writeAllWithNode("CPUConvDepthwisePointwise", node, proto);
+}
+
+Error ONNXModelWriter::writeCPUMatMulPacked(const CPUMatMulPackedNode *node,
+                                            GraphType &graph) {
+  auto *proto = graph.add_node();
+  return writeAllWithNode("CPUMatMulPacked", node, proto);
+}
+
+Error ONNXModelWriter::writeCPUBatchMatMul(const CPUBatchMatMulNode *node,
+                                           GraphType &graph) {
+  auto *proto = graph.add_node();
+  return writeAllWithNode("CPUBatchMatMul", node, proto);
+}
+
+Error ONNXModelWriter::writeCPULSTMUnit(const CPULSTMUnitNode *node,
+                                        GraphType &graph) {
+  auto *proto = graph.add_node();
+  return writeAllWithNode("CPULSTMUnit", node, proto);
+}
+
+Error ONNXModelWriter::writeCPUBlockSparseMatMul(
+    const CPUBlockSparseMatMulNode *node, GraphType &graph) {
+  auto *proto = graph.add_node();
+  return writeAllWithNode("CPUBlockSparseMatMul", node, proto);
+}
+
+// The training updates are not exported, like SGD.
+DEF_UNSUPPORTED_NODE(CPUSGD)
+DEF_UNSUPPORTED_NODE(CPUSGDMomentum)
+DEF_UNSUPPORTED_NODE(CPUSparseSGD)
+
 #endif // GLOW_WITH_CPU
 
 #ifdef GLOW_WITH_OPENCL
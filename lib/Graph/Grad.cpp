@@ -25,6 +25,10 @@
 #include "llvm/Support/Casting.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include <algorithm>
+#include <cmath>
+#include <unordered_set>
+
 using namespace glow;
 
 using llvm::cast;
@@ -51,6 +55,152 @@ NodeValue GraphGradMapper::getGradient(NodeValue activation) {
 //        Code for automatically generating the back propagation code.
 //===----------------------------------------------------------------------===//
 
+/// \returns the bytes of the results of \p N.
+static uint64_t getResultsSize(const Node *N) {
+  uint64_t size = 0;
+  for (unsigned i = 0, e = N->getNumResults(); i < e; i++) {
+    size += N->getType(i)->getSizeInBytes();
+  }
+  return size;
+}
+
+/// \returns whether the forward node \p N can be computed again from its
+/// inputs in the backward pass.
+static bool isRecomputable(const Node *N) {
+  return !isa<Storage>(N) && !N->hasSideEffects() && N->getNumInputs() > 0;
+}
+
+/// \returns the nodes of \p forward, in topological order, whose activations
+/// are recomputed in the backward pass so that the kept activations take about
+/// \p budget bytes. The recomputed nodes form segments between checkpoints.
+/// With T the bytes of the recomputable activations and a their average size,
+/// segments of S bytes keep T / S * a bytes of checkpoints, plus the S bytes
+/// of the segment being recomputed. S is the largest size which fits in the
+/// budget, or sqrt(T * a), which needs the least memory, if none fits.
+static std::unordered_set<const Node *>
+selectRecomputedNodes(llvm::ArrayRef<Node *> forward, uint64_t budget) {
+  double total = 0;
+  double kept = 0;
+  size_t numRecomputable = 0;
+  for (auto *N : forward) {
+    if (isRecomputable(N)) {
+      total += getResultsSize(N);
+      numRecomputable++;
+    } else {
+      kept += getResultsSize(N);
+    }
+  }
+  std::unordered_set<const Node *> recomputed;
+  if (!numRecomputable || total + kept <= budget) {
+    return recomputed;
+  }
+
+  double average = total / numRecomputable;
+  double left = std::max(double(budget) - kept, 0.0);
+  double disc = left * left - 4 * total * average;
+  double segmentSize = disc >= 0 ? (left + std::sqrt(disc)) / 2
+                                 : std::sqrt(total * average);
+
+  double segment = 0;
+  for (auto *N : forward) {
+    if (!isRecomputable(N)) {
+      continue;
+    }
+    double size = getResultsSize(N);
+    if (segment > 0 && segment + size > segmentSize) {
+      // N is the checkpoint which starts the next segment.
+      segment = 0;
+      continue;
+    }
+    segment += size;
+    recomputed.insert(N);
+  }
+  return recomputed;
+}
+
+/// \returns the recomputation in \p G of the forward value \p V. The nodes of
+/// \p recomputed which \p V depends on are cloned once, in \p clones. The
+/// other inputs of the clones, but the Constants, are read through a barrier,
+/// in \p barriers, which waits for \p after, or for nothing if null.
+static NodeValue
+recompute(Function *G, NodeValue V, NodeValue after,
+          const std::unordered_set<const Node *> &recomputed,
+          std::unordered_map<const Node *, Node *> &clones,
+          std::unordered_map<NodeValue, NodeValue> &barriers) {
+  Node *N = V.getNode();
+  if (isa<Constant>(N)) {
+    return V;
+  }
+  if (!recomputed.count(N)) {
+    auto it = barriers.find(V);
+    if (it != barriers.end()) {
+      return it->second;
+    }
+    auto *RB = G->addNode(new RecomputeBarrierNode(
+        N->getName().str() + ".barrier", V, after.getNode() ? after : V));
+    barriers[V] = RB->getResult();
+    return RB->getResult();
+  }
+
+  auto it = clones.find(N);
+  if (it != clones.end()) {
+    return it->second->getNthResult(V.getResNo());
+  }
+  Node *C = N->clone();
+  C->setName(N->getName().str() + ".recompute");
+  for (unsigned i = 0, e = N->getNumInputs(); i < e; i++) {
+    NodeValue in = N->getNthInput(i);
+    C->setNthInput(i, recompute(G, in, after, recomputed, clones, barriers));
+  }
+  G->addNode(C);
+  clones[N] = C;
+  return C->getNthResult(V.getResNo());
+}
+
+/// Makes the backward nodes of \p G, the ones which are not in \p forward,
+/// recompute the activations of the forward nodes selected within \p budget
+/// bytes instead of reading them, so that these activations die once the
+/// forward pass is done with them.
+static void recomputeActivations(Function *G, llvm::ArrayRef<Node *> forward,
+                                 uint64_t budget) {
+  auto recomputed = selectRecomputedNodes(forward, budget);
+  if (recomputed.empty()) {
+    return;
+  }
+  std::unordered_set<const Node *> forwardSet(forward.begin(), forward.end());
+  std::unordered_map<const Node *, Node *> clones;
+  std::unordered_map<NodeValue, NodeValue> barriers;
+
+  // Visit the backward nodes in topological order, so that the barriers of a
+  // segment wait for the first node which needs the segment.
+  PostOrderVisitor pov;
+  for (auto &N : G->getNodes()) {
+    N.visit(nullptr, &pov);
+  }
+  for (auto *N : pov.getPostOrder()) {
+    if (isa<Storage>(N) || forwardSet.count(N)) {
+      continue;
+    }
+    // The first input computed in the backward pass is usually the gradient
+    // of the output of N, the recomputation waits for it.
+    NodeValue after;
+    for (unsigned i = 0, e = N->getNumInputs(); i < e; i++) {
+      Node *in = N->getNthInput(i).getNode();
+      if (!isa<Storage>(in) && !forwardSet.count(in)) {
+        after = N->getNthInput(i);
+        break;
+      }
+    }
+    for (unsigned i = 0, e = N->getNumInputs(); i < e; i++) {
+      NodeValue in = N->getNthInput(i);
+      if (recomputed.count(in.getNode())) {
+        N->setNthInput(
+            i, recompute(G, in, after, recomputed, clones, barriers));
+      }
+    }
+  }
+}
+
 Function *glow::differentiate(Function *F, const TrainingConfig &conf,
                               llvm::StringRef newFuncName,
                               VariableGradientsList *varGrads) {
@@ -131,6 +281,21 @@ Function *glow::differentiate(Function *F, const TrainingConfig &conf,
       continue;
     }
 
+    if (N->getKind() == Kind::LSTMUnitNodeKind) {
+      auto *LU = llvm::cast<LSTMUnitNode>(N);
+      // The cell state of the last step is usually unused, its gradient is
+      // zero.
+      for (NodeValue result : {LU->getHidden(), LU->getCell()}) {
+        if (!map.hasGradient(result)) {
+          auto *ZSN = new SplatNode(N->getName(), result.getType(), 0);
+          toAppend.push_back(ZSN);
+          map.addGradient(result, ZSN);
+        }
+      }
+      toAppend.push_back(LU->getGrad(map));
+      continue;
+    }
+
     if (N->getKind() == Kind::ReshapeNodeKind) {
       ReshapeNode *RN = cast<ReshapeNode>(N);
       NodeValue outputG = map.getGradient(RN->getResult());
@@ -432,5 +597,15 @@ Function *glow::differentiate(Function *F, const TrainingConfig &conf,
     G->addNode(I);
   }
 
+  if (conf.activationsMemoryBudget) {
+    std::vector<Node *> forward;
+    for (auto *N : nodes) {
+      if (!isa<Storage>(N)) {
+        forward.push_back(N);
+      }
+    }
+    recomputeActivations(G, forward, conf.activationsMemoryBudget);
+  }
+
   return G;
 }
@@ -458,14 +458,19 @@ TypeRef Module::uniqueTypeWithNewShape(TypeRef T, llvm::ArrayRef<size_t> dims,
   return uniqueType(Type::newShape(*T, dims, alignments));
 }
 
+size_t Module::TypeHash::operator()(const Type *T) const {
+  return T->equals_hash();
+}
+
 TypeRef Module::uniqueType(const Type &T) {
-  for (auto &tp : types_) {
-    if (T.isEqual(tp)) {
-      return &tp;
-    }
+  auto it = typeIndex_.find(&T);
+  if (it != typeIndex_.end()) {
+    return *it;
   }
 
-  return &*types_.insert(types_.begin(), T);
+  TypeRef uniqued = new (types_.Allocate()) Type(T);
+  typeIndex_.insert(uniqued);
+  return uniqued;
 }
 
 TypeRef Module::getVoidTy() { return uniqueType(Type()); }
@@ -885,6 +890,30 @@ Function::createRowwiseQuantizedFullyConnected(llvm::StringRef name,
       name, outTy, input, qWeights, scales, offsets, B));
 }
 
+DynamicQuantizedFullyConnectedNode *
+Function::createDynamicQuantizedFullyConnected(llvm::StringRef name,
+                                               NodeValue input, Constant *W,
+                                               NodeValue B) {
+  // Since W is constant, quantize it in compilation time. The weights are
+  // stored transposed, so that every output is the dot product of a row of
+  // the input and a row of the weights.
+  Tensor wt;
+  W->getPayload().transpose(&wt, {1, 0});
+  auto WH = W->getPayload().getHandle<float>();
+  auto minMax = WH.minMaxArg();
+  TensorQuantizationParams TQP = quantization::chooseQuantizationParams(
+      WH.raw(minMax.first), WH.raw(minMax.second),
+      quantization::Schema::Symmetric, ElemKind::Int8QTy);
+  auto *qWeights = getParent()->createConstant(
+      "weights.dqfc",
+      quantization::quantizeTensor(wt, TQP, ElemKind::Int8QTy));
+
+  TypeRef OT = getParent()->uniqueType(
+      ElemKind::FloatTy, {input.dims()[0], W->getType()->dims()[1]});
+  return addNode(
+      new DynamicQuantizedFullyConnectedNode(name, OT, input, qWeights, B));
+}
+
 ReluNode *Function::createRELU(llvm::StringRef name, NodeValue input,
                                TypeRef outTy) {
   return addNode(new ReluNode(name, outTy, input));
@@ -1281,6 +1310,14 @@ BatchNormalizationNode *Function::createBatchNormalization(
                                             channelIdx, epsilon, momentum));
 }
 
+LayerNormalizationNode *
+Function::createLayerNormalization(llvm::StringRef name, NodeValue input,
+                                   NodeValue scale, NodeValue bias,
+                                   float epsilon) {
+  return addNode(
+      new LayerNormalizationNode(name, input, scale, bias, epsilon));
+}
+
 BucketizeNode *Function::createBucketizeNode(llvm::StringRef name,
                                              NodeValue input,
                                              llvm::ArrayRef<float> boundaries) {
@@ -1472,6 +1509,16 @@ BatchMatMulNode *Function::createBatchMatMul(llvm::StringRef name,
   return addNode(new BatchMatMulNode(name, OT, LHS, RHS));
 }
 
+BatchedPairwiseDotProductNode *
+Function::createBatchedPairwiseDotProduct(llvm::StringRef name,
+                                          llvm::ArrayRef<NodeValue> inputs) {
+  assert(inputs.size() >= 2 && "At least two inputs are needed.");
+  const size_t numPairs = inputs.size() * (inputs.size() - 1) / 2;
+  auto OT = getParent()->uniqueTypeWithNewShape(
+      inputs[0].getType(), {inputs[0].dims()[0], numPairs});
+  return addNode(new BatchedPairwiseDotProductNode(name, OT, inputs));
+}
+
 BatchedReduceAddNode *
 Function::createBatchedReduceAdd(llvm::StringRef name, TypeRef outTy,
                                  NodeValue batch,
@@ -1566,6 +1613,29 @@ Function::createSparseLengthsWeightedSum(llvm::StringRef name, NodeValue data,
                                                   indices, lengths));
 }
 
+SparseLengthsMeanNode *Function::createSparseLengthsMean(llvm::StringRef name,
+                                                         NodeValue data,
+                                                         NodeValue indices,
+                                                         NodeValue lengths) {
+  auto inDims = data.dims();
+  ShapeVector outDims(inDims.begin(), inDims.end());
+  outDims[0] = lengths.dims()[0];
+  auto outTy = getParent()->uniqueTypeWithNewShape(data.getType(), outDims);
+  return addNode(
+      new SparseLengthsMeanNode(name, outTy, data, indices, lengths));
+}
+
+SparseLengthsMaxNode *Function::createSparseLengthsMax(llvm::StringRef name,
+                                                       NodeValue data,
+                                                       NodeValue indices,
+                                                       NodeValue lengths) {
+  auto inDims = data.dims();
+  ShapeVector outDims(inDims.begin(), inDims.end());
+  outDims[0] = lengths.dims()[0];
+  auto outTy = getParent()->uniqueTypeWithNewShape(data.getType(), outDims);
+  return addNode(new SparseLengthsMaxNode(name, outTy, data, indices, lengths));
+}
+
 SparseLengthsWeightedSumNode *
 Function::createSparseLengthsWeightedSum(llvm::StringRef name, TypeRef outTy,
                                          NodeValue data, NodeValue weights,
@@ -1669,17 +1739,20 @@ Function::createRowwiseQuantizedSparseLengthsSum(
 /// Function \p F is used to get the speficific type, using inputs \p inDims and
 /// \p lenghtsDims to compute output dimensions.
 static TypeRef getOutputTypeOfFusedRowwiseQuantizedSLS(
-    Function *F, const llvm::ArrayRef<size_t> &inDims,
-    const llvm::ArrayRef<size_t> &lengthsDims, ElemKind scaleOffsetKind) {
-  ShapeVector outDims(inDims.begin(), inDims.end());
+    Function *F, TypeRef dataTy, const llvm::ArrayRef<size_t> &lengthsDims,
+    ElemKind precision) {
+  ShapeVector outDims(dataTy->dims().begin(), dataTy->dims().end());
   outDims[0] = lengthsDims[0];
   // The output column count is the same as the input column count, but
   // without the extra bytes for the fused scale/offset, as the output is not
-  // fused.
-  outDims[1] -=
-      2 * ((scaleOffsetKind == ElemKind::FloatTy) ? sizeof(float)
-                                                  : sizeof(float16_t));
-  return F->getParent()->uniqueType(scaleOffsetKind, outDims);
+  // fused. 4-bit data packs two columns in every byte.
+  ElemKind dataKind = dataTy->getElementType();
+  outDims[1] -= 2 * ((dataKind == ElemKind::UInt8FusedQTy) ? sizeof(float)
+                                                           : sizeof(float16_t));
+  if (dataKind == ElemKind::UInt4FusedFP16QTy) {
+    outDims[1] *= 2;
+  }
+  return F->getParent()->uniqueType(precision, outDims);
 }
 
 FusedRowwiseQuantizedSparseLengthsWeightedSumNode *
@@ -1687,17 +1760,30 @@ Function::createFusedRowwiseQuantizedSparseLengthsWeightedSum(
     llvm::StringRef name, NodeValue data, NodeValue weights, NodeValue indices,
     NodeValue lengths, ElemKind precision, bool useFP16Accumulation) {
   auto outTy = getOutputTypeOfFusedRowwiseQuantizedSLS(
-      this, data.dims(), lengths.dims(), precision);
+      this, data.getType(), lengths.dims(), precision);
   return addNode(new FusedRowwiseQuantizedSparseLengthsWeightedSumNode(
       name, outTy, data, weights, indices, lengths, useFP16Accumulation));
 }
 
+GroupedFusedRowwiseQuantizedSparseLengthsWeightedSumNode *
+Function::createGroupedFusedRowwiseQuantizedSparseLengthsWeightedSum(
+    llvm::StringRef name, NodeValue data, NodeValue weights, NodeValue indices,
+    NodeValue lengths, llvm::ArrayRef<size_t> rowOffsets,
+    llvm::ArrayRef<size_t> indexOffsets, llvm::ArrayRef<size_t> segmentOffsets,
+    ElemKind precision, bool useFP16Accumulation) {
+  auto outTy = getOutputTypeOfFusedRowwiseQuantizedSLS(
+      this, data.getType(), lengths.dims(), precision);
+  return addNode(new GroupedFusedRowwiseQuantizedSparseLengthsWeightedSumNode(
+      name, outTy, data, weights, indices, lengths, rowOffsets.vec(),
+      indexOffsets.vec(), segmentOffsets.vec(), useFP16Accumulation));
+}
+
 FusedRowwiseQuantizedSparseLengthsSumNode *
 Function::createFusedRowwiseQuantizedSparseLengthsSum(
     llvm::StringRef name, Constant *data, NodeValue indices, NodeValue lengths,
     ElemKind precision, bool useFP16Accumulation) {
   auto outTy = getOutputTypeOfFusedRowwiseQuantizedSLS(
-      this, data->dims(), lengths.dims(), precision);
+      this, data->getType(), lengths.dims(), precision);
   return addNode(new FusedRowwiseQuantizedSparseLengthsSumNode(
       name, outTy, data, indices, lengths, useFP16Accumulation));
 }
@@ -1763,6 +1849,48 @@ Function::createFusedRowwiseQuantizedSparseLengthsSum(
       name, rwqData, indices, lengths, precision, useFP16Accumulation);
 }
 
+FusedRowwiseQuantizedSparseLengthsMeanNode *
+Function::createFusedRowwiseQuantizedSparseLengthsMean(
+    llvm::StringRef name, Constant *data, NodeValue indices, NodeValue lengths,
+    ElemKind precision, bool useFP16Accumulation) {
+  auto outTy = getOutputTypeOfFusedRowwiseQuantizedSLS(
+      this, data->getType(), lengths.dims(), precision);
+  return addNode(new FusedRowwiseQuantizedSparseLengthsMeanNode(
+      name, outTy, data, indices, lengths, useFP16Accumulation));
+}
+
+FusedRowwiseQuantizedSparseLengthsMeanNode *
+Function::createFusedRowwiseQuantizedSparseLengthsMean(
+    llvm::StringRef name, Tensor &data, NodeValue indices, NodeValue lengths,
+    ElemKind precision, bool useFP16Accumulation) {
+  Constant *rwqData =
+      quantizeDataForFusedRowwiseQuantizedSparseLengthsWeightedSum(this, data,
+                                                                   precision);
+  return createFusedRowwiseQuantizedSparseLengthsMean(
+      name, rwqData, indices, lengths, precision, useFP16Accumulation);
+}
+
+FusedRowwiseQuantizedSparseLengthsMaxNode *
+Function::createFusedRowwiseQuantizedSparseLengthsMax(
+    llvm::StringRef name, Constant *data, NodeValue indices, NodeValue lengths,
+    ElemKind precision, bool useFP16Accumulation) {
+  auto outTy = getOutputTypeOfFusedRowwiseQuantizedSLS(
+      this, data->getType(), lengths.dims(), precision);
+  return addNode(new FusedRowwiseQuantizedSparseLengthsMaxNode(
+      name, outTy, data, indices, lengths, useFP16Accumulation));
+}
+
+FusedRowwiseQuantizedSparseLengthsMaxNode *
+Function::createFusedRowwiseQuantizedSparseLengthsMax(
+    llvm::StringRef name, Tensor &data, NodeValue indices, NodeValue lengths,
+    ElemKind precision, bool useFP16Accumulation) {
+  Constant *rwqData =
+      quantizeDataForFusedRowwiseQuantizedSparseLengthsWeightedSum(this, data,
+                                                                   precision);
+  return createFusedRowwiseQuantizedSparseLengthsMax(
+      name, rwqData, indices, lengths, precision, useFP16Accumulation);
+}
+
 LengthsToRangesNode *Function::createLengthsToRanges(llvm::StringRef name,
                                                      NodeValue lengths) {
   ShapeVector outDims({lengths.dims()[0], 2});
@@ -1911,6 +2039,11 @@ IntLookupTableNode *Function::createIntSigmoid(llvm::StringRef name,
   return createIntLookupTable(name, input, mapping, outTy);
 }
 
+LSTMUnitNode *Function::createLSTMUnit(llvm::StringRef name, NodeValue gates,
+                                       NodeValue prevCell) {
+  return addNode(new LSTMUnitNode(name, gates, prevCell));
+}
+
 TopKNode *Function::createTopK(llvm::StringRef name, NodeValue input,
                                unsigned_t k) {
   auto inDims = input.dims();
@@ -1997,10 +2130,10 @@ SpaceToDepthNode *Function::createSpaceToDepth(llvm::StringRef name,
   return addNode(new SpaceToDepthNode(name, outTy, input, blockSize));
 }
 
-ResizeNearestNode *Function::createResizeNearest(llvm::StringRef name,
-                                                 NodeValue input,
-                                                 float heightScale,
-                                                 float widthScale) {
+/// \returns the type of the result of resizing \p input by \p heightScale
+/// and \p widthScale in \p mod.
+static TypeRef getResizeOutputType(Module &mod, NodeValue input,
+                                   float heightScale, float widthScale) {
   auto inputDim = input.dims();
   DCHECK_EQ(inputDim.size(), 4)
       << "Dimension size: " << inputDim.size() << ", size of 4 is expected.";
@@ -2015,11 +2148,29 @@ ResizeNearestNode *Function::createResizeNearest(llvm::StringRef name,
   DCHECK_GT(newW, 0) << "Scaled width is " << newW
                      << ", Scaled value needs to be larger than 0.";
   std::vector<size_t> newDim = {inputDim[0], newH, newW, inputDim[3]};
-  auto outTy = getParent()->uniqueTypeWithNewShape(input.getType(), newDim);
+  return mod.uniqueTypeWithNewShape(input.getType(), newDim);
+}
+
+ResizeNearestNode *Function::createResizeNearest(llvm::StringRef name,
+                                                 NodeValue input,
+                                                 float heightScale,
+                                                 float widthScale) {
+  auto outTy =
+      getResizeOutputType(*getParent(), input, heightScale, widthScale);
   return addNode(
       new ResizeNearestNode(name, outTy, input, heightScale, widthScale));
 }
 
+ResizeBilinearNode *Function::createResizeBilinear(llvm::StringRef name,
+                                                   NodeValue input,
+                                                   float heightScale,
+                                                   float widthScale) {
+  auto outTy =
+      getResizeOutputType(*getParent(), input, heightScale, widthScale);
+  return addNode(
+      new ResizeBilinearNode(name, outTy, input, heightScale, widthScale));
+}
+
 QuantizeNode *Function::createQuantize(llvm::StringRef name, NodeValue input,
                                        TypeRef outTy) {
   assert(input.getType()->isFPType() && "Input must be a floating type");
@@ -2277,12 +2428,12 @@ ChannelwiseQuantizedConvolutionNode *Function::createChannelwiseQuantizedConv(
     llvm::StringRef name, NodeValue input, Constant *filter, Constant *bias,
     Constant *scales, Constant *offsets, TypeRef outTy,
     llvm::ArrayRef<unsigned_t> kernels, llvm::ArrayRef<unsigned_t> strides,
-    llvm::ArrayRef<unsigned_t> pads, unsigned_t group) {
+    llvm::ArrayRef<unsigned_t> pads, unsigned_t group, bool groupwise) {
   assertConvDims(input, filter, bias, kernels, strides, pads, group);
   auto OT = getParent()->uniqueType(*outTy);
   return addNode(new ChannelwiseQuantizedConvolutionNode(
       name, OT, input, filter, bias, scales, offsets, kernels, strides, pads,
-      group, /*Groupwise*/ true));
+      group, groupwise));
 }
 
 ConvertToNode *Function::createConvertTo(llvm::StringRef name, NodeValue input,
@@ -2600,102 +2751,50 @@ void Function::createLSTM(PlaceholderBindings &bindings,
       getParent()->createPlaceholder(ElemKind::FloatTy, {batchSize, hiddenSize},
                                      "initial_hidden_state", false);
   bindings.allocate(HInit)->zero();
-  Node *Ht = HInit;
+  NodeValue Ht = HInit;
 
   Placeholder *CInit = getParent()->createPlaceholder(
       ElemKind::FloatTy, {batchSize, hiddenSize}, "initial_cell_state", false);
   bindings.allocate(CInit)->zero();
-  Node *Ct = CInit;
+  NodeValue Ct = CInit;
 
-  // Forget gate:
-  //    F <- sigmoid(Wxf * x + Whf * h + bf)
   // Input gate:
   //    I <- sigmoid(Wxi * x + Whi * h + bi)
+  // Forget gate:
+  //    F <- sigmoid(Wxf * x + Whf * h + bf)
   // Output gate:
-  //    O <- sigmoid(Wxo * x + Who * h + bi)
+  //    O <- sigmoid(Wxo * x + Who * h + bo)
   // Cell state:
   //    C <- F . C + I . tanh(Wxc  * x + Whc * h + bc)
   // Hidden state:
   //    h <- O . tanh(C)
-
-  // forget gate
-  float bForget = 1.0;
-  Placeholder *Wxf = getParent()->createPlaceholder(
-      ElemKind::FloatTy, {inputSize, hiddenSize}, nameBase + ".Wxf", true);
-  Placeholder *Whf = getParent()->createPlaceholder(
-      ElemKind::FloatTy, {hiddenSize, hiddenSize}, nameBase + ".Whf", true);
-  Placeholder *Bf1 = getParent()->createPlaceholder(
-      ElemKind::FloatTy, {hiddenSize}, nameBase + ".bf1", true);
-  Placeholder *Bf2 = getParent()->createPlaceholder(
-      ElemKind::FloatTy, {hiddenSize}, nameBase + ".bf2", true);
-  bindings.allocate(Wxf)->init(glow::Tensor::InitKind::Xavier, inputSize,
-                               getPRNG());
-  bindings.allocate(Whf)->init(glow::Tensor::InitKind::Xavier, hiddenSize,
-                               getPRNG());
-  bindings.allocate(Bf1)->init(glow::Tensor::InitKind::Broadcast, bForget,
-                               getPRNG());
-  bindings.allocate(Bf2)->init(glow::Tensor::InitKind::Broadcast, bForget,
-                               getPRNG());
-
-  // input gate
-  float bInput = 0.1;
-  Placeholder *Wxi = getParent()->createPlaceholder(
-      ElemKind::FloatTy, {inputSize, hiddenSize}, nameBase + ".Wxi", true);
-  Placeholder *Whi = getParent()->createPlaceholder(
-      ElemKind::FloatTy, {hiddenSize, hiddenSize}, nameBase + ".Whi", true);
-  Placeholder *Bi1 = getParent()->createPlaceholder(
-      ElemKind::FloatTy, {hiddenSize}, nameBase + ".bi1", true);
-  Placeholder *Bi2 = getParent()->createPlaceholder(
-      ElemKind::FloatTy, {hiddenSize}, nameBase + ".bi2", true);
-
-  bindings.allocate(Wxi)->init(glow::Tensor::InitKind::Xavier, inputSize,
-                               getPRNG());
-  bindings.allocate(Whi)->init(glow::Tensor::InitKind::Xavier, hiddenSize,
-                               getPRNG());
-  bindings.allocate(Bi1)->init(glow::Tensor::InitKind::Broadcast, bInput,
-                               getPRNG());
-  bindings.allocate(Bi2)->init(glow::Tensor::InitKind::Broadcast, bInput,
-                               getPRNG());
-
-  // output gate
-  float bOutput = 0.1;
-  Placeholder *Wxo = getParent()->createPlaceholder(
-      ElemKind::FloatTy, {inputSize, hiddenSize}, nameBase + ".Wxo", true);
-  Placeholder *Who = getParent()->createPlaceholder(
-      ElemKind::FloatTy, {hiddenSize, hiddenSize}, nameBase + ".Who", true);
-  Placeholder *Bo1 = getParent()->createPlaceholder(
-      ElemKind::FloatTy, {hiddenSize}, nameBase + ".bo1", true);
-  Placeholder *Bo2 = getParent()->createPlaceholder(
-      ElemKind::FloatTy, {hiddenSize}, nameBase + ".bo2", true);
-
-  bindings.allocate(Wxo)->init(glow::Tensor::InitKind::Xavier, inputSize,
-                               getPRNG());
-  bindings.allocate(Who)->init(glow::Tensor::InitKind::Xavier, hiddenSize,
-                               getPRNG());
-  bindings.allocate(Bo1)->init(glow::Tensor::InitKind::Broadcast, bOutput,
-                               getPRNG());
-  bindings.allocate(Bo2)->init(glow::Tensor::InitKind::Broadcast, bOutput,
-                               getPRNG());
-
-  // cell state
-  float bCell = 0.1;
-  Placeholder *Wxc = getParent()->createPlaceholder(
-      ElemKind::FloatTy, {inputSize, hiddenSize}, nameBase + ".Wxc", true);
-  Placeholder *Whc = getParent()->createPlaceholder(
-      ElemKind::FloatTy, {hiddenSize, hiddenSize}, nameBase + ".Whc", true);
-  Placeholder *Bc1 = getParent()->createPlaceholder(
-      ElemKind::FloatTy, {hiddenSize}, nameBase + ".bc1", true);
-  Placeholder *Bc2 = getParent()->createPlaceholder(
-      ElemKind::FloatTy, {hiddenSize}, nameBase + ".bc2", true);
-
-  bindings.allocate(Wxc)->init(glow::Tensor::InitKind::Xavier, inputSize,
-                               getPRNG());
-  bindings.allocate(Whc)->init(glow::Tensor::InitKind::Xavier, hiddenSize,
-                               getPRNG());
-  bindings.allocate(Bc1)->init(glow::Tensor::InitKind::Broadcast, bCell,
-                               getPRNG());
-  bindings.allocate(Bc2)->init(glow::Tensor::InitKind::Broadcast, bCell,
-                               getPRNG());
+  //
+  // The weights of the four gates are concatenated in this order, so that a
+  // single FC computes the gates of x and another one those of h, and an
+  // LSTMUnit computes the rest of the step.
+  const unsigned gatesSize = 4 * hiddenSize;
+  Placeholder *Wx = getParent()->createPlaceholder(
+      ElemKind::FloatTy, {inputSize, gatesSize}, nameBase + ".Wx", true);
+  Placeholder *Wh = getParent()->createPlaceholder(
+      ElemKind::FloatTy, {hiddenSize, gatesSize}, nameBase + ".Wh", true);
+  Placeholder *Bx = getParent()->createPlaceholder(
+      ElemKind::FloatTy, {gatesSize}, nameBase + ".bx", true);
+  Placeholder *Bh = getParent()->createPlaceholder(
+      ElemKind::FloatTy, {gatesSize}, nameBase + ".bh", true);
+  bindings.allocate(Wx)->init(glow::Tensor::InitKind::Xavier, inputSize,
+                              getPRNG());
+  bindings.allocate(Wh)->init(glow::Tensor::InitKind::Xavier, hiddenSize,
+                              getPRNG());
+
+  // The forget gate is biased towards keeping the cell state.
+  const float gateBias[] = {/* input */ 0.1, /* forget */ 1.0,
+                            /* output */ 0.1, /* cell */ 0.1};
+  auto BxH = bindings.allocate(Bx)->getHandle();
+  auto BhH = bindings.allocate(Bh)->getHandle();
+  for (unsigned i = 0; i < gatesSize; i++) {
+    BxH.raw(i) = gateBias[i / hiddenSize];
+    BhH.raw(i) = gateBias[i / hiddenSize];
+  }
 
   // output layer
   float b = 0.1;
@@ -2708,56 +2807,18 @@ void Function::createLSTM(PlaceholderBindings &bindings,
                                getPRNG());
   bindings.allocate(By)->init(glow::Tensor::InitKind::Broadcast, b, getPRNG());
 
-  std::vector<Node *> outputNodes;
   for (unsigned t = 0; t < timeSteps; t++) {
     auto fc1Name = nameBase + ".fc1." + std::to_string(t);
     auto fc2Name = nameBase + ".fc2." + std::to_string(t);
-    auto add1Name = nameBase + ".add1." + std::to_string(t);
-    auto sigmoid1Name = nameBase + ".sigmoid1." + std::to_string(t);
-
-    auto *Ft = createSigmoid(
-        sigmoid1Name,
-        createAdd(add1Name, createFullyConnected(fc1Name, Ht, Whf, Bf1),
-                  createFullyConnected(fc2Name, inputs[t], Wxf, Bf2)));
-
-    auto fc3Name = nameBase + ".fc3." + std::to_string(t);
-    auto fc4Name = nameBase + ".fc4." + std::to_string(t);
-    auto add2Name = nameBase + ".add2." + std::to_string(t);
-    auto sigmoid2Name = nameBase + ".sigmoid2." + std::to_string(t);
-
-    auto *It = createSigmoid(
-        sigmoid2Name,
-        createAdd(add2Name, createFullyConnected(fc3Name, Ht, Whi, Bi1),
-                  createFullyConnected(fc4Name, inputs[t], Wxi, Bi2)));
+    auto addName = nameBase + ".add." + std::to_string(t);
+    auto *gates =
+        createAdd(addName, createFullyConnected(fc1Name, Ht, Wh, Bh),
+                  createFullyConnected(fc2Name, inputs[t], Wx, Bx));
 
-    auto fc5Name = nameBase + ".fc5." + std::to_string(t);
-    auto fc6Name = nameBase + ".fc6." + std::to_string(t);
-    auto add3Name = nameBase + ".add3." + std::to_string(t);
-    auto sigmoid3Name = nameBase + ".sigmoid3." + std::to_string(t);
-
-    auto *Ot = createSigmoid(
-        sigmoid3Name,
-        createAdd(add3Name, createFullyConnected(fc5Name, Ht, Who, Bo1),
-                  createFullyConnected(fc6Name, inputs[t], Wxo, Bo2)));
-
-    auto fc7Name = nameBase + ".fc7." + std::to_string(t);
-    auto fc8Name = nameBase + ".fc8." + std::to_string(t);
-    auto add4Name = nameBase + ".add4." + std::to_string(t);
-    auto tanh1Name = nameBase + ".tanh1." + std::to_string(t);
-
-    auto *CRt = createTanh(
-        tanh1Name,
-        createAdd(add4Name, createFullyConnected(fc7Name, Ht, Whc, Bc1),
-                  createFullyConnected(fc8Name, inputs[t], Wxc, Bc2)));
-
-    auto mul1Name = nameBase + ".mul1." + std::to_string(t);
-    auto mul2Name = nameBase + ".mul2." + std::to_string(t);
-    Ct = createAdd(nameBase + ".C." + std::to_string(t),
-                   createMul(mul1Name, Ft, Ct), createMul(mul2Name, It, CRt));
-
-    auto htName = nameBase + ".H." + std::to_string(t);
-    auto tanh2Name = nameBase + ".tanh2." + std::to_string(t);
-    Ht = createMul(htName, Ot, createTanh(tanh2Name, Ct));
+    auto *LU =
+        createLSTMUnit(nameBase + ".lstm." + std::to_string(t), gates, Ct);
+    Ht = LU->getHidden();
+    Ct = LU->getCell();
 
     auto outName = nameBase + ".out." + std::to_string(t);
     auto *O = createFullyConnected(outName, Ht, Why, By);
@@ -3002,6 +3063,7 @@ Function *Function::clone(llvm::StringRef newName,
 
   // Maps current nodes to new nodes.
   llvm::DenseMap<Node *, Node *> currToNew;
+  currToNew.reserve(getNodes().size());
 
   // Clone all of the nodes in the function.
   for (auto &N : getNodes()) {
@@ -3061,24 +3123,6 @@ static bool verifyNodeInput(const Node &N, size_t idx) {
   return false;
 }
 
-/// \returns True if \p n is a storage node (constant or placeholder) of the
-/// function \p F.
-static bool isGraphStorageNode(Node *n, const Function *F) {
-  auto &vars = F->getParent()->getConstants();
-  auto &placeholders = F->getParent()->getPlaceholders();
-
-  if (Constant *V = dyn_cast<Constant>(n)) {
-    return std::find(vars.begin(), vars.end(), V) != vars.end();
-  }
-
-  if (Placeholder *P = dyn_cast<Placeholder>(n)) {
-    return std::find(placeholders.begin(), placeholders.end(), P) !=
-           placeholders.end();
-  }
-
-  return false;
-}
-
 /// Insert \p node in \p nameToNode and report an error if the insertion fails.
 /// \returns True if \p node was inserted into \p nameToNode. False otherwise.
 /// When true is returned that means that \p nameToNode had no other nodes
@@ -3115,8 +3159,18 @@ bool Function::verify() const {
   }
 
   nameToNode.clear();
+  // The nodes of the graph and the storage nodes of the module, to look up
+  // the inputs of the nodes in constant time.
+  std::unordered_set<const Node *> graphNodes;
   for (const auto &N : nodes_) {
     isValid &= insertAndReport(nameToNode, N, *this);
+    graphNodes.insert(&N);
+  }
+  for (auto *V : getParent()->getConstants()) {
+    graphNodes.insert(V);
+  }
+  for (auto *PH : getParent()->getPlaceholders()) {
+    graphNodes.insert(PH);
   }
 
   // Any node referenced by one of the graph nodes should be part of the
@@ -3126,12 +3180,10 @@ bool Function::verify() const {
       auto &input = N.getNthInput(idx);
       // Verify each input of N.
       isValid &= verifyNodeInput(N, idx);
-      bool foundNode =
-          std::find(nodes_.begin(), nodes_.end(), *input) != nodes_.end();
       isValid &= expectCompareTrue(
           "Every node referenced by one of the graph nodes should be part of "
           "the graph",
-          foundNode || isGraphStorageNode(input, this), true, &N);
+          graphNodes.count(input.getNode()) != 0, true, &N);
     }
   }
 
@@ -3146,11 +3198,31 @@ bool Function::verify() const {
   }
 
   std::unordered_map<const Placeholder *, const Node *> placeholderWrittenTo;
+  std::lock_guard<std::mutex> lock(verifiedNodesLock_);
+  // Forget the nodes that are gone.
+  for (auto it = verifiedNodes_.begin(); it != verifiedNodes_.end();) {
+    if (graphNodes.count(it->first)) {
+      ++it;
+    } else {
+      it = verifiedNodes_.erase(it);
+    }
+  }
   for (const auto &N : nodes_) {
     isValid &=
         expectCompareTrue("Node is not linked to the function it belongs",
                           N.getParent(), this, &N);
-    isValid &= N.verify();
+    // The node is in nodes_, only its own checks are left. Skip them if the
+    // node didn't change since they last passed.
+    size_t signature = N.getVerifySignature();
+    auto verified = verifiedNodes_.find(&N);
+    if (verified == verifiedNodes_.end() || verified->second != signature) {
+      if (N.verifyLocal()) {
+        verifiedNodes_[&N] = signature;
+      } else {
+        verifiedNodes_.erase(&N);
+        isValid = false;
+      }
+    }
     // Make sure all the placeholders are at most written once, and that
     // constants are never written to.
     for (size_t idx = 0, e = N.getNumInputs(); idx < e; ++idx) {
@@ -3236,6 +3308,51 @@ SaveNode *glow::getOutputSave(Function *F, Placeholder *PH) {
   return nullptr;
 }
 
+/// \returns true if \p dst only reads the prefix of \p src that it uses, so
+/// that \p src may be a partial tensor.
+static bool allowsPartialNodeInput(NodeValue src, const Node *dst) {
+  // The sum of the lengths of a sparse lookup bounds the indices and the
+  // weights it reads.
+  if (auto *SLS = dyn_cast<SparseLengthsSumNode>(dst)) {
+    return src == SLS->getIndices();
+  } else if (auto *SLS = dyn_cast<SparseLengthsMeanNode>(dst)) {
+    return src == SLS->getIndices();
+  } else if (auto *SLS = dyn_cast<SparseLengthsMaxNode>(dst)) {
+    return src == SLS->getIndices();
+  } else if (auto *SLS = dyn_cast<SparseLengthsWeightedSumNode>(dst)) {
+    return src == SLS->getIndices() || src == SLS->getWeights();
+  } else if (auto *SLS =
+                 dyn_cast<RowwiseQuantizedSparseLengthsWeightedSumNode>(dst)) {
+    return src == SLS->getIndices() || src == SLS->getWeights();
+  } else if (auto *SLS =
+                 dyn_cast<FusedRowwiseQuantizedSparseLengthsSumNode>(dst)) {
+    return src == SLS->getIndices();
+  } else if (auto *SLS =
+                 dyn_cast<FusedRowwiseQuantizedSparseLengthsMeanNode>(dst)) {
+    return src == SLS->getIndices();
+  } else if (auto *SLS =
+                 dyn_cast<FusedRowwiseQuantizedSparseLengthsMaxNode>(dst)) {
+    return src == SLS->getIndices();
+  } else if (auto *SLS =
+                 dyn_cast<FusedRowwiseQuantizedSparseLengthsWeightedSumNode>(
+                     dst)) {
+    return src == SLS->getIndices() || src == SLS->getWeights();
+  }
+  return false;
+}
+
+bool glow::allowsPartialInput(const Placeholder *PH, const Function *F) {
+  for (const auto &U : PH->getUsers()) {
+    if (U.getUser()->getParent() != F) {
+      continue;
+    }
+    if (!allowsPartialNodeInput(*U.get(), U.getUser())) {
+      return false;
+    }
+  }
+  return true;
+}
+
 Node *glow::recursiveClone(Function *newF, Node *node, NodeMap &currToNew) {
   Node *copy = node->clone();
   currToNew[node] = copy;
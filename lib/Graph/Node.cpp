@@ -306,6 +306,38 @@ llvm::raw_ostream &operator<<(llvm::raw_ostream &os, const Node *node) {
 //===----------------------------------------------------------------------===//
 
 bool Node::verify() const {
+  bool isValid = true;
+  if (getParent()) {
+    isValid &=
+        expectCompareTrue("Node not present in its parent",
+                          std::find(getParent()->getNodes().begin(),
+                                    getParent()->getNodes().end(),
+                                    *this) != getParent()->getNodes().end(),
+                          true, this);
+  }
+  return verifyLocal() && isValid;
+}
+
+llvm::hash_code Node::getVerifySignature() const {
+  llvm::hash_code hash =
+      llvm::hash_combine(static_cast<unsigned>(getKind()), getHash());
+  for (unsigned i = 0, e = getNumInputs(); i < e; i++) {
+    auto input = getNthInput(i);
+    hash = llvm::hash_combine(hash, input.getNode(), input.getResNo(),
+                              input.getType());
+  }
+  if (hasPredicate()) {
+    auto pred = getPredicate();
+    hash = llvm::hash_combine(hash, pred.getNode(), pred.getResNo(),
+                              pred.getType());
+  }
+  for (unsigned i = 0, e = getNumResults(); i < e; i++) {
+    hash = llvm::hash_combine(hash, getType(i));
+  }
+  return hash;
+}
+
+bool Node::verifyLocal() const {
   // Verify the shared members of the node.
   bool isValid = true;
 
@@ -322,15 +354,6 @@ bool Node::verify() const {
                                  Ty->dims().size(), size_t(1), this);
   }
 
-  if (getParent()) {
-    isValid &=
-        expectCompareTrue("Node not present in its parent",
-                          std::find(getParent()->getNodes().begin(),
-                                    getParent()->getNodes().end(),
-                                    *this) != getParent()->getNodes().end(),
-                          true, this);
-  }
-
   // Verify node-specific properties:
   switch (getKind()) {
 #define DEF_NODE(CLASS, NAME)                                                  \
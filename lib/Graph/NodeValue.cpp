@@ -113,7 +113,7 @@ void NodeHandle::setOperand(Node *v, unsigned resNo) {
   }
 
   if (node_) {
-    node_->removeUse(NodeUse(this));
+    node_->removeUse(use_);
     node_ = nullptr;
     resNo_ = 0;
   }
@@ -121,7 +121,7 @@ void NodeHandle::setOperand(Node *v, unsigned resNo) {
   if (v) {
     node_ = v;
     resNo_ = resNo;
-    v->addUse(NodeUse(this));
+    use_ = v->addUse(NodeUse(this));
   }
 }
 
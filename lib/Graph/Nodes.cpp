@@ -79,6 +79,15 @@ bool Storage::hasSideEffects() const { return false; }
 
 Node *Storage::clone() const { llvm_unreachable("Storage can't be cloned."); }
 
+void Storage::serialize(ModuleWriter &writer) const {
+  llvm_unreachable("Storage is serialized with its Module.");
+}
+
+Node *Storage::deserialize(llvm::StringRef name, ModuleReader &reader) {
+  // Storage is not a node of a Function, see loadModule().
+  return nullptr;
+}
+
 //===----------------------------------------------------------------------===//
 //                     Debug description methods
 //===----------------------------------------------------------------------===//
@@ -104,6 +113,17 @@ std::string Placeholder::getDebugDesc() const {
 //                       Nodes verification
 //===----------------------------------------------------------------------===//
 
+/// Check that the weights \p weights, e.g. the filter of a Convolution, have
+/// the element type of the activations \p src, or are in Int8QTy when \p src
+/// is in Int16QTy. \p parent is used to print the context of the check.
+static bool checkWeightsType(NodeValue src, NodeValue weights,
+                             const Node *parent) {
+  if (src.getElementType() == ElemKind::Int16QTy) {
+    return checkType(weights, {ElemKind::Int8QTy, ElemKind::Int16QTy}, parent);
+  }
+  return checkType(weights, src.getElementType(), parent);
+}
+
 static bool verifyConvFilter(const Node *parent, NodeValue filter,
                              const ShapeNHWC &idim, const ShapeNHWC &odim,
                              const ShapeHW &kdim, unsigned_t group) {
@@ -134,14 +154,15 @@ static bool verifyConvolution(NodeValue src, NodeValue dest, NodeValue filter,
                               unsigned_t dilation, bool checkBiasType = true) {
   const Node *parent = dest.getNode();
   bool isValid = checkType(src, dest.getElementType(), parent);
-  isValid &= checkType(src, filter.getElementType(), parent);
+  isValid &= checkWeightsType(src, filter, parent);
   if (checkBiasType) {
     // Non quantization type check.
     if (src.getElementType() == ElemKind::FloatTy) {
       isValid &= checkType(bias, ElemKind::FloatTy, parent);
     }
     // Quantization type check.
-    if (src.getElementType() == ElemKind::Int8QTy) {
+    if (src.getElementType() == ElemKind::Int8QTy ||
+        src.getElementType() == ElemKind::Int16QTy) {
       isValid &= checkType(bias, ElemKind::Int32QTy, parent);
     }
   }
@@ -253,7 +274,8 @@ static bool verifyFullyConnected(NodeValue src, NodeValue weights,
   isValid &= expectCompareTrue("Inconsistent weights/dest sizes",
                                weights.dims()[1], dest.dims()[1], parent);
 
-  if (src.getElementType() == ElemKind::Int8QTy) {
+  if (src.getElementType() == ElemKind::Int8QTy ||
+      src.getElementType() == ElemKind::Int16QTy) {
     isValid &= checkType(bias, ElemKind::Int32QTy, parent);
   }
   return isValid;
@@ -455,14 +477,7 @@ bool ConvolutionNode::verify() const {
 }
 
 bool ChannelwiseQuantizedConvolutionNode::verify() const {
-  bool isValid = expectCompareTrue("Only groupwise quantization is supported.",
-                                   getGroupwise(), true, this);
-
-  if (!isValid) {
-    return false;
-  }
-
-  isValid =
+  bool isValid =
       verifyConvolution<ShapeNHWC>(getInput(), getResult(), getFilter(),
                                    getBias(), Kernels_, Strides_, Pads_, Group_,
                                    /* dilation */ 1, /* checkBiasType */ false);
@@ -481,12 +496,22 @@ bool ChannelwiseQuantizedConvolutionNode::verify() const {
                                getScales().dims().size(), size_t(1), this);
 
   // check qparam sizes
-  isValid &=
-      expectCompareTrue("There must be one filter offset qparam per group",
-                        getOffsets().dims()[0], size_t(getGroup()), this);
-  isValid &=
-      expectCompareTrue("There must be one filter scale qparam per group",
-                        getScales().dims()[0], size_t(getGroup()), this);
+  if (getGroupwise()) {
+    isValid &=
+        expectCompareTrue("There must be one filter offset qparam per group",
+                          getOffsets().dims()[0], size_t(getGroup()), this);
+    isValid &=
+        expectCompareTrue("There must be one filter scale qparam per group",
+                          getScales().dims()[0], size_t(getGroup()), this);
+  } else {
+    size_t outChannels = getFilter().dims()[0];
+    isValid &= expectCompareTrue(
+        "There must be one filter offset qparam per output channel",
+        getOffsets().dims()[0], outChannels, this);
+    isValid &= expectCompareTrue(
+        "There must be one filter scale qparam per output channel",
+        getScales().dims()[0], outChannels, this);
+  }
   return isValid;
 }
 
@@ -727,7 +752,7 @@ bool MatMulNode::verify() const {
 
   auto elem = dest.getType()->getElementType();
   isValid &= checkType(lhs, elem, this);
-  isValid &= checkType(rhs, elem, this);
+  isValid &= checkWeightsType(lhs, rhs, this);
 
   isValid &=
       expectCompareTrue("Invalid row dimensions", LDims[0], DDims[0], this);
@@ -768,6 +793,39 @@ bool BatchMatMulNode::verify() const {
   return isValid;
 }
 
+bool BatchedPairwiseDotProductNode::verify() const {
+  auto inputs = getInputs();
+  auto dest = getResult();
+  bool isValid = expectCompareTrue("At least two inputs are needed.",
+                                   inputs.size(), size_t(2), this,
+                                   CompareOperatorGreaterEqual<size_t>());
+  isValid &= checkType(dest, {ElemKind::FloatTy, ElemKind::Float16Ty}, this);
+  isValid &= expectCompareTrue("Result must be 2 dimensional.",
+                               dest.dims().size(), size_t(2), this);
+  if (!isValid) {
+    return false;
+  }
+
+  const size_t numPairs = inputs.size() * (inputs.size() - 1) / 2;
+  isValid &= expectCompareTrue("Result must hold every pair of inputs.",
+                               dest.dims()[1], numPairs, this);
+  for (const auto &input : inputs) {
+    isValid &= checkType(input, dest.getElementType(), this);
+    isValid &= expectCompareTrue("Inputs must be 2 dimensional.",
+                                 input.dims().size(), size_t(2), this);
+  }
+  if (!isValid) {
+    return false;
+  }
+  for (const auto &input : inputs) {
+    isValid &= expectCompareTrue("Inputs must have the batch size of Result.",
+                                 input.dims()[0], dest.dims()[0], this);
+    isValid &= expectCompareTrue("Inputs must have the same size.",
+                                 input.dims()[1], inputs[0].dims()[1], this);
+  }
+  return isValid;
+}
+
 bool SigmoidNode::verify() const {
   return verifySigmoid(getInput(), getResult());
 }
@@ -1015,6 +1073,28 @@ bool MeanVarNormalizationNode::verify() const {
          checkSameType(getMean(), getVar(), this);
 }
 
+bool LayerNormalizationNode::verify() const {
+  auto input = getInput();
+  auto scale = getScale();
+  bool isValid = checkSameType(input, getResult(), this);
+  isValid &= checkSameType(scale, getBias(), this);
+  isValid &= checkType(input, scale.getElementType(), this);
+  isValid &= checkType(input, {ElemKind::FloatTy, ElemKind::Float16Ty}, this);
+  isValid &= expectCompareTrue("Scale must not have more dims than Input",
+                               scale.dims().size(), input.dims().size(),
+                               this, CompareOperatorLessEqual<size_t>());
+  if (isValid) {
+    // The normalized dimensions are the trailing ones of the input.
+    size_t offset = input.dims().size() - scale.dims().size();
+    for (size_t i = 0, e = scale.dims().size(); i < e; i++) {
+      isValid &= expectCompareTrue("Scale dims must equal trailing Input dims",
+                                   scale.dims()[i], input.dims()[offset + i],
+                                   this);
+    }
+  }
+  return isValid;
+}
+
 bool LocalResponseNormalizationNode::verify() const {
   return verifyLocalResponseNormalization(getInput(), getResult());
 }
@@ -1135,6 +1215,16 @@ bool SparseLengthsWeightedSumNode::verify() const {
                                         getIndices(), getLengths());
 }
 
+bool SparseLengthsMeanNode::verify() const {
+  return verifySparseLengthsSum(getResult(), getData(), getIndices(),
+                                getLengths());
+}
+
+bool SparseLengthsMaxNode::verify() const {
+  return verifySparseLengthsSum(getResult(), getData(), getIndices(),
+                                getLengths());
+}
+
 bool SparseLengthsWeightedSumGradNode::verify() const {
   // Same checks as SparseLengthsWeightedSumNode.
   bool isValid =
@@ -1221,7 +1311,13 @@ static bool verifyFusedRowwiseQuantizedSparseLengthsSum(
 
   // Wrap this in isValid to prevent potential segfault if the result is
   // incorrectly shaped.
-  if (isValid) {
+  if (isValid && data.getType()->getElementType() ==
+                     ElemKind::UInt4FusedFP16QTy) {
+    isValid &= expectCompareTrue(
+        "Result output shape should have second dim twice the 4-bit data "
+        "columns of Data, without extra columns from scale/offset.",
+        result.dims()[1], (data.dims()[1] - extraCols) * 2, parent);
+  } else if (isValid) {
     isValid &=
         expectCompareTrue("Result output shape should have second dim without "
                           "extra columns from scale/offset in Data.",
@@ -1236,12 +1332,69 @@ bool FusedRowwiseQuantizedSparseLengthsWeightedSumNode::verify() const {
       getUseFP16Accumulation());
 }
 
+bool GroupedFusedRowwiseQuantizedSparseLengthsWeightedSumNode::verify() const {
+  bool isValid = verifyFusedRowwiseQuantizedSparseLengthsSum(
+      getResult(), getData(), getIndices(), getLengths(), getWeights(),
+      getUseFP16Accumulation());
+  auto rowOffsets = getRowOffsets();
+  auto indexOffsets = getIndexOffsets();
+  auto segmentOffsets = getSegmentOffsets();
+  isValid &= expectCompareTrue("There must be at least one table",
+                               rowOffsets.size(), size_t(0), this,
+                               CompareOperatorGreaterThan<size_t>());
+  isValid &= expectCompareTrue("There must be one index offset per table",
+                               indexOffsets.size(), rowOffsets.size(), this);
+  isValid &= expectCompareTrue("There must be one segment offset per table",
+                               segmentOffsets.size(), rowOffsets.size(), this);
+  if (!isValid) {
+    return false;
+  }
+  // The tables may share rows, but their indices and segments follow one
+  // another.
+  isValid &= expectCompareTrue("The first table must start at index 0",
+                               indexOffsets[0], size_t(0), this);
+  isValid &= expectCompareTrue("The first table must start at segment 0",
+                               segmentOffsets[0], size_t(0), this);
+  for (size_t i = 0, e = rowOffsets.size(); i < e; i++) {
+    isValid &= expectCompareTrue("Row offsets must be within Data",
+                                 rowOffsets[i], getData().dims()[0], this,
+                                 CompareOperatorLessEqual<size_t>());
+    if (i > 0) {
+      isValid &= expectCompareTrue("Index offsets must be increasing",
+                                   indexOffsets[i], indexOffsets[i - 1], this,
+                                   CompareOperatorGreaterEqual<size_t>());
+      isValid &= expectCompareTrue("Segment offsets must be increasing",
+                                   segmentOffsets[i], segmentOffsets[i - 1],
+                                   this, CompareOperatorGreaterEqual<size_t>());
+    }
+  }
+  isValid &= expectCompareTrue("Index offsets must be within Indices",
+                               indexOffsets.back(), getIndices().dims()[0],
+                               this, CompareOperatorLessEqual<size_t>());
+  isValid &= expectCompareTrue("Segment offsets must be within Lengths",
+                               segmentOffsets.back(), getLengths().dims()[0],
+                               this, CompareOperatorLessEqual<size_t>());
+  return isValid;
+}
+
 bool FusedRowwiseQuantizedSparseLengthsSumNode::verify() const {
   return verifyFusedRowwiseQuantizedSparseLengthsSum(
       getResult(), getData(), getIndices(), getLengths(), nullptr,
       getUseFP16Accumulation());
 }
 
+bool FusedRowwiseQuantizedSparseLengthsMeanNode::verify() const {
+  return verifyFusedRowwiseQuantizedSparseLengthsSum(
+      getResult(), getData(), getIndices(), getLengths(), nullptr,
+      getUseFP16Accumulation());
+}
+
+bool FusedRowwiseQuantizedSparseLengthsMaxNode::verify() const {
+  return verifyFusedRowwiseQuantizedSparseLengthsSum(
+      getResult(), getData(), getIndices(), getLengths(), nullptr,
+      getUseFP16Accumulation());
+}
+
 bool LengthsToRangesNode::verify() const {
   bool isValid = checkType(getResult(), getLengths().getElementType(), this);
   isValid &= checkType(getLengths(), ElemKind::Int32ITy, this);
@@ -1300,6 +1453,10 @@ bool SGDNode::verify() const {
   return checkSameType(getGradient(), getWeight(), this);
 }
 
+bool RecomputeBarrierNode::verify() const {
+  return checkSameType(getInput(), getResult(), this);
+}
+
 bool QuantizationProfileNode::verify() const {
   // Make sure that input tensor is a floating point type.
   bool isValid = checkType(getInput(), ElemKind::FloatTy, this);
@@ -1366,6 +1523,51 @@ bool TopKNode::verify() const {
   return isValid;
 }
 
+/// Verify the shapes of a step of an LSTM with the pre-activations \p gates,
+/// the previous cell state \p prevCell and the results \p hidden and
+/// \p cell.
+static bool verifyLSTMUnit(NodeValue gates, NodeValue prevCell,
+                           NodeValue hidden, NodeValue cell,
+                           const Node *parent) {
+  bool isValid = expectCompareTrue("Gates must be 2D", gates.dims().size(),
+                                   size_t(2), parent);
+  isValid &= expectCompareTrue("PrevCell must be 2D", prevCell.dims().size(),
+                               size_t(2), parent);
+  if (!isValid) {
+    return false;
+  }
+  isValid &= expectCompareTrue("Mismatching Gates and PrevCell batches",
+                               gates.dims()[0], prevCell.dims()[0], parent);
+  isValid &= expectCompareTrue("Gates must hold 4 gates per cell",
+                               gates.dims()[1], 4 * prevCell.dims()[1],
+                               parent);
+  isValid &= checkType(gates, ElemKind::FloatTy, parent);
+  isValid &= checkType(prevCell, ElemKind::FloatTy, parent);
+  isValid &= checkSameType(cell, prevCell, parent);
+  isValid &= checkSameType(hidden, cell, parent);
+  return isValid;
+}
+
+bool LSTMUnitNode::verify() const {
+  return verifyLSTMUnit(getGates(), getPrevCell(), getHidden(), getCell(),
+                        this);
+}
+
+bool LSTMUnitGradNode::verify() const {
+  bool isValid = verifyLSTMUnit(getGates(), getPrevCell(),
+                                getOriginalOutputForHidden(),
+                                getOriginalOutputForCell(), this);
+  isValid &= verifyInputAndGradInputTypes(
+      getGates(), getGradOfInputNamedGates(), this);
+  isValid &= verifyInputAndGradInputTypes(
+      getPrevCell(), getGradOfInputNamedPrevCell(), this);
+  isValid &= verifyOutputAndGradOutputTypes(
+      getOriginalOutputForHidden(), getGradOfOriginalOutputNamedHidden(), this);
+  isValid &= verifyOutputAndGradOutputTypes(
+      getOriginalOutputForCell(), getGradOfOriginalOutputNamedCell(), this);
+  return isValid;
+}
+
 bool ArgMaxNode::verify() const {
   bool isValid = true;
 
@@ -1396,6 +1598,45 @@ bool ArgMaxNode::verify() const {
   return isValid;
 }
 
+bool DynamicQuantizedFullyConnectedNode::verify() const {
+  auto src = getInput();
+  auto weights = getWeights();
+  auto bias = getBias();
+  auto dest = getResult();
+
+  bool isValid = expectCompareTrue("Inputs should be 2D tensor",
+                                   src.dims().size(), size_t(2), this);
+  isValid &= expectCompareTrue("Weights should be 2D tensor",
+                               weights.dims().size(), size_t(2), this);
+  isValid &= expectCompareTrue("Result should be 2D tensor", dest.dims().size(),
+                               size_t(2), this);
+  isValid &= expectCompareTrue("Bias should be 1D tensor", bias.dims().size(),
+                               size_t(1), this);
+  if (!isValid) {
+    return false;
+  }
+
+  isValid &= expectCompareTrue("Mismatch on expected source dimension 0",
+                               src.dims()[0], dest.dims()[0], this);
+  isValid &= expectCompareTrue("Mismatch on expected source dimension 1",
+                               src.dims()[1], weights.dims()[1], this);
+  isValid &= expectCompareTrue("Inconsistent bias/dest sizes", bias.dims()[0],
+                               weights.dims()[0], this);
+  isValid &= expectCompareTrue("Inconsistent weights/dest sizes",
+                               weights.dims()[0], dest.dims()[1], this);
+
+  isValid &= expectCompareTrue("Input should be float", src.getElementType(),
+                               ElemKind::FloatTy, this);
+  isValid &= expectCompareTrue("Weights should be Int8QTy",
+                               weights.getElementType(), ElemKind::Int8QTy,
+                               this);
+  isValid &= expectCompareTrue("Bias should be float", bias.getElementType(),
+                               ElemKind::FloatTy, this);
+  isValid &= expectCompareTrue("Result should be float", dest.getElementType(),
+                               ElemKind::FloatTy, this);
+  return isValid;
+}
+
 bool RowwiseQuantizedFullyConnectedNode::verify() const {
   auto src = getInput();
   auto weights = getWeights();
@@ -1550,37 +1791,46 @@ bool SpaceToDepthNode::verify() const {
   return sameType && dimTransform;
 }
 
-bool ResizeNearestNode::verify() const {
-  auto input = getInput();
-  auto result = getResult();
+/// Verifies the resize of \p input into \p result by \p heightScale and
+/// \p widthScale, of the node \p parent.
+static bool verifyResize(NodeValue input, NodeValue result, float heightScale,
+                         float widthScale, const Node *parent) {
   auto inputDims = input.dims();
   auto outputDims = result.dims();
 
-  bool isValid = checkTypeIgnoreShape(input, result, this);
+  bool isValid = checkTypeIgnoreShape(input, result, parent);
   isValid &= expectCompareTrue("Input must be a 4D tensor", inputDims.size(),
-                               size_t(4), this);
+                               size_t(4), parent);
   isValid &= expectCompareTrue("Output must be a 4D tensor", outputDims.size(),
-                               size_t(4), this);
+                               size_t(4), parent);
   isValid &= expectCompareTrue("Batch size must be the same", inputDims[0],
-                               outputDims[0], this);
+                               outputDims[0], parent);
   isValid &= expectCompareTrue("Depth must be the same", inputDims[3],
-                               outputDims[0], this);
-  isValid &= expectCompareTrue(
-      "Unexpected output height",
-      size_t(std::floor(inputDims[1] * getHeightScale())), outputDims[1], this);
-  isValid &= expectCompareTrue(
-      "Unexpected output width",
-      size_t(std::floor(inputDims[2] * getWidthScale())), outputDims[2], this);
-  isValid &=
-      expectCompareTrue("Invalid height scale", getHeightScale(), float(0.0),
-                        this, CompareOperatorGreaterThan<float>());
-  isValid &=
-      expectCompareTrue("Invalid width scale", getWidthScale(), float(0.0),
-                        this, CompareOperatorGreaterThan<float>());
+                               outputDims[3], parent);
+  isValid &= expectCompareTrue("Unexpected output height",
+                               size_t(std::floor(inputDims[1] * heightScale)),
+                               outputDims[1], parent);
+  isValid &= expectCompareTrue("Unexpected output width",
+                               size_t(std::floor(inputDims[2] * widthScale)),
+                               outputDims[2], parent);
+  isValid &= expectCompareTrue("Invalid height scale", heightScale, float(0.0),
+                               parent, CompareOperatorGreaterThan<float>());
+  isValid &= expectCompareTrue("Invalid width scale", widthScale, float(0.0),
+                               parent, CompareOperatorGreaterThan<float>());
 
   return isValid;
 }
 
+bool ResizeNearestNode::verify() const {
+  return verifyResize(getInput(), getResult(), getHeightScale(),
+                      getWidthScale(), this);
+}
+
+bool ResizeBilinearNode::verify() const {
+  return verifyResize(getInput(), getResult(), getHeightScale(),
+                      getWidthScale(), this);
+}
+
 bool SaveNode::verify() const {
   return checkSameType(getInput(), getOutput(), this);
 }
@@ -179,6 +179,19 @@ Tensor *PlaceholderBindings::allocate(Placeholder *P) {
   return T;
 }
 
+void PlaceholderBindings::setNumValidElements(Placeholder *P,
+                                              size_t numElements) {
+  DCHECK(P->isRagged()) << "Placeholder with name \"" << P->getName().str()
+                        << "\" is not ragged";
+  Tensor *T = get(P);
+  DCHECK(T) << "Placeholder with name \"" << P->getName().str()
+            << "\" is not registered";
+  DCHECK_LE(numElements, T->size()) << "Placeholder with name \""
+                                    << P->getName().str()
+                                    << "\" holds fewer elements";
+  T->setUnpaddedSizeInBytes(numElements * T->getType().getElementSize());
+}
+
 unsigned PlaceholderBindings::allocate(std::list<Placeholder *> &lst) {
   unsigned allocated = 0;
   // For each placeholder in the list:
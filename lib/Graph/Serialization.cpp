@@ -0,0 +1,528 @@
+/**
+ * Copyright (c) Glow Contributors. See CONTRIBUTORS file.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "glow/Graph/Serialization.h"
+#include "glow/Graph/Graph.h"
+#include "glow/Graph/Utils.h"
+#include "glow/Support/Memory.h"
+#include "glow/Support/Support.h"
+
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <memory>
+
+using namespace glow;
+
+namespace {
+
+/// The version of the format, to be bumped whenever the records of the file
+/// or the constructor arguments of a node change.
+constexpr uint32_t kModuleFormatVersion = 2;
+
+constexpr char kModuleMagic[8] = {'G', 'L', 'O', 'W', 'M', 'O', 'D', '\0'};
+
+/// The header at the start of a file. The records of the Module, i.e. the
+/// types followed by the storage and the Functions, follow the header. The
+/// payloads of the Constants are in the data section at the end of the file,
+/// every payload aligned to TensorAlignment so that it can be used in place.
+struct ModuleHeader {
+  char magic[sizeof(kModuleMagic)];
+  uint32_t version;
+  uint32_t reserved;
+  /// Size of the records after the header.
+  uint64_t recordsSize;
+  /// Offset and size of the data section in the file.
+  uint64_t dataOffset;
+  uint64_t dataSize;
+};
+
+/// Zeros to pad the file with.
+constexpr char kPadding[TensorAlignment] = {};
+
+/// Writes \p N with \p writer.
+void serializeNode(const Node &N, ModuleWriter &writer) {
+  switch (N.getKind()) {
+#define DEF_NODE(CLASS, NAME)                                                  \
+  case Kinded::Kind::CLASS##Kind:                                              \
+    return static_cast<const CLASS &>(N).serialize(writer);
+#include "glow/AutoGenNodes.def"
+  default:
+    llvm_unreachable("Unhandled node");
+  }
+}
+
+using DeserializeFn = Node *(*)(llvm::StringRef name, ModuleReader &reader);
+
+/// \returns the function that builds the nodes of kind \p kindName, or
+/// nullptr if there is no such kind. Nodes are found by the name of their
+/// kind, which unlike Kinded::Kind doesn't depend on the other nodes.
+DeserializeFn getDeserializer(llvm::StringRef kindName) {
+  static const llvm::StringMap<DeserializeFn> deserializers = [] {
+    llvm::StringMap<DeserializeFn> map;
+#define DEF_NODE(CLASS, NAME) map[#NAME] = &CLASS::deserialize;
+#include "glow/AutoGenNodes.def"
+    return map;
+  }();
+  auto it = deserializers.find(kindName);
+  return it == deserializers.end() ? nullptr : it->second;
+}
+
+} // namespace
+
+//===----------------------------------------------------------------------===//
+//                        ModuleWriter
+//===----------------------------------------------------------------------===//
+
+void ModuleWriter::write(NodeValueArrayRef values) {
+  write<uint64_t>(values.size());
+  for (size_t i = 0, e = values.size(); i < e; i++) {
+    write(values[i]);
+  }
+}
+
+void ModuleWriter::write(NodeValue value) {
+  uint32_t id = kNullID;
+  if (value.getNode()) {
+    auto it = nodeIDs_.find(value.getNode());
+    if (it != nodeIDs_.end()) {
+      id = it->second;
+    } else {
+      ok_ = false;
+    }
+  }
+  write(id);
+  write<uint32_t>(value.getResNo());
+}
+
+void ModuleWriter::write(TypeRef T) {
+  if (!T) {
+    write(kNullID);
+    return;
+  }
+  auto it = typeIDs_.find(T);
+  if (it == typeIDs_.end()) {
+    it = typeIDs_.emplace(T, typeIDs_.size()).first;
+    auto append = [this](const void *data, size_t size) {
+      types_.append(static_cast<const char *>(data), size);
+    };
+    ElemKind kind = T->getElementType();
+    uint32_t numDims = T->dims().size();
+    append(&kind, sizeof(kind));
+    append(&numDims, sizeof(numDims));
+    append(T->dims().data(), numDims * sizeof(size_t));
+    append(T->strides().data(), numDims * sizeof(size_t));
+    if (T->isQuantizedType()) {
+      float scale = T->getScale();
+      int32_t offset = T->getOffset();
+      append(&scale, sizeof(scale));
+      append(&offset, sizeof(offset));
+    }
+  }
+  write(it->second);
+}
+
+void ModuleWriter::addNode(const Node *N) {
+  nodeIDs_[N] = nodes_.size();
+  nodes_.push_back(N);
+}
+
+void ModuleWriter::resetNodes(size_t numNodes) {
+  for (size_t i = numNodes, e = nodes_.size(); i < e; i++) {
+    nodeIDs_.erase(nodes_[i]);
+  }
+  nodes_.resize(numNodes);
+}
+
+//===----------------------------------------------------------------------===//
+//                        ModuleReader
+//===----------------------------------------------------------------------===//
+
+size_t ModuleReader::readCount(size_t elemSize) {
+  uint64_t count;
+  read(count);
+  if (count > getNumBytesLeft() / elemSize) {
+    fail();
+    return 0;
+  }
+  return count;
+}
+
+void ModuleReader::read(std::string &str) {
+  uint32_t size;
+  read(size);
+  if (size > getNumBytesLeft()) {
+    fail();
+    size = 0;
+  }
+  str.assign(cur_, size);
+  cur_ += size;
+}
+
+void ModuleReader::read(std::vector<NodeValue> &values) {
+  values.resize(readCount(2 * sizeof(uint32_t)));
+  for (auto &value : values) {
+    read(value);
+  }
+}
+
+void ModuleReader::read(NodeValue &value) {
+  uint32_t id, resNo;
+  read(id);
+  read(resNo);
+  value = NodeValue();
+  if (!ok_ || id == ModuleWriter::kNullID) {
+    return;
+  }
+  if (id >= nodes_.size() || resNo >= nodes_[id]->getNumResults()) {
+    fail();
+    return;
+  }
+  value = NodeValue(nodes_[id], resNo);
+}
+
+void ModuleReader::read(TypeRef &T) {
+  uint32_t id;
+  read(id);
+  T = nullptr;
+  if (!ok_ || id == ModuleWriter::kNullID) {
+    return;
+  }
+  if (id >= types_.size()) {
+    fail();
+    return;
+  }
+  T = types_[id];
+}
+
+void ModuleReader::readTypes() {
+  uint32_t numTypes;
+  read(numTypes);
+  for (uint32_t i = 0; i < numTypes && ok_; i++) {
+    ElemKind kind;
+    uint32_t numDims;
+    read(kind);
+    read(numDims);
+    if (unsigned(kind) > unsigned(ElemKind::BoolTy) ||
+        numDims > max_tensor_dimensions) {
+      fail();
+      return;
+    }
+    size_t dims[max_tensor_dimensions], strides[max_tensor_dimensions];
+    readBytes(dims, numDims * sizeof(size_t));
+    readBytes(strides, numDims * sizeof(size_t));
+    float scale = 0;
+    int32_t offset = 0;
+    if (isQuantizedElemKind(kind)) {
+      read(scale);
+      read(offset);
+    }
+    if (!ok_) {
+      return;
+    }
+
+    // Types only keep their strides, recover the alignments which give the
+    // same strides.
+    size_t alignments[max_tensor_dimensions];
+    for (uint32_t d = 0; d < numDims; d++) {
+      bool last = d + 1 == numDims;
+      size_t packed = last ? 1 : dims[d + 1] * strides[d + 1];
+      if (!dims[d] || strides[d] < packed || (last && strides[d] != 1)) {
+        fail();
+        return;
+      }
+      alignments[d] =
+          strides[d] == packed ? 1 : strides[d] * Type::getElementSize(kind);
+    }
+    llvm::ArrayRef<size_t> dimsRef(dims, numDims);
+    llvm::ArrayRef<size_t> alignmentsRef(alignments, numDims);
+    Type T = isQuantizedElemKind(kind)
+                 ? Type(kind, dimsRef, alignmentsRef, scale, offset)
+                 : Type(kind, dimsRef, alignmentsRef);
+    if (T.strides() != llvm::makeArrayRef(strides, numDims)) {
+      fail();
+      return;
+    }
+    types_.push_back(M_.uniqueType(T));
+  }
+}
+
+//===----------------------------------------------------------------------===//
+//                        Saving and loading
+//===----------------------------------------------------------------------===//
+
+Error glow::saveModule(const Module &M, llvm::StringRef path) {
+  ModuleWriter writer;
+
+  writer.write<uint32_t>(M.getPlaceholders().size());
+  for (const auto *PH : M.getPlaceholders()) {
+    writer.write(PH->getName());
+    writer.write(PH->getType());
+    writer.write(PH->isTraining());
+    writer.write(PH->allocZero());
+    writer.write(PH->isRagged());
+    writer.addNode(PH);
+  }
+
+  // The payloads are written after the records, at these offsets in the data
+  // section.
+  std::vector<std::pair<const Tensor *, uint64_t>> payloads;
+  uint64_t dataSize = 0;
+  writer.write<uint32_t>(M.getConstants().size());
+  for (const auto *C : M.getConstants()) {
+    const Tensor &payload = C->getPayload();
+    RETURN_ERR_IF_NOT(
+        payload.getUnsafePtr(),
+        strFormat("The payload of Constant %s was released, a Module can "
+                  "only be saved before it is compiled.",
+                  C->getName().data()),
+        ErrorValue::ErrorCode::MODEL_WRITER_SERIALIZATION_ERROR);
+    dataSize = alignedSize(dataSize, TensorAlignment);
+    payloads.emplace_back(&payload, dataSize);
+    writer.write(C->getName());
+    writer.write(C->getType());
+    writer.write<uint64_t>(dataSize);
+    writer.write<uint64_t>(payload.getSizeInBytes());
+    dataSize += payload.getSizeInBytes();
+    writer.addNode(C);
+  }
+
+  const size_t numStorage = writer.getNumNodes();
+  writer.write<uint32_t>(M.getFunctions().size());
+  for (auto *F : M.getFunctions()) {
+    writer.write(F->getName());
+    // The nodes are written after the nodes they use.
+    GraphPostOrderVisitor visitor(*F);
+    std::vector<const Node *> nodes;
+    for (const auto *N : visitor.getPostOrder()) {
+      if (!llvm::isa<Storage>(N)) {
+        nodes.push_back(N);
+      }
+    }
+    writer.write<uint32_t>(nodes.size());
+    for (const auto *N : nodes) {
+      writer.write(llvm::StringRef(N->getKindName()));
+      writer.write(N->getName());
+      serializeNode(*N, writer);
+      // Optimizations may change the types of the results after the node is
+      // built.
+      writer.write<uint32_t>(N->getNumResults());
+      for (unsigned i = 0, e = N->getNumResults(); i < e; i++) {
+        writer.write(N->getType(i));
+      }
+      writer.write(N->getPredicate());
+      writer.addNode(N);
+    }
+    RETURN_ERR_IF_NOT(
+        writer.ok(),
+        strFormat("Function %s uses nodes which are not in the Module.",
+                  F->getName().data()),
+        ErrorValue::ErrorCode::MODEL_WRITER_SERIALIZATION_ERROR);
+    writer.resetNodes(numStorage);
+  }
+
+  uint32_t numTypes = writer.getNumTypes();
+  ModuleHeader header;
+  memcpy(header.magic, kModuleMagic, sizeof(kModuleMagic));
+  header.version = kModuleFormatVersion;
+  header.reserved = 0;
+  header.recordsSize =
+      sizeof(numTypes) + writer.getTypes().size() + writer.getBody().size();
+  header.dataOffset =
+      alignedSize(sizeof(header) + header.recordsSize, TensorAlignment);
+  header.dataSize = dataSize;
+
+  std::error_code EC;
+  llvm::raw_fd_ostream os(path, EC, llvm::sys::fs::F_None);
+  RETURN_ERR_IF_NOT(!EC,
+                    strFormat("Can't open the file %s.", path.str().c_str()),
+                    ErrorValue::ErrorCode::MODEL_WRITER_INVALID_FILENAME);
+  os.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  os.write(reinterpret_cast<const char *>(&numTypes), sizeof(numTypes));
+  os << writer.getTypes() << writer.getBody();
+  uint64_t pos = sizeof(header) + header.recordsSize;
+  for (const auto &payload : payloads) {
+    uint64_t start = header.dataOffset + payload.second;
+    os.write(kPadding, start - pos);
+    os.write(payload.first->getUnsafePtr(), payload.first->getSizeInBytes());
+    pos = start + payload.first->getSizeInBytes();
+  }
+  os.close();
+  RETURN_ERR_IF_NOT(!os.has_error(),
+                    strFormat("Can't write the file %s.", path.str().c_str()),
+                    ErrorValue::ErrorCode::MODEL_WRITER_SERIALIZATION_ERROR);
+  return Error::success();
+}
+
+Error glow::loadModule(Module &M, llvm::StringRef path) {
+  RETURN_ERR_IF_NOT(M.getFunctions().empty() && M.getPlaceholders().empty() &&
+                        M.getConstants().empty(),
+                    "Can only load a Module into an empty Module.");
+
+  int fd;
+  RETURN_ERR_IF_NOT(!llvm::sys::fs::openFileForRead(path, fd),
+                    strFormat("Can't open the file %s.", path.str().c_str()),
+                    ErrorValue::ErrorCode::MODEL_LOADER_INVALID_MODULE);
+  uint64_t fileSize = 0;
+  std::error_code EC = llvm::sys::fs::file_size(path, fileSize);
+  std::shared_ptr<llvm::sys::fs::mapped_file_region> mapping;
+  if (!EC && fileSize >= sizeof(ModuleHeader)) {
+    // The mapping is private so that optimizations may change the payloads
+    // of the Constants without writing to the file.
+    mapping = std::make_shared<llvm::sys::fs::mapped_file_region>(
+        fd, llvm::sys::fs::mapped_file_region::priv, fileSize, 0, EC);
+  }
+  llvm::sys::Process::SafelyCloseFileDescriptor(fd);
+  RETURN_ERR_IF_NOT(!EC && mapping,
+                    strFormat("Can't map the file %s.", path.str().c_str()),
+                    ErrorValue::ErrorCode::MODEL_LOADER_INVALID_MODULE);
+
+  const char *data = mapping->const_data();
+  ModuleHeader header;
+  memcpy(&header, data, sizeof(header));
+  RETURN_ERR_IF_NOT(
+      !memcmp(header.magic, kModuleMagic, sizeof(kModuleMagic)) &&
+          header.version == kModuleFormatVersion,
+      strFormat("%s is not a Module saved by this version of Glow.",
+                path.str().c_str()),
+      ErrorValue::ErrorCode::MODEL_LOADER_INVALID_MODULE);
+  RETURN_ERR_IF_NOT(
+      header.recordsSize <= fileSize - sizeof(header) &&
+          header.dataOffset >= sizeof(header) + header.recordsSize &&
+          header.dataOffset % TensorAlignment == 0 &&
+          header.dataOffset <= fileSize &&
+          header.dataSize <= fileSize - header.dataOffset,
+      strFormat("The file %s is truncated.", path.str().c_str()),
+      ErrorValue::ErrorCode::MODEL_LOADER_INVALID_MODULE);
+  M.addExternalStorage(mapping);
+
+  auto invalid = [&path](llvm::StringRef what) {
+    return MAKE_ERR(ErrorValue::ErrorCode::MODEL_LOADER_INVALID_MODULE,
+                    strFormat("Invalid %s in the file %s.", what.data(),
+                              path.str().c_str()));
+  };
+
+  const char *records = data + sizeof(header);
+  ModuleReader reader(M, records, records + header.recordsSize);
+  reader.readTypes();
+  if (!reader.ok()) {
+    return invalid("types");
+  }
+
+  uint32_t numPlaceholders;
+  reader.read(numPlaceholders);
+  for (uint32_t i = 0; i < numPlaceholders && reader.ok(); i++) {
+    std::string name;
+    TypeRef T;
+    bool isTrainable, allocZero, ragged;
+    reader.read(name);
+    reader.read(T);
+    reader.read(isTrainable);
+    reader.read(allocZero);
+    reader.read(ragged);
+    if (!reader.ok() || !T) {
+      return invalid("Placeholder");
+    }
+    auto *PH = M.createPlaceholder(T, name, isTrainable);
+    PH->setAllocZero(allocZero);
+    PH->setRagged(ragged);
+    reader.addNode(PH);
+  }
+
+  uint32_t numConstants;
+  reader.read(numConstants);
+  // The payloads are used in place.
+  char *payloads = const_cast<char *>(data) + header.dataOffset;
+  for (uint32_t i = 0; i < numConstants && reader.ok(); i++) {
+    std::string name;
+    TypeRef T;
+    uint64_t offset, size;
+    reader.read(name);
+    reader.read(T);
+    reader.read(offset);
+    reader.read(size);
+    if (!reader.ok() || !T || size != T->getSizeInBytes() ||
+        offset % TensorAlignment || offset > header.dataSize ||
+        size > header.dataSize - offset) {
+      return invalid("Constant");
+    }
+    reader.addNode(M.createConstant(name, Tensor(payloads + offset, T)));
+  }
+
+  const size_t numStorage = numPlaceholders + numConstants;
+  uint32_t numFunctions;
+  reader.read(numFunctions);
+  for (uint32_t i = 0; i < numFunctions && reader.ok(); i++) {
+    std::string functionName;
+    uint32_t numNodes;
+    reader.read(functionName);
+    reader.read(numNodes);
+    if (!reader.ok()) {
+      return invalid("Function");
+    }
+    Function *F = M.createFunction(functionName);
+    for (uint32_t j = 0; j < numNodes && reader.ok(); j++) {
+      std::string kindName, name;
+      reader.read(kindName);
+      reader.read(name);
+      DeserializeFn deserialize = getDeserializer(kindName);
+      if (!reader.ok() || !deserialize) {
+        return invalid("node kind " + kindName);
+      }
+      Node *N = deserialize(name, reader);
+      if (!N) {
+        return invalid("node " + name);
+      }
+      // The Function owns the node from now on, even if it is invalid.
+      F->addNode(N);
+      uint32_t numResults;
+      reader.read(numResults);
+      if (numResults != N->getNumResults()) {
+        return invalid("node " + name);
+      }
+      for (unsigned r = 0; r < numResults; r++) {
+        TypeRef T;
+        reader.read(T);
+        if (!T || T->dims() != N->getType(r)->dims()) {
+          return invalid("node " + name);
+        }
+        if (T != N->getType(r)) {
+          N->setType(r, T);
+        }
+      }
+      NodeValue predicate;
+      reader.read(predicate);
+      if (!reader.ok()) {
+        return invalid("node " + name);
+      }
+      if (predicate.getNode()) {
+        N->setPredicate(predicate);
+      }
+      reader.addNode(N);
+    }
+    reader.resetNodes(numStorage);
+    if (!reader.ok() || !F->verify()) {
+      return invalid("Function " + functionName);
+    }
+  }
+
+  if (!reader.ok() || reader.getNumBytesLeft()) {
+    return invalid("records");
+  }
+  return Error::success();
+}
@@ -15,6 +15,8 @@
  */
 #include "GraphScheduler.h"
 
+#include "glow/Backend/Backend.h"
+
 #include "llvm/Support/CommandLine.h"
 
 using namespace glow;
@@ -29,7 +31,9 @@ llvm::cl::opt<SchedulerKind> graphScheduler(
                                 "Use ChildMemSizeBased"),
                      clEnumValN(SchedulerKind::TopologicalSortBased,
                                 "topological-sort-based",
-                                "Use TopologicalSortBased")),
+                                "Use TopologicalSortBased"),
+                     clEnumValN(SchedulerKind::PeakMemoryBased,
+                                "peak-memory-based", "Use PeakMemoryBased")),
     llvm::cl::init(SchedulerKind::ChildMemSizeBased),
     llvm::cl::cat(graphSchedulerCat));
 } // namespace
@@ -42,11 +46,13 @@ Scheduler *createScheduler(SchedulerKind schedulerKind, Function &G,
     return new ChildMemSizeBasedScheduler(G, scheduled);
   case SchedulerKind::TopologicalSortBased:
     return new TopologicalSortBasedScheduler(G, scheduled);
+  case SchedulerKind::PeakMemoryBased:
+    return new PeakMemoryBasedScheduler(G, scheduled);
   }
   llvm_unreachable("unreachable");
 }
 
-void IRFunction::scheduleGraph(NodesPtrList &Schedule) {
+void IRFunction::scheduleGraph(NodesPtrList &Schedule, const Backend &B) {
   Schedule.clear();
   auto constants = G_->findConstants();
   auto placeholders = G_->findPlaceholders();
@@ -64,8 +70,13 @@ void IRFunction::scheduleGraph(NodesPtrList &Schedule) {
       placeholders.size() + G_->getMetadataPlaceholders().size();
   (void)numVars;
   (void)numPlaceholders;
-  std::unique_ptr<Scheduler> scheduler{
-      createScheduler(graphScheduler, *G_, Schedule)};
+  // The scheduler given on the command line overrides the one of the
+  // backend.
+  SchedulerKind kind = graphScheduler;
+  if (!graphScheduler.getNumOccurrences() && B.shouldMinimizePeakMemory()) {
+    kind = SchedulerKind::PeakMemoryBased;
+  }
+  std::unique_ptr<Scheduler> scheduler{createScheduler(kind, *G_, Schedule)};
   scheduler->schedule();
   assert(scheduler->getSchedule().size() ==
              G_->getNodes().size() + numPlaceholders + numVars &&
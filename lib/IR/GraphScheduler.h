@@ -18,7 +18,10 @@
 
 #include "glow/IR/IR.h"
 
+#include "llvm/ADT/SmallVector.h"
+
 #include <unordered_map>
+#include <vector>
 
 namespace glow {
 
@@ -28,6 +31,8 @@ enum class SchedulerKind {
   ChildMemSizeBased,
   /// Performs a standard topological search
   TopologicalSortBased,
+  /// Minimizes the predicted peak memory of the results of the nodes.
+  PeakMemoryBased,
 };
 
 class Scheduler {
@@ -89,6 +94,62 @@ public:
   void schedule() override;
 };
 
+/// This is a scheduler that minimizes the peak memory taken by the results
+/// of the nodes while they are live, from their computation until their last
+/// user. It schedules the nodes greedily, picking among the nodes whose
+/// operands are computed the one which increases the live memory the least,
+/// looking one user ahead so that a node whose user frees its inputs isn't
+/// postponed. It then keeps its schedule or the ChildMemSizeBased one,
+/// whichever has the lowest predicted peak.
+class PeakMemoryBasedScheduler : public Scheduler {
+  /// The nodes of the graph, in their order in the graph.
+  std::vector<Node *> nodes_;
+  /// The indices of the nodes in nodes_.
+  std::unordered_map<const Node *, size_t> indices_;
+  /// The bytes of the results of each node.
+  std::vector<int64_t> resultSize_;
+  /// The nodes whose results each node reads, once each.
+  std::vector<llvm::SmallVector<size_t, 4>> operands_;
+  /// The nodes that must be scheduled before each node, its operands and the
+  /// readers of the inputs it overwrites, and the nodes each node must be
+  /// scheduled before.
+  std::vector<llvm::SmallVector<size_t, 4>> preds_;
+  std::vector<llvm::SmallVector<size_t, 4>> succs_;
+  /// The number of nodes reading the results of each node.
+  std::vector<unsigned> numReaders_;
+  /// The predicted peak memory of the schedule, in bytes.
+  int64_t predictedPeak_{0};
+
+  /// Computes the node indices, sizes and dependencies.
+  void computeDependencies();
+
+  /// \returns the growth of the live memory when the node \p idx is
+  /// scheduled, while the results of each node still have \p remaining
+  /// readers to schedule, and after the node \p first unless it is the
+  /// number of nodes.
+  int64_t getLiveMemoryDelta(size_t idx, const std::vector<unsigned> &remaining,
+                             size_t first) const;
+
+  /// \returns the greedy schedule of the nodes.
+  std::vector<size_t> scheduleGreedily() const;
+
+  /// \returns the peak memory of the results of the nodes when they are
+  /// computed in the \p order of their indices.
+  int64_t getPeakMemory(const std::vector<size_t> &order) const;
+
+public:
+  PeakMemoryBasedScheduler(Function &G, NodesPtrList &Schedule)
+      : Scheduler(G, Schedule) {}
+
+  ~PeakMemoryBasedScheduler() override = default;
+
+  void schedule() override;
+
+  /// \returns the peak memory in bytes of the results of the nodes, as
+  /// predicted for the computed schedule.
+  int64_t getPredictedPeakMemory() const { return predictedPeak_; }
+};
+
 /// This is a simple scheduler based on topological sort based
 /// on post order traversal.
 
@@ -77,6 +77,7 @@ bool Instruction::hasPredicate() const { return predicateIndex_ > 0; }
 
 void Instruction::pushOperand(Operand op) {
   ops_.emplace_back(nullptr, op.second);
+  uses_.emplace_back();
   setOperand(ops_.size() - 1, op.first);
 }
 
@@ -88,12 +89,12 @@ void Instruction::setOperand(unsigned idx, Value *v) {
   }
 
   if (currVal) {
-    currVal->removeUse(Use(idx, this));
+    currVal->removeUse(uses_[idx]);
   }
 
+  ops_[idx].first = v;
   if (v) {
-    ops_[idx].first = v;
-    v->addUse(Use(idx, this));
+    uses_[idx] = v->addUse(Use(idx, this));
   }
 }
 
@@ -127,12 +128,17 @@ void Instruction::verify() const {
   }
 
   // Perform Instruction-specific verification.
+  switch (getKind()) {
 #define DEF_INSTR(CLASS, NAME)                                                 \
-  if (auto *X = dyn_cast<const CLASS>(this))                                   \
-    X->verify();
+  case Kinded::Kind::CLASS##Kind:                                              \
+    static_cast<const CLASS *>(this)->verify();                                \
+    break;
 #define DEF_BACKEND_SPECIFIC_INSTR(CLASS, NAME) DEF_INSTR(CLASS, NAME)
 #define DEF_VALUE(CLASS, NAME)
 #include "glow/AutoGenInstr.def"
+  default:
+    llvm_unreachable("Unknown instruction kind");
+  }
 }
 
 void Value::verify(const IRFunction &M) const {}
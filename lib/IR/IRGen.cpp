@@ -119,6 +119,14 @@ void IRGenVisitor::post(Node *parent, Node *N) {
     registerIR(N, dest);
     break;
   }
+  case glow::Kinded::Kind::RecomputeBarrierNodeKind: {
+    // The barrier only orders the graph, After is visited before it as its
+    // operand. The result aliases the input, which may be a weight, so it
+    // isn't registered as an activation.
+    auto *RB = cast<RecomputeBarrierNode>(N);
+    generatedNodeDest_[RB->getResult()] = valueForNode(RB->getInput());
+    break;
+  }
   case glow::Kinded::Kind::ConvolutionGradNodeKind: {
     auto *CG = cast<ConvolutionGradNode>(N);
 
@@ -301,6 +309,19 @@ void IRGenVisitor::post(Node *parent, Node *N) {
     registerIR(N, dest);
     break;
   }
+  case glow::Kinded::Kind::BatchedPairwiseDotProductNodeKind: {
+    auto *BPDP = cast<BatchedPairwiseDotProductNode>(N);
+    auto *dest = builder_.createAllocActivationInst(
+        BPDP->getName(), BPDP->getResult().getType());
+    auto *I = builder_.createBatchedPairwiseDotProductInst(BPDP->getName(),
+                                                           dest);
+    // The inputs are variadic, so they are pushed after Dest.
+    for (const auto &input : BPDP->getInputs()) {
+      I->pushOperand({valueForNode(input), OperandKind::In});
+    }
+    registerIR(N, dest);
+    break;
+  }
   case glow::Kinded::Kind::SliceNodeKind: {
     auto *SL = cast<SliceNode>(N);
     auto start = SL->getStart();
@@ -446,7 +467,7 @@ void IRFunction::generateIR(const Backend &B) {
   assert(G_->verify() && "Invalid function");
   // Schedule the nodes.
   NodesPtrList ScheduledNodes;
-  scheduleGraph(ScheduledNodes);
+  scheduleGraph(ScheduledNodes, B);
   IRGenVisitor irgen(this, B);
 
   for (auto &N : ScheduledNodes) {
@@ -84,3 +84,61 @@ size_t glow::getOriginOffset(Value *V) {
 
   return off;
 }
+
+bool glow::getStridedRegionLayout(llvm::ArrayRef<size_t> offsets,
+                                  llvm::ArrayRef<size_t> regionDims,
+                                  llvm::ArrayRef<size_t> tensorDims,
+                                  size_t &rowLen, size_t &pitch) {
+  if (regionDims.size() != tensorDims.size() ||
+      offsets.size() != tensorDims.size()) {
+    return false;
+  }
+
+  // Find the innermost dimension the region doesn't fully cover. The rows
+  // are made of this dimension and the inner ones.
+  size_t partialDim = tensorDims.size();
+  for (size_t i = tensorDims.size(); i-- > 0;) {
+    if (offsets[i] != 0 || regionDims[i] != tensorDims[i]) {
+      partialDim = i;
+      break;
+    }
+  }
+  if (partialDim == tensorDims.size()) {
+    return false;
+  }
+  rowLen = 1;
+  for (size_t i = partialDim; i < tensorDims.size(); i++) {
+    rowLen *= regionDims[i];
+  }
+
+  // The rows are the elements of the outer dimensions spanning more than one
+  // element. They start every pitch elements if, going outwards from the
+  // innermost of them, no dimension spans more than one element once a
+  // dimension is not fully covered.
+  bool strided = false;
+  bool partial = false;
+  pitch = 1;
+  for (size_t i = tensorDims.size(); i-- > 0;) {
+    if (i >= partialDim || (!strided && regionDims[i] == 1)) {
+      pitch *= tensorDims[i];
+      continue;
+    }
+    if (regionDims[i] == 1) {
+      partial |= tensorDims[i] != 1;
+      continue;
+    }
+    if (partial) {
+      return false;
+    }
+    strided = true;
+    partial = regionDims[i] != tensorDims[i];
+  }
+  return strided;
+}
+
+bool glow::getStridedViewLayout(const Value *V, size_t &rowLen,
+                                size_t &pitch) {
+  auto *TVI = dyn_cast<TensorViewInst>(V);
+  return TVI && getStridedRegionLayout(TVI->getOffsets(), TVI->dims(),
+                                       TVI->getSrc()->dims(), rowLen, pitch);
+}
@@ -0,0 +1,238 @@
+/**
+ * Copyright (c) Glow Contributors. See CONTRIBUTORS file.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "GraphScheduler.h"
+
+#include "glow/Support/Debug.h"
+
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+
+#define DEBUG_TYPE "graph-scheduler"
+
+namespace glow {
+
+/// Adds \p idx to \p list unless it is there already.
+static void addOnce(llvm::SmallVectorImpl<size_t> &list, size_t idx) {
+  if (std::find(list.begin(), list.end(), idx) == list.end()) {
+    list.push_back(idx);
+  }
+}
+
+void PeakMemoryBasedScheduler::computeDependencies() {
+  for (auto &N : G_.getNodes()) {
+    indices_[&N] = nodes_.size();
+    nodes_.push_back(&N);
+  }
+  size_t numNodes = nodes_.size();
+  resultSize_.assign(numNodes, 0);
+  operands_.resize(numNodes);
+  preds_.resize(numNodes);
+  succs_.resize(numNodes);
+  numReaders_.assign(numNodes, 0);
+
+  for (size_t idx = 0; idx < numNodes; idx++) {
+    Node *N = nodes_[idx];
+    for (size_t i = 0, e = N->getNumResults(); i < e; ++i) {
+      resultSize_[idx] += N->getType(i)->getSizeInBytes();
+    }
+    // Storage doesn't take memory for its results and is never scheduled.
+    auto addOperand = [&](const Node *input) {
+      auto it = indices_.find(input);
+      if (it != indices_.end()) {
+        addOnce(operands_[idx], it->second);
+        addOnce(preds_[idx], it->second);
+      }
+    };
+    for (size_t i = 0, e = N->getNumInputs(); i < e; ++i) {
+      addOperand(N->getNthInput(i).getNode());
+    }
+    if (N->hasPredicate()) {
+      addOperand(N->getPredicate().getNode());
+    }
+    // A node overwriting one of its inputs must follow its other readers, as
+    // in ChildMemSizeBasedScheduler.
+    for (unsigned i = 0, e = N->getNumInputs(); i < e; ++i) {
+      if (!N->isOverwrittenNthInput(i)) {
+        continue;
+      }
+      for (NodeUse &use : N->getNthInput(i).getNode()->getUsers()) {
+        auto it = indices_.find(use.getUser());
+        if (it != indices_.end() && it->second != idx) {
+          addOnce(preds_[idx], it->second);
+        }
+      }
+    }
+  }
+
+  for (size_t idx = 0; idx < numNodes; idx++) {
+    for (size_t operand : operands_[idx]) {
+      numReaders_[operand]++;
+    }
+    for (size_t pred : preds_[idx]) {
+      succs_[pred].push_back(idx);
+    }
+  }
+}
+
+int64_t PeakMemoryBasedScheduler::getLiveMemoryDelta(
+    size_t idx, const std::vector<unsigned> &remaining, size_t first) const {
+  int64_t delta = numReaders_[idx] ? resultSize_[idx] : 0;
+  for (size_t operand : operands_[idx]) {
+    // The node scheduled first reads its own operands, and its results have
+    // all their readers left.
+    unsigned left = remaining[operand];
+    if (first != nodes_.size() &&
+        std::find(operands_[first].begin(), operands_[first].end(),
+                  operand) != operands_[first].end()) {
+      left--;
+    }
+    if (left == 1) {
+      delta -= resultSize_[operand];
+    }
+  }
+  return delta;
+}
+
+std::vector<size_t> PeakMemoryBasedScheduler::scheduleGreedily() const {
+  size_t numNodes = nodes_.size();
+  std::vector<unsigned> pending(numNodes);
+  std::vector<unsigned> remaining(numReaders_);
+  std::vector<bool> scheduled(numNodes, false);
+  std::vector<size_t> ready;
+  for (size_t idx = 0; idx < numNodes; idx++) {
+    pending[idx] = preds_[idx].size();
+    if (!pending[idx]) {
+      ready.push_back(idx);
+    }
+  }
+
+  std::vector<size_t> order;
+  order.reserve(numNodes);
+  while (order.size() < numNodes) {
+    if (ready.empty()) {
+      // The orderings of the nodes overwriting their inputs form a cycle,
+      // which ChildMemSizeBasedScheduler breaks in the order of the graph.
+      for (size_t idx = 0; idx < numNodes; idx++) {
+        if (!scheduled[idx] &&
+            std::all_of(operands_[idx].begin(), operands_[idx].end(),
+                        [&](size_t operand) { return scheduled[operand]; })) {
+          ready.push_back(idx);
+          break;
+        }
+      }
+      assert(!ready.empty() && "The operands of the nodes form a cycle");
+    }
+
+    // Pick the node growing the live memory the least, or whose user that
+    // it makes schedulable does. Break ties by the memory the node needs
+    // while it is computed, then by the order of the graph.
+    size_t best = 0;
+    int64_t bestScore = 0;
+    int64_t bestSize = 0;
+    for (size_t r = 0, e = ready.size(); r < e; r++) {
+      size_t idx = ready[r];
+      int64_t delta = getLiveMemoryDelta(idx, remaining, numNodes);
+      int64_t score = delta;
+      if (delta > 0) {
+        for (size_t succ : succs_[idx]) {
+          if (pending[succ] == 1 && !scheduled[succ]) {
+            score = std::min(
+                score, delta + getLiveMemoryDelta(succ, remaining, idx));
+          }
+        }
+      }
+      if (r == 0 || score < bestScore ||
+          (score == bestScore &&
+           (resultSize_[idx] < bestSize ||
+            (resultSize_[idx] == bestSize && idx < ready[best])))) {
+        best = r;
+        bestScore = score;
+        bestSize = resultSize_[idx];
+      }
+    }
+
+    size_t idx = ready[best];
+    ready[best] = ready.back();
+    ready.pop_back();
+    scheduled[idx] = true;
+    order.push_back(idx);
+    for (size_t operand : operands_[idx]) {
+      remaining[operand]--;
+    }
+    for (size_t succ : succs_[idx]) {
+      if (--pending[succ] == 0 && !scheduled[succ]) {
+        ready.push_back(succ);
+      }
+    }
+  }
+  return order;
+}
+
+int64_t PeakMemoryBasedScheduler::getPeakMemory(
+    const std::vector<size_t> &order) const {
+  std::vector<unsigned> remaining(numReaders_);
+  int64_t live = 0;
+  int64_t peak = 0;
+  for (size_t idx : order) {
+    // The operands and the results are live while the node is computed.
+    live += resultSize_[idx];
+    peak = std::max(peak, live);
+    for (size_t operand : operands_[idx]) {
+      if (--remaining[operand] == 0) {
+        live -= resultSize_[operand];
+      }
+    }
+    if (!numReaders_[idx]) {
+      live -= resultSize_[idx];
+    }
+  }
+  return peak;
+}
+
+void PeakMemoryBasedScheduler::schedule() {
+  computeDependencies();
+  std::vector<size_t> order = scheduleGreedily();
+  predictedPeak_ = getPeakMemory(order);
+
+  // Keep the schedule of ChildMemSizeBasedScheduler if it predicts a lower
+  // peak, as it may on some trees.
+  NodesPtrList childSchedule;
+  ChildMemSizeBasedScheduler childScheduler(G_, childSchedule);
+  childScheduler.schedule();
+  if (childSchedule.size() == nodes_.size()) {
+    std::vector<size_t> childOrder;
+    childOrder.reserve(nodes_.size());
+    for (Node *N : childSchedule) {
+      childOrder.push_back(indices_.at(N));
+    }
+    int64_t childPeak = getPeakMemory(childOrder);
+    DEBUG_GLOW(llvm::dbgs() << "Predicted peak of " << G_.getName()
+                            << ": greedy " << predictedPeak_
+                            << ", child memory size based " << childPeak
+                            << "\n");
+    if (childPeak < predictedPeak_) {
+      order = std::move(childOrder);
+      predictedPeak_ = childPeak;
+    }
+  }
+
+  for (size_t idx : order) {
+    scheduled_.push_back(nodes_[idx]);
+  }
+}
+} // namespace glow
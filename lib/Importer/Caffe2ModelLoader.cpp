@@ -499,9 +499,11 @@ Error Caffe2ModelLoader::loadConvQuantized(const caffe2::OperatorDef &op,
     ASSIGN_VALUE_OR_RETURN_ERR(wScales, getConstantByName(wScalesName));
     ASSIGN_VALUE_OR_RETURN_ERR(wOffsets, getConstantByName(wOffsetsName));
 
-    node = G_.createChannelwiseQuantizedConv(opName, finalIn, w, bias, wScales,
-                                             wOffsets, outTy, kernels, strides,
-                                             pads, group);
+    // The weights are quantized per output channel when there are more
+    // qparams than groups.
+    node = G_.createChannelwiseQuantizedConv(
+        opName, finalIn, w, bias, wScales, wOffsets, outTy, kernels, strides,
+        pads, group, /* groupwise */ wScales->dims()[0] == group);
   } else {
     // If the bias isn't quantized for a non group quantized conv, quantize it.
     const Tensor &biasTensor = bias->getPayload();
@@ -1386,7 +1388,8 @@ Error Caffe2ModelLoader::loadInputsWithTensorProtoType(
     Placeholder *placeholder;
     ASSIGN_VALUE_OR_RETURN_ERR(
         placeholder,
-        createAndRegisterPlaceholder(in.name(), &loadRes.t->getType()));
+        createAndRegisterPlaceholder(
+            in.name(), getInputType(in.name(), &loadRes.t->getType())));
 
     inputVarsByName_.try_emplace(in.name(), placeholder);
 
@@ -1498,49 +1501,65 @@ static Error fillTensor(Tensor &T, ElemKind kind, llvm::ArrayRef<size_t> dim,
   return Error::success();
 }
 
+/// \returns whether \p typeName is the type of an op filling a tensor with
+/// given values, which loadGivenTensorFill loads.
+static bool isGivenTensorFill(llvm::StringRef typeName) {
+  return typeName == "GivenTensorFill" || typeName == "GivenTensorIntFill" ||
+         typeName == "GivenTensorInt64Fill";
+}
+
+/// Loads into \p T the values given by \p op, a GivenTensor*Fill op with the
+/// arguments \p dict. Doesn't touch the loader, so that the tensors of
+/// several ops can be loaded concurrently.
+static Error loadGivenTensorFill(const caffe2::OperatorDef &op,
+                                 ArgumentDictionaryTy &dict, Tensor &T) {
+  const std::string &typeName = op.type();
+  /*
+   * op {
+   *   output: "conv1_w"
+   *   name: ""
+   *   type: "GivenTensorFill"
+   *   arg {
+   *     name: "shape"
+   *     ints: 96
+   *     ints: 3
+   *     ints: 11
+   *     ints: 11
+   *   }
+   *   arg {
+   *     name: "values"
+   *     floats: -0.028315347
+   *     ...
+   *   }
+   * }
+   */
+  auto dim = getShape(dict["shape"]);
+  auto const &values = dict["values"];
+  RETURN_ERR_IF_NOT(op.output_size() == 1,
+                    "GivenTensorFill must have exactly 1 output");
+  if (typeName == "GivenTensorFill") {
+    RETURN_IF_ERR(
+        fillTensor<float>(T, ElemKind::FloatTy, dim, values->floats()));
+  } else if (typeName == "GivenTensorIntFill") {
+    RETURN_IF_ERR(
+        fillTensor<int32_t>(T, ElemKind::Int32ITy, dim, values->ints()));
+  } else if (typeName == "GivenTensorInt64Fill") {
+    RETURN_IF_ERR(
+        fillTensor<int64_t>(T, ElemKind::Int64ITy, dim, values->ints()));
+  } else {
+    RETURN_ERR(strFormat("Unhandled tensor fill type: %s", typeName.c_str()));
+  }
+  return Error::success();
+}
+
 Error Caffe2ModelLoader::loadWeight(const caffe2::OperatorDef &op) {
   ArgumentDictionaryTy dict = loadArgumentMap(op);
   const std::string &typeName = op.type();
 
   // Load tensors with values:
-  if (typeName == "GivenTensorFill" || typeName == "GivenTensorIntFill" ||
-      typeName == "GivenTensorInt64Fill") {
-    /*
-     * op {
-     *   output: "conv1_w"
-     *   name: ""
-     *   type: "GivenTensorFill"
-     *   arg {
-     *     name: "shape"
-     *     ints: 96
-     *     ints: 3
-     *     ints: 11
-     *     ints: 11
-     *   }
-     *   arg {
-     *     name: "values"
-     *     floats: -0.028315347
-     *     ...
-     *   }
-     * }
-     */
-    auto dim = getShape(dict["shape"]);
-    auto const &values = dict["values"];
-    RETURN_ERR_IF_NOT(op.output_size() == 1,
-                      "GivenTensorFill must have exactly 1 output");
+  if (isGivenTensorFill(typeName)) {
     Tensor T;
-    if (typeName == "GivenTensorFill") {
-      RETURN_IF_ERR(
-          fillTensor<float>(T, ElemKind::FloatTy, dim, values->floats()));
-    } else if (typeName == "GivenTensorIntFill") {
-      RETURN_IF_ERR(
-          fillTensor<int32_t>(T, ElemKind::Int32ITy, dim, values->ints()));
-    } else if (typeName == "GivenTensorInt64Fill") {
-      RETURN_IF_ERR(
-          fillTensor<int64_t>(T, ElemKind::Int64ITy, dim, values->ints()));
-    } else {
-      RETURN_ERR(strFormat("Unhandled tensor fill type: %s", typeName.c_str()));
-    }
+    RETURN_IF_ERR(loadGivenTensorFill(op, dict, T));
     RETURN_IF_ERR(createAndRegisterConstant(op.output().Get(0), std::move(T)));
     return Error::success();
   }
@@ -1784,8 +1803,27 @@ Error Caffe2ModelLoader::loadWeight(const caffe2::OperatorDef &op) {
 }
 
 Error Caffe2ModelLoader::loadWeightsFromNet(caffe2::NetDef &net) {
-  for (auto &op : net.op()) {
-    RETURN_IF_ERR(loadWeight(op));
+  // Decode the given values of the weights in parallel, then load the weights
+  // in order, so that their Constants are created in the order of the ops.
+  const size_t numOps = net.op_size();
+  std::vector<Tensor> tensors(numOps);
+  RETURN_IF_ERR(runInParallel(numOps, [&](size_t i) -> Error {
+    const auto &op = net.op(i);
+    if (!isGivenTensorFill(op.type())) {
+      return Error::success();
+    }
+    ArgumentDictionaryTy dict = loadArgumentMap(op);
+    return loadGivenTensorFill(op, dict, tensors[i]);
+  }));
+
+  for (size_t i = 0; i < numOps; i++) {
+    const auto &op = net.op(i);
+    if (isGivenTensorFill(op.type())) {
+      RETURN_IF_ERR(
+          createAndRegisterConstant(op.output(0), std::move(tensors[i])));
+    } else {
+      RETURN_IF_ERR(loadWeight(op));
+    }
   }
   return Error::success();
 }
@@ -1799,7 +1837,8 @@ Caffe2ModelLoader::Caffe2ModelLoader(const std::string &netDescFilename,
                                      const std::string &netWeightFilename,
                                      llvm::ArrayRef<const char *> names,
                                      llvm::ArrayRef<TypeRef> types, Function &F,
-                                     Error *errPtr)
+                                     Error *errPtr,
+                                     llvm::ArrayRef<std::string> outputNames)
     : CommonOperatorLoader(names, types, F, errPtr) {
   // if errPtr already contains an error then don't continue with constructor
   if (errPtr && *errPtr) {
@@ -1817,6 +1856,25 @@ Caffe2ModelLoader::Caffe2ModelLoader(const std::string &netDescFilename,
     caffe2::NetDef weightsDef;
     ASSIGN_VALUE_OR_RETURN_ERR(weightsDef, loadProtoFile(netWeightFilename));
 
+    if (!outputNames.empty()) {
+      // Only the fill operators of the weights that the kept operators use
+      // are loaded.
+      auto usedNames = pruneOperators(*networkDef.mutable_op(), outputNames);
+      std::vector<std::string> usedWeights;
+      for (const auto &op : weightsDef.op()) {
+        for (const auto &output : op.output()) {
+          if (usedNames.count(output)) {
+            usedWeights.push_back(output);
+          }
+        }
+      }
+      pruneOperators(*weightsDef.mutable_op(), usedWeights);
+      networkDef.clear_external_output();
+      for (const auto &name : outputNames) {
+        networkDef.add_external_output(name);
+      }
+    }
+
     RETURN_IF_ERR(loadWeightsFromNet(weightsDef));
     RETURN_IF_ERR(loadNetwork(networkDef));
 
@@ -1840,13 +1898,18 @@ Caffe2ModelLoader::Caffe2ModelLoader(const std::string &netDescFilename,
 Caffe2ModelLoader::Caffe2ModelLoader(
     const void *model, uint32_t modelSize, uint32_t weightsCount,
     const onnxTensorDescriptorV1 *weightDescriptors, Function &F,
-    bool loadInputsAsPlaceholders, Error *errPtr)
+    bool loadInputsAsPlaceholders, Error *errPtr,
+    const llvm::StringMap<ShapeVector> *inputShapes)
     : CommonOperatorLoader({}, {}, F, errPtr) {
   // if errPtr already contains an error then don't continue with constructor
   if (errPtr && *errPtr) {
     return;
   }
 
+  if (inputShapes) {
+    inputShapes_ = *inputShapes;
+  }
+
   // Lambda to setup the Caffe2ModelLoader and return any Errors that were
   // raised.
   auto setup = [&]() -> Error {
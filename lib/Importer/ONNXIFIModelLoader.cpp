@@ -25,7 +25,8 @@ namespace glow {
 Expected<std::unique_ptr<ONNXIFIModelLoader>> ONNXIFIModelLoader::parse(
     const void *model, uint32_t modelSize, uint32_t weightsCount,
     const onnxTensorDescriptorV1 *weightDescriptors, Function &F,
-    bool loadInputsAsPlaceholders, bool use_onnx) {
+    bool loadInputsAsPlaceholders, bool use_onnx,
+    const llvm::StringMap<ShapeVector> *inputShapes) {
 
   std::unique_ptr<ONNXIFIModelLoader> loader(new ONNXIFIModelLoader());
   Error loaderConstructionErr = Error::empty();
@@ -33,7 +34,7 @@ Expected<std::unique_ptr<ONNXIFIModelLoader>> ONNXIFIModelLoader::parse(
   if (use_onnx) {
     std::unique_ptr<ONNXModelLoader> onnxLoader(new ONNXModelLoader(
         model, modelSize, weightsCount, weightDescriptors, F,
-        loadInputsAsPlaceholders, &loaderConstructionErr));
+        loadInputsAsPlaceholders, &loaderConstructionErr, inputShapes));
     if (loaderConstructionErr) {
       return std::move(loaderConstructionErr);
     }
@@ -43,7 +44,7 @@ Expected<std::unique_ptr<ONNXIFIModelLoader>> ONNXIFIModelLoader::parse(
     // Use Caffe2 Model loader
     std::unique_ptr<Caffe2ModelLoader> c2Loader(new Caffe2ModelLoader(
         model, modelSize, weightsCount, weightDescriptors, F,
-        loadInputsAsPlaceholders, &loaderConstructionErr));
+        loadInputsAsPlaceholders, &loaderConstructionErr, inputShapes));
     if (loaderConstructionErr) {
       return std::move(loaderConstructionErr);
     }
@@ -51,6 +52,12 @@ Expected<std::unique_ptr<ONNXIFIModelLoader>> ONNXIFIModelLoader::parse(
     loader->core_ = std::move(c2Loader);
   }
 
+  for (const auto &input : loader->getInputVarsMapping()) {
+    if (allowsPartialInput(input.second, &F)) {
+      input.second->setRagged();
+    }
+  }
+
   return Expected<std::unique_ptr<ONNXIFIModelLoader>>(std::move(loader));
 }
 } // namespace glow
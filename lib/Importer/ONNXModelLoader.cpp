@@ -20,12 +20,15 @@
 #include "glow/Graph/Nodes.h"
 
 #include "llvm/Support/Casting.h"
+#include "llvm/Support/Path.h"
 
 #include "google/protobuf/io/coded_stream.h"
 #include "google/protobuf/io/zero_copy_stream_impl.h"
 
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <fstream>
 #include <sstream>
 #include <string>
@@ -88,7 +91,9 @@ Error ONNXModelLoader::loadInputs(ONNX_NAMESPACE::GraphProto &net,
 
       Placeholder *placeholder;
       ASSIGN_VALUE_OR_RETURN_ERR(
-          placeholder, createAndRegisterPlaceholder(in.name(), &T.getType()));
+          placeholder,
+          createAndRegisterPlaceholder(
+              in.name(), getInputType(in.name(), &T.getType())));
       inputVarsByName_.try_emplace(in.name(), placeholder);
     } else {
       Tensor T;
@@ -143,7 +148,7 @@ Expected<ElemKind> ONNXModelLoader::convertTensorProtoDataType(
   RETURN_ERR("Non supported ONNX type");
 }
 
-Error ONNXModelLoader::setVersion(ONNX_NAMESPACE::ModelProto MP) {
+Error ONNXModelLoader::setVersion(const ONNX_NAMESPACE::ModelProto &MP) {
   irVersion_ = MP.ir_version();
   opsetVersion_ = 0;
   RETURN_ERR_IF_NOT(
@@ -267,6 +272,13 @@ Expected<Pads> getPads(const ArgumentDictionaryTy &dict,
   return Pads({0, 0, 0, 0});
 }
 
+/// Copies the raw data of \p in into the payload of \p T, which has its type.
+static void copyRawData(const ONNX_NAMESPACE::TensorProto &in, Tensor *T) {
+  const std::string &data = in.raw_data();
+  memcpy(T->getUnsafePtr(), data.data(),
+         std::min(data.size(), T->getSizeInBytes()));
+}
+
 /// Loads tensor \p T from the input \p in.
 static Error loadTensor(const ONNX_NAMESPACE::TensorProto &in, Tensor *T) {
   std::vector<size_t> dim;
@@ -284,8 +296,7 @@ static Error loadTensor(const ONNX_NAMESPACE::TensorProto &in, Tensor *T) {
         TH.raw(i++) = f;
       }
     } else if (in.has_raw_data()) {
-      std::istringstream inStream(in.raw_data(), std::stringstream::binary);
-      inStream.read(T->getUnsafePtr(), T->size() * sizeof(float));
+      copyRawData(in, T);
     } else {
       RETURN_ERR("Unsupported Tensor format.",
                  ErrorValue::ErrorCode::MODEL_LOADER_UNSUPPORTED_DATATYPE);
@@ -300,8 +311,7 @@ static Error loadTensor(const ONNX_NAMESPACE::TensorProto &in, Tensor *T) {
         TH.raw(i++) = f;
       }
     } else if (in.has_raw_data()) {
-      std::istringstream inStream(in.raw_data(), std::stringstream::binary);
-      inStream.read(T->getUnsafePtr(), T->size() * sizeof(int64_t));
+      copyRawData(in, T);
     } else {
       RETURN_ERR("Unsupported Tensor format.",
                  ErrorValue::ErrorCode::MODEL_LOADER_UNSUPPORTED_DATATYPE);
@@ -318,8 +328,7 @@ static Error loadTensor(const ONNX_NAMESPACE::TensorProto &in, Tensor *T) {
         TH.raw(i++) = f;
       }
     } else if (in.has_raw_data()) {
-      std::istringstream inStream(in.raw_data(), std::stringstream::binary);
-      inStream.read(T->getUnsafePtr(), T->size() * sizeof(int32_t));
+      copyRawData(in, T);
     } else {
       RETURN_ERR("Unsupported Tensor format.",
                  ErrorValue::ErrorCode::MODEL_LOADER_UNSUPPORTED_DATATYPE);
@@ -327,8 +336,7 @@ static Error loadTensor(const ONNX_NAMESPACE::TensorProto &in, Tensor *T) {
   } else if (in.data_type() == ONNX_NAMESPACE::TensorProto::BOOL) {
     T->reset(ElemKind::BoolTy, dim);
     if (in.has_raw_data()) {
-      std::istringstream inStream(in.raw_data(), std::stringstream::binary);
-      inStream.read(T->getUnsafePtr(), T->size() * sizeof(bool));
+      copyRawData(in, T);
     } else {
       RETURN_ERR("Unsupported Tensor format.",
                  ErrorValue::ErrorCode::MODEL_LOADER_UNSUPPORTED_DATATYPE);
@@ -809,6 +817,55 @@ Error ONNXModelLoader::loadBatchNormalization(
   return Error::success();
 }
 
+Error ONNXModelLoader::loadLayerNormalization(
+    const ONNX_NAMESPACE::NodeProto &op, const ArgumentDictionaryTy &dict) {
+  const std::string &opName = loadOperatorName(op);
+
+  NodeValue in;
+  ASSIGN_VALUE_OR_RETURN_ERR(in, getNodeValueByName(op.input(0)));
+  NodeValue scale;
+  ASSIGN_VALUE_OR_RETURN_ERR(scale, getNodeValueByName(op.input(1)));
+
+  // The dimensions from axis to the last one are normalized.
+  int axis = -1; // default
+  if (dict.count("axis")) {
+    ASSIGN_VALUE_OR_RETURN_ERR(axis, loadInt(dict.at("axis")));
+  }
+  const int numDims = in.dims().size();
+  if (axis < 0) {
+    axis += numDims;
+  }
+  RETURN_ERR_IF_NOT(axis >= 0 && axis < numDims,
+                    "LayerNormalization axis must be within the input dims.");
+  RETURN_ERR_IF_NOT(scale.dims() == in.dims().slice(axis),
+                    "LayerNormalization Scale must have the normalized dims.");
+
+  // The bias is optional, in which case it is zero.
+  NodeValue bias;
+  if (op.input_size() > 2 && !op.input(2).empty()) {
+    ASSIGN_VALUE_OR_RETURN_ERR(bias, getNodeValueByName(op.input(2)));
+  } else {
+    Tensor biasTensor(scale.getType());
+    biasTensor.zero();
+    bias = G_.getParent()->createConstant(opName + ".bias",
+                                          std::move(biasTensor));
+  }
+
+  float epsilon = 1e-5f; // default
+  auto epsilonIt = dict.find("epsilon");
+  if (epsilonIt != dict.end()) {
+    ASSIGN_VALUE_OR_RETURN_ERR(epsilon, loadFloat(epsilonIt->second));
+  }
+
+  auto *node = G_.createLayerNormalization(opName, in, scale, bias, epsilon);
+
+  // The optional Mean and InvStdDev outputs are not supported, so only the
+  // normalized output is registered, as in loadBatchNormalization.
+  RETURN_IF_ERR(addNodeAsOutput(op, node, 1));
+
+  return Error::success();
+}
+
 Error ONNXModelLoader::loadConcat(const ONNX_NAMESPACE::NodeProto &op,
                                   const ArgumentDictionaryTy &dict) {
   const std::string &opName = loadOperatorName(op);
@@ -1549,6 +1606,9 @@ Error ONNXModelLoader::loadOperator(const ONNX_NAMESPACE::NodeProto &op) {
   if (typeName == "BatchNormalization") {
     return loadBatchNormalization(op, dict);
   }
+  if (typeName == "LayerNormalization") {
+    return loadLayerNormalization(op, dict);
+  }
   if (typeName == "Concat") {
     return loadConcat(op, dict);
   }
@@ -1651,16 +1711,123 @@ Error ONNXModelLoader::loadOperator(const ONNX_NAMESPACE::NodeProto &op) {
              ErrorValue::ErrorCode::MODEL_LOADER_UNSUPPORTED_OPERATOR);
 }
 
+Error ONNXModelLoader::loadInitializerTensor(ONNX_NAMESPACE::TensorProto &in,
+                                             Tensor &T,
+                                             std::shared_ptr<void> &storage) {
+  if (!in.has_raw_data()) {
+    return loadTensor(in, &T);
+  }
+  auto kind = convertTensorProtoDataType(
+      static_cast<ONNX_NAMESPACE::TensorProto_DataType>(in.data_type()));
+  if (!kind) {
+    ERR_TO_VOID(kind.takeError());
+    return loadTensor(in, &T);
+  }
+  std::vector<size_t> dims(in.dims().begin(), in.dims().end());
+  Type ty(*kind, dims);
+  const std::string &data = in.raw_data();
+  if (data.size() != ty.getSizeInBytes() ||
+      reinterpret_cast<uintptr_t>(data.data()) % ty.getElementSize() != 0) {
+    return loadTensor(in, &T);
+  }
+
+  // The raw data has the layout of the payload: take it from the proto, and
+  // make T point into it.
+  std::shared_ptr<std::string> payload(in.release_raw_data());
+  T = Tensor(&(*payload)[0], &ty);
+  storage = std::move(payload);
+  return Error::success();
+}
+
 Error ONNXModelLoader::loadInitializers(ONNX_NAMESPACE::GraphProto &net) {
-  // Load the network initializaers:
-  for (const auto &in : net.initializer()) {
-    Tensor T;
-    RETURN_IF_ERR(loadTensor(in, &T));
-    RETURN_IF_ERR(createAndRegisterConstant(in.name(), std::move(T)));
+  // Decode the initializers in parallel, then create their Constants in
+  // order. External tensors share the mappings of their files in the loader,
+  // they are loaded on this thread.
+  auto &initializers = *net.mutable_initializer();
+  const size_t numInitializers = initializers.size();
+  std::vector<Tensor> tensors(numInitializers);
+  std::vector<std::shared_ptr<void>> storage(numInitializers);
+  RETURN_IF_ERR(runInParallel(numInitializers, [&](size_t i) -> Error {
+    auto &in = initializers[i];
+    if (in.data_location() == ONNX_NAMESPACE::TensorProto::EXTERNAL) {
+      return Error::success();
+    }
+    return loadInitializerTensor(in, tensors[i], storage[i]);
+  }));
+
+  for (size_t i = 0; i < numInitializers; i++) {
+    const auto &in = initializers[i];
+    if (in.data_location() == ONNX_NAMESPACE::TensorProto::EXTERNAL) {
+      RETURN_IF_ERR(loadExternalTensor(in, tensors[i]));
+    }
+    if (storage[i]) {
+      G_.getParent()->addExternalStorage(std::move(storage[i]));
+    }
+    RETURN_IF_ERR(createAndRegisterConstant(in.name(), std::move(tensors[i])));
   }
   return Error::success();
 }
 
+void ONNXModelLoader::pruneToOutputs(ONNX_NAMESPACE::GraphProto &net,
+                                     llvm::ArrayRef<std::string> outputNames) {
+  auto usedNames = pruneOperators(*net.mutable_node(), outputNames);
+
+  // Drop the initializers and inputs that no kept node uses, so that their
+  // data is never read.
+  google::protobuf::RepeatedPtrField<ONNX_NAMESPACE::TensorProto> initializers;
+  for (auto &in : *net.mutable_initializer()) {
+    if (usedNames.count(in.name())) {
+      initializers.Add()->Swap(&in);
+    }
+  }
+  net.mutable_initializer()->Swap(&initializers);
+
+  google::protobuf::RepeatedPtrField<ONNX_NAMESPACE::ValueInfoProto> inputs;
+  for (auto &in : *net.mutable_input()) {
+    if (usedNames.count(in.name())) {
+      inputs.Add()->Swap(&in);
+    }
+  }
+  net.mutable_input()->Swap(&inputs);
+
+  net.clear_output();
+  for (const auto &name : outputNames) {
+    net.add_output()->set_name(name);
+  }
+}
+
+Error ONNXModelLoader::loadExternalTensor(const ONNX_NAMESPACE::TensorProto &in,
+                                          Tensor &T) {
+  std::string location;
+  uint64_t offset = 0;
+  uint64_t length = 0;
+  for (const auto &entry : in.external_data()) {
+    llvm::StringRef value = entry.value();
+    if (entry.key() == "location") {
+      location = value.str();
+    } else if (entry.key() == "offset") {
+      RETURN_ERR_IF_NOT(!value.getAsInteger(10, offset),
+                        "Invalid offset of external tensor " + in.name());
+    } else if (entry.key() == "length") {
+      RETURN_ERR_IF_NOT(!value.getAsInteger(10, length),
+                        "Invalid length of external tensor " + in.name());
+    }
+  }
+  RETURN_ERR_IF_NOT(!location.empty(),
+                    "Missing location of external tensor " + in.name());
+
+  ElemKind kind;
+  ASSIGN_VALUE_OR_RETURN_ERR(
+      kind, convertTensorProtoDataType(
+                static_cast<ONNX_NAMESPACE::TensorProto_DataType>(
+                    in.data_type())));
+  std::vector<size_t> dims(in.dims().begin(), in.dims().end());
+  Type ty(kind, dims);
+  RETURN_ERR_IF_NOT(!length || length == ty.getSizeInBytes(),
+                    "Mismatched length of external tensor " + in.name());
+  return loadExternalData(location, offset, ty, T);
+}
+
 Error ONNXModelLoader::setOutputNodes(ONNX_NAMESPACE::GraphProto &net) {
   if (net.output_size() == 0) {
     RETURN_ERR("Net output size must be greater than 0");
@@ -1736,13 +1903,17 @@ Error ONNXModelLoader::checkInputs(ONNX_NAMESPACE::GraphProto &net,
 ONNXModelLoader::ONNXModelLoader(const std::string &modelDescFilename,
                                  llvm::ArrayRef<const char *> tensorNames,
                                  llvm::ArrayRef<TypeRef> types, Function &F,
-                                 Error *errPtr)
+                                 Error *errPtr,
+                                 llvm::ArrayRef<std::string> outputNames)
     : CommonOperatorLoader(tensorNames, types, F, errPtr) {
   // if errPtr already contains an error then don't continue with constructor
   if (errPtr && *errPtr) {
     return;
   }
 
+  // The relative locations of external weights are relative to the model.
+  externalDataDir_ = llvm::sys::path::parent_path(modelDescFilename).str();
+
   // Lambda to setup the ONNXModelLoader and return any Errors that were
   // raised.
   auto setup = [&]() -> Error {
@@ -1752,7 +1923,11 @@ ONNXModelLoader::ONNXModelLoader(const std::string &modelDescFilename,
 
     RETURN_IF_ERR(setVersion(modelDef));
 
-    ONNX_NAMESPACE::GraphProto graphDef = modelDef.graph();
+    ONNX_NAMESPACE::GraphProto graphDef;
+    graphDef.Swap(modelDef.mutable_graph());
+    if (!outputNames.empty()) {
+      pruneToOutputs(graphDef, outputNames);
+    }
     RETURN_IF_ERR(checkInputs(graphDef, tensorNames, types));
 
     RETURN_IF_ERR(loadInitializers(graphDef));
@@ -1783,13 +1958,18 @@ ONNXModelLoader::ONNXModelLoader(const std::string &modelDescFilename,
 ONNXModelLoader::ONNXModelLoader(
     const void *model, uint32_t modelSize, uint32_t weightsCount,
     const onnxTensorDescriptorV1 *weightDescriptors, Function &F,
-    bool loadInputsAsPlaceholders, Error *errPtr)
+    bool loadInputsAsPlaceholders, Error *errPtr,
+    const llvm::StringMap<ShapeVector> *inputShapes)
     : CommonOperatorLoader({}, {}, F, errPtr) {
   // if errPtr already contains an error then don't continue with constructor
   if (errPtr && *errPtr) {
     return;
   }
 
+  if (inputShapes) {
+    inputShapes_ = *inputShapes;
+  }
+
   // Lambda to setup the ONNXModelLoader and return any Errors that were
   // raised.
   auto setup = [&]() -> Error {
@@ -1800,7 +1980,8 @@ ONNXModelLoader::ONNXModelLoader(
 
     RETURN_IF_ERR(loadWeights(weightsCount, weightDescriptors));
 
-    ONNX_NAMESPACE::GraphProto graphDef = modelDef.graph();
+    ONNX_NAMESPACE::GraphProto graphDef;
+    graphDef.Swap(modelDef.mutable_graph());
 
     RETURN_IF_ERR(loadInputs(graphDef, loadInputsAsPlaceholders));
 
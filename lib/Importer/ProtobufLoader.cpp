@@ -15,8 +15,15 @@
  */
 
 #include "glow/Importer/ProtobufLoader.h"
+#include "llvm/ADT/SmallString.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Process.h"
+#include <algorithm>
+#include <atomic>
+#include <fstream>
 #include <string>
+#include <thread>
 
 namespace glow {
 
@@ -28,6 +35,18 @@ static llvm::cl::opt<bool> isConstFoldLoaderOps(
         "Performs constant folding on ONNX and Caffe Operators while loading."),
     llvm::cl::init(false), llvm::cl::cat(loaderOptCat));
 
+static llvm::cl::opt<bool> mmapExternalWeights(
+    "mmap-external-weights",
+    llvm::cl::desc("Map the files of external weights of models in memory "
+                   "instead of reading them into the Constants."),
+    llvm::cl::init(true), llvm::cl::cat(loaderOptCat));
+
+static llvm::cl::opt<unsigned> loaderThreads(
+    "loader-threads",
+    llvm::cl::desc("Number of threads decoding the weights of models. 0 uses "
+                   "a thread per core."),
+    llvm::cl::init(0), llvm::cl::cat(loaderOptCat));
+
 bool isArrayConstant(llvm::ArrayRef<size_t> a) {
   for (size_t i = 1; i < a.size(); i++)
     if (a[0] != a[i])
@@ -129,6 +148,116 @@ Error ProtobufLoader::createAndRegisterConstant(llvm::StringRef name,
   return Error::success();
 }
 
+Error ProtobufLoader::loadExternalData(llvm::StringRef location,
+                                       uint64_t offset, const Type &ty,
+                                       Tensor &T) {
+  llvm::SmallString<128> path(location);
+  if (llvm::sys::path::is_relative(path)) {
+    path = externalDataDir_;
+    llvm::sys::path::append(path, location);
+  }
+  uint64_t size = ty.getSizeInBytes();
+
+  if (!mmapExternalWeights) {
+    std::ifstream ff(path.str(), std::ios::in | std::ios::binary);
+    RETURN_ERR_IF_NOT(ff,
+                      strFormat("Can't open the external weights file %s.",
+                                path.c_str()),
+                      ErrorValue::ErrorCode::MODEL_LOADER_INVALID_PROTOBUF);
+    T.reset(ty);
+    ff.seekg(offset);
+    ff.read(T.getUnsafePtr(), size);
+    RETURN_ERR_IF_NOT(ff.gcount() == std::streamsize(size),
+                      strFormat("The external weights file %s is too short.",
+                                path.c_str()),
+                      ErrorValue::ErrorCode::MODEL_LOADER_INVALID_PROTOBUF);
+    return Error::success();
+  }
+
+  // Every file is mapped once, as a whole, for all the weights in it.
+  auto &mapping = mappedFiles_[path];
+  if (!mapping) {
+    int fd;
+    RETURN_ERR_IF_NOT(!llvm::sys::fs::openFileForRead(path, fd),
+                      strFormat("Can't open the external weights file %s.",
+                                path.c_str()),
+                      ErrorValue::ErrorCode::MODEL_LOADER_INVALID_PROTOBUF);
+    uint64_t fileSize = 0;
+    std::error_code EC = llvm::sys::fs::file_size(path, fileSize);
+    if (!EC && fileSize) {
+      // The mapping is private so that optimizations may change the payloads
+      // of the Constants without writing to the file.
+      mapping = std::make_shared<llvm::sys::fs::mapped_file_region>(
+          fd, llvm::sys::fs::mapped_file_region::priv, fileSize, 0, EC);
+    }
+    llvm::sys::Process::SafelyCloseFileDescriptor(fd);
+    RETURN_ERR_IF_NOT(!EC && fileSize,
+                      strFormat("Can't map the external weights file %s.",
+                                path.c_str()),
+                      ErrorValue::ErrorCode::MODEL_LOADER_INVALID_PROTOBUF);
+    G_.getParent()->addExternalStorage(mapping);
+  }
+
+  RETURN_ERR_IF_NOT(offset + size <= mapping->size(),
+                    strFormat("The external weights file %s is too short.",
+                              path.c_str()),
+                    ErrorValue::ErrorCode::MODEL_LOADER_INVALID_PROTOBUF);
+  char *data = mapping->data() + offset;
+  if (reinterpret_cast<uintptr_t>(data) % ty.getElementSize() != 0) {
+    T.reset(ty);
+    memcpy(T.getUnsafePtr(), data, size);
+    return Error::success();
+  }
+  T = Tensor(data, &ty);
+  return Error::success();
+}
+
+Error ProtobufLoader::runInParallel(size_t numJobs,
+                                    const std::function<Error(size_t)> &job) {
+  size_t numThreads =
+      loaderThreads ? loaderThreads : std::thread::hardware_concurrency();
+  numThreads = std::min(numThreads, numJobs);
+  if (numThreads <= 1) {
+    for (size_t i = 0; i < numJobs; i++) {
+      RETURN_IF_ERR(job(i));
+    }
+    return Error::success();
+  }
+
+  std::vector<Error> errs;
+  errs.reserve(numJobs);
+  for (size_t i = 0; i < numJobs; i++) {
+    errs.emplace_back(Error::empty());
+  }
+  std::atomic<size_t> nextJob{0};
+  auto runJobs = [&]() {
+    for (size_t i = nextJob++; i < numJobs; i = nextJob++) {
+      errs[i] = job(i);
+    }
+  };
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < numThreads; i++) {
+    threads.emplace_back(runJobs);
+  }
+  runJobs();
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  // Report the error of the first job that failed, like a sequential run.
+  size_t failed = 0;
+  while (failed < numJobs && !errs[failed]) {
+    failed++;
+  }
+  if (failed == numJobs) {
+    return Error::success();
+  }
+  for (size_t i = failed + 1; i < numJobs; i++) {
+    ERR_TO_VOID(std::move(errs[i]));
+  }
+  return std::move(errs[failed]);
+}
+
 void ProtobufLoader::deleteUnusedConstants() {
   std::vector<std::string> nodeValuesToRemove;
   for (auto &kv : nodeValueByName_) {
@@ -160,6 +289,14 @@ ProtobufLoader::createAndRegisterPlaceholder(llvm::StringRef name, TypeRef T) {
   return node;
 }
 
+TypeRef ProtobufLoader::getInputType(llvm::StringRef name, TypeRef T) {
+  auto it = inputShapes_.find(name);
+  if (it == inputShapes_.end() || it->second.size() != T->dims().size()) {
+    return T;
+  }
+  return G_.getParent()->uniqueTypeWithNewShape(T, it->second);
+}
+
 bool ProtobufLoader::hasNodeByName(llvm::StringRef name) const {
   return getNodeValueByNameOrNullNodeValue(name).getNode() != nullptr;
 }
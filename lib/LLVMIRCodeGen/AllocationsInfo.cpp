@@ -90,7 +90,8 @@ void AllocationsInfo::allocateWeightVars(const IRFunction *F) {
   });
 }
 
-void AllocationsInfo::allocateActivations(const IRFunction *F) {
+void AllocationsInfo::allocateActivations(const IRFunction *F,
+                                          bool planOffline) {
   // Use a memory allocator with no upper bound on how much memory we can
   // allocate.
   MemoryAllocator activationsAllocator("Activations", 0);
@@ -99,20 +100,25 @@ void AllocationsInfo::allocateActivations(const IRFunction *F) {
   llvm::DenseMap<const Value *, uint64_t> activationAddr;
 
   // Assign device-space addresses to the activations.
-  for (const auto &I : F->getInstrs()) {
-    if (auto *A = dyn_cast<AllocActivationInst>(&I)) {
-      auto numBytes = I.getSizeInBytes();
-      size_t addr = activationsAllocator.allocate(numBytes, A);
-      assert(!activationAddr.count(A) && "Allocation already made!");
-      activationAddr[A] = addr;
-      continue;
-    }
+  if (planOffline) {
+    activationAddr = planActivations(F->getInstrs(), activationsAllocator,
+                                     /* reuseMemory */ true);
+  } else {
+    for (const auto &I : F->getInstrs()) {
+      if (auto *A = dyn_cast<AllocActivationInst>(&I)) {
+        auto numBytes = I.getSizeInBytes();
+        size_t addr = activationsAllocator.allocate(numBytes, A);
+        assert(!activationAddr.count(A) && "Allocation already made!");
+        activationAddr[A] = addr;
+        continue;
+      }
 
-    if (auto *D = dyn_cast<DeallocActivationInst>(&I)) {
-      auto *A = D->getAlloc();
-      assert(activationAddr.count(A) && "Invalid deallocation!");
-      activationsAllocator.deallocate(A);
-      continue;
+      if (auto *D = dyn_cast<DeallocActivationInst>(&I)) {
+        auto *A = D->getAlloc();
+        assert(activationAddr.count(A) && "Invalid deallocation!");
+        activationsAllocator.deallocate(A);
+        continue;
+      }
     }
   }
 
@@ -142,11 +148,11 @@ static size_t calculateTensorViewOffset(const TensorViewInst *TVI) {
     // Calculate and store the length of the current tensorview's offset
     // into the source of the tensorview. Note that this source may be
     // another tensorview.
-    size_t currOffsetLength =
-        currTVI->getOffsets().empty() ? 0 : currTVI->getOffsets()[0];
+    size_t currOffsetLength = 0;
     auto *tvSource = currTVI->getSrc();
-    for (size_t i = 1; i < tvSource->dims().size(); ++i) {
-      currOffsetLength *= tvSource->dims()[i];
+    auto offsets = currTVI->getOffsets();
+    for (size_t i = 0; i < offsets.size(); ++i) {
+      currOffsetLength += offsets[i] * tvSource->getType()->strides()[i];
     }
 
     // Increment the running total offset length which will be used to store
@@ -19,16 +19,21 @@
 
 #include "glow/LLVMIRCodeGen/LLVMBackend.h"
 
+#include "glow/Backend/BackendUtils.h"
+#include "glow/CodeGen/MemoryAllocator.h"
 #include "glow/Graph/Graph.h"
 #include "glow/Graph/PlaceholderBindings.h"
 #include "glow/IR/Instrs.h"
 #include "glow/Support/Debug.h"
 
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/Bitcode/BitcodeReader.h"
 #include "llvm/Bitcode/BitcodeWriter.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/IR/Module.h"
+#include "llvm/Linker/Linker.h"
 #include "llvm/Support/Casting.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/FileSystem.h"
@@ -72,6 +77,47 @@ llvm::cl::opt<BundleApiType> bundleApi(
                                 "Dynamic API"),
                      clEnumValN(BundleApiType::Static, "static", "Static API")),
     llvm::cl::init(BundleApiType::Dynamic), llvm::cl::cat(bundleSaverCat));
+
+llvm::cl::opt<bool> bundleParallelRunner(
+    "bundle-parallel-runner",
+    llvm::cl::desc("Give the bundle entry point a parallel runner argument "
+                   "that the parallel kernels split their work with"),
+    llvm::cl::init(false), llvm::cl::cat(bundleSaverCat));
+
+/// Format of the weights file of a bundle.
+enum class BundleWeightsFormat {
+  /// The constant weights area as is.
+  Flat,
+  /// A header table of the constants followed by the constant weights area
+  /// at a page aligned offset, so that the file can be mapped in memory and
+  /// passed as constantWeight without reading or copying it.
+  Mapped,
+};
+
+llvm::cl::opt<BundleWeightsFormat> bundleWeightsFormat(
+    "bundle-weights-format",
+    llvm::cl::desc("Specify the format of the bundle weights file."),
+    llvm::cl::values(clEnumValN(BundleWeightsFormat::Flat, "flat",
+                                "The constant weights area"),
+                     clEnumValN(BundleWeightsFormat::Mapped, "mapped",
+                                "A header table and the page aligned "
+                                "constant weights area, to be mapped")),
+    llvm::cl::init(BundleWeightsFormat::Flat), llvm::cl::cat(bundleSaverCat));
+
+llvm::cl::opt<unsigned> bundleWeightsPageSize(
+    "bundle-weights-page-size",
+    llvm::cl::desc("Page size that the constant weights area of a mapped "
+                   "weights file is aligned to"),
+    llvm::cl::init(4096), llvm::cl::cat(bundleSaverCat));
+
+/// Magic number at the start of a mapped weights file.
+const char weightsFileMagic[8] = {'G', 'L', 'O', 'W', 'W', 'G', 'T', 'S'};
+
+/// Version of the mapped weights file format.
+constexpr uint32_t weightsFileVersion = 1;
+
+/// Name of the libjit variable holding the runner of libjit_parallel_for.
+const char *parallelRunnerVarName = "glow_libjit_parallel_runner";
 } // namespace
 
 /// Header file string template.
@@ -81,6 +127,7 @@ static const char *headerFileTemplate =
 #ifndef _GLOW_BUNDLE_%s_H
 #define _GLOW_BUNDLE_%s_H
 
+#include <stddef.h>
 #include <stdint.h>
 
 // ---------------------------------------------------------------
@@ -154,6 +201,50 @@ struct BundleConfig {
 };
 )RAW";
 
+/// Header file common definitions for bundles with a parallel runner.
+static const char *parallelRunnerCommonDefines = R"RAW(
+// Body of a parallel loop which processes the iterations [begin, end) of the
+// outer loop of a kernel described by ctx.
+typedef void (*GlowParallelBody)(size_t begin, size_t end, void *ctx);
+
+// Parallel runner provided by the caller of a bundle. It processes the
+// iterations [0, numIters) of body, split in ranges across its threads, and
+// returns once all of them are done.
+typedef void (*GlowParallelRunner)(size_t numIters, GlowParallelBody body,
+                                   void *ctx);
+)RAW";
+
+/// Header file common definitions for the mapped weights file format.
+static const char *mappedWeightsCommonDefines = R"RAW(
+// Header at offset 0 of a mapped weights file. The file is meant to be mapped
+// read-only in memory, and the constant weights area at dataOffset, which is
+// page aligned, to be passed as constantWeight. All fields are little-endian.
+struct GlowWeightsFileHeader {
+  // "GLOWWGTS".
+  char magic[8];
+  // Version of the format, 1.
+  uint32_t version;
+  // Number of entries of the table that follows the header.
+  uint32_t numEntries;
+  // Offset of the constant weights area in the file.
+  uint64_t dataOffset;
+  // Size of the constant weights area.
+  uint64_t dataSize;
+  // Alignment of the constants inside the constant weights area.
+  uint64_t alignment;
+};
+
+// Entry of the table of the constants of a mapped weights file.
+struct GlowWeightsFileEntry {
+  // Offset in the file of the NUL terminated name of the constant.
+  uint64_t nameOffset;
+  // Offset of the constant inside the constant weights area.
+  uint64_t offset;
+  // Size of the constant in bytes.
+  uint64_t size;
+};
+)RAW";
+
 /// Header file common definitions for static API.
 static const char *staticApiCommonDefines = R"RAW(
 // Memory alignment definition with given alignment size
@@ -166,11 +257,15 @@ static const char *staticApiCommonDefines = R"RAW(
 #define GLOW_GET_ADDR(mutableBaseAddr, placeholderOff)  (((uint8_t*)(mutableBaseAddr)) + placeholderOff)
 )RAW";
 
-/// Utility function to serialize a binary file to text file as a C array.
+/// Utility function to serialize a binary file to text file as a C array,
+/// starting at \p offset.
 static void serializeBinaryToText(llvm::StringRef binFileName,
-                                  llvm::StringRef txtFileName) {
+                                  llvm::StringRef txtFileName,
+                                  uint64_t offset = 0) {
   FILE *inpFile = fopen(binFileName.str().c_str(), "rb");
   CHECK(inpFile) << "Could not open binary input file: " << binFileName.str();
+  CHECK(!fseek(inpFile, offset, SEEK_SET))
+      << "Could not seek in binary input file: " << binFileName.str();
   FILE *outFile = fopen(txtFileName.str().c_str(), "w");
   CHECK(outFile) << "Could not open text output file: " << txtFileName.str();
   const size_t numBytesPerLine = 20;
@@ -189,31 +284,88 @@ static void serializeBinaryToText(llvm::StringRef binFileName,
   fclose(outFile);
 }
 
-BundleSaver::BundleSaver(const IRFunction *F, const LLVMBackend &llvmBackend)
-    : F_(F), irgen_(llvmBackend.createIRGen(F_, allocationsInfo_)) {}
+BundleSaver::BundleSaver(llvm::ArrayRef<SavedIRFunction> functions,
+                         const LLVMBackend &llvmBackend)
+    : planActivationsOffline_(llvmBackend.shouldPlanActivationsOffline()) {
+  CHECK(!functions.empty()) << "A bundle needs at least one entry point";
+  llvm::StringSet<> entryNames;
+  for (auto &savedF : functions) {
+    CHECK(entryNames.insert(savedF.entryName).second)
+        << "Duplicate bundle entry point: " << savedF.entryName;
+    auto entry = llvm::make_unique<Entry>();
+    entry->name = savedF.entryName;
+    entry->F = savedF.savedF;
+    entry->irgen = llvmBackend.createIRGen(entry->F, entry->allocationsInfo);
+    entries_.push_back(std::move(entry));
+  }
+}
+
+/// Appends the little-endian representation of \p value to \p buf.
+template <typename T>
+static void appendLittleEndian(std::string &buf, T value) {
+  for (size_t i = 0; i < sizeof(T); i++) {
+    buf.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+  }
+}
 
-void BundleSaver::saveWeights(llvm::StringRef weightsFileName) {
+std::string BundleSaver::getMappedWeightsHeader() {
+  auto numEntries = constants_.size();
+  uint64_t tableSize =
+      sizeof(weightsFileMagic) + 2 * sizeof(uint32_t) + 3 * sizeof(uint64_t) +
+      numEntries * 3 * sizeof(uint64_t);
+  std::string names;
+  std::string table;
+  for (auto &c : constants_) {
+    appendLittleEndian<uint64_t>(table, tableSize + names.size());
+    appendLittleEndian<uint64_t>(table, c.addr);
+    appendLittleEndian<uint64_t>(table, c.w->getSizeInBytes());
+    names += c.w->getName();
+    names.push_back('\0');
+  }
+  uint64_t dataOffset =
+      llvm::alignTo(tableSize + names.size(), bundleWeightsPageSize);
+
+  std::string header(weightsFileMagic, sizeof(weightsFileMagic));
+  appendLittleEndian<uint32_t>(header, weightsFileVersion);
+  appendLittleEndian<uint32_t>(header, numEntries);
+  appendLittleEndian<uint64_t>(header, dataOffset);
+  appendLittleEndian<uint64_t>(header, constantWeightVarsMemSize_);
+  appendLittleEndian<uint64_t>(header, TensorAlignment);
+  header += table;
+  header += names;
+  header.resize(dataOffset, '\0');
+  return header;
+}
+
+uint64_t BundleSaver::saveWeights(llvm::StringRef weightsFileName) {
   std::error_code EC;
   llvm::raw_fd_ostream weightsFile(weightsFileName, EC, llvm::sys::fs::F_None);
   CHECK(!EC) << "Could not open the output file for saving the bundle weights "
                 "with file name: "
              << weightsFileName.str();
+  // Write the header table of the mapped format, the constant weights area
+  // follows it.
+  uint64_t dataOffset = 0;
+  if (bundleWeightsFormat == BundleWeightsFormat::Mapped) {
+    auto header = getMappedWeightsHeader();
+    weightsFile << header;
+    dataOffset = header.size();
+  }
   // Serialize only constant weights.
   // Do not serialize mutable weights representing inputs and outputs, because
   // it should be configurable and set by the client.
   size_t pos = 0;
   size_t maxPos = 0;
-  for (auto &v : F_->findConstants()) {
-    auto *w = cast<WeightVar>(F_->getWeightForNode(v));
-    auto numBytes = w->getSizeInBytes();
-    auto payload = v->getPayload().getUnsafePtr();
-    auto addr = allocationsInfo_.allocatedAddress_[w];
+  for (auto &c : constants_) {
+    auto numBytes = c.w->getSizeInBytes();
+    auto payload = cast<Constant>(c.node)->getPayload().getUnsafePtr();
+    auto addr = c.addr;
     if (addr < pos) {
       // The payload was written already. It aliases something we have seen
       // already.
       continue;
     }
-    weightsFile.seek(addr);
+    weightsFile.seek(dataOffset + addr);
     CHECK(!weightsFile.has_error()) << "Could not set file write position";
     weightsFile.write(payload, numBytes);
     CHECK(!weightsFile.has_error()) << "Could not write bytes";
@@ -222,35 +374,41 @@ void BundleSaver::saveWeights(llvm::StringRef weightsFileName) {
   }
   // Make sure that the file is as long as the constantWeightVarsMemSize_.
   // This is needed to properly handle alignments.
-  weightsFile.seek(maxPos);
-  for (size_t endPos = irgen_->getAllocationsInfo().constantWeightVarsMemSize_;
-       maxPos < endPos; maxPos++) {
+  weightsFile.seek(dataOffset + maxPos);
+  for (size_t endPos = constantWeightVarsMemSize_; maxPos < endPos; maxPos++) {
     weightsFile.write(0);
   }
   weightsFile.close();
+  return dataOffset;
 }
 
 void BundleSaver::saveHeader(llvm::StringRef headerFileName) {
-  auto bundleName = irgen_->getBundleName();
+  auto bundleName = getMainIRGen().getBundleName();
   auto bundleNameUpper = llvm::StringRef(bundleName).upper();
-  auto constMemSize = irgen_->getAllocationsInfo().constantWeightVarsMemSize_;
-  auto mutableMemSize = irgen_->getAllocationsInfo().mutableWeightVarsMemSize_;
-  auto activationsMemSize = irgen_->getAllocationsInfo().activationsMemSize_;
+  auto constMemSize = constantWeightVarsMemSize_;
+  auto mutableMemSize = mutableWeightVarsMemSize_;
+  auto activationsMemSize = activationsMemSize_;
   auto memAlignSize = TensorAlignment;
   auto totMemSize = constMemSize + mutableMemSize + activationsMemSize;
 
   // Format common bundle definitions.
-  auto commonDefines = (bundleApi == BundleApiType::Dynamic)
-                           ? dynamicApiCommonDefines
-                           : staticApiCommonDefines;
+  std::string commonDefines = (bundleApi == BundleApiType::Dynamic)
+                                  ? dynamicApiCommonDefines
+                                  : staticApiCommonDefines;
+  if (bundleParallelRunner) {
+    commonDefines += parallelRunnerCommonDefines;
+  }
+  if (bundleWeightsFormat == BundleWeightsFormat::Mapped) {
+    commonDefines += mappedWeightsCommonDefines;
+  }
 
   // Format model description.
   std::string modelInfo = strFormat("// Model name: \"%s\"\n"
                                     "// Total data size: %lu (bytes)\n"
                                     "// Placeholders:\n",
                                     bundleName.data(), totMemSize);
-  for (auto &v : F_->findPlaceholders()) {
-    auto *w = cast<WeightVar>(F_->getWeightForNode(v));
+  for (auto &ph : placeholders_) {
+    auto *w = ph.w;
     // Get placeholder shape as string.
     std::string shapeStr = "[";
     auto dims = w->getType()->dims();
@@ -266,7 +424,7 @@ void BundleSaver::saveHeader(llvm::StringRef headerFileName) {
     auto typeName = w->getType()->getElementName();
     auto sizeElem = w->getType()->size();
     auto sizeByte = w->getType()->getSizeInBytes();
-    auto offset = allocationsInfo_.allocatedAddress_[w];
+    auto offset = ph.addr;
     modelInfo += strFormat("//\n"
                            "//   Name: \"%s\"\n"
                            "//   Type: %s\n"
@@ -282,22 +440,22 @@ void BundleSaver::saveHeader(llvm::StringRef headerFileName) {
   std::string modelApi = "\n";
   if (bundleApi == BundleApiType::Dynamic) {
     // Print bundle memory configuration.
-    modelApi += strFormat("// Bundle memory configuration (memory layout)\n"
-                          "extern BundleConfig %s_config;\n"
-                          "\n",
-                          bundleName.data());
-
+    modelApi += "// Bundle memory configuration (memory layout)\n";
+    for (auto &entry : entries_) {
+      modelApi +=
+          strFormat("extern BundleConfig %s_config;\n", entry->name.c_str());
+    }
+    modelApi += "\n";
   } else {
     // Get placeholder names and offsets. Compute also the maximum placeholder
     // name length for print purposes.
     unsigned nameMaxLen = 0;
     std::vector<std::pair<llvm::StringRef, unsigned>> nameAddrPairs;
-    for (auto &v : F_->findPlaceholders()) {
-      auto *w = cast<WeightVar>(F_->getWeightForNode(v));
-      auto name = w->getName();
-      auto addr = allocationsInfo_.allocatedAddress_[w];
+    for (auto &ph : placeholders_) {
+      auto name = ph.w->getName();
       nameMaxLen = name.size() > nameMaxLen ? name.size() : nameMaxLen;
-      nameAddrPairs.push_back(std::pair<llvm::StringRef, unsigned>(name, addr));
+      nameAddrPairs.push_back(
+          std::pair<llvm::StringRef, unsigned>(name, ph.addr));
     }
 
     // Print placeholder address offsets.
@@ -326,20 +484,42 @@ void BundleSaver::saveHeader(llvm::StringRef headerFileName) {
                   bundleNameUpper.data(), memAlignSize);
   }
 
-  // Print bundle entry function.
-  modelApi += strFormat("// Bundle entry point (inference function)\n"
-                        "void %s("
-                        "uint8_t *constantWeight, "
-                        "uint8_t *mutableWeight, "
-                        "uint8_t *activations"
-                        ");\n",
-                        bundleName.data());
+  // Print bundle entry functions.
+  if (entries_.size() > 1) {
+    modelApi += "// The bundle entry points share the memory areas, so they "
+                "must not run\n"
+                "// concurrently.\n";
+  }
+  for (auto &entry : entries_) {
+    if (bundleParallelRunner) {
+      modelApi += strFormat("// Bundle entry point (inference function). The "
+                            "parallel kernels split their\n"
+                            "// work with runner, which may be NULL to run "
+                            "them on the calling thread.\n"
+                            "void %s("
+                            "uint8_t *constantWeight, "
+                            "uint8_t *mutableWeight, "
+                            "uint8_t *activations, "
+                            "GlowParallelRunner runner"
+                            ");\n",
+                            entry->name.c_str());
+    } else {
+      modelApi += strFormat("// Bundle entry point (inference function)\n"
+                            "void %s("
+                            "uint8_t *constantWeight, "
+                            "uint8_t *mutableWeight, "
+                            "uint8_t *activations"
+                            ");\n",
+                            entry->name.c_str());
+    }
+  }
 
   // Print header file.
   printHeader(headerFileName, bundleName, commonDefines, modelInfo, modelApi);
 }
 
-void BundleSaver::emitSymbolTable() {
+void BundleSaver::emitSymbolTable(Entry &entry) {
+  auto &irgen = *entry.irgen;
   // Define a struct for symbol table entries:
   // struct SymbolTableEntry {
   //  const char *name;
@@ -347,26 +527,26 @@ void BundleSaver::emitSymbolTable() {
   //  uint64_t size;
   //  char kind;
   // };
-  auto *charTy = llvm::Type::getInt8Ty(irgen_->getLLVMContext());
+  auto *charTy = llvm::Type::getInt8Ty(irgen.getLLVMContext());
   auto *uint64TTy =
-      llvm::Type::getIntNTy(irgen_->getLLVMContext(), sizeof(uint64_t) * 8);
+      llvm::Type::getIntNTy(irgen.getLLVMContext(), sizeof(uint64_t) * 8);
   auto symbolTableEntryTy = llvm::StructType::get(
-      irgen_->getLLVMContext(),
+      irgen.getLLVMContext(),
       {charTy->getPointerTo(), uint64TTy, uint64TTy, charTy});
   // Set of entries in the symbol table.
   llvm::SmallVector<llvm::Constant *, 128> entries;
   // Iterate over all Placeholders and record information about their names,
   // offset, size and kind.
-  for (auto &v : F_->findPlaceholders()) {
-    auto *w = cast<WeightVar>(F_->getWeightForNode(v));
+  for (auto &v : entry.F->findPlaceholders()) {
+    auto *w = cast<WeightVar>(entry.F->getWeightForNode(v));
     auto size = w->getType()->size();
-    auto addr = allocationsInfo_.allocatedAddress_[w];
+    auto addr = entry.allocationsInfo.allocatedAddress_[w];
     // Create an SymbolTableEntry.
-    auto *entry = llvm::ConstantStruct::get(
+    auto *symbol = llvm::ConstantStruct::get(
         symbolTableEntryTy,
         {// name.
-         dyn_cast<llvm::Constant>(irgen_->getBuilder().CreateBitCast(
-             irgen_->emitStringConst(irgen_->getBuilder(), w->getName()),
+         dyn_cast<llvm::Constant>(irgen.getBuilder().CreateBitCast(
+             irgen.emitStringConst(irgen.getBuilder(), w->getName()),
              charTy->getPointerTo())),
          // offset.
          llvm::ConstantInt::get(uint64TTy, addr),
@@ -374,29 +554,58 @@ void BundleSaver::emitSymbolTable() {
          llvm::ConstantInt::get(uint64TTy, size),
          // 1 for Mutable Kind
          llvm::ConstantInt::get(charTy, 1)});
-    entries.push_back(entry);
+    entries.push_back(symbol);
   }
 
   // Create a constant array with these entries.
   auto *arr = llvm::ConstantArray::get(
       llvm::ArrayType::get(symbolTableEntryTy, entries.size()), entries);
   // Create a global variable and initialize it with the constructed array.
-  new llvm::GlobalVariable(irgen_->getModule(), arr->getType(), true,
+  new llvm::GlobalVariable(irgen.getModule(), arr->getType(), true,
                            llvm::GlobalValue::InternalLinkage, arr,
-                           irgen_->getMainEntryName() + "SymbolTable");
+                           irgen.getMainEntryName() + "SymbolTable");
+}
+
+void BundleSaver::linkEntries() {
+  auto &M = getMainIRGen().getModule();
+  for (size_t i = 1, e = entries_.size(); i < e; i++) {
+    auto &entry = *entries_[i];
+    // Every code generator has its own LLVM context, so the module of the
+    // entry point is moved to the context of the bundle module as bitcode.
+    llvm::SmallVector<char, 0> buffer;
+    llvm::raw_svector_ostream bitcode(buffer);
+    llvm::WriteBitcodeToFile(entry.irgen->getModule(), bitcode);
+    auto entryModule = llvm::parseBitcodeFile(
+        llvm::MemoryBufferRef(llvm::StringRef(buffer.data(), buffer.size()),
+                              entry.name),
+        M.getContext());
+    if (!entryModule) {
+      LOG(FATAL) << "Could not read the module of the bundle entry point "
+                 << entry.name << ": "
+                 << llvm::toString(entryModule.takeError());
+    }
+    // The libjit definitions were internalized by the optimizer, so only
+    // the entry point and the weak globals of libjit remain to be linked.
+    CHECK(!llvm::Linker::linkModules(M, std::move(*entryModule)))
+        << "Could not link the bundle entry point " << entry.name;
+  }
 }
 
 void BundleSaver::produceBundle(llvm::StringRef outputDir) {
   // Emit symbol table and bundle config only for dynamic API
   if (bundleApi == BundleApiType::Dynamic) {
-    // Emit the symbol table for weight variables.
-    emitSymbolTable();
-    // Emit the config for the bundle.
-    emitBundleConfig();
+    for (auto &entry : entries_) {
+      // Emit the symbol table for weight variables.
+      emitSymbolTable(*entry);
+      // Emit the config for the bundle.
+      emitBundleConfig(*entry);
+    }
   }
+  // Put the code of all entry points in one module.
+  linkEntries();
 
-  auto &M = irgen_->getModule();
-  auto bundleName = irgen_->getBundleName();
+  auto &M = getMainIRGen().getModule();
+  auto bundleName = getMainIRGen().getBundleName();
   std::string extension = (llvmCompiler.empty()) ? ".o" : ".bc";
   auto bundleCodeOutput = (outputDir + "/" + bundleName + extension).str();
   auto bundleWeightsOutput = (outputDir + "/" + bundleName + ".weights").str();
@@ -432,7 +641,7 @@ void BundleSaver::produceBundle(llvm::StringRef outputDir) {
   } else if (fileName.endswith(".o")) {
     // Emit the object file.
     llvm::legacy::PassManager PM;
-    auto &TM = irgen_->getTargetMachine();
+    auto &TM = getMainIRGen().getTargetMachine();
 
 #if FACEBOOK_INTERNAL && LLVM_VERSION_MAJOR < 8
     TM.addPassesToEmitFile(
@@ -447,35 +656,45 @@ void BundleSaver::produceBundle(llvm::StringRef outputDir) {
   }
   outputFile.close();
   // Output weights.
-  saveWeights(bundleWeightsOutput);
+  auto weightsDataOffset = saveWeights(bundleWeightsOutput);
   // Header file.
   saveHeader(bundleHeaderOutput);
-  // Save weights also in text format for Static API.
+  // Save weights also in text format for Static API, without the header
+  // table of the mapped format.
   if (bundleApi == BundleApiType::Static) {
     auto bundleWeightsTxtOut = (outputDir + "/" + bundleName + ".inc").str();
-    serializeBinaryToText(bundleWeightsOutput, bundleWeightsTxtOut);
+    serializeBinaryToText(bundleWeightsOutput, bundleWeightsTxtOut,
+                          weightsDataOffset);
   }
 }
 
-/// Emit the entry function for the bundle. It simply calls the main entry of
-/// the module and forwards its arguments to it. As the last argument it
-/// provides the constant array of offsets. Since these offsets are constants,
-/// the LLVM optimizer will constant propagate them into relative addressing
-/// computations and the like and produce a very efficient code that uses
-/// absolute addressing whenever possible.
-void BundleSaver::emitBundleEntryFunction() {
+/// Emit the entry function for the entry point \p entry of the bundle. It
+/// simply calls the main entry of the module and forwards its arguments to it.
+/// As the last argument it provides the constant array of offsets. Since these
+/// offsets are constants, the LLVM optimizer will constant propagate them into
+/// relative addressing computations and the like and produce a very efficient
+/// code that uses absolute addressing whenever possible.
+void BundleSaver::emitBundleEntryFunction(Entry &entry) {
+  auto &irgen = *entry.irgen;
   // The bundle entry point has the following API:
   // void entry(uint8_t *baseConstantWeightVars, uint8_t *baseInoutWeightVars,
   // uint8_t *baseActivations);
-  llvm::Type *voidTy = llvm::Type::getVoidTy(irgen_->getLLVMContext());
-  auto int8PtrTy = llvm::Type::getInt8PtrTy(irgen_->getLLVMContext());
+  // With -bundle-parallel-runner it takes the parallel runner as a fourth
+  // argument, which is installed for libjit_parallel_for during the call.
+  llvm::Type *voidTy = llvm::Type::getVoidTy(irgen.getLLVMContext());
+  auto int8PtrTy = llvm::Type::getInt8PtrTy(irgen.getLLVMContext());
+  llvm::SmallVector<llvm::Type *, 4> bundleArgTys{int8PtrTy, int8PtrTy,
+                                                  int8PtrTy};
+  if (bundleParallelRunner) {
+    bundleArgTys.push_back(int8PtrTy);
+  }
   llvm::FunctionType *bundleFuncTy =
-      llvm::FunctionType::get(voidTy, {int8PtrTy, int8PtrTy, int8PtrTy}, false);
+      llvm::FunctionType::get(voidTy, bundleArgTys, false);
   auto *func =
       llvm::Function::Create(bundleFuncTy, llvm::Function::ExternalLinkage,
-                             irgen_->getMainEntryName(), &irgen_->getModule());
+                             irgen.getMainEntryName(), &irgen.getModule());
   llvm::BasicBlock *entry_bb =
-      llvm::BasicBlock::Create(irgen_->getLLVMContext(), "entry", func);
+      llvm::BasicBlock::Create(irgen.getLLVMContext(), "entry", func);
   llvm::IRBuilder<> builder(entry_bb);
 
   // Prepare arguments for the "main" function.
@@ -484,21 +703,38 @@ void BundleSaver::emitBundleEntryFunction() {
   initFunctionCallArgs.push_back(func->args().begin() + 1);
   initFunctionCallArgs.push_back(func->args().begin() + 2);
   // Now form the offsets array and pass it as the last argument.
-  auto offsetsArray = irgen_->emitConstOffsetsArray(builder, allocationsInfo_);
+  auto offsetsArray =
+      irgen.emitConstOffsetsArray(builder, entry.allocationsInfo);
   initFunctionCallArgs.push_back(offsetsArray);
   // Invoke the main entry with constant arguments and let LLVM optimizer make
   // use of it.
-  auto *entryF = irgen_->getModule().getFunction("main");
+  auto *entryF = irgen.getModule().getFunction("main");
   entryF->setLinkage(llvm::Function::InternalLinkage);
-  irgen_->createCall(builder, entryF, initFunctionCallArgs);
+  // Install the runner of the caller around the call, restoring the previous
+  // one afterwards. The variable is missing if libjit doesn't have it.
+  auto *runnerVar =
+      bundleParallelRunner
+          ? irgen.getModule().getGlobalVariable(parallelRunnerVarName)
+          : nullptr;
+  llvm::Value *prevRunner = nullptr;
+  if (runnerVar) {
+    prevRunner = builder.CreateLoad(runnerVar->getValueType(), runnerVar);
+    builder.CreateStore(builder.CreateBitCast(func->args().begin() + 3,
+                                              runnerVar->getValueType()),
+                        runnerVar);
+  }
+  irgen.createCall(builder, entryF, initFunctionCallArgs);
+  if (runnerVar) {
+    builder.CreateStore(prevRunner, runnerVar);
+  }
   // Terminate the function.
   builder.CreateRetVoid();
   // Create the debug info for the bundle entry point function.
-  irgen_->generateFunctionDebugInfo(func);
+  irgen.generateFunctionDebugInfo(func);
 }
 
-// Create a config for this network. It will be exposed to the clients,
-// so that they know how much memory they need to allocate, etc.
+// Create a config for the entry point \p entry. It will be exposed to the
+// clients, so that they know how much memory they need to allocate, etc.
 // Config consists of the following fields:
 // struct BundleConfig {
 //   uint64_t constantWeightVarsMemSize;
@@ -508,68 +744,112 @@ void BundleSaver::emitBundleEntryFunction() {
 //   uint64_t numSymbols;
 //   SymbolTableEntry *symbolTable;
 // };
-void BundleSaver::emitBundleConfig() {
-  auto symbolTableName = irgen_->getMainEntryName() + "SymbolTable";
-  auto symbolTable =
-      irgen_->getModule().getGlobalVariable(symbolTableName, true);
+void BundleSaver::emitBundleConfig(Entry &entry) {
+  auto &irgen = *entry.irgen;
+  auto symbolTableName = irgen.getMainEntryName() + "SymbolTable";
+  auto symbolTable = irgen.getModule().getGlobalVariable(symbolTableName, true);
   CHECK(symbolTable)
       << "Expected to find a symbol table for the AOT bundle with name: "
       << symbolTableName;
   // Get the integer type having the same size in bits as uint64_t.
-  auto *uint64TType = irgen_->getBuilder().getIntNTy(sizeof(uint64_t) * 8);
+  auto *uint64TType = irgen.getBuilder().getIntNTy(sizeof(uint64_t) * 8);
   auto symbolTableEntryTy = symbolTable->getType()->getPointerElementType();
   auto *bundleConfigTy =
-      llvm::StructType::get(irgen_->getLLVMContext(),
+      llvm::StructType::get(irgen.getLLVMContext(),
                             {uint64TType, uint64TType, uint64TType, uint64TType,
                              uint64TType, symbolTableEntryTy->getPointerTo()});
   auto config = new llvm::GlobalVariable(
-      irgen_->getModule(), bundleConfigTy, /* isConst */ true,
+      irgen.getModule(), bundleConfigTy, /* isConst */ true,
       llvm::GlobalValue::LinkageTypes::ExternalLinkage, nullptr,
-      irgen_->getMainEntryName() + "_config");
+      irgen.getMainEntryName() + "_config");
   config->setInitializer(llvm::ConstantStruct::get(
       bundleConfigTy,
-      llvm::ConstantInt::get(
-          uint64TType, irgen_->getAllocationsInfo().constantWeightVarsMemSize_),
-      llvm::ConstantInt::get(
-          uint64TType, irgen_->getAllocationsInfo().mutableWeightVarsMemSize_),
-      llvm::ConstantInt::get(uint64TType,
-                             irgen_->getAllocationsInfo().activationsMemSize_),
+      llvm::ConstantInt::get(uint64TType, constantWeightVarsMemSize_),
+      llvm::ConstantInt::get(uint64TType, mutableWeightVarsMemSize_),
+      llvm::ConstantInt::get(uint64TType, activationsMemSize_),
 
       llvm::ConstantInt::get(uint64TType, TensorAlignment),
-      llvm::ConstantInt::get(uint64TType, F_->findPlaceholders().size()),
+      llvm::ConstantInt::get(uint64TType, entry.F->findPlaceholders().size()),
 
       symbolTable));
 }
 
 void BundleSaver::performBundleMemoryAllocation() {
-  allocationsInfo_.numberValues(F_);
-  allocationsInfo_.allocateActivations(F_);
-  // Tell the allocateWeightVars to not reuse any existing addresses for weights
-  // and to assign new ones.
-  allocationsInfo_.allocateWeightVars(F_);
-  allocationsInfo_.allocateTensorViews(F_);
+  // Assign new offsets to the weights of all entry points, do not reuse any
+  // existing addresses. A Storage used by several entry points is allocated
+  // once.
+  MemoryAllocator constantWeightVarsAllocator("ConstantWeights", 0);
+  MemoryAllocator mutableWeightVarsAllocator("MutableWeights", 0);
+  llvm::DenseMap<const Storage *, uint64_t> weightAddrs;
+  auto allocateWeight = [&](Entry &entry, const Storage *node,
+                            MemoryAllocator &allocator,
+                            std::vector<BundleWeight> &weights) {
+    auto *w = cast<WeightVar>(entry.F->getWeightForNode(node));
+    auto it = weightAddrs.find(node);
+    if (it == weightAddrs.end()) {
+      uint64_t addr = allocator.allocate(w->getSizeInBytes(), w);
+      it = weightAddrs.try_emplace(node, addr).first;
+      weights.push_back({node, w, addr});
+    }
+    entry.allocationsInfo.allocatedAddress_[w] = it->second;
+  };
+  for (auto &entry : entries_) {
+    auto *F = entry->F;
+    entry->allocationsInfo.numberValues(F);
+    for (auto *v : F->findConstants()) {
+      allocateWeight(*entry, v, constantWeightVarsAllocator, constants_);
+    }
+    // Placeholders should be allocated in a order of
+    // intput|inputOutput|output|neither.
+    for (auto &ph : getContiguousPlaceHolder(F->findPlaceholders(), *F)) {
+      allocateWeight(*entry, ph.addr, mutableWeightVarsAllocator,
+                     placeholders_);
+    }
+  }
+  constantWeightVarsMemSize_ = constantWeightVarsAllocator.getMaxMemoryUsage();
+  mutableWeightVarsMemSize_ = mutableWeightVarsAllocator.getMaxMemoryUsage();
+
+  // The activations of every entry point start at the beginning of the
+  // shared activations area.
+  for (auto &entry : entries_) {
+    auto &allocationsInfo = entry->allocationsInfo;
+    allocationsInfo.allocateActivations(entry->F, planActivationsOffline_);
+    allocationsInfo.allocateTensorViews(entry->F);
+    activationsMemSize_ = std::max<uint64_t>(
+        activationsMemSize_, allocationsInfo.activationsMemSize_);
+  }
+  for (auto &entry : entries_) {
+    auto &allocationsInfo = entry->allocationsInfo;
+    allocationsInfo.constantWeightVarsMemSize_ = constantWeightVarsMemSize_;
+    allocationsInfo.mutableWeightVarsMemSize_ = mutableWeightVarsMemSize_;
+    allocationsInfo.activationsMemSize_ = activationsMemSize_;
+  }
 }
 
 void BundleSaver::save(llvm::StringRef target, llvm::StringRef arch,
                        llvm::StringRef cpu,
                        const llvm::SmallVectorImpl<std::string> &targetFeatures,
                        llvm::StringRef outputDir, llvm::StringRef bundleName,
-                       llvm::StringRef mainEntryName,
                        llvm::CodeModel::Model codeModel,
                        llvm::Reloc::Model relocModel) {
-  // Object files generation works properly only in small mode.
-  irgen_->initTargetMachine(target, arch, cpu, targetFeatures, codeModel,
+  for (auto &entry : entries_) {
+    auto &irgen = *entry->irgen;
+    // Object files generation works properly only in small mode.
+    irgen.initTargetMachine(target, arch, cpu, targetFeatures, codeModel,
                             relocModel);
-  irgen_->setOutputDir(outputDir);
-  irgen_->setBundleName(bundleName);
-  irgen_->setMainEntryName(mainEntryName);
-  irgen_->initCodeGen();
+    irgen.setOutputDir(outputDir);
+    irgen.setBundleName(bundleName);
+    irgen.setMainEntryName(entry->name);
+    irgen.initCodeGen();
+  }
   // Perform the address assignment for activations and WeightVars.
   performBundleMemoryAllocation();
-  // Create the bundle entry function.
-  emitBundleEntryFunction();
-  // Emit the code for the body of the entry function.
-  irgen_->performCodeGen();
+  for (auto &entry : entries_) {
+    // Create the bundle entry function.
+    emitBundleEntryFunction(*entry);
+    // Emit the code for the body of the entry function.
+    entry->irgen->performCodeGen();
+  }
   // Produce the bundle.
   produceBundle(outputDir);
 }
@@ -25,40 +25,90 @@ namespace glow {
 class LLVMBackend;
 
 class BundleSaver final {
-  /// The IR to be compiled.
-  const IRFunction *F_;
-  /// Information about allocations.
-  AllocationsInfo allocationsInfo_;
-  /// The LLVM IR code generator.
-  std::unique_ptr<LLVMIRGen> irgen_;
+public:
+  /// An IRFunction to be saved as an entry point of the bundle, under the
+  /// name entryName.
+  struct SavedIRFunction {
+    std::string entryName;
+    const IRFunction *savedF{nullptr};
+  };
+
+private:
+  /// An entry point of the bundle.
+  struct Entry {
+    /// Name of the entry point.
+    std::string name;
+    /// The IR to be compiled.
+    const IRFunction *F;
+    /// Information about allocations. The weights are allocated for the whole
+    /// bundle and the activations for this entry point only.
+    AllocationsInfo allocationsInfo;
+    /// The LLVM IR code generator.
+    std::unique_ptr<LLVMIRGen> irgen;
+  };
+  /// A WeightVar of the bundle. The weights of all entry points live in the
+  /// same memory areas, where a Storage used by several entry points has a
+  /// single offset.
+  struct BundleWeight {
+    /// The Storage of the weight.
+    const Storage *node;
+    /// The WeightVar of the first entry point using the weight.
+    const WeightVar *w;
+    /// Offset of the weight in its memory area.
+    uint64_t addr;
+  };
+  /// The entry points of the bundle. The code of all of them is linked into
+  /// the module of the first one.
+  std::vector<std::unique_ptr<Entry>> entries_;
+  /// The constant weights of all entry points.
+  std::vector<BundleWeight> constants_;
+  /// The placeholders of all entry points.
+  std::vector<BundleWeight> placeholders_;
+  /// Sizes of the memory areas shared by all entry points. The activations
+  /// area is as large as the one of the largest entry point, since the entry
+  /// points never run at the same time.
+  uint64_t constantWeightVarsMemSize_{0};
+  uint64_t mutableWeightVarsMemSize_{0};
+  uint64_t activationsMemSize_{0};
+  /// Whether the activations are planned offline.
+  bool planActivationsOffline_;
 
+  /// \returns the code generator of the module of the bundle.
+  LLVMIRGen &getMainIRGen() { return *entries_.front()->irgen; }
   /// Perform memory allocation for a bundle.
   void performBundleMemoryAllocation();
-  /// Save weights for the bundle.
-  void saveWeights(llvm::StringRef weightsFileName);
+  /// Save weights for the bundle. \returns the offset of the constant
+  /// weights area in the file, which is past the header table of the mapped
+  /// format.
+  uint64_t saveWeights(llvm::StringRef weightsFileName);
+  /// \returns the header table of a mapped weights file, padded to the offset
+  /// of the constant weights area.
+  std::string getMappedWeightsHeader();
   /// Save header file for the bundle.
   void saveHeader(llvm::StringRef headerFileName);
   /// Produce a bundle.
   void produceBundle(llvm::StringRef outputDir);
-  /// Emit config for a bundle.
-  void emitBundleConfig();
-  /// Emit the symbol table for a bundle.
-  void emitSymbolTable();
-  /// Emit the entry function for the bundle.
-  void emitBundleEntryFunction();
+  /// Link the modules of all entry points into the module of the first one.
+  void linkEntries();
+  /// Emit config for the entry point \p entry.
+  void emitBundleConfig(Entry &entry);
+  /// Emit the symbol table for the entry point \p entry.
+  void emitSymbolTable(Entry &entry);
+  /// Emit the entry function for the entry point \p entry.
+  void emitBundleEntryFunction(Entry &entry);
 
 public:
-  /// Ctor.
-  explicit BundleSaver(const IRFunction *F, const LLVMBackend &llvmBackend);
+  /// Ctor for a bundle with an entry point for each of \p functions. The
+  /// entry points share the weights and the activations memory areas.
+  explicit BundleSaver(llvm::ArrayRef<SavedIRFunction> functions,
+                       const LLVMBackend &llvmBackend);
   /// Save code bundle built for \p target, \p arch, \p cpu and \p
-  /// targetFeatures to \p outputDir under name \p bundleName. Make
-  /// \p mainEntryName the function name for the entry point of the network and
-  /// prepend all generated files with this name.
+  /// targetFeatures to \p outputDir under name \p bundleName. Prepend all
+  /// generated files with this name.
   void save(llvm::StringRef target, llvm::StringRef arch, llvm::StringRef cpu,
             const llvm::SmallVectorImpl<std::string> &targetFeatures,
             llvm::StringRef outputDir, llvm::StringRef bundleName,
-            llvm::StringRef mainEntryName, llvm::CodeModel::Model codeModel,
-            llvm::Reloc::Model relocModel);
+            llvm::CodeModel::Model codeModel, llvm::Reloc::Model relocModel);
 };
 
 } // namespace glow
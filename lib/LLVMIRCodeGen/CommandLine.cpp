@@ -57,3 +57,103 @@ llvm::cl::opt<llvm::FloatABI::ABIType>
                               clEnumValN(llvm::FloatABI::Hard, "hard",
                                          "Hard float ABI (hardfp)")),
              llvm::cl::init(llvm::FloatABI::Default));
+
+llvm::cl::opt<bool> llvmHugePageBuffers(
+    "llvm-huge-page-buffers",
+    llvm::cl::desc("Back the activation and mutable weight buffers of JITed "
+                   "functions with huge pages"),
+    llvm::cl::init(false), llvm::cl::cat(getLLVMBackendCat()));
+
+llvm::cl::opt<bool> llvmZeroCopyPlaceholders(
+    "llvm-zero-copy-placeholders",
+    llvm::cl::desc("Let JITed functions access suitably aligned placeholder "
+                   "tensors in place instead of copying them in and out"),
+    llvm::cl::init(false), llvm::cl::cat(getLLVMBackendCat()));
+
+llvm::cl::opt<bool> llvmEnableAVX512(
+    "llvm-enable-avx512",
+    llvm::cl::desc("Let the JIT use the AVX-512 features of the host CPU"),
+    llvm::cl::init(false), llvm::cl::cat(getLLVMBackendCat()));
+
+llvm::cl::opt<bool> llvmFuseDataParallel(
+    "llvm-fuse-data-parallel",
+    llvm::cl::desc("Keep the intermediate results of data-parallel kernels "
+                   "that are not used outside of the kernel in registers "
+                   "instead of writing them to memory"),
+    llvm::cl::init(false), llvm::cl::cat(getLLVMBackendCat()));
+
+llvm::cl::opt<bool> llvmVectorizeDataParallel(
+    "llvm-vectorize-data-parallel",
+    llvm::cl::desc("Emit the data-parallel kernels of supported instructions "
+                   "as loops on vectors of the target's register width"),
+    llvm::cl::init(false), llvm::cl::cat(getLLVMBackendCat()));
+
+llvm::cl::opt<bool> llvmFastMath(
+    "llvm-fast-math",
+    llvm::cl::desc("Compute the float Sigmoid, Tanh, ElementExp and SoftMax "
+                   "with vectorized polynomial approximations of exp, whose "
+                   "relative error is below 5e-6, instead of libm"),
+    llvm::cl::init(false), llvm::cl::cat(getLLVMBackendCat()));
+
+llvm::cl::opt<unsigned> llvmGatherPrefetchDistance(
+    "llvm-gather-prefetch-distance",
+    llvm::cl::desc("Number of slices ahead of the copied one that Gather and "
+                   "GatherRanges prefetch. 0 disables prefetching"),
+    llvm::cl::init(8), llvm::cl::cat(getLLVMBackendCat()));
+
+llvm::cl::opt<unsigned> llvmTileCacheSize(
+    "llvm-tile-cache-size",
+    llvm::cl::desc("Split the sequences of instructions computing their "
+                   "results row by row into tiles whose buffers take this "
+                   "number of bytes, to keep their intermediate results in "
+                   "the cache. 0 disables tiling"),
+    llvm::cl::init(0), llvm::cl::cat(getLLVMBackendCat()));
+
+llvm::cl::opt<bool> llvmStridedViews(
+    "llvm-strided-views",
+    llvm::cl::desc("Let data-parallel kernels read the slices and write the "
+                   "concatenated inputs that are not contiguous in place, "
+                   "instead of copying them"),
+    llvm::cl::init(true), llvm::cl::cat(getLLVMBackendCat()));
+
+llvm::cl::opt<std::string> llvmCompileCacheDir(
+    "llvm-compile-cache-dir",
+    llvm::cl::desc("Directory of an on-disk cache of the object code of JITed "
+                   "functions, reused when the same function is compiled "
+                   "again"),
+    llvm::cl::init(""), llvm::cl::cat(getLLVMBackendCat()));
+
+llvm::cl::opt<bool> llvmShareSpecializations(
+    "llvm-share-specializations",
+    llvm::cl::desc("Compile the libjit kernels specialized for constant "
+                   "arguments once per process and share them between the "
+                   "JITed functions"),
+    llvm::cl::init(false), llvm::cl::cat(getLLVMBackendCat()));
+
+llvm::cl::opt<unsigned> llvmCodegenThreads(
+    "llvm-codegen-threads",
+    llvm::cl::desc("Number of threads generating the machine code of a JITed "
+                   "function, each for a part of its optimized LLVM module. "
+                   "1 generates it on the compiling thread"),
+    llvm::cl::init(1), llvm::cl::cat(getLLVMBackendCat()));
+
+llvm::cl::opt<bool> llvmTieredCompile(
+    "llvm-tiered-compile",
+    llvm::cl::desc("Compile functions without optimizations so that they "
+                   "serve quickly, then recompile them with full "
+                   "optimizations in the background"),
+    llvm::cl::init(false), llvm::cl::cat(getLLVMBackendCat()));
+
+llvm::cl::opt<bool> llvmInterOpParallelism(
+    "llvm-inter-op-parallelism",
+    llvm::cl::desc("Run the independent branches of JITed functions "
+                   "concurrently on the intra-op threads"),
+    llvm::cl::init(false), llvm::cl::cat(getLLVMBackendCat()));
+
+llvm::cl::opt<unsigned> llvmRollRepeatedInstrs(
+    "llvm-roll-repeated-instrs",
+    llvm::cl::desc("Emit the sequences of at least this number of "
+                   "instructions that repeat on different buffers, e.g. "
+                   "identical layers, as a loop over the repetitions. 0 "
+                   "disables it"),
+    llvm::cl::init(0), llvm::cl::cat(getLLVMBackendCat()));
@@ -53,4 +53,81 @@ extern llvm::cl::list<std::string> llvmCompilerOptions;
 /// Option to set float ABI. Used as -float-abi=<abi-type>.
 extern llvm::cl::opt<llvm::FloatABI::ABIType> floatABI;
 
+/// Option to back the activation and mutable weight buffers of JITed
+/// functions with huge pages. Used as -llvm-huge-page-buffers.
+extern llvm::cl::opt<bool> llvmHugePageBuffers;
+
+/// Option to let JITed functions access placeholder tensors in place, instead
+/// of copying them in and out of the mutable weights buffer. Used as
+/// -llvm-zero-copy-placeholders.
+extern llvm::cl::opt<bool> llvmZeroCopyPlaceholders;
+
+/// Option to let the JIT use the AVX-512 features of the host CPU, which are
+/// skipped by default. Used as -llvm-enable-avx512.
+extern llvm::cl::opt<bool> llvmEnableAVX512;
+
+/// Option to keep the intermediate results of data-parallel kernels that are
+/// not used outside of the kernel in registers instead of in memory. Used as
+/// -llvm-fuse-data-parallel.
+extern llvm::cl::opt<bool> llvmFuseDataParallel;
+
+/// Option to emit data-parallel kernels made of instructions with known
+/// element types as loops on LLVM vector types, followed by a scalar loop for
+/// the remaining elements, instead of relying on the LLVM vectorizer. Used as
+/// -llvm-vectorize-data-parallel.
+extern llvm::cl::opt<bool> llvmVectorizeDataParallel;
+
+/// Option to compute Sigmoid, Tanh, ElementExp and SoftMax of floats with the
+/// vectorized polynomial approximations of libjit instead of libm, see
+/// libjit_fast_expf. Used as -llvm-fast-math.
+extern llvm::cl::opt<bool> llvmFastMath;
+
+/// Number of slices, or of ranges, ahead of the one being copied that Gather
+/// and GatherRanges prefetch, so that the cache misses of the lookups of
+/// large tables overlap. Prefetching is disabled when it is 0. Used as
+/// -llvm-gather-prefetch-distance=8.
+extern llvm::cl::opt<unsigned> llvmGatherPrefetchDistance;
+
+/// Size in bytes of the tiles of rows the sequences of row-parallel
+/// instructions are split into, see tileInstructionChains. Tiling is disabled
+/// when it is 0. Used as -llvm-tile-cache-size=262144.
+extern llvm::cl::opt<unsigned> llvmTileCacheSize;
+
+/// Option to replace the copies of the regions of tensors that are not
+/// contiguous but are made of evenly spaced rows by strided tensor views,
+/// which data-parallel kernels access in place, see createStridedViews. Used
+/// as -llvm-strided-views.
+extern llvm::cl::opt<bool> llvmStridedViews;
+
+/// Directory of the on-disk cache of the object code of JITed functions, see
+/// CompileCache. The cache is disabled when it is empty. Used as
+/// -llvm-compile-cache-dir=dirA.
+extern llvm::cl::opt<std::string> llvmCompileCacheDir;
+
+/// Option to compile the libjit kernels specialized for constant arguments
+/// once per process and share their code between the JITed functions, see
+/// SpecializationCache. Used as -llvm-share-specializations.
+extern llvm::cl::opt<bool> llvmShareSpecializations;
+
+/// Option to compile functions without optimizations first, so that they can
+/// serve quickly, and to let the device recompile them with full
+/// optimizations in the background. Used as -llvm-tiered-compile.
+extern llvm::cl::opt<bool> llvmTieredCompile;
+
+/// Option for the number of threads generating the machine code of the JITed
+/// functions, see GlowJIT::addModule. Used as -llvm-codegen-threads=4.
+extern llvm::cl::opt<unsigned> llvmCodegenThreads;
+
+/// Option to split JITed functions into segments of dependent instructions
+/// and to run the independent segments concurrently on the intra-op threads.
+/// Used as -llvm-inter-op-parallelism.
+extern llvm::cl::opt<bool> llvmInterOpParallelism;
+
+/// Minimum number of instructions of the sequences repeated on different
+/// buffers, e.g. the identical layers of a network, that are emitted once in
+/// a loop over their repetitions instead of once per repetition, see
+/// LLVMIRGen::generateLLVMIRForRepeatedInstrs. Disabled when it is 0. Used as
+/// -llvm-roll-repeated-instrs=8.
+extern llvm::cl::opt<unsigned> llvmRollRepeatedInstrs;
+
 #endif // GLOW_LLVMIRCODEGEN_COMMANDLINE_H
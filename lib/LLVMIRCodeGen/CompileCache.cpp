@@ -0,0 +1,165 @@
+/**
+ * Copyright (c) Glow Contributors. See CONTRIBUTORS file.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "CompileCache.h"
+#include "CommandLine.h"
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <glog/logging.h>
+
+#include <cstring>
+
+using namespace glow;
+
+extern llvm::cl::opt<bool> emitDebugInfo;
+extern llvm::cl::opt<bool> jitSpecializeDims;
+
+namespace {
+/// Version of the layout of the cache files. Bump it whenever the layout or
+/// the generated code changes in a way the key does not capture.
+constexpr char kFormatVersion[] = "glow-compile-cache-1";
+
+/// The header of a cached object file, followed by the object code.
+struct CacheFileHeader {
+  char magic[8];
+  uint64_t constantWeightSize;
+  uint64_t mutableWeightSize;
+  uint64_t activationsSize;
+};
+
+/// \returns the header of the cache file of a function with \p bundle.
+CacheFileHeader makeHeader(const runtime::RuntimeBundle &bundle) {
+  CacheFileHeader header;
+  std::memcpy(header.magic, "GLOWOBJ1", sizeof(header.magic));
+  header.constantWeightSize = bundle.getConstantWeightSize();
+  header.mutableWeightSize = bundle.getMutableWeightSize();
+  header.activationsSize = bundle.getActivationsSize();
+  return header;
+}
+} // namespace
+
+std::string CompileCache::getPath(llvm::StringRef key) const {
+  llvm::SmallString<128> path(dir_);
+  llvm::sys::path::append(path, key + ".o");
+  return path.str();
+}
+
+std::string CompileCache::getKey(const IRFunction &IR,
+                                 llvm::StringRef backendName,
+                                 const llvm::TargetMachine &TM,
+                                 llvm::StringRef libjitBC) {
+  llvm::MD5 hash;
+  auto add = [&hash](llvm::StringRef data) {
+    hash.update(data);
+    // Terminate every part, so that moving bytes from one part to the next
+    // changes the key.
+    hash.update(llvm::StringRef("", 1));
+  };
+  add(kFormatVersion);
+  add(LLVM_VERSION_STRING);
+  add(backendName);
+  add(TM.getTargetTriple().str());
+  add(TM.getTargetCPU());
+  add(TM.getTargetFeatureString());
+  add(std::to_string(int(TM.getCodeModel())));
+  add(std::to_string(int(TM.getRelocationModel())));
+  add(std::to_string(int(TM.Options.FloatABIType)));
+  add(std::to_string(llvmZeroCopyPlaceholders) +
+      std::to_string(llvmFuseDataParallel) +
+      std::to_string(llvmVectorizeDataParallel) +
+      std::to_string(llvmFastMath) + std::to_string(llvmInterOpParallelism) +
+      std::to_string(emitDebugInfo) + std::to_string(jitSpecializeDims));
+  add(std::to_string(llvmGatherPrefetchDistance));
+  add(std::to_string(llvmRollRepeatedInstrs));
+  add(libjitBC);
+  add(IR.toString());
+  llvm::MD5::MD5Result result;
+  hash.final(result);
+  llvm::SmallString<32> key;
+  llvm::MD5::stringifyResult(result, key);
+  return key.str();
+}
+
+std::unique_ptr<llvm::MemoryBuffer>
+CompileCache::load(llvm::StringRef key,
+                   const runtime::RuntimeBundle &bundle) const {
+  auto path = getPath(key);
+  auto bufferOrErr = llvm::MemoryBuffer::getFile(path);
+  if (!bufferOrErr) {
+    return nullptr;
+  }
+  auto &buffer = *bufferOrErr;
+  CacheFileHeader header;
+  CacheFileHeader expected = makeHeader(bundle);
+  if (buffer->getBufferSize() <= sizeof(header)) {
+    LOG(WARNING) << "Ignoring the truncated compile cache file " << path;
+    return nullptr;
+  }
+  std::memcpy(&header, buffer->getBufferStart(), sizeof(header));
+  if (std::memcmp(&header, &expected, sizeof(header)) != 0) {
+    LOG(WARNING) << "Ignoring the mismatched compile cache file " << path;
+    return nullptr;
+  }
+  // Copy the object code, the object loader needs it to be suitably aligned.
+  return llvm::MemoryBuffer::getMemBufferCopy(
+      buffer->getBuffer().drop_front(sizeof(header)), path);
+}
+
+void CompileCache::store(llvm::StringRef key,
+                         const runtime::RuntimeBundle &bundle,
+                         llvm::MemoryBufferRef object) const {
+  if (auto EC = llvm::sys::fs::create_directories(dir_)) {
+    LOG(WARNING) << "Cannot create the compile cache directory " << dir_
+                 << ": " << EC.message();
+    return;
+  }
+  // Write a temporary file and rename it, so that concurrent compilations of
+  // the same function, in this process or in others, never load a partially
+  // written file.
+  auto path = getPath(key);
+  int fd;
+  llvm::SmallString<128> tmpPath;
+  if (auto EC = llvm::sys::fs::createUniqueFile(path + "-%%%%%%.tmp", fd,
+                                                tmpPath)) {
+    LOG(WARNING) << "Cannot create a compile cache file in " << dir_ << ": "
+                 << EC.message();
+    return;
+  }
+  {
+    llvm::raw_fd_ostream os(fd, /* shouldClose */ true);
+    CacheFileHeader header = makeHeader(bundle);
+    os.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    os << object.getBuffer();
+    os.close();
+    if (os.has_error()) {
+      os.clear_error();
+      LOG(WARNING) << "Cannot write the compile cache file " << tmpPath.c_str();
+      llvm::sys::fs::remove(tmpPath);
+      return;
+    }
+  }
+  if (auto EC = llvm::sys::fs::rename(tmpPath, path)) {
+    LOG(WARNING) << "Cannot write the compile cache file " << path << ": "
+                 << EC.message();
+    llvm::sys::fs::remove(tmpPath);
+  }
+}
@@ -0,0 +1,68 @@
+/**
+ * Copyright (c) Glow Contributors. See CONTRIBUTORS file.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef GLOW_LLVMIRCODEGEN_COMPILECACHE_H
+#define GLOW_LLVMIRCODEGEN_COMPILECACHE_H
+
+#include "glow/Backend/BackendUtils.h"
+#include "glow/IR/IR.h"
+
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Target/TargetMachine.h"
+
+#include <memory>
+#include <string>
+
+namespace glow {
+
+/// An on-disk cache of the object code JITed by the LLVMBackend. The object
+/// code of a function is stored in a file of the cache directory named after
+/// a hash of everything the code depends on, so that compiling the same
+/// function again, e.g. after a restart, loads it instead of running the LLVM
+/// optimization and code generation pipelines. The file also records the
+/// memory sizes of the RuntimeBundle of the function, which are checked when
+/// it is loaded.
+class CompileCache final {
+  /// The directory holding the cached object files.
+  std::string dir_;
+
+  /// \returns the path of the file of the entry \p key.
+  std::string getPath(llvm::StringRef key) const;
+
+public:
+  /// Create a cache of the object files in \p dir.
+  explicit CompileCache(llvm::StringRef dir) : dir_(dir) {}
+
+  /// \returns the key of the object code of \p IR compiled by the backend
+  /// \p backendName with the libjit bitcode \p libjitBC for the target of
+  /// \p TM, taking the LLVMBackend options that affect the code into account.
+  static std::string getKey(const IRFunction &IR, llvm::StringRef backendName,
+                            const llvm::TargetMachine &TM,
+                            llvm::StringRef libjitBC);
+
+  /// \returns the object code stored for \p key, or nullptr if there is none
+  /// or its memory sizes don't match those of \p bundle.
+  std::unique_ptr<llvm::MemoryBuffer>
+  load(llvm::StringRef key, const runtime::RuntimeBundle &bundle) const;
+
+  /// Store \p object with the memory sizes of \p bundle for \p key. Failures
+  /// are logged and otherwise ignored, the cache is only an optimization.
+  void store(llvm::StringRef key, const runtime::RuntimeBundle &bundle,
+             llvm::MemoryBufferRef object) const;
+};
+
+} // namespace glow
+
+#endif // GLOW_LLVMIRCODEGEN_COMPILECACHE_H
@@ -15,14 +15,18 @@
  */
 
 #include "CommandLine.h"
+#include "SpecializationCache.h"
 #include "glow/LLVMIRCodeGen/LLVMBackend.h"
 #include "glow/LLVMIRCodeGen/LLVMIRGen.h"
 
 #include "glow/IR/Instrs.h"
 #include "glow/Support/Debug.h"
 
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/Statistic.h"
+#include "llvm/IR/Module.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/Utils/Cloning.h"
 #include "llvm/Transforms/Utils/ValueMapper.h"
 
@@ -38,7 +42,7 @@ namespace {
 /// Perform function specialization with constant arguments taking into account
 /// only dimensions, but not the buffer addresses. This allows for faster JIT
 /// compilation and the does degrade performance.
-static llvm::cl::opt<bool>
+llvm::cl::opt<bool>
     jitSpecializeDims("jit-specialize",
                       llvm::cl::desc("Create specialized functions for "
                                      "operations with constant dimensions"),
@@ -46,6 +50,8 @@ static llvm::cl::opt<bool>
 
 STATISTIC(NumSpecializations, "Number of created specializations");
 STATISTIC(NumSharedSpecializations, "Number of shared specializations");
+STATISTIC(NumCachedSpecializations,
+          "Number of specializations compiled once per process");
 
 /// Check if the value \p Value is a constant for the purposes of the function
 /// specialization, i.e. it is an LLVM constant or it is a global constant
@@ -145,6 +151,60 @@ class FunctionSpecializer {
     return true;
   }
 
+  /// \returns the key of the specialization of the callee of \p call for its
+  /// arguments in \p argsToBeSpecialized in the SpecializationCache, or an
+  /// empty string if the value of one of these arguments depends on the
+  /// module, e.g. refers to a global.
+  std::string getCacheKey(llvm::CallInst *call, uint64_t argsToBeSpecialized) {
+    std::string key;
+    llvm::raw_string_ostream os(key);
+    os << call->getCalledFunction()->getName();
+    for (unsigned idx = 0, e = call->getNumArgOperands(); idx < e; ++idx) {
+      if (!isArgToBeSpecialized(argsToBeSpecialized, idx)) {
+        continue;
+      }
+      auto *arg = getConstantValue(call->getArgOperand(idx));
+      // Constant arrays of dimensions are keyed by their contents.
+      if (auto *GV = dyn_cast<llvm::GlobalVariable>(arg)) {
+        arg = GV->getInitializer();
+      }
+      if (!isa<llvm::ConstantData>(arg)) {
+        return "";
+      }
+      os << '|' << idx << ':' << *arg;
+    }
+    return os.str();
+  }
+
+  /// Replace \p specializedF, the specialization of the callee of \p call
+  /// for its arguments in \p argsToBeSpecialized, by a declaration of the
+  /// same kernel compiled by the SpecializationCache if it can be shared.
+  /// \returns the function to call.
+  llvm::Function *shareSpecializedFunction(llvm::Function *specializedF,
+                                           llvm::CallInst *call,
+                                           uint64_t argsToBeSpecialized) {
+    std::string key = getCacheKey(call, argsToBeSpecialized);
+    if (key.empty()) {
+      return specializedF;
+    }
+    std::string name = SpecializationCache::get().getOrCompile(
+        specializedF, key, irgen_.getLibjitBC(), irgen_.getTargetMachine());
+    if (name.empty()) {
+      return specializedF;
+    }
+    auto *M = specializedF->getParent();
+    auto *sharedF = M->getFunction(name);
+    if (!sharedF) {
+      sharedF = llvm::Function::Create(
+          specializedF->getFunctionType(),
+          llvm::GlobalValue::LinkageTypes::ExternalLinkage, name, M);
+      sharedF->addFnAttr(llvm::Attribute::AttrKind::NoInline);
+    }
+    specializedF->eraseFromParent();
+    NumCachedSpecializations++;
+    return sharedF;
+  }
+
   /// Find an existing specialization or create a new one.
   /// \param CI the call that is being specialized.
   /// \param F the function being specialized.
@@ -231,6 +291,10 @@ class FunctionSpecializer {
                             << specializedName << "\n";
                specializedF->print(llvm::errs(), nullptr));
     NumSpecializations++;
+    if (irgen_.getShareSpecializations()) {
+      specializedF =
+          shareSpecializedFunction(specializedF, call, argsToBeSpecialized);
+    }
     return specializedF;
   }
 
@@ -242,10 +306,14 @@ class FunctionSpecializer {
     // arguments, its code size, etc.
     const auto *caller = call->getFunction();
     const auto *callee = call->getCalledFunction();
-    // Specialized only calls inside main.
-    assert(caller == entryF_ &&
-           "Only calls inside the entry function are specialized");
+    // Specialized only calls inside main and its segments.
+    assert(llvm::is_contained(entryFs_, caller) &&
+           "Only calls inside the entry functions are specialized");
     (void)caller;
+    // The segments are called with the arguments of main.
+    if (llvm::is_contained(entryFs_, callee)) {
+      return false;
+    }
     // Do not specialize any LLVM internal functions.
     if (callee && callee->getName().startswith("llvm.")) {
       return false;
@@ -265,9 +333,10 @@ class FunctionSpecializer {
   }
 
 public:
-  FunctionSpecializer(llvm::Function *entryF,
+  FunctionSpecializer(llvm::ArrayRef<llvm::Function *> entryFs,
                       llvm::DenseSet<llvm::Value *> &dontSpec, LLVMIRGen &irgen)
-      : entryF_(entryF), dontSpecializeArgsSet_(dontSpec), irgen_(irgen) {}
+      : entryFs_(entryFs.begin(), entryFs.end()),
+        dontSpecializeArgsSet_(dontSpec), irgen_(irgen) {}
 
   /// Specialize a single call.
   /// \returns the specialized Call instruction if it was possible to specialize
@@ -320,17 +389,18 @@ public:
     // these call instructions are used by the keys in Specializations_ map.
     llvm::DenseMap<llvm::Instruction *, llvm::Instruction *>
         callToSpecializedCall;
-    auto *F = entryF_;
-    // Collect all eligable calls in the current function.
+    // Collect all eligable calls in the entry functions.
     llvm::SmallVector<llvm::CallInst *, 64> calls;
-    for (auto &BB : *F) {
-      for (auto &I : BB) {
-        auto *CI = dyn_cast<llvm::CallInst>(&I);
-        if (!CI)
-          continue;
-        if (!isEligibleForSpecialization(CI))
-          continue;
-        calls.push_back(CI);
+    for (auto *F : entryFs_) {
+      for (auto &BB : *F) {
+        for (auto &I : BB) {
+          auto *CI = dyn_cast<llvm::CallInst>(&I);
+          if (!CI)
+            continue;
+          if (!isEligibleForSpecialization(CI))
+            continue;
+          calls.push_back(CI);
+        }
       }
     }
     // Try to specialize all the collected calls.
@@ -417,8 +487,8 @@ private:
     }
   };
 
-  /// The entry function of the module.
-  llvm::Function *entryF_;
+  /// The entry function of the module and the functions of its segments.
+  llvm::SmallVector<llvm::Function *, 4> entryFs_;
   /// Mapping from specialization keys to the specialized functions.
   std::unordered_map<SpecializationKey, llvm::Function *,
                      SpecializationKeyHasher, SpecializationKeyEq>
@@ -441,7 +511,9 @@ private:
 } // namespace
 
 void LLVMIRGen::performSpecialization() {
-  FunctionSpecializer FuncSpecializer(llmodule_->getFunction("main"),
-                                      dontSpecializeArgsSet_, *this);
+  llvm::SmallVector<llvm::Function *, 4> entryFs{
+      llmodule_->getFunction("main")};
+  entryFs.append(segmentFunctions_.begin(), segmentFunctions_.end());
+  FunctionSpecializer FuncSpecializer(entryFs, dontSpecializeArgsSet_, *this);
   FuncSpecializer.run();
 }
@@ -16,8 +16,13 @@
 
 #include "glow/LLVMIRCodeGen/GlowJIT.h"
 #include "CommandLine.h"
+#include "glow/Support/ThreadPool.h"
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
 #include "llvm/ExecutionEngine/JITEventListener.h"
 #include "llvm/Object/SymbolSize.h"
+#include "llvm/Support/TargetRegistry.h"
+#include "llvm/Transforms/Utils/SplitModule.h"
 
 using GlowJIT = llvm::orc::GlowJIT;
 
@@ -165,6 +170,62 @@ GlowJIT::ModuleHandle GlowJIT::addModule(std::unique_ptr<llvm::Module> M) {
   return K;
 }
 
+std::vector<GlowJIT::ModuleHandle>
+GlowJIT::addModule(std::unique_ptr<llvm::Module> M, unsigned numThreads) {
+  if (numThreads < 2) {
+    return {addModule(std::move(M))};
+  }
+  // An LLVMContext can't be used by several threads, so every part is handed
+  // over as bitcode to a thread that reads it into a context of its own. The
+  // local symbols are externalized to be resolved across the parts.
+  std::vector<SmallString<0>> bitcodes;
+  SplitModule(std::move(M), numThreads,
+              [&](std::unique_ptr<Module> part) {
+                bitcodes.emplace_back();
+                raw_svector_ostream os(bitcodes.back());
+                WriteBitcodeToFile(*part, os);
+              },
+              /* PreserveLocals */ false);
+
+  std::vector<std::unique_ptr<MemoryBuffer>> objects(bitcodes.size());
+  {
+    glow::ThreadPool pool(bitcodes.size());
+    std::vector<std::future<void>> futures;
+    for (size_t i = 0, e = bitcodes.size(); i < e; i++) {
+      futures.push_back(pool.submit([this, &bitcodes, &objects, i]() {
+        LLVMContext ctx;
+        auto part = cantFail(parseBitcodeFile(
+            MemoryBufferRef(StringRef(bitcodes[i].data(), bitcodes[i].size()),
+                            "part" + std::to_string(i)),
+            ctx));
+        // The target machine isn't thread-safe, every thread uses a copy.
+        std::unique_ptr<TargetMachine> TM(TM_.getTarget().createTargetMachine(
+            TM_.getTargetTriple().str(), TM_.getTargetCPU(),
+            TM_.getTargetFeatureString(), TM_.Options,
+            TM_.getRelocationModel(), TM_.getCodeModel(), TM_.getOptLevel(),
+            /* JIT */ true));
+        objects[i] = SimpleCompiler(*TM)(*part);
+      }));
+    }
+    for (auto &future : futures) {
+      future.wait();
+    }
+  }
+
+  std::vector<ModuleHandle> handles;
+  for (auto &object : objects) {
+    handles.push_back(addObject(std::move(object)));
+  }
+  return handles;
+}
+
+GlowJIT::ModuleHandle
+GlowJIT::addObject(std::unique_ptr<MemoryBuffer> obj) {
+  auto K = ES_.allocateVModule();
+  cantFail(objectLayer_.addObject(K, std::move(obj)));
+  return K;
+}
+
 void GlowJIT::removeModule(GlowJIT::ModuleHandle H) {
   cantFail(compileLayer_.removeModule(H));
 }
@@ -17,13 +17,16 @@
 #include "glow/LLVMIRCodeGen/LLVMBackend.h"
 #include "BundleSaver.h"
 #include "CommandLine.h"
+#include "CompileCache.h"
 #include "glow/LLVMIRCodeGen/LLVMCompiledFunction.h"
 
 #include "glow/Backend/BackendUtils.h"
 #include "glow/Graph/Graph.h"
 #include "glow/Graph/PlaceholderBindings.h"
+#include "glow/IR/IRUtils.h"
 #include "glow/IR/Instrs.h"
 #include "glow/Optimizer/IROptimizer/IROptimizer.h"
+#include "glow/Runtime/StatsExporter.h"
 #include "glow/Support/Debug.h"
 
 #include "llvm/ADT/STLExtras.h"
@@ -33,20 +36,59 @@
 
 using namespace glow;
 
+extern llvm::cl::opt<bool> emitDebugInfo;
+
 namespace {
 
 //===----------------------------------------------------------------------===//
 //                   Functions for executing code using JIT
 //===----------------------------------------------------------------------===//
 
-/// Perform memory allocation for a JIT execution.
-void allocateJITMemory(const IRFunction *F, AllocationsInfo &allocationsInfo) {
+/// Perform memory allocation for a JIT execution, planning the activations
+/// offline if \p planActivationsOffline.
+void allocateJITMemory(const IRFunction *F, AllocationsInfo &allocationsInfo,
+                       bool planActivationsOffline) {
   allocationsInfo.numberValues(F);
-  allocationsInfo.allocateActivations(F);
+  allocationsInfo.allocateActivations(F, planActivationsOffline);
   allocationsInfo.allocateWeightVars(F);
   allocationsInfo.allocateTensorViews(F);
 }
 
+/// Set up \p function to bind placeholders without copying them, using the
+/// offsets assigned in \p allocationsInfo.
+void enableZeroCopy(LLVMCompiledFunction *function,
+                    const AllocationsInfo &allocationsInfo) {
+  std::vector<size_t> offsets(allocationsInfo.valueNumbers_.size());
+  llvm::StringMap<std::vector<LLVMCompiledFunction::PlaceholderOffset>>
+      placeholderOffsets;
+  for (auto &I : allocationsInfo.valueNumbers_) {
+    auto *V = I.first;
+    auto index = I.second.second;
+    auto offset = allocationsInfo.allocatedAddress_.lookup(V);
+    offsets[index] = offset;
+    if (I.second.first != AllocationsInfo::ValueKind::MutableWeight) {
+      continue;
+    }
+    // Slots of tensor views are relative to their origin placeholder.
+    auto *origin = getOrigin(V);
+    auto viewOffset = offset - allocationsInfo.allocatedAddress_.lookup(origin);
+    placeholderOffsets[origin->getName()].push_back({index, viewOffset});
+  }
+  function->enableZeroCopy(std::move(offsets), std::move(placeholderOffsets));
+}
+
+/// \returns whether \p IR can be recompiled after the payloads of the
+/// constants of its module have been cleared, which tiered compilation
+/// requires. The code of some instructions embeds constant values.
+bool canTierUp(const IRFunction &IR) {
+  for (const auto &I : IR.getInstrs()) {
+    if (llvm::isa<RowwiseQuantizedFullyConnectedInst>(&I)) {
+      return false;
+    }
+  }
+  return true;
+}
+
 } // end namespace
 
 LLVMBackend::LLVMBackend() {
@@ -63,37 +105,103 @@ LLVMBackend::LLVMBackend() {
 ///   void jitmain(uint8_t *baseConstantWeightVars,
 ///                uint8_t *baseInOutWeightVars,
 ///                nuint8_t *baseActivations);
+/// When placeholders are bound without copying, the entry point is called
+/// "jitmain_bound" and takes the offsets array as an additional argument:
+///   void jitmain_bound(uint8_t *baseConstantWeightVars,
+///                      uint8_t *baseInOutWeightVars,
+///                      uint8_t *baseActivations,
+///                      size_t *offsets);
+/// When the function is segmented, see LLVMIRGen::planInterOpSegments, the
+/// entry point "jitmain_segment", or "jitmain_bound_segment", takes the index
+/// of a segment as an additional argument and only runs that segment:
+///   void jitmain_segment(uint8_t *baseConstantWeightVars,
+///                        uint8_t *baseInOutWeightVars,
+///                        uint8_t *baseActivations,
+///                        size_t segment);
 void LLVMBackend::emitJitMain(LLVMIRGen &irgen) const {
   AllocationsInfo &allocationsInfo = irgen.getAllocationsInfo();
   llvm::Type *voidTy = llvm::Type::getVoidTy(irgen.getLLVMContext());
   auto int8PtrTy = llvm::Type::getInt8PtrTy(irgen.getLLVMContext());
+  llvm::SmallVector<llvm::Type *, 4> jitArgTys{int8PtrTy, int8PtrTy,
+                                               int8PtrTy};
+  if (llvmZeroCopyPlaceholders) {
+    jitArgTys.push_back(
+        llvm::Type::getIntNTy(irgen.getLLVMContext(),
+                              irgen.getLibjitSizeTWidth())
+            ->getPointerTo());
+  }
   llvm::FunctionType *jitFuncTy =
-      llvm::FunctionType::get(voidTy, {int8PtrTy, int8PtrTy, int8PtrTy}, false);
-  auto *func =
-      llvm::Function::Create(jitFuncTy, llvm::Function::ExternalLinkage,
-                             "jitmain", &irgen.getModule());
+      llvm::FunctionType::get(voidTy, jitArgTys, false);
+  auto *func = llvm::Function::Create(
+      jitFuncTy, llvm::Function::ExternalLinkage,
+      llvmZeroCopyPlaceholders ? "jitmain_bound" : "jitmain",
+      &irgen.getModule());
   llvm::BasicBlock *entry_bb =
       llvm::BasicBlock::Create(irgen.getLLVMContext(), "entry", func);
   llvm::IRBuilder<> builder(entry_bb);
 
   // Prepare arguments for the "main" function.
-  llvm::SmallVector<llvm::Value *, 4> initFunctionCallArgs;
-  initFunctionCallArgs.push_back(func->args().begin());
-  initFunctionCallArgs.push_back(func->args().begin() + 1);
-  initFunctionCallArgs.push_back(func->args().begin() + 2);
-  // Now form the offsets array and pass it as the last argument.
-  auto offsetsArray =
-      irgen.emitConstOffsetsArray(irgen.getBuilder(), allocationsInfo);
-  initFunctionCallArgs.push_back(offsetsArray);
+  llvm::Value *offsetsArray = nullptr;
+  auto getMainArgs = [&](llvm::Function *F) {
+    llvm::SmallVector<llvm::Value *, 4> args;
+    args.push_back(F->args().begin());
+    args.push_back(F->args().begin() + 1);
+    args.push_back(F->args().begin() + 2);
+    // Now form the offsets array and pass it as the last argument.
+    // Placeholders bound without copying get their offsets at runtime
+    // instead.
+    if (llvmZeroCopyPlaceholders) {
+      args.push_back(F->args().begin() + 3);
+      return args;
+    }
+    if (!offsetsArray) {
+      offsetsArray =
+          irgen.emitConstOffsetsArray(irgen.getBuilder(), allocationsInfo);
+    }
+    args.push_back(offsetsArray);
+    return args;
+  };
   // Invoke the main entry with constant arguments and let LLVM optimizer make
   // use of it.
   auto *entryF = irgen.getModule().getFunction(irgen.getMainEntryName());
   entryF->setLinkage(llvm::Function::InternalLinkage);
-  irgen.createCall(builder, entryF, initFunctionCallArgs);
+  irgen.createCall(builder, entryF, getMainArgs(func));
   // Terminate the function.
   builder.CreateRetVoid();
   // Create the debug info for the entry point function.
   irgen.generateFunctionDebugInfo(func);
+
+  size_t numSegments = irgen.getSegmentPreds().size();
+  if (!numSegments) {
+    return;
+  }
+  auto *sizeTTy = llvm::Type::getIntNTy(irgen.getLLVMContext(),
+                                        irgen.getLibjitSizeTWidth());
+  jitArgTys.push_back(sizeTTy);
+  auto *segmentFunc = llvm::Function::Create(
+      llvm::FunctionType::get(voidTy, jitArgTys, false),
+      llvm::Function::ExternalLinkage,
+      llvmZeroCopyPlaceholders ? "jitmain_bound_segment" : "jitmain_segment",
+      &irgen.getModule());
+  auto segmentArgs = getMainArgs(segmentFunc);
+  builder.SetInsertPoint(
+      llvm::BasicBlock::Create(irgen.getLLVMContext(), "entry", segmentFunc));
+  auto *exitBB =
+      llvm::BasicBlock::Create(irgen.getLLVMContext(), "exit", segmentFunc);
+  auto *segmentSwitch = builder.CreateSwitch(
+      segmentFunc->args().begin() + (jitArgTys.size() - 1), exitBB,
+      numSegments);
+  for (size_t idx = 0; idx < numSegments; idx++) {
+    auto *caseBB = llvm::BasicBlock::Create(irgen.getLLVMContext(),
+                                            "segment", segmentFunc);
+    segmentSwitch->addCase(builder.getIntN(irgen.getLibjitSizeTWidth(), idx),
+                           caseBB);
+    builder.SetInsertPoint(caseBB);
+    irgen.createCall(builder, irgen.getSegmentFunction(idx), segmentArgs);
+    builder.CreateBr(exitBB);
+  }
+  builder.SetInsertPoint(exitBB);
+  builder.CreateRetVoid();
 }
 
 std::unique_ptr<CompiledFunction>
@@ -106,60 +214,149 @@ LLVMBackend::compileIR(std::unique_ptr<IRFunction> IR) const {
 }
 
 std::unique_ptr<CompiledFunction>
-LLVMBackend::compileIRWithoutConstants(IRFunction *IR) const {
+LLVMBackend::compileIRWithoutConstants(IRFunction *IR,
+                                       unsigned optLevel) const {
+  auto start = std::chrono::steady_clock::now();
   AllocationsInfo allocationsInfo;
   std::unique_ptr<LLVMIRGen> irgen = createIRGen(IR, allocationsInfo);
+  irgen->setOptLevel(optLevel);
   llvm::SmallVector<std::string, 8> targetFeatures(llvmTargetFeatures.begin(),
                                                    llvmTargetFeatures.end());
   irgen->initTargetMachine(getTarget(), getArch(), getCPU(), targetFeatures,
                            getCodeModel(), getRelocModel());
-  irgen->initCodeGen();
-  // Perform the address assignment for activations and WeightVars.
-
-  allocateJITMemory(IR, irgen->getAllocationsInfo());
-  // Create the jitmain function to be invoked by JIT.
-  emitJitMain(*irgen);
-  // Emit the code for the body of the entry function.
-  irgen->performCodeGen();
-  // Hand over the module to JIT for the machine code generation.
-  auto JIT = llvm::make_unique<llvm::orc::GlowJIT>(irgen->getTargetMachine());
-  JIT->addModule(irgen->borrowModule());
   // Build runtimeBundle object containing offsets and allocation sizes.
   MemoryAllocator constantAllocator("ConstantWeights", 0);
   MemoryAllocator placeholderAllocator("Placeholders", 0);
   MemoryAllocator activationsAllocator("Activations", 0);
   auto runtimeInfo = runtime::RuntimeBundle::create(
-      *IR, constantAllocator, placeholderAllocator, activationsAllocator);
-  return createCompiledFunction(std::move(JIT), std::move(runtimeInfo));
+      *IR, constantAllocator, placeholderAllocator, activationsAllocator,
+      shouldPlanActivationsOffline());
+  auto JIT = llvm::make_unique<llvm::orc::GlowJIT>(irgen->getTargetMachine());
+
+  // Look for the object code of an identical earlier compilation.
+  CompileCache cache(llvmCompileCacheDir);
+  std::string cacheKey;
+  std::unique_ptr<llvm::MemoryBuffer> cachedObject;
+  if (!llvmCompileCacheDir.empty()) {
+    cacheKey = CompileCache::getKey(*IR, getBackendName(),
+                                    irgen->getTargetMachine(),
+                                    getLibjitBitcode());
+    cachedObject = cache.load(cacheKey, runtimeInfo);
+  }
+  // The segments aren't described by the debug info.
+  bool planSegments = llvmInterOpParallelism && !emitDebugInfo;
+
+  if (cachedObject) {
+    // Skip the LLVM code generation, only the addresses are needed. Only fully
+    // optimized code is stored in the cache.
+    optLevel = 2;
+    allocateJITMemory(IR, irgen->getAllocationsInfo(),
+                      shouldPlanActivationsOffline());
+    if (planSegments) {
+      irgen->planInterOpSegments();
+    }
+    JIT->addObject(std::move(cachedObject));
+  } else {
+    // Shared kernels are only resolved in the process, and the object code of
+    // the cache must be self-contained.
+    irgen->setShareSpecializations(llvmShareSpecializations &&
+                                   cacheKey.empty() && !emitDebugInfo);
+    irgen->initCodeGen();
+    // Perform the address assignment for activations and WeightVars.
+    allocateJITMemory(IR, irgen->getAllocationsInfo(),
+                      shouldPlanActivationsOffline());
+    if (planSegments) {
+      irgen->planInterOpSegments();
+    }
+    // Create the jitmain function to be invoked by JIT.
+    emitJitMain(*irgen);
+    // Emit the code for the body of the entry function.
+    irgen->performCodeGen();
+    if (cacheKey.empty() || optLevel < 2) {
+      // Hand over the module to JIT for the machine code generation.
+      JIT->addModule(irgen->borrowModule(), llvmCodegenThreads);
+    } else {
+      // Generate the machine code here to keep a copy of it in the cache.
+      llvm::orc::SimpleCompiler compiler(irgen->getTargetMachine());
+      auto object = compiler(irgen->getModule());
+      cache.store(cacheKey, runtimeInfo, *object);
+      JIT->addObject(std::move(object));
+    }
+  }
+  Stats()->addLatencyValue("compile_codegen", IR->getName(), start);
+  auto function =
+      createCompiledFunction(std::move(JIT), std::move(runtimeInfo));
+  static_cast<LLVMCompiledFunction *>(function.get())->setName(IR->getName());
+  static_cast<LLVMCompiledFunction *>(function.get())->setOptLevel(optLevel);
+  if (llvmZeroCopyPlaceholders) {
+    enableZeroCopy(static_cast<LLVMCompiledFunction *>(function.get()),
+                   irgen->getAllocationsInfo());
+  }
+  if (!irgen->getSegmentPreds().empty()) {
+    static_cast<LLVMCompiledFunction *>(function.get())
+        ->setSegmentPreds(irgen->getSegmentPreds());
+  }
+  return function;
 }
 
 Expected<std::unique_ptr<CompiledFunction>>
 LLVMBackend::compile(Function *F, const BackendOptions &opts) const {
   TraceInfo traceInfo = buildManualTraceInfo(F);
   auto IR = generateAndOptimizeIR(F, *this, shouldShareBuffers());
+  tileInstructionChains(*IR, llvmTileCacheSize);
+  if (llvmStridedViews) {
+    createStridedViews(*IR);
+  }
 
   if (opts.autoInstrument) {
     autoInstrument(traceInfo, IR.get());
   }
 
   std::unique_ptr<CompiledFunction> compiledFunc;
-  if (opts.collectConstants) {
+  if (llvmTieredCompile && canTierUp(*IR)) {
+    compiledFunc = compileIRWithoutConstants(IR.get(), /* optLevel */ 0);
+    if (opts.collectConstants) {
+      compiledFunc->getRuntimeBundle().collectConstants(IR.get());
+    }
+    auto *llvmFunc = static_cast<LLVMCompiledFunction *>(compiledFunc.get());
+    if (llvmFunc->getOptLevel() < 2) {
+      llvmFunc->setTierUpIR(std::move(IR));
+    }
+  } else if (opts.collectConstants) {
     compiledFunc = compileIR(std::move(IR));
   } else {
     compiledFunc = compileIRWithoutConstants(IR.get());
   }
 
   compiledFunc->setTraceInfo(std::move(traceInfo));
+  static_cast<LLVMCompiledFunction *>(compiledFunc.get())
+      ->setMemoryBound(opts.backendHints.memoryBound);
   return Expected<std::unique_ptr<CompiledFunction>>(std::move(compiledFunc));
 }
 
 void LLVMBackend::save(Function *F, llvm::StringRef outputDir,
                        llvm::StringRef bundleName,
                        llvm::StringRef mainEntryName) const {
+  saveFunctions({{mainEntryName.str(), F}}, outputDir, bundleName);
+}
+
+void LLVMBackend::saveFunctions(llvm::ArrayRef<BundleEntry> entries,
+                                llvm::StringRef outputDir,
+                                llvm::StringRef bundleName) const {
   llvm::SmallVector<std::string, 8> targetFeatures(llvmTargetFeatures.begin(),
                                                    llvmTargetFeatures.end());
-  auto IR = generateAndOptimizeIR(F, *this, shouldShareBuffers());
-  BundleSaver(IR.get(), *this)
+  std::vector<std::unique_ptr<IRFunction>> IRs;
+  std::vector<BundleSaver::SavedIRFunction> savedFunctions;
+  for (auto &entry : entries) {
+    IRs.push_back(
+        generateAndOptimizeIR(entry.func, *this, shouldShareBuffers()));
+    tileInstructionChains(*IRs.back(), llvmTileCacheSize);
+    if (llvmStridedViews) {
+      createStridedViews(*IRs.back());
+    }
+    savedFunctions.push_back({entry.name, IRs.back().get()});
+  }
+  BundleSaver(savedFunctions, *this)
       .save(getTarget(), getArch(), getCPU(), targetFeatures, outputDir,
-            bundleName, mainEntryName, getCodeModel(), getRelocModel());
+            bundleName, getCodeModel(), getRelocModel());
 }
@@ -14,27 +14,269 @@
  * limitations under the License.
  */
 #include "glow/LLVMIRCodeGen/LLVMCompiledFunction.h"
+#include "CommandLine.h"
 
 #include "glow/Graph/PlaceholderBindings.h"
+#include "glow/Runtime/StatsExporter.h"
 #include "glow/Support/Compiler.h"
 #include "glow/Support/Memory.h"
+#include "glow/Support/ThreadPool.h"
+
+#include <condition_variable>
+#include <functional>
 
 using namespace glow;
 
+namespace {
+/// Allocate a pre-faulted buffer of \p size bytes, or \returns nullptr if
+/// \p size is 0.
+uint8_t *allocExecutionBuffer(size_t size) {
+  if (size == 0) {
+    return nullptr;
+  }
+  auto *buf = (uint8_t *)(llvmHugePageBuffers
+                              ? hugePageAlloc(size)
+                              : alignedAlloc(size, TensorAlignment));
+  // Touch all pages now rather than during the first execution.
+  memset(buf, 0, size);
+  return buf;
+}
+} // namespace
+
 LLVMCompiledFunction::LLVMCompiledFunction(
     std::unique_ptr<llvm::orc::GlowJIT> JIT,
     runtime::RuntimeBundle &&runtimeBundle)
     : CompiledFunction(std::move(runtimeBundle)), JIT_(std::move(JIT)) {}
 
+LLVMCompiledFunction::~LLVMCompiledFunction() {
+  for (auto &buffers : freeBuffers_) {
+    alignedFree(buffers.mutableWeights);
+    alignedFree(buffers.activations);
+  }
+}
+
+LLVMCompiledFunction::ExecutionBuffers LLVMCompiledFunction::acquireBuffers() {
+  {
+    std::lock_guard<std::mutex> lock(buffersLock_);
+    if (!freeBuffers_.empty()) {
+      ExecutionBuffers buffers = freeBuffers_.back();
+      freeBuffers_.pop_back();
+      return buffers;
+    }
+  }
+  ExecutionBuffers buffers;
+  buffers.activations =
+      allocExecutionBuffer(runtimeBundle_.getActivationsSize());
+  buffers.mutableWeights =
+      allocExecutionBuffer(runtimeBundle_.getMutableWeightSize());
+  return buffers;
+}
+
+void LLVMCompiledFunction::releaseBuffers(ExecutionBuffers buffers) {
+  std::lock_guard<std::mutex> lock(buffersLock_);
+  freeBuffers_.push_back(buffers);
+}
+
 void LLVMCompiledFunction::collectConstants(const Module *module) {
   runtimeBundle_.collectConstants(module);
 }
 
+void LLVMCompiledFunction::freeCompilationResources() {
+  runtimeBundle_.eraseSymbols(runtime::SymbolCategory::Activation);
+  if (runtimeBundle_.getConstants() ||
+      !runtimeBundle_.getConstantWeightSize()) {
+    runtimeBundle_.eraseSymbols(runtime::SymbolCategory::Constant);
+    runtimeBundle_.eraseSymbols(runtime::SymbolCategory::ConstantTensorView);
+  }
+}
+
+Expected<llvm::JITTargetAddress>
+LLVMCompiledFunction::findAddress(llvm::StringRef name,
+                                  llvm::JITTargetAddress &address) {
+  std::lock_guard<std::mutex> lock(JITLock_);
+  if (address) {
+    return address;
+  }
+  auto sym = JIT_->findSymbol(name);
+  DCHECK(sym) << "Unable to JIT the code!";
+  auto addrOrLLVMError = sym.getAddress();
+  if (!addrOrLLVMError) {
+    return MAKE_ERR(
+        strFormat("Failed to get address: %s",
+                  llvm::toString(addrOrLLVMError.takeError()).data()));
+  }
+  address = addrOrLLVMError.get();
+  return address;
+}
+
+Expected<llvm::JITTargetAddress> LLVMCompiledFunction::getJitmainAddress() {
+  return findAddress(zeroCopy_ ? "jitmain_bound" : "jitmain",
+                     jitmainAddress_);
+}
+
+Expected<llvm::JITTargetAddress> LLVMCompiledFunction::getSegmentAddress() {
+  return findAddress(zeroCopy_ ? "jitmain_bound_segment" : "jitmain_segment",
+                     segmentAddress_);
+}
+
+void LLVMCompiledFunction::setSegmentPreds(
+    const std::vector<std::vector<unsigned>> &segmentPreds) {
+  segmentSuccs_.assign(segmentPreds.size(), {});
+  segmentNumPreds_.assign(segmentPreds.size(), 0);
+  for (unsigned idx = 0, e = segmentPreds.size(); idx < e; idx++) {
+    for (unsigned pred : segmentPreds[idx]) {
+      segmentSuccs_[pred].push_back(idx);
+    }
+    segmentNumPreds_[idx] = segmentPreds[idx].size();
+  }
+}
+
+void LLVMCompiledFunction::runSegments(ThreadPool &pool,
+                                       llvm::JITTargetAddress address,
+                                       uint8_t *mutableWeights,
+                                       uint8_t *activations, size_t *offsets) {
+  using SegmentFuncType =
+      void (*)(uint8_t * constantWeightVars, uint8_t * mutableWeightVars,
+               uint8_t * activations, size_t segment);
+  using BoundSegmentFuncType =
+      void (*)(uint8_t * constantWeightVars, uint8_t * mutableWeightVars,
+               uint8_t * activations, size_t * offsets, size_t segment);
+  uint8_t *constants = runtimeBundle_.getConstants();
+
+  std::mutex lock;
+  std::condition_variable done;
+  std::vector<unsigned> numPending(segmentNumPreds_);
+  size_t numRemaining = numPending.size();
+
+  // Run the segment idx, then one of the segments which it was the last
+  // dependency of on the same thread, and submit the others to the pool.
+  std::function<void(unsigned)> run = [&](unsigned idx) {
+    while (true) {
+      if (zeroCopy_) {
+        reinterpret_cast<BoundSegmentFuncType>(address)(
+            constants, mutableWeights, activations, offsets, idx);
+      } else {
+        reinterpret_cast<SegmentFuncType>(address)(constants, mutableWeights,
+                                                   activations, idx);
+      }
+      llvm::SmallVector<unsigned, 4> ready;
+      {
+        std::lock_guard<std::mutex> guard(lock);
+        for (unsigned succ : segmentSuccs_[idx]) {
+          if (--numPending[succ] == 0) {
+            ready.push_back(succ);
+          }
+        }
+        if (--numRemaining == 0) {
+          done.notify_all();
+        }
+      }
+      // Nothing captured may be accessed once the last segment is done.
+      if (ready.empty()) {
+        return;
+      }
+      for (size_t i = 1, e = ready.size(); i < e; i++) {
+        pool.submit([&run, succ = ready[i]]() { run(succ); });
+      }
+      idx = ready[0];
+    }
+  };
+
+  // The calling thread runs the first segment, so that its kernels use the
+  // intra-op threads which are idle.
+  llvm::SmallVector<unsigned, 4> roots;
+  for (unsigned idx = 0, e = segmentNumPreds_.size(); idx < e; idx++) {
+    if (!segmentNumPreds_[idx]) {
+      roots.push_back(idx);
+    }
+  }
+  for (size_t i = 1, e = roots.size(); i < e; i++) {
+    pool.submit([&run, root = roots[i]]() { run(root); });
+  }
+  run(roots[0]);
+  std::unique_lock<std::mutex> guard(lock);
+  done.wait(guard, [&]() { return numRemaining == 0; });
+}
+
+Error LLVMCompiledFunction::warmUp() {
+  RETURN_IF_ERR(getJitmainAddress().takeError());
+  if (!segmentSuccs_.empty()) {
+    RETURN_IF_ERR(getSegmentAddress().takeError());
+  }
+
+  // Read a byte of every page of the constants, so that the first runs don't
+  // fault them in.
+  constexpr size_t pageSize = 4096;
+  const uint8_t *constants = runtimeBundle_.getConstants();
+  if (constants) {
+    volatile uint8_t sink = 0;
+    for (size_t i = 0, e = runtimeBundle_.getConstantWeightSize(); i < e;
+         i += pageSize) {
+      sink += constants[i];
+    }
+  }
+
+  // New execution buffers are pre-faulted, pool a set for the first run.
+  releaseBuffers(acquireBuffers());
+  return Error::success();
+}
+
+void LLVMCompiledFunction::enableZeroCopy(
+    std::vector<size_t> offsets,
+    llvm::StringMap<std::vector<PlaceholderOffset>> placeholderOffsets) {
+  zeroCopy_ = true;
+  jitmainAddress_ = 0;
+  offsets_ = std::move(offsets);
+  placeholderOffsets_ = std::move(placeholderOffsets);
+}
+
+void LLVMCompiledFunction::bindPlaceholders(
+    PlaceholderBindings *bindings, uint8_t *baseMutableWeightVarsAddress,
+    std::vector<size_t> &offsets,
+    std::unordered_set<const Placeholder *> &bound) {
+  auto &symbolTable = runtimeBundle_.getSymbolTable();
+  std::unordered_set<const char *> payloads;
+  for (auto PH : bindings->pairs()) {
+    auto it = symbolTable.find(PH.first->getName());
+    if (it == symbolTable.end()) {
+      continue;
+    }
+    auto slotsIt = placeholderOffsets_.find(PH.first->getName());
+    if (slotsIt == placeholderOffsets_.end()) {
+      continue;
+    }
+    auto payload = PH.second->getUnsafePtr();
+    // The JITed code assumes the alignment of the mutable weights memory
+    // block. Copy the tensor if its payload does not provide it.
+    if (reinterpret_cast<uintptr_t>(payload) % TensorAlignment != 0 ||
+        PH.second->getUnpaddedSizeInBytes() != it->second.size) {
+      continue;
+    }
+    // A tensor backing several placeholders, e.g. an input and an output,
+    // must not alias them.
+    if (!payloads.insert(payload).second) {
+      continue;
+    }
+    // The address of a slot is computed as base + offset, using wrapping
+    // size_t arithmetic.
+    auto base = reinterpret_cast<uintptr_t>(baseMutableWeightVarsAddress);
+    for (const auto &slot : slotsIt->second) {
+      offsets[slot.index] =
+          reinterpret_cast<uintptr_t>(payload) + slot.viewOffset - base;
+    }
+    bound.insert(PH.first);
+  }
+}
+
 void LLVMCompiledFunction::loadPlaceholders(
-    PlaceholderBindings *bindings, uint8_t *baseMutableWeightVarsAddress) {
+    PlaceholderBindings *bindings, uint8_t *baseMutableWeightVarsAddress,
+    const std::unordered_set<const Placeholder *> &bound) {
   // Copy Placeholders into allocated memory.
   auto &symbolTable = runtimeBundle_.getSymbolTable();
   for (auto PH : bindings->pairs()) {
+    if (bound.count(PH.first)) {
+      continue;
+    }
     auto it = symbolTable.find(PH.first->getName());
     if (it == symbolTable.end()) {
       continue;
@@ -45,14 +287,24 @@ void LLVMCompiledFunction::loadPlaceholders(
     auto numBytes = PH.second->getUnpaddedSizeInBytes();
     // copy PH to allocated memory.
     memcpy(baseMutableWeightVarsAddress + addr, payload, numBytes);
+    // Zero the padding of a partial tensor, which a ragged placeholder
+    // leaves undefined.
+    if (!PH.first->isRagged() && numBytes < symbolInfo.size) {
+      memset(baseMutableWeightVarsAddress + addr + numBytes, 0,
+             symbolInfo.size - numBytes);
+    }
   }
 }
 
 void LLVMCompiledFunction::updatePlaceholders(
-    PlaceholderBindings *bindings, uint8_t *baseMutableWeightVarsAddress) {
+    PlaceholderBindings *bindings, uint8_t *baseMutableWeightVarsAddress,
+    const std::unordered_set<const Placeholder *> &bound) {
   // Copy placeholders from device back into bindings.
   auto &symbolTable = runtimeBundle_.getSymbolTable();
   for (auto PH : bindings->pairs()) {
+    if (bound.count(PH.first)) {
+      continue;
+    }
     auto it = symbolTable.find(PH.first->getName());
     if (it == symbolTable.end()) {
       continue;
@@ -67,74 +319,99 @@ void LLVMCompiledFunction::updatePlaceholders(
 }
 
 Error LLVMCompiledFunction::execute(ExecutionContext *context) {
-  uint8_t *baseActivationsAddress{nullptr};
-
-  /// Base address for Mutable weights memory block, Inputs and Outputs.
-  uint8_t *baseMutableWeightVarsAddress{nullptr};
-
+  ExecutionBuffers buffers;
   {
     TRACE_EVENT_SCOPE(context, TraceLevel::RUNTIME, "allocBuffers");
-    if (runtimeBundle_.getActivationsSize() != 0) {
-      baseActivationsAddress = (uint8_t *)alignedAlloc(
-          runtimeBundle_.getActivationsSize(), TensorAlignment);
-    }
+    buffers = acquireBuffers();
+  }
+  uint8_t *baseActivationsAddress = buffers.activations;
 
-    if (runtimeBundle_.getMutableWeightSize() != 0) {
-      baseMutableWeightVarsAddress = (uint8_t *)alignedAlloc(
-          runtimeBundle_.getMutableWeightSize(), TensorAlignment);
-    }
+  /// Base address for Mutable weights memory block, Inputs and Outputs.
+  uint8_t *baseMutableWeightVarsAddress = buffers.mutableWeights;
+
+  /// Offsets passed to "jitmain_bound" and the placeholders bound through
+  /// them, which are neither loaded nor updated.
+  std::vector<size_t> offsets;
+  std::unordered_set<const Placeholder *> bound;
+  if (zeroCopy_) {
+    TRACE_EVENT_SCOPE(context, TraceLevel::RUNTIME, "bindPlaceholders");
+    offsets = offsets_;
+    bindPlaceholders(context->getPlaceholderBindings(),
+                     baseMutableWeightVarsAddress, offsets, bound);
   }
 
+  // Export the latency of the copies and of the kernels of sampled runs.
+  bool sampled = context->isStatsSampled();
+  std::chrono::steady_clock::time_point stageStart;
+  if (sampled) {
+    stageStart = std::chrono::steady_clock::now();
+  }
   {
     TRACE_EVENT_SCOPE(context, TraceLevel::RUNTIME, "loadPlaceholders");
     loadPlaceholders(context->getPlaceholderBindings(),
-                     baseMutableWeightVarsAddress);
+                     baseMutableWeightVarsAddress, bound);
+  }
+  if (sampled) {
+    Stats()->addLatencyValue("copy_in", name_, stageStart);
   }
 
   auto *traceContext = context->getTraceContext();
   TRACE_EVENT_SCOPE_NAMED(traceContext, TraceLevel::RUNTIME,
                           "findJitmainSymbol", fjEvent);
-  Expected<llvm::JITTargetAddress> address = NULL;
-  {
-    std::lock_guard<std::mutex> lock(JITLock_);
-    auto sym = JIT_->findSymbol("jitmain");
-
-    DCHECK(sym) << "Unable to JIT the code!";
-    // We know address is success since we just made it. Mark it as checked.
-    if (address) {
-      auto addrOrLLVMError = sym.getAddress();
-      if (addrOrLLVMError) {
-        address = addrOrLLVMError.get();
-      } else {
-        address = MAKE_ERR(
-            strFormat("Failed to get address: %s",
-                      llvm::toString(addrOrLLVMError.takeError()).data()));
-      }
-    }
+  // Run the segments of the function concurrently when there are threads
+  // to run them.
+  ThreadPool *pool = segmentSuccs_.empty() ? nullptr : getInterOpPool();
+  if (pool && !pool->getNumWorkers()) {
+    pool = nullptr;
   }
+  auto address = pool ? getSegmentAddress() : getJitmainAddress();
   using JitFuncType =
       void (*)(uint8_t * constantWeightVars, uint8_t * mutableWeightVars,
                uint8_t * activations);
+  using BoundJitFuncType =
+      void (*)(uint8_t * constantWeightVars, uint8_t * mutableWeightVars,
+               uint8_t * activations, size_t * offsets);
   if (address) {
-    JitFuncType funcPtr = reinterpret_cast<JitFuncType>(address.get());
     TRACE_EVENT_SCOPE_END_NAMED(fjEvent);
     TRACE_EVENT_SCOPE(traceContext, TraceLevel::RUNTIME, "execute");
-    funcPtr(runtimeBundle_.getConstants(), baseMutableWeightVarsAddress,
-            baseActivationsAddress);
+    if (sampled) {
+      stageStart = std::chrono::steady_clock::now();
+    }
+    if (pool) {
+      runSegments(*pool, address.get(), baseMutableWeightVarsAddress,
+                  baseActivationsAddress, offsets.data());
+    } else if (zeroCopy_) {
+      auto funcPtr = reinterpret_cast<BoundJitFuncType>(address.get());
+      funcPtr(runtimeBundle_.getConstants(), baseMutableWeightVarsAddress,
+              baseActivationsAddress, offsets.data());
+    } else {
+      auto funcPtr = reinterpret_cast<JitFuncType>(address.get());
+      funcPtr(runtimeBundle_.getConstants(), baseMutableWeightVarsAddress,
+              baseActivationsAddress);
+    }
+    if (sampled) {
+      Stats()->addLatencyValue("kernel", name_, stageStart);
+    }
   } else {
-    RETURN_ERR("Error getting address");
+    releaseBuffers(buffers);
+    return address.takeError();
   }
 
+  if (sampled) {
+    stageStart = std::chrono::steady_clock::now();
+  }
   {
     TRACE_EVENT_SCOPE(context, TraceLevel::RUNTIME, "updatePlaceholders");
     updatePlaceholders(context->getPlaceholderBindings(),
-                       baseMutableWeightVarsAddress);
+                       baseMutableWeightVarsAddress, bound);
+  }
+  if (sampled) {
+    Stats()->addLatencyValue("copy_out", name_, stageStart);
   }
 
   {
     TRACE_EVENT_SCOPE(context, TraceLevel::RUNTIME, "freeBuffers");
-    alignedFree(baseMutableWeightVarsAddress);
-    alignedFree(baseActivationsAddress);
+    releaseBuffers(buffers);
   }
 
   {
@@ -174,11 +451,11 @@ void LLVMCompiledFunction::translateTraceEvents(
         memcpy(&start,
                backingTensor->getUnsafePtr() +
                    (event.startIndex * traceInfo.dataSize),
-               traceInfo.dataSize);
+               sizeof(uint64_t));
         memcpy(&end,
                backingTensor->getUnsafePtr() +
                    (event.endIndex * traceInfo.dataSize),
-               traceInfo.dataSize);
+               sizeof(uint64_t));
         traceEvents.push_back(
             {event.name, start, end - start, tid, {{"kind", event.kind}}});
       } else {
@@ -186,7 +463,7 @@ void LLVMCompiledFunction::translateTraceEvents(
         memcpy(&ts,
                backingTensor->getUnsafePtr() +
                    (event.startIndex * traceInfo.dataSize),
-               traceInfo.dataSize);
+               sizeof(uint64_t));
         traceEvents.push_back(
             {event.name, ts, event.type, tid, {{"kind", event.kind}}});
       }
@@ -25,7 +25,11 @@
 #include "glow/IR/Instrs.h"
 #include "glow/Quantization/Base/Base.h"
 
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Analysis/TargetTransformInfo.h"
 #include "llvm/ExecutionEngine/ExecutionEngine.h"
+#include "llvm/IR/Intrinsics.h"
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/IR/Verifier.h"
 #include "llvm/IRReader/IRReader.h"
@@ -35,6 +39,10 @@
 #include "llvm/Support/TargetSelect.h"
 #include "llvm/Target/TargetMachine.h"
 
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
 using namespace glow;
 using llvm::cast;
 using llvm::dyn_cast;
@@ -57,6 +65,11 @@ llvm::cl::opt<bool>
 /// Limitation of number of arguments for `emitDataParallelKernel`.
 constexpr static size_t kArgLimit = 64;
 
+/// Number of elements processed at a time by a fused data-parallel kernel.
+/// The scratch buffers holding the kernel-local results of a block are small
+/// enough to stay in the L1 cache, when they are not promoted to registers.
+constexpr static size_t kFusedBlockSize = 512;
+
 /// Generate the LLVM machine attribute list for the host.
 static llvm::SmallVector<std::string, 0> getHostMachineAttributes() {
   llvm::SmallVector<std::string, 0> result;
@@ -65,8 +78,8 @@ static llvm::SmallVector<std::string, 0> getHostMachineAttributes() {
     for (auto &feature : hostFeatures) {
       if (feature.second) {
         llvm::StringRef fn = feature.first();
-        // Skip avx512 because LLVM does not support it well.
-        if (fn.startswith("avx512")) {
+        // Skip avx512 because LLVM does not support it well, unless requested.
+        if (fn.startswith("avx512") && !llvmEnableAVX512) {
           continue;
         }
         result.push_back(fn);
@@ -79,8 +92,10 @@ static llvm::SmallVector<std::string, 0> getHostMachineAttributes() {
 /// Returns the CPU hostname.
 static llvm::StringRef getHostCpuName() {
   auto cpu_name = llvm::sys::getHostCPUName();
-  // Skip avx512 because LLVM does not support it well.
-  cpu_name.consume_back("-avx512");
+  // Skip avx512 because LLVM does not support it well, unless requested.
+  if (!llvmEnableAVX512) {
+    cpu_name.consume_back("-avx512");
+  }
   return cpu_name;
 }
 
@@ -225,7 +240,8 @@ llvm::Type *LLVMIRGen::getElementType(llvm::IRBuilder<> &builder,
   case ElemKind::FloatTy:
     return builder.getFloatTy();
   case ElemKind::Float16Ty:
-    llvm_unreachable("Not implemented");
+    // Half precision numbers are passed to libjit as their raw bits.
+    return builder.getInt16Ty();
   case ElemKind::Int8QTy:
     return builder.getInt8Ty();
   case ElemKind::UInt8QTy:
@@ -371,8 +387,16 @@ llvm::Value *LLVMIRGen::emitValueAddress(llvm::IRBuilder<> &builder,
   }
 
   // Use relative addressing.
-  // Get offset.
-  auto valueIdx = llvm::ConstantInt::get(sizeTTy, kindAndValue.second);
+  // Get offset. In the body of a loop over repeated instructions, the value
+  // numbers of their operands are read from the row of the repetition.
+  llvm::Value *valueIdx =
+      llvm::ConstantInt::get(sizeTTy, kindAndValue.second);
+  auto slotIt = repeatSlots_.find(val);
+  if (slotIt != repeatSlots_.end()) {
+    auto *slot = llvm::ConstantInt::get(sizeTTy, slotIt->second);
+    auto *slotAddr = builder.CreateGEP(sizeTTy, repeatValues_, slot);
+    valueIdx = builder.CreateLoad(sizeTTy, slotAddr);
+  }
   auto offsetAddr = builder.CreateGEP(sizeTTy, offsetsArray_, valueIdx);
   auto offsetValue = builder.CreateLoad(sizeTTy, offsetAddr);
   // Add offset to the base address.
@@ -485,8 +509,12 @@ llvm::Value *LLVMIRGen::emitConst(llvm::IRBuilder<> &builder, float val,
   switch (kind) {
   case ElemKind::FloatTy:
     return llvm::ConstantFP::get(llvm::Type::getFloatTy(ctx_), val);
-  case ElemKind::Float16Ty:
-    llvm_unreachable("Not implemented");
+  case ElemKind::Float16Ty: {
+    float16 half(val);
+    uint16_t bits;
+    memcpy(&bits, &half, sizeof(bits));
+    return builder.getInt16(bits);
+  }
   case ElemKind::Int64ITy:
     return builder.getInt64(static_cast<int64_t>(val));
   case ElemKind::Int8QTy:
@@ -542,8 +570,12 @@ llvm::Function *LLVMIRGen::getFunction(const std::string &name,
   switch (elemTy) {
   case ElemKind::FloatTy:
     return get("libjit_" + name + "_f");
+  case ElemKind::Float16Ty:
+    return get("libjit_" + name + "_f16");
   case ElemKind::Int8QTy:
     return get("libjit_" + name + "_i8");
+  case ElemKind::Int16QTy:
+    return get("libjit_" + name + "_i16");
   case ElemKind::Int32QTy:
     return get("libjit_" + name + "_i32");
   case ElemKind::Int32ITy:
@@ -576,6 +608,30 @@ llvm::CallInst *LLVMIRGen::createCall(llvm::IRBuilder<> &builder,
   return builder.CreateCall(callee, args);
 }
 
+/// Attach to the back edge \p backEdge of a loop the llvm.loop.vectorize.enable
+/// metadata with the value \p enable.
+static void setLoopVectorizeMetadata(llvm::Instruction *backEdge,
+                                     llvm::LLVMContext &ctx, bool enable) {
+  llvm::SmallVector<llvm::Metadata *, 4> args;
+  // Reserve operand 0 for loop id self reference.
+  //
+  // Initialize it with a special temporary metadata node, which is typically
+  // used to create cyclic metadata structures. tmpMD is a unique_ptr and thus
+  // will be freed automatically when it goes out of scope.
+  llvm::TempMDTuple tmpMD = llvm::MDNode::getTemporary(ctx, llvm::None);
+  args.push_back(tmpMD.get());
+  llvm::Metadata *Vals[] = {
+      // Reserve operand 0 for loop id self reference.
+      llvm::MDString::get(ctx, "llvm.loop.vectorize.enable"),
+      llvm::ConstantAsMetadata::get(
+          llvm::ConstantInt::get(llvm::Type::getInt1Ty(ctx), enable))};
+  args.push_back(llvm::MDNode::get(ctx, Vals));
+  auto *loopMD = llvm::MDNode::get(ctx, args);
+  // Set the first operand to itself.
+  loopMD->replaceOperandWith(0, loopMD);
+  backEdge->setMetadata(llvm::LLVMContext::MD_loop, loopMD);
+}
+
 std::pair<llvm::BasicBlock *, llvm::BasicBlock *>
 LLVMIRGen::createLoop(llvm::IRBuilder<> &builder, llvm::LLVMContext &ctx,
                       llvm::Value *numElements) const {
@@ -614,30 +670,41 @@ LLVMIRGen::createLoop(llvm::IRBuilder<> &builder, llvm::LLVMContext &ctx,
   // loop to help the LLVM vectorizer. Without this metadata, LLVM loop
   // vectorizer bails on long data-parallel loops with a lot of operations. This
   // metadata forces it to vectorize them anyways.
-  llvm::SmallVector<llvm::Metadata *, 4> args;
-  // Reserve operand 0 for loop id self reference.
-  //
-  // Initialize it with a special temporary metadata node, which is typically
-  // used to create cyclic metadata structures. tmpMD is a unique_ptr and thus
-  // will be freed automatically when it goes out of scope.
-  llvm::TempMDTuple tmpMD = llvm::MDNode::getTemporary(ctx, llvm::None);
-  args.push_back(tmpMD.get());
-  llvm::Metadata *Vals[] = {
-      // Reserve operand 0 for loop id self reference.
-      llvm::MDString::get(ctx, "llvm.loop.vectorize.enable"),
-      llvm::ConstantAsMetadata::get(
-          llvm::ConstantInt::get(llvm::Type::getInt1Ty(ctx), true))};
-  args.push_back(llvm::MDNode::get(ctx, Vals));
-  auto *loopMD = llvm::MDNode::get(ctx, args);
-  // Set the first operand to itself.
-  loopMD->replaceOperandWith(0, loopMD);
-  backEdge->setMetadata(llvm::LLVMContext::MD_loop, loopMD);
+  setLoopVectorizeMetadata(backEdge, ctx, true);
   // Add a new entry to the PHI node for the backedge.
   var->addIncoming(nextVal, loopBB);
   builder.SetInsertPoint(afterBB);
   return std::make_pair(loopBB, afterBB);
 }
 
+std::pair<llvm::BasicBlock *, llvm::BasicBlock *>
+LLVMIRGen::createLoop(llvm::IRBuilder<> &builder, llvm::LLVMContext &ctx,
+                      llvm::Value *begin, llvm::Value *end, size_t step,
+                      bool vectorize) const {
+  auto sizeTTy = builder.getIntNTy(getLibjitSizeTWidth());
+  llvm::Function *func = builder.GetInsertBlock()->getParent();
+  auto *preheaderBB = builder.GetInsertBlock();
+  auto *loopBB = llvm::BasicBlock::Create(ctx, "loop", func);
+  auto *afterBB = llvm::BasicBlock::Create(ctx, "afterloop", func);
+
+  // Skip the loop if it has no iteration.
+  builder.CreateCondBr(builder.CreateICmpULT(begin, end, "loopguard"), loopBB,
+                       afterBB);
+
+  builder.SetInsertPoint(loopBB);
+  llvm::PHINode *var = builder.CreatePHI(sizeTTy, 2);
+  var->addIncoming(begin, preheaderBB);
+  auto *stepVal = llvm::ConstantInt::get(sizeTTy, step);
+  auto *nextVal = builder.CreateAdd(var, stepVal, "nextvar", /* HasNUW */ true,
+                                    /* HasNSW */ true);
+  auto *endCond = builder.CreateICmpULT(nextVal, end, "loopcond");
+  auto *backEdge = builder.CreateCondBr(endCond, loopBB, afterBB);
+  setLoopVectorizeMetadata(backEdge, ctx, vectorize);
+  var->addIncoming(nextVal, loopBB);
+  builder.SetInsertPoint(afterBB);
+  return std::make_pair(loopBB, afterBB);
+}
+
 /// Emit the address of the buffer \p v inside a data-parallel kernel \p kernel
 /// using the mapping provided by \p bufferToArgNum.
 llvm::Value *
@@ -648,8 +715,73 @@ LLVMIRGen::emitBufferAddress(llvm::IRBuilder<> &builder, Value *val,
   return kernel->args().begin() + bufferToArgNum[val];
 }
 
+/// \returns true if the buffer \p buf is an activation that is only accessed
+/// by the instructions of \p bundle, the first of which overwrites it. Such a
+/// buffer only carries values from one instruction of the data-parallel kernel
+/// to the next, so its contents never need to reach memory.
+static bool isKernelLocalBuffer(const Value *buf,
+                                llvm::ArrayRef<const Instruction *> bundle) {
+  if (!isa<AllocActivationInst>(buf) ||
+      buf->size() != bundle[0]->getOperand(0).first->size()) {
+    return false;
+  }
+  for (const auto &U : buf->getUsers()) {
+    const Instruction *user = U.get();
+    if (isa<DeallocActivationInst>(user)) {
+      continue;
+    }
+    if (std::find(bundle.begin(), bundle.end(), user) == bundle.end()) {
+      return false;
+    }
+  }
+  for (const auto *I : bundle) {
+    bool reads = false;
+    bool writes = false;
+    for (const auto &op : I->getOperands()) {
+      if (op.first == buf) {
+        reads |= op.second != OperandKind::Out;
+        writes |= op.second != OperandKind::In;
+      }
+    }
+    if (reads || writes) {
+      return writes && !reads;
+    }
+  }
+  return false;
+}
+
+/// \returns the number of elements of the rows of the strided views, see
+/// getStridedViewLayout, accessed by the instructions of \p bundle, which all
+/// have the same rows, or 0 if they don't access strided views.
+static size_t getStridedRowLen(llvm::ArrayRef<const Instruction *> bundle) {
+  for (const auto *I : bundle) {
+    for (const auto &op : I->getOperands()) {
+      size_t rowLen = 0;
+      size_t pitch = 0;
+      if (getStridedViewLayout(op.first, rowLen, pitch)) {
+        return rowLen;
+      }
+    }
+  }
+  return 0;
+}
+
 /// Implementation of emitDataParallelKernel where we guarantee that the number
 /// of arguments will be bound by 64.
+///
+/// When fusion is enabled and some buffers are local to the kernel (see
+/// isKernelLocalBuffer), the kernel takes the number of elements to process as
+/// an extra argument, and is invoked by a driver on blocks of kFusedBlockSize
+/// elements. The driver passes the kernel a small scratch buffer in place of
+/// each local buffer. After inlining, the values stored to the scratch buffers
+/// are forwarded to their loads in the same iteration, and the scratch buffers
+/// are removed, so each element is only loaded and stored once in memory.
+///
+/// When the bundle accesses strided views, the kernel also takes the number
+/// of elements to process, and the driver invokes it on every row of the
+/// views. The driver passes the kernel the address of the row in the strided
+/// views, and of the same elements in the other buffers, so the kernel
+/// accesses all its buffers contiguously. Such kernels aren't fused.
 void LLVMIRGen::emitDataParallelKernelImpl(
     llvm::IRBuilder<> &builder, llvm::ArrayRef<const Instruction *> bundle,
     llvm::ArrayRef<llvm::Type *> argTypes,
@@ -658,10 +790,34 @@ void LLVMIRGen::emitDataParallelKernelImpl(
   if (bundle.empty()) {
     return;
   }
+  // Map the arguments of the kernel back to their buffers, and find the
+  // buffers that are local to the kernel.
+  llvm::SmallVector<Value *, 32> argBuffers(bufferToArgNum.size());
+  for (auto &entry : bufferToArgNum) {
+    argBuffers[entry.second] = entry.first;
+  }
+  size_t rowLen = getStridedRowLen(bundle);
+  llvm::DenseSet<Value *> localBuffers;
+  if (llvmFuseDataParallel && !rowLen) {
+    for (auto *buf : argBuffers) {
+      if (isKernelLocalBuffer(buf, bundle)) {
+        localBuffers.insert(buf);
+      }
+    }
+  }
+  bool fused = !localBuffers.empty();
+  bool driven = fused || rowLen;
+  auto *sizeTTy = builder.getIntNTy(getLibjitSizeTWidth());
+
   // Create stacked kernel function type.
   llvm::Type *voidTy = llvm::Type::getVoidTy(ctx_);
+  llvm::SmallVector<llvm::Type *, 32> kernelArgTypes(argTypes.begin(),
+                                                     argTypes.end());
+  if (driven) {
+    kernelArgTypes.push_back(sizeTTy);
+  }
   llvm::FunctionType *kernelFuncTy =
-      llvm::FunctionType::get(voidTy, argTypes, false);
+      llvm::FunctionType::get(voidTy, kernelArgTypes, false);
   auto *kernelFunc =
       llvm::Function::Create(kernelFuncTy, llvm::Function::InternalLinkage,
                              "libjit_stacked_kernel", llmodule_.get());
@@ -676,10 +832,36 @@ void LLVMIRGen::emitDataParallelKernelImpl(
       llvm::BasicBlock::Create(ctx_, "entry", kernelFunc);
   llvm::IRBuilder<> kernelBuilder(entryBB);
   // Number of tensor elements.
-  auto *numElements =
-      emitValueSize(kernelBuilder, bundle[0]->getOperand(0).first);
+  llvm::Value *numElements =
+      driven ? &*(kernelFunc->args().begin() + bufferToArgNum.size())
+             : emitValueSize(kernelBuilder, bundle[0]->getOperand(0).first);
+  // When the instructions of the bundle can be emitted as vectors, compute
+  // the largest multiple of the vector width of elements with a vector loop,
+  // and only the remaining elements with the scalar loop.
+  unsigned width = getDataParallelVectorWidth(bundle, kernelFunc);
+  llvm::Value *scalarBegin = nullptr;
+  if (width > 1) {
+    auto *widthVal = emitConstSizeT(kernelBuilder, width);
+    auto *vectorEnd = kernelBuilder.CreateMul(
+        kernelBuilder.CreateUDiv(numElements, widthVal), widthVal);
+    auto vectorBBs =
+        createLoop(kernelBuilder, ctx_, emitConstSizeT(kernelBuilder, 0),
+                   vectorEnd, width, /* vectorize */ false);
+    auto *vectorIdx = dyn_cast<llvm::PHINode>(vectorBBs.first->begin());
+    assert(vectorIdx && "Could not find the loop index");
+    kernelBuilder.SetInsertPoint(vectorBBs.first->getFirstNonPHIOrDbg());
+    for (auto &BI : bundle) {
+      generateVectorLLVMIRForDataParallelInstr(
+          kernelBuilder, BI, kernelFunc, bufferToArgNum, vectorIdx, width);
+    }
+    kernelBuilder.SetInsertPoint(vectorBBs.second);
+    scalarBegin = vectorEnd;
+  }
   // Create a loop inside the stacked kernel function being generated.
-  auto loopBBs = createLoop(kernelBuilder, ctx_, numElements);
+  auto loopBBs = scalarBegin
+                     ? createLoop(kernelBuilder, ctx_, scalarBegin, numElements,
+                                  1, /* vectorize */ false)
+                     : createLoop(kernelBuilder, ctx_, numElements);
 
   // Get the index parameter of the loop.
   // This is the PHI node of the BB.
@@ -700,8 +882,81 @@ void LLVMIRGen::emitDataParallelKernelImpl(
   // Add a return.
   kernelBuilder.CreateRetVoid();
 
-  // Emit a call of the kernel.
-  createCall(builder, kernelFunc, buffers);
+  if (!driven) {
+    // Emit a call of the kernel.
+    createCall(builder, kernelFunc, buffers);
+    return;
+  }
+
+  // Create the driver, which takes the same buffers as the kernel.
+  auto *driverFunc = llvm::Function::Create(
+      llvm::FunctionType::get(voidTy, argTypes, false),
+      llvm::Function::InternalLinkage, "libjit_fused_kernel", llmodule_.get());
+  for (unsigned paramIdx = 0; paramIdx < argTypes.size(); ++paramIdx) {
+    driverFunc->addParamAttr(paramIdx, llvm::Attribute::AttrKind::NoAlias);
+  }
+  llvm::IRBuilder<> driverBuilder(
+      llvm::BasicBlock::Create(ctx_, "entry", driverFunc));
+
+  // Allocate the scratch buffers in the entry block, so that they are only
+  // allocated once. Strided kernels process a row at a time.
+  size_t size = bundle[0]->getOperand(0).first->size();
+  size_t blockSize = rowLen ? rowLen : std::min(size, kFusedBlockSize);
+  auto *blockSizeVal = emitConstSizeT(driverBuilder, blockSize);
+  llvm::DenseMap<Value *, llvm::Value *> scratchBuffers;
+  for (auto *buf : argBuffers) {
+    if (localBuffers.count(buf)) {
+      scratchBuffers[buf] = driverBuilder.CreateAlloca(
+          getElementType(driverBuilder, buf), blockSizeVal, "scratch");
+    }
+  }
+
+  // Run the kernel on each block of elements.
+  size_t numBlocks = (size + blockSize - 1) / blockSize;
+  auto driverLoopBBs = createLoop(driverBuilder, ctx_,
+                                  emitConstSizeT(driverBuilder, numBlocks));
+  auto *blockIdx = dyn_cast<llvm::PHINode>(driverLoopBBs.first->begin());
+  assert(blockIdx && "Could not find the loop index");
+  driverBuilder.SetInsertPoint(driverLoopBBs.first->getFirstNonPHIOrDbg());
+  auto *start = driverBuilder.CreateMul(blockIdx, blockSizeVal);
+  auto *remaining =
+      driverBuilder.CreateSub(emitConstSizeT(driverBuilder, size), start);
+  auto *count = driverBuilder.CreateSelect(
+      driverBuilder.CreateICmpULT(remaining, blockSizeVal), remaining,
+      blockSizeVal);
+  llvm::SmallVector<llvm::Value *, 32> kernelArgs;
+  for (size_t i = 0, e = argBuffers.size(); i < e; i++) {
+    auto *buf = argBuffers[i];
+    if (localBuffers.count(buf)) {
+      kernelArgs.push_back(scratchBuffers[buf]);
+      continue;
+    }
+    // Buffers that are not indexed by the loop, like lookup tables, are
+    // passed unchanged.
+    if (buf->size() != size) {
+      kernelArgs.push_back(driverFunc->args().begin() + i);
+      continue;
+    }
+    // The rows of strided views start every pitch elements.
+    size_t viewRowLen = 0;
+    size_t pitch = 0;
+    auto *bufStart = start;
+    if (getStridedViewLayout(buf, viewRowLen, pitch)) {
+      assert(viewRowLen == rowLen && "The strided views have different rows");
+      bufStart = driverBuilder.CreateMul(
+          blockIdx, emitConstSizeT(driverBuilder, pitch));
+    }
+    kernelArgs.push_back(driverBuilder.CreateInBoundsGEP(
+        getElementType(driverBuilder, buf), driverFunc->args().begin() + i,
+        bufStart));
+  }
+  kernelArgs.push_back(count);
+  createCall(driverBuilder, kernelFunc, kernelArgs);
+  driverBuilder.SetInsertPoint(driverLoopBBs.second);
+  driverBuilder.CreateRetVoid();
+
+  // Emit a call of the driver.
+  createCall(builder, driverFunc, buffers);
 }
 
 /// Emit the function that implements a data-parallel kernel and calls it.
@@ -761,6 +1016,19 @@ void LLVMIRGen::emitDataParallelKernel(
                              buffers);
 }
 
+/// \returns the number of bytes between the first and the last byte of \p buf,
+/// which is larger than its size if it is a strided view. \p pitch is set to
+/// the pitch of the rows of a strided view, or to 0.
+static size_t getBufferSpanInBytes(const Value *buf, size_t &pitch) {
+  size_t rowLen = 0;
+  if (!getStridedViewLayout(buf, rowLen, pitch)) {
+    pitch = 0;
+    return buf->getSizeInBytes();
+  }
+  size_t rows = buf->size() / rowLen;
+  return ((rows - 1) * pitch + rowLen) * buf->getType()->getElementSize();
+}
+
 /// Check if the provided operand overlaps with an operand of an instruction
 /// already in the bundle, but is not exactly the same memory region.
 /// Such memory regions cannot be considered data-parallel in the scope of the
@@ -769,19 +1037,26 @@ void LLVMIRGen::emitDataParallelKernel(
 /// \param allocationsInfo information about allocations
 /// \param bundle current bundle of stacked instructions
 /// \param buf the buffer operand to be checked for overlaps with the \p bundle.
+/// \param writtenOnly whether to only check the mutated operands of \p bundle.
 static bool isOverlappingWithAnyBundleBufferOperands(
     AllocationsInfo &allocationsInfo,
-    llvm::SmallVectorImpl<const Instruction *> &bundle, Value *buf) {
+    llvm::SmallVectorImpl<const Instruction *> &bundle, Value *buf,
+    bool writtenOnly = false) {
   auto addr1 = allocationsInfo.allocatedAddress_[buf];
-  auto size1 = buf->getSizeInBytes();
+  size_t pitch1 = 0;
+  auto size1 = getBufferSpanInBytes(buf, pitch1);
   for (auto bi : bundle) {
     for (auto bop : bi->getOperands()) {
+      if (writtenOnly && bop.second == OperandKind::In) {
+        continue;
+      }
       auto buf2 = bop.first;
       auto addr2 = allocationsInfo.allocatedAddress_[buf2];
-      auto size2 = buf2->getSizeInBytes();
+      size_t pitch2 = 0;
+      auto size2 = getBufferSpanInBytes(buf2, pitch2);
       // It is fine, if buffers of different data-parallel instructions are
       // allocated exactly the same memory region.
-      if (addr1 == addr2 && size1 == size2) {
+      if (addr1 == addr2 && size1 == size2 && pitch1 == pitch2) {
         continue;
       }
       if ((addr1 >= addr2 && addr1 < addr2 + size2) ||
@@ -795,13 +1070,41 @@ static bool isOverlappingWithAnyBundleBufferOperands(
 }
 
 void LLVMIRGen::generateLLVMIRForModule(llvm::IRBuilder<> &builder) {
-  // Go over the instructions and try to group them into bundles.
-  auto &instrs = F_->getInstrs();
+  if (segments_.empty()) {
+    std::vector<const Instruction *> instrs;
+    for (auto &I : F_->getInstrs()) {
+      instrs.push_back(&I);
+    }
+    generateLLVMIRForRepeatedInstrs(builder, instrs);
+    return;
+  }
+
+  // Emit each segment into its own function, with its own base addresses,
+  // and call the segments in order.
+  auto *F = builder.GetInsertBlock()->getParent();
+  llvm::SmallVector<llvm::Value *, 4> args;
+  for (auto &arg : F->args()) {
+    args.push_back(&arg);
+  }
+  for (unsigned idx = 0, e = segments_.size(); idx < e; idx++) {
+    auto *segmentF = getSegmentFunction(idx);
+    llvm::IRBuilder<> segmentBuilder(
+        llvm::BasicBlock::Create(ctx_, "entry", segmentF));
+    loadBaseAddresses(segmentBuilder);
+    generateLLVMIRForRepeatedInstrs(segmentBuilder, segments_[idx]);
+    segmentBuilder.CreateRetVoid();
+    createCall(builder, segmentF, args);
+  }
+  loadBaseAddresses(builder);
+}
 
+void LLVMIRGen::generateLLVMIRForInstrs(
+    llvm::IRBuilder<> &builder, llvm::ArrayRef<const Instruction *> instrs) {
   // Group instructions into bundles of shape compatible data parallel
   // instructions and emit them.
   llvm::SmallVector<const Instruction *, 32> bundle;
-  for (auto &I : instrs) {
+  for (auto *instr : instrs) {
+    auto &I = *instr;
     if (!canBePartOfDataParallelKernel(&I)) {
       // Ignore memory management instructions as they are handled by the
       // MemoryManager and are NOPs for a JIT.
@@ -810,6 +1113,8 @@ void LLVMIRGen::generateLLVMIRForModule(llvm::IRBuilder<> &builder) {
         generateLLVMIRForInstr(builder, &I);
         continue;
       }
+      assert(!getStridedRowLen(&I) &&
+             "Strided views are only accessed by data-parallel kernels");
       emitDataParallelKernel(builder, bundle);
       bundle.clear();
       generateLLVMIRForInstr(builder, &I);
@@ -819,12 +1124,17 @@ void LLVMIRGen::generateLLVMIRForModule(llvm::IRBuilder<> &builder) {
     // This is a data parallel instruction.
 
     // Check if the current instruction is shape compatible with the bundle.
+    // The instructions accessing strided views must have the same rows as
+    // the others in the bundle, see emitDataParallelKernelImpl.
     bool isBundleCompatible = true;
+    size_t rowLen = getStridedRowLen(&I);
+    size_t bundleRowLen = getStridedRowLen(bundle);
     if (!bundle.empty()) {
       auto val = I.getOperand(0).first;
       auto bundleVal = bundle.back()->getOperand(0).first;
       // Check if shapes have the same amount of elements.
-      isBundleCompatible = val->size() == bundleVal->size();
+      isBundleCompatible = val->size() == bundleVal->size() &&
+                           (!rowLen || !bundleRowLen || rowLen == bundleRowLen);
     }
 
     // Check all mutated operands of the current instruction. Their memory
@@ -833,9 +1143,19 @@ void LLVMIRGen::generateLLVMIRForModule(llvm::IRBuilder<> &builder) {
     // instruction cannot be included into the data-parallel bundle, because
     // overlapping operand buffers are not data parallel.
     for (auto op : I.getOperands()) {
-      // Skip non-mutated operands.
-      if (op.second == OperandKind::In)
+      // Skip non-mutated operands. Kernels accessing strided views process
+      // the elements of the buffers in a different order, their inputs must
+      // not overlap with the mutated buffers of the bundle.
+      if (op.second == OperandKind::In) {
+        if ((rowLen || bundleRowLen) &&
+            isOverlappingWithAnyBundleBufferOperands(allocationsInfo_, bundle,
+                                                     op.first,
+                                                     /* writtenOnly */ true)) {
+          isBundleCompatible = false;
+          break;
+        }
         continue;
+      }
       // If the mutated operand buffer overlaps with any buffer already used by
       // the bundle, the current instruction cannot become a part of the bundle.
       if (isOverlappingWithAnyBundleBufferOperands(allocationsInfo_, bundle,
@@ -858,6 +1178,713 @@ void LLVMIRGen::generateLLVMIRForModule(llvm::IRBuilder<> &builder) {
   emitDataParallelKernel(builder, bundle);
 }
 
+/// Maximum number of instructions of the sequences emitted in a loop over
+/// their repetitions, see generateLLVMIRForRepeatedInstrs.
+constexpr static size_t kMaxRepeatedInstrs = 256;
+
+/// \returns the description of the operand \p V which the code emitted for
+/// its users depends on: its kind, its type, its kind of memory and, for a
+/// tensor view, the layout of the view.
+static std::string getOperandSignature(const AllocationsInfo &allocationsInfo,
+                                       const Value *V) {
+  std::string sig;
+  llvm::raw_string_ostream os(sig);
+  auto it = allocationsInfo.valueNumbers_.find(V);
+  assert(it != allocationsInfo.valueNumbers_.end() &&
+         "Operand was not allocated");
+  os << V->getKindName() << ":" << (int)it->second.first << ":"
+     << (const void *)V->getType();
+  if (auto *TVI = dyn_cast<TensorViewInst>(V)) {
+    os << "[";
+    for (auto offset : TVI->getOffsets()) {
+      os << offset << ",";
+    }
+    os << getOperandSignature(allocationsInfo, TVI->getSrc()) << "]";
+  }
+  return os.str();
+}
+
+/// \returns the description of the instruction \p I which the code emitted
+/// for it depends on, with the operands in place of their names.
+static std::string
+getInstrSignature(const AllocationsInfo &allocationsInfo,
+                  const Instruction *I) {
+  // The attributes of the instruction are printed after its operands.
+  std::string operands;
+  llvm::raw_string_ostream os(operands);
+  os << "%" << I->getName().str() << " = " << I->getKindName() << " ";
+  for (size_t i = 0, e = I->getNumOperands(); i < e; i++) {
+    auto op = I->getOperand(i);
+    os << (i ? ", " : "") << getOperandKindStr(op.second) << " %"
+       << op.first->getName().str();
+  }
+  std::string text = I->toString();
+  assert(llvm::StringRef(text).startswith(os.str()) &&
+         "Unexpected format of the instruction");
+  std::string sig = I->getKindName();
+  sig += text.substr(os.str().size());
+  for (const auto &op : I->getOperands()) {
+    sig += " " + std::to_string((int)op.second) + ":" +
+           getOperandSignature(allocationsInfo, op.first);
+  }
+  return sig;
+}
+
+namespace {
+/// The operands of a sequence of instructions, and the properties of their
+/// memory which the code emitted for the sequence depends on. The code
+/// emitted for two sequences of instructions with the same signatures and
+/// the same pattern only differs by the addresses of their operands.
+struct RepeatPattern {
+  /// The distinct operands, in the order they are first used.
+  std::vector<const Value *> values;
+  /// The index in values of each operand of the instructions.
+  std::vector<unsigned> slots;
+  /// Whether each value is an activation whose users are all in the
+  /// sequence, see isKernelLocalBuffer.
+  std::vector<bool> local;
+  /// Whether the memory of each pair of values is the same, disjoint or
+  /// overlapping, see isOverlappingWithAnyBundleBufferOperands.
+  std::vector<uint8_t> overlaps;
+
+  bool operator==(const RepeatPattern &other) const {
+    return slots == other.slots && local == other.local &&
+           overlaps == other.overlaps;
+  }
+};
+} // namespace
+
+/// \returns the pattern of the sequence of instructions \p instrs.
+static RepeatPattern
+getRepeatPattern(AllocationsInfo &allocationsInfo,
+                 llvm::ArrayRef<const Instruction *> instrs) {
+  RepeatPattern P;
+  llvm::DenseMap<const Value *, unsigned> slotOf;
+  for (const auto *I : instrs) {
+    for (const auto &op : I->getOperands()) {
+      auto it = slotOf.try_emplace(op.first, P.values.size()).first;
+      if (it->second == P.values.size()) {
+        P.values.push_back(op.first);
+      }
+      P.slots.push_back(it->second);
+    }
+  }
+  for (const auto *V : P.values) {
+    bool local = isa<AllocActivationInst>(V);
+    for (const auto &U : V->getUsers()) {
+      local &= isa<DeallocActivationInst>(U.get()) ||
+               std::find(instrs.begin(), instrs.end(), U.get()) != instrs.end();
+    }
+    P.local.push_back(local);
+  }
+  std::vector<uint64_t> begin, span, pitch;
+  for (const auto *V : P.values) {
+    size_t rowPitch = 0;
+    begin.push_back(allocationsInfo.allocatedAddress_[V]);
+    span.push_back(getBufferSpanInBytes(V, rowPitch));
+    pitch.push_back(rowPitch);
+  }
+  for (size_t i = 0, e = P.values.size(); i < e; i++) {
+    for (size_t j = 0; j < i; j++) {
+      if (begin[i] == begin[j] && span[i] == span[j] && pitch[i] == pitch[j]) {
+        P.overlaps.push_back(0);
+      } else if (begin[i] < begin[j] + span[j] &&
+                 begin[j] < begin[i] + span[i]) {
+        P.overlaps.push_back(1);
+      } else {
+        P.overlaps.push_back(2);
+      }
+    }
+  }
+  return P;
+}
+
+void LLVMIRGen::generateLLVMIRForRepeatedInstrs(
+    llvm::IRBuilder<> &builder, llvm::ArrayRef<const Instruction *> instrs) {
+  size_t minLen = llvmRollRepeatedInstrs;
+  size_t numInstrs = instrs.size();
+  if (!minLen || emitDebugInfo || numInstrs < 2 * minLen) {
+    generateLLVMIRForInstrs(builder, instrs);
+    return;
+  }
+
+  // Number the signatures of the instructions. Those which can't be rolled
+  // are never repeated.
+  std::vector<int64_t> sigs;
+  llvm::StringMap<int64_t> sigNumbers;
+  for (const auto *I : instrs) {
+    if (!canRollInstr(I)) {
+      sigs.push_back(-(int64_t)sigs.size() - 1);
+      continue;
+    }
+    auto it = sigNumbers
+                  .try_emplace(getInstrSignature(allocationsInfo_, I),
+                               sigNumbers.size())
+                  .first;
+    sigs.push_back(it->second);
+  }
+
+  // At each instruction, find the sequence starting there whose repetitions
+  // that follow it save the most instructions, emit it in a loop and resume
+  // after its repetitions.
+  size_t emitted = 0;
+  for (size_t i = 0; i + 2 * minLen <= numInstrs;) {
+    size_t bestLen = 0;
+    size_t bestSaving = 0;
+    std::vector<RepeatPattern> best;
+    for (size_t len = minLen;
+         len <= kMaxRepeatedInstrs && i + 2 * len <= numInstrs; len++) {
+      auto isRepeated = [&](size_t start) {
+        return start + len <= numInstrs &&
+               std::equal(&sigs[i], &sigs[i] + len, &sigs[start]);
+      };
+      if (!isRepeated(i + len)) {
+        continue;
+      }
+      std::vector<RepeatPattern> patterns;
+      patterns.push_back(
+          getRepeatPattern(allocationsInfo_, instrs.slice(i, len)));
+      for (size_t start = i + len; isRepeated(start); start += len) {
+        auto P = getRepeatPattern(allocationsInfo_, instrs.slice(start, len));
+        if (!(P == patterns[0])) {
+          break;
+        }
+        patterns.push_back(std::move(P));
+      }
+      size_t saving = (patterns.size() - 1) * len;
+      if (saving > bestSaving) {
+        bestLen = len;
+        bestSaving = saving;
+        best = std::move(patterns);
+      }
+    }
+    if (!bestLen) {
+      i++;
+      continue;
+    }
+    generateLLVMIRForInstrs(builder, instrs.slice(emitted, i - emitted));
+    std::vector<std::vector<const Value *>> values;
+    for (auto &P : best) {
+      values.push_back(std::move(P.values));
+    }
+    emitRepeatedInstrs(builder, instrs.slice(i, bestLen), values);
+    i += best.size() * bestLen;
+    emitted = i;
+  }
+  generateLLVMIRForInstrs(builder, instrs.slice(emitted));
+}
+
+void LLVMIRGen::emitRepeatedInstrs(
+    llvm::IRBuilder<> &builder, llvm::ArrayRef<const Instruction *> body,
+    llvm::ArrayRef<std::vector<const Value *>> values) {
+  auto sizeTTy = builder.getIntNTy(getLibjitSizeTWidth());
+  size_t numSlots = values[0].size();
+  std::vector<llvm::Constant *> elems;
+  for (const auto &row : values) {
+    for (const auto *V : row) {
+      elems.push_back(llvm::ConstantInt::get(
+          sizeTTy, allocationsInfo_.valueNumbers_[V].second));
+    }
+  }
+  auto *arr = llvm::ConstantArray::get(
+      llvm::ArrayType::get(sizeTTy, elems.size()), elems);
+  auto *table = new llvm::GlobalVariable(*llmodule_, arr->getType(), true,
+                                         llvm::GlobalValue::InternalLinkage,
+                                         arr, "repeated.values");
+
+  // Loop over the rows of the table.
+  auto *F = builder.GetInsertBlock()->getParent();
+  auto *entryBB = builder.GetInsertBlock();
+  auto *bodyBB = llvm::BasicBlock::Create(ctx_, "repeat.body", F);
+  auto *exitBB = llvm::BasicBlock::Create(ctx_, "repeat.exit", F);
+  builder.CreateBr(bodyBB);
+  builder.SetInsertPoint(bodyBB);
+  auto *idx = builder.CreatePHI(sizeTTy, 2, "repeat.idx");
+  idx->addIncoming(llvm::ConstantInt::get(sizeTTy, 0), entryBB);
+  auto *row =
+      builder.CreateMul(idx, llvm::ConstantInt::get(sizeTTy, numSlots));
+  repeatValues_ = builder.CreateGEP(
+      sizeTTy, builder.CreateBitCast(table, sizeTTy->getPointerTo()), row);
+  for (unsigned slot = 0; slot < numSlots; slot++) {
+    repeatSlots_[values[0][slot]] = slot;
+  }
+  generateLLVMIRForInstrs(builder, body);
+  repeatSlots_.clear();
+  repeatValues_ = nullptr;
+
+  // The instructions may have emitted blocks of their own. Keep the loop
+  // rolled, which is its point.
+  auto *latchBB = builder.GetInsertBlock();
+  auto *next = builder.CreateAdd(idx, llvm::ConstantInt::get(sizeTTy, 1),
+                                 "repeat.next");
+  idx->addIncoming(next, latchBB);
+  auto *cond = builder.CreateICmpULT(
+      next, llvm::ConstantInt::get(sizeTTy, values.size()));
+  auto *br = builder.CreateCondBr(cond, bodyBB, exitBB);
+  auto temp = llvm::MDNode::getTemporary(ctx_, llvm::None);
+  llvm::SmallVector<llvm::Metadata *, 2> loopMD;
+  loopMD.push_back(temp.get());
+  loopMD.push_back(llvm::MDNode::get(
+      ctx_, llvm::MDString::get(ctx_, "llvm.loop.unroll.disable")));
+  auto *loopID = llvm::MDNode::get(ctx_, loopMD);
+  loopID->replaceOperandWith(0, loopID);
+  br->setMetadata(llvm::LLVMContext::MD_loop, loopID);
+  builder.SetInsertPoint(exitBB);
+}
+
+namespace {
+/// The memory accessed by an operand of an instruction.
+struct MemoryAccess {
+  AllocationsInfo::ValueKind kind;
+  uint64_t begin;
+  uint64_t end;
+  bool written;
+};
+} // namespace
+
+/// \returns whether an instruction accessing \p A must follow or precede an
+/// instruction accessing \p B.
+static bool isConflicting(llvm::ArrayRef<MemoryAccess> A,
+                          llvm::ArrayRef<MemoryAccess> B) {
+  for (const auto &a : A) {
+    for (const auto &b : B) {
+      if ((a.written || b.written) && a.kind == b.kind && a.begin < b.end &&
+          b.begin < a.end) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+void LLVMIRGen::planInterOpSegments() {
+  segments_.clear();
+  segmentPreds_.clear();
+
+  // Collect the instructions emitting code and the memory they access. The
+  // constants are never written and don't order anything.
+  std::vector<const Instruction *> instrs;
+  std::vector<llvm::SmallVector<MemoryAccess, 4>> accesses;
+  for (auto &I : F_->getInstrs()) {
+    if (isa<AllocActivationInst>(&I) || isa<DeallocActivationInst>(&I) ||
+        isa<TensorViewInst>(&I)) {
+      continue;
+    }
+    llvm::SmallVector<MemoryAccess, 4> access;
+    for (const auto &op : I.getOperands()) {
+      auto it = allocationsInfo_.valueNumbers_.find(op.first);
+      assert(it != allocationsInfo_.valueNumbers_.end() &&
+             "Operand was not allocated");
+      auto kind = it->second.first;
+      if (kind == AllocationsInfo::ValueKind::ConstantWeight) {
+        continue;
+      }
+      size_t pitch = 0;
+      uint64_t begin = allocationsInfo_.allocatedAddress_[op.first];
+      uint64_t end = begin + getBufferSpanInBytes(op.first, pitch);
+      access.push_back({kind, begin, end, op.second != OperandKind::In});
+    }
+    instrs.push_back(&I);
+    accesses.push_back(std::move(access));
+  }
+
+  // Link each instruction to the closest conflicting instructions before it
+  // which it doesn't depend on through the others already.
+  constexpr size_t maxInstrs = 8192;
+  size_t numInstrs = instrs.size();
+  if (numInstrs < 2 || numInstrs > maxInstrs) {
+    return;
+  }
+  std::vector<llvm::BitVector> ancestors(numInstrs,
+                                         llvm::BitVector(numInstrs));
+  std::vector<llvm::SmallVector<unsigned, 4>> preds(numInstrs);
+  std::vector<unsigned> numSuccs(numInstrs, 0);
+  for (size_t i = 0; i < numInstrs; i++) {
+    for (size_t j = i; j-- > 0;) {
+      if (ancestors[i].test(j) || !isConflicting(accesses[i], accesses[j])) {
+        continue;
+      }
+      preds[i].push_back(j);
+      numSuccs[j]++;
+      ancestors[i] |= ancestors[j];
+      ancestors[i].set(j);
+    }
+  }
+
+  // Chain an instruction to the segment of its only predecessor if it is its
+  // only successor, otherwise start a segment.
+  std::vector<unsigned> segmentOf(numInstrs);
+  for (size_t i = 0; i < numInstrs; i++) {
+    if (preds[i].size() == 1 && numSuccs[preds[i][0]] == 1) {
+      segmentOf[i] = segmentOf[preds[i][0]];
+      segments_[segmentOf[i]].push_back(instrs[i]);
+      continue;
+    }
+    segmentOf[i] = segments_.size();
+    segments_.push_back({instrs[i]});
+    segmentPreds_.emplace_back();
+    for (unsigned pred : preds[i]) {
+      auto &segmentPreds = segmentPreds_.back();
+      if (std::find(segmentPreds.begin(), segmentPreds.end(),
+                    segmentOf[pred]) == segmentPreds.end()) {
+        segmentPreds.push_back(segmentOf[pred]);
+      }
+    }
+  }
+
+  // The segments are in a topological order. Unless a segment doesn't depend
+  // on the previous one, which means they may run concurrently, they all run
+  // in sequence.
+  for (unsigned idx = 1, e = segments_.size(); idx < e; idx++) {
+    auto &segmentPreds = segmentPreds_[idx];
+    if (std::find(segmentPreds.begin(), segmentPreds.end(), idx - 1) ==
+        segmentPreds.end()) {
+      return;
+    }
+  }
+  segments_.clear();
+  segmentPreds_.clear();
+}
+
+llvm::Function *LLVMIRGen::getSegmentFunction(unsigned idx) {
+  assert(idx < segments_.size() && "Not a segment of the function");
+  segmentFunctions_.resize(segments_.size(), nullptr);
+  if (!segmentFunctions_[idx]) {
+    auto *mainF = llmodule_->getFunction("main");
+    segmentFunctions_[idx] = llvm::Function::Create(
+        mainF->getFunctionType(), llvm::Function::InternalLinkage,
+        "main_segment" + std::to_string(idx), llmodule_.get());
+  }
+  return segmentFunctions_[idx];
+}
+
+bool LLVMIRGen::canVectorizeDataParallelInstr(const Instruction *I) const {
+  auto destKind = I->getOperand(0).first->getElementType();
+  switch (I->getKind()) {
+  case Kinded::Kind::SplatInstKind:
+  case Kinded::Kind::CopyInstKind:
+  case Kinded::Kind::ElementAddInstKind:
+  case Kinded::Kind::ElementSubInstKind:
+  case Kinded::Kind::ElementMulInstKind:
+  case Kinded::Kind::ElementMaxInstKind:
+  case Kinded::Kind::ElementMinInstKind:
+    return destKind == ElemKind::FloatTy || destKind == ElemKind::Int8QTy;
+  case Kinded::Kind::ElementDivInstKind:
+    return destKind == ElemKind::FloatTy;
+  case Kinded::Kind::RescaleQuantizedInstKind:
+    return destKind == ElemKind::Int8QTy;
+  case Kinded::Kind::QuantizeInstKind:
+    return destKind == ElemKind::Int8QTy;
+  case Kinded::Kind::DequantizeInstKind:
+    return I->getOperand(1).first->getElementType() == ElemKind::Int8QTy;
+  default:
+    return false;
+  }
+}
+
+unsigned LLVMIRGen::getDataParallelVectorWidth(
+    llvm::ArrayRef<const Instruction *> bundle, llvm::Function *kernel) {
+  if (!llvmVectorizeDataParallel) {
+    return 1;
+  }
+  size_t size = bundle[0]->getOperand(0).first->size();
+  for (const auto *I : bundle) {
+    if (!canVectorizeDataParallelInstr(I)) {
+      return 1;
+    }
+    // All the operands must be indexed by the loop.
+    for (const auto &op : I->getOperands()) {
+      if (op.first->size() != size) {
+        return 1;
+      }
+    }
+  }
+  // The supported instructions compute on 32-bit lanes, the quantized ones
+  // widen their 8-bit elements to 32 bits.
+  unsigned registerBits = TM_->getTargetTransformInfo(*kernel)
+                              .getRegisterBitWidth(/* Vector */ true);
+  return std::max(registerBits / 32, 1u);
+}
+
+llvm::Value *
+LLVMIRGen::emitVectorLoad(llvm::IRBuilder<> &builder, Value *val,
+                          llvm::Function *kernel,
+                          llvm::DenseMap<Value *, int> &bufferToArgNum,
+                          llvm::Value *index, unsigned width) {
+  auto *elementTy = getElementType(builder, val);
+  auto *ptr = builder.CreateGEP(
+      elementTy, emitBufferAddress(builder, val, kernel, bufferToArgNum),
+      index, "buffer.element.addr");
+  auto *vectorPtr = builder.CreateBitCast(
+      ptr, llvm::VectorType::get(elementTy, width)->getPointerTo());
+  // The buffers are only aligned on their elements.
+  return builder.CreateAlignedLoad(
+      vectorPtr, llmodule_->getDataLayout().getABITypeAlignment(elementTy));
+}
+
+void LLVMIRGen::emitVectorStore(llvm::IRBuilder<> &builder, llvm::Value *vec,
+                                Value *val, llvm::Function *kernel,
+                                llvm::DenseMap<Value *, int> &bufferToArgNum,
+                                llvm::Value *index) {
+  auto *elementTy = getElementType(builder, val);
+  auto *ptr = builder.CreateGEP(
+      elementTy, emitBufferAddress(builder, val, kernel, bufferToArgNum),
+      index, "buffer.element.addr");
+  auto *vectorPtr = builder.CreateBitCast(ptr, vec->getType()->getPointerTo());
+  builder.CreateAlignedStore(
+      vec, vectorPtr,
+      llmodule_->getDataLayout().getABITypeAlignment(elementTy));
+}
+
+/// Emit the scaling of the int32 vector \p input of \p width elements by the
+/// integer shift-mult-shift \p params, followed by the addition of \p offset.
+/// This is the same computation as libjit_scale_i32i8.
+static llvm::Value *
+emitVectorScaleI32I8(llvm::IRBuilder<> &builder, llvm::Value *input,
+                     unsigned width, const QuantizationTransform32To8 &params,
+                     int32_t offset) {
+  auto splat = [&](int32_t val) {
+    return builder.CreateVectorSplat(width, builder.getInt32(val));
+  };
+  // Round to nearest when shifting right.
+  int32_t rtn = params.post > 0 ? (1 << (params.post - 1)) : 0;
+  auto *val = builder.CreateAShr(input, splat(params.pre));
+  val = builder.CreateMul(val, splat(params.scale));
+  val = builder.CreateAdd(val, splat(rtn));
+  val = builder.CreateAShr(val, splat(params.post));
+  return builder.CreateAdd(val, splat(offset));
+}
+
+/// Emit the clipping of the int32 vector \p input of \p width elements to
+/// int8, like libjit_clip.
+static llvm::Value *emitVectorClipI8(llvm::IRBuilder<> &builder,
+                                     llvm::Value *input, unsigned width) {
+  auto *minVal = builder.CreateVectorSplat(width, builder.getInt32(-128));
+  auto *maxVal = builder.CreateVectorSplat(width, builder.getInt32(127));
+  auto *val = builder.CreateSelect(builder.CreateICmpSGT(input, minVal), input,
+                                   minVal);
+  val = builder.CreateSelect(builder.CreateICmpSLT(val, maxVal), val, maxVal);
+  return builder.CreateTrunc(val,
+                             llvm::VectorType::get(builder.getInt8Ty(), width));
+}
+
+void LLVMIRGen::generateVectorLLVMIRForDataParallelInstr(
+    llvm::IRBuilder<> &builder, const glow::Instruction *I,
+    llvm::Function *kernel, llvm::DenseMap<Value *, int> &bufferToArgNum,
+    llvm::Value *index, unsigned width) {
+  setCurrentDebugLocation(builder, I);
+  assert(canVectorizeDataParallelInstr(I) &&
+         "Instruction cannot be emitted with vector types");
+  auto *dest = I->getOperand(0).first;
+  auto *destTy = dest->getType();
+  auto *i32VectorTy = llvm::VectorType::get(builder.getInt32Ty(), width);
+  auto load = [&](Value *val) {
+    return emitVectorLoad(builder, val, kernel, bufferToArgNum, index, width);
+  };
+  // Load the quantized elements of val widened to int32, minus its offset.
+  auto loadI32 = [&](Value *val) {
+    auto *offset = builder.getInt32(val->getType()->getOffset());
+    return builder.CreateSub(builder.CreateSExt(load(val), i32VectorTy),
+                             builder.CreateVectorSplat(width, offset));
+  };
+  auto store = [&](llvm::Value *vec) {
+    emitVectorStore(builder, vec, dest, kernel, bufferToArgNum, index);
+  };
+
+  switch (I->getKind()) {
+  case Kinded::Kind::SplatInstKind: {
+    auto value = cast<SplatInst>(I)->getValue();
+    llvm::Value *val = nullptr;
+    if (destTy->isQuantizedType()) {
+      TensorQuantizationParams TQP{destTy->getScale(), destTy->getOffset()};
+      val = emitConstI8(builder, quantization::quantize(value, TQP));
+    } else {
+      val = emitConstF32(builder, value);
+    }
+    store(builder.CreateVectorSplat(width, val));
+    break;
+  }
+
+  case Kinded::Kind::CopyInstKind:
+    store(load(cast<CopyInst>(I)->getSrc()));
+    break;
+
+  case Kinded::Kind::RescaleQuantizedInstKind: {
+    auto *src = cast<RescaleQuantizedInst>(I)->getSrc();
+    auto *srcTy = src->getType();
+    auto params = quantization::quantizeScaleOffset32To8(
+        srcTy->getScale() / destTy->getScale(), srcTy->getOffset());
+    store(emitVectorClipI8(builder,
+                           emitVectorScaleI32I8(builder, loadI32(src), width,
+                                                params, destTy->getOffset()),
+                           width));
+    break;
+  }
+
+  case Kinded::Kind::QuantizeInstKind: {
+    // Like libjit_element_quantize_kernel_i8, the value is rounded to the
+    // nearest even integer. It is clipped before the conversion, which is
+    // undefined out of the range of int8.
+    auto *src = cast<QuantizeInst>(I)->getSrc();
+    auto *floatVectorTy = llvm::VectorType::get(builder.getFloatTy(), width);
+    auto splat = [&](float val) {
+      return builder.CreateVectorSplat(width, emitConstF32(builder, val));
+    };
+    auto *val = builder.CreateFDiv(load(src), splat(destTy->getScale()));
+    val = builder.CreateFAdd(val, splat(destTy->getOffset()));
+    auto *minVal = splat(-128);
+    auto *maxVal = splat(127);
+    val = builder.CreateSelect(builder.CreateFCmpOGT(val, minVal), val, minVal);
+    val = builder.CreateSelect(builder.CreateFCmpOLT(val, maxVal), val, maxVal);
+    auto *nearbyint = llvm::Intrinsic::getDeclaration(
+        llmodule_.get(), llvm::Intrinsic::nearbyint, {floatVectorTy});
+    val = builder.CreateCall(nearbyint, {val});
+    store(builder.CreateFPToSI(
+        val, llvm::VectorType::get(builder.getInt8Ty(), width)));
+    break;
+  }
+
+  case Kinded::Kind::DequantizeInstKind: {
+    auto *src = cast<DequantizeInst>(I)->getSrc();
+    auto *floatVectorTy = llvm::VectorType::get(builder.getFloatTy(), width);
+    auto *scale = builder.CreateVectorSplat(
+        width, emitConstF32(builder, src->getType()->getScale()));
+    store(builder.CreateFMul(builder.CreateSIToFP(loadI32(src), floatVectorTy),
+                             scale));
+    break;
+  }
+
+  case Kinded::Kind::ElementAddInstKind:
+  case Kinded::Kind::ElementSubInstKind:
+  case Kinded::Kind::ElementMulInstKind:
+  case Kinded::Kind::ElementDivInstKind:
+  case Kinded::Kind::ElementMaxInstKind:
+  case Kinded::Kind::ElementMinInstKind: {
+    auto *lhs = I->getOperand(1).first;
+    auto *rhs = I->getOperand(2).first;
+    auto kind = I->getKind();
+    if (!destTy->isQuantizedType()) {
+      auto *L = load(lhs);
+      auto *R = load(rhs);
+      llvm::Value *res = nullptr;
+      switch (kind) {
+      case Kinded::Kind::ElementAddInstKind:
+        res = builder.CreateFAdd(L, R);
+        break;
+      case Kinded::Kind::ElementSubInstKind:
+        res = builder.CreateFSub(L, R);
+        break;
+      case Kinded::Kind::ElementMulInstKind:
+        res = builder.CreateFMul(L, R);
+        break;
+      case Kinded::Kind::ElementDivInstKind:
+        res = builder.CreateFDiv(L, R);
+        break;
+      // Select like the MAX and MIN macros of libjit, to get the same results
+      // for NaNs.
+      case Kinded::Kind::ElementMaxInstKind:
+        res = builder.CreateSelect(builder.CreateFCmpOGT(L, R), L, R);
+        break;
+      default:
+        res = builder.CreateSelect(builder.CreateFCmpOLT(L, R), L, R);
+        break;
+      }
+      store(res);
+      break;
+    }
+
+    auto *lhsTy = lhs->getType();
+    auto *rhsTy = rhs->getType();
+    float destScale = destTy->getScale();
+    if (kind == Kinded::Kind::ElementMulInstKind) {
+      // See the scalar ElementMul: i_d = (s_l * s_r / s_d) * (i_l - o_l) *
+      // (i_r - o_r) + o_d.
+      auto params = quantization::quantizeScaleOffset32To8(
+          lhsTy->getScale() * rhsTy->getScale() / destScale, 0);
+      auto *prod = builder.CreateMul(loadI32(lhs), loadI32(rhs));
+      store(emitVectorClipI8(builder,
+                             emitVectorScaleI32I8(builder, prod, width, params,
+                                                  destTy->getOffset()),
+                             width));
+      break;
+    }
+    // Bring both sides to the scale of the destination, see
+    // ARITHMETIC_BINARY_OP_CASE.
+    auto lhsParams = quantization::quantizeScaleOffset32To8(
+        lhsTy->getScale() / destScale, lhsTy->getOffset());
+    auto rhsParams = quantization::quantizeScaleOffset32To8(
+        rhsTy->getScale() / destScale, rhsTy->getOffset());
+    auto *L = emitVectorScaleI32I8(builder, loadI32(lhs), width, lhsParams, 0);
+    auto *R = emitVectorScaleI32I8(builder, loadI32(rhs), width, rhsParams, 0);
+    llvm::Value *res = nullptr;
+    switch (kind) {
+    case Kinded::Kind::ElementAddInstKind:
+      res = builder.CreateAdd(L, R);
+      break;
+    case Kinded::Kind::ElementSubInstKind:
+      res = builder.CreateSub(L, R);
+      break;
+    case Kinded::Kind::ElementMaxInstKind:
+      res = builder.CreateSelect(builder.CreateICmpSGT(L, R), L, R);
+      break;
+    default:
+      res = builder.CreateSelect(builder.CreateICmpSLT(L, R), L, R);
+      break;
+    }
+    auto *destOffset = builder.getInt32(destTy->getOffset());
+    res = builder.CreateAdd(res, builder.CreateVectorSplat(width, destOffset));
+    store(emitVectorClipI8(builder, res, width));
+    break;
+  }
+
+  default:
+    llvm_unreachable("Instruction cannot be emitted with vector types");
+  }
+}
+
+/// \returns the payload of the Constant of \p F whose weight is \p value.
+/// Since we can't get the variable from a glow::Value directly, we need to
+/// traverse the list of Constants and find the one matching \p value.
+static const Tensor &getConstantPayload(const IRFunction *F,
+                                        const glow::Value *value) {
+  for (auto &v : F->findConstants()) {
+    assert(isa<WeightVar>(F->getWeightForNode(v)));
+    if (cast<glow::Value>(F->getWeightForNode(v)) == value) {
+      return v->getPayload();
+    }
+  }
+  llvm_unreachable("Can't find the variable.");
+}
+
+/// Computes the input coordinates of the \p outSize output rows or columns
+/// resized by \p scale from \p inSize ones, as the Interpreter does. Appends
+/// to \p coords the two input coordinates of every output one, multiplied
+/// by \p stride, and to \p weights the bilinear weight of the second one,
+/// which is 0 if \p bilinear is false.
+static void getResizeTable(size_t inSize, size_t outSize, float scale,
+                           size_t stride, bool bilinear,
+                           std::vector<size_t> &coords,
+                           std::vector<float> &weights) {
+  for (size_t o = 0; o < outSize; o++) {
+    float in = o / scale;
+    size_t i0 = std::min(size_t(in), inSize - 1);
+    size_t i1 = bilinear ? std::min(i0 + 1, inSize - 1) : i0;
+    coords.push_back(i0 * stride);
+    coords.push_back(i1 * stride);
+    weights.push_back(i1 == i0 ? 0 : in - i0);
+  }
+}
+
+/// \returns the name of the libjit function \p name computing exponentials
+/// into \p dest, or of its variant using approximations of exp if
+/// -llvm-fast-math is set and \p dest holds floats.
+static std::string getMathKernelName(llvm::StringRef name, const Value *dest) {
+  if (llvmFastMath && dest->getElementType() == ElemKind::FloatTy) {
+    return name.str() + "_fast";
+  }
+  return name.str();
+}
+
 void LLVMIRGen::generateLLVMIRForDataParallelInstr(
     llvm::IRBuilder<> &builder, const glow::Instruction *I,
     llvm::Function *kernel, llvm::DenseMap<Value *, int> &bufferToArgNum,
@@ -883,8 +1910,12 @@ void LLVMIRGen::generateLLVMIRForDataParallelInstr(
       /* Perform this early and let jit library to work */                     \
       /* with quantized number. */                                             \
       TensorQuantizationParams TQP{destTy->getScale(), destTy->getOffset()};   \
-      auto quantizedValue = quantization::quantize(value, TQP);                \
-      auto *val = emitConstI8(builder, quantizedValue);                        \
+      auto *val =                                                              \
+          destTy->getElementType() == ElemKind::Int16QTy                       \
+              ? emitConst(builder,                                             \
+                          quantization::quantize<int16_t>(value, TQP),         \
+                          ElemKind::Int16QTy)                                  \
+              : emitConstI8(builder, quantization::quantize(value, TQP));      \
       auto *stackedOpCall =                                                    \
           createCall(builder, F, {loopCount, val, pointerNull, pointerNull});  \
       auto *destAddr = builder.CreateGEP(elementTy, destPtr, loopCount,        \
@@ -988,7 +2019,8 @@ void LLVMIRGen::generateLLVMIRForDataParallelInstr(
     auto *destPtr = emitBufferAddress(builder, dest, kernel, bufferToArgNum);  \
     auto *srcPtr =                                                             \
         emitBufferAddress(builder, AN->getSrc(), kernel, bufferToArgNum);      \
-    auto *F = getFunction(FUN_NAME_ "_kernel", dest->getElementType());        \
+    auto *F = getFunction(std::string(FUN_NAME_) + "_kernel",                  \
+                          dest->getElementType());                             \
     auto *elementTy = getElementType(builder, dest);                           \
     auto *pointerNull =                                                        \
         llvm::ConstantPointerNull::get(elementTy->getPointerTo());             \
@@ -1000,10 +2032,11 @@ void LLVMIRGen::generateLLVMIRForDataParallelInstr(
     break;                                                                     \
   }
 
-    ARITHMETIC_UNARY_OP_CASE(Sigmoid, "sigmoid");
-    ARITHMETIC_UNARY_OP_CASE(Tanh, "tanh");
+    ARITHMETIC_UNARY_OP_CASE(Sigmoid, getMathKernelName("sigmoid", dest));
+    ARITHMETIC_UNARY_OP_CASE(Tanh, getMathKernelName("tanh", dest));
     ARITHMETIC_UNARY_OP_CASE(ElementLog, "element_log");
-    ARITHMETIC_UNARY_OP_CASE(ElementExp, "element_exp");
+    ARITHMETIC_UNARY_OP_CASE(ElementExp,
+                             getMathKernelName("element_exp", dest));
 
 #undef ARITHMETIC_UNARY_OP_CASE
 
@@ -1039,6 +2072,9 @@ void LLVMIRGen::generateLLVMIRForDataParallelInstr(
     if (dest->getElementType() == ElemKind::Int8QTy) {
       destAddr = builder.CreateGEP(builder.getInt8Ty(), destPtr, loopCount,
                                    "buffer.element.addr");
+    } else if (dest->getElementType() == ElemKind::Int16QTy) {
+      destAddr = builder.CreateGEP(builder.getInt16Ty(), destPtr, loopCount,
+                                   "buffer.element.addr");
     } else if (dest->getElementType() == ElemKind::Int32QTy) {
       destAddr = builder.CreateGEP(builder.getInt32Ty(), destPtr, loopCount,
                                    "buffer.element.addr");
@@ -1059,7 +2095,12 @@ void LLVMIRGen::generateLLVMIRForDataParallelInstr(
     auto *srcTy = src->getType();
     auto *srcScale = emitConstF32(builder, srcTy->getScale());
     auto *srcOffset = emitConstI32(builder, srcTy->getOffset());
-    auto *F = getFunction("element_dequantize_kernel", dest->getElementType());
+    // The kernels are named after their float result, the int16 one also
+    // after its source.
+    auto *F = getFunction(src->getElementType() == ElemKind::Int16QTy
+                              ? "element_dequantize_i16_kernel"
+                              : "element_dequantize_kernel",
+                          dest->getElementType());
 
     auto *stackedOpCall =
         createCall(builder, F, {loopCount, srcPtr, srcScale, srcOffset});
@@ -1079,6 +2120,20 @@ void LLVMIRGen::generateLLVMIRForDataParallelInstr(
     auto *destType = dest->getType();
     auto *srcType = src->getType();
 
+    if (dest->getElementType() == ElemKind::Int16QTy) {
+      // The int16 kernel rescales in float.
+      auto *F = getFunction("element_rescale_kernel", dest->getElementType());
+      auto *stackedOpCall = createCall(
+          builder, F,
+          {loopCount, srcPtr, emitConstI32(builder, destType->getOffset()),
+           emitConstI32(builder, srcType->getOffset()),
+           emitConstF32(builder, srcType->getScale() / destType->getScale())});
+      auto *destAddr = builder.CreateGEP(builder.getInt16Ty(), destPtr,
+                                         loopCount, "buffer.element.addr");
+      builder.CreateStore(stackedOpCall, destAddr);
+      break;
+    }
+
     auto rescaleParams = quantization::quantizeScaleOffset32To8(
         srcType->getScale() / destType->getScale(), srcType->getOffset());
 
@@ -1131,7 +2186,24 @@ void LLVMIRGen::generateLLVMIRForDataParallelInstr(
     auto *pointerNull =                                                        \
         llvm::ConstantPointerNull::get(elementTy->getPointerTo());             \
                                                                                \
-    if (lhs->getType()->isQuantizedType()) {                                   \
+    if (dest->getElementType() == ElemKind::Int16QTy) {                        \
+      /* The int16 kernels bring the operands to the destination scale in */  \
+      /* float. */                                                             \
+      auto *destTy = dest->getType();                                          \
+      auto *stackedOpCall = createCall(                                        \
+          builder, F,                                                          \
+          {loopCount, lhsPtr, rhsPtr,                                          \
+           emitConstI32(builder, destTy->getOffset()),                         \
+           emitConstI32(builder, lhs->getType()->getOffset()),                 \
+           emitConstI32(builder, rhs->getType()->getOffset()),                 \
+           emitConstF32(builder,                                               \
+                        lhs->getType()->getScale() / destTy->getScale()),      \
+           emitConstF32(builder,                                               \
+                        rhs->getType()->getScale() / destTy->getScale())});    \
+      auto *destAddr = builder.CreateGEP(elementTy, destPtr, loopCount,        \
+                                         "buffer.element.addr");               \
+      builder.CreateStore(stackedOpCall, destAddr);                            \
+    } else if (lhs->getType()->isQuantizedType()) {                            \
       auto *destTy = dest->getType();                                          \
       auto *lhsTy = lhs->getType();                                            \
       auto *rhsTy = rhs->getType();                                            \
@@ -1164,8 +2236,8 @@ void LLVMIRGen::generateLLVMIRForDataParallelInstr(
     } else {                                                                   \
       auto *stackedOpCall =                                                    \
           createCall(builder, F, {loopCount, lhsPtr, rhsPtr, pointerNull});    \
-      auto *destAddr = builder.CreateGEP(builder.getFloatTy(), destPtr,        \
-                                         loopCount, "buffer.element.addr");    \
+      auto *destAddr = builder.CreateGEP(elementTy, destPtr, loopCount,        \
+                                         "buffer.element.addr");               \
       builder.CreateStore(stackedOpCall, destAddr);                            \
     }                                                                          \
     break;                                                                     \
@@ -1278,7 +2350,24 @@ void LLVMIRGen::generateLLVMIRForDataParallelInstr(
     auto *pointerNull =
         llvm::ConstantPointerNull::get(elementTy->getPointerTo());
 
-    if (lhs->getType()->isQuantizedType()) {
+    if (dest->getElementType() == ElemKind::Int16QTy) {
+      // The int16 kernel multiplies in float, scaling the LHS by the scale of
+      // the product, see below.
+      auto *destTy = dest->getType();
+      auto *lhsTy = lhs->getType();
+      auto *rhsTy = rhs->getType();
+      float scale = lhsTy->getScale() * rhsTy->getScale() / destTy->getScale();
+      auto *stackedOpCall = createCall(
+          builder, F,
+          {loopCount, lhsPtr, rhsPtr,
+           emitConstI32(builder, destTy->getOffset()),
+           emitConstI32(builder, lhsTy->getOffset()),
+           emitConstI32(builder, rhsTy->getOffset()),
+           emitConstF32(builder, scale), emitConstF32(builder, 1.0f)});
+      auto *destAddr = builder.CreateGEP(elementTy, destPtr, loopCount,
+                                         "buffer.element.addr");
+      builder.CreateStore(stackedOpCall, destAddr);
+    } else if (lhs->getType()->isQuantizedType()) {
       auto *destTy = dest->getType();
       auto *lhsTy = lhs->getType();
       auto *rhsTy = rhs->getType();
@@ -1306,8 +2395,8 @@ void LLVMIRGen::generateLLVMIRForDataParallelInstr(
     } else {
       auto *stackedOpCall =
           createCall(builder, F, {loopCount, lhsPtr, rhsPtr, pointerNull});
-      auto *destAddr = builder.CreateGEP(builder.getFloatTy(), destPtr,
-                                         loopCount, "buffer.element.addr");
+      auto *destAddr = builder.CreateGEP(elementTy, destPtr, loopCount,
+                                         "buffer.element.addr");
       builder.CreateStore(stackedOpCall, destAddr);
     }
     break;
@@ -1410,6 +2499,30 @@ void LLVMIRGen::generateLLVMIRForInstr(llvm::IRBuilder<> &builder,
   assert((!canBePartOfDataParallelKernel(I)) &&
          "data parallel instructions are not handled here");
   switch (I->getKind()) {
+  case Kinded::Kind::ConvertToInstKind: {
+    auto *CI = cast<ConvertToInst>(I);
+    auto *dest = CI->getResult();
+    auto *src = CI->getInput();
+    auto *destPtr = emitValueAddress(builder, dest);
+    auto *srcPtr = emitValueAddress(builder, src);
+    auto *size = emitConstSizeT(builder, dest->size());
+    llvm::Function *F = nullptr;
+    if (src->getElementType() == ElemKind::FloatTy &&
+        dest->getElementType() == ElemKind::Float16Ty) {
+      F = getFunction("convert_f_to_f16");
+    } else if (src->getElementType() == ElemKind::Float16Ty &&
+               dest->getElementType() == ElemKind::FloatTy) {
+      F = getFunction("convert_f16_to_f");
+    } else {
+      LOG(FATAL) << "Unsupported conversion from "
+                 << Type::getElementName(src->getElementType()).str()
+                 << " to "
+                 << Type::getElementName(dest->getElementType()).str();
+    }
+    createCall(builder, F, {destPtr, srcPtr, size});
+    break;
+  }
+
   case Kinded::Kind::MatMulInstKind: {
     auto *MM = cast<MatMulInst>(I);
     auto *dest = MM->getDest();
@@ -1425,7 +2538,21 @@ void LLVMIRGen::generateLLVMIRForInstr(llvm::IRBuilder<> &builder,
 
     auto *F = getFunction("matmul", dest->getElementType());
 
-    if (lhs->getType()->isQuantizedType()) {
+    if (lhs->getElementType() == ElemKind::Int16QTy) {
+      // The int16 kernel multiplies by int8 weights and requantizes in float.
+      auto *destTy = dest->getType();
+      auto *lhsTy = lhs->getType();
+      auto *rhsTy = rhs->getType();
+      assert(rhsTy->getElementType() == ElemKind::Int8QTy &&
+             "The int16 MatMul expects int8 weights");
+      createCall(builder, F,
+                 {destPtr, lhsPtr, rhsPtr, destDims, lhsDims, rhsDims,
+                  emitConstI32(builder, destTy->getOffset()),
+                  emitConstI32(builder, lhsTy->getOffset()),
+                  emitConstI32(builder, rhsTy->getOffset()),
+                  emitConstF32(builder, lhsTy->getScale() * rhsTy->getScale() /
+                                            destTy->getScale())});
+    } else if (lhs->getType()->isQuantizedType()) {
       auto *destTy = dest->getType();
       auto *lhsTy = lhs->getType();
       auto *rhsTy = rhs->getType();
@@ -1473,24 +2600,38 @@ void LLVMIRGen::generateLLVMIRForInstr(llvm::IRBuilder<> &builder,
     break;
   }
 
+  case Kinded::Kind::DynamicQuantizedFullyConnectedInstKind: {
+    auto *DQFC = cast<DynamicQuantizedFullyConnectedInst>(I);
+    auto *dest = DQFC->getDest();
+    auto *src = DQFC->getSrc();
+    auto *weights = DQFC->getWeights();
+    auto *bias = DQFC->getBias();
+
+    auto *destPtr = emitValueAddress(builder, dest);
+    auto *srcPtr = emitValueAddress(builder, src);
+    auto *weightsPtr = emitValueAddress(builder, weights);
+    auto *biasPtr = emitValueAddress(builder, bias);
+
+    auto *destDims = emitValueDims(builder, dest);
+    auto *srcDims = emitValueDims(builder, src);
+    auto *weightsDims = emitValueDims(builder, weights);
+    auto *biasDims = emitValueDims(builder, bias);
+
+    auto *weightsOffset =
+        emitConstI32(builder, weights->getType()->getOffset());
+    auto *weightsScale = emitConstF32(builder, weights->getType()->getScale());
+
+    auto *F = getFunction("dynamic_quantized_fc", dest->getElementType());
+    createCall(builder, F,
+               {destPtr, srcPtr, weightsPtr, biasPtr, destDims, srcDims,
+                weightsDims, biasDims, weightsOffset, weightsScale});
+    break;
+  }
+
   case Kinded::Kind::RowwiseQuantizedFullyConnectedInstKind: {
     auto *RWQFC = cast<RowwiseQuantizedFullyConnectedInst>(I);
-    // Since we can't get the variable from a glow::Value directly,
-    // we need to traverse the var list and find the one matching the given
-    // Value.
-    Tensor scalesT;
-    auto *F_ = getIRFunction();
-    for (auto &v : F_->findConstants()) {
-      assert(isa<WeightVar>(F_->getWeightForNode(v)));
-      auto *w = cast<glow::Value>(F_->getWeightForNode(v));
-      if (w == RWQFC->getScales()) {
-        scalesT.assign(&v->getPayload());
-        break;
-      }
-    }
-    CHECK(scalesT.getUnsafePtr()) << "Can't find the variable.";
-
-    auto scalesH = scalesT.getHandle();
+    auto scalesH =
+        getConstantPayload(getIRFunction(), RWQFC->getScales()).getHandle();
     size_t rowNum = scalesH.dims()[0];
     float inputScale = RWQFC->getSrc()->getType()->getScale();
 
@@ -1589,7 +2730,26 @@ void LLVMIRGen::generateLLVMIRForInstr(llvm::IRBuilder<> &builder,
     auto *numSlice = emitConstSizeT(builder, bdim.first);
     auto *sliceSize = emitConstSizeT(builder, bdim.second);
 
-    if (batch->getType()->isQuantizedType()) {
+    if (batch->getElementType() == ElemKind::Int16QTy) {
+      // The int16 kernels bring both summands to the destination scale in
+      // float.
+      auto *destTy = dest->getType();
+      auto *batchTy = batch->getType();
+      auto *sliceTy = slice->getType();
+      auto *F = getFunction(sliceTy->getElementType() == ElemKind::Int32QTy
+                                ? "batchedadd_i32"
+                                : "batchedadd",
+                            dest->getElementType());
+      createCall(builder, F,
+                 {destPtr, batchPtr, slicePtr, numSlice, sliceSize,
+                  emitConstI32(builder, destTy->getOffset()),
+                  emitConstI32(builder, batchTy->getOffset()),
+                  emitConstI32(builder, sliceTy->getOffset()),
+                  emitConstF32(builder,
+                               batchTy->getScale() / destTy->getScale()),
+                  emitConstF32(builder,
+                               sliceTy->getScale() / destTy->getScale())});
+    } else if (batch->getType()->isQuantizedType()) {
       auto *destTy = dest->getType();
       auto *batchTy = batch->getType();
       auto *sliceTy = slice->getType();
@@ -1766,7 +2926,26 @@ void LLVMIRGen::generateLLVMIRForInstr(llvm::IRBuilder<> &builder,
 
     auto *F = getFunction(kernelName, dest->getElementType());
 
-    if (src->getType()->isQuantizedType()) {
+    if (src->getElementType() == ElemKind::Int16QTy) {
+      // The int16 kernel accumulates in 64 bits and requantizes in float.
+      auto *destTy = dest->getType();
+      auto *srcTy = src->getType();
+      auto *filterTy = filter->getType();
+      auto *biasTy = bias->getType();
+      assert(filterTy->getElementType() == ElemKind::Int8QTy &&
+             "The int16 convolution expects an int8 filter");
+      float matMulScale = srcTy->getScale() * filterTy->getScale();
+      createCall(builder, F,
+                 {destPtr, srcPtr, filterPtr, biasPtr, destDims, srcDims,
+                  filterDims, biasDims, kernels, strides, pads, group,
+                  emitConstI32(builder, destTy->getOffset()),
+                  emitConstI32(builder, srcTy->getOffset()),
+                  emitConstI32(builder, filterTy->getOffset()),
+                  emitConstI32(builder, biasTy->getOffset()),
+                  emitConstF32(builder, biasTy->getScale() / matMulScale),
+                  emitConstF32(builder, matMulScale / destTy->getScale()),
+                  dilation});
+    } else if (src->getType()->isQuantizedType()) {
       auto *destTy = dest->getType();
       auto *srcTy = src->getType();
       auto *filterTy = filter->getType();
@@ -1811,6 +2990,80 @@ void LLVMIRGen::generateLLVMIRForInstr(llvm::IRBuilder<> &builder,
     break;
   }
 
+  case Kinded::Kind::ChannelwiseQuantizedConvolutionInstKind: {
+    auto *CQCI = cast<ChannelwiseQuantizedConvolutionInst>(I);
+    auto *dest = CQCI->getDest();
+    auto *src = CQCI->getSrc();
+    auto *filter = CQCI->getFilter();
+    auto biasH =
+        getConstantPayload(getIRFunction(), CQCI->getBias()).getHandle();
+    auto scalesH =
+        getConstantPayload(getIRFunction(), CQCI->getScales()).getHandle();
+    auto offsetsH = getConstantPayload(getIRFunction(), CQCI->getOffsets())
+                        .getHandle<int32_t>();
+
+    size_t outChannels = dest->dims()[3];
+    size_t outCperG = outChannels / CQCI->getGroup();
+    float srcScale = src->getType()->getScale();
+    float destScale = dest->getType()->getScale();
+
+    // Quantize the bias to the scale of the matrix multiplication of every
+    // output channel, and compute the parameters requantizing its results.
+    std::vector<llvm::Constant *> biasV(outChannels);
+    std::vector<llvm::Constant *> filterOffsetsV(outChannels);
+    std::vector<llvm::Constant *> outPreV(outChannels);
+    std::vector<llvm::Constant *> outPostV(outChannels);
+    std::vector<llvm::Constant *> outScaleV(outChannels);
+    for (size_t d = 0; d < outChannels; d++) {
+      size_t q = CQCI->getGroupwise() ? d / outCperG : d;
+      float matMulScale = srcScale * scalesH.raw(q);
+      auto outScaleParam =
+          quantization::quantizeScaleOffset32To8(matMulScale / destScale, 0);
+      int32_t bias = std::round(biasH.raw(d) / matMulScale);
+      biasV[d] = llvm::ConstantInt::get(builder.getInt32Ty(), bias, true);
+      filterOffsetsV[d] =
+          llvm::ConstantInt::get(builder.getInt32Ty(), offsetsH.raw(q), true);
+      outPreV[d] =
+          llvm::ConstantInt::get(builder.getInt32Ty(), outScaleParam.pre, true);
+      outPostV[d] = llvm::ConstantInt::get(builder.getInt32Ty(),
+                                           outScaleParam.post, true);
+      outScaleV[d] = llvm::ConstantInt::get(builder.getInt32Ty(),
+                                            outScaleParam.scale, true);
+    }
+
+    auto *destPtr = emitValueAddress(builder, dest);
+    auto *srcPtr = emitValueAddress(builder, src);
+    auto *filterPtr = emitValueAddress(builder, filter);
+    auto *biasPtr = emitConstArray(builder, biasV, builder.getInt32Ty());
+    auto *filterOffsetsPtr =
+        emitConstArray(builder, filterOffsetsV, builder.getInt32Ty());
+    auto *outPrePtr = emitConstArray(builder, outPreV, builder.getInt32Ty());
+    auto *outPostPtr = emitConstArray(builder, outPostV, builder.getInt32Ty());
+    auto *outScalePtr =
+        emitConstArray(builder, outScaleV, builder.getInt32Ty());
+
+    auto *destDims = emitValueDims(builder, dest);
+    auto *srcDims = emitValueDims(builder, src);
+    auto *filterDims = emitValueDims(builder, filter);
+
+    auto *kernels = emitConstSizeTArray(builder, CQCI->getKernels());
+    auto *strides = emitConstSizeTArray(builder, CQCI->getStrides());
+    auto *pads = emitConstSizeTArray(builder, CQCI->getPads());
+    auto *group = emitConstSizeT(builder, CQCI->getGroup());
+
+    auto *destOffset = emitConstI32(builder, dest->getType()->getOffset());
+    auto *srcOffset = emitConstI32(builder, src->getType()->getOffset());
+
+    auto *F = getFunction("channelwise_quantized_convolution",
+                          dest->getElementType());
+    createCall(builder, F,
+               {destPtr, srcPtr, filterPtr, biasPtr, filterOffsetsPtr,
+                outPrePtr, outPostPtr, outScalePtr, destDims, srcDims,
+                filterDims, kernels, strides, pads, group, destOffset,
+                srcOffset});
+    break;
+  }
+
   case Kinded::Kind::ConvolutionGradInstKind: {
     auto *CG = cast<ConvolutionGradInst>(I);
     auto *srcGrad = CG->getSrcGrad();
@@ -1870,6 +3123,163 @@ void LLVMIRGen::generateLLVMIRForInstr(llvm::IRBuilder<> &builder,
     break;
   }
 
+  case Kinded::Kind::BucketizeInstKind: {
+    auto *BI = cast<BucketizeInst>(I);
+    auto *dest = BI->getDest();
+    auto *src = BI->getSrc();
+    auto *destPtr = emitValueAddress(builder, dest);
+    auto *srcPtr = emitValueAddress(builder, src);
+
+    // The number of the boundaries lower than or equal to a value doesn't
+    // depend on their order, so the kernel searches them sorted.
+    std::vector<float> boundaries = BI->getBoundaries();
+    std::sort(boundaries.begin(), boundaries.end());
+    std::vector<llvm::Constant *> elems;
+    for (float boundary : boundaries) {
+      elems.push_back(llvm::ConstantFP::get(builder.getFloatTy(), boundary));
+    }
+    auto *boundariesPtr = emitConstArray(builder, elems, builder.getFloatTy());
+    auto *size = emitConstSizeT(builder, src->size());
+    auto *numBoundaries = emitConstSizeT(builder, boundaries.size());
+
+    auto *F = getFunction("bucketize", src->getElementType());
+    createCall(builder, F,
+               {destPtr, srcPtr, boundariesPtr, size, numBoundaries});
+    break;
+  }
+
+  case Kinded::Kind::BatchBoxCoxInstKind: {
+    auto *BBC = cast<BatchBoxCoxInst>(I);
+    auto *dest = BBC->getDest();
+    auto *src = BBC->getSrc();
+    auto *destPtr = emitValueAddress(builder, dest);
+    auto *srcPtr = emitValueAddress(builder, src);
+    auto *lambda1Ptr = emitValueAddress(builder, BBC->getLambda1());
+    auto *lambda2Ptr = emitValueAddress(builder, BBC->getLambda2());
+    auto *rows = emitConstSizeT(builder, src->dims()[0]);
+    auto *cols = emitConstSizeT(builder, src->dims()[1]);
+    auto *epsilon = emitConstF32(builder, BBC->getEpsilon());
+
+    auto *F = getFunction("batch_box_cox", dest->getElementType());
+    createCall(builder, F,
+               {destPtr, srcPtr, lambda1Ptr, lambda2Ptr, rows, cols, epsilon});
+    break;
+  }
+
+  case Kinded::Kind::LayerNormalizationInstKind: {
+    auto *LN = cast<LayerNormalizationInst>(I);
+    auto *dest = LN->getDest();
+    auto *src = LN->getSrc();
+    auto *scale = LN->getScale();
+    auto *destPtr = emitValueAddress(builder, dest);
+    auto *srcPtr = emitValueAddress(builder, src);
+    auto *scalePtr = emitValueAddress(builder, scale);
+    auto *biasPtr = emitValueAddress(builder, LN->getBias());
+    // The rows hold the normalized trailing dimensions of the source.
+    auto *rows = emitConstSizeT(builder, src->size() / scale->size());
+    auto *cols = emitConstSizeT(builder, scale->size());
+    auto *epsilon = emitConstF32(builder, LN->getEpsilon());
+
+    auto *F = getFunction("layer_norm", dest->getElementType());
+    createCall(builder, F,
+               {destPtr, srcPtr, scalePtr, biasPtr, rows, cols, epsilon});
+    break;
+  }
+
+  case Kinded::Kind::BatchedPairwiseDotProductInstKind: {
+    auto *BPDP = cast<BatchedPairwiseDotProductInst>(I);
+    auto *dest = BPDP->getDest();
+    auto *destPtr = emitValueAddress(builder, dest);
+    unsigned numInputs = BPDP->getNumInputs();
+    auto *input = BPDP->getInput(0);
+
+    // The kernel reads the inputs where they are, from an array of their
+    // addresses allocated in the entry block, so they are never concatenated.
+    auto *ptrTy = llvm::Type::getFloatPtrTy(ctx_);
+    auto &entryBB = builder.GetInsertBlock()->getParent()->getEntryBlock();
+    llvm::IRBuilder<> entryBuilder(&entryBB, entryBB.begin());
+    auto *inputsPtr = entryBuilder.CreateAlloca(
+        ptrTy, entryBuilder.getInt32(numInputs), "inputs");
+    for (unsigned i = 0; i < numInputs; i++) {
+      builder.CreateStore(
+          emitValueAddress(builder, BPDP->getInput(i)),
+          builder.CreateConstInBoundsGEP1_32(ptrTy, inputsPtr, i));
+    }
+    auto *numInputsVal = emitConstSizeT(builder, numInputs);
+    auto *batchSize = emitConstSizeT(builder, input->dims()[0]);
+    auto *vectorSize = emitConstSizeT(builder, input->dims()[1]);
+
+    auto *F = getFunction("batched_pairwise_dot_product",
+                          dest->getElementType());
+    createCall(builder, F,
+               {destPtr, inputsPtr, numInputsVal, batchSize, vectorSize});
+    break;
+  }
+
+  case Kinded::Kind::BatchOneHotInstKind: {
+    auto *BOH = cast<BatchOneHotInst>(I);
+    auto *dest = BOH->getDest();
+    auto *data = BOH->getData();
+    auto *destPtr = emitValueAddress(builder, dest);
+    auto *dataPtr = emitValueAddress(builder, data);
+    auto *lengthsPtr = emitValueAddress(builder, BOH->getLengths());
+    auto *valuesPtr = emitValueAddress(builder, BOH->getValues());
+    auto *batchSize = emitConstSizeT(builder, data->dims()[0]);
+    auto *featureCnt = emitConstSizeT(builder, data->dims()[1]);
+    auto *outWidth = emitConstSizeT(builder, dest->dims()[1]);
+
+    auto *F = getFunction("batch_one_hot", data->getElementType());
+    createCall(builder, F,
+               {destPtr, dataPtr, lengthsPtr, valuesPtr, batchSize, featureCnt,
+                outWidth});
+    break;
+  }
+
+  case Kinded::Kind::SparseToDenseMaskInstKind: {
+    auto *STDM = cast<SparseToDenseMaskInst>(I);
+    auto *dest = STDM->getDest();
+    auto *lengths = STDM->getLengths();
+    auto *defaultValue = STDM->getDefaultValue();
+    // The values are copied as bytes, whatever their type.
+    auto *int8PtrTy = builder.getInt8PtrTy();
+    auto *destPtr =
+        builder.CreateBitCast(emitValueAddress(builder, dest), int8PtrTy);
+    auto *valuesPtr = builder.CreateBitCast(
+        emitValueAddress(builder, STDM->getValues()), int8PtrTy);
+    auto *defaultValuePtr = builder.CreateBitCast(
+        emitValueAddress(builder, defaultValue), int8PtrTy);
+    auto *indicesPtr = emitValueAddress(builder, STDM->getIndices());
+    auto *lengthsPtr = emitValueAddress(builder, lengths);
+
+    // The mask is searched sorted by the kernel, with the position of every
+    // ID in the mask.
+    auto mask = STDM->getMask();
+    std::vector<size_t> positions(mask.size());
+    std::iota(positions.begin(), positions.end(), 0);
+    std::sort(positions.begin(), positions.end(),
+              [&](size_t a, size_t b) { return mask[a] < mask[b]; });
+    std::vector<llvm::Constant *> sortedMask;
+    for (size_t pos : positions) {
+      sortedMask.push_back(llvm::ConstantInt::get(builder.getInt64Ty(),
+                                                  mask[pos]));
+    }
+    auto *sortedMaskPtr =
+        emitConstArray(builder, sortedMask, builder.getInt64Ty());
+    auto *positionsPtr =
+        emitConstSizeTArray(builder, llvm::makeArrayRef(positions));
+    auto *maskSize = emitConstSizeT(builder, mask.size());
+    // Lengths can be scalar, which means that all pairs belong to one batch.
+    auto *numBatches = emitConstSizeT(
+        builder, lengths->dims().empty() ? 1 : lengths->dims()[0]);
+    auto *valueSize = emitConstSizeT(builder, defaultValue->getSizeInBytes());
+
+    auto *F = getFunction("sparse_to_dense_mask");
+    createCall(builder, F,
+               {destPtr, valuesPtr, defaultValuePtr, indicesPtr, lengthsPtr,
+                sortedMaskPtr, positionsPtr, maskSize, numBatches, valueSize});
+    break;
+  }
+
   case Kinded::Kind::LengthsSumInstKind: {
     auto *LS = cast<LengthsSumInst>(I);
     auto *dest = LS->getDest();
@@ -2063,6 +3473,35 @@ void LLVMIRGen::generateLLVMIRForInstr(llvm::IRBuilder<> &builder,
     }
   }
 
+  case Kinded::Kind::AdaptiveAvgPoolInstKind: {
+    auto *PA = cast<AdaptiveAvgPoolInst>(I);
+    auto *dest = PA->getDest();
+    auto *src = PA->getSrc();
+    auto *destPtr = emitValueAddress(builder, dest);
+    auto *srcPtr = emitValueAddress(builder, src);
+
+    auto *destDims = emitValueDims(builder, dest);
+    auto *srcDims = emitValueDims(builder, src);
+
+    auto *F = getFunction("adaptive_avg_pool", dest->getElementType());
+    if (src->getType()->isQuantizedType()) {
+      auto *destTy = dest->getType();
+      auto *srcTy = src->getType();
+      auto *destOffset = emitConstI32(builder, destTy->getOffset());
+      auto *srcOffset = emitConstI32(builder, srcTy->getOffset());
+      // The windows have different areas, so libjit divides the ratio of the
+      // scales by the area of every window.
+      auto *scaleRatio =
+          emitConstF32(builder, srcTy->getScale() / destTy->getScale());
+      createCall(builder, F,
+                 {srcPtr, destPtr, srcDims, destDims, destOffset, srcOffset,
+                  scaleRatio});
+    } else {
+      createCall(builder, F, {srcPtr, destPtr, srcDims, destDims});
+    }
+    break;
+  }
+
   case Kinded::Kind::AvgPoolGradInstKind: {
     auto *PAG = cast<AvgPoolGradInst>(I);
     auto *srcGrad = PAG->getSrcGrad();
@@ -2093,7 +3532,8 @@ void LLVMIRGen::generateLLVMIRForInstr(llvm::IRBuilder<> &builder,
     auto *destDims = emitValueDims(builder, dest);
     auto *srcDims = emitValueDims(builder, src);
 
-    auto *F = getFunction("softmax", dest->getElementType());
+    auto *F = getFunction(getMathKernelName("softmax", dest),
+                          dest->getElementType());
     createCall(builder, F, {srcPtr, destPtr, srcDims, destDims});
     break;
   }
@@ -2153,6 +3593,68 @@ void LLVMIRGen::generateLLVMIRForInstr(llvm::IRBuilder<> &builder,
     break;
   }
 
+  case Kinded::Kind::ResizeNearestInstKind:
+  case Kinded::Kind::ResizeBilinearInstKind: {
+    auto *dest = I->getOperand(0).first;
+    auto *src = I->getOperand(1).first;
+    bool bilinear = isa<ResizeBilinearInst>(I);
+    float heightScale = bilinear
+                            ? cast<ResizeBilinearInst>(I)->getHeightScale()
+                            : cast<ResizeNearestInst>(I)->getHeightScale();
+    float widthScale = bilinear ? cast<ResizeBilinearInst>(I)->getWidthScale()
+                                : cast<ResizeNearestInst>(I)->getWidthScale();
+    ShapeNHWC idim(src->dims());
+    ShapeNHWC odim(dest->dims());
+
+    // Compute the input pixels of the output rows and columns, and their
+    // weights, once at compile time instead of for every output element.
+    std::vector<size_t> rows, cols;
+    std::vector<float> rowWeights, colWeights;
+    getResizeTable(idim.h, odim.h, heightScale, 1, bilinear, rows, rowWeights);
+    getResizeTable(idim.w, odim.w, widthScale, idim.c, bilinear, cols,
+                   colWeights);
+
+    auto *destPtr = emitValueAddress(builder, dest);
+    auto *srcPtr = emitValueAddress(builder, src);
+    auto *destDims = emitValueDims(builder, dest);
+    auto *srcDims = emitValueDims(builder, src);
+    auto *rowsPtr = emitConstSizeTArray(builder, llvm::makeArrayRef(rows));
+    auto *colsPtr = emitConstSizeTArray(builder, llvm::makeArrayRef(cols));
+    if (!bilinear) {
+      auto *F = getFunction("resize_nearest", dest->getElementType());
+      createCall(builder, F,
+                 {srcPtr, destPtr, srcDims, destDims, rowsPtr, colsPtr});
+      break;
+    }
+
+    auto emitWeights = [&](llvm::ArrayRef<float> weights) {
+      std::vector<llvm::Constant *> elems;
+      for (float w : weights) {
+        elems.push_back(llvm::ConstantFP::get(builder.getFloatTy(), w));
+      }
+      return emitConstArray(builder, elems, builder.getFloatTy());
+    };
+    auto *rowWeightsPtr = emitWeights(rowWeights);
+    auto *colWeightsPtr = emitWeights(colWeights);
+    auto *F = getFunction("resize_bilinear", dest->getElementType());
+    if (src->getType()->isQuantizedType()) {
+      auto *destTy = dest->getType();
+      auto *srcTy = src->getType();
+      auto *srcOffset = emitConstI32(builder, srcTy->getOffset());
+      auto *destOffset = emitConstI32(builder, destTy->getOffset());
+      auto *scaleRatio =
+          emitConstF32(builder, srcTy->getScale() / destTy->getScale());
+      createCall(builder, F,
+                 {srcPtr, destPtr, srcDims, destDims, rowsPtr, rowWeightsPtr,
+                  colsPtr, colWeightsPtr, srcOffset, destOffset, scaleRatio});
+    } else {
+      createCall(builder, F,
+                 {srcPtr, destPtr, srcDims, destDims, rowsPtr, rowWeightsPtr,
+                  colsPtr, colWeightsPtr});
+    }
+    break;
+  }
+
   case Kinded::Kind::TransposeInstKind: {
     auto *TI = cast<TransposeInst>(I);
     auto *dest = TI->getDest();
@@ -2281,9 +3783,11 @@ void LLVMIRGen::generateLLVMIRForInstr(llvm::IRBuilder<> &builder,
       llvm_unreachable("Cannot get function for Gather. "
                        "Indices input of Gather has to be int32 or int64");
     }
+    auto *prefetchDistance =
+        emitConstSizeT(builder, llvmGatherPrefetchDistance);
     createCall(builder, F,
                {destPtr, dataPtr, indicesPtr, indicesSize, sliceSizeVal,
-                numSamplesVal, sampleSizeVal});
+                numSamplesVal, sampleSizeVal, prefetchDistance});
     break;
   }
 
@@ -2320,9 +3824,11 @@ void LLVMIRGen::generateLLVMIRForInstr(llvm::IRBuilder<> &builder,
       llvm_unreachable("Cannot get function for GatherRanges. "
                        "Ranges input of GatherRanges has to be int32 or int64");
     }
+    auto *prefetchDistance =
+        emitConstSizeT(builder, llvmGatherPrefetchDistance);
     createCall(builder, F,
                {outputPtr, lengthsPtr, dataPtr, rangesPtr, numExamplesVal,
-                exampleSizeVal});
+                exampleSizeVal, prefetchDistance});
     break;
   }
 
@@ -2395,6 +3901,42 @@ void LLVMIRGen::generateLLVMIRForInstr(llvm::IRBuilder<> &builder,
     break;
   }
 
+  case Kinded::Kind::SparseLengthsMeanInstKind: {
+    auto *SI = cast<SparseLengthsMeanInst>(I);
+    auto *dest = SI->getDest();
+    auto *data = SI->getData();
+    auto *indices = SI->getIndices();
+    auto *lengths = SI->getLengths();
+    auto *destPtr = emitValueAddress(builder, dest);
+    auto *dataPtr = emitValueAddress(builder, data);
+    auto *indicesPtr = emitValueAddress(builder, indices);
+    auto *lengthsPtr = emitValueAddress(builder, lengths);
+    auto *segments = emitConstSizeT(builder, lengths->dims()[0]);
+    auto *lineSize = emitConstSizeT(builder, data->size() / data->dims()[0]);
+    auto *F = getFunction("sparse_lengths_mean", dest->getElementType());
+    createCall(builder, F,
+               {destPtr, dataPtr, indicesPtr, lengthsPtr, segments, lineSize});
+    break;
+  }
+
+  case Kinded::Kind::SparseLengthsMaxInstKind: {
+    auto *SI = cast<SparseLengthsMaxInst>(I);
+    auto *dest = SI->getDest();
+    auto *data = SI->getData();
+    auto *indices = SI->getIndices();
+    auto *lengths = SI->getLengths();
+    auto *destPtr = emitValueAddress(builder, dest);
+    auto *dataPtr = emitValueAddress(builder, data);
+    auto *indicesPtr = emitValueAddress(builder, indices);
+    auto *lengthsPtr = emitValueAddress(builder, lengths);
+    auto *segments = emitConstSizeT(builder, lengths->dims()[0]);
+    auto *lineSize = emitConstSizeT(builder, data->size() / data->dims()[0]);
+    auto *F = getFunction("sparse_lengths_max", dest->getElementType());
+    createCall(builder, F,
+               {destPtr, dataPtr, indicesPtr, lengthsPtr, segments, lineSize});
+    break;
+  }
+
   case Kinded::Kind::SparseLengthsWeightedSumInstKind: {
     auto *SI = cast<SparseLengthsWeightedSumInst>(I);
     auto *dest = SI->getDest();
@@ -2487,11 +4029,98 @@ void LLVMIRGen::generateLLVMIRForInstr(llvm::IRBuilder<> &builder,
     auto *segments = emitConstSizeT(builder, lengths->dims()[0]);
     auto *inLineSize = emitConstSizeT(builder, data->size() / data->dims()[0]);
     auto *outLineSize = emitConstSizeT(builder, dest->size() / dest->dims()[0]);
+    auto *fp16ScaleOffset = emitConstI1(
+        builder, data->getElementType() == ElemKind::UInt8FusedFP16QTy);
+    auto *fourBits = emitConstI1(
+        builder, data->getElementType() == ElemKind::UInt4FusedFP16QTy);
     auto *F = getFunction("fused_rowwise_quantized_sparse_lengths_weighted_sum",
                           dest->getElementType());
     createCall(builder, F,
                {destPtr, dataPtr, weightsPtr, indicesPtr, lengthsPtr, segments,
-                inLineSize, outLineSize});
+                inLineSize, outLineSize, fp16ScaleOffset, fourBits});
+    break;
+  }
+
+  case Kinded::Kind::FusedRowwiseQuantizedSparseLengthsMeanInstKind: {
+    auto *N = cast<FusedRowwiseQuantizedSparseLengthsMeanInst>(I);
+    auto *dest = N->getDest();
+    auto *data = N->getData();
+    auto *indices = N->getIndices();
+    auto *lengths = N->getLengths();
+    auto *destPtr = emitValueAddress(builder, dest);
+    auto *dataPtr = emitValueAddress(builder, data);
+    auto *indicesPtr = emitValueAddress(builder, indices);
+    auto *lengthsPtr = emitValueAddress(builder, lengths);
+    auto *segments = emitConstSizeT(builder, lengths->dims()[0]);
+    auto *inLineSize = emitConstSizeT(builder, data->size() / data->dims()[0]);
+    auto *outLineSize = emitConstSizeT(builder, dest->size() / dest->dims()[0]);
+    auto *fp16ScaleOffset = emitConstI1(
+        builder, data->getElementType() == ElemKind::UInt8FusedFP16QTy);
+    auto *fourBits = emitConstI1(
+        builder, data->getElementType() == ElemKind::UInt4FusedFP16QTy);
+    auto *F = getFunction("fused_rowwise_quantized_sparse_lengths_mean",
+                          dest->getElementType());
+    createCall(builder, F,
+               {destPtr, dataPtr, indicesPtr, lengthsPtr, segments, inLineSize,
+                outLineSize, fp16ScaleOffset, fourBits});
+    break;
+  }
+
+  case Kinded::Kind::FusedRowwiseQuantizedSparseLengthsMaxInstKind: {
+    auto *N = cast<FusedRowwiseQuantizedSparseLengthsMaxInst>(I);
+    auto *dest = N->getDest();
+    auto *data = N->getData();
+    auto *indices = N->getIndices();
+    auto *lengths = N->getLengths();
+    auto *destPtr = emitValueAddress(builder, dest);
+    auto *dataPtr = emitValueAddress(builder, data);
+    auto *indicesPtr = emitValueAddress(builder, indices);
+    auto *lengthsPtr = emitValueAddress(builder, lengths);
+    auto *segments = emitConstSizeT(builder, lengths->dims()[0]);
+    auto *inLineSize = emitConstSizeT(builder, data->size() / data->dims()[0]);
+    auto *outLineSize = emitConstSizeT(builder, dest->size() / dest->dims()[0]);
+    auto *fp16ScaleOffset = emitConstI1(
+        builder, data->getElementType() == ElemKind::UInt8FusedFP16QTy);
+    auto *fourBits = emitConstI1(
+        builder, data->getElementType() == ElemKind::UInt4FusedFP16QTy);
+    auto *F = getFunction("fused_rowwise_quantized_sparse_lengths_max",
+                          dest->getElementType());
+    createCall(builder, F,
+               {destPtr, dataPtr, indicesPtr, lengthsPtr, segments, inLineSize,
+                outLineSize, fp16ScaleOffset, fourBits});
+    break;
+  }
+
+  case Kinded::Kind::
+      GroupedFusedRowwiseQuantizedSparseLengthsWeightedSumInstKind: {
+    auto *N = cast<GroupedFusedRowwiseQuantizedSparseLengthsWeightedSumInst>(I);
+    auto *dest = N->getDest();
+    auto *data = N->getData();
+    auto *lengths = N->getLengths();
+    auto *destPtr = emitValueAddress(builder, dest);
+    auto *dataPtr = emitValueAddress(builder, data);
+    auto *weightsPtr = emitValueAddress(builder, N->getWeights());
+    auto *indicesPtr = emitValueAddress(builder, N->getIndices());
+    auto *lengthsPtr = emitValueAddress(builder, lengths);
+    auto *rowOffsetsPtr = emitConstSizeTArray(builder, N->getRowOffsets());
+    auto *indexOffsetsPtr = emitConstSizeTArray(builder, N->getIndexOffsets());
+    auto *segmentOffsetsPtr =
+        emitConstSizeTArray(builder, N->getSegmentOffsets());
+    auto *numTables = emitConstSizeT(builder, N->getRowOffsets().size());
+    auto *segments = emitConstSizeT(builder, lengths->dims()[0]);
+    auto *inLineSize = emitConstSizeT(builder, data->size() / data->dims()[0]);
+    auto *outLineSize = emitConstSizeT(builder, dest->size() / dest->dims()[0]);
+    auto *fp16ScaleOffset = emitConstI1(
+        builder, data->getElementType() == ElemKind::UInt8FusedFP16QTy);
+    auto *fourBits = emitConstI1(
+        builder, data->getElementType() == ElemKind::UInt4FusedFP16QTy);
+    auto *F = getFunction(
+        "grouped_fused_rowwise_quantized_sparse_lengths_weighted_sum",
+        dest->getElementType());
+    createCall(builder, F,
+               {destPtr, dataPtr, weightsPtr, indicesPtr, lengthsPtr,
+                rowOffsetsPtr, indexOffsetsPtr, segmentOffsetsPtr, numTables,
+                segments, inLineSize, outLineSize, fp16ScaleOffset, fourBits});
     break;
   }
 
@@ -2572,3 +4201,19 @@ bool LLVMIRGen::canBePartOfDataParallelKernel(
     const glow::Instruction *I) const {
   return I->isDataParallel();
 }
+
+bool LLVMIRGen::canRollInstr(const glow::Instruction *I) const {
+  if (I->hasPredicate()) {
+    return false;
+  }
+  switch (I->getKind()) {
+  // The code emitted for these depends on the name of the instruction or on
+  // the payload of their constants.
+  case Kinded::Kind::DebugPrintInstKind:
+  case Kinded::Kind::RowwiseQuantizedFullyConnectedInstKind:
+  case Kinded::Kind::ChannelwiseQuantizedConvolutionInstKind:
+    return false;
+  default:
+    return true;
+  }
+}
@@ -98,14 +98,22 @@ void LLVMIRGen::optimizeLLVMModule(llvm::Function *F, llvm::TargetMachine &TM) {
 
   // Perform specialization of functions for constant arguments before anything
   // else.
-  performSpecialization();
+  if (optLevel_ > 0) {
+    performSpecialization();
+  }
 
   llvm::PassManagerBuilder PMB;
-  PMB.OptLevel = 2;
+  PMB.OptLevel = optLevel_;
   PMB.SizeLevel = 0;
-  PMB.LoopVectorize = true;
+  PMB.LoopVectorize = optLevel_ > 0;
   PMB.SLPVectorize = false;
-  PMB.Inliner = llvm::createFunctionInliningPass();
+  // At level 0 the libjit functions are called instead of being inlined, which
+  // saves most of the compile time of large functions.
+  if (optLevel_ > 0) {
+    PMB.Inliner = llvm::createFunctionInliningPass();
+  }
+  TM.setOptLevel(optLevel_ > 0 ? llvm::CodeGenOpt::Default
+                               : llvm::CodeGenOpt::None);
 
   M->setTargetTriple(TM.getTargetTriple().normalize());
   M->setDataLayout(TM.createDataLayout());
@@ -122,7 +130,7 @@ void LLVMIRGen::optimizeLLVMModule(llvm::Function *F, llvm::TargetMachine &TM) {
     // Clear all attributes.
     FF.setAttributes(AL);
     // Force inline all non-no-inline functions.
-    if (!dontInline) {
+    if (!dontInline && optLevel_ > 0) {
       FF.addFnAttr(llvm::Attribute::AttrKind::AlwaysInline);
     }
     if (dontInline) {
@@ -137,7 +145,16 @@ void LLVMIRGen::optimizeLLVMModule(llvm::Function *F, llvm::TargetMachine &TM) {
   // and it is always invoked from either the "jitmain" function or the AOT
   // entry point. To enable better LLVM optimizations "main" should always be
   // inlined.
-  M->getFunction("main")->addFnAttr(llvm::Attribute::AttrKind::AlwaysInline);
+  if (optLevel_ > 0) {
+    M->getFunction("main")->addFnAttr(
+        llvm::Attribute::AttrKind::AlwaysInline);
+  }
+  // The segments are called by "main" and by the entry point running them
+  // concurrently, which must not duplicate their code.
+  for (auto *segmentF : segmentFunctions_) {
+    segmentF->removeFnAttr(llvm::Attribute::AttrKind::AlwaysInline);
+    segmentF->addFnAttr(llvm::Attribute::AttrKind::NoInline);
+  }
 
   llvm::legacy::FunctionPassManager FPM(M);
   llvm::legacy::PassManager PM;
@@ -148,6 +165,11 @@ void LLVMIRGen::optimizeLLVMModule(llvm::Function *F, llvm::TargetMachine &TM) {
 
   PMB.populateFunctionPassManager(FPM);
   PMB.populateModulePassManager(PM);
+  // Still drop the unused libjit functions, which would otherwise all be
+  // compiled to machine code.
+  if (optLevel_ == 0) {
+    PM.add(llvm::createGlobalDCEPass());
+  }
   FPM.doInitialization();
   PM.run(*M);
   for (auto &FF : *M) {
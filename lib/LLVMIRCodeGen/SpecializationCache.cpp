@@ -0,0 +1,244 @@
+/**
+ * Copyright (c) Glow Contributors. See CONTRIBUTORS file.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "SpecializationCache.h"
+
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Analysis/TargetTransformInfo.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/DynamicLibrary.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/TargetRegistry.h"
+#include "llvm/Transforms/IPO.h"
+#include "llvm/Transforms/IPO/PassManagerBuilder.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include "llvm/Transforms/Utils/ValueMapper.h"
+
+#include <glog/logging.h>
+
+using namespace glow;
+
+namespace {
+
+/// \returns a description of the target of \p TM.
+std::string getTargetKey(const llvm::TargetMachine &TM) {
+  return (llvm::Twine(TM.getTargetTriple().str()) + "|" + TM.getTargetCPU() +
+          "|" + TM.getTargetFeatureString())
+      .str();
+}
+
+/// Collect into \p deps the functions and global variables \p F uses,
+/// directly or transitively, including \p F. \returns false if any of them is
+/// a mutable global variable or an alias, which the code of \p F cannot be
+/// shared with other modules with.
+bool collectDependencies(llvm::Function *F,
+                         llvm::DenseSet<const llvm::GlobalValue *> &deps) {
+  llvm::SmallVector<const llvm::User *, 64> worklist;
+  llvm::DenseSet<const llvm::User *> visited;
+  deps.insert(F);
+  worklist.push_back(F);
+  while (!worklist.empty()) {
+    const llvm::User *user = worklist.pop_back_val();
+    llvm::SmallVector<const llvm::Value *, 16> operands;
+    if (auto *fn = llvm::dyn_cast<llvm::Function>(user)) {
+      for (const auto &BB : *fn) {
+        for (const auto &I : BB) {
+          operands.append(I.op_begin(), I.op_end());
+        }
+      }
+    } else {
+      operands.append(user->op_begin(), user->op_end());
+    }
+
+    for (const llvm::Value *op : operands) {
+      if (llvm::isa<llvm::GlobalAlias>(op)) {
+        return false;
+      }
+      if (auto *GV = llvm::dyn_cast<llvm::GlobalVariable>(op)) {
+        // The runtime installs hooks into mutable globals of every module,
+        // e.g. the parallel runner of the CPU backend.
+        if (!GV->isConstant()) {
+          return false;
+        }
+        if (deps.insert(GV).second && GV->hasInitializer()) {
+          worklist.push_back(GV->getInitializer());
+        }
+        continue;
+      }
+      if (auto *fn = llvm::dyn_cast<llvm::Function>(op)) {
+        if (deps.insert(fn).second && !fn->isDeclaration()) {
+          worklist.push_back(fn);
+        }
+        continue;
+      }
+      // Look through constant expressions and aggregates referring to
+      // globals.
+      if (auto *C = llvm::dyn_cast<llvm::Constant>(op)) {
+        if (C->getNumOperands() && visited.insert(C).second) {
+          worklist.push_back(C);
+        }
+      }
+    }
+  }
+  return true;
+}
+
+/// Optimize \p M, a module holding the kernel \p kernelName and the functions
+/// it uses, for \p TM, inlining everything into the kernel like
+/// LLVMIRGen::optimizeLLVMModule inlines everything into "main".
+void optimizeKernelModule(llvm::Module &M, llvm::StringRef kernelName,
+                          llvm::TargetMachine &TM) {
+  llvm::AttributeList AL;
+  for (auto &FF : M) {
+    if (FF.isDeclaration()) {
+      continue;
+    }
+    if (FF.getName() != kernelName) {
+      FF.setLinkage(llvm::GlobalValue::LinkageTypes::InternalLinkage);
+    }
+    // Keep the no-inline attribute of the specializations, force inline all
+    // the other functions.
+    bool dontInline = FF.hasFnAttribute(llvm::Attribute::AttrKind::NoInline);
+    FF.setAttributes(AL);
+    FF.addFnAttr(dontInline ? llvm::Attribute::AttrKind::NoInline
+                            : llvm::Attribute::AttrKind::AlwaysInline);
+    FF.addFnAttr("no-frame-pointer-elim", "true");
+  }
+  for (auto &GV : M.globals()) {
+    if (!GV.isDeclaration()) {
+      GV.setLinkage(llvm::GlobalValue::LinkageTypes::InternalLinkage);
+    }
+  }
+
+  M.setTargetTriple(TM.getTargetTriple().normalize());
+  M.setDataLayout(TM.createDataLayout());
+
+  llvm::PassManagerBuilder PMB;
+  PMB.OptLevel = 2;
+  PMB.SizeLevel = 0;
+  PMB.LoopVectorize = true;
+  PMB.SLPVectorize = false;
+  PMB.Inliner = llvm::createFunctionInliningPass();
+
+  llvm::legacy::FunctionPassManager FPM(&M);
+  llvm::legacy::PassManager PM;
+  PM.add(createTargetTransformInfoWrapperPass(TM.getTargetIRAnalysis()));
+  FPM.add(createTargetTransformInfoWrapperPass(TM.getTargetIRAnalysis()));
+  PMB.populateFunctionPassManager(FPM);
+  PMB.populateModulePassManager(PM);
+  PM.add(llvm::createGlobalDCEPass());
+  FPM.doInitialization();
+  for (auto &FF : M) {
+    FPM.run(FF);
+  }
+  FPM.doFinalization();
+  PM.run(M);
+}
+
+} // namespace
+
+SpecializationCache &SpecializationCache::get() {
+  static SpecializationCache cache;
+  return cache;
+}
+
+SpecializationCache::TargetJIT &
+SpecializationCache::getJIT(const llvm::TargetMachine &TM) {
+  auto &target = JITs_[getTargetKey(TM)];
+  if (!target.JIT) {
+    target.TM.reset(TM.getTarget().createTargetMachine(
+        TM.getTargetTriple().str(), TM.getTargetCPU(),
+        TM.getTargetFeatureString(), TM.Options, TM.getRelocationModel(),
+        TM.getCodeModel(), llvm::CodeGenOpt::Default, /* JIT */ true));
+    CHECK(target.TM) << "Could not create the target machine of the shared "
+                        "specializations";
+    target.JIT = llvm::make_unique<llvm::orc::GlowJIT>(*target.TM);
+  }
+  return target;
+}
+
+llvm::StringRef SpecializationCache::getLibjitHash(llvm::StringRef libjitBC) {
+  auto &hash = libjitHashes_[libjitBC.data()];
+  if (hash.empty()) {
+    llvm::MD5 md5;
+    md5.update(libjitBC);
+    llvm::MD5::MD5Result result;
+    md5.final(result);
+    hash = result.digest().str();
+  }
+  return hash;
+}
+
+std::string SpecializationCache::getOrCompile(llvm::Function *specializedF,
+                                              llvm::StringRef key,
+                                              llvm::StringRef libjitBC,
+                                              const llvm::TargetMachine &TM) {
+  std::lock_guard<std::mutex> lock(lock_);
+  std::string fullKey = (llvm::Twine(getTargetKey(TM)) + "|" +
+                         getLibjitHash(libjitBC) + "|" + key)
+                            .str();
+  auto it = kernels_.find(fullKey);
+  if (it != kernels_.end()) {
+    return it->second;
+  }
+  // Remember the kernels which cannot be shared too, to not look at them
+  // again.
+  auto &name = kernels_[fullKey];
+
+  llvm::DenseSet<const llvm::GlobalValue *> deps;
+  if (!collectDependencies(specializedF, deps)) {
+    return name;
+  }
+
+  // Copy the kernel and what it uses into a module of its own.
+  std::string kernelName =
+      "glow_shared_specialization_" + std::to_string(kernels_.size());
+  llvm::ValueToValueMapTy VMap;
+  auto kernelM = llvm::CloneModule(
+      *specializedF->getParent(), VMap,
+      [&deps](const llvm::GlobalValue *GV) { return deps.count(GV) != 0; });
+  auto *kernel = llvm::cast<llvm::Function>(VMap[specializedF]);
+  kernel->setName(kernelName);
+  kernel->setLinkage(llvm::GlobalValue::LinkageTypes::ExternalLinkage);
+
+  auto &target = getJIT(TM);
+  optimizeKernelModule(*kernelM, kernelName, *target.TM);
+  llvm::orc::SimpleCompiler compiler(*target.TM);
+  target.JIT->addObject(compiler(*kernelM));
+  auto address = target.JIT->findSymbol(kernelName).getAddress();
+  if (!address) {
+    LOG(ERROR) << "Could not compile the shared specialization "
+               << specializedF->getName().str() << ": "
+               << llvm::toString(address.takeError());
+    return name;
+  }
+
+  // Let the JITs of the process resolve the kernel.
+  llvm::sys::DynamicLibrary::AddSymbol(kernelName, (void *)*address);
+  name = kernelName;
+  return name;
+}
+
+size_t SpecializationCache::size() {
+  std::lock_guard<std::mutex> lock(lock_);
+  size_t numKernels = 0;
+  for (const auto &kernel : kernels_) {
+    numKernels += !kernel.getValue().empty();
+  }
+  return numKernels;
+}
@@ -0,0 +1,87 @@
+/**
+ * Copyright (c) Glow Contributors. See CONTRIBUTORS file.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef GLOW_LLVMIRCODEGEN_SPECIALIZATIONCACHE_H
+#define GLOW_LLVMIRCODEGEN_SPECIALIZATIONCACHE_H
+
+#include "glow/LLVMIRCodeGen/GlowJIT.h"
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/IR/Function.h"
+#include "llvm/Target/TargetMachine.h"
+
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace glow {
+
+/// A process-wide cache of the machine code of the libjit kernels specialized
+/// for constant arguments by the FunctionSpecializer. Every kernel is compiled
+/// once per target, libjit bitcode and set of constant arguments, into a JIT
+/// owned by the cache, and its address is published to the dynamic linker of
+/// the process. The modules JITed afterwards only declare the kernel, and
+/// their GlowJIT resolves it like a symbol of the process. Compile time and
+/// code size then grow with the number of distinct shapes instead of the
+/// number of networks. May be used concurrently.
+class SpecializationCache final {
+  /// A JIT holding the kernels compiled for one target.
+  struct TargetJIT {
+    /// The target machine the kernels are compiled with.
+    std::unique_ptr<llvm::TargetMachine> TM;
+    /// The JIT the kernels are loaded into.
+    std::unique_ptr<llvm::orc::GlowJIT> JIT;
+  };
+
+  /// The JITs by target description, see getTargetKey.
+  llvm::StringMap<TargetJIT> JITs_;
+
+  /// The names of the compiled kernels by key, empty for the kernels which
+  /// cannot be shared.
+  llvm::StringMap<std::string> kernels_;
+
+  /// The hashes of the libjit bitcodes by their address.
+  llvm::DenseMap<const char *, std::string> libjitHashes_;
+
+  /// Protects all the members.
+  std::mutex lock_;
+
+  /// \returns the JIT compiling kernels for the target of \p TM.
+  TargetJIT &getJIT(const llvm::TargetMachine &TM);
+
+  /// \returns the hash of the libjit bitcode \p libjitBC.
+  llvm::StringRef getLibjitHash(llvm::StringRef libjitBC);
+
+public:
+  /// \returns the cache of the process.
+  static SpecializationCache &get();
+
+  /// \returns the name of the shared machine code of \p specializedF, a libjit
+  /// kernel specialized for constant arguments and identified by \p key in
+  /// the libjit bitcode \p libjitBC, compiling it for the target of \p TM on
+  /// the first call. \returns an empty string if \p specializedF cannot be
+  /// shared, e.g. because it uses mutable globals of its module.
+  std::string getOrCompile(llvm::Function *specializedF, llvm::StringRef key,
+                           llvm::StringRef libjitBC,
+                           const llvm::TargetMachine &TM);
+
+  /// \returns the number of kernels compiled by the cache.
+  size_t size();
+};
+
+} // namespace glow
+
+#endif // GLOW_LLVMIRCODEGEN_SPECIALIZATIONCACHE_H
@@ -18,7 +18,11 @@
 #include "glow/Importer/ONNXIFIModelLoader.h"
 #include "glow/Optimizer/GraphOptimizer/FunctionPasses.h"
 #include "glow/Optimizer/GraphOptimizer/GraphOptimizer.h"
+#include "glow/Runtime/StatsExporter.h"
+#include "glow/Support/ThreadPool.h"
 
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Format.h"
 #include <glog/logging.h>
 
@@ -26,8 +30,17 @@ namespace glow {
 namespace onnxifi {
 extern bool GlowDumpDebugTraces;
 
+static llvm::cl::opt<unsigned> GlowCompletionThreads(
+    "glow-onnxifi-completion-threads",
+    llvm::cl::desc("Number of threads running the callbacks of the events"),
+    llvm::cl::init(2));
+
 namespace {
 const char *compatibilityFunctionName = "check";
+
+/// Counter of the bytes of inputs copied because their buffer could not be
+/// bound to their placeholder directly.
+const char *kInputBytesCopied = "glow.onnxifi.input_bytes_copied";
 } // namespace
 
 onnxStatus Backend::checkGraphCompatibility(const void *onnxModel,
@@ -83,7 +96,13 @@ onnxStatus Backend::checkGraphCompatibility(const void *onnxModel,
   return ONNXIFI_STATUS_SUCCESS;
 }
 
+ThreadPool &Event::getCompletionPool() {
+  static ThreadPool pool(std::max(1u, unsigned(GlowCompletionThreads)));
+  return pool;
+}
+
 bool Event::signal(onnxStatus status) {
+  CallbackTy callback;
   {
     std::lock_guard<std::mutex> guard(mutex_);
     if (fired_) {
@@ -91,8 +110,35 @@ bool Event::signal(onnxStatus status) {
     }
     status_ = status;
     fired_ = true;
+    callback = std::move(callback_);
+    // Notify while holding the lock, as a waiter may release the event as
+    // soon as it wakes up.
+    cond_.notify_all();
+  }
+  // The callback may release the event, don't touch it from now on.
+  if (callback) {
+    getCompletionPool().submit(
+        [callback = std::move(callback), status]() { callback(status); });
+  }
+  return true;
+}
+
+bool Event::setCallback(CallbackTy callback) {
+  onnxStatus status;
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (hasCallback_) {
+      return false;
+    }
+    hasCallback_ = true;
+    if (!fired_) {
+      callback_ = std::move(callback);
+      return true;
+    }
+    status = status_;
   }
-  cond_.notify_all();
+  getCompletionPool().submit(
+      [callback = std::move(callback), status]() { callback(status); });
   return true;
 }
 
@@ -119,6 +165,68 @@ std::pair<bool, onnxStatus> Event::waitFor(size_t timeoutMs) {
   return {/*signalled*/ true, status_};
 }
 
+void Graph::copyTensorBox(const char *src, llvm::ArrayRef<size_t> srcDims,
+                          char *dst, llvm::ArrayRef<size_t> dstDims,
+                          size_t elementSize) {
+  DCHECK_EQ(srcDims.size(), dstDims.size());
+  if (dstDims.empty()) {
+    memcpy(dst, src, elementSize);
+    return;
+  }
+  size_t srcSliceBytes = elementSize;
+  size_t dstSliceBytes = elementSize;
+  for (size_t j = 1, e = dstDims.size(); j < e; ++j) {
+    srcSliceBytes *= srcDims[j];
+    dstSliceBytes *= dstDims[j];
+  }
+  size_t rows = std::min(srcDims[0], dstDims[0]);
+  if (srcDims.drop_front().equals(dstDims.drop_front())) {
+    // The leading rows are contiguous in both tensors.
+    memcpy(dst, src, rows * dstSliceBytes);
+  } else {
+    for (size_t r = 0; r < rows; ++r) {
+      copyTensorBox(src + r * srcSliceBytes, srcDims.drop_front(),
+                    dst + r * dstSliceBytes, dstDims.drop_front(),
+                    elementSize);
+    }
+  }
+  memset(dst + rows * dstSliceBytes, 0, (dstDims[0] - rows) * dstSliceBytes);
+}
+
+const Graph::ShapeBucket *
+Graph::selectShapeBucket(uint32_t inputsCount,
+                         const onnxTensorDescriptorV1 *inputDescriptors) const {
+  for (const auto &bucket : shapeBuckets_) {
+    bool fits = true;
+    for (unsigned i = 0; i < inputsCount && fits; ++i) {
+      const auto &inOnnxTensor = inputDescriptors[i];
+      auto inPhIt = bucket.inputs.find(inOnnxTensor.name);
+      if (inPhIt == bucket.inputs.end()) {
+        // Unknown inputs are reported on the whole model.
+        return nullptr;
+      }
+      // An input of the rank of its placeholder fits if each of its
+      // dimensions does, since it is padded along each dimension.
+      auto inPhDims = inPhIt->getValue()->dims();
+      if (inOnnxTensor.dimensions == inPhDims.size()) {
+        for (unsigned j = 0; j < inOnnxTensor.dimensions && fits; ++j) {
+          fits = inOnnxTensor.shape[j] <= inPhDims[j];
+        }
+        continue;
+      }
+      size_t inOnnxTensorSize = 1;
+      for (unsigned j = 0; j < inOnnxTensor.dimensions; ++j) {
+        inOnnxTensorSize *= inOnnxTensor.shape[j];
+      }
+      fits = inOnnxTensorSize <= inPhIt->getValue()->getType()->size();
+    }
+    if (fits) {
+      return &bucket;
+    }
+  }
+  return nullptr;
+}
+
 onnxStatus Graph::setIOAndRun(uint32_t inputsCount,
                               const onnxTensorDescriptorV1 *inputDescriptors,
                               uint32_t outputsCount,
@@ -137,19 +245,27 @@ onnxStatus Graph::setIOAndRun(uint32_t inputsCount,
   TRACE_EVENT_SCOPE_NAMED(traceContext, TraceLevel::RUNTIME, "adjustInputs",
                           aiEvent);
 
+  // Run the smallest batch bucket that the request fits in, if any, whose
+  // inputs are padded like those of the whole model.
+  const ShapeBucket *bucket = selectShapeBucket(inputsCount, inputDescriptors);
+  const auto &inputToPlaceholder =
+      bucket ? bucket->inputs : onnxInputToPlaceholder_;
+  const auto &outputToPlaceholder =
+      bucket ? bucket->outputs : onnxOutputToPlaceholder_;
+
   // Create tensors for input placeholders
   for (unsigned i = 0; i < inputsCount; ++i) {
     const auto &inOnnxTensor = inputDescriptors[i];
     auto *inOnnxBuffer = reinterpret_cast<void *>(inOnnxTensor.buffer);
 
-    auto inPhIt = onnxInputToPlaceholder_.find(inOnnxTensor.name);
-    if (inPhIt == onnxInputToPlaceholder_.end()) {
+    auto inPhIt = inputToPlaceholder.find(inOnnxTensor.name);
+    if (inPhIt == inputToPlaceholder.end()) {
       return ONNXIFI_STATUS_UNIDENTIFIED_NAME;
     }
 
     auto &inPhPtr = inPhIt->getValue();
 
-    std::vector<size_t> inOnnxTensorDims(inOnnxTensor.dimensions);
+    llvm::SmallVector<size_t, 6> inOnnxTensorDims(inOnnxTensor.dimensions);
     size_t inOnnxTensorSize = 1;
     for (unsigned j = 0; j < inOnnxTensor.dimensions; ++j) {
       inOnnxTensorDims[j] = inOnnxTensor.shape[j];
@@ -172,16 +288,47 @@ onnxStatus Graph::setIOAndRun(uint32_t inputsCount,
       return ONNXIFI_STATUS_INVALID_SHAPE;
     }
 
-    // Only allocate a tensor if insufficient backing storage is provided.
+    // Only allocate a tensor if insufficient backing storage is provided. A
+    // buffer holding all elements of the placeholder is bound directly even
+    // if it is described with another shape, since both are row-major.
     unsigned elementSize = inPhPtr->getType()->getElementSize();
     size_t onnxBytes = inOnnxTensorSize * elementSize;
-    if (inPhPtr->dims().equals(inOnnxTensorDims)) {
+    auto inPhDims = inPhPtr->dims();
+    if (inOnnxTensorSize == inPhPtr->getType()->size()) {
       ctx->getPlaceholderBindings()->insert(
           inPhPtr, Tensor(inOnnxBuffer, inPhPtr->getType()));
+    } else if (inOnnxBuffer && inOnnxTensorDims.size() == inPhDims.size() &&
+               !llvm::makeArrayRef(inOnnxTensorDims)
+                    .drop_front()
+                    .equals(inPhDims.drop_front())) {
+      // An input shorter than its placeholder along another dimension than
+      // the leading one, e.g. a shorter sequence, is padded along each
+      // dimension.
+      for (size_t j = 0, e = inPhDims.size(); j < e; ++j) {
+        if (inOnnxTensorDims[j] > inPhDims[j]) {
+          LOG(ERROR) << "Input tensor does not fit in dimension " << j << ": "
+                     << inOnnxTensorDims[j] << " vs " << inPhDims[j] << ": "
+                     << inOnnxTensor.name;
+          return ONNXIFI_STATUS_INVALID_SHAPE;
+        }
+      }
+      Tensor *inputTensor = tensorPool_.get(inPhPtr->getType());
+      if (!inputTensor) {
+        DLOG(FATAL) << "Tensorpool tensor not found for input "
+                    << inOnnxTensor.name;
+        return ONNXIFI_STATUS_INTERNAL_ERROR;
+      }
+      copyTensorBox(reinterpret_cast<const char *>(inOnnxBuffer),
+                    inOnnxTensorDims, inputTensor->getUnsafePtr(), inPhDims,
+                    elementSize);
+      Stats()->incrementCounter(kInputBytesCopied, onnxBytes);
+      ctx->getPlaceholderBindings()->insert(inPhPtr, inputTensor);
     } else if (backendPtr_->getBackend().supportsPartialTensors() &&
                inOnnxBuffer && inOnnxTensorSize > 0) {
       // We have a partial input buffer.  Create a padded unowned tensor that
-      // remembers the actual size of the input.
+      // remembers the actual size of the input, so that only the input is
+      // transferred. The backend zeroes the padding unless the placeholder is
+      // ragged, e.g. the indices of a sparse lookup.
       ctx->getPlaceholderBindings()->insert(
           inPhPtr, Tensor(inOnnxBuffer, inPhPtr->getType(), onnxBytes));
     } else {
@@ -201,6 +348,7 @@ onnxStatus Graph::setIOAndRun(uint32_t inputsCount,
       } else {
         inputTensor->zero();
       }
+      Stats()->incrementCounter(kInputBytesCopied, onnxBytes);
       ctx->getPlaceholderBindings()->insert(inPhPtr, inputTensor);
     }
   }
@@ -210,27 +358,47 @@ onnxStatus Graph::setIOAndRun(uint32_t inputsCount,
                           "setOnnxifiOutputs", soEvent);
 
   // Create tensors for output placeholders
+  std::vector<OutputSlice> outputSlices;
   for (unsigned i = 0; i < outputsCount; ++i) {
     const auto &outOnnxTensor = outputDescriptors[i];
     auto *outOnnxBuffer = reinterpret_cast<void *>(outOnnxTensor.buffer);
 
-    auto outPhIt = onnxOutputToPlaceholder_.find(outOnnxTensor.name);
-    if (outPhIt == onnxOutputToPlaceholder_.end()) {
+    auto outPhIt = outputToPlaceholder.find(outOnnxTensor.name);
+    if (outPhIt == outputToPlaceholder.end()) {
       return ONNXIFI_STATUS_UNIDENTIFIED_NAME;
     }
 
     auto &outPhPtr = outPhIt->getValue();
 
     // Compute the total size of the onnxifi tensor.
-    std::vector<size_t> outOnnxTensorDims(outOnnxTensor.dimensions);
+    llvm::SmallVector<size_t, 6> outOnnxTensorDims(outOnnxTensor.dimensions);
     size_t outOnnxTensorSize = 1;
     for (unsigned j = 0; j < outOnnxTensor.dimensions; ++j) {
       outOnnxTensorDims[j] = outOnnxTensor.shape[j];
       outOnnxTensorSize *= outOnnxTensorDims[j];
     }
 
+    // The outputs of a shape bucket may have other dimensions than those of
+    // the request, which then gets the leading elements of the bucket along
+    // each dimension.
+    auto outPhDims = outPhPtr->dims();
+    if (bucket && !outPhDims.equals(outOnnxTensorDims) &&
+        outPhDims.size() == outOnnxTensorDims.size()) {
+      Tensor *outputTensor = tensorPool_.get(outPhPtr->getType());
+      if (!outputTensor) {
+        DLOG(FATAL) << "Tensorpool tensor not found for output "
+                    << outOnnxTensor.name;
+        return ONNXIFI_STATUS_INTERNAL_ERROR;
+      }
+      outputSlices.push_back(
+          {outPhPtr, outOnnxBuffer,
+           ShapeVector(outOnnxTensorDims.begin(), outOnnxTensorDims.end())});
+      ctx->getPlaceholderBindings()->insert(outPhPtr, outputTensor);
+      continue;
+    }
+
     // Check that tensor provided by onnxifi is the correct size.
-    if (!outPhPtr->dims().equals(outOnnxTensorDims)) {
+    if (!outPhDims.equals(outOnnxTensorDims)) {
       LOG(ERROR) << "Output tensor is the wrong shape: " << outOnnxTensorSize
                  << " total dims vs " << outPhPtr->getType()->size() << ": "
                  << outOnnxTensor.name;
@@ -244,6 +412,10 @@ onnxStatus Graph::setIOAndRun(uint32_t inputsCount,
   }
   TRACE_EVENT_SCOPE_END_NAMED(soEvent);
 
+  if (bucket) {
+    return runShapeBucket(*bucket, std::move(ctx), std::move(outputSlices),
+                          outputEvent, traceEvents);
+  }
   return run(std::move(ctx), outputEvent, traceEvents);
 }
 
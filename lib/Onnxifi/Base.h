@@ -27,11 +27,43 @@
 
 #include <atomic>
 #include <condition_variable>
+#include <functional>
 #include <mutex>
+#include <string>
+#include <vector>
 
 #include "llvm/ADT/StringMap.h"
 
+/// Glow extensions of ONNXIFI that foxi doesn't declare.
+
+/// Continuation of an onnxEvent, called with \p userData and the status of
+/// the event once it is signalled.
+typedef void(ONNXIFI_ABI *onnxEventCallback)(void *userData,
+                                              onnxStatus status);
+
+/// Registers \p callback to be called with \p userData on the completion
+/// thread pool once \p event is signalled, instead of waiting for it.
+typedef ONNXIFI_CHECK_RESULT onnxStatus(
+    ONNXIFI_ABI *onnxSetEventCallbackFunction)(onnxEvent event,
+                                               onnxEventCallback callback,
+                                               void *userData);
+
+/// Runs \p graphsCount graphs as onnxSetIOAndRunGraph does, the run \p i
+/// binding \p inputDescriptors[i] and \p outputDescriptors[i] to \p
+/// graphs[i] and signalling \p outputFences[i]. \p traceEvents is null or
+/// holds a trace event list, possibly null, per run.
+typedef ONNXIFI_CHECK_RESULT onnxStatus(
+    ONNXIFI_ABI *onnxSetIOAndRunGraphsFunction)(
+    uint32_t graphsCount, const onnxGraph *graphs,
+    const uint32_t *inputsCounts,
+    const onnxTensorDescriptorV1 *const *inputDescriptors,
+    const uint32_t *outputsCounts,
+    const onnxTensorDescriptorV1 *const *outputDescriptors,
+    onnxMemoryFenceV1 *outputFences, onnxTraceEventList **traceEvents);
+
 namespace glow {
+class ThreadPool;
+
 namespace onnxifi {
 
 class Graph;
@@ -79,10 +111,19 @@ typedef Backend *BackendPtr;
 
 class Event {
 public:
+  /// A continuation called with the status of the event.
+  using CallbackTy = std::function<void(onnxStatus)>;
+
   Event() : fired_{false} {}
-  /// Signal the event.
+  /// Signal the event, then run its callback on the completion pool if it
+  /// has one.
   bool signal(onnxStatus status);
 
+  /// Register \p callback to be run on the completion pool once the event is
+  /// signalled, or right away if it is already, so that no thread blocks on
+  /// the event. \returns false if the event already has a callback.
+  bool setCallback(CallbackTy callback);
+
   /// Wait until the event is signalled.
   onnxStatus wait();
 
@@ -95,6 +136,10 @@ public:
   /// Check if event was signalled.
   bool isSignalled() { return fired_; }
 
+  /// \returns the thread pool shared by all the events to run their
+  /// callbacks.
+  static ThreadPool &getCompletionPool();
+
 private:
   std::atomic<bool> fired_;
   std::mutex mutex_;
@@ -102,24 +147,60 @@ private:
   /// Used to hold an onnxStatus that will be passed for the signaller of the
   /// event to a waiter. Should only be accessed while holding mutex_.
   onnxStatus status_ = ONNXIFI_STATUS_SUCCESS;
+  /// The callback to run once the event is signalled, and whether one was
+  /// registered. Should only be accessed while holding mutex_.
+  CallbackTy callback_;
+  bool hasCallback_{false};
 };
 
 typedef Event *EventPtr;
 
 class Graph {
 public:
+  /// A network compiled from the model of the Graph with some of its inputs
+  /// loaded with smaller dimensions, e.g. a smaller batch size or sequence
+  /// length. A request that fits in a bucket runs it instead of the whole
+  /// model, which saves the compute spent on padding.
+  struct ShapeBucket {
+    /// Name of the network of the bucket in the backend.
+    std::string name;
+    /// Mapping between ONNX names and Glow placeholders of the inputs and the
+    /// outputs of the bucket.
+    llvm::StringMap<Placeholder *> inputs;
+    llvm::StringMap<Placeholder *> outputs;
+  };
+
+  /// An output of a run of a ShapeBucket that is copied to the \p buffer of
+  /// the request, of shape \p dims, once the run is done, since the request
+  /// has other dimensions than the bucket. Each dimension gets the leading
+  /// elements of the bucket, and zeros past the end of the bucket.
+  struct OutputSlice {
+    Placeholder *PH;
+    void *buffer;
+    ShapeVector dims;
+  };
+
   explicit Graph(BackendPtr backendPtr);
   virtual ~Graph() = default;
 
   BackendPtr backend() { return backendPtr_; }
 
+  /// \returns the shape buckets of the Graph.
+  const std::vector<ShapeBucket> &getShapeBuckets() const {
+    return shapeBuckets_;
+  }
+
   /// Setup Glow graph in preparation for the inference and run.
   /// Set input memory addresses for inputs based on the \p inputDescriptors.
   /// Set output memory addresses for outputs based on the \p
   /// outputDescriptors. Will async signal the \p outputEvent when run is
   /// complete. \p traceEvents is a pointer to onnxTraceEventList, if it is not
   /// null then it is expected that this will be populated with trace events
-  /// from the run before signalling the outputEvent.
+  /// from the run before signalling the outputEvent. The smallest shape
+  /// bucket that fits the inputs is run if there is one, with the inputs
+  /// padded and the outputs sliced to the shapes of the request. Inputs
+  /// with smaller dimensions than their placeholder are zero padded along
+  /// each dimension.
   onnxStatus setIOAndRun(uint32_t inputsCount,
                          const onnxTensorDescriptorV1 *inputDescriptors,
                          uint32_t outputsCount,
@@ -136,6 +217,25 @@ public:
                          EventPtr outputEvent,
                          onnxTraceEventList *traceEvents) = 0;
 
+  /// Async run the shape bucket \p bucket with the given ExecutionContext
+  /// \p ctx, copy \p outputSlices out of it then signal \p outputEvent when
+  /// done. Only Graphs that create shape buckets implement it.
+  virtual onnxStatus runShapeBucket(const ShapeBucket &bucket,
+                                    std::unique_ptr<ExecutionContext> ctx,
+                                    std::vector<OutputSlice> outputSlices,
+                                    EventPtr outputEvent,
+                                    onnxTraceEventList *traceEvents) {
+    return ONNXIFI_STATUS_INTERNAL_ERROR;
+  }
+
+  /// Copy the elements of the row-major tensor \p src of shape \p srcDims
+  /// that are within the shape \p dstDims, of the same rank, to the row-major
+  /// tensor \p dst of that shape, and zero the other elements of \p dst.
+  /// Both tensors have elements of \p elementSize bytes.
+  static void copyTensorBox(const char *src, llvm::ArrayRef<size_t> srcDims,
+                            char *dst, llvm::ArrayRef<size_t> dstDims,
+                            size_t elementSize);
+
   /// Copy any trace events \p traceContext into \p traceEvents. If
   /// \p traceEvents is null then do nothing.
   static void setTraceEvents(onnxTraceEventList *traceEvents,
@@ -156,8 +256,19 @@ protected:
   /// placeholder for output.
   llvm::StringMap<Placeholder *> onnxOutputToPlaceholder_;
 
+  /// Shape buckets of the Graph by increasing size of their inputs, which
+  /// are all smaller than those of the model.
+  std::vector<ShapeBucket> shapeBuckets_;
+
   /// An object pool for tensors, to share allocations.
   TensorPool tensorPool_;
+
+private:
+  /// \returns the smallest shape bucket that holds the \p inputsCount inputs
+  /// \p inputDescriptors, or nullptr if only the whole model does.
+  const ShapeBucket *
+  selectShapeBucket(uint32_t inputsCount,
+                    const onnxTensorDescriptorV1 *inputDescriptors) const;
 };
 
 typedef Graph *GraphPtr;
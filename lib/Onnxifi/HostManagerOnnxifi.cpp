@@ -19,6 +19,8 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/FileSystem.h"
 
+#include <algorithm>
+
 namespace glow {
 namespace onnxifi {
 
@@ -44,6 +46,34 @@ static llvm::cl::opt<bool, true> GlowSaturateHostOpt(
     llvm::cl::desc("Try to use all available devices on the host"),
     llvm::cl::location(GlowSaturateHost));
 
+static llvm::cl::list<unsigned> GlowBatchBuckets(
+    "glow-onnxifi-batch-buckets",
+    llvm::cl::desc("Batch sizes that variants of each network are compiled "
+                   "for, a request runs the smallest one it fits in"),
+    llvm::cl::CommaSeparated, llvm::cl::ZeroOrMore);
+
+static llvm::cl::list<std::string> GlowDynamicDims(
+    "glow-onnxifi-dynamic-dims",
+    llvm::cl::desc("Dimensions of the inputs of the networks, as input:dim, "
+                   "that vary between requests, e.g. sequence lengths"),
+    llvm::cl::CommaSeparated, llvm::cl::ZeroOrMore);
+
+static llvm::cl::list<unsigned> GlowDynamicDimBuckets(
+    "glow-onnxifi-dynamic-dim-buckets",
+    llvm::cl::desc("Sizes of -glow-onnxifi-dynamic-dims that variants of each "
+                   "network are compiled for, a request runs the smallest one "
+                   "it fits in"),
+    llvm::cl::CommaSeparated, llvm::cl::ZeroOrMore);
+
+/// \returns the sorted unique sizes of \p sizes.
+static std::vector<unsigned>
+getBucketSizes(const llvm::cl::list<unsigned> &sizes) {
+  std::vector<unsigned> sorted(sizes.begin(), sizes.end());
+  std::sort(sorted.begin(), sorted.end());
+  sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+  return sorted;
+}
+
 std::unique_ptr<runtime::HostManager>
 HostManagerBackend::createHostManager(llvm::StringRef backendName) {
   std::vector<std::unique_ptr<runtime::DeviceConfig>> configs;
@@ -66,7 +96,17 @@ void HostManagerBackend::runNetwork(const Graph *graph,
   DCHECK(callback != nullptr);
 
   auto hostManagerGraph = static_cast<const HostManagerGraph *>(graph);
-  hostManager_->runNetwork(hostManagerGraph->getName(), std::move(context),
+  runNetwork(hostManagerGraph->getName(), std::move(context),
+             std::move(callback), priority);
+}
+
+void HostManagerBackend::runNetwork(llvm::StringRef networkName,
+                                    std::unique_ptr<ExecutionContext> context,
+                                    runtime::ResultCBTy callback,
+                                    uint64_t priority) {
+  DCHECK(callback != nullptr);
+
+  hostManager_->runNetwork(networkName, std::move(context),
                            std::move(callback), priority);
 }
 
@@ -100,8 +140,13 @@ onnxStatus HostManagerBackend::addNetwork(std::unique_ptr<Module> module) {
 onnxStatus HostManagerBackend::removeNetwork(const Graph *graph) {
   auto hostManagerGraph = static_cast<const HostManagerGraph *>(graph);
   auto error = hostManager_->removeNetwork(hostManagerGraph->getName());
+  bool failed = ERR_TO_BOOL(std::move(error));
+
+  for (const auto &bucket : graph->getShapeBuckets()) {
+    failed |= ERR_TO_BOOL(hostManager_->removeNetwork(bucket.name));
+  }
 
-  if (ERR_TO_BOOL(std::move(error))) {
+  if (failed) {
     return ONNXIFI_STATUS_INTERNAL_ERROR;
   }
 
@@ -132,17 +177,207 @@ HostManagerGraph::initGraph(const void *onnxModel, size_t onnxModelSize,
     tensorPool_.reserve(obj.second->getType(), 10);
   }
 
-  return static_cast<HostManagerBackend *>(backendPtr_)
-      ->addNetwork(std::move(module));
+  auto status = static_cast<HostManagerBackend *>(backendPtr_)
+                    ->addNetwork(std::move(module));
+  if (status != ONNXIFI_STATUS_SUCCESS) {
+    return status;
+  }
+
+  addBatchBuckets(onnxModel, onnxModelSize, weightCount, weightDescriptors);
+  addDynamicDimBuckets(onnxModel, onnxModelSize, weightCount,
+                       weightDescriptors);
+  // A request runs the first bucket that it fits in.
+  auto bucketSize = [](const ShapeBucket &bucket) {
+    size_t size = 0;
+    for (const auto &obj : bucket.inputs) {
+      size += obj.second->getType()->size();
+    }
+    return size;
+  };
+  std::stable_sort(shapeBuckets_.begin(), shapeBuckets_.end(),
+                   [&](const ShapeBucket &a, const ShapeBucket &b) {
+                     return bucketSize(a) < bucketSize(b);
+                   });
+  return status;
+}
+
+void HostManagerGraph::addBatchBuckets(
+    const void *onnxModel, size_t onnxModelSize, uint32_t weightCount,
+    const onnxTensorDescriptorV1 *weightDescriptors) {
+  if (GlowBatchBuckets.empty()) {
+    return;
+  }
+
+  // The batch size of the model is the leading dimension of its outputs, and
+  // its batched inputs are those with the same leading dimension.
+  size_t modelBatchSize = 0;
+  for (const auto &obj : onnxOutputToPlaceholder_) {
+    auto dims = obj.second->dims();
+    size_t batchSize = dims.empty() ? 0 : dims[0];
+    if (modelBatchSize && batchSize != modelBatchSize) {
+      LOG(WARNING) << "Not adding batch buckets to " << netName_
+                   << ", whose outputs have different batch sizes";
+      return;
+    }
+    modelBatchSize = batchSize;
+  }
+  std::vector<Placeholder *> batchedInputs;
+  for (const auto &obj : onnxInputToPlaceholder_) {
+    auto dims = obj.second->dims();
+    if (!dims.empty() && dims[0] == modelBatchSize) {
+      batchedInputs.push_back(obj.second);
+    }
+  }
+  if (!modelBatchSize || batchedInputs.empty()) {
+    return;
+  }
+
+  for (unsigned batchSize : getBucketSizes(GlowBatchBuckets)) {
+    if (batchSize == 0 || batchSize >= modelBatchSize) {
+      continue;
+    }
+    llvm::StringMap<ShapeVector> inputShapes;
+    for (auto *PH : batchedInputs) {
+      ShapeVector dims(PH->dims().begin(), PH->dims().end());
+      dims[0] = batchSize;
+      inputShapes.try_emplace(PH->getName(), dims);
+    }
+    addShapeBucket(onnxModel, onnxModelSize, weightCount, weightDescriptors,
+                   strFormat("%s_batch_%u", netName_.c_str(), batchSize),
+                   inputShapes, batchSize);
+  }
+}
+
+void HostManagerGraph::addDynamicDimBuckets(
+    const void *onnxModel, size_t onnxModelSize, uint32_t weightCount,
+    const onnxTensorDescriptorV1 *weightDescriptors) {
+  if (GlowDynamicDims.empty() || GlowDynamicDimBuckets.empty()) {
+    return;
+  }
+
+  // The dynamic dimensions of the inputs of this model.
+  std::vector<std::pair<Placeholder *, size_t>> dynamicDims;
+  for (const auto &spec : GlowDynamicDims) {
+    auto nameAndDim = llvm::StringRef(spec).rsplit(':');
+    size_t dim;
+    if (nameAndDim.second.empty() ||
+        nameAndDim.second.getAsInteger(10, dim)) {
+      LOG(WARNING) << "Ignoring the dynamic dimension " << spec
+                   << ", which is not input:dim";
+      continue;
+    }
+    auto it = onnxInputToPlaceholder_.find(nameAndDim.first);
+    if (it == onnxInputToPlaceholder_.end()) {
+      continue;
+    }
+    if (dim >= it->second->dims().size()) {
+      LOG(WARNING) << "Ignoring the dynamic dimension " << spec << " of "
+                   << netName_ << ", whose input has fewer dimensions";
+      continue;
+    }
+    dynamicDims.emplace_back(it->second, dim);
+  }
+  if (dynamicDims.empty()) {
+    return;
+  }
+
+  for (unsigned size : getBucketSizes(GlowDynamicDimBuckets)) {
+    // The dimensions of the model are the largest sizes.
+    llvm::StringMap<ShapeVector> inputShapes;
+    for (const auto &PHAndDim : dynamicDims) {
+      auto *PH = PHAndDim.first;
+      auto &dims = inputShapes
+                       .try_emplace(PH->getName(), PH->dims().begin(),
+                                    PH->dims().end())
+                       .first->second;
+      if (size > 0 && size < dims[PHAndDim.second]) {
+        dims[PHAndDim.second] = size;
+      }
+    }
+    bool smaller = false;
+    for (const auto &obj : inputShapes) {
+      smaller |= !onnxInputToPlaceholder_[obj.first()]->dims().equals(
+          obj.second);
+    }
+    if (smaller) {
+      addShapeBucket(onnxModel, onnxModelSize, weightCount, weightDescriptors,
+                     strFormat("%s_dynamic_%u", netName_.c_str(), size),
+                     inputShapes);
+    }
+  }
+}
+
+void HostManagerGraph::addShapeBucket(
+    const void *onnxModel, size_t onnxModelSize, uint32_t weightCount,
+    const onnxTensorDescriptorV1 *weightDescriptors, llvm::StringRef name,
+    const llvm::StringMap<ShapeVector> &inputShapes, size_t batchSize) {
+  ShapeBucket bucket;
+  bucket.name = name;
+
+  std::unique_ptr<Module> module = llvm::make_unique<Module>();
+  Function *function = module->createFunction(bucket.name);
+  auto loaderOrErr = ONNXIFIModelLoader::parse(
+      onnxModel, onnxModelSize, weightCount, weightDescriptors, *function,
+      true /*loadInputsAsPlaceholders*/, backendPtr_->getUseOnnx(),
+      &inputShapes);
+  if (!loaderOrErr) {
+    LOG(WARNING) << "Not adding shape bucket " << bucket.name << ": "
+                 << ERR_TO_STRING(loaderOrErr.takeError());
+    return;
+  }
+  bucket.inputs = (*loaderOrErr)->getInputVarsMapping();
+  bucket.outputs = (*loaderOrErr)->getOutputVarsMapping();
+
+  // Shapes that the model fixes, such as those of a Reshape, may keep the
+  // outputs at the batch size of the model.
+  for (const auto &obj : bucket.outputs) {
+    auto dims = obj.second->dims();
+    if (batchSize && (dims.empty() || dims[0] != batchSize)) {
+      LOG(WARNING) << "Not adding shape bucket " << bucket.name
+                   << ", whose output " << obj.first().str()
+                   << " is not batched";
+      return;
+    }
+  }
+
+  if (static_cast<HostManagerBackend *>(backendPtr_)
+          ->addNetwork(std::move(module)) != ONNXIFI_STATUS_SUCCESS) {
+    LOG(WARNING) << "Not adding shape bucket " << bucket.name
+                 << ", which failed to compile";
+    return;
+  }
+
+  for (auto &obj : bucket.inputs) {
+    tensorPool_.reserve(obj.second->getType(), 10);
+  }
+  shapeBuckets_.push_back(std::move(bucket));
 }
 
 onnxStatus HostManagerGraph::run(std::unique_ptr<ExecutionContext> ctx,
                                  EventPtr outputEvent,
                                  onnxTraceEventList *traceEvents) {
-  backendPtr_->runNetwork(
-      this, std::move(ctx),
-      [outputEvent, traceEvents](runtime::RunIdentifierTy runId, Error err,
-                                 std::unique_ptr<ExecutionContext> ctx) {
+  return runNetwork(netName_, std::move(ctx), {}, outputEvent, traceEvents);
+}
+
+onnxStatus HostManagerGraph::runShapeBucket(
+    const ShapeBucket &bucket, std::unique_ptr<ExecutionContext> ctx,
+    std::vector<OutputSlice> outputSlices, EventPtr outputEvent,
+    onnxTraceEventList *traceEvents) {
+  return runNetwork(bucket.name, std::move(ctx), std::move(outputSlices),
+                    outputEvent, traceEvents);
+}
+
+onnxStatus HostManagerGraph::runNetwork(llvm::StringRef networkName,
+                                        std::unique_ptr<ExecutionContext> ctx,
+                                        std::vector<OutputSlice> outputSlices,
+                                        EventPtr outputEvent,
+                                        onnxTraceEventList *traceEvents) {
+  auto *backend = static_cast<HostManagerBackend *>(backendPtr_);
+  backend->runNetwork(
+      networkName, std::move(ctx),
+      [outputEvent, traceEvents,
+       outputSlices](runtime::RunIdentifierTy runId, Error err,
+                     std::unique_ptr<ExecutionContext> ctx) {
         TRACE_EVENT_SCOPE(ctx->getTraceContext(), TraceLevel::RUNTIME,
                           "Onnxifi::callback");
         // If an Error occurred then log it in ERR_TO_BOOL and signal the output
@@ -152,6 +387,15 @@ onnxStatus HostManagerGraph::run(std::unique_ptr<ExecutionContext> ctx,
           return;
         }
 
+        // Copy the elements of the outputs of a shape bucket that the
+        // request asked for.
+        for (const auto &slice : outputSlices) {
+          auto *outputTensor = ctx->getPlaceholderBindings()->get(slice.PH);
+          copyTensorBox(outputTensor->getUnsafePtr(), slice.PH->dims(),
+                        reinterpret_cast<char *>(slice.buffer), slice.dims,
+                        outputTensor->getType().getElementSize());
+        }
+
         // End the current trace event before we convert TraceEvents to the ONNX
         // format.
         TRACE_EVENT_SCOPE_END();
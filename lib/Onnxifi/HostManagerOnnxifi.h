@@ -35,6 +35,12 @@ public:
   void runNetwork(const Graph *graph, std::unique_ptr<ExecutionContext> context,
                   runtime::ResultCBTy callback, uint64_t priority = 0) override;
 
+  /// Run the network named \p networkName, which is either a HostManagerGraph
+  /// or one of its batch buckets.
+  void runNetwork(llvm::StringRef networkName,
+                  std::unique_ptr<ExecutionContext> context,
+                  runtime::ResultCBTy callback, uint64_t priority = 0);
+
   onnxStatus addNetwork(std::unique_ptr<Module> module);
 
   onnxStatus removeNetwork(const Graph *graph) override;
@@ -58,7 +64,11 @@ public:
   static size_t makeUniqueGraphId();
 
   /// Init Glow graph based on the ONNX model \p onnxModel and
-  /// static trained weights \p weightDescriptors.
+  /// static trained weights \p weightDescriptors. A shape bucket is also
+  /// added for every size of -glow-onnxifi-batch-buckets smaller than the
+  /// batch size of the model, and for every size of
+  /// -glow-onnxifi-dynamic-dim-buckets smaller than one of the
+  /// -glow-onnxifi-dynamic-dims of the model.
   onnxStatus
   initGraph(const void *onnxModel, size_t onnxModelSize, uint32_t weightCount,
             const onnxTensorDescriptorV1 *weightDescriptors) override;
@@ -70,11 +80,50 @@ public:
   onnxStatus run(std::unique_ptr<ExecutionContext> ctx, EventPtr outputEvent,
                  onnxTraceEventList *traceEvents) override;
 
+  onnxStatus runShapeBucket(const ShapeBucket &bucket,
+                            std::unique_ptr<ExecutionContext> ctx,
+                            std::vector<OutputSlice> outputSlices,
+                            EventPtr outputEvent,
+                            onnxTraceEventList *traceEvents) override;
+
   /// \returns the unique string name of the HostManagerGraph that the
   /// underlying HostManagerGraph uses to identify this network.
   const std::string &getName() const { return netName_; }
 
 private:
+  /// Add the batch buckets of the model \p onnxModel with weights
+  /// \p weightDescriptors, whose batched inputs get the leading dimensions of
+  /// -glow-onnxifi-batch-buckets.
+  void addBatchBuckets(const void *onnxModel, size_t onnxModelSize,
+                       uint32_t weightCount,
+                       const onnxTensorDescriptorV1 *weightDescriptors);
+
+  /// Add the dynamic dimension buckets of the model \p onnxModel with
+  /// weights \p weightDescriptors, whose -glow-onnxifi-dynamic-dims get the
+  /// sizes of -glow-onnxifi-dynamic-dim-buckets.
+  void addDynamicDimBuckets(const void *onnxModel, size_t onnxModelSize,
+                            uint32_t weightCount,
+                            const onnxTensorDescriptorV1 *weightDescriptors);
+
+  /// Load the model \p onnxModel with weights \p weightDescriptors again,
+  /// with the inputs named in \p inputShapes given those shapes, and add it
+  /// to the backend as the shape bucket \p name. The bucket is left out if
+  /// the model doesn't load, or if \p batchSize isn't 0 and its outputs
+  /// don't have that leading dimension.
+  void addShapeBucket(const void *onnxModel, size_t onnxModelSize,
+                      uint32_t weightCount,
+                      const onnxTensorDescriptorV1 *weightDescriptors,
+                      llvm::StringRef name,
+                      const llvm::StringMap<ShapeVector> &inputShapes,
+                      size_t batchSize = 0);
+
+  /// Run the network \p networkName of the backend with \p ctx, copy
+  /// \p outputSlices out of it then signal \p outputEvent.
+  onnxStatus runNetwork(llvm::StringRef networkName,
+                        std::unique_ptr<ExecutionContext> ctx,
+                        std::vector<OutputSlice> outputSlices,
+                        EventPtr outputEvent, onnxTraceEventList *traceEvents);
+
   std::string netName_;
 };
 
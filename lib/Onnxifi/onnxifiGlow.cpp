@@ -211,7 +211,8 @@ GLOW_ONNXIFI_LIBRARY_FUNCTION_WRAPPER(onnxGetBackendInfo)(
     return setBackendInfoString(
         infoValue, infoValueSize,
         "onnxSetIOAndRunGraphFunction onnxWaitEventForFunction "
-        "onnxReleaseTraceEventsFunction");
+        "onnxReleaseTraceEventsFunction onnxSetEventCallbackFunction "
+        "onnxSetIOAndRunGraphsFunction");
   default:
     return ONNXIFI_STATUS_UNSUPPORTED_PROPERTY;
   }
@@ -360,6 +361,32 @@ GLOW_ONNXIFI_LIBRARY_FUNCTION_WRAPPER(onnxWaitEventFor)(
   return ONNXIFI_STATUS_SUCCESS;
 }
 
+/// Register \p callback to be called with \p userData and the status of \p
+/// event on the completion thread pool once \p event is signalled, so that
+/// the caller doesn't block a thread waiting for it. The callback may release
+/// the event. Only one callback may be registered per event.
+EXTERNC ONNXIFI_PUBLIC ONNXIFI_CHECK_RESULT onnxStatus ONNXIFI_ABI
+GLOW_ONNXIFI_LIBRARY_FUNCTION_WRAPPER(onnxSetEventCallback)(
+    onnxEvent event, onnxEventCallback callback, void *userData) {
+  auto &manager = glow::onnxifi::GlowOnnxifiManager::get();
+
+  if (!callback) {
+    return ONNXIFI_STATUS_INVALID_POINTER;
+  }
+
+  auto *glowEvent = static_cast<glow::onnxifi::EventPtr>(event);
+  if (!manager.isValid(glowEvent)) {
+    return ONNXIFI_STATUS_INVALID_EVENT;
+  }
+
+  if (!glowEvent->setCallback([callback, userData](onnxStatus status) {
+        callback(userData, status);
+      })) {
+    return ONNXIFI_STATUS_INVALID_STATE;
+  }
+  return ONNXIFI_STATUS_SUCCESS;
+}
+
 /// Query ONNXIFI event state without blocking.
 EXTERNC ONNXIFI_PUBLIC ONNXIFI_CHECK_RESULT onnxStatus ONNXIFI_ABI
 GLOW_ONNXIFI_LIBRARY_FUNCTION_WRAPPER(onnxGetEventState)(
@@ -537,6 +564,34 @@ GLOW_ONNXIFI_LIBRARY_FUNCTION_WRAPPER(onnxSetIOAndRunGraph)(
                                 outputDescriptors, outputEvent, traceEvents);
 }
 
+/// Run \p graphsCount graphs in one call, as onnxSetIOAndRunGraph runs each
+/// of them. \returns the status of the first run that fails, the runs before
+/// it are submitted and will signal their fences.
+EXTERNC ONNXIFI_PUBLIC ONNXIFI_CHECK_RESULT onnxStatus ONNXIFI_ABI
+GLOW_ONNXIFI_LIBRARY_FUNCTION_WRAPPER(onnxSetIOAndRunGraphs)(
+    uint32_t graphsCount, const onnxGraph *graphs,
+    const uint32_t *inputsCounts,
+    const onnxTensorDescriptorV1 *const *inputDescriptors,
+    const uint32_t *outputsCounts,
+    const onnxTensorDescriptorV1 *const *outputDescriptors,
+    onnxMemoryFenceV1 *outputFences, onnxTraceEventList **traceEvents) {
+  if (graphsCount && (!graphs || !inputsCounts || !inputDescriptors ||
+                      !outputsCounts || !outputDescriptors || !outputFences)) {
+    return ONNXIFI_STATUS_INVALID_POINTER;
+  }
+
+  for (uint32_t i = 0; i < graphsCount; ++i) {
+    auto status = GLOW_ONNXIFI_LIBRARY_FUNCTION_WRAPPER(onnxSetIOAndRunGraph)(
+        graphs[i], inputsCounts[i], inputDescriptors[i], outputsCounts[i],
+        outputDescriptors[i], &outputFences[i],
+        traceEvents ? traceEvents[i] : nullptr);
+    if (status != ONNXIFI_STATUS_SUCCESS) {
+      return status;
+    }
+  }
+  return ONNXIFI_STATUS_SUCCESS;
+}
+
 /// Deinitialize an ONNXIFI graph and release associated resources.
 /// It blocks until all in-flight inference operations complete.
 EXTERNC ONNXIFI_PUBLIC ONNXIFI_CHECK_RESULT onnxStatus ONNXIFI_ABI
@@ -594,7 +649,13 @@ GLOW_ONNXIFI_LIBRARY_FUNCTION_WRAPPER(onnxGetExtensionFunctionAddress)(
                GLOW_ONNXIFI_LIBRARY_FUNCTION_WRAPPER(onnxWaitEventFor))},
           {"onnxReleaseTraceEventsFunction",
            reinterpret_cast<onnxExtensionFunctionPointer>(
-               GLOW_ONNXIFI_LIBRARY_FUNCTION_WRAPPER(onnxReleaseTraceEvents))}};
+               GLOW_ONNXIFI_LIBRARY_FUNCTION_WRAPPER(onnxReleaseTraceEvents))},
+          {"onnxSetEventCallbackFunction",
+           reinterpret_cast<onnxExtensionFunctionPointer>(
+               GLOW_ONNXIFI_LIBRARY_FUNCTION_WRAPPER(onnxSetEventCallback))},
+          {"onnxSetIOAndRunGraphsFunction",
+           reinterpret_cast<onnxExtensionFunctionPointer>(
+               GLOW_ONNXIFI_LIBRARY_FUNCTION_WRAPPER(onnxSetIOAndRunGraphs))}};
 
   auto extensionIt = extensionMap.find(name);
 
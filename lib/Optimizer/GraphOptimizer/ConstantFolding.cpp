@@ -25,13 +25,26 @@
 #include "glow/Graph/Utils.h"
 #include "glow/Optimizer/GraphOptimizer/FunctionPasses.h"
 
+#include "llvm/ADT/Hashing.h"
 #include "llvm/Support/Casting.h"
+#include "llvm/Support/CommandLine.h"
+
+#include <mutex>
+#include <unordered_map>
 
 using namespace glow;
 using llvm::dyn_cast;
 using llvm::isa;
 
 namespace {
+llvm::cl::OptionCategory constantFoldingCat("Constant Folding Options");
+
+llvm::cl::opt<unsigned> constantFoldingCacheSizeOpt(
+    "constant-folding-cache-size",
+    llvm::cl::desc("Maximum size in MB of the results of constant folding "
+                   "cached for later compilations, 0 disables the cache."),
+    llvm::cl::init(1024), llvm::cl::cat(constantFoldingCat));
+
 /// The name of the temporary function to be used to perform constant folding.
 constexpr const char *constEvaluationFunctionName =
     "__constEvaluationFunction__";
@@ -113,56 +126,157 @@ void run(Backend &backend, CompiledFunction &compiledF,
   context.movePlaceholderBindings().release();
 }
 
-/// Evaluates a provided constant operation \p C using the provided \p backend
-/// and using the compilation context \p cctx.
-/// \returns constant results.
-std::vector<Constant *>
-evaluateConstantOperation(Backend &backend, CompilationContext &cctx, Node *C) {
-  PlaceholderBindings bindings;
-  assert(isConstantOperation(C, backend) && "Expected a constant expression");
-  // Constants and splats do not need to be constant evaluated.
-  if (isa<Constant>(C) || isa<SplatNode>(C)) {
-    return {};
+/// Evaluates the provided constant operations \p ops using the provided
+/// \p backend and using the compilation context \p cctx. All of them are
+/// computed by a single temporary function, which is compiled and run once.
+/// \returns the constant results of each operation.
+std::vector<std::vector<Constant *>>
+evaluateConstantOperations(Backend &backend, CompilationContext &cctx,
+                           llvm::ArrayRef<Node *> ops) {
+  std::vector<std::vector<Constant *>> constResults(ops.size());
+  if (ops.empty()) {
+    return constResults;
   }
-  Module &mod = *C->getParent()->getParent();
-  // Create a temporary function to perform the constant operation.
+  PlaceholderBindings bindings;
+  Module &mod = *ops[0]->getParent()->getParent();
+  // Create a temporary function to perform the constant operations.
   Function *constEvaluationF = mod.createFunction(constEvaluationFunctionName);
-  // Mapping from existing nodes to the new ones.
+  // Mapping from existing nodes to the new ones, shared by all operations so
+  // that their common parts are computed once.
   NodeMap currToNew;
-  // Clone the constant operation and some of its inputs if necessary.
-  auto *clonedC = recursiveClone(constEvaluationF, C, currToNew);
-  // Create save nodes for each of the results.
-  llvm::SmallVector<SaveNode *, 16> savedResults;
-  for (size_t idx = 0, e = clonedC->getNumResults(); idx < e; ++idx) {
-    auto *SN = constEvaluationF->createSave(clonedC->getName(),
-                                            clonedC->getNthResult(idx));
-    savedResults.emplace_back(SN);
-    bindings.allocate(SN->getPlaceholder());
+  // Save nodes for each of the results of each operation.
+  std::vector<llvm::SmallVector<SaveNode *, 4>> savedResults(ops.size());
+  for (size_t i = 0, e = ops.size(); i < e; i++) {
+    Node *C = ops[i];
+    assert(isConstantOperation(C, backend) && "Expected a constant expression");
+    // Constants and splats do not need to be constant evaluated.
+    if (isa<Constant>(C) || isa<SplatNode>(C)) {
+      continue;
+    }
+    // Clone the constant operation and some of its inputs if necessary, unless
+    // it is part of an operation cloned already.
+    auto it = currToNew.find(C);
+    Node *clonedC = it != currToNew.end()
+                        ? it->second
+                        : recursiveClone(constEvaluationF, C, currToNew);
+    for (size_t idx = 0, e = clonedC->getNumResults(); idx < e; ++idx) {
+      auto *SN = constEvaluationF->createSave(clonedC->getName(),
+                                              clonedC->getNthResult(idx));
+      savedResults[i].emplace_back(SN);
+      bindings.allocate(SN->getPlaceholder());
+    }
+  }
+  if (bindings.pairs().empty()) {
+    mod.eraseFunction(constEvaluationF);
+    return constResults;
   }
-  // Run the temporary backend to perform this constant operation
-  // evaluation.
+  // Run the temporary backend to perform the constant operations evaluation.
   EXIT_ON_ERR(
       executeConstantFunction(backend, *constEvaluationF, bindings, cctx));
-  // Get the results of the constant operation compile-time computation and
-  // create new constants from it.
-  std::vector<Constant *> constResults;
-  constResults.reserve(savedResults.size());
-  for (auto *SN : savedResults) {
-    Tensor *outputTensor = bindings.get(SN->getPlaceholder());
-    auto *constResult =
-        mod.createConstant(SN->getName(), std::move(*outputTensor));
-    constResults.emplace_back(constResult);
+  // Get the results of the constant operations compile-time computation and
+  // create new constants from them.
+  for (size_t i = 0, e = ops.size(); i < e; i++) {
+    constResults[i].reserve(savedResults[i].size());
+    for (auto *SN : savedResults[i]) {
+      Tensor *outputTensor = bindings.get(SN->getPlaceholder());
+      auto *constResult =
+          mod.createConstant(SN->getName(), std::move(*outputTensor));
+      constResults[i].emplace_back(constResult);
 
-    // Now erase the Placeholder that we created for the SaveNode.
-    auto &vars = mod.getPlaceholders();
-    mod.erasePlaceholder(
-        std::find(vars.begin(), vars.end(), SN->getPlaceholder()));
+      // Now erase the Placeholder that we created for the SaveNode.
+      auto &vars = mod.getPlaceholders();
+      mod.erasePlaceholder(
+          std::find(vars.begin(), vars.end(), SN->getPlaceholder()));
+    }
   }
   // Remove the temporary function.
   mod.eraseFunction(constEvaluationF);
   return constResults;
 }
 
+/// \returns a hash of the constant operation \p N that only depends on what
+/// it computes and on the data of the Constants it reads, so that the same
+/// operation gets the same hash when a model is loaded again. \p hashes
+/// memoizes the hashes of the nodes seen already.
+llvm::hash_code
+hashConstantOperation(const Node *N,
+                      llvm::DenseMap<const Node *, llvm::hash_code> &hashes) {
+  auto it = hashes.find(N);
+  if (it != hashes.end()) {
+    return it->second;
+  }
+  llvm::hash_code hash;
+  if (auto *C = dyn_cast<Constant>(N)) {
+    auto &T = C->getPayload();
+    auto *data = T.getUnsafePtr();
+    hash = llvm::hash_combine(
+        T.getType().toString(),
+        llvm::hash_combine_range(data, data + T.getSizeInBytes()));
+  } else {
+    // The description holds the kind, the attributes and the types of the node.
+    hash = llvm::hash_value(N->getDebugDesc());
+    for (size_t idx = 0, e = N->getNumInputs(); idx < e; ++idx) {
+      auto input = N->getNthInput(idx);
+      hash = llvm::hash_combine(hash,
+                                hashConstantOperation(input.getNode(), hashes),
+                                input.getResNo());
+    }
+  }
+  hashes[N] = hash;
+  return hash;
+}
+
+/// Cache of the results of constant folding, shared by all compilations in the
+/// process so that a model compiled again doesn't fold its weights again.
+class ConstantFoldingCache {
+  /// The results of the constant operations, by their hash.
+  std::unordered_map<size_t, std::vector<Tensor>> results_;
+  /// Total size of the cached results.
+  size_t sizeInBytes_{0};
+  /// Lock for concurrent compilations.
+  std::mutex lock_;
+
+public:
+  /// Copies into \p results the cached results of the operation with hash
+  /// \p hash. \returns whether the results were found.
+  bool lookup(size_t hash, std::vector<Tensor> &results) {
+    std::lock_guard<std::mutex> guard(lock_);
+    auto it = results_.find(hash);
+    if (it == results_.end()) {
+      return false;
+    }
+    for (auto &T : it->second) {
+      results.emplace_back(T.clone());
+    }
+    return true;
+  }
+
+  /// Caches a copy of \p results as the results of the operation with hash
+  /// \p hash, unless the cache is full.
+  void insert(size_t hash, llvm::ArrayRef<Constant *> results) {
+    size_t size = 0;
+    for (auto *C : results) {
+      size += C->getPayload().getSizeInBytes();
+    }
+    std::lock_guard<std::mutex> guard(lock_);
+    if (sizeInBytes_ + size > constantFoldingCacheSizeOpt * 1024 * 1024 ||
+        results_.count(hash)) {
+      return;
+    }
+    auto &cached = results_[hash];
+    for (auto *C : results) {
+      cached.emplace_back(C->getPayload().clone());
+    }
+    sizeInBytes_ += size;
+  }
+};
+
+/// \returns the process-wide ConstantFoldingCache.
+ConstantFoldingCache &getConstantFoldingCache() {
+  static ConstantFoldingCache cache;
+  return cache;
+}
+
 /// Check if function \p F consists of constant operations only.
 LLVM_ATTRIBUTE_USED
 Error verifyConstantFunction(Backend &backend, Function &F) {
@@ -190,17 +304,25 @@ Error verifyConstantFunction(Backend &backend, Function &F) {
   return Error::success();
 }
 
+/// Perform a compile-time constant folding of the nodes \p nodes using the
+/// provided \p backend, all at once. \returns for each node the constants
+/// which are the result of its constant-folding.
+std::vector<std::vector<Constant *>>
+constantFoldNodesImpl(Backend &backend, llvm::ArrayRef<Node *> nodes) {
+  CompilationContext cctx;
+  // Do not recursively call constant folding.
+  cctx.optimizationOpts.enableConstantFolding = false;
+  cctx.backendOpts.collectConstants = true;
+  return evaluateConstantOperations(backend, cctx, nodes);
+}
+
 /// Perform a compile-time constant folding of the node \p N using the provided
 /// \p backend.
 /// \returns list of constants which are the result of the
 /// constant-folding. These constants correspond to results of the node. If no
 /// constant folding was possible an empty vector will be returned
 std::vector<Constant *> constantFoldNodeImpl(Backend &backend, Node *N) {
-  CompilationContext cctx;
-  // Do not recursively call constant folding.
-  cctx.optimizationOpts.enableConstantFolding = false;
-  cctx.backendOpts.collectConstants = true;
-  return evaluateConstantOperation(backend, cctx, N);
+  return constantFoldNodesImpl(backend, {N})[0];
 }
 
 } // namespace
@@ -234,6 +356,7 @@ bool glow::ConstantFold::run(Function *F, const CompilationContext &cctx) {
   GraphPostOrderVisitor postOrderVisitor(*F);
   auto nodes = postOrderVisitor.getPostOrder();
   // Collect all non-trivial constant operations.
+  std::vector<Node *> foldedNodes;
   for (auto *N : nodes) {
     // Skip trivial nodes/operations that do not require any constant
     // computations.
@@ -248,23 +371,50 @@ bool glow::ConstantFold::run(Function *F, const CompilationContext &cctx) {
     // one non constant-operation node, because no other bigger constant
     // operation containing the current node can completely replace the result
     // of its computation. Doing this check allows for performing a smaller
-    // number of evaluateConstantOperation calls later and thus reduces the
+    // number of evaluateConstantOperations calls later and thus reduces the
     // overhead.
     if (!hasNonConstantOperationUser(N, *backend)) {
       continue;
     }
-    // Compute the constant value of the node.
-    std::vector<Constant *> constResults = constantFoldNodeImpl(*backend, N);
+    foldedNodes.push_back(N);
+  }
+  if (foldedNodes.empty()) {
+    return false;
+  }
+
+  // Take the results that were computed already from the cache, and compute
+  // the others all at once. The cached results replace the original ones
+  // right away, as the computation runs DCE on the Module, which would remove
+  // new Constants without users.
+  auto &cache = getConstantFoldingCache();
+  const bool useCache = constantFoldingCacheSizeOpt != 0;
+  llvm::DenseMap<const Node *, llvm::hash_code> hashes;
+  std::vector<Node *> uncachedNodes;
+  for (auto *N : foldedNodes) {
+    std::vector<Tensor> cached;
+    if (!useCache || !cache.lookup(hashConstantOperation(N, hashes), cached)) {
+      uncachedNodes.push_back(N);
+      continue;
+    }
+    for (size_t idx = 0, e = cached.size(); idx < e; ++idx) {
+      auto *constResult =
+          F->getParent()->createConstant(N->getName(), std::move(cached[idx]));
+      N->getNthResult(idx).replaceAllUsesOfWith(constResult);
+    }
+  }
+  auto constResults = constantFoldNodesImpl(*backend, uncachedNodes);
+  for (size_t i = 0, e = uncachedNodes.size(); i < e; i++) {
+    Node *N = uncachedNodes[i];
+    if (useCache) {
+      cache.insert(hashConstantOperation(N, hashes), constResults[i]);
+    }
     // Replace all results of the original operation by the computed
     // compile-time results of this operation.
-    for (size_t idx = 0, e = constResults.size(); idx < e; ++idx) {
-      auto constResult = constResults[idx];
-      // Replace the old result by the new constant result.
-      N->getNthResult(idx).replaceAllUsesOfWith(constResult);
+    for (size_t idx = 0, e = constResults[i].size(); idx < e; ++idx) {
+      N->getNthResult(idx).replaceAllUsesOfWith(constResults[i][idx]);
     }
-    changed = true;
   }
-  return changed;
+  return true;
 }
 
 std::vector<Constant *> glow::constantFold(Node *N) {
@@ -31,10 +31,13 @@
 #include "glow/Quantization/Base/Base.h"
 #include "glow/Quantization/Quantization.h"
 
+#include "llvm/ADT/MapVector.h"
 #include "llvm/Support/Casting.h"
 #include "llvm/Support/CommandLine.h"
 
 #include <algorithm>
+#include <map>
+#include <tuple>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -44,7 +47,8 @@ llvm::cl::opt<unsigned> constDedupSizeOpt(
     "const_dedup_size",
     llvm::cl::desc(
         "Max number of elements allowed for deduplicating Constants"),
-    llvm::cl::Optional, llvm::cl::init(256), llvm::cl::cat(graphOptCat));
+    llvm::cl::Optional, llvm::cl::init(std::numeric_limits<unsigned>::max()),
+    llvm::cl::cat(graphOptCat));
 
 using namespace glow;
 using llvm::cast;
@@ -783,6 +787,268 @@ bool MergeMatMul::run(Function *F, const CompilationContext &cctx) {
   return changed;
 }
 
+/// \returns true if the FullyConnected \p FC can be merged with other FCs by
+/// MergeParallelFCs: it is a floating point FC of a matrix whose weights and
+/// bias are constants, so that concatenating them costs nothing at run time.
+static bool isMergeableFC(const FullyConnectedNode *FC) {
+  auto elemTy = FC->getResult().getElementType();
+  return !FC->getResult().getType()->isQuantizedType() &&
+         FC->getInput().dims().size() == 2 &&
+         FC->getWeights().getElementType() == elemTy &&
+         FC->getBias().getElementType() == elemTy &&
+         isa<Constant>(FC->getWeights()) && isa<Constant>(FC->getBias());
+}
+
+// Merge parallel fully connected layers into fewer, larger matrix
+// multiplications, which use the hardware better than many small ones.
+//
+// FCs of the same input are merged into a single FC with the concatenated
+// weights and biases, whose result is sliced back into the original results:
+//
+//       ___        ________          ___        ________________
+//      |   |      |        |        |   |      |        |       |
+//     N| X | *   K|   W1   |  ...  N| X | =   N| X * W1 |  ...  |
+//      |___|      |________|        |___|      |________|_______|
+//        K           M1                            M1
+//
+// With the groupParallelFCsIntoBatchMatMul option, FCs of different inputs
+// with the same shapes are also grouped into a BatchMatMul of the stacked
+// inputs and weights. This is only useful to backends which execute
+// BatchMatMul natively.
+bool MergeParallelFCs::run(Function *F, const CompilationContext &cctx) {
+  LOG_SCOPE(F->getLogContext(), getName());
+  // The concatenations of the weights must be folded at compile time.
+  if (!cctx.optimizationOpts.enableConstantFolding) {
+    return false;
+  }
+  bool changed = false;
+
+  // The mergeable FCs by input.
+  llvm::MapVector<std::pair<Node *, unsigned>,
+                  std::vector<FullyConnectedNode *>>
+      inputUsers;
+  for (auto &node : F->getNodes()) {
+    auto *FC = dyn_cast<FullyConnectedNode>(&node);
+    if (FC && isMergeableFC(FC)) {
+      auto input = FC->getInput();
+      inputUsers[{input.getNode(), input.getResNo()}].push_back(FC);
+    }
+  }
+
+  std::vector<FullyConnectedNode *> singleFCs;
+  for (auto &it : inputUsers) {
+    auto &FCs = it.second;
+    if (FCs.size() < 2) {
+      singleFCs.push_back(FCs[0]);
+      continue;
+    }
+    auto input = FCs[0]->getInput();
+    size_t N = input.dims()[0];
+    std::vector<NodeValue> weights;
+    std::vector<NodeValue> biases;
+    size_t numColumns = 0;
+    for (auto *FC : FCs) {
+      weights.push_back(FC->getWeights());
+      biases.push_back(FC->getBias());
+      numColumns += FC->getResult().dims()[1];
+    }
+    auto *W = F->createConcat("mergedFC.weights", weights, 1);
+    auto *B = F->createConcat("mergedFC.bias", biases, 0);
+    auto outTy = F->getParent()->uniqueTypeWithNewShape(
+        FCs[0]->getResult().getType(), {N, numColumns});
+    auto *mergedFC = F->createFullyConnected("mergedFC", input, W, B, outTy);
+
+    size_t start = 0;
+    for (auto *FC : FCs) {
+      size_t M = FC->getResult().dims()[1];
+      auto *slice = F->createSlice(FC->getName().str() + ".slice", mergedFC,
+                                   {0, start}, {N, start + M});
+      start += M;
+      FC->getResult().replaceAllUsesOfWith(slice);
+    }
+    changed = true;
+  }
+
+  if (!cctx.optimizationOpts.groupParallelFCsIntoBatchMatMul) {
+    return changed;
+  }
+
+  // Group the remaining FCs by the types of their operands.
+  llvm::MapVector<std::tuple<TypeRef, TypeRef, TypeRef>,
+                  std::vector<FullyConnectedNode *>>
+      typeUsers;
+  for (auto *FC : singleFCs) {
+    typeUsers[std::make_tuple(FC->getInput().getType(),
+                              FC->getWeights().getType(),
+                              FC->getBias().getType())]
+        .push_back(FC);
+  }
+  for (auto &it : typeUsers) {
+    // The inputs of the FCs must not depend on one another, or else we would
+    // not be able to get rid of the original FCs.
+    std::vector<NodeValue> inputs;
+    std::vector<FullyConnectedNode *> FCs;
+    for (auto *FC : it.second) {
+      if (mayDependOnAny(inputs, FC->getInput().getNode())) {
+        continue;
+      }
+      inputs.push_back(FC->getInput());
+      FCs.push_back(FC);
+    }
+    if (FCs.size() < 2) {
+      continue;
+    }
+
+    size_t G = FCs.size();
+    size_t N = FCs[0]->getInput().dims()[0];
+    size_t K = FCs[0]->getInput().dims()[1];
+    size_t M = FCs[0]->getResult().dims()[1];
+    std::vector<NodeValue> lhs;
+    std::vector<NodeValue> rhs;
+    std::vector<NodeValue> biases;
+    for (auto *FC : FCs) {
+      lhs.push_back(F->createReshape("groupedFC.input", FC->getInput(),
+                                     {1, N, K}));
+      rhs.push_back(F->createReshape("groupedFC.weights", FC->getWeights(),
+                                     {1, K, M}));
+      biases.push_back(
+          F->createReshape("groupedFC.bias", FC->getBias(), {1, 1, M}));
+    }
+    auto *BMM = F->createBatchMatMul(
+        "groupedFC", F->createConcat("groupedFC.inputs", lhs, 0),
+        F->createConcat("groupedFC.weights", rhs, 0));
+    auto *bias = F->createTile(
+        "groupedFC.bias", F->createConcat("groupedFC.bias", biases, 0), N, 1);
+    auto *add = F->createAdd("groupedFC.add", BMM, bias);
+
+    for (size_t i = 0; i < G; i++) {
+      auto *slice = F->createSlice(FCs[i]->getName().str() + ".slice", add,
+                                   {i, 0, 0}, {i + 1, N, M});
+      auto *reshape = F->createReshape(FCs[i]->getName().str() + ".reshape",
+                                       slice, {N, M});
+      FCs[i]->getResult().replaceAllUsesOfWith(reshape);
+    }
+    changed = true;
+  }
+  return changed;
+}
+
+// Group the FusedRowwiseQuantizedSparseLengthsWeightedSums of constant tables
+// with the same row size and types into a single
+// GroupedFusedRowwiseQuantizedSparseLengthsWeightedSum, which computes all
+// the tables at once. The tables are concatenated at compile time, while the
+// weights, indices and lengths are concatenated at run time. The indices of
+// each table are still relative to its first row, and may be padded, i.e.
+// the sum of its lengths may be less than the number of its indices. The
+// result of each original node is a slice of the grouped result. This saves
+// the setup of each node and balances the work of the tables between the
+// threads. The backends executing the grouped node add this pass to their
+// pipeline.
+bool GroupFusedRowwiseQuantizedSLWS::run(Function *F,
+                                         const CompilationContext &cctx) {
+  LOG_SCOPE(F->getLogContext(), getName());
+  using SLWSNode = FusedRowwiseQuantizedSparseLengthsWeightedSumNode;
+
+  // The candidate nodes by data type, row size, weights type, result type and
+  // accumulation precision.
+  using GroupKey = std::tuple<ElemKind, size_t, ElemKind, ElemKind, bool>;
+  llvm::MapVector<GroupKey, std::vector<SLWSNode *>,
+                  std::map<GroupKey, unsigned>>
+      groups;
+  for (auto &node : F->getNodes()) {
+    auto *SLWS = dyn_cast<SLWSNode>(&node);
+    if (!SLWS || !isa<Constant>(SLWS->getData())) {
+      continue;
+    }
+    auto key = std::make_tuple(
+        SLWS->getData().getElementType(), SLWS->getData().dims()[1],
+        SLWS->getWeights().getElementType(),
+        SLWS->getResult().getElementType(), SLWS->getUseFP16Accumulation());
+    groups[key].push_back(SLWS);
+  }
+
+  bool changed = false;
+  for (auto &it : groups) {
+    // The nodes must not depend on one another, or else we would not be able
+    // to get rid of the original nodes.
+    std::vector<NodeValue> results;
+    std::vector<SLWSNode *> SLWSs;
+    for (auto *SLWS : it.second) {
+      if (mayDependOnAny(results, SLWS)) {
+        continue;
+      }
+      results.push_back(SLWS->getResult());
+      SLWSs.push_back(SLWS);
+    }
+    if (SLWSs.size() < 2) {
+      continue;
+    }
+
+    // Concatenate the tables, once per table used by several nodes.
+    llvm::DenseMap<Constant *, size_t> tableRowOffsets;
+    std::vector<Constant *> tables;
+    size_t numRows = 0;
+    for (auto *SLWS : SLWSs) {
+      auto *table = cast<Constant>(SLWS->getData());
+      if (tableRowOffsets.try_emplace(table, numRows).second) {
+        tables.push_back(table);
+        numRows += table->dims()[0];
+      }
+    }
+    auto *data = F->getParent()->createConstant(
+        F->getParent()->uniqueTypeWithNewShape(
+            SLWSs[0]->getData().getType(),
+            {numRows, SLWSs[0]->getData().dims()[1]}),
+        "groupedSLWS.data");
+    char *dataPtr = data->getPayloadMutable().getUnsafePtr();
+    for (auto *table : tables) {
+      const Tensor &payload = table->getPayload();
+      std::copy(payload.getUnsafePtr(),
+                payload.getUnsafePtr() + payload.getSizeInBytes(), dataPtr);
+      dataPtr += payload.getSizeInBytes();
+    }
+
+    std::vector<NodeValue> weights;
+    std::vector<NodeValue> indices;
+    std::vector<NodeValue> lengths;
+    std::vector<size_t> rowOffsets;
+    std::vector<size_t> indexOffsets;
+    std::vector<size_t> segmentOffsets;
+    size_t numIndices = 0;
+    size_t numSegments = 0;
+    for (auto *SLWS : SLWSs) {
+      weights.push_back(SLWS->getWeights());
+      indices.push_back(SLWS->getIndices());
+      lengths.push_back(SLWS->getLengths());
+      rowOffsets.push_back(tableRowOffsets[cast<Constant>(SLWS->getData())]);
+      indexOffsets.push_back(numIndices);
+      segmentOffsets.push_back(numSegments);
+      numIndices += SLWS->getIndices().dims()[0];
+      numSegments += SLWS->getLengths().dims()[0];
+    }
+    auto outTy = F->getParent()->uniqueTypeWithNewShape(
+        SLWSs[0]->getResult().getType(),
+        {numSegments, SLWSs[0]->getResult().dims()[1]});
+    auto *grouped = F->addNode(
+        new GroupedFusedRowwiseQuantizedSparseLengthsWeightedSumNode(
+            "groupedSLWS", outTy, data,
+            F->createConcat("groupedSLWS.weights", weights, 0),
+            F->createConcat("groupedSLWS.indices", indices, 0),
+            F->createConcat("groupedSLWS.lengths", lengths, 0), rowOffsets,
+            indexOffsets, segmentOffsets, SLWSs[0]->getUseFP16Accumulation()));
+
+    for (size_t i = 0, e = SLWSs.size(); i < e; i++) {
+      auto dims = SLWSs[i]->getResult().dims();
+      auto *slice = F->createSlice(SLWSs[i]->getName().str() + ".slice",
+                                   grouped, {segmentOffsets[i], 0},
+                                   {segmentOffsets[i] + dims[0], dims[1]});
+      SLWSs[i]->getResult().replaceAllUsesOfWith(slice);
+    }
+    changed = true;
+  }
+  return changed;
+}
+
 bool MergePadIntoConvolution::run(Function *F, const CompilationContext &cctx) {
   LOG_SCOPE(F->getLogContext(), getName());
   bool changed = false;
@@ -1774,6 +2040,8 @@ struct CSEVisitor : NodeWalker {
   std::unordered_map<Node *, Node *, NodeHasher, NodeEq> cseNodes_;
   // Set of visited nodes.
   std::unordered_set<Node *> visitedNodes_;
+  /// Whether any node was replaced.
+  bool changed_{false};
 
   /// This callback is called before visiting the children of \p N.
   void pre(Node *parent, Node *N) override {
@@ -1806,6 +2074,7 @@ struct CSEVisitor : NodeWalker {
       NodeValue FV(foundN, i);
       N->getNthResult(i).replaceAllUsesOfWith(FV);
     }
+    changed_ = true;
     // TODO: Erase N during CSE? If we don't do it here,
     // DCE will remove it later anyways.
   }
@@ -1818,21 +2087,25 @@ struct CSEVisitor : NodeWalker {
 
 /// A helper type for hashing Constant pointers when they are used as keys in
 /// hash maps for deduplication. The hash is based on the type of the Constant
-/// (element type, dimensions), as well as a constant number of elements from
-/// the backing Tensor to balance collisions with hash calclulation time.
+/// (element type, dimensions), as well as a constant number of elements
+/// sampled across the whole backing Tensor, so that hashing stays cheap for
+/// large Constants while Constants that only differ past a common prefix
+/// (e.g. of zeros) rarely collide.
 struct ConstsHasherDedup {
   size_t operator()(Constant *V) const {
     auto hash = llvm::hash_value(V->getType());
     auto &T = V->getPayload();
-    // Only use the first 8 elements in the hash. It's likely that if two
-    // tensors have different content they will diverge quickly. Fall back to
-    // full equality check in ConstsEqDedup.
-    constexpr size_t maxNumEls = 8;
-    size_t numEls = std::min(T.getType().size(), maxNumEls);
-    size_t bufSize = T.getType().getElementSize() * numEls;
+    // Only use 64 elements in the hash. Fall back to full equality check in
+    // ConstsEqDedup.
+    constexpr size_t maxNumEls = 64;
+    size_t numEls = T.getType().size();
+    size_t stride = std::max<size_t>(numEls / maxNumEls, 1);
+    size_t elemSize = T.getType().getElementSize();
     auto *data = T.getUnsafePtr();
-    for (size_t i = 0; i < bufSize; i++) {
-      hash = llvm::hash_combine(hash, data[i]);
+    for (size_t i = 0; i < numEls; i += stride) {
+      hash = llvm::hash_combine(
+          hash, llvm::hash_combine_range(data + i * elemSize,
+                                         data + (i + 1) * elemSize));
     }
     return hash;
   }
@@ -1866,8 +2139,9 @@ static bool deduplicateConstants(Module *M) {
   bool changed = false;
   for (auto &C : M->getConstants()) {
     // Only perform deduplication on consts of small enough size. Otherwise
-    // just skip them. constDedupSizeOpt defaults to 256 as a heuristic, to
-    // keep compile time reasonable.
+    // just skip them. Hashing only samples the Constants and the full
+    // comparison only runs on a hash match, so constDedupSizeOpt doesn't limit
+    // the size by default.
     size_t maxNumEls = constDedupSizeOpt;
     size_t numEls = C->getType()->size();
     if (numEls > maxNumEls) {
@@ -1906,10 +2180,7 @@ bool CSE::run(Function *F, const CompilationContext &cctx) {
   for (auto &N : F->getNodes()) {
     N.visit(nullptr, &visitor);
   }
-  // TODO: Change Visitors to return whether they modified the Function they
-  // are contained in. For now conservatively set changed to true;
-  changed = true;
-  return changed;
+  return changed || visitor.changed_;
 }
 
 /// Eliminate SliceNode when the input is SplatNode.
@@ -2015,6 +2286,7 @@ bool OptimizeReshape::run(Function *F, const CompilationContext &cctx) {
     // Eliminate ReshapeNode when the input is already the correct shape.
     if (inputNode.dims() == reshapeNode->getResult().dims()) {
       reshapeNode->getResult().replaceAllUsesOfWith(inputNode);
+      changed = true;
       continue;
     }
     // Reshape(Splat(args)) -> Splat(args').
@@ -2591,35 +2863,62 @@ bool OptimizeQuantization::run(Function *F, const CompilationContext &cctx) {
   bool changed = false;
   // A worklist that contains the nodes to process.
   std::vector<Node *> worklist;
+  auto isInteresting = [](const Node *N) {
+    return isa<QuantizeNode>(N) || isa<DequantizeNode>(N) ||
+           isa<RescaleQuantizedNode>(N);
+  };
 
   // Add all of the interesting nodes to the worklist.
   for (auto &node : F->getNodes()) {
-    if (isa<QuantizeNode>(node) || isa<DequantizeNode>(node) ||
-        isa<RescaleQuantizedNode>(node)) {
+    if (isInteresting(&node)) {
       worklist.push_back(&node);
     }
   }
 
+  // Replace all uses of \p oldNV with \p newNV and revisit the interesting
+  // users, whose inputs changed, so that the pass doesn't need another run
+  // over the whole Function to optimize them.
+  auto replaceAndRevisit = [&](NodeValue oldNV, NodeValue newNV) {
+    for (auto &U : oldNV.getUsers()) {
+      if (isInteresting(U.getUser())) {
+        worklist.push_back(U.getUser());
+      }
+    }
+    oldNV.replaceAllUsesOfWith(newNV);
+  };
+
   while (!worklist.empty()) {
     // Take a node from the worklist.
     Node *node = worklist.back();
     worklist.pop_back();
 
+    // Skip the nodes whose uses were all replaced, DCE removes them.
+    if (!node->hasUsers()) {
+      continue;
+    }
+
     if (auto *Q = dyn_cast<QuantizeNode>(node)) {
       if (auto *DQ = dyn_cast<DequantizeNode>(Q->getInput())) {
         // Quantize(Dequantize(X)) -> RescaleQuantized(X)
         // If the quantization-dequantization sequence does not change the
         // type then we can simply drop them without adding a requantization
         // node.
-        changed = true;
         if (DQ->getInput().getType() == Q->getResult().getType()) {
-          Q->getResult().replaceAllUsesOfWith(DQ->getInput());
+          changed = true;
+          replaceAndRevisit(Q->getResult(), DQ->getInput());
+          continue;
+        }
+        // A rescale doesn't change the element type, e.g. of the int16
+        // activations of a node used by int8 nodes.
+        if (DQ->getInput().getElementType() !=
+            Q->getResult().getElementType()) {
           continue;
         }
 
+        changed = true;
         auto *RS = F->createRescaleQuantized(Q->getName(), DQ->getInput(),
                                              Q->getResult().getType());
-        Q->getResult().replaceAllUsesOfWith(RS);
+        replaceAndRevisit(Q->getResult(), RS);
 
         // We may be able to optimize this rescale node. Remember to visit
         // this new node and try to optimize it later.
@@ -2638,7 +2937,7 @@ bool OptimizeQuantization::run(Function *F, const CompilationContext &cctx) {
           continue;
         }
         changed = true;
-        Q->getResult().replaceAllUsesOfWith(NC);
+        replaceAndRevisit(Q->getResult(), NC);
         continue;
       }
 
@@ -2647,7 +2946,7 @@ bool OptimizeQuantization::run(Function *F, const CompilationContext &cctx) {
         changed = true;
         SplatNode *newSN = F->createSplat(
             SN->getName(), Q->getResult().getType(), SN->getValue());
-        Q->getResult().replaceAllUsesOfWith(newSN);
+        replaceAndRevisit(Q->getResult(), newSN);
         continue;
       }
     }
@@ -2656,7 +2955,7 @@ bool OptimizeQuantization::run(Function *F, const CompilationContext &cctx) {
       if (auto *Q = dyn_cast<QuantizeNode>(DQ->getInput())) {
         // Dequantize(Quantize(X)) -> X
         changed = true;
-        DQ->getResult().replaceAllUsesOfWith(Q->getInput());
+        replaceAndRevisit(DQ->getResult(), Q->getInput());
         continue;
       }
       // Fold the rescale into the following Dequantize.
@@ -2664,7 +2963,7 @@ bool OptimizeQuantization::run(Function *F, const CompilationContext &cctx) {
       if (auto *RS = dyn_cast<RescaleQuantizedNode>(DQ->getInput())) {
         changed = true;
         auto *newRS = F->createDequantize(DQ->getName(), RS->getInput());
-        DQ->getResult().replaceAllUsesOfWith(newRS);
+        replaceAndRevisit(DQ->getResult(), newRS);
 
         // We may be able to optimize this rescale node. Remember to visit
         // this new node and try to optimize it later.
@@ -2676,7 +2975,7 @@ bool OptimizeQuantization::run(Function *F, const CompilationContext &cctx) {
         changed = true;
         SplatNode *newSN = F->createSplat(
             SN->getName(), DQ->getResult().getType(), SN->getValue());
-        DQ->getResult().replaceAllUsesOfWith(newSN);
+        replaceAndRevisit(DQ->getResult(), newSN);
         continue;
       }
     }
@@ -2685,7 +2984,7 @@ bool OptimizeQuantization::run(Function *F, const CompilationContext &cctx) {
       if (RS->getInput().getType() == RS->getResult().getType()) {
         // If rescale does not change the type, then simply drop it.
         changed = true;
-        RS->getResult().replaceAllUsesOfWith(RS->getInput());
+        replaceAndRevisit(RS->getResult(), RS->getInput());
         continue;
       }
 
@@ -2717,7 +3016,7 @@ bool OptimizeQuantization::run(Function *F, const CompilationContext &cctx) {
         changed = true;
         Node *newNode =
             cloneNodeWithNewTypes(F, RS->getInput(), RS->getResult().getType());
-        RS->getResult().replaceAllUsesOfWith(newNode);
+        replaceAndRevisit(RS->getResult(), newNode);
         if (addNewNodeToWorklist) {
           worklist.push_back(newNode);
         }
@@ -2741,7 +3040,7 @@ bool OptimizeQuantization::run(Function *F, const CompilationContext &cctx) {
         auto *newMN = F->createMax(MN->getName(), L, R);
         worklist.push_back(L);
         worklist.push_back(R);
-        RS->getResult().replaceAllUsesOfWith(newMN);
+        replaceAndRevisit(RS->getResult(), newMN);
         continue;
       }
     } // Handle RescaleQuantizedNode
@@ -2846,6 +3145,245 @@ bool FoldLeakyRelu::run(Function *F, const CompilationContext &cctx) {
   return changed;
 }
 
+/// \returns \p V without the Reshape nodes that produce it.
+static NodeValue skipReshapes(NodeValue V) {
+  while (auto *RN = dyn_cast<ReshapeNode>(V)) {
+    V = RN->getInput();
+  }
+  return V;
+}
+
+/// \returns the value that \p V broadcasts to the shape \p dims, as
+/// createBroadcast does, or an empty NodeValue if \p V isn't such a broadcast.
+/// The value only varies along the axes of \p dims in [\p begin, \p end),
+/// it is repeated by Tile nodes along the others.
+static NodeValue getBroadcastSource(NodeValue V, llvm::ArrayRef<size_t> dims,
+                                    size_t begin, size_t end) {
+  if (V.dims() != dims) {
+    return NodeValue();
+  }
+  while (auto *TN = dyn_cast<TileNode>(V)) {
+    if (TN->getAxis() >= begin && TN->getAxis() < end) {
+      return NodeValue();
+    }
+    V = TN->getInput();
+  }
+  for (size_t i = 0, e = dims.size(); i < e; i++) {
+    if (V.dims()[i] != (i >= begin && i < end ? dims[i] : 1)) {
+      return NodeValue();
+    }
+  }
+  return skipReshapes(V);
+}
+
+/// \returns if \p V is a float scalar, broadcast or not, and sets \p value to
+/// it.
+static bool getBroadcastFloatScalar(NodeValue V, float *value) {
+  while (auto *TN = dyn_cast<TileNode>(V)) {
+    V = TN->getInput();
+  }
+  return getFloatScalar(skipReshapes(V), value);
+}
+
+/// \returns if \p V squares \p D, as a Mul or as a Pow node.
+static bool isSquareOf(NodeValue V, NodeValue D) {
+  if (auto *MN = dyn_cast<MulNode>(V)) {
+    return MN->getLHS() == D && MN->getRHS() == D;
+  }
+  float exponent;
+  if (auto *PN = dyn_cast<PowNode>(V)) {
+    return PN->getLHS() == D &&
+           getBroadcastFloatScalar(PN->getRHS(), &exponent) && exponent == 2;
+  }
+  return false;
+}
+
+bool FoldLayerNormalization::run(Function *F, const CompilationContext &cctx) {
+  LOG_SCOPE(F->getLogContext(), getName());
+  bool changed = false;
+  auto &nodes = F->getNodes();
+  for (auto &node : nodes) {
+    // Look for (X - mean(X)) / sqrt(mean((X - mean(X))^2) + epsilon), whose
+    // means are reduced over the trailing dimensions of X from axis.
+    auto *DN = dyn_cast<DivNode>(&node);
+    if (!DN) {
+      continue;
+    }
+    auto *SN = dyn_cast<SubNode>(DN->getLHS());
+    if (!SN) {
+      continue;
+    }
+    NodeValue in = SN->getLHS();
+    auto dims = in.dims();
+    if (in.getElementType() != ElemKind::FloatTy &&
+        in.getElementType() != ElemKind::Float16Ty) {
+      continue;
+    }
+    NodeValue meanB = SN->getRHS();
+    while (auto *TN = dyn_cast<TileNode>(meanB)) {
+      meanB = TN->getInput();
+    }
+    auto *mean = dyn_cast<BatchedReduceMeanNode>(skipReshapes(meanB));
+    if (!mean || mean->getBatch() != in || mean->getAxes().empty()) {
+      continue;
+    }
+    auto axes = mean->getAxes();
+    const size_t axis = dims.size() - axes.size();
+    bool trailing = true;
+    for (size_t i = 0, e = axes.size(); i < e; i++) {
+      trailing &= axes[i] == axis + i;
+    }
+    if (!trailing ||
+        getBroadcastSource(SN->getRHS(), dims, 0, axis) != mean->getResult()) {
+      continue;
+    }
+
+    auto *stdDev = llvm::dyn_cast_or_null<PowNode>(
+        getBroadcastSource(DN->getRHS(), dims, 0, axis).getNode());
+    float exponent;
+    if (!stdDev || !getBroadcastFloatScalar(stdDev->getRHS(), &exponent) ||
+        exponent != 0.5f) {
+      continue;
+    }
+    auto *AN = dyn_cast<AddNode>(skipReshapes(stdDev->getLHS()));
+    if (!AN) {
+      continue;
+    }
+    float epsilon;
+    NodeValue varB;
+    if (getBroadcastFloatScalar(AN->getRHS(), &epsilon)) {
+      varB = AN->getLHS();
+    } else if (getBroadcastFloatScalar(AN->getLHS(), &epsilon)) {
+      varB = AN->getRHS();
+    } else {
+      continue;
+    }
+    auto *var = dyn_cast<BatchedReduceMeanNode>(skipReshapes(varB));
+    if (!var || var->getAxes() != axes ||
+        !isSquareOf(var->getBatch(), SN->getResult())) {
+      continue;
+    }
+
+    // Take the Mul by the scale and the Add of the bias that follow, if they
+    // are broadcast along the normalized dimensions.
+    auto normDims = dims.slice(axis);
+    NodeValue result = DN->getResult();
+    NodeValue scale;
+    NodeValue bias;
+    auto takeUser = [&](NodeValue *param, Kinded::Kind kind) {
+      if (!result.hasOneUse()) {
+        return;
+      }
+      Node *user = (*result.getUsers().begin()).getUser();
+      if (user->getKind() != kind) {
+        return;
+      }
+      NodeValue other = user->getNthInput(0) == result ? user->getNthInput(1)
+                                                       : user->getNthInput(0);
+      NodeValue source = getBroadcastSource(other, dims, axis, dims.size());
+      if (source.getNode() && source.getElementType() == in.getElementType()) {
+        *param =
+            F->createReshape(source.getNode()->getName(), source, normDims);
+        result = user->getNthResult(0);
+      }
+    };
+    takeUser(&scale, Kinded::Kind::MulNodeKind);
+    takeUser(&bias, Kinded::Kind::AddNodeKind);
+    auto normTy =
+        F->getParent()->uniqueTypeWithNewShape(in.getType(), normDims);
+    if (!scale.getNode()) {
+      scale = F->createSplat(DN->getName().str() + ".scale", normTy, 1);
+    }
+    if (!bias.getNode()) {
+      bias = F->createSplat(DN->getName().str() + ".bias", normTy, 0);
+    }
+
+    auto *LN =
+        F->createLayerNormalization(DN->getName(), in, scale, bias, epsilon);
+    result.replaceAllUsesOfWith(LN);
+    changed = true;
+  }
+  return changed;
+}
+
+/// \returns if \p C holds the indices of the pairs i > j of a {N, N} matrix
+/// flattened, by i and then by j, as Int32 or Int64.
+static bool isLowerTriangleIndices(const Constant *C, size_t N) {
+  const Tensor &T = C->getPayload();
+  if (T.dims().size() != 1 || T.size() != N * (N - 1) / 2) {
+    return false;
+  }
+  auto getIndex = [&T](size_t k) -> int64_t {
+    if (T.getElementType() == ElemKind::Int64ITy) {
+      return T.getHandle<int64_t>().raw(k);
+    }
+    return T.getHandle<int32_t>().raw(k);
+  };
+  size_t k = 0;
+  for (size_t i = 1; i < N; i++) {
+    for (size_t j = 0; j < i; j++) {
+      if (getIndex(k++) != int64_t(i * N + j)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+bool FoldPairwiseDotProducts::run(Function *F,
+                                  const CompilationContext &cctx) {
+  LOG_SCOPE(F->getLogContext(), getName());
+  bool changed = false;
+  auto &nodes = F->getNodes();
+  for (auto &node : nodes) {
+    // Look for the lower triangle of BatchMatMul(X, X^T) gathered from its
+    // flattened {B, N * N} products, where X = {B, N, D} stacks N {B, D}
+    // inputs concatenated along their second dimension.
+    auto *GN = dyn_cast<GatherNode>(&node);
+    if (!GN || GN->getBatchDims() != 1 || GN->getData().dims().size() != 2) {
+      continue;
+    }
+    auto *BMM = dyn_cast<BatchMatMulNode>(skipReshapes(GN->getData()));
+    if (!BMM) {
+      continue;
+    }
+    NodeValue X = BMM->getLHS();
+    auto *TN = dyn_cast<TransposeNode>(BMM->getRHS());
+    if (!TN || !TN->getShuffle().equals({0, 2, 1}) ||
+        TN->getInput().dims() != X.dims() ||
+        skipReshapes(TN->getInput()) != skipReshapes(X)) {
+      continue;
+    }
+    auto *CN = dyn_cast<ConcatNode>(skipReshapes(X));
+    if (!CN || CN->getDim() != 1) {
+      continue;
+    }
+    const size_t batchSize = X.dims()[0];
+    const size_t numInputs = X.dims()[1];
+    const size_t vectorSize = X.dims()[2];
+    auto inputs = CN->getInputs();
+    bool stacked = numInputs >= 2 && inputs.size() == numInputs &&
+                   GN->getData().dims()[1] == numInputs * numInputs &&
+                   (X.getElementType() == ElemKind::FloatTy ||
+                    X.getElementType() == ElemKind::Float16Ty);
+    for (const auto &input : inputs) {
+      stacked &= input.dims().equals({batchSize, vectorSize});
+    }
+    auto *indices = dyn_cast<Constant>(GN->getIndices());
+    if (!stacked || !indices || !isLowerTriangleIndices(indices, numInputs)) {
+      continue;
+    }
+
+    // The fused node reads the inputs instead of their concatenation, and
+    // only computes the products that are gathered.
+    std::vector<NodeValue> pairInputs(inputs.begin(), inputs.end());
+    auto *BPDP = F->createBatchedPairwiseDotProduct(GN->getName(), pairInputs);
+    GN->getResult().replaceAllUsesOfWith(BPDP);
+    changed = true;
+  }
+  return changed;
+}
+
 /// Parameters that are used to define ChannelShuffle operators.
 struct ChannelShuffleParams {
   size_t group;
@@ -3012,8 +3550,10 @@ void glow::fold(Function *F, CompilationMode mode) {
 void glow::optimize(Function *F, CompilationContext &cctx, const Backend &B) {
   LOG_SCOPE(F->getLogContext(), "glow::optimize")
 
+  const auto &pipeline = cctx.optimizationOpts.graphOptimizationPipeline;
   FunctionPassManager FPM("TargetDependentGraphOptzFPM",
-                          B.getOptimizationPipeline(), &B);
+                          pipeline ? *pipeline : B.getOptimizationPipeline(),
+                          &B);
   FPM.run(F, cctx);
 }
 
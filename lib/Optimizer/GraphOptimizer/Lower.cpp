@@ -418,6 +418,91 @@ static void lowerBatchNormalizationNode(Function *F, CompilationContext &cctx,
   replaceAllUsesOfWith(cctx.loweredInfoMap, BN.getResult(), newResult);
 }
 
+static void lowerLayerNormalizationNode(Function *F, CompilationContext &cctx,
+                                        const LayerNormalizationNode &LN) {
+  LOG_SCOPE(F->getLogContext(), "lowerLayerNormalizationNode")
+
+  auto name = LN.getName().str();
+  auto in = LN.getInput();
+  auto scale = LN.getScale();
+  auto bias = LN.getBias();
+
+  // Normalize the rows of the input seen as a {outer, inner} matrix, whose
+  // inner dimension holds the normalized trailing dimensions:
+  // y = (x - mean(x)) / sqrt(mean((x - mean(x))^2) + epsilon) * scale + bias
+  const size_t inner = scale.getType()->size();
+  const size_t outer = in.getType()->size() / inner;
+  auto *in2D = F->createReshape(name + ".in2D", in, {outer, inner});
+
+  auto *mean = F->createBatchedReduceMean(name + ".mean", in2D, {1});
+  auto *meanB = F->createBroadcast(name + ".meanBroadcasted", mean,
+                                   in2D->getResult().dims(), /* axis */ 0);
+  auto *diff = F->createSub(name + ".diff", in2D, meanB);
+  auto *diffSq = F->createMul(name + ".diffSq", diff, diff);
+  auto *var = F->createBatchedReduceMean(name + ".var", diffSq, {1});
+
+  auto *epsilonSplat = F->createSplat(
+      name + ".epsSplat", var->getResult().getType(), LN.getEpsilon());
+  Node *stdDev = F->createAdd(name + ".varPlusEps", var, epsilonSplat);
+  stdDev = F->createPow(name + ".stdDev", stdDev, 0.5);
+  auto *stdDevB = F->createBroadcast(name + ".stdDevBroadcasted", stdDev,
+                                     in2D->getResult().dims(), /* axis */ 0);
+  Node *newResult = F->createDiv(name + ".normalized", diff, stdDevB);
+
+  auto *scale1D = F->createReshape(name + ".scale", scale, {inner});
+  auto *bias1D = F->createReshape(name + ".bias", bias, {inner});
+  auto *scaleB = F->createBroadcast(name + ".scaleBroadcasted", scale1D,
+                                    in2D->getResult().dims(), /* axis */ 1);
+  auto *biasB = F->createBroadcast(name + ".biasBroadcasted", bias1D,
+                                   in2D->getResult().dims(), /* axis */ 1);
+  newResult = F->createMul(name + ".scaled", newResult, scaleB);
+  newResult = F->createAdd(name + ".shifted", newResult, biasB);
+  newResult = F->createReshape(name + ".result", newResult, in.dims());
+
+  replaceAllUsesOfWith(cctx.loweredInfoMap, LN.getResult(), newResult);
+}
+
+static void lowerBatchedPairwiseDotProductNode(
+    Function *F, CompilationContext &cctx,
+    const BatchedPairwiseDotProductNode &BPDP) {
+  LOG_SCOPE(F->getLogContext(), "lowerBatchedPairwiseDotProductNode")
+
+  auto name = BPDP.getName().str();
+  std::vector<NodeValue> inputs(BPDP.getInputs().begin(),
+                                BPDP.getInputs().end());
+  const size_t batchSize = inputs[0].dims()[0];
+  const size_t vectorSize = inputs[0].dims()[1];
+  const size_t numInputs = inputs.size();
+  const size_t numPairs = BPDP.getResult().dims()[1];
+
+  // Stack the inputs into X = {B, N, D}, multiply X by its transpose and
+  // gather the products of the pairs i > j of every batch from the {N, N}
+  // matrix of products.
+  auto *concat = F->createConcat(name + ".concat", inputs, 1);
+  auto *stacked = F->createReshape(name + ".stacked", concat,
+                                   {batchSize, numInputs, vectorSize});
+  auto *transposed =
+      F->createTranspose(name + ".transposed", stacked, {0, 2, 1});
+  auto *products =
+      F->createBatchMatMul(name + ".products", stacked, transposed);
+  auto *flat = F->createReshape(name + ".flat", products,
+                                {batchSize, numInputs * numInputs});
+
+  auto *indices = F->getParent()->createConstant(ElemKind::Int64ITy,
+                                                 {numPairs}, name + ".pairs");
+  auto indicesH = indices->getPayloadMutable().getHandle<int64_t>();
+  size_t k = 0;
+  for (size_t i = 1; i < numInputs; i++) {
+    for (size_t j = 0; j < i; j++) {
+      indicesH.raw(k++) = i * numInputs + j;
+    }
+  }
+  auto *result =
+      F->createGather(name + ".result", flat, indices, /* batchDims */ 1);
+
+  replaceAllUsesOfWith(cctx.loweredInfoMap, BPDP.getResult(), result);
+}
+
 static void lowerMeanVarNormalizationNode(Function *F, CompilationContext &cctx,
                                           const MeanVarNormalizationNode &MVN) {
   LOG_SCOPE(F->getLogContext(), "lowerMeanVarNormalizationNode")
@@ -708,14 +793,9 @@ static void lowerChannelwiseQuantizedConvolutionNode(
   // ChannelwiseQuantizedConvolutionNode can be represented as a Concatenation
   // of smaller dimension quantized Convolutions each with their own qparams.
   // Input channels will be divided into equal groups of consecutive channels.
-  // These will be separately convolved each with its own filter and bias.
-  // This will result in 4 * Group + 1 nodes.
-
-  // Only lowering of groupwise, not channelwise is supported so far.
-  if (!CQC.getGroupwise()) {
-    return;
-  }
-
+  // These will be separately convolved each with its own filter and bias: the
+  // filter of every group when the qparams are groupwise, or of every output
+  // channel otherwise. This will result in 4 * qparams + 1 nodes.
   llvm::ArrayRef<unsigned_t> kernels = CQC.getKernels();
   llvm::ArrayRef<unsigned_t> pads = CQC.getPads();
   llvm::ArrayRef<unsigned_t> strides = CQC.getStrides();
@@ -731,12 +811,15 @@ static void lowerChannelwiseQuantizedConvolutionNode(
   ShapeHW kdim(kernels);
   unsigned inCperG = idim.c / group;
   unsigned outCperG = filter->dims()[0] / group;
+  // The number of output channels of every Convolution.
+  unsigned outCperQ = CQC.getGroupwise() ? outCperG : 1;
+  unsigned numQParams = filter->dims()[0] / outCperQ;
 
   auto convOutDims = CQC.getResult().dims().vec();
-  convOutDims[3] = outCperG;
+  convOutDims[3] = outCperQ;
 
   auto filterDims = filter->dims().vec();
-  filterDims[0] = outCperG;
+  filterDims[0] = outCperQ;
   filterDims[3] = inCperG;
 
   // Final output type of each convolution after rescaling
@@ -749,9 +832,10 @@ static void lowerChannelwiseQuantizedConvolutionNode(
   Module *M = F->getParent();
 
   std::vector<NodeValue> branches;
-  for (unsigned_t groupId = 0; groupId < group; groupId++) {
-    float filterScale = scalesHandle.raw(groupId);
-    int32_t filterOffset = offsetsHandle.raw(groupId);
+  for (unsigned_t qId = 0; qId < numQParams; qId++) {
+    float filterScale = scalesHandle.raw(qId);
+    int32_t filterOffset = offsetsHandle.raw(qId);
+    unsigned_t groupId = qId * outCperQ / outCperG;
 
     SliceNode *inSlice =
         F->createSlice(CQC.getName(), in, {0, 0, 0, groupId * inCperG},
@@ -759,7 +843,7 @@ static void lowerChannelwiseQuantizedConvolutionNode(
 
     // Create quantized filter sliced Constant.
     Tensor slicedFilterTensor = filter->getPayload().getOwnedSlice(
-        filterDims, {outCperG * groupId, 0, 0, 0});
+        filterDims, {outCperQ * qId, 0, 0, 0});
     auto quantizedFilterType = slicedFilterTensor.getType();
     quantizedFilterType.scale_ = filterScale;
     quantizedFilterType.offset_ = filterOffset;
@@ -774,7 +858,7 @@ static void lowerChannelwiseQuantizedConvolutionNode(
     tqp.offset = 0;
     tqp.scale = inSlice->getInput().getType()->getScale() * filterScale;
     Tensor slicedBiasTensor =
-        bias->getPayload().getOwnedSlice({outCperG}, {outCperG * groupId});
+        bias->getPayload().getOwnedSlice({outCperQ}, {outCperQ * qId});
     Tensor quantizedSlicedBiasTensor =
         quantization::quantizeTensor(slicedBiasTensor, tqp, ElemKind::Int32QTy);
     Constant *slicedBias =
@@ -1021,6 +1105,49 @@ static void lowerFusedRowwiseQuantizedSparseLengthsSumNode(
   replaceAllUsesOfWith(cctx.loweredInfoMap, FRQSLSN.getResult(), FRQSLWSN);
 }
 
+/// Replace \p mean, the means of the segments given by \p lengths, by
+/// \p sum, their sums, divided by their lengths. Empty segments stay zero.
+static void lowerSparseLengthsMean(Function *F, CompilationContext &cctx,
+                                   NodeValue mean, NodeValue sum,
+                                   NodeValue lengths) {
+  auto name = mean.getNode()->getName().str();
+  auto *lengthsFP =
+      F->createConvertTo(name + ".lengths", lengths, sum.getElementType());
+  auto *ones =
+      F->createSplat(name + ".ones", lengthsFP->getResult().getType(), 1.0);
+  auto *divisors = F->createMax(name + ".divisors", lengthsFP, ones);
+  auto *divisorsB = F->createBroadcast(name + ".divisorsBroadcasted",
+                                       divisors, sum.dims(), /* axis */ 0);
+  auto *result = F->createDiv(name + ".result", sum, divisorsB);
+
+  replaceAllUsesOfWith(cctx.loweredInfoMap, mean, result);
+}
+
+static void lowerSparseLengthsMeanNode(Function *F, CompilationContext &cctx,
+                                       const SparseLengthsMeanNode &SLMN) {
+  LOG_SCOPE(F->getLogContext(), "lowerSparseLengthsMeanNode")
+
+  auto *SLSN = F->createSparseLengthsSum(SLMN.getName().str() + ".sum",
+                                         SLMN.getData(), SLMN.getIndices(),
+                                         SLMN.getLengths());
+  lowerSparseLengthsMean(F, cctx, SLMN.getResult(), SLSN->getResult(),
+                         SLMN.getLengths());
+}
+
+static void lowerFusedRowwiseQuantizedSparseLengthsMeanNode(
+    Function *F, CompilationContext &cctx,
+    const FusedRowwiseQuantizedSparseLengthsMeanNode &FRQSLMN) {
+  LOG_SCOPE(F->getLogContext(),
+            "lowerFusedRowwiseQuantizedSparseLengthsMeanNode")
+
+  auto *FRQSLSN = F->addNode(new FusedRowwiseQuantizedSparseLengthsSumNode(
+      FRQSLMN.getName().str() + ".sum", FRQSLMN.getResult().getType(),
+      FRQSLMN.getData(), FRQSLMN.getIndices(), FRQSLMN.getLengths(),
+      FRQSLMN.getUseFP16Accumulation()));
+  lowerSparseLengthsMean(F, cctx, FRQSLMN.getResult(), FRQSLSN->getResult(),
+                         FRQSLMN.getLengths());
+}
+
 static void lowerBatchBoxCoxNode(Function *F, CompilationContext &cctx,
                                  const BatchBoxCoxNode &BBCN) {
   auto name = BBCN.getName();
@@ -1100,6 +1227,102 @@ static void lowerClipNode(Function *F, CompilationContext &cctx,
   replaceAllUsesOfWith(cctx.loweredInfoMap, CN.getResult(), result);
 }
 
+/// Slices the activations of the four gates of the LSTMUnit pre-activations
+/// \p gates, of the type \p cellTy each, into \p i, \p f, \p o and \p g.
+static void createLSTMGates(Function *F, llvm::StringRef name, NodeValue gates,
+                            TypeRef cellTy, NodeValue &i, NodeValue &f,
+                            NodeValue &o, NodeValue &g) {
+  size_t hiddenSize = cellTy->dims()[1];
+  auto gate = [&](const char *gateName, size_t index) -> NodeValue {
+    return F->createSlice(name.str() + "." + gateName, gates,
+                          {0, index * hiddenSize}, cellTy);
+  };
+  i = F->createSigmoid(name.str() + ".i", gate("i.slice", 0));
+  f = F->createSigmoid(name.str() + ".f", gate("f.slice", 1));
+  o = F->createSigmoid(name.str() + ".o", gate("o.slice", 2));
+  g = F->createTanh(name.str() + ".g", gate("g.slice", 3));
+}
+
+static void lowerLSTMUnitNode(Function *F, CompilationContext &cctx,
+                              const LSTMUnitNode &LU) {
+  // Cell = f * prevCell + i * g, Hidden = o * tanh(Cell), where i, f and o
+  // are the sigmoids of the input, forget and output gates and g the tanh of
+  // the candidate cell.
+
+  LOG_SCOPE(F->getLogContext(), "lowerLSTMUnitNode")
+
+  auto name = LU.getName();
+  NodeValue i, f, o, g;
+  createLSTMGates(F, name, LU.getGates(), LU.getPrevCell().getType(), i, f, o,
+                  g);
+  auto *fc = F->createMul(name.str() + ".fc", f, LU.getPrevCell());
+  auto *ig = F->createMul(name.str() + ".ig", i, g);
+  auto *cell = F->createAdd(name.str() + ".cell", fc, ig);
+  auto *hidden = F->createMul(name.str() + ".hidden", o,
+                              F->createTanh(name.str() + ".tanh", cell));
+  replaceAllUsesOfWith(cctx.loweredInfoMap, LU.getCell(), cell);
+  replaceAllUsesOfWith(cctx.loweredInfoMap, LU.getHidden(), hidden);
+}
+
+static void lowerLSTMUnitGradNode(Function *F, CompilationContext &cctx,
+                                  const LSTMUnitGradNode &LUG) {
+  // With t = tanh(Cell), the gradient of the cell state is
+  //   dCell = cellG + hiddenG * o * (1 - t * t)
+  // and the gradients of the pre-activations are
+  //   di = dCell * g * i * (1 - i)
+  //   df = dCell * prevCell * f * (1 - f)
+  //   do = hiddenG * t * o * (1 - o)
+  //   dg = dCell * i * (1 - g * g)
+  // while the gradient of prevCell is dCell * f. The gates are recomputed
+  // from the pre-activations.
+
+  LOG_SCOPE(F->getLogContext(), "lowerLSTMUnitGradNode")
+
+  auto name = LUG.getName();
+  TypeRef cellTy = LUG.getPrevCell().getType();
+  NodeValue i, f, o, g;
+  createLSTMGates(F, name, LUG.getGates(), cellTy, i, f, o, g);
+  NodeValue hiddenG = LUG.getGradOfOriginalOutputNamedHidden();
+  NodeValue cellG = LUG.getGradOfOriginalOutputNamedCell();
+
+  auto *one = F->createSplat(name.str() + ".one", cellTy, 1.0);
+  // \returns x * (1 - x).
+  auto sigmoidGrad = [&](const char *gateName, NodeValue x) -> NodeValue {
+    return F->createMul(name.str() + "." + gateName + ".grad", x,
+                        F->createSub(name.str() + ".one.sub", one, x));
+  };
+  // \returns 1 - x * x.
+  auto tanhGrad = [&](NodeValue x) -> NodeValue {
+    return F->createSub(name.str() + ".one.sub", one,
+                        F->createMul(name.str() + ".sq", x, x));
+  };
+
+  auto *t = F->createTanh(name.str() + ".tanh", LUG.getOriginalOutputForCell());
+  auto *dCell = F->createAdd(
+      name.str() + ".dcell", cellG,
+      F->createMul(name.str() + ".dcell.hidden", hiddenG,
+                   F->createMul(name.str() + ".dtanh", o, tanhGrad(t))));
+  auto *di = F->createMul(name.str() + ".di",
+                          F->createMul(name.str() + ".dig", dCell, g),
+                          sigmoidGrad("i", i));
+  auto *df =
+      F->createMul(name.str() + ".df",
+                   F->createMul(name.str() + ".dfc", dCell, LUG.getPrevCell()),
+                   sigmoidGrad("f", f));
+  auto *dO = F->createMul(name.str() + ".do",
+                          F->createMul(name.str() + ".doh", hiddenG, t),
+                          sigmoidGrad("o", o));
+  auto *dg = F->createMul(name.str() + ".dg",
+                          F->createMul(name.str() + ".dgi", dCell, i),
+                          tanhGrad(g));
+  auto *gatesG = F->createConcat(name.str() + ".dgates", {di, df, dO, dg}, 1);
+  auto *prevCellG = F->createMul(name.str() + ".dprevcell", dCell, f);
+  replaceAllUsesOfWith(cctx.loweredInfoMap, LUG.getGradOfInputNamedGates(),
+                       gatesG);
+  replaceAllUsesOfWith(cctx.loweredInfoMap, LUG.getGradOfInputNamedPrevCell(),
+                       prevCellG);
+}
+
 /// Lowers \p node given Function \p. \p cctx contains a mapping of loweredMap
 /// that will log the lowering info of what was replaced by what via output
 /// names.
@@ -1136,6 +1359,10 @@ static void lowerNode(Function *F, Node *node, CompilationContext &cctx) {
     lowerSGDNode(F, cctx, *SGD);
   } else if (auto *BN = dyn_cast<BatchNormalizationNode>(node)) {
     lowerBatchNormalizationNode(F, cctx, *BN);
+  } else if (auto *LN = dyn_cast<LayerNormalizationNode>(node)) {
+    lowerLayerNormalizationNode(F, cctx, *LN);
+  } else if (auto *BPDP = dyn_cast<BatchedPairwiseDotProductNode>(node)) {
+    lowerBatchedPairwiseDotProductNode(F, cctx, *BPDP);
   } else if (auto *MVN = dyn_cast<MeanVarNormalizationNode>(node)) {
     lowerMeanVarNormalizationNode(F, cctx, *MVN);
   } else if (auto *BNG = dyn_cast<BatchNormalizationGradNode>(node)) {
@@ -1158,6 +1385,10 @@ static void lowerNode(Function *F, Node *node, CompilationContext &cctx) {
     lowerChannelShuffleNode(F, cctx, *CSN);
   } else if (auto *RN = dyn_cast<ReplaceNaNNode>(node)) {
     lowerReplaceNaNNode(F, cctx, *RN);
+  } else if (auto *LU = dyn_cast<LSTMUnitNode>(node)) {
+    lowerLSTMUnitNode(F, cctx, *LU);
+  } else if (auto *LUG = dyn_cast<LSTMUnitGradNode>(node)) {
+    lowerLSTMUnitGradNode(F, cctx, *LUG);
   } else if (auto *BMMN = dyn_cast<BatchMatMulNode>(node)) {
     lowerBatchMatMulNode(F, cctx, *BMMN);
   } else if (auto *SLSN = dyn_cast<SparseLengthsSumNode>(node)) {
@@ -1165,6 +1396,11 @@ static void lowerNode(Function *F, Node *node, CompilationContext &cctx) {
   } else if (auto *FQSLSN =
                  dyn_cast<FusedRowwiseQuantizedSparseLengthsSumNode>(node)) {
     lowerFusedRowwiseQuantizedSparseLengthsSumNode(F, cctx, *FQSLSN);
+  } else if (auto *SLMN = dyn_cast<SparseLengthsMeanNode>(node)) {
+    lowerSparseLengthsMeanNode(F, cctx, *SLMN);
+  } else if (auto *FQSLMN =
+                 dyn_cast<FusedRowwiseQuantizedSparseLengthsMeanNode>(node)) {
+    lowerFusedRowwiseQuantizedSparseLengthsMeanNode(F, cctx, *FQSLMN);
   } else if (auto *BBCN = dyn_cast<BatchBoxCoxNode>(node)) {
     lowerBatchBoxCoxNode(F, cctx, *BBCN);
   } else if (auto *CN = dyn_cast<ClipNode>(node)) {
@@ -1188,9 +1424,12 @@ void glow::lower(Function *F, CompilationContext &cctx, const Backend *B,
     lowerNode(F, &N, cctx);
   }
 
+  // The lowered SGD nodes have side effects, so DCE doesn't remove them. The
+  // ones that the backend doesn't lower are left to it.
   for (auto it = F->getNodes().begin(), e = F->getNodes().end(); it != e;) {
     auto cur = &*(it++);
-    if (dyn_cast<SGDNode>(cur)) {
+    if (dyn_cast<SGDNode>(cur) && (!B || B->shouldLower(cur)) &&
+        !doNotLowerKinds.count(cur->getKind())) {
       F->eraseNode(cur);
     }
   }
@@ -16,8 +16,10 @@
 
 #include "glow/Optimizer/GraphOptimizer/PassManager.h"
 
+#include "glow/ExecutionContext/TraceEvents.h"
 #include "glow/Graph/Graph.h"
 #include "glow/Optimizer/GraphOptimizer/FunctionPasses.h"
+#include "glow/Runtime/StatsExporter.h"
 
 #include "llvm/Support/CommandLine.h"
 
@@ -94,6 +96,12 @@ llvm::cl::opt<unsigned> stopAfterPassNumOpt(
     llvm::cl::init(std::numeric_limits<unsigned>::max()),
     llvm::cl::cat(passManagerCat));
 
+llvm::cl::opt<bool> rerunUnchangedPassesOpt(
+    "rerun-unchanged-passes",
+    llvm::cl::desc("Run passes again even if the Function was not changed "
+                   "since they last found nothing to change."),
+    llvm::cl::Optional, llvm::cl::cat(passManagerCat));
+
 /// Helper to check if \p otherStr is in \p strList.
 static bool listContainsString(llvm::ArrayRef<std::string> strList,
                                llvm::StringRef otherStr) {
@@ -108,6 +116,28 @@ static bool listContainsString(llvm::ArrayRef<std::string> strList,
 /// Global pass counter used to identify each pass.
 static std::atomic<unsigned> globalPassCounter{0};
 
+/// \returns the bytes of the constants of \p mod.
+static int64_t getConstantBytes(const Module &mod) {
+  int64_t bytes = 0;
+  for (const auto *C : mod.getConstants()) {
+    bytes += C->getType()->getSizeInBytes();
+  }
+  return bytes;
+}
+
+/// Adds \p stats of the pass \p passName to the stats of the registered
+/// StatsExporters, as "glow.compile.pass.<passName>.<stat>".
+static void exportPassStats(llvm::StringRef passName,
+                            const FunctionPassStats &stats) {
+  std::string prefix = ("glow.compile.pass." + passName + ".").str();
+  Stats()->addTimeSeriesValue(prefix + "time_us", stats.time.count());
+  Stats()->incrementCounter(prefix + "runs", stats.numRuns);
+  Stats()->incrementCounter(prefix + "changes", stats.numChanges);
+  Stats()->incrementCounter(prefix + "nodes_delta", stats.nodesDelta);
+  Stats()->incrementCounter(prefix + "constant_bytes_delta",
+                            stats.constantBytesDelta);
+}
+
 } // namespace
 
 bool glow::runDCEPass(Function *F, CompilationContext &cctx) {
@@ -194,21 +224,63 @@ bool FunctionPassManager::runPass(const FunctionPassConfig &passConfig,
     runPass(getDCEPassConfig(), F, cctx);
   }
 
+  // Passes only look at F, so one that found nothing to change finds nothing
+  // again until another pass changes F.
+  const unsigned passKey = convertEnumToUnsigned(passID);
+  auto unchangedIt = unchangedAt_.find(passKey);
+  if (!rerunUnchangedPassesOpt && unchangedIt != unchangedAt_.end() &&
+      unchangedIt->second == numChanges_) {
+    return false;
+  }
+
   auto P = createFunctionPass(passID);
+  const bool collectStats = cctx.optimizationOpts.collectPassStats;
+  int64_t numNodes = 0;
+  int64_t constantBytes = 0;
+  if (collectStats) {
+    numNodes = F->getNodes().size();
+    constantBytes = getConstantBytes(*F->getParent());
+  }
+  auto start = std::chrono::steady_clock::now();
+  TRACE_EVENT_SCOPE_NAMED(cctx.traceContext, TraceLevel::COMPILE,
+                          P->getName(), passEvent);
+
   bool changed = runPrePass(F, cctx, *P);
   changed |= P->run(F, cctx);
   changed |= runPostPass(F, cctx, *P);
 
+  passEvent.addArg("function", F->getName());
+  passEvent.addArg("changed", changed ? "true" : "false");
+  TRACE_EVENT_SCOPE_END_NAMED(passEvent);
+  if (collectStats) {
+    auto &stats = passStats_[passID];
+    stats.numRuns++;
+    stats.numChanges += changed;
+    stats.time += std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start);
+    stats.nodesDelta += int64_t(F->getNodes().size()) - numNodes;
+    stats.constantBytesDelta +=
+        getConstantBytes(*F->getParent()) - constantBytes;
+  }
+
+  if (changed) {
+    numChanges_++;
+  } else {
+    unchangedAt_[passKey] = numChanges_;
+  }
   return changed;
 }
 
 bool FunctionPassManager::run(Function *F, const CompilationContext &cctx) {
   bool changed = false;
+  numChanges_ = 0;
+  unchangedAt_.clear();
+  passStats_.clear();
   for (passIdx_ = 0; passIdx_ < getPipeline().size(); passIdx_++) {
     const FunctionPassConfig &passConfig = getPipeline().at(passIdx_);
     // If we've exceeded the number of passes to run then early exit.
     if (++globalPassCounter > stopAfterPassNumOpt) {
-      return changed;
+      break;
     }
 
     // Skip some passes if specified by the config that they shouldn't be
@@ -234,5 +306,9 @@ bool FunctionPassManager::run(Function *F, const CompilationContext &cctx) {
       break;
     }
   }
+
+  for (const auto &stats : passStats_) {
+    exportPassStats(getNameOfPass(stats.first), stats.second);
+  }
   return changed;
 }
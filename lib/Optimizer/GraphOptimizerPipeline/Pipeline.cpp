@@ -18,8 +18,71 @@
 #include "glow/Optimizer/GraphOptimizer/GraphOptimizer.h"
 #include "glow/Optimizer/GraphOptimizer/PassManager.h"
 
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/YAMLTraits.h"
+#include "llvm/Support/raw_ostream.h"
+
 using namespace glow;
 
+namespace {
+/// The fields of a FunctionPassConfig, which has no setters, for the YAML
+/// serialization.
+struct FunctionPassConfigHelper {
+  FunctionPassID passID{FunctionPassID::EmptyPass};
+  ConvergenceMode convergenceMode{ConvergenceMode::OnePass};
+  std::vector<CompilationMode> compilationModes{CompilationMode::Infer,
+                                                CompilationMode::Train};
+  DCERequiredMode dceMode{DCERequiredMode::BeforePass};
+};
+} // namespace
+
+namespace llvm {
+namespace yaml {
+template <> struct ScalarEnumerationTraits<FunctionPassID> {
+  static void enumeration(IO &io, FunctionPassID &value) {
+#define FUN_PASS(PASS_NAME)                                                    \
+  io.enumCase(value, #PASS_NAME, FunctionPassID::PASS_NAME);
+#include "glow/Optimizer/GraphOptimizer/FunctionPasses.def"
+  }
+};
+
+template <> struct ScalarEnumerationTraits<ConvergenceMode> {
+  static void enumeration(IO &io, ConvergenceMode &value) {
+    io.enumCase(value, "OnePass", ConvergenceMode::OnePass);
+    io.enumCase(value, "UntilFixedPoint", ConvergenceMode::UntilFixedPoint);
+  }
+};
+
+template <> struct ScalarEnumerationTraits<CompilationMode> {
+  static void enumeration(IO &io, CompilationMode &value) {
+    io.enumCase(value, "Infer", CompilationMode::Infer);
+    io.enumCase(value, "Train", CompilationMode::Train);
+  }
+};
+
+template <> struct ScalarEnumerationTraits<DCERequiredMode> {
+  static void enumeration(IO &io, DCERequiredMode &value) {
+    io.enumCase(value, "BeforePass", DCERequiredMode::BeforePass);
+    io.enumCase(value, "None", DCERequiredMode::None);
+  }
+};
+
+template <> struct MappingTraits<FunctionPassConfigHelper> {
+  static void mapping(IO &io, FunctionPassConfigHelper &config) {
+    io.mapRequired("pass", config.passID);
+    io.mapOptional("convergenceMode", config.convergenceMode,
+                   ConvergenceMode::OnePass);
+    io.mapOptional("compilationModes", config.compilationModes);
+    io.mapOptional("dceMode", config.dceMode, DCERequiredMode::BeforePass);
+  }
+};
+} // namespace yaml
+} // namespace llvm
+
+LLVM_YAML_IS_FLOW_SEQUENCE_VECTOR(CompilationMode);
+LLVM_YAML_IS_SEQUENCE_VECTOR(FunctionPassConfigHelper);
+
 FunctionPassPipeline glow::createDefaultGraphOptimizationPassPipeline() {
   return {
       // Sink transpose operations in an attempt to cancel them out.
@@ -54,6 +117,11 @@ FunctionPassPipeline glow::createDefaultGraphOptimizationPassPipeline() {
       // Merge multiple matmul nodes into a single large matmul.
       {FunctionPassID::MergeMatMul},
 
+      // Merge parallel fully connected nodes into fewer, larger ones.
+      {FunctionPassID::MergeParallelFCs,
+       ConvergenceMode::OnePass,
+       {CompilationMode::Infer}},
+
       // Merge multiple batched adds into a larger batched add.
       {FunctionPassID::MergeBatchedAdd},
 
@@ -123,6 +191,12 @@ FunctionPassPipeline glow::createDefaultFoldPassPipeline() {
       // Fold sub-graphs corresponding to leakyRelu.
       {FunctionPassID::FoldLeakyRelu},
 
+      // Fold sub-graphs corresponding to LayerNormalization.
+      {FunctionPassID::FoldLayerNormalization},
+
+      // Fold the pairwise dot products of DLRM feature interactions.
+      {FunctionPassID::FoldPairwiseDotProducts},
+
       // Fold Reshape->Transpose->Reshape into ChannelShuffle when applicable.
       {FunctionPassID::FoldChannelShuffle},
 
@@ -209,3 +283,52 @@ void FunctionPassPipeline::removeAllInstancesOfPass(FunctionPassID FPID) {
   while (removeFirstInstanceOfPass(FPID)) {
   }
 }
+
+Error glow::serializePipelineToYaml(llvm::StringRef fileName,
+                                    const FunctionPassPipeline &pipeline) {
+  std::vector<FunctionPassConfigHelper> configs;
+  for (const auto &passConfig : pipeline) {
+    FunctionPassConfigHelper config;
+    config.passID = passConfig.getFunctionPassID();
+    config.convergenceMode = passConfig.getConvergenceMode();
+    config.compilationModes.clear();
+    for (auto mode : {CompilationMode::Infer, CompilationMode::Train}) {
+      if (passConfig.isEnabledForCompilationMode(mode)) {
+        config.compilationModes.push_back(mode);
+      }
+    }
+    config.dceMode = passConfig.getDCERequiredMode();
+    configs.push_back(config);
+  }
+
+  std::error_code EC;
+  llvm::raw_fd_ostream outputStream(fileName, EC, llvm::sys::fs::F_None);
+  RETURN_ERR_IF_NOT(!EC, "Unable to create " + fileName.str() + ": " +
+                             EC.message());
+  llvm::yaml::Output yout(outputStream);
+  yout << configs;
+  return Error::success();
+}
+
+Expected<FunctionPassPipeline>
+glow::deserializePipelineFromYaml(llvm::StringRef fileName) {
+  auto text = llvm::MemoryBuffer::getFileAsStream(fileName);
+  RETURN_ERR_IF_NOT(!text.getError(), "Unable to open " + fileName.str());
+
+  std::vector<FunctionPassConfigHelper> configs;
+  llvm::yaml::Input yin((*text)->getBuffer());
+  yin >> configs;
+  RETURN_ERR_IF_NOT(!yin.error(), "Invalid pipeline in " + fileName.str());
+
+  FunctionPassPipeline pipeline;
+  for (const auto &config : configs) {
+    RETURN_ERR_IF_NOT(config.passID != FunctionPassID::DCE ||
+                          config.dceMode == DCERequiredMode::None,
+                      "DCE can't require DCE before it in " + fileName.str());
+    std::set<CompilationMode> modes(config.compilationModes.begin(),
+                                    config.compilationModes.end());
+    pipeline.pushBack(
+        {config.passID, config.convergenceMode, modes, config.dceMode});
+  }
+  return Expected<FunctionPassPipeline>(std::move(pipeline));
+}
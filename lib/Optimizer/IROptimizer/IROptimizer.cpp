@@ -22,6 +22,7 @@
 #include "glow/IR/IRBuilder.h"
 #include "glow/IR/IRUtils.h"
 #include "glow/IR/Instrs.h"
+#include "glow/Runtime/StatsExporter.h"
 #include "glow/Support/Debug.h"
 
 #include "llvm/ADT/SetVector.h"
@@ -30,6 +31,7 @@
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include <chrono>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -1103,6 +1105,19 @@ public:
 };
 } // namespace
 
+/// \returns true if the operands \p a and \p b, which an instruction may
+/// update in place, have types that allow them to share a buffer. The types
+/// must be the same, or differ only in their quantization parameters, e.g. the
+/// source and destination of a RescaleQuantized, in which case the shared
+/// buffer is viewed with the type of each operand.
+static bool haveShareableTypes(const Value *a, const Value *b) {
+  if (a->getType() == b->getType()) {
+    return true;
+  }
+  return a->getElementType() == b->getElementType() &&
+         a->getType()->size() == b->getType()->size();
+}
+
 /// Tries to share a buffer for two operands of the same instruction.
 /// An operand X cannot reuse the buffer of another operand Y,
 /// if the live interval of X overlaps with any live intervals of Y.
@@ -1128,8 +1143,8 @@ static void tryToShareBuffersForInstr(
       if (!src) {
         src = srcOp.first;
       }
-      // Operands must be different, but of the same type.
-      if (destOp.first->getType() != srcOp.first->getType()) {
+      // Operands must be different, but of shareable types.
+      if (!haveShareableTypes(destOp.first, srcOp.first)) {
         continue;
       }
 
@@ -1296,38 +1311,36 @@ static void eliminateDeadStores(IRFunction &M) {
   eraseInstructions(M, erasedInstructions);
 }
 
-/// \returns true if the first dimension in \p offsets has a non-zero value.
-static bool isOnlyOffsetInFirstDim(llvm::ArrayRef<size_t> offsets) {
-  if (offsets.size() > 1) {
-    for (size_t i = 1; i < offsets.size(); ++i) {
-      if (offsets[i] != 0) {
-        return false;
-      }
+/// \returns true if the region of shape \p regionDims at \p offsets inside a
+/// tensor of shape \p tensorDims is contiguous in memory. This is the case if
+/// the region has a size of 1 in all dimensions before some dimension, and
+/// covers the whole tensor in all dimensions after it, e.g. the inputs of a
+/// Concat along an inner dimension with a batch of 1.
+static bool isContiguousRegion(llvm::ArrayRef<size_t> offsets,
+                               llvm::ArrayRef<size_t> regionDims,
+                               llvm::ArrayRef<size_t> tensorDims) {
+  assert(regionDims.size() == tensorDims.size() &&
+         offsets.size() == tensorDims.size() &&
+         "Region and tensor must have same number of dims.");
+  // Find the innermost dimension the region doesn't fully cover.
+  size_t partialDim = 0;
+  for (size_t i = tensorDims.size(); i-- > 0;) {
+    if (offsets[i] != 0 || regionDims[i] != tensorDims[i]) {
+      partialDim = i;
+      break;
     }
   }
-  return true;
-}
-
-/// \returns true if the dimensions of \p sourceDims, other than the first
-/// dimension, all equal the dimensions in \p destDims.
-static bool allButFirstDimsEqual(llvm::ArrayRef<size_t> sourceDims,
-                                 llvm::ArrayRef<size_t> destDims) {
-  assert(sourceDims.size() == destDims.size() &&
-         "Source and dest dims must have same number of dims.");
-  if (sourceDims.size() > 1) {
-    for (size_t i = 1; i < sourceDims.size(); ++i) {
-      if (sourceDims[i] != destDims[i]) {
-        return false;
-      }
+  for (size_t i = 0; i < partialDim; ++i) {
+    if (regionDims[i] != 1) {
+      return false;
     }
   }
   return true;
 }
 
-/// Replace InsertTensors that are only offset in the first dimension with
-/// writing directly into the destination using TensorViews with the same
-/// offsets. This is possible because this means the underlying memory is
-/// contiguous in this case.
+/// Replace InsertTensors into a contiguous region of their destination, see
+/// isContiguousRegion, with writing directly into the destination using
+/// TensorViews with the same offsets.
 void optimizeInserts(IRFunction &M) {
   auto &instrs = M.getInstrs();
   InstructionPtrSet erasedInstructions;
@@ -1350,13 +1363,6 @@ void optimizeInserts(IRFunction &M) {
       continue;
     }
 
-    // TVI with offsets currently only works for this optimization if the insert
-    // is only into the first dimension. This is because the tensor memory must
-    // be contiguous.
-    if (!isOnlyOffsetInFirstDim(ITI->getOffsets())) {
-      continue;
-    }
-
     // For now only support an InsertTensor with an alloc as its source. This is
     // the pattern usually seen via IRGen'd ConcatNodes.
     auto *insertSourceAAI = dyn_cast<AllocActivationInst>(ITI->getSrc());
@@ -1372,11 +1378,11 @@ void optimizeInserts(IRFunction &M) {
       continue;
     }
 
-    // Make sure that all but the first dimension of the inserttensor's source
-    // and dest are equal. This means that the writes to the destination of the
-    // insert are contiguous.
+    // TVI with offsets only works for this optimization if the writes to the
+    // destination of the insert are contiguous.
     auto *insertDest = ITI->getDest();
-    if (!allButFirstDimsEqual(insertSourceAAI->dims(), insertDest->dims())) {
+    if (!isContiguousRegion(ITI->getOffsets(), insertSourceAAI->dims(),
+                            insertDest->dims())) {
       continue;
     }
 
@@ -1417,10 +1423,9 @@ void optimizeInserts(IRFunction &M) {
   eraseInstructions(M, erasedInstructions);
 }
 
-/// Replace ExtractTensors that are only offset in the first dimension with
-/// reading directly from the destination using TensorViews with the same
-/// offsets. This is possible because this means the underlying memory is
-/// contiguous in this case.
+/// Replace ExtractTensors from a contiguous region of their source, see
+/// isContiguousRegion, with reading directly from the source using
+/// TensorViews with the same offsets.
 void optimizeExtracts(IRFunction &M) {
   auto &instrs = M.getInstrs();
   InstructionPtrSet erasedInstructions;
@@ -1433,13 +1438,6 @@ void optimizeExtracts(IRFunction &M) {
       continue;
     }
 
-    // TVI with offsets currently only works for this optimization if the
-    // extract is only into the first dimension. This is because the tensor
-    // memory must be contiguous.
-    if (!isOnlyOffsetInFirstDim(ETI->getOffsets())) {
-      continue;
-    }
-
     // Verify that the source of the extract is not written to more than once.
     // This is to ensure that all uses of the extract's output can be replaced
     // by a view of the source instead, since it should be read-only after the
@@ -1456,9 +1454,10 @@ void optimizeExtracts(IRFunction &M) {
       continue;
     }
 
-    // Make sure that all but the first dimension of the extract's source and
-    // dest are equal. This means that the accesses are contiguous.
-    if (!allButFirstDimsEqual(extractSrc->dims(), extractDestAAI->dims())) {
+    // TVI with offsets only works for this optimization if the reads from the
+    // source of the extract are contiguous.
+    if (!isContiguousRegion(ETI->getOffsets(), extractDestAAI->dims(),
+                            extractSrc->dims())) {
       continue;
     }
 
@@ -1650,9 +1649,13 @@ void performPeepholeOptimizations(IRFunction &M) {
 std::unique_ptr<IRFunction>
 glow::generateAndOptimizeIR(Function *F, const Backend &B,
                             bool shouldShareBuffers) {
+  auto start = std::chrono::steady_clock::now();
   auto IR = llvm::make_unique<IRFunction>(F);
   IR->generateIR(B);
+  Stats()->addLatencyValue("compile_irgen", F->getName(), start);
+  start = std::chrono::steady_clock::now();
   ::glow::optimize(*IR, shouldShareBuffers);
+  Stats()->addLatencyValue("compile_iroptimizer", F->getName(), start);
   if (!B.verify(*IR)) {
     EXIT_ON_ERR(MAKE_ERR(
         ErrorValue::ErrorCode::COMPILE_UNSUPPORTED_IR_AFTER_OPTIMIZE,
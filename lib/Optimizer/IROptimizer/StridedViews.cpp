@@ -0,0 +1,271 @@
+/**
+ * Copyright (c) Glow Contributors. See CONTRIBUTORS file.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "glow/Optimizer/IROptimizer/IROptimizer.h"
+
+#include "glow/IR/IR.h"
+#include "glow/IR/IRBuilder.h"
+#include "glow/IR/IRUtils.h"
+#include "glow/IR/Instrs.h"
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
+
+#include <algorithm>
+
+using namespace glow;
+using llvm::cast;
+using llvm::dyn_cast;
+using llvm::isa;
+
+namespace {
+
+/// \returns the number of elements of the rows of the region \p regionDims at
+/// \p offsets of \p tensor if it is strided, see getStridedRegionLayout, or 0
+/// otherwise. \p tensor must not be a strided view.
+size_t getStridedRowLen(llvm::ArrayRef<size_t> offsets,
+                        llvm::ArrayRef<size_t> regionDims,
+                        const Value *tensor) {
+  size_t rowLen = 0;
+  size_t pitch = 0;
+  if (getStridedViewLayout(tensor, rowLen, pitch) ||
+      !getStridedRegionLayout(offsets, regionDims, tensor->dims(), rowLen,
+                              pitch)) {
+    return 0;
+  }
+  return rowLen;
+}
+
+/// \returns true if \p buf may be replaced by a strided view of \p origin with
+/// rows of \p rowLen elements in the instruction \p I, which accesses \p buf
+/// only as \p kind. \p I must be data-parallel and access \p buf element by
+/// element. The other strided views it accesses must have the same rows, and
+/// it must not access \p origin otherwise when one of the accesses writes.
+bool canAccessStrided(const Instruction *I, const Value *buf,
+                      const Value *origin, size_t rowLen, OperandKind kind) {
+  if (!I->isDataParallel() || I->getOperand(0).first->size() != buf->size()) {
+    return false;
+  }
+  for (const auto &op : I->getOperands()) {
+    if (op.first == buf) {
+      if (op.second != kind) {
+        return false;
+      }
+      continue;
+    }
+    size_t opRowLen = 0;
+    size_t opPitch = 0;
+    if (getStridedViewLayout(op.first, opRowLen, opPitch) &&
+        opRowLen != rowLen) {
+      return false;
+    }
+    if (getOrigin(op.first) == origin &&
+        (kind != OperandKind::In || op.second != OperandKind::In)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/// \returns true if one of the instructions of \p M between \p I and
+/// \p where writes or deallocates a buffer whose origin is the origin of one
+/// of the inputs of \p I, or if \p where doesn't follow \p I.
+bool writesInputs(IRFunction &M, Instruction *I, const Instruction *where) {
+  for (auto it = std::next(I->getIterator()), e = M.getInstrs().end();
+       it != e; ++it) {
+    if (&*it == where) {
+      return false;
+    }
+    for (const auto &op : it->getOperands()) {
+      if (op.second == OperandKind::In) {
+        continue;
+      }
+      for (const auto &input : I->getOperands()) {
+        if (input.second != OperandKind::Out &&
+            getOrigin(input.first) == getOrigin(op.first)) {
+          return true;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+/// Erase the activation \p AAI of \p M, which is only used by its dealloc.
+void eraseUnusedActivation(IRFunction &M, AllocActivationInst *AAI) {
+  llvm::SmallVector<Instruction *, 2> users;
+  for (auto &U : AAI->getUsers()) {
+    users.push_back(U.get());
+  }
+  for (auto *user : users) {
+    assert(isa<DeallocActivationInst>(user) && "The activation is still used");
+    M.eraseInstruction(user);
+  }
+  M.eraseInstruction(AAI);
+}
+
+/// Replace the ExtractTensors of \p M from strided regions, whose results are
+/// only read by data-parallel instructions, with strided views of their
+/// sources. \returns true if \p M was changed.
+bool createStridedExtracts(IRFunction &M) {
+  auto &instrs = M.getInstrs();
+  // The positions of the instructions, and the positions where the buffers
+  // are written or deallocated. The reads of a source are deferred to the
+  // readers of the extract, so it must not change in-between.
+  llvm::DenseMap<const Instruction *, size_t> positions;
+  llvm::DenseMap<const Value *, llvm::SmallVector<size_t, 4>> writes;
+  for (auto &I : instrs) {
+    size_t pos = positions.size();
+    positions[&I] = pos;
+    for (const auto &op : I.getOperands()) {
+      if (op.second != OperandKind::In) {
+        writes[getOrigin(op.first)].push_back(pos);
+      }
+    }
+  }
+
+  IRBuilder B(&M);
+  llvm::SmallVector<ExtractTensorInst *, 8> erased;
+  for (auto &I : instrs) {
+    auto *ETI = dyn_cast<ExtractTensorInst>(&I);
+    if (!ETI) {
+      continue;
+    }
+    auto *src = ETI->getSrc();
+    auto *dest = dyn_cast<AllocActivationInst>(ETI->getDest());
+    if (!dest) {
+      continue;
+    }
+    size_t rowLen = getStridedRowLen(ETI->getOffsets(), dest->dims(), src);
+    if (!rowLen) {
+      continue;
+    }
+    bool onlyReadByKernels = true;
+    size_t lastRead = positions[ETI];
+    for (const auto &U : dest->getUsers()) {
+      auto *user = U.get();
+      if (user == ETI || isa<DeallocActivationInst>(user)) {
+        continue;
+      }
+      if (!canAccessStrided(user, dest, getOrigin(src), rowLen,
+                            OperandKind::In)) {
+        onlyReadByKernels = false;
+        break;
+      }
+      lastRead = std::max(lastRead, positions[user]);
+    }
+    if (!onlyReadByKernels) {
+      continue;
+    }
+    const auto &srcWrites = writes[getOrigin(src)];
+    if (std::any_of(srcWrites.begin(), srcWrites.end(), [&](size_t pos) {
+          return pos > positions[ETI] && pos <= lastRead;
+        })) {
+      continue;
+    }
+
+    auto *TVI = B.createTensorViewInst((ETI->getName() + ".tv.strided").str(),
+                                       src, dest->getType(), ETI->getOffsets());
+    M.moveInstruction(ETI, TVI);
+    llvm::SmallVector<Use, 6> uses(dest->getUsers().begin(),
+                                   dest->getUsers().end());
+    for (auto &U : uses) {
+      if (U.get() != ETI && !isa<DeallocActivationInst>(U.get())) {
+        U.setOperand(TVI);
+      }
+    }
+    erased.push_back(ETI);
+  }
+
+  for (auto *ETI : erased) {
+    auto *dest = cast<AllocActivationInst>(ETI->getDest());
+    M.eraseInstruction(ETI);
+    eraseUnusedActivation(M, dest);
+  }
+  return !erased.empty();
+}
+
+/// Replace the InsertTensors of \p M into strided regions, whose sources are
+/// only written by a data-parallel instruction, with the instruction writing
+/// into a strided view of the destination. \returns true if \p M was changed.
+bool createStridedInserts(IRFunction &M) {
+  auto &instrs = M.getInstrs();
+  IRBuilder B(&M);
+  llvm::SmallVector<InsertTensorInst *, 8> erased;
+  for (auto &I : instrs) {
+    auto *ITI = dyn_cast<InsertTensorInst>(&I);
+    if (!ITI || ITI->getCount() > 1) {
+      continue;
+    }
+    auto *dest = ITI->getDest();
+    auto *src = dyn_cast<AllocActivationInst>(ITI->getSrc());
+    // The source must only be used by the insert, its writer and its dealloc.
+    if (!src || src->getNumUsers() != 3) {
+      continue;
+    }
+    size_t rowLen = getStridedRowLen(ITI->getOffsets(), src->dims(), dest);
+    if (!rowLen) {
+      continue;
+    }
+    Instruction *writer = nullptr;
+    for (const auto &U : src->getUsers()) {
+      auto *user = U.get();
+      if (user != ITI && !isa<DeallocActivationInst>(user)) {
+        writer = user;
+      }
+    }
+    if (!writer || !canAccessStrided(writer, src, getOrigin(dest), rowLen,
+                                     OperandKind::Out)) {
+      continue;
+    }
+    // The writer is moved to the insert, its inputs must not change
+    // in-between.
+    if (writesInputs(M, writer, ITI)) {
+      continue;
+    }
+
+    auto *TVI = B.createTensorViewInst((ITI->getName() + ".tv.strided").str(),
+                                       dest, src->getType(), ITI->getOffsets());
+    M.moveInstruction(ITI, TVI);
+    M.moveInstruction(ITI, writer);
+    llvm::SmallVector<Use, 6> uses(src->getUsers().begin(),
+                                   src->getUsers().end());
+    for (auto &U : uses) {
+      if (U.get() == writer) {
+        U.setOperand(TVI);
+      }
+    }
+    erased.push_back(ITI);
+  }
+
+  for (auto *ITI : erased) {
+    auto *src = cast<AllocActivationInst>(ITI->getSrc());
+    M.eraseInstruction(ITI);
+    eraseUnusedActivation(M, src);
+  }
+  return !erased.empty();
+}
+
+} // namespace
+
+bool glow::createStridedViews(IRFunction &M) {
+  bool changed = createStridedInserts(M);
+  changed |= createStridedExtracts(M);
+  if (changed) {
+    M.verify();
+  }
+  return changed;
+}
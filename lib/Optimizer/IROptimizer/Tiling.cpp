@@ -0,0 +1,376 @@
+/**
+ * Copyright (c) Glow Contributors. See CONTRIBUTORS file.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "glow/Optimizer/IROptimizer/IROptimizer.h"
+
+#include "glow/Graph/Graph.h"
+#include "glow/IR/IR.h"
+#include "glow/IR/IRBuilder.h"
+#include "glow/IR/IRUtils.h"
+#include "glow/IR/Instrs.h"
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+
+using namespace glow;
+using llvm::cast;
+using llvm::dyn_cast;
+using llvm::isa;
+
+namespace {
+
+/// The largest number of tiles a chain is split into. The tiles are unrolled
+/// in the IR, so this bounds the growth of the instruction list.
+constexpr size_t kMaxTiles = 64;
+
+/// A sequence of instructions computing the same number of rows, i.e. the
+/// elements of the outermost dimension of their destinations.
+using Chain = llvm::SmallVector<Instruction *, 8>;
+
+/// \returns the number of rows of \p V.
+size_t getRows(const Value *V) { return V->dims()[0]; }
+
+/// \returns true if row r of every operand of \p I that is accessed by rows
+/// is only computed from, or only used to compute, row r of the destination
+/// of \p I. Such instructions can run on any range of rows independently.
+bool isTileable(const Instruction *I) {
+  auto *dest = I->getOperand(0).first;
+  switch (I->getKind()) {
+  case Kinded::Kind::SplatInstKind:
+  case Kinded::Kind::CopyInstKind:
+  case Kinded::Kind::ElementAddInstKind:
+  case Kinded::Kind::ElementSubInstKind:
+  case Kinded::Kind::ElementMulInstKind:
+  case Kinded::Kind::ElementDivInstKind:
+  case Kinded::Kind::ElementMaxInstKind:
+  case Kinded::Kind::ElementMinInstKind:
+  case Kinded::Kind::ElementLogInstKind:
+  case Kinded::Kind::ElementExpInstKind:
+  case Kinded::Kind::SigmoidInstKind:
+  case Kinded::Kind::TanhInstKind:
+  case Kinded::Kind::QuantizeInstKind:
+  case Kinded::Kind::DequantizeInstKind:
+  case Kinded::Kind::RescaleQuantizedInstKind:
+    // Element-wise instructions, as long as no operand is broadcasted.
+    for (const auto &op : I->getOperands()) {
+      if (op.first->dims() != dest->dims()) {
+        return false;
+      }
+    }
+    return true;
+  case Kinded::Kind::ExtractTensorInstKind:
+    // Row r of the destination is read from row r + offsets[0] of the source.
+    return true;
+  case Kinded::Kind::BatchedReduceAddInstKind: {
+    // Rows are independent when they are not reduced.
+    auto *BRA = cast<BatchedReduceAddInst>(I);
+    return BRA->getAxis() != 0 && getRows(BRA->getBatch()) == getRows(dest);
+  }
+  default:
+    return false;
+  }
+}
+
+/// \returns true if the source of the ExtractTensor \p ETI is not read by rows
+/// of the destination, i.e. row r of its destination is not read from row r of
+/// its source.
+bool isMisalignedExtract(const ExtractTensorInst *ETI) {
+  return ETI->getOffsets()[0] != 0 ||
+         getRows(ETI->getSrc()) != getRows(ETI->getDest());
+}
+
+/// \returns true if the buffer \p buf is an activation that only carries
+/// values between the instructions of \p chain, i.e. it is only accessed by
+/// them and is overwritten by the first of them to access it.
+bool isChainLocalBuffer(const Value *buf, const Chain &chain,
+                        const llvm::SmallPtrSetImpl<Instruction *> &inChain) {
+  if (!isa<AllocActivationInst>(buf)) {
+    return false;
+  }
+  for (const auto &U : buf->getUsers()) {
+    Instruction *user = U.get();
+    if (!isa<DeallocActivationInst>(user) && !inChain.count(user)) {
+      return false;
+    }
+  }
+  for (const auto *I : chain) {
+    bool reads = false;
+    bool writes = false;
+    for (const auto &op : I->getOperands()) {
+      if (op.first == buf) {
+        reads |= op.second != OperandKind::Out;
+        writes |= op.second != OperandKind::In;
+      }
+    }
+    if (reads || writes) {
+      return writes && !reads;
+    }
+  }
+  return false;
+}
+
+/// Split the instructions of \p chain of \p M into tiles of rows whose
+/// buffers take about \p cacheSize bytes, computing all the instructions of a
+/// tile before moving to the next one. The intermediate results that are only
+/// used inside of the chain are kept in a buffer of one tile, reused by all
+/// the tiles. \returns true if the chain was tiled.
+bool tileChain(IRFunction &M, const Chain &chain, size_t cacheSize) {
+  size_t rows = getRows(chain[0]->getOperand(0).first);
+  llvm::SmallPtrSet<Instruction *, 8> inChain(chain.begin(), chain.end());
+
+  // Collect the buffers of the chain.
+  llvm::SmallVector<Value *, 16> buffers;
+  llvm::DenseSet<Value *> written;
+  llvm::DenseSet<Value *> misaligned;
+  for (auto *I : chain) {
+    for (const auto &op : I->getOperands()) {
+      if (std::find(buffers.begin(), buffers.end(), op.first) ==
+          buffers.end()) {
+        buffers.push_back(op.first);
+      }
+      if (op.second != OperandKind::In) {
+        written.insert(op.first);
+      }
+    }
+    auto *ETI = dyn_cast<ExtractTensorInst>(I);
+    if (ETI && isMisalignedExtract(ETI)) {
+      misaligned.insert(ETI->getSrc());
+    }
+  }
+
+  // Tiling reorders the accesses of different rows. This is only legal when
+  // the row r of a written buffer is only accessed by the tile of row r.
+  for (auto *buf : written) {
+    if (misaligned.count(buf)) {
+      return false;
+    }
+    for (auto *other : buffers) {
+      if (other != buf && getOrigin(other) == getOrigin(buf)) {
+        return false;
+      }
+    }
+  }
+
+  llvm::DenseSet<Value *> local;
+  size_t rowBytes = 0;
+  for (auto *buf : buffers) {
+    if (isChainLocalBuffer(buf, chain, inChain)) {
+      local.insert(buf);
+    }
+    rowBytes += buf->getSizeInBytes() / getRows(buf);
+  }
+  // There is nothing to keep in the cache without intermediate results.
+  if (local.empty() || !rowBytes) {
+    return false;
+  }
+  size_t tileRows = std::max<size_t>(cacheSize / rowBytes, 1);
+  tileRows = std::max(tileRows, (rows + kMaxTiles - 1) / kMaxTiles);
+  if (tileRows >= rows) {
+    return false;
+  }
+
+  // The tiles are emitted at the position of the last instruction of the
+  // chain. Buffers deallocated inside of the chain must live until then.
+  Instruction *where = chain.back();
+  llvm::SmallVector<Instruction *, 8> deallocs;
+  for (auto it = chain.front()->getIterator(); &*it != where; ++it) {
+    auto *DA = dyn_cast<DeallocActivationInst>(&*it);
+    if (DA && !local.count(DA->getSrc())) {
+      deallocs.push_back(DA);
+    }
+  }
+
+  IRBuilder B(&M);
+  auto *module = M.getGraph()->getParent();
+  auto getTileType = [&](const Value *V, size_t count) {
+    std::vector<size_t> dims(V->dims().begin(), V->dims().end());
+    dims[0] = count;
+    return module->uniqueTypeWithNewShape(V->getType(), dims);
+  };
+  auto emit = [&](Instruction *I) {
+    M.moveInstruction(where, I);
+    return I;
+  };
+
+  // Allocate the buffers holding one tile of the local intermediate results.
+  llvm::DenseMap<Value *, Value *> tileBuffers;
+  for (auto *buf : buffers) {
+    if (local.count(buf)) {
+      tileBuffers[buf] = emit(B.createAllocActivationInst(
+          (buf->getName() + ".tile").str(), getTileType(buf, tileRows)));
+    }
+  }
+
+  for (size_t start = 0; start < rows; start += tileRows) {
+    size_t count = std::min(tileRows, rows - start);
+    // The views of the rows [start, start + count) of the buffers.
+    llvm::DenseMap<Value *, Value *> views;
+    auto getTile = [&](Value *buf) {
+      auto &view = views[buf];
+      if (view) {
+        return view;
+      }
+      std::vector<size_t> offsets(buf->dims().size(), 0);
+      Value *src = buf;
+      if (local.count(buf)) {
+        src = tileBuffers[buf];
+        if (count == tileRows) {
+          view = src;
+          return view;
+        }
+      } else {
+        offsets[0] = start;
+      }
+      view = emit(B.createTensorViewInst((buf->getName() + ".tile").str(),
+                                         src, getTileType(buf, count),
+                                         offsets));
+      return view;
+    };
+
+    for (auto *I : chain) {
+      auto name = (I->getName() + ".tile").str();
+      auto tile = [&](unsigned idx) {
+        return getTile(I->getOperand(idx).first);
+      };
+      switch (I->getKind()) {
+#define TILE_UNARY_CASE(INST_NAME_)                                            \
+  case Kinded::Kind::INST_NAME_##InstKind:                                     \
+    emit(B.create##INST_NAME_##Inst(name, tile(0), tile(1)));                  \
+    break;
+#define TILE_BINARY_CASE(INST_NAME_)                                           \
+  case Kinded::Kind::INST_NAME_##InstKind:                                     \
+    emit(B.create##INST_NAME_##Inst(name, tile(0), tile(1), tile(2)));         \
+    break;
+        TILE_UNARY_CASE(Copy)
+        TILE_UNARY_CASE(ElementLog)
+        TILE_UNARY_CASE(ElementExp)
+        TILE_UNARY_CASE(Sigmoid)
+        TILE_UNARY_CASE(Tanh)
+        TILE_UNARY_CASE(Quantize)
+        TILE_UNARY_CASE(Dequantize)
+        TILE_UNARY_CASE(RescaleQuantized)
+        TILE_BINARY_CASE(ElementAdd)
+        TILE_BINARY_CASE(ElementSub)
+        TILE_BINARY_CASE(ElementMul)
+        TILE_BINARY_CASE(ElementDiv)
+        TILE_BINARY_CASE(ElementMax)
+        TILE_BINARY_CASE(ElementMin)
+#undef TILE_UNARY_CASE
+#undef TILE_BINARY_CASE
+      case Kinded::Kind::SplatInstKind:
+        emit(B.createSplatInst(name, tile(0), cast<SplatInst>(I)->getValue()));
+        break;
+      case Kinded::Kind::BatchedReduceAddInstKind:
+        emit(B.createBatchedReduceAddInst(
+            name, tile(0), tile(1), cast<BatchedReduceAddInst>(I)->getAxis()));
+        break;
+      case Kinded::Kind::ExtractTensorInstKind: {
+        auto *ETI = cast<ExtractTensorInst>(I);
+        std::vector<size_t> offsets(ETI->getOffsets().begin(),
+                                    ETI->getOffsets().end());
+        Value *src = nullptr;
+        if (isMisalignedExtract(ETI)) {
+          // The source is not written by the chain, read its rows in place.
+          std::vector<size_t> srcOffsets(offsets.size(), 0);
+          srcOffsets[0] = offsets[0] + start;
+          src = emit(B.createTensorViewInst(name + ".src", ETI->getSrc(),
+                                            getTileType(ETI->getSrc(), count),
+                                            srcOffsets));
+        } else {
+          src = getTile(ETI->getSrc());
+        }
+        offsets[0] = 0;
+        emit(B.createExtractTensorInst(name, tile(0), src, offsets));
+        break;
+      }
+      default:
+        llvm_unreachable("Instruction cannot be tiled");
+      }
+    }
+  }
+
+  for (auto *buf : buffers) {
+    if (local.count(buf)) {
+      emit(B.createDeallocActivationInst((buf->getName() + ".tile").str(),
+                                         tileBuffers[buf]));
+    }
+  }
+  for (auto *DA : deallocs) {
+    M.moveInstruction(where, DA);
+  }
+
+  // Remove the original instructions and intermediate buffers.
+  for (auto *I : chain) {
+    M.eraseInstruction(I);
+  }
+  for (auto *buf : local) {
+    llvm::SmallVector<Instruction *, 2> users;
+    for (auto &U : buf->getUsers()) {
+      users.push_back(U.get());
+    }
+    for (auto *user : users) {
+      M.eraseInstruction(user);
+    }
+    M.eraseInstruction(cast<AllocActivationInst>(buf));
+  }
+  return true;
+}
+
+} // namespace
+
+bool glow::tileInstructionChains(IRFunction &M, size_t cacheSize) {
+  if (!cacheSize) {
+    return false;
+  }
+  // Find the sequences of tileable instructions computing the same number of
+  // rows. The memory management instructions only define buffers, they do not
+  // end a sequence.
+  std::vector<Chain> chains;
+  Chain chain;
+  auto endChain = [&]() {
+    if (chain.size() > 1) {
+      chains.push_back(chain);
+    }
+    chain.clear();
+  };
+  for (auto &I : M.getInstrs()) {
+    if (isa<AllocActivationInst>(&I) || isa<DeallocActivationInst>(&I) ||
+        isa<TensorViewInst>(&I)) {
+      continue;
+    }
+    if (!isTileable(&I)) {
+      endChain();
+      continue;
+    }
+    if (!chain.empty() && getRows(I.getOperand(0).first) !=
+                              getRows(chain[0]->getOperand(0).first)) {
+      endChain();
+    }
+    chain.push_back(&I);
+  }
+  endChain();
+
+  bool changed = false;
+  for (const auto &C : chains) {
+    changed |= tileChain(M, C, cacheSize);
+  }
+  if (changed) {
+    M.verify();
+  }
+  return changed;
+}
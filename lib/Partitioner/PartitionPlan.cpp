@@ -0,0 +1,152 @@
+/**
+ * Copyright (c) Glow Contributors. See CONTRIBUTORS file.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "glow/Partitioner/PartitionPlan.h"
+
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/YAMLTraits.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+
+using namespace glow;
+using namespace glow::runtime;
+
+namespace {
+/// A partition of a plan, as it is serialized.
+struct PartitionHelper {
+  std::string name;
+  std::string backendName;
+  std::vector<uint64_t> logicalDevices;
+  std::string predicate;
+  std::vector<std::string> nodes;
+};
+
+/// A plan, as it is serialized.
+struct PartitionPlanHelper {
+  std::string funcName;
+  std::vector<PartitionHelper> partitions;
+};
+} // namespace
+
+namespace llvm {
+namespace yaml {
+template <> struct MappingTraits<PartitionHelper> {
+  static void mapping(IO &io, PartitionHelper &partition) {
+    io.mapRequired("name", partition.name);
+    io.mapRequired("backendName", partition.backendName);
+    io.mapOptional("logicalDevices", partition.logicalDevices);
+    io.mapOptional("predicate", partition.predicate);
+    io.mapRequired("nodes", partition.nodes);
+  }
+};
+
+template <> struct MappingTraits<PartitionPlanHelper> {
+  static void mapping(IO &io, PartitionPlanHelper &plan) {
+    io.mapRequired("funcName", plan.funcName);
+    io.mapRequired("partitions", plan.partitions);
+  }
+};
+} // end namespace yaml
+} // end namespace llvm
+
+LLVM_YAML_IS_SEQUENCE_VECTOR(PartitionHelper);
+
+namespace glow {
+
+Error serializePartitionConfig(const PartitionConfig &config,
+                               llvm::StringRef fileName) {
+  PartitionPlanHelper plan;
+  plan.funcName = config.funcName;
+  plan.partitions.resize(config.numOfPartitions);
+  for (size_t i = 0; i < config.numOfPartitions; i++) {
+    auto &partition = plan.partitions[i];
+    partition.name = config.partitionNames[i];
+    partition.backendName = config.backendNames[i];
+    if (i < config.logicalIDs.size()) {
+      partition.logicalDevices.assign(config.logicalIDs[i].begin(),
+                                      config.logicalIDs[i].end());
+    }
+    if (i < config.partitionPredicates.size()) {
+      partition.predicate = config.partitionPredicates[i];
+    }
+  }
+  // List the nodes in order, so that the same plan is the same file.
+  std::vector<std::pair<std::string, size_t>> nodes;
+  for (const auto &it : config.nodeToPartition) {
+    RETURN_ERR_IF_NOT(it.second < config.numOfPartitions,
+                      "Invalid partition of node " + it.first().str());
+    nodes.emplace_back(it.first(), it.second);
+  }
+  std::sort(nodes.begin(), nodes.end());
+  for (auto &node : nodes) {
+    plan.partitions[node.second].nodes.push_back(std::move(node.first));
+  }
+
+  std::error_code EC;
+  llvm::raw_fd_ostream os(fileName, EC, llvm::sys::fs::F_None);
+  RETURN_ERR_IF_NOT(!EC, "Unable to create the partition plan " +
+                             fileName.str() + ": " + EC.message());
+  llvm::yaml::Output yout(os);
+  yout << plan;
+  return Error::success();
+}
+
+Expected<PartitionConfig> deserializePartitionConfig(llvm::StringRef fileName) {
+  auto buffer = llvm::MemoryBuffer::getFile(fileName);
+  RETURN_ERR_IF_NOT(buffer, "Unable to open the partition plan " +
+                                fileName.str() + ": " +
+                                buffer.getError().message());
+  PartitionPlanHelper plan;
+  llvm::yaml::Input yin((*buffer)->getBuffer());
+  yin >> plan;
+  RETURN_ERR_IF_NOT(!yin.error(),
+                    "Invalid partition plan " + fileName.str());
+  RETURN_ERR_IF_NOT(!plan.partitions.empty(),
+                    "No partition in the partition plan " + fileName.str());
+
+  PartitionConfig config;
+  config.funcName = plan.funcName;
+  config.numOfPartitions = plan.partitions.size();
+  bool hasPredicates = false;
+  for (size_t i = 0, e = plan.partitions.size(); i < e; i++) {
+    const auto &partition = plan.partitions[i];
+    config.partitionNames.push_back(partition.name);
+    config.backendNames.push_back(partition.backendName);
+    config.partitionPredicates.push_back(partition.predicate);
+    hasPredicates |= !partition.predicate.empty();
+    RETURN_ERR_IF_NOT(partition.logicalDevices.empty() ==
+                          plan.partitions[0].logicalDevices.empty(),
+                      "Only some partitions have logical devices in " +
+                          fileName.str());
+    if (!partition.logicalDevices.empty()) {
+      config.logicalIDs.emplace_back(partition.logicalDevices.begin(),
+                                     partition.logicalDevices.end());
+    }
+    for (const auto &node : partition.nodes) {
+      RETURN_ERR_IF_NOT(config.nodeToPartition.try_emplace(node, i).second,
+                        "Node " + node + " is in two partitions in " +
+                            fileName.str());
+    }
+  }
+  if (!hasPredicates) {
+    config.partitionPredicates.clear();
+  }
+  return config;
+}
+
+} // namespace glow
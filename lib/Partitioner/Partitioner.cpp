@@ -16,13 +16,18 @@
 
 #include "glow/Partitioner/Partitioner.h"
 #include "glow/Optimizer/GraphOptimizer/GraphOptimizer.h"
+#include "glow/Partitioner/PartitionPlan.h"
 #include "glow/Partitioner/PartitionerOptimizer.h"
 #include "glow/Partitioner/PartitionerUtils.h"
 #include "glow/Partitioner/PartitionerValidation.h"
 #include "glow/Support/Support.h"
 
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/Path.h"
 #include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/xxhash.h"
 
 #include <fstream>
 namespace glow {
@@ -34,6 +39,14 @@ static llvm::cl::opt<bool, /* ExternalStorage */ true>
             "Enable a partitioner pass to optimize for "
             "load balance in addition to memory capacity constraints"),
         llvm::cl::location(GlowEnableLoadBalancedPartitioning));
+bool GlowEnableMinCutPartitioning = false;
+static llvm::cl::opt<bool, /* ExternalStorage */ true>
+    GlowEnableMinCutPartitioningOpt(
+        "glow_partitioner_enable_min_cut",
+        llvm::cl::desc("Enable a partitioner pass to minimize the bytes "
+                       "transferred between partitions under memory capacity "
+                       "constraints"),
+        llvm::cl::location(GlowEnableMinCutPartitioning));
 } // namespace glow
 
 /// -log-partition - Command line option to dump Partitioner logs.
@@ -50,6 +63,56 @@ static llvm::cl::opt<bool>
                   llvm::cl::desc("Enable dumping the graph of each partitions"),
                   llvm::cl::init(false), llvm::cl::cat(PartitionerCat));
 
+/// -partition-cost-report - Command line option to dump the roofline cost
+/// estimate of every node of each partition.
+static llvm::cl::opt<std::string> partitionCostReport(
+    "partition-cost-report",
+    llvm::cl::desc("Dump the estimated FLOPs, bytes moved, arithmetic "
+                   "intensity and time of every node of each partition into "
+                   "this csv file"),
+    llvm::cl::value_desc("file.csv"), llvm::cl::init(""),
+    llvm::cl::cat(PartitionerCat));
+
+/// -partition-cost-profile - Command line option to report the measured time
+/// of the nodes next to their estimate.
+static llvm::cl::opt<std::string> partitionCostProfile(
+    "partition-cost-profile",
+    llvm::cl::desc("Trace events of a profiling run whose measured times are "
+                   "reported next to the estimates of -partition-cost-report"),
+    llvm::cl::value_desc("trace.json"), llvm::cl::init(""),
+    llvm::cl::cat(PartitionerCat));
+
+/// -partition-profile - Command line option to balance partitions with
+/// measured node times.
+static llvm::cl::opt<std::string> partitionProfile(
+    "partition-profile",
+    llvm::cl::desc("Trace events of a calibration run whose node times, per "
+                   "node kind and shape, replace the roofline estimates "
+                   "when balancing partitions"),
+    llvm::cl::value_desc("trace.json"), llvm::cl::init(""),
+    llvm::cl::cat(PartitionerCat));
+
+/// -partition-max-table-size - Command line option to shard embedding tables
+/// across devices.
+static llvm::cl::opt<uint64_t> partitionMaxTableSize(
+    "partition-max-table-size",
+    llvm::cl::desc("Shard by rows the embedding tables of SparseLengthsWeighted"
+                   "Sum nodes larger than this number of bytes, up to one "
+                   "shard per device, so that they are partitioned across "
+                   "devices. 0 disables sharding"),
+    llvm::cl::init(0), llvm::cl::cat(PartitionerCat));
+
+/// -partition-plan-cache - Command line option to save the partitions of the
+/// functions and load them back instead of partitioning again.
+static llvm::cl::opt<std::string> partitionPlanCache(
+    "partition-plan-cache",
+    llvm::cl::desc("Directory of the partition plans of the functions, by "
+                   "the hashes of the functions and of the devices. A "
+                   "function whose plan is found there is partitioned as "
+                   "the plan says, otherwise its plan is saved there"),
+    llvm::cl::value_desc("dir"), llvm::cl::init(""),
+    llvm::cl::cat(PartitionerCat));
+
 using namespace glow;
 using llvm::isa;
 
@@ -72,6 +135,58 @@ void Partitioner::init() {
   }
 }
 
+void Partitioner::setSRAMPrioritization(const DAGListTy &partitions) {
+  for (const auto &dag : partitions) {
+    for (const auto &node : dag.nodes) {
+      Function *subF = module_->getFunction(node->name);
+      auto &hints = node->backendHints.SRAMPrioritization;
+      if (!subF || !hints.empty()) {
+        continue;
+      }
+      // The devices of a backend are assumed to have the same SRAM, as they
+      // are assumed to have the same memory.
+      uint64_t sramCapacity = 0;
+      for (const auto &device : deviceInfo_) {
+        if (device.backendName == node->backendName) {
+          sramCapacity = device.sramCapacity;
+          break;
+        }
+      }
+      if (sramCapacity) {
+        hints = getSRAMPrioritization(subF, sramCapacity);
+      }
+    }
+  }
+}
+
+BackendInfo Partitioner::getPeakBackendInfo(llvm::StringRef backendName) const {
+  BackendInfo backendInfo;
+  for (const auto &device : deviceInfo_) {
+    if (device.backendName == backendName) {
+      backendInfo.sramCapacity = device.sramCapacity;
+      backendInfo.peakCompute = device.peakCompute;
+      backendInfo.peakDramBw = device.peakDramBw;
+      backendInfo.peakSramBw = device.peakSramBw;
+      break;
+    }
+  }
+  return backendInfo;
+}
+
+void Partitioner::setMemoryBoundHints(const DAGListTy &partitions) {
+  for (const auto &dag : partitions) {
+    for (const auto &node : dag.nodes) {
+      Function *subF = module_->getFunction(node->name);
+      if (!subF) {
+        continue;
+      }
+      BackendInfo backendInfo = getPeakBackendInfo(node->backendName);
+      node->backendHints.memoryBound =
+          isMemoryBound(getFunctionCost(subF, backendInfo), backendInfo);
+    }
+  }
+}
+
 Error Partitioner::finalize(const DAGListTy &partitions,
                             const NodeToFunctionMap &mapping) {
 
@@ -84,6 +199,9 @@ Error Partitioner::finalize(const DAGListTy &partitions,
     }
   }
 
+  setSRAMPrioritization(partitions);
+  setMemoryBoundHints(partitions);
+
   if (logPartition) {
     LOG(INFO) << "The number of partitions is : "
               << module_->getFunctions().size()
@@ -105,6 +223,78 @@ Error Partitioner::finalize(const DAGListTy &partitions,
                     subF->getName().str() + "__" + node->backendName + ".dot");
     }
   }
+
+  if (!partitionCostReport.empty()) {
+    RETURN_IF_ERR(
+        dumpCostReport(partitions, partitionCostReport, partitionCostProfile));
+  }
+  return Error::success();
+}
+
+Error Partitioner::dumpCostReport(const DAGListTy &partitions,
+                                  llvm::StringRef filename,
+                                  llvm::StringRef profile) {
+  llvm::StringMap<float> measured;
+  if (!profile.empty()) {
+    ASSIGN_VALUE_OR_RETURN_ERR(measured, loadNodeTimeProfile(profile));
+  }
+
+  std::error_code EC;
+  llvm::raw_fd_ostream os(filename, EC, llvm::sys::fs::F_None);
+  if (EC) {
+    return MAKE_ERR(ErrorValue::ErrorCode::PARTITIONER_ERROR,
+                    "Unable to open the cost report " + filename.str());
+  }
+
+  // Times are reported in microseconds, and the measured time is left empty
+  // for the nodes which are missing from the profile.
+  auto printMeasured = [&](bool found, float time) {
+    if (found) {
+      os << llvm::format("%.3f", time * 1e6);
+    }
+    os << "\n";
+  };
+
+  os << "partition,backend,node,kind,ops,dram_bytes,sram_bytes,"
+        "arithmetic_intensity,estimated_us,measured_us\n";
+  for (const auto &dag : partitions) {
+    for (const auto &node : dag.nodes) {
+      Function *subF = module_->getFunction(node->name);
+      if (!subF) {
+        return MAKE_ERR(ErrorValue::ErrorCode::PARTITIONER_ERROR,
+                        "Invalid function name " + node->name);
+      }
+      BackendInfo backendInfo = getPeakBackendInfo(node->backendName);
+
+      NodeCost total;
+      float totalMeasured = 0;
+      bool allMeasured = true;
+      for (auto &N : subF->getNodes()) {
+        NodeCost cost = getNodeCost(&N, backendInfo);
+        total.ops += cost.ops;
+        total.dramBytes += cost.dramBytes;
+        total.sramBytes += cost.sramBytes;
+        total.time += cost.time;
+        auto it = measured.find(N.getName());
+        bool found = it != measured.end();
+        float measuredTime = found ? it->second : 0;
+        allMeasured &= found;
+        totalMeasured += measuredTime;
+
+        os << node->name << "," << node->backendName << "," << N.getName()
+           << "," << N.getKindName() << "," << cost.ops << "," << cost.dramBytes
+           << "," << cost.sramBytes << ","
+           << llvm::format("%.3f", cost.getArithmeticIntensity()) << ","
+           << llvm::format("%.3f", cost.time * 1e6) << ",";
+        printMeasured(found, measuredTime);
+      }
+      os << node->name << "," << node->backendName << ",total,," << total.ops
+         << "," << total.dramBytes << "," << total.sramBytes << ","
+         << llvm::format("%.3f", total.getArithmeticIntensity()) << ","
+         << llvm::format("%.3f", total.time * 1e6) << ",";
+      printMeasured(!measured.empty() && allMeasured, totalMeasured);
+    }
+  }
   return Error::success();
 }
 
@@ -494,12 +684,20 @@ Expected<DAGListTy> Partitioner::loadBalancedPartition(CompilationContext &cctx,
   std::vector<GraphMemInfo> graphMem(numDevices, GraphMemInfo{});
   std::vector<Function *> partitionFuncs(numDevices);
 
-  // Compute total roofline time
+  // Compute total roofline time, or the total measured time when a profile of
+  // the nodes is given.
+  llvm::StringMap<float> profile;
+  if (!partitionProfile.empty()) {
+    llvm::StringMap<float> measured;
+    ASSIGN_VALUE_OR_RETURN_ERR(measured, loadNodeTimeProfile(partitionProfile));
+    profile = getNodeProfile(F_, measured);
+  }
+  auto nodeTimes =
+      getNodeTimes(F_, backendMap_[deviceInfo_[0].backendName], profile);
   NodeToFunctionMap partitionMap;
   float totalRooflineTime = 0;
   for (auto &n : F_->getNodes()) {
-    totalRooflineTime +=
-        getNodeComputeTime(&n, backendMap_[deviceInfo_[0].backendName]);
+    totalRooflineTime += nodeTimes[&n];
   }
 
   float timePerPartition = totalRooflineTime / numDevices;
@@ -540,8 +738,7 @@ Expected<DAGListTy> Partitioner::loadBalancedPartition(CompilationContext &cctx,
         }
       }
 
-      auto curOpTime =
-          getNodeComputeTime(N, backendMap_[deviceInfo_[0].backendName]);
+      auto curOpTime = nodeTimes[N];
       auto curOpMemory = getNodeMemUsage(N);
 
       // Find a partition to put this node into
@@ -606,6 +803,90 @@ Expected<DAGListTy> Partitioner::loadBalancedPartition(CompilationContext &cctx,
   return std::move(partitions);
 }
 
+Expected<DAGListTy> Partitioner::minCutPartition(CompilationContext &cctx) {
+  if (module_->getFunctions().size() != 1) {
+    return MAKE_ERR(
+        ErrorValue::ErrorCode::PARTITIONER_ERROR,
+        strFormat("Invalid : %lu functions in a module. Now in min-cut "
+                  "partition flow, the module can only contain 1 function",
+                  module_->getFunctions().size()));
+  }
+
+  if (multiBackendNames_) {
+    VLOG(1) << "For multi backend types, min-cut partition can't be applied. "
+               "Call heterogeneous partition instead.";
+    return heterogeneousPartition(cctx);
+  }
+  F_ = selectRepFunc(module_, memSize_);
+  std::string origName(F_->getName().data());
+  std::vector<Backend *> backends;
+  genBackendMap(backendMap_, backendHolder, backends);
+  auto backendName = backends[0]->getBackendName();
+  uint64_t availableMemory = backendMap_[backendName].memSize;
+  if (!optimized_) {
+    RETURN_IF_ERR(::glow::optimizeFunction(F_, *(backends[0]), cctx));
+  }
+
+  // Step 1 : get the initial cut based on BFS levels and availableMemory, as
+  // in selectPartitions. The nodes of a partition only use the nodes of the
+  // same or of earlier partitions.
+  std::vector<NodesSet> nodesSets(1);
+  GraphMemInfo graphMem;
+  BFSLevel bfs = getBFSLevel(F_);
+  for (int i = bfs.size() - 1; i >= 0; i--) {
+    for (Node *N : bfs[i]) {
+      graphMem = updateGraphMemInfoByAddingNode(nodesSets.back(), graphMem, N);
+      if (graphMem.getTotalMemSize() > availableMemory) {
+        if (nodesSets.back().empty()) {
+          return MAKE_ERR(ErrorValue::ErrorCode::PARTITIONER_ERROR,
+                          "Node " + N->getName().str() +
+                              " doesn't fit in the device memory");
+        }
+        nodesSets.emplace_back();
+        graphMem =
+            updateGraphMemInfoByAddingNode(nodesSets.back(), GraphMemInfo{}, N);
+      }
+      nodesSets.back().insert(N);
+    }
+  }
+
+  // Step 2 : move nodes between the partitions to minimize the bytes sent
+  // from one partition to another.
+  VLOG(1) << "Initial boundary bytes " << getBoundaryBytes(nodesSets);
+  minimizeBoundaryBytes(nodesSets, availableMemory);
+  VLOG(1) << "Final boundary bytes " << getBoundaryBytes(nodesSets);
+
+  NodeToFunctionMap partitionMap;
+  for (size_t i = 0, e = nodesSets.size(); i < e; i++) {
+    Function *newF = module_->createFunction(std::string(F_->getName()) +
+                                             "_part" + std::to_string(i + 1));
+    partitionMap.createPartition(newF, backendName);
+    for (Node *N : nodesSets[i]) {
+      partitionMap.add(N, newF);
+    }
+    partitionMap.setGraphMemInfo(newF, getGraphMemInfo(nodesSets[i]));
+  }
+
+  // Check if the memory usage meets the device memory limitation.
+  RETURN_IF_ERR(memoryUsageValidation(partitionMap, backendMap_));
+
+  logicalDeviceID_ = assignLogicalDeviceID(partitionMap, backendMap_);
+  RETURN_IF_ERR(logicalDevicesValidation(partitionMap, backendMap_));
+
+  DAGListTy partitions =
+      doPartitioning(origName, {F_}, module_, partitionMap, /* saveDAG */ true);
+  module_->eraseFunction(F_);
+
+  if (saturateHost_ &&
+      partitionMap.getPartitions().size() < deviceInfo_.size()) {
+    saturateHost(logicalDeviceID_, partitions);
+  }
+
+  RETURN_IF_ERR(finalize(partitions, partitionMap));
+
+  return std::move(partitions);
+}
+
 Expected<DAGListTy>
 Partitioner::quantizationProfilingPartition(CompilationContext &cctx) {
   // For quantization profiling flow, currently we assume there is only 1
@@ -760,7 +1041,8 @@ Partitioner::heterogeneousPartition(CompilationContext &cctx) {
 }
 
 Expected<DAGListTy>
-Partitioner::partitionFromConfig(const PartitionConfig &partitionConfig) {
+Partitioner::partitionFromConfig(const PartitionConfig &partitionConfig,
+                                 bool optimizePartitions) {
   DAGListTy partitions;
   // Prepare the mapping between BackendName and BackendInfo.
   std::vector<Backend *> backends;
@@ -776,6 +1058,14 @@ Partitioner::partitionFromConfig(const PartitionConfig &partitionConfig) {
       partitionConfig.numOfPartitions == partitionConfig.backendNames.size() &&
       partitionConfig.numOfPartitions == partitionConfig.partitionNames.size())
       << "Invalid user-defined partition config.";
+  RETURN_ERR_IF_NOT(partitionConfig.partitionPredicates.empty() ||
+                        partitionConfig.partitionPredicates.size() ==
+                            partitionConfig.numOfPartitions,
+                    "Invalid number of partition predicates.");
+  RETURN_ERR_IF_NOT(partitionConfig.logicalIDs.empty() ||
+                        partitionConfig.logicalIDs.size() ==
+                            partitionConfig.numOfPartitions,
+                    "Invalid number of partition logical devices.");
 
   NodeToFunctionMap partitionMap;
   std::vector<Function *> funcList;
@@ -826,7 +1116,20 @@ Partitioner::partitionFromConfig(const PartitionConfig &partitionConfig) {
   RETURN_IF_ERR(memoryUsageValidation(partitionMap, backendMap_));
 
   // Logical device ID validation.
-  logicalDeviceID_ = assignLogicalDeviceID(partitionMap, backendMap_);
+  if (partitionConfig.logicalIDs.empty()) {
+    logicalDeviceID_ = assignLogicalDeviceID(partitionMap, backendMap_);
+  } else {
+    logicalDeviceID_ = 0;
+    for (size_t i = 0; i < partitionConfig.numOfPartitions; i++) {
+      RETURN_ERR_IF_NOT(!partitionConfig.logicalIDs[i].empty(),
+                        "No logical device for partition " +
+                            partitionConfig.partitionNames[i]);
+      for (DeviceIDTy id : partitionConfig.logicalIDs[i]) {
+        partitionMap.appendLogicalDeviceID(funcList[i], id);
+        logicalDeviceID_ = std::max<DeviceIDTy>(logicalDeviceID_, id + 1);
+      }
+    }
+  }
   RETURN_IF_ERR(logicalDevicesValidation(partitionMap, backendMap_));
 
   // Do partition.
@@ -837,13 +1140,22 @@ Partitioner::partitionFromConfig(const PartitionConfig &partitionConfig) {
   // DAG validation.
   RETURN_IF_ERR(dagValidation(partitions[0]));
 
+  // Predicate the nodes of the partitions.
+  for (size_t i = 0; i < partitionConfig.partitionPredicates.size(); i++) {
+    for (auto &node : partitions[0].nodes) {
+      if (node->name == partitionConfig.partitionNames[i]) {
+        node->predicate = partitionConfig.partitionPredicates[i];
+      }
+    }
+  }
+
   // Do optimization based on backendName.
   for (size_t i = 0; i < partitionConfig.numOfPartitions; i++) {
     auto func = funcList[i];
     DCHECK(func->verify()) << "Conversion led to invalid function";
     std::unique_ptr<Backend> backend(
         createBackend(partitionConfig.backendNames[i]));
-    if (!optimized_) {
+    if (!optimized_ && optimizePartitions) {
       CompilationContext cctx;
       RETURN_IF_ERR(::glow::optimizeFunction(func, *backend, cctx));
     }
@@ -854,6 +1166,23 @@ Partitioner::partitionFromConfig(const PartitionConfig &partitionConfig) {
   return std::move(partitions);
 }
 
+void Partitioner::shardEmbeddingTables() {
+  ShardedTablesMap shardedTables;
+  for (Function *F : module_->getFunctions()) {
+    unsigned numSharded = glow::shardEmbeddingTables(
+        F, partitionMaxTableSize, deviceInfo_.size(), shardedTables);
+    VLOG(1) << "Sharded " << numSharded << " embedding table lookups of "
+            << F->getName().str();
+  }
+  // Only the shards of the tables are needed now.
+  for (auto &table : shardedTables) {
+    if (!table.first->hasUsers()) {
+      module_->eraseConstant(table.first);
+    }
+  }
+  memSize_ = module_->getConstantsSize();
+}
+
 Expected<DAGListTy> Partitioner::partition(CompilationContext &cctx) {
   if (partitionConfig_.enabled()) {
     // Call user-defined partition flow.
@@ -865,11 +1194,119 @@ Expected<DAGListTy> Partitioner::partition(CompilationContext &cctx) {
     return quantizationProfilingPartition(cctx);
   }
 
-  if (!multiBackendNames_ && glow::GlowEnableLoadBalancedPartitioning) {
-    // Call load-balance partition flow.
-    return loadBalancedPartition(cctx);
+  if (partitionMaxTableSize) {
+    shardEmbeddingTables();
+  }
+
+  // Partition the function as its saved plan says if there is one. Only the
+  // plans of a single function on a single type of backend are saved.
+  std::string planFile;
+  if (!partitionPlanCache.empty() && !multiBackendNames_ &&
+      module_->getFunctions().size() == 1) {
+    planFile = getPartitionPlanFile(module_->getFunctions().front());
+    if (llvm::sys::fs::exists(planFile)) {
+      auto plan = deserializePartitionConfig(planFile);
+      if (plan) {
+        VLOG(1) << "Partitioning as the plan " << planFile << " says";
+        return partitionFromPlan(*plan, cctx);
+      }
+      LOG(WARNING) << "Ignoring the partition plan " << planFile << ": "
+                   << ERR_TO_STRING(plan.takeError());
+    }
+  }
+
+  // Call the load-balance, the min-cut or the heterogeneous partition flow.
+  bool loadBalanced =
+      !multiBackendNames_ && glow::GlowEnableLoadBalancedPartitioning;
+  bool minCut = !multiBackendNames_ && glow::GlowEnableMinCutPartitioning;
+  auto partitions = loadBalanced
+                        ? loadBalancedPartition(cctx)
+                        : minCut ? minCutPartition(cctx)
+                                 : heterogeneousPartition(cctx);
+  if (partitions && !planFile.empty()) {
+    savePartitionPlan(*partitions, planFile);
+  }
+  return partitions;
+}
+
+std::string Partitioner::getPartitionPlanFile(const Function *F) const {
+  // The plan depends on the function, on the devices and on the options of
+  // the partitioning.
+  std::string key;
+  llvm::raw_string_ostream os(key);
+  F->dump(os);
+  for (const auto &device : deviceInfo_) {
+    os << device.backendName << ' ' << device.availableMemory << ' '
+       << device.sramCapacity << ' ' << device.supportedNodes << ' '
+       << device.nonSupportedNodes << '\n';
+  }
+  os << saturateHost_ << optimized_ << glow::GlowEnableLoadBalancedPartitioning
+     << glow::GlowEnableMinCutPartitioning;
+  uint64_t hash = llvm::xxHash64(os.str());
+
+  llvm::SmallString<128> path(partitionPlanCache);
+  llvm::sys::path::append(path, strFormat("%s_%016llx.yaml",
+                                          F->getName().str().c_str(),
+                                          (unsigned long long)hash));
+  return path.str().str();
+}
+
+void Partitioner::savePartitionPlan(const DAGListTy &partitions,
+                                    llvm::StringRef planFile) {
+  // Not partitioning is fast anyway.
+  if (partitions.size() != 1 || partitions[0].nodes.size() < 2) {
+    return;
+  }
+  const DAG &dag = partitions[0];
+  PartitionConfig plan;
+  plan.funcName = dag.root->name;
+  plan.numOfPartitions = dag.nodes.size();
+  llvm::StringMap<size_t> indices;
+  bool hasPredicates = false;
+  for (const auto &node : dag.nodes) {
+    indices[node->name] = plan.partitionNames.size();
+    plan.partitionNames.push_back(node->name);
+    plan.backendNames.push_back(node->backendName);
+    plan.partitionPredicates.push_back(node->predicate);
+    plan.logicalIDs.push_back(node->logicalDevices);
+    hasPredicates |= !node->predicate.empty();
+  }
+  if (!hasPredicates) {
+    plan.partitionPredicates.clear();
+  }
+  for (const auto &it : nodePartitions_) {
+    auto indexIt = indices.find(it.second);
+    if (indexIt != indices.end()) {
+      plan.nodeToPartition[it.first()] = indexIt->second;
+    }
+  }
+
+  auto err = llvm::sys::fs::create_directories(partitionPlanCache);
+  if (err) {
+    LOG(WARNING) << "Failed to create " << partitionPlanCache << ": "
+                 << err.message();
+    return;
   }
+  if (auto saveErr = serializePartitionConfig(plan, planFile)) {
+    LOG(WARNING) << "Failed to save the partition plan: "
+                 << ERR_TO_STRING(std::move(saveErr));
+    return;
+  }
+  VLOG(1) << "Saved the partition plan " << planFile.str();
+}
 
-  // Call heterogeneous partition flow.
-  return heterogeneousPartition(cctx);
+Expected<DAGListTy>
+Partitioner::partitionFromPlan(const PartitionConfig &plan,
+                               CompilationContext &cctx) {
+  // The plan was made on the function optimized for its backend, optimize it
+  // the same way first, and not the partitions after.
+  Function *F = module_->getFunction(plan.funcName);
+  RETURN_ERR_IF_NOT(F, "Can't find function " + plan.funcName,
+                    ErrorValue::ErrorCode::PARTITIONER_ERROR);
+  if (!optimized_) {
+    std::unique_ptr<Backend> backend(
+        createBackend(deviceInfo_[0].backendName));
+    RETURN_IF_ERR(::glow::optimizeFunction(F, *backend, cctx));
+  }
+  return partitionFromConfig(plan, /* optimizePartitions */ false);
 }
@@ -23,6 +23,94 @@
 using namespace glow;
 using llvm::isa;
 
+/// \returns whether \p CN converts \p from into \p to.
+static bool isConversion(const ConvertToNode *CN, ElemKind from, ElemKind to) {
+  return CN->getInput().getElementType() == from &&
+         CN->getResult().getElementType() == to;
+}
+
+/// Moves the conversions between Float16Ty and FloatTy at the boundaries of
+/// the partitions of \p mapping to the side where the value is in Float16Ty,
+/// so that the results crossing the partitions are half-size. Conversions
+/// only move between partitions of the same backend.
+static void moveBoundaryConversions(NodeToFunctionMap &mapping) {
+  // The conversions to Float16Ty of the FloatTy results of another partition
+  // move into that partition, if they are the only users of the results in
+  // their own partition.
+  for (auto *subF : mapping.getPartitions()) {
+    std::vector<ConvertToNode *> moved;
+    for (auto &N : subF->getNodes()) {
+      auto *CN = llvm::dyn_cast<ConvertToNode>(&N);
+      if (!CN || !isConversion(CN, ElemKind::FloatTy, ElemKind::Float16Ty) ||
+          isa<Storage>(CN->getInput().getNode())) {
+        continue;
+      }
+      Function *inputF = CN->getInput().getNode()->getParent();
+      if (inputF == subF || mapping.getPartitionBackendName(inputF) !=
+                                mapping.getPartitionBackendName(subF)) {
+        continue;
+      }
+      bool onlyConverted = true;
+      for (const auto &use : CN->getInput().getUsers()) {
+        const auto *user = use.getUser();
+        auto *userCN = llvm::dyn_cast<ConvertToNode>(user);
+        if (user->getParent() == subF &&
+            (!userCN || userCN->getResult().getElementType() !=
+                            ElemKind::Float16Ty)) {
+          onlyConverted = false;
+          break;
+        }
+      }
+      if (onlyConverted) {
+        moved.push_back(CN);
+      }
+    }
+    for (auto *CN : moved) {
+      Function *inputF = CN->getInput().getNode()->getParent();
+      inputF->takeOwnershipOfNode(CN);
+      mapping.add(CN, inputF);
+    }
+  }
+
+  // The conversions to FloatTy of the Float16Ty results of a partition are
+  // copied into the partitions using them.
+  std::vector<ConvertToNode *> unused;
+  for (auto *subF : mapping.getPartitions()) {
+    std::vector<std::pair<Node *, unsigned>> uses;
+    for (auto &N : subF->getNodes()) {
+      for (unsigned inp = 0, e = N.getNumInputs(); inp < e; inp++) {
+        auto *CN = llvm::dyn_cast<ConvertToNode>(N.getNthInput(inp).getNode());
+        if (!CN || !isConversion(CN, ElemKind::Float16Ty, ElemKind::FloatTy) ||
+            isa<Storage>(CN->getInput().getNode())) {
+          continue;
+        }
+        Function *inputF = CN->getParent();
+        if (inputF != subF && mapping.getPartitionBackendName(inputF) ==
+                                  mapping.getPartitionBackendName(subF)) {
+          uses.emplace_back(&N, inp);
+        }
+      }
+    }
+    llvm::DenseMap<Node *, Node *> copies;
+    for (auto &use : uses) {
+      auto *CN = use.first->getNthInput(use.second).getNode();
+      auto &copy = copies[CN];
+      if (!copy) {
+        copy = subF->addNode(CN->clone());
+        mapping.add(copy, subF);
+      }
+      use.first->setNthInput(use.second, copy);
+      if (!CN->hasUsers()) {
+        unused.push_back(llvm::cast<ConvertToNode>(CN));
+      }
+    }
+  }
+  for (auto *CN : unused) {
+    CN->getParent()->eraseNode(CN);
+    mapping.erase(CN);
+  }
+}
+
 // Current only partition the representative function.
 DAGListTy PartitionerBase::doPartitioning(llvm::StringRef funcName,
                                           std::vector<Function *> funcs,
@@ -39,14 +127,24 @@ DAGListTy PartitionerBase::doPartitioning(llvm::StringRef funcName,
   DAGRoot->deviceIDs = {0};
   DAGNode *root = DAGRoot.get();
 
-  llvm::DenseMap<Node *, Node *> currToNew;
-
-  // Clone nodes into target partition.
+  // Move nodes into target partition. The nodes keep their inputs, so the
+  // links between them don't need to be rebuilt, and the graph isn't copied.
   for (size_t i = 0, e = funcs.size(); i < e; i++) {
-    for (auto &N : funcs[i]->getNodes()) {
-      auto *clone = N.clone();
-      currToNew[&N] = clone;
-      mapping[&N]->addNode(clone);
+    auto &funcNodes = funcs[i]->getNodes();
+    for (auto it = funcNodes.begin(); it != funcNodes.end();) {
+      Node *N = &*it++;
+      Function *subF = mapping[N];
+      if (subF != funcs[i]) {
+        subF->takeOwnershipOfNode(N);
+      }
+    }
+  }
+
+  moveBoundaryConversions(mapping);
+  nodePartitions_.clear();
+  for (auto *subF : mapping.getPartitions()) {
+    for (auto &N : subF->getNodes()) {
+      nodePartitions_[N.getName()] = subF->getName();
     }
   }
 
@@ -136,22 +234,6 @@ DAGListTy PartitionerBase::doPartitioning(llvm::StringRef funcName,
     partitions.push_back(std::move(dag));
   }
 
-  // Update links between nodes in the cloned functions. Add placeholders (and
-  // save nodes) where a link crosses a partition boundary.
-  for (auto *subF : mapping.getPartitions()) {
-    for (auto &N : subF->getNodes()) {
-      for (int inp = 0, e = N.getNumInputs(); inp < e; inp++) {
-        auto input = N.getNthInput(inp);
-        if (isa<Storage>(input.getNode())) {
-          continue;
-        }
-        // Link this node to the clone of its input.
-        auto *clone = currToNew[input.getNode()];
-        N.setNthInput(inp, NodeValue(clone, input.getResNo()));
-      }
-    }
-  }
-
   // For all DAGNode without parents, link them to the root DAG.
   for (auto *subF : mapping.getPartitions()) {
     if (funcDAG[subF]->parents.size() == 0) {
@@ -249,4 +249,189 @@ assignLogicalDeviceID(NodeToFunctionMap &mapping,
   }
   return logicalDeviceID;
 }
+
+namespace {
+/// The index of the partition of every node.
+using PartitionIndexMap = llvm::DenseMap<const Node *, size_t>;
+
+/// \returns the bytes of the results of \p node which are used by other
+/// partitions than the partition of \p node in \p partOf.
+uint64_t getSentBytes(const Node *node, const PartitionIndexMap &partOf) {
+  uint64_t bytes = 0;
+  size_t part = partOf.find(node)->second;
+  for (size_t i = 0, e = node->getNumResults(); i < e; i++) {
+    std::set<size_t> receivers;
+    for (auto &U : node->getNthResult(i).getUsers()) {
+      auto it = partOf.find(U.getUser());
+      if (it != partOf.end() && it->second != part) {
+        receivers.insert(it->second);
+      }
+    }
+    bytes += receivers.size() * node->getType(i)->getSizeInBytes();
+  }
+  return bytes;
+}
+
+/// \returns the bytes sent by \p node and by the nodes whose results it uses,
+/// which are the only ones changed by a move of \p node.
+uint64_t getLocalSentBytes(const Node *node, const PartitionIndexMap &partOf) {
+  uint64_t bytes = getSentBytes(node, partOf);
+  for (const Node *input : getInputs(node)) {
+    if (partOf.count(input)) {
+      bytes += getSentBytes(input, partOf);
+    }
+  }
+  return bytes;
+}
+
+/// \returns whether \p node can move from partition \p from to partition \p to
+/// in \p partOf without using a later partition or being used by an earlier
+/// one.
+bool isOrderedMove(const Node *node, size_t from, size_t to,
+                   const PartitionIndexMap &partOf) {
+  if (to < from) {
+    for (const Node *input : getInputs(node)) {
+      auto it = partOf.find(input);
+      if (it != partOf.end() && it->second > to) {
+        return false;
+      }
+    }
+    return true;
+  }
+  for (size_t i = 0, e = node->getNumResults(); i < e; i++) {
+    for (auto &U : node->getNthResult(i).getUsers()) {
+      auto it = partOf.find(U.getUser());
+      if (it != partOf.end() && it->second < to) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+/// A move of a node to another partition, and the bytes it saves.
+struct BoundaryMove {
+  Node *node;
+  size_t from;
+  size_t to;
+  int64_t gain;
+};
+} // namespace
+
+uint64_t getBoundaryBytes(const std::vector<NodesSet> &partitions) {
+  PartitionIndexMap partOf;
+  for (size_t i = 0, e = partitions.size(); i < e; i++) {
+    for (const Node *N : partitions[i]) {
+      partOf[N] = i;
+    }
+  }
+  uint64_t bytes = 0;
+  for (const auto &p : partOf) {
+    bytes += getSentBytes(p.first, partOf);
+  }
+  return bytes;
+}
+
+void minimizeBoundaryBytes(std::vector<NodesSet> &partitions,
+                           uint64_t availableMemory) {
+  // The nodes are visited by partition and by name, so that ties between
+  // moves are broken the same way on every run.
+  PartitionIndexMap partOf;
+  std::vector<Node *> nodes;
+  std::vector<GraphMemInfo> mem(partitions.size());
+  for (size_t i = 0, e = partitions.size(); i < e; i++) {
+    size_t first = nodes.size();
+    for (Node *N : partitions[i]) {
+      partOf[N] = i;
+      nodes.push_back(N);
+    }
+    std::sort(nodes.begin() + first, nodes.end(),
+              [](const Node *a, const Node *b) {
+                return a->compareByName(*b);
+              });
+    mem[i] = getGraphMemInfo(partitions[i]);
+  }
+
+  auto moveNode = [&](Node *N, size_t from, size_t to) {
+    partitions[from].erase(N);
+    partitions[to].insert(N);
+    partOf[N] = to;
+    mem[from] = getGraphMemInfo(partitions[from]);
+    mem[to] = getGraphMemInfo(partitions[to]);
+  };
+
+  // Every pass moves each node at most once, then rolls back the moves past
+  // the best total gain of the pass. The passes stop once they gain nothing.
+  constexpr unsigned maxPasses = 8;
+  for (unsigned pass = 0; pass < maxPasses; pass++) {
+    std::unordered_set<const Node *> locked;
+    std::vector<BoundaryMove> moves;
+    int64_t totalGain = 0, bestGain = 0;
+    size_t bestMoves = 0;
+    while (true) {
+      // Collect the ordered moves of the unlocked nodes which don't empty a
+      // partition, best gain first.
+      std::vector<BoundaryMove> candidates;
+      for (Node *N : nodes) {
+        size_t from = partOf[N];
+        if (locked.count(N) || partitions[from].size() == 1) {
+          continue;
+        }
+        int64_t before = getLocalSentBytes(N, partOf);
+        for (size_t to : {from - 1, from + 1}) {
+          if (to >= partitions.size() || !isOrderedMove(N, from, to, partOf)) {
+            continue;
+          }
+          partOf[N] = to;
+          int64_t after = getLocalSentBytes(N, partOf);
+          partOf[N] = from;
+          candidates.push_back({N, from, to, before - after});
+        }
+      }
+      std::stable_sort(candidates.begin(), candidates.end(),
+                       [](const BoundaryMove &a, const BoundaryMove &b) {
+                         return a.gain > b.gain;
+                       });
+
+      // Take the best move which keeps both partitions within memory.
+      const BoundaryMove *best = nullptr;
+      for (const auto &move : candidates) {
+        if (updateGraphMemInfoByAddingNode(partitions[move.to], mem[move.to],
+                                           move.node)
+                .getTotalMemSize() > availableMemory) {
+          continue;
+        }
+        NodesSet remaining = partitions[move.from];
+        remaining.erase(move.node);
+        if (getGraphMemInfo(remaining).getTotalMemSize() > availableMemory) {
+          continue;
+        }
+        best = &move;
+        break;
+      }
+      if (!best) {
+        break;
+      }
+
+      moveNode(best->node, best->from, best->to);
+      locked.insert(best->node);
+      moves.push_back(*best);
+      totalGain += best->gain;
+      if (totalGain > bestGain) {
+        bestGain = totalGain;
+        bestMoves = moves.size();
+      }
+    }
+
+    // Roll back the moves past the best prefix of the pass.
+    while (moves.size() > bestMoves) {
+      const auto &move = moves.back();
+      moveNode(move.node, move.to, move.from);
+      moves.pop_back();
+    }
+    if (bestGain <= 0) {
+      break;
+    }
+  }
+}
 } // namespace glow
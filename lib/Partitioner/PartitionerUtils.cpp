@@ -15,7 +15,14 @@
  */
 
 #include "glow/Partitioner/PartitionerUtils.h"
+#include "glow/ExecutionContext/TraceEvents.h"
 #include "glow/Partitioner/PartitionerTypes.h"
+
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+#include <algorithm>
+#include <unordered_map>
 #include <unordered_set>
 
 using llvm::isa;
@@ -186,7 +193,44 @@ uint64_t getNodeMemUsage(const Node *node) {
   return size;
 }
 
-float getNodeComputeTime(const Node *node, const BackendInfo &backendInfo) {
+std::vector<std::string> getSRAMPrioritization(const Function *F,
+                                               uint64_t sramCapacity) {
+  // The Storage nodes in the order they are first used, and the number of
+  // times each of them is used. A SaveNode writes its output placeholder.
+  std::vector<Storage *> storages;
+  std::unordered_map<const Storage *, uint64_t> accesses;
+  for (const auto &N : F->getNodes()) {
+    for (size_t i = 0, e = N.getNumInputs(); i < e; i++) {
+      auto *S = llvm::dyn_cast<Storage>(N.getNthInput(i).getNode());
+      if (S && accesses[S]++ == 0) {
+        storages.push_back(S);
+      }
+    }
+  }
+  std::stable_sort(storages.begin(), storages.end(),
+                   [&](const Storage *lhs, const Storage *rhs) {
+                     uint64_t lhsAccesses = accesses[lhs];
+                     uint64_t rhsAccesses = accesses[rhs];
+                     if (lhsAccesses != rhsAccesses) {
+                       return lhsAccesses > rhsAccesses;
+                     }
+                     return lhs->getType()->getSizeInBytes() <
+                            rhs->getType()->getSizeInBytes();
+                   });
+
+  std::vector<std::string> names;
+  uint64_t left = sramCapacity;
+  for (const auto *S : storages) {
+    uint64_t size = S->getType()->getSizeInBytes();
+    if (size <= left) {
+      names.push_back(S->getName());
+      left -= size;
+    }
+  }
+  return names;
+}
+
+NodeCost getNodeCost(const Node *node, const BackendInfo &backendInfo) {
   // This code assumes all ops are BW limited from SRAM; except
   // if the input does not fit in SRAM -- then it is DRAM BW limited
   float peakDramBw = backendInfo.peakDramBw;
@@ -201,7 +245,7 @@ float getNodeComputeTime(const Node *node, const BackendInfo &backendInfo) {
   uint64_t sizeDram = 0;
   uint64_t sizeSram = 0;
   if (node->getKind() == Kinded::Kind::SaveNodeKind) {
-    return 0.0f;
+    return NodeCost();
   }
   // The memory bytes for embedding table lookups is data dependent,
   // so it needs to be calculated as per the number of indices accessed.
@@ -372,9 +416,38 @@ float getNodeComputeTime(const Node *node, const BackendInfo &backendInfo) {
   // Compute compute roofline as max of flops, DRAM, SRAM BW
   // See https://bit.ly/2UdJ3mz
   // Add epsilons to prevent seg faults on uninitialized peak values.
-  return std::max(totalOps * 1.0f / std::max(peakCompute, 1e-6f),
-                  std::max(sizeDram * 1.0f / std::max(peakDramBw, 1e-6f),
-                           sizeSram * 1.0f / std::max(peakSramBw, 1e-6f)));
+  NodeCost cost;
+  cost.ops = totalOps;
+  cost.dramBytes = sizeDram;
+  cost.sramBytes = sizeSram;
+  cost.time = std::max(totalOps * 1.0f / std::max(peakCompute, 1e-6f),
+                       std::max(sizeDram * 1.0f / std::max(peakDramBw, 1e-6f),
+                                sizeSram * 1.0f / std::max(peakSramBw, 1e-6f)));
+  return cost;
+}
+
+float getNodeComputeTime(const Node *node, const BackendInfo &backendInfo) {
+  return getNodeCost(node, backendInfo).time;
+}
+
+NodeCost getFunctionCost(const Function *F, const BackendInfo &backendInfo) {
+  NodeCost total;
+  for (const auto &N : F->getNodes()) {
+    NodeCost cost = getNodeCost(&N, backendInfo);
+    total.ops += cost.ops;
+    total.dramBytes += cost.dramBytes;
+    total.sramBytes += cost.sramBytes;
+    total.time += cost.time;
+  }
+  return total;
+}
+
+bool isMemoryBound(const NodeCost &cost, const BackendInfo &backendInfo) {
+  if (backendInfo.peakCompute <= 0 || backendInfo.peakDramBw <= 0) {
+    return false;
+  }
+  return cost.dramBytes / backendInfo.peakDramBw >
+         cost.ops / backendInfo.peakCompute;
 }
 
 /// Given nodes set \p currNodes and its memory usage info \p info, \returns the
@@ -526,4 +599,216 @@ void logPartitionInfo(const NodeToFunctionMap &partitions) {
               << partitions.getLogicalDeviceIDList(subF)[0] << "\n";
   }
 }
+
+Expected<llvm::StringMap<float>> loadNodeTimeProfile(llvm::StringRef filename) {
+  auto buffer = llvm::MemoryBuffer::getFile(filename);
+  if (!buffer) {
+    return MAKE_ERR(ErrorValue::ErrorCode::PARTITIONER_ERROR,
+                    "Unable to open the profile " + filename.str());
+  }
+  auto trace = llvm::json::parse(buffer.get()->getBuffer());
+  if (!trace) {
+    return MAKE_ERR(ErrorValue::ErrorCode::PARTITIONER_ERROR,
+                    "Invalid profile " + filename.str() + ": " +
+                        llvm::toString(trace.takeError()));
+  }
+  auto *events = trace->getAsArray();
+  if (!events) {
+    return MAKE_ERR(ErrorValue::ErrorCode::PARTITIONER_ERROR,
+                    "The profile " + filename.str() +
+                        " is not an array of trace events");
+  }
+
+  // Sum the durations, in microseconds, and count the events of every name.
+  llvm::StringMap<std::pair<double, uint64_t>> durations;
+  for (const auto &value : *events) {
+    auto *event = value.getAsObject();
+    if (!event) {
+      continue;
+    }
+    auto type = event->getString("ph");
+    auto name = event->getString("name");
+    auto duration = event->getNumber("dur");
+    if (!type || !name || !duration || type->size() != 1 ||
+        type->front() != TraceEvent::CompleteType) {
+      continue;
+    }
+    auto &sum = durations[*name];
+    sum.first += *duration;
+    sum.second++;
+  }
+
+  llvm::StringMap<float> times;
+  for (const auto &sum : durations) {
+    times[sum.getKey()] = sum.second.first / sum.second.second * 1e-6;
+  }
+  return times;
+}
+
+std::string getNodeProfileKey(const Node *node) {
+  std::string key = node->getKindName();
+  key += "(";
+  for (size_t i = 0, e = node->getNumInputs(); i < e; i++) {
+    key += (i ? ", " : "") + node->getNthInput(i).getType()->toString();
+  }
+  key += ") -> (";
+  for (size_t i = 0, e = node->getNumResults(); i < e; i++) {
+    key += (i ? ", " : "") + node->getType(i)->toString();
+  }
+  return key + ")";
+}
+
+llvm::StringMap<float> getNodeProfile(Function *F,
+                                      const llvm::StringMap<float> &nodeTimes) {
+  llvm::StringMap<std::pair<float, unsigned>> sums;
+  for (auto &N : F->getNodes()) {
+    auto it = nodeTimes.find(N.getName());
+    if (it == nodeTimes.end()) {
+      continue;
+    }
+    auto &sum = sums[getNodeProfileKey(&N)];
+    sum.first += it->second;
+    sum.second++;
+  }
+
+  llvm::StringMap<float> profile;
+  for (const auto &sum : sums) {
+    profile[sum.getKey()] = sum.second.first / sum.second.second;
+  }
+  return profile;
+}
+
+llvm::DenseMap<const Node *, float>
+getNodeTimes(Function *F, const BackendInfo &backendInfo,
+             const llvm::StringMap<float> &profile) {
+  llvm::DenseMap<const Node *, float> times;
+  std::vector<const Node *> unmeasured;
+  float measured = 0, estimated = 0;
+  for (auto &N : F->getNodes()) {
+    auto it = profile.find(getNodeProfileKey(&N));
+    if (it == profile.end()) {
+      unmeasured.push_back(&N);
+      continue;
+    }
+    times[&N] = it->second;
+    measured += it->second;
+    estimated += getNodeComputeTime(&N, backendInfo);
+  }
+
+  // The estimates are only meaningful relative to each other, so they are
+  // brought to the scale of the measured times.
+  float scale = measured > 0 && estimated > 0 ? measured / estimated : 1;
+  for (const Node *N : unmeasured) {
+    times[N] = getNodeComputeTime(N, backendInfo) * scale;
+  }
+  return times;
+}
+
+/// \returns the shards of the rows of \p table into \p numShards tables of
+/// the same number of rows, padded with zero rows, see shardEmbeddingTables.
+static std::vector<Constant *> shardTable(Module *mod, Constant *table,
+                                          unsigned numShards) {
+  auto dims = table->dims();
+  size_t rows = dims[0];
+  std::vector<size_t> shardDims(dims.begin(), dims.end());
+  shardDims[0] = (rows + numShards - 1) / numShards;
+  auto shardTy = mod->uniqueTypeWithNewShape(table->getType(), shardDims);
+  size_t rowSize = table->getType()->getSizeInBytes() / rows;
+  const char *src = table->getPayload().getUnsafePtr();
+
+  std::vector<Constant *> shards;
+  for (unsigned k = 0; k < numShards; k++) {
+    auto *shard = mod->createConstant(
+        shardTy, table->getName().str() + "_shard" + std::to_string(k));
+    char *dst = shard->getPayloadMutable().getUnsafePtr();
+    memset(dst, 0, shardTy->getSizeInBytes());
+    for (size_t r = k, i = 0; r < rows; r += numShards, i++) {
+      memcpy(dst + i * rowSize, src + r * rowSize, rowSize);
+    }
+    shards.push_back(shard);
+  }
+  return shards;
+}
+
+/// Replace \p SLWS by the sum of one node per table of \p shards, see
+/// shardEmbeddingTables.
+template <class SLWSNodeTy>
+static void shardSparseLengthsWeightedSum(Function *F, SLWSNodeTy *SLWS,
+                                          llvm::ArrayRef<Constant *> shards) {
+  std::string name = SLWS->getName();
+  unsigned numShards = shards.size();
+  NodeValue indices = SLWS->getIndices();
+  NodeValue weights = SLWS->getWeights();
+
+  // Bucket the indices by shard, and get their rows in their shard.
+  auto *shardOf = F->createModulo(name + "_shard_of", indices, numShards);
+  auto *numShardsSplat =
+      F->createSplat(name + "_num_shards", indices.getType(), numShards);
+  auto *rows = F->createDiv(name + "_rows", indices, numShardsSplat);
+  auto *zeros = F->createSplat(name + "_zeros", weights.getType(), 0);
+
+  // Sum the partial sums of the shards.
+  NodeValue sum;
+  for (unsigned k = 0; k < numShards; k++) {
+    auto suffix = std::to_string(k);
+    auto *shardId =
+        F->createSplat(name + "_shard_id" + suffix, indices.getType(), k);
+    auto *inShard =
+        F->createCmpEQ(name + "_in_shard" + suffix, shardOf, shardId);
+    auto *shardWeights = F->createSelect(name + "_weights" + suffix, inShard,
+                                         weights, zeros);
+    Node *partial = SLWS->clone();
+    partial->setName(name + "_shard" + suffix);
+    F->addNode(partial);
+    partial->setNthInput(SLWSNodeTy::DataIdx, shards[k]);
+    partial->setNthInput(SLWSNodeTy::WeightsIdx, shardWeights);
+    partial->setNthInput(SLWSNodeTy::IndicesIdx, rows);
+    sum = k ? F->createAdd(name + "_sum" + suffix, sum, partial)->getResult()
+            : partial->getNthResult(0);
+  }
+  SLWS->getResult().replaceAllUsesOfWith(sum);
+  F->eraseNode(SLWS);
+}
+
+unsigned shardEmbeddingTables(Function *F, uint64_t maxTableSize,
+                              unsigned maxShards,
+                              ShardedTablesMap &shardedTables) {
+  unsigned numSharded = 0;
+  std::vector<Node *> nodes;
+  for (auto &N : F->getNodes()) {
+    if (llvm::isa<SparseLengthsWeightedSumNode>(&N) ||
+        llvm::isa<FusedRowwiseQuantizedSparseLengthsWeightedSumNode>(&N)) {
+      nodes.push_back(&N);
+    }
+  }
+  for (Node *N : nodes) {
+    auto *table = llvm::dyn_cast<Constant>(N->getNthInput(0).getNode());
+    if (!table) {
+      continue;
+    }
+    auto it = shardedTables.find(table);
+    if (it == shardedTables.end()) {
+      uint64_t size = table->getType()->getSizeInBytes();
+      uint64_t numShards = std::min<uint64_t>(
+          (size + maxTableSize - 1) / maxTableSize,
+          std::min<uint64_t>(maxShards, table->dims()[0]));
+      if (numShards < 2) {
+        continue;
+      }
+      it = shardedTables
+               .try_emplace(table,
+                            shardTable(F->getParent(), table, numShards))
+               .first;
+    }
+    if (auto *SLWS = llvm::dyn_cast<SparseLengthsWeightedSumNode>(N)) {
+      shardSparseLengthsWeightedSum(F, SLWS, it->second);
+    } else {
+      shardSparseLengthsWeightedSum(
+          F, llvm::cast<FusedRowwiseQuantizedSparseLengthsWeightedSumNode>(N),
+          it->second);
+    }
+    numSharded++;
+  }
+  return numSharded;
+}
 } // namespace glow
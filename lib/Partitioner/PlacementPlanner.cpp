@@ -0,0 +1,159 @@
+/**
+ * Copyright (c) Glow Contributors. See CONTRIBUTORS file.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "glow/Partitioner/PlacementPlanner.h"
+
+#include "llvm/Support/FormatVariadic.h"
+
+#include <algorithm>
+#include <numeric>
+
+namespace glow {
+
+namespace {
+/// The state of a device while the replicas are placed.
+struct DeviceState {
+  /// The memory left, in bytes.
+  uint64_t memory;
+  /// The fraction of the time of the device left.
+  double time{1.0};
+};
+} // namespace
+
+Expected<PlacementPlan>
+planPlacement(llvm::ArrayRef<NetworkLoad> networks,
+              llvm::ArrayRef<runtime::DeviceInfo> devices) {
+  std::vector<DeviceState> state;
+  for (const auto &device : devices) {
+    state.push_back({device.availableMemory});
+  }
+  std::vector<std::vector<unsigned>> replicas(networks.size());
+  std::vector<double> served(networks.size(), 0);
+
+  auto fits = [&](size_t n, unsigned d) {
+    return devices[d].backendName == networks[n].backendName &&
+           state[d].memory >= networks[n].memory &&
+           std::find(replicas[n].begin(), replicas[n].end(), d) ==
+               replicas[n].end();
+  };
+  // \returns the requests per second a replica of n would serve on d.
+  auto getGain = [&](size_t n, unsigned d) {
+    double unserved = std::max(networks[n].targetQPS - served[n], 0.0);
+    return std::min(unserved, state[d].time * networks[n].replicaQPS);
+  };
+  auto isCurrent = [&](size_t n, unsigned d) {
+    const auto &current = networks[n].devices;
+    return std::find(current.begin(), current.end(), d) != current.end();
+  };
+  auto place = [&](size_t n, unsigned d) {
+    double gain = getGain(n, d);
+    replicas[n].push_back(d);
+    served[n] += gain;
+    state[d].memory -= networks[n].memory;
+    if (networks[n].replicaQPS > 0) {
+      state[d].time -= gain / networks[n].replicaQPS;
+    }
+  };
+
+  // Every network gets a replica, the largest ones first. A network stays on
+  // one of its devices if it still fits there, or goes to the device with
+  // the most time and then memory left.
+  std::vector<size_t> order(networks.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return networks[a].memory > networks[b].memory;
+  });
+  for (size_t n : order) {
+    int best = -1;
+    for (unsigned d = 0, e = devices.size(); d < e; d++) {
+      if (!fits(n, d)) {
+        continue;
+      }
+      if (best < 0) {
+        best = d;
+        continue;
+      }
+      bool current = isCurrent(n, d), bestCurrent = isCurrent(n, best);
+      if (current != bestCurrent) {
+        if (current) {
+          best = d;
+        }
+        continue;
+      }
+      if (state[d].time > state[best].time ||
+          (state[d].time == state[best].time &&
+           state[d].memory > state[best].memory)) {
+        best = d;
+      }
+    }
+    if (best < 0) {
+      return MAKE_ERR(
+          ErrorValue::ErrorCode::RUNTIME_OUT_OF_DEVICE_MEMORY,
+          llvm::formatv("Not enough memory to place the network {0}, which "
+                        "needs {1} bytes.",
+                        networks[n].name, networks[n].memory)
+              .str());
+    }
+    place(n, best);
+  }
+
+  // Add the replica serving the most requests until none serves more. Ties
+  // keep the replicas where they are, else go to the network with the most
+  // requests left unserved.
+  while (true) {
+    double bestGain = 0;
+    size_t bestNetwork = 0;
+    unsigned bestDevice = 0;
+    bool bestCurrent = false;
+    double bestUnserved = 0;
+    for (size_t n = 0, e = networks.size(); n < e; n++) {
+      double unserved = networks[n].targetQPS - served[n];
+      for (unsigned d = 0, de = devices.size(); d < de; d++) {
+        if (!fits(n, d)) {
+          continue;
+        }
+        double gain = getGain(n, d);
+        bool current = isCurrent(n, d);
+        if (gain < bestGain || gain <= 0) {
+          continue;
+        }
+        if (gain == bestGain &&
+            (bestCurrent > current ||
+             (bestCurrent == current && bestUnserved >= unserved))) {
+          continue;
+        }
+        bestGain = gain;
+        bestNetwork = n;
+        bestDevice = d;
+        bestCurrent = current;
+        bestUnserved = unserved;
+      }
+    }
+    if (bestGain <= 0) {
+      break;
+    }
+    place(bestNetwork, bestDevice);
+  }
+
+  PlacementPlan plan;
+  for (size_t n = 0, e = networks.size(); n < e; n++) {
+    std::sort(replicas[n].begin(), replicas[n].end());
+    plan.replicas[networks[n].name] = std::move(replicas[n]);
+    plan.servedQPS += served[n];
+  }
+  return plan;
+}
+
+} // namespace glow
@@ -138,6 +138,26 @@ Tensor tensor4BitsFusedRowwiseDequantization(const Tensor &input) {
   return output;
 }
 
+float getFused4BitRowwiseQuantizationError(const Tensor &input) {
+  assert(input.dims().size() == 2 && input.dims()[1] % 2 == 0 &&
+         "Input must be 2 dimensional, with an even number of columns.");
+  const size_t quantizedCols = input.dims()[1] / 2 + 2 * sizeof(float16_t);
+  Tensor quantized(ElemKind::UInt4FusedFP16QTy,
+                   {input.dims()[0], quantizedCols}, 1.0, 0);
+  tensorFusedRowwiseQuantization<float16_t>(input, quantized);
+  Tensor dequantized = tensor4BitsFusedRowwiseDequantization(quantized);
+  auto srcH = input.getHandle<float>();
+  auto destH = dequantized.getHandle<float>();
+  double error = 0;
+  double norm = 0;
+  for (size_t i = 0, e = input.size(); i < e; i++) {
+    double diff = double(destH.raw(i)) - srcH.raw(i);
+    error += diff * diff;
+    norm += double(srcH.raw(i)) * srcH.raw(i);
+  }
+  return norm ? std::sqrt(error / norm) : 0;
+}
+
 QuantizationTransform32To8 quantizeScaleOffset32To8(float scale,
                                                     int32_t offset) {
   // In this function we compute an efficient way to convert signed 32-bit
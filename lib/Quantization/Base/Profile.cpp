@@ -33,6 +33,54 @@ static size_t getBin(size_t nBins, float binWidth, float minValue,
   return result;
 }
 
+/// Redistribute the counts of \p histogram, whose bins cover [\p min, \p max],
+/// into the same number of bins covering [\p newMin, \p newMax], which must
+/// contain [\p min, \p max].
+static void rescaleHistogram(Handle<float> histogram, float min, float max,
+                             float newMin, float newMax) {
+  size_t nBins = histogram.size();
+  float destBinWidth = (newMax - newMin) / nBins;
+  float srcBinWidth = (max - min) / nBins;
+
+  std::vector<float> scaledHistogram(nBins, 0);
+
+  for (size_t i = 0; i < nBins; ++i) {
+    if (histogram.raw(i) == 0)
+      continue;
+
+    float srcBinBegin = min + srcBinWidth * i;
+    size_t destBin = (srcBinBegin - newMin) / destBinWidth;
+    float destBinEnd = newMin + destBinWidth * (destBin + 1);
+
+    float srcBinEnd = srcBinBegin + srcBinWidth;
+    size_t destBinToVerify = (srcBinEnd - newMin) / destBinWidth;
+    // Make sure that destination bin is mapped at most to 2 final bins, based
+    // on that redistribute percentage is calculated.
+    assert(destBinToVerify <= destBin + 2);
+    (void)destBinToVerify;
+
+    // Calculate how much we need to redistribute.
+    uint64_t dstBinCnt = static_cast<uint64_t>(
+        std::min(static_cast<float>(round((destBinEnd - srcBinBegin) /
+                                          srcBinWidth * histogram.raw(i))),
+                 histogram.raw(i)));
+
+    size_t newBin = getBin(nBins, destBinWidth, newMin, srcBinBegin);
+    scaledHistogram[newBin] += dstBinCnt;
+
+    if (dstBinCnt < histogram.raw(i)) {
+      size_t newBin =
+          getBin(nBins, destBinWidth, newMin, srcBinBegin + destBinWidth);
+      scaledHistogram[newBin] += histogram.raw(i) - dstBinCnt;
+    }
+  }
+
+  // Copy scaled histogram back to the histogram.
+  for (size_t i = 0, e = scaledHistogram.size(); i < e; ++i) {
+    histogram.raw(i) = scaledHistogram[i];
+  }
+}
+
 void generateTensorHistogram(const Handle<float> inputTensor,
                              Handle<float> existingHistogram, float &min,
                              float &max) {
@@ -51,47 +99,7 @@ void generateTensorHistogram(const Handle<float> inputTensor,
   if (minInput < min || maxInput > max) {
     float newMin = std::min(minInput, min);
     float newMax = std::max(maxInput, max);
-
-    float destBinWidth = (newMax - newMin) / nBins;
-    float srcBinWidth = (max - min) / nBins;
-
-    std::vector<float> scaledHistogram(nBins, 0);
-
-    for (size_t i = 0; i < nBins; ++i) {
-      if (existingHistogram.raw(i) == 0)
-        continue;
-
-      float srcBinBegin = min + srcBinWidth * i;
-      size_t destBin = (srcBinBegin - newMin) / destBinWidth;
-      float destBinEnd = newMin + destBinWidth * (destBin + 1);
-
-      float srcBinEnd = srcBinBegin + srcBinWidth;
-      size_t destBinToVerify = (srcBinEnd - newMin) / destBinWidth;
-      // Make sure that destination bin is mapped at most to 2 final bins, based
-      // on that redistribute percentage is calculated.
-      assert(destBinToVerify <= destBin + 2);
-      (void)destBinToVerify;
-
-      // Calculate how much we need to redistribute.
-      uint64_t dstBinCnt = static_cast<uint64_t>(std::min(
-          static_cast<float>(round((destBinEnd - srcBinBegin) / srcBinWidth *
-                                   existingHistogram.raw(i))),
-          existingHistogram.raw(i)));
-
-      size_t newBin = getBin(nBins, destBinWidth, newMin, srcBinBegin);
-      scaledHistogram[newBin] += dstBinCnt;
-
-      if (dstBinCnt < existingHistogram.raw(i)) {
-        size_t newBin =
-            getBin(nBins, destBinWidth, newMin, srcBinBegin + destBinWidth);
-        scaledHistogram[newBin] += existingHistogram.raw(i) - dstBinCnt;
-      }
-    }
-
-    // Copy scaled histogram back to the existing histogram.
-    for (size_t i = 0, e = scaledHistogram.size(); i < e; ++i) {
-      existingHistogram.raw(i) = scaledHistogram[i];
-    }
+    rescaleHistogram(existingHistogram, min, max, newMin, newMax);
 
     // Update global min and max.
     min = newMin;
@@ -105,5 +113,44 @@ void generateTensorHistogram(const Handle<float> inputTensor,
   }
 }
 
+void mergeTensorHistograms(const Handle<float> srcHistogram, float srcMin,
+                           float srcMax, Handle<float> destHistogram,
+                           float &destMin, float &destMax) {
+  size_t nBins = destHistogram.size();
+  assert(srcHistogram.size() == nBins && "Histograms must have the same bins");
+  if (srcHistogram.isZero()) {
+    return;
+  }
+  if (destHistogram.isZero()) {
+    for (size_t i = 0; i < nBins; ++i) {
+      destHistogram.raw(i) = srcHistogram.raw(i);
+    }
+    destMin = srcMin;
+    destMax = srcMax;
+    return;
+  }
+
+  float newMin = std::min(srcMin, destMin);
+  float newMax = std::max(srcMax, destMax);
+  if (newMin < destMin || newMax > destMax) {
+    rescaleHistogram(destHistogram, destMin, destMax, newMin, newMax);
+    destMin = newMin;
+    destMax = newMax;
+  }
+
+  // Bring the source histogram to the merged range before adding it.
+  Tensor scaled(ElemKind::FloatTy, {nBins});
+  auto scaledH = scaled.getHandle<float>();
+  for (size_t i = 0; i < nBins; ++i) {
+    scaledH.raw(i) = srcHistogram.raw(i);
+  }
+  if (newMin < srcMin || newMax > srcMax) {
+    rescaleHistogram(scaledH, srcMin, srcMax, newMin, newMax);
+  }
+  for (size_t i = 0; i < nBins; ++i) {
+    destHistogram.raw(i) += scaledH.raw(i);
+  }
+}
+
 } // namespace quantization
 } // namespace glow
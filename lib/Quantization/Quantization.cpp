@@ -18,6 +18,9 @@
 
 #include "glow/Backend/Backend.h"
 #include "glow/Converter/FunctionConverter.h"
+#include "glow/Quantization/Base/Profile.h"
+
+#include "llvm/ADT/DenseMap.h"
 
 #include <cmath>
 #include <unordered_set>
@@ -140,6 +143,41 @@ static Node *replaceQuantizedSigmoidWithLookupTable(Function &F,
   return rescaleOutputNode;
 }
 
+/// The extra cost of running in float an operation of a quantized node,
+/// relative to the cost of converting an element between float and the
+/// quantized type: quantized kernels process about four times as many
+/// elements per instruction.
+constexpr float kFloatOpCost = 0.75f;
+
+/// \returns an estimate of the number of operations of \p N: its
+/// multiply-accumulates for the matrix multiplications and the convolutions,
+/// and the number of elements of its results otherwise.
+static float getNumOps(const Node &N) {
+  switch (N.getKind()) {
+  case Kinded::Kind::ConvolutionNodeKind: {
+    auto filterDims = llvm::cast<ConvolutionNode>(&N)->getFilter().dims();
+    return float(N.getNthResult(0).getType()->size()) * filterDims[1] *
+           filterDims[2] * filterDims[3];
+  }
+  case Kinded::Kind::FullyConnectedNodeKind:
+    return float(N.getNthResult(0).getType()->size()) *
+           llvm::cast<FullyConnectedNode>(&N)->getWeights().dims()[0];
+  case Kinded::Kind::MatMulNodeKind:
+    return float(N.getNthResult(0).getType()->size()) *
+           llvm::cast<MatMulNode>(&N)->getLHS().dims()[1];
+  case Kinded::Kind::BatchMatMulNodeKind:
+    return float(N.getNthResult(0).getType()->size()) *
+           llvm::cast<BatchMatMulNode>(&N)->getLHS().dims()[2];
+  default: {
+    float ops = 0;
+    for (unsigned i = 0, e = N.getNumResults(); i < e; i++) {
+      ops += N.getNthResult(i).getType()->size();
+    }
+    return ops;
+  }
+  }
+}
+
 /// This class produces a quantized function based on a provided profile.
 class FunctionQuantizer : public FunctionConverter {
 protected:
@@ -159,9 +197,10 @@ protected:
     assert(outTQPIt != nodeToTQP_.end() &&
            "Missing quantization params for a node");
 
-    const TensorQuantizationParams &TQP = outTQPIt->second;
-    return mod_.uniqueType(quantizationPrecision_, out.dims(), TQP.scale,
-                           TQP.offset);
+    ElemKind precision = getActivationPrecision(*out.getNode());
+    TensorQuantizationParams TQP =
+        getParamsForPrecision(outTQPIt->second, precision);
+    return mod_.uniqueType(precision, out.dims(), TQP.scale, TQP.offset);
   }
 
   /// \see FunctionConverter::getTargetTypeForOutput.
@@ -250,14 +289,21 @@ protected:
           MM = llvm::cast<MatMulNode>(QN->getInput());
         }
 
-        float scaleInput = getTargetTypeForOutput(MM->getLHS())->getScale();
-        float scaleWeights = getTargetTypeForOutput(MM->getRHS())->getScale();
+        float scaleInput =
+            getTargetTypeForInput(*MM, MatMulNode::LHSIdx)->getScale();
+        float scaleWeights =
+            getTargetTypeForInput(*MM, MatMulNode::RHSIdx)->getScale();
         return mod_.uniqueType(ElemKind::Int32QTy, val.dims(),
                                scaleInput * scaleWeights, 0);
       }
     }
-    return mod_.uniqueType(quantizationPrecision_, val.dims(), TQP.scale,
-                           TQP.offset);
+    // The weights stay in the base precision when the activations of \p use
+    // are in Int16QTy.
+    ElemKind precision = isWeightsInput(use, idx)
+                             ? quantizationPrecision_
+                             : getActivationPrecision(use);
+    TensorQuantizationParams inTQP = getParamsForPrecision(TQP, precision);
+    return mod_.uniqueType(precision, val.dims(), inTQP.scale, inTQP.offset);
   }
 
   /// Macro to be put in a switch for all nodes that may need to be replaced by
@@ -282,6 +328,12 @@ protected:
       return false;
     }
 
+    // Dynamically quantized nodes quantize their float activations at
+    // runtime.
+    if (llvm::isa<DynamicQuantizedFullyConnectedNode>(&node)) {
+      return false;
+    }
+
     // Gather the input and output types that we will have once we quantize the
     // node, and check if the backend supports such a node. Note that if a node
     // has float inputs or outputs then we must have quantization parameters for
@@ -467,7 +519,7 @@ protected:
       TypeRef inTy =
           node.getNthInput(SingleMatchingInOutTypeInputIdx).getType();
       TypeRef fixedTy = mod_.uniqueType(
-          quantizationPrecision_,
+          inTy->getElementType(),
           node.getNthResult(SingleMatchingInOutTypeResultIdx).dims(),
           inTy->getScale(), inTy->getOffset());
 
@@ -503,7 +555,7 @@ protected:
     for (size_t i = 0, e = N->getNumInputs(); i < e; ++i) {                    \
       NodeValue input = N->getNthInput(i);                                     \
       auto argOutTy =                                                          \
-          mod_.uniqueType(quantizationPrecision_, input.dims(),                \
+          mod_.uniqueType(outputTy->getElementType(), input.dims(),            \
                           outputTy->getScale(), outputTy->getOffset());        \
       auto *rescale = function_.createRescaleQuantized(                        \
           input.getNode()->getName(), input, argOutTy);                        \
@@ -531,8 +583,9 @@ protected:
       TypeRef outputTy = getTargetTypeForOutputImpl(
           NodeValue(&node, SingleMatchingInOutTypeResultIdx));
       assert(outputTy->isQuantizedType() && "Node hasn't been quantized yet?!");
-      auto outTy = mod_.uniqueType(quantizationPrecision_, outputTy->dims(),
-                                   outputTy->getScale(), outputTy->getOffset());
+      auto outTy = mod_.uniqueType(outputTy->getElementType(),
+                                   outputTy->dims(), outputTy->getScale(),
+                                   outputTy->getOffset());
       NodeValue val = node.getNthResult(SingleMatchingInOutTypeResultIdx);
       // "val" may not have any users if the output goes unused, e.g. if we are
       // quantizing a TopKNode and only indices is used.
@@ -617,6 +670,16 @@ protected:
       auto name = NodeQuantizationInfo::generateNodeOutputName(
           dequantize->getName(), outNum);
 
+      // The users of the dequantize may be in another precision, so the
+      // params of the Int16QTy outputs are kept in the base precision.
+      if (outTy->getElementType() != quantizationPrecision_) {
+        auto it = nodeToTQP_.find(NodeQuantizationInfo::generateNodeOutputName(
+            node.getName(), outNum));
+        assert(it != nodeToTQP_.end() && "Missing quantization params");
+        TensorQuantizationParams TQP = it->second;
+        nodeToTQP_[name] = TQP;
+        continue;
+      }
       nodeToTQP_[name] = {outTy->getScale(), outTy->getOffset()};
     }
   } // namespace
@@ -642,6 +705,11 @@ private:
   const ElemKind quantizationPrecision_;
   /// Set of node kinds that should not be quantized.
   const KindSet &doNotQuantizeKinds_;
+  /// Set of node kinds whose activations are quantized to Int16QTy.
+  const KindSet &int16ActivationKinds_;
+  /// The precision of the activations of the nodes, decided before they are
+  /// converted, see getActivationPrecision.
+  mutable llvm::DenseMap<const Node *, ElemKind> activationPrecisions_;
   /// Map the (name of a node, idx) to its quantization parameters.
   std::unordered_map<std::string, TensorQuantizationParams> nodeToTQP_;
   /// For debug, keep track of the last node that we changed because of IR
@@ -678,23 +746,136 @@ private:
     return false;
   }
 
+  /// \returns whether \p node or the node it was lowered from is of one of
+  /// the kinds of int16ActivationKinds_.
+  bool isInt16ActivationKind(const Node &node) const {
+    if (int16ActivationKinds_.count(node.getKind())) {
+      return true;
+    }
+    // The MatMul of a lowered FullyConnected is only used by its BatchedAdd.
+    if (auto *MM = llvm::dyn_cast<MatMulNode>(&node)) {
+      auto *BA = MM->getResult().hasOneUse()
+                     ? llvm::dyn_cast<BatchedAddNode>(
+                           (*MM->getResult().getUsers().begin()).getUser())
+                     : nullptr;
+      return BA && BA->getBatch() == MM->getResult() && isBAFromLoweredFC(BA) &&
+             int16ActivationKinds_.count(
+                 Kinded::Kind::FullyConnectedNodeKind);
+    }
+    for (unsigned i = 0, e = node.getNumResults(); i < e; i++) {
+      auto it = loweredMap_.find(
+          NodeQuantizationInfo::generateNodeOutputName(node.getName(), i));
+      if (it == loweredMap_.end()) {
+        continue;
+      }
+      for (const auto &origin : it->getValue()) {
+        if (int16ActivationKinds_.count(origin.getKind())) {
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+
+  /// \returns whether the \p idx-th input of \p use holds the weights of a
+  /// Convolution or of a matrix multiplication.
+  static bool isWeightsInput(const Node &use, unsigned idx) {
+    switch (use.getKind()) {
+    case Kinded::Kind::ConvolutionNodeKind:
+      return idx == ConvolutionNode::FilterIdx;
+    case Kinded::Kind::FullyConnectedNodeKind:
+      return idx == FullyConnectedNode::WeightsIdx;
+    case Kinded::Kind::MatMulNodeKind:
+      return idx == MatMulNode::RHSIdx;
+    default:
+      return false;
+    }
+  }
+
+  /// \returns the params quantizing in \p precision the range which \p TQP
+  /// quantizes in quantizationPrecision_.
+  TensorQuantizationParams
+  getParamsForPrecision(const TensorQuantizationParams &TQP,
+                        ElemKind precision) const {
+    if (precision == quantizationPrecision_) {
+      return TQP;
+    }
+    Type baseTy(quantizationPrecision_, {1}, TQP.scale, TQP.offset);
+    auto range = baseTy.getQuantizedValueRange();
+    return chooseQuantizationParams(range.first, range.second, schema_,
+                                    precision);
+  }
+
+  /// \returns the precision of the activations of \p node: Int16QTy if it is
+  /// of one of int16ActivationKinds_ and the backend supports it with int16
+  /// activations and with its weights in Int8QTy, or quantizationPrecision_
+  /// otherwise. The precision is decided the first time \p node is queried,
+  /// before it is converted.
+  ElemKind getActivationPrecision(const Node &node) const {
+    if (int16ActivationKinds_.empty() ||
+        quantizationPrecision_ != ElemKind::Int8QTy) {
+      return quantizationPrecision_;
+    }
+    auto it = activationPrecisions_.find(&node);
+    if (it != activationPrecisions_.end()) {
+      return it->second;
+    }
+    if (!isInt16ActivationKind(node)) {
+      activationPrecisions_[&node] = quantizationPrecision_;
+      return quantizationPrecision_;
+    }
+
+    // Compute the types of \p node with int16 activations, the backend must
+    // support them.
+    activationPrecisions_[&node] = ElemKind::Int16QTy;
+    bool isSupported = true;
+    std::vector<TypeRef> inputTypes, outputTypes;
+    for (unsigned idx = 0, e = node.getNumInputs(); idx != e && isSupported;
+         ++idx) {
+      NodeValue val = node.getNthInput(idx);
+      isSupported = val.getElementType() != ElemKind::FloatTy ||
+                    quantizationParamsExist(val);
+      if (isSupported) {
+        inputTypes.push_back(getTargetTypeForInput(node, idx));
+      }
+    }
+    for (unsigned idx = 0, e = node.getNumResults(); idx != e && isSupported;
+         ++idx) {
+      NodeValue val = node.getNthResult(idx);
+      isSupported = val.getElementType() != ElemKind::FloatTy ||
+                    quantizationParamsExist(val);
+      if (isSupported) {
+        outputTypes.push_back(getTargetTypeForOutput(val));
+      }
+    }
+    if (!isSupported ||
+        !B_.isOpSupported(NodeInfo(node.getKind(), inputTypes, outputTypes))) {
+      activationPrecisions_[&node] = quantizationPrecision_;
+    }
+    return activationPrecisions_[&node];
+  }
+
 public:
   /// Creates a function quantizer for \p F using the quantization
   /// parameters defined by \p quantizationInfos and target quantization
   /// precision defined by \p quantizationPrecision.
   /// \p B and \p doNotQuantizeKinds are used to check which nodes shouldn't be
-  /// converted. \p assertAllNodesQuantized is used as a debugging tool; if
-  /// true then if the backend does not support a node as quantized for the
-  /// given \p quantizationPrecision then the program will exit with an error.
+  /// converted. The activations of the nodes of \p int16ActivationKinds are
+  /// quantized to Int16QTy when the backend supports it.
+  /// \p assertAllNodesQuantized is used as a debugging tool; if true then if
+  /// the backend does not support a node as quantized for the given
+  /// \p quantizationPrecision then the program will exit with an error.
   FunctionQuantizer(Function &F, const Backend &B, quantization::Schema schema,
                     llvm::ArrayRef<NodeQuantizationInfo> quantizationInfos,
                     ElemKind quantizationPrecision,
                     const KindSet &doNotQuantizeKinds,
+                    const KindSet &int16ActivationKinds,
                     const LoweredInfoMap &loweredMap,
                     bool assertAllNodesQuantized)
       : FunctionConverter(F), mod_(*F.getParent()), B_(B), schema_(schema),
         quantizationPrecision_(quantizationPrecision),
-        doNotQuantizeKinds_(doNotQuantizeKinds), loweredMap_(loweredMap),
+        doNotQuantizeKinds_(doNotQuantizeKinds),
+        int16ActivationKinds_(int16ActivationKinds), loweredMap_(loweredMap),
         assertAllNodesQuantized_(assertAllNodesQuantized) {
     // Build a mapping between node name and TensorQuantizatonParams.
     for (const auto &quantizationInfo : quantizationInfos) {
@@ -706,9 +887,113 @@ public:
     (void)assertAllNodesQuantized_;
   }
 
+  /// \returns a 4-bit fused rowwise-quantized copy of the float embedding
+  /// table \p table of a SparseLengthsWeightedSum of \p weights, \p indices
+  /// and \p lengths, or nullptr if the error of its quantization is above
+  /// \p maxError or the backend does not support it.
+  Constant *quantizeFused4BitTable(const Tensor &table, NodeValue weights,
+                                   NodeValue indices, NodeValue lengths,
+                                   float maxError) {
+    if (maxError <= 0 || table.getElementType() != ElemKind::FloatTy) {
+      return nullptr;
+    }
+    const auto fDims = flattenCdr(table.dims());
+    if (fDims.second % 2 != 0) {
+      return nullptr;
+    }
+    Tensor fTable = table.getUnowned({fDims.first, fDims.second});
+    if (quantization::getFused4BitRowwiseQuantizationError(fTable) >
+        maxError) {
+      return nullptr;
+    }
+
+    auto *dataTy = mod_.uniqueType(
+        ElemKind::UInt4FusedFP16QTy,
+        {fDims.first, fDims.second / 2 + 2 * sizeof(float16_t)}, 0.0, 0);
+    auto *resultTy = mod_.uniqueType(
+        ElemKind::FloatTy, {lengths.dims()[0], fDims.second});
+    if (!B_.isOpSupported(NodeInfo(
+            Kinded::Kind::FusedRowwiseQuantizedSparseLengthsWeightedSumNodeKind,
+            {dataTy, weights.getType(), indices.getType(), lengths.getType()},
+            {resultTy}))) {
+      return nullptr;
+    }
+    auto *data = mod_.createConstant(dataTy, "data");
+    quantization::tensorFusedRowwiseQuantization<float16_t>(
+        fTable, data->getPayloadMutable());
+    return data;
+  }
+
+  /// Replace the float FullyConnected nodes whose weights are Constant, or
+  /// the MatMul and BatchedAdd they were lowered to, by
+  /// DynamicQuantizedFullyConnected nodes if the backend supports them. This
+  /// must be done before the other nodes are converted, as their activations
+  /// have no profile.
+  void enableDynamic() {
+    if (doNotQuantizeKinds_.count(Kinded::Kind::FullyConnectedNodeKind)) {
+      return;
+    }
+
+    struct DynamicFC {
+      NodeValue input;
+      Constant *weights;
+      NodeValue bias;
+      NodeValue result;
+      llvm::SmallVector<Node *, 2> replaced;
+    };
+    std::vector<DynamicFC> candidates;
+    for (auto &node : function_.getNodes()) {
+      if (auto *FC = llvm::dyn_cast<FullyConnectedNode>(&node)) {
+        if (auto *W = llvm::dyn_cast<Constant>(FC->getWeights())) {
+          candidates.push_back(
+              {FC->getInput(), W, FC->getBias(), FC->getResult(), {FC}});
+        }
+        continue;
+      }
+      auto *BA = llvm::dyn_cast<BatchedAddNode>(&node);
+      if (!BA || !isBAFromLoweredFC(BA)) {
+        continue;
+      }
+      auto *MM = llvm::dyn_cast<MatMulNode>(BA->getBatch());
+      if (!MM || !MM->getResult().hasOneUse()) {
+        continue;
+      }
+      if (auto *W = llvm::dyn_cast<Constant>(MM->getRHS())) {
+        candidates.push_back(
+            {MM->getLHS(), W, BA->getSlice(), BA->getResult(), {BA, MM}});
+      }
+    }
+
+    for (auto &FC : candidates) {
+      if (FC.input.getElementType() != ElemKind::FloatTy ||
+          FC.weights->getElementType() != ElemKind::FloatTy ||
+          FC.bias.getElementType() != ElemKind::FloatTy ||
+          FC.result.getElementType() != ElemKind::FloatTy) {
+        continue;
+      }
+      auto wDims = FC.weights->dims();
+      auto *weightsTy =
+          mod_.uniqueType(ElemKind::Int8QTy, {wDims[1], wDims[0]}, 1.0, 0);
+      if (!B_.isOpSupported(NodeInfo(
+              Kinded::Kind::DynamicQuantizedFullyConnectedNodeKind,
+              {FC.input.getType(), weightsTy, FC.bias.getType()},
+              {FC.result.getType()}))) {
+        continue;
+      }
+      auto *DQFC = function_.createDynamicQuantizedFullyConnected(
+          "dynamicqfc", FC.input, FC.weights, FC.bias);
+      FC.result.replaceAllUsesOfWith(DQFC->getResult());
+      for (Node *N : FC.replaced) {
+        function_.eraseNode(N);
+      }
+    }
+  }
+
   /// Traverse all nodes to find applicable quantized nodes, and convert them
-  /// to RowwiseQuantized versions if required inputs are Constant.
-  void enableRowwise() {
+  /// to RowwiseQuantized versions if required inputs are Constant. The
+  /// embedding tables whose 4-bit quantization error is at most
+  /// \p fused4BitMaxError are quantized to 4 bits, the others to 8 bits.
+  void enableRowwise(float fused4BitMaxError) {
     auto nodeIt = function_.getNodes().end();
     auto stopIt = function_.getNodes().begin();
     do {
@@ -769,8 +1054,10 @@ public:
       }
       if (foundFC) {
         // Only convert quantized FullyConnected Node (or its equivalent lowered
-        // representation in MatMul + BatchedAdd form).
+        // representation in MatMul + BatchedAdd form), whose activations are
+        // in the base precision.
         if (input.getType()->isQuantizedType() &&
+            input.getElementType() == quantizationPrecision_ &&
             llvm::isa<QuantizeNode>(weights.getNode()) &&
             bias.getType()->isQuantizedType() &&
             result.getType()->isQuantizedType()) {
@@ -818,10 +1105,20 @@ public:
         assert(weightsQN && "Weights should have been quantized");
         NodeValue weightsF = weightsQN->getInput();
 
-        auto *FRWQSLWS =
-            function_.createFusedRowwiseQuantizedSparseLengthsWeightedSum(
-                SLWS->getName(), dataC->getPayloadMutable(), weightsF,
-                SLWS->getIndices(), SLWS->getLengths());
+        FusedRowwiseQuantizedSparseLengthsWeightedSumNode *FRWQSLWS;
+        if (auto *data4 = quantizeFused4BitTable(
+                dataC->getPayload(), weightsF, SLWS->getIndices(),
+                SLWS->getLengths(), fused4BitMaxError)) {
+          FRWQSLWS =
+              function_.createFusedRowwiseQuantizedSparseLengthsWeightedSum(
+                  SLWS->getName(), data4, weightsF, SLWS->getIndices(),
+                  SLWS->getLengths());
+        } else {
+          FRWQSLWS =
+              function_.createFusedRowwiseQuantizedSparseLengthsWeightedSum(
+                  SLWS->getName(), dataC->getPayloadMutable(), weightsF,
+                  SLWS->getIndices(), SLWS->getLengths());
+        }
 
         // Fused RWQSLWS stores the fused scales and offsets in trailing
         // columns. If the input was single dimensional then it adds extra
@@ -841,6 +1138,250 @@ public:
     cleanUp();
     assert(function_.verify() && "Conversion led to invalid function");
   }
+
+  /// \returns whether \p N computes quantized results, i.e. is one of the
+  /// nodes a region of quantized nodes is made of.
+  static bool isQuantizedCompute(const Node &N) {
+    if (llvm::isa<QuantizeNode>(&N) || llvm::isa<DequantizeNode>(&N) ||
+        llvm::isa<Storage>(&N) || llvm::isa<SaveNode>(&N)) {
+      return false;
+    }
+    for (unsigned i = 0, e = N.getNumResults(); i < e; i++) {
+      if (N.getNthResult(i).getType()->isQuantizedType()) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /// \returns the float type of \p val if it is quantized, or its type.
+  TypeRef getFloatType(NodeValue val) const {
+    if (!val.getType()->isQuantizedType()) {
+      return val.getType();
+    }
+    return mod_.uniqueType(ElemKind::FloatTy, val.dims());
+  }
+
+  /// \returns the quantized node whose result \p val is converted to float and
+  /// back by a Dequantize and a Quantize, or nullptr.
+  static Node *getRequantizedNode(NodeValue val) {
+    auto *QN = llvm::dyn_cast<QuantizeNode>(val.getNode());
+    if (!QN) {
+      return nullptr;
+    }
+    auto *DQN = llvm::dyn_cast<DequantizeNode>(QN->getInput().getNode());
+    if (!DQN || !isQuantizedCompute(*DQN->getInput().getNode())) {
+      return nullptr;
+    }
+    return DQN->getInput().getNode();
+  }
+
+  /// \returns whether the region of quantized nodes \p region can run in
+  /// float: all its quantized inputs are Quantizes, all the users of its
+  /// results are Dequantizes, and the backend supports its nodes in float.
+  bool canRunInFloat(const std::unordered_set<Node *> &region) const {
+    for (Node *N : region) {
+      if (llvm::isa<IntLookupTableNode>(N)) {
+        return false;
+      }
+      std::vector<TypeRef> inputTypes, outputTypes;
+      for (unsigned i = 0, e = N->getNumInputs(); i < e; i++) {
+        NodeValue in = N->getNthInput(i);
+        if (in.getType()->isQuantizedType() &&
+            !llvm::isa<QuantizeNode>(in.getNode())) {
+          return false;
+        }
+        inputTypes.push_back(getFloatType(in));
+      }
+      for (unsigned i = 0, e = N->getNumResults(); i < e; i++) {
+        NodeValue res = N->getNthResult(i);
+        if (res.getType()->isQuantizedType()) {
+          for (auto &U : res.getUsers()) {
+            if (!llvm::isa<DequantizeNode>(U.getUser())) {
+              return false;
+            }
+          }
+        }
+        outputTypes.push_back(getFloatType(res));
+      }
+      if (!llvm::isa<RescaleQuantizedNode>(N) &&
+          !B_.isOpSupported(NodeInfo(N->getKind(), inputTypes, outputTypes))) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /// \returns the cost of the conversions between float and the quantized
+  /// type at the boundaries of \p region, which running it in float removes.
+  /// Quantizes of Constants are folded at compile time and cost nothing.
+  static float getConversionCost(const std::unordered_set<Node *> &region) {
+    float cost = 0;
+    std::unordered_set<Node *> quantizes;
+    for (Node *N : region) {
+      for (unsigned i = 0, e = N->getNumInputs(); i < e; i++) {
+        auto *QN = llvm::dyn_cast<QuantizeNode>(N->getNthInput(i).getNode());
+        if (!QN || getRequantizedNode(QN->getResult()) ||
+            llvm::isa<Constant>(QN->getInput().getNode()) ||
+            !quantizes.insert(QN).second) {
+          continue;
+        }
+        // Quantizes also used outside the region are kept.
+        bool onlyUsedByRegion = true;
+        for (auto &U : QN->getResult().getUsers()) {
+          onlyUsedByRegion &= region.count(U.getUser()) != 0;
+        }
+        if (onlyUsedByRegion) {
+          cost += QN->getResult().getType()->size();
+        }
+      }
+      for (unsigned i = 0, e = N->getNumResults(); i < e; i++) {
+        NodeValue res = N->getNthResult(i);
+        for (auto &U : res.getUsers()) {
+          // Dequantizes only used by Quantizes into the region are internal.
+          bool usedOutsideRegion = false;
+          for (auto &DU : U.getUser()->getNthResult(0).getUsers()) {
+            auto *QN = llvm::dyn_cast<QuantizeNode>(DU.getUser());
+            if (!QN) {
+              usedOutsideRegion = true;
+              continue;
+            }
+            for (auto &QU : QN->getResult().getUsers()) {
+              usedOutsideRegion |= region.count(QU.getUser()) == 0;
+            }
+          }
+          if (usedOutsideRegion) {
+            cost += res.getType()->size();
+          }
+        }
+      }
+    }
+    return cost;
+  }
+
+  /// Convert the region of quantized nodes \p region to float, removing the
+  /// conversions between its nodes and at its boundaries.
+  void convertToFloat(const std::unordered_set<Node *> &region) {
+    std::unordered_set<Node *> conversions;
+    for (Node *N : region) {
+      for (unsigned i = 0, e = N->getNumInputs(); i < e; i++) {
+        auto *QN = llvm::dyn_cast<QuantizeNode>(N->getNthInput(i).getNode());
+        if (!QN) {
+          continue;
+        }
+        conversions.insert(QN);
+        NodeValue in = QN->getInput();
+        if (getRequantizedNode(QN->getResult())) {
+          auto *DQN = llvm::cast<DequantizeNode>(in.getNode());
+          conversions.insert(DQN);
+          in = DQN->getInput();
+        }
+        N->setNthInput(i, in);
+      }
+      for (unsigned i = 0, e = N->getNumResults(); i < e; i++) {
+        N->setType(i, getFloatType(N->getNthResult(i)));
+      }
+    }
+    for (Node *N : region) {
+      for (unsigned i = 0, e = N->getNumResults(); i < e; i++) {
+        NodeValue res = N->getNthResult(i);
+        std::vector<DequantizeNode *> dequantizes;
+        for (auto &U : res.getUsers()) {
+          if (auto *DQN = llvm::dyn_cast<DequantizeNode>(U.getUser())) {
+            dequantizes.push_back(DQN);
+          }
+        }
+        for (auto *DQN : dequantizes) {
+          DQN->getResult().replaceAllUsesOfWith(res);
+          conversions.insert(DQN);
+        }
+      }
+      // Rescales are no-ops in float.
+      if (auto *RQN = llvm::dyn_cast<RescaleQuantizedNode>(N)) {
+        RQN->getResult().replaceAllUsesOfWith(RQN->getInput());
+        conversions.insert(RQN);
+      }
+    }
+
+    // Erase the conversions which aren't used anymore, users first.
+    bool erased = true;
+    while (erased) {
+      erased = false;
+      for (auto it = conversions.begin(); it != conversions.end();) {
+        if ((*it)->getNthResult(0).getNumUsers() == 0) {
+          function_.eraseNode(*it);
+          it = conversions.erase(it);
+          erased = true;
+        } else {
+          ++it;
+        }
+      }
+    }
+  }
+
+  /// Run in float the regions of quantized nodes whose conversions at the
+  /// boundaries cost more than the float compute they save, so that the
+  /// Function has fewer precision transitions. A region is a set of quantized
+  /// nodes connected through Dequantize -> Quantize pairs, which the
+  /// conversion inserted between every pair of quantized nodes.
+  void minimizeConversions() {
+    std::unordered_set<Node *> visited;
+    std::vector<std::unordered_set<Node *>> regions;
+    for (auto &node : function_.getNodes()) {
+      if (!isQuantizedCompute(node) || visited.count(&node)) {
+        continue;
+      }
+      std::unordered_set<Node *> region;
+      std::vector<Node *> worklist{&node};
+      visited.insert(&node);
+      while (!worklist.empty()) {
+        Node *N = worklist.back();
+        worklist.pop_back();
+        region.insert(N);
+        std::vector<Node *> neighbors;
+        for (unsigned i = 0, e = N->getNumInputs(); i < e; i++) {
+          if (Node *producer = getRequantizedNode(N->getNthInput(i))) {
+            neighbors.push_back(producer);
+          }
+        }
+        for (unsigned i = 0, e = N->getNumResults(); i < e; i++) {
+          for (auto &U : N->getNthResult(i).getUsers()) {
+            auto *DQN = llvm::dyn_cast<DequantizeNode>(U.getUser());
+            if (!DQN) {
+              continue;
+            }
+            for (auto &DU : DQN->getResult().getUsers()) {
+              if (!llvm::isa<QuantizeNode>(DU.getUser())) {
+                continue;
+              }
+              for (auto &QU : DU.getUser()->getNthResult(0).getUsers()) {
+                if (isQuantizedCompute(*QU.getUser())) {
+                  neighbors.push_back(QU.getUser());
+                }
+              }
+            }
+          }
+        }
+        for (Node *neighbor : neighbors) {
+          if (visited.insert(neighbor).second) {
+            worklist.push_back(neighbor);
+          }
+        }
+      }
+      regions.push_back(std::move(region));
+    }
+
+    for (const auto &region : regions) {
+      float floatCost = 0;
+      for (Node *N : region) {
+        floatCost += kFloatOpCost * getNumOps(*N);
+      }
+      if (canRunInFloat(region) && getConversionCost(region) > floatCost) {
+        convertToFloat(region);
+      }
+    }
+    assert(function_.verify() && "Conversion led to invalid function");
+  }
 }; // namespace
 
 } // namespace
@@ -915,6 +1456,43 @@ generateNodeQuantizationInfos(PlaceholderBindings &bindings, const Function *F,
   return quantizationInfos;
 }
 
+void mergeQuantizationProfiles(PlaceholderBindings &bindings,
+                               const Function *F,
+                               const PlaceholderBindings &otherBindings,
+                               const Function *otherF) {
+  llvm::StringMap<const QuantizationProfileNode *> otherProfiles;
+  for (auto &node : otherF->getNodes()) {
+    if (auto *QPN = llvm::dyn_cast<QuantizationProfileNode>(&node)) {
+      otherProfiles[NodeQuantizationInfo::generateNodeOutputName(
+          QPN->getProfiledNodeName(), QPN->getProfiledOutputNumber())] = QPN;
+    }
+  }
+
+  for (auto &node : F->getNodes()) {
+    auto *QPN = llvm::dyn_cast<QuantizationProfileNode>(&node);
+    if (!QPN) {
+      continue;
+    }
+    auto it = otherProfiles.find(NodeQuantizationInfo::generateNodeOutputName(
+        QPN->getProfiledNodeName(), QPN->getProfiledOutputNumber()));
+    if (it == otherProfiles.end()) {
+      continue;
+    }
+    const QuantizationProfileNode *otherQPN = it->second;
+    auto CI = bindings.get(QPN->getComputationInfoPlaceholder())
+                  ->getHandle<float>();
+    auto histogram =
+        bindings.get(QPN->getHistogramPlaceholder())->getHandle<float>();
+    auto otherCI = otherBindings.get(otherQPN->getComputationInfoPlaceholder())
+                       ->getHandle<float>();
+    auto otherHistogram =
+        otherBindings.get(otherQPN->getHistogramPlaceholder())
+            ->getHandle<float>();
+    mergeTensorHistograms(otherHistogram, otherCI.raw(0), otherCI.raw(1),
+                          histogram, CI.raw(0), CI.raw(1));
+  }
+}
+
 void quantizeFunction(Function *F, const QuantizationConfiguration &quantConfig,
                       const Backend &B, const LoweredInfoMap &loweredMap,
                       const KindSet &doNotQuantizeKinds) {
@@ -925,10 +1503,17 @@ void quantizeFunction(Function *F, const QuantizationConfiguration &quantConfig,
 
   FunctionQuantizer quantizer(*F, B, quantConfig.schema, quantConfig.infos,
                               quantConfig.precision, doNotQuantizeKinds,
-                              loweredMap, quantConfig.assertAllNodesQuantized);
+                              quantConfig.int16ActivationKinds, loweredMap,
+                              quantConfig.assertAllNodesQuantized);
+  if (quantConfig.enableDynamic) {
+    quantizer.enableDynamic();
+  }
   quantizer.convert();
   if (quantConfig.enableRowwise) {
-    quantizer.enableRowwise();
+    quantizer.enableRowwise(quantConfig.fused4BitMaxError);
+  }
+  if (quantConfig.minimizeConversions) {
+    quantizer.minimizeConversions();
   }
 }
 
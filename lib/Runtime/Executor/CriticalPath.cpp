@@ -0,0 +1,254 @@
+/**
+ * Copyright (c) Glow Contributors. See CONTRIBUTORS file.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "glow/Runtime/Executor/CriticalPath.h"
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <map>
+#include <queue>
+
+using namespace glow;
+using namespace glow::runtime;
+
+/// \returns \p end - \p begin, or 0 if \p begin is later.
+static uint64_t since(uint64_t end, uint64_t begin) {
+  return end > begin ? end - begin : 0;
+}
+
+/// \returns the timestamp of the argument \p name of \p event, or \p def if
+/// the event has none.
+static uint64_t getTimestampArg(const TraceEvent &event, const char *name,
+                                uint64_t def) {
+  auto it = event.args.find(name);
+  uint64_t value;
+  if (it == event.args.end() ||
+      llvm::StringRef(it->second).getAsInteger(10, value)) {
+    return def;
+  }
+  return value;
+}
+
+CriticalPathAnalyzer::CriticalPathAnalyzer(const DAGNode *root) {
+  if (!root) {
+    return;
+  }
+  // Order the nodes parents first: a node is visited once all its parents
+  // were.
+  std::unordered_map<const DAGNode *, size_t> positions;
+  std::unordered_map<const DAGNode *, size_t> pendingParents;
+  std::queue<const DAGNode *> bfsQueue;
+  for (const auto *node : root->children) {
+    bfsQueue.push(node);
+  }
+  while (!bfsQueue.empty()) {
+    const DAGNode *node = bfsQueue.front();
+    bfsQueue.pop();
+    positions[node] = nodes_.size();
+    indices_[node->name] = nodes_.size();
+    nodes_.push_back(node);
+    for (const auto *child : node->children) {
+      auto it = pendingParents.find(child);
+      if (it == pendingParents.end()) {
+        size_t numParents =
+            std::count_if(child->parents.begin(), child->parents.end(),
+                          [root](const DAGNode *p) { return p != root; });
+        it = pendingParents.emplace(child, numParents).first;
+      }
+      if (--it->second == 0) {
+        bfsQueue.push(child);
+      }
+    }
+  }
+
+  parents_.resize(nodes_.size());
+  children_.resize(nodes_.size());
+  for (size_t i = 0, e = nodes_.size(); i < e; i++) {
+    for (const auto *parent : nodes_[i]->parents) {
+      auto it = positions.find(parent);
+      if (it != positions.end()) {
+        parents_[i].push_back(it->second);
+        children_[it->second].push_back(i);
+      }
+    }
+  }
+}
+
+size_t CriticalPathAnalyzer::addTraceEvents(llvm::ArrayRef<TraceEvent> events) {
+  if (nodes_.empty()) {
+    return 0;
+  }
+  // The timelines of the nodes of every run, and how many were found.
+  std::map<std::string, std::pair<std::vector<NodeTimeline>, size_t>> runs;
+  for (const auto &event : events) {
+    if (event.type != TraceEvent::CompleteType) {
+      continue;
+    }
+    auto runIt = event.args.find(kRunArg);
+    auto nodeIt = event.args.find(kNodeArg);
+    if (runIt == event.args.end() || nodeIt == event.args.end()) {
+      continue;
+    }
+    auto indexIt = indices_.find(nodeIt->second);
+    if (indexIt == indices_.end()) {
+      continue;
+    }
+    auto &run = runs[runIt->second];
+    if (run.first.empty()) {
+      run.first.resize(nodes_.size());
+    }
+    NodeTimeline &timeline = run.first[indexIt->second];
+    if (timeline.done) {
+      continue;
+    }
+    timeline.ready = event.timestamp;
+    timeline.done = event.timestamp + event.duration;
+    timeline.dispatch = getTimestampArg(event, kDispatchArg, timeline.ready);
+    timeline.deviceBegin = getTimestampArg(event, kDeviceBeginArg, 0);
+    timeline.deviceEnd = getTimestampArg(event, kDeviceEndArg, 0);
+    run.second++;
+  }
+
+  size_t numAdded = 0;
+  for (auto &run : runs) {
+    if (run.second.second == nodes_.size()) {
+      runs_.push_back(std::move(run.second.first));
+      numAdded++;
+    }
+  }
+  return numAdded;
+}
+
+CriticalPathAnalyzer::Report CriticalPathAnalyzer::analyze() const {
+  Report report;
+  size_t numNodes = nodes_.size();
+  report.numRuns = runs_.size();
+  report.nodes.resize(numNodes);
+  for (size_t i = 0; i < numNodes; i++) {
+    report.nodes[i].node = nodes_[i];
+  }
+  if (runs_.empty()) {
+    return report;
+  }
+
+  std::vector<uint64_t> queue(numNodes), transfer(numNodes),
+      compute(numNodes), slack(numNodes), latestDone(numNodes);
+  uint64_t latency = 0;
+  for (const auto &run : runs_) {
+    uint64_t start = run[0].ready;
+    size_t last = 0;
+    for (size_t i = 0; i < numNodes; i++) {
+      start = std::min(start, run[i].ready);
+      if (run[i].done > run[last].done) {
+        last = i;
+      }
+    }
+    uint64_t end = run[last].done;
+    latency += end - start;
+
+    for (size_t i = numNodes; i-- > 0;) {
+      const NodeTimeline &timeline = run[i];
+      // The node could have been done as late as the latest time its
+      // children could have been ready without delaying the run.
+      uint64_t latest = end;
+      for (size_t child : children_[i]) {
+        latest = std::min(latest, since(latestDone[child],
+                                        run[child].done - run[child].ready));
+      }
+      latestDone[i] = latest;
+      slack[i] += since(latest, timeline.done);
+
+      queue[i] += since(timeline.dispatch, timeline.ready);
+      if (timeline.deviceEnd) {
+        compute[i] += since(timeline.deviceEnd, timeline.deviceBegin);
+        transfer[i] += since(timeline.deviceBegin, timeline.dispatch) +
+                       since(timeline.done, timeline.deviceEnd);
+      } else {
+        compute[i] += since(timeline.done, timeline.dispatch);
+      }
+    }
+
+    // The critical path ends with the node done last, and goes up through
+    // the parent each of its nodes waited for, the one done last.
+    for (size_t i = last;;) {
+      report.nodes[i].numCritical++;
+      report.nodes[i].criticalTime += run[i].done - run[i].ready;
+      if (parents_[i].empty()) {
+        break;
+      }
+      i = *std::max_element(
+          parents_[i].begin(), parents_[i].end(),
+          [&run](size_t a, size_t b) { return run[a].done < run[b].done; });
+    }
+  }
+
+  double numRuns = runs_.size();
+  report.meanLatency = latency / numRuns;
+  for (size_t i = 0; i < numNodes; i++) {
+    NodeReport &node = report.nodes[i];
+    node.meanQueue = queue[i] / numRuns;
+    node.meanTransfer = transfer[i] / numRuns;
+    node.meanCompute = compute[i] / numRuns;
+    node.meanSlack = slack[i] / numRuns;
+  }
+  std::stable_sort(report.nodes.begin(), report.nodes.end(),
+                   [](const NodeReport &a, const NodeReport &b) {
+                     if (a.criticalTime != b.criticalTime) {
+                       return a.criticalTime > b.criticalTime;
+                     }
+                     return a.meanSlack < b.meanSlack;
+                   });
+  return report;
+}
+
+std::string CriticalPathAnalyzer::Report::toString() const {
+  std::string str;
+  llvm::raw_string_ostream os(str);
+  os << "Critical path of " << numRuns << " runs, mean latency "
+     << llvm::format("%.1f", meanLatency) << " us\n";
+  os << llvm::left_justify("node", 32)
+     << "  critical  path(us)     slack     queue  transfer   compute\n";
+  for (const auto &node : nodes) {
+    double critical = numRuns ? 100.0 * node.numCritical / numRuns : 0;
+    double pathTime = numRuns ? double(node.criticalTime) / numRuns : 0;
+    os << llvm::format("%-32s %8.1f%% %9.1f %9.1f %9.1f %9.1f %9.1f\n",
+                       node.node->name.c_str(), critical, pathTime,
+                       node.meanSlack, node.meanQueue, node.meanTransfer,
+                       node.meanCompute);
+  }
+
+  if (nodes.empty() || !nodes[0].numCritical) {
+    return os.str();
+  }
+  const NodeReport &first = nodes[0];
+  os << "Optimize " << first.node->name << " first, it is on the critical "
+     << "path of " << first.numCritical << " of " << numRuns << " runs. ";
+  if (first.meanQueue >= first.meanTransfer &&
+      first.meanQueue >= first.meanCompute) {
+    os << "It mostly waits to be dispatched: run it on more devices or with "
+          "a deeper pipeline.\n";
+  } else if (first.meanTransfer >= first.meanCompute) {
+    os << "It mostly waits for its tensors and its device: keep its tensors "
+          "on the device or move it to a less loaded one.\n";
+  } else {
+    os << "It mostly computes: optimize its function or split it into more "
+          "partitions.\n";
+  }
+  return os.str();
+}
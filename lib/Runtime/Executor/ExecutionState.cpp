@@ -15,18 +15,15 @@
  */
 #include "ExecutionState.h"
 
+#include <queue>
+
 using namespace glow;
 using namespace glow::runtime;
 
-ExecutionState::ExecutionState(RunIdentifierTy id, const DAGNode *root,
-                               ThreadExecutor *executor,
-                               std::unique_ptr<ExecutionContext> resultContext,
-                               ResultCBTy doneCb)
-    : runId_(id), cb_(doneCb), resultCtx_(std::move(resultContext)),
-      inflightNodes_(0), module_(root->module), root_(root),
-      executor_(executor) {
-  DCHECK(cb_ != nullptr);
-}
+ExecutionState::ExecutionState(const DAGNode *root, TensorPool *tensorPool,
+                               PipelineStages *stages)
+    : inflightNodes_(0), module_(root->module), root_(root),
+      intermediateTensorPool_(tensorPool), pipelineStages_(stages) {}
 
 void ExecutionState::init() {
   // Create a queue for the breadth-first traversal through the graph.
@@ -37,8 +34,6 @@ void ExecutionState::init() {
     bfsQueue.push(node);
   }
 
-  auto *resultTraceContext = resultCtx_->getTraceContext();
-
   // Breadth-first search.
   while (!bfsQueue.empty()) {
     // Get the next node in the BFS queue.
@@ -47,50 +42,22 @@ void ExecutionState::init() {
 
     // Make a counter for the number of node parents done.
     nodeParentsDone_[node] = 0;
-
-    // Make an (empty) input context for the node.
-    auto nodeInputCtx = llvm::make_unique<ExecutionContext>();
-
-    if (resultTraceContext) {
-      nodeInputCtx->setTraceContext(
-          llvm::make_unique<TraceContext>(resultTraceContext->getTraceLevel()));
-    }
-
-    auto nodeInputPhBindings = nodeInputCtx->getPlaceholderBindings();
+    preparedDevices_[node] = nullptr;
+    nodeTimes_[node] = NodeTimes();
 
     // Get the symbol table for the node.
     const SymbolTableTy &symbolTable = node->runtimeBundle->getSymbolTable();
 
-    // Create Placeholders for the symbols of all intermediate nodes. These are
-    // not in the ExecutionContext passed to Executor::run, so they must be
-    // created by the Executor.
-    auto *resultBindings = resultCtx_->getPlaceholderBindings();
+    // Look up the placeholders of the symbols in the module once, runs only
+    // need to look them up in their bindings.
+    auto &symbols = nodeSymbols_[node];
     for (const auto &symbolPair : symbolTable) {
-      const auto &symbolName = symbolPair.first;
-      const auto &symbolInfo = symbolPair.second;
-
-      if (symbolInfo.symbolCategory == SymbolCategory::Placeholder) {
-        auto *PH = resultBindings->getPlaceholderByName(symbolName);
-        if (!PH) {
-          PH = module_->getPlaceholderByName(symbolName);
-          DCHECK(PH) << "Placeholder: " << symbolName
-                     << " is not in the module";
-
-          // allocate into the resultBindings because they have the longest
-          // lifetime.
-          resultBindings->insert(PH,
-                                 intermediateTensorPool_.get(PH->getType()));
-          intermediatePlaceholders_.push_back(PH);
-        }
-
-        nodeInputPhBindings->insert(
-            PH, resultBindings->get(PH)->getUnowned(PH->dims()));
+      if (symbolPair.second.symbolCategory == SymbolCategory::Placeholder) {
+        symbols.emplace_back(symbolPair.first,
+                             module_->getPlaceholderByName(symbolPair.first));
       }
     }
 
-    // Insert the prepared ExecutionContext into the input contexts map.
-    inputCtxs_.insert(std::make_pair(node, std::move(nodeInputCtx)));
-
     // Push all unvisited children onto the BFS queue.
     for (const auto &child : node->children) {
       // Use nodeParentsDone_ as a set of nodes that have been visited already
@@ -103,6 +70,101 @@ void ExecutionState::init() {
   initialized_ = true;
 }
 
+void ExecutionState::reset(RunIdentifierTy id,
+                           std::unique_ptr<ExecutionContext> resultContext,
+                           ResultCBTy doneCb) {
+  DCHECK(initialized_) << "Run state must be initialized";
+  DCHECK(doneCb != nullptr);
+  runId_ = id;
+  cb_ = std::move(doneCb);
+  resultCtx_ = std::move(resultContext);
+  inflightNodes_ = 0;
+  intermediatePlaceholders_.clear();
+
+  for (auto &counter : nodeParentsDone_) {
+    counter.second = 0;
+  }
+  for (auto &device : preparedDevices_) {
+    device.second = nullptr;
+  }
+  for (auto &times : nodeTimes_) {
+    times.second = NodeTimes();
+  }
+
+  auto *resultTraceContext = resultCtx_->getTraceContext();
+  auto *resultBindings = resultCtx_->getPlaceholderBindings();
+
+  for (const auto &nodeSymbols : nodeSymbols_) {
+    const DAGNode *node = nodeSymbols.first;
+
+    // Make an (empty) input context for the node, with the bindings of the
+    // last run if there are some.
+    auto &freeBindings = freeBindings_[node];
+    if (!freeBindings) {
+      freeBindings = llvm::make_unique<PlaceholderBindings>();
+    }
+    auto nodeInputCtx =
+        llvm::make_unique<ExecutionContext>(std::move(freeBindings));
+
+    if (resultTraceContext) {
+      nodeInputCtx->setTraceContext(llvm::make_unique<TraceContext>(
+          resultTraceContext->getTraceLevel(),
+          resultTraceContext->getRecorder()));
+    }
+    nodeInputCtx->setStatsSampled(resultCtx_->isStatsSampled());
+    nodeInputCtx->inheritCancellation(*resultCtx_);
+
+    auto nodeInputPhBindings = nodeInputCtx->getPlaceholderBindings();
+
+    // Create Placeholders for the symbols of all intermediate nodes. These are
+    // not in the ExecutionContext passed to Executor::run, so they must be
+    // created by the Executor.
+    for (const auto &symbol : nodeSymbols.second) {
+      // Requests prepared by HostManager::prepareRequest bind the
+      // placeholders of the module, which are found without hashing names.
+      auto *PH = symbol.second && resultBindings->count(symbol.second)
+                     ? symbol.second
+                     : resultBindings->getPlaceholderByName(symbol.first);
+      if (!PH) {
+        PH = symbol.second;
+        DCHECK(PH) << "Placeholder: " << symbol.first.str()
+                   << " is not in the module";
+
+        // allocate into the resultBindings because they have the longest
+        // lifetime.
+        resultBindings->insert(PH, intermediateTensorPool_->get(PH->getType()));
+        intermediatePlaceholders_.push_back(PH);
+      }
+
+      // Bind the tensor to the placeholder of the module, so that a request
+      // binding its own placeholder of the same name runs on any version of
+      // the network, see HostManager::swapNetwork.
+      auto *modulePH = symbol.second ? symbol.second : PH;
+      nodeInputPhBindings->insert(
+          modulePH, resultBindings->get(PH)->getUnowned(modulePH->dims()));
+    }
+
+    // Insert the prepared ExecutionContext into the input contexts map.
+    inputCtxs_[node] = std::move(nodeInputCtx);
+  }
+}
+
+void ExecutionState::release() {
+  cb_ = nullptr;
+  resultCtx_.reset();
+}
+
+void ExecutionState::returnNodeContext(const DAGNode *node,
+                                       std::unique_ptr<ExecutionContext> ctx) {
+  auto bindings = ctx->movePlaceholderBindings();
+  bindings->clear();
+  // Only the handler of the node writes this entry, which exists since
+  // reset(), so handlers of other nodes can return theirs concurrently.
+  auto it = freeBindings_.find(node);
+  DCHECK(it != freeBindings_.end()) << "Node of another DAG";
+  it->second = std::move(bindings);
+}
+
 std::unique_ptr<ExecutionContext>
 ExecutionState::getUniqueNodeContextPtr(const DAGNode *node) {
   // The input PlaceholderBindings for the node should have been created in the
@@ -115,6 +177,36 @@ ExecutionState::getUniqueNodeContextPtr(const DAGNode *node) {
   return std::move(ctxIt->second);
 }
 
+ExecutionContext *
+ExecutionState::getRawNodeContextPtr(const DAGNode *node) const {
+  auto ctxIt = inputCtxs_.find(node);
+  DCHECK(ctxIt != inputCtxs_.end())
+      << "Input bindings not found but should exist!";
+  return ctxIt->second.get();
+}
+
+void ExecutionState::setPreparedDevice(const DAGNode *node,
+                                       DeviceManager *deviceManager) {
+  // The entries exist since init(), so nodes are prepared concurrently.
+  auto it = preparedDevices_.find(node);
+  DCHECK(it != preparedDevices_.end()) << "Node of another DAG";
+  it->second = deviceManager;
+}
+
+DeviceManager *ExecutionState::getPreparedDevice(const DAGNode *node) const {
+  auto it = preparedDevices_.find(node);
+  DCHECK(it != preparedDevices_.end()) << "Node of another DAG";
+  return it->second;
+}
+
+ExecutionState::NodeTimes &
+ExecutionState::getNodeTimes(const DAGNode *node) {
+  // The entries exist since init(), so nodes record their times concurrently.
+  auto it = nodeTimes_.find(node);
+  DCHECK(it != nodeTimes_.end()) << "Node of another DAG";
+  return it->second;
+}
+
 void ExecutionState::incrementInflightNodes(unsigned increment) {
   inflightNodes_ += increment;
 }
@@ -186,3 +278,61 @@ ExecutionContext *ExecutionState::getRawResultContextPtr() const {
   DCHECK_NOTNULL(resultCtx_.get());
   return resultCtx_.get();
 }
+
+PipelineStages::PipelineStages(const DAGNode *root, unsigned depth)
+    : depth_(depth) {
+  DCHECK_GT(depth_, 0) << "A stage must be able to run its node";
+  std::queue<const DAGNode *> bfsQueue;
+  for (const auto &node : root->children) {
+    bfsQueue.push(node);
+  }
+  while (!bfsQueue.empty()) {
+    const DAGNode *node = bfsQueue.front();
+    bfsQueue.pop();
+    if (stages_.count(node)) {
+      continue;
+    }
+    stages_[node] = llvm::make_unique<Stage>();
+    for (const auto &child : node->children) {
+      bfsQueue.push(child);
+    }
+  }
+}
+
+bool PipelineStages::enter(const DAGNode *node,
+                           std::shared_ptr<ExecutionState> state) {
+  auto it = stages_.find(node);
+  DCHECK(it != stages_.end()) << "Node of another DAG";
+  Stage &stage = *it->second;
+  std::lock_guard<std::mutex> lock(stage.lock);
+  if (stage.running < depth_) {
+    stage.running++;
+    return true;
+  }
+  stage.queued.emplace_back(std::move(state));
+  return false;
+}
+
+bool PipelineStages::isFull(const DAGNode *node) {
+  auto it = stages_.find(node);
+  DCHECK(it != stages_.end()) << "Node of another DAG";
+  Stage &stage = *it->second;
+  std::lock_guard<std::mutex> lock(stage.lock);
+  return stage.running >= depth_;
+}
+
+std::shared_ptr<ExecutionState> PipelineStages::leave(const DAGNode *node) {
+  auto it = stages_.find(node);
+  DCHECK(it != stages_.end()) << "Node of another DAG";
+  Stage &stage = *it->second;
+  std::lock_guard<std::mutex> lock(stage.lock);
+  // The queued run takes over the slot of the run that left.
+  if (!stage.queued.empty()) {
+    auto state = std::move(stage.queued.front());
+    stage.queued.pop_front();
+    return state;
+  }
+  DCHECK_GT(stage.running, 0) << "More leaves than enters";
+  stage.running--;
+  return nullptr;
+}
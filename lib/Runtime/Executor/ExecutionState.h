@@ -18,29 +18,74 @@
 
 #include "glow/Runtime/RuntimeTypes.h"
 #include "glow/Support/TensorPool.h"
-#include "glow/Support/ThreadPool.h"
+
+#include <deque>
+#include <mutex>
 
 namespace glow {
 namespace runtime {
 
+class DeviceManager;
+class PipelineStages;
+
 /// This class keeps track of the state of execution for a run (identified
-/// by the runId).
+/// by the runId). The state of a DAG is reusable: init() is called once, and
+/// reset() before each run.
 class ExecutionState final {
 public:
-  /// Constructor.
-  explicit ExecutionState(RunIdentifierTy id, const DAGNode *root,
-                          ThreadExecutor *executor,
-                          std::unique_ptr<ExecutionContext> resultContext,
-                          ResultCBTy doneCb);
-
-  /// Does the BFS traversal and initializes the ExecutionState.
+  /// Constructor. The tensors of the intermediate placeholders of the DAG of
+  /// \p root are taken from \p tensorPool, which must outlive the state. If
+  /// \p stages isn't null the nodes of the DAG are run through its stages.
+  explicit ExecutionState(const DAGNode *root, TensorPool *tensorPool,
+                          PipelineStages *stages = nullptr);
+
+  /// Does the BFS traversal and initializes the parts of the ExecutionState
+  /// that don't depend on the run.
   void init();
 
+  /// Prepares the state for the run \p id, which takes its inputs from and
+  /// gives its outputs to \p resultContext, and calls \p doneCb when done.
+  void reset(RunIdentifierTy id,
+             std::unique_ptr<ExecutionContext> resultContext,
+             ResultCBTy doneCb);
+
+  /// Drops the callback and the contexts of the last run once it is done, so
+  /// that they don't outlive it while the state waits to be reused.
+  void release();
+
+  /// Gives back to the state the input context \p ctx of \p node once the
+  /// node was run, so that its bindings are reused by the next run.
+  void returnNodeContext(const DAGNode *node,
+                         std::unique_ptr<ExecutionContext> ctx);
+
   /// \returns a unique pointer to an input bindings for \p node. This should
   /// not be called at the same time as insertIntoNodeCtx().
   std::unique_ptr<ExecutionContext>
   getUniqueNodeContextPtr(const DAGNode *node);
 
+  /// \returns a non-owning pointer to the input context of \p node, which
+  /// remains owned by the state until getUniqueNodeContextPtr() is called.
+  ExecutionContext *getRawNodeContextPtr(const DAGNode *node) const;
+
+  /// Records that the inputs of \p node were prepared on \p deviceManager,
+  /// which must then run the node for this run.
+  void setPreparedDevice(const DAGNode *node, DeviceManager *deviceManager);
+
+  /// \returns the device the inputs of \p node were prepared on for this
+  /// run, or null if they weren't.
+  DeviceManager *getPreparedDevice(const DAGNode *node) const;
+
+  /// The times, in microseconds, a node became ready for this run, all its
+  /// parents being done, and was dispatched to a device. They are recorded
+  /// when the run is traced, or are zero.
+  struct NodeTimes {
+    uint64_t ready{0};
+    uint64_t dispatch{0};
+  };
+
+  /// \returns the times of \p node for this run.
+  NodeTimes &getNodeTimes(const DAGNode *node);
+
   /// Increment the count of inflight nodes by \p increment (default is 1).
   void incrementInflightNodes(unsigned increment = 1);
 
@@ -78,8 +123,9 @@ public:
   /// \returns the run ID for the execution.
   RunIdentifierTy getRunId() const { return runId_; }
 
-  /// \returns the Executor used for this run.
-  ThreadExecutor *getExecutor() { return executor_; }
+  /// \returns the pipeline stages of the DAG, or null if the DAG isn't run
+  /// as a pipeline.
+  PipelineStages *getPipelineStages() const { return pipelineStages_; }
 
   /// Whether or not this node has been initialized.
   bool initialized_{false};
@@ -99,6 +145,21 @@ private:
   /// populated as a node's parents finish.
   std::unordered_map<const DAGNode *, std::unique_ptr<ExecutionContext>>
       inputCtxs_;
+  /// The input bindings of the nodes that were given back by
+  /// returnNodeContext(), to be reused by the next run.
+  std::unordered_map<const DAGNode *, std::unique_ptr<PlaceholderBindings>>
+      freeBindings_;
+  /// The device the inputs of every node were prepared on by
+  /// DeviceManager::prepareInputs() for this run, or null.
+  std::unordered_map<const DAGNode *, DeviceManager *> preparedDevices_;
+  /// The times of every node for this run.
+  std::unordered_map<const DAGNode *, NodeTimes> nodeTimes_;
+  /// The placeholder symbols of every node, with the placeholder of the
+  /// module of the same name, or null if the module has none. Symbols are
+  /// still resolved by name in the bindings of each run.
+  std::unordered_map<const DAGNode *,
+                     std::vector<std::pair<llvm::StringRef, Placeholder *>>>
+      nodeSymbols_;
   /// Placeholders for tensors generated by DAG nodes that aren't the final
   /// output (i.e. they have children). The owning pointer for these tensors
   /// exists in the resultCtx and are removed before the ResultCB is called.
@@ -113,10 +174,51 @@ private:
   Module *module_{nullptr};
   /// Root node of the DAG for this run.
   const DAGNode *root_;
-  /// Object pool for intermediate tensors.
-  TensorPool intermediateTensorPool_;
-  /// Thread Executor used for this run.
-  ThreadExecutor *executor_;
+  /// Object pool for intermediate tensors, shared by the states of the DAG.
+  TensorPool *intermediateTensorPool_;
+  /// The pipeline stages of the DAG, shared by the states of the DAG.
+  PipelineStages *pipelineStages_;
+};
+
+/// The stages of the pipelined execution of a DAG, one per node. A stage runs
+/// its node for at most depth runs at once, and queues the other runs that
+/// are ready for the node in the order they got ready. With several runs in
+/// flight, the device of a node works on one run while the devices of its
+/// parents work on the next ones.
+class PipelineStages final {
+public:
+  /// Create the stages of the nodes of the DAG of \p root, each stage runs
+  /// at most \p depth runs of its node at once.
+  PipelineStages(const DAGNode *root, unsigned depth);
+
+  /// Make \p node ready for the run of \p state. \returns true if the node
+  /// can be run right away, or false if the run is queued, in which case
+  /// leave() returns it later.
+  bool enter(const DAGNode *node, std::shared_ptr<ExecutionState> state);
+
+  /// \returns true if \p node runs as many runs as it can at once, so that
+  /// a run entering the stage now would be queued.
+  bool isFull(const DAGNode *node);
+
+  /// Mark a run of \p node as no longer running. \returns the state of the
+  /// queued run that can now run the node, or null if none is queued.
+  std::shared_ptr<ExecutionState> leave(const DAGNode *node);
+
+private:
+  /// The stage of a node.
+  struct Stage {
+    /// Lock for the stage.
+    std::mutex lock;
+    /// Number of runs of the node that are running.
+    unsigned running{0};
+    /// The runs ready for the node that wait for a running one to finish.
+    std::deque<std::shared_ptr<ExecutionState>> queued;
+  };
+
+  /// Maximum number of runs of a node that run at once.
+  const unsigned depth_;
+  /// The stage of every node of the DAG.
+  std::unordered_map<const DAGNode *, std::unique_ptr<Stage>> stages_;
 };
 
 } // namespace runtime
@@ -18,8 +18,12 @@
 
 #include "glow/Backends/DeviceManager.h"
 #include "glow/ExecutionContext/ExecutionContext.h"
+#include "glow/Runtime/Executor/CriticalPath.h"
 #include "glow/Runtime/Executor/ThreadPoolExecutor.h"
+#include "glow/Runtime/StatsExporter.h"
+#include "glow/Support/Support.h"
 
+#include <algorithm>
 #include <queue>
 #include <unordered_set>
 
@@ -28,6 +32,35 @@
 namespace glow {
 namespace runtime {
 
+/// Logs into \p traceContext the event CriticalPathAnalyzer reads for the run
+/// \p runId of \p node, which was ready at \p ready and dispatched at
+/// \p dispatch. The run of the device is the last one in the events of
+/// \p traceContext. Nothing is logged if the times weren't recorded.
+static void logDAGNodeTraceEvent(TraceContext *traceContext,
+                                 const DAGNode *node, RunIdentifierTy runId,
+                                 uint64_t ready, uint64_t dispatch) {
+  if (!ready || !traceContext->shouldLog(TraceLevel::RUNTIME)) {
+    return;
+  }
+  std::map<std::string, std::string> args;
+  args[CriticalPathAnalyzer::kRunArg] = std::to_string(runId);
+  args[CriticalPathAnalyzer::kNodeArg] = node->name;
+  if (dispatch) {
+    args[CriticalPathAnalyzer::kDispatchArg] = std::to_string(dispatch);
+  }
+  for (const auto &event : traceContext->getTraceEvents()) {
+    if (event.type == TraceEvent::CompleteType &&
+        event.name == "DeviceManager::run") {
+      args[CriticalPathAnalyzer::kDeviceBeginArg] =
+          std::to_string(event.timestamp);
+      args[CriticalPathAnalyzer::kDeviceEndArg] =
+          std::to_string(event.timestamp + event.duration);
+    }
+  }
+  traceContext->logCompleteTraceEvent(node->name, TraceLevel::RUNTIME, ready,
+                                      std::move(args));
+}
+
 void InflightBarrier::decrement(unsigned decr) {
   std::unique_lock<std::mutex> lock(mtx_);
   DCHECK_GE(count_, decr) << "Barrier decrement cannot be less than count!";
@@ -58,6 +91,17 @@ void InflightBarrier::wait() {
   cv_.wait(lock, [&] { return count_ == 0; });
 }
 
+ThreadPoolExecutor::ThreadPoolExecutor(const DeviceManagerMapTy &deviceManagers,
+                                       unsigned numWorkers,
+                                       unsigned pipelineDepth,
+                                       const HedgingConfig &hedging)
+    : threadPool_(numWorkers), deviceManagers_(deviceManagers),
+      pipelineDepth_(pipelineDepth), hedging_(hedging) {
+  if (hedging_.percentile > 0) {
+    hedgeTimerThread_ = std::thread([this]() { runHedgeTimers(); });
+  }
+}
+
 void ThreadPoolExecutor::shutdown() {
   // Prevent more requests from being processed.
   shuttingDown_ = true;
@@ -66,6 +110,164 @@ void ThreadPoolExecutor::shutdown() {
   // processed before starting to destroy state that is used in
   // handleDeviceManagerResult().
   inflightBarrier_.wait();
+
+  // No run is left to hedge, the timers that are left are of runs that are
+  // done.
+  if (hedgeTimerThread_.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(hedgeTimersLock_);
+      stopHedgeTimers_ = true;
+      hedgeTimers_ = decltype(hedgeTimers_)();
+    }
+    hedgeTimersCV_.notify_all();
+    hedgeTimerThread_.join();
+  }
+}
+
+std::shared_ptr<ThreadPoolExecutor::ExecutionStatePool>
+ThreadPoolExecutor::getStatePool(const DAGNode *root) {
+  std::lock_guard<std::mutex> lock(statePoolsLock_);
+  auto &entry = statePools_[root];
+  if (entry) {
+    return entry;
+  }
+  entry = std::make_shared<ExecutionStatePool>();
+  if (pipelineDepth_) {
+    entry->stages = llvm::make_unique<PipelineStages>(root, pipelineDepth_);
+    return entry;
+  }
+  // The runs of a DAG of a single node that always runs, and isn't hedged,
+  // don't need the bookkeeping of an ExecutionState.
+  if (root->children.size() != 1) {
+    return entry;
+  }
+  const DAGNode *node = root->children[0];
+  if (!node->children.empty() || !node->predicate.empty() ||
+      !node->runtimeBundle || !root->module ||
+      (hedging_.percentile > 0 && node->deviceIDs.size() > 1)) {
+    return entry;
+  }
+  for (const auto &symbol : node->runtimeBundle->getSymbolTable()) {
+    if (symbol.second.symbolCategory != SymbolCategory::Placeholder) {
+      continue;
+    }
+    auto *PH = root->module->getPlaceholderByName(symbol.first);
+    if (!PH) {
+      entry->directPlaceholders.clear();
+      return entry;
+    }
+    entry->directPlaceholders.push_back(PH);
+  }
+  entry->direct = true;
+  return entry;
+}
+
+bool ThreadPoolExecutor::runDirectly(const ExecutionStatePool &pool,
+                                     const DAGNode *root,
+                                     std::unique_ptr<ExecutionContext> &context,
+                                     RunIdentifierTy runId, ResultCBTy &cb) {
+  if (!pool.direct) {
+    return false;
+  }
+  // The ExecutionState binds the placeholders of the module to views of the
+  // tensors of the run, and allocates the ones the run doesn't bind. A run
+  // binding exactly the placeholders of the module is handed over as is.
+  auto *bindings = context->getPlaceholderBindings();
+  if (bindings->pairs().size() != pool.directPlaceholders.size()) {
+    return false;
+  }
+  for (auto *PH : pool.directPlaceholders) {
+    Tensor *T = bindings->get(PH);
+    if (!T || T->dims() != PH->dims()) {
+      return false;
+    }
+  }
+
+  DAGNode *node = root->children[0];
+  auto deviceManagerIt = selectDevice(node);
+  if (deviceManagerIt == deviceManagers_.end()) {
+    cb(runId,
+       MAKE_ERR(ErrorValue::ErrorCode::RUNTIME_DEVICE_NOT_FOUND,
+                "Cannot find the DeviceManager specified."),
+       std::move(context));
+    return true;
+  }
+  DeviceManager *deviceManager = deviceManagerIt->second.get();
+
+  inflightBarrier_.increment();
+  auto startTime = std::chrono::steady_clock::now();
+  uint64_t traceTime = context->getTraceContext() ? TraceEvent::now() : 0;
+  deviceManager->startedRun();
+  deviceManager->runFunction(
+      node->name, std::move(context),
+      [this, node, deviceManager, startTime, traceTime, runId,
+       cb = std::move(cb)](RunIdentifierTy, Error err,
+                           std::unique_ptr<ExecutionContext> ctx) {
+        deviceManager->finishedRun();
+        if (ctx->isStatsSampled()) {
+          Stats()->addLatencyValue("partition", node->name, startTime);
+        }
+        if (auto *traceContext = ctx->getTraceContext()) {
+          logDAGNodeTraceEvent(traceContext, node, runId, traceTime,
+                               traceTime);
+        }
+        cb(runId, std::move(err), std::move(ctx));
+        inflightBarrier_.decrement();
+      });
+  return true;
+}
+
+std::shared_ptr<ExecutionState> ThreadPoolExecutor::getExecutionState(
+    std::shared_ptr<ExecutionStatePool> pool, const DAGNode *root,
+    RunIdentifierTy runId, std::unique_ptr<ExecutionContext> context,
+    ResultCBTy cb) {
+  std::unique_ptr<ExecutionState> state;
+  {
+    std::lock_guard<std::mutex> lock(pool->lock);
+    if (!pool->states.empty()) {
+      state = std::move(pool->states.back());
+      pool->states.pop_back();
+    }
+  }
+  if (!state) {
+    state = llvm::make_unique<ExecutionState>(root, &pool->tensorPool,
+                                              pool->stages.get());
+    state->init();
+  }
+  state->reset(runId, std::move(context), std::move(cb));
+
+  // Give the state back to the pool once the last handler of the run is done
+  // with it. The deleter keeps the pool alive, so removeDAG() may be called
+  // while the run is still going.
+  return std::shared_ptr<ExecutionState>(
+      state.release(), [pool](ExecutionState *released) {
+        released->release();
+        std::lock_guard<std::mutex> lock(pool->lock);
+        pool->states.emplace_back(released);
+      });
+}
+
+void ThreadPoolExecutor::removeDAG(const DAGNode *root) {
+  {
+    std::lock_guard<std::mutex> lock(statePoolsLock_);
+    statePools_.erase(root);
+  }
+  std::lock_guard<std::mutex> lock(latenciesLock_);
+  if (latencies_.empty()) {
+    return;
+  }
+  std::queue<const DAGNode *> bfsQueue;
+  for (const auto *node : root->children) {
+    bfsQueue.push(node);
+  }
+  while (!bfsQueue.empty()) {
+    const DAGNode *node = bfsQueue.front();
+    bfsQueue.pop();
+    latencies_.erase(node);
+    for (const auto *child : node->children) {
+      bfsQueue.push(child);
+    }
+  }
 }
 
 void ThreadPoolExecutor::run(const DAGNode *root,
@@ -92,10 +294,12 @@ void ThreadPoolExecutor::run(const DAGNode *root,
     return;
   }
 
-  std::shared_ptr<ExecutionState> executionState =
-      std::make_shared<ExecutionState>(runId, root, threadPool_.getExecutor(),
-                                       std::move(context), std::move(cb));
-  executionState->init();
+  auto pool = getStatePool(root);
+  if (runDirectly(*pool, root, context, runId, cb)) {
+    return;
+  }
+  std::shared_ptr<ExecutionState> executionState = getExecutionState(
+      std::move(pool), root, runId, std::move(context), std::move(cb));
 
   // Execute all child nodes of root.
 
@@ -115,63 +319,428 @@ void ThreadPoolExecutor::run(const DAGNode *root,
 
 void ThreadPoolExecutor::executeDAGNode(
     std::shared_ptr<ExecutionState> executionState, DAGNode *node) {
+  if (executionState->getRawResultContextPtr()->getTraceContext()) {
+    executionState->getNodeTimes(node).ready = TraceEvent::now();
+  }
+
+  // A pipelined node waits for a run of the node that is ahead of it to be
+  // done if its stage is full. The device stages the inputs of the run
+  // meanwhile, so that their copy overlaps the runs in flight.
+  auto *stages = executionState->getPipelineStages();
+  if (stages) {
+    if (stages->isFull(node)) {
+      prepareDAGNode(*executionState, node);
+    }
+    if (!stages->enter(node, executionState)) {
+      return;
+    }
+  }
+  runDAGNode(std::move(executionState), node);
+}
+
+void ThreadPoolExecutor::prepareDAGNode(ExecutionState &executionState,
+                                        DAGNode *node) {
+  auto deviceManagerIt = selectDevice(node);
+  if (deviceManagerIt == deviceManagers_.end()) {
+    // runDAGNode() fails the run.
+    return;
+  }
+  DeviceManager *deviceManager = deviceManagerIt->second.get();
+  TRACE_EVENT_SCOPE(executionState.getRawResultContextPtr()->getTraceContext(),
+                    TraceLevel::RUNTIME, "ThreadPoolExecutor::prepareDAGNode");
+  if (auto err = deviceManager->prepareInputs(
+          node->name, *executionState.getRawNodeContextPtr(node))) {
+    executionState.getErrorContainer().set(std::move(err));
+    return;
+  }
+  executionState.setPreparedDevice(node, deviceManager);
+}
+
+DeviceManagerMapTy::const_iterator
+ThreadPoolExecutor::selectDevice(DAGNode *node, DeviceManager *exclude) {
+  const auto &deviceIDs = node->deviceIDs;
+  if (deviceIDs.empty()) {
+    return deviceManagers_.end();
+  }
+  // Join the shortest queue. The search starts at the next device in
+  // round-robin order, so that devices that are as busy take turns.
+  unsigned start = node->currentDeviceIdx++;
+  auto best = deviceManagers_.end();
+  unsigned bestInflightRuns = 0;
+  for (size_t i = 0, e = deviceIDs.size(); i < e; i++) {
+    auto it = deviceManagers_.find(deviceIDs[(start + i) % e]);
+    if (it == deviceManagers_.end() || it->second.get() == exclude) {
+      continue;
+    }
+    unsigned inflightRuns = it->second->getInflightRuns();
+    if (best == deviceManagers_.end() || inflightRuns < bestInflightRuns) {
+      best = it;
+      bestInflightRuns = inflightRuns;
+    }
+  }
+  return best;
+}
+
+void ThreadPoolExecutor::leaveStage(ExecutionState &executionState,
+                                    DAGNode *node) {
+  auto *stages = executionState.getPipelineStages();
+  if (!stages) {
+    return;
+  }
+  if (auto next = stages->leave(node)) {
+    threadPool_.run([this, next = std::move(next), node]() mutable {
+      runDAGNode(std::move(next), node);
+    });
+  }
+}
+
+void ThreadPoolExecutor::runDAGNode(
+    std::shared_ptr<ExecutionState> executionState, DAGNode *node) {
   TRACE_EVENT_SCOPE(executionState->getRawResultContextPtr()->getTraceContext(),
                     TraceLevel::RUNTIME, "ThreadPoolExecutor::executeDAGNode");
   DCHECK(executionState->initialized_) << "Run state must be initialized";
+  // The device the inputs of the node were staged on, if any, runs it.
+  DeviceManager *deviceManager = executionState->getPreparedDevice(node);
+  bool prepared = deviceManager != nullptr;
+
+  // Don't run the nodes of a run whose client gave up on it.
+  if (auto err = checkAbandoned(*executionState->getRawResultContextPtr(),
+                                node->name)) {
+    executionState->getErrorContainer().set(std::move(err));
+  }
+
+  // Skip the node if its predicate is off.
+  bool skipped = false;
+  if (!node->predicate.empty() &&
+      !executionState->getErrorContainer().containsErr()) {
+    auto predicatedOn = isPredicatedOn(*executionState, node);
+    if (predicatedOn) {
+      skipped = !*predicatedOn;
+    } else {
+      executionState->getErrorContainer().set(predicatedOn.takeError());
+    }
+  }
+
   // If execution has already failed due to another node, don't bother running
   // this one.
   if (executionState->getErrorContainer().containsErr()) {
+    if (deviceManager) {
+      deviceManager->releaseInputs(
+          node->name, *executionState->getRawNodeContextPtr(node));
+    }
     // Mark the node as no longer executing.
+    leaveStage(*executionState, node);
     executionState->decrementInflightNodes();
     inflightBarrier_.decrement();
     return;
   }
 
-  auto currentDevice = node->getNextDevice();
+  if (skipped) {
+    skipDAGNode(std::move(executionState), node, deviceManager);
+    return;
+  }
+
   // Get the DeviceManager that can run the node.
-  auto deviceManagerIt = deviceManagers_.find(currentDevice);
+  if (!deviceManager) {
+    auto deviceManagerIt = selectDevice(node);
+    if (deviceManagerIt != deviceManagers_.end()) {
+      deviceManager = deviceManagerIt->second.get();
+    }
+  }
 
-  if (deviceManagerIt == deviceManagers_.end()) {
+  if (!deviceManager) {
     // Mark the node as no longer executing.
     executionState->getErrorContainer().set(
         MAKE_ERR(ErrorValue::ErrorCode::RUNTIME_DEVICE_NOT_FOUND,
                  "Cannot find the DeviceManager specified."));
+    leaveStage(*executionState, node);
     executionState->decrementInflightNodes();
     inflightBarrier_.decrement();
     return;
   }
 
-  auto &deviceManager = deviceManagerIt->second;
+  if (executionState->getRawResultContextPtr()->getTraceContext()) {
+    executionState->getNodeTimes(node).dispatch = TraceEvent::now();
+  }
+
+  // The runs of the nodes that run on several devices may be hedged, unless
+  // their inputs were staged on a device.
+  if (hedging_.percentile > 0 && !prepared && node->deviceIDs.size() > 1) {
+    runHedgedDAGNode(std::move(executionState), node, deviceManager);
+    return;
+  }
 
   // Get the PlaceholderBindings containing all of the inputs for the node.
   std::unique_ptr<ExecutionContext> nodeCtx =
       executionState->getUniqueNodeContextPtr(node);
 
   // Run the node using the DeviceManager.
+  auto startTime = std::chrono::steady_clock::now();
+  deviceManager->startedRun();
   deviceManager->runFunction(
       node->name, std::move(nodeCtx),
-      [this, executionState,
-       node](RunIdentifierTy id, Error err,
-             std::unique_ptr<ExecutionContext> resultCtx) {
-        // Immediately move the handling of the result onto this run's executor
-        // to avoid doing work on the DeviceManager thread.
-        executionState->getExecutor()->submit(
-            [this, executionState, node, err = std::move(err),
-             ctx = std::move(resultCtx)]() mutable {
-              this->handleDeviceManagerResult(executionState, std::move(err),
-                                              std::move(ctx), node);
-            });
+      [this, executionState, node, deviceManager,
+       startTime](RunIdentifierTy id, Error err,
+                  std::unique_ptr<ExecutionContext> resultCtx) {
+        deviceManager->finishedRun();
+        if (resultCtx->isStatsSampled()) {
+          Stats()->addLatencyValue("partition", node->name, startTime);
+        }
+        // Immediately move the handling of the result onto the thread pool
+        // to avoid doing work on the DeviceManager thread. Any worker may
+        // handle it, so results of the same run can be handled concurrently.
+        auto resultTime = std::chrono::steady_clock::now();
+        threadPool_.run([this, executionState, node, resultTime,
+                         err = std::move(err),
+                         ctx = std::move(resultCtx)]() mutable {
+          if (ctx->isStatsSampled()) {
+            Stats()->addLatencyValue("result_handoff", node->name,
+                                     resultTime);
+          }
+          this->handleDeviceManagerResult(executionState, std::move(err),
+                                          std::move(ctx), node);
+        });
       });
 }
 
+Expected<bool>
+ThreadPoolExecutor::isPredicatedOn(ExecutionState &executionState,
+                                   const DAGNode *node) {
+  auto *bindings =
+      executionState.getRawResultContextPtr()->getPlaceholderBindings();
+  auto *PH = bindings->getPlaceholderByName(node->predicate);
+  RETURN_ERR_IF_NOT(PH, strFormat("The predicate %s of %s is not bound.",
+                                  node->predicate.c_str(), node->name.c_str()));
+  const Tensor *predicate = bindings->get(PH);
+  const char *data = predicate->getUnsafePtr();
+  return std::any_of(data, data + predicate->getType().getElementSize(),
+                     [](char byte) { return byte != 0; });
+}
+
+void ThreadPoolExecutor::skipDAGNode(
+    std::shared_ptr<ExecutionState> executionState, DAGNode *node,
+    DeviceManager *preparedDevice) {
+  if (preparedDevice) {
+    preparedDevice->releaseInputs(node->name,
+                                  *executionState->getRawNodeContextPtr(node));
+  }
+  Stats()->incrementCounter(kSkippedRuns);
+
+  // The outputs of the node are zeros, like the ones of a run that computed
+  // nothing, so that the nodes reading them may select another result.
+  std::unique_ptr<ExecutionContext> nodeCtx =
+      executionState->getUniqueNodeContextPtr(node);
+  const auto &symbolTable = node->runtimeBundle->getSymbolTable();
+  for (auto &pair : nodeCtx->getPlaceholderBindings()->pairs()) {
+    auto it = symbolTable.find(pair.first->getName().str());
+    if (it != symbolTable.end() && it->second.output && !it->second.input) {
+      pair.second->zero();
+    }
+  }
+  handleDeviceManagerResult(std::move(executionState), Error::success(),
+                            std::move(nodeCtx), node);
+}
+
+void ThreadPoolExecutor::runHedgedDAGNode(
+    std::shared_ptr<ExecutionState> executionState, DAGNode *node,
+    DeviceManager *deviceManager) {
+  auto run = std::make_shared<HedgedRun>();
+  run->state = std::move(executionState);
+  run->node = node;
+  run->primary = deviceManager;
+  hedgeableRuns_++;
+  Stats()->incrementCounter(kHedgeableRuns);
+
+  auto timeout = getHedgeTimeout(node);
+  {
+    std::lock_guard<std::mutex> lock(run->lock);
+    startAttempt(run, deviceManager);
+  }
+  if (timeout.count() == 0) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(hedgeTimersLock_);
+    hedgeTimers_.emplace(std::chrono::steady_clock::now() + timeout,
+                         std::move(run));
+  }
+  hedgeTimersCV_.notify_one();
+}
+
+void ThreadPoolExecutor::startAttempt(std::shared_ptr<HedgedRun> run,
+                                      DeviceManager *deviceManager) {
+  DAGNode *node = run->node;
+  // The attempts don't share any tensor with the run, so that the one that
+  // loses may still run once the run is done. Only the inputs are copied.
+  ExecutionContext *nodeCtx = run->state->getRawNodeContextPtr(node);
+  const auto &symbolTable = node->runtimeBundle->getSymbolTable();
+  auto bindings = llvm::make_unique<PlaceholderBindings>();
+  for (const auto &pair : nodeCtx->getPlaceholderBindings()->pairs()) {
+    auto it = symbolTable.find(pair.first->getName().str());
+    if (it == symbolTable.end() || it->second.input) {
+      bindings->insert(pair.first, pair.second->clone());
+    } else {
+      bindings->insert(pair.first, Tensor(pair.second->getType()));
+    }
+  }
+  auto attemptCtx = llvm::make_unique<ExecutionContext>(std::move(bindings));
+  attemptCtx->setStatsSampled(nodeCtx->isStatsSampled());
+  attemptCtx->inheritCancellation(*nodeCtx);
+
+  run->pending++;
+  auto startTime = std::chrono::steady_clock::now();
+  deviceManager->startedRun();
+  deviceManager->runFunction(
+      node->name, std::move(attemptCtx),
+      [this, run, deviceManager,
+       startTime](RunIdentifierTy, Error err,
+                  std::unique_ptr<ExecutionContext> resultCtx) mutable {
+        deviceManager->finishedRun();
+        threadPool_.run([this, run = std::move(run), deviceManager, startTime,
+                         err = std::move(err),
+                         ctx = std::move(resultCtx)]() mutable {
+          finishAttempt(std::move(run), deviceManager, std::move(err),
+                        std::move(ctx), startTime);
+        });
+      });
+}
+
+void ThreadPoolExecutor::hedge(std::shared_ptr<HedgedRun> run) {
+  std::lock_guard<std::mutex> lock(run->lock);
+  if (run->done ||
+      double(hedgedRuns_ + 1) > hedging_.budget * double(hedgeableRuns_)) {
+    return;
+  }
+  auto deviceManagerIt = selectDevice(run->node, run->primary);
+  if (deviceManagerIt == deviceManagers_.end()) {
+    return;
+  }
+  hedgedRuns_++;
+  Stats()->incrementCounter(kHedgedRuns);
+  // The run is in flight, so the barrier is held and the executor can't shut
+  // down before the hedge is done.
+  inflightBarrier_.increment();
+  startAttempt(std::move(run), deviceManagerIt->second.get());
+}
+
+void ThreadPoolExecutor::finishAttempt(
+    std::shared_ptr<HedgedRun> run, DeviceManager *deviceManager, Error err,
+    std::unique_ptr<ExecutionContext> ctx,
+    std::chrono::steady_clock::time_point startTime) {
+  std::shared_ptr<ExecutionState> executionState;
+  {
+    std::lock_guard<std::mutex> lock(run->lock);
+    unsigned pending = --run->pending;
+    if (!run->done && (!err || pending == 0)) {
+      run->done = true;
+      executionState = std::move(run->state);
+    }
+  }
+  if (!executionState) {
+    // The run goes on with the other attempt.
+    ERR_TO_VOID(std::move(err), /* log */ false);
+    inflightBarrier_.decrement();
+    return;
+  }
+
+  DAGNode *node = run->node;
+  recordLatency(node, startTime);
+  if (ctx->isStatsSampled()) {
+    Stats()->addLatencyValue("partition", node->name, startTime);
+  }
+  if (deviceManager != run->primary) {
+    Stats()->incrementCounter(kHedgeWins);
+  }
+
+  // Hand the outputs of the attempt over to the run.
+  auto nodeCtx = executionState->getUniqueNodeContextPtr(node);
+  if (!err) {
+    const auto &symbolTable = node->runtimeBundle->getSymbolTable();
+    auto *attemptBindings = ctx->getPlaceholderBindings();
+    for (const auto &pair : nodeCtx->getPlaceholderBindings()->pairs()) {
+      auto it = symbolTable.find(pair.first->getName().str());
+      if (it != symbolTable.end() && it->second.output) {
+        pair.second->copyRawFrom(attemptBindings->get(pair.first));
+      }
+    }
+  }
+  handleDeviceManagerResult(std::move(executionState), std::move(err),
+                            std::move(nodeCtx), node);
+}
+
+ThreadPoolExecutor::LatencyHistory &
+ThreadPoolExecutor::getLatencyHistory(const DAGNode *node) {
+  std::lock_guard<std::mutex> lock(latenciesLock_);
+  auto &history = latencies_[node];
+  if (!history) {
+    history = llvm::make_unique<LatencyHistory>();
+  }
+  return *history;
+}
+
+std::chrono::microseconds
+ThreadPoolExecutor::getHedgeTimeout(const DAGNode *node) {
+  auto &history = getLatencyHistory(node);
+  std::vector<uint64_t> samples;
+  {
+    std::lock_guard<std::mutex> lock(history.lock);
+    if (history.samples.size() < kMinHedgeSamples) {
+      return std::chrono::microseconds(0);
+    }
+    samples = history.samples;
+  }
+  size_t index = std::min<size_t>(samples.size() - 1,
+                                  hedging_.percentile * samples.size());
+  std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+  return std::chrono::microseconds(std::max<uint64_t>(samples[index], 1));
+}
+
+void ThreadPoolExecutor::recordLatency(
+    const DAGNode *node, std::chrono::steady_clock::time_point startTime) {
+  uint64_t latency = std::chrono::duration_cast<std::chrono::microseconds>(
+                         std::chrono::steady_clock::now() - startTime)
+                         .count();
+  auto &history = getLatencyHistory(node);
+  std::lock_guard<std::mutex> lock(history.lock);
+  if (history.samples.size() < kHedgeSamples) {
+    history.samples.push_back(latency);
+  } else {
+    history.samples[history.next] = latency;
+    history.next = (history.next + 1) % kHedgeSamples;
+  }
+}
+
+void ThreadPoolExecutor::runHedgeTimers() {
+  std::unique_lock<std::mutex> lock(hedgeTimersLock_);
+  while (!stopHedgeTimers_) {
+    if (hedgeTimers_.empty()) {
+      hedgeTimersCV_.wait(lock);
+      continue;
+    }
+    auto deadline = hedgeTimers_.top().first;
+    if (std::chrono::steady_clock::now() < deadline) {
+      hedgeTimersCV_.wait_until(lock, deadline);
+      continue;
+    }
+    auto run = hedgeTimers_.top().second;
+    hedgeTimers_.pop();
+    lock.unlock();
+    hedge(std::move(run));
+    lock.lock();
+  }
+}
+
 void ThreadPoolExecutor::handleDeviceManagerResult(
     std::shared_ptr<ExecutionState> executionState, Error err,
-    std::unique_ptr<ExecutionContext> ctx, const DAGNode *node) {
+    std::unique_ptr<ExecutionContext> ctx, DAGNode *node) {
 
   // If executionState is null, that means that the object was deleted
   // while a node was executing. That should never happen.
   DCHECK_NOTNULL(executionState.get());
 
+  // The device is done with the node, the next run of the node can start.
+  leaveStage(*executionState, node);
+
   TraceContext *traceContext = ctx->getTraceContext();
   TRACE_EVENT_SCOPE_NAMED(traceContext, TraceLevel::RUNTIME,
                           "ThreadPoolExecutor::handleResult", traceEvent);
@@ -197,17 +766,27 @@ void ThreadPoolExecutor::handleDeviceManagerResult(
     }
   }
 
-  // Now, check if all nodes in the graph are done. If so, the callback can be
-  // called and all state associated with the run can be erased.
-  bool noNodesInflight = executionState->decrementInflightNodes();
-
+  // Merge the trace before decrementing the inflight nodes, since the result
+  // context may be given back by the handler of the last node as soon as this
+  // one is no longer inflight.
   if (traceContext) {
     TRACE_EVENT_END(traceContext, TraceLevel::RUNTIME,
                     "ThreadPoolExecutor::handleResult");
-    // Lock is not necessary as we only access on this runs executor.
+    const auto &times = executionState->getNodeTimes(node);
+    logDAGNodeTraceEvent(traceContext, node, executionState->getRunId(),
+                         times.ready, times.dispatch);
+    // TraceContext::merge takes a lock, handlers of the same run may merge
+    // concurrently.
     executionState->insertIntoTraceContext(traceContext);
   }
 
+  // Give the bindings of the node back for the next run of the DAG.
+  executionState->returnNodeContext(node, std::move(ctx));
+
+  // Now, check if all nodes in the graph are done. If so, the callback can be
+  // called and all state associated with the run can be erased.
+  bool noNodesInflight = executionState->decrementInflightNodes();
+
   if (noNodesInflight) {
     // Remove the intermediate placeholders so we don't leak them to the caller.
     executionState->removeIntermediatePlaceholders();
@@ -16,21 +16,28 @@
 
 #include "glow/Runtime/HostManager/HostManager.h"
 #include "glow/Backends/DeviceManager.h"
+#include "glow/ExecutionContext/TraceRecorder.h"
 #include "glow/Graph/PlaceholderBindings.h"
 #include "glow/Optimizer/GraphOptimizer/GraphOptimizer.h"
 #include "glow/Partitioner/Partitioner.h"
+#include "glow/Partitioner/PartitionerUtils.h"
 #include "glow/Runtime/Executor/ThreadPoolExecutor.h"
 #include "glow/Runtime/Provisioner/Provisioner.h"
 #include "glow/Runtime/RuntimeTypes.h"
 #include "glow/Runtime/StatsExporter.h"
 #include "glow/Support/Support.h"
 
+#include "llvm/ADT/Hashing.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/FormatVariadic.h"
+#include "llvm/Support/xxhash.h"
 
 #include <glog/logging.h>
 
+#include <algorithm>
+#include <cstring>
 #include <future>
+#include <limits>
 #include <queue>
 
 using namespace glow;
@@ -74,7 +81,7 @@ Expected<DAG *> HostManager::getNetworkDAG(llvm::StringRef network) {
   if (it == networks_.end()) {
     return MAKE_ERR(ErrorValue::ErrorCode::RUNTIME_ERROR, "Network not found.");
   }
-  return &it->second.dag;
+  return &it->second->dag;
 }
 
 Error HostManager::init(std::vector<std::unique_ptr<DeviceConfig>> configs) {
@@ -93,22 +100,106 @@ Error HostManager::init(std::vector<std::unique_ptr<DeviceConfig>> configs) {
 
     deviceCount++;
   }
-  provisioner_.reset(new Provisioner(devices_));
-  executor_.reset(new ThreadPoolExecutor(devices_, config_.executorThreads));
+  provisioner_.reset(new Provisioner(devices_, config_.compileThreads));
+  executor_.reset(new ThreadPoolExecutor(devices_, config_.executorThreads,
+                                         config_.executorPipelineDepth,
+                                         config_.hedging));
+  activeRequestLimit_ = config_.maxActiveRequests;
+  if (config_.adaptiveConcurrency.latencyTarget.count()) {
+    Stats()->setCounter(kActiveRequestLimit, activeRequestLimit_);
+  }
+  if (config_.completionThreads) {
+    completions_ = llvm::make_unique<MPMCQueue<Completion>>(
+        config_.maxActiveRequests + config_.maxQueueSize);
+    stopCompletions_ = false;
+    for (size_t i = 0; i < config_.completionThreads; i++) {
+      completionThreads_.emplace_back([this]() { runCompletions(); });
+    }
+    completionsRunning_ = true;
+  }
   exportMemoryCounters();
   return Error::success();
 }
 
+void HostManager::callCompletion(Completion &completion) {
+  bool sampled = completion.context && completion.context->isStatsSampled();
+  auto callbackTime = std::chrono::steady_clock::now();
+  completion.callback(completion.runID, std::move(completion.err),
+                      std::move(completion.context));
+  if (sampled) {
+    Stats()->addLatencyValue("callback", completion.name, callbackTime);
+  }
+}
+
+void HostManager::complete(Completion completion) {
+  // Call the callback here when the queue is full, which slows down the
+  // executor rather than piling up results.
+  if (!completionsRunning_ || !completions_->push(std::move(completion))) {
+    callCompletion(completion);
+    return;
+  }
+  // A completion thread increments the waiters before it looks at the queue
+  // one last time, so either it sees the result or the result sees it.
+  if (completionWaiters_ != 0) {
+    std::lock_guard<std::mutex> lock(completionsLock_);
+    completionsCV_.notify_one();
+  }
+}
+
+void HostManager::runCompletions() {
+  while (true) {
+    if (auto completion = completions_->pop()) {
+      callCompletion(*completion);
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(completionsLock_);
+    completionWaiters_++;
+    auto completion = completions_->pop();
+    if (!completion) {
+      if (stopCompletions_) {
+        completionWaiters_--;
+        return;
+      }
+      completionsCV_.wait(lock);
+    }
+    completionWaiters_--;
+    lock.unlock();
+    if (completion) {
+      callCompletion(*completion);
+    }
+  }
+}
+
+void HostManager::stopCompletions() {
+  if (completionThreads_.empty()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(completionsLock_);
+    stopCompletions_ = true;
+  }
+  completionsCV_.notify_all();
+  for (auto &thread : completionThreads_) {
+    thread.join();
+  }
+  completionThreads_.clear();
+  completionsRunning_ = false;
+}
+
 void HostManager::exportMemoryCounters() {
   uint64_t maxMem = 0;
   uint64_t availableMem = 0;
+  uint64_t largestFreeBlock = 0;
   for (auto &dev : devices_) {
     maxMem += dev.second->getMaximumMemory();
     availableMem += dev.second->getAvailableMemory();
+    largestFreeBlock =
+        std::max(largestFreeBlock, dev.second->getLargestFreeBlock());
   }
   Stats()->setCounter(kDeviceMemoryUsed, maxMem - availableMem);
   Stats()->setCounter(kDeviceMemoryAvailable, availableMem);
   Stats()->setCounter(kDeviceMemoryMax, maxMem);
+  Stats()->setCounter(kDeviceLargestFreeBlock, largestFreeBlock);
 }
 
 HostManager::~HostManager() {
@@ -116,6 +207,23 @@ HostManager::~HostManager() {
   exportMemoryCounters();
 }
 
+/// \returns the requests per second a device described by \p info serves
+/// running \p F alone, estimated from the costs of its nodes, or zero if
+/// unknown.
+static double estimateReplicaQPS(const Function *F, const DeviceInfo &info) {
+  BackendInfo backendInfo;
+  backendInfo.sramCapacity = info.sramCapacity;
+  backendInfo.peakCompute = info.peakCompute;
+  backendInfo.peakDramBw = info.peakDramBw;
+  backendInfo.peakSramBw = info.peakSramBw;
+  backendInfo.peakPCIeBw = info.peakPCIeBw;
+  double time = 0;
+  for (const auto &N : F->getNodes()) {
+    time += getNodeComputeTime(&N, backendInfo);
+  }
+  return time > 0 ? 1 / time : 0;
+}
+
 void HostManager::cleanupAddNetwork(llvm::ArrayRef<std::string> names) {
   for (auto &name : names) {
     processingNetworks_.erase(name);
@@ -131,9 +239,7 @@ Error HostManager::addNetwork(std::unique_ptr<Module> module,
     auto functions = module->getFunctions();
     for (auto &F : functions) {
       std::string name = F->getName();
-      auto it = networks_.find(name);
-      if (it != networks_.end() ||
-          processingNetworks_.find(name) != processingNetworks_.end()) {
+      if (isNameUsed(name)) {
         cleanupAddNetwork(names);
         return MAKE_ERR(
             ErrorValue::ErrorCode::RUNTIME_ERROR,
@@ -159,7 +265,10 @@ Error HostManager::addNetwork(std::unique_ptr<Module> module,
     std::lock_guard<std::mutex> networkLock(networkLock_);
     for (auto &device : devices_) {
       DeviceInfo info = device.second->getDeviceInfo();
-      info.availableMemory = device.second->getAvailableMemory();
+      // Evicting networks can free all the memory of the device.
+      info.availableMemory = config_.evictLRUNetworks
+                                 ? device.second->getMaximumMemory()
+                                 : device.second->getAvailableMemory();
       info.backendName = device.second->getBackendName();
       info.nonSupportedNodes =
           device.second->getParamByName("nonSupportedNodes");
@@ -181,7 +290,10 @@ Error HostManager::addNetwork(std::unique_ptr<Module> module,
   }
   Partitioner partitioner(module.get(), deviceInfo, saturateHost);
   DAGListTy nodeList;
+  TRACE_EVENT_SCOPE_NAMED(cctx.traceContext, TraceLevel::COMPILE, "partition",
+                          partitionEvent);
   auto result = partitioner.partition(cctx);
+  TRACE_EVENT_SCOPE_END_NAMED(partitionEvent);
   if (result) {
     nodeList = std::move(result.get());
   } else {
@@ -208,11 +320,26 @@ Error HostManager::addNetwork(std::unique_ptr<Module> module,
           DeviceManager::createDeviceManager(*config));
       RETURN_IF_ERR(devices_[i]->init());
     }
-    provisioner_.reset(new Provisioner(devices_));
-    executor_.reset(new ThreadPoolExecutor(devices_, config_.executorThreads));
+    provisioner_.reset(new Provisioner(devices_, config_.compileThreads));
+    executor_.reset(new ThreadPoolExecutor(devices_, config_.executorThreads,
+                                           config_.executorPipelineDepth,
+                                           config_.hedging));
   }
 
   auto err = provisioner_->provision(nodeList, *module, cctx);
+  // Make room for the network by evicting the least recently run ones.
+  constexpr auto outOfMemory =
+      ErrorValue::ErrorCode::RUNTIME_OUT_OF_DEVICE_MEMORY;
+  while (config_.evictLRUNetworks && err.hasErrorCode(outOfMemory)) {
+    {
+      std::lock_guard<std::mutex> residencyLock(residencyLock_);
+      if (!evictLRUNetwork(nullptr)) {
+        break;
+      }
+    }
+    ERR_TO_VOID(std::move(err), /* log */ false);
+    err = provisioner_->provision(nodeList, *module, cctx);
+  }
   if (err) {
     {
       std::lock_guard<std::mutex> networkLock(networkLock_);
@@ -221,24 +348,114 @@ Error HostManager::addNetwork(std::unique_ptr<Module> module,
     return err;
   }
 
+  const auto &warmupOpts = cctx.warmupOpts;
+  if ((warmupOpts.prepare || warmupOpts.numRuns) &&
+      cctx.precisionConfig.quantMode != QuantizationMode::Profile) {
+    for (auto &dag : nodeList) {
+      warmUpNetwork(dag, warmupOpts);
+    }
+  }
+
+  // Estimate the requests a replica of the networks of a single partition
+  // serves, which planPlacement uses until they ran.
+  llvm::StringMap<double> replicaQPS;
+  for (auto &dag : nodeList) {
+    if (dag.nodes.size() != 1) {
+      continue;
+    }
+    const DAGNode &node = *dag.nodes[0];
+    const Function *F = module->getFunction(node.name);
+    auto infoIt = std::find_if(deviceInfo.begin(), deviceInfo.end(),
+                               [&node](const DeviceInfo &info) {
+                                 return info.backendName == node.backendName;
+                               });
+    if (F && infoIt != deviceInfo.end()) {
+      replicaQPS[dag.root->name] = estimateReplicaQPS(F, *infoIt);
+    }
+  }
+
   // Clear constants contents from the module then put it in a
   // shared_ptr to be shared between all of the networks created from each
-  // function in the module.
-  module->strip();
+  // function in the module. Networks that may be evicted keep them, in case
+  // their devices collect them again when they are reloaded.
+  if (!config_.evictLRUNetworks) {
+    module->strip();
+  }
   auto sharedModule = std::shared_ptr<Module>(std::move(module));
   {
     std::lock_guard<std::mutex> networkLock(networkLock_);
     for (auto &node : nodeList) {
-      auto &networkData = networks_[(node.root)->name];
-      networkData.dag = std::move(node);
-      networkData.module = sharedModule;
+      auto networkData = std::make_shared<NetworkData>();
+      networkData->dag = std::move(node);
+      networkData->module = sharedModule;
+      networkData->lastUse = ++useClock_;
+      networkData->estimatedReplicaQPS =
+          replicaQPS.lookup(networkData->dag.root->name);
+      networks_[networkData->dag.root->name] = std::move(networkData);
     }
+    publishNetworks();
     cleanupAddNetwork(names);
   }
   return Error::success();
 }
 
+void HostManager::warmUpNetwork(DAG &dag, const WarmupOptions &opts) {
+  const std::string &networkName = dag.root->name;
+  if (opts.prepare) {
+    for (auto &node : dag.nodes) {
+      auto *function = provisioner_->getFunction(node->name);
+      if (!function) {
+        continue;
+      }
+      if (auto err = function->warmUp()) {
+        LOG(WARNING) << "Failed to warm up " << node->name << ": "
+                     << ERR_TO_STRING(std::move(err));
+      }
+    }
+  }
+  if (!opts.numRuns) {
+    return;
+  }
+
+  // Bind zeros to all the placeholders of the partitions. The outputs are
+  // overwritten by every run.
+  auto bindings = llvm::make_unique<PlaceholderBindings>();
+  for (auto &node : dag.nodes) {
+    for (const auto &symbol : node->runtimeBundle->getSymbolTable()) {
+      if (symbol.second.symbolCategory != SymbolCategory::Placeholder) {
+        continue;
+      }
+      auto *PH = dag.root->module->getPlaceholderByName(symbol.first);
+      if (PH && !bindings->get(PH)) {
+        bindings->allocate(PH)->zero();
+      }
+    }
+  }
+  auto context = llvm::make_unique<ExecutionContext>(std::move(bindings));
+  for (unsigned i = 0; i < opts.numRuns; i++) {
+    std::promise<void> runPromise;
+    auto fut = runPromise.get_future();
+    std::unique_ptr<Error> runErr;
+    executor_->run(dag.root.get(), std::move(context), totalRequestCount_++,
+                   [&](RunIdentifierTy, Error err,
+                       std::unique_ptr<ExecutionContext> resultContext) {
+                     runErr = llvm::make_unique<Error>(std::move(err));
+                     context = std::move(resultContext);
+                     runPromise.set_value();
+                   });
+    fut.wait();
+    if (*runErr) {
+      LOG(WARNING) << "Failed to warm up " << networkName << ": "
+                   << ERR_TO_STRING(std::move(*runErr));
+      return;
+    }
+  }
+}
+
 Error HostManager::removeNetwork(llvm::StringRef networkName) {
+  // Declared before the lock so that the batching thread is joined after
+  // networkLock_ is released.
+  std::unique_ptr<BatchingData> batching;
   std::lock_guard<std::mutex> networkLock(networkLock_);
   auto networkIterator = networks_.find(networkName);
   if (networkIterator == networks_.end()) {
@@ -255,8 +472,12 @@ Error HostManager::removeNetwork(llvm::StringRef networkName) {
                         .str());
   }
 
-  // Issue an error as there are outstanding runs for the network
-  if (networkIterator->second.refcount != 0) {
+  // Issue an error as there are outstanding runs for the network. runNetwork
+  // doesn't start new runs while removing is set.
+  NetworkData &network = *networkIterator->second;
+  network.removing = true;
+  if (network.refcount != 0) {
+    network.removing = false;
     return MAKE_ERR(ErrorValue::ErrorCode::RUNTIME_NET_BUSY,
                     llvm::formatv("Cannot remove the network {0}, as there are "
                                   "still outstanding runs",
@@ -264,10 +485,28 @@ Error HostManager::removeNetwork(llvm::StringRef networkName) {
                         .str());
   }
 
+  auto batchingIt = batching_.find(networkName);
+  if (batchingIt != batching_.end()) {
+    network.batching = nullptr;
+    batching = std::move(batchingIt->second);
+    batching_.erase(batchingIt);
+  }
+
+  auto err = evictNetwork(network);
+  networks_.erase(networkIterator);
+  publishNetworks();
+  exportMemoryCounters();
+  return err;
+}
+
+Error HostManager::evictPartitions(NetworkData &network,
+                                   const std::set<DeviceIDTy> *devices) {
   OneErrOnly err;
-  auto &nodes = networkIterator->second.dag.nodes;
-  for (auto &node : nodes) {
+  for (auto &node : network.dag.nodes) {
     for (auto device : node->deviceIDs) {
+      if (devices && !devices->count(device)) {
+        continue;
+      }
       std::promise<void> removeNetwork;
       auto done = removeNetwork.get_future();
       std::unique_ptr<Error> removeErr;
@@ -280,23 +519,1039 @@ Error HostManager::removeNetwork(llvm::StringRef networkName) {
       done.get();
       err.set(std::move(*DCHECK_NOTNULL(removeErr.get())));
     }
+  }
+  return err.get();
+}
+
+Error HostManager::evictNetwork(NetworkData &network) {
+  OneErrOnly err;
+  // An evicted network has no partitions left on the devices.
+  if (network.resident) {
+    err.set(evictPartitions(network));
+  }
+  for (auto &node : network.dag.nodes) {
     // Also remove compiledFunction from Provisioner.
     err.set(provisioner_->removeFunction(node->name));
   }
-  networks_.erase(networkIterator);
-  exportMemoryCounters();
+  executor_->removeDAG(network.dag.root.get());
   return err.get();
 }
 
+bool HostManager::evictLRUNetwork(const NetworkData *keep) {
+  std::lock_guard<std::mutex> networkLock(networkLock_);
+  std::vector<NetworkData *> candidates;
+  for (auto &it : networks_) {
+    NetworkData *network = it.second.get();
+    if (network != keep && network->resident && !network->removing) {
+      candidates.push_back(network);
+    }
+  }
+  std::sort(candidates.begin(), candidates.end(),
+            [](const NetworkData *a, const NetworkData *b) {
+              return a->lastUse < b->lastUse;
+            });
+  for (auto *network : candidates) {
+    // Either this sees the refcount of a new run, or the run sees that the
+    // network isn't resident and waits on residencyLock_ to reload it.
+    network->resident = false;
+    if (network->refcount != 0) {
+      network->resident = true;
+      continue;
+    }
+    if (auto err = evictPartitions(*network)) {
+      LOG(ERROR) << "Failed to evict network " << network->dag.root->name
+                 << ": " << errorToString(std::move(err));
+    }
+    Stats()->incrementCounter(kEvictedNetworks);
+    exportMemoryCounters();
+    return true;
+  }
+  return false;
+}
+
+Error HostManager::reloadNetwork(NetworkData &network) {
+  auto startTime = std::chrono::steady_clock::now();
+  // The partitions go back to the devices they were provisioned on.
+  std::map<DeviceIDTy, FunctionMapTy> deviceFunctions;
+  for (auto &node : network.dag.nodes) {
+    CompiledFunction *function = provisioner_->getFunction(node->name);
+    RETURN_ERR_IF_NOT(function, "Missing compiled function " + node->name);
+    for (auto device : node->deviceIDs) {
+      deviceFunctions[device].emplace(node->name, function);
+    }
+  }
+
+  std::set<DeviceIDTy> added;
+  for (auto &it : deviceFunctions) {
+    while (true) {
+      std::promise<void> addPromise;
+      auto ready = addPromise.get_future();
+      std::unique_ptr<Error> addErr;
+      devices_[it.first]->addNetwork(
+          network.module.get(), it.second,
+          [&addErr, &addPromise](const Module *, Error err) {
+            addErr = llvm::make_unique<Error>(std::move(err));
+            addPromise.set_value();
+          });
+      ready.wait();
+      Error err = std::move(*DCHECK_NOTNULL(addErr.get()));
+      if (!err) {
+        added.insert(it.first);
+        break;
+      }
+      if (!err.hasErrorCode(
+              ErrorValue::ErrorCode::RUNTIME_OUT_OF_DEVICE_MEMORY) ||
+          !evictLRUNetwork(&network)) {
+        // Don't leave the network partly on the devices.
+        ERR_TO_VOID(evictPartitions(network, &added));
+        return err;
+      }
+      ERR_TO_VOID(std::move(err), /* log */ false);
+    }
+  }
+
+  network.resident = true;
+  auto reloadTime = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - startTime);
+  Stats()->addTimeSeriesValue(kReloadLatency, reloadTime.count());
+  exportMemoryCounters();
+  return Error::success();
+}
+
+bool HostManager::isNameUsed(llvm::StringRef name) const {
+  if (networks_.count(name) || processingNetworks_.count(name)) {
+    return true;
+  }
+  for (const auto &it : networks_) {
+    if (it.second->dag.root->name == name) {
+      return true;
+    }
+  }
+  for (const auto &network : retiredNetworks_) {
+    if (network->dag.root->name == name) {
+      return true;
+    }
+  }
+  return false;
+}
+
+std::future<Error> HostManager::runAsync(std::function<Error()> work) {
+  auto promise = std::make_shared<std::promise<Error>>();
+  auto future = promise->get_future();
+  {
+    std::lock_guard<std::mutex> asyncLoadsLock(asyncLoadsLock_);
+    asyncLoads_++;
+  }
+  std::thread([this, promise, work = std::move(work)]() {
+    promise->set_value(work());
+    // Notify while holding the lock, so that the HostManager isn't destroyed
+    // before this thread is done with it.
+    std::lock_guard<std::mutex> asyncLoadsLock(asyncLoadsLock_);
+    if (--asyncLoads_ == 0) {
+      asyncLoadsDone_.notify_all();
+    }
+  }).detach();
+  return future;
+}
+
+std::future<Error> HostManager::addNetworkAsync(std::unique_ptr<Module> module,
+                                                CompilationContext cctx,
+                                                bool saturateHost) {
+  // std::function must be copyable, so it holds the module through a
+  // shared_ptr.
+  auto holder = std::make_shared<std::unique_ptr<Module>>(std::move(module));
+  return runAsync([this, holder, cctx, saturateHost]() mutable {
+    return addNetwork(std::move(*holder), cctx, saturateHost);
+  });
+}
+
+std::future<Error> HostManager::swapNetwork(llvm::StringRef networkName,
+                                            std::unique_ptr<Module> module,
+                                            CompilationContext cctx) {
+  auto holder = std::make_shared<std::unique_ptr<Module>>(std::move(module));
+  return runAsync([this, name = networkName.str(), holder, cctx]() mutable {
+    return swapNetworkImpl(name, std::move(*holder), cctx);
+  });
+}
+
+Error HostManager::swapNetworkImpl(const std::string &networkName,
+                                   std::unique_ptr<Module> module,
+                                   CompilationContext &cctx) {
+  RETURN_ERR_IF_NOT(module->getFunctions().size() == 1,
+                    "The new version of a network must be a single function");
+  std::string functionName = module->getFunctions().front()->getName();
+  // \returns an Error if the network can't be swapped. This must be called
+  // while holding a lock on networkLock_.
+  auto checkSwappable = [this, &networkName]() -> Error {
+    if (!networks_.count(networkName)) {
+      return MAKE_ERR(ErrorValue::ErrorCode::RUNTIME_NET_NOT_FOUND,
+                      llvm::formatv("Cannot swap the network {0}: network not "
+                                    "found",
+                                    networkName)
+                          .str());
+    }
+    for (const auto &it : batching_) {
+      if (it.first == networkName ||
+          it.second->config.batchedNetworkName == networkName) {
+        return MAKE_ERR(ErrorValue::ErrorCode::RUNTIME_ERROR,
+                        llvm::formatv("Cannot swap the batched network {0}",
+                                      networkName)
+                            .str());
+      }
+    }
+    const auto &network = *networks_[networkName];
+    if (network.isBatchVariant || std::atomic_load(&network.batchVariants)) {
+      return MAKE_ERR(ErrorValue::ErrorCode::RUNTIME_ERROR,
+                      llvm::formatv("Cannot swap the network {0}, which has "
+                                    "batch variants or is one",
+                                    networkName)
+                          .str());
+    }
+    return Error::success();
+  };
+  {
+    std::lock_guard<std::mutex> networkLock(networkLock_);
+    RETURN_IF_ERR(checkSwappable());
+  }
+
+  // Add the new version under the name of its function.
+  RETURN_IF_ERR(addNetwork(std::move(module), cctx));
+
+  // Switch the runs to the new version.
+  std::shared_ptr<NetworkData> oldNetwork;
+  {
+    std::unique_lock<std::mutex> networkLock(networkLock_);
+    if (auto err = checkSwappable()) {
+      // The old version was removed or batched meanwhile, drop the new one.
+      networkLock.unlock();
+      ERR_TO_VOID(removeNetwork(functionName));
+      return err;
+    }
+    auto newIt = networks_.find(functionName);
+    auto &slot = networks_[networkName];
+    oldNetwork = std::move(slot);
+    slot = std::move(newIt->second);
+    slot->tenant = oldNetwork->tenant.load();
+    networks_.erase(newIt);
+    publishNetworks();
+    // From here runNetwork doesn't start runs of the old version, it looks
+    // the network up again in the published networks instead.
+    oldNetwork->removing = true;
+    retiredNetworks_.push_back(oldNetwork);
+  }
+
+  // Wait for the runs of the old version that started before the switch.
+  while (oldNetwork->refcount != 0) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  auto err = evictNetwork(*oldNetwork);
+  {
+    std::lock_guard<std::mutex> networkLock(networkLock_);
+    retiredNetworks_.erase(std::find(retiredNetworks_.begin(),
+                                     retiredNetworks_.end(), oldNetwork));
+    exportMemoryCounters();
+  }
+  return err;
+}
+
+Error HostManager::addTenant(const TenantConfig &config) {
+  std::lock_guard<std::mutex> tenantsLock(tenantsLock_);
+  RETURN_ERR_IF_NOT(!tenants_.count(config.name),
+                    "There is already a tenant called " + config.name);
+  tenants_.emplace(config.name, llvm::make_unique<TenantData>(config));
+  return Error::success();
+}
+
+Error HostManager::setTenant(llvm::StringRef networkName,
+                             llvm::StringRef tenantName) {
+  std::lock_guard<std::mutex> networkLock(networkLock_);
+  std::lock_guard<std::mutex> tenantsLock(tenantsLock_);
+  auto networkIt = networks_.find(networkName);
+  RETURN_ERR_IF_NOT(networkIt != networks_.end(),
+                    llvm::formatv("Function {0} not found", networkName).str(),
+                    ErrorValue::ErrorCode::RUNTIME_NET_NOT_FOUND);
+  auto tenantIt = tenants_.find(tenantName);
+  RETURN_ERR_IF_NOT(tenantIt != tenants_.end(),
+                    "Tenant " + tenantName.str() + " not found");
+  networkIt->second->tenant = tenantIt->second.get();
+  return Error::success();
+}
+
+Error HostManager::setTargetQPS(llvm::StringRef networkName, double qps) {
+  std::lock_guard<std::mutex> networkLock(networkLock_);
+  auto it = networks_.find(networkName);
+  RETURN_ERR_IF_NOT(it != networks_.end(),
+                    llvm::formatv("Function {0} not found", networkName).str(),
+                    ErrorValue::ErrorCode::RUNTIME_NET_NOT_FOUND);
+  it->second->targetQPS = qps;
+  return Error::success();
+}
+
+bool HostManager::canPlaceReplicas(llvm::StringRef name,
+                                   const NetworkData &network) {
+  if (config_.evictLRUNetworks || network.dag.nodes.size() != 1 ||
+      !network.resident || network.removing || network.isBatchVariant ||
+      std::atomic_load(&network.batchVariants)) {
+    return false;
+  }
+  for (const auto &it : batching_) {
+    if (it.first == name || it.second->config.batchedNetworkName == name) {
+      return false;
+    }
+  }
+  // The devices collect the constants of the function from the module when
+  // it doesn't hold them, and the module was stripped.
+  auto *function = provisioner_->getFunction(network.dag.nodes[0]->name);
+  if (!function) {
+    return false;
+  }
+  const auto &bundle = function->getRuntimeBundle();
+  return bundle.getConstants() || !bundle.getConstantWeightSize();
+}
+
+Expected<PlacementPlan> HostManager::planPlacement() {
+  std::lock_guard<std::mutex> networkLock(networkLock_);
+  std::vector<DeviceIDTy> deviceIDs;
+  std::unordered_map<DeviceIDTy, unsigned> indices;
+  std::vector<DeviceInfo> deviceInfo;
+  for (auto &device : devices_) {
+    DeviceInfo info = device.second->getDeviceInfo();
+    info.availableMemory = device.second->getAvailableMemory();
+    info.backendName = device.second->getBackendName();
+    indices[device.first] = deviceIDs.size();
+    deviceIDs.push_back(device.first);
+    deviceInfo.push_back(info);
+  }
+
+  auto now = std::chrono::steady_clock::now();
+  std::vector<NetworkLoad> loads;
+  for (auto &it : networks_) {
+    NetworkData &network = *it.second;
+    if (!canPlaceReplicas(it.first, network)) {
+      continue;
+    }
+    const DAGNode &node = *network.dag.nodes[0];
+    NetworkLoad load;
+    load.name = it.first;
+    load.backendName = node.backendName;
+    load.memory = provisioner_->getFunction(node.name)
+                      ->getRuntimeBundle()
+                      .getConstantWeightSize();
+
+    // Plan for the rate of the requests since the last plan, unless the
+    // network has a target.
+    uint64_t numRequests = network.numRequests;
+    double elapsed =
+        std::chrono::duration<double>(now - network.observedTime).count();
+    load.targetQPS = network.targetQPS;
+    if (load.targetQPS <= 0 && elapsed > 0) {
+      load.targetQPS = (numRequests - network.observedRequests) / elapsed;
+    }
+    network.observedRequests = numRequests;
+    network.observedTime = now;
+
+    uint64_t runTimeUs = network.estimatedRunTimeUs;
+    load.replicaQPS = runTimeUs ? 1e6 / runTimeUs : network.estimatedReplicaQPS;
+
+    // The memory of the current replicas is available to the plan.
+    for (auto device : node.deviceIDs) {
+      auto indexIt = indices.find(device);
+      if (indexIt != indices.end()) {
+        load.devices.push_back(indexIt->second);
+        deviceInfo[indexIt->second].availableMemory += load.memory;
+      }
+    }
+    loads.push_back(std::move(load));
+  }
+
+  PlacementPlan plan;
+  ASSIGN_VALUE_OR_RETURN_ERR(plan, glow::planPlacement(loads, deviceInfo));
+  for (auto &it : plan.replicas) {
+    for (auto &device : it.second) {
+      device = deviceIDs[device];
+    }
+  }
+  return plan;
+}
+
+Expected<unsigned> HostManager::applyPlacement(const PlacementPlan &plan) {
+  // The networks losing replicas, then the others.
+  std::vector<std::pair<std::string, std::vector<DeviceIDTy>>> moves;
+  {
+    std::lock_guard<std::mutex> networkLock(networkLock_);
+    size_t numShrinking = 0;
+    for (const auto &it : plan.replicas) {
+      auto networkIt = networks_.find(it.first);
+      if (networkIt == networks_.end() ||
+          !canPlaceReplicas(it.first, *networkIt->second)) {
+        continue;
+      }
+      std::vector<DeviceIDTy> current =
+          networkIt->second->dag.nodes[0]->deviceIDs;
+      std::vector<DeviceIDTy> planned(it.second.begin(), it.second.end());
+      std::sort(current.begin(), current.end());
+      std::sort(planned.begin(), planned.end());
+      if (planned.empty() || current == planned) {
+        continue;
+      }
+      moves.emplace_back(it.first, std::move(planned));
+      if (!std::includes(moves.back().second.begin(),
+                         moves.back().second.end(), current.begin(),
+                         current.end())) {
+        std::swap(moves[numShrinking++], moves.back());
+      }
+    }
+  }
+
+  unsigned numMoved = 0;
+  for (const auto &move : moves) {
+    bool moved;
+    ASSIGN_VALUE_OR_RETURN_ERR(moved, moveReplicas(move.first, move.second));
+    numMoved += moved;
+  }
+  return numMoved;
+}
+
+Expected<bool> HostManager::moveReplicas(const std::string &networkName,
+                                         llvm::ArrayRef<DeviceIDTy> deviceIDs) {
+  std::shared_ptr<NetworkData> oldNetwork;
+  std::set<DeviceIDTy> dropped;
+  {
+    // Loading the replicas holds the lock, so that the network isn't
+    // removed meanwhile. runNetwork doesn't take it.
+    std::lock_guard<std::mutex> networkLock(networkLock_);
+    auto it = networks_.find(networkName);
+    if (it == networks_.end() || !canPlaceReplicas(networkName, *it->second)) {
+      return false;
+    }
+    const NetworkData &network = *it->second;
+    const DAGNode &node = *network.dag.nodes[0];
+    CompiledFunction *function = provisioner_->getFunction(node.name);
+    FunctionMapTy functions{{node.name, function}};
+    std::vector<DeviceIDTy> placed;
+    for (auto device : deviceIDs) {
+      if (std::find(node.deviceIDs.begin(), node.deviceIDs.end(), device) !=
+          node.deviceIDs.end()) {
+        placed.push_back(device);
+        continue;
+      }
+      auto deviceIt = devices_.find(device);
+      if (deviceIt == devices_.end() ||
+          deviceIt->second->getBackendName() != node.backendName) {
+        LOG(WARNING) << "Cannot place a replica of " << networkName
+                     << " on device " << device;
+        continue;
+      }
+      std::promise<void> addPromise;
+      auto ready = addPromise.get_future();
+      std::unique_ptr<Error> addErr;
+      deviceIt->second->addNetwork(
+          network.module.get(), functions,
+          [&addErr, &addPromise](const Module *, Error err) {
+            addErr = llvm::make_unique<Error>(std::move(err));
+            addPromise.set_value();
+          });
+      ready.wait();
+      if (Error err = std::move(*DCHECK_NOTNULL(addErr.get()))) {
+        LOG(WARNING) << "Failed to add a replica of " << networkName
+                     << " to device " << device << ": "
+                     << ERR_TO_STRING(std::move(err));
+        continue;
+      }
+      placed.push_back(device);
+    }
+    for (auto device : node.deviceIDs) {
+      if (std::find(placed.begin(), placed.end(), device) == placed.end()) {
+        dropped.insert(device);
+      }
+    }
+    if (placed.empty() ||
+        (dropped.empty() && placed.size() == node.deviceIDs.size())) {
+      return false;
+    }
+
+    // A copy of the network whose node runs on the placed devices. The
+    // compiled function stays in the Provisioner, shared by both.
+    auto newNetwork = std::make_shared<NetworkData>();
+    auto copyNode = [](const DAGNode &from) {
+      auto to = llvm::make_unique<DAGNode>();
+      to->deviceIDs = from.deviceIDs;
+      to->backendName = from.backendName;
+      to->logicalDevices = from.logicalDevices;
+      to->name = from.name;
+      if (from.runtimeBundle) {
+        to->runtimeBundle =
+            llvm::make_unique<RuntimeBundle>(*from.runtimeBundle);
+      }
+      to->backendHints = from.backendHints;
+      to->module = from.module;
+      to->predicate = from.predicate;
+      return to;
+    };
+    newNetwork->dag.root = copyNode(*network.dag.root);
+    newNetwork->dag.nodes.push_back(copyNode(node));
+    DAGNode *root = newNetwork->dag.root.get();
+    DAGNode *newNode = newNetwork->dag.nodes[0].get();
+    newNode->deviceIDs = placed;
+    root->children.push_back(newNode);
+    newNode->parents.push_back(root);
+    newNetwork->module = network.module;
+    newNetwork->estimatedRunTimeUs = network.estimatedRunTimeUs.load();
+    newNetwork->lastUse = network.lastUse.load();
+    newNetwork->tenant = network.tenant.load();
+    newNetwork->resultCache = std::atomic_load(&network.resultCache);
+    newNetwork->targetQPS = network.targetQPS;
+    newNetwork->numRequests = network.numRequests.load();
+    newNetwork->observedRequests = network.observedRequests;
+    newNetwork->observedTime = network.observedTime;
+    newNetwork->estimatedReplicaQPS = network.estimatedReplicaQPS;
+
+    oldNetwork = std::move(it->second);
+    it->second = std::move(newNetwork);
+    publishNetworks();
+    // From here runNetwork doesn't start runs of the old network, see
+    // swapNetworkImpl.
+    oldNetwork->removing = true;
+    retiredNetworks_.push_back(oldNetwork);
+  }
+
+  // Wait for the runs of the old network that started before the switch.
+  while (oldNetwork->refcount != 0) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  auto err = evictPartitions(*oldNetwork, &dropped);
+  executor_->removeDAG(oldNetwork->dag.root.get());
+  {
+    std::lock_guard<std::mutex> networkLock(networkLock_);
+    retiredNetworks_.erase(std::find(retiredNetworks_.begin(),
+                                     retiredNetworks_.end(), oldNetwork));
+    exportMemoryCounters();
+  }
+  RETURN_IF_ERR(err);
+  return true;
+}
+
 bool HostManager::networkAdded(llvm::StringRef networkName) {
+  return std::atomic_load(&publishedNetworks_)->count(networkName);
+}
+
+void HostManager::publishNetworks() {
+  auto networks = std::make_shared<NetworkMapTy>();
+  for (const auto &it : networks_) {
+    (*networks)[it.first] = it.second;
+  }
+  std::atomic_store(&publishedNetworks_,
+                    std::shared_ptr<const NetworkMapTy>(std::move(networks)));
+}
+
+/// \returns true if \p batchedTy is the type of \p batchSize tensors of type
+/// \p ty concatenated along their first dimension.
+static bool isBatchOfType(TypeRef batchedTy, TypeRef ty, size_t batchSize) {
+  auto dims = ty->dims();
+  auto batchedDims = batchedTy->dims();
+  if (ty->getElementType() != batchedTy->getElementType() || dims.empty() ||
+      dims.size() != batchedDims.size() ||
+      batchedDims[0] != dims[0] * batchSize ||
+      dims.slice(1) != batchedDims.slice(1)) {
+    return false;
+  }
+  return !ty->isQuantizedType() ||
+         (ty->getScale() == batchedTy->getScale() &&
+          ty->getOffset() == batchedTy->getOffset());
+}
+
+Error HostManager::enableBatching(llvm::StringRef networkName,
+                                  const BatchingConfig &config) {
+  std::lock_guard<std::mutex> networkLock(networkLock_);
+  auto it = networks_.find(networkName);
+  auto batchedIt = networks_.find(config.batchedNetworkName);
+  if (it == networks_.end() || batchedIt == networks_.end()) {
+    return MAKE_ERR(ErrorValue::ErrorCode::RUNTIME_NET_NOT_FOUND,
+                    llvm::formatv("Cannot batch {0} with {1}: network not "
+                                  "found",
+                                  networkName, config.batchedNetworkName)
+                        .str());
+  }
+  if (batching_.count(networkName)) {
+    return MAKE_ERR(ErrorValue::ErrorCode::RUNTIME_ERROR,
+                    llvm::formatv("Batching of {0} is already enabled",
+                                  networkName)
+                        .str());
+  }
+  RETURN_ERR_IF_NOT(config.maxBatchSize > 0,
+                    "The maximum batch size must be positive");
+  RETURN_ERR_IF_NOT(!it->second->isBatchVariant &&
+                        !std::atomic_load(&it->second->batchVariants),
+                    "Cannot batch a network that has batch variants or is one");
+
+  auto batching = llvm::make_unique<BatchingData>(config, it->second.get(),
+                                                  batchedIt->second->module);
+  for (auto *PH : batching->batchedModule->getPlaceholders()) {
+    batching->placeholders[PH->getName()] = PH;
+  }
+  for (auto *PH : it->second->module->getPlaceholders()) {
+    auto placeholderIt = batching->placeholders.find(PH->getName());
+    if (placeholderIt == batching->placeholders.end() ||
+        !isBatchOfType(placeholderIt->second->getType(), PH->getType(),
+                       config.maxBatchSize)) {
+      return MAKE_ERR(
+          ErrorValue::ErrorCode::RUNTIME_ERROR,
+          llvm::formatv("Cannot batch {0} with {1}: no placeholder {2} of {3} "
+                        "batches of its type",
+                        networkName, config.batchedNetworkName, PH->getName(),
+                        config.maxBatchSize)
+              .str());
+    }
+  }
+
+  batching->thread =
+      std::thread(&HostManager::runBatching, this, batching.get());
+  it->second->batching = batching.get();
+  batching_[networkName] = std::move(batching);
+  return Error::success();
+}
+
+/// \returns true if \p variantTy is \p ty but for its first dimension.
+static bool isBatchVariantOfType(TypeRef variantTy, TypeRef ty) {
+  auto dims = ty->dims();
+  auto variantDims = variantTy->dims();
+  if (ty->getElementType() != variantTy->getElementType() || dims.empty() ||
+      dims.size() != variantDims.size() ||
+      dims.slice(1) != variantDims.slice(1)) {
+    return false;
+  }
+  return !ty->isQuantizedType() ||
+         (ty->getScale() == variantTy->getScale() &&
+          ty->getOffset() == variantTy->getOffset());
+}
+
+Error HostManager::addBatchVariant(llvm::StringRef networkName,
+                                   llvm::StringRef variantName) {
+  std::lock_guard<std::mutex> networkLock(networkLock_);
+  auto it = networks_.find(networkName);
+  auto variantIt = networks_.find(variantName);
+  if (it == networks_.end() || variantIt == networks_.end()) {
+    return MAKE_ERR(ErrorValue::ErrorCode::RUNTIME_NET_NOT_FOUND,
+                    llvm::formatv("Cannot add the variant {1} of {0}: network "
+                                  "not found",
+                                  networkName, variantName)
+                        .str());
+  }
+  auto &network = *it->second;
+  auto &variant = *variantIt->second;
+  if (network.isBatchVariant || variant.isBatchVariant ||
+      std::atomic_load(&variant.batchVariants) || network.batching ||
+      variant.batching || networkName == variantName) {
+    return MAKE_ERR(ErrorValue::ErrorCode::RUNTIME_ERROR,
+                    llvm::formatv("Cannot add the variant {1} of {0}: the "
+                                  "networks are batched or have variants",
+                                  networkName, variantName)
+                        .str());
+  }
+
+  const auto &placeholders = network.module->getPlaceholders();
+  RETURN_ERR_IF_NOT(!placeholders.empty(),
+                    "Cannot add variants of a network without placeholders");
+  for (auto *PH : placeholders) {
+    auto *variantPH = variant.module->getPlaceholderByName(PH->getName());
+    if (!variantPH ||
+        !isBatchVariantOfType(variantPH->getType(), PH->getType())) {
+      return MAKE_ERR(
+          ErrorValue::ErrorCode::RUNTIME_ERROR,
+          llvm::formatv("Cannot add the variant {1} of {0}: no placeholder "
+                        "{2} of its type for another batch size",
+                        networkName, variantName, PH->getName())
+              .str());
+    }
+  }
+
+  auto variants = std::make_shared<BatchVariants>();
+  if (auto current = std::atomic_load(&network.batchVariants)) {
+    *variants = *current;
+  }
+  auto *batchPH = placeholders.front();
+  variants->placeholderName = batchPH->getName();
+  size_t batchSize =
+      variant.module->getPlaceholderByName(batchPH->getName())->dims()[0];
+  RETURN_ERR_IF_NOT(batchSize != batchPH->dims()[0] &&
+                        !variants->names.count(batchSize),
+                    llvm::formatv("There is already a variant of {0} for "
+                                  "batches of {1}",
+                                  networkName, batchSize)
+                        .str());
+  variants->names[batchSize] = variantName;
+  variant.isBatchVariant = true;
+  std::atomic_store(&network.batchVariants,
+                    std::shared_ptr<const BatchVariants>(std::move(variants)));
+  return Error::success();
+}
+
+Error HostManager::enableResultCache(llvm::StringRef networkName,
+                                     const ResultCacheConfig &config) {
   std::lock_guard<std::mutex> networkLock(networkLock_);
-  return networks_.find(networkName) != networks_.end();
+  auto it = networks_.find(networkName);
+  if (it == networks_.end()) {
+    return MAKE_ERR(ErrorValue::ErrorCode::RUNTIME_NET_NOT_FOUND,
+                    llvm::formatv("Cannot cache the results of {0}: network "
+                                  "not found",
+                                  networkName)
+                        .str());
+  }
+  NetworkData &network = *it->second;
+  if (std::atomic_load(&network.resultCache)) {
+    return MAKE_ERR(ErrorValue::ErrorCode::RUNTIME_ERROR,
+                    llvm::formatv("The result cache of {0} is already enabled",
+                                  networkName)
+                        .str());
+  }
+
+  // The placeholders a partition writes are outputs of the network, even if
+  // later partitions read them, and the other ones they read are inputs.
+  std::set<std::string> read;
+  std::set<std::string> written;
+  for (const auto &node : network.dag.nodes) {
+    RETURN_ERR_IF_NOT(node->runtimeBundle,
+                      "Cannot cache the results of a network whose "
+                      "placeholders are unknown");
+    for (const auto &symbol : node->runtimeBundle->getSymbolTable()) {
+      const RuntimeSymbolInfo &info = symbol.second;
+      if (info.symbolCategory != SymbolCategory::Placeholder) {
+        continue;
+      }
+      if (info.input && info.output) {
+        return MAKE_ERR(ErrorValue::ErrorCode::RUNTIME_ERROR,
+                        llvm::formatv("Cannot cache the results of {0}: it "
+                                      "reads and writes {1}",
+                                      networkName, symbol.first)
+                            .str());
+      }
+      if (info.input) {
+        read.insert(symbol.first);
+      }
+      if (info.output) {
+        written.insert(symbol.first);
+      }
+    }
+  }
+
+  auto cache =
+      std::make_shared<ResultCacheData>(config, networkName, network.module);
+  for (const auto &name : read) {
+    if (!written.count(name)) {
+      cache->inputs.push_back(network.module->getPlaceholderByName(name));
+    }
+  }
+  for (const auto &name : written) {
+    cache->outputs.push_back(network.module->getPlaceholderByName(name));
+  }
+  for (auto *PH : cache->inputs) {
+    RETURN_ERR_IF_NOT(PH, "The partitions read an unknown placeholder");
+  }
+  for (auto *PH : cache->outputs) {
+    RETURN_ERR_IF_NOT(PH, "The partitions write an unknown placeholder");
+  }
+  std::atomic_store(&network.resultCache, std::move(cache));
+  return Error::success();
+}
+
+/// \returns the tensor bound to \p PH in \p bindings, or to the placeholder
+/// of the same name, or null.
+static Tensor *getBoundTensor(PlaceholderBindings &bindings, Placeholder *PH) {
+  if (Tensor *T = bindings.get(PH)) {
+    return T;
+  }
+  auto *boundPH = bindings.getPlaceholderByName(PH->getName());
+  return boundPH ? bindings.get(boundPH) : nullptr;
+}
+
+bool HostManager::ResultCacheData::getKey(PlaceholderBindings &bindings,
+                                          uint64_t &key) const {
+  key = 0;
+  for (auto *PH : inputs) {
+    Tensor *T = getBoundTensor(bindings, PH);
+    if (!T) {
+      return false;
+    }
+    key = llvm::hash_combine(
+        key, llvm::xxHash64(llvm::StringRef(T->getUnsafePtr(),
+                                            T->getSizeInBytes())));
+  }
+  return true;
+}
+
+bool HostManager::ResultCacheData::lookup(uint64_t key,
+                                          PlaceholderBindings &bindings) {
+  std::lock_guard<std::mutex> cacheLock(lock);
+  bool hit = false;
+  lookups++;
+  auto it = index.find(key);
+  if (it != index.end()) {
+    Entry &entry = *it->second;
+    if (entry.expiry <= std::chrono::steady_clock::now()) {
+      bytes -= entry.bytes;
+      entries.erase(it->second);
+      index.erase(it);
+    } else {
+      // Check the inputs, another run may have the same hash, and that every
+      // bound output was cached with its type, before copying any of them.
+      hit = true;
+      for (size_t i = 0, e = inputs.size(); hit && i < e; i++) {
+        Tensor *T = getBoundTensor(bindings, inputs[i]);
+        const Tensor &cached = entry.inputs[i];
+        hit = T->getType().isEqual(cached.getType()) &&
+              !std::memcmp(T->getUnsafePtr(), cached.getUnsafePtr(),
+                           cached.getSizeInBytes());
+      }
+      std::vector<std::pair<Tensor *, const Tensor *>> copies;
+      for (size_t i = 0, j = 0, e = outputs.size(); hit && i < e; i++) {
+        Tensor *T = getBoundTensor(bindings, outputs[i]);
+        while (j < entry.outputs.size() && entry.outputs[j].first < i) {
+          j++;
+        }
+        if (!T) {
+          continue;
+        }
+        hit = j < entry.outputs.size() && entry.outputs[j].first == i &&
+              T->getType().isEqual(entry.outputs[j].second.getType());
+        if (hit) {
+          copies.emplace_back(T, &entry.outputs[j].second);
+        }
+      }
+      if (hit) {
+        for (auto &copy : copies) {
+          copy.first->assign(copy.second);
+        }
+        entries.splice(entries.begin(), entries, it->second);
+        hits++;
+      }
+    }
+  }
+  Stats()->incrementCounter(hit ? kResultCacheHits : kResultCacheMisses);
+  Stats()->setCounter(hitRateKey, hits * 100 / lookups);
+  return hit;
+}
+
+void HostManager::ResultCacheData::insert(uint64_t key,
+                                          PlaceholderBindings &bindings) {
+  Entry entry;
+  entry.key = key;
+  entry.bytes = 0;
+  for (auto *PH : inputs) {
+    Tensor *T = getBoundTensor(bindings, PH);
+    if (!T) {
+      return;
+    }
+    entry.inputs.push_back(T->clone());
+    entry.bytes += T->getSizeInBytes();
+  }
+  for (size_t i = 0, e = outputs.size(); i < e; i++) {
+    if (Tensor *T = getBoundTensor(bindings, outputs[i])) {
+      entry.outputs.emplace_back(i, T->clone());
+      entry.bytes += T->getSizeInBytes();
+    }
+  }
+  if (entry.bytes > config.maxBytes) {
+    return;
+  }
+  auto now = std::chrono::steady_clock::now();
+  entry.expiry = now + config.ttl;
+
+  std::lock_guard<std::mutex> cacheLock(lock);
+  auto it = index.find(key);
+  if (it != index.end()) {
+    bytes -= it->second->bytes;
+    entries.erase(it->second);
+    index.erase(it);
+  }
+  // Drop the expired runs and then the least recently used ones.
+  while (!entries.empty() && (bytes + entry.bytes > config.maxBytes ||
+                              entries.back().expiry <= now)) {
+    bytes -= entries.back().bytes;
+    index.erase(entries.back().key);
+    entries.pop_back();
+  }
+  bytes += entry.bytes;
+  entries.push_front(std::move(entry));
+  index[key] = entries.begin();
+}
+
+HostManager::BatchingData::~BatchingData() {
+  if (!thread.joinable()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> batchingLock(lock);
+    stop = true;
+  }
+  cv.notify_one();
+  thread.join();
+}
+
+void HostManager::runBatching(BatchingData *batching) {
+  const BatchingConfig &config = batching->config;
+  auto &pending = batching->pending;
+  std::unique_lock<std::mutex> batchingLock(batching->lock);
+  while (true) {
+    if (pending.empty()) {
+      if (batching->stop) {
+        return;
+      }
+      batching->cv.wait(batchingLock);
+      continue;
+    }
+    // Wait for a full batch, unless the oldest request has waited long
+    // enough.
+    auto deadline = pending.front().second + config.maxWait;
+    if (!batching->stop && pending.size() < config.maxBatchSize &&
+        std::chrono::steady_clock::now() < deadline) {
+      batching->cv.wait_until(batchingLock, deadline);
+      continue;
+    }
+    std::vector<InferRequest> requests;
+    while (!pending.empty() && requests.size() < config.maxBatchSize) {
+      requests.push_back(std::move(pending.front().first));
+      pending.pop_front();
+    }
+    batchingLock.unlock();
+    dispatchBatch(batching, std::move(requests));
+    batchingLock.lock();
+  }
+}
+
+void HostManager::dispatchBatch(BatchingData *batching,
+                                std::vector<InferRequest> requests) {
+  const BatchingConfig &config = batching->config;
+  NetworkData *network = batching->network;
+  auto batchContext = llvm::make_unique<ExecutionContext>();
+  auto *batchBindings = batchContext->getPlaceholderBindings();
+  auto batch = std::make_shared<std::vector<InferRequest>>();
+  uint64_t priority = std::numeric_limits<uint64_t>::max();
+  for (auto &request : requests) {
+    // Refuse requests whose bindings don't match the batched network.
+    auto *bindings = request.context->getPlaceholderBindings();
+    bool isValid = true;
+    for (const auto &pair : bindings->pairs()) {
+      auto it = batching->placeholders.find(pair.first->getName());
+      if (it != batching->placeholders.end() &&
+          !isBatchOfType(it->second->getType(), &pair.second->getType(),
+                         config.maxBatchSize)) {
+        isValid = false;
+      }
+    }
+    if (!isValid) {
+      network->refcount--;
+      request.callback(
+          request.requestID,
+          MAKE_ERR(ErrorValue::ErrorCode::RUNTIME_ERROR,
+                   "The tensors of the request cannot be batched"),
+          std::move(request.context));
+      continue;
+    }
+    if (request.context->isCancelled()) {
+      request.network = network;
+      failCancelled(request);
+      continue;
+    }
+    // The batch runs the batched network, only the requests whose deadline
+    // already passed are known to be late.
+    if (request.deadline <= std::chrono::steady_clock::now()) {
+      request.network = network;
+      failDeadline(request);
+      continue;
+    }
+
+    // Copy the tensors of the request into its slice of the batch.
+    size_t index = batch->size();
+    for (const auto &pair : bindings->pairs()) {
+      auto it = batching->placeholders.find(pair.first->getName());
+      if (it == batching->placeholders.end()) {
+        continue;
+      }
+      Tensor *batchTensor = batchBindings->get(it->second);
+      if (!batchTensor) {
+        batchTensor = batchBindings->allocate(it->second);
+      }
+      size_t size = pair.second->getSizeInBytes();
+      std::memcpy(batchTensor->getUnsafePtr() + index * size,
+                  pair.second->getUnsafePtr(), size);
+    }
+    priority = std::min(priority, request.priority);
+    batch->push_back(std::move(request));
+  }
+  if (batch->empty()) {
+    return;
+  }
+
+  // Pad the slices of the missing requests with zeros.
+  for (const auto &pair : batchBindings->pairs()) {
+    size_t size = pair.second->getSizeInBytes() / config.maxBatchSize;
+    std::memset(pair.second->getUnsafePtr() + batch->size() * size, 0,
+                (config.maxBatchSize - batch->size()) * size);
+  }
+
+  runNetwork(
+      config.batchedNetworkName, std::move(batchContext),
+      [batch, network, placeholders = &batching->placeholders,
+       batchedModule = batching->batchedModule](
+          RunIdentifierTy, Error err,
+          std::unique_ptr<ExecutionContext> batchContext) {
+        std::string errMsg;
+        if (err) {
+          errMsg = ERR_TO_STRING(std::move(err));
+        }
+        auto *batchBindings = batchContext->getPlaceholderBindings();
+        for (size_t index = 0; index < batch->size(); index++) {
+          auto &request = (*batch)[index];
+          if (errMsg.empty()) {
+            // Copy the slice of the request back into its tensors.
+            auto *bindings = request.context->getPlaceholderBindings();
+            for (const auto &pair : bindings->pairs()) {
+              auto it = placeholders->find(pair.first->getName());
+              if (it == placeholders->end()) {
+                continue;
+              }
+              size_t size = pair.second->getSizeInBytes();
+              std::memcpy(pair.second->getUnsafePtr(),
+                          batchBindings->get(it->second)->getUnsafePtr() +
+                              index * size,
+                          size);
+            }
+          }
+          network->refcount--;
+          request.callback(request.requestID,
+                           errMsg.empty()
+                               ? Error::success()
+                               : MAKE_ERR(ErrorValue::ErrorCode::RUNTIME_ERROR,
+                                          errMsg),
+                           std::move(request.context));
+        }
+      },
+      priority);
 }
 
 Error HostManager::clearHost() {
+  // Let the networks being added or swapped in the background settle first.
+  {
+    std::unique_lock<std::mutex> asyncLoadsLock(asyncLoadsLock_);
+    asyncLoadsDone_.wait(asyncLoadsLock, [this]() { return asyncLoads_ == 0; });
+  }
+
+  // Dispatch the requests waiting to be batched before the executor stops.
+  std::vector<std::unique_ptr<BatchingData>> batching;
+  {
+    std::lock_guard<std::mutex> networkLock(networkLock_);
+    for (auto &it : batching_) {
+      networks_[it.first]->batching = nullptr;
+      batching.push_back(std::move(it.second));
+    }
+    batching_.clear();
+  }
+  batching.clear();
+
   // shutdown the executor, blocking on any current inflight and prevent new
   // requests from being serviced.
   executor_->shutdown();
+  stopCompletions();
 
   DCHECK_EQ(activeRequestCount_, 0)
       << "All requests should be finished when shutting down HostManager.";
@@ -316,6 +1571,7 @@ Error HostManager::clearHost() {
   Stats()->setCounter(kDeviceMemoryUsed, 0);
   Stats()->setCounter(kDeviceMemoryAvailable, 0);
   Stats()->setCounter(kDeviceMemoryMax, 0);
+  Stats()->setCounter(kDeviceLargestFreeBlock, 0);
 
   return errContainer.get();
 }
@@ -363,96 +1619,573 @@ Error HostManager::runNetworkBlocking(
   return std::move(*DCHECK_NOTNULL(runErr.get()));
 }
 
-void HostManager::dispatchNextRun() {
+PreparedRequest::PreparedRequest(llvm::StringRef networkName,
+                                 std::shared_ptr<Module> module)
+    : networkName_(networkName), module_(std::move(module)),
+      context_(llvm::make_unique<ExecutionContext>()) {
+  auto *bindings = context_->getPlaceholderBindings();
+  for (auto *PH : module_->getPlaceholders()) {
+    placeholders_.push_back(PH);
+    tensors_.push_back(bindings->allocate(PH));
+    tensors_.back()->zero();
+  }
+}
 
-  std::lock_guard<std::mutex> networkLock(networkLock_);
-  if (inferQueue_.size()) {
-    // Get the next request, unfortunately priority_queue only
-    // provides a const ref to the top element, since we need to move
-    // it we first cast it to remove the const.
-    auto request = std::move(const_cast<InferRequest &>(inferQueue_.top()));
-    inferQueue_.pop();
-    executor_->run(
-        networks_[request.networkName].dag.root.get(),
-        std::move(request.context), request.requestID,
-        [this, callback = request.callback, name = request.networkName](
-            RunIdentifierTy runID, Error err,
-            std::unique_ptr<ExecutionContext> context) {
-          {
-            std::lock_guard<std::mutex> networkLock(networkLock_);
-            auto it = networks_.find(name);
-            if (it != networks_.end()) {
-              it->second.refcount--;
+Expected<size_t> PreparedRequest::getSlot(llvm::StringRef name) const {
+  for (size_t slot = 0, e = placeholders_.size(); slot < e; slot++) {
+    if (placeholders_[slot]->getName() == name) {
+      return slot;
+    }
+  }
+  return MAKE_ERR(ErrorValue::ErrorCode::RUNTIME_ERROR,
+                  llvm::formatv("Network {0} has no placeholder {1}",
+                                networkName_, name)
+                      .str());
+}
+
+std::unique_ptr<ExecutionContext> PreparedRequest::takeContext() {
+  DCHECK(context_) << "The request is already running";
+  context_->setTraceContext(nullptr);
+  context_->setStatsSampled(false);
+  return std::move(context_);
+}
+
+void PreparedRequest::returnContext(std::unique_ptr<ExecutionContext> context) {
+  DCHECK(!context_) << "The request isn't running";
+  DCHECK(context && (tensors_.empty() ||
+                     context->getPlaceholderBindings()->get(
+                         placeholders_[0]) == tensors_[0]))
+      << "Not the context of the request";
+  context_ = std::move(context);
+}
+
+Expected<HostMemoryAllocator *>
+HostManager::getHostMemoryAllocator(DeviceIDTy deviceID) {
+  auto it = devices_.find(deviceID);
+  RETURN_ERR_IF_NOT(it != devices_.end(),
+                    llvm::formatv("There is no device {0}", deviceID).str(),
+                    ErrorValue::ErrorCode::RUNTIME_DEVICE_NOT_FOUND);
+  return &it->second->getHostMemoryAllocator();
+}
+
+std::map<DeviceIDTy, DeviceMemoryUsage>
+HostManager::getDeviceMemoryUsage() const {
+  std::map<DeviceIDTy, DeviceMemoryUsage> usage;
+  for (const auto &dev : devices_) {
+    usage.emplace(dev.first, dev.second->getMemoryUsage());
+  }
+  return usage;
+}
+
+Expected<std::shared_ptr<Module>>
+HostManager::getNetworkModule(llvm::StringRef networkName) {
+  auto networks = std::atomic_load(&publishedNetworks_);
+  auto it = networks->find(networkName);
+  RETURN_ERR_IF_NOT(
+      it != networks->end(),
+      llvm::formatv("Function {0} not found", networkName).str(),
+      ErrorValue::ErrorCode::RUNTIME_NET_NOT_FOUND);
+  return it->second->module;
+}
+
+Expected<std::unique_ptr<PreparedRequest>>
+HostManager::prepareRequest(llvm::StringRef networkName) {
+  std::shared_ptr<Module> module;
+  ASSIGN_VALUE_OR_RETURN_ERR(module, getNetworkModule(networkName));
+  return llvm::make_unique<PreparedRequest>(networkName, std::move(module));
+}
+
+Error HostManager::runNetworkBlocking(PreparedRequest &request) {
+  std::promise<void> runPromise;
+  auto fut = runPromise.get_future();
+  std::unique_ptr<Error> runErr;
+  runNetwork(
+      request.getNetworkName(), request.takeContext(),
+      [&runPromise, &runErr, &request](
+          runtime::RunIdentifierTy, Error err,
+          std::unique_ptr<ExecutionContext> contextPtr) {
+        request.returnContext(std::move(contextPtr));
+        runErr = llvm::make_unique<Error>(std::move(err));
+        runPromise.set_value();
+      });
+
+  fut.wait();
+  return std::move(*DCHECK_NOTNULL(runErr.get()));
+}
+
+bool HostManager::claimActiveRequest() {
+  size_t activeRequestCount = activeRequestCount_.load();
+  do {
+    if (activeRequestCount >= activeRequestLimit_) {
+      concurrencyLimited_ = true;
+      return false;
+    }
+  } while (!activeRequestCount_.compare_exchange_weak(activeRequestCount,
+                                                      activeRequestCount + 1));
+  return true;
+}
+
+bool HostManager::releaseExcessRequest() {
+  size_t activeRequestCount = activeRequestCount_.load();
+  do {
+    // This never releases the last slots, so that the requests that are
+    // queued are still dispatched by the runs that hold them.
+    if (activeRequestCount <= activeRequestLimit_) {
+      return false;
+    }
+  } while (!activeRequestCount_.compare_exchange_weak(activeRequestCount,
+                                                      activeRequestCount - 1));
+  return true;
+}
+
+void HostManager::recordConcurrencySample(std::chrono::microseconds latency) {
+  const auto &adaptive = config_.adaptiveConcurrency;
+  std::lock_guard<std::mutex> lock(concurrencyLock_);
+  concurrencyWindowLatency_ += latency;
+  size_t limit = activeRequestLimit_;
+  if (++concurrencyWindowRuns_ < limit) {
+    return;
+  }
+  auto average = concurrencyWindowLatency_ / concurrencyWindowRuns_;
+  size_t minLimit = std::max<size_t>(
+      1, std::min(adaptive.minActiveRequests, config_.maxActiveRequests));
+  if (average > adaptive.latencyTarget) {
+    limit = std::max(minLimit, size_t(limit * adaptive.backoff));
+  } else if (concurrencyLimited_) {
+    // Only grow while the limit holds requests back, so that it doesn't
+    // drift up while the load is light.
+    limit = std::min(config_.maxActiveRequests, limit + 1);
+  }
+  activeRequestLimit_ = limit;
+  concurrencyWindowRuns_ = 0;
+  concurrencyWindowLatency_ = std::chrono::microseconds(0);
+  concurrencyLimited_ = false;
+  Stats()->setCounter(kActiveRequestLimit, limit);
+}
+
+bool HostManager::NetworkData::canFinishBy(
+    std::chrono::steady_clock::time_point deadline) const {
+  if (deadline == std::chrono::steady_clock::time_point::max()) {
+    return true;
+  }
+  std::chrono::microseconds runTime(estimatedRunTimeUs.load());
+  return std::chrono::steady_clock::now() + runTime <= deadline;
+}
+
+void HostManager::NetworkData::recordRunTime(
+    std::chrono::microseconds runTime) {
+  // An exponential moving average with a weight of 1/8 for the new sample.
+  // Concurrent updates may lose a sample, which doesn't matter for an
+  // estimate.
+  uint64_t sample = runTime.count();
+  uint64_t estimate = estimatedRunTimeUs.load();
+  estimatedRunTimeUs =
+      estimate == 0 ? sample : estimate - estimate / 8 + sample / 8;
+}
+
+/// \returns whether the deadline of \p lhs is later than that of \p rhs, or
+/// \p lhs was submitted later at equal deadlines. It orders a heap for the
+/// earliest deadline first.
+template <typename RequestTy>
+static bool hasLaterDeadline(const RequestTy &lhs, const RequestTy &rhs) {
+  if (lhs.deadline != rhs.deadline) {
+    return lhs.deadline > rhs.deadline;
+  }
+  return lhs.requestID > rhs.requestID;
+}
+
+/// \returns whether \p lhs is to be dispatched after \p rhs among the
+/// requests of a tenant: the earliest deadline first, then the lowest
+/// priority value, then the oldest request. It orders a heap.
+template <typename RequestTy>
+static bool isDispatchedAfter(const RequestTy &lhs, const RequestTy &rhs) {
+  if (lhs.deadline != rhs.deadline) {
+    return lhs.deadline > rhs.deadline;
+  }
+  if (lhs.priority != rhs.priority) {
+    return lhs.priority > rhs.priority;
+  }
+  return lhs.requestID > rhs.requestID;
+}
+
+bool HostManager::queueRequest(InferRequest &&request) {
+  if (TenantData *tenant = request.tenant) {
+    std::lock_guard<std::mutex> tenantsLock(tenantsLock_);
+    size_t maxQueueSize = tenant->config.maxQueueSize
+                              ? tenant->config.maxQueueSize
+                              : config_.maxQueueSize;
+    if (tenant->queue.size() >= maxQueueSize) {
+      return false;
+    }
+    tenant->queue.push_back(std::move(request));
+    std::push_heap(tenant->queue.begin(), tenant->queue.end(),
+                   isDispatchedAfter<InferRequest>);
+    tenantQueueSize_++;
+    Stats()->setCounter(tenant->queueDepthKey, tenant->queue.size());
+    return true;
+  }
+  if (request.deadline == std::chrono::steady_clock::time_point::max()) {
+    uint64_t priority = request.priority;
+    return inferQueue_.push(std::move(request), priority);
+  }
+  std::lock_guard<std::mutex> deadlineQueueLock(deadlineQueueLock_);
+  if (deadlineQueue_.size() >= config_.maxQueueSize) {
+    return false;
+  }
+  deadlineQueue_.push_back(std::move(request));
+  std::push_heap(deadlineQueue_.begin(), deadlineQueue_.end(),
+                 hasLaterDeadline<InferRequest>);
+  deadlineQueueSize_++;
+  return true;
+}
+
+llvm::Optional<HostManager::InferRequest> HostManager::popRequest() {
+  if (deadlineQueueSize_ != 0) {
+    std::lock_guard<std::mutex> deadlineQueueLock(deadlineQueueLock_);
+    if (!deadlineQueue_.empty()) {
+      std::pop_heap(deadlineQueue_.begin(), deadlineQueue_.end(),
+                    hasLaterDeadline<InferRequest>);
+      llvm::Optional<InferRequest> request(std::move(deadlineQueue_.back()));
+      deadlineQueue_.pop_back();
+      deadlineQueueSize_--;
+      return request;
+    }
+  }
+  if (tenantQueueSize_ != 0) {
+    return popFairRequest();
+  }
+  return inferQueue_.pop();
+}
+
+llvm::Optional<HostManager::InferRequest> HostManager::popFairRequest() {
+  std::lock_guard<std::mutex> tenantsLock(tenantsLock_);
+  // Idle tenants resume from the virtual time.
+  TenantData *next = nullptr;
+  for (auto &it : tenants_) {
+    TenantData *tenant = it.second.get();
+    if (tenant->queue.empty() || tenant->atQuota()) {
+      continue;
+    }
+    tenant->pass = std::max(tenant->pass, virtualTime_);
+    if (!next || tenant->pass < next->pass) {
+      next = tenant;
+    }
+  }
+  if (!inferQueue_.empty()) {
+    defaultPass_ = std::max(defaultPass_, virtualTime_);
+    if (!next || defaultPass_ <= next->pass) {
+      auto request = inferQueue_.pop();
+      if (request) {
+        virtualTime_ = defaultPass_;
+        defaultPass_ += kFairStride;
+        return request;
+      }
+    }
+  }
+  if (!next) {
+    return llvm::None;
+  }
+
+  std::pop_heap(next->queue.begin(), next->queue.end(),
+                isDispatchedAfter<InferRequest>);
+  llvm::Optional<InferRequest> request(std::move(next->queue.back()));
+  next->queue.pop_back();
+  tenantQueueSize_--;
+  next->active++;
+  virtualTime_ = next->pass;
+  next->pass += kFairStride / std::max(1u, next->config.weight);
+  Stats()->setCounter(next->queueDepthKey, next->queue.size());
+  Stats()->setCounter(next->activeKey, next->active);
+  return request;
+}
+
+bool HostManager::hasRunnableTenantRequest() {
+  if (tenantQueueSize_ == 0) {
+    return false;
+  }
+  std::lock_guard<std::mutex> tenantsLock(tenantsLock_);
+  for (auto &it : tenants_) {
+    if (!it.second->queue.empty() && !it.second->atQuota()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void HostManager::releaseTenant(TenantData *tenant) {
+  if (tenant) {
+    std::lock_guard<std::mutex> tenantsLock(tenantsLock_);
+    DCHECK_GT(tenant->active, 0) << "No request of the tenant is running";
+    tenant->active--;
+    Stats()->setCounter(tenant->activeKey, tenant->active);
+  }
+}
+
+void HostManager::failDeadline(InferRequest &request) {
+  request.network->refcount--;
+  Stats()->incrementCounter(kDeadlineExceededRequests);
+  request.callback(
+      request.requestID,
+      MAKE_ERR(ErrorValue::ErrorCode::RUNTIME_DEADLINE_EXCEEDED,
+               llvm::formatv("The request for {0} cannot finish by its "
+                             "deadline",
+                             request.networkName)
+                   .str()),
+      std::move(request.context));
+}
+
+void HostManager::failCancelled(InferRequest &request) {
+  request.network->refcount--;
+  Stats()->incrementCounter(kCancelledRequests);
+  request.callback(
+      request.requestID,
+      MAKE_ERR(ErrorValue::ErrorCode::RUNTIME_REQUEST_CANCELLED,
+               llvm::formatv("The request for {0} was cancelled",
+                             request.networkName)
+                   .str()),
+      std::move(request.context));
+}
+
+void HostManager::dispatchNextRun() {
+  while (true) {
+    if (releaseExcessRequest()) {
+      return;
+    }
+    auto request = popRequest();
+    if (request) {
+      NetworkData *network = request->network;
+      // Drop the requests that their clients gave up on.
+      if (request->context->isCancelled()) {
+        releaseTenant(request->tenant);
+        failCancelled(*request);
+        continue;
+      }
+      // Rather than running a request late, fail it and run the next one.
+      if (!network->canFinishBy(request->deadline)) {
+        releaseTenant(request->tenant);
+        failDeadline(*request);
+        continue;
+      }
+      auto startTime = std::chrono::steady_clock::now();
+      if (request->context->isStatsSampled()) {
+        Stats()->addLatencyValue("queue_wait", request->networkName,
+                                 request->queueTime);
+      }
+      executor_->run(
+          network->dag.root.get(), std::move(request->context),
+          request->requestID,
+          [this, network, startTime, tenant = request->tenant,
+           callback = std::move(request->callback),
+           name = std::move(request->networkName)](
+              RunIdentifierTy runID, Error err,
+              std::unique_ptr<ExecutionContext> context) mutable {
+            if (!err) {
+              auto runTime =
+                  std::chrono::duration_cast<std::chrono::microseconds>(
+                      std::chrono::steady_clock::now() - startTime);
+              network->recordRunTime(runTime);
+              if (config_.adaptiveConcurrency.latencyTarget.count()) {
+                recordConcurrencySample(runTime);
+              }
             }
-          }
-          TRACE_EVENT_INSTANT(context->getTraceContext(), TraceLevel::RUNTIME,
-                              "finish_" + name);
-          callback(runID, std::move(err), std::move(context));
-          dispatchNextRun();
-        });
-  } else {
+            releaseTenant(tenant);
+            network->refcount--;
+            TRACE_EVENT_INSTANT(context->getTraceContext(),
+                                TraceLevel::RUNTIME, "finish_" + name);
+            if (context->isStatsSampled()) {
+              Stats()->addLatencyValue("execution", name, startTime);
+            }
+            complete(Completion{std::move(callback), runID, std::move(err),
+                                std::move(context), std::move(name)});
+            dispatchNextRun();
+          });
+      return;
+    }
+
     // Decrement the activeRequest counter so new requests can
-    // launched.
+    // launched. A runNetwork that found no free slot may have queued a
+    // request after the pop, so claim the slot back for it.
     --activeRequestCount_;
+    if ((inferQueue_.empty() && deadlineQueueSize_ == 0 &&
+         !hasRunnableTenantRequest()) ||
+        !claimActiveRequest()) {
+      return;
+    }
   }
 }
 
 RunIdentifierTy
 HostManager::runNetwork(llvm::StringRef networkName,
                         std::unique_ptr<ExecutionContext> context,
-                        ResultCBTy callback, uint64_t priority) {
+                        ResultCBTy callback, uint64_t priority,
+                        std::chrono::steady_clock::time_point deadline) {
   DCHECK(callback != nullptr);
 
+  auto currentRun = totalRequestCount_++;
+  if (config_.traceSampleInterval && !context->getTraceContext() &&
+      currentRun % config_.traceSampleInterval == 0) {
+    context->setTraceContext(llvm::make_unique<TraceContext>(
+        TraceLevel::RUNTIME, getTraceRecorder()));
+  }
   TRACE_EVENT_SCOPE(context->getTraceContext(), TraceLevel::RUNTIME,
                     "HostManager::runNetwork");
-  auto currentRun = totalRequestCount_++;
+  if (config_.latencyStatsSampleInterval &&
+      currentRun % config_.latencyStatsSampleInterval == 0) {
+    context->setStatsSampled(true);
+  }
+  // The executor and the devices drop the run once the deadline of its
+  // context passed, the deadline given here only orders the queue.
+  deadline = std::min(deadline, context->getDeadline());
 
+  // Hold the network, so that it isn't removed until the run is done.
   NetworkData *network = nullptr;
   {
-    std::lock_guard<std::mutex> networkLock(networkLock_);
-    auto it = networks_.find(networkName);
-    if (it != networks_.end()) {
-      network = &it->second;
+    auto networks = std::atomic_load(&publishedNetworks_);
+    while (true) {
+      auto it = networks->find(networkName);
+      if (it == networks->end()) {
+        break;
+      }
+      // Run the variant of the batch size of the request if there is one.
+      if (auto variants = std::atomic_load(&it->second->batchVariants)) {
+        auto *bindings = context->getPlaceholderBindings();
+        auto *PH = bindings->getPlaceholderByName(variants->placeholderName);
+        Tensor *T = PH ? bindings->get(PH) : nullptr;
+        if (T && !T->dims().empty()) {
+          auto nameIt = variants->names.find(T->dims()[0]);
+          if (nameIt != variants->names.end()) {
+            auto variantIt = networks->find(nameIt->second);
+            if (variantIt != networks->end()) {
+              it = variantIt;
+            }
+          }
+        }
+      }
+      network = it->second.get();
       network->refcount++;
+      // Either this sees removing, or removeNetwork sees the refcount.
+      if (!network->removing) {
+        network->numRequests++;
+        break;
+      }
+      network->refcount--;
+      network = nullptr;
+      // swapNetwork retires the old version of a network after publishing
+      // the new one, look for it in the latest published networks.
+      auto latest = std::atomic_load(&publishedNetworks_);
+      if (latest == networks) {
+        break;
+      }
+      networks = std::move(latest);
     }
+  }
 
-    if (network == nullptr) {
-      callback(
-          currentRun,
-          MAKE_ERR(ErrorValue::ErrorCode::RUNTIME_NET_NOT_FOUND,
-                   llvm::formatv("Function {0} not found", networkName).str()),
-          std::move(context));
-      return currentRun;
+  if (network == nullptr) {
+    callback(
+        currentRun,
+        MAKE_ERR(ErrorValue::ErrorCode::RUNTIME_NET_NOT_FOUND,
+                 llvm::formatv("Function {0} not found", networkName).str()),
+        std::move(context));
+    return currentRun;
+  }
+
+  // Serve the request from the cached run with the same inputs, or cache its
+  // results once it ran.
+  if (auto cache = std::atomic_load(&network->resultCache)) {
+    auto &bindings = *context->getPlaceholderBindings();
+    uint64_t key;
+    if (cache->getKey(bindings, key)) {
+      if (cache->lookup(key, bindings)) {
+        network->refcount--;
+        callback(currentRun, Error::success(), std::move(context));
+        return currentRun;
+      }
+      callback = [cache, key, callback = std::move(callback)](
+                     RunIdentifierTy runId, Error err,
+                     std::unique_ptr<ExecutionContext> context) {
+        if (!err) {
+          cache->insert(key, *context->getPlaceholderBindings());
+        }
+        callback(runId, std::move(err), std::move(context));
+      };
     }
-    // Setup the request
-    InferRequest queuedRequest(networkName, std::move(context), callback,
-                               priority, currentRun);
-    // Put the request in the queue.
-    auto queueSize = inferQueue_.size();
-    if (queueSize >= config_.maxQueueSize) {
-      // The queue is full, return an error.
+  }
+
+  // Leave the request to the batching thread if its network is batched.
+  if (BatchingData *batching = network->batching) {
+    std::lock_guard<std::mutex> batchingLock(batching->lock);
+    auto pendingSize = batching->pending.size();
+    if (pendingSize >= config_.maxQueueSize) {
       network->refcount--;
-      callback(
-          currentRun,
-          MAKE_ERR(
-              ErrorValue::ErrorCode::RUNTIME_REQUEST_REFUSED,
-              strFormat(
-                  "The number of allowed queued requests has been exceeded. "
-                  "queued requests: %lu allowed requests: %zu",
-                  queueSize, config_.maxQueueSize)),
-          std::move(context));
+      callback(currentRun,
+               MAKE_ERR(ErrorValue::ErrorCode::RUNTIME_REQUEST_REFUSED,
+                        strFormat("The number of allowed requests waiting "
+                                  "to be batched has been exceeded. "
+                                  "queued requests: %zu allowed requests: "
+                                  "%zu",
+                                  pendingSize, config_.maxQueueSize)),
+               std::move(context));
       return currentRun;
     }
-    inferQueue_.push(std::move(queuedRequest));
+    InferRequest pendingRequest(networkName, std::move(context), callback,
+                                priority, currentRun);
+    pendingRequest.deadline = deadline;
+    batching->pending.emplace_back(std::move(pendingRequest),
+                                   std::chrono::steady_clock::now());
+    if (pendingSize == 0 || pendingSize + 1 >= batching->config.maxBatchSize) {
+      batching->cv.notify_one();
+    }
+    return currentRun;
+  }
+
+  // Reload the network if it was evicted, this run then waits for it.
+  if (config_.evictLRUNetworks) {
+    network->lastUse = ++useClock_;
+    if (!network->resident) {
+      std::lock_guard<std::mutex> residencyLock(residencyLock_);
+      if (!network->resident) {
+        if (auto err = reloadNetwork(*network)) {
+          network->refcount--;
+          callback(currentRun, std::move(err), std::move(context));
+          return currentRun;
+        }
+      }
+    }
+  }
+
+  // Setup the request
+  InferRequest queuedRequest(networkName, std::move(context), callback,
+                             priority, currentRun);
+  queuedRequest.network = network;
+  queuedRequest.tenant = network->tenant;
+  queuedRequest.deadline = deadline;
+  if (queuedRequest.context->isStatsSampled()) {
+    queuedRequest.queueTime = std::chrono::steady_clock::now();
+  }
+  // Don't queue a request that would finish late even if it ran now.
+  if (!network->canFinishBy(deadline)) {
+    failDeadline(queuedRequest);
+    return currentRun;
+  }
+  // Put the request in the queue.
+  if (!queueRequest(std::move(queuedRequest))) {
+    // The queue is full, return an error.
+    network->refcount--;
+    callback(currentRun,
+             MAKE_ERR(ErrorValue::ErrorCode::RUNTIME_REQUEST_REFUSED,
+                      strFormat("The number of allowed queued requests has "
+                                "been exceeded. queued requests: %zu allowed "
+                                "requests: %zu",
+                                inferQueue_.size() + deadlineQueueSize_,
+                                config_.maxQueueSize)),
+             std::move(queuedRequest.context));
+    return currentRun;
   }
 
   // If we haven't reached maxActiveRequests kick off next request.
-  size_t activeRequestCount = activeRequestCount_++;
-  if (activeRequestCount < config_.maxActiveRequests) {
+  if (claimActiveRequest()) {
     dispatchNextRun();
-    return currentRun;
   }
-  activeRequestCount_--;
   return currentRun;
 }
 
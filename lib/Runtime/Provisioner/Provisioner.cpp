@@ -17,9 +17,12 @@
 #include "glow/Runtime/Provisioner/Provisioner.h"
 #include "glow/Backend/BackendUtils.h"
 #include "glow/Backend/CompiledFunction.h"
+#include "glow/ExecutionContext/TraceEvents.h"
 #include "glow/Graph/Graph.h"
+#include "glow/Runtime/StatsExporter.h"
 #include "glow/Support/Debug.h"
 
+#include "llvm/ADT/StringSet.h"
 #include "llvm/Support/FormatVariadic.h"
 
 #include <future>
@@ -47,7 +50,11 @@ auto sortMostMemory = [](const std::pair<DeviceIDTy, uint64_t> &a,
 };
 } // namespace
 
-Provisioner::Provisioner(DeviceManagerMapTy &devices) {
+Provisioner::Provisioner(DeviceManagerMapTy &devices,
+                         unsigned compileThreads) {
+  if (compileThreads > 1) {
+    compilePool_ = llvm::make_unique<ThreadPool>(compileThreads);
+  }
   llvm::SmallSet<std::string, 10> used;
   for (auto &device : devices) {
     devices_.push_back(device.second.get());
@@ -61,6 +68,7 @@ Provisioner::Provisioner(DeviceManagerMapTy &devices) {
 
 Error Provisioner::provision(DAGListTy &networks, Module &module,
                              CompilationContext &cctx) {
+  TRACE_EVENT_SCOPE(cctx.traceContext, TraceLevel::COMPILE, "provision");
   // Walk the networks and group by logicalDeviceId.
   std::map<DeviceIDTy, std::vector<DAGNode *>> logicalDevices;
   // List of functions being added.
@@ -111,44 +119,92 @@ Error Provisioner::provision(DAGListTy &networks, Module &module,
   // copy operation.
   cctx.backendOpts.collectConstants = false;
 
+  // Collect the functions to compile. A function assigned to several logical
+  // devices is only compiled once.
+  std::vector<DAGNode *> compileNodes;
+  {
+    llvm::StringSet<> compileNames;
+    for (auto &device : logicalDevices) {
+      for (auto &node : device.second) {
+        if (compileNames.insert(node->name).second) {
+          compileNodes.push_back(node);
+        }
+      }
+    }
+  }
+  std::vector<std::unique_ptr<CompiledFunction>> compiled(compileNodes.size());
+  // Compile the function of compileNodes[i] into compiled[i]. Every call
+  // touches its own node and result only, so that calls can run in parallel.
+  auto compileNode = [&](size_t i) -> Error {
+    DAGNode *node = compileNodes[i];
+    // Copy BackendOptions and add the compiler hints for this function.
+    auto options = cctx.backendOpts;
+    options.backendHints = node->backendHints;
+
+    Function *function = module.getFunction(node->name);
+    for (size_t j = 0, e = backends_.size(); j < e; j++) {
+      if (backends_[j]->getBackendName() == node->backendName) {
+        auto start = std::chrono::steady_clock::now();
+        TRACE_EVENT_SCOPE_NAMED(cctx.traceContext, TraceLevel::COMPILE,
+                                "compile", compileEvent);
+        compileEvent.addArg("function", node->name);
+        auto compiledOrErr = backends_[j]->compile(function, options);
+        TRACE_EVENT_SCOPE_END_NAMED(compileEvent);
+        Stats()->addLatencyValue("compile", node->name, start);
+        // Check to see if an error was encountered while compiling.
+        if (!compiledOrErr) {
+          return compiledOrErr.takeError();
+        }
+        compiled[i] = std::move(*compiledOrErr);
+        node->runtimeBundle =
+            llvm::make_unique<RuntimeBundle>(compiled[i]->getRuntimeBundle());
+        break;
+      }
+    }
+    return Error::success();
+  };
+  if (compilePool_ && compileNodes.size() > 1) {
+    // Compile all the functions at once, so that provisioning takes about as
+    // long as compiling the largest function.
+    OneErrOnly compileErr;
+    std::vector<std::future<void>> compileDone;
+    for (size_t i = 0, e = compileNodes.size(); i < e; i++) {
+      compileDone.push_back(compilePool_->submit(
+          [&, i]() { compileErr.set(compileNode(i)); }));
+    }
+    for (auto &done : compileDone) {
+      done.wait();
+    }
+    if (auto err = compileErr.get()) {
+      // If an error occurred, clean up provisioning state and return the
+      // error.
+      cleanupProvision(localActiveNames);
+      return err;
+    }
+  } else {
+    for (size_t i = 0, e = compileNodes.size(); i < e; i++) {
+      if (auto err = compileNode(i)) {
+        cleanupProvision(localActiveNames);
+        return err;
+      }
+    }
+  }
+
+  // Set of functions compiled during this provisioning.
+  std::map<std::string, std::unique_ptr<CompiledFunction>> compiledFunctions;
+  for (size_t i = 0, e = compileNodes.size(); i < e; i++) {
+    compiledFunctions.emplace(compileNodes[i]->name, std::move(compiled[i]));
+  }
+
   std::vector<std::pair<DeviceIDTy, uint64_t>> logicalDeviceSize;
   std::map<DeviceIDTy, std::string> logicalDeviceBackendName;
   std::map<DeviceIDTy, FunctionMapTy> functionMaps;
-  // Set of functions already compiled during this provisioning.
-  std::map<std::string, std::unique_ptr<CompiledFunction>> compiledFunctions;
-  // Compile functions and calculate required memory for each logical device.
+  // Calculate required memory for each logical device.
   for (auto &device : logicalDevices) {
     uint64_t totalMemory = 0;
     auto nodeBackendName = (device.second[0])->backendName;
     FunctionMapTy functionMap;
     for (auto &node : device.second) {
-      // Only compile if we haven't compiled before. If we have previously
-      // compiled the function reuse it.
-      if (compiledFunctions.find(node->name) == compiledFunctions.end()) {
-        // Copy BackendOptions and add the compiler hints for this function.
-        auto options = cctx.backendOpts;
-        options.backendHints = node->backendHints;
-
-        Function *function = module.getFunction(node->name);
-        for (size_t i = 0, e = backends_.size(); i < e; i++) {
-          if (backends_[i]->getBackendName() == nodeBackendName) {
-            auto compiledOrErr = backends_[i]->compile(function, options);
-            // Check to see if an error was encountered while compiling.
-            if (!compiledOrErr) {
-              // If and error occured, clean up provisioning state and return
-              // the error.
-              cleanupProvision(localActiveNames);
-              return compiledOrErr.takeError();
-            }
-            auto compiled = std::move(*compiledOrErr);
-            node->runtimeBundle =
-                llvm::make_unique<RuntimeBundle>(compiled->getRuntimeBundle());
-
-            compiledFunctions.emplace(node->name, std::move(compiled));
-            break;
-          }
-        }
-      }
       functionMap.emplace(node->name, compiledFunctions[node->name].get());
       totalMemory += node->runtimeBundle->getConstantWeightSize();
     }
@@ -174,8 +230,53 @@ Error Provisioner::provision(DAGListTy &networks, Module &module,
   }
   // Sort by available memory in descending order.
   std::sort(deviceMemory.begin(), deviceMemory.end(), sortMostMemory);
+  // Keep the partitions of the network on one NUMA node when the devices are
+  // on several ones, so that the requests don't cross the interconnect
+  // between the partitions: group the devices by node, the node with the most
+  // available memory first, as logical devices are assigned in order.
+  std::map<int, uint64_t> nodeMemory;
+  for (const auto &device : deviceMemory) {
+    nodeMemory[devices_[device.first]->getDeviceConfig().getNumaNode()] +=
+        device.second;
+  }
+  if (nodeMemory.size() > 1) {
+    std::stable_sort(
+        deviceMemory.begin(), deviceMemory.end(),
+        [&](const std::pair<DeviceIDTy, uint64_t> &a,
+            const std::pair<DeviceIDTy, uint64_t> &b) {
+          int nodeA = devices_[a.first]->getDeviceConfig().getNumaNode();
+          int nodeB = devices_[b.first]->getDeviceConfig().getNumaNode();
+          if (nodeA == nodeB) {
+            return false;
+          }
+          uint64_t memoryA = nodeMemory[nodeA];
+          uint64_t memoryB = nodeMemory[nodeB];
+          return memoryA != memoryB ? memoryA > memoryB : nodeA < nodeB;
+        });
+  }
 
-  // Try to add functions to devices in order from largest to smallest.
+  // Evict the functions that were added to devices before a failure, so that
+  // provisioning the network again, e.g. once memory was freed, starts over.
+  auto evictAdded = [&]() {
+    for (auto &device : logicalDevices) {
+      for (auto *node : device.second) {
+        for (auto deviceID : node->deviceIDs) {
+          std::promise<void> evictPromise;
+          auto evicted = evictPromise.get_future();
+          devices_[deviceID]->evictNetwork(
+              node->name, [&evictPromise](std::string, Error err) {
+                ERR_TO_VOID(std::move(err));
+                evictPromise.set_value();
+              });
+          evicted.wait();
+        }
+        node->deviceIDs.clear();
+      }
+    }
+  };
+
+  // Assign the logical devices to devices in order from largest to smallest.
+  std::vector<std::pair<DeviceIDTy, DeviceIDTy>> assignments;
   std::map<std::string, size_t> startPos;
   for (unsigned i = 0; i < logicalDeviceSize.size(); i++) {
     std::string backendName =
@@ -189,6 +290,7 @@ Error Provisioner::provision(DAGListTy &networks, Module &module,
       if (devices_[deviceID]->getBackendName() == backendName) {
         startPos[backendName] = j + 1;
         if (logicalDeviceSize[i].second > deviceMemory[j].second) {
+          // Nothing was added to the devices yet.
           cleanupProvision(localActiveNames);
           return MAKE_ERR(
               ErrorValue::ErrorCode::RUNTIME_OUT_OF_DEVICE_MEMORY,
@@ -197,35 +299,88 @@ Error Provisioner::provision(DAGListTy &networks, Module &module,
                             logicalDeviceSize[i].second, deviceMemory[j].second)
                   .str());
         }
-        // Load functions on device.
-        DeviceIDTy logicalID = logicalDeviceSize[i].first;
-        std::promise<void> addPromise;
-        auto ready = addPromise.get_future();
-        std::unique_ptr<Error> addErr;
-        devices_[deviceID]->addNetwork(
-            &module, functionMaps[logicalID],
-            [&addErr, &addPromise](const Module *, Error err) {
-              addErr = llvm::make_unique<Error>(std::move(err));
-              addPromise.set_value();
-            });
-        ready.wait();
-        DCHECK_NOTNULL(addErr.get());
-        if (*addErr.get()) {
-          cleanupProvision(localActiveNames);
-          return std::move(*addErr.get());
-        }
-        // Set deviceID for each node added
-        for (auto &node : logicalDevices[logicalID]) {
-          node->deviceIDs.push_back(deviceID);
-        }
+        assignments.emplace_back(logicalDeviceSize[i].first, deviceID);
         break;
       }
     }
   }
+
+  // A function added to several devices is compiled once, and the device
+  // managers copy its constants from the host when they don't have them
+  // yet. Stage them on the host before the devices are loaded, so that the
+  // replicas share one copy and the devices don't race to collect it.
+  std::map<std::string, unsigned> numReplicas;
+  for (const auto &assignment : assignments) {
+    for (auto *node : logicalDevices[assignment.first]) {
+      numReplicas[node->name]++;
+    }
+  }
+  for (const auto &assignment : assignments) {
+    for (const auto &func : functionMaps[assignment.first]) {
+      if (numReplicas[func.first] > 1 &&
+          func.second->getRuntimeBundle().getConstants() == nullptr) {
+        func.second->collectConstants(&module);
+      }
+    }
+  }
+
+  // Load the functions on all the devices at once, as the devices copy
+  // their constants at the same time, then wait for all of them.
+  OneErrOnly addErr;
+  std::vector<char> added(assignments.size(), false);
+  std::vector<std::promise<void>> addPromises(assignments.size());
+  std::vector<std::future<void>> addDone;
+  for (auto &addPromise : addPromises) {
+    addDone.push_back(addPromise.get_future());
+  }
+  for (size_t i = 0, e = assignments.size(); i < e; i++) {
+    DeviceIDTy logicalID = assignments[i].first;
+    DeviceIDTy deviceID = assignments[i].second;
+    devices_[deviceID]->addNetwork(
+        &module, functionMaps[logicalID],
+        [&addErr, &added, &addPromises, i](const Module *, Error err) {
+          added[i] = !err;
+          addErr.set(std::move(err));
+          addPromises[i].set_value();
+        });
+  }
+  for (auto &done : addDone) {
+    done.wait();
+  }
+  // Set deviceID for each node added
+  for (size_t i = 0, e = assignments.size(); i < e; i++) {
+    if (added[i]) {
+      for (auto &node : logicalDevices[assignments[i].first]) {
+        node->deviceIDs.push_back(assignments[i].second);
+      }
+    }
+  }
+  if (auto err = addErr.get()) {
+    evictAdded();
+    cleanupProvision(localActiveNames);
+    return err;
+  }
+  // The copies of the runtime bundles in the nodes are only looked up for
+  // the placeholders of the runs.
+  for (auto &network : networks) {
+    for (auto &node : network.nodes) {
+      if (node->runtimeBundle) {
+        node->runtimeBundle->eraseSymbols(SymbolCategory::Activation);
+        node->runtimeBundle->eraseSymbols(SymbolCategory::Constant);
+        node->runtimeBundle->eraseSymbols(SymbolCategory::ConstantTensorView);
+      }
+    }
+  }
   cleanupProvision(localActiveNames, false);
   return Error::success();
 };
 
+CompiledFunction *Provisioner::getFunction(llvm::StringRef name) {
+  std::lock_guard<std::mutex> functionsLock(functionsLock_);
+  auto it = functions_.find(name);
+  return it == functions_.end() ? nullptr : it->second.get();
+}
+
 Error Provisioner::removeFunction(llvm::StringRef name) {
   std::lock_guard<std::mutex> functionsLock(functionsLock_);
   auto it = activeFunctions_.find(name);
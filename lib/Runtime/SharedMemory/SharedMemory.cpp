@@ -0,0 +1,508 @@
+/**
+ * Copyright (c) Glow Contributors. See CONTRIBUTORS file.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "glow/Runtime/SharedMemory/SharedMemory.h"
+#include "glow/ExecutionContext/ExecutionContext.h"
+
+#include "llvm/Support/FormatVariadic.h"
+
+#include <cerrno>
+#include <cstring>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <semaphore.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace glow;
+using namespace glow::runtime;
+
+#ifdef __linux__
+
+namespace glow {
+namespace runtime {
+namespace shm {
+
+/// Identifies the segments of SharedMemoryServer, and their layout.
+constexpr uint32_t kMagic = 0x676c6f77;
+constexpr uint32_t kVersion = 1;
+
+/// The limits of the records of a slot.
+constexpr size_t kMaxNameLen = 64;
+constexpr size_t kMaxTensors = 32;
+constexpr size_t kMaxMessageLen = 256;
+
+/// The alignment of the slots and of the tensors.
+constexpr size_t kAlignment = 64;
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2,
+              "The atomics of the segment must be lock free to be shared");
+
+/// A cell of the ring of submitted slots.
+struct Cell {
+  std::atomic<uint64_t> sequence;
+  uint32_t slot;
+};
+
+/// The header of the segment, followed by the cells of the ring and by the
+/// slots. The ring is a bounded queue of Vyukov: a cell holds the slot
+/// pushed at position p once its sequence is p + 1. The ring has more cells
+/// than there are slots and a slot is only pushed once per run, so pushes
+/// never wait for the ring.
+struct SegmentHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t numSlots;
+  uint32_t ringMask;
+  uint64_t slotBytes;
+  uint64_t slotStride;
+  /// Counts the pushed slots, the server waits on it.
+  sem_t submitted;
+  std::atomic<uint64_t> pushPos;
+  std::atomic<uint64_t> popPos;
+};
+
+/// The tensor bound to a placeholder of the request of a slot.
+struct TensorDesc {
+  char name[kMaxNameLen];
+  uint64_t offset;
+  uint64_t size;
+};
+
+/// A request, followed by its tensors.
+struct Slot {
+  /// Whether a client holds the slot.
+  std::atomic<uint32_t> claimed;
+  /// Posted by the server once the run completes.
+  sem_t done;
+  char network[kMaxNameLen];
+  uint32_t numTensors;
+  TensorDesc tensors[kMaxTensors];
+  /// The bytes of the tensors which are bound.
+  uint64_t used;
+  /// Whether the run failed, and its error.
+  uint32_t failed;
+  uint32_t errorCode;
+  char errorMessage[kMaxMessageLen];
+};
+
+} // namespace shm
+} // namespace runtime
+} // namespace glow
+
+using namespace glow::runtime::shm;
+
+namespace {
+
+size_t alignTo(size_t size, size_t alignment) {
+  return (size + alignment - 1) / alignment * alignment;
+}
+
+/// \returns the offset of the first slot of a segment whose ring has
+/// \p numCells cells.
+size_t getSlotsOffset(size_t numCells) {
+  return alignTo(sizeof(SegmentHeader) + numCells * sizeof(Cell), kAlignment);
+}
+
+Cell *getCells(SegmentHeader *header) {
+  return reinterpret_cast<Cell *>(header + 1);
+}
+
+Slot *getSlot(SegmentHeader *header, unsigned index) {
+  char *base = reinterpret_cast<char *>(header);
+  return reinterpret_cast<Slot *>(base +
+                                  getSlotsOffset(header->ringMask + 1) +
+                                  index * header->slotStride);
+}
+
+char *getSlotData(Slot *slot) {
+  return reinterpret_cast<char *>(slot) + alignTo(sizeof(Slot), kAlignment);
+}
+
+/// Copies \p str into the record \p dest of \p size bytes. \returns false if
+/// it doesn't fit with its terminator.
+bool copyName(char *dest, llvm::StringRef str, size_t size) {
+  if (str.size() >= size) {
+    return false;
+  }
+  memcpy(dest, str.data(), str.size());
+  dest[str.size()] = '\0';
+  return true;
+}
+
+/// Pushes the slot \p index into the ring of \p header.
+void pushSlot(SegmentHeader *header, uint32_t index) {
+  uint64_t pos = header->pushPos.fetch_add(1, std::memory_order_relaxed);
+  Cell &cell = getCells(header)[pos & header->ringMask];
+  while (cell.sequence.load(std::memory_order_acquire) != pos) {
+    std::this_thread::yield();
+  }
+  cell.slot = index;
+  cell.sequence.store(pos + 1, std::memory_order_release);
+}
+
+/// Pops a slot from the ring of \p header, which only the server pops. The
+/// slot was counted by the semaphore, but its client may still be writing
+/// it into the cell.
+uint32_t popSlot(SegmentHeader *header) {
+  uint64_t pos = header->popPos.load(std::memory_order_relaxed);
+  Cell &cell = getCells(header)[pos & header->ringMask];
+  while (cell.sequence.load(std::memory_order_acquire) != pos + 1) {
+    std::this_thread::yield();
+  }
+  uint32_t index = cell.slot;
+  cell.sequence.store(pos + header->ringMask + 1, std::memory_order_release);
+  header->popPos.store(pos + 1, std::memory_order_relaxed);
+  return index;
+}
+
+/// Waits on \p sem, retrying when interrupted by a signal.
+void waitOn(sem_t *sem) {
+  while (sem_wait(sem) == -1 && errno == EINTR) {
+  }
+}
+
+} // namespace
+
+Error SharedMemoryServer::init(const SharedMemoryConfig &config) {
+  RETURN_ERR_IF_NOT(config.numSlots > 0 && config.slotBytes > 0,
+                    "The segment needs slots with bytes");
+  size_t numCells = 1;
+  while (numCells < config.numSlots) {
+    numCells *= 2;
+  }
+  size_t slotStride = alignTo(sizeof(Slot), kAlignment) +
+                      alignTo(config.slotBytes, kAlignment);
+  size_ = getSlotsOffset(numCells) + config.numSlots * slotStride;
+
+  int fd = shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+  RETURN_ERR_IF_NOT(fd != -1, llvm::formatv("Can't create the segment {0}: {1}",
+                                            name_, strerror(errno))
+                                  .str());
+  void *base = MAP_FAILED;
+  if (ftruncate(fd, size_) == 0) {
+    base = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+  int mapErrno = errno;
+  close(fd);
+  if (base == MAP_FAILED) {
+    shm_unlink(name_.c_str());
+    return MAKE_ERR(llvm::formatv("Can't map the segment {0}: {1}", name_,
+                                  strerror(mapErrno))
+                        .str());
+  }
+  base_ = static_cast<char *>(base);
+
+  // The segment is zeroed by ftruncate.
+  header_ = new (base_) SegmentHeader();
+  header_->numSlots = config.numSlots;
+  header_->ringMask = numCells - 1;
+  header_->slotBytes = config.slotBytes;
+  header_->slotStride = slotStride;
+  sem_init(&header_->submitted, /* pshared */ 1, 0);
+  Cell *cells = getCells(header_);
+  for (size_t i = 0; i < numCells; i++) {
+    new (&cells[i]) Cell();
+    cells[i].sequence.store(i, std::memory_order_relaxed);
+  }
+  for (unsigned i = 0; i < config.numSlots; i++) {
+    Slot *slot = new (getSlot(header_, i)) Slot();
+    sem_init(&slot->done, /* pshared */ 1, 0);
+  }
+  header_->version = kVersion;
+  std::atomic_thread_fence(std::memory_order_release);
+  header_->magic = kMagic;
+  return Error::success();
+}
+
+Expected<std::unique_ptr<SharedMemoryServer>>
+SharedMemoryServer::create(HostManager &hostManager,
+                           const SharedMemoryConfig &config) {
+  std::unique_ptr<SharedMemoryServer> server(
+      new SharedMemoryServer(hostManager, config.name));
+  RETURN_IF_ERR(server->init(config));
+  server->dispatcher_ = std::thread([server = server.get()]() {
+    server->dispatch();
+  });
+  return std::move(server);
+}
+
+SharedMemoryServer::~SharedMemoryServer() {
+  if (dispatcher_.joinable()) {
+    stop_ = true;
+    sem_post(&header_->submitted);
+    dispatcher_.join();
+  }
+  while (inflight_) {
+    std::this_thread::yield();
+  }
+  if (base_) {
+    sem_destroy(&header_->submitted);
+    for (unsigned i = 0; i < header_->numSlots; i++) {
+      sem_destroy(&getSlot(header_, i)->done);
+    }
+    munmap(base_, size_);
+    shm_unlink(name_.c_str());
+  }
+}
+
+void SharedMemoryServer::dispatch() {
+  while (true) {
+    waitOn(&header_->submitted);
+    if (stop_) {
+      return;
+    }
+    runSlot(popSlot(header_));
+  }
+}
+
+void SharedMemoryServer::runSlot(unsigned index) {
+  Slot *slot = getSlot(header_, index);
+  std::string network(slot->network, strnlen(slot->network, kMaxNameLen));
+  auto moduleOrErr = hostManager_.getNetworkModule(network);
+  if (!moduleOrErr) {
+    respond(index, moduleOrErr.takeError());
+    return;
+  }
+  // The module holds the placeholders of the context, it is kept alive until
+  // the run completes.
+  std::shared_ptr<Module> module = std::move(*moduleOrErr);
+
+  auto context = llvm::make_unique<ExecutionContext>();
+  auto *bindings = context->getPlaceholderBindings();
+  char *data = getSlotData(slot);
+  for (uint32_t i = 0; i < std::min<uint64_t>(slot->numTensors, kMaxTensors);
+       i++) {
+    const TensorDesc &desc = slot->tensors[i];
+    llvm::StringRef name(desc.name, strnlen(desc.name, kMaxNameLen));
+    Placeholder *PH = module->getPlaceholderByName(name);
+    if (!PH) {
+      respond(index,
+              MAKE_ERR(ErrorValue::ErrorCode::RUNTIME_ERROR,
+                       llvm::formatv("Network {0} has no placeholder {1}",
+                                     network, name)
+                           .str()));
+      return;
+    }
+    // The records are written by the client, they are checked against the
+    // slot.
+    if (desc.size != PH->getType()->getSizeInBytes() ||
+        desc.offset > header_->slotBytes ||
+        desc.size > header_->slotBytes - desc.offset ||
+        desc.offset % kAlignment || bindings->get(PH)) {
+      respond(index,
+              MAKE_ERR(ErrorValue::ErrorCode::RUNTIME_ERROR,
+                       llvm::formatv("Invalid tensor of placeholder {0}", name)
+                           .str()));
+      return;
+    }
+    bindings->insert(PH, Tensor(data + desc.offset, PH->getType()));
+  }
+  for (auto *PH : module->getPlaceholders()) {
+    if (!bindings->get(PH)) {
+      bindings->allocate(PH)->zero();
+    }
+  }
+
+  inflight_++;
+  hostManager_.runNetwork(
+      network, std::move(context),
+      [this, index, module](RunIdentifierTy, Error err,
+                            std::unique_ptr<ExecutionContext> context) {
+        // The tensors of the context point into the slot, they are released
+        // before the client reuses it.
+        context.reset();
+        respond(index, std::move(err));
+        inflight_--;
+      });
+}
+
+void SharedMemoryServer::respond(unsigned index, Error err) {
+  Slot *slot = getSlot(header_, index);
+  slot->failed = 0;
+  if (err) {
+    auto value = detail::takeErrorValue(std::move(err));
+    slot->failed = 1;
+    slot->errorCode = static_cast<uint32_t>(value->getErrorCode());
+    std::string message = value->logToString();
+    message.resize(std::min(message.size(), kMaxMessageLen - 1));
+    copyName(slot->errorMessage, message, kMaxMessageLen);
+  }
+  sem_post(&slot->done);
+}
+
+Expected<std::unique_ptr<SharedMemoryClient>>
+SharedMemoryClient::connect(llvm::StringRef name) {
+  std::string path = name;
+  int fd = shm_open(path.c_str(), O_RDWR, 0);
+  RETURN_ERR_IF_NOT(fd != -1, llvm::formatv("Can't open the segment {0}: {1}",
+                                            path, strerror(errno))
+                                  .str());
+  struct stat st;
+  void *base = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && size_t(st.st_size) >= sizeof(SegmentHeader)) {
+    base = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd,
+                0);
+  }
+  close(fd);
+  RETURN_ERR_IF_NOT(base != MAP_FAILED,
+                    llvm::formatv("Can't map the segment {0}", path).str());
+
+  std::unique_ptr<SharedMemoryClient> client(new SharedMemoryClient());
+  client->size_ = st.st_size;
+  client->base_ = static_cast<char *>(base);
+  client->header_ = reinterpret_cast<SegmentHeader *>(base);
+  SegmentHeader *header = client->header_;
+  RETURN_ERR_IF_NOT(
+      header->magic == kMagic && header->version == kVersion &&
+          getSlotsOffset(header->ringMask + 1) +
+                  uint64_t(header->numSlots) * header->slotStride <=
+              client->size_,
+      llvm::formatv("{0} isn't a segment of this version", path).str());
+  return std::move(client);
+}
+
+SharedMemoryClient::~SharedMemoryClient() {
+  if (base_) {
+    munmap(base_, size_);
+  }
+}
+
+SharedMemoryClient::Request::~Request() {
+  slot_->claimed.store(0, std::memory_order_release);
+}
+
+Expected<void *> SharedMemoryClient::Request::addTensor(llvm::StringRef name,
+                                                         size_t size) {
+  uint64_t offset = alignTo(slot_->used, kAlignment);
+  RETURN_ERR_IF_NOT(slot_->numTensors < kMaxTensors,
+                    "The request has too many tensors");
+  RETURN_ERR_IF_NOT(offset <= capacity_ && size <= capacity_ - offset,
+                    llvm::formatv("The tensors of the request need more than "
+                                  "the {0} bytes of a slot",
+                                  capacity_)
+                        .str());
+  RETURN_ERR_IF_NOT(name.size() < kMaxNameLen,
+                    llvm::formatv("The name {0} is too long", name).str());
+  TensorDesc &desc = slot_->tensors[slot_->numTensors];
+  copyName(desc.name, name, kMaxNameLen);
+  desc.offset = offset;
+  desc.size = size;
+  slot_->used = offset + size;
+  slot_->numTensors++;
+  return static_cast<void *>(data_ + offset);
+}
+
+Expected<std::unique_ptr<SharedMemoryClient::Request>>
+SharedMemoryClient::createRequest(llvm::StringRef networkName) {
+  RETURN_ERR_IF_NOT(
+      networkName.size() < kMaxNameLen,
+      llvm::formatv("The name {0} is too long", networkName).str());
+  for (unsigned i = 0; i < header_->numSlots; i++) {
+    Slot *slot = getSlot(header_, i);
+    uint32_t expected = 0;
+    if (slot->claimed.load(std::memory_order_relaxed) ||
+        !slot->claimed.compare_exchange_strong(expected, 1,
+                                               std::memory_order_acquire)) {
+      continue;
+    }
+    copyName(slot->network, networkName, kMaxNameLen);
+    slot->numTensors = 0;
+    slot->used = 0;
+    return std::unique_ptr<Request>(
+        new Request(slot, getSlotData(slot), header_->slotBytes));
+  }
+  return MAKE_ERR(ErrorValue::ErrorCode::RUNTIME_REQUEST_REFUSED,
+                  "All the slots of the segment are held");
+}
+
+Error SharedMemoryClient::run(Request &request) {
+  Slot *slot = request.slot_;
+  uint32_t index = (reinterpret_cast<char *>(slot) - base_ -
+                    getSlotsOffset(header_->ringMask + 1)) /
+                   header_->slotStride;
+  pushSlot(header_, index);
+  sem_post(&header_->submitted);
+  waitOn(&slot->done);
+  if (!slot->failed) {
+    return Error::success();
+  }
+  return MAKE_ERR(static_cast<ErrorValue::ErrorCode>(slot->errorCode),
+                  std::string(slot->errorMessage,
+                              strnlen(slot->errorMessage, kMaxMessageLen)));
+}
+
+#else
+
+namespace glow {
+namespace runtime {
+namespace shm {
+struct SegmentHeader {};
+struct Slot {};
+} // namespace shm
+} // namespace runtime
+} // namespace glow
+
+Error SharedMemoryServer::init(const SharedMemoryConfig &) {
+  return MAKE_ERR("Shared memory serving is only supported on Linux");
+}
+
+Expected<std::unique_ptr<SharedMemoryServer>>
+SharedMemoryServer::create(HostManager &hostManager,
+                           const SharedMemoryConfig &config) {
+  std::unique_ptr<SharedMemoryServer> server(
+      new SharedMemoryServer(hostManager, config.name));
+  RETURN_IF_ERR(server->init(config));
+  return std::move(server);
+}
+
+SharedMemoryServer::~SharedMemoryServer() = default;
+
+void SharedMemoryServer::dispatch() {}
+
+void SharedMemoryServer::runSlot(unsigned) {}
+
+void SharedMemoryServer::respond(unsigned, Error err) {
+  ERR_TO_VOID(std::move(err), /* log */ false);
+}
+
+Expected<std::unique_ptr<SharedMemoryClient>>
+SharedMemoryClient::connect(llvm::StringRef) {
+  return MAKE_ERR("Shared memory serving is only supported on Linux");
+}
+
+SharedMemoryClient::~SharedMemoryClient() = default;
+
+SharedMemoryClient::Request::~Request() = default;
+
+Expected<void *> SharedMemoryClient::Request::addTensor(llvm::StringRef,
+                                                         size_t) {
+  return MAKE_ERR("Shared memory serving is only supported on Linux");
+}
+
+Expected<std::unique_ptr<SharedMemoryClient::Request>>
+SharedMemoryClient::createRequest(llvm::StringRef) {
+  return MAKE_ERR("Shared memory serving is only supported on Linux");
+}
+
+Error SharedMemoryClient::run(Request &) {
+  return MAKE_ERR("Shared memory serving is only supported on Linux");
+}
+
+#endif // __linux__
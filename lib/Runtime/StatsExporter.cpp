@@ -16,6 +16,8 @@
 
 #include "glow/Runtime/StatsExporter.h"
 
+#include "llvm/ADT/Twine.h"
+
 #include <vector>
 
 namespace glow {
@@ -44,6 +46,19 @@ void StatsExporterRegistry::incrementCounter(llvm::StringRef key,
   }
 }
 
+void StatsExporterRegistry::addLatencyValue(
+    llvm::StringRef stage, llvm::StringRef name,
+    std::chrono::steady_clock::time_point start) {
+  if (exporters_.empty()) {
+    return;
+  }
+  auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start);
+  addTimeSeriesValue(
+      (llvm::Twine("glow.latency.") + stage + "." + name).str(),
+      elapsed.count());
+}
+
 StatsExporterRegistry *Stats() {
   static auto *stats = new StatsExporterRegistry();
   return stats;
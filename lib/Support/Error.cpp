@@ -73,6 +73,8 @@ std::string GlowErrorValue::errorCodeToString(const ErrorCode &ec) {
     return "MODEL_LOADER_UNSUPPORTED_ONNX_VERSION";
   case ErrorCode::MODEL_LOADER_INVALID_PROTOBUF:
     return "MODEL_LOADER_INVALID_PROTOBUF";
+  case ErrorCode::MODEL_LOADER_INVALID_MODULE:
+    return "MODEL_LOADER_INVALID_MODULE";
   case ErrorCode::PARTITIONER_ERROR:
     return "PARTITIONER_ERROR";
   case ErrorCode::RUNTIME_ERROR:
@@ -87,6 +89,10 @@ std::string GlowErrorValue::errorCodeToString(const ErrorCode &ec) {
     return "RUNTIME_DEVICE_NOT_FOUND";
   case ErrorCode::RUNTIME_NET_BUSY:
     return "RUNTIME_NET_BUSY";
+  case ErrorCode::RUNTIME_DEADLINE_EXCEEDED:
+    return "RUNTIME_DEADLINE_EXCEEDED";
+  case ErrorCode::RUNTIME_REQUEST_CANCELLED:
+    return "RUNTIME_REQUEST_CANCELLED";
   case ErrorCode::COMPILE_UNSUPPORTED_NODE_AFTER_OPTIMIZE:
     return "COMPILE_UNSUPPORTED_NODE_AFTER_OPTIMIZE";
   case ErrorCode::COMPILE_CONTEXT_MALFORMED:
@@ -0,0 +1,100 @@
+/**
+ * Copyright (c) Glow Contributors. See CONTRIBUTORS file.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "glow/Support/Float16.h"
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#ifdef __F16C__
+#include <immintrin.h>
+#endif
+
+using namespace glow;
+
+namespace {
+/// Number of elements under which a conversion runs on the calling thread,
+/// as starting threads would take longer than converting.
+constexpr size_t kParallelThreshold = 1 << 20;
+/// Maximum number of threads of a conversion, which is bound by the memory
+/// bandwidth beyond a few threads.
+constexpr unsigned kMaxThreads = 8;
+
+/// Calls \p fn(begin, end) on the ranges of [0, \p n) of several threads if
+/// \p n is large, else once on the calling thread. The ranges but the last
+/// are multiples of 8 elements, the width of the vector conversions.
+template <typename F> void parallelFor(size_t n, F fn) {
+  unsigned numThreads =
+      std::min(kMaxThreads, std::thread::hardware_concurrency());
+  if (n < kParallelThreshold || numThreads < 2) {
+    fn(0, n);
+    return;
+  }
+  size_t chunk = (n / numThreads + 7) & ~size_t(7);
+  std::vector<std::thread> threads;
+  for (size_t begin = chunk; begin < n; begin += chunk) {
+    threads.emplace_back(fn, begin, std::min(n, begin + chunk));
+  }
+  fn(0, chunk);
+  for (auto &thread : threads) {
+    thread.join();
+  }
+}
+
+void floatToFloat16(const float *src, uint16_t *dst, size_t begin,
+                    size_t end) {
+  size_t i = begin;
+#ifdef __F16C__
+  for (; i + 8 <= end; i += 8) {
+    __m128i h =
+        _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), h);
+  }
+#endif
+  for (; i < end; i++) {
+    dst[i] = fp16_ieee_from_fp32_value(src[i]);
+  }
+}
+
+void float16ToFloat(const uint16_t *src, float *dst, size_t begin,
+                    size_t end) {
+  size_t i = begin;
+#ifdef __F16C__
+  for (; i + 8 <= end; i += 8) {
+    __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+    _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(h));
+  }
+#endif
+  for (; i < end; i++) {
+    dst[i] = fp16_ieee_to_fp32_value(src[i]);
+  }
+}
+} // namespace
+
+void glow::convertFloatToFloat16(const float *src, float16 *dst, size_t n) {
+  auto *data = reinterpret_cast<uint16_t *>(dst);
+  parallelFor(n, [src, data](size_t begin, size_t end) {
+    floatToFloat16(src, data, begin, end);
+  });
+}
+
+void glow::convertFloat16ToFloat(const float16 *src, float *dst, size_t n) {
+  const auto *data = reinterpret_cast<const uint16_t *>(src);
+  parallelFor(n, [data, dst](size_t begin, size_t end) {
+    float16ToFloat(data, dst, begin, end);
+  });
+}
@@ -0,0 +1,109 @@
+/**
+ * Copyright (c) Glow Contributors. See CONTRIBUTORS file.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "glow/Support/HostMemory.h"
+#include "glow/Support/Memory.h"
+
+#include <algorithm>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+using namespace glow;
+
+namespace {
+
+/// \returns the size of the pages of the host.
+size_t getPageSize() {
+#ifndef _WIN32
+  static const size_t pageSize = sysconf(_SC_PAGESIZE);
+  return pageSize;
+#else
+  return 4096;
+#endif
+}
+
+} // namespace
+
+PageLockedAllocator::~PageLockedAllocator() {
+#ifndef _WIN32
+  for (auto &buffer : buffers_) {
+    munmap(reinterpret_cast<void *>(buffer.first), buffer.second);
+  }
+#endif
+}
+
+void *PageLockedAllocator::allocate(size_t bytes) {
+#ifndef _WIN32
+  // Buffers are whole pages, so that no other memory shares their locked
+  // pages, which are aligned on TensorAlignment.
+  size_t size = alignedSize(std::max<size_t>(bytes, 1), getPageSize());
+  void *data = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (data == MAP_FAILED) {
+    return nullptr;
+  }
+  if (mlock(data, size) != 0) {
+    munmap(data, size);
+    return nullptr;
+  }
+  std::lock_guard<std::mutex> lock(lock_);
+  buffers_[reinterpret_cast<uintptr_t>(data)] = size;
+  lockedBytes_ += size;
+  return data;
+#else
+  return nullptr;
+#endif
+}
+
+void PageLockedAllocator::deallocate(void *data, size_t bytes) {
+#ifndef _WIN32
+  size_t size;
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    auto it = buffers_.find(reinterpret_cast<uintptr_t>(data));
+    DCHECK(it != buffers_.end()) << "The buffer wasn't allocated here";
+    if (it == buffers_.end()) {
+      return;
+    }
+    size = it->second;
+    buffers_.erase(it);
+    lockedBytes_ -= size;
+  }
+  // munmap unlocks the pages.
+  munmap(data, size);
+#endif
+}
+
+bool PageLockedAllocator::contains(const void *data, size_t bytes) const {
+  auto addr = reinterpret_cast<uintptr_t>(data);
+  std::lock_guard<std::mutex> lock(lock_);
+  auto it = buffers_.upper_bound(addr);
+  if (it == buffers_.begin()) {
+    return false;
+  }
+  --it;
+  return addr - it->first + bytes <= it->second;
+}
+
+PageLockedAllocator &glow::getPageLockedAllocator() {
+  // The allocator is never destroyed, as tensors may be freed during the
+  // destruction of other statics.
+  static auto *allocator = new PageLockedAllocator();
+  return *allocator;
+}
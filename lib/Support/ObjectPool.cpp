@@ -0,0 +1,243 @@
+/**
+ * Copyright (c) Glow Contributors. See CONTRIBUTORS file.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "glow/Support/ObjectPool.h"
+
+#include <glog/logging.h>
+
+#include <cstdint>
+#include <mutex>
+#include <new>
+
+using namespace glow;
+
+namespace {
+
+/// Block sizes are multiples of this value, which is the alignment of the
+/// blocks.
+constexpr size_t Granule = alignof(std::max_align_t) < 16
+                               ? 16
+                               : alignof(std::max_align_t);
+
+/// Number of block sizes. Larger objects are allocated by operator new.
+constexpr size_t NumClasses = 64;
+
+/// Size class of the blocks allocated by operator new.
+constexpr uint32_t LargeClass = NumClasses;
+
+/// Every block starts with a header of this size holding its size class.
+constexpr size_t HeaderSize = Granule;
+
+/// Size of the slabs the blocks are carved from.
+constexpr size_t SlabSize = 1 << 20;
+
+/// Maximum number of free blocks of every size kept by a thread.
+constexpr size_t CacheCapacity = 128;
+
+/// Number of blocks moved at once between a thread and the global pool.
+constexpr size_t BatchSize = 32;
+
+struct BlockHeader {
+  uint32_t sizeClass;
+};
+
+/// A free block, linked through its payload.
+struct FreeBlock {
+  FreeBlock *next;
+};
+
+/// \returns the size in bytes, header included, of the blocks of class \p c.
+constexpr size_t getBlockSize(size_t c) {
+  return HeaderSize + (c + 1) * Granule;
+}
+
+BlockHeader *getHeader(void *ptr) {
+  return reinterpret_cast<BlockHeader *>(static_cast<char *>(ptr) -
+                                         HeaderSize);
+}
+
+void *getPayload(void *block) {
+  return static_cast<char *>(block) + HeaderSize;
+}
+
+/// The free blocks shared by the threads, and the slab the new blocks are
+/// carved from.
+class GlobalPool {
+  std::mutex lock_;
+  FreeBlock *free_[NumClasses]{};
+  char *cur_{nullptr};
+  char *end_{nullptr};
+  size_t numSlabs_{0};
+
+public:
+  /// \returns a list of up to \p n free blocks of class \p c, carving new
+  /// blocks if there are none, with its length in \p taken.
+  FreeBlock *take(size_t c, size_t n, size_t &taken) {
+    std::lock_guard<std::mutex> lock(lock_);
+    FreeBlock *head = free_[c];
+    taken = 0;
+    if (head) {
+      FreeBlock *tail = head;
+      for (taken = 1; taken < n && tail->next; taken++) {
+        tail = tail->next;
+      }
+      free_[c] = tail->next;
+      tail->next = nullptr;
+      return head;
+    }
+
+    const size_t blockSize = getBlockSize(c);
+    for (; taken < n; taken++) {
+      if (cur_ + blockSize > end_) {
+        if (taken) {
+          break;
+        }
+        // The rest of the current slab is too small, it is lost.
+        cur_ = static_cast<char *>(::operator new(SlabSize));
+        end_ = cur_ + SlabSize;
+        numSlabs_++;
+      }
+      reinterpret_cast<BlockHeader *>(cur_)->sizeClass = c;
+      auto *block = static_cast<FreeBlock *>(getPayload(cur_));
+      block->next = head;
+      head = block;
+      cur_ += blockSize;
+    }
+    return head;
+  }
+
+  /// Adds the list of free blocks of class \p c from \p head to \p tail.
+  void give(size_t c, FreeBlock *head, FreeBlock *tail) {
+    std::lock_guard<std::mutex> lock(lock_);
+    tail->next = free_[c];
+    free_[c] = head;
+  }
+
+  size_t getNumSlabs() {
+    std::lock_guard<std::mutex> lock(lock_);
+    return numSlabs_;
+  }
+};
+
+/// \returns the global pool. It is never destroyed, objects may be freed by
+/// the destructors of static objects.
+GlobalPool &getGlobalPool() {
+  static GlobalPool *pool = new GlobalPool();
+  return *pool;
+}
+
+/// The free blocks of a thread. It is trivially destructible, so that it
+/// stays usable until the thread is gone.
+struct ThreadCache {
+  FreeBlock *free[NumClasses];
+  size_t count[NumClasses];
+  /// Set once the blocks were given back to the global pool, at the exit of
+  /// the thread. Blocks then go straight to the global pool.
+  bool disabled;
+};
+
+thread_local ThreadCache threadCache;
+
+/// Gives the blocks of the cache of the thread back to the global pool when
+/// the thread exits.
+struct ThreadCacheFlusher {
+  ~ThreadCacheFlusher() {
+    for (size_t c = 0; c < NumClasses; c++) {
+      FreeBlock *head = threadCache.free[c];
+      if (!head) {
+        continue;
+      }
+      FreeBlock *tail = head;
+      while (tail->next) {
+        tail = tail->next;
+      }
+      getGlobalPool().give(c, head, tail);
+      threadCache.free[c] = nullptr;
+      threadCache.count[c] = 0;
+    }
+    threadCache.disabled = true;
+  }
+};
+
+thread_local ThreadCacheFlusher threadCacheFlusher;
+
+} // namespace
+
+void *ObjectPool::allocate(size_t size) {
+  if (size > NumClasses * Granule) {
+    void *block = ::operator new(HeaderSize + size);
+    getHeader(getPayload(block))->sizeClass = LargeClass;
+    return getPayload(block);
+  }
+  const size_t c = size ? (size - 1) / Granule : 0;
+  auto &cache = threadCache;
+  if (cache.disabled) {
+    size_t taken;
+    return getGlobalPool().take(c, 1, taken);
+  }
+  if (!cache.free[c]) {
+    // Make sure that the blocks of the thread are given back when it exits.
+    (void)&threadCacheFlusher;
+    cache.free[c] = getGlobalPool().take(c, BatchSize, cache.count[c]);
+  }
+  FreeBlock *block = cache.free[c];
+  cache.free[c] = block->next;
+  cache.count[c]--;
+  return block;
+}
+
+void ObjectPool::deallocate(void *ptr) {
+  if (!ptr) {
+    return;
+  }
+  const uint32_t c = getHeader(ptr)->sizeClass;
+  if (c == LargeClass) {
+    ::operator delete(static_cast<char *>(ptr) - HeaderSize);
+    return;
+  }
+  DCHECK_LT(c, NumClasses) << "Not a block of the object pool";
+  auto *block = static_cast<FreeBlock *>(ptr);
+  auto &cache = threadCache;
+  if (cache.disabled) {
+    block->next = nullptr;
+    getGlobalPool().give(c, block, block);
+    return;
+  }
+  if (!cache.free[c]) {
+    (void)&threadCacheFlusher;
+  }
+  block->next = cache.free[c];
+  cache.free[c] = block;
+  if (++cache.count[c] < CacheCapacity) {
+    return;
+  }
+  // Give the blocks freed first back to the global pool, e.g. when a thread
+  // frees what another thread allocated.
+  FreeBlock *keep = block;
+  for (size_t i = 1; i < CacheCapacity - BatchSize; i++) {
+    keep = keep->next;
+  }
+  FreeBlock *head = keep->next;
+  FreeBlock *tail = head;
+  while (tail->next) {
+    tail = tail->next;
+  }
+  keep->next = nullptr;
+  getGlobalPool().give(c, head, tail);
+  cache.count[c] = CacheCapacity - BatchSize;
+}
+
+size_t ObjectPool::getNumSlabs() { return getGlobalPool().getNumSlabs(); }
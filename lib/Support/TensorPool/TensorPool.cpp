@@ -16,85 +16,244 @@
 
 #include "glow/Support/TensorPool.h"
 
+#include "llvm/Support/MathExtras.h"
+
+#include <unordered_map>
+
 namespace glow {
 
-Tensor *TensorPool::get(TypeRef ty) {
-  stats_.totalGets++;
+constexpr size_t TensorPool::kNumSizeClasses;
+constexpr size_t TensorPool::kThreadCacheSize;
+constexpr size_t TensorPool::kSharedListCapacity;
 
-  std::unique_lock<std::mutex> l(lock_);
+/// Source of the ids of the pools.
+static std::atomic<uint64_t> nextPoolId{0};
 
-  auto it = pools_.find(*ty);
+size_t TensorPool::getSizeClass(uint64_t bytes) {
+  assert(bytes > 0 && "Tensors must always have positive size.");
+  // The four smallest classes are 1 to 4 bytes. Past them, the sizes in
+  // (2^(p-1), 2^p] are split into four classes a quarter of 2^(p-1) apart.
+  if (bytes <= 4) {
+    return bytes - 1;
+  }
+  uint64_t p = llvm::Log2_64_Ceil(bytes);
+  uint64_t base = uint64_t(1) << (p - 1);
+  uint64_t step = base >> 2;
+  uint64_t quarter = (bytes - base + step - 1) / step;
+  return 4 * (p - 2) + quarter - 1;
+}
 
-  if (it == pools_.end()) {
-    if (preventInlineAllocs_) {
-      return nullptr;
+uint64_t TensorPool::getSizeClassBytes(size_t sizeClass) {
+  assert(sizeClass < kNumSizeClasses && "Invalid size class");
+  if (sizeClass < 4) {
+    return sizeClass + 1;
+  }
+  uint64_t base = uint64_t(1) << (sizeClass / 4 + 1);
+  return base + (sizeClass % 4 + 1) * (base >> 2);
+}
+
+TensorPool::ThreadCache::ThreadCache() {
+  for (auto &classSlots : slots) {
+    for (auto &slot : classSlots) {
+      slot.store(nullptr, std::memory_order_relaxed);
     }
+  }
+}
+
+TensorPool::TensorPool(bool preventAllocs, HostMemoryAllocator *hostMemory)
+    : id_(nextPoolId++), preventInlineAllocs_{preventAllocs},
+      hostMemory_(hostMemory) {
+  for (auto &list : sharedLists_) {
+    list.store(nullptr, std::memory_order_relaxed);
+  }
+  for (auto &mask : usedSizeClasses_) {
+    mask.store(0, std::memory_order_relaxed);
+  }
+}
+
+TensorPool::~TensorPool() {
+  clear();
+  for (auto &list : sharedLists_) {
+    delete list.load();
+  }
+}
 
+TensorPool::ThreadCache &TensorPool::getThreadCache() {
+  // Most threads only ever use one pool, so the last pool used is checked
+  // before the map of all of them.
+  thread_local uint64_t lastId = ~uint64_t(0);
+  thread_local ThreadCache *lastCache = nullptr;
+  if (lastId == id_) {
+    return *lastCache;
+  }
+  thread_local std::unordered_map<uint64_t, ThreadCache *> threadCaches;
+  auto &cache = threadCaches[id_];
+  if (!cache) {
+    std::unique_ptr<ThreadCache> newCache(new ThreadCache());
+    cache = newCache.get();
+    std::lock_guard<std::mutex> l(threadCachesLock_);
+    threadCaches_.push_back(std::move(newCache));
+  }
+  lastId = id_;
+  lastCache = cache;
+  return *cache;
+}
+
+MPMCQueue<Tensor *> &TensorPool::getSharedList(size_t sizeClass) {
+  auto *list = sharedLists_[sizeClass].load(std::memory_order_acquire);
+  if (list) {
+    return *list;
+  }
+  auto *newList = new MPMCQueue<Tensor *>(kSharedListCapacity);
+  if (sharedLists_[sizeClass].compare_exchange_strong(list, newList)) {
+    return *newList;
+  }
+  // Another thread created the list first.
+  delete newList;
+  return *list;
+}
+
+void TensorPool::markSizeClassUsed(size_t sizeClass) {
+  uint64_t bit = uint64_t(1) << (sizeClass % 64);
+  auto &mask = usedSizeClasses_[sizeClass / 64];
+  if (mask.load(std::memory_order_relaxed) & bit) {
+    return;
+  }
+  if (!(mask.fetch_or(bit) & bit)) {
     stats_.totalTypes++;
-    it = pools_.emplace(*ty, std::vector<Tensor *>()).first;
+  }
+}
+
+Tensor *TensorPool::allocate(TypeRef ty, size_t sizeClass) {
+  // Allocate the whole size class so that the buffer can be reused by any
+  // Type of the class, then give it the requested Type.
+  Type classTy(ElemKind::BoolTy, {getSizeClassBytes(sizeClass)});
+  Tensor *t = nullptr;
+  if (hostMemory_) {
+    if (void *data = hostMemory_->allocate(classTy.getSizeInBytes())) {
+      // The Tensor doesn't own the buffer, which freeTensor() gives back.
+      t = new Tensor(data, &classTy);
+      t->tensorPool_ = this;
+    } else {
+      stats_.hostMemoryFallbacks++;
+    }
+  }
+  if (!t) {
+    t = new Tensor(&classTy, this);
+  }
+  t->type_ = *ty;
+  return t;
+}
+
+void TensorPool::freeTensor(Tensor *t) {
+  if (hostMemory_ && t->isUnowned()) {
+    hostMemory_->deallocate(
+        t->getUnsafePtr(),
+        getSizeClassBytes(getSizeClass(t->getSizeInBytes())));
+  }
+  delete t;
+}
+
+void TensorPool::pushShared(Tensor *t, size_t sizeClass) {
+  if (!getSharedList(sizeClass).push(std::move(t))) {
+    stats_.overflowFrees++;
+    stats_.currentBuffers--;
+    stats_.totalFrees++;
+    freeTensor(t);
+  }
+}
+
+Tensor *TensorPool::get(TypeRef ty) {
+  stats_.totalGets++;
+
+  size_t sizeClass = getSizeClass(ty->getSizeInBytes());
+  Tensor *t = nullptr;
+  for (auto &slot : getThreadCache().slots[sizeClass]) {
+    if (slot.load(std::memory_order_relaxed) &&
+        (t = slot.exchange(nullptr, std::memory_order_acquire))) {
+      stats_.threadCacheGets++;
+      break;
+    }
+  }
+  if (!t) {
+    auto *list = sharedLists_[sizeClass].load(std::memory_order_acquire);
+    if (list) {
+      if (auto value = list->pop()) {
+        t = *value;
+        stats_.sharedListGets++;
+      }
+    }
   }
 
-  if (it->second.empty()) {
+  if (!t) {
     if (preventInlineAllocs_) {
       return nullptr;
     }
 
-    // Don't need to alloc under the lock.
-    l.unlock();
+    markSizeClassUsed(sizeClass);
     stats_.totalAllocs++;
     stats_.inlineAllocs++;
-    // Don't add it to the queue because it's being claimed now.
-    return new Tensor(ty, this);
+    // Don't add it to the pool because it's being claimed now.
+    return allocate(ty, sizeClass);
   }
 
-  auto &queue = it->second;
-  Tensor *t = std::move(queue.back());
-  queue.pop_back();
   stats_.currentBuffers--;
+  t->type_ = *ty;
+  t->unpaddedSize_ = 0;
   return t;
 }
 
 void TensorPool::reclaim(Tensor *t) {
-  std::lock_guard<std::mutex> l(lock_);
-  auto it = pools_.find(t->getType());
-  assert(it != pools_.end() && "Type has not been initialized");
+  assert(t->getOwningPool() == this && "Tensor is not owned by this pool");
+  size_t sizeClass = getSizeClass(t->getSizeInBytes());
   stats_.totalReclaims++;
   stats_.currentBuffers++;
-  it->second.push_back(t);
+  for (auto &slot : getThreadCache().slots[sizeClass]) {
+    Tensor *empty = nullptr;
+    if (!slot.load(std::memory_order_relaxed) &&
+        slot.compare_exchange_strong(empty, t, std::memory_order_release)) {
+      return;
+    }
+  }
+  stats_.sharedListReclaims++;
+  pushShared(t, sizeClass);
 }
 
 void TensorPool::reserve(TypeRef ty, size_t count) {
-  std::vector<Tensor *> temp;
-  temp.reserve(count);
-  for (unsigned i = 0; i < count; ++i) {
+  size_t sizeClass = getSizeClass(ty->getSizeInBytes());
+  markSizeClassUsed(sizeClass);
+  for (size_t i = 0; i < count; ++i) {
     stats_.totalAllocs++;
-    temp.push_back(new Tensor(ty, this));
-  }
-
-  {
-    std::lock_guard<std::mutex> l(lock_);
-    auto it = pools_.find(*ty);
-    if (it == pools_.end()) {
-      stats_.totalTypes++;
-    }
-
-    std::vector<Tensor *> &queue = pools_[*ty];
-    std::move(temp.begin(), temp.end(), std::back_inserter(queue));
-    stats_.currentBuffers += count;
+    stats_.currentBuffers++;
+    pushShared(allocate(ty, sizeClass), sizeClass);
   }
 }
 
 void TensorPool::clear() {
-  std::lock_guard<std::mutex> l(lock_);
-  for (auto &p : pools_) {
-    stats_.currentBuffers -= p.second.size();
-    for (auto *t : p.second) {
-      delete t;
+  for (auto &list : sharedLists_) {
+    auto *queue = list.load(std::memory_order_acquire);
+    if (!queue) {
+      continue;
+    }
+    while (auto value = queue->pop()) {
+      stats_.currentBuffers--;
+      freeTensor(*value);
       stats_.totalFrees++;
     }
-    p.second.clear();
   }
-  assert(stats_.currentBuffers == 0);
+
+  std::lock_guard<std::mutex> l(threadCachesLock_);
+  for (auto &cache : threadCaches_) {
+    for (auto &classSlots : cache->slots) {
+      for (auto &slot : classSlots) {
+        if (auto *t = slot.exchange(nullptr, std::memory_order_acquire)) {
+          stats_.currentBuffers--;
+          freeTensor(t);
+          stats_.totalFrees++;
+        }
+      }
+    }
+  }
 }
 
 } // namespace glow
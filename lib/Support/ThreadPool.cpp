@@ -15,8 +15,60 @@
  */
 #include "glow/Support/ThreadPool.h"
 
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
 namespace glow {
 
+std::vector<unsigned> getNumaNodeCPUs(unsigned node) {
+  std::vector<unsigned> cpus;
+#ifdef __linux__
+  // The list is made of comma separated CPUs and ranges, e.g. "0-11,24-35".
+  std::ifstream list("/sys/devices/system/node/node" + std::to_string(node) +
+                     "/cpulist");
+  std::string range;
+  while (std::getline(list, range, ',')) {
+    unsigned first, last;
+    int numRead = sscanf(range.c_str(), "%u-%u", &first, &last);
+    if (numRead < 1) {
+      continue;
+    }
+    if (numRead == 1) {
+      last = first;
+    }
+    for (unsigned cpu = first; cpu <= last; cpu++) {
+      cpus.push_back(cpu);
+    }
+  }
+#endif
+  return cpus;
+}
+
+bool setCurrentThreadAffinity(const std::vector<unsigned> &cpus) {
+#ifdef __linux__
+  if (cpus.empty()) {
+    return false;
+  }
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (unsigned cpu : cpus) {
+    if (cpu < CPU_SETSIZE) {
+      CPU_SET(cpu, &set);
+    }
+  }
+  return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+  (void)cpus;
+  return false;
+#endif
+}
+
 ThreadExecutor::ThreadExecutor()
     : shouldStop_(false), worker_([this]() { threadPoolWorkerMain(); }) {}
 
@@ -77,32 +129,152 @@ ThreadExecutor::submit(std::packaged_task<void(void)> &&task) {
   return future;
 }
 
+namespace {
+/// The worker whose thread is the current thread, if any.
+thread_local ThreadPool::Worker *currentWorker = nullptr;
+} // namespace
+
 ThreadPool::ThreadPool(unsigned numWorkers) {
   // Intialize all workers and make each one run threadPoolWorkerMain.
-  workers_.reserve(kNumWorkers);
+  workers_.reserve(numWorkers);
   for (unsigned i = 0; i < numWorkers; i++) {
-    workers_.push_back(new ThreadExecutor());
+    workers_.emplace_back(new Worker(this, i));
+  }
+  // Start the threads once all the workers exist, since they steal from each
+  // other.
+  for (auto &w : workers_) {
+    Worker *worker = w.get();
+    worker->thread_ = std::thread([this, worker]() {
+      currentWorker = worker;
+      threadPoolWorkerMain(worker);
+    });
   }
 }
 
 ThreadPool::~ThreadPool() {
   stop(true);
-  for (auto *w : workers_) {
-    delete w;
-  }
   workers_.clear();
 }
 
 void ThreadPool::stop(bool block) {
-  // Signal to workers to stop.
-  for (auto *w : workers_) {
-    w->stop(block);
+  // Lock mutex before signalling for threads to stop to make sure
+  // a thread can't wait on the condition variable after checking the
+  // *old* value of shouldStop_.
+  std::unique_lock<std::mutex> lock(waitMtx_);
+  shouldStop_ = true;
+  lock.unlock();
+  taskQueued_.notify_all();
+
+  if (block) {
+    for (auto &w : workers_) {
+      if (w->thread_.joinable()) {
+        w->thread_.join();
+      }
+    }
   }
 }
 
+void ThreadPool::notifyWorkers(bool all) {
+  // A worker increments numWaiting_ before it checks for tasks, so either it
+  // sees the task or it is seen here.
+  if (numWaiting_ == 0) {
+    return;
+  }
+  std::unique_lock<std::mutex> lock(waitMtx_);
+  lock.unlock();
+  if (all) {
+    taskQueued_.notify_all();
+  } else {
+    taskQueued_.notify_one();
+  }
+}
+
+std::future<void>
+ThreadPool::Worker::submit(std::packaged_task<void(void)> &&task) {
+  auto future = task.get_future();
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    pinnedTasks_.emplace_back(std::move(task));
+    numPinnedTasks_++;
+  }
+  // Only this worker can run the task, so wake all of them.
+  pool_->notifyWorkers(/* all */ true);
+  return future;
+}
+
 std::future<void> ThreadPool::submit(std::packaged_task<void(void)> &&task) {
-  ThreadExecutor *ex = getExecutor();
-  return ex->submit(std::move(task));
+  auto future = task.get_future();
+  run(std::move(task));
+  return future;
+}
+
+void ThreadPool::run(InlineFunction &&fn) {
+  // Keep the tasks submitted by a worker on it, they likely use the data it
+  // just used.
+  Worker *worker = currentWorker;
+  if (!worker || worker->pool_ != this) {
+    worker = workers_[nextWorker_++ % workers_.size()].get();
+  }
+  {
+    std::lock_guard<std::mutex> lock(worker->lock_);
+    worker->tasks_.emplace_back(std::move(fn));
+    numTasks_++;
+  }
+  notifyWorkers(/* all */ false);
+}
+
+InlineFunction ThreadPool::takeTask(Worker *worker) {
+  InlineFunction task;
+  {
+    std::lock_guard<std::mutex> lock(worker->lock_);
+    if (!worker->pinnedTasks_.empty()) {
+      task = std::move(worker->pinnedTasks_.front());
+      worker->pinnedTasks_.pop_front();
+      worker->numPinnedTasks_--;
+      return task;
+    }
+    if (!worker->tasks_.empty()) {
+      task = std::move(worker->tasks_.front());
+      worker->tasks_.pop_front();
+      numTasks_--;
+      return task;
+    }
+  }
+
+  // Steal from the other workers, starting with the next one so that the
+  // workers don't all steal from the same one.
+  if (numTasks_ == 0) {
+    return task;
+  }
+  for (size_t i = 1; i < workers_.size(); i++) {
+    Worker *victim = workers_[(worker->index_ + i) % workers_.size()].get();
+    std::lock_guard<std::mutex> lock(victim->lock_);
+    if (!victim->tasks_.empty()) {
+      task = std::move(victim->tasks_.front());
+      victim->tasks_.pop_front();
+      numTasks_--;
+      return task;
+    }
+  }
+  return task;
+}
+
+void ThreadPool::threadPoolWorkerMain(Worker *worker) {
+  while (!shouldStop_) {
+    if (InlineFunction task = takeTask(worker)) {
+      // Process work item.
+      task();
+      continue;
+    }
+
+    // Wait to be signalled when a task this worker can run is queued.
+    std::unique_lock<std::mutex> lock(waitMtx_);
+    numWaiting_++;
+    taskQueued_.wait(lock, [this, worker]() {
+      return shouldStop_ || numTasks_ > 0 || worker->numPinnedTasks_ > 0;
+    });
+    numWaiting_--;
+  }
 }
 
 } // namespace glow
@@ -0,0 +1,144 @@
+/**
+ * Copyright (c) Glow Contributors. See CONTRIBUTORS file.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <algorithm>
+#include <cstdlib>
+#include <future>
+#include <string>
+
+#include "Bench.h"
+
+#include "glow/ExecutionEngine/ExecutionEngine.h"
+
+#include "llvm/Support/CommandLine.h"
+
+using namespace glow;
+
+/*
+ * This class implements a benchmark of the activations computing
+ * exponentials: Sigmoid, Tanh, Exp and SoftMax. A number of layers of the
+ * activation are computed from an input of rows x cols floats, with the
+ * exact or the fast math of -llvm-fast-math.
+ */
+class ActivationBench : public Benchmark {
+  size_t rows_;
+  size_t cols_;
+  size_t numLayers_;
+  std::string op_;
+  const char *backendStr_;
+  std::unique_ptr<runtime::HostManager> hostManager_;
+  std::unique_ptr<ExecutionContext> context_;
+
+public:
+  ActivationBench(size_t rows, size_t cols, size_t numLayers,
+                  const char *opStr, const char *backendStr)
+      : rows_(rows), cols_(cols), numLayers_(numLayers), op_(opStr),
+        backendStr_(backendStr) {}
+
+  void setup() override {
+    std::vector<std::unique_ptr<runtime::DeviceConfig>> configs;
+    configs.push_back(llvm::make_unique<runtime::DeviceConfig>(backendStr_));
+    hostManager_ = llvm::make_unique<runtime::HostManager>(std::move(configs));
+
+    std::unique_ptr<Module> mod(new Module);
+    auto *fn = mod->createFunction("singleNode");
+    auto *input =
+        mod->createPlaceholder(ElemKind::FloatTy, {rows_, cols_}, "A", false);
+    auto *selected =
+        mod->createConstant(ElemKind::Int64ITy, {rows_, 1}, "selected");
+    selected->getPayloadMutable().zero();
+
+    // The layers are independent, so that the chains of Exp don't overflow.
+    for (size_t layer = 0; layer < numLayers_; layer++) {
+      auto name = op_ + std::to_string(layer);
+      NodeValue result;
+      if (op_ == "sigmoid") {
+        result = fn->createSigmoid(name, input);
+      } else if (op_ == "tanh") {
+        result = fn->createTanh(name, input);
+      } else if (op_ == "exp") {
+        result = fn->createExp(name, input);
+      } else if (op_ == "softmax") {
+        result = fn->createSoftMax(name, input, selected);
+      } else {
+        llvm_unreachable("Expected sigmoid, tanh, exp or softmax");
+      }
+      fn->createSave("save" + std::to_string(layer), result);
+    }
+
+    context_ = llvm::make_unique<ExecutionContext>();
+    auto *bindings = context_->getPlaceholderBindings();
+    bindings->allocate(mod->getPlaceholders());
+    bindings->get(input)->getHandle().randomize(-4.0, 4.0, mod->getPRNG());
+
+    CompilationContext ctx;
+    EXIT_ON_ERR(hostManager_->addNetwork(std::move(mod), ctx));
+  }
+
+  void run() override {
+    std::promise<void> runPromise;
+    auto future = runPromise.get_future();
+    hostManager_->runNetwork(
+        "singleNode", std::move(context_),
+        [&](runtime::RunIdentifierTy, Error err,
+            std::unique_ptr<ExecutionContext> context) {
+          EXIT_ON_ERR(std::move(err));
+          context_ = std::move(context);
+          runPromise.set_value();
+        });
+    future.wait();
+  }
+
+  void teardown() override {}
+
+  // One input and one output per layer.
+  double gbytes() const {
+    return sizeof(float) * rows_ * cols_ * (2 * numLayers_) / 1e9;
+  }
+};
+
+int main(int argc, char *argv[]) {
+  assert(argc == 8);
+  size_t rows = atoi(argv[1]);
+  size_t cols = atoi(argv[2]);
+  size_t numLayers = atoi(argv[3]);
+  size_t reps = atoi(argv[4]);
+  const char *opStr = argv[5];
+  const char *backendStr = argv[6];
+  const char *mathStr = argv[7];
+  assert(reps > 0);
+
+  if (std::string(mathStr) == "fast") {
+    const char *opts[] = {argv[0], "-llvm-fast-math"};
+    llvm::cl::ParseCommandLineOptions(2, opts);
+  }
+
+  ActivationBench b(rows, cols, numLayers, opStr, backendStr);
+  auto times = bench(&b, reps);
+  for (auto t : times) {
+    printf("BenchResult,ActivationBench,SW,%4zu,%4zu,%4zu,%4zu,%s,%s,%s,"
+           "%2.6lf,%5.2lf\n",
+           rows, cols, numLayers, reps, opStr, backendStr, mathStr, t,
+           b.gbytes() / t);
+  }
+  double min = *(std::min_element(times.begin(), times.end()));
+  size_t midElt = times.size() / 2;
+  std::nth_element(times.begin(), times.begin() + midElt, times.end());
+  double median = times[midElt];
+  printf("BenchSummary,ActivationBench,SW,%4zu,%4zu,%4zu,%4zu,%s,%s,%s,%2.6lf,"
+         "%2.6lf,%5.2lf,%5.2lf\n",
+         rows, cols, numLayers, reps, opStr, backendStr, mathStr, median, min,
+         b.gbytes() / median, b.gbytes() / min);
+}
@@ -22,12 +22,44 @@ using namespace glow;
 
 extern "C" {
 // Forward declare functions from libjit.
-extern void libjit_convolution_f(float *outW, const float *inW, const float *filterW,
-                     const float *biasW, const size_t *outWdims,
-                     const size_t *inWdims, const size_t *filterWdims, 
-                     const size_t *biasWdims, const size_t *kernelSizes, 
-                     const size_t *strides, const size_t *pads, 
-                     size_t group, unsigned depthUnroll);
+extern void libjit_convolution_f(float *outW, const float *inW,
+                                 const float *filterW, const float *biasW,
+                                 const size_t *outWdims, const size_t *inWdims,
+                                 const size_t *filterWdims,
+                                 const size_t *biasWdims,
+                                 const size_t *kernelSizes,
+                                 const size_t *strides, const size_t *pads,
+                                 size_t group, unsigned depthUnroll,
+                                 size_t dilation);
+extern void libjit_conv_im2col_f(float *outW, const float *inW,
+                                 const float *filterW, const float *biasW,
+                                 const size_t *outWdims, const size_t *inWdims,
+                                 const size_t *filterWdims,
+                                 const size_t *biasWdims,
+                                 const size_t *kernelSizes,
+                                 const size_t *strides, const size_t *pads);
+extern void libjit_conv_winograd_f(float *outW, const float *inW,
+                                   const float *filterW, const float *biasW,
+                                   const size_t *outWdims,
+                                   const size_t *inWdims,
+                                   const size_t *filterWdims,
+                                   const size_t *biasWdims,
+                                   const size_t *pads);
+}
+
+/// The convolution algorithms of the CPU backend.
+enum class ConvAlgorithm { Direct, Im2Col, Winograd };
+
+static const char *getAlgorithmName(ConvAlgorithm algorithm) {
+  switch (algorithm) {
+  case ConvAlgorithm::Direct:
+    return "direct";
+  case ConvAlgorithm::Im2Col:
+    return "im2col";
+  case ConvAlgorithm::Winograd:
+    return "winograd";
+  }
+  return "unknown";
 }
 
 /// Benchmark a convolution with specified parameters on square inputs.
@@ -37,6 +69,8 @@ class ConvBench : public Benchmark {
   std::vector<float> inW;
   std::vector<float> filterW;
   std::vector<float> biasW;
+  /// The filter in the layout expected by the selected algorithm.
+  std::vector<float> algoFilterW;
 
   /// Dimensions
   // [batch, h, w, channels]
@@ -44,39 +78,44 @@ class ConvBench : public Benchmark {
   size_t inWdims[4];
   // [outputChannels, h, w, inputChannels]
   size_t filterWdims[4];
+  // [h * w * inputChannels, outputChannels] for im2col and
+  // [16, inputChannels, outputChannels] for Winograd.
+  size_t algoFilterWdims[3];
 
   /// Parameters
   size_t kernelSizes[2];
   size_t strides[2];
-  size_t pads[2];
+  size_t pads[4];
   size_t group;
   unsigned depthUnroll;
-
+  ConvAlgorithm algorithm;
 
 public:
-  ConvBench(size_t inputBatch, size_t inputEdgeSize, size_t inputChannels, size_t filterMultiplier, 
-            size_t kernelSize, size_t stride, size_t pad, size_t group)
-      : kernelSizes{kernelSize, kernelSize}, strides{stride, stride}, 
-      pads{pad, pad}, group(group) {
-
-        inWdims[0] = inputBatch;  
-        inWdims[1] = inputEdgeSize;
-        inWdims[2] = inputEdgeSize;
-        inWdims[3] = inputChannels;
-
-        filterWdims[0] = filterMultiplier * group;
-        filterWdims[1] = kernelSize;
-        filterWdims[2] = kernelSize;
-        filterWdims[3] = inWdims[3] / group;
-
-        size_t outEdgeSize = ((inputEdgeSize + (2 * pad) - kernelSize) / stride) + 1;
-        outWdims[0] = inWdims[0];
-        outWdims[1] = outEdgeSize;
-        outWdims[2] = outEdgeSize;
-        outWdims[3] = filterWdims[0];
-
-        depthUnroll = (((outWdims[3] / group) % 8) == 0) ? 8 : 1; 
-      }
+  ConvBench(size_t inputBatch, size_t inputEdgeSize, size_t inputChannels,
+            size_t filterMultiplier, size_t kernelSize, size_t stride,
+            size_t pad, size_t group, ConvAlgorithm algorithm)
+      : kernelSizes{kernelSize, kernelSize}, strides{stride, stride},
+        pads{pad, pad, pad, pad}, group(group), algorithm(algorithm) {
+
+    inWdims[0] = inputBatch;
+    inWdims[1] = inputEdgeSize;
+    inWdims[2] = inputEdgeSize;
+    inWdims[3] = inputChannels;
+
+    filterWdims[0] = filterMultiplier * group;
+    filterWdims[1] = kernelSize;
+    filterWdims[2] = kernelSize;
+    filterWdims[3] = inWdims[3] / group;
+
+    size_t outEdgeSize =
+        ((inputEdgeSize + (2 * pad) - kernelSize) / stride) + 1;
+    outWdims[0] = inWdims[0];
+    outWdims[1] = outEdgeSize;
+    outWdims[2] = outEdgeSize;
+    outWdims[3] = filterWdims[0];
+
+    depthUnroll = (((outWdims[3] / group) % 8) == 0) ? 8 : 1;
+  }
 
   virtual void setup() override {
     size_t outSize = mapMult(outWdims, 4);
@@ -92,13 +131,69 @@ public:
     randomize(inSize, inW.data());
     randomize(filterSize, filterW.data());
     randomize(biasSize, biasW.data());
+
+    // Rewrite the filter the way the CPU backend does at compile time.
+    size_t depth = filterWdims[0];
+    size_t channels = filterWdims[3];
+    size_t patchSize = filterWdims[1] * filterWdims[2] * channels;
+    if (algorithm == ConvAlgorithm::Im2Col) {
+      algoFilterWdims[0] = patchSize;
+      algoFilterWdims[1] = depth;
+      algoFilterW.resize(filterSize);
+      for (size_t d = 0; d < depth; d++) {
+        for (size_t i = 0; i < patchSize; i++) {
+          algoFilterW[i * depth + d] = filterW[d * patchSize + i];
+        }
+      }
+    } else if (algorithm == ConvAlgorithm::Winograd) {
+      static const float G[4][3] = {
+          {1.0f, 0.0f, 0.0f},
+          {0.5f, 0.5f, 0.5f},
+          {0.5f, -0.5f, 0.5f},
+          {0.0f, 0.0f, 1.0f},
+      };
+      algoFilterWdims[0] = 16;
+      algoFilterWdims[1] = channels;
+      algoFilterWdims[2] = depth;
+      algoFilterW.resize(16 * channels * depth);
+      for (size_t d = 0; d < depth; d++) {
+        for (size_t c = 0; c < channels; c++) {
+          const float *g = &filterW[d * patchSize + c];
+          for (size_t i = 0; i < 4; i++) {
+            for (size_t j = 0; j < 4; j++) {
+              float u = 0;
+              for (size_t k = 0; k < 3; k++) {
+                for (size_t l = 0; l < 3; l++) {
+                  u += G[i][k] * g[(k * 3 + l) * channels] * G[j][l];
+                }
+              }
+              algoFilterW[((i * 4 + j) * channels + c) * depth + d] = u;
+            }
+          }
+        }
+      }
+    }
   }
 
   virtual void run() override {
-    // biasWDims isn't used in libjit_convolution_f, so we're passing NULL.
-    libjit_convolution_f(outW.data(), inW.data(), filterW.data(), biasW.data(), 
-                         outWdims, inWdims, filterWdims, NULL, 
-                         kernelSizes, strides, pads, group, depthUnroll);
+    // biasWDims isn't used by the convolutions, so we're passing NULL.
+    switch (algorithm) {
+    case ConvAlgorithm::Direct:
+      libjit_convolution_f(outW.data(), inW.data(), filterW.data(),
+                           biasW.data(), outWdims, inWdims, filterWdims, NULL,
+                           kernelSizes, strides, pads, group, depthUnroll, 1);
+      break;
+    case ConvAlgorithm::Im2Col:
+      libjit_conv_im2col_f(outW.data(), inW.data(), algoFilterW.data(),
+                           biasW.data(), outWdims, inWdims, algoFilterWdims,
+                           NULL, kernelSizes, strides, pads);
+      break;
+    case ConvAlgorithm::Winograd:
+      libjit_conv_winograd_f(outW.data(), inW.data(), algoFilterW.data(),
+                             biasW.data(), outWdims, inWdims, algoFilterWdims,
+                             NULL, pads);
+      break;
+    }
   }
 
   virtual void teardown() override {}
@@ -116,14 +211,15 @@ private:
     std::mt19937 gen;
     std::uniform_real_distribution<> dis(-1.0, 1.0);
     for (size_t i = 0; i < size; i++) {
-        a[i] = dis(gen);
+      a[i] = dis(gen);
     }
   }
 };
 
 int main() {
   constexpr int reps = 10;
-  printf("inputBatch, inputEdgeSize, inputChannels, filterMultiplier, kernelSize, stride, pad, group, bestInSeconds\n");
+  printf("inputBatch, inputEdgeSize, inputChannels, filterMultiplier, "
+         "kernelSize, stride, pad, group, algorithm, bestInSeconds\n");
 
   for (size_t inputBatch : {1, 3}) {
     for (size_t inputEdgeSize : {7, 56, 224}) {
@@ -137,13 +233,27 @@ int main() {
               for (size_t group : {1, 112}) {
                 if (inputChannels % group != 0)
                   continue;
-                ConvBench b(inputBatch, inputEdgeSize, inputChannels,
-                            filterMultiplier, kernelSize, stride, pad, group);
-                auto times = bench(&b, reps);
-                double time = *(std::min_element(times.begin(), times.end()));
-                printf("%zu, %zu, %zu, %zu, %zu, %zu, %zu, %zu, %f\n",
-                       inputBatch, inputEdgeSize, inputChannels,
-                       filterMultiplier, kernelSize, stride, pad, group, time);
+                for (ConvAlgorithm algorithm :
+                     {ConvAlgorithm::Direct, ConvAlgorithm::Im2Col,
+                      ConvAlgorithm::Winograd}) {
+                  // The GEMM-based algorithms don't support groups, and
+                  // Winograd is only implemented for 3x3 stride 1.
+                  if (algorithm != ConvAlgorithm::Direct && group != 1)
+                    continue;
+                  if (algorithm == ConvAlgorithm::Winograd &&
+                      (kernelSize != 3 || stride != 1))
+                    continue;
+                  ConvBench b(inputBatch, inputEdgeSize, inputChannels,
+                              filterMultiplier, kernelSize, stride, pad, group,
+                              algorithm);
+                  auto times = bench(&b, reps);
+                  double time =
+                      *(std::min_element(times.begin(), times.end()));
+                  printf("%zu, %zu, %zu, %zu, %zu, %zu, %zu, %zu, %s, %f\n",
+                         inputBatch, inputEdgeSize, inputChannels,
+                         filterMultiplier, kernelSize, stride, pad, group,
+                         getAlgorithmName(algorithm), time);
+                } // algorithm
               }   // group
             }     // stride
           }       // kernelSize
@@ -0,0 +1,223 @@
+/**
+ * Copyright (c) Glow Contributors. See CONTRIBUTORS file.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Benchmarks every node kind which NodeGen can describe by its inputs and the
+// type of its result, see AutoGenNodeBenchmarks.def, on square tensors of a
+// sweep of sizes. All the inputs and the result have the same type, the
+// kinds for which this isn't valid or which the backend doesn't support are
+// reported as skipped. The bandwidth is counted from the bytes of the inputs
+// and of the result, and compared to the peak of the device if it is given.
+
+#include "Bench.h"
+
+#include "glow/Graph/Graph.h"
+#include "glow/Runtime/HostManager/HostManager.h"
+
+#include "llvm/Support/CommandLine.h"
+
+#include <cstdio>
+#include <utility>
+
+using namespace glow;
+
+namespace {
+llvm::cl::OptionCategory nodeBenchCat("Node Benchmark Options");
+
+llvm::cl::opt<std::string> backendOpt("backend",
+                                      llvm::cl::desc("Backend to benchmark"),
+                                      llvm::cl::init("CPU"),
+                                      llvm::cl::cat(nodeBenchCat));
+
+llvm::cl::list<unsigned>
+    sizesOpt("sizes",
+             llvm::cl::desc("Sizes N of the N x N tensors of the benchmarks"),
+             llvm::cl::CommaSeparated, llvm::cl::ZeroOrMore,
+             llvm::cl::cat(nodeBenchCat));
+
+llvm::cl::opt<std::string>
+    dtypeOpt("dtype", llvm::cl::desc("Float32 or Float16 tensors"),
+             llvm::cl::init("Float32"), llvm::cl::cat(nodeBenchCat));
+
+llvm::cl::opt<unsigned> repsOpt("reps",
+                                llvm::cl::desc("Timed runs of every benchmark"),
+                                llvm::cl::init(10),
+                                llvm::cl::cat(nodeBenchCat));
+
+llvm::cl::list<std::string>
+    kindsOpt("kinds",
+             llvm::cl::desc("Node kinds to benchmark, all of them if empty"),
+             llvm::cl::CommaSeparated, llvm::cl::ZeroOrMore,
+             llvm::cl::cat(nodeBenchCat));
+
+llvm::cl::opt<double>
+    peakGBpsOpt("peak-gbps",
+                llvm::cl::desc("Peak memory bandwidth of the device in GB/s"),
+                llvm::cl::init(0), llvm::cl::cat(nodeBenchCat));
+
+/// Creates the node of the benchmark in a Function from its inputs and the
+/// type of its result.
+using CreateNodeFn = Node *(*)(Function *, TypeRef, llvm::ArrayRef<NodeValue>);
+
+/// Creates a NodeTy with the result type \p ty.
+template <class NodeTy, size_t... I>
+Node *createNode(Function *F, TypeRef ty, llvm::ArrayRef<NodeValue> inputs,
+                 std::true_type, std::index_sequence<I...>) {
+  return F->addNode(new NodeTy("bench", ty, inputs[I]...));
+}
+
+/// Creates a NodeTy whose result type is computed from its inputs.
+template <class NodeTy, size_t... I>
+Node *createNode(Function *F, TypeRef, llvm::ArrayRef<NodeValue> inputs,
+                 std::false_type, std::index_sequence<I...>) {
+  return F->addNode(new NodeTy("bench", inputs[I]...));
+}
+
+template <class NodeTy, size_t NumInputs, bool HasResultType>
+Node *createNode(Function *F, TypeRef ty, llvm::ArrayRef<NodeValue> inputs) {
+  return createNode<NodeTy>(F, ty, inputs,
+                            std::integral_constant<bool, HasResultType>(),
+                            std::make_index_sequence<NumInputs>());
+}
+
+/// A node kind of AutoGenNodeBenchmarks.def.
+struct BenchmarkNodeKind {
+  const char *name;
+  size_t numInputs;
+  CreateNodeFn create;
+};
+
+const BenchmarkNodeKind benchmarkNodeKinds[] = {
+#define DEF_BENCHMARK_NODE(CLASS, NAME, NUM_INPUTS, HAS_RESULT_TYPE)           \
+  {#NAME, NUM_INPUTS, &createNode<CLASS, NUM_INPUTS, HAS_RESULT_TYPE>},
+#include "glow/AutoGenNodeBenchmarks.def"
+};
+
+/// The number of node kinds, including those which aren't benchmarked.
+constexpr size_t numNodeKinds = 0
+#define DEF_NODE(CLASS, NAME) +1
+#include "glow/AutoGenNodes.def"
+    ;
+
+/// Runs a node of \p kind on inputs and a result of shape N x N.
+class NodeBench : public Benchmark {
+  runtime::HostManager &hostManager_;
+  const BenchmarkNodeKind &kind_;
+  size_t n_;
+  ElemKind dtype_;
+  std::string networkName_;
+  PlaceholderBindings bindings_;
+
+public:
+  NodeBench(runtime::HostManager &hostManager, const BenchmarkNodeKind &kind,
+            size_t n, ElemKind dtype)
+      : hostManager_(hostManager), kind_(kind), n_(n), dtype_(dtype),
+        networkName_(std::string(kind.name) + "_" + std::to_string(n)) {}
+
+  /// Creates and adds the network of the benchmark. \returns an Error if
+  /// the node isn't valid for these shapes or isn't supported.
+  Error prepare() {
+    std::unique_ptr<Module> mod(new Module);
+    auto *F = mod->createFunction(networkName_);
+    auto *ty = mod->uniqueType(dtype_, {n_, n_});
+    std::vector<NodeValue> inputs;
+    for (size_t i = 0; i < kind_.numInputs; i++) {
+      inputs.push_back(mod->createPlaceholder(ty, "input" + std::to_string(i),
+                                              /* isTrainable */ false));
+    }
+    auto *node = kind_.create(F, ty, inputs);
+    F->createSave("save", node->getNthResult(0));
+    RETURN_ERR_IF_NOT(F->verify(), "Invalid for inputs of the result type");
+
+    bindings_.allocate(mod->getPlaceholders());
+    for (auto &PH : bindings_.pairs()) {
+      auto &T = *PH.second;
+      if (dtype_ == ElemKind::Float16Ty) {
+        T.getHandle<float16_t>().randomize(-1, 1, mod->getPRNG());
+      } else {
+        T.getHandle<float>().randomize(-1, 1, mod->getPRNG());
+      }
+    }
+    CompilationContext cctx;
+    return hostManager_.addNetwork(std::move(mod), cctx);
+  }
+
+  void setup() override {
+    // Warm up.
+    run();
+  }
+
+  void run() override {
+    EXIT_ON_ERR(hostManager_.runNetworkBlocking(networkName_, bindings_));
+  }
+
+  void teardown() override {
+    EXIT_ON_ERR(hostManager_.removeNetwork(networkName_));
+  }
+
+  /// The bytes of the inputs and of the result.
+  double gbytes() const {
+    size_t elementSize = Type(dtype_, {1}).getElementSize();
+    return (kind_.numInputs + 1) * n_ * n_ * elementSize / 1e9;
+  }
+};
+} // namespace
+
+int main(int argc, char **argv) {
+  llvm::cl::ParseCommandLineOptions(argc, argv, " Node benchmarks\n");
+  std::vector<unsigned> sizes(sizesOpt.begin(), sizesOpt.end());
+  if (sizes.empty()) {
+    sizes = {64, 256, 1024};
+  }
+  ElemKind dtype =
+      dtypeOpt == "Float16" ? ElemKind::Float16Ty : ElemKind::FloatTy;
+
+  std::vector<std::unique_ptr<runtime::DeviceConfig>> configs;
+  configs.push_back(llvm::make_unique<runtime::DeviceConfig>(backendOpt));
+  runtime::HostManager hostManager(std::move(configs));
+
+  size_t numBenchmarked = 0;
+  for (const auto &kind : benchmarkNodeKinds) {
+    if (!kindsOpt.empty() &&
+        std::find(kindsOpt.begin(), kindsOpt.end(), kind.name) ==
+            kindsOpt.end()) {
+      continue;
+    }
+    bool benchmarked = false;
+    for (auto n : sizes) {
+      NodeBench b(hostManager, kind, n, dtype);
+      if (auto err = b.prepare()) {
+        printf("BenchSkipped,NodeBench,%s,%s,%s,%u,%s\n", kind.name,
+               backendOpt.c_str(), dtypeOpt.c_str(), n,
+               ERR_TO_STRING(std::move(err)).c_str());
+        continue;
+      }
+      benchmarked = true;
+      auto times = bench(&b, repsOpt);
+      size_t mid = times.size() / 2;
+      std::nth_element(times.begin(), times.begin() + mid, times.end());
+      double median = times[mid];
+      double gbps = b.gbytes() / median;
+      printf("BenchResult,NodeBench,%s,%s,%s,%u,%2.6lf,%5.2lf,%3.1lf\n",
+             kind.name, backendOpt.c_str(), dtypeOpt.c_str(), n, median, gbps,
+             peakGBpsOpt > 0 ? 100 * gbps / peakGBpsOpt : 0.0);
+    }
+    numBenchmarked += benchmarked;
+  }
+  printf("BenchCoverage,NodeBench,%s,%zu,%zu,%zu\n", backendOpt.c_str(),
+         numBenchmarked, sizeof(benchmarkNodeKinds) / sizeof(BenchmarkNodeKind),
+         numNodeKinds);
+  return 0;
+}
@@ -24,6 +24,8 @@
 #include "CPUBackend.h"
 
 #include <future>
+#include <map>
+#include <thread>
 
 using namespace glow;
 using namespace glow::runtime;
@@ -61,6 +63,13 @@ using namespace glow::runtime;
 /// overrides.
 #define DECLARE_RUNTIME_BENCHMARK(name, moduleCreator, dagCreator)             \
   DECLARE_RUNTIME_COMPONENT_BENCHMARK(name, moduleCreator, HostManager)        \
+  DECLARE_RUNTIME_COMPONENT_BENCHMARK(name, moduleCreator,                     \
+                                      ConcurrentHostManager)                   \
+  DECLARE_RUNTIME_COMPONENT_BENCHMARK(name, moduleCreator,                     \
+                                      SaturatedHostManager)                    \
+  DECLARE_RUNTIME_COMPONENT_BENCHMARK(name, moduleCreator,                     \
+                                      MixedPriorityHostManager)                \
+  DECLARE_RUNTIME_COMPONENT_BENCHMARK(name, moduleCreator, StagesHostManager)  \
   DECLARE_EXECUTOR_BENCHMARK(name, moduleCreator, dagCreator)                  \
   DECLARE_RUNTIME_COMPONENT_BENCHMARK(name, moduleCreator, DeviceManager)
 
@@ -74,9 +83,29 @@ using namespace glow::runtime;
   BENCHMARK_REGISTER_F(name##component##Benchmark, component##backend)         \
       ->Unit(benchmark::kMicrosecond);
 
+/// Define a ConcurrentHostManagerBenchmark subclass (or a subclass of it)
+/// declared using DECLARE_RUNTIME_BENCHMARK for a specific backend and
+/// component, for 1 to 16 client threads.
+#define INSTANTIATE_CONCURRENT_COMPONENT_BENCHMARK(name, backend, component)   \
+  BENCHMARK_TEMPLATE_DEFINE_F(name##component##Benchmark, component##backend,  \
+                              backend)                                         \
+  (benchmark::State & state) { runBenchmark(state); }                          \
+  BENCHMARK_REGISTER_F(name##component##Benchmark, component##backend)         \
+      ->RangeMultiplier(2)                                                     \
+      ->Range(1, 16)                                                           \
+      ->UseRealTime()                                                          \
+      ->Unit(benchmark::kMicrosecond);
+
 /// Define RuntimeBenchmark subclasses for all runtime components.
 #define INSTANTIATE_RUNTIME_BENCHMARK(name, backend)                           \
   INSTANTIATE_RUNTIME_COMPONENT_BENCHMARK(name, backend, HostManager)          \
+  INSTANTIATE_CONCURRENT_COMPONENT_BENCHMARK(name, backend,                    \
+                                             ConcurrentHostManager)            \
+  INSTANTIATE_CONCURRENT_COMPONENT_BENCHMARK(name, backend,                    \
+                                             SaturatedHostManager)             \
+  INSTANTIATE_CONCURRENT_COMPONENT_BENCHMARK(name, backend,                    \
+                                             MixedPriorityHostManager)         \
+  INSTANTIATE_RUNTIME_COMPONENT_BENCHMARK(name, backend, StagesHostManager)    \
   INSTANTIATE_RUNTIME_COMPONENT_BENCHMARK(name, backend, Executor)             \
   INSTANTIATE_RUNTIME_COMPONENT_BENCHMARK(name, backend, DeviceManager)
 
@@ -296,7 +325,8 @@ protected:
     }
 
     // Create and initialize the HostManager instance.
-    hostManager_ = llvm::make_unique<HostManager>(std::move(configs));
+    hostManager_ =
+        llvm::make_unique<HostManager>(std::move(configs), hostConfig_);
 
     // Remember the names of all functions in the module before passing
     // ownership to the HostManager.
@@ -306,7 +336,8 @@ protected:
 
     // Add the module to the HostManager instance.
     CompilationContext cctx;
-    bool error = ERR_TO_BOOL(hostManager_->addNetwork(std::move(mod), cctx));
+    bool error = ERR_TO_BOOL(
+        hostManager_->addNetwork(std::move(mod), cctx, saturateHost_));
     if (error) {
       state.SkipWithError("Unable to set up host manager - failed to add "
                           "module!");
@@ -332,36 +363,235 @@ protected:
   }
 
   void runBenchmark(benchmark::State &state) override {
+    for (auto _ : state) {
+      runAllFunctions();
+    }
+  }
+
+  /// Run all functions in the module synchronously.
+  void runAllFunctions() {
     // Get references to the context stored in the parent class.
     // this->xxx() must be used since this is a template class (as is its
     // superclass).
     std::unique_ptr<ExecutionContext> &ctx = this->getExecutionContext();
-
-    for (auto _ : state) {
-      // Run all functions in the module synchronously.
-      for (const auto &function : functions_) {
-        std::promise<void> promise;
-        std::future<void> future = promise.get_future();
-        hostManager_->runNetwork(
-            function, std::move(ctx),
-            [&promise, &ctx](runtime::RunIdentifierTy /*runId*/, Error /*err*/,
-                             std::unique_ptr<ExecutionContext> result) {
-              ctx = std::move(result);
-              promise.set_value();
-            });
-        future.wait();
-      }
+    for (const auto &function : functions_) {
+      std::promise<void> promise;
+      std::future<void> future = promise.get_future();
+      hostManager_->runNetwork(
+          function, std::move(ctx),
+          [&promise, &ctx](runtime::RunIdentifierTy /*runId*/, Error /*err*/,
+                           std::unique_ptr<ExecutionContext> result) {
+            ctx = std::move(result);
+            promise.set_value();
+          });
+      future.wait();
     }
   }
 
   /// The HostManager instance being benchmarked.
   std::unique_ptr<HostManager> hostManager_;
+  /// The configuration of hostManager_.
+  HostConfig hostConfig_;
   /// The number of DeviceManagers to use during the benchmark.
-  static constexpr unsigned numDeviceManagers_{1};
+  unsigned numDeviceManagers_{1};
+  /// Whether the networks are replicated on all DeviceManagers.
+  bool saturateHost_{false};
   /// List of functions in the module.
   std::vector<std::string> functions_;
 };
 
+/// HostManagerBenchmark subclass that traces the runtime events of the runs
+/// and reports the average time spent in each of them per iteration, to
+/// break the overhead of the runtime down into its stages.
+template <typename BackendTy>
+class StagesHostManagerBenchmark : public HostManagerBenchmark<BackendTy> {
+protected:
+  void setUpExecutionContext(benchmark::State &state) override {
+    RuntimeBenchmark<BackendTy>::setUpExecutionContext(state);
+    std::unique_ptr<ExecutionContext> &ctx = this->getExecutionContext();
+    if (ctx) {
+      ctx->setTraceContext(
+          llvm::make_unique<TraceContext>(TraceLevel::RUNTIME));
+    }
+  }
+
+  void runBenchmark(benchmark::State &state) override {
+    std::unique_ptr<ExecutionContext> &ctx = this->getExecutionContext();
+    // Total duration of the events of each name, in microseconds.
+    std::map<std::string, uint64_t> stageTimes;
+    for (auto _ : state) {
+      this->runAllFunctions();
+      state.PauseTiming();
+      auto &events = ctx->getTraceContext()->getTraceEvents();
+      for (const auto &event : events) {
+        if (event.type == TraceEvent::CompleteType) {
+          stageTimes[event.name] += event.duration;
+        }
+      }
+      events.clear();
+      state.ResumeTiming();
+    }
+    for (const auto &stage : stageTimes) {
+      state.counters[stage.first] = benchmark::Counter(
+          double(stage.second) / std::max<size_t>(state.iterations(), 1));
+    }
+  }
+};
+
+/// HostManagerBenchmark subclass that runs the functions of the module from
+/// state.range(0) client threads at once, each with numRequests_ requests in
+/// flight, to measure how runNetwork scales with the number of threads that
+/// call it.
+template <typename BackendTy>
+class ConcurrentHostManagerBenchmark : public HostManagerBenchmark<BackendTy> {
+protected:
+  void setUpExecutionContext(benchmark::State &state) override {
+    RuntimeBenchmark<BackendTy>::setUpExecutionContext(state);
+    std::unique_ptr<ExecutionContext> &ctx = this->getExecutionContext();
+    if (!ctx) {
+      return;
+    }
+    for (unsigned p = 0; p < numPriorities_; p++) {
+      latencies_[p] = 0;
+      numLatencies_[p] = 0;
+    }
+    contexts_.resize(state.range(0));
+    for (auto &threadContexts : contexts_) {
+      for (unsigned i = 0; i < numRequests_; ++i) {
+        threadContexts.emplace_back(llvm::make_unique<ExecutionContext>(
+            llvm::make_unique<PlaceholderBindings>(
+                ctx->getPlaceholderBindings()->clone())));
+      }
+    }
+  }
+
+  void tearDownExecutionContext(benchmark::State &state) override {
+    contexts_.clear();
+  }
+
+  void setUpHostManager(benchmark::State &state) override {
+    // Never refuse a request, and by default never queue one either, so that
+    // only the overhead of the HostManager limits the throughput.
+    this->hostConfig_.maxActiveRequests =
+        state.range(0) * activeRequestsPerThread_;
+    this->hostConfig_.maxQueueSize = state.range(0) * numRequests_;
+    HostManagerBenchmark<BackendTy>::setUpHostManager(state);
+  }
+
+  void runBenchmark(benchmark::State &state) override {
+    for (auto _ : state) {
+      std::vector<std::thread> threads;
+      for (auto &threadContexts : contexts_) {
+        threads.emplace_back([this, &threadContexts]() {
+          runRequests(threadContexts);
+        });
+      }
+      for (auto &thread : threads) {
+        thread.join();
+      }
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0) *
+                            numRequests_ * this->functions_.size());
+  }
+
+  /// Run every function with all of \p contexts at once, and wait for the
+  /// runs to finish.
+  void runRequests(std::vector<std::unique_ptr<ExecutionContext>> &contexts) {
+    for (const auto &function : this->functions_) {
+      std::atomic<unsigned> pending{unsigned(contexts.size())};
+      std::promise<void> promise;
+      std::future<void> future = promise.get_future();
+      for (size_t i = 0, e = contexts.size(); i < e; i++) {
+        auto &ctx = contexts[i];
+        uint64_t priority = getPriority(i);
+        uint64_t start = TraceEvent::now();
+        this->hostManager_->runNetwork(
+            function, std::move(ctx),
+            [this, &ctx, &pending, &promise, priority,
+             start](runtime::RunIdentifierTy /*runId*/, Error err,
+                    std::unique_ptr<ExecutionContext> result) {
+              ERR_TO_VOID(std::move(err));
+              latencies_[priority] += TraceEvent::now() - start;
+              numLatencies_[priority]++;
+              ctx = std::move(result);
+              if (--pending == 0) {
+                promise.set_value();
+              }
+            },
+            priority);
+      }
+      future.wait();
+    }
+  }
+
+  /// \returns the priority of the request \p request of a thread, lower
+  /// being more urgent, less than numPriorities_.
+  virtual uint64_t getPriority(size_t request) const { return 0; }
+
+  /// Report the average latency of the requests of every priority.
+  void reportLatencies(benchmark::State &state) {
+    for (unsigned p = 0; p < numPriorities_; p++) {
+      if (numLatencies_[p]) {
+        state.counters["latency_us_priority" + std::to_string(p)] =
+            benchmark::Counter(double(latencies_[p]) / numLatencies_[p]);
+      }
+    }
+  }
+
+  /// The number of requests every thread has in flight.
+  static constexpr unsigned numRequests_{16};
+  /// The number of requests of every thread run at once, the others being
+  /// queued by the HostManager.
+  unsigned activeRequestsPerThread_{numRequests_};
+  /// The contexts of the requests of every thread.
+  std::vector<std::vector<std::unique_ptr<ExecutionContext>>> contexts_;
+  /// The number of priorities getPriority() may return.
+  static constexpr unsigned numPriorities_{2};
+  /// The total latency in microseconds and the number of the requests of
+  /// every priority.
+  std::atomic<uint64_t> latencies_[numPriorities_]{};
+  std::atomic<uint64_t> numLatencies_[numPriorities_]{};
+};
+
+/// ConcurrentHostManagerBenchmark subclass that replicates the networks on
+/// several DeviceManagers, so that the requests are spread among them.
+template <typename BackendTy>
+class SaturatedHostManagerBenchmark
+    : public ConcurrentHostManagerBenchmark<BackendTy> {
+protected:
+  void setUpHostManager(benchmark::State &state) override {
+    this->numDeviceManagers_ = numReplicas_;
+    this->saturateHost_ = true;
+    ConcurrentHostManagerBenchmark<BackendTy>::setUpHostManager(state);
+  }
+
+  /// The number of DeviceManagers the networks are replicated on.
+  static constexpr unsigned numReplicas_{4};
+};
+
+/// ConcurrentHostManagerBenchmark subclass whose threads alternate between
+/// requests of high and low priority, and that reports the average latency
+/// of each.
+template <typename BackendTy>
+class MixedPriorityHostManagerBenchmark
+    : public ConcurrentHostManagerBenchmark<BackendTy> {
+protected:
+  void setUpHostManager(benchmark::State &state) override {
+    // Queue requests, so that their priorities decide which run first.
+    this->activeRequestsPerThread_ = 1;
+    ConcurrentHostManagerBenchmark<BackendTy>::setUpHostManager(state);
+  }
+
+  uint64_t getPriority(size_t request) const override {
+    return request % this->numPriorities_;
+  }
+
+  void runBenchmark(benchmark::State &state) override {
+    ConcurrentHostManagerBenchmark<BackendTy>::runBenchmark(state);
+    this->reportLatencies(state);
+  }
+};
+
 /// RuntimeBenchmark subclass that benchmarks at the Executor level (i.e.
 /// Executor + DeviceManager).
 template <typename BackendTy>
@@ -586,6 +816,132 @@ std::unique_ptr<DAG> createSingleNodeDAG(
 }
 //--------------------------------------------------------------------------//
 
+//----------------------------- Multi Node ---------------------------------//
+/// Create a module of three functions forming a small partitioned network:
+/// "multiNodeA" computes an FC whose result is used by the FCs of
+/// "multiNodeB" and "multiNodeC".
+std::unique_ptr<Module> createMultiNodeModule() {
+  auto mod = llvm::make_unique<Module>();
+  PlaceholderBindings bindings;
+
+  auto *input =
+      mod->createPlaceholder(ElemKind::FloatTy, {16, 32}, "input", false);
+  auto *intermediate = mod->createPlaceholder(ElemKind::FloatTy, {16, 32},
+                                              "intermediate", false);
+  auto *outputB =
+      mod->createPlaceholder(ElemKind::FloatTy, {16, 32}, "outputB", false);
+  auto *outputC =
+      mod->createPlaceholder(ElemKind::FloatTy, {16, 32}, "outputC", false);
+
+  auto createFCFunction = [&](llvm::StringRef name, Placeholder *in,
+                              Placeholder *out) {
+    auto *fn = mod->createFunction(name);
+    auto *weights = mod->createPlaceholder(ElemKind::FloatTy, {32, 32},
+                                           name.str() + "_weights", false);
+    auto *bias = mod->createPlaceholder(ElemKind::FloatTy, {32},
+                                        name.str() + "_bias", false);
+    auto *fc = fn->createFullyConnected("fc", in, weights, bias);
+    fn->createSave("save", fc, out);
+    bindings.allocate(weights)->getHandle().clear(0);
+    bindings.allocate(bias)->getHandle().clear(32);
+    glow::convertPlaceholdersToConstants(fn, bindings, {in, out});
+  };
+  createFCFunction("multiNodeA", input, intermediate);
+  createFCFunction("multiNodeB", intermediate, outputB);
+  createFCFunction("multiNodeC", intermediate, outputC);
+
+  return mod;
+}
+
+/// Create an Executor DAG for the functions of createMultiNodeModule, in
+/// which the nodes of "multiNodeB" and "multiNodeC" both depend on the node
+/// of "multiNodeA" and run in parallel.
+std::unique_ptr<DAG> createMultiNodeDAG(
+    std::unordered_map<std::string, std::unique_ptr<CompiledFunction>>
+        &compiledFunctions) {
+  auto root = llvm::make_unique<DAGNode>();
+  std::vector<std::unique_ptr<DAGNode>> nodes;
+  for (const char *name : {"multiNodeA", "multiNodeB", "multiNodeC"}) {
+    auto node = llvm::make_unique<DAGNode>();
+    node->deviceIDs = {0};
+    node->name = name;
+    node->runtimeBundle = llvm::make_unique<RuntimeBundle>(
+        compiledFunctions[name]->getRuntimeBundle());
+    nodes.emplace_back(std::move(node));
+  }
+
+  root->children.emplace_back(nodes[0].get());
+  nodes[0]->parents.emplace_back(root.get());
+  for (size_t i = 1; i < nodes.size(); i++) {
+    nodes[0]->children.emplace_back(nodes[i].get());
+    nodes[i]->parents.emplace_back(nodes[0].get());
+  }
+
+  auto dag = llvm::make_unique<DAG>();
+  dag->root = std::move(root);
+  dag->nodes = std::move(nodes);
+
+  return dag;
+}
+//--------------------------------------------------------------------------//
+
+//------------------------- Many Small Networks ----------------------------//
+/// The number of functions of createManySmallNetworksModule.
+constexpr unsigned numSmallNetworks = 32;
+
+/// Create a module of numSmallNetworks independent functions, each a tiny FC,
+/// so that the runtime overhead dominates their runs.
+std::unique_ptr<Module> createManySmallNetworksModule() {
+  auto mod = llvm::make_unique<Module>();
+  PlaceholderBindings bindings;
+
+  for (unsigned i = 0; i < numSmallNetworks; i++) {
+    std::string name = "smallNetwork" + std::to_string(i);
+    auto *fn = mod->createFunction(name);
+    auto *input = mod->createPlaceholder(ElemKind::FloatTy, {1, 8},
+                                         name + "_input", false);
+    auto *weights = mod->createPlaceholder(ElemKind::FloatTy, {8, 8},
+                                           name + "_weights", false);
+    auto *bias =
+        mod->createPlaceholder(ElemKind::FloatTy, {8}, name + "_bias", false);
+    auto *output = mod->createPlaceholder(ElemKind::FloatTy, {1, 8},
+                                          name + "_output", false);
+    auto *fc = fn->createFullyConnected("fc", input, weights, bias);
+    fn->createSave("save", fc, output);
+    bindings.allocate(weights)->getHandle().clear(0);
+    bindings.allocate(bias)->getHandle().clear(8);
+    glow::convertPlaceholdersToConstants(fn, bindings, {input, output});
+  }
+
+  return mod;
+}
+
+/// Create an Executor DAG in which the nodes of all the functions of
+/// createManySmallNetworksModule are children of the root.
+std::unique_ptr<DAG> createManySmallNetworksDAG(
+    std::unordered_map<std::string, std::unique_ptr<CompiledFunction>>
+        &compiledFunctions) {
+  auto root = llvm::make_unique<DAGNode>();
+  std::vector<std::unique_ptr<DAGNode>> nodes;
+  for (unsigned i = 0; i < numSmallNetworks; i++) {
+    auto node = llvm::make_unique<DAGNode>();
+    node->deviceIDs = {0};
+    node->name = "smallNetwork" + std::to_string(i);
+    node->runtimeBundle = llvm::make_unique<RuntimeBundle>(
+        compiledFunctions[node->name]->getRuntimeBundle());
+    node->parents.emplace_back(root.get());
+    root->children.emplace_back(node.get());
+    nodes.emplace_back(std::move(node));
+  }
+
+  auto dag = llvm::make_unique<DAG>();
+  dag->root = std::move(root);
+  dag->nodes = std::move(nodes);
+
+  return dag;
+}
+//--------------------------------------------------------------------------//
+
 //===--------------------------------------------------------------------===//
 //              Benchmark Declarations and Instantiations                   //
 //===--------------------------------------------------------------------===//
@@ -603,6 +959,17 @@ DECLARE_RUNTIME_BENCHMARK(SingleNode, createSingleNodeModule,
 // backend.
 INSTANTIATE_RUNTIME_BENCHMARK(SingleNode, CPUBackend);
 
+// Declare and instantiate the MultiNode benchmark, whose Executor DAG has a
+// node feeding two nodes that run in parallel.
+DECLARE_RUNTIME_BENCHMARK(MultiNode, createMultiNodeModule, createMultiNodeDAG);
+INSTANTIATE_RUNTIME_BENCHMARK(MultiNode, CPUBackend);
+
+// Declare and instantiate the ManySmallNetworks benchmark, which runs many
+// tiny networks resident on the same device.
+DECLARE_RUNTIME_BENCHMARK(ManySmallNetworks, createManySmallNetworksModule,
+                          createManySmallNetworksDAG);
+INSTANTIATE_RUNTIME_BENCHMARK(ManySmallNetworks, CPUBackend);
+
 //===--------------------------------------------------------------------===//
 //                           Benchmark Main                                 //
 //===--------------------------------------------------------------------===//
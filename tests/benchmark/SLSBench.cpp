@@ -23,13 +23,15 @@
 
 #include "glow/ExecutionEngine/ExecutionEngine.h"
 #include "glow/Optimizer/GraphOptimizer/GraphOptimizer.h"
+#include "glow/Quantization/Base/Base.h"
 
 using namespace glow;
 
 /*
  * This class implements an SLS benchmark. There are a number of
  * parallel FusedRowwiseQuantizedSparseLengthsWeightedSum nodes
- * which are created.
+ * which are created. The embedding tables use UInt8FusedQTy, or
+ * UInt8FusedFP16QTy when fp16 scales and offsets are requested.
  */
 class SLSBench : public Benchmark {
   /// Dimensions expressed in libjit's format.
@@ -44,12 +46,15 @@ class SLSBench : public Benchmark {
   const char *backendStr_;
   ElemKind dtype_;
   size_t elementSize_;
+  bool fp16ScaleOffset_;
+  size_t scaleOffsetSize_;
 
 public:
   SLSBench(size_t batchSize_, size_t numIndicesPerBatch_,
            size_t numTableEntries_, size_t numElementsPerRow_,
            size_t asyncLaunchSize_, size_t numSLSNodes_,
-           const char *backendStr_, const char *dtypeStr_)
+           const char *backendStr_, const char *dtypeStr_,
+           const char *fusedDtypeStr_)
       : batchSize_(batchSize_), numIndicesPerBatch_(numIndicesPerBatch_),
         numTableEntries_(numTableEntries_),
         numElementsPerRow_(numElementsPerRow_),
@@ -65,6 +70,11 @@ public:
       dtype_ = ElemKind::FloatTy;
       elementSize_ = 4;
     }
+
+    // Float16 results always come with fp16 scales and offsets.
+    fp16ScaleOffset_ = dtype_ == ElemKind::Float16Ty ||
+                       std::string(fusedDtypeStr_) == "UInt8FusedFP16";
+    scaleOffsetSize_ = fp16ScaleOffset_ ? sizeof(float16_t) : sizeof(float);
   }
 
   void setup() override {
@@ -133,9 +143,22 @@ public:
         }
       }
 
-      auto *R = fn->createFusedRowwiseQuantizedSparseLengthsWeightedSum(
-          "RQSLWS_" + std::to_string(slsNodeId), data, weights[slsNodeId],
-          indices[slsNodeId], lengths[slsNodeId], dtype_, false);
+      FusedRowwiseQuantizedSparseLengthsWeightedSumNode *R;
+      if (fp16ScaleOffset_ && dtype_ == ElemKind::FloatTy) {
+        Constant *rwqData = mod->createConstant(
+            ElemKind::UInt8FusedFP16QTy,
+            {numTableEntries_, numElementsPerRow_ + 2 * sizeof(float16_t)},
+            0.0, 0, "data_" + std::to_string(slsNodeId));
+        quantization::tensorFusedRowwiseQuantization<float16_t>(
+            data, rwqData->getPayloadMutable());
+        R = fn->createFusedRowwiseQuantizedSparseLengthsWeightedSum(
+            "RQSLWS_" + std::to_string(slsNodeId), rwqData, weights[slsNodeId],
+            indices[slsNodeId], lengths[slsNodeId], dtype_, false);
+      } else {
+        R = fn->createFusedRowwiseQuantizedSparseLengthsWeightedSum(
+            "RQSLWS_" + std::to_string(slsNodeId), data, weights[slsNodeId],
+            indices[slsNodeId], lengths[slsNodeId], dtype_, false);
+      }
 
       S[slsNodeId] = fn->createSave("save_" + std::to_string(slsNodeId), R);
 
@@ -186,7 +209,7 @@ public:
 
     // Embedding data
     double input_gbytes = (numSLSNodes_ * batchSize_ * numIndicesPerBatch_ *
-                           (numElementsPerRow_ + 2 * elementSize_)) /
+                           (numElementsPerRow_ + 2 * scaleOffsetSize_)) /
                           1e9;
     // + indices
     input_gbytes +=
@@ -208,7 +231,7 @@ public:
 };
 
 int main(int argc, char *argv[]) {
-  assert(argc == 10);
+  assert(argc == 10 || argc == 11);
   size_t batchSize = atoi(argv[1]);
   size_t numIndicesPerBatch = atoi(argv[2]);
   size_t numTableEntries = atoi(argv[3]);
@@ -218,16 +241,21 @@ int main(int argc, char *argv[]) {
   size_t numSLSNodes = atoi(argv[7]);
   const char *backendStr = argv[8];
   const char *dtypeStr = argv[9];
+  // Either "UInt8Fused" or "UInt8FusedFP16".
+  const char *fusedDtypeStr = argc == 11 ? argv[10] : "UInt8Fused";
   assert(numReps > 0);
 
   SLSBench b(batchSize, numIndicesPerBatch, numTableEntries, numElementsPerRow,
-             numAsyncLaunches, numSLSNodes, backendStr, dtypeStr);
+             numAsyncLaunches, numSLSNodes, backendStr, dtypeStr,
+             fusedDtypeStr);
   auto times = bench(&b, numReps);
   for (auto t : times) {
-    printf("BenchResult,SLSBench,SW,%zu,%zu,%zu,%zu,%zu,%zu,%zu,%s,%s,%f,%f\n",
-           batchSize, numIndicesPerBatch, numTableEntries, numElementsPerRow,
-           numReps, numAsyncLaunches, numSLSNodes, backendStr, dtypeStr,
-           t / numAsyncLaunches, b.gbytes() * numAsyncLaunches / t);
+    printf(
+        "BenchResult,SLSBench,SW,%zu,%zu,%zu,%zu,%zu,%zu,%zu,%s,%s,%s,%f,%f\n",
+        batchSize, numIndicesPerBatch, numTableEntries, numElementsPerRow,
+        numReps, numAsyncLaunches, numSLSNodes, backendStr, dtypeStr,
+        fusedDtypeStr, t / numAsyncLaunches,
+        b.gbytes() * numAsyncLaunches / t);
   }
   double min = *(std::min_element(times.begin(), times.end()));
   size_t midElt = times.size() / 2;
@@ -235,10 +263,10 @@ int main(int argc, char *argv[]) {
   double median = times[midElt];
   double median_runtime = median / ((double)numAsyncLaunches);
   double min_runtime = min / ((double)numAsyncLaunches);
-  printf("BenchSummary,SLSBench,SW,%zu,%zu,%zu,%zu,%zu,%zu,%zu,%s,%s,%f,%f,%f,%"
-         "f\n",
+  printf("BenchSummary,SLSBench,SW,%zu,%zu,%zu,%zu,%zu,%zu,%zu,%s,%s,%s,%f,%f,%"
+         "f,%f\n",
          batchSize, numIndicesPerBatch, numTableEntries, numElementsPerRow,
          numReps, numAsyncLaunches, numSLSNodes, backendStr, dtypeStr,
-         median_runtime, min_runtime, b.gbytes() / median_runtime,
-         b.gbytes() / min_runtime);
+         fusedDtypeStr, median_runtime, min_runtime,
+         b.gbytes() / median_runtime, b.gbytes() / min_runtime);
 }
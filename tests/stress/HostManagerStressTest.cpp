@@ -0,0 +1,371 @@
+/**
+ * Copyright (c) Glow Contributors. See CONTRIBUTORS file.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Loads many networks into one HostManager across several devices and runs
+// them with Poisson traffic from many client threads, while a churn thread
+// removes and adds networks. Throughput, latency percentiles, the time spent
+// in runNetwork, addNetwork and removeNetwork, which grows with the
+// contention on the locks of the HostManager, and the resident memory are
+// reported at every interval.
+
+#include "glow/Graph/Graph.h"
+#include "glow/Runtime/HostManager/HostManager.h"
+
+#include "llvm/Support/CommandLine.h"
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+using namespace glow;
+using namespace glow::runtime;
+
+namespace {
+llvm::cl::OptionCategory stressCat("HostManager Stress Options");
+
+llvm::cl::opt<std::string> backendOpt("backend",
+                                      llvm::cl::desc("Backend of the devices"),
+                                      llvm::cl::init("Interpreter"),
+                                      llvm::cl::cat(stressCat));
+
+llvm::cl::opt<unsigned> numDevicesOpt("num-devices",
+                                      llvm::cl::desc("Number of devices"),
+                                      llvm::cl::init(4),
+                                      llvm::cl::cat(stressCat));
+
+llvm::cl::opt<unsigned> numNetworksOpt("num-networks",
+                                       llvm::cl::desc("Number of networks"),
+                                       llvm::cl::init(200),
+                                       llvm::cl::cat(stressCat));
+
+llvm::cl::opt<unsigned>
+    numClientsOpt("num-clients", llvm::cl::desc("Number of client threads"),
+                  llvm::cl::init(16), llvm::cl::cat(stressCat));
+
+llvm::cl::opt<double>
+    rateOpt("rate",
+            llvm::cl::desc("Mean requests per second of every client, whose "
+                           "requests arrive as a Poisson process"),
+            llvm::cl::init(200), llvm::cl::cat(stressCat));
+
+llvm::cl::opt<unsigned> durationOpt("duration",
+                                    llvm::cl::desc("Seconds of traffic"),
+                                    llvm::cl::init(30),
+                                    llvm::cl::cat(stressCat));
+
+llvm::cl::opt<unsigned> churnIntervalOpt(
+    "churn-interval",
+    llvm::cl::desc("Milliseconds between the removals and additions of a "
+                   "random network, 0 disables the churn"),
+    llvm::cl::init(100), llvm::cl::cat(stressCat));
+
+llvm::cl::opt<unsigned>
+    reportIntervalOpt("report-interval",
+                      llvm::cl::desc("Seconds between the reports"),
+                      llvm::cl::init(5), llvm::cl::cat(stressCat));
+
+llvm::cl::opt<unsigned> maxActiveRequestsOpt(
+    "max-active-requests",
+    llvm::cl::desc("HostConfig::maxActiveRequests of the HostManager"),
+    llvm::cl::init(64), llvm::cl::cat(stressCat));
+
+llvm::cl::opt<unsigned> maxQueueSizeOpt(
+    "max-queue-size",
+    llvm::cl::desc("HostConfig::maxQueueSize of the HostManager"),
+    llvm::cl::init(1000), llvm::cl::cat(stressCat));
+
+using Clock = std::chrono::steady_clock;
+
+/// \returns the name of the network \p index.
+std::string getNetworkName(unsigned index) {
+  return "net_" + std::to_string(index);
+}
+
+/// \returns a module with the network \p name, a stack of FullyConnected and
+/// Relu nodes of a width and depth drawn from \p gen.
+std::unique_ptr<Module> createNetwork(const std::string &name,
+                                      std::mt19937 &gen) {
+  static const size_t widths[] = {32, 64, 128};
+  size_t width = widths[gen() % 3];
+  unsigned numLayers = 1 + gen() % 4;
+
+  std::unique_ptr<Module> mod(new Module);
+  auto *F = mod->createFunction(name);
+  auto *input = mod->createPlaceholder(ElemKind::FloatTy, {4, width}, "input",
+                                       /* isTrainable */ false);
+  NodeValue cur = input;
+  for (unsigned i = 0; i < numLayers; i++) {
+    auto *W = mod->createConstant(ElemKind::FloatTy, {width, width}, "weights");
+    auto *B = mod->createConstant(ElemKind::FloatTy, {width}, "bias");
+    W->getPayloadMutable().getHandle().randomize(-1, 1, mod->getPRNG());
+    B->getPayloadMutable().getHandle().randomize(-1, 1, mod->getPRNG());
+    cur = F->createFullyConnected("fc", cur, W, B);
+    cur = F->createRELU("relu", cur);
+  }
+  F->createSave("save", cur);
+  return mod;
+}
+
+/// \returns the resident memory of the process in MB, or 0 where it isn't
+/// known.
+double getResidentMB() {
+#ifdef __linux__
+  FILE *statm = fopen("/proc/self/statm", "r");
+  if (!statm) {
+    return 0;
+  }
+  long pages = 0;
+  long resident = 0;
+  int read = fscanf(statm, "%ld %ld", &pages, &resident);
+  fclose(statm);
+  if (read != 2) {
+    return 0;
+  }
+  return double(resident) * sysconf(_SC_PAGESIZE) / (1 << 20);
+#else
+  return 0;
+#endif
+}
+
+/// \returns the percentile \p p of the sorted \p values, or 0 if empty.
+double getPercentile(const std::vector<double> &values, double p) {
+  if (values.empty()) {
+    return 0;
+  }
+  size_t index = std::min(values.size() - 1, size_t(p * values.size()));
+  return values[index];
+}
+
+/// The measurements of a report interval.
+struct IntervalStats {
+  /// The latencies of the completed runs, in ms.
+  std::vector<double> latencies;
+  /// The time spent in the calls to runNetwork, in us.
+  std::vector<double> submitTimes;
+  /// The time spent in the calls to addNetwork and removeNetwork, in ms.
+  std::vector<double> addTimes;
+  std::vector<double> removeTimes;
+  /// The runs which returned an Error, mostly because their network was
+  /// removed by the churn or the queue was full.
+  uint64_t numFailed{0};
+  /// The removals refused because the network had runs in flight.
+  uint64_t numBusyRemovals{0};
+};
+
+/// Collects the measurements of the threads, for the reports.
+class StressStats {
+  std::mutex mutex_;
+  IntervalStats stats_;
+
+public:
+  void addSubmit(double us) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.submitTimes.push_back(us);
+  }
+
+  void addRun(double ms, bool failed) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (failed) {
+      stats_.numFailed++;
+    } else {
+      stats_.latencies.push_back(ms);
+    }
+  }
+
+  void addChurn(double removeMs, double addMs, bool busy) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (busy) {
+      stats_.numBusyRemovals++;
+      return;
+    }
+    stats_.removeTimes.push_back(removeMs);
+    stats_.addTimes.push_back(addMs);
+  }
+
+  /// \returns the measurements since the last call, and starts new ones.
+  IntervalStats take() {
+    IntervalStats stats;
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::swap(stats, stats_);
+    return stats;
+  }
+};
+
+/// Prints the report of \p stats measured over \p seconds, at \p elapsed
+/// seconds.
+void report(IntervalStats stats, double seconds, double elapsed) {
+  for (auto *values : {&stats.latencies, &stats.submitTimes, &stats.addTimes,
+                       &stats.removeTimes}) {
+    std::sort(values->begin(), values->end());
+  }
+  printf("StressReport,%.1lf,throughput,%.1lf,failed,%llu,latency_ms,p50,%.3lf,"
+         "p90,%.3lf,p99,%.3lf,max,%.3lf,submit_us,p50,%.1lf,p99,%.1lf,"
+         "add_ms,p50,%.2lf,max,%.2lf,remove_ms,p50,%.2lf,max,%.2lf,"
+         "busy_removals,%llu,rss_mb,%.1lf\n",
+         elapsed, stats.latencies.size() / seconds,
+         (unsigned long long)stats.numFailed,
+         getPercentile(stats.latencies, 0.5),
+         getPercentile(stats.latencies, 0.9),
+         getPercentile(stats.latencies, 0.99),
+         getPercentile(stats.latencies, 1),
+         getPercentile(stats.submitTimes, 0.5),
+         getPercentile(stats.submitTimes, 0.99),
+         getPercentile(stats.addTimes, 0.5), getPercentile(stats.addTimes, 1),
+         getPercentile(stats.removeTimes, 0.5),
+         getPercentile(stats.removeTimes, 1),
+         (unsigned long long)stats.numBusyRemovals, getResidentMB());
+  fflush(stdout);
+}
+
+/// Sends requests for random networks of \p hostManager as a Poisson process
+/// until \p stop is set, counting the runs in flight in \p inflight.
+void runClient(HostManager &hostManager, StressStats &stats,
+               std::atomic<bool> &stop, std::atomic<uint64_t> &inflight,
+               unsigned seed) {
+  std::mt19937 gen(seed);
+  std::exponential_distribution<double> interArrival(rateOpt);
+  std::uniform_int_distribution<unsigned> network(0, numNetworksOpt - 1);
+  auto next = Clock::now();
+  while (!stop) {
+    next += std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(interArrival(gen)));
+    std::this_thread::sleep_until(next);
+
+    auto name = getNetworkName(network(gen));
+    auto modOrErr = hostManager.getNetworkModule(name);
+    if (!modOrErr) {
+      // Removed by the churn.
+      ERR_TO_VOID(modOrErr.takeError());
+      stats.addRun(0, /* failed */ true);
+      continue;
+    }
+    std::shared_ptr<Module> mod = std::move(*modOrErr);
+    auto context = llvm::make_unique<ExecutionContext>();
+    context->getPlaceholderBindings()->allocate(mod->getPlaceholders());
+
+    inflight++;
+    auto start = Clock::now();
+    hostManager.runNetwork(
+        name, std::move(context),
+        [&stats, &inflight, mod, start](RunIdentifierTy, Error err,
+                                        std::unique_ptr<ExecutionContext>) {
+          std::chrono::duration<double, std::milli> latency =
+              Clock::now() - start;
+          stats.addRun(latency.count(), ERR_TO_BOOL(std::move(err)));
+          inflight--;
+        });
+    std::chrono::duration<double, std::micro> submit = Clock::now() - start;
+    stats.addSubmit(submit.count());
+  }
+}
+
+/// Removes and adds again a random network of \p hostManager every
+/// churnIntervalOpt until \p stop is set.
+void runChurn(HostManager &hostManager, StressStats &stats,
+              std::atomic<bool> &stop) {
+  std::mt19937 gen(numClientsOpt);
+  std::uniform_int_distribution<unsigned> network(0, numNetworksOpt - 1);
+  while (!stop) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(churnIntervalOpt));
+    auto name = getNetworkName(network(gen));
+    auto start = Clock::now();
+    if (ERR_TO_BOOL(hostManager.removeNetwork(name))) {
+      stats.addChurn(0, 0, /* busy */ true);
+      continue;
+    }
+    std::chrono::duration<double, std::milli> removeTime = Clock::now() - start;
+    auto mod = createNetwork(name, gen);
+    CompilationContext cctx;
+    start = Clock::now();
+    EXIT_ON_ERR(hostManager.addNetwork(std::move(mod), cctx));
+    std::chrono::duration<double, std::milli> addTime = Clock::now() - start;
+    stats.addChurn(removeTime.count(), addTime.count(), /* busy */ false);
+  }
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  llvm::cl::ParseCommandLineOptions(argc, argv,
+                                    " HostManager stress benchmark\n");
+
+  HostConfig hostConfig;
+  hostConfig.maxActiveRequests = maxActiveRequestsOpt;
+  hostConfig.maxQueueSize = maxQueueSizeOpt;
+  HostManager hostManager(generateDeviceConfigs(numDevicesOpt, backendOpt),
+                          hostConfig);
+
+  double startMB = getResidentMB();
+  auto loadStart = Clock::now();
+  std::mt19937 gen(0);
+  for (unsigned i = 0; i < numNetworksOpt; i++) {
+    CompilationContext cctx;
+    EXIT_ON_ERR(
+        hostManager.addNetwork(createNetwork(getNetworkName(i), gen), cctx));
+  }
+  std::chrono::duration<double> loadTime = Clock::now() - loadStart;
+  double loadedMB = getResidentMB();
+  printf("StressLoad,networks,%u,devices,%u,seconds,%.2lf,rss_mb,%.1lf,%.1lf\n",
+         unsigned(numNetworksOpt), unsigned(numDevicesOpt), loadTime.count(),
+         startMB, loadedMB);
+
+  StressStats stats;
+  std::atomic<bool> stop{false};
+  std::atomic<uint64_t> inflight{0};
+  std::vector<std::thread> threads;
+  for (unsigned i = 0; i < numClientsOpt; i++) {
+    threads.emplace_back(runClient, std::ref(hostManager), std::ref(stats),
+                         std::ref(stop), std::ref(inflight), i);
+  }
+  if (churnIntervalOpt) {
+    threads.emplace_back(runChurn, std::ref(hostManager), std::ref(stats),
+                         std::ref(stop));
+  }
+
+  auto start = Clock::now();
+  auto lastReport = start;
+  auto end = start + std::chrono::seconds(durationOpt);
+  while (Clock::now() < end) {
+    std::this_thread::sleep_until(
+        std::min(end, lastReport + std::chrono::seconds(reportIntervalOpt)));
+    auto now = Clock::now();
+    std::chrono::duration<double> interval = now - lastReport;
+    std::chrono::duration<double> elapsed = now - start;
+    report(stats.take(), interval.count(), elapsed.count());
+    lastReport = now;
+  }
+
+  stop = true;
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  while (inflight) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  printf("StressSummary,rss_growth_mb,%.1lf\n", getResidentMB() - loadedMB);
+  EXIT_ON_ERR(hostManager.clearHost());
+  return 0;
+}
@@ -27,6 +27,9 @@
 #include "gtest/gtest.h"
 
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/Support/CommandLine.h"
+
+#include <limits>
 
 using namespace glow;
 using llvm::cast;
@@ -264,6 +267,499 @@ TEST_P(BackendCorrectnessTest, dataParallelStackingTest) {
   EXPECT_EQ(H.at(1), 4);
 }
 
+/// Check that a chain of data-parallel instructions produces the right results
+/// when the intermediate activations of the chain are kept out of memory with
+/// -llvm-fuse-data-parallel. The size of the tensors is not a multiple of the
+/// block size used by fused kernels.
+TEST_P(BackendCorrectnessTest, dataParallelFusionTest) {
+  CHECK_IF_ENABLED();
+  auto *fuseOpt = static_cast<llvm::cl::opt<bool> *>(
+      llvm::cl::getRegisteredOptions()["llvm-fuse-data-parallel"]);
+  ASSERT_TRUE(fuseOpt);
+  constexpr size_t size = 1100;
+  Module mod;
+  Function *F = mod.createFunction("DataParallelFusion");
+  auto M = llvm::make_unique<IRFunction>(F);
+
+  auto *inputVar =
+      mod.createPlaceholder(glow::ElemKind::FloatTy, {size}, "input", false);
+  auto *outputVar =
+      mod.createPlaceholder(glow::ElemKind::FloatTy, {size}, "output", false);
+  auto ctx = llvm::make_unique<ExecutionContext>();
+  auto *inputTensor = ctx->getPlaceholderBindings()->allocate(inputVar);
+  auto *outputTensor = ctx->getPlaceholderBindings()->allocate(outputVar);
+  auto IH = inputTensor->getHandle();
+  for (size_t i = 0; i < size; i++) {
+    IH.at({i}) = float(i % 7) - 4;
+  }
+  {
+    // Scope the IRBuilder so the active allocations are properly deallocated at
+    // destruction.
+    IRBuilder bb(M.get());
+    auto *ty = mod.uniqueType(glow::ElemKind::FloatTy, {size});
+
+    auto *input =
+        bb.createWeightVar(ty, "input1", WeightVar::MutabilityKind::Mutable);
+    auto *output =
+        bb.createWeightVar(ty, "output1", WeightVar::MutabilityKind::Mutable);
+    M->getVariableMap()[inputVar] = input;
+    M->getVariableMap()[outputVar] = output;
+
+    // output = max(input + 2, 0) * (input + 2), where all the intermediate
+    // values are local to the stacked kernel.
+    auto *two = bb.createAllocActivationInst("two", ty);
+    bb.createSplatInst("two", two, 2.0);
+    auto *zero = bb.createAllocActivationInst("zero", ty);
+    bb.createSplatInst("zero", zero, 0.0);
+    auto *sum = bb.createAllocActivationInst("sum", ty);
+    bb.createElementAddInst("add", sum, input, two);
+    auto *relu = bb.createAllocActivationInst("relu", ty);
+    bb.createElementMaxInst("max", relu, sum, zero);
+    bb.createElementMulInst("mul", output, relu, sum);
+    bb.createDeallocActivationInst("dealloc_relu", relu);
+    bb.createDeallocActivationInst("dealloc_sum", sum);
+    bb.createDeallocActivationInst("dealloc_zero", zero);
+    bb.createDeallocActivationInst("dealloc_two", two);
+  }
+
+  MockCPUBackend backend;
+  *fuseOpt = true;
+  auto function = backend.compileIR(std::move(M));
+  *fuseOpt = false;
+  ASSERT_FALSE(ERR_TO_BOOL(function->execute(ctx.get())));
+  auto OH = outputTensor->getHandle();
+  for (size_t i = 0; i < size; i++) {
+    float sum = IH.at({i}) + 2;
+    EXPECT_EQ(OH.at({i}), std::max(sum, 0.0f) * sum);
+  }
+}
+
+/// Computes the Sigmoid, Tanh, Exp and SoftMax of \p input on \p backendName
+/// into \p outs.
+static void inferActivations(Tensor *input, llvm::MutableArrayRef<Tensor> outs,
+                             llvm::StringRef backendName) {
+  PlaceholderBindings bindings;
+  ExecutionEngine EE(backendName);
+  auto &mod = EE.getModule();
+  Function *F = mod.createFunction("main");
+  auto *var = mod.createPlaceholder(&input->getType(), "var", false);
+  bindings.allocate(var);
+  auto *selected = mod.createConstant(ElemKind::Int64ITy,
+                                      {input->dims()[0], 1}, "selected");
+  selected->getPayloadMutable().zero();
+  std::vector<NodeValue> results = {
+      F->createSigmoid("sigmoid", var), F->createTanh("tanh", var),
+      F->createExp("exp", var), F->createSoftMax("softmax", var, selected)};
+  std::vector<Tensor *> resultTensors;
+  for (size_t i = 0; i < results.size(); i++) {
+    auto *save = F->createSave("save" + std::to_string(i), results[i]);
+    resultTensors.push_back(bindings.allocate(save->getPlaceholder()));
+  }
+
+  EE.compile(CompilationMode::Infer);
+
+  updateInputPlaceholders(bindings, {var}, {input});
+  EE.run(bindings);
+  for (size_t i = 0; i < results.size(); i++) {
+    outs[i].assign(resultTensors[i]);
+  }
+}
+
+/// Check that the approximations of exp used with -llvm-fast-math are close
+/// to the exact activations. The rows of the SoftMax, and the tensors, are not
+/// a multiple of the vector width.
+TEST_P(BackendCorrectnessTest, fastMathTest) {
+  CHECK_IF_ENABLED();
+  auto *fastMathOpt = static_cast<llvm::cl::opt<bool> *>(
+      llvm::cl::getRegisteredOptions()["llvm-fast-math"]);
+  ASSERT_TRUE(fastMathOpt);
+  PseudoRNG PRNG;
+  Tensor input(ElemKind::FloatTy, {13, 301});
+  input.getHandle().randomize(-4.0, 4.0, PRNG);
+  std::vector<Tensor> out1(4), out2(4);
+
+  *fastMathOpt = true;
+  inferActivations(&input, out1, backendName_);
+  *fastMathOpt = false;
+  inferActivations(&input, out2, "Interpreter");
+
+  for (size_t i = 0; i < out1.size(); i++) {
+    EXPECT_TRUE(out1[i].isEqual(out2[i], 1e-4));
+  }
+}
+
+/// Computes \p numLayers identical residual layers, each a FullyConnected
+/// with weights of its own, a Relu and an Add of the input of the layer, of
+/// \p input on \p backendName into \p out.
+static void inferRepeatedLayers(Tensor *input, Tensor *out, unsigned numLayers,
+                                llvm::StringRef backendName) {
+  PlaceholderBindings bindings;
+  ExecutionEngine EE(backendName);
+  auto &mod = EE.getModule();
+  Function *F = mod.createFunction("main");
+  auto *var = mod.createPlaceholder(&input->getType(), "var", false);
+  bindings.allocate(var);
+  size_t width = input->dims()[1];
+  PseudoRNG PRNG;
+  NodeValue layer = var;
+  for (unsigned i = 0; i < numLayers; i++) {
+    auto *W = mod.createConstant(ElemKind::FloatTy, {width, width},
+                                 "weights" + std::to_string(i));
+    auto *B = mod.createConstant(ElemKind::FloatTy, {width},
+                                 "bias" + std::to_string(i));
+    W->getPayloadMutable().getHandle().randomize(-0.2, 0.2, PRNG);
+    B->getPayloadMutable().getHandle().randomize(-0.2, 0.2, PRNG);
+    auto *FC = F->createFullyConnected("fc" + std::to_string(i), layer, W, B);
+    auto *relu = F->createRELU("relu" + std::to_string(i), FC);
+    layer = F->createAdd("add" + std::to_string(i), relu, layer);
+  }
+  auto *save = F->createSave("save", layer);
+  auto *result = bindings.allocate(save->getPlaceholder());
+
+  EE.compile(CompilationMode::Infer);
+
+  updateInputPlaceholders(bindings, {var}, {input});
+  EE.run(bindings);
+  out->assign(result);
+}
+
+/// Check that the layers emitted in a loop with -llvm-roll-repeated-instrs
+/// compute the same results as the layers emitted one by one.
+TEST_P(BackendCorrectnessTest, rollRepeatedInstrsTest) {
+  CHECK_IF_ENABLED();
+  auto *rollOpt = static_cast<llvm::cl::opt<unsigned> *>(
+      llvm::cl::getRegisteredOptions()["llvm-roll-repeated-instrs"]);
+  ASSERT_TRUE(rollOpt);
+  PseudoRNG PRNG;
+  Tensor input(ElemKind::FloatTy, {5, 37});
+  input.getHandle().randomize(-1.0, 1.0, PRNG);
+  Tensor out1, out2;
+
+  *rollOpt = 2;
+  inferRepeatedLayers(&input, &out1, 6, backendName_);
+  *rollOpt = 0;
+  inferRepeatedLayers(&input, &out2, 6, "Interpreter");
+
+  EXPECT_TRUE(out1.isEqual(out2, 1e-4));
+}
+
+/// Check that the parts of a module whose machine code is generated on
+/// several threads with -llvm-codegen-threads link into a function computing
+/// the same results.
+TEST_P(BackendCorrectnessTest, parallelCodegenTest) {
+  CHECK_IF_ENABLED();
+  auto *threadsOpt = static_cast<llvm::cl::opt<unsigned> *>(
+      llvm::cl::getRegisteredOptions()["llvm-codegen-threads"]);
+  ASSERT_TRUE(threadsOpt);
+  PseudoRNG PRNG;
+  Tensor input(ElemKind::FloatTy, {5, 37});
+  input.getHandle().randomize(-1.0, 1.0, PRNG);
+  Tensor out1, out2;
+
+  *threadsOpt = 4;
+  inferRepeatedLayers(&input, &out1, 6, backendName_);
+  *threadsOpt = 1;
+  inferRepeatedLayers(&input, &out2, 6, "Interpreter");
+
+  EXPECT_TRUE(out1.isEqual(out2, 1e-4));
+}
+
+/// Computes Quantize(Add(Dequantize(\p A), Dequantize(\p B))) and
+/// Quantize(Max(Dequantize(\p A), 0)) on \p backendName into \p outs. The
+/// CPU backend computes the sandwiches in int8.
+static void inferQuantizedSandwiches(Tensor *A, Tensor *B,
+                                     llvm::MutableArrayRef<Tensor> outs,
+                                     llvm::StringRef backendName) {
+  PlaceholderBindings bindings;
+  ExecutionEngine EE(backendName);
+  auto &mod = EE.getModule();
+  Function *F = mod.createFunction("main");
+  auto *varA = mod.createPlaceholder(&A->getType(), "A", false);
+  auto *varB = mod.createPlaceholder(&B->getType(), "B", false);
+  bindings.allocate(varA);
+  bindings.allocate(varB);
+  auto *DQA = F->createDequantize("dequantizeA", varA);
+  auto *DQB = F->createDequantize("dequantizeB", varB);
+  auto *add = F->createAdd("add", DQA, DQB);
+  auto *zero = F->createSplat("zero", DQA->getResult().getType(), 0);
+  auto *max = F->createMax("max", DQA, zero);
+  auto *addTy = mod.uniqueType(ElemKind::Int8QTy, A->dims(), 0.06, 3);
+  auto *maxTy = mod.uniqueType(ElemKind::Int8QTy, A->dims(), 0.02, -128);
+  std::vector<NodeValue> results = {
+      F->createQuantize("quantizeAdd", add, addTy),
+      F->createQuantize("quantizeMax", max, maxTy)};
+  std::vector<Tensor *> resultTensors;
+  for (size_t i = 0; i < results.size(); i++) {
+    auto *save = F->createSave("save" + std::to_string(i), results[i]);
+    resultTensors.push_back(bindings.allocate(save->getPlaceholder()));
+  }
+
+  EE.compile(CompilationMode::Infer);
+
+  updateInputPlaceholders(bindings, {varA, varB}, {A, B});
+  EE.run(bindings);
+  for (size_t i = 0; i < results.size(); i++) {
+    outs[i].assign(resultTensors[i]);
+  }
+}
+
+/// Check that the arithmetic nodes between Dequantize and Quantize nodes
+/// compute the same results as in float, up to the rounding of the int8
+/// kernels.
+TEST_P(BackendCorrectnessTest, quantizedSandwichTest) {
+  CHECK_IF_ENABLED();
+  PseudoRNG PRNG;
+  Tensor A(ElemKind::Int8QTy, {7, 53}, 0.05, -4);
+  Tensor B(ElemKind::Int8QTy, {7, 53}, 0.02, 11);
+  A.getHandle<int8_t>().randomize(-128, 127, PRNG);
+  B.getHandle<int8_t>().randomize(-128, 127, PRNG);
+  std::vector<Tensor> out1(2), out2(2);
+
+  inferQuantizedSandwiches(&A, &B, out1, backendName_);
+  inferQuantizedSandwiches(&A, &B, out2, "Interpreter");
+
+  for (size_t i = 0; i < out1.size(); i++) {
+    EXPECT_TRUE(out1[i].isEqual(out2[i], 1));
+  }
+}
+
+/// Computes a padded strided MaxPool and AvgPool, a global AvgPool and an
+/// AdaptiveAvgPool of the NHWC \p input on \p backendName into \p outs.
+static void inferPools(Tensor *input, llvm::MutableArrayRef<Tensor> outs,
+                       llvm::StringRef backendName) {
+  PlaceholderBindings bindings;
+  ExecutionEngine EE(backendName);
+  auto &mod = EE.getModule();
+  Function *F = mod.createFunction("main");
+  auto *var = mod.createPlaceholder(&input->getType(), "var", false);
+  bindings.allocate(var);
+  auto dims = input->dims();
+  std::vector<unsigned_t> globalKernels = {unsigned_t(dims[1]),
+                                           unsigned_t(dims[2])};
+  auto *adaptiveTy =
+      mod.uniqueTypeWithNewShape(&input->getType(), {dims[0], 3, 4, dims[3]});
+  std::vector<NodeValue> results = {
+      F->createMaxPool("maxPool", var, {3, 3}, {2, 2}, {1, 1, 1, 1})
+          ->getResult(),
+      F->createAvgPool("avgPool", var, {3, 3}, {2, 2}, {1, 1, 1, 1}),
+      F->createAvgPool("globalPool", var, globalKernels, {1, 1},
+                       {0, 0, 0, 0}),
+      F->createAdaptiveAvgPool("adaptivePool", var, adaptiveTy)};
+  std::vector<Tensor *> resultTensors;
+  for (size_t i = 0; i < results.size(); i++) {
+    auto *save = F->createSave("save" + std::to_string(i), results[i]);
+    resultTensors.push_back(bindings.allocate(save->getPlaceholder()));
+  }
+
+  EE.compile(CompilationMode::Infer);
+
+  updateInputPlaceholders(bindings, {var}, {input});
+  EE.run(bindings);
+  for (size_t i = 0; i < results.size(); i++) {
+    outs[i].assign(resultTensors[i]);
+  }
+}
+
+/// Check the pools of float and int8 tensors whose channels are not a
+/// multiple of the vector width, nor of the channel blocks of the int8
+/// average pools of the CPU backend.
+TEST_P(BackendCorrectnessTest, poolsTest) {
+  CHECK_IF_ENABLED();
+  PseudoRNG PRNG;
+  Tensor inputF(ElemKind::FloatTy, {2, 7, 9, 70});
+  Tensor inputI8(ElemKind::Int8QTy, {2, 7, 9, 70}, 0.04, -3);
+  inputF.getHandle().randomize(-2.0, 2.0, PRNG);
+  inputI8.getHandle<int8_t>().randomize(-128, 127, PRNG);
+  std::vector<Tensor> out1(4), out2(4);
+
+  inferPools(&inputF, out1, backendName_);
+  inferPools(&inputF, out2, "Interpreter");
+  for (size_t i = 0; i < out1.size(); i++) {
+    EXPECT_TRUE(out1[i].isEqual(out2[i], 1e-5));
+  }
+
+  inferPools(&inputI8, out1, backendName_);
+  inferPools(&inputI8, out2, "Interpreter");
+  for (size_t i = 0; i < out1.size(); i++) {
+    EXPECT_TRUE(out1[i].isEqual(out2[i], 1));
+  }
+}
+
+/// Computes reductions of the innermost, middle and outermost axes of the
+/// float \p input and the int8 \p inputI8, of rank 3, on \p backendName into
+/// \p outs.
+static void inferReductions(Tensor *input, Tensor *inputI8,
+                            llvm::MutableArrayRef<Tensor> outs,
+                            llvm::StringRef backendName) {
+  PlaceholderBindings bindings;
+  ExecutionEngine EE(backendName);
+  auto &mod = EE.getModule();
+  Function *F = mod.createFunction("main");
+  auto *var = mod.createPlaceholder(&input->getType(), "var", false);
+  auto *varI8 = mod.createPlaceholder(&inputI8->getType(), "varI8", false);
+  bindings.allocate(var);
+  bindings.allocate(varI8);
+  auto dims = inputI8->dims();
+  auto *sumI8Ty = mod.uniqueType(ElemKind::Int8QTy, {dims[0], dims[1]},
+                                 inputI8->getType().getScale() * 8, 5);
+  std::vector<NodeValue> results = {
+      F->createBatchedReduceAdd("sum0", var, {0}),
+      F->createBatchedReduceAdd("sum1", var, {1}),
+      F->createBatchedReduceAdd("sum2", var, {2}),
+      F->createBatchedReduceMean("mean1", var, {1}),
+      F->createBatchedReduceMin("min2", var, {2}),
+      F->createBatchedReduceMin("min02", var, {0, 2}),
+      F->createBatchedReduceAdd("sumI8", sumI8Ty, varI8, {2})};
+  std::vector<Tensor *> resultTensors;
+  for (size_t i = 0; i < results.size(); i++) {
+    auto *save = F->createSave("save" + std::to_string(i), results[i]);
+    resultTensors.push_back(bindings.allocate(save->getPlaceholder()));
+  }
+
+  EE.compile(CompilationMode::Infer);
+
+  updateInputPlaceholders(bindings, {var, varI8}, {input, inputI8});
+  EE.run(bindings);
+  for (size_t i = 0; i < results.size(); i++) {
+    outs[i].assign(resultTensors[i]);
+  }
+}
+
+/// Check the reductions of contiguous rows, whose elements the CPU backend
+/// combines in vectors of partial results, and of the outer axes, whose
+/// output rows it computes in blocks. The sizes are not multiples of the
+/// vectors nor of the blocks.
+TEST_P(BackendCorrectnessTest, reductionsTest) {
+  CHECK_IF_ENABLED();
+  PseudoRNG PRNG;
+  Tensor input(ElemKind::FloatTy, {3, 1030, 21});
+  Tensor inputI8(ElemKind::Int8QTy, {5, 7, 67}, 0.03, 2);
+  input.getHandle().randomize(-2.0, 2.0, PRNG);
+  inputI8.getHandle<int8_t>().randomize(-128, 127, PRNG);
+  std::vector<Tensor> out1(7), out2(7);
+
+  inferReductions(&input, &inputI8, out1, backendName_);
+  inferReductions(&input, &inputI8, out2, "Interpreter");
+
+  for (size_t i = 0; i + 1 < out1.size(); i++) {
+    EXPECT_TRUE(out1[i].isEqual(out2[i], 1e-3));
+  }
+  EXPECT_TRUE(out1.back().isEqual(out2.back(), 1));
+}
+
+/// Computes element-wise instructions of slices of \p input along its inner
+/// dimension, and concatenates their results along the inner dimension, on
+/// \p backendName into \p out.
+static void inferSliceConcat(Tensor *input, Tensor *out,
+                             llvm::StringRef backendName) {
+  PlaceholderBindings bindings;
+  ExecutionEngine EE(backendName);
+  auto &mod = EE.getModule();
+  Function *F = mod.createFunction("main");
+  auto *var = mod.createPlaceholder(&input->getType(), "input", false);
+  bindings.allocate(var);
+  size_t rows = input->dims()[0];
+  size_t half = input->dims()[1] / 2;
+  auto *lhs = F->createSlice("lhs", var, {0, 0}, {rows, half});
+  auto *rhs = F->createSlice("rhs", var, {0, half}, {rows, 2 * half});
+  auto *gate = F->createMul("gate", F->createTanh("tanh", lhs),
+                            F->createSigmoid("sigmoid", rhs));
+  auto *sum = F->createAdd("sum", lhs, rhs);
+  auto *concat = F->createConcat("concat", {gate, sum}, 1);
+  auto *save = F->createSave("save", concat);
+  auto *result = bindings.allocate(save->getPlaceholder());
+
+  EE.compile(CompilationMode::Infer);
+
+  updateInputPlaceholders(bindings, {var}, {input});
+  EE.run(bindings);
+  out->assign(result);
+}
+
+/// Check the slices and the concats along the inner dimension, which the CPU
+/// backend accesses in place with strided views.
+TEST_P(BackendCorrectnessTest, sliceConcatTest) {
+  CHECK_IF_ENABLED();
+  PseudoRNG PRNG;
+  Tensor input(ElemKind::FloatTy, {37, 26});
+  input.getHandle().randomize(-2.0, 2.0, PRNG);
+  Tensor out1;
+  Tensor out2;
+
+  inferSliceConcat(&input, &out1, backendName_);
+  inferSliceConcat(&input, &out2, "Interpreter");
+
+  EXPECT_TRUE(out1.isEqual(out2, 1e-5));
+}
+
+/// Computes Gathers of \p data and of \p narrowData with \p indices, and the
+/// ScatterData and cumulative ScatterData of \p slices into \p data at
+/// \p scatterIndices, on \p backendName into \p outs.
+static void inferGatherScatter(Tensor *data, Tensor *narrowData,
+                               Tensor *indices, Tensor *scatterIndices,
+                               Tensor *slices,
+                               llvm::MutableArrayRef<Tensor> outs,
+                               llvm::StringRef backendName) {
+  PlaceholderBindings bindings;
+  ExecutionEngine EE(backendName);
+  auto &mod = EE.getModule();
+  Function *F = mod.createFunction("main");
+  std::vector<Placeholder *> vars;
+  for (auto *T : {data, narrowData, indices, scatterIndices, slices}) {
+    vars.push_back(mod.createPlaceholder(&T->getType(), "var", false));
+    bindings.allocate(vars.back());
+  }
+  std::vector<NodeValue> results = {
+      F->createGather("gather", vars[0], vars[2]),
+      F->createGather("narrowGather", vars[1], vars[2]),
+      F->createScatterData("scatter", vars[0], vars[3], vars[4]),
+      F->createScatterData("scatterAdd", vars[0], vars[3], vars[4],
+                           /* cumulative */ true)};
+  std::vector<Tensor *> resultTensors;
+  for (size_t i = 0; i < results.size(); i++) {
+    auto *save = F->createSave("save" + std::to_string(i), results[i]);
+    resultTensors.push_back(bindings.allocate(save->getPlaceholder()));
+  }
+
+  EE.compile(CompilationMode::Infer);
+
+  updateInputPlaceholders(bindings, vars,
+                          {data, narrowData, indices, scatterIndices, slices});
+  EE.run(bindings);
+  for (size_t i = 0; i < results.size(); i++) {
+    outs[i].assign(resultTensors[i]);
+  }
+}
+
+/// Check the prefetching Gathers, and the ScatterData of enough slices to be
+/// written in parallel by the CPU backend, with repeated indices whose slices
+/// must be written in order.
+TEST_P(BackendCorrectnessTest, gatherScatterTest) {
+  CHECK_IF_ENABLED();
+  PseudoRNG PRNG;
+  Tensor data(ElemKind::FloatTy, {600, 40});
+  Tensor narrowData(ElemKind::FloatTy, {600, 3});
+  Tensor indices(ElemKind::Int64ITy, {3000});
+  Tensor scatterIndices(ElemKind::Int64ITy, {4000, 1});
+  Tensor slices(ElemKind::FloatTy, {4000, 40});
+  data.getHandle().randomize(-1.0, 1.0, PRNG);
+  narrowData.getHandle().randomize(-1.0, 1.0, PRNG);
+  indices.getHandle<int64_t>().randomize(0, 599, PRNG);
+  scatterIndices.getHandle<int64_t>().randomize(0, 599, PRNG);
+  slices.getHandle().randomize(-1.0, 1.0, PRNG);
+  std::vector<Tensor> out1(4), out2(4);
+
+  inferGatherScatter(&data, &narrowData, &indices, &scatterIndices, &slices,
+                     out1, backendName_);
+  inferGatherScatter(&data, &narrowData, &indices, &scatterIndices, &slices,
+                     out2, "Interpreter");
+
+  for (size_t i = 0; i < 3; i++) {
+    EXPECT_TRUE(out1[i].isEqual(out2[i], 0));
+  }
+  EXPECT_TRUE(out1[3].isEqual(out2[3], 1e-5));
+}
+
 TEST_P(BackendCorrectnessTest, AvgPoolGradTest) {
   CHECK_IF_ENABLED();
   PseudoRNG PRNG;
@@ -414,6 +910,187 @@ TEST_P(BackendCorrectnessTest, convDKKC8Test) {
   EXPECT_TRUE(out1.isEqual(out2));
 }
 
+/// Run a convolution with constant weights of the given shape on the backend
+/// and on the Interpreter, and compare the results.
+static void testConstantWeightsConv(llvm::StringRef backendName,
+                                    llvm::ArrayRef<size_t> inputDims,
+                                    llvm::ArrayRef<size_t> filterDims,
+                                    llvm::ArrayRef<size_t> outDims,
+                                    unsigned_t stride, unsigned_t pad) {
+  PseudoRNG PRNG;
+  Tensor inputs(ElemKind::FloatTy, inputDims);
+  Tensor filter(ElemKind::FloatTy, filterDims);
+  Tensor bias(ElemKind::FloatTy, {filterDims[0]});
+  inputs.getHandle().randomize(-1.0, 1.0, PRNG);
+  filter.getHandle().randomize(-1.0, 1.0, PRNG);
+  bias.getHandle().randomize(-1.0, 1.0, PRNG);
+  Tensor out1(ElemKind::FloatTy, outDims);
+  Tensor out2(ElemKind::FloatTy, outDims);
+
+  inferConstantWeightsConv(&inputs, &filter, &bias, &out1, filterDims[1],
+                           stride, pad, backendName);
+  inferConstantWeightsConv(&inputs, &filter, &bias, &out2, filterDims[1],
+                           stride, pad, "Interpreter");
+
+  EXPECT_TRUE(out1.isEqual(out2, 0.001));
+}
+
+/// This test targets the Winograd convolution of the CPU backend, with output
+/// sizes that are not multiples of the tile size.
+TEST_P(BackendCorrectnessTest, convWinogradTest) {
+  CHECK_IF_ENABLED();
+  testConstantWeightsConv(backendName_, {2, 9, 7, 64}, {64, 3, 3, 64},
+                          {2, 9, 7, 64}, 1, 1);
+}
+
+/// This test targets the im2col convolution of the CPU backend.
+TEST_P(BackendCorrectnessTest, convIm2ColTest) {
+  CHECK_IF_ENABLED();
+  testConstantWeightsConv(backendName_, {2, 11, 10, 12}, {20, 5, 5, 12},
+                          {2, 6, 5, 20}, 2, 2);
+}
+
+/// This test targets the im2col convolution of the CPU backend for pointwise
+/// convolutions, which read the input in place.
+TEST_P(BackendCorrectnessTest, convPointwiseTest) {
+  CHECK_IF_ENABLED();
+  testConstantWeightsConv(backendName_, {3, 5, 6, 24}, {40, 1, 1, 24},
+                          {3, 5, 6, 40}, 1, 0);
+}
+
+/// Run a convolution with constant weights followed by an optional residual
+/// Add and by a Relu or a Clip on the backend and on the Interpreter, and
+/// compare the results. The CPU backend fuses them into the convolution.
+static void testConvWithEpilogue(llvm::StringRef backendName,
+                                 llvm::ArrayRef<size_t> inputDims,
+                                 llvm::ArrayRef<size_t> filterDims,
+                                 llvm::ArrayRef<size_t> outDims,
+                                 unsigned_t stride, unsigned_t pad,
+                                 bool withResidual, float clipMax) {
+  PseudoRNG PRNG;
+  Tensor inputs(ElemKind::FloatTy, inputDims);
+  Tensor filter(ElemKind::FloatTy, filterDims);
+  Tensor bias(ElemKind::FloatTy, {filterDims[0]});
+  Tensor residual(ElemKind::FloatTy, outDims);
+  inputs.getHandle().randomize(-1.0, 1.0, PRNG);
+  filter.getHandle().randomize(-1.0, 1.0, PRNG);
+  bias.getHandle().randomize(-1.0, 1.0, PRNG);
+  residual.getHandle().randomize(-2.0, 2.0, PRNG);
+  Tensor out1(ElemKind::FloatTy, outDims);
+  Tensor out2(ElemKind::FloatTy, outDims);
+  Tensor *residualT = withResidual ? &residual : nullptr;
+
+  inferConvWithEpilogue(&inputs, &filter, &bias, residualT, &out1,
+                        filterDims[1], stride, pad, clipMax, backendName);
+  inferConvWithEpilogue(&inputs, &filter, &bias, residualT, &out2,
+                        filterDims[1], stride, pad, clipMax, "Interpreter");
+
+  EXPECT_TRUE(out1.isEqual(out2, 0.001));
+}
+
+/// A residual block: convolution, residual Add and Relu.
+TEST_P(BackendCorrectnessTest, convResidualReluTest) {
+  CHECK_IF_ENABLED();
+  testConvWithEpilogue(backendName_, {2, 11, 10, 12}, {20, 5, 5, 12},
+                       {2, 6, 5, 20}, 2, 2, true,
+                       std::numeric_limits<float>::infinity());
+}
+
+/// A Winograd convolution followed by a residual Add and a Clip.
+TEST_P(BackendCorrectnessTest, convWinogradResidualClipTest) {
+  CHECK_IF_ENABLED();
+  testConvWithEpilogue(backendName_, {2, 9, 7, 64}, {64, 3, 3, 64},
+                       {2, 9, 7, 64}, 1, 1, true, 6.0);
+}
+
+/// A pointwise convolution followed by a Relu, without residual.
+TEST_P(BackendCorrectnessTest, convPointwiseReluTest) {
+  CHECK_IF_ENABLED();
+  testConvWithEpilogue(backendName_, {3, 5, 6, 24}, {40, 1, 1, 24},
+                       {3, 5, 6, 40}, 1, 0, false,
+                       std::numeric_limits<float>::infinity());
+}
+
+/// Run a depthwise convolution with constant weights of \p kernel x \p kernel
+/// over \p inputDims, followed by a Clip and a pointwise convolution with
+/// \p pwChannels outputs unless it is zero, on the backend and on the
+/// Interpreter, and compare the results. The CPU backend runs them with its
+/// depthwise kernels, fused with the pointwise convolution.
+static void testDepthwiseConv(llvm::StringRef backendName,
+                              llvm::ArrayRef<size_t> inputDims,
+                              unsigned_t kernel, unsigned_t stride,
+                              unsigned_t pad, size_t pwChannels) {
+  PseudoRNG PRNG;
+  size_t channels = inputDims[3];
+  size_t outH = (inputDims[1] + 2 * pad - kernel) / stride + 1;
+  size_t outW = (inputDims[2] + 2 * pad - kernel) / stride + 1;
+  Tensor inputs(ElemKind::FloatTy, inputDims);
+  Tensor filter(ElemKind::FloatTy, {channels, kernel, kernel, 1});
+  Tensor bias(ElemKind::FloatTy, {channels});
+  Tensor pwFilter(ElemKind::FloatTy, {pwChannels, 1, 1, channels});
+  Tensor pwBias(ElemKind::FloatTy, {pwChannels});
+  inputs.getHandle().randomize(-1.0, 1.0, PRNG);
+  filter.getHandle().randomize(-1.0, 1.0, PRNG);
+  bias.getHandle().randomize(-1.0, 1.0, PRNG);
+  pwFilter.getHandle().randomize(-1.0, 1.0, PRNG);
+  pwBias.getHandle().randomize(-1.0, 1.0, PRNG);
+  std::array<size_t, 4> S{
+      {inputDims[0], outH, outW, pwChannels ? pwChannels : channels}};
+  llvm::ArrayRef<size_t> shape(S);
+  Tensor out1(ElemKind::FloatTy, shape);
+  Tensor out2(ElemKind::FloatTy, shape);
+  Tensor *pwFilterT = pwChannels ? &pwFilter : nullptr;
+
+  inferDepthwiseConv(&inputs, &filter, &bias, pwFilterT, &pwBias, &out1, kernel,
+                     stride, pad, backendName);
+  inferDepthwiseConv(&inputs, &filter, &bias, pwFilterT, &pwBias, &out2, kernel,
+                     stride, pad, "Interpreter");
+
+  EXPECT_TRUE(out1.isEqual(out2, 0.001));
+}
+
+/// A 3x3 depthwise convolution, with channels that are not a multiple of the
+/// vector width.
+TEST_P(BackendCorrectnessTest, convDepthwise3x3Test) {
+  CHECK_IF_ENABLED();
+  testDepthwiseConv(backendName_, {2, 9, 7, 45}, 3, 1, 1, 0);
+}
+
+/// A strided 5x5 depthwise convolution.
+TEST_P(BackendCorrectnessTest, convDepthwise5x5StrideTest) {
+  CHECK_IF_ENABLED();
+  testDepthwiseConv(backendName_, {2, 12, 11, 36}, 5, 2, 2, 0);
+}
+
+/// A depthwise convolution followed by a Clip and a pointwise convolution,
+/// as in the blocks of MobileNet.
+TEST_P(BackendCorrectnessTest, convDepthwisePointwiseTest) {
+  CHECK_IF_ENABLED();
+  testDepthwiseConv(backendName_, {2, 9, 7, 40}, 3, 1, 1, 24);
+}
+
+TEST_P(BackendCorrectnessTest, quantizedConvDepthwiseTest) {
+  CHECK_IF_ENABLED();
+  PseudoRNG PRNG;
+  Tensor inputs(ElemKind::Int8QTy, {2, 10, 9, 40}, 0.025, -7);
+  Tensor filter(ElemKind::Int8QTy, {40, 3, 3, 1}, 0.003, 3);
+  Tensor bias(ElemKind::Int32QTy, {40}, 0.5, -4);
+  inputs.getHandle<int8_t>().randomize(-128, 127, PRNG);
+  filter.getHandle<int8_t>().randomize(-128, 127, PRNG);
+  bias.getHandle<int32_t>().randomize(-11, 8, PRNG);
+  std::array<size_t, 4> S{{2, 10, 9, 40}};
+  llvm::ArrayRef<size_t> shape(S);
+  Tensor out1(ElemKind::Int8QTy, shape, 0.05, -17);
+  Tensor out2(ElemKind::Int8QTy, shape, 0.05, -17);
+
+  inferDepthwiseConv(&inputs, &filter, &bias, nullptr, nullptr, &out1, 3, 1,
+                     1, backendName_);
+  inferDepthwiseConv(&inputs, &filter, &bias, nullptr, nullptr, &out2, 3, 1,
+                     1, "Interpreter");
+
+  EXPECT_TRUE(out1.isEqual(out2, 1.0));
+}
+
 TEST_P(BackendCorrectnessTest, softmaxGradTest) {
   CHECK_IF_ENABLED();
   PseudoRNG PRNG;
@@ -20,6 +20,7 @@
 #include "glow/Graph/Graph.h"
 #include "glow/Graph/PlaceholderBindings.h"
 #include "glow/IR/IRBuilder.h"
+#include "glow/Optimizer/GraphOptimizer/GraphOptimizer.h"
 
 #include "gtest/gtest.h"
 
@@ -131,11 +132,14 @@ TEST(RuntimeBundle, BundleSymbolInfo) {
   auto *S = F->createSave("ret", SM);
   auto *qp = F->createQuantizationProfile(bindings, "qp", input);
 
-  EE.compile(CompilationMode::Infer);
-  runtime::DAG *dag;
-  ASSIGN_VALUE_OR_FAIL_TEST(dag, EE.getDAG("main"));
-  assert(dag->nodes.size() > 0 && "Empty DAG list");
-  auto table = dag->nodes[0]->runtimeBundle->getSymbolTable();
+  // Check the symbols of the compiled function, the ones of the provisioned
+  // networks only keep the placeholders.
+  std::unique_ptr<Backend> backend(createBackend(EE.getBackendName()));
+  CompilationContext cctx;
+  cctx.compMode = CompilationMode::Infer;
+  EXIT_ON_ERR(::glow::optimizeFunction(F, *backend, cctx));
+  auto function = EXIT_ON_ERR(backend->compile(F));
+  auto table = function->getRuntimeBundle().getSymbolTable();
   // Check that placeholders and constants are correctly labelled.
   EXPECT_EQ(table.find(S->getPlaceholder()->getName())->second.symbolCategory,
             glow::runtime::SymbolCategory::Placeholder);
@@ -168,6 +172,42 @@ TEST(RuntimeBundle, BundleSymbolInfo) {
   EXPECT_EQ(table.find("tensorview_reshape_in")->second.output, false);
 }
 
+/// Test that the symbol tables of a provisioned network only keep the
+/// placeholders, which the runs look up, and that the network still runs.
+TEST(RuntimeBundle, ProvisionedSymbols) {
+  ExecutionEngine EE;
+  auto &mod = EE.getModule();
+  PlaceholderBindings bindings;
+  Function *F = mod.createFunction("main");
+  auto *input =
+      mod.createPlaceholder(ElemKind::FloatTy, {1, 10, 10, 3}, "in", false);
+  auto *FC = F->createFullyConnected(bindings, "FC", input, 30);
+  auto *RL = F->createRELU("RL2", FC);
+  auto *S = F->createSave("ret", RL);
+
+  EE.compile(CompilationMode::Infer);
+  runtime::DAG *dag;
+  ASSIGN_VALUE_OR_FAIL_TEST(dag, EE.getDAG("main"));
+  ASSERT_GT(dag->nodes.size(), 0);
+  const auto &table = dag->nodes[0]->runtimeBundle->getSymbolTable();
+  using glow::runtime::SymbolCategory;
+  for (const auto &symbol : table) {
+    auto category = symbol.second.symbolCategory;
+    EXPECT_TRUE(category == SymbolCategory::Placeholder ||
+                category == SymbolCategory::PlaceholderTensorView)
+        << symbol.first;
+  }
+  EXPECT_NE(table.find(S->getPlaceholder()->getName()), table.end());
+  EXPECT_NE(table.find(input->getName()), table.end());
+
+  bindings.allocate(input)->getHandle().randomize(-2, 2, mod.getPRNG());
+  bindings.allocate(S->getPlaceholder());
+  EE.run(bindings);
+  for (auto v : bindings.get(S->getPlaceholder())->getHandle()) {
+    EXPECT_GE(v, 0);
+  }
+}
+
 // Test if the placeholders are allocated contiguously as
 // Input|InputOutput|Output.
 TEST(RuntimeBundle, ContiguousPlaceholder) {
@@ -546,6 +586,87 @@ TEST_P(BackendExecTest, compileThenAddNetwork) {
                   ->isEqual(*bindings2.get(S2->getPlaceholder())));
 }
 
+/// Run a network repeatedly with different bindings and inputs, which reuses
+/// the state of earlier runs on backends that keep it.
+TEST_P(BackendTest, rerunWithNewBindings) {
+  CHECK_IF_ENABLED();
+  auto *input = mod_.createPlaceholder(ElemKind::FloatTy, {2, 3, 4}, "in",
+                                       /* isTrainable */ false);
+  auto *RS = F_->createReshape("reshape", input, {6, 4});
+  auto *W = mod_.createConstant(ElemKind::FloatTy, {4, 5}, "weights");
+  W->getPayloadMutable().getHandle().randomize(-1, 1, mod_.getPRNG());
+  auto *MM = F_->createMatMul("matmul", RS, W);
+  auto *RL = F_->createRELU("relu", MM);
+  auto *SL = F_->createSlice("slice", RL, {1, 1}, {5, 4});
+  auto *S = F_->createSave("ret", SL);
+
+  EE_.compile(CompilationMode::Infer);
+
+  PlaceholderBindings bindings1, bindings2;
+  bindings1.allocate(mod_.getPlaceholders());
+  bindings2.allocate(mod_.getPlaceholders());
+  bindings1.get(input)->getHandle().randomize(-2, 2, mod_.getPRNG());
+  bindings2.get(input)->getHandle().randomize(-2, 2, mod_.getPRNG());
+
+  EE_.run(bindings1);
+  Tensor expected1 = bindings1.get(S->getPlaceholder())->clone();
+  EE_.run(bindings2);
+  Tensor expected2 = bindings2.get(S->getPlaceholder())->clone();
+  EXPECT_FALSE(expected1.isEqual(expected2));
+
+  for (int i = 0; i < 3; i++) {
+    bindings1.get(S->getPlaceholder())->zero();
+    bindings2.get(S->getPlaceholder())->zero();
+    EE_.run(bindings1);
+    EE_.run(bindings2);
+    EXPECT_TRUE(bindings1.get(S->getPlaceholder())->isEqual(expected1));
+    EXPECT_TRUE(bindings2.get(S->getPlaceholder())->isEqual(expected2));
+  }
+}
+
+/// Check that the batches run on several devices with runBatchParallel give
+/// the results of the batches run one by one, in the order of the batches.
+TEST_P(BackendExecTest, runBatchParallel) {
+  ExecutionEngine EE(GetParam(), /* deviceMemory */ 0,
+                     /* ignoreUserDeviceConfig */ true, /* numDevices */ 3);
+  auto &mod = EE.getModule();
+  Function *F = mod.createFunction("main");
+  auto *input = mod.createPlaceholder(ElemKind::FloatTy, {2, 8}, "in", false);
+  auto *W = mod.createConstant(ElemKind::FloatTy, {8, 4}, "weights");
+  W->getPayloadMutable().getHandle().randomize(-1, 1, mod.getPRNG());
+  auto *MM = F->createMatMul("matmul", input, W);
+  auto *S = F->createSave("ret", F->createTanh("tanh", MM));
+
+  CompilationContext cctx;
+  cctx.compMode = CompilationMode::Infer;
+  EE.compile(cctx);
+
+  Tensor inputs(ElemKind::FloatTy, {14, 8});
+  inputs.getHandle().randomize(-2, 2, mod.getPRNG());
+  PlaceholderBindings bindings;
+  bindings.allocate(mod.getPlaceholders());
+
+  // 9 batches of 2 samples wrap around the 14 samples.
+  Tensor results;
+  size_t sampleCounter = 0;
+  runBatchParallel(EE, bindings, 9, sampleCounter, {input}, {&inputs},
+                   {S->getPlaceholder()}, {&results});
+  EXPECT_EQ(sampleCounter, 18);
+  ASSERT_EQ(results.dims()[0], 18);
+
+  sampleCounter = 0;
+  auto resultH = results.getHandle();
+  for (size_t j = 0; j < 9; j++) {
+    runBatch(EE, bindings, 1, sampleCounter, {input}, {&inputs});
+    auto expectedH = bindings.get(S->getPlaceholder())->getHandle();
+    for (size_t i = 0; i < 2; i++) {
+      for (size_t k = 0; k < 4; k++) {
+        EXPECT_FLOAT_EQ(resultH.at({j * 2 + i, k}), expectedH.at({i, k}));
+      }
+    }
+  }
+}
+
 /// Test the basic functionality of the bindings.
 TEST(PlaceholderBindings, basicPlaceholderBindingsTest) {
   Module mod;
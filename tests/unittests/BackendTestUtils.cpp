@@ -29,6 +29,7 @@
 
 #include "llvm/Support/CommandLine.h"
 
+#include <cmath>
 #include <future>
 
 namespace glow {
@@ -605,6 +606,109 @@ void trainMaxPoolNet(Tensor *inputs, Tensor *weights, Tensor *bias,
   out->assign(res);
 }
 
+void inferConstantWeightsConv(Tensor *inputs, Tensor *filter, Tensor *bias,
+                              Tensor *out, unsigned_t kernel, unsigned_t stride,
+                              unsigned_t pad, llvm::StringRef kind) {
+  PlaceholderBindings bindings;
+  ExecutionEngine EE(kind);
+  auto &mod = EE.getModule();
+  auto *F = mod.createFunction("main");
+  auto *inputP = createPlaceholder(mod, bindings, inputs, "inputP");
+  auto *filterC = mod.createConstant("filter", *filter);
+  auto *biasC = mod.createConstant("bias", *bias);
+  auto OT = mod.uniqueType(ElemKind::FloatTy, out->dims());
+  auto *conv = F->createConv("conv", inputP, filterC, biasC, OT, kernel, stride,
+                             pad, 1);
+  auto *result = F->createSave("ret", conv);
+  auto *resultTensor = bindings.allocate(result->getPlaceholder());
+
+  EE.compile(CompilationMode::Infer);
+
+  updateInputPlaceholders(bindings, {inputP}, {inputs});
+  EE.run(bindings);
+  out->assign(resultTensor);
+}
+
+void inferConvWithEpilogue(Tensor *inputs, Tensor *filter, Tensor *bias,
+                           Tensor *residual, Tensor *out, unsigned_t kernel,
+                           unsigned_t stride, unsigned_t pad, float clipMax,
+                           llvm::StringRef kind) {
+  PlaceholderBindings bindings;
+  ExecutionEngine EE(kind);
+  auto &mod = EE.getModule();
+  auto *F = mod.createFunction("main");
+  auto *inputP = createPlaceholder(mod, bindings, inputs, "inputP");
+  auto *filterC = mod.createConstant("filter", *filter);
+  auto *biasC = mod.createConstant("bias", *bias);
+  auto OT = mod.uniqueType(ElemKind::FloatTy, out->dims());
+  NodeValue result = F->createConv("conv", inputP, filterC, biasC, OT, kernel,
+                                   stride, pad, 1);
+  std::vector<Placeholder *> inputPHs = {inputP};
+  std::vector<Tensor *> inputTensors = {inputs};
+  if (residual) {
+    auto *residualP = createPlaceholder(mod, bindings, residual, "residualP");
+    result = F->createAdd("add", result, residualP);
+    inputPHs.push_back(residualP);
+    inputTensors.push_back(residual);
+  }
+  if (std::isinf(clipMax)) {
+    result = F->createRELU("relu", result);
+  } else {
+    result = F->createClip("clip", result, 0, clipMax);
+  }
+  auto *save = F->createSave("ret", result);
+  auto *resultTensor = bindings.allocate(save->getPlaceholder());
+
+  EE.compile(CompilationMode::Infer);
+
+  updateInputPlaceholders(bindings, inputPHs, inputTensors);
+  EE.run(bindings);
+  out->assign(resultTensor);
+}
+
+void inferDepthwiseConv(Tensor *inputs, Tensor *filter, Tensor *bias,
+                        Tensor *pwFilter, Tensor *pwBias, Tensor *out,
+                        unsigned_t kernel, unsigned_t stride, unsigned_t pad,
+                        llvm::StringRef kind) {
+  PlaceholderBindings bindings;
+  ExecutionEngine EE(kind);
+  auto &mod = EE.getModule();
+  auto *F = mod.createFunction("main");
+  auto &inType = inputs->getType();
+  auto *inputP =
+      inType.isQuantizedType()
+          ? createQuantizedPlaceholder(mod, bindings, inputs,
+                                       inType.getScale(), inType.getOffset(),
+                                       "inputP")
+          : createPlaceholder(mod, bindings, inputs, "inputP");
+  auto *filterC = mod.createConstant("filter", *filter);
+  auto *biasC = mod.createConstant("bias", *bias);
+  unsigned_t channels = inputs->dims()[3];
+  auto outDims = out->dims().vec();
+  outDims[3] = channels;
+  auto OT = out->getType().isQuantizedType() && !pwFilter
+                ? mod.uniqueTypeWithNewShape(&out->getType(), outDims)
+                : mod.uniqueType(ElemKind::FloatTy, outDims);
+  NodeValue result = F->createConv("conv", inputP, filterC, biasC, OT, kernel,
+                                   stride, pad, channels);
+  if (pwFilter) {
+    auto *pwFilterC = mod.createConstant("pwFilter", *pwFilter);
+    auto *pwBiasC = mod.createConstant("pwBias", *pwBias);
+    result = F->createClip("clip", result, 0, 6);
+    auto PT = mod.uniqueType(ElemKind::FloatTy, out->dims());
+    result = F->createConv("pointwise", result, pwFilterC, pwBiasC, PT, 1, 1,
+                           0, 1);
+  }
+  auto *save = F->createSave("ret", result);
+  auto *resultTensor = bindings.allocate(save->getPlaceholder());
+
+  EE.compile(CompilationMode::Infer);
+
+  updateInputPlaceholders(bindings, {inputP}, {inputs});
+  EE.run(bindings);
+  out->assign(resultTensor);
+}
+
 void inferSmallConv(Tensor *inputs, Tensor *out, llvm::StringRef kind) {
   PlaceholderBindings bindings;
   ExecutionEngine EE(kind);
@@ -320,6 +320,32 @@ void inferNonSquareStrideConv(Tensor *out, llvm::StringRef kind);
 
 void inferConvDKKC8(Tensor *out, llvm::StringRef kind);
 
+/// Run a float convolution of \p inputs with the constant \p filter and
+/// \p bias into \p out on backend \p kind, using \p kernel, \p stride and
+/// \p pad in both dimensions. Constant weights let backends rewrite them at
+/// compile time.
+void inferConstantWeightsConv(Tensor *inputs, Tensor *filter, Tensor *bias,
+                              Tensor *out, unsigned_t kernel, unsigned_t stride,
+                              unsigned_t pad, llvm::StringRef kind);
+
+/// Like inferConstantWeightsConv, but add \p residual to the result of the
+/// convolution unless it is null, and then clip it to [0, \p clipMax], with a
+/// Relu when \p clipMax is infinite.
+void inferConvWithEpilogue(Tensor *inputs, Tensor *filter, Tensor *bias,
+                           Tensor *residual, Tensor *out, unsigned_t kernel,
+                           unsigned_t stride, unsigned_t pad, float clipMax,
+                           llvm::StringRef kind);
+
+/// Run a depthwise convolution of \p inputs with the constant \p filter and
+/// \p bias into \p out on backend \p kind, using \p kernel, \p stride and
+/// \p pad in both dimensions. The tensors may be float or quantized. Unless
+/// \p pwFilter is null, clip the result to [0, 6] and run the pointwise
+/// convolution of the constant \p pwFilter and \p pwBias on it.
+void inferDepthwiseConv(Tensor *inputs, Tensor *filter, Tensor *bias,
+                        Tensor *pwFilter, Tensor *pwBias, Tensor *out,
+                        unsigned_t kernel, unsigned_t stride, unsigned_t pad,
+                        llvm::StringRef kind);
+
 void inferSmallConv(Tensor *inputs, Tensor *out, llvm::StringRef kind);
 
 void trainSoftMaxNet(Tensor *inputs, Tensor *weights, Tensor *bias,
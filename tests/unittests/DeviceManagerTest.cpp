@@ -20,14 +20,20 @@
 
 #include "../../lib/Backends/CPU/CPUDeviceManager.h"
 #include "../../lib/Backends/Interpreter/InterpreterDeviceManager.h"
+#include "../../lib/LLVMIRCodeGen/SpecializationCache.h"
 #include "glow/ExecutionEngine/ExecutionEngine.h"
+#include "glow/LLVMIRCodeGen/LLVMCompiledFunction.h"
 #include "glow/Optimizer/GraphOptimizer/GraphOptimizer.h"
 #include "glow/Runtime/RuntimeTypes.h"
 
 #include "gtest/gtest.h"
 
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+
 #include <chrono>
 #include <future>
+#include <thread>
 
 using namespace glow;
 using namespace glow::runtime;
@@ -149,6 +155,48 @@ TEST_P(DeviceManagerTest, Basic) {
   EXPECT_TRUE(result1->isEqual(output1));
 }
 
+/// Test that a device reports the memory of the networks added to it until
+/// they are evicted.
+TEST_P(DeviceManagerTest, NetworkMemoryUsage) {
+  auto module = makeBasicModule();
+  std::vector<std::unique_ptr<CompiledFunction>> backing;
+  FunctionMapTy functions =
+      compileFunctions(backendName, module.get(), backing);
+
+  std::promise<const Module *> promise;
+  std::future<const Module *> future;
+  std::tie(promise, future) = getFutureHelper<const Module *>();
+  device->addNetwork(module.get(), std::move(functions),
+                     [&promise](const Module *module, Error err) {
+                       callbackHelper(promise, module, std::move(err));
+                     });
+  future.wait_for(std::chrono::seconds(2));
+  EXPECT_EQ(future.get(), module.get());
+
+  DeviceMemoryUsage usage = device->getMemoryUsage();
+  EXPECT_EQ(usage.maxBytes, device->getMaximumMemory());
+  EXPECT_EQ(usage.availableBytes, device->getAvailableMemory());
+  EXPECT_LE(usage.largestFreeBlock, usage.availableBytes);
+  EXPECT_GE(usage.getFragmentation(), 0.0);
+  EXPECT_LT(usage.getFragmentation(), 1.0);
+  ASSERT_EQ(usage.networks.count("main"), 1);
+  const auto &bundle = backing[0]->getRuntimeBundle();
+  EXPECT_GE(usage.networks["main"].constants, bundle.getConstantWeightSize());
+  EXPECT_GE(usage.networks["main"].io, bundle.getMutableWeightSize());
+
+  std::promise<std::string> evictPromise;
+  std::future<std::string> evictFuture;
+  std::tie(evictPromise, evictFuture) = getFutureHelper<std::string>();
+  device->evictNetwork("main",
+                       [&evictPromise](std::string functionName, Error err) {
+                         callbackHelper(evictPromise, functionName,
+                                        std::move(err));
+                       });
+  evictFuture.wait_for(std::chrono::seconds(2));
+  EXPECT_EQ(evictFuture.get(), "main");
+  EXPECT_EQ(device->getMemoryUsage().networks.count("main"), 0);
+}
+
 // Test that the DeviceManager correctly supports virtual padding.
 TEST_P(DeviceManagerTest, PartialTensorCopy) {
   // Temporarily disable this test for Habana.
@@ -583,6 +631,138 @@ TEST(DeviceManagerTest, SetDeviceMemory) {
   EXPECT_EQ(interpreterDeviceDefault.getMaximumMemory(), 2000000000);
 }
 
+/// Test that replicas of a network with identical weights share them on a
+/// device, which only counts their memory once.
+TEST(DeviceManagerTest, SharedConstants) {
+  std::vector<std::unique_ptr<CompiledFunction>> backing;
+  auto module = makeBasicModule("main");
+  auto module2 = makeBasicModule("replica");
+  auto functions = compileFunctions("Interpreter", module.get(), backing);
+  auto functions2 = compileFunctions("Interpreter", module2.get(), backing);
+  uint64_t expectedBytes =
+      backing[0]->getRuntimeBundle().getConstantWeightSize();
+  ASSERT_GT(expectedBytes, 0);
+
+  auto config = DeviceConfig("Interpreter");
+  config.setDeviceMemory(expectedBytes);
+  InterpreterDeviceManager device(config);
+  ASSERT_FALSE(ERR_TO_BOOL(device.init()));
+
+  std::promise<const Module *> promise;
+  std::future<const Module *> future;
+  std::tie(promise, future) = getFutureHelper<const Module *>();
+  device.addNetwork(module.get(), functions,
+                    [&promise](const Module *module, Error err) {
+                      callbackHelper(promise, module, std::move(err));
+                    });
+  future.wait_for(std::chrono::seconds(2));
+  EXPECT_EQ(future.get(), module.get());
+  EXPECT_EQ(device.getAvailableMemory(), 0);
+
+  // The replica fits since its weights are already on the device.
+  std::tie(promise, future) = getFutureHelper<const Module *>();
+  device.addNetwork(module2.get(), functions2,
+                    [&promise](const Module *module, Error err) {
+                      callbackHelper(promise, module, std::move(err));
+                    });
+  future.wait_for(std::chrono::seconds(2));
+  EXPECT_EQ(future.get(), module2.get());
+  EXPECT_EQ(device.getAvailableMemory(), 0);
+  EXPECT_EQ(backing[0]->getRuntimeBundle().getConstants(),
+            backing[1]->getRuntimeBundle().getConstants());
+
+  // The weights stay on the device until their last user is evicted.
+  for (const char *name : {"main", "replica"}) {
+    std::promise<std::string> evictPromise;
+    std::future<std::string> evictFuture;
+    std::tie(evictPromise, evictFuture) = getFutureHelper<std::string>();
+    device.evictNetwork(name,
+                        [&evictPromise](std::string functionName, Error err) {
+                          callbackHelper(evictPromise, functionName,
+                                         std::move(err));
+                        });
+    evictFuture.wait_for(std::chrono::seconds(2));
+    EXPECT_EQ(evictFuture.get(), name);
+    EXPECT_EQ(device.getAvailableMemory(),
+              std::string(name) == "main" ? 0 : expectedBytes);
+  }
+
+  EXPECT_FALSE(ERR_TO_BOOL(device.stop()));
+}
+
+/// Check that an Interpreter device splitting its kernels across several
+/// intra-op threads computes the same results as a serial device.
+TEST(DeviceManagerTest, InterpreterIntraOpThreads) {
+  auto module = llvm::make_unique<Module>();
+  Function *F = module->createFunction("main");
+  auto *input = module->createPlaceholder(ElemKind::FloatTy, {2, 12, 12, 8},
+                                          "input", false);
+  auto *output =
+      module->createPlaceholder(ElemKind::FloatTy, {2, 64}, "output", false);
+  PlaceholderBindings initBindings;
+  auto *conv = F->createConv(initBindings, "conv", input, 16, 3, 1, 1, 1);
+  auto *pool = F->createMaxPool("pool", conv, 2, 2, 0);
+  auto *reshape =
+      F->createReshape("reshape", pool->getResult(), {2, 6 * 6 * 16});
+  auto *FC = F->createFullyConnected(initBindings, "fc", reshape, 64);
+  F->createSave("ret", FC, output);
+  ::glow::convertPlaceholdersToConstants(F, initBindings, {input, output});
+
+  std::vector<std::unique_ptr<CompiledFunction>> backing;
+  FunctionMapTy functions =
+      compileFunctions("Interpreter", module.get(), backing);
+
+  auto config = DeviceConfig("Interpreter");
+  InterpreterDeviceManager serialDevice(config);
+  config.parameters["intraOpThreads"] = "4";
+  InterpreterDeviceManager parallelDevice(config);
+  EXPECT_EQ(serialDevice.getNumIntraOpThreads(), 1);
+  EXPECT_EQ(parallelDevice.getNumIntraOpThreads(), 4);
+
+  Tensor inputT(ElemKind::FloatTy, {2, 12, 12, 8});
+  inputT.getHandle().randomize(-1.0, 1.0, module->getPRNG());
+
+  std::vector<Tensor> results;
+  for (auto *device : {&serialDevice, &parallelDevice}) {
+    ASSERT_FALSE(ERR_TO_BOOL(device->init()));
+    std::promise<const Module *> promise;
+    std::future<const Module *> future;
+    std::tie(promise, future) = getFutureHelper<const Module *>();
+    device->addNetwork(module.get(), functions,
+                       [&promise](const Module *module, Error err) {
+                         callbackHelper(promise, module, std::move(err));
+                       });
+    future.wait_for(std::chrono::seconds(2));
+    EXPECT_EQ(future.get(), module.get());
+
+    std::unique_ptr<ExecutionContext> context =
+        llvm::make_unique<ExecutionContext>();
+    auto *bindings = context->getPlaceholderBindings();
+    bindings->allocate(module->getPlaceholders());
+    bindings->get(input)->assign(&inputT);
+
+    std::promise<std::unique_ptr<ExecutionContext>> runPromise;
+    std::future<std::unique_ptr<ExecutionContext>> runFuture;
+    std::tie(runPromise, runFuture) =
+        getFutureHelper<std::unique_ptr<ExecutionContext>>();
+    device->runFunction("main", std::move(context),
+                        [&runPromise](RunIdentifierTy, Error err,
+                                      std::unique_ptr<ExecutionContext> ctx) {
+                          callbackHelper(runPromise, std::move(ctx),
+                                         std::move(err));
+                        });
+    runFuture.wait_for(std::chrono::seconds(2));
+    context = runFuture.get();
+    ASSERT_TRUE(context);
+
+    Tensor *result = context->getPlaceholderBindings()->get(output);
+    ASSERT_TRUE(result);
+    results.push_back(result->clone());
+    EXPECT_FALSE(ERR_TO_BOOL(device->stop()));
+  }
+  EXPECT_TRUE(results[0].isEqual(results[1]));
+}
+
 #ifdef GLOW_WITH_CPU
 
 TEST(DeviceManagerTest, AvailableMemory) {
@@ -679,6 +859,561 @@ TEST(DeviceManagerTest, AvailableMemory) {
   EXPECT_EQ(cpuDeviceDefault.getMaximumMemory(), 2000000000);
 }
 
+/// Check that a CPU device splitting its kernels across several intra-op
+/// threads computes the same results as a serial computation.
+TEST(DeviceManagerTest, CPUIntraOpThreads) {
+  auto module = llvm::make_unique<Module>();
+  Function *F = module->createFunction("main");
+  auto *lhs = module->createPlaceholder(ElemKind::FloatTy, {64, 128}, "lhs",
+                                        false);
+  auto *rhs = module->createPlaceholder(ElemKind::FloatTy, {128, 256}, "rhs",
+                                        false);
+  auto *output = module->createPlaceholder(ElemKind::FloatTy, {64, 256},
+                                           "output", false);
+  auto *MM = F->createMatMul("matmul", lhs, rhs);
+  F->createSave("ret", MM, output);
+
+  std::vector<std::unique_ptr<CompiledFunction>> backing;
+  FunctionMapTy functions = compileFunctions("CPU", module.get(), backing);
+
+  auto config = DeviceConfig("CPU");
+  config.parameters["intraOpThreads"] = "4";
+  CPUDeviceManager cpuDevice(config);
+  ASSERT_FALSE(ERR_TO_BOOL(cpuDevice.init()));
+  EXPECT_EQ(cpuDevice.getNumIntraOpThreads(), 4);
+
+  std::promise<const Module *> promise;
+  std::future<const Module *> future;
+  std::tie(promise, future) = getFutureHelper<const Module *>();
+  cpuDevice.addNetwork(module.get(), std::move(functions),
+                       [&promise](const Module *module, Error err) {
+                         callbackHelper(promise, module, std::move(err));
+                       });
+  future.wait_for(std::chrono::seconds(2));
+  EXPECT_EQ(future.get(), module.get());
+
+  std::unique_ptr<ExecutionContext> context =
+      llvm::make_unique<ExecutionContext>();
+  auto *bindings = context->getPlaceholderBindings();
+  bindings->allocate(module->getPlaceholders());
+  auto LH = bindings->get(lhs)->getHandle();
+  auto RH = bindings->get(rhs)->getHandle();
+  LH.randomize(-1.0, 1.0, module->getPRNG());
+  RH.randomize(-1.0, 1.0, module->getPRNG());
+
+  Tensor expected(ElemKind::FloatTy, {64, 256});
+  auto EH = expected.getHandle();
+  for (size_t i = 0; i < 64; i++) {
+    for (size_t j = 0; j < 256; j++) {
+      float sum = 0;
+      for (size_t k = 0; k < 128; k++) {
+        sum += LH.at({i, k}) * RH.at({k, j});
+      }
+      EH.at({i, j}) = sum;
+    }
+  }
+
+  std::promise<std::unique_ptr<ExecutionContext>> runPromise;
+  std::future<std::unique_ptr<ExecutionContext>> runFuture;
+  std::tie(runPromise, runFuture) =
+      getFutureHelper<std::unique_ptr<ExecutionContext>>();
+  cpuDevice.runFunction("main", std::move(context),
+                        [&runPromise](RunIdentifierTy, Error err,
+                                      std::unique_ptr<ExecutionContext> ctx) {
+                          callbackHelper(runPromise, std::move(ctx),
+                                         std::move(err));
+                        });
+  runFuture.wait_for(std::chrono::seconds(2));
+  context = runFuture.get();
+  ASSERT_TRUE(context);
+
+  Tensor *result = context->getPlaceholderBindings()->get(output);
+  ASSERT_TRUE(result);
+  EXPECT_TRUE(result->isEqual(expected, 0.001));
+
+  EXPECT_FALSE(ERR_TO_BOOL(cpuDevice.stop()));
+}
+
+/// Check that a CPU device given a NUMA node pins its threads to the CPUs of
+/// the node, and still runs requests on them.
+TEST(DeviceManagerTest, CPUNumaNode) {
+  auto module = makeBasicModule();
+  std::vector<std::unique_ptr<CompiledFunction>> backing;
+  FunctionMapTy functions = compileFunctions("CPU", module.get(), backing);
+
+  auto config = DeviceConfig("CPU");
+  config.parameters["numaNode"] = "0";
+  config.parameters["intraOpThreads"] = "2";
+  config.parameters["executionLanes"] = "2";
+  EXPECT_EQ(config.getNumaNode(), 0);
+  CPUDeviceManager cpuDevice(config);
+  ASSERT_FALSE(ERR_TO_BOOL(cpuDevice.init()));
+  // Hosts whose topology is unknown have no CPUs for the node.
+  EXPECT_EQ(cpuDevice.getNumaCPUs(), getNumaNodeCPUs(0));
+
+  std::promise<const Module *> promise;
+  std::future<const Module *> future;
+  std::tie(promise, future) = getFutureHelper<const Module *>();
+  cpuDevice.addNetwork(module.get(), std::move(functions),
+                       [&promise](const Module *module, Error err) {
+                         callbackHelper(promise, module, std::move(err));
+                       });
+  future.wait_for(std::chrono::seconds(2));
+  EXPECT_EQ(future.get(), module.get());
+
+  std::unique_ptr<ExecutionContext> context =
+      llvm::make_unique<ExecutionContext>();
+  context->getPlaceholderBindings()->allocate(module->getPlaceholders());
+  Tensor input(ElemKind::FloatTy, {1});
+  input.getHandle().clear(0.5);
+  updateInputPlaceholders(*context->getPlaceholderBindings(),
+                          {module->getPlaceholderByName("main_input")},
+                          {&input});
+
+  std::promise<std::unique_ptr<ExecutionContext>> runPromise;
+  std::future<std::unique_ptr<ExecutionContext>> runFuture;
+  std::tie(runPromise, runFuture) =
+      getFutureHelper<std::unique_ptr<ExecutionContext>>();
+  cpuDevice.runFunction("main", std::move(context),
+                        [&runPromise](RunIdentifierTy, Error err,
+                                      std::unique_ptr<ExecutionContext> ctx) {
+                          callbackHelper(runPromise, std::move(ctx),
+                                         std::move(err));
+                        });
+  runFuture.wait_for(std::chrono::seconds(2));
+  context = runFuture.get();
+  ASSERT_TRUE(context);
+  Tensor *result = context->getPlaceholderBindings()->get(
+      module->getPlaceholderByName("main_output"));
+  ASSERT_TRUE(result);
+  EXPECT_FLOAT_EQ(result->getHandle().raw(0), std::tanh(0.5f));
+
+  EXPECT_FALSE(ERR_TO_BOOL(cpuDevice.stop()));
+}
+
+/// Request \p numRuns concurrent runs of the function "main" of \p module,
+/// made by makeBasicModule, on \p device and check their results.
+static void checkConcurrentRuns(DeviceManager &device, Module *module,
+                                unsigned numRuns) {
+  std::vector<std::promise<std::unique_ptr<ExecutionContext>>> runPromises(
+      numRuns);
+  std::vector<std::future<std::unique_ptr<ExecutionContext>>> runFutures;
+  std::vector<Tensor> expected;
+  for (unsigned i = 0; i < numRuns; i++) {
+    std::unique_ptr<ExecutionContext> context =
+        llvm::make_unique<ExecutionContext>();
+    context->getPlaceholderBindings()->allocate(module->getPlaceholders());
+
+    float in = float(i) / numRuns;
+    Tensor input(ElemKind::FloatTy, {1});
+    input.getHandle().clear(in);
+    expected.emplace_back(ElemKind::FloatTy, std::vector<size_t>{1});
+    expected.back().getHandle().clear(std::max(std::tanh(in), 0.25f));
+    updateInputPlaceholders(*context->getPlaceholderBindings(),
+                            {module->getPlaceholderByName("main_input")},
+                            {&input});
+
+    runFutures.push_back(runPromises[i].get_future());
+    device.runFunction(
+        "main", std::move(context),
+        [&runPromises, i](RunIdentifierTy, Error err,
+                          std::unique_ptr<ExecutionContext> ctx) {
+          callbackHelper(runPromises[i], std::move(ctx), std::move(err));
+        });
+  }
+
+  for (unsigned i = 0; i < numRuns; i++) {
+    runFutures[i].wait_for(std::chrono::seconds(2));
+    auto context = runFutures[i].get();
+    ASSERT_TRUE(context);
+    Tensor *result = context->getPlaceholderBindings()->get(
+        module->getPlaceholderByName("main_output"));
+    ASSERT_TRUE(result);
+    EXPECT_TRUE(result->isEqual(expected[i]));
+  }
+}
+
+/// Check that a CPU device with several execution lanes runs many concurrent
+/// requests correctly.
+TEST(DeviceManagerTest, CPUExecutionLanes) {
+  auto module = makeBasicModule();
+  std::vector<std::unique_ptr<CompiledFunction>> backing;
+  FunctionMapTy functions = compileFunctions("CPU", module.get(), backing);
+
+  auto config = DeviceConfig("CPU");
+  config.parameters["executionLanes"] = "3";
+  CPUDeviceManager cpuDevice(config);
+  ASSERT_FALSE(ERR_TO_BOOL(cpuDevice.init()));
+  EXPECT_EQ(cpuDevice.getNumExecutionLanes(), 3);
+
+  std::promise<const Module *> promise;
+  std::future<const Module *> future;
+  std::tie(promise, future) = getFutureHelper<const Module *>();
+  cpuDevice.addNetwork(module.get(), std::move(functions),
+                       [&promise](const Module *module, Error err) {
+                         callbackHelper(promise, module, std::move(err));
+                       });
+  future.wait_for(std::chrono::seconds(2));
+  EXPECT_EQ(future.get(), module.get());
+  EXPECT_FALSE(cpuDevice.isMemoryBound("main"));
+
+  checkConcurrentRuns(cpuDevice, module.get(), 20);
+
+  EXPECT_FALSE(ERR_TO_BOOL(cpuDevice.stop()));
+}
+
+/// Check that the runs of a function hinted as memory bound all complete
+/// when only one of them may run at a time on a CPU device with several
+/// execution lanes.
+TEST(DeviceManagerTest, CPUMemoryBoundRuns) {
+  auto module = makeBasicModule();
+  std::unique_ptr<Backend> backend(createBackend("CPU"));
+  CompilationContext cctx;
+  cctx.compMode = CompilationMode::Infer;
+  cctx.backendOpts.backendHints.memoryBound = true;
+  Function *F = module->getFunction("main");
+  EXIT_ON_ERR(::glow::optimizeFunction(F, *backend, cctx));
+  auto compiled = EXIT_ON_ERR(backend->compile(F, cctx.backendOpts));
+  FunctionMapTy functions = {{"main", compiled.get()}};
+
+  auto config = DeviceConfig("CPU");
+  config.parameters["executionLanes"] = "3";
+  config.parameters["memoryBoundRuns"] = "1";
+  CPUDeviceManager cpuDevice(config);
+  ASSERT_FALSE(ERR_TO_BOOL(cpuDevice.init()));
+  EXPECT_EQ(cpuDevice.getMaxMemoryBoundRuns(), 1);
+
+  std::promise<const Module *> promise;
+  std::future<const Module *> future;
+  std::tie(promise, future) = getFutureHelper<const Module *>();
+  cpuDevice.addNetwork(module.get(), std::move(functions),
+                       [&promise](const Module *module, Error err) {
+                         callbackHelper(promise, module, std::move(err));
+                       });
+  future.wait_for(std::chrono::seconds(2));
+  EXPECT_EQ(future.get(), module.get());
+  EXPECT_TRUE(cpuDevice.isMemoryBound("main"));
+
+  checkConcurrentRuns(cpuDevice, module.get(), 20);
+
+  EXPECT_FALSE(ERR_TO_BOOL(cpuDevice.stop()));
+}
+
+/// Check that functions compiled with -llvm-tiered-compile serve before and
+/// after they are recompiled with full optimizations in the background.
+TEST(DeviceManagerTest, CPUTieredCompile) {
+  auto *tieredOpt = static_cast<llvm::cl::opt<bool> *>(
+      llvm::cl::getRegisteredOptions()["llvm-tiered-compile"]);
+  ASSERT_TRUE(tieredOpt);
+  *tieredOpt = true;
+  auto module = makeBasicModule();
+  std::vector<std::unique_ptr<CompiledFunction>> backing;
+  FunctionMapTy functions = compileFunctions("CPU", module.get(), backing);
+  *tieredOpt = false;
+  ASSERT_EQ(backing.size(), 1u);
+  auto *function = static_cast<LLVMCompiledFunction *>(backing[0].get());
+  EXPECT_EQ(function->getOptLevel(), 0u);
+  EXPECT_TRUE(function->getTierUpIR());
+
+  CPUDeviceManager cpuDevice(DeviceConfig("CPU"));
+  ASSERT_FALSE(ERR_TO_BOOL(cpuDevice.init()));
+
+  std::promise<const Module *> promise;
+  std::future<const Module *> future;
+  std::tie(promise, future) = getFutureHelper<const Module *>();
+  cpuDevice.addNetwork(module.get(), std::move(functions),
+                       [&promise](const Module *module, Error err) {
+                         callbackHelper(promise, module, std::move(err));
+                       });
+  future.wait_for(std::chrono::seconds(2));
+  EXPECT_EQ(future.get(), module.get());
+  // The recompilation must not depend on the constants of the module, which
+  // the HostManager clears once the network is added.
+  module->strip();
+
+  auto runAndCheck = [&](float in) {
+    std::unique_ptr<ExecutionContext> context =
+        llvm::make_unique<ExecutionContext>();
+    context->getPlaceholderBindings()->allocate(module->getPlaceholders());
+    Tensor input(ElemKind::FloatTy, {1});
+    input.getHandle().clear(in);
+    Tensor expected(ElemKind::FloatTy, {1});
+    expected.getHandle().clear(std::max(std::tanh(in), 0.25f));
+    updateInputPlaceholders(*context->getPlaceholderBindings(),
+                            {module->getPlaceholderByName("main_input")},
+                            {&input});
+
+    std::promise<std::unique_ptr<ExecutionContext>> runPromise;
+    std::future<std::unique_ptr<ExecutionContext>> runFuture;
+    std::tie(runPromise, runFuture) =
+        getFutureHelper<std::unique_ptr<ExecutionContext>>();
+    cpuDevice.runFunction("main", std::move(context),
+                          [&runPromise](RunIdentifierTy, Error err,
+                                        std::unique_ptr<ExecutionContext> ctx) {
+                            callbackHelper(runPromise, std::move(ctx),
+                                           std::move(err));
+                          });
+    runFuture.wait_for(std::chrono::seconds(2));
+    context = runFuture.get();
+    ASSERT_TRUE(context);
+    Tensor *result = context->getPlaceholderBindings()->get(
+        module->getPlaceholderByName("main_output"));
+    ASSERT_TRUE(result);
+    EXPECT_TRUE(result->isEqual(expected));
+  };
+
+  runAndCheck(0.5);
+  for (unsigned i = 0; i < 100 && cpuDevice.getNumTieredFunctions() == 0;
+       i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+  EXPECT_EQ(cpuDevice.getNumTieredFunctions(), 1u);
+  runAndCheck(0.75);
+
+  std::promise<std::string> evictPromise;
+  std::future<std::string> evictFuture;
+  std::tie(evictPromise, evictFuture) = getFutureHelper<std::string>();
+  cpuDevice.evictNetwork(
+      "main", [&evictPromise](std::string functionName, Error err) {
+        callbackHelper(evictPromise, functionName, std::move(err));
+      });
+  evictFuture.wait_for(std::chrono::seconds(2));
+  EXPECT_EQ(evictFuture.get(), "main");
+  EXPECT_EQ(cpuDevice.getNumTieredFunctions(), 0u);
+
+  EXPECT_FALSE(ERR_TO_BOOL(cpuDevice.stop()));
+}
+
+/// Check that placeholders are accessed in place when functions are compiled
+/// with -llvm-zero-copy-placeholders, and copied when they are misaligned.
+TEST(DeviceManagerTest, CPUZeroCopyPlaceholders) {
+  auto *zeroCopyOpt = static_cast<llvm::cl::opt<bool> *>(
+      llvm::cl::getRegisteredOptions()["llvm-zero-copy-placeholders"]);
+  ASSERT_TRUE(zeroCopyOpt);
+  *zeroCopyOpt = true;
+  auto module = makeBasicModule();
+  std::vector<std::unique_ptr<CompiledFunction>> backing;
+  FunctionMapTy functions = compileFunctions("CPU", module.get(), backing);
+  *zeroCopyOpt = false;
+  ASSERT_EQ(backing.size(), 1u);
+
+  auto *inputPH = module->getPlaceholderByName("main_input");
+  auto *outputPH = module->getPlaceholderByName("main_output");
+  ExecutionContext context;
+  auto *bindings = context.getPlaceholderBindings();
+
+  // Tensors allocated by the bindings are suitably aligned.
+  bindings->allocate(module->getPlaceholders());
+  bindings->get(inputPH)->getHandle().clear(0.5f);
+  ASSERT_FALSE(ERR_TO_BOOL(backing[0]->execute(&context)));
+  EXPECT_FLOAT_EQ(bindings->get(outputPH)->getHandle().at({0}),
+                  std::max(std::tanh(0.5f), 0.25f));
+
+  // Misaligned tensors fall back to copying.
+  alignas(TensorAlignment) float storage[4] = {0, 0.75f, 0, 0};
+  bindings->erase(inputPH);
+  bindings->erase(outputPH);
+  bindings->insert(inputPH, Tensor(&storage[1], inputPH->getType()));
+  bindings->insert(outputPH, Tensor(&storage[2], outputPH->getType()));
+  ASSERT_FALSE(ERR_TO_BOOL(backing[0]->execute(&context)));
+  EXPECT_FLOAT_EQ(storage[2], std::max(std::tanh(0.75f), 0.25f));
+}
+
+/// Check that functions compiled with -llvm-compile-cache-dir store their
+/// object code in the cache, and that identical functions compiled later load
+/// it from the cache and compute the same results.
+TEST(DeviceManagerTest, CPUCompileCache) {
+  auto *cacheDirOpt = static_cast<llvm::cl::opt<std::string> *>(
+      llvm::cl::getRegisteredOptions()["llvm-compile-cache-dir"]);
+  ASSERT_TRUE(cacheDirOpt);
+  llvm::SmallString<64> cacheDir;
+  ASSERT_FALSE(
+      llvm::sys::fs::createUniqueDirectory("glow-compile-cache", cacheDir));
+  *cacheDirOpt = cacheDir.str();
+  auto countCacheFiles = [&cacheDir]() {
+    unsigned count = 0;
+    std::error_code EC;
+    for (llvm::sys::fs::directory_iterator it(cacheDir, EC), e;
+         it != e && !EC; it.increment(EC)) {
+      count++;
+    }
+    return count;
+  };
+
+  std::vector<std::unique_ptr<Module>> modules;
+  std::vector<std::unique_ptr<CompiledFunction>> backing;
+  modules.push_back(makeBasicModule());
+  compileFunctions("CPU", modules.back().get(), backing);
+  EXPECT_EQ(countCacheFiles(), 1u);
+  modules.push_back(makeBasicModule());
+  compileFunctions("CPU", modules.back().get(), backing);
+  EXPECT_EQ(countCacheFiles(), 1u);
+  modules.push_back(makeBasicModule("other"));
+  compileFunctions("CPU", modules.back().get(), backing);
+  EXPECT_EQ(countCacheFiles(), 2u);
+  *cacheDirOpt = "";
+  ASSERT_EQ(backing.size(), modules.size());
+
+  for (size_t i = 0; i < modules.size(); i++) {
+    auto *F = modules[i]->getFunctions().front();
+    auto name = F->getName().str();
+    ExecutionContext context;
+    auto *bindings = context.getPlaceholderBindings();
+    bindings->allocate(modules[i]->getPlaceholders());
+    bindings->get(modules[i]->getPlaceholderByName(name + "_input"))
+        ->getHandle()
+        .clear(0.5f);
+    ASSERT_FALSE(ERR_TO_BOOL(backing[i]->execute(&context)));
+    EXPECT_FLOAT_EQ(
+        bindings->get(modules[i]->getPlaceholderByName(name + "_output"))
+            ->getHandle()
+            .at({0}),
+        std::max(std::tanh(0.5f), 0.25f));
+  }
+  llvm::sys::fs::remove_directories(cacheDir);
+}
+
+/// Check that functions compiled with -llvm-share-specializations compile the
+/// specialized kernels of a shape once and run correctly.
+TEST(DeviceManagerTest, CPUShareSpecializations) {
+  auto *shareOpt = static_cast<llvm::cl::opt<bool> *>(
+      llvm::cl::getRegisteredOptions()["llvm-share-specializations"]);
+  ASSERT_TRUE(shareOpt);
+  *shareOpt = true;
+
+  auto makePoolModule = []() {
+    auto module = llvm::make_unique<Module>();
+    Function *F = module->createFunction("main");
+    auto *input = module->createPlaceholder(ElemKind::FloatTy, {1, 4, 4, 1},
+                                            "main_input", false);
+    auto *pool = F->createMaxPool("pool", input, 2, 2, 0);
+    auto *output = module->createPlaceholder(ElemKind::FloatTy, {1, 2, 2, 1},
+                                             "main_output", false);
+    F->createSave("save", pool->getResult(), output);
+    return module;
+  };
+
+  std::vector<std::unique_ptr<Module>> modules;
+  std::vector<std::unique_ptr<CompiledFunction>> backing;
+  modules.push_back(makePoolModule());
+  compileFunctions("CPU", modules.back().get(), backing);
+  size_t numKernels = SpecializationCache::get().size();
+  modules.push_back(makePoolModule());
+  compileFunctions("CPU", modules.back().get(), backing);
+  EXPECT_EQ(SpecializationCache::get().size(), numKernels);
+  *shareOpt = false;
+  ASSERT_EQ(backing.size(), modules.size());
+
+  for (size_t i = 0; i < modules.size(); i++) {
+    ExecutionContext context;
+    auto *bindings = context.getPlaceholderBindings();
+    bindings->allocate(modules[i]->getPlaceholders());
+    auto inputH = bindings->get(modules[i]->getPlaceholderByName("main_input"))
+                      ->getHandle();
+    for (size_t j = 0; j < inputH.size(); j++) {
+      inputH.raw(j) = j;
+    }
+    ASSERT_FALSE(ERR_TO_BOOL(backing[i]->execute(&context)));
+    auto H = bindings->get(modules[i]->getPlaceholderByName("main_output"))
+                 ->getHandle();
+    EXPECT_FLOAT_EQ(H.at({0, 0, 0, 0}), 5);
+    EXPECT_FLOAT_EQ(H.at({0, 0, 1, 0}), 7);
+    EXPECT_FLOAT_EQ(H.at({0, 1, 0, 0}), 13);
+    EXPECT_FLOAT_EQ(H.at({0, 1, 1, 0}), 15);
+  }
+}
+
+/// Check that functions compiled with -llvm-inter-op-parallelism are split
+/// into segments, and compute the same results when the independent segments
+/// run concurrently on the intra-op threads.
+TEST(DeviceManagerTest, CPUInterOpParallelism) {
+  auto *interOpOpt = static_cast<llvm::cl::opt<bool> *>(
+      llvm::cl::getRegisteredOptions()["llvm-inter-op-parallelism"]);
+  ASSERT_TRUE(interOpOpt);
+  *interOpOpt = true;
+  auto module = llvm::make_unique<Module>();
+  Function *F = module->createFunction("main");
+  auto *lhs =
+      module->createPlaceholder(ElemKind::FloatTy, {16, 32}, "lhs", false);
+  auto *rhs1 =
+      module->createPlaceholder(ElemKind::FloatTy, {32, 64}, "rhs1", false);
+  auto *rhs2 =
+      module->createPlaceholder(ElemKind::FloatTy, {32, 64}, "rhs2", false);
+  auto *output =
+      module->createPlaceholder(ElemKind::FloatTy, {16, 64}, "output", false);
+  auto *MM1 = F->createMatMul("matmul1", lhs, rhs1);
+  auto *MM2 = F->createMatMul("matmul2", lhs, rhs2);
+  auto *add = F->createAdd("add", MM1, MM2);
+  F->createSave("ret", add, output);
+
+  std::vector<std::unique_ptr<CompiledFunction>> backing;
+  FunctionMapTy functions = compileFunctions("CPU", module.get(), backing);
+  *interOpOpt = false;
+  ASSERT_EQ(backing.size(), 1u);
+  auto *function = static_cast<LLVMCompiledFunction *>(backing[0].get());
+  EXPECT_GE(function->getNumSegments(), 3u);
+
+  auto config = DeviceConfig("CPU");
+  config.parameters["intraOpThreads"] = "4";
+  CPUDeviceManager cpuDevice(config);
+  ASSERT_FALSE(ERR_TO_BOOL(cpuDevice.init()));
+
+  std::promise<const Module *> promise;
+  std::future<const Module *> future;
+  std::tie(promise, future) = getFutureHelper<const Module *>();
+  cpuDevice.addNetwork(module.get(), std::move(functions),
+                       [&promise](const Module *module, Error err) {
+                         callbackHelper(promise, module, std::move(err));
+                       });
+  future.wait_for(std::chrono::seconds(2));
+  EXPECT_EQ(future.get(), module.get());
+
+  for (unsigned run = 0; run < 8; run++) {
+    std::unique_ptr<ExecutionContext> context =
+        llvm::make_unique<ExecutionContext>();
+    auto *bindings = context->getPlaceholderBindings();
+    bindings->allocate(module->getPlaceholders());
+    auto LH = bindings->get(lhs)->getHandle();
+    auto R1H = bindings->get(rhs1)->getHandle();
+    auto R2H = bindings->get(rhs2)->getHandle();
+    LH.randomize(-1.0, 1.0, module->getPRNG());
+    R1H.randomize(-1.0, 1.0, module->getPRNG());
+    R2H.randomize(-1.0, 1.0, module->getPRNG());
+
+    Tensor expected(ElemKind::FloatTy, {16, 64});
+    auto EH = expected.getHandle();
+    for (size_t i = 0; i < 16; i++) {
+      for (size_t j = 0; j < 64; j++) {
+        float sum = 0;
+        for (size_t k = 0; k < 32; k++) {
+          sum += LH.at({i, k}) * (R1H.at({k, j}) + R2H.at({k, j}));
+        }
+        EH.at({i, j}) = sum;
+      }
+    }
+
+    std::promise<std::unique_ptr<ExecutionContext>> runPromise;
+    std::future<std::unique_ptr<ExecutionContext>> runFuture;
+    std::tie(runPromise, runFuture) =
+        getFutureHelper<std::unique_ptr<ExecutionContext>>();
+    cpuDevice.runFunction("main", std::move(context),
+                          [&runPromise](RunIdentifierTy, Error err,
+                                        std::unique_ptr<ExecutionContext> ctx) {
+                            callbackHelper(runPromise, std::move(ctx),
+                                           std::move(err));
+                          });
+    runFuture.wait_for(std::chrono::seconds(2));
+    context = runFuture.get();
+    ASSERT_TRUE(context);
+
+    Tensor *result = context->getPlaceholderBindings()->get(output);
+    ASSERT_TRUE(result);
+    EXPECT_TRUE(result->isEqual(expected, 0.001));
+  }
+
+  EXPECT_FALSE(ERR_TO_BOOL(cpuDevice.stop()));
+}
+
 TEST(DeviceManagerTest, DummyDeviceManager) {
   DummyDeviceManager deviceManager{DeviceConfig("Interpreter")};
   ASSERT_FALSE(ERR_TO_BOOL(deviceManager.init()));
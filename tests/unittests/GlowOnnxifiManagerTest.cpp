@@ -18,7 +18,9 @@
 
 #include "gtest/gtest.h"
 
+#include <future>
 #include <thread>
+#include <vector>
 
 using namespace glow::onnxifi;
 
@@ -51,6 +53,29 @@ TEST(GlowOnnxifiManagerTest, EventTest) {
   EXPECT_FALSE(manager.isValid(event));
 }
 
+/// Test that the callback of an event runs with its status whether it is
+/// registered before or after the event is signalled.
+TEST(GlowOnnxifiManagerTest, EventCallbackTest) {
+  auto &manager = GlowOnnxifiManager::get();
+  for (bool signalFirst : {false, true}) {
+    auto *event = manager.createEvent();
+    std::promise<onnxStatus> promise;
+    auto future = promise.get_future();
+    if (signalFirst) {
+      EXPECT_TRUE(event->signal(ONNXIFI_STATUS_INTERNAL_ERROR));
+    }
+    EXPECT_TRUE(event->setCallback(
+        [&promise](onnxStatus status) { promise.set_value(status); }));
+    // Only one callback may be registered.
+    EXPECT_FALSE(event->setCallback([](onnxStatus) {}));
+    if (!signalFirst) {
+      EXPECT_TRUE(event->signal(ONNXIFI_STATUS_INTERNAL_ERROR));
+    }
+    EXPECT_EQ(future.get(), ONNXIFI_STATUS_INTERNAL_ERROR);
+    manager.release(event);
+  }
+}
+
 TEST(GlowOnnxifiManagerTest, GraphTest) {
   auto &manager = GlowOnnxifiManager::get();
   auto *backend = manager.createBackend("Interpreter",
@@ -105,3 +130,21 @@ TEST(GlowOnnxifiManagerTest, Concurrency) {
     t.join();
   }
 }
+
+/// Test that a tensor with a shorter middle dimension, e.g. a shorter
+/// sequence, is padded along it and that slicing it back restores it.
+TEST(GlowOnnxifiManagerTest, CopyTensorBox) {
+  const std::vector<float> src = {1, 2, 3, 4, 5, 6};
+  std::vector<float> padded(2 * 3 * 2, -1);
+  Graph::copyTensorBox(reinterpret_cast<const char *>(src.data()), {2, 1, 3},
+                       reinterpret_cast<char *>(padded.data()), {2, 2, 3},
+                       sizeof(float));
+  EXPECT_EQ(padded,
+            std::vector<float>({1, 2, 3, 0, 0, 0, 4, 5, 6, 0, 0, 0}));
+
+  std::vector<float> sliced(src.size(), -1);
+  Graph::copyTensorBox(reinterpret_cast<const char *>(padded.data()),
+                       {2, 2, 3}, reinterpret_cast<char *>(sliced.data()),
+                       {2, 1, 3}, sizeof(float));
+  EXPECT_EQ(sliced, src);
+}
@@ -298,6 +298,47 @@ TEST_P(GradCheck, gradientCheckBatchMatMul) {
                    &Inputs, &Outputs, 0.001, 0.01);
 }
 
+TEST_P(GradCheck, gradientCheckLSTMUnit) {
+  CHECK_IF_ENABLED();
+  PlaceholderBindings Bindings;
+  Placeholder *A, *Exp, *C;
+  SaveNode *Result;
+
+  constexpr size_t BatchSize{3}, HiddenSize{5};
+
+  for (auto *EE : engines_) {
+    auto &Mod = EE->getModule();
+    Bindings.clear();
+    Function *F = Mod.createFunction("main");
+
+    A = Mod.createPlaceholder(ElemKind::FloatTy, {BatchSize, 4 * HiddenSize},
+                              "A", /*isTrainable=*/false);
+    C = Mod.createPlaceholder(ElemKind::FloatTy, {BatchSize, HiddenSize}, "C",
+                              /*isTrainable=*/false);
+    Exp = Mod.createPlaceholder(ElemKind::FloatTy, {BatchSize, HiddenSize},
+                                "exp", /*isTrainable=*/false);
+    Bindings.allocate(C)->getHandle<float>().randomize(-1, 1, Mod.getPRNG());
+    auto *LU = F->createLSTMUnit("lstm", A, C);
+    // Both the hidden and the cell states are differentiated.
+    auto *add = F->createAdd("add", LU->getHidden(), LU->getCell());
+    auto *Reg = F->createRegression("reg", add, Exp);
+    Result = F->createSave("save", Reg);
+  }
+
+  Tensor Inputs(ElemKind::FloatTy, {BatchSize, 4 * HiddenSize});
+  Tensor Outputs(ElemKind::FloatTy, {BatchSize, HiddenSize});
+
+  auto InputsH = Inputs.getHandle<>();
+  auto OutputsH = Outputs.getHandle<>();
+  auto &Mod = EET_.getModule();
+
+  InputsH.randomize(-2, 2, Mod.getPRNG());
+  OutputsH.randomize(-1, 1, Mod.getPRNG());
+
+  performGradCheck(EET_, EEI_, Bindings, Result->getPlaceholder(), A, Exp,
+                   &Inputs, &Outputs, 0.001, 0.01);
+}
+
 TEST_P(GradCheck, gradientCheckTile) {
   CHECK_IF_ENABLED();
   PlaceholderBindings Bindings;
@@ -22,6 +22,7 @@
 
 #include "gtest/gtest.h"
 
+#include <algorithm>
 #include <cassert>
 #include <string>
 
@@ -389,3 +390,59 @@ TEST(GraphAutoGrad, checkAdaptiveAvgPoolGradTest) {
   glow::differentiate(F, TC);
   EE.compile(CompilationMode::Train);
 }
+
+/// Check that recomputing the activations in the backward pass computes the
+/// same gradients as keeping all the activations.
+TEST(GraphAutoGrad, recomputeActivations) {
+  ExecutionEngine EE;
+  PlaceholderBindings bindings;
+
+  auto &mod = EE.getModule();
+  Function *F = mod.createFunction("main");
+  auto *A = mod.createPlaceholder(ElemKind::FloatTy, {8, 16}, "input", false);
+  NodeValue H = A;
+  for (unsigned i = 0; i < 4; i++) {
+    auto *FC = F->createFullyConnected(bindings, "fc", H, 16);
+    H = F->createRELU("relu", FC);
+  }
+  auto *FC = F->createFullyConnected(bindings, "fc", H, 4);
+  auto *selected =
+      mod.createPlaceholder(ElemKind::Int64ITy, {8, 1}, "selected", false);
+  auto *SM = F->createSoftMax("sm", FC, selected);
+  F->createSave("return", SM);
+
+  TrainingConfig TC;
+  VariableGradientsList keptGrads;
+  Function *KF = glow::differentiate(F, TC, "kept", &keptGrads);
+  // A budget so small that only the checkpoints are kept.
+  TC.activationsMemoryBudget = 1;
+  VariableGradientsList recomputedGrads;
+  Function *RF = glow::differentiate(F, TC, "recomputed", &recomputedGrads);
+
+  auto countBarriers = [](Function *G) {
+    return std::count_if(G->getNodes().begin(), G->getNodes().end(),
+                         [](const Node &N) {
+                           return llvm::isa<RecomputeBarrierNode>(&N);
+                         });
+  };
+  EXPECT_EQ(countBarriers(KF), 0);
+  EXPECT_GT(countBarriers(RF), 0);
+  ASSERT_EQ(keptGrads.size(), recomputedGrads.size());
+
+  EE.compile(CompilationMode::Train);
+  bindings.allocate(mod.getPlaceholders());
+  bindings.get(A)->getHandle().randomize(-1, 1, mod.getPRNG());
+  auto selectedH = bindings.get(selected)->getHandle<int64_t>();
+  for (size_t i = 0; i < 8; i++) {
+    selectedH.raw(i) = i % 4;
+  }
+  EE.run(bindings, "kept");
+  EE.run(bindings, "recomputed");
+
+  for (auto kept = keptGrads.begin(), recomputed = recomputedGrads.begin();
+       kept != keptGrads.end(); ++kept, ++recomputed) {
+    EXPECT_EQ(kept->first, recomputed->first);
+    EXPECT_TRUE(bindings.get(kept->second)
+                    ->isEqual(*bindings.get(recomputed->second)));
+  }
+}
@@ -15,15 +15,20 @@
  */
 #include "BackendTestUtils.h"
 
+#include "glow/Backends/LayoutConverter.h"
+#include "glow/ExecutionContext/TraceEvents.h"
 #include "glow/Graph/Graph.h"
 #include "glow/Graph/Node.h"
 #include "glow/Graph/Nodes.h"
 #include "glow/Graph/PlaceholderBindings.h"
 #include "glow/IR/IR.h"
 #include "glow/Optimizer/GraphOptimizer/GraphOptimizer.h"
+#include "glow/Optimizer/GraphOptimizerPipeline/Pipeline.h"
 
 #include "gtest/gtest.h"
 
+#include "llvm/Support/FileSystem.h"
+
 using namespace glow;
 
 class GraphOptz : public ::testing::Test {
@@ -1357,6 +1362,68 @@ TEST_F(GraphOptz, CSE) {
   EXPECT_EQ(F_->getNodes().size(), 3);
 }
 
+/// Check that CSE reports whether it changed the Function, so that the
+/// FunctionPassManager can skip passes on an unchanged Function.
+TEST_F(GraphOptz, CSEReportsChanges) {
+  Node *A1 = mod_.createPlaceholder(ElemKind::FloatTy, {1, 5, 10, 15}, "input1",
+                                    false);
+  Node *A2 = mod_.createPlaceholder(ElemKind::FloatTy, {1, 5, 10, 15}, "input2",
+                                    false);
+  Node *CN1 = F_->createConcat("concat1", {A1, A2}, 1);
+  Node *CN2 = F_->createConcat("concat2", {A1, A2}, 1);
+  Node *CN3 = F_->createConcat("concat3", {CN1, CN2}, 2);
+  F_->createSave("ret", CN3);
+
+  FunctionPassManager FPM("CSE_FPM", {{FunctionPassID::CSE}});
+  EXPECT_TRUE(FPM.run(F_, CompilationContext()));
+  EXPECT_FALSE(FPM.run(F_, CompilationContext()));
+}
+
+/// Check that the FunctionPassManager collects the statistics of its passes
+/// and traces them when asked to.
+TEST_F(GraphOptz, passStatsAndTrace) {
+  Node *A1 = mod_.createPlaceholder(ElemKind::FloatTy, {1, 5, 10, 15}, "input1",
+                                    false);
+  Node *A2 = mod_.createPlaceholder(ElemKind::FloatTy, {1, 5, 10, 15}, "input2",
+                                    false);
+  Node *CN1 = F_->createConcat("concat1", {A1, A2}, 1);
+  Node *CN2 = F_->createConcat("concat2", {A1, A2}, 1);
+  Node *CN3 = F_->createConcat("concat3", {CN1, CN2}, 2);
+  F_->createSave("ret", CN3);
+  const int64_t numNodes = F_->getNodes().size();
+
+  TraceContext traceContext(TraceLevel::COMPILE);
+  CompilationContext cctx;
+  cctx.optimizationOpts.collectPassStats = true;
+  cctx.traceContext = &traceContext;
+  FunctionPassManager FPM("opt",
+                          {{FunctionPassID::CSE}, {FunctionPassID::CSE}});
+  EXPECT_TRUE(FPM.run(F_, cctx));
+
+  // Both CSEs run after a DCE. The first DCE and the second CSE find nothing
+  // to change, the second DCE erases the Concat replaced by the first CSE.
+  const auto &stats = FPM.getPassStats();
+  ASSERT_EQ(stats.size(), 2);
+  const auto &CSEStats = stats.at(FunctionPassID::CSE);
+  const auto &DCEStats = stats.at(FunctionPassID::DCE);
+  EXPECT_EQ(CSEStats.numRuns, 2);
+  EXPECT_EQ(CSEStats.numChanges, 1);
+  EXPECT_EQ(DCEStats.numRuns, 2);
+  EXPECT_EQ(DCEStats.numChanges, 1);
+  EXPECT_EQ(CSEStats.nodesDelta + DCEStats.nodesDelta,
+            int64_t(F_->getNodes().size()) - numNodes);
+  EXPECT_EQ(DCEStats.nodesDelta, -1);
+  EXPECT_EQ(CSEStats.constantBytesDelta, 0);
+
+  auto &events = traceContext.getTraceEvents();
+  ASSERT_EQ(events.size(), 4);
+  EXPECT_EQ(events[0].name, "DCE");
+  EXPECT_EQ(events[1].name, "CSE");
+  EXPECT_EQ(events[1].type, TraceEvent::CompleteType);
+  EXPECT_EQ(events[1].args.at("function"), F_->getName());
+  EXPECT_EQ(events[1].args.at("changed"), "true");
+}
+
 TEST_F(GraphOptz, SliceOfSplatNode) {
   Type t(ElemKind::FloatTy, {1000, 1000, 1000});
   Node *Z = F_->createSplat("zero", &t, 0.);
@@ -2175,6 +2242,108 @@ TEST_F(GraphFold, foldLeakyReluFromConst) {
   EXPECT_EQ(input, newPReluNode->getInput());
 }
 
+/// This test checks that a LayerNormalization decomposed by an exporter is
+/// folded, with its scale and bias:
+/// (A - mean(A)) / Pow(mean((A - mean(A))^2) + eps, 0.5) * B + C
+/// -> LayerNormalization(A, B, C, eps)
+TEST_F(GraphFold, foldLayerNormalization) {
+  std::vector<size_t> dims = {3, 5};
+  auto *input = mod_.createPlaceholder(ElemKind::FloatTy, dims, "input", true);
+  auto *gamma = mod_.createConstant(ElemKind::FloatTy, {5}, "gamma");
+  gamma->getHandle() = {1, 2, 3, 4, 5};
+  auto *beta = mod_.createConstant(ElemKind::FloatTy, {5}, "beta");
+  beta->getHandle() = {-1, 0, 1, 2, 3};
+
+  const float epsilon = 1e-3f;
+  auto *mean = F_->createBatchedReduceMean("mean", input, {1});
+  auto *meanB = F_->createBroadcast("meanB", mean, dims, /* axis */ 0);
+  auto *diff = F_->createSub("diff", input, meanB);
+  auto *diffSq = F_->createMul("diffSq", diff, diff);
+  auto *var = F_->createBatchedReduceMean("var", diffSq, {1});
+  auto *eps = F_->createSplat("eps", var->getResult().getType(), epsilon);
+  auto *varEps = F_->createAdd("varEps", var, eps);
+  auto *stdDev = F_->createPow("stdDev", varEps, 0.5);
+  auto *stdDevB = F_->createBroadcast("stdDevB", stdDev, dims, /* axis */ 0);
+  auto *norm = F_->createDiv("norm", diff, stdDevB);
+  auto *gammaB = F_->createBroadcast("gammaB", gamma, dims, /* axis */ 1);
+  auto *scaled = F_->createMul("scaled", norm, gammaB);
+  auto *betaB = F_->createBroadcast("betaB", beta, dims, /* axis */ 1);
+  auto *shifted = F_->createAdd("shifted", scaled, betaB);
+  SaveNode *output = F_->createSave("save", shifted);
+
+  ::glow::fold(F_, CompilationMode::Infer);
+
+  // The Reshapes of the scale and the bias are left.
+  EXPECT_EQ(4, F_->getNodes().size());
+  auto *LN = llvm::dyn_cast<LayerNormalizationNode>(output->getInput());
+  ASSERT_TRUE(LN);
+  EXPECT_EQ(input, LN->getInput());
+  EXPECT_EQ(epsilon, LN->getEpsilon());
+  auto *scale = llvm::dyn_cast<ReshapeNode>(LN->getScale());
+  ASSERT_TRUE(scale);
+  EXPECT_EQ(scale->getResult().dims().vec(), std::vector<size_t>({5}));
+  auto *scaleC = llvm::dyn_cast<Constant>(scale->getInput());
+  ASSERT_TRUE(scaleC);
+  for (size_t i = 0; i < 5; i++) {
+    EXPECT_EQ(scaleC->getHandle().raw(i), gamma->getHandle().raw(i));
+  }
+}
+
+/// Creates the DLRM feature interactions of three {2, 4} inputs as the Caffe2
+/// loader does: the lower triangle of BatchMatMul(X, X^T), with \p pairs as
+/// the gathered indices, where X reshapes the concatenated \p inputs to
+/// {2, 3, 4}. \returns the Save of the interactions.
+static SaveNode *createInteractions(Module &mod, Function *F,
+                                    std::vector<NodeValue> &inputs,
+                                    llvm::ArrayRef<int32_t> pairs) {
+  for (size_t i = 0; i < 3; i++) {
+    inputs.push_back(mod.createPlaceholder(
+        ElemKind::FloatTy, {2, 4}, "input" + std::to_string(i), false));
+  }
+  auto *concat = F->createConcat("cat", inputs, 1);
+  auto *X = F->createReshape("X", concat, {2, 3, 4});
+  auto *XT = F->createTranspose("XT", X, {0, 2, 1});
+  auto *Z = F->createBatchMatMul("Z", X, XT);
+  auto *flat = F->createReshape("flat", Z, {2, 9});
+  auto *indices =
+      mod.createConstant(ElemKind::Int32ITy, {pairs.size()}, "indices");
+  indices->getHandle<int32_t>() = pairs;
+  auto *gather = F->createGather("gather", flat, indices, /* batchDims */ 1);
+  return F->createSave("save", gather);
+}
+
+/// This test checks that the lower triangle of the products of the inputs
+/// gathered from BatchMatMul(X, X^T) is folded into a
+/// BatchedPairwiseDotProduct of the inputs.
+TEST_F(GraphFold, foldPairwiseDotProducts) {
+  std::vector<NodeValue> inputs;
+  SaveNode *save = createInteractions(mod_, F_, inputs, {3, 6, 7});
+
+  ::glow::fold(F_, CompilationMode::Infer);
+
+  EXPECT_EQ(2, F_->getNodes().size());
+  auto *BPDP =
+      llvm::dyn_cast<BatchedPairwiseDotProductNode>(save->getInput());
+  ASSERT_TRUE(BPDP);
+  ASSERT_EQ(3, BPDP->getInputs().size());
+  for (size_t i = 0; i < 3; i++) {
+    EXPECT_EQ(inputs[i], BPDP->getInputs()[i]);
+  }
+}
+
+/// This test checks that products gathered in another order than the lower
+/// triangle are not folded.
+TEST_F(GraphFold, foldPairwiseDotProductsUpperTriangle) {
+  std::vector<NodeValue> inputs;
+  createInteractions(mod_, F_, inputs, {1, 2, 5});
+
+  ::glow::fold(F_, CompilationMode::Infer);
+
+  EXPECT_EQ(
+      countNodeKind(F_, Kinded::Kind::BatchedPairwiseDotProductNodeKind), 0);
+  EXPECT_EQ(countNodeKind(F_, Kinded::Kind::BatchMatMulNodeKind), 1);
+}
+
 /// Testing folding of Reshape->Transpose->Reshape into ChannelShuffle.
 TEST_F(GraphFold, foldChannelShuffle) {
   const size_t inputDims[] = {3, 136, 28, 28};
@@ -2380,6 +2549,104 @@ TEST_F(GraphOptz, mergeMatMulNodes) {
   EXPECT_EQ(countNodeKind(F_, Kinded::Kind::MatMulNodeKind), 1);
 }
 
+// Check that we are able to merge the fully connected nodes of an input.
+TEST_F(GraphOptz, mergeParallelFCNodes) {
+  auto *input =
+      mod_.createPlaceholder(ElemKind::FloatTy, {4, 16}, "input", false);
+  for (size_t i = 0; i < 4; i++) {
+    auto *FC = F_->createFullyConnected(bindings_, "fc", input, 8 + i);
+    F_->createSave("save", FC);
+  }
+  ::glow::convertPlaceholdersToConstants(F_, bindings_, {input});
+
+  EXPECT_EQ(countNodeKind(F_, Kinded::Kind::FullyConnectedNodeKind), 4);
+  optimizedF_ = optimizeFunction(F_);
+
+  // Check that all of the FCs are merged into a single FC node.
+  EXPECT_EQ(countNodeKind(optimizedF_, Kinded::Kind::FullyConnectedNodeKind),
+            1);
+  EXPECT_EQ(countNodeKind(optimizedF_, Kinded::Kind::SliceNodeKind), 4);
+
+  bindings_.allocate(mod_.getPlaceholders());
+  bindings_.get(input)->getHandle().randomize(-1.0, 1.0, mod_.getPRNG());
+  checkNumericalEquivalence();
+}
+
+// Check that fully connected nodes of different inputs are grouped into a
+// batched matmul only when asked to.
+TEST_F(GraphOptz, groupParallelFCNodesIntoBatchMatMul) {
+  std::vector<Placeholder *> inputs;
+  for (size_t i = 0; i < 4; i++) {
+    auto *input =
+        mod_.createPlaceholder(ElemKind::FloatTy, {4, 16}, "input", false);
+    auto *FC = F_->createFullyConnected(bindings_, "fc", input, 8);
+    F_->createSave("save", FC);
+    inputs.push_back(input);
+  }
+  ::glow::convertPlaceholdersToConstants(F_, bindings_, inputs);
+
+  // By default the FCs are left alone.
+  auto *defaultF = optimizeFunction(F_);
+  EXPECT_EQ(countNodeKind(defaultF, Kinded::Kind::FullyConnectedNodeKind), 4);
+  EXPECT_EQ(countNodeKind(defaultF, Kinded::Kind::BatchMatMulNodeKind), 0);
+
+  optimizedF_ = F_->clone(F_->getName().str() + "_grouped");
+  CompilationContext cctx;
+  cctx.compMode = CompilationMode::Infer;
+  cctx.optimizationOpts.groupParallelFCsIntoBatchMatMul = true;
+  ::glow::optimize(optimizedF_, cctx);
+  EXPECT_EQ(countNodeKind(optimizedF_, Kinded::Kind::FullyConnectedNodeKind),
+            0);
+  EXPECT_EQ(countNodeKind(optimizedF_, Kinded::Kind::BatchMatMulNodeKind), 1);
+
+  bindings_.allocate(mod_.getPlaceholders());
+  for (auto *input : inputs) {
+    bindings_.get(input)->getHandle().randomize(-1.0, 1.0, mod_.getPRNG());
+  }
+  checkNumericalEquivalence();
+}
+
+/// Check that FusedRowwiseQuantizedSparseLengthsWeightedSum nodes of tables of
+/// the same width are grouped into a single node.
+TEST_F(GraphOptz, groupFusedRowwiseQuantizedSLWSNodes) {
+  Tensor data0(ElemKind::FloatTy, {10, 8});
+  Tensor data1(ElemKind::FloatTy, {6, 8});
+  data0.getHandle().randomize(-1.0, 1.0, mod_.getPRNG());
+  data1.getHandle().randomize(-1.0, 1.0, mod_.getPRNG());
+
+  for (size_t i = 0; i < 3; i++) {
+    auto *weights = mod_.createPlaceholder(ElemKind::FloatTy, {5}, "weights",
+                                           false);
+    auto *indices = mod_.createPlaceholder(ElemKind::Int64ITy, {5}, "indices",
+                                           false);
+    auto *lengths = mod_.createPlaceholder(ElemKind::Int32ITy, {2}, "lengths",
+                                           false);
+    auto *SLWS = F_->createFusedRowwiseQuantizedSparseLengthsWeightedSum(
+        "slws", i == 1 ? data1 : data0, weights, indices, lengths);
+    F_->createSave("save", SLWS);
+
+    bindings_.allocate(weights)->getHandle().randomize(-1.0, 1.0,
+                                                       mod_.getPRNG());
+    bindings_.allocate(indices)->getHandle<int64_t>() = {0, 5, 3, 4, 1};
+    bindings_.allocate(lengths)->getHandle<int32_t>() = {2, 3};
+  }
+
+  optimizedF_ = F_->clone(F_->getName().str() + "_grouped");
+  FunctionPassManager FPM(
+      "opt", {{FunctionPassID::GroupFusedRowwiseQuantizedSLWS},
+              getDCEPassConfig()});
+  EXPECT_TRUE(FPM.run(optimizedF_, CompilationContext()));
+  ASSERT_TRUE(optimizedF_->verify());
+  auto SLWSKind =
+      Kinded::Kind::FusedRowwiseQuantizedSparseLengthsWeightedSumNodeKind;
+  auto groupedSLWSKind = Kinded::Kind::
+      GroupedFusedRowwiseQuantizedSparseLengthsWeightedSumNodeKind;
+  EXPECT_EQ(countNodeKind(optimizedF_, SLWSKind), 0);
+  EXPECT_EQ(countNodeKind(optimizedF_, groupedSLWSKind), 1);
+
+  checkNumericalEquivalence();
+}
+
 // Check that we are able to merge batched adds.
 TEST_F(GraphOptz, mergeBANodes) {
   Node *input =
@@ -2650,6 +2917,34 @@ TEST_F(GraphOptz, VarsCSE) {
   EXPECT_TRUE(input3->getUsers().begin()->getUser() == RN);
 }
 
+/// Check that large Constants are deduplicated too, and that Constants which
+/// only differ in elements the hash doesn't sample are kept apart.
+TEST_F(GraphOptz, VarsCSELarge) {
+  auto *input1 = mod_.createConstant(ElemKind::FloatTy, {4096}, "input1");
+  auto *input2 = mod_.createConstant(ElemKind::FloatTy, {4096}, "input2");
+  auto *input3 = mod_.createConstant(ElemKind::FloatTy, {4096}, "input3");
+  input1->getPayloadMutable().zero();
+  input2->getPayloadMutable().zero();
+  input3->getPayloadMutable().zero();
+  input3->getHandle().raw(4095) = 1;
+
+  auto *TN = F_->createTanh("tanh", input1);
+  auto *SN = F_->createSigmoid("sigmoid", input2);
+  auto *RN = F_->createRELU("relu", input3);
+  auto *CN = F_->createConcat("concat", {TN, SN, RN}, /* axis */ 0);
+  F_->createSave("ret", CN);
+
+  CompilationContext cctx;
+  cctx.compMode = CompilationMode::Infer;
+  // Do not perform any compile-time constant folding.
+  cctx.optimizationOpts.enableConstantFolding = false;
+  ::glow::optimize(F_, cctx);
+
+  EXPECT_EQ(mod_.getConstants().size(), 2);
+  EXPECT_EQ(TN->getInput().getNode(), SN->getInput().getNode());
+  EXPECT_EQ(RN->getInput().getNode(), input3);
+}
+
 TEST_F(GraphOptz, VarsCSENaN) {
   // Create two variables that are Private, are not trainable, have no writers
   // and include NaNs. The first two variables have the same data, and so should
@@ -3243,6 +3538,42 @@ TEST_F(GraphOptz, constantFoldWholeFunction) {
   EXPECT_EQ(CH.at({1, 1}), 76.0f);
 }
 
+/// Build two independent constant operations in \p F of \p mod, one of which
+/// uses \p data. \returns the saves of their results.
+static std::pair<SaveNode *, SaveNode *>
+createIndependentConstantOps(Module &mod, Function *F, float data) {
+  auto *const1 = mod.createConstant(ElemKind::FloatTy, {2, 2}, "const1");
+  auto *const2 = mod.createConstant(ElemKind::FloatTy, {2, 2}, "const2");
+  setConstValue(const1, data);
+  setConstValue(const2, 2.0f);
+  auto *add = F->createAdd("add", const1, const2);
+  auto *transpose = F->createTranspose("transpose", const2, {1, 0});
+  auto *mul = F->createMul("mul", transpose, const2);
+  return {F->createSave("save1", add), F->createSave("save2", mul)};
+}
+
+/// Check that independent constant operations are folded together, and that
+/// folding the same operations in another Module gives the same results,
+/// whether they come from the cache or not.
+TEST_F(GraphOptz, constantFoldIndependentOps) {
+  for (float data : {1.0f, 1.0f, 3.0f}) {
+    Module mod;
+    Function *F = mod.createFunction("main");
+    auto saves = createIndependentConstantOps(mod, F, data);
+    ::glow::optimize(F, CompilationMode::Infer);
+
+    auto *C1 = llvm::dyn_cast<Constant>(saves.first->getInput());
+    auto *C2 = llvm::dyn_cast<Constant>(saves.second->getInput());
+    ASSERT_TRUE(C1);
+    ASSERT_TRUE(C2);
+    EXPECT_EQ(F->getNodes().size(), 2);
+    for (size_t i = 0; i < 4; i++) {
+      EXPECT_EQ(C1->getHandle().raw(i), data + 2.0f);
+      EXPECT_EQ(C2->getHandle().raw(i), 4.0f);
+    }
+  }
+}
+
 /// Test Splitting FC into multiple FCs.
 TEST_F(GraphOptz, SplitFCIntoMultipleOps) {
   auto *input =
@@ -3289,3 +3620,86 @@ TEST_F(GraphOptz, SplitFCIntoMultipleOps) {
     }
   }
 }
+
+/// Build a convolution followed by a relu and a max pool in \p F, \returns
+/// the save of the result.
+static SaveNode *createConvReluPool(Module &mod, Function *F) {
+  auto *input =
+      mod.createPlaceholder(ElemKind::FloatTy, {1, 8, 8, 4}, "input", false);
+  auto *filter = mod.createConstant(ElemKind::FloatTy, {4, 3, 3, 4}, "filter");
+  auto *bias = mod.createConstant(ElemKind::FloatTy, {4}, "bias");
+  auto outTy = mod.uniqueType(ElemKind::FloatTy, {1, 8, 8, 4});
+  auto *CV = F->createConv("conv", input, filter, bias, outTy, 3, 1, 1, 1);
+  auto *RL = F->createRELU("relu", CV);
+  auto *MP = F->createMaxPool("pool", RL, 2, 2, 0);
+  return F->createSave("save", MP->getResult());
+}
+
+/// Check that a region of NCHW friendly nodes is converted as a whole, with a
+/// single transpose for each value entering or leaving it.
+TEST_F(GraphOptz, assignNCHWLayoutsToRegion) {
+  auto *save = createConvReluPool(mod_, F_);
+
+  LayoutCosts costs;
+  costs.convNHWC = 4;
+  costs.poolNHWC = 2;
+  EXPECT_TRUE(assignNCHWLayouts(F_, costs, [](const Node *) { return true; }));
+  ::glow::optimize(F_, CompilationMode::Infer);
+  EXPECT_TRUE(F_->verify());
+
+  // The input and the result, the transpose of the filter is folded.
+  EXPECT_EQ(2, countNodeKind(F_, Kinded::Kind::TransposeNodeKind));
+  auto *TR = llvm::dyn_cast<TransposeNode>(save->getInput());
+  ASSERT_TRUE(TR);
+  EXPECT_TRUE(TR->getResult().dims().equals({1, 4, 4, 4}));
+  auto *MP = llvm::dyn_cast<MaxPoolNode>(TR->getInput());
+  ASSERT_TRUE(MP);
+  EXPECT_EQ(MP->getLayout(), NCHW);
+  auto *RL = llvm::dyn_cast<ReluNode>(MP->getInput());
+  ASSERT_TRUE(RL);
+  auto *CV = llvm::dyn_cast<ConvolutionNode>(RL->getInput());
+  ASSERT_TRUE(CV);
+  EXPECT_EQ(CV->getLayout(), NCHW);
+  EXPECT_TRUE(llvm::isa<TransposeNode>(CV->getInput()));
+}
+
+/// Check that a region stays in NHWC when its transposes cost more than it
+/// gains in NCHW.
+TEST_F(GraphOptz, assignNCHWLayoutsKeepsCheaperNHWC) {
+  createConvReluPool(mod_, F_);
+
+  LayoutCosts costs;
+  costs.convNHWC = 1.1;
+  costs.transpose = 10;
+  EXPECT_FALSE(
+      assignNCHWLayouts(F_, costs, [](const Node *) { return true; }));
+  EXPECT_EQ(0, countNodeKind(F_, Kinded::Kind::TransposeNodeKind));
+}
+
+/// Check that a pipeline written to YAML is read back unchanged.
+TEST(GraphOptzPipeline, yamlRoundTrip) {
+  auto pipeline = createDefaultGraphOptimizationPassPipeline();
+  pipeline.pushBack({FunctionPassID::FoldTileAddIntoBatchedAdd,
+                     ConvergenceMode::UntilFixedPoint,
+                     {CompilationMode::Train}});
+
+  llvm::SmallString<64> path;
+  ASSERT_FALSE(llvm::sys::fs::createTemporaryFile("pipeline", ".yaml", path));
+  ASSERT_FALSE(ERR_TO_BOOL(serializePipelineToYaml(path, pipeline)));
+  FunctionPassPipeline loaded;
+  ASSIGN_VALUE_OR_FAIL_TEST(loaded, deserializePipelineFromYaml(path));
+  llvm::sys::fs::remove(path);
+
+  ASSERT_EQ(pipeline.size(), loaded.size());
+  for (size_t i = 0, e = pipeline.size(); i < e; i++) {
+    const auto &expected = pipeline.at(i);
+    const auto &actual = loaded.at(i);
+    EXPECT_EQ(expected.getFunctionPassID(), actual.getFunctionPassID());
+    EXPECT_EQ(expected.getConvergenceMode(), actual.getConvergenceMode());
+    EXPECT_EQ(expected.getDCERequiredMode(), actual.getDCERequiredMode());
+    for (auto mode : {CompilationMode::Train, CompilationMode::Infer}) {
+      EXPECT_EQ(expected.isEnabledForCompilationMode(mode),
+                actual.isEnabledForCompilationMode(mode));
+    }
+  }
+}
@@ -161,3 +161,44 @@ TEST(GraphScheduler, ScheduleQuantizationProfileRightAfterNodeBeingProfiled) {
   // Expect the save node to be the last in the schedule.
   EXPECT_EQ(save, schedule.back());
 }
+
+/// Tests that PeakMemoryBasedScheduler computes a branch whose last node
+/// frees the memory of the branch before a branch which keeps its memory,
+/// and predicts the resulting peak.
+TEST(GraphScheduler, PeakMemoryBasedSchedulerFreesMemoryFirst) {
+  Module MD;
+  auto *smallTensorA =
+      MD.createPlaceholder(ElemKind::FloatTy, {1, 4, 4}, "small_1", false);
+  auto *smallTensorB =
+      MD.createPlaceholder(ElemKind::FloatTy, {1, 4, 4}, "small_2", false);
+  auto *bigTensor =
+      MD.createPlaceholder(ElemKind::FloatTy, {100, 4, 4}, "big", false);
+  Function *F = MD.createFunction("F");
+  Node *transposeBig = F->createTranspose("transposeBig", bigTensor, {0, 2, 1});
+  Node *sliceBig =
+      F->createSlice("sliceBig", transposeBig, {0, 0, 0}, {1, 4, 4});
+  Node *concatSmall =
+      F->createConcat("concatSmall", {smallTensorA, smallTensorB}, 0);
+  Node *concat = F->createConcat("concat", {concatSmall, sliceBig}, 0);
+  F->createSave("save", concat);
+
+  NodesPtrList schedule;
+  PeakMemoryBasedScheduler scheduler(*F, schedule);
+  scheduler.schedule();
+  ASSERT_EQ(schedule.size(), F->getNodes().size());
+
+  // transposeBig is only live until sliceBig, which must then come before
+  // concatSmall so that the latter doesn't add to the peak.
+  auto position = [&](Node *N) {
+    return std::distance(schedule.begin(),
+                         std::find(schedule.begin(), schedule.end(), N));
+  };
+  EXPECT_EQ(position(sliceBig), position(transposeBig) + 1);
+  EXPECT_LT(position(sliceBig), position(concatSmall));
+  EXPECT_LT(position(concatSmall), position(concat));
+
+  // The peak is reached by sliceBig, while transposeBig is live.
+  EXPECT_EQ(scheduler.getPredictedPeakMemory(),
+            transposeBig->getType(0)->getSizeInBytes() +
+                sliceBig->getType(0)->getSizeInBytes());
+}
@@ -20,6 +20,7 @@
 #include "glow/Graph/Hook.h"
 #include "glow/Graph/Node.h"
 #include "glow/Graph/Nodes.h"
+#include "glow/Graph/Serialization.h"
 #include "glow/Graph/Utils.h"
 #include "glow/IR/IR.h"
 #include "glow/IR/Instrs.h"
@@ -441,6 +442,161 @@ TEST(Graph, useListIteration) {
   EXPECT_EQ((++K->getUsers().begin())->getUser(), conv2);
 }
 
+/// Check that removing uses from the middle of a long use-list keeps the
+/// order of the other users.
+TEST(Graph, useListRemoval) {
+  Module MD;
+  Function *F = MD.createFunction("F");
+  Node *K = MD.createPlaceholder(ElemKind::FloatTy, {4}, "input", false);
+  Node *other = MD.createPlaceholder(ElemKind::FloatTy, {4}, "other", false);
+
+  constexpr unsigned numUsers = 100;
+  std::vector<ReluNode *> relus;
+  for (unsigned i = 0; i < numUsers; i++) {
+    relus.push_back(F->createRELU("relu", K));
+  }
+  EXPECT_EQ(K->getNumUsers(), numUsers);
+
+  // Move every other user to another node, then erase one of the others.
+  for (unsigned i = 0; i < numUsers; i += 2) {
+    relus[i]->setNthInput(ReluNode::InputIdx, other);
+  }
+  F->eraseNode(relus[1]);
+  EXPECT_EQ(K->getNumUsers(), numUsers / 2 - 1);
+  EXPECT_EQ(other->getNumUsers(), numUsers / 2);
+
+  unsigned i = 3;
+  for (const auto &U : K->getUsers()) {
+    EXPECT_EQ(U.getUser(), relus[i]);
+    i += 2;
+  }
+  i = 0;
+  for (const auto &U : other->getUsers()) {
+    EXPECT_EQ(U.getUser(), relus[i]);
+    i += 2;
+  }
+}
+
+/// Check that equal types are uniqued to the same type, and different types
+/// to different ones.
+TEST(Graph, uniqueTypes) {
+  Module MD;
+  TypeRef T1 = MD.uniqueType(ElemKind::FloatTy, {2, 3});
+  EXPECT_EQ(T1, MD.uniqueType(ElemKind::FloatTy, {2, 3}));
+  EXPECT_EQ(T1, MD.uniqueType(Type(ElemKind::FloatTy, {2, 3})));
+  EXPECT_NE(T1, MD.uniqueType(ElemKind::FloatTy, {3, 2}));
+  EXPECT_NE(T1, MD.uniqueType(ElemKind::Float16Ty, {2, 3}));
+
+  TypeRef Q1 = MD.uniqueType(ElemKind::Int8QTy, {2, 3}, 0.5, 1);
+  EXPECT_EQ(Q1, MD.uniqueType(ElemKind::Int8QTy, {2, 3}, 0.5, 1));
+  EXPECT_NE(Q1, MD.uniqueType(ElemKind::Int8QTy, {2, 3}, 0.25, 1));
+  EXPECT_NE(Q1, MD.uniqueType(ElemKind::Int8QTy, {2, 3}, 0.5, 2));
+
+  // Types with the same shape but padded rows have different strides.
+  TypeRef P1 = MD.uniqueTypeWithNewShape(T1, {2, 3}, {8, 1});
+  EXPECT_NE(T1, P1);
+  EXPECT_EQ(P1, MD.uniqueTypeWithNewShape(T1, {2, 3}, {8, 1}));
+}
+
+/// Check that verify() rechecks the nodes that changed since they were last
+/// verified.
+TEST(Graph, verifyChangedNodes) {
+  Module MD;
+  Function *F = MD.createFunction("F");
+  auto *A = MD.createPlaceholder(ElemKind::FloatTy, {4}, "A", false);
+  auto *B = MD.createPlaceholder(ElemKind::FloatTy, {4}, "B", false);
+  auto *C = MD.createPlaceholder(ElemKind::FloatTy, {5}, "C", false);
+  auto *add = F->createAdd("add", A, B);
+  F->createSave("save", add);
+  EXPECT_TRUE(F->verify());
+  EXPECT_TRUE(F->verify());
+
+  // The operands of the add no longer have the same shape.
+  add->setNthInput(1, C);
+  EXPECT_FALSE(F->verify());
+  add->setNthInput(1, B);
+  EXPECT_TRUE(F->verify());
+
+  // The result of the add no longer has the shape of its operands.
+  add->setType(0, MD.uniqueType(ElemKind::FloatTy, {5}));
+  EXPECT_FALSE(F->verify());
+  add->setType(0, A->getType());
+  EXPECT_TRUE(F->verify());
+}
+
+/// Check that a Module saved with saveModule() is loaded as it was.
+TEST(Graph, saveAndLoadModule) {
+  Module MD;
+  Function *F = MD.createFunction("F");
+  auto *input =
+      MD.createPlaceholder(ElemKind::FloatTy, {1, 8, 8, 3}, "input", false);
+  auto *filter = MD.createConstant(ElemKind::FloatTy, {4, 3, 3, 3}, "filter");
+  auto *bias = MD.createConstant(ElemKind::FloatTy, {4}, "bias");
+  PseudoRNG PRNG;
+  filter->getPayloadMutable().getHandle().randomize(-1.0, 1.0, PRNG);
+  bias->getPayloadMutable().getHandle().randomize(-1.0, 1.0, PRNG);
+  auto outTy = MD.uniqueType(ElemKind::FloatTy, {1, 8, 8, 4});
+  auto *conv = F->createConv("conv", input, filter, bias, outTy, 3, 1, 1, 1);
+  auto *concat = F->createConcat("concat", {conv, conv}, 3);
+  auto *flag = MD.createPlaceholder(ElemKind::BoolTy, {1}, "flag", false);
+  concat->setPredicate(flag);
+  auto *save = F->createSave("save", concat);
+  auto qTy = MD.uniqueType(ElemKind::Int8QTy, outTy->dims(), 0.1, 0);
+  auto *quantize = F->createQuantize("quantize", conv, qTy);
+  auto *relu = F->createRELU("relu", quantize);
+  // A result type which differs from the one built by the constructor.
+  relu->setType(0, MD.uniqueType(ElemKind::Int8QTy, outTy->dims(), 0.2, -3));
+  F->createSave("saveRelu", relu);
+  auto *aligned = MD.createPlaceholder(
+      MD.uniqueTypeWithNewShape(outTy, outTy->dims(), {1, 512, 64, 1}),
+      "aligned", false);
+  aligned->setRagged();
+  ASSERT_TRUE(F->verify());
+
+  llvm::SmallString<64> path;
+  ASSERT_FALSE(llvm::sys::fs::createTemporaryFile("module", "glow", path));
+  EXIT_ON_ERR(saveModule(MD, path));
+  Module loaded;
+  EXIT_ON_ERR(loadModule(loaded, path));
+  llvm::sys::fs::remove(path);
+
+  ASSERT_EQ(loaded.getFunctions().size(), 1);
+  Function *LF = loaded.getFunction("F");
+  ASSERT_TRUE(LF);
+  EXPECT_EQ(LF->getNodes().size(), F->getNodes().size());
+  for (auto &N : F->getNodes()) {
+    Node *LN = LF->getNodeByName(N.getName());
+    ASSERT_TRUE(LN);
+    EXPECT_EQ(LN->getKind(), N.getKind());
+    EXPECT_EQ(LN->getDebugDesc(), N.getDebugDesc());
+    EXPECT_EQ(LN->getNumInputs(), N.getNumInputs());
+    for (unsigned i = 0, e = N.getNumInputs(); i < e; i++) {
+      EXPECT_EQ(LN->getNthInput(i).getNode()->getName(),
+                N.getNthInput(i).getNode()->getName());
+      EXPECT_EQ(LN->getNthInput(i).getResNo(), N.getNthInput(i).getResNo());
+    }
+  }
+  EXPECT_EQ(*LF->getNodeByName(relu->getName())->getType(0),
+            *relu->getType(0));
+  EXPECT_EQ(loaded.getPlaceholderByName("aligned")->getType()->strides(),
+            aligned->getType()->strides());
+  EXPECT_TRUE(loaded.getPlaceholderByName("aligned")->isRagged());
+  EXPECT_FALSE(loaded.getPlaceholderByName("input")->isRagged());
+  EXPECT_EQ(LF->getNodeByName(concat->getName())->getPredicate().getNode(),
+            loaded.getPlaceholderByName("flag"));
+  EXPECT_EQ(llvm::cast<SaveNode>(LF->getNodeByName(save->getName()))
+                ->getPlaceholder(),
+            loaded.getPlaceholderByName(save->getPlaceholder()->getName()));
+
+  // The payloads of the Constants are used in place.
+  for (const Constant *C : {filter, bias}) {
+    Constant *LC = loaded.getConstantByName(C->getName());
+    ASSERT_TRUE(LC);
+    EXPECT_TRUE(LC->getPayload().isUnowned());
+    EXPECT_TRUE(LC->getPayload().isEqual(C->getPayload()));
+  }
+}
+
 TEST(Graph, simpleTestFC) {
   unsigned numInputs = 10;
   Module MD;
@@ -1534,6 +1690,41 @@ TEST(Graph, contextSize) {
   EXPECT_EQ(bindings.getDataSize(), sizeof(float) * bindings.get(PH)->size());
 }
 
+/// Check that only the placeholders read as the indices or weights of sparse
+/// lookups allow partial tensors, and that a ragged placeholder is bound to
+/// its valid prefix.
+TEST(Graph, allowsPartialInput) {
+  Module MD;
+  Function *F = MD.createFunction("F");
+  auto *data = MD.createPlaceholder(ElemKind::FloatTy, {4, 2}, "data", false);
+  auto *weights =
+      MD.createPlaceholder(ElemKind::FloatTy, {10}, "weights", false);
+  auto *indices =
+      MD.createPlaceholder(ElemKind::Int64ITy, {10}, "indices", false);
+  auto *lengths =
+      MD.createPlaceholder(ElemKind::Int32ITy, {3}, "lengths", false);
+  auto *SLWS = F->createSparseLengthsWeightedSum("SLWS", data, weights,
+                                                 indices, lengths);
+  F->createSave("save", SLWS);
+  EXPECT_TRUE(allowsPartialInput(weights, F));
+  EXPECT_TRUE(allowsPartialInput(indices, F));
+  EXPECT_FALSE(allowsPartialInput(data, F));
+  EXPECT_FALSE(allowsPartialInput(lengths, F));
+
+  // Another user may read the whole placeholder.
+  F->createSave("saveWeights", F->createTanh("tanh", weights));
+  EXPECT_FALSE(allowsPartialInput(weights, F));
+  EXPECT_TRUE(allowsPartialInput(indices, F));
+
+  indices->setRagged();
+  PlaceholderBindings bindings;
+  Tensor *T = bindings.allocate(indices);
+  EXPECT_EQ(T->getUnpaddedSizeInBytes(), T->getSizeInBytes());
+  bindings.setNumValidElements(indices, 6);
+  EXPECT_EQ(T->getUnpaddedSizeInBytes(), 6 * sizeof(int64_t));
+  EXPECT_EQ(T->getSizeInBytes(), 10 * sizeof(int64_t));
+}
+
 /// Check that clones of the context are distinct and share no references back
 /// to the original object.
 TEST(Graph, clonePlaceholderBindings) {
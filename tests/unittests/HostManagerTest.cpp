@@ -16,6 +16,7 @@
 
 #include "glow/Runtime/HostManager/HostManager.h"
 #include "glow/ExecutionContext/ExecutionContext.h"
+#include "glow/ExecutionContext/TraceRecorder.h"
 
 #include "gtest/gtest.h"
 
@@ -277,3 +278,729 @@ TEST_F(HostManagerTest, QueueTest) {
   EXPECT_GT(res3, res1);
   EXPECT_GT(res2, res3);
 }
+
+/// \returns whether \p err is a RUNTIME_DEADLINE_EXCEEDED error.
+static bool isDeadlineExceeded(Error err) {
+  return ERR_TO_STRING(std::move(err)).find("RUNTIME_DEADLINE_EXCEEDED") !=
+         std::string::npos;
+}
+
+/// Test that the requests with a deadline run earliest deadline first, before
+/// the requests without one.
+TEST_F(HostManagerTest, DeadlineQueueTest) {
+  HostConfig config;
+  config.maxActiveRequests = 1;
+  auto hostManager = createHostManager("Interpreter", std::move(config));
+
+  EXPECT_FALSE(ERR_TO_BOOL(addNetwork(hostManager.get(), "main")));
+
+  std::promise<unsigned> run1p, run2p, run3p, run4p, dispatched;
+  auto dispatchDone = dispatched.get_future();
+  auto run1f = run1p.get_future();
+  auto run2f = run2p.get_future();
+  auto run3f = run3p.get_future();
+  auto run4f = run4p.get_future();
+  std::atomic<unsigned> counter{0};
+  auto makeCallback = [&counter](std::promise<unsigned> &promise) {
+    return [&counter, &promise](RunIdentifierTy runID, Error err,
+                                std::unique_ptr<ExecutionContext> context) {
+      EXIT_ON_ERR(std::move(err));
+      promise.set_value(counter++);
+    };
+  };
+
+  // The first one holds the only active request until all are queued.
+  hostManager->runNetwork("main", llvm::make_unique<ExecutionContext>(),
+                          [&run1p, &counter, &dispatchDone](
+                              RunIdentifierTy runID, Error err,
+                              std::unique_ptr<ExecutionContext> context) {
+                            EXIT_ON_ERR(std::move(err));
+                            run1p.set_value(counter++);
+                            dispatchDone.wait();
+                          });
+  auto now = std::chrono::steady_clock::now();
+  hostManager->runNetwork("main", llvm::make_unique<ExecutionContext>(),
+                          makeCallback(run2p), 0);
+  hostManager->runNetwork("main", llvm::make_unique<ExecutionContext>(),
+                          makeCallback(run3p), 1,
+                          now + std::chrono::seconds(20));
+  hostManager->runNetwork("main", llvm::make_unique<ExecutionContext>(),
+                          makeCallback(run4p), 1,
+                          now + std::chrono::seconds(10));
+  dispatched.set_value(0);
+
+  // Should expect them to finish in order: 1, 4, 3, 2.
+  auto res1 = run1f.get();
+  auto res2 = run2f.get();
+  auto res3 = run3f.get();
+  auto res4 = run4f.get();
+  EXPECT_GT(res4, res1);
+  EXPECT_GT(res3, res4);
+  EXPECT_GT(res2, res3);
+}
+
+/// Test that the requests that can't finish by their deadline fail instead of
+/// running late.
+TEST_F(HostManagerTest, DeadlineExceededTest) {
+  HostConfig config;
+  config.maxActiveRequests = 1;
+  auto hostManager = createHostManager("Interpreter", std::move(config));
+
+  EXPECT_FALSE(ERR_TO_BOOL(addNetwork(hostManager.get(), "main")));
+
+  // A request whose deadline passed fails without being queued.
+  std::unique_ptr<Error> runErr;
+  hostManager->runNetwork(
+      "main", llvm::make_unique<ExecutionContext>(),
+      [&runErr](RunIdentifierTy runID, Error err,
+                std::unique_ptr<ExecutionContext> context) {
+        runErr = llvm::make_unique<Error>(std::move(err));
+      },
+      0, std::chrono::steady_clock::now() - std::chrono::milliseconds(1));
+  ASSERT_TRUE(runErr);
+  EXPECT_TRUE(isDeadlineExceeded(std::move(*runErr)));
+
+  // A request whose deadline passes while it is queued fails when it is
+  // dispatched.
+  std::promise<void> dispatched;
+  auto dispatchDone = dispatched.get_future();
+  std::promise<Error> run1p, run2p;
+  auto run1f = run1p.get_future();
+  auto run2f = run2p.get_future();
+  hostManager->runNetwork("main", llvm::make_unique<ExecutionContext>(),
+                          [&run1p, &dispatchDone](
+                              RunIdentifierTy runID, Error err,
+                              std::unique_ptr<ExecutionContext> context) {
+                            run1p.set_value(std::move(err));
+                            dispatchDone.wait();
+                          });
+  hostManager->runNetwork(
+      "main", llvm::make_unique<ExecutionContext>(),
+      [&run2p](RunIdentifierTy runID, Error err,
+               std::unique_ptr<ExecutionContext> context) {
+        run2p.set_value(std::move(err));
+      },
+      0, std::chrono::steady_clock::now() + std::chrono::milliseconds(50));
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  dispatched.set_value();
+  EXPECT_FALSE(ERR_TO_BOOL(run1f.get()));
+  EXPECT_TRUE(isDeadlineExceeded(run2f.get()));
+}
+
+/// Test that a queued request whose client cancelled it is dropped when it is
+/// dispatched, and that the deadline of a context is the one of its run.
+TEST_F(HostManagerTest, CancelledRequest) {
+  HostConfig config;
+  config.maxActiveRequests = 1;
+  auto hostManager = createHostManager("Interpreter", std::move(config));
+
+  EXPECT_FALSE(ERR_TO_BOOL(addNetwork(hostManager.get(), "main")));
+
+  std::unique_ptr<Error> runErr;
+  auto context = llvm::make_unique<ExecutionContext>();
+  context->setDeadline(std::chrono::steady_clock::now() -
+                       std::chrono::milliseconds(1));
+  hostManager->runNetwork("main", std::move(context),
+                          [&runErr](RunIdentifierTy runID, Error err,
+                                    std::unique_ptr<ExecutionContext> context) {
+                            runErr = llvm::make_unique<Error>(std::move(err));
+                          });
+  ASSERT_TRUE(runErr);
+  EXPECT_TRUE(isDeadlineExceeded(std::move(*runErr)));
+
+  // The second request is queued behind the first one, and cancelled before
+  // the first one is done.
+  std::promise<void> dispatched;
+  auto dispatchDone = dispatched.get_future();
+  std::promise<Error> run1p, run2p;
+  auto run1f = run1p.get_future();
+  auto run2f = run2p.get_future();
+  hostManager->runNetwork("main", llvm::make_unique<ExecutionContext>(),
+                          [&run1p, &dispatchDone](
+                              RunIdentifierTy runID, Error err,
+                              std::unique_ptr<ExecutionContext> context) {
+                            run1p.set_value(std::move(err));
+                            dispatchDone.wait();
+                          });
+  auto token = std::make_shared<CancellationToken>();
+  context = llvm::make_unique<ExecutionContext>();
+  context->setCancellationToken(token);
+  hostManager->runNetwork("main", std::move(context),
+                          [&run2p](RunIdentifierTy runID, Error err,
+                                   std::unique_ptr<ExecutionContext> context) {
+                            run2p.set_value(std::move(err));
+                          });
+  token->cancel();
+  dispatched.set_value();
+  EXPECT_FALSE(ERR_TO_BOOL(run1f.get()));
+  EXPECT_NE(ERR_TO_STRING(run2f.get()).find("RUNTIME_REQUEST_CANCELLED"),
+            std::string::npos);
+}
+
+/// Test that the callbacks are called by the completion threads, so that a
+/// callback that blocks doesn't hold up the executor.
+TEST_F(HostManagerTest, CompletionThreads) {
+  HostConfig config;
+  config.executorThreads = 1;
+  config.completionThreads = 2;
+  auto hostManager = createHostManager("Interpreter", std::move(config));
+
+  EXPECT_FALSE(ERR_TO_BOOL(addNetwork(hostManager.get(), "main")));
+
+  // The first callback waits for the second run, which the only thread of
+  // the executor would never get to if it called the first callback.
+  std::promise<Error> run1p;
+  std::promise<bool> run2p;
+  auto run1f = run1p.get_future();
+  auto run2f = run2p.get_future().share();
+  hostManager->runNetwork("main", llvm::make_unique<ExecutionContext>(),
+                          [&run1p, run2f](
+                              RunIdentifierTy runID, Error err,
+                              std::unique_ptr<ExecutionContext> context) {
+                            run2f.wait_for(std::chrono::seconds(10));
+                            run1p.set_value(std::move(err));
+                          });
+  hostManager->runNetwork("main", llvm::make_unique<ExecutionContext>(),
+                          [&run2p](RunIdentifierTy runID, Error err,
+                                   std::unique_ptr<ExecutionContext> context) {
+                            run2p.set_value(ERR_TO_BOOL(std::move(err)));
+                          });
+  ASSERT_EQ(run2f.wait_for(std::chrono::seconds(10)),
+            std::future_status::ready);
+  EXPECT_FALSE(run2f.get());
+  EXPECT_FALSE(ERR_TO_BOOL(run1f.get()));
+}
+
+/// Add to \p manager a network \p name that squares the {\p batchSize, 3}
+/// placeholder "X" into the placeholder "out".
+Error addSquareNetwork(HostManager *manager, llvm::StringRef name,
+                       size_t batchSize) {
+  std::unique_ptr<Module> module = llvm::make_unique<Module>();
+  Function *F = module->createFunction(name);
+  auto *X = module->createPlaceholder(ElemKind::FloatTy, {batchSize, 3}, "X",
+                                      false);
+  auto *out = module->createPlaceholder(ElemKind::FloatTy, {batchSize, 3},
+                                        "out", false);
+  auto *pow = F->createPow("pow", X, 2.0);
+  F->createSave("save", pow, out);
+  CompilationContext cctx;
+  return manager->addNetwork(std::move(module), cctx);
+}
+
+/// Run \p count concurrent requests of the network "single", and check that
+/// each gets the squares of its own inputs back.
+void runBatchedRequests(HostManager *manager, unsigned count) {
+  Module inputModule;
+  auto *X = inputModule.createPlaceholder(ElemKind::FloatTy, {1, 3}, "X",
+                                          false);
+  auto *out = inputModule.createPlaceholder(ElemKind::FloatTy, {1, 3}, "out",
+                                            false);
+  std::vector<std::promise<void>> done(count);
+  std::vector<std::unique_ptr<ExecutionContext>> results(count);
+  std::vector<std::unique_ptr<Error>> errors(count);
+  for (unsigned i = 0; i < count; i++) {
+    auto context = llvm::make_unique<ExecutionContext>();
+    auto *bindings = context->getPlaceholderBindings();
+    bindings->allocate(X)->getHandle() = {float(i), float(i + 1),
+                                          float(i + 2)};
+    bindings->allocate(out)->zero();
+    manager->runNetwork(
+        "single", std::move(context),
+        [&, i](RunIdentifierTy, Error err,
+               std::unique_ptr<ExecutionContext> context) {
+          errors[i] = llvm::make_unique<Error>(std::move(err));
+          results[i] = std::move(context);
+          done[i].set_value();
+        });
+  }
+  for (unsigned i = 0; i < count; i++) {
+    done[i].get_future().wait();
+    EXPECT_FALSE(ERR_TO_BOOL(std::move(*errors[i])));
+    auto H = results[i]->getPlaceholderBindings()->get(out)->getHandle();
+    for (unsigned j = 0; j < 3; j++) {
+      EXPECT_NEAR(H.at({0, j}), float((i + j) * (i + j)), 1E-5);
+    }
+  }
+}
+
+/// Test that concurrent requests of a batched network are run as one batch
+/// and get their own results back.
+TEST_F(HostManagerTest, BatchingFullBatch) {
+  auto hostManager = createHostManager("Interpreter");
+  ASSERT_FALSE(ERR_TO_BOOL(addSquareNetwork(hostManager.get(), "single", 1)));
+  ASSERT_FALSE(ERR_TO_BOOL(addSquareNetwork(hostManager.get(), "batched", 4)));
+  BatchingConfig config;
+  config.batchedNetworkName = "batched";
+  config.maxBatchSize = 4;
+  // Long enough for the requests to always make one full batch.
+  config.maxWait = std::chrono::seconds(10);
+  ASSERT_FALSE(ERR_TO_BOOL(hostManager->enableBatching("single", config)));
+  runBatchedRequests(hostManager.get(), 4);
+}
+
+/// Test that a request that times out is run in a zero padded batch.
+TEST_F(HostManagerTest, BatchingPartialBatch) {
+  auto hostManager = createHostManager("Interpreter");
+  ASSERT_FALSE(ERR_TO_BOOL(addSquareNetwork(hostManager.get(), "single", 1)));
+  ASSERT_FALSE(ERR_TO_BOOL(addSquareNetwork(hostManager.get(), "batched", 4)));
+  BatchingConfig config;
+  config.batchedNetworkName = "batched";
+  config.maxBatchSize = 4;
+  config.maxWait = std::chrono::microseconds(100);
+  ASSERT_FALSE(ERR_TO_BOOL(hostManager->enableBatching("single", config)));
+  runBatchedRequests(hostManager.get(), 1);
+  // Both networks can be removed once their requests are done.
+  EXPECT_FALSE(ERR_TO_BOOL(hostManager->removeNetwork("single")));
+  EXPECT_FALSE(ERR_TO_BOOL(hostManager->removeNetwork("batched")));
+}
+
+/// Test that batching is refused with a network of the wrong batch size.
+TEST_F(HostManagerTest, BatchingMismatch) {
+  auto hostManager = createHostManager("Interpreter");
+  ASSERT_FALSE(ERR_TO_BOOL(addSquareNetwork(hostManager.get(), "single", 1)));
+  ASSERT_FALSE(ERR_TO_BOOL(addSquareNetwork(hostManager.get(), "batched", 3)));
+  BatchingConfig config;
+  config.batchedNetworkName = "batched";
+  config.maxBatchSize = 4;
+  EXPECT_TRUE(ERR_TO_BOOL(hostManager->enableBatching("single", config)));
+  config.batchedNetworkName = "missing";
+  EXPECT_TRUE(ERR_TO_BOOL(hostManager->enableBatching("single", config)));
+}
+
+/// Test that requests run concurrently from many threads all complete, while
+/// most of them wait in the queue.
+TEST_F(HostManagerTest, ConcurrentRunNetwork) {
+  const unsigned numThreads = 8;
+  const unsigned numRuns = 25;
+  HostConfig config;
+  config.maxActiveRequests = 2;
+  config.maxQueueSize = numThreads * numRuns;
+  auto hostManager = createHostManager("Interpreter", config);
+  ASSERT_FALSE(ERR_TO_BOOL(addSquareNetwork(hostManager.get(), "single", 1)));
+
+  std::vector<std::thread> threads;
+  std::atomic<unsigned> numSucceeded{0};
+  for (unsigned t = 0; t < numThreads; t++) {
+    threads.emplace_back([&hostManager, &numSucceeded]() {
+      for (unsigned i = 0; i < numRuns; i++) {
+        auto context = llvm::make_unique<ExecutionContext>();
+        if (!ERR_TO_BOOL(hostManager->runNetworkBlocking("single",
+                                                         std::move(context)))) {
+          numSucceeded++;
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(numSucceeded, numThreads * numRuns);
+}
+
+/// Test that the functions of a module compiled on several threads at once
+/// are all added and run correctly.
+TEST_F(HostManagerTest, ParallelCompile) {
+  const unsigned numFunctions = 6;
+  HostConfig config;
+  config.compileThreads = 4;
+  auto hostManager = createHostManager("Interpreter", config);
+
+  auto module = llvm::make_unique<Module>();
+  std::vector<PlaceholderBindings> bindings(numFunctions);
+  std::vector<Tensor *> results;
+  for (unsigned i = 0; i < numFunctions; i++) {
+    auto name = std::to_string(i);
+    Function *F = module->createFunction("function" + name);
+    auto *X = module->createPlaceholder(ElemKind::FloatTy, {3}, "X" + name,
+                                        false);
+    auto *save = F->createSave("save" + name, F->createPow("Pow" + name, X, 2));
+    bindings[i].allocate(X)->getHandle() = {1, 2, float(i)};
+    results.push_back(bindings[i].allocate(save->getPlaceholder()));
+  }
+  CompilationContext cctx;
+  ASSERT_FALSE(ERR_TO_BOOL(hostManager->addNetwork(std::move(module), cctx)));
+
+  for (unsigned i = 0; i < numFunctions; i++) {
+    EXPECT_FALSE(ERR_TO_BOOL(hostManager->runNetworkBlocking(
+        "function" + std::to_string(i), bindings[i])));
+    auto H = results[i]->getHandle();
+    EXPECT_NEAR(H.at({0}), 1, 1E-5);
+    EXPECT_NEAR(H.at({1}), 4, 1E-5);
+    EXPECT_NEAR(H.at({2}), i * i, 1E-5);
+  }
+}
+
+/// \returns a module with the function \p name, which raises the placeholder
+/// "X" of \p batchSize rows to the power \p exp into the placeholder "out".
+static std::unique_ptr<Module>
+createPowModule(llvm::StringRef name, size_t batchSize, float exp,
+                llvm::StringRef inputName = "X") {
+  auto module = llvm::make_unique<Module>();
+  Function *F = module->createFunction(name);
+  auto *X = module->createPlaceholder(ElemKind::FloatTy, {batchSize, 3},
+                                      inputName, false);
+  auto *out = module->createPlaceholder(ElemKind::FloatTy, {batchSize, 3},
+                                        "out", false);
+  F->createSave("save", F->createPow("pow", X, exp), out);
+  return module;
+}
+
+/// Run the network "net" on the inputs {1, 2, 3} and \returns the first
+/// result, or -1 if the run failed.
+static float runPowNetwork(HostManager *manager) {
+  PlaceholderBindings bindings;
+  Module inputModule;
+  auto *X = inputModule.createPlaceholder(ElemKind::FloatTy, {1, 3}, "X",
+                                          false);
+  auto *out = inputModule.createPlaceholder(ElemKind::FloatTy, {1, 3}, "out",
+                                            false);
+  bindings.allocate(X)->getHandle() = {1, 2, 3};
+  auto *result = bindings.allocate(out);
+  if (ERR_TO_BOOL(manager->runNetworkBlocking("net", bindings))) {
+    return -1;
+  }
+  return result->getHandle().at({0, 1});
+}
+
+/// Test that a network added in the background runs once its future is
+/// ready.
+TEST_F(HostManagerTest, AddNetworkAsync) {
+  auto hostManager = createHostManager("Interpreter");
+  CompilationContext cctx;
+  auto added = hostManager->addNetworkAsync(createPowModule("net", 1, 2), cctx);
+  ASSERT_FALSE(ERR_TO_BOOL(added.get()));
+  EXPECT_TRUE(hostManager->networkAdded("net"));
+  EXPECT_EQ(runPowNetwork(hostManager.get()), 4);
+}
+
+/// Test that the requests of a network run the variant of their batch size,
+/// and the network itself for the other sizes.
+TEST_F(HostManagerTest, BatchVariants) {
+  auto hostManager = createHostManager("Interpreter");
+  CompilationContext cctx;
+  ASSERT_FALSE(ERR_TO_BOOL(
+      hostManager->addNetwork(createPowModule("net", 1, 2), cctx)));
+  // The variant cubes instead of squaring, to see which network runs.
+  ASSERT_FALSE(ERR_TO_BOOL(
+      hostManager->addNetwork(createPowModule("net4", 4, 3), cctx)));
+  ASSERT_FALSE(ERR_TO_BOOL(
+      hostManager->addNetwork(createPowModule("mismatch", 4, 3, "Y"), cctx)));
+  EXPECT_TRUE(ERR_TO_BOOL(hostManager->addBatchVariant("net", "mismatch")));
+  ASSERT_FALSE(ERR_TO_BOOL(hostManager->addBatchVariant("net", "net4")));
+  EXPECT_TRUE(ERR_TO_BOOL(hostManager->addBatchVariant("net", "net4")));
+
+  EXPECT_EQ(runPowNetwork(hostManager.get()), 4);
+
+  PlaceholderBindings bindings;
+  Module inputModule;
+  auto *X = inputModule.createPlaceholder(ElemKind::FloatTy, {4, 3}, "X",
+                                          false);
+  auto *out = inputModule.createPlaceholder(ElemKind::FloatTy, {4, 3}, "out",
+                                            false);
+  bindings.allocate(X)->getHandle().clear(2);
+  auto *result = bindings.allocate(out);
+  ASSERT_FALSE(ERR_TO_BOOL(hostManager->runNetworkBlocking("net", bindings)));
+  EXPECT_EQ(result->getHandle().at({3, 2}), 8);
+}
+
+/// Test that a network warmed up when it is added runs on its own inputs
+/// afterwards.
+TEST_F(HostManagerTest, WarmUpNetwork) {
+  auto hostManager = createHostManager("CPU");
+  CompilationContext cctx;
+  cctx.warmupOpts.prepare = true;
+  cctx.warmupOpts.numRuns = 3;
+  ASSERT_FALSE(ERR_TO_BOOL(
+      hostManager->addNetwork(createPowModule("net", 1, 2), cctx)));
+  EXPECT_EQ(runPowNetwork(hostManager.get()), 4);
+}
+
+/// Test that requests run while a network is swapped all succeed, and that
+/// they run the new version after the swap.
+TEST_F(HostManagerTest, SwapNetwork) {
+  auto hostManager = createHostManager("Interpreter");
+  CompilationContext cctx;
+  ASSERT_FALSE(ERR_TO_BOOL(
+      hostManager->addNetwork(createPowModule("net", 1, 2), cctx)));
+  EXPECT_EQ(runPowNetwork(hostManager.get()), 4);
+
+  std::atomic<bool> stop{false};
+  std::atomic<unsigned> numFailed{0};
+  std::thread runner([&]() {
+    while (!stop) {
+      auto result = runPowNetwork(hostManager.get());
+      if (result != 4 && result != 8) {
+        numFailed++;
+      }
+    }
+  });
+  auto swapped =
+      hostManager->swapNetwork("net", createPowModule("net_v2", 1, 3), cctx);
+  EXPECT_FALSE(ERR_TO_BOOL(swapped.get()));
+  stop = true;
+  runner.join();
+  EXPECT_EQ(numFailed, 0);
+
+  EXPECT_EQ(runPowNetwork(hostManager.get()), 8);
+  EXPECT_TRUE(hostManager->networkAdded("net"));
+  EXPECT_FALSE(hostManager->networkAdded("net_v2"));
+  // The function of the new version keeps its name.
+  EXPECT_TRUE(ERR_TO_BOOL(
+      hostManager->addNetwork(createPowModule("net_v2", 1, 2), cctx)));
+  // Swapping a missing network fails.
+  EXPECT_TRUE(ERR_TO_BOOL(
+      hostManager->swapNetwork("missing", createPowModule("v3", 1, 2), cctx)
+          .get()));
+  EXPECT_FALSE(ERR_TO_BOOL(hostManager->removeNetwork("net")));
+}
+
+/// Test that sampled requests are traced into the process-wide TraceRecorder.
+TEST_F(HostManagerTest, TraceSampling) {
+  HostConfig hostConfig;
+  hostConfig.traceSampleInterval = 1;
+  auto hostManager = createHostManager("Interpreter", hostConfig);
+  CompilationContext cctx;
+  ASSERT_FALSE(ERR_TO_BOOL(
+      hostManager->addNetwork(createPowModule("net", 1, 2), cctx)));
+  getTraceRecorder()->takeTraceEvents();
+  EXPECT_EQ(runPowNetwork(hostManager.get()), 4);
+
+  auto events = getTraceRecorder()->takeTraceEvents();
+  EXPECT_TRUE(std::any_of(events.begin(), events.end(),
+                          [](const TraceEvent &event) {
+                            return event.name == "HostManager::runNetwork";
+                          }));
+}
+
+/// Test that a prepared request runs many times with its inputs filled in
+/// place, reusing the same tensors.
+TEST_F(HostManagerTest, PreparedRequest) {
+  auto hostManager = createHostManager("Interpreter");
+  CompilationContext cctx;
+  ASSERT_FALSE(ERR_TO_BOOL(
+      hostManager->addNetwork(createPowModule("net", 1, 2), cctx)));
+  EXPECT_TRUE(
+      ERR_TO_BOOL(hostManager->prepareRequest("missing").takeError()));
+
+  std::unique_ptr<PreparedRequest> request;
+  ASSIGN_VALUE_OR_FAIL_TEST(request, hostManager->prepareRequest("net"));
+  size_t inputSlot, outputSlot;
+  ASSIGN_VALUE_OR_FAIL_TEST(inputSlot, request->getSlot("X"));
+  ASSIGN_VALUE_OR_FAIL_TEST(outputSlot, request->getSlot("out"));
+  EXPECT_TRUE(ERR_TO_BOOL(request->getSlot("missing").takeError()));
+  Tensor *input = request->getTensor(inputSlot);
+  Tensor *output = request->getTensor(outputSlot);
+
+  for (float i = 0; i < 4; i++) {
+    input->getHandle() = {i, i + 1, i + 2};
+    ASSERT_FALSE(ERR_TO_BOOL(hostManager->runNetworkBlocking(*request)));
+    EXPECT_FALSE(request->isRunning());
+    EXPECT_EQ(request->getTensor(outputSlot), output);
+    EXPECT_EQ(output->getHandle().at({0, 1}), (i + 1) * (i + 1));
+  }
+  request.reset();
+  EXPECT_FALSE(ERR_TO_BOOL(hostManager->removeNetwork("net")));
+}
+
+/// Create the network \p name adding a constant of 1000 floats of value
+/// \p value to its input X, into the placeholder out.
+static std::unique_ptr<Module> createAddConstantModule(llvm::StringRef name,
+                                                       float value) {
+  auto module = llvm::make_unique<Module>();
+  Function *F = module->createFunction(name);
+  auto *X = module->createPlaceholder(ElemKind::FloatTy, {1000}, "X", false);
+  auto *out =
+      module->createPlaceholder(ElemKind::FloatTy, {1000}, "out", false);
+  auto *C = module->createConstant(ElemKind::FloatTy, {1000}, "C");
+  C->getPayloadMutable().getHandle().clear(value);
+  F->createSave("save", F->createAdd("add", X, C), out);
+  return module;
+}
+
+/// Test that with LRU eviction more networks are added than fit on the device
+/// at once, and that all of them run, the evicted ones being reloaded.
+TEST_F(HostManagerTest, EvictLRUNetworks) {
+  HostConfig hostConfig;
+  hostConfig.evictLRUNetworks = true;
+  std::vector<std::unique_ptr<DeviceConfig>> configs;
+  configs.push_back(llvm::make_unique<DeviceConfig>("Interpreter"));
+  // The device holds the constants of two of the networks.
+  configs.back()->setDeviceMemory(10000);
+  auto hostManager =
+      llvm::make_unique<HostManager>(std::move(configs), hostConfig);
+
+  constexpr unsigned numNetworks = 4;
+  for (unsigned i = 0; i < numNetworks; i++) {
+    CompilationContext cctx;
+    ASSERT_FALSE(ERR_TO_BOOL(hostManager->addNetwork(
+        createAddConstantModule("net" + std::to_string(i), i), cctx)));
+  }
+
+  for (unsigned round = 0; round < 2; round++) {
+    for (unsigned i = 0; i < numNetworks; i++) {
+      std::unique_ptr<PreparedRequest> request;
+      ASSIGN_VALUE_OR_FAIL_TEST(
+          request, hostManager->prepareRequest("net" + std::to_string(i)));
+      size_t inputSlot, outputSlot;
+      ASSIGN_VALUE_OR_FAIL_TEST(inputSlot, request->getSlot("X"));
+      ASSIGN_VALUE_OR_FAIL_TEST(outputSlot, request->getSlot("out"));
+      request->getTensor(inputSlot)->getHandle().clear(1);
+      ASSERT_FALSE(ERR_TO_BOOL(hostManager->runNetworkBlocking(*request)));
+      EXPECT_EQ(request->getTensor(outputSlot)->getHandle().at({999}), i + 1);
+    }
+  }
+
+  for (unsigned i = 0; i < numNetworks; i++) {
+    EXPECT_FALSE(
+        ERR_TO_BOOL(hostManager->removeNetwork("net" + std::to_string(i))));
+  }
+}
+
+/// Test that the requests of the networks of tenants with quotas and weights
+/// all run, along with the requests of a network without a tenant.
+TEST_F(HostManagerTest, Tenants) {
+  auto hostManager = createHostManager("Interpreter");
+  CompilationContext cctx;
+  for (unsigned i = 0; i < 3; i++) {
+    ASSERT_FALSE(ERR_TO_BOOL(hostManager->addNetwork(
+        createAddConstantModule("net" + std::to_string(i), i), cctx)));
+  }
+  TenantConfig small;
+  small.name = "small";
+  small.maxActiveRequests = 1;
+  TenantConfig large;
+  large.name = "large";
+  large.weight = 3;
+  ASSERT_FALSE(ERR_TO_BOOL(hostManager->addTenant(small)));
+  ASSERT_FALSE(ERR_TO_BOOL(hostManager->addTenant(large)));
+  EXPECT_TRUE(ERR_TO_BOOL(hostManager->addTenant(large)));
+  EXPECT_FALSE(ERR_TO_BOOL(hostManager->setTenant("net0", "small")));
+  EXPECT_FALSE(ERR_TO_BOOL(hostManager->setTenant("net1", "large")));
+  EXPECT_TRUE(ERR_TO_BOOL(hostManager->setTenant("net2", "missing")));
+  EXPECT_TRUE(ERR_TO_BOOL(hostManager->setTenant("missing", "small")));
+
+  constexpr unsigned numRuns = 30;
+  std::vector<std::unique_ptr<PreparedRequest>> requests;
+  std::vector<std::promise<bool>> promises(numRuns);
+  for (unsigned i = 0; i < numRuns; i++) {
+    unsigned network = i % 3;
+    std::unique_ptr<PreparedRequest> request;
+    ASSIGN_VALUE_OR_FAIL_TEST(
+        request, hostManager->prepareRequest("net" + std::to_string(network)));
+    size_t inputSlot, outputSlot;
+    ASSIGN_VALUE_OR_FAIL_TEST(inputSlot, request->getSlot("X"));
+    ASSIGN_VALUE_OR_FAIL_TEST(outputSlot, request->getSlot("out"));
+    request->getTensor(inputSlot)->getHandle().clear(i);
+    Tensor *output = request->getTensor(outputSlot);
+    auto *rawRequest = request.get();
+    requests.push_back(std::move(request));
+    hostManager->runNetwork(
+        rawRequest->getNetworkName(), rawRequest->takeContext(),
+        [&promises, i, network, rawRequest,
+         output](RunIdentifierTy, Error err,
+                 std::unique_ptr<ExecutionContext> context) {
+          rawRequest->returnContext(std::move(context));
+          promises[i].set_value(!ERR_TO_BOOL(std::move(err)) &&
+                                output->getHandle().at({0}) == i + network);
+        });
+  }
+  for (auto &promise : promises) {
+    EXPECT_TRUE(promise.get_future().get());
+  }
+}
+
+/// Test that the adaptive limit of the active requests backs off to its
+/// lower bound while the runs are slower than the latency target, and that
+/// the requests held back by the limit still run.
+TEST_F(HostManagerTest, AdaptiveConcurrency) {
+  HostConfig config;
+  config.maxActiveRequests = 8;
+  config.adaptiveConcurrency.latencyTarget = std::chrono::microseconds(1);
+  config.adaptiveConcurrency.minActiveRequests = 2;
+  config.adaptiveConcurrency.backoff = 0.5;
+  auto hostManager = createHostManager("Interpreter", config);
+  EXPECT_EQ(hostManager->getActiveRequestLimit(), 8);
+  CompilationContext cctx;
+  ASSERT_FALSE(ERR_TO_BOOL(
+      hostManager->addNetwork(createAddConstantModule("net", 1), cctx)));
+
+  // The windows of 8, 4 and 2 runs bring the limit down to 2.
+  constexpr unsigned numRuns = 40;
+  std::vector<std::unique_ptr<PreparedRequest>> requests;
+  std::vector<std::promise<bool>> promises(numRuns);
+  for (unsigned i = 0; i < numRuns; i++) {
+    std::unique_ptr<PreparedRequest> request;
+    ASSIGN_VALUE_OR_FAIL_TEST(request, hostManager->prepareRequest("net"));
+    size_t inputSlot, outputSlot;
+    ASSIGN_VALUE_OR_FAIL_TEST(inputSlot, request->getSlot("X"));
+    ASSIGN_VALUE_OR_FAIL_TEST(outputSlot, request->getSlot("out"));
+    request->getTensor(inputSlot)->getHandle().clear(i);
+    Tensor *output = request->getTensor(outputSlot);
+    auto *rawRequest = request.get();
+    requests.push_back(std::move(request));
+    hostManager->runNetwork(
+        "net", rawRequest->takeContext(),
+        [&promises, i, rawRequest, output](
+            RunIdentifierTy, Error err,
+            std::unique_ptr<ExecutionContext> context) {
+          rawRequest->returnContext(std::move(context));
+          promises[i].set_value(!ERR_TO_BOOL(std::move(err)) &&
+                                output->getHandle().at({999}) == i + 1);
+        });
+  }
+  for (auto &promise : promises) {
+    EXPECT_TRUE(promise.get_future().get());
+  }
+  EXPECT_EQ(hostManager->getActiveRequestLimit(), 2);
+}
+
+/// Test that the replicas of a network follow its target: they are added to
+/// the other devices for a high target and removed for a low one, and the
+/// network keeps running from its new devices.
+TEST_F(HostManagerTest, PlaceReplicas) {
+  std::vector<std::unique_ptr<DeviceConfig>> configs;
+  for (unsigned i = 0; i < 3; i++) {
+    configs.push_back(llvm::make_unique<DeviceConfig>("Interpreter"));
+  }
+  auto hostManager = llvm::make_unique<HostManager>(std::move(configs));
+  CompilationContext cctx;
+  ASSERT_FALSE(ERR_TO_BOOL(
+      hostManager->addNetwork(createAddConstantModule("net", 1), cctx)));
+  std::shared_ptr<Module> module;
+  ASSIGN_VALUE_OR_FAIL_TEST(module, hostManager->getNetworkModule("net"));
+  auto run = [&]() {
+    PlaceholderBindings bindings;
+    bindings.allocate(module->getPlaceholderByName("X"))->zero();
+    auto *out = bindings.allocate(module->getPlaceholderByName("out"));
+    return !ERR_TO_BOOL(hostManager->runNetworkBlocking("net", bindings)) &&
+           out->getHandle().at({999}) == 1;
+  };
+  auto getNumReplicas = [&]() -> size_t {
+    DAG *dag = EXIT_ON_ERR(hostManager->getNetworkDAG("net"));
+    return dag->nodes[0]->deviceIDs.size();
+  };
+  ASSERT_TRUE(run());
+  EXPECT_EQ(getNumReplicas(), 1);
+
+  ASSERT_FALSE(ERR_TO_BOOL(hostManager->setTargetQPS("net", 1e9)));
+  PlacementPlan plan;
+  ASSIGN_VALUE_OR_FAIL_TEST(plan, hostManager->planPlacement());
+  EXPECT_EQ(plan.replicas["net"], std::vector<unsigned>({0, 1, 2}));
+  unsigned numMoved;
+  ASSIGN_VALUE_OR_FAIL_TEST(numMoved, hostManager->applyPlacement(plan));
+  EXPECT_EQ(numMoved, 1);
+  EXPECT_EQ(getNumReplicas(), 3);
+  for (unsigned i = 0; i < 6; i++) {
+    EXPECT_TRUE(run());
+  }
+
+  ASSERT_FALSE(ERR_TO_BOOL(hostManager->setTargetQPS("net", 1)));
+  ASSIGN_VALUE_OR_FAIL_TEST(plan, hostManager->planPlacement());
+  EXPECT_EQ(plan.replicas["net"].size(), 1);
+  ASSIGN_VALUE_OR_FAIL_TEST(numMoved, hostManager->applyPlacement(plan));
+  EXPECT_EQ(numMoved, 1);
+  EXPECT_EQ(getNumReplicas(), 1);
+  EXPECT_TRUE(run());
+
+  EXPECT_TRUE(ERR_TO_BOOL(hostManager->setTargetQPS("missing", 1)));
+}
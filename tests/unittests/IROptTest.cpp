@@ -128,6 +128,41 @@ TEST(Optimizer, shareBuffers) {
   EXPECT_EQ(M.getInstrs().size(), 2);
 }
 
+/// Check that the source and destination of a RescaleQuantized share a buffer
+/// although their quantization parameters differ.
+TEST(Optimizer, shareBuffersOfRescale) {
+  Module mod;
+  Function *F = mod.createFunction("ShareBuffersOfRescale");
+  IRFunction M(F);
+  IRBuilder bb(&M);
+
+  auto *input = bb.createWeightVar(
+      mod.uniqueType(glow::ElemKind::Int8QTy, {4}, 1.0, 0), "input",
+      WeightVar::MutabilityKind::Constant);
+  auto *output = bb.createWeightVar(
+      mod.uniqueType(glow::ElemKind::Int8QTy, {4}, 0.25, 0), "output",
+      WeightVar::MutabilityKind::Mutable);
+
+  auto *alloc = bb.createAllocActivationInst(
+      "alloc", mod.uniqueType(glow::ElemKind::Int8QTy, {4}, 0.5, 0));
+  bb.createRescaleQuantizedInst("rescale1", alloc, input);
+  bb.createRescaleQuantizedInst("rescale2", output, alloc);
+  bb.createDeallocActivationInst("dealloc", alloc);
+
+  optimize(M, MockBackend().shouldShareBuffers());
+
+  // The activation is replaced by a view of the output with its type.
+  unsigned numRescales = 0;
+  for (auto &I : M.getInstrs()) {
+    EXPECT_FALSE(isa<AllocActivationInst>(&I));
+    if (auto *RI = dyn_cast<RescaleQuantizedInst>(&I)) {
+      EXPECT_EQ(getOrigin(RI->getDest()), output);
+      numRescales++;
+    }
+  }
+  EXPECT_EQ(numRescales, 2);
+}
+
 TEST(Optimizer, deleteDeadViews) {
   Module mod;
   Function *F = mod.createFunction("DeleteDeadViews");
@@ -294,6 +329,58 @@ TEST(Optimizer, insertOptimizer) {
       }));
 }
 
+/// Check that an insert along an inner dimension is replaced by a tensorview
+/// when the inserted region is contiguous, but not otherwise.
+TEST(Optimizer, insertOptimizerInnerDim) {
+  Module mod;
+  Function *F = mod.createFunction("InsertOptimizerInnerDim");
+  IRFunction M(F);
+  IRBuilder bb(&M);
+
+  auto *output1 =
+      bb.createWeightVar(glow::ElemKind::FloatTy, {1, 6, 5}, "output1",
+                         WeightVar::MutabilityKind::Mutable);
+  auto *output2 =
+      bb.createWeightVar(glow::ElemKind::FloatTy, {2, 6, 5}, "output2",
+                         WeightVar::MutabilityKind::Mutable);
+
+  auto *allocSrc1 = bb.createAllocActivationInst(
+      "allocSrc1", glow::ElemKind::FloatTy, {1, 2, 5});
+  auto *allocSrc2 = bb.createAllocActivationInst(
+      "allocSrc2", glow::ElemKind::FloatTy, {2, 2, 5});
+
+  bb.createSplatInst("splatSrc1", allocSrc1, 1.0);
+  bb.createSplatInst("splatSrc2", allocSrc2, 1.0);
+  bb.createSplatInst("splatDest1", output1, 2.0);
+  bb.createSplatInst("splatDest2", output2, 2.0);
+
+  // The rows of allocSrc1 are contiguous in output1, but not the ones of
+  // allocSrc2 in output2.
+  bb.createInsertTensorInst("insert1", output1, allocSrc1, {0, 4, 0}, 1, 0);
+  bb.createInsertTensorInst("insert2", output2, allocSrc2, {0, 4, 0}, 1, 0);
+
+  bb.createDeallocActivationInst("deallocSrc1", allocSrc1);
+  bb.createDeallocActivationInst("deallocSrc2", allocSrc2);
+
+  optimize(M, MockBackend().shouldShareBuffers());
+
+  // Only the first insert should be replaced by a tensorview.
+  unsigned numInserts = 0;
+  unsigned numViews = 0;
+  for (const auto &I : M.getInstrs()) {
+    if (auto *ITI = dyn_cast<InsertTensorInst>(&I)) {
+      EXPECT_EQ(ITI->getDest(), output2);
+      numInserts++;
+    }
+    if (auto *TVI = dyn_cast<TensorViewInst>(&I)) {
+      EXPECT_EQ(TVI->getSrc(), output1);
+      numViews++;
+    }
+  }
+  EXPECT_EQ(numInserts, 1);
+  EXPECT_EQ(numViews, 1);
+}
+
 /// This is representative of what a ConcatNode is IRGen'd into: src1 and src2
 /// represent the two tensors that are being concatenated, and dest represents
 /// the resulting concatenated tensor.
@@ -386,6 +473,120 @@ TEST(Optimizer, twoExtractsWithBuffersOptimizer) {
       [](const Instruction &I) -> bool { return isa<ExtractTensorInst>(&I); }));
 }
 
+/// Check that a slice, an element-wise instruction and a reduction of the
+/// inner dimensions are split into tiles of rows, with their intermediate
+/// results kept in buffers of one tile.
+TEST(Optimizer, tileInstructionChains) {
+  Module mod;
+  Function *F = mod.createFunction("tileInstructionChains");
+  IRFunction M(F);
+  IRBuilder bb(&M);
+
+  auto *input = bb.createWeightVar(glow::ElemKind::FloatTy, {16, 8, 4},
+                                   "input", WeightVar::MutabilityKind::Mutable);
+  auto *output = bb.createWeightVar(glow::ElemKind::FloatTy, {16, 4}, "output",
+                                    WeightVar::MutabilityKind::Mutable);
+
+  auto *slice = bb.createAllocActivationInst(
+      "slice", glow::ElemKind::FloatTy, {16, 4, 4});
+  auto *square = bb.createAllocActivationInst(
+      "square", glow::ElemKind::FloatTy, {16, 4, 4});
+  bb.createExtractTensorInst("extract", slice, input, {0, 4, 0});
+  bb.createElementMulInst("mul", square, slice, slice);
+  bb.createBatchedReduceAddInst("reduce", output, square, 2);
+  bb.createDeallocActivationInst("deallocSquare", square);
+  bb.createDeallocActivationInst("deallocSlice", slice);
+
+  // A row of the buffers takes 128 + 64 + 64 + 16 bytes, tile by 4 rows.
+  EXPECT_TRUE(tileInstructionChains(M, 4 * 272));
+
+  auto &instrs = M.getInstrs();
+  auto count = [&](Kinded::Kind kind) {
+    return std::count_if(
+        instrs.begin(), instrs.end(),
+        [kind](const Instruction &I) { return I.getKind() == kind; });
+  };
+  EXPECT_EQ(count(Kinded::Kind::ExtractTensorInstKind), 4);
+  EXPECT_EQ(count(Kinded::Kind::ElementMulInstKind), 4);
+  EXPECT_EQ(count(Kinded::Kind::BatchedReduceAddInstKind), 4);
+  // The intermediate results only take one tile.
+  for (const auto &I : instrs) {
+    if (auto *AA = dyn_cast<AllocActivationInst>(&I)) {
+      EXPECT_EQ(AA->dims()[0], 4u);
+    }
+  }
+
+  // There is nothing to tile when the whole chain fits in the cache.
+  EXPECT_FALSE(tileInstructionChains(M, 16 * 272));
+}
+
+/// Check that the slices and the concats along the inner dimension that are
+/// only accessed by data-parallel instructions are replaced by strided views,
+/// and that the others are kept.
+TEST(Optimizer, createStridedViews) {
+  Module mod;
+  Function *F = mod.createFunction("createStridedViews");
+  IRFunction M(F);
+  IRBuilder bb(&M);
+
+  auto *input = bb.createWeightVar(glow::ElemKind::FloatTy, {8, 6, 4}, "input",
+                                   WeightVar::MutabilityKind::Mutable);
+  auto *output =
+      bb.createWeightVar(glow::ElemKind::FloatTy, {8, 6, 4}, "output",
+                         WeightVar::MutabilityKind::Mutable);
+  auto *sum = bb.createWeightVar(glow::ElemKind::FloatTy, {8, 2}, "sum",
+                                 WeightVar::MutabilityKind::Mutable);
+
+  auto *slice = bb.createAllocActivationInst(
+      "slice", glow::ElemKind::FloatTy, {8, 6, 2});
+  auto *square = bb.createAllocActivationInst(
+      "square", glow::ElemKind::FloatTy, {8, 6, 2});
+  auto *tanh = bb.createAllocActivationInst("tanh", glow::ElemKind::FloatTy,
+                                            {8, 6, 2});
+  auto *reduced = bb.createAllocActivationInst(
+      "reduced", glow::ElemKind::FloatTy, {8, 4, 2});
+  bb.createExtractTensorInst("extract", slice, input, {0, 0, 1});
+  bb.createElementMulInst("mul", square, slice, slice);
+  bb.createTanhInst("tanh", tanh, slice);
+  bb.createInsertTensorInst("insertSquare", output, square, {0, 0, 0}, 1, 0);
+  bb.createInsertTensorInst("insertTanh", output, tanh, {0, 0, 2}, 1, 0);
+  // The reduction isn't data-parallel, its input is still copied.
+  bb.createExtractTensorInst("extractReduced", reduced, input, {0, 1, 2});
+  bb.createBatchedReduceAddInst("reduce", sum, reduced, 1);
+  bb.createDeallocActivationInst("deallocReduced", reduced);
+  bb.createDeallocActivationInst("deallocTanh", tanh);
+  bb.createDeallocActivationInst("deallocSquare", square);
+  bb.createDeallocActivationInst("deallocSlice", slice);
+
+  EXPECT_TRUE(createStridedViews(M));
+
+  auto &instrs = M.getInstrs();
+  auto count = [&](Kinded::Kind kind) {
+    return std::count_if(
+        instrs.begin(), instrs.end(),
+        [kind](const Instruction &I) { return I.getKind() == kind; });
+  };
+  EXPECT_EQ(count(Kinded::Kind::InsertTensorInstKind), 0);
+  EXPECT_EQ(count(Kinded::Kind::ExtractTensorInstKind), 1);
+  EXPECT_EQ(count(Kinded::Kind::TensorViewInstKind), 3);
+  EXPECT_EQ(count(Kinded::Kind::AllocActivationInstKind), 1);
+  size_t rowLen = 0;
+  size_t pitch = 0;
+  for (const auto &I : instrs) {
+    if (auto *TVI = dyn_cast<TensorViewInst>(&I)) {
+      EXPECT_TRUE(getStridedViewLayout(TVI, rowLen, pitch));
+      EXPECT_EQ(rowLen, 2u);
+      EXPECT_EQ(pitch, 4u);
+    }
+  }
+
+  // The remaining extract reads rows of 2 elements every 4 elements, but
+  // they are not evenly spaced across the outer dimension.
+  EXPECT_FALSE(getStridedRegionLayout({0, 1, 2}, {8, 4, 2}, {8, 6, 4},
+                                      rowLen, pitch));
+  EXPECT_FALSE(createStridedViews(M));
+}
+
 /// Check that we are able to coalesce a copy forward from the input.
 /// This test consists in copy from the input variable.
 /// Its may characteristic is that this copy cannot be coalesced with
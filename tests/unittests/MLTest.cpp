@@ -15,6 +15,7 @@
  */
 #include "BackendTestUtils.h"
 
+#include "glow/ExecutionEngine/DataParallelTrainer.h"
 #include "glow/ExecutionEngine/ExecutionEngine.h"
 #include "glow/Graph/Graph.h"
 #include "glow/Quantization/Quantization.h"
@@ -1745,4 +1746,209 @@ TEST_P(MLTest, learnSparseLengthsWeightedSumWeights) {
   }
 }
 
+/// Check two steps of an SGD update with weight decays and momentum against
+/// the steps computed by hand.
+TEST_P(MLTest, sgdUpdateWithMomentum) {
+  CHECK_IF_ENABLED();
+  constexpr float L1Decay = 0.01;
+  constexpr float L2Decay = 0.02;
+  constexpr float learningRate = 0.1;
+  constexpr float momentum = 0.5;
+  constexpr unsigned batchSize = 2;
+
+  ExecutionEngine EE(GetParam());
+  auto &mod = EE.getModule();
+  Function *F = mod.createFunction("sgd");
+  auto *W = mod.createPlaceholder(ElemKind::FloatTy, {5}, "W", true);
+  auto *G = mod.createPlaceholder(ElemKind::FloatTy, {5}, "G", false);
+  auto *SGD = F->addNode(new SGDNode("sgd", G, W, L1Decay, L2Decay,
+                                     learningRate, momentum, batchSize));
+  F->createSave("save", SGD, W);
+  EE.compile(CompilationMode::Train);
+
+  PlaceholderBindings bindings;
+  bindings.allocate(mod.getPlaceholders());
+  auto WH = bindings.get(W)->getHandle();
+  WH = {1.0, -2.0, 0.5, 0.0, -0.25};
+  bindings.get(G)->getHandle() = {0.3, -0.1, 2.0, -1.0, 0.0};
+
+  std::vector<float> weights(WH.begin(), WH.end());
+  std::vector<float> gsum(weights.size(), 0);
+  auto GH = bindings.get(G)->getHandle();
+  for (int step = 0; step < 2; step++) {
+    EE.run(bindings);
+    for (size_t i = 0; i < weights.size(); i++) {
+      float w = weights[i];
+      float g = GH.raw(i) + L1Decay * (w >= 0 ? 1 : -1) + L2Decay * w;
+      gsum[i] = momentum * gsum[i] - learningRate * (g / batchSize);
+      weights[i] = w + gsum[i];
+      EXPECT_NEAR(WH.raw(i), weights[i], 1e-6);
+    }
+  }
+}
+
+/// Check a step of training an embedding table by a SparseLengthsWeightedSum
+/// of it: only the rows that were looked up change, by their gradients.
+TEST_P(MLTest, sparseLengthsWeightedSumSGDUpdate) {
+  CHECK_IF_ENABLED();
+  TrainingConfig TC;
+  TC.learningRate = 0.1;
+  TC.batchSize = 2;
+
+  ExecutionEngine EE(GetParam());
+  auto &mod = EE.getModule();
+  Function *F = mod.createFunction("slws");
+  auto *data = mod.createPlaceholder(ElemKind::FloatTy, {6, 2}, "data", true);
+  auto *weights =
+      mod.createPlaceholder(ElemKind::FloatTy, {4}, "weights", false);
+  auto *indices =
+      mod.createPlaceholder(ElemKind::Int64ITy, {4}, "indices", false);
+  auto *lengths =
+      mod.createPlaceholder(ElemKind::Int32ITy, {2}, "lengths", false);
+  auto *expected =
+      mod.createPlaceholder(ElemKind::FloatTy, {2, 2}, "expected", false);
+  auto *SLWS = F->createSparseLengthsWeightedSum("SLWS", data, weights,
+                                                 indices, lengths);
+  auto *reg = F->createRegression("reg", SLWS, expected);
+  F->createSave("save", reg);
+  auto *TF = glow::differentiate(F, TC);
+  auto tfName = TF->getName();
+  EE.compile(CompilationMode::Train);
+
+  PlaceholderBindings bindings;
+  bindings.allocate(mod.getPlaceholders());
+  auto DH = bindings.get(data)->getHandle();
+  DH = {0.0, 0.5, 1.0, 1.5, 2.0, 2.5, 3.0, 3.5, 4.0, 4.5, 5.0, 5.5};
+  auto WH = bindings.get(weights)->getHandle();
+  WH = {0.5, 2.0, -1.0, 1.0};
+  auto IH = bindings.get(indices)->getHandle<int64_t>();
+  IH = {1, 3, 1, 4};
+  bindings.get(lengths)->getHandle<int32_t>() = {2, 2};
+  auto EH = bindings.get(expected)->getHandle();
+  EH = {1.0, 2.0, 3.0, 4.0};
+
+  Tensor before = bindings.get(data)->clone();
+  auto BH = before.getHandle();
+  EE.run(bindings, tfName);
+
+  // The gradient of every row is the sum of the errors of the segments that
+  // looked it up, scaled by the weights of the lookups.
+  Tensor grad(ElemKind::FloatTy, {6, 2});
+  grad.zero();
+  auto GH = grad.getHandle();
+  for (size_t seg = 0; seg < 2; seg++) {
+    for (size_t k = 0; k < 2; k++) {
+      float res = 0;
+      for (size_t j = seg * 2; j < seg * 2 + 2; j++) {
+        res += WH.raw(j) * BH.at({size_t(IH.raw(j)), k});
+      }
+      for (size_t j = seg * 2; j < seg * 2 + 2; j++) {
+        GH.at({size_t(IH.raw(j)), k}) += WH.raw(j) * (res - EH.at({seg, k}));
+      }
+    }
+  }
+  for (size_t row = 0; row < 6; row++) {
+    for (size_t k = 0; k < 2; k++) {
+      EXPECT_NEAR(DH.at({row, k}),
+                  BH.at({row, k}) -
+                      TC.learningRate * GH.at({row, k}) / TC.batchSize,
+                  1e-5);
+    }
+  }
+  // Rows 0, 2 and 5 were not looked up.
+  for (size_t k = 0; k < 2; k++) {
+    EXPECT_EQ(DH.at({0, k}), BH.at({0, k}));
+    EXPECT_EQ(DH.at({2, k}), BH.at({2, k}));
+    EXPECT_EQ(DH.at({5, k}), BH.at({5, k}));
+  }
+}
+
+/// Check that training a linear regression with data parallelism over two
+/// replicas gives the weights of training it on a single device with a
+/// minibatch twice larger.
+TEST_P(MLTest, dataParallelTraining) {
+  CHECK_IF_ENABLED();
+  constexpr unsigned numReplicas = 2;
+  constexpr size_t shardSize = 2;
+  constexpr size_t numSamples = 16;
+  TrainingConfig TC;
+  TC.learningRate = 0.05;
+  TC.momentum = 0.9;
+
+  // The samples of y = x0 + 2 * x1 - 3 * x2 + 0.5.
+  PseudoRNG PRNG;
+  Tensor inputs(ElemKind::FloatTy, {numSamples, 3});
+  Tensor expected(ElemKind::FloatTy, {numSamples, 1});
+  inputs.getHandle().randomize(-1.0, 1.0, PRNG);
+  auto IH = inputs.getHandle();
+  auto EH = expected.getHandle();
+  for (size_t i = 0; i < numSamples; i++) {
+    EH.at({i, 0}) =
+        IH.at({i, 0}) + 2 * IH.at({i, 1}) - 3 * IH.at({i, 2}) + 0.5;
+  }
+
+  auto createNetwork = [](Module &mod, size_t batchSize) {
+    Function *F = mod.createFunction("linear");
+    auto *X = mod.createPlaceholder(ElemKind::FloatTy, {batchSize, 3}, "X",
+                                    false);
+    auto *E = mod.createPlaceholder(ElemKind::FloatTy, {batchSize, 1}, "E",
+                                    false);
+    auto *W = mod.createPlaceholder(ElemKind::FloatTy, {3, 1}, "W", true);
+    auto *B = mod.createPlaceholder(ElemKind::FloatTy, {1}, "B", true);
+    Node *O = F->createFullyConnected("fc", X, W, B);
+    O = F->createRegression("reg", O, E);
+    F->createSave("ret", O);
+    return F;
+  };
+  auto initWeights = [](Module &mod, PlaceholderBindings &bindings) {
+    bindings.get(mod.getPlaceholderByName("W"))->getHandle() = {0.1f, -0.2f,
+                                                                0.3f};
+    bindings.get(mod.getPlaceholderByName("B"))->getHandle() = {0};
+  };
+
+  // Train on a single device with minibatches of all the shards.
+  ExecutionEngine EE(GetParam());
+  auto &mod = EE.getModule();
+  Function *F = createNetwork(mod, numReplicas * shardSize);
+  TC.batchSize = numReplicas * shardSize;
+  auto *TF = glow::differentiate(F, TC);
+  auto tfName = TF->getName();
+  EE.compile(CompilationMode::Train);
+  PlaceholderBindings bindings;
+  bindings.allocate(mod.getPlaceholders());
+  initWeights(mod, bindings);
+  size_t sampleCounter = 0;
+  runBatch(EE, bindings, 10, sampleCounter,
+           {mod.getPlaceholderByName("X"), mod.getPlaceholderByName("E")},
+           {&inputs, &expected}, tfName);
+
+  // Train on two replicas with a shard each.
+  DataParallelTrainer trainer(GetParam(), numReplicas);
+  auto &trainerMod = trainer.getModule();
+  F = createNetwork(trainerMod, shardSize);
+  auto *X = trainerMod.getPlaceholderByName("X");
+  auto *E = trainerMod.getPlaceholderByName("E");
+  TC.batchSize = shardSize;
+  CompilationContext cctx;
+  EXIT_ON_ERR(trainer.compile(F, TC, cctx));
+  PlaceholderBindings trainerBindings;
+  trainerBindings.allocate(trainerMod.getPlaceholders());
+  initWeights(trainerMod, trainerBindings);
+  trainer.loadBindings(trainerBindings);
+  size_t trainerSampleCounter = 0;
+  EXIT_ON_ERR(
+      trainer.train(10, trainerSampleCounter, {X, E}, {&inputs, &expected}));
+  trainer.storeBindings(trainerBindings);
+  EXPECT_EQ(sampleCounter, trainerSampleCounter);
+
+  for (llvm::StringRef name : {"W", "B"}) {
+    auto *T = bindings.get(mod.getPlaceholderByName(name));
+    auto *trainerT = trainerBindings.get(trainerMod.getPlaceholderByName(name));
+    EXPECT_TRUE(T->isEqual(*trainerT));
+  }
+  // The weights were trained.
+  EXPECT_NE(bindings.get(mod.getPlaceholderByName("W"))->getHandle().raw(0),
+            0.1f);
+}
+
 INSTANTIATE_BACKEND_TEST(MLTest);
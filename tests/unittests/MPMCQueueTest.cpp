@@ -0,0 +1,98 @@
+/**
+ * Copyright (c) Glow Contributors. See CONTRIBUTORS file.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "glow/Support/MPMCQueue.h"
+#include "gtest/gtest.h"
+
+#include "llvm/ADT/STLExtras.h"
+
+#include <thread>
+#include <vector>
+
+using namespace glow;
+
+TEST(MPMCQueue, FIFOTest) {
+  MPMCQueue<int> queue(3);
+  for (int i = 0; i < 4; i++) {
+    int value = i;
+    EXPECT_TRUE(queue.push(std::move(value)));
+  }
+  // The capacity is rounded up to 4.
+  int value = 4;
+  EXPECT_FALSE(queue.push(std::move(value)));
+  for (int i = 0; i < 4; i++) {
+    auto popped = queue.pop();
+    ASSERT_TRUE(popped.hasValue());
+    EXPECT_EQ(*popped, i);
+  }
+  EXPECT_FALSE(queue.pop().hasValue());
+}
+
+TEST(MPMCQueue, PriorityTest) {
+  MPMCPriorityQueue<int> queue(4, 2);
+  int a = 0, b = 1, c = 2, d = 3, e = 4;
+  EXPECT_TRUE(queue.push(std::move(a), 1));
+  EXPECT_TRUE(queue.push(std::move(b), 0));
+  // Priorities past the last one are queued as the last one.
+  EXPECT_TRUE(queue.push(std::move(c), 7));
+  EXPECT_TRUE(queue.push(std::move(d), 0));
+  EXPECT_FALSE(queue.push(std::move(e), 0));
+  EXPECT_EQ(queue.size(), 4u);
+  for (int expected : {1, 3, 0, 2}) {
+    auto popped = queue.pop();
+    ASSERT_TRUE(popped.hasValue());
+    EXPECT_EQ(*popped, expected);
+  }
+  EXPECT_TRUE(queue.empty());
+  EXPECT_FALSE(queue.pop().hasValue());
+}
+
+/// Test that every element pushed by concurrent producers is popped exactly
+/// once by concurrent consumers.
+TEST(MPMCQueue, ConcurrentTest) {
+  const unsigned numThreads = 4;
+  const unsigned numElements = 2000;
+  MPMCPriorityQueue<std::unique_ptr<unsigned>> queue(64, 3);
+  std::vector<std::atomic<unsigned>> counts(numThreads * numElements);
+  std::atomic<unsigned> numPopped{0};
+  std::vector<std::thread> threads;
+  for (unsigned t = 0; t < numThreads; t++) {
+    threads.emplace_back([&queue, t]() {
+      for (unsigned i = 0; i < numElements; i++) {
+        auto value = llvm::make_unique<unsigned>(t * numElements + i);
+        while (!queue.push(std::move(value), i % 4)) {
+          std::this_thread::yield();
+        }
+      }
+    });
+    threads.emplace_back([&queue, &counts, &numPopped]() {
+      while (numPopped < numThreads * numElements) {
+        if (auto value = queue.pop()) {
+          counts[**value]++;
+          numPopped++;
+        } else {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  for (auto &count : counts) {
+    EXPECT_EQ(count, 1);
+  }
+  EXPECT_TRUE(queue.empty());
+}
@@ -15,9 +15,12 @@
  */
 
 #include "glow/CodeGen/MemoryAllocator.h"
+#include "glow/Support/Memory.h"
 
 #include "gtest/gtest.h"
 
+#include <map>
+
 using namespace glow;
 
 TEST(MemAlloc, simple) {
@@ -172,6 +175,53 @@ TEST(MemAlloc, dealloc2) {
   EXPECT_EQ(MA.allocate(10, handle), 0);
 }
 
+/// Check that the allocator places the buffers in the first free segment they
+/// fit in, as a linear scan over the allocations does, when the buffers are
+/// freed in any order.
+TEST(MemAlloc, firstFitAfterRandomDeallocs) {
+  MemoryAllocator MA("test", 0);
+  // The reference allocations, mapping their beginnings to their ends.
+  std::map<uint64_t, uint64_t> expected;
+  std::vector<uint64_t> live;
+  uint32_t seed = 42;
+  auto next = [&]() {
+    seed = seed * 1103515245 + 12345;
+    return seed >> 8;
+  };
+
+  for (int i = 0; i < 2000; i++) {
+    if (!live.empty() && next() % 3 == 0) {
+      size_t idx = next() % live.size();
+      MA.deallocate(MA.getHandle(live[idx]));
+      expected.erase(live[idx]);
+      live[idx] = live.back();
+      live.pop_back();
+      continue;
+    }
+    uint64_t size = 1 + next() % 1000;
+    uint64_t segmentSize = alignedSize(size, TensorAlignment);
+    uint64_t ref = 0;
+    for (auto &allocation : expected) {
+      if (allocation.first - ref >= segmentSize) {
+        break;
+      }
+      ref = allocation.second;
+    }
+    const void *handle = reinterpret_cast<void *>(i + 1);
+    auto ptr = MA.allocate(size, handle);
+    ASSERT_EQ(ptr, ref);
+    expected[ptr] = ptr + segmentSize;
+    live.push_back(ptr);
+  }
+
+  // Check that after deallocating everything we start allocating from zero.
+  for (auto ptr : live) {
+    MA.deallocate(MA.getHandle(ptr));
+  }
+  EXPECT_FALSE(MA.contains(0));
+  EXPECT_EQ(MA.allocate(10, reinterpret_cast<void *>(1)), 0);
+}
+
 TEST(MemAlloc, allocateToTheMax) {
   MemoryAllocator MA("test", 128);
   void *handle0 = reinterpret_cast<void *>(0);
@@ -320,3 +370,43 @@ TEST(MemAlloc, testGetMemorySize) {
   MemoryAllocator MA2("test1", 102);
   EXPECT_EQ(MA2.getMemorySize(), 102);
 }
+
+/// Check that planning buffers offline from their live intervals can beat the
+/// first-fit allocation in time order.
+TEST(MemAlloc, planBestFit) {
+  // A is freed before C is allocated, but the first-fit allocation places B
+  // above A, so that C doesn't fit in the space of A.
+  std::vector<MemoryAllocator::Buffer> buffers{
+      {64, 0, 2}, {128, 1, 4}, {192, 3, 5}};
+  std::vector<uint64_t> offsets;
+  EXPECT_EQ(MemoryAllocator::planFirstFit(buffers, offsets), 384);
+  EXPECT_EQ(offsets, std::vector<uint64_t>({0, 64, 192}));
+
+  // Placing the largest buffers first reaches the lower bound.
+  EXPECT_EQ(MemoryAllocator::planBestFit(buffers, offsets), 320);
+  EXPECT_EQ(offsets, std::vector<uint64_t>({0, 192, 0}));
+  EXPECT_EQ(MemoryAllocator::getMaxLiveSize(buffers), 320);
+}
+
+TEST(MemAlloc, allocateAll) {
+  MemoryAllocator MA("test", 1024);
+  void *handle0 = reinterpret_cast<void *>(0);
+  void *handle1 = reinterpret_cast<void *>(1);
+  std::vector<MemoryAllocator::Buffer> buffers{
+      {64, 0, 2}, {128, 1, 4}, {192, 3, 5}};
+  std::vector<uint64_t> addrs;
+
+  // The buffers are placed above the live allocations.
+  EXPECT_EQ(MA.allocate(64, handle0), 0);
+  EXPECT_EQ(MA.allocateAll(buffers, handle1, addrs), 64);
+  EXPECT_EQ(addrs, std::vector<uint64_t>({64, 256, 64}));
+  EXPECT_EQ(MA.getSize(handle1), 320);
+  EXPECT_EQ(MA.getMaxMemoryUsage(), 384);
+
+  // Freeing the handle frees all the buffers.
+  MA.deallocate(handle1);
+  EXPECT_EQ(MA.allocate(960, handle1), 64);
+
+  // The region of the buffers must fit in the pool.
+  EXPECT_EQ(MA.allocateAll(buffers, handle1, addrs), MemoryAllocator::npos);
+}
@@ -23,6 +23,8 @@
 #define CL_USE_DEPRECATED_OPENCL_1_2_APIS
 
 #include "../../lib/Backends/OpenCL/OpenCLDeviceManager.h"
+#include "../../lib/Backends/OpenCL/OpenCLProgramCache.h"
+#include "../../lib/Backends/OpenCL/OpenCLTuningCache.h"
 #include "glow/Backends/DeviceManager.h"
 #include "glow/ExecutionEngine/ExecutionEngine.h"
 #include "glow/Graph/Graph.h"
@@ -31,6 +33,8 @@
 #include "glow/IR/Instrs.h"
 #include "gtest/gtest.h"
 
+#include "llvm/Support/FileSystem.h"
+
 /// Takes an Expected<T> \p rhsOrErrV, asserts that it is not an error,
 /// and takes the value from rhsOrErrV and assigns it to \p lhs.
 #define ASSERT_AND_ASSIGN_VALUE(lhs, rhsOrErrV)                                \
@@ -252,3 +256,172 @@ TEST_F(OpenCLCommandQueuePoolTest, NoQueueReuseWithDifferentProps) {
 
   pool_.returnCommandQueue(queue);
 }
+
+/// Tests that the execution lanes of an OpenCL device are configured by the
+/// executionLanes parameter.
+TEST(OpenCLCorrectnessTest, ExecutionLanes) {
+  using namespace runtime;
+  auto config = DeviceConfig("OpenCL");
+  config.parameters["executionLanes"] = "3";
+  OpenCLDeviceManager openCLDevice(config);
+  ASSERT_FALSE(ERR_TO_BOOL(openCLDevice.init()));
+  EXPECT_EQ(openCLDevice.getNumExecutionLanes(), 3);
+}
+
+/// Tests that the constants which may be streamed from the host, as
+/// configured by the weightStreamingHostMB parameter, count as available
+/// memory of an OpenCL device.
+TEST(OpenCLCorrectnessTest, WeightStreamingMemory) {
+  using namespace runtime;
+  auto config = DeviceConfig("OpenCL");
+  config.setDeviceMemory(32768);
+  config.parameters["weightStreamingHostMB"] = "1";
+  OpenCLDeviceManager openCLDevice(config);
+  ASSERT_FALSE(ERR_TO_BOOL(openCLDevice.init()));
+  EXPECT_EQ(openCLDevice.getMaximumMemory(), 32768);
+  EXPECT_EQ(openCLDevice.getAvailableMemory(), 32768 + (1 << 20));
+  EXPECT_TRUE(openCLDevice.isMemoryAvailable(1 << 20));
+  EXPECT_FALSE(openCLDevice.isMemoryAvailable(32768 + (1 << 20) + 1));
+}
+
+class OpenCLStagingBufferPoolTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    // Get an OpenCL platform ID.
+    std::vector<cl_platform_id> platforms(1);
+    cl_int err = clGetPlatformIDs(1, platforms.data(), NULL);
+    ASSERT_EQ(err, CL_SUCCESS) << "clGetPlatformIDs failed.";
+
+    // Get an OpenCL device ID.
+    cl_platform_id platform_id_used = platforms[0];
+    std::vector<cl_device_id> devices(1);
+    err = clGetDeviceIDs(platform_id_used, CL_DEVICE_TYPE_ALL, 1,
+                         devices.data(), NULL);
+    ASSERT_EQ(err, CL_SUCCESS) << "clGetDeviceIDs failed";
+
+    // Create an OpenCL context.
+    device_ = devices[0];
+    context_ = clCreateContext(nullptr, 1, &device_, nullptr, nullptr, nullptr);
+    ASSERT_TRUE(context_) << "clCreateContext failed";
+
+    // Set the context and device on the pool to prepare for the tests.
+    pool_.reset(new runtime::OpenCLStagingBufferPool());
+    pool_->setContext(context_);
+    pool_->setDevice(device_);
+  }
+
+  void TearDown() override {
+    // Release the buffers of the pool and then the context.
+    pool_.reset();
+    cl_int err = clReleaseContext(context_);
+    ASSERT_EQ(err, CL_SUCCESS) << "clReleaseContext failed";
+  }
+
+  cl_context context_{nullptr};
+  cl_device_id device_{0};
+  std::unique_ptr<runtime::OpenCLStagingBufferPool> pool_;
+};
+
+/// Tests that the pool reuses a staging buffer large enough for a request.
+TEST_F(OpenCLStagingBufferPoolTest, BufferReuse) {
+  runtime::OpenCLStagingBuffer buffer;
+
+  // Request a buffer and write into it.
+  Expected<runtime::OpenCLStagingBuffer> bufferOrError =
+      pool_->requestStagingBuffer(1024);
+  ASSERT_AND_ASSIGN_VALUE(buffer, bufferOrError);
+  ASSERT_TRUE(buffer.hostPtr);
+  EXPECT_EQ(buffer.size, 1024);
+  memset(buffer.hostPtr, 0, buffer.size);
+  cl_mem backingBuffer1 = buffer.backingBuffer;
+
+  // Put it back and request a smaller one.
+  pool_->returnStagingBuffer(buffer);
+  bufferOrError = pool_->requestStagingBuffer(512);
+  ASSERT_AND_ASSIGN_VALUE(buffer, bufferOrError);
+
+  // The same buffer should have been returned and only one allocated.
+  EXPECT_EQ(buffer.backingBuffer, backingBuffer1);
+  EXPECT_EQ(pool_->getNumAllocatedBuffers(), 1);
+  EXPECT_EQ(pool_->getNumBuffersAvailable(), 0);
+
+  pool_->returnStagingBuffer(buffer);
+  EXPECT_EQ(pool_->getNumBuffersAvailable(), 1);
+}
+
+/// Tests that the pool allocates a new staging buffer when the available ones
+/// are too small.
+TEST_F(OpenCLStagingBufferPoolTest, NoReuseOfSmallerBuffers) {
+  runtime::OpenCLStagingBuffer small, large;
+
+  Expected<runtime::OpenCLStagingBuffer> bufferOrError =
+      pool_->requestStagingBuffer(256);
+  ASSERT_AND_ASSIGN_VALUE(small, bufferOrError);
+  pool_->returnStagingBuffer(small);
+
+  bufferOrError = pool_->requestStagingBuffer(4096);
+  ASSERT_AND_ASSIGN_VALUE(large, bufferOrError);
+  EXPECT_EQ(large.size, 4096);
+  EXPECT_NE(large.backingBuffer, small.backingBuffer);
+  EXPECT_EQ(pool_->getNumAllocatedBuffers(), 2);
+  EXPECT_EQ(pool_->getNumBuffersAvailable(), 1);
+
+  pool_->returnStagingBuffer(large);
+}
+
+/// Tests that the configurations of the tuning cache survive saving and
+/// loading it.
+TEST(OpenCLTuningCacheTest, SaveAndLoad) {
+  llvm::SmallVector<char, 64> resultPath;
+  llvm::sys::fs::createTemporaryFile("opencl", "tuning", resultPath);
+  std::string path(resultPath.begin(), resultPath.end());
+
+  OpenCLTuningCache cache;
+  auto localKey = OpenCLTuningCache::getKey("GPU\t0", "reluW", {64, 32});
+  auto convKey =
+      OpenCLTuningCache::getKey("GPU\t0", "conv_forward_mem", {3, 3, 1, 1});
+  cache.insert(localKey, {16, 8});
+  cache.insert(convKey, {8, 16, 4, 8, 4});
+  ASSERT_FALSE(ERR_TO_BOOL(cache.save(path)));
+
+  OpenCLTuningCache loaded;
+  ASSERT_FALSE(ERR_TO_BOOL(loaded.load(path)));
+  EXPECT_EQ(loaded.size(), 2);
+  std::vector<size_t> values;
+  ASSERT_TRUE(loaded.lookup(localKey, values));
+  EXPECT_EQ(values, std::vector<size_t>({16, 8}));
+  ASSERT_TRUE(loaded.lookup(convKey, values));
+  EXPECT_EQ(values, std::vector<size_t>({8, 16, 4, 8, 4}));
+  EXPECT_FALSE(loaded.lookup(
+      OpenCLTuningCache::getKey("GPU\t0", "reluW", {64, 16}), values));
+  llvm::sys::fs::remove(path);
+
+  // A missing file is an empty cache.
+  OpenCLTuningCache empty;
+  ASSERT_FALSE(ERR_TO_BOOL(empty.load(path)));
+  EXPECT_EQ(empty.size(), 0);
+}
+
+/// Tests that the program cache returns the stored binaries by key, and that
+/// the key depends on the build options.
+TEST(OpenCLProgramCacheTest, StoreAndLoad) {
+  llvm::SmallString<64> dir;
+  ASSERT_FALSE(llvm::sys::fs::createUniqueDirectory("opencl-programs", dir));
+  OpenCLProgramCache cache(dir);
+
+  auto key = OpenCLProgramCache::getKey("GPU", "OpenCL 1.2", "1.0", "source",
+                                        "-Dv_k_0=3");
+  auto otherKey = OpenCLProgramCache::getKey("GPU", "OpenCL 1.2", "1.0",
+                                             "source", "-Dv_k_0=5");
+  EXPECT_NE(key, otherKey);
+  EXPECT_FALSE(cache.load(key));
+
+  std::string binary("\x7f" "ELF binary", 11);
+  cache.store(key, binary);
+  auto loaded = cache.load(key);
+  ASSERT_TRUE(loaded);
+  EXPECT_EQ(loaded->getBuffer(), binary);
+  EXPECT_FALSE(cache.load(otherKey));
+
+  llvm::sys::fs::remove_directories(dir);
+}
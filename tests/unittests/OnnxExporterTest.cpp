@@ -122,3 +122,51 @@ TEST(exporter, onnxModels) {
     testLoadAndSaveONNXModel(dirIt->path());
   }
 }
+
+/// Check that the payloads of the larger Constants are streamed to the
+/// external data file, and loaded back from it.
+TEST(exporter, externalData) {
+  Module mod;
+  Function *F = mod.createFunction("F");
+  PseudoRNG PRNG;
+  auto *input =
+      mod.createPlaceholder(ElemKind::FloatTy, {16, 64}, "input", false);
+  auto *weights = mod.createConstant(ElemKind::FloatTy, {16, 64}, "weights");
+  weights->getPayloadMutable().getHandle().randomize(-1.0, 1.0, PRNG);
+  F->createSave("out", F->createAdd("add", input, weights));
+  auto *smallInput =
+      mod.createPlaceholder(ElemKind::FloatTy, {2, 2}, "smallInput", false);
+  auto *small = mod.createConstant(ElemKind::FloatTy, {2, 2}, "small");
+  small->getPayloadMutable().getHandle().randomize(-1.0, 1.0, PRNG);
+  F->createSave("smallOut", F->createAdd("smallAdd", smallInput, small));
+
+  llvm::SmallString<64> path;
+  ASSERT_FALSE(llvm::sys::fs::createTemporaryFile("exporter", ".onnx", path));
+  std::string outputFilename(path.c_str());
+  std::string dataFilename = outputFilename + ".data";
+  Error err = Error::empty();
+  {
+    ONNXModelWriter onnxWR(outputFilename, *F, 5, 10, &err, false,
+                           /* externalData */ true);
+  }
+  ASSERT_FALSE(ERR_TO_BOOL(std::move(err)));
+
+  // Only the payload of the larger Constant is external.
+  uint64_t dataSize = 0;
+  ASSERT_FALSE(llvm::sys::fs::file_size(dataFilename, dataSize));
+  EXPECT_EQ(dataSize, weights->getPayload().getSizeInBytes());
+
+  Module loaded;
+  Function *R = loaded.createFunction("reload");
+  err = Error::empty();
+  { ONNXModelLoader onnxLD(outputFilename, {}, {}, *R, &err); }
+  llvm::sys::fs::remove(outputFilename);
+  llvm::sys::fs::remove(dataFilename);
+  ASSERT_FALSE(ERR_TO_BOOL(std::move(err)));
+
+  for (const Constant *C : {weights, small}) {
+    Constant *LC = loaded.getConstantByName(C->getName());
+    ASSERT_TRUE(LC);
+    EXPECT_TRUE(LC->getPayload().isEqual(C->getPayload()));
+  }
+}
@@ -1306,6 +1306,57 @@ TEST(onnx, importBatchBoxCox) {
       {bindings.get(output)}));
 }
 
+/// Test loading LayerNormalization op from an ONNX model.
+TEST(onnx, importLayerNormalization) {
+  ExecutionEngine EE{};
+  auto &mod = EE.getModule();
+  Function *F = mod.createFunction("main");
+
+  std::string netFilename(GLOW_DATA_PATH
+                          "tests/models/onnxModels/layerNorm.onnxtxt");
+
+  PlaceholderBindings bindings;
+  Placeholder *output;
+  Tensor x(ElemKind::FloatTy, {2, 4});
+  x.getHandle() = {1, 2, 3, 4, -10, 0, 10, 40};
+  {
+    ONNXModelLoader onnxLD(netFilename, {"x"}, {&x.getType()}, *F);
+    output = EXIT_ON_ERR(onnxLD.getSingleOutput());
+    bindings.allocate(mod.getPlaceholders());
+    updateInputPlaceholdersByName(bindings, &mod, {"x"}, {&x});
+  }
+
+  auto *save = getSaveNodeFromDest(output);
+  auto *LN = llvm::dyn_cast<LayerNormalizationNode>(save->getInput().getNode());
+  ASSERT_TRUE(LN);
+  EXPECT_FLOAT_EQ(LN->getEpsilon(), 0.001);
+  EXPECT_EQ(LN->getScale().dims().vec(), std::vector<size_t>({4}));
+
+  auto *res = bindings.get(output);
+  EE.compile(CompilationMode::Infer);
+  EE.run(bindings);
+
+  auto result = res->getHandle();
+  auto xH = x.getHandle();
+  const std::vector<float> scale = {1.0, 2.0, 0.5, -1.0};
+  const std::vector<float> bias = {0.0, 0.5, -1.0, 2.0};
+  for (size_t i = 0; i < 2; i++) {
+    float mean = 0;
+    for (size_t j = 0; j < 4; j++) {
+      mean += xH.at({i, j}) / 4;
+    }
+    float var = 0;
+    for (size_t j = 0; j < 4; j++) {
+      var += (xH.at({i, j}) - mean) * (xH.at({i, j}) - mean) / 4;
+    }
+    for (size_t j = 0; j < 4; j++) {
+      float y =
+          (xH.at({i, j}) - mean) / std::sqrt(var + 0.001) * scale[j] + bias[j];
+      EXPECT_NEAR(y, result.at({i, j}), 1e-5);
+    }
+  }
+}
+
 /// Test loading DotProduct op from an ONNX model.
 TEST(onnx, importDotProduct) {
   ExecutionEngine EE{};
@@ -2519,3 +2570,64 @@ TEST(onnx, importLess) {
   EXPECT_EQ(CMPLT->getResult().dims()[1], 4);
   EXPECT_EQ(CMPLT->getResult().dims()[2], 1);
 }
+
+/// Test loading an initializer stored in an external file, which is mapped in
+/// memory rather than copied into its Constant.
+TEST(onnx, importExternalInitializer) {
+  ExecutionEngine EE{};
+  auto &mod = EE.getModule();
+  Function *F = mod.createFunction("main");
+  std::string netFilename(
+      GLOW_DATA_PATH "tests/models/onnxModels/externalInitializer.onnxtxt");
+
+  PlaceholderBindings bindings;
+  Placeholder *output;
+  Tensor x(ElemKind::FloatTy, {2, 2});
+  x.getHandle() = {1, 2, 3, 4};
+  {
+    ONNXModelLoader onnxLD(netFilename, {"x"}, {&x.getType()}, *F);
+    output = EXIT_ON_ERR(onnxLD.getSingleOutput());
+    bindings.allocate(mod.getPlaceholders());
+    updateInputPlaceholdersByName(bindings, &mod, {"x"}, {&x});
+  }
+
+  // The mapping of the weights is kept by the Module after the loader is gone.
+  Constant *W = mod.getConstantByName("W");
+  ASSERT_TRUE(W);
+  EXPECT_TRUE(W->getPayload().isUnowned());
+  auto WH = W->getPayload().getHandle();
+  EXPECT_FLOAT_EQ(WH.raw(0), 0.5);
+  EXPECT_FLOAT_EQ(WH.raw(3), 3.5);
+
+  EE.compile(CompilationMode::Infer);
+  EE.run(bindings);
+  auto result = bindings.get(output)->getHandle();
+  std::vector<float> expected = {1.5, 3.5, 5.5, 7.5};
+  for (size_t i = 0; i < expected.size(); i++) {
+    EXPECT_FLOAT_EQ(result.raw(i), expected[i]);
+  }
+}
+
+/// Test that only the nodes and initializers needed by the requested outputs
+/// are loaded.
+TEST(onnx, importRequestedOutputs) {
+  ExecutionEngine EE{};
+  auto &mod = EE.getModule();
+  Function *F = mod.createFunction("main");
+  std::string netFilename(GLOW_DATA_PATH
+                          "tests/models/onnxModels/twoHeads.onnxtxt");
+
+  Tensor x(ElemKind::FloatTy, {2});
+  {
+    ONNXModelLoader onnxLD(netFilename, {"x"}, {&x.getType()}, *F, nullptr,
+                           {"y1"});
+    EXPECT_EQ(onnxLD.getOutputVarsMapping().size(), 1);
+    EXPECT_TRUE(onnxLD.getOutputVarsMapping().count("y1"));
+  }
+
+  EXPECT_TRUE(mod.getConstantByName("W1"));
+  EXPECT_FALSE(mod.getConstantByName("W2"));
+  for (const auto &node : F->getNodes()) {
+    EXPECT_FALSE(llvm::isa<MulNode>(&node));
+  }
+}
@@ -968,6 +968,76 @@ TEST_P(OperatorTest, ResizeNearest_Int32) {
   testResizeNearest<int32_t>(bindings_, mod_, F_, EE_, ElemKind::Int32QTy);
 }
 
+/// Helper to test ResizeBilinear using \p DTy.
+template <typename DataType>
+static void testResizeBilinear(glow::PlaceholderBindings &bindings,
+                               glow::Module &mod, glow::Function *F,
+                               glow::ExecutionEngine &EE, ElemKind DTy) {
+  auto *input = createPlaceholderConditionallyQuantized(mod, DTy, {1, 2, 2, 2},
+                                                        "input", false);
+  bindings.allocate(input)->getHandle<DataType>() = {2,  -2,  6,  -6,
+                                                     10, -10, 18, -18};
+
+  auto *resizeBilinearUp =
+      F->createResizeBilinear("resizeBilinearUp", input, 2.0f, 2.0f);
+  auto *saveUp = F->createSave("saveUp", resizeBilinearUp);
+  auto *resultUp = bindings.allocate(saveUp->getPlaceholder());
+
+  auto *resizeBilinearDown =
+      F->createResizeBilinear("resizeBilinearDown", input, 0.9f, 0.6f);
+  auto *saveDown = F->createSave("saveDown", resizeBilinearDown);
+  auto *resultDown = bindings.allocate(saveDown->getPlaceholder());
+
+  ::glow::convertPlaceholdersToConstants(
+      F, bindings,
+      {input, saveUp->getPlaceholder(), saveDown->getPlaceholder()});
+
+  EE.compile(CompilationMode::Infer);
+  EE.run(bindings);
+
+  // The output pixels between the input ones are their averages, the last
+  // output row and column repeat the last input ones.
+  auto resultUpH = resultUp->getHandle<DataType>();
+  std::vector<size_t> expectedDimsUp = {1, 4, 4, 2};
+  ASSERT_TRUE(resultUpH.dims().vec() == expectedDimsUp);
+  std::vector<float> expectedUp = {2,  4,  6,  6,  //
+                                   6,  9,  12, 12, //
+                                   10, 14, 18, 18, //
+                                   10, 14, 18, 18};
+  for (size_t h = 0; h < 4; h++) {
+    for (size_t w = 0; w < 4; w++) {
+      EXPECT_NEAR(float(resultUpH.at({0, h, w, 0})), expectedUp[h * 4 + w],
+                  1e-5);
+      EXPECT_NEAR(float(resultUpH.at({0, h, w, 1})), -expectedUp[h * 4 + w],
+                  1e-5);
+    }
+  }
+
+  auto resultDownH = resultDown->getHandle<DataType>();
+  std::vector<size_t> expectedDimsDown = {1, 1, 1, 2};
+  ASSERT_TRUE(resultDownH.dims().vec() == expectedDimsDown);
+  EXPECT_EQ(resultDownH.at({0, 0, 0, 0}), static_cast<DataType>(2));
+  EXPECT_EQ(resultDownH.at({0, 0, 0, 1}), static_cast<DataType>(-2));
+}
+
+/// Verify that the ResizeBilinear operator works correctly for Float.
+TEST_P(OperatorTest, ResizeBilinear_Float) {
+  CHECK_IF_ENABLED();
+  testResizeBilinear<float>(bindings_, mod_, F_, EE_, ElemKind::FloatTy);
+}
+
+/// Verify that the ResizeBilinear operator works correctly for Float16.
+TEST_P(OperatorTest, ResizeBilinear_Float16) {
+  CHECK_IF_ENABLED();
+  testResizeBilinear<float16_t>(bindings_, mod_, F_, EE_, ElemKind::Float16Ty);
+}
+
+/// Verify that the ResizeBilinear operator works correctly for Int8Q.
+TEST_P(OperatorTest, ResizeBilinear_Int8) {
+  CHECK_IF_ENABLED();
+  testResizeBilinear<int8_t>(bindings_, mod_, F_, EE_, ElemKind::Int8QTy);
+}
+
 TEST_P(OperatorTest, pow) {
   CHECK_IF_ENABLED();
 
@@ -1367,6 +1437,84 @@ TEST_P(OperatorTest, ParallelBatchMatMul) {
   EXPECT_NEAR(H.at({1, 2, 0}), -54, 0.001);
 }
 
+/// Test a BatchMatMul of many small batches, which the CPU backend multiplies
+/// in a single kernel whose threads may split a batch.
+TEST_P(OperatorTest, ManySmallBatchMatMul) {
+  CHECK_IF_ENABLED();
+
+  constexpr size_t batches = 200, m = 5, k = 7, n = 3;
+  auto *lhs =
+      mod_.createPlaceholder(ElemKind::FloatTy, {batches, m, k}, "lhs", false);
+  auto *rhs =
+      mod_.createPlaceholder(ElemKind::FloatTy, {batches, k, n}, "rhs", false);
+  bindings_.allocate(lhs)->getHandle().randomize(-1.0, 1.0, mod_.getPRNG());
+  bindings_.allocate(rhs)->getHandle().randomize(-1.0, 1.0, mod_.getPRNG());
+
+  auto *R = F_->createBatchMatMul("BMM", lhs, rhs);
+
+  auto *save = F_->createSave("save", R);
+  auto *result = bindings_.allocate(save->getPlaceholder());
+
+  EE_.compile(CompilationMode::Infer);
+  EE_.run(bindings_);
+
+  auto LH = bindings_.get(lhs)->getHandle();
+  auto RH = bindings_.get(rhs)->getHandle();
+  auto H = result->getHandle();
+  for (size_t b = 0; b < batches; b++) {
+    for (size_t i = 0; i < m; i++) {
+      for (size_t j = 0; j < n; j++) {
+        float expected = 0;
+        for (size_t p = 0; p < k; p++) {
+          expected += LH.at({b, i, p}) * RH.at({b, p, j});
+        }
+        EXPECT_NEAR(H.at({b, i, j}), expected, 0.001);
+      }
+    }
+  }
+}
+
+/// Test a step of an LSTM, whose cell state is updated in place.
+TEST_P(OperatorTest, LSTMUnit) {
+  CHECK_IF_ENABLED();
+
+  constexpr size_t batchSize = 3, hiddenSize = 7;
+  auto *gates = mod_.createPlaceholder(
+      ElemKind::FloatTy, {batchSize, 4 * hiddenSize}, "gates", false);
+  auto *cell = mod_.createPlaceholder(ElemKind::FloatTy,
+                                      {batchSize, hiddenSize}, "cell", false);
+  bindings_.allocate(gates)->getHandle().randomize(-3.0, 3.0, mod_.getPRNG());
+  bindings_.allocate(cell)->getHandle().randomize(-1.0, 1.0, mod_.getPRNG());
+
+  auto *LU = F_->createLSTMUnit("lstm", gates, cell);
+  auto *saveH = F_->createSave("saveHidden", LU->getHidden());
+  F_->createSave("saveCell", LU->getCell(), cell);
+  auto *hidden = bindings_.allocate(saveH->getPlaceholder());
+
+  // The cell is overwritten by the run.
+  Tensor prevCell = bindings_.get(cell)->clone();
+
+  EE_.compile(CompilationMode::Infer);
+  EE_.run(bindings_);
+
+  auto sigmoid = [](float x) { return 1 / (1 + std::exp(-x)); };
+  auto GH = bindings_.get(gates)->getHandle();
+  auto PH = prevCell.getHandle();
+  auto CH = bindings_.get(cell)->getHandle();
+  auto HH = hidden->getHandle();
+  for (size_t b = 0; b < batchSize; b++) {
+    for (size_t j = 0; j < hiddenSize; j++) {
+      float i = sigmoid(GH.at({b, j}));
+      float f = sigmoid(GH.at({b, hiddenSize + j}));
+      float o = sigmoid(GH.at({b, 2 * hiddenSize + j}));
+      float g = std::tanh(GH.at({b, 3 * hiddenSize + j}));
+      float c = f * PH.at({b, j}) + i * g;
+      EXPECT_NEAR(CH.at({b, j}), c, 1e-5);
+      EXPECT_NEAR(HH.at({b, j}), o * std::tanh(c), 1e-5);
+    }
+  }
+}
+
 /// Helper to test BatchedReduceAdd using \p DTy.
 template <typename DataType>
 static void testBatchedReduceAdd(glow::PlaceholderBindings &bindings,
@@ -2543,6 +2691,49 @@ TEST_P(OperatorTest, TopK1) {
   EXPECT_EQ(I.at({2, 0, 0}), 2);
 }
 
+// Check the TopK operator on rows much wider than K, with many equal values.
+TEST_P(OperatorTest, TopKWideRows) {
+  CHECK_IF_ENABLED();
+
+  constexpr size_t rows = 5;
+  constexpr size_t n = 1000;
+  constexpr size_t k = 20;
+  auto *inp =
+      mod_.createPlaceholder(ElemKind::FloatTy, {rows, n}, "input", false);
+  auto IH = bindings_.allocate(inp)->getHandle();
+  for (size_t i = 0; i < rows * n; i++) {
+    IH.raw(i) = (i * 7919) % 97;
+  }
+
+  auto *R = F_->createTopK("TopK", inp, k);
+  auto *values = F_->createSave("save.values", {R, 0});
+  bindings_.allocate(values->getPlaceholder());
+  auto *indices = F_->createSave("save.indices", {R, 1});
+  bindings_.allocate(indices->getPlaceholder());
+
+  EE_.compile(CompilationMode::Infer);
+  EE_.run(bindings_);
+
+  auto V = bindings_.get(values->getPlaceholder())->getHandle();
+  auto I = bindings_.get(indices->getPlaceholder())->getHandle<int64_t>();
+  for (size_t r = 0; r < rows; r++) {
+    // Equal values are ordered by index.
+    std::vector<std::pair<float, size_t>> expected;
+    for (size_t i = 0; i < n; i++) {
+      expected.push_back({IH.at({r, i}), i});
+    }
+    std::stable_sort(expected.begin(), expected.end(),
+                     [](const std::pair<float, size_t> &a,
+                        const std::pair<float, size_t> &b) {
+                       return a.first > b.first;
+                     });
+    for (size_t i = 0; i < k; i++) {
+      EXPECT_FLOAT_EQ(V.at({r, i}), expected[i].first);
+      EXPECT_EQ(I.at({r, i}), expected[i].second);
+    }
+  }
+}
+
 TEST_P(OperatorTest, QuantizedTopK) {
   CHECK_IF_ENABLED();
 
@@ -2975,6 +3166,41 @@ TEST_P(OperatorTest, Transpose3Dims_Int8) {
   testTranspose3Dims<int8_t>(bindings_, mod_, F_, EE_, ElemKind::Int8QTy);
 }
 
+/// Test transposes of a tensor with 6 dimensions, including permutations that
+/// keep the innermost dimension and ones that only move dimensions of size 1.
+TEST_P(OperatorTest, Transpose6Dims) {
+  CHECK_IF_ENABLED();
+
+  constexpr size_t dims[] = {3, 1, 5, 4, 1, 6};
+  const std::vector<std::vector<unsigned_t>> shuffles = {
+      {5, 4, 3, 2, 1, 0}, {0, 2, 3, 5, 1, 4}, {1, 0, 2, 4, 3, 5},
+      {2, 0, 5, 1, 3, 4}, {3, 4, 0, 1, 2, 5}};
+  auto *A = mod_.createPlaceholder(ElemKind::FloatTy, dims, "A", false);
+  bindings_.allocate(A)->getHandle().randomize(-3.0, 3.0, mod_.getPRNG());
+
+  std::vector<SaveNode *> saves;
+  for (auto &shuffle : shuffles) {
+    auto *tr = F_->createTranspose("tr", A, shuffle);
+    saves.push_back(F_->createSave("saveTranspose", tr));
+    bindings_.allocate(saves.back()->getPlaceholder());
+  }
+
+  EE_.compile(CompilationMode::Infer);
+  EE_.run(bindings_);
+
+  auto AH = bindings_.get(A)->getHandle();
+  for (size_t i = 0, e = shuffles.size(); i < e; i++) {
+    auto RH = bindings_.get(saves[i]->getPlaceholder())->getHandle();
+    std::vector<size_t> src(6);
+    for (size_t j = 0, n = RH.size(); j < n; j++) {
+      for (size_t d = 0; d < 6; d++) {
+        src[shuffles[i][d]] = RH.getDimForPtr(d, j);
+      }
+      EXPECT_EQ(RH.raw(j), AH.at(src));
+    }
+  }
+}
+
 /// Test that Transpose optimization into Reshape yields expected results.
 TEST_P(OperatorTest, TransposeIntoReshapeOptim) {
   CHECK_IF_ENABLED();
@@ -3592,6 +3818,44 @@ TEST_P(OperatorTest, IntMatMul) {
   EXPECT_NEAR(H.at({2, 2}), 58.8, 1.0);
 }
 
+/// Test a quantized MatMul whose sizes are not multiples of the blocking
+/// factors of the int8 kernels, against the float MatMul.
+TEST_P(OperatorTest, IntMatMulRaggedEdges) {
+  CHECK_IF_ENABLED();
+
+  TypeRef resTy = mod_.uniqueType(ElemKind::Int8QTy, {5, 7}, 0.08, -3);
+  TypeRef lhsTy = mod_.uniqueType(ElemKind::Int8QTy, {5, 19}, 1.0 / 120, 5);
+  TypeRef rhsTy = mod_.uniqueType(ElemKind::Int8QTy, {19, 7}, 1.0 / 120, -7);
+
+  auto *lhs = mod_.createPlaceholder(ElemKind::FloatTy, {5, 19}, "lhs", false);
+  auto *rhs = mod_.createPlaceholder(ElemKind::FloatTy, {19, 7}, "rhs", false);
+  bindings_.allocate(lhs)->getHandle().randomize(-1.0, 1.0, mod_.getPRNG());
+  bindings_.allocate(rhs)->getHandle().randomize(-1.0, 1.0, mod_.getPRNG());
+
+  auto *lhsq = F_->createQuantize("lhs.q", lhs, lhsTy);
+  auto *rhsq = F_->createQuantize("rhs.q", rhs, rhsTy);
+  auto *matmulq = F_->createMatMul("matmul.q", resTy, lhsq, rhsq);
+  auto *rq = F_->createDequantize("dequant", matmulq);
+  auto *result = F_->createSave("save", rq);
+  bindings_.allocate(result->getPlaceholder());
+
+  EE_.compile(CompilationMode::Infer);
+  EE_.run(bindings_);
+
+  auto LH = bindings_.get(lhs)->getHandle();
+  auto RH = bindings_.get(rhs)->getHandle();
+  auto H = bindings_.get(result->getPlaceholder())->getHandle();
+  for (size_t i = 0; i < 5; i++) {
+    for (size_t j = 0; j < 7; j++) {
+      float expected = 0;
+      for (size_t k = 0; k < 19; k++) {
+        expected += LH.at({i, k}) * RH.at({k, j});
+      }
+      EXPECT_NEAR(H.at({i, j}), expected, 0.2);
+    }
+  }
+}
+
 TEST_P(OperatorTest, IntBatchedArith) {
   CHECK_IF_ENABLED();
 
@@ -3838,6 +4102,143 @@ TEST_P(OperatorTest, FCWithFlatten) {
   }
 }
 
+/// Test an FC with constant weights whose output size is not a multiple of the
+/// panel size in which the CPU backend packs the weights of a MatMul.
+TEST_P(OperatorTest, FCWithConstantWeightsRaggedPanels) {
+  CHECK_IF_ENABLED();
+
+  constexpr size_t m = 11, k = 37, n = 45;
+  auto *input =
+      mod_.createPlaceholder(ElemKind::FloatTy, {m, k}, "input", false);
+  Constant *weights = mod_.createConstant(ElemKind::FloatTy, {k, n}, "weights");
+  Constant *bias = mod_.createConstant(ElemKind::FloatTy, {n}, "bias");
+
+  bindings_.allocate(input)->getHandle().randomize(-1.0, 1.0, mod_.getPRNG());
+  weights->getPayloadMutable().getHandle().randomize(-1.0, 1.0,
+                                                      mod_.getPRNG());
+  bias->getPayloadMutable().getHandle().randomize(-1.0, 1.0, mod_.getPRNG());
+
+  auto *FC = F_->createFullyConnected("fc", input, weights, bias);
+  auto *S = F_->createSave("save", FC);
+  bindings_.allocate(S->getPlaceholder());
+
+  // Keep a copy of the weights, since the backend may replace them.
+  Tensor weightsCopy = weights->getPayload().clone();
+  Tensor biasCopy = bias->getPayload().clone();
+
+  EE_.compile(CompilationMode::Infer);
+  EE_.run(bindings_);
+
+  auto IH = bindings_.get(input)->getHandle();
+  auto WH = weightsCopy.getHandle();
+  auto BH = biasCopy.getHandle();
+  auto result = bindings_.get(S->getPlaceholder())->getHandle();
+  for (size_t i = 0; i < m; i++) {
+    for (size_t j = 0; j < n; j++) {
+      float expected = BH.at({j});
+      for (size_t p = 0; p < k; p++) {
+        expected += IH.at({i, p}) * WH.at({p, j});
+      }
+      EXPECT_NEAR(result.at({i, j}), expected, 1e-4);
+    }
+  }
+}
+
+/// Test DynamicQuantizedFullyConnected against the float FC, with the error
+/// of the quantization of its input and weights.
+TEST_P(OperatorTest, DynamicQuantizedFC) {
+  CHECK_IF_ENABLED();
+
+  constexpr size_t m = 5, k = 37, n = 19;
+  auto *input =
+      mod_.createPlaceholder(ElemKind::FloatTy, {m, k}, "input", false);
+  Constant *weights = mod_.createConstant(ElemKind::FloatTy, {k, n}, "weights");
+  Constant *bias = mod_.createConstant(ElemKind::FloatTy, {n}, "bias");
+
+  bindings_.allocate(input)->getHandle().randomize(-1.0, 1.5, mod_.getPRNG());
+  weights->getPayloadMutable().getHandle().randomize(-1.0, 1.0,
+                                                      mod_.getPRNG());
+  bias->getPayloadMutable().getHandle().randomize(-1.0, 1.0, mod_.getPRNG());
+
+  auto *FC =
+      F_->createDynamicQuantizedFullyConnected("dqfc", input, weights, bias);
+  auto *S = F_->createSave("save", FC);
+  bindings_.allocate(S->getPlaceholder());
+
+  EE_.compile(CompilationMode::Infer);
+  EE_.run(bindings_);
+
+  auto IH = bindings_.get(input)->getHandle();
+  auto WH = weights->getPayload().getHandle();
+  auto BH = bias->getPayload().getHandle();
+  auto result = bindings_.get(S->getPlaceholder())->getHandle();
+  for (size_t i = 0; i < m; i++) {
+    for (size_t j = 0; j < n; j++) {
+      float expected = BH.at({j});
+      for (size_t p = 0; p < k; p++) {
+        expected += IH.at({i, p}) * WH.at({p, j});
+      }
+      EXPECT_NEAR(result.at({i, j}), expected, 0.1);
+    }
+  }
+}
+
+/// Test an FC with constant weights of which most 8x8 blocks are zero, which
+/// the CPU backend multiplies as a block-sparse MatMul.
+TEST_P(OperatorTest, FCWithBlockSparseWeights) {
+  CHECK_IF_ENABLED();
+
+  constexpr size_t m = 5, k = 64, n = 48, bs = 8;
+  auto *input =
+      mod_.createPlaceholder(ElemKind::FloatTy, {m, k}, "input", false);
+  Constant *weights = mod_.createConstant(ElemKind::FloatTy, {k, n}, "weights");
+  Constant *bias = mod_.createConstant(ElemKind::FloatTy, {n}, "bias");
+
+  bindings_.allocate(input)->getHandle().randomize(-1.0, 1.0, mod_.getPRNG());
+  bias->getPayloadMutable().getHandle().randomize(-1.0, 1.0, mod_.getPRNG());
+
+  // Fill one block in eight, and leave the last column of blocks empty.
+  auto WH = weights->getPayloadMutable().getHandle();
+  WH.clear(0);
+  for (size_t p = 0; p < k / bs; p++) {
+    for (size_t j = 0; j + 1 < n / bs; j++) {
+      if ((p * 3 + j) % 8) {
+        continue;
+      }
+      for (size_t x = 0; x < bs; x++) {
+        for (size_t y = 0; y < bs; y++) {
+          WH.at({p * bs + x, j * bs + y}) = mod_.getPRNG().nextRandReal(-1, 1);
+        }
+      }
+    }
+  }
+
+  auto *FC = F_->createFullyConnected("fc", input, weights, bias);
+  auto *S = F_->createSave("save", FC);
+  bindings_.allocate(S->getPlaceholder());
+
+  // Keep a copy of the weights, since the backend may replace them.
+  Tensor weightsCopy = weights->getPayload().clone();
+  Tensor biasCopy = bias->getPayload().clone();
+
+  EE_.compile(CompilationMode::Infer);
+  EE_.run(bindings_);
+
+  auto IH = bindings_.get(input)->getHandle();
+  auto CWH = weightsCopy.getHandle();
+  auto BH = biasCopy.getHandle();
+  auto result = bindings_.get(S->getPlaceholder())->getHandle();
+  for (size_t i = 0; i < m; i++) {
+    for (size_t j = 0; j < n; j++) {
+      float expected = BH.at({j});
+      for (size_t p = 0; p < k; p++) {
+        expected += IH.at({i, p}) * CWH.at({p, j});
+      }
+      EXPECT_NEAR(result.at({i, j}), expected, 1e-4);
+    }
+  }
+}
+
 static FunctionTensorPair
 createAndInitBasicFCTest(glow::PlaceholderBindings &bindings,
                          glow::ExecutionEngine &EE) {
@@ -5321,6 +5722,74 @@ TEST_P(OperatorTest, GroupwiseQuantizedConvolution) {
   EXPECT_FLOAT_EQ(result.at({0, 1, 0, 5}), (13 + 14 + 15 + 16) * 2);
 }
 
+/// Test the functionality of channelwise quantized convolution, whose filter
+/// has its own qparams for every output channel.
+TEST_P(OperatorTest, ChannelwiseQuantizedConvolution) {
+  CHECK_IF_ENABLED();
+
+  constexpr size_t groups = 2;
+  constexpr size_t outChannels = 4;
+
+  auto *input =
+      mod_.createPlaceholder(ElemKind::FloatTy, {1, 2, 1, 8}, "input", false);
+  auto IH = bindings_.allocate(input)->getHandle<float>();
+  for (size_t i = 0; i < 2 * 8; i++) {
+    IH.raw(i) = i + 1;
+  }
+
+  auto *qInTy = mod_.uniqueType(ElemKind::Int8QTy, {1, 2, 1, 8}, 1.0, 0);
+  auto *qInput = F_->createQuantize("qInput", input, qInTy);
+
+  auto filterT = Tensor(ElemKind::Int8QTy, {outChannels, 1, 1, 4}, 1.0, 0);
+  filterT.getHandle<int8_t>().clear(2);
+  auto *filter = mod_.createConstant("filter", std::move(filterT));
+
+  auto biasT = Tensor(ElemKind::FloatTy, {outChannels});
+  biasT.getHandle<float>() = {1, 2, 3, 4};
+  auto *bias = mod_.createConstant("bias", std::move(biasT));
+
+  // The dequantized filters of the channels are 2, 1, 0.5 and 1.
+  auto scalesT = Tensor(ElemKind::FloatTy, {outChannels});
+  scalesT.getHandle<float>() = {1, 0.5, 0.25, 1};
+  auto *scales = mod_.createConstant("scales", std::move(scalesT));
+
+  auto offsetsT = Tensor(ElemKind::Int32ITy, {outChannels});
+  offsetsT.getHandle<int32_t>() = {0, 0, 0, 1};
+  auto *offsets = mod_.createConstant("offsets", std::move(offsetsT));
+
+  auto *outTy =
+      mod_.uniqueType(ElemKind::Int8QTy, {1, 2, 1, outChannels}, 1.0, 0);
+
+  ChannelwiseQuantizedConvolutionNode *CQC = F_->createChannelwiseQuantizedConv(
+      "channelwiseQuantizedConv", qInput, filter, bias, scales, offsets, outTy,
+      {1, 1}, {1, 1}, {0, 0, 0, 0}, groups, /* groupwise */ false);
+
+  DequantizeNode *dq = F_->createDequantize("dequantize", CQC);
+  SaveNode *S = F_->createSave("save", dq);
+  bindings_.allocate(S->getPlaceholder());
+
+  ::glow::convertPlaceholdersToConstants(F_, bindings_,
+                                         {input, S->getPlaceholder()});
+
+  EE_.compile(CompilationMode::Infer);
+  EE_.run(bindings_);
+
+  auto result = bindings_.get(S->getPlaceholder())->getHandle();
+
+  std::vector<size_t> expectedDims = {1, 2, 1, outChannels};
+  ASSERT_TRUE(result.dims().vec() == expectedDims);
+
+  EXPECT_FLOAT_EQ(result.at({0, 0, 0, 0}), (1 + 2 + 3 + 4) * 2 + 1);
+  EXPECT_FLOAT_EQ(result.at({0, 0, 0, 1}), (1 + 2 + 3 + 4) * 1 + 2);
+  EXPECT_FLOAT_EQ(result.at({0, 0, 0, 2}), (5 + 6 + 7 + 8) * 0.5 + 3);
+  EXPECT_FLOAT_EQ(result.at({0, 0, 0, 3}), (5 + 6 + 7 + 8) * 1 + 4);
+
+  EXPECT_FLOAT_EQ(result.at({0, 1, 0, 0}), (9 + 10 + 11 + 12) * 2 + 1);
+  EXPECT_FLOAT_EQ(result.at({0, 1, 0, 1}), (9 + 10 + 11 + 12) * 1 + 2);
+  EXPECT_FLOAT_EQ(result.at({0, 1, 0, 2}), (13 + 14 + 15 + 16) * 0.5 + 3);
+  EXPECT_FLOAT_EQ(result.at({0, 1, 0, 3}), (13 + 14 + 15 + 16) * 1 + 4);
+}
+
 TEST_P(OperatorTest, DilatedConvolution) {
   CHECK_IF_ENABLED();
 
@@ -6886,6 +7355,145 @@ TEST_P(OperatorTest, SparseLengthsSum_Float16) {
   testSLS<float16_t>(bindings_, mod_, F_, EE_, ElemKind::Float16Ty, 0.002);
 }
 
+/// Test SLS with ragged indices, of which only the valid prefix is
+/// transferred. The rest are out of range, and must not be read.
+TEST_P(OperatorTest, SparseLengthsSumRaggedIndices) {
+  CHECK_IF_ENABLED();
+
+  auto *data = mod_.createPlaceholder(ElemKind::FloatTy, {3, 2}, "data", false);
+  auto *indices =
+      mod_.createPlaceholder(ElemKind::Int64ITy, {12}, "indices", false);
+  auto *lengths =
+      mod_.createPlaceholder(ElemKind::Int32ITy, {5}, "lengths", false);
+  indices->setRagged();
+
+  bindings_.allocate(data)->getHandle() = {
+      1.0f, 1.2f, 2.3f, 3.4f, 4.5f, 5.7f,
+  };
+  bindings_.allocate(indices)->getHandle<int64_t>() = {
+      2, 0, 1, 2, 0, 0, 0, 0, 100, 100, 100, 100,
+  };
+  bindings_.setNumValidElements(indices, 8);
+  bindings_.allocate(lengths)->getHandle<int32_t>() = {
+      2, 0, 2, 1, 3,
+  };
+
+  auto *R = F_->createSparseLengthsSum("SLS", data, indices, lengths);
+  auto *S = F_->createSave("save", R);
+  bindings_.allocate(S->getPlaceholder());
+  EXPECT_TRUE(allowsPartialInput(indices, F_));
+
+  EE_.compile(CompilationMode::Infer);
+  EE_.run(bindings_);
+
+  Tensor &result = *bindings_.get(S->getPlaceholder());
+  Tensor expected(ElemKind::FloatTy, {5, 2});
+  expected.getHandle() = {
+      5.5f, 6.9f, 0.0f, 0.0f, 6.8f, 9.1f, 1.0f, 1.2f, 3.0f, 3.6f,
+  };
+  EXPECT_TRUE(expected.isEqual(result, 0.0001));
+}
+
+/// Helper to test SparseLengthsMean, or SparseLengthsMax if \p isMax, using
+/// \p DTy.
+template <typename DataType>
+static void testSLSPooling(glow::PlaceholderBindings &bindings,
+                           glow::Module &mod, glow::Function *F,
+                           glow::ExecutionEngine &EE, ElemKind DTy,
+                           float allowedError, bool isMax) {
+  /*
+    DATA  = [
+        [1.0, -1.2],
+        [2.3, -3.4],
+        [-4.5, 5.7],
+    ]
+    INDICES = [2, 0, 1, 2, 0, 0, 0, 0]
+    LENGTHS = [2, 0, 2, 1, 3]
+    MEAN = [
+        [-1.75, 2.25],
+        [0.0, 0.0],
+        [-1.1, 1.15],
+        [1.0, -1.2],
+        [1.0, -1.2],
+    ]
+    MAX = [
+        [1.0, 5.7],
+        [0.0, 0.0],
+        [2.3, 5.7],
+        [1.0, -1.2],
+        [1.0, -1.2],
+    ]
+  */
+  auto *data = mod.createPlaceholder(DTy, {3, 2}, "data", false);
+  auto *indices =
+      mod.createPlaceholder(ElemKind::Int64ITy, {8}, "indices", false);
+  auto *lengths =
+      mod.createPlaceholder(ElemKind::Int32ITy, {5}, "lengths", false);
+
+  bindings.allocate(data)->getHandle<DataType>() = {
+      1.0f, -1.2f, 2.3f, -3.4f, -4.5f, 5.7f,
+  };
+  bindings.allocate(indices)->getHandle<int64_t>() = {
+      2, 0, 1, 2, 0, 0, 0, 0,
+  };
+  bindings.allocate(lengths)->getHandle<int32_t>() = {
+      2, 0, 2, 1, 3,
+  };
+
+  Node *R = isMax ? (Node *)F->createSparseLengthsMax("SLMax", data, indices,
+                                                      lengths)
+                  : (Node *)F->createSparseLengthsMean("SLMean", data,
+                                                       indices, lengths);
+
+  auto *S = F->createSave("save", R);
+  bindings.allocate(S->getPlaceholder());
+
+  EE.compile(CompilationMode::Infer);
+  EE.run(bindings);
+
+  Tensor &result = *bindings.get(S->getPlaceholder());
+  Tensor expected(DTy, {5, 2});
+  if (isMax) {
+    expected.getHandle<DataType>() = {
+        1.0f, 5.7f, 0.0f, 0.0f, 2.3f, 5.7f, 1.0f, -1.2f, 1.0f, -1.2f,
+    };
+  } else {
+    expected.getHandle<DataType>() = {
+        -1.75f, 2.25f, 0.0f, 0.0f, -1.1f, 1.15f, 1.0f, -1.2f, 1.0f, -1.2f,
+    };
+  }
+
+  EXPECT_TRUE(expected.isEqual(result, allowedError));
+}
+
+/// Test that SparseLengthsMean is correctly supported in FloatTy.
+TEST_P(OperatorTest, SparseLengthsMean_Float) {
+  CHECK_IF_ENABLED();
+  testSLSPooling<float>(bindings_, mod_, F_, EE_, ElemKind::FloatTy, 0.0001,
+                        /* isMax */ false);
+}
+
+/// Test that SparseLengthsMean is correctly supported in Float16Ty.
+TEST_P(OperatorTest, SparseLengthsMean_Float16) {
+  CHECK_IF_ENABLED();
+  testSLSPooling<float16_t>(bindings_, mod_, F_, EE_, ElemKind::Float16Ty,
+                            0.002, /* isMax */ false);
+}
+
+/// Test that SparseLengthsMax is correctly supported in FloatTy.
+TEST_P(OperatorTest, SparseLengthsMax_Float) {
+  CHECK_IF_ENABLED();
+  testSLSPooling<float>(bindings_, mod_, F_, EE_, ElemKind::FloatTy, 0.0001,
+                        /* isMax */ true);
+}
+
+/// Test that SparseLengthsMax is correctly supported in Float16Ty.
+TEST_P(OperatorTest, SparseLengthsMax_Float16) {
+  CHECK_IF_ENABLED();
+  testSLSPooling<float16_t>(bindings_, mod_, F_, EE_, ElemKind::Float16Ty,
+                            0.002, /* isMax */ true);
+}
+
 TEST_P(OperatorTest, SparseLengthsSumI8) {
   CHECK_IF_ENABLED();
 
@@ -7540,6 +8148,140 @@ TEST_P(
   EXPECT_TRUE(expected1.isEqual(result1, 0.02));
 }
 
+/// Test Fused-RWQ-SLWS with float16 scales and offsets and a float result.
+/// Rows are long enough to cover both the vectorized and the scalar parts of
+/// the kernels.
+TEST_P(OperatorTest,
+       FusedRowwiseQuantizedSparseLengthsWeightedSum_Float_FP16ScaleOffset) {
+  CHECK_IF_ENABLED();
+  constexpr size_t numRows = 10;
+  constexpr size_t rowSize = 37;
+  constexpr size_t numIndices = 12;
+  Tensor data(ElemKind::FloatTy, {numRows, rowSize});
+  data.getHandle().randomize(-1.0, 1.0, mod_.getPRNG());
+  Constant *rwqData = mod_.createConstant(
+      ElemKind::UInt8FusedFP16QTy,
+      {numRows, rowSize + 2 * sizeof(float16_t)}, 0.0, 0, "data");
+  quantization::tensorFusedRowwiseQuantization<float16_t>(
+      data, rwqData->getPayloadMutable());
+
+  Constant *weights =
+      mod_.createConstant(ElemKind::FloatTy, {numIndices}, "weights");
+  weights->getPayloadMutable().getHandle().randomize(-1.0, 1.0,
+                                                     mod_.getPRNG());
+
+  Placeholder *indices =
+      mod_.createPlaceholder(ElemKind::Int64ITy, {numIndices}, "indices",
+                             /* isTrainable */ false);
+  Placeholder *lengths =
+      mod_.createPlaceholder(ElemKind::Int32ITy, {4}, "lengths",
+                             /* isTrainable */ false);
+  bindings_.allocate(indices)->getHandle<int64_t>() = {
+      1, 0, 9, 3, 3, 5, 7, 2, 8, 4, 6, 0,
+  };
+  bindings_.allocate(lengths)->getHandle<int32_t>() = {
+      3,
+      0,
+      5,
+      4,
+  };
+
+  auto *R = F_->createFusedRowwiseQuantizedSparseLengthsWeightedSum(
+      "RQSLWS", rwqData, weights, indices, lengths, ElemKind::FloatTy);
+  SaveNode *S = F_->createSave("save", R);
+  bindings_.allocate(S->getPlaceholder());
+
+  EE_.compile(CompilationMode::Infer);
+  EE_.run(bindings_);
+
+  auto DH = data.getHandle();
+  auto WH = weights->getPayload().getHandle();
+  auto IH = bindings_.get(indices)->getHandle<int64_t>();
+  auto LH = bindings_.get(lengths)->getHandle<int32_t>();
+  Tensor expected(ElemKind::FloatTy, {4, rowSize});
+  auto EH = expected.getHandle();
+  EH.clear(0);
+  for (size_t i = 0, curIndex = 0; i < 4; i++) {
+    for (int32_t j = 0; j < LH.raw(i); j++, curIndex++) {
+      size_t row = IH.raw(curIndex);
+      for (size_t k = 0; k < rowSize; k++) {
+        EH.at({i, k}) += WH.raw(curIndex) * DH.at({row, k});
+      }
+    }
+  }
+
+  EXPECT_TRUE(expected.isEqual(*bindings_.get(S->getPlaceholder()), 0.05));
+}
+
+/// Test FusedRowwiseQuantizedSparseLengthsWeightedSum with 4-bit data, two
+/// values packed in every byte, and float16 scale and offset. The expected
+/// result is computed from the dequantized table, so only the accumulation
+/// differs. Rows are long enough to cover both the vectorized and the scalar
+/// parts of the kernels.
+TEST_P(OperatorTest, FusedRowwiseQuantizedSparseLengthsWeightedSum_Float_4Bit) {
+  CHECK_IF_ENABLED();
+  constexpr size_t numRows = 10;
+  constexpr size_t rowSize = 38;
+  constexpr size_t numIndices = 12;
+  Tensor data(ElemKind::FloatTy, {numRows, rowSize});
+  data.getHandle().randomize(-1.0, 1.0, mod_.getPRNG());
+  Constant *rwqData = mod_.createConstant(
+      ElemKind::UInt4FusedFP16QTy,
+      {numRows, rowSize / 2 + 2 * sizeof(float16_t)}, 0.0, 0, "data");
+  quantization::tensorFusedRowwiseQuantization<float16_t>(
+      data, rwqData->getPayloadMutable());
+  Tensor dequantized = quantization::tensor4BitsFusedRowwiseDequantization(
+      rwqData->getPayload());
+
+  Constant *weights =
+      mod_.createConstant(ElemKind::FloatTy, {numIndices}, "weights");
+  weights->getPayloadMutable().getHandle().randomize(-1.0, 1.0,
+                                                     mod_.getPRNG());
+
+  Placeholder *indices =
+      mod_.createPlaceholder(ElemKind::Int64ITy, {numIndices}, "indices",
+                             /* isTrainable */ false);
+  Placeholder *lengths =
+      mod_.createPlaceholder(ElemKind::Int32ITy, {4}, "lengths",
+                             /* isTrainable */ false);
+  bindings_.allocate(indices)->getHandle<int64_t>() = {
+      1, 0, 9, 3, 3, 5, 7, 2, 8, 4, 6, 0,
+  };
+  bindings_.allocate(lengths)->getHandle<int32_t>() = {
+      3,
+      0,
+      5,
+      4,
+  };
+
+  auto *R = F_->createFusedRowwiseQuantizedSparseLengthsWeightedSum(
+      "RQSLWS", rwqData, weights, indices, lengths, ElemKind::FloatTy);
+  EXPECT_EQ(R->getResult().dims()[1], rowSize);
+  SaveNode *S = F_->createSave("save", R);
+  bindings_.allocate(S->getPlaceholder());
+
+  EE_.compile(CompilationMode::Infer);
+  EE_.run(bindings_);
+
+  auto DH = dequantized.getHandle();
+  auto WH = weights->getPayload().getHandle();
+  auto IH = bindings_.get(indices)->getHandle<int64_t>();
+  auto LH = bindings_.get(lengths)->getHandle<int32_t>();
+  Tensor expected(ElemKind::FloatTy, {4, rowSize});
+  auto EH = expected.getHandle();
+  EH.clear(0);
+  for (size_t i = 0, curIndex = 0; i < 4; i++) {
+    for (int32_t j = 0; j < LH.raw(i); j++, curIndex++) {
+      size_t row = IH.raw(curIndex);
+      for (size_t k = 0; k < rowSize; k++) {
+        EH.at({i, k}) += WH.raw(curIndex) * DH.at({row, k});
+      }
+    }
+  }
+
+  EXPECT_TRUE(expected.isEqual(*bindings_.get(S->getPlaceholder()), 0.01));
+}
+
 /// Helper to test FusedRowwiseQuantizedSparseLengthsSum using \p DTy.
 template <typename DataType>
 static void testFusedRowwiseQuantizedSparseLengthsSum(
@@ -7620,6 +8362,105 @@ TEST_P(OperatorTest,
       /* useFP16Accumulation */ true);
 }
 
+/// Helper to test FusedRowwiseQuantizedSparseLengthsMean, or
+/// FusedRowwiseQuantizedSparseLengthsMax if \p isMax, using \p DTy.
+template <typename DataType>
+static void testFusedRowwiseQuantizedSparseLengthsPooling(
+    glow::PlaceholderBindings &bindings, glow::Module &mod, glow::Function *F,
+    glow::ExecutionEngine &EE, ElemKind DTy, float allowedError, bool isMax) {
+  /*
+    DATA  = [
+        [1.0, -1.2],
+        [2.3, -3.4],
+        [-4.5, 5.7],
+    ]
+    INDICES = [2, 0, 1, 2, 0, 0, 0, 0]
+    LENGTHS = [2, 0, 2, 1, 3]
+    MEAN = [
+        [-1.75, 2.25],
+        [0.0, 0.0],
+        [-1.1, 1.15],
+        [1.0, -1.2],
+        [1.0, -1.2],
+    ]
+    MAX = [
+        [1.0, 5.7],
+        [0.0, 0.0],
+        [2.3, 5.7],
+        [1.0, -1.2],
+        [1.0, -1.2],
+    ]
+  */
+  Tensor data(ElemKind::FloatTy, {3, 2});
+  data.getHandle() = {
+      1.0f, -1.2f, 2.3f, -3.4f, -4.5f, 5.7f,
+  };
+
+  Placeholder *indices = mod.createPlaceholder(
+      ElemKind::Int64ITy, {8}, "indices", /* isTrainable */ false);
+  Placeholder *lengths = mod.createPlaceholder(
+      ElemKind::Int32ITy, {5}, "lengths", /* isTrainable */ false);
+
+  bindings.allocate(indices)->getHandle<int64_t>() = {
+      2, 0, 1, 2, 0, 0, 0, 0,
+  };
+  bindings.allocate(lengths)->getHandle<int32_t>() = {
+      2, 0, 2, 1, 3,
+  };
+
+  Node *R = isMax ? (Node *)F->createFusedRowwiseQuantizedSparseLengthsMax(
+                        "RQSLMax", data, indices, lengths, DTy)
+                  : (Node *)F->createFusedRowwiseQuantizedSparseLengthsMean(
+                        "RQSLMean", data, indices, lengths, DTy);
+  SaveNode *S = F->createSave("save", R);
+  bindings.allocate(S->getPlaceholder());
+
+  EE.compile(CompilationMode::Infer);
+  EE.run(bindings);
+
+  Tensor &result = *bindings.get(S->getPlaceholder());
+  Tensor expected(DTy, {5, 2});
+  if (isMax) {
+    expected.getHandle<DataType>() = {
+        1.0f, 5.7f, 0.0f, 0.0f, 2.3f, 5.7f, 1.0f, -1.2f, 1.0f, -1.2f,
+    };
+  } else {
+    expected.getHandle<DataType>() = {
+        -1.75f, 2.25f, 0.0f, 0.0f, -1.1f, 1.15f, 1.0f, -1.2f, 1.0f, -1.2f,
+    };
+  }
+
+  EXPECT_TRUE(expected.isEqual(result, allowedError));
+}
+
+/// Test Fused-RWQ-SLMean in Float.
+TEST_P(OperatorTest, FusedRowwiseQuantizedSparseLengthsMean_Float) {
+  CHECK_IF_ENABLED();
+  testFusedRowwiseQuantizedSparseLengthsPooling<float>(
+      bindings_, mod_, F_, EE_, ElemKind::FloatTy, 0.03, /* isMax */ false);
+}
+
+/// Test Fused-RWQ-SLMean in Float16.
+TEST_P(OperatorTest, FusedRowwiseQuantizedSparseLengthsMean_Float16) {
+  CHECK_IF_ENABLED();
+  testFusedRowwiseQuantizedSparseLengthsPooling<float16_t>(
+      bindings_, mod_, F_, EE_, ElemKind::Float16Ty, 0.03, /* isMax */ false);
+}
+
+/// Test Fused-RWQ-SLMax in Float.
+TEST_P(OperatorTest, FusedRowwiseQuantizedSparseLengthsMax_Float) {
+  CHECK_IF_ENABLED();
+  testFusedRowwiseQuantizedSparseLengthsPooling<float>(
+      bindings_, mod_, F_, EE_, ElemKind::FloatTy, 0.03, /* isMax */ true);
+}
+
+/// Test Fused-RWQ-SLMax in Float16.
+TEST_P(OperatorTest, FusedRowwiseQuantizedSparseLengthsMax_Float16) {
+  CHECK_IF_ENABLED();
+  testFusedRowwiseQuantizedSparseLengthsPooling<float16_t>(
+      bindings_, mod_, F_, EE_, ElemKind::Float16Ty, 0.03, /* isMax */ true);
+}
+
 /// Test SLS when some input tensors are constants.
 TEST_P(OperatorTest, ConstantSLS) {
   CHECK_IF_ENABLED();
@@ -8536,6 +9377,32 @@ TEST_P(OperatorTest, Bucketize) {
   EXPECT_TRUE(expected2.isEqual(*result2));
 }
 
+/// Check the bucketize operator with more boundaries than the CPU backend
+/// compares every value to, unsorted, and with values equal to boundaries.
+TEST_P(OperatorTest, BucketizeManyBoundaries) {
+  CHECK_IF_ENABLED();
+
+  std::vector<float> boundaries;
+  for (int i = 39; i >= 0; i--) {
+    boundaries.push_back(0.5f * i);
+  }
+  std::swap(boundaries[3], boundaries[30]);
+  auto *input = mod_.createPlaceholder(ElemKind::FloatTy, {6}, "input", false);
+  bindings_.allocate(input)->getHandle<float>() = {-1.0, 0.0,  0.25,
+                                                   7.5,  19.5, 30.0};
+  auto *bucketize = F_->createBucketizeNode("bucketize", input, boundaries);
+  auto *save = F_->createSave("save", bucketize);
+  bindings_.allocate(save->getPlaceholder());
+
+  EE_.compile(CompilationMode::Infer);
+  EE_.run(bindings_);
+
+  // The result is the number of boundaries lower than or equal to the value.
+  Tensor expected(ElemKind::Int32ITy, {6});
+  expected.getHandle<int32_t>() = {0, 1, 1, 16, 40, 40};
+  EXPECT_TRUE(expected.isEqual(*bindings_.get(save->getPlaceholder())));
+}
+
 /// Check the correctness of the SoftMax operator.
 /// The semantic of SoftMax is
 /// res_i = exp(input_i) / (exp(input_0) + ... + exp(input_N)).
@@ -9148,6 +10015,139 @@ TEST_P(OperatorTest, BatchBoxCox_Float16) {
                              0.01f);
 }
 
+/// Helper to test LayerNormalization using \p DTy.
+template <typename DataType>
+static void testLayerNormalization(glow::PlaceholderBindings &bindings,
+                                   glow::Module &mod, glow::Function *F,
+                                   glow::ExecutionEngine &EE, ElemKind DTy,
+                                   float allowedError) {
+  // The two trailing dimensions of the input are normalized.
+  const size_t kRows = 3;
+  const size_t kHeight = 4;
+  const size_t kWidth = 6;
+  const size_t kCols = kHeight * kWidth;
+  auto *data = mod.createPlaceholder(DTy, {kRows, kHeight, kWidth}, "data",
+                                     /* isTrainable */ false);
+  auto *scale = mod.createPlaceholder(DTy, {kHeight, kWidth}, "scale",
+                                      /* isTrainable */ false);
+  auto *bias = mod.createPlaceholder(DTy, {kHeight, kWidth}, "bias",
+                                     /* isTrainable */ false);
+  auto dataH = bindings.allocate(data)->getHandle<DataType>();
+  auto scaleH = bindings.allocate(scale)->getHandle<DataType>();
+  auto biasH = bindings.allocate(bias)->getHandle<DataType>();
+  dataH.randomize(-5.0, 5.0, mod.getPRNG());
+  scaleH.randomize(0.5, 2.0, mod.getPRNG());
+  biasH.randomize(-1.0, 1.0, mod.getPRNG());
+
+  const float epsilon = 1e-5f;
+  auto *LN = F->createLayerNormalization("ln", data, scale, bias, epsilon);
+  auto *save = F->createSave("save", LN);
+  auto resultH =
+      bindings.allocate(save->getPlaceholder())->getHandle<DataType>();
+
+  EE.compile(CompilationMode::Infer);
+  EE.run(bindings);
+
+  // Compute expected output here on the host to compare results.
+  for (size_t i = 0; i < kRows; ++i) {
+    double mean = 0;
+    for (size_t j = 0; j < kCols; ++j) {
+      mean += float(dataH.raw(i * kCols + j));
+    }
+    mean /= kCols;
+    double var = 0;
+    for (size_t j = 0; j < kCols; ++j) {
+      double diff = float(dataH.raw(i * kCols + j)) - mean;
+      var += diff * diff;
+    }
+    var /= kCols;
+    for (size_t j = 0; j < kCols; ++j) {
+      double expected = (float(dataH.raw(i * kCols + j)) - mean) /
+                            std::sqrt(var + epsilon) * float(scaleH.raw(j)) +
+                        float(biasH.raw(j));
+      EXPECT_NEAR(float(resultH.raw(i * kCols + j)), expected, allowedError);
+    }
+  }
+}
+
+/// Test that the LayerNormalization operator works as expected in FloatTy.
+TEST_P(OperatorTest, LayerNormalization_Float) {
+  CHECK_IF_ENABLED();
+  testLayerNormalization<float>(bindings_, mod_, F_, EE_, ElemKind::FloatTy,
+                                0.0001f);
+}
+
+/// Test that the LayerNormalization operator works as expected in Float16Ty.
+TEST_P(OperatorTest, LayerNormalization_Float16) {
+  CHECK_IF_ENABLED();
+  testLayerNormalization<float16_t>(bindings_, mod_, F_, EE_,
+                                    ElemKind::Float16Ty, 0.02f);
+}
+
+/// Helper to test BatchedPairwiseDotProduct using \p DTy.
+template <typename DataType>
+static void testBatchedPairwiseDotProduct(glow::PlaceholderBindings &bindings,
+                                          glow::Module &mod, glow::Function *F,
+                                          glow::ExecutionEngine &EE,
+                                          ElemKind DTy, float allowedError) {
+  const size_t kBatchSize = 3;
+  const size_t kVectorSize = 7;
+  const size_t kNumInputs = 5;
+  const size_t kNumPairs = kNumInputs * (kNumInputs - 1) / 2;
+  std::vector<NodeValue> inputs;
+  std::vector<Handle<DataType>> inputsH;
+  for (size_t i = 0; i < kNumInputs; i++) {
+    auto *input = mod.createPlaceholder(DTy, {kBatchSize, kVectorSize},
+                                        "input" + std::to_string(i),
+                                        /* isTrainable */ false);
+    inputsH.push_back(bindings.allocate(input)->getHandle<DataType>());
+    inputsH.back().randomize(-1.0, 1.0, mod.getPRNG());
+    inputs.push_back(input);
+  }
+
+  auto *BPDP = F->createBatchedPairwiseDotProduct("pairs", inputs);
+  auto *save = F->createSave("save", BPDP);
+  auto resultH =
+      bindings.allocate(save->getPlaceholder())->getHandle<DataType>();
+
+  EE.compile(CompilationMode::Infer);
+  EE.run(bindings);
+
+  // The products of input i with the inputs j < i follow those of input
+  // i - 1 in every batch.
+  ASSERT_EQ(resultH.dims().vec(),
+            std::vector<size_t>({kBatchSize, kNumPairs}));
+  for (size_t b = 0; b < kBatchSize; b++) {
+    size_t k = 0;
+    for (size_t i = 1; i < kNumInputs; i++) {
+      for (size_t j = 0; j < i; j++) {
+        float expected = 0;
+        for (size_t d = 0; d < kVectorSize; d++) {
+          expected += float(inputsH[i].at({b, d})) *
+                      float(inputsH[j].at({b, d}));
+        }
+        EXPECT_NEAR(float(resultH.at({b, k++})), expected, allowedError);
+      }
+    }
+  }
+}
+
+/// Test that the BatchedPairwiseDotProduct operator works as expected in
+/// FloatTy.
+TEST_P(OperatorTest, BatchedPairwiseDotProduct_Float) {
+  CHECK_IF_ENABLED();
+  testBatchedPairwiseDotProduct<float>(bindings_, mod_, F_, EE_,
+                                       ElemKind::FloatTy, 0.0001f);
+}
+
+/// Test that the BatchedPairwiseDotProduct operator works as expected in
+/// Float16Ty.
+TEST_P(OperatorTest, BatchedPairwiseDotProduct_Float16) {
+  CHECK_IF_ENABLED();
+  testBatchedPairwiseDotProduct<float16_t>(bindings_, mod_, F_, EE_,
+                                           ElemKind::Float16Ty, 0.02f);
+}
+
 /// Test that Arithmetic ops work.
 #define TEST_ARITH_OP_FLOAT(OP_NAME_, OP_)                                     \
   TEST_P(OperatorTest, OP_NAME_##ArithFloatTest) {                             \
@@ -14,13 +14,20 @@
  * limitations under the License.
  */
 #include "glow/Partitioner/Partitioner.h"
+#include "glow/Partitioner/PartitionPlan.h"
+#include "glow/ExecutionContext/TraceEvents.h"
 #include "glow/ExecutionEngine/ExecutionEngine.h"
 #include "glow/Graph/Graph.h"
 #include "glow/Optimizer/GraphOptimizer/GraphOptimizer.h"
 #include "glow/Partitioner/PartitionerUtils.h"
+#include "glow/Partitioner/PlacementPlanner.h"
 
 #include "gtest/gtest.h"
 
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+
 using namespace glow;
 
 class PartitionerTest : public ::testing::Test {
@@ -1001,6 +1008,124 @@ TEST_F(PartitionerTest, partitionFromConfigDirectCall) {
   heterogeneousPartitionValidation(dagList.get(), mod_);
 }
 
+/// Check that the predicates of a user-defined config are set on the DAG
+/// nodes of their partitions, and that their number is validated.
+TEST_F(PartitionerTest, partitionFromConfigPredicates) {
+  createSimpleModule(mod_);
+  std::vector<DeviceInfo> devices = {
+      {3072, "Interpreter"}, {3072, "Interpreter"}, {3072, "CPU"}};
+  PartitionConfig partitionConfig;
+  partitionConfig.funcName = "test";
+  partitionConfig.numOfPartitions = 3;
+  partitionConfig.backendNames = {"Interpreter", "CPU", "Interpreter"};
+  partitionConfig.partitionNames = {"p1", "p2", "p3"};
+  partitionConfig.nodeToPartition = {{"sub", 0}, {"mul", 1}};
+  partitionConfig.partitionPredicates = {"", "input3", ""};
+  Partitioner partitioner(&mod_, devices);
+  auto dagList = partitioner.partitionFromConfig(partitionConfig);
+  ASSERT_TRUE((bool)dagList);
+  for (const auto &node : (*dagList)[0].nodes) {
+    EXPECT_EQ(node->predicate, node->name == "p2" ? "input3" : "");
+  }
+
+  createSimpleModule(mod_);
+  partitionConfig.partitionPredicates = {"input3"};
+  Partitioner badPartitioner(&mod_, devices);
+  auto badDagList = badPartitioner.partitionFromConfig(partitionConfig);
+  EXPECT_TRUE(ERR_TO_BOOL(badDagList.takeError()));
+}
+
+/// Check that partitioning moves the nodes of the function into the
+/// partitions instead of copying them.
+TEST_F(PartitionerTest, partitionMovesNodes) {
+  createSimpleModule(mod_);
+  std::vector<DeviceInfo> devices = {
+      {3072, "Interpreter"}, {3072, "Interpreter"}, {3072, "CPU"}};
+  PartitionConfig partitionConfig;
+  partitionConfig.funcName = "test";
+  partitionConfig.numOfPartitions = 3;
+  partitionConfig.backendNames = {"Interpreter", "CPU", "Interpreter"};
+  partitionConfig.partitionNames = {"p1", "p2", "p3"};
+  partitionConfig.nodeToPartition = {{"sub", 0}, {"mul", 1}};
+
+  std::unordered_set<const Node *> origNodes;
+  for (const auto &N : mod_.getFunction("test")->getNodes()) {
+    origNodes.insert(&N);
+  }
+
+  // Don't optimize the partitions, which could replace their nodes.
+  Partitioner partitioner(&mod_, devices, /* saturateHost */ false,
+                          /* optimized */ true);
+  auto dagList = partitioner.partitionFromConfig(partitionConfig);
+  ASSERT_TRUE((bool)dagList);
+  // Every node is in a partition. The only new nodes save the results which
+  // cross partitions.
+  size_t numMoved = 0;
+  for (const auto *F : mod_.getFunctions()) {
+    for (const auto &N : F->getNodes()) {
+      if (origNodes.count(&N)) {
+        numMoved++;
+      } else {
+        EXPECT_TRUE(llvm::isa<SaveNode>(&N));
+      }
+    }
+  }
+  EXPECT_EQ(numMoved, origNodes.size());
+}
+
+/// Check that the results crossing the partitions stay in Float16Ty when they
+/// are converted to FloatTy at the boundary.
+TEST_F(PartitionerTest, float16BoundaryConversions) {
+  auto *F = mod_.createFunction("test");
+  auto *input =
+      mod_.createPlaceholder(ElemKind::FloatTy, {2, 32}, "input", false);
+  auto *in1 = F->createConvertTo("in1", input, ElemKind::Float16Ty);
+  auto *tanh1 = F->createTanh("tanh1", in1);
+  auto *out1 = F->createConvertTo("out1", tanh1, ElemKind::FloatTy);
+  auto *in2 = F->createConvertTo("in2", out1, ElemKind::Float16Ty);
+  auto *tanh2 = F->createTanh("tanh2", in2);
+  auto *out2 = F->createConvertTo("out2", tanh2, ElemKind::FloatTy);
+  auto *relu = F->createRELU("relu", out1);
+  F->createSave("ret1", out2);
+  F->createSave("ret2", relu);
+
+  std::vector<DeviceInfo> devices = {{3072, "Interpreter"},
+                                     {3072, "Interpreter"}};
+  PartitionConfig partitionConfig;
+  partitionConfig.funcName = "test";
+  partitionConfig.numOfPartitions = 2;
+  partitionConfig.backendNames = {"Interpreter", "Interpreter"};
+  partitionConfig.partitionNames = {"p1", "p2"};
+  partitionConfig.nodeToPartition = {{"in1", 0}, {"tanh1", 0}, {"out1", 0}};
+  Partitioner partitioner(&mod_, devices, /* saturateHost */ false,
+                          /* optimized */ true);
+  auto dagList = partitioner.partitionFromConfig(partitionConfig);
+  ASSERT_TRUE((bool)dagList);
+
+  // The result of tanh1 crosses the partitions, the conversion of out1 is
+  // copied into p2 for the Relu and in2.
+  auto *p1 = mod_.getFunction("p1");
+  auto *p2 = mod_.getFunction("p2");
+  ASSERT_TRUE(p1 && p2);
+  unsigned numCrossing = 0;
+  for (auto &N : p1->getNodes()) {
+    if (auto *save = llvm::dyn_cast<SaveNode>(&N)) {
+      EXPECT_EQ(save->getInput().getNode(), tanh1);
+      EXPECT_EQ(save->getPlaceholder()->getElementType(),
+                ElemKind::Float16Ty);
+      numCrossing++;
+    }
+    EXPECT_FALSE(llvm::isa<ConvertToNode>(&N) &&
+                 N.getNthResult(0).getElementType() == ElemKind::FloatTy);
+  }
+  EXPECT_EQ(numCrossing, 1);
+  EXPECT_EQ(in2->getParent(), p2);
+  EXPECT_EQ(in2->getInput(), relu->getInput());
+  EXPECT_EQ(in2->getInput().getNode()->getParent(), p2);
+  EXPECT_TRUE(p1->verify());
+  EXPECT_TRUE(p2->verify());
+}
+
 /// This one test load-balanced partition flow.
 TEST_F(PartitionerTest, loadBalancedPartition) {
   ExecutionEngine EER, EEP;
@@ -1089,3 +1214,530 @@ TEST_F(PartitionerTest, loadBalancedPartition) {
     EXPECT_TRUE(ref.isEqual(test));
   }
 }
+
+/// Check the roofline cost report of -partition-cost-report, with the times
+/// measured in the trace events of -partition-cost-profile.
+TEST_F(PartitionerTest, costReport) {
+  auto *lhs = mod_.createPlaceholder(ElemKind::FloatTy, {1, 32}, "lhs", false);
+  auto *rhs = mod_.createConstant(ElemKind::FloatTy, {32, 16}, "rhs");
+  Node *N = F_->createMatMul("mm", lhs, rhs);
+  N = F_->createSigmoid("sigmoid", N);
+  F_->createSave("ret", N);
+
+  // Only sigmoid is measured, with an average of 5us.
+  llvm::SmallVector<char, 64> profilePath, reportPath;
+  llvm::sys::fs::createTemporaryFile("profile", "json", profilePath);
+  llvm::sys::fs::createTemporaryFile("report", "csv", reportPath);
+  std::string profile(profilePath.begin(), profilePath.end());
+  std::string report(reportPath.begin(), reportPath.end());
+  std::vector<TraceEvent> events;
+  events.emplace_back("sigmoid", uint64_t(0), uint64_t(4), 0);
+  events.emplace_back("sigmoid", uint64_t(10), uint64_t(6), 0);
+  events.emplace_back("mm", uint64_t(20), char(TraceEvent::InstantType), 0);
+  TraceEvent::dumpTraceEvents(events, profile);
+
+  auto &options = llvm::cl::getRegisteredOptions();
+  auto *reportOpt = static_cast<llvm::cl::opt<std::string> *>(
+      options["partition-cost-report"]);
+  auto *profileOpt = static_cast<llvm::cl::opt<std::string> *>(
+      options["partition-cost-profile"]);
+  ASSERT_TRUE(reportOpt && profileOpt);
+  *reportOpt = report;
+  *profileOpt = profile;
+
+  DeviceInfo device;
+  device.availableMemory = 1 << 20;
+  device.backendName = "Interpreter";
+  device.sramCapacity = 1 << 20;
+  device.peakCompute = 1e9;
+  device.peakDramBw = 1e9;
+  device.peakSramBw = 1e9;
+  Partitioner myPartitioner(&mod_, {device}, false, true);
+  CompilationContext cctx;
+  auto dagList = myPartitioner.partition(cctx);
+  *reportOpt = "";
+  *profileOpt = "";
+  ASSERT_TRUE((bool)dagList);
+
+  auto buffer = llvm::MemoryBuffer::getFile(report);
+  ASSERT_TRUE((bool)buffer);
+  llvm::SmallVector<llvm::StringRef, 8> lines;
+  buffer.get()->getBuffer().trim().split(lines, '\n');
+  llvm::sys::fs::remove(profile);
+  llvm::sys::fs::remove(report);
+
+  // The header, the three nodes and the total of the partition.
+  ASSERT_EQ(lines.size(), 5);
+  EXPECT_TRUE(lines[0].startswith("partition,backend,node,kind,ops,"));
+  llvm::StringMap<llvm::SmallVector<llvm::StringRef, 10>> rows;
+  for (size_t i = 1; i < lines.size(); i++) {
+    llvm::SmallVector<llvm::StringRef, 10> columns;
+    lines[i].split(columns, ',');
+    ASSERT_EQ(columns.size(), 10);
+    EXPECT_EQ(columns[0], "main");
+    EXPECT_EQ(columns[1], "Interpreter");
+    rows[columns[2]] = columns;
+  }
+  ASSERT_EQ(rows.count("mm"), 1);
+  ASSERT_EQ(rows.count("sigmoid"), 1);
+  ASSERT_EQ(rows.count("total"), 1);
+
+  // 2 * 1 * 32 * 16 ops, for 128 + 2048 bytes of inputs and 64 of outputs.
+  EXPECT_EQ(rows["mm"][3], "MatMul");
+  EXPECT_EQ(rows["mm"][4], "1024");
+  EXPECT_EQ(rows["mm"][6], "2240");
+  EXPECT_EQ(rows["mm"][7], "0.457");
+  EXPECT_EQ(rows["mm"][8], "2.240");
+  EXPECT_EQ(rows["mm"][9], "");
+  EXPECT_EQ(rows["sigmoid"][9], "5.000");
+  // The partition isn't fully measured.
+  EXPECT_EQ(rows["total"][4], "1024");
+  EXPECT_EQ(rows["total"][9], "");
+}
+
+/// Check that the load-balanced partition balances the times measured in the
+/// trace events of -partition-profile rather than the roofline estimates.
+TEST_F(PartitionerTest, loadBalancedPartitionWithProfile) {
+  auto createNetwork = [](Module &mod) {
+    Function *F = mod.createFunction("main");
+    auto *input =
+        mod.createPlaceholder(ElemKind::FloatTy, {1, 32}, "input", false);
+    Node *N = F->createSigmoid("sigmoid", input);
+    N = F->createTanh("tanh", N);
+    N = F->createRELU("relu", N);
+    N = F->createExp("exp", N);
+    F->createSave("ret", N);
+  };
+
+  // The elementwise nodes have the same estimate, but sigmoid is measured as
+  // more expensive than all the others together. relu isn't measured.
+  llvm::SmallVector<char, 64> profilePath;
+  llvm::sys::fs::createTemporaryFile("profile", "json", profilePath);
+  std::string profile(profilePath.begin(), profilePath.end());
+  std::vector<TraceEvent> events;
+  events.emplace_back("sigmoid", uint64_t(0), uint64_t(100), 0);
+  events.emplace_back("tanh", uint64_t(100), uint64_t(1), 0);
+  events.emplace_back("exp", uint64_t(101), uint64_t(1), 0);
+  TraceEvent::dumpTraceEvents(events, profile);
+
+  DeviceInfo device;
+  device.availableMemory = 1 << 20;
+  device.backendName = "Interpreter";
+  device.sramCapacity = 1 << 20;
+  device.peakCompute = 1e9;
+  device.peakDramBw = 1e9;
+  device.peakSramBw = 1e9;
+  std::vector<DeviceInfo> devices{device, device};
+
+  // Creates and partitions the network, and \returns the number of nodes of
+  // the first partition.
+  auto partitionFirstSize = [&]() -> size_t {
+    Module mod;
+    createNetwork(mod);
+    Partitioner myPartitioner(&mod, devices, false, true);
+    CompilationContext cctx;
+    auto dagList = myPartitioner.loadBalancedPartition(cctx, devices.size());
+    EXPECT_TRUE((bool)dagList);
+    EXPECT_EQ(mod.getFunctions().size(), 2);
+    Function *first = mod.getFunction("main_part1");
+    return first ? first->getNodes().size() : 0;
+  };
+
+  // With the estimates, sigmoid and tanh fit in the first partition.
+  EXPECT_EQ(partitionFirstSize(), 3);
+
+  // With the profile, sigmoid is alone in the first partition.
+  auto *profileOpt = static_cast<llvm::cl::opt<std::string> *>(
+      llvm::cl::getRegisteredOptions()["partition-profile"]);
+  ASSERT_TRUE(profileOpt);
+  *profileOpt = profile;
+  EXPECT_EQ(partitionFirstSize(), 2);
+  *profileOpt = "";
+  llvm::sys::fs::remove(profile);
+}
+
+/// \returns the bytes of the placeholders saved by a function of \p mod and
+/// read by another, counted once per reading function.
+static uint64_t getTransferredBytes(Module &mod) {
+  uint64_t bytes = 0;
+  for (auto *F : mod.getFunctions()) {
+    for (auto &N : F->getNodes()) {
+      auto *save = llvm::dyn_cast<SaveNode>(&N);
+      if (!save) {
+        continue;
+      }
+      std::set<Function *> readers;
+      for (auto &U : save->getPlaceholder()->getUsers()) {
+        auto *user = U.getUser();
+        if (user != save && user->getParent() != F) {
+          readers.insert(user->getParent());
+        }
+      }
+      bytes += readers.size() *
+               save->getPlaceholder()->getType()->getSizeInBytes();
+    }
+  }
+  return bytes;
+}
+
+/// Check that the min-cut partition cuts through a smaller tensor than the
+/// memory-based cut of the heterogeneous partition, and keeps the results.
+TEST_F(PartitionerTest, minCutPartition) {
+  ExecutionEngine EER, EEH, EEM;
+  constexpr float range = 2.0;
+  std::vector<ExecutionEngine *> engines{&EER, &EEH, &EEM};
+  for (auto EE : engines) {
+    auto mod = &EE->getModule();
+    F_ = mod->createFunction("main");
+    auto *input =
+        mod->createPlaceholder(ElemKind::FloatTy, {1, 64}, "input", false);
+    auto *w1 = mod->createConstant(ElemKind::FloatTy, {64, 4}, "w1");
+    auto *w2 = mod->createConstant(ElemKind::FloatTy, {4, 64}, "w2");
+    auto *w3 = mod->createConstant(ElemKind::FloatTy, {64, 64}, "w3");
+    w1->getHandle<>().randomize(-range, range, mod->getPRNG());
+    w2->getHandle<>().randomize(-range, range, mod->getPRNG());
+    w3->getHandle<>().randomize(-range, range, mod->getPRNG());
+
+    // The bottleneck of 4 elements is followed by the large weights w3, which
+    // don't fit with the others.
+    Node *N = F_->createTanh("tanh", input);
+    N = F_->createMatMul("mm1", N, w1);
+    N = F_->createMatMul("mm2", N, w2);
+    N = F_->createMatMul("mm3", N, w3);
+    F_->createSave("ret", N);
+  }
+
+  Tensor in(ElemKind::FloatTy, {1, 64});
+  in.getHandle<>().randomize(-range, range, EER.getModule().getPRNG());
+  EER.compile(CompilationMode::Infer);
+  bindings_.clear();
+  bindings_.allocate(EER.getModule().getPlaceholders());
+  updateInputPlaceholders(bindings_, {bindings_.getPlaceholderByName("input")},
+                          {&in});
+  EER.run(bindings_);
+  Tensor ref = bindings_.get(bindings_.getPlaceholderByName("ret"))->clone();
+
+  // Room for w3 and a little more, but not for all the weights.
+  std::vector<DeviceInfo> devices = {{17920, "Interpreter"},
+                                     {17920, "Interpreter"}};
+  CompilationContext cctx;
+
+  // The memory-based cut sends the 64 elements of mm2.
+  Partitioner heterogeneousPartitioner(&EEH.getModule(), devices, false, true);
+  auto heterogeneousList =
+      heterogeneousPartitioner.heterogeneousPartition(cctx);
+  ASSERT_TRUE((bool)heterogeneousList);
+  EXPECT_EQ(EEH.getModule().getFunctions().size(), 2);
+  EXPECT_EQ(getTransferredBytes(EEH.getModule()), 64 * sizeof(float));
+
+  // The min-cut sends the 4 elements of mm1 instead.
+  Partitioner minCutPartitioner(&EEM.getModule(), devices, false, true);
+  auto dagList = minCutPartitioner.minCutPartition(cctx);
+  ASSERT_TRUE((bool)dagList);
+  EXPECT_EQ(EEM.getModule().getFunctions().size(), 2);
+  EXPECT_EQ(getTransferredBytes(EEM.getModule()), 4 * sizeof(float));
+  EXPECT_TRUE(checkSaveNode(EEM.getModule()));
+
+  bindings_.clear();
+  bindings_.allocate(EEM.getModule().getPlaceholders());
+  EEM.compile(cctx);
+  for (auto it = dagList->begin(); it != dagList->end(); ++it) {
+    executeDAG((*it).root.get(), EEM.getModule(), bindings_,
+               {bindings_.getPlaceholderByName("input")}, {&in}, &EEM);
+    Tensor test = bindings_.get(bindings_.getPlaceholderByName("ret"))->clone();
+    EXPECT_TRUE(ref.isEqual(test));
+  }
+}
+
+/// Check that -partition-max-table-size shards an embedding table too large
+/// for one device across devices, and keeps the results.
+TEST_F(PartitionerTest, shardEmbeddingTables) {
+  ExecutionEngine EER, EEP;
+  std::vector<ExecutionEngine *> engines{&EER, &EEP};
+  for (auto EE : engines) {
+    auto mod = &EE->getModule();
+    F_ = mod->createFunction("main");
+    auto *data = mod->createConstant(ElemKind::FloatTy, {1000, 16}, "data");
+    data->getHandle<>().randomize(-2.0, 2.0, mod->getPRNG());
+    auto *weights =
+        mod->createPlaceholder(ElemKind::FloatTy, {8}, "weights", false);
+    auto *indices =
+        mod->createPlaceholder(ElemKind::Int64ITy, {8}, "indices", false);
+    auto *lengths =
+        mod->createPlaceholder(ElemKind::Int32ITy, {4}, "lengths", false);
+    auto *SLWS = F_->createSparseLengthsWeightedSum("slws", data, weights,
+                                                    indices, lengths);
+    F_->createSave("ret", SLWS);
+  }
+
+  Tensor weights(ElemKind::FloatTy, {8});
+  Tensor indices(ElemKind::Int64ITy, {8});
+  Tensor lengths(ElemKind::Int32ITy, {4});
+  weights.getHandle<>() = {1, -2, 0.5, 3, 1, 1, -1, 2};
+  indices.getHandle<int64_t>() = {0, 999, 500, 1, 2, 998, 3, 501};
+  lengths.getHandle<int32_t>() = {2, 3, 0, 3};
+  auto inputs = [&](PlaceholderBindings &bindings) {
+    updateInputPlaceholders(bindings,
+                            {bindings.getPlaceholderByName("weights"),
+                             bindings.getPlaceholderByName("indices"),
+                             bindings.getPlaceholderByName("lengths")},
+                            {&weights, &indices, &lengths});
+  };
+
+  EER.compile(CompilationMode::Infer);
+  bindings_.clear();
+  bindings_.allocate(EER.getModule().getPlaceholders());
+  inputs(bindings_);
+  EER.run(bindings_);
+  Tensor ref = bindings_.get(bindings_.getPlaceholderByName("ret"))->clone();
+
+  // The table of 64000 bytes is split into two shards of 32000 bytes, which
+  // only fit on different devices.
+  auto *maxTableSizeOpt = static_cast<llvm::cl::opt<uint64_t> *>(
+      llvm::cl::getRegisteredOptions()["partition-max-table-size"]);
+  ASSERT_TRUE(maxTableSizeOpt);
+  *maxTableSizeOpt = 32000;
+  std::vector<DeviceInfo> devices = {{40000, "Interpreter"},
+                                     {40000, "Interpreter"}};
+  Partitioner myPartitioner(&EEP.getModule(), devices, false, true);
+  CompilationContext cctx;
+  auto dagList = myPartitioner.partition(cctx);
+  *maxTableSizeOpt = 0;
+  ASSERT_TRUE((bool)dagList);
+  EXPECT_EQ(EEP.getModule().getFunctions().size(), 2);
+  EXPECT_FALSE(EEP.getModule().getConstantByName("data"));
+  ASSERT_EQ(EEP.getModule().getConstants().size(), 2);
+  for (auto *C : EEP.getModule().getConstants()) {
+    EXPECT_EQ(C->getType()->getSizeInBytes(), 32000);
+  }
+
+  bindings_.clear();
+  bindings_.allocate(EEP.getModule().getPlaceholders());
+  EEP.compile(cctx);
+  for (auto it = dagList->begin(); it != dagList->end(); ++it) {
+    inputs(bindings_);
+    executeDAG((*it).root.get(), EEP.getModule(), bindings_, {}, {}, &EEP);
+    Tensor test = bindings_.get(bindings_.getPlaceholderByName("ret"))->clone();
+    EXPECT_TRUE(ref.isEqual(test, 1e-5));
+  }
+}
+
+/// Check that the Storage nodes used the most are hinted to be placed in the
+/// SRAM of the device first, as long as they fit.
+TEST_F(PartitionerTest, SRAMPrioritization) {
+  auto *input = mod_.createPlaceholder(ElemKind::FloatTy, {10}, "input", false);
+  auto *once = mod_.createConstant(ElemKind::FloatTy, {10}, "once");
+  auto *twice = mod_.createConstant(ElemKind::FloatTy, {10}, "twice");
+  once->getPayloadMutable().getHandle<>().clear(1);
+  twice->getPayloadMutable().getHandle<>().clear(2);
+  Node *N = F_->createAdd("add", input, twice);
+  N = F_->createMul("mul", N, twice);
+  N = F_->createSub("sub", N, once);
+  F_->createSave("ret", N);
+
+  // The constant used twice and then the input fit in the 100 bytes, the
+  // other tensors of 40 bytes don't.
+  DeviceInfo device;
+  device.availableMemory = 1 << 20;
+  device.backendName = "Interpreter";
+  device.sramCapacity = 100;
+  Partitioner myPartitioner(&mod_, {device}, false, true);
+  CompilationContext cctx;
+  auto dagList = myPartitioner.partition(cctx);
+  ASSERT_TRUE((bool)dagList);
+  ASSERT_EQ(dagList->size(), 1);
+  ASSERT_EQ(dagList->front().nodes.size(), 1);
+  const auto &hints =
+      dagList->front().nodes[0]->backendHints.SRAMPrioritization;
+  EXPECT_EQ(hints, std::vector<std::string>({"twice", "input"}));
+}
+
+/// Check that a function of embedding lookups is hinted as bound by the DRAM
+/// bandwidth of its device, and a function of matrix multiplications isn't.
+TEST_F(PartitionerTest, MemoryBoundHints) {
+  DeviceInfo device;
+  device.availableMemory = 1 << 24;
+  device.backendName = "Interpreter";
+  device.sramCapacity = 1 << 20;
+  device.peakCompute = 1e12;
+  device.peakDramBw = 1e11;
+  device.peakSramBw = 1e12;
+  device.peakPCIeBw = 1e10;
+
+  auto *data = mod_.createConstant(ElemKind::FloatTy, {1000, 64}, "data");
+  data->getPayloadMutable().zero();
+  auto *indices =
+      mod_.createPlaceholder(ElemKind::Int64ITy, {1000}, "indices", false);
+  auto *lengths =
+      mod_.createPlaceholder(ElemKind::Int32ITy, {10}, "lengths", false);
+  F_->createSave("ret",
+                 F_->createSparseLengthsSum("SLS", data, indices, lengths));
+  {
+    Partitioner myPartitioner(&mod_, {device}, false, true);
+    CompilationContext cctx;
+    auto dagList = myPartitioner.partition(cctx);
+    ASSERT_TRUE((bool)dagList);
+    ASSERT_EQ(dagList->size(), 1);
+    ASSERT_EQ(dagList->front().nodes.size(), 1);
+    EXPECT_TRUE(dagList->front().nodes[0]->backendHints.memoryBound);
+  }
+
+  Module mod;
+  Function *F = mod.createFunction("main");
+  auto *input =
+      mod.createPlaceholder(ElemKind::FloatTy, {64, 256}, "input", false);
+  auto *weights = mod.createConstant(ElemKind::FloatTy, {256, 256}, "weights");
+  auto *bias = mod.createConstant(ElemKind::FloatTy, {256}, "bias");
+  weights->getPayloadMutable().zero();
+  bias->getPayloadMutable().zero();
+  F->createSave("ret", F->createFullyConnected("fc", input, weights, bias));
+  Partitioner myPartitioner(&mod, {device}, false, true);
+  CompilationContext cctx;
+  auto dagList = myPartitioner.partition(cctx);
+  ASSERT_TRUE((bool)dagList);
+  ASSERT_EQ(dagList->size(), 1);
+  ASSERT_EQ(dagList->front().nodes.size(), 1);
+  EXPECT_FALSE(dagList->front().nodes[0]->backendHints.memoryBound);
+}
+
+/// Create in \p mod the function "main" of a chain of fully connected layers
+/// which doesn't fit on a device of 3072 bytes.
+static void createFCChain(Module &mod) {
+  Function *F = mod.createFunction("main");
+  Node *N = mod.createPlaceholder(ElemKind::FloatTy, {1, 16}, "input", false);
+  for (unsigned i = 0; i < 4; i++) {
+    auto *W = mod.createConstant(ElemKind::FloatTy, {16, 16},
+                                 "w" + std::to_string(i));
+    auto *B = mod.createConstant(ElemKind::FloatTy, {16},
+                                 "b" + std::to_string(i));
+    W->getPayloadMutable().zero();
+    B->getPayloadMutable().zero();
+    N = F->createFullyConnected("fc" + std::to_string(i), N, W, B);
+    N = F->createSigmoid("sigmoid" + std::to_string(i), N);
+  }
+  F->createSave("ret", N);
+}
+
+/// Check that the plan of the partitions of a function is saved, and that
+/// the same function on the same devices is then partitioned as the plan
+/// says.
+TEST_F(PartitionerTest, PartitionPlanCache) {
+  llvm::SmallString<64> dir;
+  ASSERT_FALSE(llvm::sys::fs::createUniqueDirectory("partition-plans", dir));
+  auto *planCacheOpt = static_cast<llvm::cl::opt<std::string> *>(
+      llvm::cl::getRegisteredOptions()["partition-plan-cache"]);
+  ASSERT_TRUE(planCacheOpt);
+  *planCacheOpt = dir.str().str();
+  std::vector<DeviceInfo> devices(3, {3072, "Interpreter"});
+  CompilationContext cctx;
+
+  Module mod1;
+  createFCChain(mod1);
+  Partitioner partitioner1(&mod1, devices, false, true);
+  auto dagList1 = partitioner1.partition(cctx);
+  ASSERT_TRUE((bool)dagList1);
+  const auto &nodes1 = dagList1->front().nodes;
+  ASSERT_GE(nodes1.size(), 2);
+
+  // Rename the partitions of the saved plan, to see that it is used.
+  std::error_code EC;
+  llvm::sys::fs::directory_iterator fileIt(dir, EC);
+  ASSERT_FALSE(EC);
+  ASSERT_NE(fileIt, llvm::sys::fs::directory_iterator());
+  std::string planFile = fileIt->path();
+  PartitionConfig plan;
+  ASSIGN_VALUE_OR_FAIL_TEST(plan, deserializePartitionConfig(planFile));
+  EXPECT_EQ(plan.funcName, "main");
+  ASSERT_EQ(plan.numOfPartitions, nodes1.size());
+  for (size_t i = 0; i < plan.numOfPartitions; i++) {
+    plan.partitionNames[i] = "plan_part" + std::to_string(i);
+  }
+  FAIL_TEST_IF_ERR(serializePartitionConfig(plan, planFile));
+
+  Module mod2;
+  createFCChain(mod2);
+  Partitioner partitioner2(&mod2, devices, false, true);
+  auto dagList2 = partitioner2.partition(cctx);
+  *planCacheOpt = "";
+  llvm::sys::fs::remove_directories(dir);
+  ASSERT_TRUE((bool)dagList2);
+  const auto &nodes2 = dagList2->front().nodes;
+  ASSERT_EQ(nodes2.size(), nodes1.size());
+  for (size_t i = 0; i < nodes1.size(); i++) {
+    auto it = std::find_if(nodes2.begin(), nodes2.end(),
+                           [i](const std::unique_ptr<DAGNode> &node) {
+                             return node->name ==
+                                    "plan_part" + std::to_string(i);
+                           });
+    ASSERT_NE(it, nodes2.end());
+    EXPECT_EQ((*it)->logicalDevices, nodes1[i]->logicalDevices);
+    EXPECT_EQ((*it)->children.size(), nodes1[i]->children.size());
+    EXPECT_EQ(mod2.getFunction((*it)->name)->getNodes().size(),
+              mod1.getFunction(nodes1[i]->name)->getNodes().size());
+  }
+}
+
+/// Check that the replicas of a hot network go to the devices a cold network
+/// doesn't need, up to the target of the hot one.
+TEST(PlacementPlanner, HotAndColdNetworks) {
+  std::vector<DeviceInfo> devices(4, {1000, "Interpreter"});
+  std::vector<NetworkLoad> networks(2);
+  networks[0].name = "hot";
+  networks[0].backendName = "Interpreter";
+  networks[0].memory = 100;
+  networks[0].targetQPS = 300;
+  networks[0].replicaQPS = 100;
+  networks[1] = networks[0];
+  networks[1].name = "cold";
+  networks[1].targetQPS = 10;
+  auto plan = planPlacement(networks, devices);
+  ASSERT_TRUE((bool)plan);
+  EXPECT_EQ(plan->replicas["hot"], std::vector<unsigned>({0, 2, 3}));
+  EXPECT_EQ(plan->replicas["cold"], std::vector<unsigned>({1}));
+  EXPECT_EQ(plan->servedQPS, 310);
+
+  // Without a known rate a network gets one replica.
+  networks[0].replicaQPS = 0;
+  plan = planPlacement(networks, devices);
+  ASSERT_TRUE((bool)plan);
+  EXPECT_EQ(plan->replicas["hot"].size(), 1);
+}
+
+/// Check that the replicas fit in the memory of the devices, and that a
+/// network which fits nowhere is an error.
+TEST(PlacementPlanner, MemoryLimits) {
+  std::vector<DeviceInfo> devices(4, {150, "Interpreter"});
+  std::vector<NetworkLoad> networks(2);
+  networks[0].name = "a";
+  networks[0].backendName = "Interpreter";
+  networks[0].memory = 100;
+  networks[0].targetQPS = 1000;
+  networks[0].replicaQPS = 100;
+  networks[1] = networks[0];
+  networks[1].name = "b";
+  auto plan = planPlacement(networks, devices);
+  ASSERT_TRUE((bool)plan);
+  EXPECT_EQ(plan->replicas["a"], std::vector<unsigned>({0, 2}));
+  EXPECT_EQ(plan->replicas["b"], std::vector<unsigned>({1, 3}));
+  EXPECT_EQ(plan->servedQPS, 400);
+
+  networks[1].memory = 200;
+  plan = planPlacement(networks, devices);
+  EXPECT_TRUE(ERR_TO_BOOL(plan.takeError()));
+}
+
+/// Check that a network stays on its device when it serves as many requests
+/// there as anywhere else.
+TEST(PlacementPlanner, KeepCurrentDevices) {
+  std::vector<DeviceInfo> devices(4, {1000, "Interpreter"});
+  std::vector<NetworkLoad> networks(1);
+  networks[0].name = "net";
+  networks[0].backendName = "Interpreter";
+  networks[0].memory = 100;
+  networks[0].targetQPS = 150;
+  networks[0].replicaQPS = 100;
+  networks[0].devices = {1, 3};
+  auto plan = planPlacement(networks, devices);
+  ASSERT_TRUE((bool)plan);
+  EXPECT_EQ(plan->replicas["net"], std::vector<unsigned>({1, 3}));
+}
@@ -103,3 +103,54 @@ TEST_F(ProvisionerTest, provisionDagFail) {
   // Expect that there was an Error when provisioning
   EXPECT_TRUE(ERR_TO_BOOL(std::move(err)));
 }
+
+/// Test that the partitions of a network are kept on the devices of one NUMA
+/// node, the node with the most available memory, even when another node has
+/// the device with the most available memory.
+TEST_F(ProvisionerTest, provisionNumaNode) {
+  auto mod = setupModule(2);
+  auto networks = setupDAG(1, 1);
+
+  DeviceManagerMapTy devices;
+  const uint64_t memory[] = {3000000000, 2500000000, 1000000000, 2500000000};
+  for (int i = 0; i < 4; i++) {
+    auto config = DeviceConfig("CPU");
+    config.setDeviceMemory(memory[i]);
+    config.parameters["numaNode"] = std::to_string(i % 2);
+    std::unique_ptr<DeviceManager> device(new CPUDeviceManager(config));
+    devices.emplace(i, std::move(device));
+  }
+
+  CompilationContext cctx;
+  Provisioner provisioner(devices);
+  ASSERT_FALSE(ERR_TO_BOOL(provisioner.provision(networks, *mod.get(), cctx)));
+  for (auto &node : networks[0].nodes) {
+    for (auto deviceID : node->deviceIDs) {
+      EXPECT_EQ(deviceID % 2, 1);
+    }
+  }
+  EXPECT_EQ(networks[0].nodes.back()->deviceIDs.size(), 2);
+}
+
+/// Test that a function replicated on several devices is loaded on all of
+/// them from one copy of its constants on the host.
+TEST_F(ProvisionerTest, provisionReplicasShareConstants) {
+  auto mod = setupModule(1);
+  auto networks = setupDAG(1, 0);
+
+  DeviceManagerMapTy devices;
+  for (int i = 0; i < 2; i++) {
+    std::unique_ptr<DeviceManager> device(
+        new CPUDeviceManager(DeviceConfig("CPU")));
+    devices.emplace(i, std::move(device));
+  }
+
+  CompilationContext cctx;
+  Provisioner provisioner(devices);
+  ASSERT_FALSE(ERR_TO_BOOL(provisioner.provision(networks, *mod.get(), cctx)));
+  auto &node = networks[0].nodes.back();
+  EXPECT_EQ(node->deviceIDs.size(), 2);
+  auto *function = provisioner.getFunction(node->name);
+  ASSERT_NE(function, nullptr);
+  EXPECT_NE(function->getRuntimeBundle().getConstants(), nullptr);
+}
@@ -21,6 +21,7 @@
 #include "glow/IR/IR.h"
 #include "glow/Optimizer/GraphOptimizer/GraphOptimizer.h"
 #include "glow/Quantization/Base/Base.h"
+#include "glow/Quantization/Base/Profile.h"
 #include "glow/Quantization/Quantization.h"
 #include "glow/Quantization/Serialization.h"
 
@@ -509,6 +510,63 @@ TEST(Quantization, enableRowwiseQuantizedFullyConnected) {
   EE.run(bindings);
 }
 
+/// Test enabling DynamicQuantizedFullyConnected in Glow quantization
+/// procedure. A lowered FC with constant weights is converted to a
+/// DynamicQuantizedFullyConnected without any profile, while the other nodes
+/// stay in float.
+TEST(Quantization, enableDynamicQuantizedFullyConnected) {
+  ExecutionEngine EE{};
+  auto &mod = EE.getModule();
+  Function *F = mod.createFunction("main");
+
+  auto *input = mod.createPlaceholder(ElemKind::FloatTy, {4, 8}, "input", true);
+  auto *B = mod.createPlaceholder(ElemKind::FloatTy, {3}, "bias", true);
+  PlaceholderBindings bindings;
+  bindings.allocate(input)->getHandle().randomize(-2.0, 2.0, mod.getPRNG());
+  bindings.allocate(B)->init(Tensor::InitKind::Broadcast, 0.1, mod.getPRNG());
+
+  auto *WC = mod.createConstant(ElemKind::FloatTy, {8, 3}, "wc");
+  WC->getPayloadMutable().getHandle().randomize(-1.0, 1.0, mod.getPRNG());
+  auto *FC = F->createFullyConnected("FC", input, WC, B);
+  auto *R = F->createRELU("relu", FC);
+  auto *S = F->createSave("ret", R);
+  bindings.allocate(S->getPlaceholder());
+
+  LoweredInfoMap loweredMapForQuant;
+  CompilationContext cctx(/* bindings */ nullptr, &loweredMapForQuant);
+  std::unique_ptr<Backend> backend(createBackend(EE.getBackendName()));
+  ::glow::lower(F, cctx, backend.get());
+
+  quantization::QuantizationConfiguration quantConfig;
+  quantConfig.enableDynamic = true;
+  quantization::quantizeFunction(F, quantConfig, *backend, loweredMapForQuant);
+
+  // Check the graph structure after quantization.
+  auto *saveNode = llvm::dyn_cast<SaveNode>(F->getNodeByName(S->getName()));
+  ASSERT_TRUE(saveNode);
+  auto *reluNode = llvm::dyn_cast<ReluNode>(saveNode->getInput().getNode());
+  ASSERT_TRUE(reluNode);
+  EXPECT_EQ(reluNode->getResult().getElementType(), ElemKind::FloatTy);
+  auto *dqNode = llvm::dyn_cast<DynamicQuantizedFullyConnectedNode>(
+      reluNode->getInput().getNode());
+  ASSERT_TRUE(dqNode);
+  EXPECT_EQ(dqNode->getInput().getNode(), input);
+  auto *weightsNode = llvm::dyn_cast<Constant>(dqNode->getWeights().getNode());
+  ASSERT_TRUE(weightsNode);
+  EXPECT_EQ(weightsNode->getElementType(), ElemKind::Int8QTy);
+  EXPECT_EQ(weightsNode->getType()->getOffset(), 0);
+  for (auto &N : F->getNodes()) {
+    EXPECT_FALSE(llvm::isa<MatMulNode>(&N));
+    EXPECT_FALSE(llvm::isa<BatchedAddNode>(&N));
+  }
+
+  // Make sure that graph can be compiled and run. We check the correctness of
+  // DynamicQuantizedFullyConnected in operatorTests.cpp.
+  EE.compile(CompilationMode::Infer);
+
+  EE.run(bindings);
+}
+
 /// Test enabling RowwiseQuantizedFullyConnected with Symmetric quantization.
 TEST(Quantization, enableRowwiseQuantizedFullyConnectedSymmetric) {
   ExecutionEngine EE{};
@@ -666,6 +724,68 @@ TEST(Quantization, enableRowwiseQuantizedSLWS) {
   ASSERT_TRUE(FRWQSLWS);
 }
 
+/// Check that the embedding tables within the 4-bit error budget of the
+/// quantizer are fused rowwise-quantized to 4 bits, and the others to 8 bits.
+TEST(Quantization, enableRowwiseQuantizedSLWSFused4Bit) {
+  for (float maxError : {0.0f, 1.0f}) {
+    ExecutionEngine EE{};
+    auto &mod = EE.getModule();
+    Function *F = mod.createFunction("main");
+    PlaceholderBindings bindings;
+
+    auto *data =
+        mod.createPlaceholder(ElemKind::FloatTy, {3, 4}, "data", false);
+    auto *weights =
+        mod.createPlaceholder(ElemKind::FloatTy, {8}, "weights", false);
+    auto *indices =
+        mod.createPlaceholder(ElemKind::Int64ITy, {8}, "indices", false);
+    auto *lengths =
+        mod.createPlaceholder(ElemKind::Int32ITy, {4}, "lengths", false);
+
+    bindings.allocate(data)->getHandle().randomize(-1.0, 1.0, mod.getPRNG());
+    bindings.allocate(weights);
+    bindings.allocate(indices);
+    bindings.allocate(lengths);
+
+    auto *SLWS = F->createSparseLengthsWeightedSum("SLWS", data, weights,
+                                                   indices, lengths);
+    auto *res = F->createSave("save", SLWS);
+    ::glow::convertPlaceholdersToConstants(
+        F, bindings, {indices, lengths, res->getPlaceholder()});
+    bindings.allocate(res->getPlaceholder());
+
+    quantization::QuantizationConfiguration quantConfig{{
+        {NodeQuantizationInfo::generateNodeOutputName(
+             SLWS->getData().getNode()->getName()),
+         {0.2f, 0}},
+        {NodeQuantizationInfo::generateNodeOutputName(
+             SLWS->getWeights().getNode()->getName()),
+         {0.3f, 0}},
+        {NodeQuantizationInfo::generateNodeOutputName(SLWS->getName()),
+         {0.4f, 0}},
+    }};
+
+    quantConfig.enableRowwise = true;
+    quantConfig.fused4BitMaxError = maxError;
+    std::unique_ptr<Backend> backend(createBackend(EE.getBackendName()));
+    quantization::quantizeFunction(F, quantConfig, *backend);
+
+    FusedRowwiseQuantizedSparseLengthsWeightedSumNode *FRWQSLWS = nullptr;
+    for (auto &N : F->getNodes()) {
+      if (auto *found =
+              llvm::dyn_cast<FusedRowwiseQuantizedSparseLengthsWeightedSumNode>(
+                  &N)) {
+        FRWQSLWS = found;
+      }
+    }
+    ASSERT_TRUE(FRWQSLWS);
+    EXPECT_EQ(FRWQSLWS->getData().getElementType(),
+              maxError > 0 ? ElemKind::UInt4FusedFP16QTy
+                           : ElemKind::UInt8FusedQTy);
+    EXPECT_EQ(FRWQSLWS->getResult().dims()[1], 4);
+  }
+}
+
 /// Quantize ReLU node and make sure that quantized version
 /// has quantization parameters mapping to non-negative floating
 /// point range.
@@ -1829,6 +1949,132 @@ TEST(Quantization, quantizeGraphPartiallyMultipleKinds) {
   }
 }
 
+/// Check that minimizeConversions runs in float the cheap quantized nodes
+/// between nodes which aren't quantized, and keeps the expensive ones
+/// quantized.
+TEST(Quantization, minimizeConversions) {
+  ExecutionEngine EE{};
+  PlaceholderBindings bindings;
+  auto &mod = EE.getModule();
+  Function *F = mod.createFunction("main");
+
+  auto *input = mod.createPlaceholder(ElemKind::FloatTy, {4, 16}, "in", false);
+  bindings.allocate(input)->getHandle().randomize(-1.0, 1.0, mod.getPRNG());
+  auto *weights = mod.createConstant(ElemKind::FloatTy, {16, 16}, "weights");
+  weights->getPayloadMutable().getHandle().randomize(-1.0, 1.0,
+                                                      mod.getPRNG());
+
+  auto *TN1 = F->createTanh("tanh1", input);
+  auto *RN = F->createRELU("relu", TN1);
+  auto *TN2 = F->createTanh("tanh2", RN);
+  auto *MMN = F->createMatMul("matmul", TN2, weights);
+  auto *TN3 = F->createTanh("tanh3", MMN);
+  auto *save = F->createSave("ret", TN3);
+  bindings.allocate(save->getPlaceholder());
+
+  quantization::QuantizationConfiguration quantConfig{{
+      {NodeQuantizationInfo::generateNodeOutputName(input->getName()),
+       {0.01f, 0}},
+      {NodeQuantizationInfo::generateNodeOutputName(weights->getName()),
+       {0.01f, 0}},
+      {NodeQuantizationInfo::generateNodeOutputName(TN1->getName()),
+       {0.01f, 0}},
+      {NodeQuantizationInfo::generateNodeOutputName(RN->getName()), {0.01f, 0}},
+      {NodeQuantizationInfo::generateNodeOutputName(TN2->getName()),
+       {0.01f, 0}},
+      {NodeQuantizationInfo::generateNodeOutputName(MMN->getName()),
+       {0.2f, 0}},
+      {NodeQuantizationInfo::generateNodeOutputName(TN3->getName()),
+       {0.01f, 0}},
+  }};
+  quantConfig.minimizeConversions = true;
+
+  KindSet doNotQuantizeKinds;
+  doNotQuantizeKinds.insert(Kinded::Kind::TanhNodeKind);
+
+  MockQuantBackend backend;
+  quantization::quantizeFunction(F, quantConfig, backend,
+                                 /* loweredMap */ {}, doNotQuantizeKinds);
+
+  // The Relu saves less than its conversions cost, it runs in float between
+  // the Tanhs.
+  auto *floatRN = llvm::dyn_cast<ReluNode>(TN2->getInput());
+  ASSERT_TRUE(floatRN);
+  EXPECT_FALSE(floatRN->getResult().getType()->isQuantizedType());
+  EXPECT_EQ(floatRN->getInput().getNode(), TN1);
+
+  // The MatMul saves more than its conversions cost, it stays quantized.
+  auto *DN = llvm::dyn_cast<DequantizeNode>(TN3->getInput());
+  ASSERT_TRUE(DN);
+  auto *quantizedMMN = llvm::dyn_cast<MatMulNode>(DN->getInput());
+  ASSERT_TRUE(quantizedMMN);
+  EXPECT_TRUE(quantizedMMN->getResult().getType()->isQuantizedType());
+
+  unsigned numConversions = 0;
+  for (const auto &node : F->getNodes()) {
+    numConversions +=
+        llvm::isa<QuantizeNode>(&node) || llvm::isa<DequantizeNode>(&node);
+  }
+  // The input and the weights of the MatMul, and its result.
+  EXPECT_EQ(numConversions, 3);
+
+  CompilationContext cctx;
+  cctx.compMode = CompilationMode::Infer;
+  EE.compile(cctx);
+  EE.run(bindings);
+}
+
+/// Check that the nodes of int16ActivationKinds get Int16QTy activations while
+/// their weights stay in Int8QTy.
+TEST(Quantization, int16ActivationKinds) {
+  ExecutionEngine EE{};
+  auto &mod = EE.getModule();
+  Function *F = mod.createFunction("main");
+
+  auto *input =
+      mod.createPlaceholder(ElemKind::FloatTy, {1, 4, 4, 1}, "input", false);
+  auto *filter = mod.createConstant(ElemKind::FloatTy, {2, 2, 2, 1}, "filter");
+  auto *bias = mod.createConstant(ElemKind::FloatTy, {2}, "bias");
+  auto outTy = mod.uniqueType(ElemKind::FloatTy, {1, 4, 8, 2});
+  PlaceholderBindings bindings;
+  bindings.allocate(input)->getHandle().randomize(-1.0, 1.0, mod.getPRNG());
+  filter->getHandle().randomize(-1.0, 1.0, mod.getPRNG());
+  bias->getHandle().randomize(-1.0, 1.0, mod.getPRNG());
+
+  auto *CN = F->createConv("Conv", input, filter, bias, outTy, {2, 2}, {1, 1},
+                           {0, 2, 1, 3}, 1);
+  auto *S = F->createSave("ret", CN);
+  bindings.allocate(S->getPlaceholder());
+
+  quantization::QuantizationConfiguration quantConfig{{
+      {NodeQuantizationInfo::generateNodeOutputName(input->getName()),
+       {0.01f, 0}},
+      {NodeQuantizationInfo::generateNodeOutputName(filter->getName()),
+       {0.01f, 0}},
+      {NodeQuantizationInfo::generateNodeOutputName(bias->getName()),
+       {0.01f, 0}},
+      {NodeQuantizationInfo::generateNodeOutputName(CN->getName()),
+       {0.05f, 0}},
+  }};
+  quantConfig.assertAllNodesQuantized = true;
+  quantConfig.int16ActivationKinds.insert(Kinded::Kind::ConvolutionNodeKind);
+
+  std::unique_ptr<Backend> backend(createBackend(EE.getBackendName()));
+  quantization::quantizeFunction(F, quantConfig, *backend);
+
+  auto *DN = llvm::dyn_cast<DequantizeNode>(S->getInput());
+  ASSERT_TRUE(DN);
+  auto *quantizedCN = llvm::dyn_cast<ConvolutionNode>(DN->getInput());
+  ASSERT_TRUE(quantizedCN);
+  EXPECT_EQ(quantizedCN->getResult().getElementType(), ElemKind::Int16QTy);
+  EXPECT_EQ(quantizedCN->getInput().getElementType(), ElemKind::Int16QTy);
+  EXPECT_EQ(quantizedCN->getFilter().getElementType(), ElemKind::Int8QTy);
+  EXPECT_EQ(quantizedCN->getBias().getElementType(), ElemKind::Int32QTy);
+
+  EE.compile(CompilationMode::Infer);
+  EE.run(bindings);
+}
+
 /// Check that quantizeFunction directly converts the constants
 /// instead of leaving quantize node around.
 TEST(Quantization, quantizeFunctionConvertConstant) {
@@ -2391,6 +2637,93 @@ TEST(Quantization, QuantizationZeroUsersResult) {
   EXPECT_TRUE(qTK->getValues().getType()->isQuantizedType());
 }
 
+/// Check that merging histograms gathered separately covers the union of their
+/// ranges and keeps all of their counts.
+TEST(Quantization, mergeTensorHistograms) {
+  Tensor first(ElemKind::FloatTy, {6});
+  first.getHandle() = {-1, 0, 0.5, 1, 1.5, 2};
+  Tensor second(ElemKind::FloatTy, {4});
+  second.getHandle() = {1, 3, 4, 5};
+
+  Tensor firstHist(ElemKind::FloatTy, {10});
+  firstHist.zero();
+  float firstMin = 0, firstMax = 0;
+  quantization::generateTensorHistogram(first.getHandle(),
+                                        firstHist.getHandle(), firstMin,
+                                        firstMax);
+  Tensor secondHist(ElemKind::FloatTy, {10});
+  secondHist.zero();
+  float secondMin = 0, secondMax = 0;
+  quantization::generateTensorHistogram(second.getHandle(),
+                                        secondHist.getHandle(), secondMin,
+                                        secondMax);
+
+  // Merging into an empty histogram copies it.
+  Tensor merged(ElemKind::FloatTy, {10});
+  merged.zero();
+  float mergedMin = 0, mergedMax = 0;
+  quantization::mergeTensorHistograms(firstHist.getHandle(), firstMin,
+                                      firstMax, merged.getHandle(), mergedMin,
+                                      mergedMax);
+  EXPECT_TRUE(merged.isEqual(firstHist));
+  EXPECT_EQ(mergedMin, -1);
+  EXPECT_EQ(mergedMax, 2);
+
+  quantization::mergeTensorHistograms(secondHist.getHandle(), secondMin,
+                                      secondMax, merged.getHandle(), mergedMin,
+                                      mergedMax);
+  EXPECT_EQ(mergedMin, -1);
+  EXPECT_EQ(mergedMax, 5);
+  float total = 0;
+  for (auto count : merged.getHandle()) {
+    total += count;
+  }
+  EXPECT_EQ(total, 10);
+  // Only -1 falls in the first bin of width 0.6, and only 5 in the last one.
+  EXPECT_EQ(merged.getHandle().raw(0), 1);
+  EXPECT_EQ(merged.getHandle().raw(9), 1);
+}
+
+/// Check that profiles gathered by separate Modules on separate inputs are
+/// merged into the profile of all the inputs.
+TEST(Quantization, mergeQuantizationProfiles) {
+  auto profile = [](ExecutionEngine &EE, PlaceholderBindings &bindings,
+                    llvm::ArrayRef<float> data) {
+    auto &mod = EE.getModule();
+    Function *F = mod.createFunction("main");
+    auto *input =
+        mod.createPlaceholder(ElemKind::FloatTy, {4}, "input", false);
+    auto *save = F->createSave("save", F->createTanh("tanh", input));
+    bindings.allocate(save->getPlaceholder());
+    bindings.allocate(input)->getHandle() = data;
+    glow::profileQuantization(bindings, F);
+    EE.compile(CompilationMode::Infer);
+    EE.run(bindings);
+    return F;
+  };
+
+  ExecutionEngine firstEE{}, secondEE{};
+  PlaceholderBindings firstBindings, secondBindings;
+  Function *firstF = profile(firstEE, firstBindings, {-1, 0, 1, 2});
+  Function *secondF = profile(secondEE, secondBindings, {3, 4, 5, 6});
+
+  quantization::mergeQuantizationProfiles(firstBindings, firstF,
+                                          secondBindings, secondF);
+  auto infos =
+      quantization::generateNodeQuantizationInfos(firstBindings, firstF);
+  auto expected = quantization::chooseQuantizationParams(-1, 6);
+  bool foundInput = false;
+  for (const auto &info : infos) {
+    if (info.nodeOutputName_ ==
+        NodeQuantizationInfo::generateNodeOutputName("input")) {
+      foundInput = true;
+      EXPECT_EQ(info.Scale(), expected.scale);
+      EXPECT_EQ(info.Offset(), expected.offset);
+    }
+  }
+  EXPECT_TRUE(foundInput);
+}
+
 GLOW_INSTANTIATE_TEST_SUITE_P(Interpreter, Quantization,
                               ::testing::Values("Interpreter"));
 
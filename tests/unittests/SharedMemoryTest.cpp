@@ -0,0 +1,110 @@
+/**
+ * Copyright (c) Glow Contributors. See CONTRIBUTORS file.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "glow/Runtime/SharedMemory/SharedMemory.h"
+
+#include "gtest/gtest.h"
+
+#include <thread>
+#include <unistd.h>
+
+using namespace glow;
+using namespace glow::runtime;
+
+class SharedMemoryTest : public ::testing::Test {};
+
+/// \returns a HostManager with an Interpreter device running the network
+/// "net", which squares its input X of 3 floats into out.
+static std::unique_ptr<HostManager> createServedHostManager() {
+  std::vector<std::unique_ptr<DeviceConfig>> configs;
+  configs.push_back(llvm::make_unique<DeviceConfig>("Interpreter"));
+  auto hostManager = llvm::make_unique<HostManager>(std::move(configs));
+  auto module = llvm::make_unique<Module>();
+  Function *F = module->createFunction("net");
+  auto *X = module->createPlaceholder(ElemKind::FloatTy, {3}, "X", false);
+  auto *out = module->createPlaceholder(ElemKind::FloatTy, {3}, "out", false);
+  F->createSave("save", F->createPow("pow", X, 2.0), out);
+  CompilationContext cctx;
+  EXIT_ON_ERR(hostManager->addNetwork(std::move(module), cctx));
+  return hostManager;
+}
+
+/// Test that clients run the networks of a server with their tensors in the
+/// shared memory, and get the errors of the runs.
+TEST_F(SharedMemoryTest, RunThroughSegment) {
+  auto hostManager = createServedHostManager();
+  SharedMemoryConfig config;
+  config.name = "/glow-test-" + std::to_string(getpid());
+  config.numSlots = 4;
+  config.slotBytes = 1024;
+  std::unique_ptr<SharedMemoryServer> server;
+  ASSIGN_VALUE_OR_FAIL_TEST(server,
+                            SharedMemoryServer::create(*hostManager, config));
+  // The segment is owned by a single server.
+  EXPECT_TRUE(ERR_TO_BOOL(
+      SharedMemoryServer::create(*hostManager, config).takeError()));
+
+  constexpr unsigned numClients = 4;
+  std::vector<std::thread> threads;
+  for (unsigned c = 0; c < numClients; c++) {
+    threads.emplace_back([&, c]() {
+      std::unique_ptr<SharedMemoryClient> client;
+      ASSIGN_VALUE_OR_FAIL_TEST(client,
+                                SharedMemoryClient::connect(config.name));
+      std::unique_ptr<SharedMemoryClient::Request> request;
+      ASSIGN_VALUE_OR_FAIL_TEST(request, client->createRequest("net"));
+      void *inputData, *outputData;
+      ASSIGN_VALUE_OR_FAIL_TEST(inputData,
+                                request->addTensor("X", 3 * sizeof(float)));
+      ASSIGN_VALUE_OR_FAIL_TEST(outputData,
+                                request->addTensor("out", 3 * sizeof(float)));
+      float *input = static_cast<float *>(inputData);
+      float *output = static_cast<float *>(outputData);
+      for (unsigned i = 0; i < 10; i++) {
+        float value = c * 10 + i;
+        input[0] = value;
+        input[1] = value + 1;
+        input[2] = value + 2;
+        ASSERT_FALSE(ERR_TO_BOOL(client->run(*request)));
+        EXPECT_EQ(output[0], value * value);
+        EXPECT_EQ(output[2], (value + 2) * (value + 2));
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  std::unique_ptr<SharedMemoryClient> client;
+  ASSIGN_VALUE_OR_FAIL_TEST(client, SharedMemoryClient::connect(config.name));
+  {
+    // The sizes of the tensors are checked by the server.
+    std::unique_ptr<SharedMemoryClient::Request> request;
+    ASSIGN_VALUE_OR_FAIL_TEST(request, client->createRequest("net"));
+    ASSERT_TRUE(ERR_TO_BOOL(request->addTensor("X", 2048).takeError()));
+    ASSERT_FALSE(ERR_TO_BOOL(request->addTensor("X", 8).takeError()));
+    EXPECT_TRUE(ERR_TO_BOOL(client->run(*request)));
+  }
+  {
+    std::unique_ptr<SharedMemoryClient::Request> request;
+    ASSIGN_VALUE_OR_FAIL_TEST(request, client->createRequest("missing"));
+    EXPECT_TRUE(ERR_TO_BOOL(client->run(*request)));
+  }
+  client.reset();
+  server.reset();
+  EXPECT_TRUE(
+      ERR_TO_BOOL(SharedMemoryClient::connect(config.name).takeError()));
+}
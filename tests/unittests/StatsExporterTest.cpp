@@ -133,3 +133,72 @@ TEST(StatsExporter, HostManager) {
   }
   EXPECT_EQ(MockStats.counters["glow.devices_used.interpreter"], 0);
 }
+
+TEST(StatsExporter, Latency) {
+  using namespace glow::runtime;
+  {
+    auto deviceConfig = llvm::make_unique<DeviceConfig>("Interpreter");
+    std::vector<std::unique_ptr<DeviceConfig>> configs;
+    configs.push_back(std::move(deviceConfig));
+    HostConfig hostConfig;
+    hostConfig.latencyStatsSampleInterval = 2;
+    std::unique_ptr<HostManager> HM =
+        llvm::make_unique<HostManager>(std::move(configs), hostConfig);
+
+    std::unique_ptr<Module> module = llvm::make_unique<Module>();
+    Function *F = module->createFunction("main");
+    auto *X = module->createPlaceholder(ElemKind::FloatTy, {3}, "X", false);
+    F->createSave("save", F->createPow("Pow", X, 2.0));
+    CompilationContext cctx;
+    EXIT_ON_ERR(HM->addNetwork(std::move(module), cctx));
+
+    // Only the first and the third runs are sampled.
+    for (size_t i = 0; i < 3; i++) {
+      PlaceholderBindings bindings;
+      bindings.allocate(X)->getHandle() = {1, 2, 3};
+      bindings.allocate(F->getParent()->getPlaceholders());
+      EXIT_ON_ERR(HM->runNetworkBlocking("main", bindings));
+    }
+  }
+  // The HostManager is gone, every stage of the runs has been exported.
+  for (const char *stage : {"queue_wait", "execution", "callback",
+                            "partition", "result_handoff", "device_queue"}) {
+    auto it = MockStats.timeSeries.find(std::string("glow.latency.") + stage +
+                                        ".main");
+    ASSERT_NE(it, MockStats.timeSeries.end()) << stage;
+    EXPECT_EQ(it->second.size(), 2) << stage;
+  }
+}
+
+TEST(StatsExporter, ResultCache) {
+  using namespace glow::runtime;
+  auto deviceConfig = llvm::make_unique<DeviceConfig>("Interpreter");
+  std::vector<std::unique_ptr<DeviceConfig>> configs;
+  configs.push_back(std::move(deviceConfig));
+  std::unique_ptr<HostManager> HM =
+      llvm::make_unique<HostManager>(std::move(configs), HostConfig());
+
+  std::unique_ptr<Module> module = llvm::make_unique<Module>();
+  Function *F = module->createFunction("main");
+  auto *X = module->createPlaceholder(ElemKind::FloatTy, {3}, "X", false);
+  auto *out = module->createPlaceholder(ElemKind::FloatTy, {3}, "out", false);
+  F->createSave("save", F->createPow("Pow", X, 2.0), out);
+  CompilationContext cctx;
+  EXIT_ON_ERR(HM->addNetwork(std::move(module), cctx));
+  EXPECT_TRUE(ERR_TO_BOOL(HM->enableResultCache("other", {})));
+  EXIT_ON_ERR(HM->enableResultCache("main", {}));
+  EXPECT_TRUE(ERR_TO_BOOL(HM->enableResultCache("main", {})));
+
+  // The second run is served from the cache, the third has other inputs.
+  for (float x : {2, 2, 3}) {
+    PlaceholderBindings bindings;
+    bindings.allocate(X)->getHandle().clear(x);
+    auto *result = bindings.allocate(out);
+    result->zero();
+    EXIT_ON_ERR(HM->runNetworkBlocking("main", bindings));
+    EXPECT_EQ(result->getHandle().at({2}), x * x);
+  }
+  EXPECT_EQ(MockStats.counters["glow.result_cache.hits"], 1);
+  EXPECT_EQ(MockStats.counters["glow.result_cache.misses"], 2);
+  EXPECT_EQ(MockStats.counters["glow.result_cache.main.hit_rate_pct"], 33);
+}
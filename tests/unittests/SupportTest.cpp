@@ -14,10 +14,16 @@
  * limitations under the License.
  */
 
+#include "glow/Support/Memory.h"
+#include "glow/Support/ObjectPool.h"
 #include "glow/Support/Support.h"
 #include "glow/Testing/StrCheck.h"
 #include "gtest/gtest.h"
 
+#include <cstring>
+#include <thread>
+#include <vector>
+
 #ifndef GLOW_DATA_PATH
 #define GLOW_DATA_PATH
 #endif
@@ -93,3 +99,64 @@ TEST(Support, loadStrStrMapYamlFile) {
   EXPECT_EQ(map["backendOption1"], "foo");
   EXPECT_EQ(map["backendOption2"], "bar");
 }
+
+/// Check that the blocks of the object pool are aligned, usable, and reused
+/// once freed, including large blocks and blocks freed by other threads.
+TEST(Support, objectPool) {
+  std::vector<void *> blocks;
+  for (size_t size : {1, 16, 17, 100, 1024, 1025, 10000}) {
+    void *ptr = ObjectPool::allocate(size);
+    EXPECT_EQ((uintptr_t)ptr % alignof(std::max_align_t), 0);
+    memset(ptr, 0xff, size);
+    blocks.push_back(ptr);
+  }
+  for (auto *ptr : blocks) {
+    ObjectPool::deallocate(ptr);
+  }
+
+  // The last freed block of a size is the next one allocated.
+  void *first = ObjectPool::allocate(200);
+  ObjectPool::deallocate(first);
+  void *second = ObjectPool::allocate(200);
+  EXPECT_EQ(first, second);
+
+  // Blocks freed by threads that exited are reused without new slabs.
+  constexpr size_t numBlocks = 10000;
+  std::vector<void *> shared(numBlocks);
+  for (auto &ptr : shared) {
+    ptr = ObjectPool::allocate(64);
+  }
+  size_t numSlabs = ObjectPool::getNumSlabs();
+  std::thread([&shared]() {
+    for (auto *ptr : shared) {
+      ObjectPool::deallocate(ptr);
+    }
+  }).join();
+  for (auto &ptr : shared) {
+    ptr = ObjectPool::allocate(64);
+  }
+  EXPECT_EQ(ObjectPool::getNumSlabs(), numSlabs);
+  for (auto *ptr : shared) {
+    ObjectPool::deallocate(ptr);
+  }
+  ObjectPool::deallocate(second);
+}
+
+/// Test that the memory of hugePagesAlloc is usable whatever pages back it,
+/// falling back when the hugetlbfs pool has no pages.
+TEST(Support, hugePagesAlloc) {
+  constexpr size_t size = 3 * HugePageSize + 1;
+  for (auto requested : {HugePages::None, HugePages::Transparent,
+                         HugePages::HugeTLB2MB, HugePages::HugeTLB1GB}) {
+    HugePages pages = requested;
+    auto *ptr = static_cast<char *>(hugePagesAlloc(size, pages));
+    ASSERT_NE(ptr, nullptr);
+    EXPECT_EQ(reinterpret_cast<size_t>(ptr) % TensorAlignment, 0);
+    if (requested == HugePages::None || requested == HugePages::Transparent) {
+      EXPECT_EQ(pages, requested);
+    }
+    memset(ptr, 1, size);
+    EXPECT_EQ(ptr[size - 1], 1);
+    hugePagesFree(ptr, size, pages);
+  }
+}
@@ -20,6 +20,8 @@
 
 #include "llvm/ADT/STLExtras.h"
 
+#include <algorithm>
+#include <cstring>
 #include <future>
 #include <vector>
 
@@ -289,3 +291,161 @@ TEST(TensorPool, Clear) {
   EXPECT_EQ(stats2.totalReclaims, 2);
   EXPECT_EQ(stats2.totalFrees, 1);
 }
+
+/// Size classes cover every size with at most a quarter of waste.
+TEST(TensorPool, SizeClasses) {
+  for (uint64_t bytes = 1; bytes < 4096; bytes++) {
+    size_t sizeClass = TensorPool::getSizeClass(bytes);
+    uint64_t classBytes = TensorPool::getSizeClassBytes(sizeClass);
+    EXPECT_GE(classBytes, bytes);
+    EXPECT_LE(classBytes, bytes + bytes / 4 + 1);
+    if (sizeClass > 0) {
+      EXPECT_LT(TensorPool::getSizeClassBytes(sizeClass - 1), bytes);
+    }
+  }
+  EXPECT_LT(TensorPool::getSizeClass(~uint64_t(0)),
+            TensorPool::kNumSizeClasses);
+}
+
+/// A buffer is reused by another Type of the same size class.
+TEST(TensorPool, ReuseAcrossTypes) {
+  TensorPool pool;
+  Type ty(ElemKind::FloatTy, {2, 3});
+  Type ty2(ElemKind::Int32ITy, {3, 2});
+  Type ty3(ElemKind::Int8QTy, {6, 4}, 1.0, 0);
+
+  Tensor *T = pool.get(&ty);
+  auto *backingPtr = T->getUnsafePtr();
+  pool.reclaim(T);
+
+  for (auto *reuseTy : {&ty2, &ty3}) {
+    T = pool.get(reuseTy);
+    EXPECT_TRUE(T->getType().isEqual(*reuseTy));
+    EXPECT_EQ(T->getUnsafePtr(), backingPtr);
+    pool.reclaim(T);
+  }
+
+  const auto &stats = pool.getStats();
+  EXPECT_EQ(stats.totalTypes, 1);
+  EXPECT_EQ(stats.currentBuffers, 1);
+  EXPECT_EQ(stats.totalAllocs, 1);
+  EXPECT_EQ(stats.totalGets, 3);
+  EXPECT_EQ(stats.threadCacheGets, 2);
+}
+
+/// Tensors reclaimed on other threads are served by the shared lists once
+/// the caches of these threads are full.
+TEST(TensorPool, ConcurrentGetAndReclaim) {
+  TensorPool pool;
+  Type ty(ElemKind::FloatTy, {16});
+  constexpr size_t numThreads = 4;
+  constexpr size_t numTensors = 64;
+
+  std::vector<Tensor *> tensors;
+  for (size_t i = 0; i < numThreads * numTensors; i++) {
+    tensors.push_back(pool.get(&ty));
+  }
+
+  std::vector<std::future<void>> futures;
+  for (size_t i = 0; i < numThreads; i++) {
+    futures.push_back(std::async(std::launch::async, [&, i]() {
+      for (size_t j = 0; j < numTensors; j++) {
+        pool.reclaim(tensors[i * numTensors + j]);
+      }
+      for (size_t j = 0; j < numTensors; j++) {
+        tensors[i * numTensors + j] = pool.get(&ty);
+      }
+    }));
+  }
+  for (auto &future : futures) {
+    future.get();
+  }
+
+  const auto &stats = pool.getStats();
+  EXPECT_EQ(stats.totalAllocs, numThreads * numTensors);
+  EXPECT_EQ(stats.currentBuffers, 0);
+  EXPECT_EQ(stats.threadCacheGets + stats.sharedListGets,
+            numThreads * numTensors);
+  EXPECT_EQ(stats.sharedListReclaims,
+            numThreads * (numTensors - TensorPool::kThreadCacheSize));
+
+  for (auto *T : tensors) {
+    pool.reclaim(T);
+  }
+}
+
+/// Allocates at most two buffers of host memory.
+class TestHostMemoryAllocator final : public HostMemoryAllocator {
+public:
+  std::vector<void *> buffers;
+
+  void *allocate(size_t bytes) override {
+    if (buffers.size() == 2) {
+      return nullptr;
+    }
+    buffers.push_back(alignedAlloc(bytes, TensorAlignment));
+    return buffers.back();
+  }
+
+  void deallocate(void *data, size_t bytes) override {
+    auto it = std::find(buffers.begin(), buffers.end(), data);
+    ASSERT_NE(it, buffers.end());
+    buffers.erase(it);
+    alignedFree(data);
+  }
+
+  bool contains(const void *data, size_t bytes) const override {
+    return std::find(buffers.begin(), buffers.end(), data) != buffers.end();
+  }
+};
+
+/// Test that the buffers of a pool come from its host memory allocator, and
+/// from pageable memory once the allocator has no more memory.
+TEST(TensorPool, HostMemory) {
+  TestHostMemoryAllocator hostMemory;
+  {
+    TensorPool pool(/* preventAllocs */ false, &hostMemory);
+    Type ty(ElemKind::FloatTy, {100});
+    std::vector<Tensor *> tensors;
+    for (size_t i = 0; i < 3; i++) {
+      tensors.push_back(pool.get(&ty));
+      tensors.back()->getHandle().clear(i);
+    }
+    EXPECT_TRUE(hostMemory.contains(tensors[0]->getUnsafePtr(), 400));
+    EXPECT_TRUE(hostMemory.contains(tensors[1]->getUnsafePtr(), 400));
+    EXPECT_FALSE(hostMemory.contains(tensors[2]->getUnsafePtr(), 400));
+    EXPECT_EQ(pool.getStats().hostMemoryFallbacks, 1);
+    EXPECT_EQ(tensors[1]->getHandle().at({99}), 1);
+
+    for (auto *T : tensors) {
+      pool.reclaim(T);
+    }
+    // The buffers are reused like any other.
+    Tensor *T = pool.get(&ty);
+    EXPECT_EQ(pool.getStats().totalAllocs, 3);
+    pool.reclaim(T);
+  }
+  // The buffers are given back once the pool is cleared.
+  EXPECT_TRUE(hostMemory.buffers.empty());
+}
+
+/// Test that page-locked buffers are tracked until they are freed, or that
+/// nothing is allocated if the host can't lock memory.
+TEST(TensorPool, PageLockedAllocator) {
+  PageLockedAllocator allocator;
+  void *data = allocator.allocate(100);
+  if (!data) {
+    EXPECT_EQ(allocator.getLockedBytes(), 0);
+    return;
+  }
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(data) % TensorAlignment, 0);
+  EXPECT_GE(allocator.getLockedBytes(), 100);
+  EXPECT_TRUE(allocator.contains(data, 100));
+  EXPECT_TRUE(allocator.contains(static_cast<char *>(data) + 50, 50));
+  int onStack;
+  EXPECT_FALSE(allocator.contains(&onStack, sizeof(onStack)));
+  memset(data, 1, 100);
+  allocator.deallocate(data, 100);
+  EXPECT_FALSE(allocator.contains(data, 100));
+  EXPECT_EQ(allocator.getLockedBytes(), 0);
+}
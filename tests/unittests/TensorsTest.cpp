@@ -396,6 +396,31 @@ TEST(Tensor, convertToType) {
   EXPECT_TRUE(B.isEqual(A, 0.001));
 }
 
+/// Check that the bulk conversions of large tensors, split over threads and
+/// vectors, round every element like the conversion of a single float16_t.
+TEST(Tensor, convertLargeToType) {
+  PseudoRNG PRNG;
+  // Large enough to be converted on several threads, with a tail of elements
+  // that don't fill a vector.
+  Tensor A(ElemKind::FloatTy, {(1 << 20) + 13});
+  auto AH = A.getHandle<>();
+  AH.randomize(-70000.0, 70000.0, PRNG);
+  AH.raw(3) = 1e-7;
+  AH.raw(5) = -0.0;
+
+  Tensor B = A.getCopyConvertedToType(ElemKind::Float16Ty);
+  auto BH = B.getHandle<float16_t>();
+  for (size_t idx = 0, end = A.size(); idx != end; ++idx) {
+    ASSERT_EQ(float(BH.raw(idx)), float(float16_t(AH.raw(idx))));
+  }
+
+  Tensor C = B.getCopyConvertedToType(ElemKind::FloatTy);
+  auto CH = C.getHandle<>();
+  for (size_t idx = 0, end = A.size(); idx != end; ++idx) {
+    ASSERT_EQ(CH.raw(idx), float(BH.raw(idx)));
+  }
+}
+
 TEST(Tensor, reset) {
   Tensor A(ElemKind::FloatTy, {2, 3});
   Tensor QA(ElemKind::Int8QTy, {3, 4}, 2.2, 7);
@@ -468,6 +493,31 @@ TEST(Tensor, transpose2) {
   }
 }
 
+/// Check transposes of 6 dimensions into a destination with padded rows.
+TEST(Tensor, transposePadded) {
+  PseudoRNG PRNG;
+  Tensor X(ElemKind::FloatTy, {4, 3, 1, 5, 2, 7});
+  auto H = X.getHandle<>();
+  H.randomize(-2.0, 2.0, PRNG);
+
+  const std::vector<unsigned_t> shuffle = {5, 0, 3, 2, 4, 1};
+  Tensor Xhat(Type(ElemKind::FloatTy, {7, 4, 5, 1, 2, 3}, {1, 1, 1, 1, 32, 1}));
+  ASSERT_GT(Xhat.getType().getSizeInBytes(),
+            Xhat.size() * Xhat.getType().getElementSize());
+  X.transpose(&Xhat, shuffle);
+
+  auto XhatH = Xhat.getHandle<>();
+  std::vector<size_t> src(6);
+  std::vector<size_t> dest(6);
+  for (size_t i = 0, e = XhatH.size(); i < e; i++) {
+    for (size_t d = 0; d < 6; d++) {
+      dest[d] = XhatH.getDimForPtr(d, i);
+      src[shuffle[d]] = dest[d];
+    }
+    EXPECT_EQ(H.at(src), XhatH.at(dest));
+  }
+}
+
 TEST(Tensor, nonOwnedTensor) {
   Tensor T1 = {1.2f, 12.1f, 51.0f, 1515.2f};
 
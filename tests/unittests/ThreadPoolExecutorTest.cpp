@@ -16,6 +16,7 @@
 
 #include "glow/Runtime/Executor/ThreadPoolExecutor.h"
 #include "glow/Backends/DeviceManager.h"
+#include "glow/Runtime/Executor/CriticalPath.h"
 #include "glow/Support/Support.h"
 #include "glow/Support/ThreadPool.h"
 
@@ -70,17 +71,22 @@ public:
                      std::unique_ptr<ExecutionContext> context,
                      ResultCBTy resultCB) {
 
+    if (delay_.count()) {
+      std::this_thread::sleep_for(delay_);
+    }
+
     RunIdentifierTy runId = 0;
     bool successResult = false;
 
-    // Retrieve the registered response for the function if there is one.
-    if (context && resultCB && resultMap_.count(functionName)) {
-      std::unique_ptr<RunFunctionResult> registeredResult =
-          std::move(resultMap_[functionName]);
+    // Retrieve the registered response for the function if there is one. It
+    // is kept so that the function can be run again.
+    auto resultIt = resultMap_.find(functionName);
+    if (context && resultCB && resultIt != resultMap_.end()) {
+      const RunFunctionResult *registeredResult = resultIt->second.get();
 
       // Check that context contains the expected Placeholder-Tensor mappings.
-      std::unique_ptr<ExecutionContext> inputContext =
-          std::move(registeredResult->inputContext);
+      const ExecutionContext *inputContext =
+          registeredResult->inputContext.get();
 
       bool equalInputs = true;
       for (auto &p : inputContext->getPlaceholderBindings()->pairs()) {
@@ -118,6 +124,10 @@ public:
   runFunction(std::string functionName,
               std::unique_ptr<ExecutionContext> context,
               ResultCBTy resultCB) override {
+    if (context->getDeviceBindings()) {
+      numPreparedRuns_++;
+    }
+    lastContext_ = context.get();
     // Give the call to the thread pool to process to make the tests
     // multithreaded if needed.
     this->threadPool_.submit(
@@ -127,6 +137,53 @@ public:
     return 0;
   }
 
+  /// Marks the inputs of \p context as staged with device bindings.
+  Error prepareInputs(const std::string &functionName,
+                      ExecutionContext &context) override {
+    EXPECT_FALSE(context.getDeviceBindings());
+    context.setDeviceBindings(llvm::make_unique<DeviceBindings>("Test"));
+    numPrepared_++;
+    return Error::success();
+  }
+
+  void releaseInputs(const std::string &functionName,
+                     ExecutionContext &context) override {
+    EXPECT_TRUE(context.getDeviceBindings());
+    context.setDeviceBindings(nullptr);
+    numReleased_++;
+  }
+
+  /// Make the next runs take at least \p delay.
+  void setDelay(std::chrono::milliseconds delay) { delay_ = delay; }
+
+  /// Register the result registered with \p other for \p functionName, so
+  /// that this device can run the function too.
+  void copyResult(const std::string &functionName,
+                  const TestDeviceManager &other) {
+    const auto &result = other.resultMap_.at(functionName);
+    auto cloneContext = [](const ExecutionContext &context) {
+      return llvm::make_unique<ExecutionContext>(
+          llvm::make_unique<PlaceholderBindings>(
+              context.getPlaceholderBindings()->clone()));
+    };
+    registerResult(functionName, result->runId, result->success,
+                   cloneContext(*result->inputContext),
+                   cloneContext(*result->resultContext));
+  }
+
+  /// \returns the number of calls to prepareInputs().
+  unsigned getNumPrepared() const { return numPrepared_; }
+
+  /// \returns the number of runs given to runFunction() whose inputs were
+  /// prepared.
+  unsigned getNumPreparedRuns() const { return numPreparedRuns_; }
+
+  /// \returns the number of calls to releaseInputs().
+  unsigned getNumReleased() const { return numReleased_; }
+
+  /// \returns the context of the last call to runFunction().
+  const ExecutionContext *getLastContext() const { return lastContext_; }
+
   uint64_t getMaximumMemory() const override {
     return std::numeric_limits<uint64_t>::max();
   }
@@ -137,7 +194,7 @@ public:
 
   bool isMemoryAvailable(uint64_t /*estimate*/) const override { return true; }
 
-  /// Register a result that should be returned by the subsequent call to
+  /// Register a result that should be returned by the subsequent calls to
   /// runFunction with the same \p functionName. The callback for that call
   /// to runFunction will be called with \p runId, \p success, and \p
   /// \p resultContext if the context passed in to runFunction
@@ -192,6 +249,14 @@ private:
 
   /// Map for storing registered results.
   TestDeviceManagerResultMapTy resultMap_;
+  /// Counters of the inputs prepared, run and released.
+  std::atomic<unsigned> numPrepared_{0};
+  std::atomic<unsigned> numPreparedRuns_{0};
+  std::atomic<unsigned> numReleased_{0};
+  /// The context of the last run.
+  std::atomic<const ExecutionContext *> lastContext_{nullptr};
+  /// The time every run takes at least.
+  std::chrono::milliseconds delay_{0};
   /// Thread pool for executing runFunction() in a multithreaded fashion.
   ThreadPool threadPool_;
 };
@@ -219,15 +284,29 @@ public:
         placeholders_(std::move(placeholders)),
         inputContext_(std::move(inputContext)),
         outputContext_(std::move(outputContext)), runId_(runId),
-        expectSuccess_(expectSuccess), testRun_(false) {
+        expectSuccess_(expectSuccess) {
     root_->module = module_.get();
   }
 
-  /// Run the test.
-  bool run() {
-    if (testRun_) {
-      assert(!"Test has already been run!");
+  ExecutorTest(ExecutorTest &&) = default;
+
+  ~ExecutorTest() {
+    // The Executor may keep state for the DAG until it is told that the DAG
+    // is gone.
+    if (root_) {
+      executor_->removeDAG(root_.get());
     }
+  }
+
+  /// \returns the root of the DAG of the test.
+  const DAGNode *getRoot() const { return root_.get(); }
+
+  /// Run the test. The test can be run more than once, and concurrently.
+  /// The context given to Executor::run() is returned in \p runContext if it
+  /// isn't null. The run is traced at the RUNTIME level if \p traceEvents
+  /// isn't null, which then gets the events of the run.
+  bool run(const ExecutionContext **runContext = nullptr,
+           std::vector<TraceEvent> *traceEvents = nullptr) {
 
     // Variables for storing runId actually returned by
     // Executor::run() via its callback.
@@ -237,7 +316,17 @@ public:
     // Call Executor::run().
     std::promise<bool> promise;
     std::future<bool> future = promise.get_future();
-    executor_->run(root_.get(), std::move(inputContext_), runId_,
+    auto context = llvm::make_unique<ExecutionContext>(
+        llvm::make_unique<PlaceholderBindings>(
+            inputContext_->getPlaceholderBindings()->clone()));
+    if (runContext) {
+      *runContext = context.get();
+    }
+    if (traceEvents) {
+      context->setTraceContext(
+          llvm::make_unique<TraceContext>(TraceLevel::RUNTIME));
+    }
+    executor_->run(root_.get(), std::move(context), runId_,
                    [&promise, &executorRunId, &executorOutputContext](
                        RunIdentifierTy runId, Error err,
                        std::unique_ptr<ExecutionContext> context) {
@@ -247,6 +336,10 @@ public:
                    });
 
     bool runSuccess = !future.get();
+    if (traceEvents) {
+      auto &events = executorOutputContext->getTraceContext()->getTraceEvents();
+      traceEvents->insert(traceEvents->end(), events.begin(), events.end());
+    }
 
     // Check that the values returned in the Executor callback match
     // expectations.
@@ -261,8 +354,6 @@ public:
     bool testPassed =
         runIdsMatch && resultsMatch && (!runSuccess || bindingsMatch);
 
-    testRun_ = true;
-
     return testPassed;
   }
 
@@ -289,8 +380,6 @@ private:
   RunIdentifierTy runId_;
   /// The expected result that the Executor should return.
   bool expectSuccess_;
-  /// Tracks whether or not the test has already been run.
-  bool testRun_;
 };
 
 /// This class helps build tests for testing Executor implementations. It
@@ -440,6 +529,39 @@ public:
     leaves_.insert(newNodeRawPtr);
   }
 
+  /// Add \p deviceId to the devices that can run the node named \p name,
+  /// without registering a result for the node with it, so that the runs of
+  /// the node on it fail.
+  void addNodeDevice(const std::string &name, DeviceIDTy deviceId) {
+    auto it = nodes_.find(name);
+    assert(it != nodes_.end() && "Node not found!");
+    it->second->deviceIDs.push_back(deviceId);
+  }
+
+  /// Predicate the node named \p name with its first input. If \p on is
+  /// false, the first element of the input is zeroed, and the node is
+  /// expected to be skipped and its outputs to be zeros. Otherwise the random
+  /// input is left as is and must not be zero. Must be called before the
+  /// children of the node are added.
+  void predicateNode(const std::string &name, bool on) {
+    auto it = nodes_.find(name);
+    assert(it != nodes_.end() && "Node not found!");
+    DAGNode *node = it->second.get();
+    for (const auto &symbol : node->runtimeBundle->getSymbolTable()) {
+      Tensor *tensor =
+          bindings_->get(bindings_->getPlaceholderByName(symbol.first));
+      if (symbol.second.input && node->predicate.empty()) {
+        node->predicate = symbol.first;
+        if (!on) {
+          tensor->getHandle<float>().raw(0) = 0;
+        }
+        assert(on == (tensor->getHandle<float>().raw(0) != 0));
+      } else if (symbol.second.output && !on) {
+        tensor->zero();
+      }
+    }
+  }
+
   /// Emit the test built so far and clear any state in the builder.
   ExecutorTest emitTest() {
     // Get the input and output symbol names for the whole DAG.
@@ -691,6 +813,30 @@ TEST_F(ThreadPoolExecutorTest, SingleNode) {
   EXPECT_TRUE(test.run());
 }
 
+/// Tests that the runs of a single node DAG binding exactly the placeholders
+/// of the node are handed to the device as they are.
+TEST_F(ThreadPoolExecutorTest, SingleNodeDirect) {
+  constexpr RunIdentifierTy testRunId = 10;
+  constexpr DeviceIDTy testDeviceId = 111;
+  constexpr unsigned deviceManagerThreads = 1;
+
+  auto deviceManager = llvm::make_unique<TestDeviceManager>(
+      deviceManagerThreads, DeviceConfig("Interpreter"));
+  auto *device = deviceManager.get();
+  deviceManagerMap_.emplace(testDeviceId, std::move(deviceManager));
+
+  testBuilder_.addNode("net", testDeviceId,
+                       /*parents=*/{}, {"netInput"}, {"netOutput"}, testRunId,
+                       true);
+
+  ExecutorTest test = testBuilder_.emitTest();
+  for (unsigned i = 0; i < 3; ++i) {
+    const ExecutionContext *context = nullptr;
+    EXPECT_TRUE(test.run(&context));
+    EXPECT_EQ(device->getLastContext(), context);
+  }
+}
+
 /// Tests that several instances of a single node DAG can be run in parallel.
 TEST_F(ThreadPoolExecutorTest, ConcurrentSingleNode) {
   constexpr RunIdentifierTy baseTestRunId = 10;
@@ -883,6 +1029,414 @@ TEST_F(ThreadPoolExecutorTest, MultiNode) {
   EXPECT_TRUE(test.run());
 }
 
+/// Tests that the traced runs of a DAG give the critical path analyzer the
+/// timelines of all their nodes.
+TEST_F(ThreadPoolExecutorTest, CriticalPathOfTracedRuns) {
+  constexpr RunIdentifierTy testRunId = 10;
+  constexpr DeviceIDTy testDeviceId = 111;
+  constexpr unsigned deviceManagerThreads = 3;
+  constexpr unsigned numRuns = 3;
+
+  auto deviceManager = llvm::make_unique<TestDeviceManager>(
+      deviceManagerThreads, DeviceConfig("Interpreter"));
+  deviceManagerMap_.emplace(testDeviceId, std::move(deviceManager));
+
+  testBuilder_.addNode("alpha", testDeviceId,
+                       /*parents=*/{}, /*inputs=*/{"alphaIn"},
+                       /*outputs=*/{"alphaOut"}, testRunId, true);
+  testBuilder_.addNode("beta", testDeviceId,
+                       /*parents=*/{}, /*inputs=*/{"betaIn"},
+                       /*outputs=*/{"betaOut"}, testRunId, true);
+  testBuilder_.addNode("gamma", testDeviceId,
+                       /*parents=*/{"alpha", "beta"},
+                       /*inputs=*/{"alphaOut", "betaOut"},
+                       /*outputs=*/{"gammaOut"}, testRunId, true);
+
+  ExecutorTest test = testBuilder_.emitTest();
+  CriticalPathAnalyzer analyzer(test.getRoot());
+  for (unsigned i = 0; i < numRuns; ++i) {
+    std::vector<TraceEvent> events;
+    EXPECT_TRUE(test.run(nullptr, &events));
+    EXPECT_EQ(analyzer.addTraceEvents(events), 1);
+  }
+
+  auto report = analyzer.analyze();
+  EXPECT_EQ(report.numRuns, numRuns);
+  ASSERT_EQ(report.nodes.size(), 3);
+  size_t numCritical = 0;
+  for (const auto &node : report.nodes) {
+    if (node.node->name == "gamma") {
+      EXPECT_EQ(node.numCritical, numRuns);
+      EXPECT_EQ(node.meanSlack, 0);
+    } else {
+      numCritical += node.numCritical;
+    }
+  }
+  EXPECT_EQ(numCritical, numRuns);
+}
+
+/// Tests the critical paths, the slack and the stages of the nodes that the
+/// analyzer finds in the trace events of the runs of a DAG.
+TEST(CriticalPathAnalyzer, Diamond) {
+  // The DAG below is run twice: b bounds the first run and c the second.
+  /**
+   *         root
+   *          |
+   *          a
+   *        /   \
+   *       b     c
+   *        \   /
+   *          d
+   **/
+  DAGNode root;
+  std::vector<std::unique_ptr<DAGNode>> nodes;
+  auto addNode = [&](llvm::StringRef name,
+                     std::vector<DAGNode *> parents) -> DAGNode * {
+    nodes.push_back(llvm::make_unique<DAGNode>());
+    DAGNode *node = nodes.back().get();
+    node->name = name;
+    if (parents.empty()) {
+      parents.push_back(&root);
+    }
+    for (auto *parent : parents) {
+      node->parents.push_back(parent);
+      parent->children.push_back(node);
+    }
+    return node;
+  };
+  DAGNode *a = addNode("a", {});
+  DAGNode *b = addNode("b", {a});
+  DAGNode *c = addNode("c", {a});
+  addNode("d", {b, c});
+
+  std::vector<TraceEvent> events;
+  auto addEvent = [&](llvm::StringRef run, llvm::StringRef node,
+                      uint64_t ready, uint64_t dispatch, uint64_t done,
+                      uint64_t deviceBegin = 0, uint64_t deviceEnd = 0) {
+    std::map<std::string, std::string> args;
+    args[CriticalPathAnalyzer::kRunArg] = run;
+    args[CriticalPathAnalyzer::kNodeArg] = node;
+    args[CriticalPathAnalyzer::kDispatchArg] = std::to_string(dispatch);
+    if (deviceEnd) {
+      args[CriticalPathAnalyzer::kDeviceBeginArg] =
+          std::to_string(deviceBegin);
+      args[CriticalPathAnalyzer::kDeviceEndArg] = std::to_string(deviceEnd);
+    }
+    events.emplace_back(node, ready, done - ready, 0, args);
+  };
+  addEvent("1", "a", 1000, 1000, 1110, 1010, 1100);
+  addEvent("1", "b", 1110, 1110, 1400);
+  addEvent("1", "c", 1110, 1150, 1200);
+  addEvent("1", "d", 1400, 1400, 1500);
+  addEvent("2", "a", 11000, 11000, 11110, 11010, 11100);
+  addEvent("2", "b", 11110, 11110, 11400);
+  addEvent("2", "c", 11110, 11150, 11500);
+  addEvent("2", "d", 11500, 11500, 11600);
+  // A run that failed after its first node, and another event.
+  addEvent("3", "a", 21000, 21000, 21110);
+  events.emplace_back("ThreadPoolExecutor::run", uint64_t(1000),
+                      uint64_t(600), 0);
+
+  CriticalPathAnalyzer analyzer(&root);
+  EXPECT_EQ(analyzer.addTraceEvents(events), 2);
+  auto report = analyzer.analyze();
+  EXPECT_EQ(report.numRuns, 2);
+  EXPECT_EQ(report.meanLatency, 550);
+
+  // The nodes are ordered by the time the critical paths spent in them.
+  ASSERT_EQ(report.nodes.size(), 4);
+  EXPECT_EQ(report.nodes[0].node, c);
+  EXPECT_EQ(report.nodes[0].numCritical, 1);
+  EXPECT_EQ(report.nodes[0].criticalTime, 390);
+  EXPECT_EQ(report.nodes[0].meanSlack, 100);
+  EXPECT_EQ(report.nodes[0].meanQueue, 40);
+  EXPECT_EQ(report.nodes[1].node, b);
+  EXPECT_EQ(report.nodes[1].criticalTime, 290);
+  EXPECT_EQ(report.nodes[1].meanSlack, 50);
+  EXPECT_EQ(report.nodes[2].node, a);
+  EXPECT_EQ(report.nodes[2].numCritical, 2);
+  EXPECT_EQ(report.nodes[2].meanSlack, 0);
+  EXPECT_EQ(report.nodes[2].meanTransfer, 20);
+  EXPECT_EQ(report.nodes[2].meanCompute, 90);
+  EXPECT_EQ(report.nodes[3].node->name, "d");
+  EXPECT_EQ(report.nodes[3].numCritical, 2);
+
+  EXPECT_NE(report.toString().find("Optimize c first"), std::string::npos);
+}
+
+/// Tests that the nodes whose predicate is off are skipped, and that their
+/// children run with zeros for their outputs.
+TEST_F(ThreadPoolExecutorTest, PredicatedNodes) {
+  constexpr RunIdentifierTy testRunId = 10;
+  constexpr DeviceIDTy testDeviceId = 111;
+  constexpr unsigned deviceManagerThreads = 3;
+
+  auto deviceManager = llvm::make_unique<TestDeviceManager>(
+      deviceManagerThreads, DeviceConfig("Interpreter"));
+  deviceManagerMap_.emplace(testDeviceId, std::move(deviceManager));
+
+  testBuilder_.addNode("alpha", testDeviceId,
+                       /*parents=*/{}, /*inputs=*/{"alphaIn"},
+                       /*outputs=*/{"alphaOut"}, testRunId, true);
+  testBuilder_.predicateNode("alpha", /* on */ false);
+  testBuilder_.addNode("beta", testDeviceId,
+                       /*parents=*/{}, /*inputs=*/{"betaIn"},
+                       /*outputs=*/{"betaOut"}, testRunId, true);
+  testBuilder_.predicateNode("beta", /* on */ true);
+  testBuilder_.addNode("gamma", testDeviceId,
+                       /*parents=*/{"alpha", "beta"},
+                       /*inputs=*/{"alphaOut", "betaOut"},
+                       /*outputs=*/{"gammaOut"}, testRunId, true);
+
+  ExecutorTest test = testBuilder_.emitTest();
+  EXPECT_TRUE(test.run());
+  EXPECT_TRUE(test.run());
+}
+
+/// Tests that a DAG can be run repeatedly and concurrently, which reuses the
+/// ExecutionStates and the intermediate tensors of earlier runs.
+TEST_F(ThreadPoolExecutorTest, MultiNodeRepeatedRuns) {
+  constexpr RunIdentifierTy testRunId = 10;
+  constexpr DeviceIDTy testDeviceId = 111;
+  constexpr unsigned deviceManagerThreads = 3;
+  constexpr unsigned numThreads = 4;
+  constexpr unsigned numRuns = 10;
+
+  auto deviceManager = llvm::make_unique<TestDeviceManager>(
+      deviceManagerThreads, DeviceConfig("Interpreter"));
+  deviceManagerMap_.emplace(testDeviceId, std::move(deviceManager));
+
+  // Build the DAG. The DAG created below looks like this:
+  /**
+   *         root
+   *          |
+   *          v
+   *        alpha
+   *          |
+   *          v
+   *         beta
+   **/
+
+  testBuilder_.addNode("alpha", testDeviceId,
+                       /*parents=*/{}, /*inputs=*/{"alphaIn"},
+                       /*outputs=*/{"alphaOut"}, testRunId, true);
+  testBuilder_.addNode("beta", testDeviceId,
+                       /*parents=*/{"alpha"}, /*inputs=*/{"alphaOut"},
+                       /*outputs=*/{"betaOut"}, testRunId, true);
+
+  ExecutorTest test = testBuilder_.emitTest();
+  for (unsigned i = 0; i < numRuns; ++i) {
+    EXPECT_TRUE(test.run());
+  }
+
+  std::atomic<unsigned> testsPassed{0};
+  std::vector<std::thread> threads;
+  for (unsigned i = 0; i < numThreads; ++i) {
+    threads.emplace_back([&test, &testsPassed]() {
+      for (unsigned j = 0; j < numRuns; ++j) {
+        if (test.run()) {
+          testsPassed++;
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(testsPassed, numThreads * numRuns);
+}
+
+/// Tests that concurrent runs of a DAG whose nodes are pipelined across
+/// devices run correctly.
+TEST_F(ThreadPoolExecutorTest, PipelinedMultiNode) {
+  constexpr RunIdentifierTy testRunId = 10;
+  constexpr DeviceIDTy testDeviceIdA = 111;
+  constexpr DeviceIDTy testDeviceIdB = 112;
+  constexpr unsigned deviceManagerThreads = 3;
+  constexpr unsigned executorThreads = 3;
+  constexpr unsigned pipelineDepth = 1;
+  constexpr unsigned numThreads = 4;
+  constexpr unsigned numRuns = 10;
+
+  auto deviceManagerA = llvm::make_unique<TestDeviceManager>(
+      deviceManagerThreads, DeviceConfig("Interpreter"));
+  auto deviceManagerB = llvm::make_unique<TestDeviceManager>(
+      deviceManagerThreads, DeviceConfig("Interpreter"));
+  deviceManagerMap_.emplace(testDeviceIdA, std::move(deviceManagerA));
+  deviceManagerMap_.emplace(testDeviceIdB, std::move(deviceManagerB));
+
+  auto executor = std::make_shared<ThreadPoolExecutor>(
+      deviceManagerMap_, executorThreads, pipelineDepth);
+  ExecutorTestBuilder testBuilder(executor, deviceManagerMap_);
+
+  // Build the DAG. The DAG created below looks like this:
+  /**
+   *           root
+   *         /      \
+   *        v       v
+   *      alpha    beta
+   *        \       /
+   *         v     v
+   *          gamma
+   **/
+
+  testBuilder.addNode("alpha", testDeviceIdA,
+                      /*parents=*/{}, /*inputs=*/{"alphaIn"},
+                      /*outputs=*/{"alphaOut"}, testRunId, true);
+  testBuilder.addNode("beta", testDeviceIdB,
+                      /*parents=*/{}, /*inputs=*/{"betaIn"},
+                      /*outputs=*/{"betaOut"}, testRunId, true);
+  testBuilder.addNode("gamma", testDeviceIdA,
+                      /*parents=*/{"alpha", "beta"},
+                      /*inputs=*/{"alphaOut", "betaOut"},
+                      /*outputs=*/{"gammaOut"}, testRunId, true);
+
+  ExecutorTest test = testBuilder.emitTest();
+  std::atomic<unsigned> testsPassed{0};
+  std::vector<std::thread> threads;
+  for (unsigned i = 0; i < numThreads; ++i) {
+    threads.emplace_back([&test, &testsPassed]() {
+      for (unsigned j = 0; j < numRuns; ++j) {
+        if (test.run()) {
+          testsPassed++;
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(testsPassed, numThreads * numRuns);
+}
+
+/// Tests that the runs of a pipelined DAG that wait for their stage have
+/// their inputs prepared on the device that then runs them.
+TEST_F(ThreadPoolExecutorTest, PipelinedPreparedInputs) {
+  constexpr RunIdentifierTy testRunId = 10;
+  constexpr DeviceIDTy testDeviceId = 111;
+  constexpr unsigned deviceManagerThreads = 1;
+  constexpr unsigned executorThreads = 3;
+  constexpr unsigned pipelineDepth = 1;
+  constexpr unsigned numThreads = 4;
+  constexpr unsigned numRuns = 10;
+
+  auto deviceManager = llvm::make_unique<TestDeviceManager>(
+      deviceManagerThreads, DeviceConfig("Interpreter"));
+  auto *device = deviceManager.get();
+  deviceManagerMap_.emplace(testDeviceId, std::move(deviceManager));
+
+  auto executor = std::make_shared<ThreadPoolExecutor>(
+      deviceManagerMap_, executorThreads, pipelineDepth);
+  ExecutorTestBuilder testBuilder(executor, deviceManagerMap_);
+  testBuilder.addNode("net", testDeviceId,
+                      /*parents=*/{}, {"netInput"}, {"netOutput"}, testRunId,
+                      true);
+  ExecutorTest test = testBuilder.emitTest();
+
+  std::atomic<unsigned> testsPassed{0};
+  std::vector<std::thread> threads;
+  for (unsigned i = 0; i < numThreads; ++i) {
+    threads.emplace_back([&test, &testsPassed]() {
+      for (unsigned j = 0; j < numRuns; ++j) {
+        if (test.run()) {
+          testsPassed++;
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(testsPassed, numThreads * numRuns);
+  // None of the runs fails, so all the prepared runs are run.
+  EXPECT_EQ(device->getNumPreparedRuns(), device->getNumPrepared());
+  EXPECT_EQ(device->getNumReleased(), 0u);
+}
+
+/// Tests that a node that can run on several devices runs on the one with
+/// the fewest runs in flight.
+TEST_F(ThreadPoolExecutorTest, LoadAwareDeviceSelection) {
+  constexpr RunIdentifierTy testRunId = 10;
+  constexpr DeviceIDTy busyDeviceId = 111;
+  constexpr DeviceIDTy idleDeviceId = 112;
+  constexpr unsigned deviceManagerThreads = 1;
+  constexpr unsigned numRuns = 10;
+
+  auto busyDeviceManager = llvm::make_unique<TestDeviceManager>(
+      deviceManagerThreads, DeviceConfig("Interpreter"));
+  auto *busyDevice = busyDeviceManager.get();
+  deviceManagerMap_.emplace(busyDeviceId, std::move(busyDeviceManager));
+  deviceManagerMap_.emplace(idleDeviceId,
+                            llvm::make_unique<TestDeviceManager>(
+                                deviceManagerThreads,
+                                DeviceConfig("Interpreter")));
+
+  // Only the idle device has a result for the node, the runs that go to the
+  // busy device fail.
+  testBuilder_.addNode("net", idleDeviceId,
+                       /*parents=*/{}, {"netInput"}, {"netOutput"}, testRunId,
+                       true);
+  testBuilder_.addNodeDevice("net", busyDeviceId);
+  ExecutorTest test = testBuilder_.emitTest();
+
+  // Make it look like the busy device runs other networks.
+  busyDevice->startedRun();
+  busyDevice->startedRun();
+  for (unsigned i = 0; i < numRuns; ++i) {
+    EXPECT_TRUE(test.run());
+  }
+  busyDevice->finishedRun();
+  busyDevice->finishedRun();
+}
+
+/// Tests that a run of a node on a device that stalls is hedged on another
+/// device of the node, and that the hedge's outputs are the ones of the run.
+TEST_F(ThreadPoolExecutorTest, HedgedRuns) {
+  constexpr RunIdentifierTy testRunId = 10;
+  constexpr DeviceIDTy slowDeviceId = 111;
+  constexpr DeviceIDTy fastDeviceId = 112;
+  constexpr unsigned deviceManagerThreads = 1;
+  constexpr unsigned executorThreads = 3;
+  constexpr unsigned numRuns = 20;
+  constexpr std::chrono::milliseconds stall(2000);
+
+  auto slowDeviceManager = llvm::make_unique<TestDeviceManager>(
+      deviceManagerThreads, DeviceConfig("Interpreter"));
+  auto fastDeviceManager = llvm::make_unique<TestDeviceManager>(
+      deviceManagerThreads, DeviceConfig("Interpreter"));
+  auto *slowDevice = slowDeviceManager.get();
+  auto *fastDevice = fastDeviceManager.get();
+  deviceManagerMap_.emplace(slowDeviceId, std::move(slowDeviceManager));
+  deviceManagerMap_.emplace(fastDeviceId, std::move(fastDeviceManager));
+
+  HedgingConfig hedging;
+  hedging.percentile = 0.5;
+  hedging.budget = 1;
+  auto executor = std::make_shared<ThreadPoolExecutor>(
+      deviceManagerMap_, executorThreads, /* pipelineDepth */ 0, hedging);
+  ExecutorTestBuilder testBuilder(executor, deviceManagerMap_);
+  testBuilder.addNode("net", slowDeviceId,
+                      /*parents=*/{}, {"netInput"}, {"netOutput"}, testRunId,
+                      true);
+  testBuilder.addNodeDevice("net", fastDeviceId);
+  fastDevice->copyResult("net", *slowDevice);
+  ExecutorTest test = testBuilder.emitTest();
+
+  // Record the latencies of the node, some runs may be hedged already.
+  for (unsigned i = 0; i < numRuns; ++i) {
+    EXPECT_TRUE(test.run());
+  }
+
+  // Make the stalling device the primary one, the run is done by the hedge
+  // long before the stall ends.
+  slowDevice->setDelay(stall);
+  fastDevice->startedRun();
+  auto start = std::chrono::steady_clock::now();
+  EXPECT_TRUE(test.run());
+  EXPECT_LT(std::chrono::steady_clock::now() - start, stall);
+  fastDevice->finishedRun();
+}
+
 /// Tests that a DAG with a node that fails can run correctly.
 TEST_F(ThreadPoolExecutorTest, MultiNodeWithFailure) {
   constexpr RunIdentifierTy testRunId = 10;
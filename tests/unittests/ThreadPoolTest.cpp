@@ -18,6 +18,7 @@
 
 #include "llvm/ADT/STLExtras.h"
 
+#include <array>
 #include <future>
 #include <vector>
 
@@ -154,3 +155,49 @@ TEST(ThreadPool, runOnAllThreads) {
   ASSERT_NE(threadIds[1], threadIds[2]);
   ASSERT_NE(threadIds[2], threadIds[0]);
 }
+
+/// Verify that run() runs tasks with move-only captures, whether they are
+/// stored in place or not.
+TEST(ThreadPool, runTest) {
+  ThreadPool tp(2);
+  std::promise<int> small, large;
+  std::array<char, 2 * InlineFunction::kInlineSize> padding{};
+
+  auto input = llvm::make_unique<int>(42);
+  tp.run([input = std::move(input), &small]() { small.set_value(*input); });
+  tp.run([padding, &large]() { large.set_value(padding.size()); });
+
+  EXPECT_EQ(small.get_future().get(), 42);
+  EXPECT_EQ(large.get_future().get(), 2 * InlineFunction::kInlineSize);
+}
+
+/// Verify that tasks queued on a busy worker are stolen by idle ones.
+TEST(ThreadPool, workStealingTest) {
+  const unsigned numTasks = 20;
+  ThreadPool tp(2);
+  std::promise<void> unblock;
+  std::shared_future<void> unblocked = unblock.get_future().share();
+
+  // Block one of the workers. The tasks queued on it after this one can only
+  // run if the other one steals them.
+  std::promise<void> blocked;
+  tp.run([&blocked, unblocked]() {
+    blocked.set_value();
+    unblocked.wait();
+  });
+  blocked.get_future().wait();
+
+  std::atomic<unsigned> left{numTasks};
+  std::promise<void> finished;
+  for (unsigned i = 0; i < numTasks; ++i) {
+    tp.run([&left, &finished]() {
+      if (--left == 0) {
+        finished.set_value();
+      }
+    });
+  }
+
+  finished.get_future().wait();
+  EXPECT_EQ(left, 0);
+  unblock.set_value();
+}
@@ -18,6 +18,7 @@
 
 #include "glow/Backends/DeviceManager.h"
 #include "glow/ExecutionContext/ExecutionContext.h"
+#include "glow/ExecutionContext/TraceRecorder.h"
 #include "glow/ExecutionEngine/ExecutionEngine.h"
 #include "glow/Graph/Graph.h"
 #include "glow/IR/IRBuilder.h"
@@ -837,4 +838,57 @@ TEST(TraceEventsTest, MergeEvents) {
   ASSERT_EQ(tc2->getTraceEvents().size(), 4);
 }
 
+TEST(TraceEventsTest, RecorderEvents) {
+  TraceRecorder recorder;
+  auto tc = llvm::make_unique<TraceContext>(TraceLevel::RUNTIME, &recorder);
+  constexpr size_t numThreads = 4;
+  constexpr size_t numEvents = 100;
+
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < numThreads; i++) {
+    threads.emplace_back([&tc, i]() {
+      for (size_t j = 0; j < numEvents; j++) {
+        TRACE_EVENT_SCOPE(tc.get(), TraceLevel::RUNTIME, "scope");
+        TRACE_EVENT_INSTANT(tc, TraceLevel::RUNTIME,
+                            "instant" + std::to_string(i));
+        TRACE_EVENT_INSTANT(tc, TraceLevel::OPERATOR, "skipped");
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  // The events are in the recorder, not in the context.
+  EXPECT_EQ(tc->getTraceEvents().size(), 0);
+  auto events = recorder.takeTraceEvents();
+  ASSERT_EQ(events.size(), 2 * numThreads * numEvents);
+  EXPECT_EQ(recorder.getDroppedCount(), 0);
+  std::map<std::string, size_t> counts;
+  for (const auto &event : events) {
+    counts[event.name]++;
+    char type = event.name == "scope" ? char(TraceEvent::CompleteType)
+                                      : char(TraceEvent::InstantType);
+    EXPECT_EQ(event.type, type);
+  }
+  EXPECT_EQ(counts["scope"], numThreads * numEvents);
+  for (size_t i = 0; i < numThreads; i++) {
+    EXPECT_EQ(counts["instant" + std::to_string(i)], numEvents);
+  }
+  EXPECT_EQ(recorder.takeTraceEvents().size(), 0);
+}
+
+TEST(TraceEventsTest, RecorderDropsWhenFull) {
+  TraceRecorder recorder;
+  // Without flushes, the events past the size of the ring buffer are
+  // dropped rather than waited for.
+  const size_t numEvents = 2 * TraceRecorder::kThreadBufferSize;
+  for (size_t i = 0; i < numEvents; i++) {
+    recorder.record("ev", TraceEvent::InstantType, TraceEvent::now());
+  }
+  auto events = recorder.takeTraceEvents();
+  EXPECT_GE(events.size(), TraceRecorder::kThreadBufferSize);
+  EXPECT_EQ(events.size() + recorder.getDroppedCount(), numEvents);
+}
+
 INSTANTIATE_BACKEND_TEST(TraceEventsTest);
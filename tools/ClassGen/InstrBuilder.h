@@ -169,7 +169,9 @@ public:
 
   /// Adds a list of inplace operands. The instruction may use the memory
   /// read by any of the operands in \p lst[1 .. n] for writing the result of
-  /// the operand \p lst[0].
+  /// the operand \p lst[0]. The operands may differ in their quantization
+  /// parameters, the optimizer then views the shared memory with the type of
+  /// each operand.
   InstrBuilder &inplaceOperand(llvm::ArrayRef<llvm::StringRef> lst) {
     assert(lst.size() > 1 && "Not enough operands");
     inplaceOperands_.emplace_back(lst.begin(), lst.end());
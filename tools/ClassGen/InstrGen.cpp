@@ -89,7 +89,8 @@ int main(int argc, char **argv) {
       .addMember(MEMBER_TYPE_INFO(ConvolutionLayout), "Layout")
       .addMember(MEMBER_TYPE_INFO(FusedActivation), "FusedActivation")
       .autoIRGen()
-      .autoVerify(VerifyKind::SameElementType, {"Dest", "Src", "Filter"})
+      // The Filter of an Int16QTy Src may be in Int8QTy, see the node.
+      .autoVerify(VerifyKind::SameElementType, {"Dest", "Src"})
       .addGradientInstr({"Src", "Filter"}, {"Dest", "Src", "Filter", "Bias"});
 
   BB.newInstr("ChannelwiseQuantizedConvolution")
@@ -180,10 +181,31 @@ int main(int argc, char **argv) {
       .autoVerify(VerifyKind::SameElementType,
                   {"Dest", "Src", "ElemKind::Int8QTy"});
 
+  BB.newInstr("DynamicQuantizedFullyConnected")
+      .addOperand("Dest", OperandKind::Out)
+      .addOperand("Src", OperandKind::In)
+      .addOperand("Weights", OperandKind::In)
+      .addOperand("Bias", OperandKind::In)
+      .autoIRGen()
+      .autoVerify(VerifyKind::SameElementType,
+                  {"Dest", "Src", "Bias", "ElemKind::FloatTy"})
+      .autoVerify(VerifyKind::SameElementType,
+                  {"Weights", "ElemKind::Int8QTy"});
+
   //===--------------------------------------------------------------------===//
   //                     Normalization
   //===--------------------------------------------------------------------===//
 
+  BB.newInstr("LayerNormalization")
+      .addOperand("Dest", OperandKind::Out)
+      .addOperand("Src", OperandKind::In)
+      .addOperand("Scale", OperandKind::In)
+      .addOperand("Bias", OperandKind::In)
+      .addMember(MemberType::Float, "Epsilon")
+      .autoVerify(VerifyKind::SameType, {"Dest", "Src"})
+      .autoVerify(VerifyKind::SameElementType, {"Src", "Scale", "Bias"})
+      .autoIRGen();
+
   BB.newInstr("LocalResponseNormalization")
       .addOperand("Dest", OperandKind::Out)
       .addOperand("Src", OperandKind::In)
@@ -238,7 +260,23 @@ int main(int argc, char **argv) {
       .addOperand("LHS", OperandKind::In)
       .addOperand("RHS", OperandKind::In)
       .autoIRGen()
-      .autoVerify(VerifyKind::SameElementType, {"Dest", "LHS", "RHS"});
+      // The RHS of an Int16QTy LHS may be in Int8QTy, see the node.
+      .autoVerify(VerifyKind::SameElementType, {"Dest", "LHS"});
+
+  /// Computes the dot products of every pair of distinct inputs, batch by
+  /// batch. The inputs are read where they are: their number varies, so they
+  /// are the operands pushed after Dest by IRGen.
+  BB.newInstr("BatchedPairwiseDotProduct")
+      .addOperand("Dest", OperandKind::Out)
+      .addExtraMethod(
+          "unsigned getNumInputs() const;",
+          "unsigned BatchedPairwiseDotProductInst::getNumInputs() const { "
+          "return getNumOperands() - 1; }")
+      .addExtraMethod(
+          "Value *getInput(unsigned idx) const;",
+          "Value *BatchedPairwiseDotProductInst::getInput(unsigned idx) const "
+          "{ return getOperand(idx + 1).first; }")
+      .autoVerify(VerifyKind::NoVerify);
 
   /// Accumulates all of the layers in the batch along the Axis dimension and
   /// produce a tensor that has the same dimensions as the input tensor without
@@ -299,6 +337,30 @@ int main(int argc, char **argv) {
       .addGradientInstr({"Data", "Weights", "Indices", "Lengths"},
                         {"Dest", "Data", "Weights"});
 
+  BB.newInstr("SparseLengthsMean")
+      .addOperand("Dest", OperandKind::Out)
+      .addOperand("Data", OperandKind::In)
+      .addOperand("Indices", OperandKind::In)
+      .addOperand("Lengths", OperandKind::In)
+      .autoIRGen()
+      .autoVerify(VerifyKind::SameElementType, {"Dest", "Data"})
+      .autoVerify(VerifyKind::SameElementType,
+                  {"Indices", "ElemKind::Int64ITy"})
+      .autoVerify(VerifyKind::SameElementType,
+                  {"Lengths", "ElemKind::Int32ITy"});
+
+  BB.newInstr("SparseLengthsMax")
+      .addOperand("Dest", OperandKind::Out)
+      .addOperand("Data", OperandKind::In)
+      .addOperand("Indices", OperandKind::In)
+      .addOperand("Lengths", OperandKind::In)
+      .autoIRGen()
+      .autoVerify(VerifyKind::SameElementType, {"Dest", "Data"})
+      .autoVerify(VerifyKind::SameElementType,
+                  {"Indices", "ElemKind::Int64ITy"})
+      .autoVerify(VerifyKind::SameElementType,
+                  {"Lengths", "ElemKind::Int32ITy"});
+
   BB.newInstr("RowwiseQuantizedSparseLengthsWeightedSum")
       .addOperand("Dest", OperandKind::Out)
       .addOperand("Data", OperandKind::In)
@@ -330,6 +392,47 @@ int main(int argc, char **argv) {
                   {"Lengths", "ElemKind::Int32ITy"})
       .autoVerify(VerifyKind::SameShape, {"Weights", "Indices"});
 
+  BB.newInstr("FusedRowwiseQuantizedSparseLengthsMean")
+      .addOperand("Dest", OperandKind::Out)
+      .addOperand("Data", OperandKind::In)
+      .addOperand("Indices", OperandKind::In)
+      .addOperand("Lengths", OperandKind::In)
+      .addMember(MemberType::Boolean, "UseFP16Accumulation")
+      .autoIRGen()
+      .autoVerify(VerifyKind::SameElementType,
+                  {"Indices", "ElemKind::Int64ITy"})
+      .autoVerify(VerifyKind::SameElementType,
+                  {"Lengths", "ElemKind::Int32ITy"});
+
+  BB.newInstr("FusedRowwiseQuantizedSparseLengthsMax")
+      .addOperand("Dest", OperandKind::Out)
+      .addOperand("Data", OperandKind::In)
+      .addOperand("Indices", OperandKind::In)
+      .addOperand("Lengths", OperandKind::In)
+      .addMember(MemberType::Boolean, "UseFP16Accumulation")
+      .autoIRGen()
+      .autoVerify(VerifyKind::SameElementType,
+                  {"Indices", "ElemKind::Int64ITy"})
+      .autoVerify(VerifyKind::SameElementType,
+                  {"Lengths", "ElemKind::Int32ITy"});
+
+  BB.newInstr("GroupedFusedRowwiseQuantizedSparseLengthsWeightedSum")
+      .addOperand("Dest", OperandKind::Out)
+      .addOperand("Data", OperandKind::In)
+      .addOperand("Weights", OperandKind::In)
+      .addOperand("Indices", OperandKind::In)
+      .addOperand("Lengths", OperandKind::In)
+      .addMember(MemberType::VectorSizeT, "RowOffsets")
+      .addMember(MemberType::VectorSizeT, "IndexOffsets")
+      .addMember(MemberType::VectorSizeT, "SegmentOffsets")
+      .addMember(MemberType::Boolean, "UseFP16Accumulation")
+      .autoIRGen()
+      .autoVerify(VerifyKind::SameElementType,
+                  {"Indices", "ElemKind::Int64ITy"})
+      .autoVerify(VerifyKind::SameElementType,
+                  {"Lengths", "ElemKind::Int32ITy"})
+      .autoVerify(VerifyKind::SameShape, {"Weights", "Indices"});
+
   BB.newInstr("LengthsToRanges")
       .addOperand("Dest", OperandKind::Out)
       .addOperand("Lengths", OperandKind::In)
@@ -369,6 +472,28 @@ int main(int argc, char **argv) {
                   {"Lengths", "ElemKind::Int32ITy"})
       .autoIRGen();
 
+  /// Counts, for every element of Src, the Boundaries lower than or equal to
+  /// it.
+  BB.newInstr("Bucketize")
+      .addOperand("Dest", OperandKind::Out)
+      .addOperand("Src", OperandKind::In)
+      .addMember(MemberType::VectorFloat, "Boundaries")
+      .autoVerify(VerifyKind::SameShape, {"Dest", "Src"})
+      .autoVerify(VerifyKind::SameElementType, {"Dest", "ElemKind::Int32ITy"})
+      .autoIRGen();
+
+  /// Applies the Box-Cox transform of every column of Lambda1 and Lambda2 to
+  /// the columns of the NxD Src.
+  BB.newInstr("BatchBoxCox")
+      .addOperand("Dest", OperandKind::Out)
+      .addOperand("Src", OperandKind::In)
+      .addOperand("Lambda1", OperandKind::In)
+      .addOperand("Lambda2", OperandKind::In)
+      .addMember(MemberType::Float, "Epsilon")
+      .autoVerify(VerifyKind::SameType, {"Dest", "Src"})
+      .autoVerify(VerifyKind::SameElementType, {"Src", "Lambda1", "Lambda2"})
+      .autoIRGen();
+
   /// Adds the 'Slice' operand to each one of the slices in the batch.
   BB.newInstr("BatchedAdd")
       .addOperand("Dest", OperandKind::Out)
@@ -642,6 +767,14 @@ int main(int argc, char **argv) {
       .autoVerify(VerifyKind::SameElementType, {"Dest", "Src"})
       .autoIRGen();
 
+  BB.newInstr("ResizeBilinear")
+      .addOperand("Dest", OperandKind::Out)
+      .addOperand("Src", OperandKind::In)
+      .addMember(MemberType::Float, "HeightScale")
+      .addMember(MemberType::Float, "WidthScale")
+      .autoVerify(VerifyKind::SameElementType, {"Dest", "Src"})
+      .autoIRGen();
+
   //===--------------------------------------------------------------------===//
   //             Instructions used for debugging/profiling/printing
   //===--------------------------------------------------------------------===//
@@ -670,6 +803,7 @@ int main(int argc, char **argv) {
       .addOperand("Dest", OperandKind::Out)
       .addOperand("Src", OperandKind::In)
       .addOperand("Mapping", OperandKind::In)
+      .inplaceOperand({"Dest", "Src"})
       .autoVerify(VerifyKind::SameElementType, {"Dest", "Src"})
       .autoVerify(VerifyKind::TypeCheck, {"Dest", "isQuantizedType()"})
       .dataParallel()
@@ -696,6 +830,7 @@ int main(int argc, char **argv) {
   BB.newInstr("RescaleQuantized")
       .addOperand("Dest", OperandKind::Out)
       .addOperand("Src", OperandKind::In)
+      .inplaceOperand({"Dest", "Src"})
       .autoVerify(VerifyKind::SameElementType, {"Dest", "Src"})
       .autoVerify(VerifyKind::TypeCheck, {"Dest", "isQuantizedType()"})
       .autoVerify(VerifyKind::SameShape, {"Dest", "Src"})
@@ -369,6 +369,67 @@ void NodeBuilder::emitCloner(std::ostream &os) const {
   os << ");\n}\n";
 }
 
+void NodeBuilder::emitSerializer(std::ostream &os) const {
+  os << "\nvoid " << name_
+     << "Node::serialize(ModuleWriter &writer) const {\n";
+
+  // Write the constructor arguments in the order of the constructor.
+  for (const auto &paramName : ctorTypeParams_) {
+    os << "  writer.write(get" << paramName << "().getType());\n";
+  }
+  if (!enum_.empty()) {
+    os << "  writer.write(getMode());\n";
+  }
+  for (const auto &op : nodeInputs_) {
+    os << "  writer.write(get" << op << "());\n";
+  }
+  for (const auto &op : members_) {
+    os << "  writer.write(get" << op.second << "());\n";
+  }
+
+  os << "}\n";
+}
+
+void NodeBuilder::emitDeserializer(std::ostream &os) const {
+  os << "\nNode *" << name_ << "Node::deserialize(llvm::StringRef name, "
+     << "ModuleReader &reader) {\n";
+
+  // Read all the arguments before building the node, which is only built if
+  // they are all valid.
+  for (const auto &paramName : ctorTypeParams_) {
+    os << "  TypeRef " << paramName << "{};\n"
+       << "  reader.read(" << paramName << ");\n";
+  }
+  if (!enum_.empty()) {
+    os << "  Mode mode{};\n"
+       << "  reader.read(mode);\n";
+  }
+  for (const auto &op : nodeInputs_) {
+    os << "  NodeValue " << op << ";\n"
+       << "  reader.read(" << op << ");\n";
+  }
+  for (const auto &op : members_) {
+    os << "  " << getCtorArgTypename(&op.first) << " " << op.second << "{};\n"
+       << "  reader.read(" << op.second << ");\n";
+  }
+  os << "  if (!reader.ok()) {\n    return nullptr;\n  }\n";
+
+  os << "  return new " << name_ << "Node(name";
+  for (const auto &paramName : ctorTypeParams_) {
+    os << ", " << paramName;
+  }
+  if (!enum_.empty()) {
+    os << ", mode";
+  }
+  for (const auto &op : nodeInputs_) {
+    os << ", " << op;
+  }
+  for (const auto &op : members_) {
+    os << ", " << op.second;
+  }
+  os << ");\n}\n";
+}
+
 /// \returns true if a can be a part of a valid C/C++ identifier.
 static bool isIdentifierChar(char c) { return (c == '_' || isalnum(c)); }
 
@@ -537,6 +598,9 @@ void NodeBuilder::emitNodeClass(std::ostream &os) const {
      << "  llvm::hash_code getHash() const;\n"
      << "  void visit(Node *parent, NodeWalker *visitor);\n"
      << "  Node* clone() const;\n"
+     << "  void serialize(ModuleWriter &writer) const;\n"
+     << "  static Node *deserialize(llvm::StringRef name,\n"
+     << "                           ModuleReader &reader);\n"
      << "  bool verify() const;\n";
 
   if (!enum_.empty()) {
@@ -557,6 +621,8 @@ void NodeBuilder::emitCppMethods(std::ostream &os) const {
   emitVisitor(os);
   emitEquator(os);
   emitCloner(os);
+  emitSerializer(os);
+  emitDeserializer(os);
   emitHasher(os);
   if (!enum_.empty()) {
     emitEnumModePrinters(os);
@@ -569,7 +635,9 @@ void NodeBuilder::emitCppMethods(std::ostream &os) const {
 }
 
 NodeBuilder &NodeBuilder::addGradient() {
-  NodeBuilder GN(hStream, cStream, dStream, name_ + "Grad", isBackendSpecific_);
+  // Gradients are only run in training, they aren't benchmarked.
+  NodeBuilder GN(hStream, cStream, dStream, /* B */ nullptr, name_ + "Grad",
+                 isBackendSpecific_);
 
   // The new 'Grad' class will have all of the fields of the current class.
   GN.members_ = members_;
@@ -631,7 +699,22 @@ NodeBuilder &NodeBuilder::addGradient() {
   return *this;
 }
 
+void NodeBuilder::emitBenchmarkDef(std::ostream &os) const {
+  // Backend specific nodes are created by their backends, and the nodes with
+  // members, modes or several results can't be created from their inputs.
+  if (isBackendSpecific_ || hasSideEffects_ || !enum_.empty() ||
+      !members_.empty() || nodeInputs_.empty() || nodeOutputs_.size() != 1 ||
+      ctorTypeParams_.size() > 1 || !nodeOverwrittenInputs_.empty()) {
+    return;
+  }
+  os << "DEF_BENCHMARK_NODE(" << name_ << "Node, " << name_ << ", "
+     << nodeInputs_.size() << ", " << ctorTypeParams_.size() << ")\n";
+}
+
 NodeBuilder::~NodeBuilder() {
   emitNodeClass(hStream);
   emitCppMethods(cStream);
+  if (bStream) {
+    emitBenchmarkDef(*bStream);
+  }
 }
@@ -60,6 +60,8 @@ class NodeBuilder {
   std::ofstream &cStream;
   /// Def file stream.
   std::ofstream &dStream;
+  /// Benchmark def file stream, or nullptr if the node isn't benchmarked.
+  std::ofstream *bStream;
   /// Documentation string printed with the class definition.
   std::string docstring_;
   /// Whether node has side effects. By default there are no side effects.
@@ -69,8 +71,9 @@ class NodeBuilder {
 
 public:
   NodeBuilder(std::ofstream &H, std::ofstream &C, std::ofstream &D,
-              const std::string &name, bool isBackendSpecific)
-      : name_(name), hStream(H), cStream(C), dStream(D),
+              std::ofstream *B, const std::string &name,
+              bool isBackendSpecific)
+      : name_(name), hStream(H), cStream(C), dStream(D), bStream(B),
         isBackendSpecific_(isBackendSpecific) {
     dStream << "DEF_NODE(" << name << "Node, " << name << ")\n";
   }
@@ -201,6 +204,13 @@ private:
   /// Emit the clone() method copies the node.
   void emitCloner(std::ostream &os) const;
 
+  /// Emit the serialize() method that writes the node with a ModuleWriter.
+  void emitSerializer(std::ostream &os) const;
+
+  /// Emit the deserialize() method that builds the node from the arguments of
+  /// its constructor read with a ModuleReader.
+  void emitDeserializer(std::ostream &os) const;
+
   /// Emit the getHash method that computes a hash of a node.
   void emitHasher(std::ostream &os) const;
 
@@ -219,38 +229,54 @@ private:
   /// Emit the methods that go into the CPP file and implement the methods that
   /// were declared in the header file.
   void emitCppMethods(std::ostream &os) const;
+
+  /// Emit the benchmark definition of the node if it can be created from its
+  /// inputs and the type of its result only.
+  void emitBenchmarkDef(std::ostream &os) const;
 };
 
 class Builder {
   std::ofstream &hStream;
   std::ofstream &cStream;
   std::ofstream &dStream;
+  std::ofstream &bStream;
 
 public:
-  /// Create a new top-level builder that holds the three output streams that
-  /// point to the header file, cpp file and enum definition file.
-  Builder(std::ofstream &H, std::ofstream &C, std::ofstream &D)
-      : hStream(H), cStream(C), dStream(D) {
+  /// Create a new top-level builder that holds the four output streams that
+  /// point to the header file, cpp file, enum definition file and benchmark
+  /// definition file.
+  Builder(std::ofstream &H, std::ofstream &C, std::ofstream &D,
+          std::ofstream &B)
+      : hStream(H), cStream(C), dStream(D), bStream(B) {
     cStream << "#include \"glow/Graph/Nodes.h\"\n"
                "#include \"glow/Base/Type.h\"\n"
+               "#include \"glow/Graph/Serialization.h\"\n"
                "#include \"glow/Support/Support.h\"\n\n"
                "using namespace glow;\n";
     dStream << "#ifndef DEF_NODE\n#error The macro DEF_NODE was not declared.\n"
                "#endif\n";
+    bStream << "#ifndef DEF_BENCHMARK_NODE\n"
+               "#error The macro DEF_BENCHMARK_NODE was not declared.\n"
+               "#endif\n";
   }
 
-  ~Builder() { dStream << "#undef DEF_NODE"; }
+  ~Builder() {
+    dStream << "#undef DEF_NODE";
+    bStream << "#undef DEF_BENCHMARK_NODE";
+  }
 
   /// Declare a new node and generate code for it.
   NodeBuilder newNode(const std::string &name) {
     const bool isBackendSpecific = false;
-    return NodeBuilder(hStream, cStream, dStream, name, isBackendSpecific);
+    return NodeBuilder(hStream, cStream, dStream, &bStream, name,
+                       isBackendSpecific);
   }
 
   /// Declare a new backend specific node and generate code for it.
   NodeBuilder newBackendSpecificNode(const std::string &name) {
     const bool isBackendSpecific = true;
-    return NodeBuilder(hStream, cStream, dStream, name, isBackendSpecific);
+    return NodeBuilder(hStream, cStream, dStream, &bStream, name,
+                       isBackendSpecific);
   }
 
   /// Declare the node in the def file but don't generate code for it.
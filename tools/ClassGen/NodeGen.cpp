@@ -19,19 +19,21 @@
 #include <iostream>
 
 int main(int argc, char **argv) {
-  if (argc != 4) {
-    std::cerr << "Usage: " << argv[0] << " output.h output.cpp output.def\n";
+  if (argc != 5) {
+    std::cerr << "Usage: " << argv[0]
+              << " output.h output.cpp output.def output_benchmarks.def\n";
     return -1;
   }
 
   std::cout << "Writing node descriptors to:\n\t" << argv[1] << "\n\t"
-            << argv[2] << "\n\t" << argv[3] << "\n";
+            << argv[2] << "\n\t" << argv[3] << "\n\t" << argv[4] << "\n";
 
   std::ofstream hFile(argv[1]);
   std::ofstream cFile(argv[2]);
   std::ofstream dFile(argv[3]);
+  std::ofstream bFile(argv[4]);
 
-  Builder BB(hFile, cFile, dFile);
+  Builder BB(hFile, cFile, dFile, bFile);
 
   //===--------------------------------------------------------------------===//
   //                    Input/Output nodes
@@ -198,6 +200,19 @@ int main(int argc, char **argv) {
           "Bias and Result are regularly quantized, while Weights use row-wise"
           "quantization.");
 
+  BB.newNode("DynamicQuantizedFullyConnected")
+      .addInput("Input")
+      .addInput("Weights")
+      .addInput("Bias")
+      .addResultFromCtorArg()
+      .setDocstring(
+          "Creates a DynamicQuantizedFullyConnected node where the Input "
+          "matrix and the transpose of Weights matrix are multiplied, and "
+          "then the Bias vector is broadcast-added to the result. Input, Bias "
+          "and Result are float, while Weights are quantized. The Input is "
+          "quantized to Int8QTy at runtime, with the params of its own range, "
+          "and the product is computed in integers and dequantized.");
+
   //===--------------------------------------------------------------------===//
   //                     Normalization
   //===--------------------------------------------------------------------===//
@@ -229,6 +244,18 @@ int main(int argc, char **argv) {
       .setDocstring("Calculates new normalized mean and variance based on the "
                     "input mean, variance, and input.");
 
+  BB.newNode("LayerNormalization")
+      .addInput("Input")
+      .addInput("Scale")
+      .addInput("Bias")
+      .addMember(MemberType::Float, "Epsilon")
+      .addResult("Input.getType()")
+      .setDocstring("Performs layer normalization on the Input tensor with the "
+                    "provided Scale, Bias and Epsilon. The trailing dimensions "
+                    "of Input equal to the dimensions of Scale and Bias are "
+                    "normalized. Similar to ONNX LayerNormalization and "
+                    "PyTorch layer_norm.");
+
   BB.newNode("LocalResponseNormalization")
       .addInput("Input")
       .addMember(MemberType::Unsigned, "HalfWindowSize")
@@ -416,6 +443,18 @@ int main(int argc, char **argv) {
                     "RHS. The operands are a stack of two dimensional "
                     "matrices. Example: (N, A, Z) x (N, Z, B) => (N, A, B)");
 
+  BB.newNode("BatchedPairwiseDotProduct")
+      .addMember(MemberType::VectorNodeValue, "Inputs")
+      .addResultFromCtorArg()
+      .setDocstring("Computes the dot products of every pair of distinct "
+                    "Inputs, batch by batch, like the feature interactions of "
+                    "DLRM. All Inputs have the shape {B, D}. The Result has "
+                    "the shape {B, N * (N - 1) / 2}, for N Inputs, and the "
+                    "dot product of Inputs i and j, j < i, for every batch at "
+                    "index i * (i - 1) / 2 + j. Equivalent to gathering the "
+                    "lower triangle of BatchMatMul(X, X^T), where X stacks "
+                    "the Inputs into the shape {B, N, D}.");
+
   BB.newNode("BatchedReduceAdd")
       .addInput("Batch")
       .addMember(MemberType::Unsigned, "Axis")
@@ -484,6 +523,31 @@ int main(int argc, char **argv) {
                     "Weights[0] * Slice(0) + Weights[1] * Slice(1) + ... "
                     "It implies that len(Weights) == len(Indices).");
 
+  BB.newNode("SparseLengthsMean")
+      .addInput("Data")
+      .addInput("Indices")
+      .addInput("Lengths")
+      .addResultFromCtorArg()
+      .setDocstring("Gathers slices of the outer-most dimension of Data "
+                    "indexed by Indices vector, and then averages them into "
+                    "len(Lengths) entries: first Lengths[0] slices are "
+                    "averaged to Result[0], next Lengths[1] slices are "
+                    "averaged to Result[1], etc. I.e. sum(Lengths) must be "
+                    "equal to len(Indices). Empty segments are zero.");
+
+  BB.newNode("SparseLengthsMax")
+      .addInput("Data")
+      .addInput("Indices")
+      .addInput("Lengths")
+      .addResultFromCtorArg()
+      .setDocstring("Gathers slices of the outer-most dimension of Data "
+                    "indexed by Indices vector, and then takes their "
+                    "elementwise maximum into len(Lengths) entries: first "
+                    "Lengths[0] slices are reduced to Result[0], next "
+                    "Lengths[1] slices are reduced to Result[1], etc. I.e. "
+                    "sum(Lengths) must be equal to len(Indices). Empty "
+                    "segments are zero.");
+
   BB.newNode("RowwiseQuantizedSparseLengthsWeightedSum")
       .addInput("Data")
       .addInput("Scales")
@@ -525,6 +589,27 @@ int main(int argc, char **argv) {
                     "Offsets are appended to the end of each row. Thus, Data "
                     "must be a two-dimensional tensor.");
 
+  BB.newNode("GroupedFusedRowwiseQuantizedSparseLengthsWeightedSum")
+      .addInput("Data")
+      .addInput("Weights")
+      .addInput("Indices")
+      .addInput("Lengths")
+      .addMember(MemberType::VectorSizeT, "RowOffsets")
+      .addMember(MemberType::VectorSizeT, "IndexOffsets")
+      .addMember(MemberType::VectorSizeT, "SegmentOffsets")
+      .addMember(MemberType::Boolean, "UseFP16Accumulation")
+      .addResultFromCtorArg()
+      .setDocstring("Performs the "
+                    "FusedRowwiseQuantizedSparseLengthsWeightedSum of several "
+                    "embedding tables at once. Data, Weights, "
+                    "Indices and Lengths are the concatenations of the inputs "
+                    "of the tables, and Result is the concatenation of their "
+                    "results. Table i owns the rows of Data starting at "
+                    "RowOffsets[i], the entries of Weights and Indices "
+                    "starting at IndexOffsets[i] and the entries of Lengths "
+                    "starting at SegmentOffsets[i]. Its Indices are relative "
+                    "to its first row.");
+
   BB.newNode("FusedRowwiseQuantizedSparseLengthsSum")
       .addInput("Data")
       .addInput("Indices")
@@ -541,6 +626,28 @@ int main(int argc, char **argv) {
                     "Offsets are appended to the end of each row. Thus, Data "
                     "must be a two-dimensional tensor.");
 
+  BB.newNode("FusedRowwiseQuantizedSparseLengthsMean")
+      .addInput("Data")
+      .addInput("Indices")
+      .addInput("Lengths")
+      .addMember(MemberType::Boolean, "UseFP16Accumulation")
+      .addResultFromCtorArg()
+      .setDocstring("Same as SparseLengthsMean, but the input data is fused "
+                    "rowwise-quantized, where the Scales and Offsets are "
+                    "appended to the end of each row. Thus, Data must be a "
+                    "two-dimensional tensor.");
+
+  BB.newNode("FusedRowwiseQuantizedSparseLengthsMax")
+      .addInput("Data")
+      .addInput("Indices")
+      .addInput("Lengths")
+      .addMember(MemberType::Boolean, "UseFP16Accumulation")
+      .addResultFromCtorArg()
+      .setDocstring("Same as SparseLengthsMax, but the input data is fused "
+                    "rowwise-quantized, where the Scales and Offsets are "
+                    "appended to the end of each row. Thus, Data must be a "
+                    "two-dimensional tensor.");
+
   BB.newNode("LengthsToRanges")
       .addInput("Lengths")
       .addResultFromCtorArg()
@@ -770,6 +877,18 @@ int main(int argc, char **argv) {
           "neighbor interpolation. The Output tensor is of shape [N, "
           "floor(H*HeightScale), floor(W*WidthScale), C]");
 
+  BB.newNode("ResizeBilinear")
+      .addInput("Input")
+      .addMember(MemberType::Float, "HeightScale")
+      .addMember(MemberType::Float, "WidthScale")
+      .addResultFromCtorArg()
+      .setDocstring(
+          "Given Input tensor of [N,H,W,C], where N is the batch, C is the "
+          "channel or depth, H is the height and W is the width, Generates an "
+          "Output tensor with resized spatial dimensions using bilinear "
+          "interpolation. The Output tensor is of shape [N, "
+          "floor(H*HeightScale), floor(W*WidthScale), C]");
+
   //===--------------------------------------------------------------------===//
   //                Nodes used for network training
   //===--------------------------------------------------------------------===//
@@ -795,6 +914,17 @@ int main(int argc, char **argv) {
                     "Produces the updated weight that needs to be used "
                     "instead of Weight for the next iteration.");
 
+  BB.newNode("RecomputeBarrier")
+      .addInput("Input")
+      .addInput("After")
+      .addResult("Input.getType()")
+      .setDocstring("Forwards Input, which a segment of the forward pass is "
+                    "recomputed from in the backward pass, once After is "
+                    "computed. Keeps the recomputed nodes from being merged "
+                    "with the forward nodes they were cloned from, and from "
+                    "running before the backward pass reaches them. "
+                    "Generates no code, Result is Input.");
+
   //===--------------------------------------------------------------------===//
   //             Nodes used for debugging/profiling/printing
   //===--------------------------------------------------------------------===//
@@ -884,6 +1014,20 @@ int main(int argc, char **argv) {
                     "tensor. The input shape {D_0, D_1, ... D_n} results in "
                     "the outputs {D_0, D_1, ... D_n-1, K}, sorted in "
                     "non-decreasing order.");
+
+  BB.newNode("LSTMUnit")
+      .addInput("Gates")
+      .addInput("PrevCell")
+      .addResult("PrevCell.getType()", "Hidden")
+      .addResult("PrevCell.getType()", "Cell")
+      .addGradient()
+      .setDocstring("Computes a step of an LSTM from the pre-activations of "
+                    "its gates, Gates of shape [B, 4H], which holds the "
+                    "input, forget and output gates and the candidate cell "
+                    "one after the other, and from the cell state PrevCell "
+                    "of shape [B, H]. Cell = sigmoid(f) * PrevCell + "
+                    "sigmoid(i) * tanh(c), Hidden = sigmoid(o) * tanh(Cell).");
+
   //===--------------------------------------------------------------------===//
   //                Conversions
   //===--------------------------------------------------------------------===//
@@ -29,6 +29,7 @@
 #include "llvm/Support/raw_ostream.h"
 
 #include <atomic>
+#include <condition_variable>
 #include <fstream>
 #include <future>
 #include <iostream>
@@ -84,8 +85,9 @@ llvm::cl::opt<unsigned> miniBatchThreads(
         "this option (for example, if specified number of threads is greater "
         "than number of minibatches to process). Their number may also be "
         "forced to 1 in some cases (see below);\n"
-        "\t- Currently, dumping profile and emitting bundle force "
-        "single-threaded mode;\n"
+        "\t- Currently, emitting bundle forces single-threaded mode;\n"
+        "\t- When dumping profile, the profiles gathered by the threads are "
+        "merged into one;\n"
         "\t- If a model has operations that make reduction across images in "
         "the batch, it is a user's responsibility to make sure that this model "
         "is  not processed in multi-threaded mode. Otherwise, the correctness "
@@ -148,6 +150,30 @@ llvm::cl::opt<unsigned>
            llvm::cl::init(0), llvm::cl::value_desc("W"),
            llvm::cl::cat(imageLoaderCat));
 
+llvm::cl::opt<unsigned> preprocessThreads(
+    "image-preprocess-threads",
+    llvm::cl::desc("Number of threads decoding and preprocessing the images of "
+                   "a batch in parallel"),
+    llvm::cl::Optional, llvm::cl::init(1), llvm::cl::cat(imageLoaderCat));
+
+llvm::cl::opt<unsigned> prefetchMiniBatches(
+    "prefetch-minibatches",
+    llvm::cl::desc(
+        "Number of mini-batches decoded and preprocessed ahead of their "
+        "inference by a background thread of each minibatch thread. By "
+        "default, mini-batches are loaded right before being inferred."),
+    llvm::cl::Optional, llvm::cl::init(0), llvm::cl::cat(imageLoaderCat));
+
+llvm::cl::opt<unsigned> streamMiniBatches(
+    "stream-minibatches",
+    llvm::cl::desc(
+        "Number of mini-batches each minibatch thread keeps in flight through "
+        "the HostManager, each with its own input and output tensors. The "
+        "results of a mini-batch are printed when its run completes, while "
+        "the next mini-batches are loaded and run. By default, mini-batches "
+        "are run one at a time. Not available when profiling."),
+    llvm::cl::Optional, llvm::cl::init(0), llvm::cl::cat(imageLoaderCat));
+
 std::mutex eventLock;
 std::unique_ptr<TraceContext> traceContext;
 
@@ -196,6 +222,89 @@ static bool getNextMiniBatch(std::vector<std::string> &imageList,
   return true;
 }
 
+namespace {
+
+/// Loads the mini-batches of images [startIndex, endIndex) of
+/// inputImageFilenames on a background thread, keeping up to a given number of
+/// them ready ahead of their inference.
+class MiniBatchPrefetcher {
+  /// A loaded mini-batch.
+  struct MiniBatch {
+    std::vector<std::string> filenames;
+    Tensor data;
+  };
+  /// The loaded mini-batches, in order.
+  std::queue<MiniBatch> ready_;
+  /// The maximum size of ready_.
+  size_t depth_;
+  /// Set when all mini-batches were loaded, or when the loading must stop.
+  bool done_{false};
+  bool stop_{false};
+  /// Protects the members above.
+  std::mutex mu_;
+  /// Signaled when a mini-batch is added to or removed from ready_.
+  std::condition_variable cv_;
+  /// The thread loading the mini-batches.
+  std::thread thread_;
+
+  void load(size_t startIndex, size_t endIndex) {
+    size_t miniBatchIndex = startIndex;
+    std::vector<std::string> filenames;
+    while (getNextMiniBatch(filenames, inputImageFilenames, miniBatchIndex,
+                            miniBatch, endIndex)) {
+      MiniBatch batch;
+      batch.filenames = filenames;
+      loadImagesAndPreprocess(filenames, &batch.data, imageNormMode,
+                              imageChannelOrder, imageLayout,
+                              preprocessThreads);
+      std::unique_lock<std::mutex> lock(mu_);
+      cv_.wait(lock, [this] { return stop_ || ready_.size() < depth_; });
+      if (stop_) {
+        return;
+      }
+      ready_.push(std::move(batch));
+      cv_.notify_all();
+    }
+    std::lock_guard<std::mutex> lock(mu_);
+    done_ = true;
+    cv_.notify_all();
+  }
+
+public:
+  MiniBatchPrefetcher(size_t startIndex, size_t endIndex, size_t depth)
+      : depth_(depth) {
+    thread_ = std::thread(
+        [this, startIndex, endIndex]() { load(startIndex, endIndex); });
+  }
+
+  ~MiniBatchPrefetcher() {
+    {
+      std::lock_guard<std::mutex> lock(mu_);
+      stop_ = true;
+    }
+    cv_.notify_all();
+    thread_.join();
+  }
+
+  /// Moves the file names and the data of the next mini-batch into
+  /// \p filenames and \p data, waiting for it to be loaded. \returns false if
+  /// there are no more mini-batches.
+  bool next(std::vector<std::string> &filenames, Tensor &data) {
+    std::unique_lock<std::mutex> lock(mu_);
+    cv_.wait(lock, [this] { return done_ || !ready_.empty(); });
+    if (ready_.empty()) {
+      return false;
+    }
+    filenames = std::move(ready_.front().filenames);
+    data = std::move(ready_.front().data);
+    ready_.pop();
+    cv_.notify_all();
+    return true;
+  }
+};
+
+} // namespace
+
 /// Creates and \returns the ProtobufLoader given \p loader and the
 /// \p inputImageType. Note that this must come after loading images for
 /// inference so that \p inputImageType is known.
@@ -417,6 +526,94 @@ static int processAndPrintResults(Tensor *SMT,
   }
 }
 
+namespace {
+
+/// Runs mini-batches through the HostManager keeping up to a given number of
+/// them in flight, each in its own ExecutionContext, and prints the results of
+/// every mini-batch from the callback of its run.
+class MiniBatchStreamer {
+  runtime::HostManager *hostManager_;
+  std::string name_;
+  Placeholder *inputPH_;
+  Placeholder *outputPH_;
+  /// Guards the printing of the results and numErrors_.
+  std::mutex &ioMu_;
+  int &numErrors_;
+  /// The contexts not used by a run.
+  std::vector<std::unique_ptr<ExecutionContext>> freeContexts_;
+  /// The number of runs not completed yet.
+  size_t inflight_{0};
+  /// Protects freeContexts_ and inflight_.
+  std::mutex mu_;
+  /// Signaled when a run completes.
+  std::condition_variable cv_;
+
+public:
+  MiniBatchStreamer(runtime::HostManager *hostManager, llvm::StringRef name,
+                    Placeholder *inputPH, Placeholder *outputPH,
+                    size_t numContexts, std::mutex &ioMu, int &numErrors)
+      : hostManager_(hostManager), name_(name), inputPH_(inputPH),
+        outputPH_(outputPH), ioMu_(ioMu), numErrors_(numErrors) {
+    for (size_t i = 0; i < numContexts; i++) {
+      auto context = llvm::make_unique<ExecutionContext>();
+      if (traceContext) {
+        context->setTraceContext(
+            llvm::make_unique<TraceContext>(TraceLevel::STANDARD));
+      }
+      auto *bindings = context->getPlaceholderBindings();
+      bindings->allocate(inputPH_);
+      bindings->allocate(outputPH_);
+      freeContexts_.push_back(std::move(context));
+    }
+  }
+
+  ~MiniBatchStreamer() { wait(); }
+
+  /// Starts the inference of the mini-batch of \p filenames whose data is
+  /// \p inputData, waiting for a previous run to complete if there are as
+  /// many in flight as contexts.
+  void run(const std::vector<std::string> &filenames, Tensor &inputData) {
+    std::unique_ptr<ExecutionContext> context;
+    {
+      std::unique_lock<std::mutex> lock(mu_);
+      cv_.wait(lock, [this] { return !freeContexts_.empty(); });
+      context = std::move(freeContexts_.back());
+      freeContexts_.pop_back();
+      inflight_++;
+    }
+    updateInputPlaceholders(*context->getPlaceholderBindings(), {inputPH_},
+                            {&inputData});
+    hostManager_->runNetwork(
+        name_, std::move(context),
+        [this, filenames](runtime::RunIdentifierTy, Error err,
+                          std::unique_ptr<ExecutionContext> contextPtr) {
+          EXIT_ON_ERR(std::move(err));
+          {
+            std::lock_guard<std::mutex> lock(ioMu_);
+            numErrors_ += processAndPrintResults(
+                contextPtr->getPlaceholderBindings()->get(outputPH_),
+                filenames);
+          }
+          if (traceContext) {
+            std::lock_guard<std::mutex> lock(eventLock);
+            traceContext->merge(contextPtr->getTraceContext());
+          }
+          std::lock_guard<std::mutex> lock(mu_);
+          freeContexts_.push_back(std::move(contextPtr));
+          inflight_--;
+          cv_.notify_all();
+        });
+  }
+
+  /// Waits for all runs to complete.
+  void wait() {
+    std::unique_lock<std::mutex> lock(mu_);
+    cv_.wait(lock, [this] { return inflight_ == 0; });
+  }
+};
+
+} // namespace
+
 /// Read all images from \p inputImageListFile in to \p inputImageFilenames.
 static void parseInputImageList(const std::string &inputImageListFile) {
   std::ifstream inFile;
@@ -581,6 +778,12 @@ int main(int argc, char **argv) {
   std::mutex ioMu;
   int numErrors = 0;
 
+  // When profiling, the threads merge their profiles into the one of the
+  // first thread to finish, which is serialized once all threads are done.
+  std::mutex profileMu;
+  std::unique_ptr<Loader> profileLoader;
+  std::unique_ptr<ExecutionContext> profileContext;
+
   // Process a set of minibatches with indices [startIndex, endIndex).
   auto processImageRange = [&](size_t startIndex, size_t endIndex) {
     std::unique_ptr<ExecutionContext> exContext =
@@ -590,7 +793,8 @@ int main(int argc, char **argv) {
       exContext->setTraceContext(
           llvm::make_unique<TraceContext>(TraceLevel::STANDARD));
     }
-    Loader loader;
+    auto loaderP = llvm::make_unique<Loader>();
+    Loader &loader = *loaderP;
     // Used to make sure we only compile once, and run only once if not
     // streaming.
     bool isFirstRun = true;
@@ -606,15 +810,34 @@ int main(int argc, char **argv) {
       inputImageBatchFilenames = inputImageFilenames;
     }
 
+    // When prefetching, the mini-batches are loaded ahead by a background
+    // thread instead of in the loop below.
+    std::unique_ptr<MiniBatchPrefetcher> prefetcher;
+    if (miniBatchMode && prefetchMiniBatches && !iterationsOpt) {
+      prefetcher = llvm::make_unique<MiniBatchPrefetcher>(
+          startIndex, endIndex, prefetchMiniBatches);
+    }
+    bool prefetched = false;
+    // Set during the first run when mini-batches are streamed.
+    std::unique_ptr<MiniBatchStreamer> streamer;
+    auto getNextMiniBatchData = [&]() {
+      if (prefetcher) {
+        prefetched = prefetcher->next(inputImageBatchFilenames, inputImageData);
+        return prefetched;
+      }
+      return getNextMiniBatch(inputImageBatchFilenames, inputImageFilenames,
+                              miniBatchIndex, miniBatch, endIndex);
+    };
+
     while ((streamInputFilenamesMode &&
             getNextImageFilenames(&inputImageBatchFilenames)) ||
-           (miniBatchMode &&
-            getNextMiniBatch(inputImageBatchFilenames, inputImageFilenames,
-                             miniBatchIndex, miniBatch, endIndex)) ||
-           isFirstRun) {
+           (miniBatchMode && getNextMiniBatchData()) || isFirstRun) {
       // Load and process the image data into the inputImageData Tensor.
-      loadImagesAndPreprocess(inputImageBatchFilenames, &inputImageData,
-                              imageNormMode, imageChannelOrder, imageLayout);
+      if (!prefetched) {
+        loadImagesAndPreprocess(inputImageBatchFilenames, &inputImageData,
+                                imageNormMode, imageChannelOrder, imageLayout,
+                                preprocessThreads);
+      }
 
       // It we are benchmarking reset the image data to the batch size we need.
       if (iterationsOpt) {
@@ -646,6 +869,13 @@ int main(int argc, char **argv) {
 
         inputImagePH = inputOutputPair.first;
         outputPH = inputOutputPair.second;
+
+        if (miniBatchMode && streamMiniBatches && !iterationsOpt &&
+            !profilingGraph()) {
+          streamer = llvm::make_unique<MiniBatchStreamer>(
+              loader.getHostManager(), loader.getFunctionName(), inputImagePH,
+              outputPH, streamMiniBatches, ioMu, numErrors);
+        }
       }
       CHECK(inputImagePH) << "Input must be valid.";
       CHECK(outputPH) << "Output must be valid.";
@@ -663,6 +893,11 @@ int main(int argc, char **argv) {
       if (iterationsOpt) {
         break;
       }
+      // When streaming, the results are printed once the run completes.
+      if (streamer) {
+        streamer->run(inputImageBatchFilenames, inputImageData);
+        continue;
+      }
       // About to run inference, so update the input image Placeholder's backing
       // Tensor with inputImageData.
       updateInputPlaceholders(bindings, {inputImagePH}, {&inputImageData});
@@ -682,6 +917,9 @@ int main(int argc, char **argv) {
       }
     }
 
+    // Wait for the streamed mini-batches.
+    streamer.reset();
+
     if (iterationsOpt) {
       // Image tensors loaded up to be run at once for benchmark mode.
       std::vector<std::unique_ptr<ExecutionContext>> contexts =
@@ -702,20 +940,25 @@ int main(int argc, char **argv) {
       }
     }
 
-    // If profiling, generate and serialize the quantization infos now that we
-    // have run inference one or more times to gather the profile.
+    // If profiling, merge the profile gathered by this thread.
     if (profilingGraph()) {
-      loader.generateAndSerializeQuantizationInfos(bindings);
+      std::lock_guard<std::mutex> lock(profileMu);
+      if (!profileLoader) {
+        profileLoader = std::move(loaderP);
+        profileContext = std::move(exContext);
+      } else {
+        profileLoader->mergeQuantizationProfiles(
+            *profileContext->getPlaceholderBindings(), loader, bindings);
+      }
     }
   };
 
   // We will force single-threaded execution if:
   // - Minibatch mode is disabled;
-  // - We are going to emit bundle and do not do inference;
-  // - We are collecting inference profile.
-  // Otherwise, there can be several minibatches of equal size.
-  const bool multiThreadingAllowed =
-      miniBatchMode && !emittingBundle() && !profilingGraph();
+  // - We are going to emit bundle and do not do inference.
+  // Otherwise, there can be several minibatches of equal size, and the
+  // profiles of the threads are merged when collecting inference profile.
+  const bool multiThreadingAllowed = miniBatchMode && !emittingBundle();
   const size_t numBatches =
       miniBatchMode ? inputImageFilenames.size() / miniBatch : 1u;
   const size_t numThreads = multiThreadingAllowed
@@ -724,7 +967,7 @@ int main(int argc, char **argv) {
   if (miniBatchThreads > 1 && !multiThreadingAllowed) {
     llvm::outs() << "WARNING: multi-threaded execution is not possible. Make "
                     "sure that minibatch size is specified and you are not "
-                    "trying to dump profile or emit bundle.\n";
+                    "trying to emit bundle.\n";
   }
 
   llvm::outs() << "Running " << numThreads << " thread(s).\n";
@@ -753,6 +996,13 @@ int main(int argc, char **argv) {
     }
   }
 
+  // If profiling, generate and serialize the quantization infos now that we
+  // have run inference one or more times to gather the profile.
+  if (profileLoader) {
+    profileLoader->generateAndSerializeQuantizationInfos(
+        *profileContext->getPlaceholderBindings());
+  }
+
   if (!tracePath.empty()) {
     traceContext->dump(tracePath, "ImageClassifier");
   }
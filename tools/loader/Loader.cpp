@@ -21,6 +21,7 @@
 #include "glow/IR/IR.h"
 #include "glow/Optimizer/GraphOptimizer/CompilationContext.h"
 #include "glow/Optimizer/GraphOptimizer/GraphOptimizer.h"
+#include "glow/Optimizer/GraphOptimizerPipeline/Pipeline.h"
 #include "glow/Quantization/Quantization.h"
 #include "glow/Quantization/Serialization.h"
 #include "glow/Runtime/RuntimeTypes.h"
@@ -46,6 +47,33 @@ static llvm::cl::opt<bool, true>
                    llvm::cl::desc("Enable rowwise quantized fully connected."),
                    llvm::cl::location(enableRowwiseOpt), llvm::cl::init(false));
 
+/// -fused-4bit-max-error : Command line option to quantize the embedding
+/// tables accurate enough in 4 bits to 4 bits in rowwise quantization.
+static llvm::cl::opt<float> fused4BitMaxErrorOpt(
+    "fused-4bit-max-error",
+    llvm::cl::desc("With -enable-rowwise, quantize to 4 bits instead of 8 the "
+                   "embedding tables whose relative 4-bit quantization error "
+                   "is at most this value. 0 keeps all tables in 8 bits."),
+    llvm::cl::init(0.0f));
+
+/// -minimize-quantization-conversions : Command line option to run in float
+/// the quantized nodes whose conversions cost more than they save.
+static llvm::cl::opt<bool> minimizeConversionsOpt(
+    "minimize-quantization-conversions",
+    llvm::cl::desc("Run in float the regions of quantized nodes whose "
+                   "conversions from and to float cost more than the float "
+                   "compute they save."),
+    llvm::cl::init(false));
+
+/// -dynamic-quantize-fc : Command line option to quantize the activations of
+/// the fully connected nodes at runtime, which needs no profile.
+static llvm::cl::opt<bool> dynamicQuantizeFCOpt(
+    "dynamic-quantize-fc",
+    llvm::cl::desc("Quantize the weights of the fully connected nodes at "
+                   "compile time and their activations at runtime, with the "
+                   "range of every run, so that they need no profile."),
+    llvm::cl::init(false));
+
 namespace {
 llvm::cl::OptionCategory loaderCat("Loader Options");
 
@@ -148,6 +176,15 @@ llvm::cl::list<std::string> keepOriginalPrecisionForNodesOpt(
     llvm::cl::value_desc("NodeNames (e.g. Add,Div)"), llvm::cl::ZeroOrMore,
     llvm::cl::CommaSeparated, llvm::cl::cat(loaderCat));
 
+llvm::cl::list<std::string> int16ActivationNodesOpt(
+    "int16-activation-nodes",
+    llvm::cl::desc(
+        "Use to specify the name of nodes (e.g. Convolution, FullyConnected) "
+        "whose activations are quantized to Int16QTy while their weights keep "
+        "the quantization precision, when the backend supports it."),
+    llvm::cl::value_desc("NodeNames (e.g. Convolution,FullyConnected)"),
+    llvm::cl::ZeroOrMore, llvm::cl::CommaSeparated, llvm::cl::cat(loaderCat));
+
 llvm::cl::list<std::string> doNotLowerNodesForProfilingOpt(
     "do-not-lower-nodes-for-profiling",
     llvm::cl::desc(
@@ -172,6 +209,14 @@ llvm::cl::OptionCategory
                    "graphs by writing the IR/Graphs to "
                    "given files/stdout");
 
+llvm::cl::opt<std::string> loadOptimizationPipelineOpt(
+    "load-optimization-pipeline",
+    llvm::cl::desc("Run the graph optimization pipeline of this file instead "
+                   "of the one of the backend, e.g. as tuned by "
+                   "model-compiler -tune-optimization-pipeline"),
+    llvm::cl::value_desc("pipeline.yaml"), llvm::cl::Optional,
+    llvm::cl::cat(loaderCat));
+
 llvm::cl::opt<std::string> dumpGraphDAGFileBeforeCompilationOpt(
     "dump-graph-DAG-before-compile",
     llvm::cl::desc("Specify the file to export the Graph in DOT format"),
@@ -467,17 +512,33 @@ void Loader::compile(CompilationContext &cctx) {
     }
   }
 
-  if (!loadProfileFileOpt.empty()) {
+  if (!loadProfileFileOpt.empty() || dynamicQuantizeFCOpt) {
     precConfig.quantMode = QuantizationMode::Quantize;
     precConfig.quantConfig.precision = quantizationPrecision;
-    precConfig.quantConfig.infos = deserializeFromYaml(loadProfileFileOpt);
+    if (!loadProfileFileOpt.empty()) {
+      precConfig.quantConfig.infos = deserializeFromYaml(loadProfileFileOpt);
+    }
+    precConfig.quantConfig.enableDynamic = dynamicQuantizeFCOpt;
     precConfig.quantConfig.schema = quantizationSchema;
     precConfig.quantConfig.enableRowwise = enableRowwiseOpt;
+    precConfig.quantConfig.fused4BitMaxError = fused4BitMaxErrorOpt;
+    precConfig.quantConfig.minimizeConversions = minimizeConversionsOpt;
+    for (llvm::StringRef kindName : int16ActivationNodesOpt) {
+      precConfig.quantConfig.int16ActivationKinds.insert(
+          getKindFromNodeName(kindName));
+    }
     precConfig.quantConfig.assertAllNodesQuantized = assertAllNodesQuantizedOpt;
   }
 
   precConfig.convertToFP16 = convertToFP16;
 
+  if (!loadOptimizationPipelineOpt.empty() &&
+      !cctx.optimizationOpts.graphOptimizationPipeline) {
+    cctx.optimizationOpts.graphOptimizationPipeline =
+        std::make_shared<const FunctionPassPipeline>(EXIT_ON_ERR(
+            deserializePipelineFromYaml(loadOptimizationPipelineOpt)));
+  }
+
   // Store a raw pointer to the Module, we pass the unique_ptr to HostManager
   // but the Module is stored by Hostmanager so the pointer will remain valid.
   auto module = M_.get();
@@ -580,6 +641,17 @@ void Loader::generateAndSerializeQuantizationInfos(
   serializeToYaml(dumpProfileFileOpt, QI);
 }
 
+void Loader::mergeQuantizationProfiles(
+    PlaceholderBindings &bindings, Loader &other,
+    const PlaceholderBindings &otherBindings) {
+  for (auto F : getModule()->getFunctions()) {
+    Function *otherF = other.getModule()->getFunction(F->getName());
+    CHECK(otherF) << "Profiles of different models can't be merged";
+    quantization::mergeQuantizationProfiles(bindings, F, otherBindings,
+                                            otherF);
+  }
+}
+
 Loader::Loader() {
   if (modelPathOpt.size() == 1) {
     if (llvm::sys::fs::is_directory(*modelPathOpt.begin())) {
@@ -72,6 +72,8 @@ public:
   /// Getter for the hostManager, this can be useful for calling int othe
   /// HostManager directly.
   runtime::HostManager *getHostManager() { return hostManager_.get(); }
+  /// Getter for the backend used for saving bundles and quantization.
+  const Backend &getBackend() const { return *backend_; }
   /// Getter for the Function. This should not be called after compile since the
   /// compile process is destructive on the original function.
   Function *getFunction() { return F_; }
@@ -127,6 +129,12 @@ public:
   /// include quantization profile guided information.
   void generateAndSerializeQuantizationInfos(PlaceholderBindings &bindings);
 
+  /// Merges the profile gathered into \p otherBindings by \p other, a Loader
+  /// of the same model, into the profile gathered into \p bindings, so that
+  /// several Loaders can profile separate inputs in parallel.
+  void mergeQuantizationProfiles(PlaceholderBindings &bindings, Loader &other,
+                                 const PlaceholderBindings &otherBindings);
+
   /// Create the Loader driver object.
   Loader();
 };
@@ -18,23 +18,43 @@
 
 #include "glow/Importer/Caffe2ModelLoader.h"
 #include "glow/Importer/ONNXModelLoader.h"
+#include "glow/Optimizer/GraphOptimizerPipeline/Pipeline.h"
+
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FormatVariadic.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <chrono>
 
 using namespace glow;
 
-int main(int argc, char **argv) {
+namespace {
+llvm::cl::OptionCategory modelCompilerCat("Model Compiler Options");
 
-  // Verify/initialize command line parameters, and then loader initializes
-  // the ExecutionEngine and Function.
-  parseCommandLine(argc, argv);
+llvm::cl::opt<std::string> tunePipelineOpt(
+    "tune-optimization-pipeline",
+    llvm::cl::desc("Instead of emitting a bundle, try orderings of the graph "
+                   "optimization pipeline of the backend on the model, and "
+                   "write the one with the lowest inference latency to this "
+                   "file, for -load-optimization-pipeline"),
+    llvm::cl::value_desc("pipeline.yaml"), llvm::cl::Optional,
+    llvm::cl::cat(modelCompilerCat));
 
-  // Initialize loader.
-  Loader loader;
+llvm::cl::opt<unsigned> tuneRunsOpt(
+    "tune-runs",
+    llvm::cl::desc("Number of inferences timed for every pipeline tried, "
+                   "their median latency is compared"),
+    llvm::cl::Optional, llvm::cl::init(10), llvm::cl::cat(modelCompilerCat));
 
-  // Emit bundle flag should be true.
-  CHECK(emittingBundle())
-      << "Bundle output directory not provided. Use the -emit-bundle option!";
+llvm::cl::opt<unsigned> tuneMaxPipelinesOpt(
+    "tune-max-pipelines",
+    llvm::cl::desc("Maximum number of pipelines tried"), llvm::cl::Optional,
+    llvm::cl::init(64), llvm::cl::cat(modelCompilerCat));
 
-  // Create the model based on the input model format.
+/// Loads the model of the command line into the Function of \p loader.
+/// \returns the model loader.
+std::unique_ptr<ProtobufLoader> loadModel(Loader &loader) {
   std::unique_ptr<ProtobufLoader> LD;
   if (!loader.getCaffe2NetDescFilename().empty()) {
     // For Caffe2 format the input placeholder names/types must be provided
@@ -57,6 +77,106 @@ int main(int argc, char **argv) {
     LD.reset(new ONNXModelLoader(loader.getOnnxModelFilename(), {}, {},
                                  *loader.getFunction()));
   }
+  return LD;
+}
+
+/// Compiles the model with the graph optimization pipeline \p pipeline.
+/// \returns the median latency of tuneRunsOpt inferences, in milliseconds.
+double measureLatency(const FunctionPassPipeline &pipeline) {
+  Loader loader;
+  auto LD = loadModel(loader);
+  PlaceholderBindings bindings;
+  bindings.allocate(loader.getModule()->getPlaceholders());
+
+  CompilationContext cctx{&bindings};
+  cctx.optimizationOpts.graphOptimizationPipeline =
+      std::make_shared<const FunctionPassPipeline>(pipeline);
+  loader.compile(cctx);
+
+  // Warm up, then time the inferences.
+  loader.runInference(bindings);
+  std::vector<double> latencies;
+  for (unsigned i = 0, e = std::max(1u, unsigned(tuneRunsOpt)); i < e; i++) {
+    auto start = std::chrono::steady_clock::now();
+    loader.runInference(bindings);
+    std::chrono::duration<double, std::milli> latency =
+        std::chrono::steady_clock::now() - start;
+    latencies.push_back(latency.count());
+  }
+  std::sort(latencies.begin(), latencies.end());
+  return latencies[latencies.size() / 2];
+}
+
+/// \returns \p pipeline with its passes \p i and \p i + 1 swapped.
+FunctionPassPipeline swapPasses(const FunctionPassPipeline &pipeline,
+                                size_t i) {
+  FunctionPassPipeline swapped;
+  for (size_t j = 0, e = pipeline.size(); j < e; j++) {
+    size_t k = j == i ? i + 1 : j == i + 1 ? i : j;
+    swapped.pushBack(pipeline.at(k));
+  }
+  return swapped;
+}
+
+/// Tries orderings of the graph optimization pipeline of the backend on the
+/// model and writes the fastest one to tunePipelineOpt. Neighboring passes
+/// are swapped in turn, keeping the swaps which lower the latency by more
+/// than the noise of the measurements.
+void tunePipeline() {
+  FunctionPassPipeline best = Loader().getBackend().getOptimizationPipeline();
+  double bestLatency = measureLatency(best);
+  llvm::outs() << llvm::formatv("Backend pipeline: {0:f3} ms\n", bestLatency);
+
+  unsigned numPipelines = 1;
+  for (size_t i = 0; i + 1 < best.size() && numPipelines < tuneMaxPipelinesOpt;
+       i++) {
+    auto first = best.at(i).getFunctionPassID();
+    auto second = best.at(i + 1).getFunctionPassID();
+    if (first == second) {
+      continue;
+    }
+    auto candidate = swapPasses(best, i);
+    double latency = measureLatency(candidate);
+    numPipelines++;
+    llvm::outs() << llvm::formatv("Swapping {0} and {1}: {2:f3} ms\n",
+                                  getNameOfPass(first), getNameOfPass(second),
+                                  latency);
+    // Require a 1% gain, smaller differences are mostly noise.
+    if (latency < 0.99 * bestLatency) {
+      best = std::move(candidate);
+      bestLatency = latency;
+    }
+  }
+
+  llvm::outs() << llvm::formatv("Best pipeline: {0:f3} ms, written to {1}\n",
+                                bestLatency, tunePipelineOpt);
+  EXIT_ON_ERR(serializePipelineToYaml(tunePipelineOpt, best));
+}
+} // namespace
+
+int main(int argc, char **argv) {
+
+  // Verify/initialize command line parameters, and then loader initializes
+  // the ExecutionEngine and Function.
+  parseCommandLine(argc, argv);
+
+  if (!tunePipelineOpt.empty()) {
+    CHECK(!emittingBundle())
+        << "Tuning runs the model instead of emitting a bundle. Emit it with "
+           "the tuned pipeline through -load-optimization-pipeline.";
+    tunePipeline();
+    return 0;
+  }
+
+  // Initialize loader.
+  Loader loader;
+
+  // Emit bundle flag should be true.
+  CHECK(emittingBundle())
+      << "Bundle output directory not provided. Use the -emit-bundle option!";
+
+  // Create the model based on the input model format.
+  auto LD = loadModel(loader);
 
   // Compile the model and generate the bundle.
   CompilationContext ctx;
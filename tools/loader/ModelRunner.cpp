@@ -20,12 +20,213 @@
 #include "glow/Importer/Caffe2ModelLoader.h"
 #include "glow/Importer/ONNXModelLoader.h"
 
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/FormatVariadic.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
+#include <thread>
 
 using namespace glow;
 
+namespace {
+llvm::cl::OptionCategory modelRunnerCat("Model Runner Options");
+
+llvm::cl::list<unsigned> loadConcurrency(
+    "load-concurrency",
+    llvm::cl::desc("Comma separated list of numbers of requests to keep in "
+                   "flight through the HostManager. Every level is run for "
+                   "-load-requests requests and its throughput and latency "
+                   "percentiles are reported."),
+    llvm::cl::ZeroOrMore, llvm::cl::CommaSeparated,
+    llvm::cl::cat(modelRunnerCat));
+
+llvm::cl::opt<double> loadQPS(
+    "load-qps",
+    llvm::cl::desc("Issue the requests at this rate instead of keeping a fixed "
+                   "number in flight. Latencies are measured from the time a "
+                   "request is due, so that queueing delays are included."),
+    llvm::cl::Optional, llvm::cl::init(0), llvm::cl::cat(modelRunnerCat));
+
+llvm::cl::opt<unsigned> loadMaxInflight(
+    "load-max-inflight",
+    llvm::cl::desc("Maximum number of requests in flight with -load-qps"),
+    llvm::cl::Optional, llvm::cl::init(64), llvm::cl::cat(modelRunnerCat));
+
+llvm::cl::opt<unsigned>
+    loadRequests("load-requests",
+                 llvm::cl::desc("Number of requests per load level"),
+                 llvm::cl::Optional, llvm::cl::init(1000),
+                 llvm::cl::cat(modelRunnerCat));
+
+llvm::cl::opt<std::string>
+    loadReportPath("load-report",
+                   llvm::cl::desc("Write the results of the load levels as "
+                                  "JSON to this file"),
+                   llvm::cl::Optional, llvm::cl::cat(modelRunnerCat));
+
+/// The results of a load level.
+struct LoadResult {
+  /// The number of requests kept in flight, or 0 for a target rate.
+  unsigned concurrency;
+  /// The target rate in requests per second, or 0 for a concurrency level.
+  double targetQPS;
+  /// The number of requests run and the time they took, in seconds.
+  size_t requests;
+  double seconds;
+  /// The latency percentiles, in milliseconds.
+  double p50, p90, p99, p999, max;
+};
+
+/// \returns the \p q quantile of the sorted \p latencies.
+double getPercentile(llvm::ArrayRef<double> latencies, double q) {
+  if (latencies.empty()) {
+    return 0;
+  }
+  size_t rank = std::ceil(q * latencies.size());
+  return latencies[std::min(latencies.size(), std::max<size_t>(rank, 1)) - 1];
+}
+
+/// Runs \p numRequests requests of \p name on \p hostManager, each on a
+/// copy of \p bindings. Keeps \p concurrency requests in flight if
+/// \p targetQPS is 0, else issues them at \p targetQPS with up to
+/// \p concurrency in flight. \returns the results.
+LoadResult runLoadLevel(runtime::HostManager *hostManager,
+                        const std::string &name,
+                        const PlaceholderBindings &bindings,
+                        unsigned concurrency, double targetQPS,
+                        size_t numRequests) {
+  using Clock = std::chrono::steady_clock;
+  std::mutex mu;
+  std::condition_variable cv;
+  std::vector<std::unique_ptr<ExecutionContext>> contexts;
+  for (unsigned i = 0; i < concurrency; i++) {
+    contexts.push_back(llvm::make_unique<ExecutionContext>(
+        llvm::make_unique<PlaceholderBindings>(bindings.clone())));
+  }
+  std::vector<double> latencies;
+  latencies.reserve(numRequests);
+
+  auto start = Clock::now();
+  for (size_t i = 0; i < numRequests; i++) {
+    // Wait for a free context, then until the request is due.
+    std::unique_ptr<ExecutionContext> context;
+    {
+      std::unique_lock<std::mutex> lock(mu);
+      cv.wait(lock, [&] { return !contexts.empty(); });
+      context = std::move(contexts.back());
+      contexts.pop_back();
+    }
+    auto due = Clock::now();
+    if (targetQPS > 0) {
+      due = start + std::chrono::duration_cast<Clock::duration>(
+                        std::chrono::duration<double>(i / targetQPS));
+      std::this_thread::sleep_until(due);
+    }
+    hostManager->runNetwork(
+        name, std::move(context),
+        [&, due](runtime::RunIdentifierTy, Error err,
+                 std::unique_ptr<ExecutionContext> contextPtr) {
+          EXIT_ON_ERR(std::move(err));
+          std::chrono::duration<double, std::milli> latency =
+              Clock::now() - due;
+          std::lock_guard<std::mutex> lock(mu);
+          latencies.push_back(latency.count());
+          contexts.push_back(std::move(contextPtr));
+          cv.notify_all();
+        });
+  }
+  {
+    std::unique_lock<std::mutex> lock(mu);
+    cv.wait(lock, [&] { return latencies.size() == numRequests; });
+  }
+  std::chrono::duration<double> elapsed = Clock::now() - start;
+
+  std::sort(latencies.begin(), latencies.end());
+  LoadResult result;
+  result.concurrency = targetQPS > 0 ? 0 : concurrency;
+  result.targetQPS = targetQPS;
+  result.requests = numRequests;
+  result.seconds = elapsed.count();
+  result.p50 = getPercentile(latencies, 0.5);
+  result.p90 = getPercentile(latencies, 0.9);
+  result.p99 = getPercentile(latencies, 0.99);
+  result.p999 = getPercentile(latencies, 0.999);
+  result.max = latencies.empty() ? 0 : latencies.back();
+  return result;
+}
+
+/// Writes \p results as a JSON document to \p path.
+void writeLoadReport(llvm::StringRef path, llvm::StringRef modelName,
+                     llvm::ArrayRef<LoadResult> results, double maxQPS) {
+  std::error_code EC;
+  llvm::raw_fd_ostream os(path, EC, llvm::sys::fs::F_Text);
+  CHECK(!EC) << "Could not open " << path.str() << ": " << EC.message();
+  os << "{\n  \"model\": \"" << modelName << "\",\n";
+  os << llvm::formatv("  \"max_qps\": {0:f2},\n", maxQPS);
+  os << "  \"levels\": [";
+  for (size_t i = 0, e = results.size(); i < e; i++) {
+    const auto &r = results[i];
+    os << (i ? "," : "") << "\n    {";
+    os << llvm::formatv("\"concurrency\": {0}, \"target_qps\": {1:f2}, "
+                        "\"requests\": {2}, \"qps\": {3:f2}, ",
+                        r.concurrency, r.targetQPS, r.requests,
+                        r.requests / r.seconds);
+    os << llvm::formatv("\"p50_ms\": {0:f3}, \"p90_ms\": {1:f3}, "
+                        "\"p99_ms\": {2:f3}, \"p99.9_ms\": {3:f3}, "
+                        "\"max_ms\": {4:f3}}",
+                        r.p50, r.p90, r.p99, r.p999, r.max);
+  }
+  os << "\n  ]\n}\n";
+}
+
+/// Runs the load levels requested on the command line for the compiled model
+/// of \p loader, using copies of \p bindings, and reports the results.
+void runLoadTest(Loader &loader, const PlaceholderBindings &bindings,
+                 llvm::StringRef modelName) {
+  std::vector<LoadResult> results;
+  if (loadQPS > 0) {
+    results.push_back(runLoadLevel(loader.getHostManager(),
+                                   loader.getFunctionName(), bindings,
+                                   std::max(1u, unsigned(loadMaxInflight)),
+                                   loadQPS, loadRequests));
+  } else {
+    for (auto concurrency : loadConcurrency) {
+      results.push_back(runLoadLevel(
+          loader.getHostManager(), loader.getFunctionName(), bindings,
+          std::max(1u, concurrency), /* targetQPS */ 0, loadRequests));
+    }
+  }
+
+  double maxQPS = 0;
+  llvm::outs() << "Model: " << modelName << "\n";
+  for (const auto &r : results) {
+    double qps = r.requests / r.seconds;
+    maxQPS = std::max(maxQPS, qps);
+    if (r.concurrency) {
+      llvm::outs() << llvm::formatv("Concurrency {0,4}:", r.concurrency);
+    } else {
+      llvm::outs() << llvm::formatv("Target {0:f1} QPS:", r.targetQPS);
+    }
+    llvm::outs() << llvm::formatv(
+        " {0:f2} QPS, latency (ms) p50 {1:f3} p90 {2:f3} p99 {3:f3} "
+        "p99.9 {4:f3} max {5:f3}\n",
+        qps, r.p50, r.p90, r.p99, r.p999, r.max);
+  }
+  llvm::outs() << llvm::formatv("Max throughput: {0:f2} QPS\n", maxQPS);
+
+  if (!loadReportPath.empty()) {
+    writeLoadReport(loadReportPath, modelName, results, maxQPS);
+  }
+}
+} // namespace
+
 int main(int argc, char **argv) {
   PlaceholderBindings bindings;
   // Verify/initialize command line parameters, and then loader initializes
@@ -60,6 +261,13 @@ int main(int argc, char **argv) {
   cctx.optimizationOpts.enableConstantFolding = false;
   loader.compile(cctx);
 
+  // Run the load test instead of a single inference if requested.
+  if (!emittingBundle() && (loadQPS > 0 || !loadConcurrency.empty())) {
+    CHECK(!profilingGraph()) << "Cannot gather a profile under load.";
+    runLoadTest(loader, bindings, modelName);
+    return 0;
+  }
+
   // If in bundle mode, do not run inference.
   if (!emittingBundle()) {
     loader.runInference(bindings);
@@ -23,6 +23,7 @@
 
 #include <fstream>
 #include <iostream>
+#include <list>
 #include <sstream>
 
 using namespace glow;
@@ -54,6 +55,33 @@ llvm::cl::opt<double>
                                     "highest likelihood output sentence."),
                      llvm::cl::Optional, llvm::cl::init(0.0f),
                      llvm::cl::cat(textTranslatorCat));
+
+llvm::cl::opt<std::string> decoderStepNetDescOpt(
+    "decoder-step-net-desc",
+    llvm::cl::desc("Caffe2 network of one step of the decoder. When it is "
+                   "set the model is the encoder, which runs once per "
+                   "sentence, and the decoder runs step by step until all "
+                   "the hypotheses end."),
+    llvm::cl::Optional, llvm::cl::cat(textTranslatorCat));
+
+llvm::cl::opt<std::string> decoderStepNetWeightsOpt(
+    "decoder-step-net-weights",
+    llvm::cl::desc("Caffe2 weights of -decoder-step-net-desc."),
+    llvm::cl::Optional, llvm::cl::cat(textTranslatorCat));
+
+llvm::cl::list<std::string> decoderStepStatesOpt(
+    "decoder-step-states",
+    llvm::cl::desc("Outputs of the decoder step that are its inputs at the "
+                   "next step, as output:input."),
+    llvm::cl::CommaSeparated, llvm::cl::ZeroOrMore,
+    llvm::cl::cat(textTranslatorCat));
+
+llvm::cl::opt<unsigned> encoderCacheSizeOpt(
+    "encoder-cache-size",
+    llvm::cl::desc("Number of sentences whose encoder outputs are kept for "
+                   "the next requests of the same sentence, in the "
+                   "step-wise decoding mode."),
+    llvm::cl::Optional, llvm::cl::init(16), llvm::cl::cat(textTranslatorCat));
 } // namespace
 
 /// These should be kept in sync with pytorch_translate/vocab_constants.py
@@ -178,11 +206,13 @@ static bool loadNextInputTranslationText(Tensor *encoderInputs) {
 
 /// Find and return a vector of the best translation given the outputs from the
 /// model \p outputTokenBeamList, \p outputScoreBeamList, and \p
-/// outputPrevIndexBeamList. A translation is made up of a vector of tokens
-/// which must be converted back to words from via the destination dictionary.
+/// outputPrevIndexBeamList, of which the first \p outputLen steps were
+/// decoded. A translation is made up of a vector of tokens which must be
+/// converted back to words from via the destination dictionary.
 static std::vector<size_t> getBestTranslation(Tensor *outputTokenBeamList,
                                               Tensor *outputScoreBeamList,
-                                              Tensor *outputPrevIndexBeamList) {
+                                              Tensor *outputPrevIndexBeamList,
+                                              size_t outputLen) {
   // Get handles to all the outputs from the model run.
   auto tokenBeamListH = outputTokenBeamList->getHandle<int64_t>();
   auto scoreBeamListH = outputScoreBeamList->getHandle<float>();
@@ -198,7 +228,7 @@ static std::vector<size_t> getBestTranslation(Tensor *outputTokenBeamList,
   // already ended.
   std::vector<bool> prevHypoIsFinished(beamSizeOpt, false);
   std::vector<bool> currentHypoIsFinished(beamSizeOpt, false);
-  for (size_t lengthIndex = 0; lengthIndex < maxOutputLenOpt; ++lengthIndex) {
+  for (size_t lengthIndex = 0; lengthIndex < outputLen; ++lengthIndex) {
     for (size_t hypoIndex = 0; hypoIndex < beamSizeOpt; ++hypoIndex) {
       // If the current hypothesis was already scored and compared to the best,
       // we can skip it and move onto the next one.
@@ -212,7 +242,7 @@ static std::vector<size_t> getBestTranslation(Tensor *outputTokenBeamList,
       // the max output length, then we cannot yet score/compare it, so keep
       // going until we reach the end.
       if (tokenBeamListH.at({lengthIndex, hypoIndex}) != eosIdx &&
-          lengthIndex + 1 != maxOutputLenOpt) {
+          lengthIndex + 1 != outputLen) {
         continue;
       }
 
@@ -262,13 +292,16 @@ static std::vector<size_t> getBestTranslation(Tensor *outputTokenBeamList,
 
 /// Queries getBestTranslation() for the best translation via the outputs from
 /// the model, \p outputTokenBeamList, \p outputScoreBeamList, and \p
-/// outputPrevIndexBeamList. Then converts each of the tokens from the returned
-/// best translation into words from the dest dictionary, and prints it.
+/// outputPrevIndexBeamList, of which the first \p outputLen steps were
+/// decoded. Then converts each of the tokens from the returned best
+/// translation into words from the dest dictionary, and prints it.
 static void processAndPrintDecodedTranslation(Tensor *outputTokenBeamList,
                                               Tensor *outputScoreBeamList,
-                                              Tensor *outputPrevIndexBeamList) {
-  std::vector<size_t> translationTokens = getBestTranslation(
-      outputTokenBeamList, outputScoreBeamList, outputPrevIndexBeamList);
+                                              Tensor *outputPrevIndexBeamList,
+                                              size_t outputLen) {
+  std::vector<size_t> translationTokens =
+      getBestTranslation(outputTokenBeamList, outputScoreBeamList,
+                         outputPrevIndexBeamList, outputLen);
 
   // Use the dest dictionary to convert tokens to words, and print it.
   for (size_t i = 0; i < translationTokens.size(); i++) {
@@ -288,6 +321,222 @@ static void processAndPrintDecodedTranslation(Tensor *outputTokenBeamList,
   llvm::outs() << "\n\n";
 }
 
+/// The networks of the step-wise decoding mode. The encoder has the input
+/// "encoder_inputs". The decoder step has the inputs "prev_tokens",
+/// "prev_scores" and "timestep", and one input per output of the encoder with
+/// the same name, e.g. the encoder outputs and the initial states. It has the
+/// outputs "best_tokens", "best_scores" and "prev_hypos_indices" of the beam,
+/// and the states of -decoder-step-states.
+struct StepDecoder {
+  /// Name of the decoder step network.
+  std::string name;
+  Placeholder *encoderInputs;
+  Placeholder *prevTokens;
+  Placeholder *prevScores;
+  Placeholder *timestep;
+  Placeholder *bestTokens;
+  Placeholder *bestScores;
+  Placeholder *prevHyposIndices;
+  /// The outputs of the encoder and the inputs of the decoder they feed.
+  std::vector<std::pair<Placeholder *, Placeholder *>> encoderOutputs;
+  /// The outputs of the decoder and the inputs they feed at the next step.
+  std::vector<std::pair<Placeholder *, Placeholder *>> states;
+  /// The encoder outputs of the last sentences, oldest first.
+  std::list<std::pair<std::vector<int64_t>, std::vector<Tensor>>> cache;
+};
+
+/// Loads the encoder from the model of \p loader and the decoder step of
+/// -decoder-step-net-desc into its Module. \returns their placeholders.
+static StepDecoder loadStepDecoder(Loader &loader) {
+  CHECK(!loader.getCaffe2NetDescFilename().empty())
+      << "Only supporting Caffe2 currently.";
+  StepDecoder D;
+  Tensor encoderInputs(ElemKind::Int64ITy, {maxInputLenOpt, /* batchSize */ 1});
+  const char *encoderInputNames[] = {"encoder_inputs"};
+  Caffe2ModelLoader encoderLD(
+      loader.getCaffe2NetDescFilename(), loader.getCaffe2NetWeightFilename(),
+      encoderInputNames, {&encoderInputs.getType()}, *loader.getFunction());
+  D.encoderInputs = llvm::cast<Placeholder>(
+      EXIT_ON_ERR(encoderLD.getNodeValueByName("encoder_inputs")));
+
+  // The decoder step takes the outputs of the encoder by name.
+  Tensor prevTokens(ElemKind::Int64ITy, {beamSizeOpt});
+  Tensor prevScores(ElemKind::FloatTy, {beamSizeOpt});
+  Tensor timestep(ElemKind::Int64ITy, {1});
+  std::vector<std::string> names = {"prev_tokens", "prev_scores", "timestep"};
+  std::vector<TypeRef> types = {&prevTokens.getType(), &prevScores.getType(),
+                                &timestep.getType()};
+  for (const auto &output : encoderLD.getOutputVarsMapping()) {
+    names.push_back(output.first());
+    types.push_back(output.second->getType());
+  }
+  std::vector<const char *> inputNames;
+  for (const auto &name : names) {
+    inputNames.push_back(name.c_str());
+  }
+
+  D.name = "decoder_step";
+  Function *decoderF = loader.getModule()->createFunction(D.name);
+  Caffe2ModelLoader decoderLD(decoderStepNetDescOpt, decoderStepNetWeightsOpt,
+                              inputNames, types, *decoderF);
+  auto getInput = [&](llvm::StringRef name) {
+    return llvm::cast<Placeholder>(
+        EXIT_ON_ERR(decoderLD.getNodeValueByName(name)));
+  };
+  D.prevTokens = getInput("prev_tokens");
+  D.prevScores = getInput("prev_scores");
+  D.timestep = getInput("timestep");
+  D.bestTokens = EXIT_ON_ERR(decoderLD.getOutputByName("best_tokens"));
+  D.bestScores = EXIT_ON_ERR(decoderLD.getOutputByName("best_scores"));
+  D.prevHyposIndices =
+      EXIT_ON_ERR(decoderLD.getOutputByName("prev_hypos_indices"));
+  for (const auto &output : encoderLD.getOutputVarsMapping()) {
+    D.encoderOutputs.emplace_back(output.second, getInput(output.first()));
+  }
+  for (llvm::StringRef state : decoderStepStatesOpt) {
+    auto outputAndInput = state.split(':');
+    CHECK(!outputAndInput.second.empty())
+        << "Decoder step states are output:input, not " << state.str();
+    D.states.emplace_back(
+        EXIT_ON_ERR(decoderLD.getOutputByName(outputAndInput.first)),
+        getInput(outputAndInput.second));
+    CHECK(D.states.back().first->getType()->isEqual(
+        D.states.back().second->getType()))
+        << "The decoder step state " << state.str() << " changes its type";
+  }
+  return D;
+}
+
+/// Runs the encoder of \p D on the sentence \p encoderInputs with
+/// \p bindings, unless its outputs are in the cache of \p D, and binds them
+/// to the inputs of the decoder step.
+static void runEncoder(Loader &loader, PlaceholderBindings &bindings,
+                       StepDecoder &D, Tensor &encoderInputs) {
+  auto IH = encoderInputs.getHandle<int64_t>();
+  std::vector<int64_t> key(IH.size());
+  for (size_t i = 0, e = key.size(); i < e; i++) {
+    key[i] = IH.raw(i);
+  }
+  auto cached = std::find_if(D.cache.begin(), D.cache.end(),
+                             [&](const std::pair<std::vector<int64_t>,
+                                                 std::vector<Tensor>> &entry) {
+                               return entry.first == key;
+                             });
+  if (cached == D.cache.end()) {
+    updateInputPlaceholders(bindings, {D.encoderInputs}, {&encoderInputs});
+    loader.runInference(bindings);
+    if (encoderCacheSizeOpt == 0) {
+      for (const auto &output : D.encoderOutputs) {
+        bindings.get(output.second)->assign(bindings.get(output.first));
+      }
+      return;
+    }
+    if (D.cache.size() == encoderCacheSizeOpt) {
+      D.cache.pop_front();
+    }
+    std::vector<Tensor> outputs;
+    for (const auto &output : D.encoderOutputs) {
+      outputs.push_back(bindings.get(output.first)->clone());
+    }
+    cached = D.cache.emplace(D.cache.end(), std::move(key), std::move(outputs));
+  }
+  for (size_t i = 0, e = D.encoderOutputs.size(); i < e; i++) {
+    bindings.get(D.encoderOutputs[i].second)->assign(&cached->second[i]);
+  }
+}
+
+/// Decodes the sentence that the encoder of \p D ran on step by step with
+/// \p bindings into the beam lists \p tokenBeamList, \p scoreBeamList and
+/// \p prevIndexBeamList, until all the hypotheses end or -max-output-len is
+/// reached. \returns the number of rows of the beam lists that were decoded.
+static size_t decodeStepwise(Loader &loader, PlaceholderBindings &bindings,
+                             StepDecoder &D, Tensor &tokenBeamList,
+                             Tensor &scoreBeamList, Tensor &prevIndexBeamList) {
+  auto tokenBeamListH = tokenBeamList.getHandle<int64_t>();
+  auto scoreBeamListH = scoreBeamList.getHandle<float>();
+  auto prevIndexBeamListH = prevIndexBeamList.getHandle<int64_t>();
+
+  // All the hypotheses start from the end of sentence token.
+  bindings.get(D.prevTokens)->getHandle<int64_t>().clear(eosIdx);
+  bindings.get(D.prevScores)->zero();
+  for (size_t hypoIndex = 0; hypoIndex < beamSizeOpt; ++hypoIndex) {
+    tokenBeamListH.at({0, hypoIndex}) = eosIdx;
+    scoreBeamListH.at({0, hypoIndex}) = 0;
+    prevIndexBeamListH.at({0, hypoIndex}) = 0;
+  }
+
+  std::vector<bool> prevHypoIsFinished(beamSizeOpt, false);
+  std::vector<bool> currentHypoIsFinished(beamSizeOpt, false);
+  size_t lengthIndex = 1;
+  while (lengthIndex < maxOutputLenOpt) {
+    bindings.get(D.timestep)->getHandle<int64_t>().raw(0) = lengthIndex - 1;
+    EXIT_ON_ERR(
+        loader.getHostManager()->runNetworkBlocking(D.name, bindings));
+
+    auto bestTokensH = bindings.get(D.bestTokens)->getHandle<int64_t>();
+    auto bestScoresH = bindings.get(D.bestScores)->getHandle<float>();
+    auto prevHyposIndicesH =
+        bindings.get(D.prevHyposIndices)->getHandle<int64_t>();
+    bool allFinished = true;
+    for (size_t hypoIndex = 0; hypoIndex < beamSizeOpt; ++hypoIndex) {
+      tokenBeamListH.at({lengthIndex, hypoIndex}) = bestTokensH.raw(hypoIndex);
+      scoreBeamListH.at({lengthIndex, hypoIndex}) = bestScoresH.raw(hypoIndex);
+      size_t prevIndex = prevHyposIndicesH.raw(hypoIndex);
+      prevIndexBeamListH.at({lengthIndex, hypoIndex}) = prevIndex;
+      currentHypoIsFinished[hypoIndex] = prevHypoIsFinished[prevIndex] ||
+                                         bestTokensH.raw(hypoIndex) == eosIdx;
+      allFinished &= currentHypoIsFinished[hypoIndex];
+    }
+    prevHypoIsFinished.swap(currentHypoIsFinished);
+    lengthIndex++;
+    if (allFinished) {
+      break;
+    }
+
+    // The outputs of this step are the inputs of the next one. The states
+    // are swapped rather than copied, since the next step overwrites the
+    // outputs anyway.
+    bindings.get(D.prevTokens)->assign(bindings.get(D.bestTokens));
+    bindings.get(D.prevScores)->assign(bindings.get(D.bestScores));
+    for (const auto &state : D.states) {
+      std::swap(*bindings.get(state.first), *bindings.get(state.second));
+    }
+  }
+  return lengthIndex;
+}
+
+/// Translates the sentences of std::cin with the encoder and the decoder step
+/// of \p loader, see StepDecoder.
+static void runStepwiseTranslation(Loader &loader) {
+  StepDecoder D = loadStepDecoder(loader);
+
+  PlaceholderBindings bindings;
+  bindings.allocate(loader.getModule()->getPlaceholders());
+  for (auto &PHAndTensor : bindings.pairs()) {
+    PHAndTensor.second->zero();
+  }
+
+  loader.compile(bindings);
+
+  DCHECK(!emittingBundle()) << "Bundle mode has not been tested.";
+
+  Tensor encoderInputs(ElemKind::Int64ITy, {maxInputLenOpt, /* batchSize */ 1});
+  Tensor tokenBeamList(ElemKind::Int64ITy, {maxOutputLenOpt, beamSizeOpt});
+  Tensor scoreBeamList(ElemKind::FloatTy, {maxOutputLenOpt, beamSizeOpt});
+  Tensor prevIndexBeamList(ElemKind::Int64ITy, {maxOutputLenOpt, beamSizeOpt});
+  while (loadNextInputTranslationText(&encoderInputs)) {
+    runEncoder(loader, bindings, D, encoderInputs);
+    size_t outputLen = decodeStepwise(loader, bindings, D, tokenBeamList,
+                                      scoreBeamList, prevIndexBeamList);
+    processAndPrintDecodedTranslation(&tokenBeamList, &scoreBeamList,
+                                      &prevIndexBeamList, outputLen);
+  }
+
+  if (profilingGraph()) {
+    loader.generateAndSerializeQuantizationInfos(bindings);
+  }
+}
+
 int main(int argc, char **argv) {
   PlaceholderBindings bindings;
 
@@ -301,6 +550,11 @@ int main(int argc, char **argv) {
   srcVocab.loadDictionaryFromFile(modelDir.str() + "/src_dictionary.txt");
   dstVocab.loadDictionaryFromFile(modelDir.str() + "/dst_dictionary.txt");
 
+  if (!decoderStepNetDescOpt.empty()) {
+    runStepwiseTranslation(loader);
+    return 0;
+  }
+
   // Encoded input sentence. Note that the batch size is 1 for inference models.
   Tensor encoderInputs(ElemKind::Int64ITy, {maxInputLenOpt, /* batchSize */ 1});
 
@@ -362,9 +616,9 @@ int main(int argc, char **argv) {
 
     // Process the outputs to determine the highest likelihood sentence, and
     // print out the decoded translation using the dest dictionary.
-    processAndPrintDecodedTranslation(bindings.get(outputTokenBeamList),
-                                      bindings.get(outputScoreBeamList),
-                                      bindings.get(outputPrevIndexBeamList));
+    processAndPrintDecodedTranslation(
+        bindings.get(outputTokenBeamList), bindings.get(outputScoreBeamList),
+        bindings.get(outputPrevIndexBeamList), maxOutputLenOpt);
   }
 
   // If profiling, generate and serialize the quantization infos now that we
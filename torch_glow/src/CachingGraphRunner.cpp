@@ -18,9 +18,11 @@
 
 #include "glow/Support/Support.h"
 
+#include <atomic>
 #include <mutex>
 #include <torch/csrc/jit/argument_spec.h>
 #include <torch/csrc/utils/hash.h>
+#include <unordered_map>
 
 namespace glow {
 // TODO: this should also return the list of TensorTypes used to compute the
@@ -43,12 +45,72 @@ size_t CachingGraphRunner::computeGraphHash(
   return hash;
 }
 
+std::vector<CachingGraphRunner::InputSignature>
+CachingGraphRunner::computeInputSignatures(
+    const c10::ArrayRef<c10::IValue> inputs) {
+  std::vector<InputSignature> signatures(inputs.size());
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    if (!inputs[i].isTensor()) {
+      continue;
+    }
+    const auto &t = inputs[i].toTensor();
+    auto &signature = signatures[i];
+    signature.isTensor = true;
+    signature.scalarType = t.scalar_type();
+    signature.device = t.device();
+    signature.requiresGrad = t.requires_grad();
+    signature.sizes = t.sizes().vec();
+    signature.strides = t.strides().vec();
+  }
+  return signatures;
+}
+
+bool CachingGraphRunner::matchInputSignatures(
+    const c10::ArrayRef<c10::IValue> inputs,
+    llvm::ArrayRef<InputSignature> signatures) {
+  if (inputs.size() != signatures.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    const auto &signature = signatures[i];
+    if (inputs[i].isTensor() != signature.isTensor) {
+      return false;
+    }
+    if (!signature.isTensor) {
+      continue;
+    }
+    const auto &t = inputs[i].toTensor();
+    if (t.scalar_type() != signature.scalarType ||
+        t.device() != signature.device ||
+        t.requires_grad() != signature.requiresGrad ||
+        t.sizes() != c10::IntArrayRef(signature.sizes) ||
+        t.strides() != c10::IntArrayRef(signature.strides)) {
+      return false;
+    }
+  }
+  return true;
+}
+
 namespace {
 static std::mutex graphCacheMutex;
+
+/// Source of the ids of the CachingGraphRunners.
+static std::atomic<uint64_t> nextRunnerId{0};
+} // namespace
+
+CachingGraphRunner::LastRun &CachingGraphRunner::getLastRun() const {
+  thread_local std::unordered_map<uint64_t, LastRun> lastRuns;
+  return lastRuns[id_];
 }
 
 Expected<CachingGraphRunner::PerGlowGraphInfo *>
-CachingGraphRunner::loadImpl(torch::jit::Stack &stack) {
+CachingGraphRunner::loadImpl(torch::jit::Stack &stack, LastRun &lastRun) {
+  // Inputs of the same types as the last run of the thread run the same Glow
+  // function, which is found without hashing nor locking.
+  if (lastRun.info && matchInputSignatures(stack, lastRun.inputs)) {
+    return lastRun.info;
+  }
+
   const auto inputs = torch::jit::last(stack, graph_->inputs().size());
 
   size_t hash = computeGraphHash(stack);
@@ -56,57 +118,128 @@ CachingGraphRunner::loadImpl(torch::jit::Stack &stack) {
   // If we already have a Glow function compiled for this graph with and the
   // given inputs then use that.
   std::lock_guard<std::mutex> guard(graphCacheMutex);
+  lastRun.info = nullptr;
+  lastRun.outputs.clear();
   auto it = perGlowGraphInfoMap_.find(hash);
   if (it != perGlowGraphInfoMap_.end()) {
-    return it->second.get();
+    auto *info = it->second.get();
+    switch (info->state.load()) {
+    case PerGlowGraphInfo::State::Ready:
+      lastRun.inputs = computeInputSignatures(stack);
+      lastRun.info = info;
+      return info;
+    case PerGlowGraphInfo::State::Compiling:
+      return nullptr;
+    case PerGlowGraphInfo::State::Failed:
+      return MAKE_ERR(info->compileError);
+    }
   }
 
   auto info = std::make_shared<PerGlowGraphInfo>();
   info->functionName = strFormat("PTFunction%lu", hash);
 
+  // Compile in the background while this and the next runs of the same input
+  // types go to the PyTorch JIT interpreter. The inputs are kept for the
+  // shapes of their tensors.
+  if (getPyTorchLoaderSettings().asyncCompilationEnabled && canRunFallback()) {
+    if (!fallbackCode_) {
+      fallbackCode_ = llvm::make_unique<torch::jit::Code>(graph_->copy(),
+                                                          "glow_fallback");
+      compilePool_ = llvm::make_unique<ThreadPool>(1);
+    }
+    info->state = PerGlowGraphInfo::State::Compiling;
+    std::vector<c10::IValue> inputsCopy(inputs.begin(), inputs.end());
+    compilePool_->submit([this, info, inputsCopy]() {
+      if (auto err = compileImpl(*info, inputsCopy)) {
+        info->compileError = ERR_TO_STRING(std::move(err));
+        LOG(ERROR) << "Failed to compile " << info->functionName << ": "
+                   << info->compileError;
+        info->state = PerGlowGraphInfo::State::Failed;
+      } else {
+        info->state = PerGlowGraphInfo::State::Ready;
+      }
+    });
+    perGlowGraphInfoMap_[hash] = std::move(info);
+    return nullptr;
+  }
+
+  RETURN_IF_ERR(compileImpl(*info, inputs));
+
+  perGlowGraphInfoMap_[hash] = std::move(info);
+
+  lastRun.inputs = computeInputSignatures(stack);
+  lastRun.info = perGlowGraphInfoMap_[hash].get();
+  return lastRun.info;
+}
+
+Error CachingGraphRunner::compileImpl(
+    PerGlowGraphInfo &info, c10::ArrayRef<c10::IValue> inputs) const {
   std::unique_ptr<Module> module = llvm::make_unique<Module>();
-  Function *f = module->createFunction(info->functionName);
+  Function *f = module->createFunction(info.functionName);
 
   RETURN_IF_ERR(PyTorchModelLoader::loadJITGraph(
-      *f, *graph_, info->inputPlaceholders, info->outputPlaceholders,
+      *f, *graph_, info.inputPlaceholders, info.outputPlaceholders,
       getPyTorchLoaderSettings(), inputs, {}));
 
   glow::CompilationContext cctx;
 
-  RETURN_IF_ERR(hostManager_->addNetwork(std::move(module), cctx));
-
-  perGlowGraphInfoMap_[hash] = std::move(info);
+  return hostManager_->addNetwork(std::move(module), cctx);
+}
 
-  return perGlowGraphInfoMap_[hash].get();
+bool CachingGraphRunner::canRunFallback() const {
+  for (const auto *node : graph_->nodes()) {
+    if (llvm::StringRef(node->kind().toQualString()).startswith("glow::")) {
+      return false;
+    }
+  }
+  return true;
 }
 
-Error CachingGraphRunner::runImpl(const PerGlowGraphInfo &info,
-                                  torch::jit::Stack &stack) const {
+Error CachingGraphRunner::runImpl(
+    const PerGlowGraphInfo &info, torch::jit::Stack &stack,
+    std::vector<at::Tensor> *reusableOutputs) const {
   size_t numInputs = info.inputPlaceholders.size();
   const auto inputs = torch::jit::last(stack, numInputs);
 
   std::unique_ptr<ExecutionContext> ctx = llvm::make_unique<ExecutionContext>();
   auto *bindings = ctx->getPlaceholderBindings();
 
+  // The inputs are bound in place when their layout allows it, and copied
+  // otherwise. They are still on the stack, so outlive the run.
   for (size_t i = 0; i < numInputs; ++i) {
     glow::Placeholder *ph = info.inputPlaceholders[i];
     glow::TypeRef ty = ph->getType();
-    glow::Tensor t(inputs[i].toTensor().data_ptr(), ty);
-    bindings->insert(ph, std::move(t));
+    const at::Tensor &ptTensor = inputs[i].toTensor();
+    RETURN_ERR_IF_NOT(ptTensor.nbytes() == ty->getSizeInBytes(),
+                      strFormat("Input %lu has %lu bytes, expected %lu.", i,
+                                size_t(ptTensor.nbytes()),
+                                size_t(ty->getSizeInBytes())));
+    bindings->insert(ph, ptTensorToGlowTensor(ptTensor, ty));
   }
 
-  std::vector<at::IValue> outputs;
-  for (auto *ph : info.outputPlaceholders) {
-    std::vector<int64_t> sizes;
-    for (auto size : ph->dims()) {
-      sizes.push_back(static_cast<int64_t>(size));
+  size_t numOutputs = info.outputPlaceholders.size();
+  std::vector<at::Tensor> outputs(numOutputs);
+  if (reusableOutputs) {
+    reusableOutputs->resize(numOutputs);
+  }
+  for (size_t i = 0; i < numOutputs; ++i) {
+    glow::Placeholder *ph = info.outputPlaceholders[i];
+
+    // An output of an earlier run can be overwritten once the caller no
+    // longer holds it, in which case its storage is only referenced here.
+    if (reusableOutputs && (*reusableOutputs)[i].defined() &&
+        (*reusableOutputs)[i].storage().use_count() == 1) {
+      outputs[i] = (*reusableOutputs)[i];
+    } else {
+      outputs[i] = glowTypeToEmptyPTTensor(*ph->getType());
+      if (reusableOutputs) {
+        (*reusableOutputs)[i] = outputs[i];
+      }
     }
 
-    auto ptT = glowTypeToEmptyPTTensor(*ph->getType());
-
-    glow::Tensor t(ptT.data_ptr(), ph->getType());
-
-    outputs.push_back(std::move(ptT));
+    // Glow writes the outputs into their PyTorch Tensors directly.
+    DCHECK(isPTTensorBindable(outputs[i]));
+    glow::Tensor t(outputs[i].data_ptr(), ph->getType());
     bindings->insert(ph, std::move(t));
   }
 
@@ -116,7 +249,7 @@ Error CachingGraphRunner::runImpl(const PerGlowGraphInfo &info,
   torch::jit::drop(stack, numInputs);
 
   for (auto &output : outputs) {
-    auto var = torch::autograd::make_variable(output.toTensor());
+    auto var = torch::autograd::make_variable(std::move(output));
     stack.push_back(at::IValue(var));
   }
 
@@ -124,9 +257,15 @@ Error CachingGraphRunner::runImpl(const PerGlowGraphInfo &info,
 }
 
 Error CachingGraphRunner::run(torch::jit::Stack &stack) {
+  auto &lastRun = getLastRun();
   PerGlowGraphInfo *info;
-  ASSIGN_VALUE_OR_RETURN_ERR(info, loadImpl(stack));
-  return runImpl(*DCHECK_NOTNULL(info), stack);
+  ASSIGN_VALUE_OR_RETURN_ERR(info, loadImpl(stack, lastRun));
+  if (!info) {
+    // The Glow function for these inputs is still compiling.
+    torch::jit::InterpreterState(*fallbackCode_).run(stack);
+    return Error::success();
+  }
+  return runImpl(*info, stack, &lastRun.outputs);
 }
 
 Error CachingGraphRunner::run(const std::string &key,
@@ -202,16 +341,21 @@ CachingGraphRunner *CachingGraphRunner::getCachingGraphRunner() {
 }
 
 CachingGraphRunner::CachingGraphRunner()
-    : hostManager_(glow::getHostManager()) {}
+    : id_(nextRunnerId++), hostManager_(glow::getHostManager()) {}
 
 CachingGraphRunner::CachingGraphRunner(torch::jit::Graph *graph,
                                        runtime::HostManager *hostManager)
-    : graph_(graph), hostManager_(hostManager) {}
+    : id_(nextRunnerId++), graph_(graph), hostManager_(hostManager) {}
 
 CachingGraphRunner::~CachingGraphRunner() {
+  // Wait for the functions being compiled in the background.
+  compilePool_.reset();
+
   // Remove Glow functions saved in HostManager when being destroyed.
   for (auto &kv : perGlowGraphInfoMap_) {
-    ERR_TO_BOOL(hostManager_->removeNetwork(kv.second->functionName));
+    if (kv.second->state == PerGlowGraphInfo::State::Ready) {
+      ERR_TO_BOOL(hostManager_->removeNetwork(kv.second->functionName));
+    }
   }
   for (auto &kv : glowGraphInfoMap) {
     ERR_TO_BOOL(hostManager_->removeNetwork(kv.second->functionName));
@@ -19,12 +19,16 @@
 
 #include "PyTorchModelLoader.h"
 #include "glow/Runtime/HostManager/HostManager.h"
+#include "glow/Support/ThreadPool.h"
 
 #include <torch/csrc/jit/custom_operator.h>
+#include <torch/csrc/jit/interpreter.h>
 #include <torch/csrc/jit/ir.h>
 
 #include <torch/csrc/jit/import.h>
 
+#include <atomic>
+
 namespace glow {
 
 /// For a given PyTorch JIT graph, this class is responsible for maintaining a
@@ -40,8 +44,44 @@ class CachingGraphRunner {
 
     /// Name of the Glow function maintained by HostManager for this subgraph.
     std::string functionName;
+
+    /// Whether the Glow function is compiled, is being compiled in the
+    /// background, or failed to compile in the background.
+    enum class State { Ready, Compiling, Failed };
+    std::atomic<State> state{State::Ready};
+
+    /// Why the Glow function failed to compile.
+    std::string compileError;
+  };
+
+  /// The type of an input of a run, which is all that computeGraphHash
+  /// looks at.
+  struct InputSignature {
+    bool isTensor = false;
+    c10::ScalarType scalarType = c10::ScalarType::Undefined;
+    c10::Device device = c10::kCPU;
+    bool requiresGrad = false;
+    std::vector<int64_t> sizes;
+    std::vector<int64_t> strides;
+  };
+
+  /// What a thread keeps of its last run of the graph. The next run of the
+  /// thread with inputs of the same types runs the same Glow function without
+  /// hashing its inputs, and reuses the output tensors that the caller has
+  /// released.
+  struct LastRun {
+    /// The types of the inputs of the last run.
+    std::vector<InputSignature> inputs;
+    /// The Glow function the inputs ran, or nullptr before the first run.
+    PerGlowGraphInfo *info = nullptr;
+    /// The output tensors of the last run.
+    std::vector<at::Tensor> outputs;
   };
 
+  /// Unique id of the CachingGraphRunner, which identifies its LastRun in
+  /// the thread local storage of threads.
+  const uint64_t id_;
+
   /// The PyTorch JIT Graph that this CachingGraphRunner caches Glow functions
   /// for.
   torch::jit::Graph *graph_ = nullptr;
@@ -49,6 +89,13 @@ class CachingGraphRunner {
   /// The HostManager used to store and run Glow graphs.
   runtime::HostManager *hostManager_ = nullptr;
 
+  /// graph_ compiled for the PyTorch JIT interpreter, which runs it while
+  /// its Glow function for new input types is compiled in the background.
+  std::unique_ptr<torch::jit::Code> fallbackCode_;
+
+  /// The thread compiling Glow functions in the background.
+  std::unique_ptr<ThreadPool> compilePool_;
+
   // Mapping from module name to PerGlowGraphInfo. Here we assume one method
   // each module, which should be the common case for accelerator modules.
   std::unordered_map<std::string, std::shared_ptr<PerGlowGraphInfo>>
@@ -65,16 +112,46 @@ class CachingGraphRunner {
   /// info is returned immediately. Otherwise this loads the
   /// subgraph into the owned HostManager, creates a PerGlowGraphInfo which is
   /// cached for the given inputs, and then \returns this PerGlowGraphInfo.
-  Expected<PerGlowGraphInfo *> loadImpl(torch::jit::Stack &stack);
+  /// The function of \p lastRun is returned without hashing if the inputs
+  /// on the stack have the same types as those of \p lastRun, which is
+  /// updated otherwise. With asyncCompilationEnabled, a new function is
+  /// compiled in the background instead, and nullptr is returned until it is
+  /// ready to signal that the stack should run in the PyTorch JIT interpreter.
+  Expected<PerGlowGraphInfo *> loadImpl(torch::jit::Stack &stack,
+                                        LastRun &lastRun);
+
+  /// Loads graph_ for the inputs \p inputs into a Glow function and adds it
+  /// to the HostManager, filling in \p info.
+  Error compileImpl(PerGlowGraphInfo &info,
+                    c10::ArrayRef<c10::IValue> inputs) const;
+
+  /// \returns whether graph_ can run in the PyTorch JIT interpreter, which
+  /// is not the case if it has placeholder ops of Glow fusion passes.
+  bool canRunFallback() const;
 
   /// Given a PerGlowGraphInfo \p info for a subgraph that was previously
   /// loaded, this runs the Glow function that corresponds to that
   /// PerGlowGraphInfo in the shape of the inputs with the given \p stack.
-  Error runImpl(const PerGlowGraphInfo &info, torch::jit::Stack &stack) const;
+  /// If \p reusableOutputs is given, it holds the output tensors of an
+  /// earlier run of \p info, whose buffers are reused if nothing else holds
+  /// them, and it receives the output tensors of this run.
+  Error runImpl(const PerGlowGraphInfo &info, torch::jit::Stack &stack,
+                std::vector<at::Tensor> *reusableOutputs = nullptr) const;
 
   /// Given a \p stack of inputs, computes the hash for the inputs on the stack.
   size_t computeGraphHash(const c10::ArrayRef<c10::IValue> inputs) const;
 
+  /// \returns the types of \p inputs.
+  static std::vector<InputSignature>
+  computeInputSignatures(const c10::ArrayRef<c10::IValue> inputs);
+
+  /// \returns whether \p inputs have the types \p signatures.
+  static bool matchInputSignatures(const c10::ArrayRef<c10::IValue> inputs,
+                                   llvm::ArrayRef<InputSignature> signatures);
+
+  /// \returns the LastRun of the calling thread for this CachingGraphRunner.
+  LastRun &getLastRun() const;
+
 public:
   CachingGraphRunner(torch::jit::Graph *graph,
                      runtime::HostManager *hostManager);
@@ -126,10 +126,67 @@ getNewNode(torch::jit::Node *node, torch::jit::AliasDb &aliasDb,
   }
   return {++node->reverseIterator(), false};
 }
+
+/// \returns the bytes of the tensor \p value, or 0 if its type isn't complete.
+size_t getTensorBytes(const torch::jit::Value *value) {
+  auto type = value->type()->cast<c10::TensorType>();
+  if (!type || !type->scalarType() || !type->sizes().concrete_sizes()) {
+    return 0;
+  }
+  size_t bytes = c10::elementSize(*type->scalarType());
+  for (auto size : *type->sizes().concrete_sizes()) {
+    bytes *= size;
+  }
+  return bytes;
+}
+
+/// Estimates the cost of the fusion group \p group as the Partitioner does
+/// for memory bound nodes. Sets \p numNodes to the number of nodes of the
+/// group which aren't constants, and \p bytes to the bytes they read and
+/// write, counting only the tensors whose types are complete.
+void estimateFusionGroupCost(torch::jit::Node *group, size_t &numNodes,
+                             size_t &bytes) {
+  numNodes = 0;
+  bytes = 0;
+  for (auto *node : group->g(torch::jit::attr::Subgraph)->nodes()) {
+    if (node->kind() == torch::jit::prim::Constant) {
+      continue;
+    }
+    numNodes++;
+    for (auto *input : node->inputs()) {
+      bytes += getTensorBytes(input);
+    }
+    for (auto *output : node->outputs()) {
+      bytes += getTensorBytes(output);
+    }
+  }
+}
+
+/// Inlines back the fusion groups of \p kind in \p block which have fewer
+/// than \p minGroupSize nodes or move fewer than \p minGroupBytes bytes, so
+/// that they don't pay the cost of a Glow run for little compute.
+void unfuseSmallGroups(torch::jit::Block *block, at::Symbol kind,
+                       size_t minGroupSize, size_t minGroupBytes) {
+  std::vector<torch::jit::Node *> smallGroups;
+  for (auto *node : block->nodes()) {
+    if (node->kind() != kind) {
+      continue;
+    }
+    size_t numNodes, bytes;
+    estimateFusionGroupCost(node, numNodes, bytes);
+    if (numNodes < minGroupSize || bytes < minGroupBytes) {
+      smallGroups.push_back(node);
+    }
+  }
+  for (auto *node : smallGroups) {
+    torch::jit::SubgraphUtils::unmergeSubgraph(node);
+  }
+}
 } // namespace
 
 void GlowCustomFuse(std::shared_ptr<torch::jit::Graph> graph, isSupportFunc fn,
-                    at::Symbol kind) {
+                    at::Symbol kind, size_t minGroupSize,
+                    size_t minGroupBytes) {
   torch::jit::AliasDb aliasDb(graph);
   auto block = graph->block();
 
@@ -143,6 +200,7 @@ void GlowCustomFuse(std::shared_ptr<torch::jit::Graph> graph, isSupportFunc fn,
       is_changed |= is_changed_thisnode;
     }
   } while (is_changed);
+  unfuseSmallGroups(block, kind, minGroupSize, minGroupBytes);
   EliminateCommonSubexpression(graph);
   EliminateDeadCode(graph);
 }
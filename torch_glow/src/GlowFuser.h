@@ -22,8 +22,13 @@
 namespace glow {
 typedef std::function<bool(torch::jit::Node *)> isSupportFunc;
 
+/// Fuses the maximal regions of \p graph whose nodes are supported by \p fn
+/// into nodes of \p kind. The regions with fewer than \p minGroupSize nodes or
+/// whose nodes read and write fewer than \p minGroupBytes bytes are left to
+/// the JIT.
 void GlowCustomFuse(std::shared_ptr<torch::jit::Graph> graph, isSupportFunc fn,
-                    at::Symbol kind);
+                    at::Symbol kind, size_t minGroupSize = 1,
+                    size_t minGroupBytes = 0);
 } // namespace glow
 
 #endif // GLOW_TORCH_GLOW_SRC_GLOW_FUSER_H
@@ -20,6 +20,7 @@
 #include "FusePrepack.h"
 #include "GlowFuser.h"
 #include "PyTorchModelLoader.h"
+#include "glow/Support/Memory.h"
 
 #include <torch/csrc/jit/operator_options.h>
 #include <torch/csrc/jit/pass_manager.h>
@@ -143,7 +144,9 @@ void glowCustomFuse(std::shared_ptr<torch::jit::Graph> &g,
 
   fuseKnownPatterns(g);
 
-  GlowCustomFuse(g, PyTorchModelLoader::isNodeSupported, fuseSymbol);
+  const auto &settings = getPyTorchLoaderSettings();
+  GlowCustomFuse(g, PyTorchModelLoader::isNodeSupported, fuseSymbol,
+                 settings.minFusionGroupSize, settings.minFusionGroupBytes);
 }
 
 void registerGlowOp(const c10::Symbol &symbol) {
@@ -227,9 +230,30 @@ at::Tensor glowTypeToEmptyPTTensor(const glow::Type &glowType) {
                               elemKindToScalarType(glowType.getElementType())));
 }
 
+bool isPTTensorBindable(const at::Tensor &ptTensor) {
+  auto address = reinterpret_cast<uintptr_t>(ptTensor.data_ptr());
+  return ptTensor.device().is_cpu() && ptTensor.is_contiguous() &&
+         address % TensorAlignment == 0;
+}
+
+glow::Tensor ptTensorToGlowTensor(const at::Tensor &ptTensor,
+                                  TypeRef glowType) {
+  DCHECK_EQ(ptTensor.nbytes(), glowType->getSizeInBytes())
+      << "The PyTorch Tensor and the Glow Type have different sizes.";
+  if (isPTTensorBindable(ptTensor)) {
+    return glow::Tensor(ptTensor.data_ptr(), glowType);
+  }
+  // Copy the elements in their contiguous order into an aligned Tensor.
+  const at::Tensor contiguous = ptTensor.to(at::kCPU).contiguous();
+  glow::Tensor glowTensor(glowType);
+  memcpy(glowTensor.getUnsafePtr(), contiguous.data_ptr(),
+         glowType->getSizeInBytes());
+  return glowTensor;
+}
+
 glow::Tensor ptTensorToGlowTensor(const at::Tensor &ptTensor) {
   auto glowType = ptTypeToGlowType(*c10::TensorType::create(ptTensor));
-  return glow::Tensor(ptTensor.data_ptr(), &glowType);
+  return ptTensorToGlowTensor(ptTensor, &glowType);
 }
 
 void fuseKnownPatterns(std::shared_ptr<torch::jit::Graph> &graph) {
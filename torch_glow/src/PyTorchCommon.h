@@ -40,6 +40,21 @@ struct PyTorchLoaderSettings {
 
   /// Name of the Glow backend to use with CachingGraphRunner's HostManager.
   std::string glowBackendName = "Interpreter";
+
+  /// Whether a PyTorch subgraph run with inputs of new types runs in the
+  /// PyTorch JIT interpreter while Glow compiles it in the background, rather
+  /// than waiting for Glow to compile it.
+  bool asyncCompilationEnabled = false;
+
+  /// The fusion groups with fewer nodes than this, constants aside, are left
+  /// to the PyTorch JIT interpreter: their Glow runs would cost more than
+  /// they compute.
+  size_t minFusionGroupSize = 1;
+
+  /// The fusion groups whose nodes read and write fewer bytes than this are
+  /// left to the PyTorch JIT interpreter. Only the tensors whose types are
+  /// complete are counted.
+  size_t minFusionGroupBytes = 0;
 };
 
 /// Given a PyTorch ScalarType \p ty, \returns a matching Glow ElemKind.
@@ -79,8 +94,20 @@ void registerGlowFusionOpAndPass(std::function<bool()> enablePassFn);
 /// Given a PyTorch TensorType \p ptType, \returns a matching Glow Type.
 glow::Type ptTypeToGlowType(const c10::TensorType &ptType);
 
-/// Given a PyTorch Tensor \p ptTensor, \returns an unowned Glow Tensor with a
-/// matching type backed by the same memory as ptTensor.
+/// \returns whether an unowned Glow Tensor can be backed by the memory of the
+/// PyTorch Tensor \p ptTensor: its elements must be in the memory of the host,
+/// contiguous, and aligned as the Glow Tensors are.
+bool isPTTensorBindable(const at::Tensor &ptTensor);
+
+/// Given a PyTorch Tensor \p ptTensor and a Glow Type \p glowType of the same
+/// size in bytes, \returns an unowned Glow Tensor of glowType backed by the
+/// same memory as ptTensor if it is bindable, see isPTTensorBindable, and
+/// otherwise an owned copy of its elements.
+glow::Tensor ptTensorToGlowTensor(const at::Tensor &ptTensor,
+                                  TypeRef glowType);
+
+/// Given a PyTorch Tensor \p ptTensor, \returns a Glow Tensor with a matching
+/// type, unowned and backed by the same memory as ptTensor when possible.
 glow::Tensor ptTensorToGlowTensor(const at::Tensor &ptTensor);
 
 /// Given a Glow Type \p glowType, \returns an empty PyTorch Tensor with a
@@ -23,6 +23,10 @@
 #include <ATen/ATen.h>
 #include <torch/csrc/jit/ir.h>
 
+#include <map>
+#include <mutex>
+#include <tuple>
+
 namespace glow {
 
 namespace {
@@ -413,6 +417,18 @@ struct BNInputs {
   };
 };
 
+/// Indexes of aten::layer_norm inputs.
+struct LNInputs {
+  enum {
+    input = 0,
+    normalized_shape = 1,
+    weight = 2,
+    bias = 3,
+    eps = 4,
+    cuddnn_enabled = 5,
+  };
+};
+
 /// Indexes of aten::avg_pool2d inputs.
 struct AvgPoolInputs {
   enum {
@@ -572,6 +588,72 @@ struct AddMMInputs {
     alpha = 4,
   };
 };
+
+/// \returns \p weights rescaled from uint8 to int8 if \p rescaleToInt, and
+/// transposed with \p shuffle.
+glow::Tensor convertWeightsTensor(const glow::Tensor &weights,
+                                  llvm::ArrayRef<glow::unsigned_t> shuffle,
+                                  bool rescaleToInt) {
+  glow::Tensor rescaled;
+  const glow::Tensor *src = &weights;
+  if (rescaleToInt && weights.getElementType() == ElemKind::UInt8QTy) {
+    const auto &ty = weights.getType();
+    rescaled.reset(ElemKind::Int8QTy, ty.dims(), ty.getScale(),
+                   ty.getOffset() - OFFSETSHIFT);
+    auto srcH = weights.getHandle<uint8_t>();
+    auto destH = rescaled.getHandle<int8_t>();
+    for (size_t i = 0, e = srcH.size(); i < e; i++) {
+      destH.raw(i) = int32_t(srcH.raw(i)) - OFFSETSHIFT;
+    }
+    src = &rescaled;
+  }
+  glow::Tensor converted;
+  src->transpose(&converted, shuffle);
+  return converted;
+}
+
+/// The frozen PyTorch weights converted for Glow. The Glow functions loaded
+/// for the different input shapes of a graph share them instead of holding
+/// copies. The PyTorch tensors are kept alive so that their identities stay
+/// valid. Like the frozen Constants, which alias the PyTorch tensors, this
+/// assumes that frozen weights aren't modified.
+class ConvertedWeightsCache {
+  using Key =
+      std::tuple<const c10::TensorImpl *, std::vector<glow::unsigned_t>, bool>;
+
+  struct Entry {
+    at::Tensor source;
+    glow::Tensor converted;
+  };
+
+  std::mutex mutex_;
+  std::map<Key, std::unique_ptr<Entry>> entries_;
+
+public:
+  /// \returns the weights \p weights of the PyTorch tensor \p source
+  /// converted as by convertWeightsTensor, which stay valid for the life of
+  /// the process.
+  const glow::Tensor &get(const at::Tensor &source,
+                          const glow::Tensor &weights,
+                          llvm::ArrayRef<glow::unsigned_t> shuffle,
+                          bool rescaleToInt) {
+    Key key{source.unsafeGetTensorImpl(), shuffle.vec(), rescaleToInt};
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto &entry = entries_[key];
+    if (!entry) {
+      entry = llvm::make_unique<Entry>();
+      entry->source = source;
+      entry->converted = convertWeightsTensor(weights, shuffle, rescaleToInt);
+    }
+    return entry->converted;
+  }
+};
+
+/// \returns the ConvertedWeightsCache singleton.
+ConvertedWeightsCache &getConvertedWeightsCache() {
+  static ConvertedWeightsCache cache;
+  return cache;
+}
 } // namespace
 
 // static
@@ -670,6 +752,15 @@ PyTorchModelLoader::getSymbolsMapping() {
             BNInputs::eps,
             BNInputs::cuddnn_enabled,
         }},
+       {{"aten::layer_norm"},
+        &PyTorchModelLoader::loadLayerNorm,
+        {
+            LNInputs::normalized_shape,
+            LNInputs::weight,
+            LNInputs::bias,
+            LNInputs::eps,
+            LNInputs::cuddnn_enabled,
+        }},
        {{"aten::max_pool2d"},
         &PyTorchModelLoader::loadMaxPool2d,
         {
@@ -784,6 +875,13 @@ Error PyTorchModelLoader::freezeWeights(const torch::jit::Node *ptNode) {
     RETURN_IF_ERR(
         addValueMapping(inputs[i], std::move(glowIVal), /*wasFrozen*/ true));
 
+    if (inputIVal.isTensor()) {
+      glow::NodeValue frozen;
+      ASSIGN_VALUE_OR_RETURN_ERR(frozen, getGlowNodeValueForValue(inputs[i]));
+      frozenTensors_[llvm::cast<glow::Constant>(frozen.getNode())] =
+          inputIVal.toTensor();
+    }
+
     if (frozenInputIndices_) {
       frozenInputIndices_->insert(inputIndex);
     }
@@ -914,6 +1012,27 @@ glow::NodeValue PyTorchModelLoader::rescaleUIntToInt(glow::NodeValue input) {
   }
 }
 
+glow::NodeValue
+PyTorchModelLoader::convertWeights(llvm::StringRef name,
+                                   glow::NodeValue weights,
+                                   llvm::ArrayRef<glow::unsigned_t> shuffle,
+                                   bool rescaleToInt) {
+  auto *C = llvm::dyn_cast<glow::Constant>(weights.getNode());
+  auto it = C ? frozenTensors_.find(C) : frozenTensors_.end();
+  if (it == frozenTensors_.end()) {
+    if (rescaleToInt) {
+      weights = rescaleUIntToInt(weights);
+    }
+    return F_.createTranspose(name, weights, shuffle);
+  }
+
+  const glow::Tensor &converted = getConvertedWeightsCache().get(
+      it->second, C->getPayload(), shuffle, rescaleToInt);
+  // The Constant doesn't own the converted weights, which the cache keeps.
+  glow::Tensor unowned(converted.getUnsafePtr(), &converted.getType());
+  return F_.getParent()->createConstant(name, std::move(unowned))->getOutput();
+}
+
 glow::NodeValue PyTorchModelLoader::rescaleIntToUint(glow::NodeValue input) {
   auto *inputTy = input.getType();
   if (inputTy->getElementType() == ElemKind::Int8QTy) {
@@ -977,11 +1096,10 @@ Error PyTorchModelLoader::loadQuantizedLinear(const torch::jit::Node *ptNode) {
   glow::NodeValue weight;
   ASSIGN_VALUE_OR_RETURN_ERR(
       weight, getGlowNodeValueForValue(inputs[QuantizedLinearInputs::weight]));
-  weight = rescaleUIntToInt(weight);
-
   RETURN_ERR_IF_NOT(weight.dims().size() == 2, "Expected 2d Linear weights");
 
-  weight = F_.createTranspose("weight_transpose", weight, {1, 0});
+  weight = convertWeights("weight_transpose", weight, {1, 0},
+                          /*rescaleToInt*/ true);
 
   float outScale;
   ASSIGN_VALUE_OR_RETURN_ERR(outScale,
@@ -1324,7 +1442,8 @@ Error PyTorchModelLoader::loadConvolution(const torch::jit::Node *ptNode) {
   glow::NodeValue weights;
   ASSIGN_VALUE_OR_RETURN_ERR(
       weights, getGlowNodeValueForValue(inputs[ConvInputs::weights]));
-  weights = F_.createTranspose("conv_weights_transposed", weights, NCHW2NHWC);
+  weights = convertWeights("conv_weights_transposed", weights, NCHW2NHWC,
+                           /*rescaleToInt*/ false);
   glow::ShapeNHWC weightsShape(weights.dims());
 
   // If a bias was provided then use it otherwise create a 0 bias.
@@ -1459,6 +1578,62 @@ Error PyTorchModelLoader::loadBatchNorm(const torch::jit::Node *ptNode) {
   return addValueMapping(outputs[0], bn->getResult());
 }
 
+Error PyTorchModelLoader::loadLayerNorm(const torch::jit::Node *ptNode) {
+  auto inputs = ptNode->inputs();
+  auto outputs = ptNode->outputs();
+  RETURN_IF_ERR(checkInputAndOutputSizes(inputs, 6, outputs, 1));
+
+  glow::NodeValue input;
+  ASSIGN_VALUE_OR_RETURN_ERR(input,
+                             getGlowNodeValueForValue(inputs[LNInputs::input]));
+
+  std::vector<int64_t> *normalizedShape;
+  ASSIGN_VALUE_OR_RETURN_ERR(normalizedShape,
+                             iValToIntList(getGlowIValueForValue(
+                                 inputs[LNInputs::normalized_shape])));
+  RETURN_ERR_IF_NOT(normalizedShape->size() <= input.dims().size(),
+                    "normalized_shape must not have more dims than input.");
+  std::vector<size_t> shape(normalizedShape->begin(), normalizedShape->end());
+  RETURN_ERR_IF_NOT(
+      llvm::ArrayRef<size_t>(shape) ==
+          input.dims().take_back(normalizedShape->size()),
+      "normalized_shape must equal the trailing dims of input.");
+
+  glow::NodeValue weight;
+  if (hasGlowNodeValueForValue(inputs[LNInputs::weight])) {
+    ASSIGN_VALUE_OR_RETURN_ERR(
+        weight, getGlowNodeValueForValue(inputs[LNInputs::weight]));
+  } else {
+    glow::Tensor weightT(glow::ElemKind::FloatTy, shape);
+    weightT.init(glow::Tensor::InitKind::Broadcast, 1,
+                 F_.getParent()->getPRNG());
+    weight = F_.getParent()
+                 ->createConstant("layernorm_weight", std::move(weightT))
+                 ->getOutput();
+  }
+
+  glow::NodeValue bias;
+  if (hasGlowNodeValueForValue(inputs[LNInputs::bias])) {
+    ASSIGN_VALUE_OR_RETURN_ERR(
+        bias, getGlowNodeValueForValue(inputs[LNInputs::bias]));
+  } else {
+    glow::Tensor biasT(glow::ElemKind::FloatTy, shape);
+    biasT.zero();
+    bias = F_.getParent()
+               ->createConstant("layernorm_bias", std::move(biasT))
+               ->getOutput();
+  }
+
+  float epsilon;
+  ASSIGN_VALUE_OR_RETURN_ERR(
+      epsilon,
+      to32Bit(iValToDouble(getGlowIValueForValue(inputs[LNInputs::eps]))));
+
+  glow::LayerNormalizationNode *ln =
+      F_.createLayerNormalization("layernorm", input, weight, bias, epsilon);
+  return addValueMapping(outputs[0], ln->getResult());
+}
+
 Error PyTorchModelLoader::loadQuantize(const torch::jit::Node *ptNode) {
   auto inputs = ptNode->inputs();
   auto outputs = ptNode->outputs();
@@ -1535,8 +1710,8 @@ Error PyTorchModelLoader::loadQuantizedConvUnpacked(
   ASSIGN_VALUE_OR_RETURN_ERR(
       weights,
       getGlowNodeValueForValue(inputs[QuantizedUnpackedConv2dInputs::weights]));
-  weights = rescaleUIntToInt(weights);
-  weights = F_.createTranspose("qconv_weights_tranposed", weights, NCHW2NHWC);
+  weights = convertWeights("qconv_weights_tranposed", weights, NCHW2NHWC,
+                           /*rescaleToInt*/ true);
   glow::ShapeNHWC weightsShape(weights.dims());
 
   glow::NodeValue bias;
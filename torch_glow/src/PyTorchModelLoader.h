@@ -111,6 +111,10 @@ class PyTorchModelLoader {
   /// to them after loading is complete.
   std::set<size_t> *frozenInputIndices_ = nullptr;
 
+  /// The PyTorch tensors of the Constants created for frozen inputs, whose
+  /// conversions are shared by all the loads, see convertWeights.
+  std::unordered_map<const glow::Constant *, at::Tensor> frozenTensors_;
+
   /// Flags if the memory held by aten::Constants of Tensor type should be
   /// copied.
   const bool copyTensorMemory_;
@@ -319,6 +323,10 @@ private:
   /// \returns error on failure.
   Error loadBatchNorm(const torch::jit::Node *ptNode);
 
+  /// Load a PyTorch layer_norm node.
+  /// \returns error on failure.
+  Error loadLayerNorm(const torch::jit::Node *ptNode);
+
   /// Load a PyTorch quantized::add node.
   /// \return error on failure.
   Error loadQuantizedAdd(const torch::jit::Node *ptNode);
@@ -412,6 +420,15 @@ private:
 
   /// Rescale a int8 NodeValue \p input to the equivalent uint8 NodeValue.
   glow::NodeValue rescaleIntToUint(glow::NodeValue input);
+
+  /// \returns the weights \p weights rescaled from uint8 to int8 if
+  /// \p rescaleToInt, and transposed with \p shuffle. If \p weights is a
+  /// frozen input, it is converted once per PyTorch tensor into a Constant
+  /// named \p name which the Glow functions loaded for every input shape
+  /// share, rather than folded into a new Constant by each of them.
+  glow::NodeValue convertWeights(llvm::StringRef name, glow::NodeValue weights,
+                                 llvm::ArrayRef<glow::unsigned_t> shuffle,
+                                 bool rescaleToInt);
 };
 
 } // namespace glow
@@ -53,6 +53,27 @@ PYBIND11_MODULE(_torch_glow, m) {
   m.def("disableWeightFreezing",
         []() { getPyTorchLoaderSettings().weightFreezingEnabled = false; });
 
+  /// Enable compiling PyTorch subgraphs in the background, running them in
+  /// the PyTorch JIT interpreter until Glow has compiled them.
+  m.def("enableAsyncCompilation",
+        []() { getPyTorchLoaderSettings().asyncCompilationEnabled = true; });
+
+  /// Disable compiling PyTorch subgraphs in the background.
+  m.def("disableAsyncCompilation",
+        []() { getPyTorchLoaderSettings().asyncCompilationEnabled = false; });
+
+  /// Leave the fusion groups with fewer nodes than the given number to the
+  /// PyTorch JIT interpreter.
+  m.def("setMinFusionGroupSize", [](size_t minSize) {
+    getPyTorchLoaderSettings().minFusionGroupSize = minSize;
+  });
+
+  /// Leave the fusion groups whose nodes read and write fewer bytes than the
+  /// given number to the PyTorch JIT interpreter.
+  m.def("setMinFusionGroupBytes", [](size_t minBytes) {
+    getPyTorchLoaderSettings().minFusionGroupBytes = minBytes;
+  });
+
   /// Binding wrapper class for TorchGlowTraining and its settings.
   py::class_<TorchGlowTrainingWrapper>(m, "TorchGlowTrainingWrapper")
       .def(py::init())
@@ -0,0 +1,33 @@
+from __future__ import absolute_import, division, print_function, unicode_literals
+
+import torch
+
+import torch_glow
+
+
+def add_relu(a, b):
+    return (a + b).relu()
+
+
+def test_async_compilation():
+    """Test that results are right while Glow compiles in the background."""
+
+    torch_glow.enableFusionPass()
+    torch_glow.enableAsyncCompilation()
+
+    try:
+        with torch.no_grad():
+            a = torch.randn(4, 5)
+            b = torch.randn(4, 5)
+            traced = torch.jit.trace(add_relu, (a, b))
+
+            # The first runs of every shape may run in the PyTorch JIT
+            # interpreter, the later ones in Glow.
+            for shape in [(4, 5), (2, 3), (4, 5)]:
+                for _ in range(10):
+                    x = torch.randn(shape)
+                    y = torch.randn(shape)
+                    assert torch.allclose(traced(x, y), add_relu(x, y))
+    finally:
+        torch_glow.disableAsyncCompilation()
+        torch_glow.disableFusionPass()
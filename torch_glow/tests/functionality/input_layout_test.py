@@ -0,0 +1,37 @@
+from __future__ import absolute_import, division, print_function, unicode_literals
+
+import torch
+
+from tests.utils import jitVsGlow
+
+
+def add_relu(a, b):
+    return (a + b).relu()
+
+
+def test_contiguous_inputs():
+    """Test the inputs that Glow reads in place."""
+
+    jitVsGlow(add_relu, torch.randn(4, 6), torch.randn(4, 6),
+              expected_fused_ops={"aten::add", "aten::relu"})
+
+
+def test_noncontiguous_inputs():
+    """Test that the transposed inputs are copied before Glow reads them."""
+
+    a = torch.randn(6, 4).t()
+    b = torch.randn(4, 6)
+    assert not a.is_contiguous()
+
+    jitVsGlow(add_relu, a, b, expected_fused_ops={"aten::add", "aten::relu"})
+
+
+def test_misaligned_inputs():
+    """Test that the inputs that don't start at the alignment of the Glow
+    Tensors are copied before Glow reads them."""
+
+    a = torch.randn(25)[1:]
+    b = torch.randn(24)
+    assert a.is_contiguous()
+
+    jitVsGlow(add_relu, a, b, expected_fused_ops={"aten::add", "aten::relu"})
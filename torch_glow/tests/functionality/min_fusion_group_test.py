@@ -0,0 +1,56 @@
+from __future__ import absolute_import, division, print_function, unicode_literals
+
+import torch
+
+import torch_glow
+
+GLOW_NODE_NAME = "glow::FusionGroup"
+
+
+def add(a, b):
+    return a + b
+
+
+def add_relu_mul(a, b):
+    return (a + b).relu() * b
+
+
+def count_glow_nodes(f, *inputs):
+    traced = torch.jit.trace(f, inputs)
+    assert torch.allclose(traced(*inputs), f(*inputs))
+    return len(traced.graph_for(*inputs).findAllNodes(GLOW_NODE_NAME))
+
+
+def test_min_fusion_group_size():
+    """Test that the fusion groups with too few nodes are left to the JIT."""
+
+    torch_glow.enableFusionPass()
+    torch_glow.setMinFusionGroupSize(2)
+
+    try:
+        with torch.no_grad():
+            a = torch.randn(4, 5)
+            b = torch.randn(4, 5)
+            assert count_glow_nodes(add, a, b) == 0
+            assert count_glow_nodes(add_relu_mul, a, b) == 1
+    finally:
+        torch_glow.setMinFusionGroupSize(1)
+        torch_glow.disableFusionPass()
+
+
+def test_min_fusion_group_bytes():
+    """Test that the fusion groups moving too few bytes are left to the JIT."""
+
+    torch_glow.enableFusionPass()
+    # add reads two 4x5 float tensors and writes one: 240 bytes.
+    torch_glow.setMinFusionGroupBytes(1000)
+
+    try:
+        with torch.no_grad():
+            assert count_glow_nodes(add, torch.randn(4, 5),
+                                    torch.randn(4, 5)) == 0
+            assert count_glow_nodes(add, torch.randn(40, 50),
+                                    torch.randn(40, 50)) == 1
+    finally:
+        torch_glow.setMinFusionGroupBytes(0)
+        torch_glow.disableFusionPass()
@@ -31,3 +31,23 @@ def test_weight_freezing():
     out2 = conv2d_freeze(inputs, filters)
 
     assert(torch.allclose(out1, out2))
+
+
+def test_frozen_weights_shared_across_shapes():
+    """Test that the frozen weights converted for the Glow function of one
+    input shape are right for the functions of the other shapes."""
+
+    torch_glow.enableFusionPass()
+    torch_glow.enableWeightFreezing()
+
+    try:
+        with torch.no_grad():
+            filters = torch.randn(8, 4, 3, 3)
+            traced = torch.jit.trace(conv2d, (torch.randn(1, 4, 5, 5),
+                                              filters))
+            for shape in [(1, 4, 5, 5), (2, 4, 7, 7), (1, 4, 5, 5)]:
+                inputs = torch.randn(shape)
+                assert torch.allclose(traced(inputs, filters),
+                                      conv2d(inputs, filters), atol=1e-5)
+    finally:
+        torch_glow.disableFusionPass()
@@ -0,0 +1,31 @@
+from __future__ import absolute_import, division, print_function, unicode_literals
+
+import torch
+import torch.nn.functional as F
+
+from tests.utils import jitVsGlow
+
+
+def test_layernorm_basic():
+    """Basic test of the PyTorch layernorm Node on Glow."""
+
+    def test_f(inputs):
+        return F.layer_norm(inputs, [5])
+
+    inputs = torch.randn(2, 4, 5)
+
+    jitVsGlow(test_f, inputs, expected_fused_ops={"aten::layer_norm"})
+
+
+def test_layernorm_with_weights():
+    """Test of the PyTorch layernorm Node with weights and biases on Glow."""
+
+    def test_f(inputs, weight, bias):
+        return F.layer_norm(inputs, [4, 5], weight=weight, bias=bias, eps=1e-3)
+
+    inputs = torch.randn(2, 4, 5)
+    weight = torch.rand(4, 5)
+    bias = torch.rand(4, 5)
+
+    jitVsGlow(test_f, inputs, weight, bias,
+              expected_fused_ops={"aten::layer_norm"})